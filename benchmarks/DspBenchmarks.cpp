@@ -0,0 +1,1207 @@
+#include <JuceHeader.h>
+#include <QCoreApplication>
+#include "../src/DJAudioPlayer.h"
+#include "../src/DeckMixer.h"
+#include "../src/WaveformGenerator.h"
+#include "../src/BpmAnalyzer.h"
+#include "../src/LibraryManager.h"
+#include "../src/SessionReplay.h"
+#include "../src/RealtimeAllocGuard.h"
+#include "../src/DeckEffectRack.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <sys/resource.h>
+#endif
+
+/**
+ * Headless benchmarks for the engine's hot paths: deck rendering in every playback mode, the
+ * deck mixer, waveform and BPM analysis and the library model's sort and filter.
+ *
+ * Every benchmark runs on a synthetic 60 s, 124 BPM test track written to the temp folder, so
+ * runs on different machines are comparable. Each prints a median / p95 per iteration and, for
+ * block rendering, the real-time factor at 512 samples / 48 kHz.
+ *
+ *     DavidBench [--json results.json] [--filter keylock] [--quick] [--verbose]
+ *     DavidBench --replay last_mix_automation.json [--json report.json] [--parallel]
+ *     DavidBench --rt-check [--quick] [--filter loads] [--verbose]
+ *     DavidBench --accuracy dataset.json [--threads 8] [--json report.json] [--baseline old.json]
+ *     DavidBench --scaling [--decks 8] [--filter keylock] [--parallel] [--quick] [--json scaling.json]
+ *
+ * The JSON uses Google Benchmark's field names (name, iterations, real_time, time_unit) so its
+ * compare.py can diff two runs. scripts/pgo-build.sh uses a --quick run as the training workload
+ * of the profile-guided build.
+ *
+ * --replay runs a recorded set (File > Record Mix) through SessionReplay instead, at full speed
+ * and with every block timed, and prints the blocks that came closest to or over the deadline.
+ *
+ * --rt-check is the real-time safety run for CI: two decks through the mixer in every mode
+ * (keylock toggles, loops and jumps, uncached loop wraps, scratching, loads while playing, EQ and
+ * filter sweeps, effects, device blocks larger than announced, brakes), each mixer callback inside a RealtimeAllocGuard::Scope and the
+ * controls moved from this thread in between, as the UI would. Any allocation, free or mutex lock on
+ * the audio side fails it (exit code 1) with the stack of the first one. Needs a build with
+ * -DDAVID_RT_CHECKS=ON (or a debug build, which catches operator new/delete only); such a build
+ * registers a --quick run as the rt_safety test, so ctest runs it.
+ *
+ * --accuracy weighs analysis speed against what it gets right, so a faster analysis (parallel
+ * detectors, streaming, a shared FFT) can be checked against the last run. It runs
+ * BpmAnalyzer::analyzeFile over a ground-truth set on --threads workers and reports tracks per
+ * second, the process's peak RSS, BPM accuracy (within 0.5 BPM; off by a factor of two counts
+ * as an octave error) and the mean beat F-measure (70 ms window, the first 5 s skipped, as in
+ * mir_eval). The dataset is a JSON file, paths relative to it:
+ *
+ *     { "tracks": [ { "file": "house/01.flac", "bpm": 124.0, "beats_file": "house/01.beats" },
+ *                   { "file": "dnb/02.mp3", "bpm": 174.0, "beats": [ 0.21, 0.55, ... ] } ] }
+ *
+ * A beats file takes the first number of every line (the .beats annotations of the public
+ * sets). Tracks without a BPM only count for speed. --baseline prints the change against an
+ * earlier --json report.
+ *
+ * --scaling finds where this machine tops out: for every feature set (plain, EQ, loops,
+ * effects, each keylock profile, all of them at once) and block size from 32 to 1024 it adds
+ * decks one at a time, up to --decks, and times every mixer callback against its deadline. A
+ * configuration is stable while the worst callback stays under StableLoad of the deadline, the
+ * rest being left to the OS, the UI and the driver. It ends with a table of the most decks that
+ * were stable per feature set and block size; --json keeps every run.
+ */
+namespace {
+    constexpr int BlockSize = 512;
+    constexpr double SampleRate = 48000.0;
+    constexpr double TrackBpm = 124.0;
+    constexpr double TrackSeconds = 60.0;
+
+    struct Result {
+        std::string name;
+        int iterations{0};
+        double medianNs{0.0};
+        double meanNs{0.0};
+        double minNs{0.0};
+        double p95Ns{0.0};
+        double realtimeFactor{0.0};   // audio per iteration / time per iteration; 0 when not audio
+    };
+
+    struct Options {
+        juce::String jsonPath;
+        juce::String filter;
+        bool quick{false};
+        bool verbose{false};
+        juce::String replayPath;
+        bool parallel{false};
+        bool rtCheck{false};
+        juce::String accuracyPath;
+        juce::String baselinePath;
+        int threads{1};
+        bool scaling{false};
+        int maxDecks{8};
+    };
+
+    // The engine logs a lot while loading; it is muted during the runs unless --verbose
+    class MutedCout {
+    public:
+        explicit MutedCout(bool mute) : saved(mute ? std::cout.rdbuf(sink.rdbuf()) : nullptr) {}
+        ~MutedCout() { if (saved != nullptr) std::cout.rdbuf(saved); }
+    private:
+        std::ostringstream sink;
+        std::streambuf* saved;
+    };
+
+    Result measure(const std::string& name, int warmup, int iterations, double audioSecondsPerIteration,
+                   const std::function<void(int)>& body)
+    {
+        for (int i = 0; i < warmup; ++i) body(i);
+
+        std::vector<double> samples((size_t) iterations);
+        for (int i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            body(warmup + i);
+            samples[(size_t) i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+        result.meanNs = sum / iterations;
+        std::sort(samples.begin(), samples.end());
+        result.minNs = samples.front();
+        result.medianNs = samples[samples.size() / 2];
+        result.p95Ns = samples[std::min(samples.size() - 1, (samples.size() * 95) / 100)];
+        if (audioSecondsPerIteration > 0.0 && result.medianNs > 0.0)
+            result.realtimeFactor = audioSecondsPerIteration * 1.0e9 / result.medianNs;
+        return result;
+    }
+
+    // Kick on every beat, off-beat hats and a sustained chord, so onsets, bands and keylock
+    // transients all have something to work on
+    juce::File writeTestTrack()
+    {
+        const juce::File file = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("DavidBench_124bpm.wav");
+        if (file.existsAsFile()) return file;
+
+        const int numSamples = (int) (TrackSeconds * SampleRate);
+        const double beatSamples = SampleRate * 60.0 / TrackBpm;
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        juce::Random random(124);
+        for (int n = 0; n < numSamples; ++n) {
+            const double t = n / SampleRate;
+            const double inBeat = std::fmod((double) n, beatSamples) / SampleRate;
+            const double inOffbeat = std::fmod(n + beatSamples * 0.5, beatSamples) / SampleRate;
+            const double kick = std::sin(2.0 * juce::MathConstants<double>::pi * (50.0 + 90.0 * std::exp(-inBeat * 30.0)) * inBeat)
+                                * std::exp(-inBeat * 8.0);
+            const double hat = (random.nextFloat() * 2.0 - 1.0) * std::exp(-inOffbeat * 60.0) * 0.25;
+            const double chord = 0.08 * (std::sin(2.0 * juce::MathConstants<double>::pi * 220.0 * t)
+                                         + std::sin(2.0 * juce::MathConstants<double>::pi * 277.18 * t)
+                                         + std::sin(2.0 * juce::MathConstants<double>::pi * 329.63 * t));
+            buffer.setSample(0, n, (float) (0.6 * kick + hat + chord));
+            buffer.setSample(1, n, (float) (0.6 * kick - hat + chord));
+        }
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::OutputStream> stream = std::make_unique<juce::FileOutputStream>(file);
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            wav.createWriterFor(stream.get(), SampleRate, 2, 16, {}, 0));
+        if (writer == nullptr) return {};
+        stream.release();
+        writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        return file;
+    }
+
+    enum class DeckMode { Plain, Varispeed, KeylockFast, KeylockBalanced, KeylockQuality, Loop, Scratch, Eq };
+
+    struct ModeInfo {
+        DeckMode mode;
+        const char* name;
+    };
+
+    const ModeInfo deckModes[] = {
+        { DeckMode::Plain,           "deck/plain" },
+        { DeckMode::Varispeed,       "deck/varispeed" },
+        { DeckMode::KeylockFast,     "deck/keylock_fast" },
+        { DeckMode::KeylockBalanced, "deck/keylock_balanced" },
+        { DeckMode::KeylockQuality,  "deck/keylock_quality" },
+        { DeckMode::Loop,            "deck/loop" },
+        { DeckMode::Scratch,         "deck/scratch" },
+        { DeckMode::Eq,              "deck/eq_filter" },
+    };
+
+    bool isKeylockMode(DeckMode mode)
+    {
+        return mode == DeckMode::KeylockFast || mode == DeckMode::KeylockBalanced || mode == DeckMode::KeylockQuality;
+    }
+
+    std::unique_ptr<DJAudioPlayer> makePlayer(juce::AudioFormatManager& formatManager, const juce::File& track, DeckMode mode,
+                                              int blockSize = BlockSize)
+    {
+        auto player = std::make_unique<DJAudioPlayer>(formatManager);
+        // The stretcher is built at prepare time, so its quality goes first
+        if (mode == DeckMode::KeylockFast) player->setKeylockQuality(DJAudioPlayer::KeylockQuality::Fast);
+        if (mode == DeckMode::KeylockBalanced) player->setKeylockQuality(DJAudioPlayer::KeylockQuality::Balanced);
+        if (mode == DeckMode::KeylockQuality) player->setKeylockQuality(DJAudioPlayer::KeylockQuality::Quality);
+        player->prepareToPlay(blockSize, SampleRate);
+        player->loadFile(track);
+        player->start();
+
+        if (mode != DeckMode::Plain) player->setSpeed(1.06);
+        if (isKeylockMode(mode)) player->setKeylockEnabled(true);
+        if (mode == DeckMode::Loop) player->enableLoop(0.0, 4 * 60.0 / TrackBpm);   // one bar from the top, wrapping every ~2 s
+        if (mode == DeckMode::Scratch) player->enableScratch(true);
+        if (mode == DeckMode::Eq) {
+            player->setHighGain(0.5);
+            player->setMidGain(-0.3);
+            player->setLowGain(-1.0);
+            player->setFilterCutoff(0.4);
+        }
+        return player;
+    }
+
+    class Runner {
+    public:
+        Runner(const Options& options, juce::AudioFormatManager& formatManager, const juce::File& track)
+            : options(options), formatManager(formatManager), track(track) {}
+
+        void runDeckModes()
+        {
+            const int iterations = options.quick ? 400 : 4000;
+            const double blockSeconds = BlockSize / SampleRate;
+            juce::AudioBuffer<float> buffer(2, BlockSize);
+            for (const auto& info : deckModes) {
+                if (!selected(info.name)) continue;
+                std::unique_ptr<DJAudioPlayer> player;
+                {
+                    const MutedCout mute(!options.verbose);
+                    player = makePlayer(formatManager, track, info.mode);
+                }
+                const bool scratching = info.mode == DeckMode::Scratch;
+                add(measure(info.name, 200, iterations, blockSeconds, [&](int i) {
+                    // Back and forth every ~85 ms, like a baby scratch
+                    if (scratching && i % 8 == 0) player->setScratchVelocity((i / 8) % 2 == 0 ? 1.5 : -1.5);
+                    const juce::AudioSourceChannelInfo block(&buffer, 0, BlockSize);
+                    player->getNextAudioBlock(block);
+                }));
+                player->releaseResources();
+            }
+        }
+
+        void runMixer(int numDecks, bool parallel)
+        {
+            const std::string name = "mixer/" + std::to_string(numDecks) + "_decks" + (parallel ? "_parallel" : "_serial");
+            if (!selected(name)) return;
+
+            std::vector<std::unique_ptr<DJAudioPlayer>> players;
+            DeckMixer mixer;
+            {
+                const MutedCout mute(!options.verbose);
+                for (int d = 0; d < numDecks; ++d) {
+                    players.push_back(makePlayer(formatManager, track, d % 2 == 0 ? DeckMode::Plain : DeckMode::KeylockBalanced));
+                    mixer.addChannel(players.back().get(), d % 2 == 0 ? DeckMixer::CrossfaderSide::A : DeckMixer::CrossfaderSide::B);
+                }
+                mixer.prepareToRender(2, BlockSize, SampleRate);
+                mixer.setParallelRendering(parallel);
+            }
+
+            juce::AudioBuffer<float> output(2, BlockSize);
+            const juce::AudioIODeviceCallbackContext context{};
+            const int iterations = options.quick ? 400 : 4000;
+            add(measure(name, 200, iterations, BlockSize / SampleRate, [&](int) {
+                mixer.audioDeviceIOCallbackWithContext(nullptr, 0, output.getArrayOfWritePointers(), 2, BlockSize, context);
+            }));
+
+            const MutedCout mute(!options.verbose);
+            mixer.setParallelRendering(false);
+            for (auto& player : players) player->releaseResources();
+        }
+
+        // A scripted two-deck transition: varispeed deck A into keylocked deck B, with a loop, EQ
+        // and filter moves, a crossfader sweep, a scratch and a beat jump. Each iteration is one
+        // callback, so p95 shows the blocks where the controls change. Also the PGO training run.
+        void runSession()
+        {
+            if (!selected("session/two_deck_set")) return;
+
+            DeckMixer mixer;
+            std::unique_ptr<DJAudioPlayer> deckA, deckB;
+            {
+                const MutedCout mute(!options.verbose);
+                deckA = makePlayer(formatManager, track, DeckMode::Varispeed);
+                deckB = makePlayer(formatManager, track, DeckMode::KeylockBalanced);
+                deckA->setSpeed(1.02);
+                deckB->setSpeed(0.97);
+                mixer.addChannel(deckA.get(), DeckMixer::CrossfaderSide::A);
+                mixer.addChannel(deckB.get(), DeckMixer::CrossfaderSide::B);
+                mixer.prepareToRender(2, BlockSize, SampleRate);
+                mixer.setCrossfader(-1.0f);
+            }
+
+            const double barSeconds = 4 * 60.0 / TrackBpm;
+            auto blockAt = [](double seconds) { return (int) (seconds * SampleRate / BlockSize); };
+            const int sweepStart = blockAt(20.0), sweepEnd = blockAt(28.0);
+            const int filterStart = blockAt(30.0), filterEnd = blockAt(36.0);
+            const int scratchStart = blockAt(36.0), scratchEnd = blockAt(38.0);
+
+            juce::AudioBuffer<float> output(2, BlockSize);
+            const juce::AudioIODeviceCallbackContext context{};
+            auto play = [&](int block) {
+                if (block == blockAt(8.0)) deckB->enableLoop(deckB->getCurrentPositionSeconds(), barSeconds);
+                if (block == blockAt(16.0)) deckB->disableLoop();
+                if (block == blockAt(18.0)) deckA->setLowGain(-1.0);
+                if (block == blockAt(28.0)) deckA->setLowGain(0.0);
+                if (block >= sweepStart && block < sweepEnd)
+                    mixer.setCrossfader(-1.0f + 2.0f * (float) (block - sweepStart) / (float) (sweepEnd - sweepStart));
+                if (block >= filterStart && block < filterEnd && block % 4 == 0)
+                    deckB->setFilterCutoff(0.5 * std::sin((block - filterStart) * 0.02));
+                if (block == scratchStart) deckA->enableScratch(true);
+                if (block > scratchStart && block < scratchEnd && block % 8 == 0)
+                    deckA->setScratchVelocity((block / 8) % 2 == 0 ? 1.5 : -1.5);
+                if (block == scratchEnd) deckA->enableScratch(false);
+                if (block == blockAt(40.0)) deckA->beatJump(4.0);
+                mixer.audioDeviceIOCallbackWithContext(nullptr, 0, output.getArrayOfWritePointers(), 2, BlockSize, context);
+            };
+
+            Result result;
+            {
+                // The control setters log every call
+                const MutedCout mute(!options.verbose);
+                result = measure("session/two_deck_set", 0, blockAt(45.0), BlockSize / SampleRate, play);
+            }
+            add(result);
+
+            deckA->releaseResources();
+            deckB->releaseResources();
+        }
+
+        void runWaveform()
+        {
+            if (!selected("analysis/waveform_generate")) return;
+            WaveformGenerator generator;
+            // One more consecutive chunk than the default keeps the waveform cache out of it
+            const int uncachedChunks = WaveformGenerator::DefaultConsecutiveChunks + 1;
+            add(measure("analysis/waveform_generate", 1, options.quick ? 3 : 10, TrackSeconds, [&](int) {
+                const MutedCout mute(!options.verbose);
+                WaveformGenerator::Result result;
+                generator.generate(track, 4096, result, WaveformGenerator::DefaultSilenceThreshold, uncachedChunks);
+            }));
+        }
+
+        void runBpm()
+        {
+            if (!selected("analysis/bpm_analyze_file")) return;
+            BpmAnalyzer analyzer;
+            add(measure("analysis/bpm_analyze_file", 1, options.quick ? 3 : 10, TrackSeconds, [&](int) {
+                const MutedCout mute(!options.verbose);
+                analyzer.analyzeFile(track, TrackSeconds);
+            }));
+        }
+
+        void runLibrary(int numTracks)
+        {
+            const std::string suffix = "_" + std::to_string(numTracks / 1000) + "k";
+            const QVector<TrackInfo> tracks = makeLibrary(numTracks);
+            const int iterations = options.quick ? 3 : (numTracks > 20000 ? 10 : 30);
+
+            if (selected("library/add_tracks" + suffix)) {
+                add(measure("library/add_tracks" + suffix, 1, iterations, 0.0, [&](int) {
+                    LibraryTableModel model;
+                    model.addTracks(tracks);
+                }));
+            }
+
+            LibraryTableModel model;
+            model.addTracks(tracks);
+            const std::pair<LibraryTableModel::SortMode, const char*> sorts[] = {
+                { LibraryTableModel::SortByTitle, "title" },
+                { LibraryTableModel::SortByArtist, "artist" },
+                { LibraryTableModel::SortByBpm, "bpm" },
+                { LibraryTableModel::SortByKey, "key" },
+            };
+            for (const auto& [mode, sortName] : sorts) {
+                const std::string name = "library/sort_" + std::string(sortName) + suffix;
+                if (!selected(name)) continue;
+                add(measure(name, 1, iterations, 0.0, [&](int i) {
+                    model.setSortMode(mode, i % 2 == 0 ? Qt::DescendingOrder : Qt::AscendingOrder);
+                }));
+            }
+            model.setSortMode(LibraryTableModel::SortByTitle);
+
+            // Typing a query one key at a time, then clearing the search box
+            const std::string filterName = "library/filter_typing" + suffix;
+            if (selected(filterName)) {
+                const QStringList keystrokes = { "d", "de", "dee", "deep", "deep h", "deep ho", "" };
+                add(measure(filterName, 1, iterations, 0.0, [&](int) {
+                    for (const QString& text : keystrokes) model.setFilterText(text);
+                }));
+            }
+
+            // Queries with typos, each matched fuzzily over the whole library
+            const std::string fuzzyName = "library/filter_fuzzy" + suffix;
+            if (selected(fuzzyName)) {
+                const QStringList queries = { "deep hose", "velvt motion", "tribl dbu", "" };
+                add(measure(fuzzyName, 1, iterations, 0.0, [&](int) {
+                    for (const QString& text : queries) model.setFilterText(text);
+                }));
+            }
+        }
+
+        const std::vector<Result>& getResults() const { return results; }
+
+    private:
+        bool selected(const std::string& name) const
+        {
+            return options.filter.isEmpty() || juce::String(name).containsIgnoreCase(options.filter);
+        }
+
+        void add(const Result& result)
+        {
+            std::cout << juce::String(result.name).paddedRight(' ', 32)
+                      << " median " << juce::String(result.medianNs / 1000.0, 1).paddedLeft(' ', 10) << " us"
+                      << "   p95 " << juce::String(result.p95Ns / 1000.0, 1).paddedLeft(' ', 10) << " us";
+            if (result.realtimeFactor > 0.0) std::cout << "   " << juce::String(result.realtimeFactor, 1) << "x realtime";
+            std::cout << std::endl;
+            results.push_back(result);
+        }
+
+        static QVector<TrackInfo> makeLibrary(int numTracks)
+        {
+            static const char* const words[] = { "Deep", "House", "Night", "Drive", "Acid", "Groove", "Sunrise", "Echo",
+                                                 "Velvet", "Motion", "Neon", "Pulse", "Tribal", "Dub", "Roller", "Anthem" };
+            static const char* const keys[] = { "1A", "2A", "3A", "4A", "5A", "6A", "7A", "8A", "9A", "10A", "11A", "12A",
+                                                "1B", "2B", "3B", "4B", "5B", "6B", "7B", "8B", "9B", "10B", "11B", "12B" };
+            juce::Random random(42);
+            auto word = [&]() { return QString::fromUtf8(words[random.nextInt(16)]); };
+
+            QVector<TrackInfo> tracks;
+            tracks.reserve(numTracks);
+            for (int i = 0; i < numTracks; ++i) {
+                TrackInfo t(QString("/music/bench/%1/track_%2.mp3").arg(i % 400).arg(i));
+                t.title = word() + " " + word() + " " + QString::number(random.nextInt(100));
+                t.artist = word() + " " + word();
+                t.album = word() + " EP";
+                t.genre = word();
+                t.year = QString::number(1990 + random.nextInt(36));
+                t.duration = 180.0 + random.nextInt(300);
+                t.bpm = 110.0 + random.nextInt(400) * 0.1;
+                t.key = keys[random.nextInt(24)];
+                t.fileSize = 4000000 + random.nextInt(12000000);
+                t.addedMs = 1700000000000LL + i;
+                tracks.push_back(t);
+            }
+            return tracks;
+        }
+
+        const Options& options;
+        juce::AudioFormatManager& formatManager;
+        const juce::File track;
+        std::vector<Result> results;
+    };
+
+    juce::DynamicObject* makeContext()
+    {
+        auto* context = new juce::DynamicObject();
+        context->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+        context->setProperty("host_name", juce::SystemStats::getComputerName());
+        context->setProperty("num_cpus", juce::SystemStats::getNumCpus());
+        context->setProperty("cpu_model", juce::SystemStats::getCpuModel());
+        context->setProperty("block_size", BlockSize);
+        context->setProperty("sample_rate", SampleRate);
+       #if JUCE_DEBUG
+        context->setProperty("library_build_type", "debug");
+       #else
+        context->setProperty("library_build_type", "release");
+       #endif
+        return context;
+    }
+
+    bool writeJson(const juce::File& file, const std::vector<Result>& results)
+    {
+        auto* context = makeContext();
+        juce::Array<juce::var> list;
+        for (const auto& r : results) {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("name", juce::String(r.name));
+            entry->setProperty("run_type", "iteration");
+            entry->setProperty("iterations", r.iterations);
+            entry->setProperty("real_time", r.medianNs);
+            entry->setProperty("cpu_time", r.medianNs);
+            entry->setProperty("time_unit", "ns");
+            entry->setProperty("mean_ns", r.meanNs);
+            entry->setProperty("min_ns", r.minNs);
+            entry->setProperty("p95_ns", r.p95Ns);
+            if (r.realtimeFactor > 0.0) entry->setProperty("realtime_factor", r.realtimeFactor);
+            list.add(juce::var(entry));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("context", juce::var(context));
+        root->setProperty("benchmarks", list);
+        return file.replaceWithText(juce::JSON::toString(juce::var(root)) + "\n");
+    }
+
+    Options parseOptions(int argc, char* argv[])
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const juce::String arg(argv[i]);
+            if (arg == "--json" && i + 1 < argc) options.jsonPath = argv[++i];
+            else if (arg == "--filter" && i + 1 < argc) options.filter = argv[++i];
+            else if (arg == "--quick") options.quick = true;
+            else if (arg == "--verbose") options.verbose = true;
+            else if (arg == "--replay" && i + 1 < argc) options.replayPath = argv[++i];
+            else if (arg == "--parallel") options.parallel = true;
+            else if (arg == "--rt-check") options.rtCheck = true;
+            else if (arg == "--accuracy" && i + 1 < argc) options.accuracyPath = argv[++i];
+            else if (arg == "--baseline" && i + 1 < argc) options.baselinePath = argv[++i];
+            else if (arg == "--threads" && i + 1 < argc) options.threads = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+            else if (arg == "--scaling") options.scaling = true;
+            else if (arg == "--decks" && i + 1 < argc) options.maxDecks = juce::jlimit(1, DeckMixer::MaxChannels, juce::String(argv[++i]).getIntValue());
+            else std::cout << "DavidBench: ignoring unknown argument " << arg << std::endl;
+        }
+        return options;
+    }
+
+    int replaySession(const Options& options)
+    {
+        const juce::File sessionFile = juce::File::getCurrentWorkingDirectory().getChildFile(options.replayPath);
+        MixAutomation session;
+        if (!session.loadFromFile(sessionFile)) return 1;
+
+        SessionReplay::Settings settings;
+        settings.parallelDecks = options.parallel;
+        SessionReplay::Report report;
+        {
+            MutedCout mute(!options.verbose);
+            report = SessionReplay::run(session, settings);
+        }
+        if (report.error.isNotEmpty()) {
+            std::cout << "DavidBench: replay failed: " << report.error << std::endl;
+            return 1;
+        }
+
+        std::cout << "replay " << sessionFile.getFileName() << ": " << report.numBlocks << " blocks of "
+                  << report.blockSize << " @ " << report.sampleRate << " Hz, deadline " << report.deadlineMs
+                  << " ms, median " << report.medianMs << " ms, p99 " << report.p99Ms << " ms, max "
+                  << report.maxMs << " ms, " << report.overruns << " overruns" << std::endl;
+        const std::vector<MixAutomation::Event> events = session.getEvents();
+        for (const auto& b : report.worstBlocks) {
+            std::cout << "  block " << b.index << " at " << juce::String(b.frame / report.sampleRate, 3) << " s: "
+                      << juce::String(b.ms, 3) << " ms (" << juce::roundToInt(100.0 * b.ms / report.deadlineMs) << "%), decks";
+            for (int i = 0; i < report.numDecks; ++i)
+                std::cout << " " << juce::String(b.deckMs[(size_t) i], 3);
+            if (b.endEvent > b.firstEvent)
+                std::cout << ", after " << (b.endEvent - b.firstEvent) << " event(s) from #" << b.firstEvent;
+            std::cout << std::endl;
+        }
+
+        if (options.jsonPath.isNotEmpty()) {
+            const juce::File jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(options.jsonPath);
+            if (!SessionReplay::writeReport(report, session, jsonFile)) {
+                std::cout << "DavidBench: could not write " << jsonFile.getFullPathName() << std::endl;
+                return 1;
+            }
+            std::cout << "DavidBench: report written to " << jsonFile.getFullPathName() << std::endl;
+        }
+        return 0;
+    }
+
+    // One real-time safety scenario: the decks start as makePlayer() leaves them, then
+    // `control` runs on this thread before every block, as the UI thread would. The mixer is
+    // prepared for BlockSize; a larger deviceBlockSize is a driver handing over more than it announced.
+    struct RtScenario {
+        const char* name;
+        DeckMode modeA;
+        DeckMode modeB;
+        std::function<void(int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer& mixer)> control;
+        int deviceBlockSize{BlockSize};
+    };
+
+    std::vector<RtScenario> rtScenarios(const juce::File& track)
+    {
+        const double barSeconds = 4 * 60.0 / TrackBpm;
+        std::vector<RtScenario> scenarios;
+        for (const auto& info : deckModes)
+            scenarios.push_back({ info.name, info.mode, DeckMode::Plain, [](int, DJAudioPlayer&, DJAudioPlayer&, DeckMixer&) {} });
+
+        scenarios.push_back({ "rt/keylock_toggles", DeckMode::KeylockBalanced, DeckMode::Varispeed,
+            [](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer&) {
+                if (block % 40 == 0) a.setKeylockEnabled((block / 40) % 2 == 1);
+                if (block % 55 == 0) b.setKeylockEnabled((block / 55) % 2 == 0);
+                if (block % 10 == 0) a.setSpeed(0.92 + 0.16 * ((block / 10) % 8) / 7.0);
+                if (block % 70 == 0) a.setKeyShift((double) ((block / 70) % 5 - 2));
+            } });
+        scenarios.push_back({ "rt/loops_and_jumps", DeckMode::Plain, DeckMode::KeylockFast,
+            [barSeconds](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer&) {
+                if (block % 120 == 10) a.enableLoop(a.getCurrentPositionSeconds(), barSeconds / (1 << ((block / 120) % 4)));
+                if (block % 120 == 90) a.disableLoop();
+                if (block % 60 == 30) b.beatJump((block / 60) % 2 == 0 ? 4.0 : -4.0);
+                if (block % 200 == 150) b.setPositionRelative(0.25);
+            } });
+        // makePlayer() sets up no read-ahead, so these loops can't be cached there: every wrap goes
+        // through the player's own seek and crossfade. Deck A's beat-long loop ends mid-block (the
+        // long crossfade), deck B's ends 8 frames into a block (the short fade after the jump).
+        scenarios.push_back({ "rt/uncached_loops", DeckMode::Plain, DeckMode::Plain,
+            [barSeconds](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer&) {
+                if (block % 200 != 0) return;
+                a.enableLoop(a.getCurrentPositionSeconds(), barSeconds / 4);
+                b.enableLoop(b.getCurrentPositionSeconds(), (4 * BlockSize + 8) / SampleRate);
+            } });
+        scenarios.push_back({ "rt/scratch", DeckMode::Plain, DeckMode::KeylockBalanced,
+            [](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer&) {
+                if (block % 150 == 0) a.enableScratch(true);
+                if (block % 150 < 100 && block % 6 == 0) a.setScratchVelocity((block / 6) % 2 == 0 ? 2.0 : -1.5);
+                if (block % 150 == 100) a.enableScratch(false);
+                if (block % 90 == 45) b.enableScratch(true);
+                if (block % 90 == 80) b.enableScratch(false);
+            } });
+        scenarios.push_back({ "rt/loads_while_playing", DeckMode::Varispeed, DeckMode::KeylockBalanced,
+            [track](int block, DJAudioPlayer&, DJAudioPlayer& b, DeckMixer&) {
+                // The decode runs on the loader thread; the audio side only swaps the new track in
+                if (block % 250 == 20) {
+                    b.loadFile(track);
+                    b.start();
+                }
+            } });
+        scenarios.push_back({ "rt/eq_sweeps", DeckMode::Plain, DeckMode::KeylockBalanced,
+            [](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer& mixer) {
+                const double phase = block * 0.05;
+                a.setLowGain(std::sin(phase));
+                a.setMidGain(std::sin(phase * 1.3));
+                a.setHighGain(std::cos(phase * 0.7));
+                b.setFilterCutoff(0.9 * std::sin(phase * 0.5));
+                b.setTrimGain(1.0 + 0.5 * std::sin(phase * 0.2));
+                mixer.setCrossfader((float) std::sin(phase * 0.3));
+            } });
+        scenarios.push_back({ "rt/effects", DeckMode::Plain, DeckMode::Varispeed,
+            [](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer&) {
+                const int effect = (block / 60) % DeckEffectRack::NumEffects;
+                if (block % 60 == 0) {
+                    for (int e = 0; e < DeckEffectRack::NumEffects; ++e) a.setEffectEnabled(e, e == effect);
+                    b.setEffectEnabled(effect, (block / 60) % 2 == 0);
+                    a.setEffectBeats(effect, 0.25 * (1 << ((block / 60) % 4)));
+                }
+                a.setEffectAmount(effect, 0.5 + 0.5 * std::sin(block * 0.07));
+                a.setEffectMix(effect, 0.5 + 0.4 * std::cos(block * 0.05));
+            } });
+        // 3.2 prepared blocks per callback, so the mixer renders it in slices and the last one is
+        // short; the fused low-latency path is switched on and off between them
+        scenarios.push_back({ "rt/oversized_blocks", DeckMode::Plain, DeckMode::KeylockBalanced,
+            [](int block, DJAudioPlayer& a, DJAudioPlayer&, DeckMixer& mixer) {
+                if (block % 50 == 0) mixer.setLowLatencyMode((block / 50) % 2 == 1);
+                if (block % 10 == 0) a.setSpeed(0.92 + 0.16 * ((block / 10) % 8) / 7.0);
+            }, 3 * BlockSize + BlockSize / 5 });
+        scenarios.push_back({ "rt/brake_spinback", DeckMode::Plain, DeckMode::KeylockBalanced,
+            [](int block, DJAudioPlayer& a, DJAudioPlayer& b, DeckMixer&) {
+                if (block % 200 == 50) a.brake(2.0);
+                if (block % 200 == 150) b.spinback(2.0);
+                if (block % 200 == 199) {
+                    a.start();
+                    b.start();
+                }
+            } });
+        return scenarios;
+    }
+
+    int checkRealtimeSafety(const Options& options)
+    {
+        if (!RealtimeAllocGuard::allocationHooksInstalled()) {
+            std::cout << "DavidBench: --rt-check needs a build with -DDAVID_RT_CHECKS=ON or a debug build" << std::endl;
+            return 2;
+        }
+        if (!RealtimeAllocGuard::lockHooksInstalled())
+            std::cout << "DavidBench: only operator new/delete are checked in this build (no malloc or lock hooks)" << std::endl;
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        const juce::File track = writeTestTrack();
+        if (!track.existsAsFile()) {
+            std::cout << "DavidBench: could not write the test track" << std::endl;
+            return 1;
+        }
+
+        const int numBlocks = options.quick ? 300 : 1500;
+        // The first callbacks of a device start attach the thread (trace buffers, priority)
+        constexpr int warmupBlocks = 4;
+        int failures = 0;
+        juce::AudioBuffer<float> output;
+        const juce::AudioIODeviceCallbackContext context{};
+
+        for (const auto& scenario : rtScenarios(track)) {
+            if (options.filter.isNotEmpty() && !juce::String(scenario.name).containsIgnoreCase(options.filter)) continue;
+            const int deviceBlock = scenario.deviceBlockSize;
+            output.setSize(2, deviceBlock);
+
+            DeckMixer mixer;
+            std::unique_ptr<DJAudioPlayer> deckA, deckB;
+            {
+                const MutedCout mute(!options.verbose);
+                deckA = makePlayer(formatManager, track, scenario.modeA);
+                deckB = makePlayer(formatManager, track, scenario.modeB);
+                mixer.addChannel(deckA.get(), DeckMixer::CrossfaderSide::A);
+                mixer.addChannel(deckB.get(), DeckMixer::CrossfaderSide::B);
+                mixer.prepareToRender(2, BlockSize, SampleRate);
+            }
+
+            const auto before = RealtimeAllocGuard::counts();
+            {
+                const MutedCout mute(!options.verbose);
+                for (int block = 0; block < warmupBlocks + numBlocks; ++block) {
+                    if (block >= warmupBlocks) scenario.control(block - warmupBlocks, *deckA, *deckB, mixer);
+                    if (block < warmupBlocks) {
+                        mixer.audioDeviceIOCallbackWithContext(nullptr, 0, output.getArrayOfWritePointers(), 2, deviceBlock, context);
+                        continue;
+                    }
+                    const RealtimeAllocGuard::Scope audioThread;
+                    mixer.audioDeviceIOCallbackWithContext(nullptr, 0, output.getArrayOfWritePointers(), 2, deviceBlock, context);
+                }
+            }
+            const auto after = RealtimeAllocGuard::counts();
+            const int allocations = after.allocations - before.allocations;
+            const int frees = after.frees - before.frees;
+            const int locks = after.locks - before.locks;
+
+            std::cout << juce::String(scenario.name).paddedRight(' ', 32);
+            if (allocations + frees + locks == 0) {
+                std::cout << "ok" << std::endl;
+            } else {
+                ++failures;
+                std::cout << "FAILED: " << allocations << " allocations, " << frees << " frees, " << locks
+                          << " locks in " << numBlocks << " blocks" << std::endl;
+            }
+
+            const MutedCout mute(!options.verbose);
+            deckA->releaseResources();
+            deckB->releaseResources();
+        }
+
+        if (failures > 0) {
+            std::cout << "DavidBench: " << failures << " scenario(s) not real-time safe; first violation at:" << std::endl
+                      << RealtimeAllocGuard::firstViolationBacktrace() << std::endl;
+            return 1;
+        }
+        std::cout << "DavidBench: audio path is real-time safe in every scenario" << std::endl;
+        return 0;
+    }
+
+    // What the decks of a --scaling run do on top of playing at +6%
+    struct ScalingFeatures {
+        const char* name;
+        DeckMode mode;      // Varispeed or a keylock profile
+        bool eq;
+        bool loop;
+        bool effects;
+    };
+
+    const ScalingFeatures scalingFeatureSets[] = {
+        { "plain",            DeckMode::Varispeed,       false, false, false },
+        { "eq",               DeckMode::Varispeed,       true,  false, false },
+        { "loop",             DeckMode::Varispeed,       false, true,  false },
+        { "effects",          DeckMode::Varispeed,       false, false, true },
+        { "keylock_fast",     DeckMode::KeylockFast,     false, false, false },
+        { "keylock_balanced", DeckMode::KeylockBalanced, false, false, false },
+        { "keylock_quality",  DeckMode::KeylockQuality,  false, false, false },
+        { "full",             DeckMode::KeylockBalanced, true,  true,  true },
+    };
+
+    const int scalingBlockSizes[] = { 32, 64, 128, 256, 512, 1024 };
+
+    // Worst callback, as a share of the deadline, that still counts as stable
+    constexpr double StableLoad = 0.7;
+
+    struct ScalingRun {
+        std::string features;
+        int blockSize{0};
+        int numDecks{0};
+        int blocks{0};
+        double deadlineUs{0.0};
+        double medianUs{0.0};
+        double p99Us{0.0};
+        double worstUs{0.0};
+        int overruns{0};
+        bool stable() const { return worstUs < deadlineUs * StableLoad; }
+    };
+
+    std::unique_ptr<DJAudioPlayer> makeScalingPlayer(juce::AudioFormatManager& formatManager, const juce::File& track,
+                                                     const ScalingFeatures& features, int blockSize, int deck)
+    {
+        auto player = makePlayer(formatManager, track, features.mode, blockSize);
+        // Decks a few bars apart, so they don't read the same stretch of the track in step
+        player->setPositionRelative(0.05 * deck);
+        if (features.eq) {
+            player->setHighGain(0.5);
+            player->setMidGain(-0.3);
+            player->setLowGain(-1.0);
+            player->setFilterCutoff(0.4);
+        }
+        if (features.loop) player->enableLoop(0.05 * deck * TrackSeconds, 4 * 60.0 / TrackBpm);
+        if (features.effects) {
+            for (int e = 0; e < DeckEffectRack::NumEffects; ++e) {
+                player->setEffectEnabled(e, true);
+                player->setEffectAmount(e, 0.6);
+                player->setEffectMix(e, 0.5);
+            }
+        }
+        return player;
+    }
+
+    ScalingRun runScaling(const Options& options, std::vector<std::unique_ptr<DJAudioPlayer>>& players,
+                          const ScalingFeatures& features, int blockSize, int numDecks)
+    {
+        DeckMixer mixer;
+        {
+            const MutedCout mute(!options.verbose);
+            for (int d = 0; d < numDecks; ++d)
+                mixer.addChannel(players[(size_t) d].get(), d % 2 == 0 ? DeckMixer::CrossfaderSide::A : DeckMixer::CrossfaderSide::B);
+            mixer.prepareToRender(2, blockSize, SampleRate);
+            mixer.setParallelRendering(options.parallel);
+        }
+
+        const double blockSeconds = blockSize / SampleRate;
+        const int warmupBlocks = (int) std::ceil(0.5 / blockSeconds);
+        const int numBlocks = (int) std::ceil((options.quick ? 2.0 : 10.0) / blockSeconds);
+        juce::AudioBuffer<float> output(2, blockSize);
+        const juce::AudioIODeviceCallbackContext context{};
+        std::vector<double> times((size_t) numBlocks);
+        for (int block = 0; block < warmupBlocks + numBlocks; ++block) {
+            const auto start = std::chrono::steady_clock::now();
+            mixer.audioDeviceIOCallbackWithContext(nullptr, 0, output.getArrayOfWritePointers(), 2, blockSize, context);
+            if (block >= warmupBlocks)
+                times[(size_t) (block - warmupBlocks)] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        ScalingRun run;
+        run.features = features.name;
+        run.blockSize = blockSize;
+        run.numDecks = numDecks;
+        run.blocks = numBlocks;
+        run.deadlineUs = blockSeconds * 1.0e6;
+        run.overruns = (int) std::count_if(times.begin(), times.end(), [&](double t) { return t > run.deadlineUs; });
+        std::sort(times.begin(), times.end());
+        run.medianUs = times[times.size() / 2];
+        run.p99Us = times[std::min(times.size() - 1, (times.size() * 99) / 100)];
+        run.worstUs = times.back();
+
+        const MutedCout mute(!options.verbose);
+        mixer.setParallelRendering(false);
+        return run;
+    }
+
+    bool writeScalingJson(const juce::File& file, const std::vector<ScalingRun>& runs, const Options& options)
+    {
+        auto* context = makeContext();
+        context->removeProperty("block_size");
+        context->setProperty("stable_load", StableLoad);
+        context->setProperty("parallel_rendering", options.parallel);
+        juce::Array<juce::var> list;
+        for (const auto& r : runs) {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("features", juce::String(r.features));
+            entry->setProperty("block_size", r.blockSize);
+            entry->setProperty("decks", r.numDecks);
+            entry->setProperty("blocks", r.blocks);
+            entry->setProperty("deadline_us", r.deadlineUs);
+            entry->setProperty("median_us", r.medianUs);
+            entry->setProperty("p99_us", r.p99Us);
+            entry->setProperty("worst_us", r.worstUs);
+            entry->setProperty("overruns", r.overruns);
+            entry->setProperty("stable", r.stable());
+            list.add(juce::var(entry));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("context", juce::var(context));
+        root->setProperty("runs", list);
+        return file.replaceWithText(juce::JSON::toString(juce::var(root)) + "\n");
+    }
+
+    int measureScaling(const Options& options)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        const juce::File track = writeTestTrack();
+        if (!track.existsAsFile()) {
+            std::cout << "DavidBench: could not write the test track" << std::endl;
+            return 1;
+        }
+
+        std::vector<ScalingRun> runs;
+        std::vector<std::vector<int>> maxStable;   // [feature set][block size]
+        std::vector<const ScalingFeatures*> featureSets;
+        for (const auto& features : scalingFeatureSets) {
+            if (options.filter.isNotEmpty() && !juce::String(features.name).containsIgnoreCase(options.filter)) continue;
+            featureSets.push_back(&features);
+            maxStable.emplace_back();
+
+            for (int blockSize : scalingBlockSizes) {
+                std::vector<std::unique_ptr<DJAudioPlayer>> players;
+                {
+                    const MutedCout mute(!options.verbose);
+                    for (int d = 0; d < options.maxDecks; ++d)
+                        players.push_back(makeScalingPlayer(formatManager, track, features, blockSize, d));
+                }
+
+                // More decks only cost more, so the first unstable count ends the column
+                int stableDecks = 0;
+                for (int numDecks = 1; numDecks <= options.maxDecks; ++numDecks) {
+                    const ScalingRun run = runScaling(options, players, features, blockSize, numDecks);
+                    runs.push_back(run);
+                    std::cout << juce::String(features.name).paddedRight(' ', 18) << juce::String(blockSize).paddedLeft(' ', 5)
+                              << " x " << numDecks << " decks   worst " << juce::String(run.worstUs, 1).paddedLeft(' ', 8)
+                              << " us of " << juce::String(run.deadlineUs, 0) << " ("
+                              << juce::roundToInt(100.0 * run.worstUs / run.deadlineUs) << "%), p99 "
+                              << juce::String(run.p99Us, 1) << " us, " << run.overruns << " overruns"
+                              << (run.stable() ? "" : "   UNSTABLE") << std::endl;
+                    if (!run.stable()) break;
+                    stableDecks = numDecks;
+                }
+                maxStable.back().push_back(stableDecks);
+
+                const MutedCout mute(!options.verbose);
+                for (auto& player : players) player->releaseResources();
+            }
+        }
+
+        std::cout << std::endl << "Most stable decks (worst callback under " << juce::roundToInt(StableLoad * 100.0)
+                  << "% of the deadline, " << SampleRate / 1000.0 << " kHz, "
+                  << (options.parallel ? "parallel" : "serial") << " rendering, " << options.maxDecks << " tried)"
+                  << std::endl << juce::String("block size").paddedRight(' ', 18);
+        for (int blockSize : scalingBlockSizes) std::cout << juce::String(blockSize).paddedLeft(' ', 6);
+        std::cout << std::endl;
+        for (size_t f = 0; f < featureSets.size(); ++f) {
+            std::cout << juce::String(featureSets[f]->name).paddedRight(' ', 18);
+            for (int decks : maxStable[f]) std::cout << juce::String(decks).paddedLeft(' ', 6);
+            std::cout << std::endl;
+        }
+
+        if (options.jsonPath.isNotEmpty()) {
+            const juce::File jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(options.jsonPath);
+            if (!writeScalingJson(jsonFile, runs, options)) {
+                std::cout << "DavidBench: could not write " << jsonFile.getFullPathName() << std::endl;
+                return 1;
+            }
+            std::cout << "DavidBench: results written to " << jsonFile.getFullPathName() << std::endl;
+        }
+        return 0;
+    }
+
+    // One track of an --accuracy dataset and what the analysis made of it
+    struct GroundTruthTrack {
+        juce::File file;
+        double bpm{0.0};                 // 0: no reference tempo
+        std::vector<double> beats;       // seconds; empty: no reference beats
+
+        double estimatedBpm{0.0};
+        std::vector<double> estimatedBeats;
+        double seconds{0.0};             // wall time of analyzeFile
+        double lengthSeconds{0.0};
+        bool failed{false};
+    };
+
+    std::vector<GroundTruthTrack> loadDataset(const juce::File& manifest)
+    {
+        std::vector<GroundTruthTrack> tracks;
+        const juce::var root = juce::JSON::parse(manifest);
+        const juce::File folder = manifest.getParentDirectory();
+        if (const auto* list = root["tracks"].getArray()) {
+            for (const auto& entry : *list) {
+                const juce::String path = entry["file"].toString();
+                if (path.isEmpty()) continue;
+                GroundTruthTrack track;
+                track.file = folder.getChildFile(path);
+                track.bpm = entry.hasProperty("bpm") ? (double) entry["bpm"] : 0.0;
+                if (const auto* beats = entry["beats"].getArray()) {
+                    for (const auto& beat : *beats) track.beats.push_back((double) beat);
+                } else if (entry["beats_file"].toString().isNotEmpty()) {
+                    juce::StringArray lines;
+                    lines.addLines(folder.getChildFile(entry["beats_file"].toString()).loadFileAsString());
+                    for (const auto& line : lines) {
+                        const auto first = line.trim().upToFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf("\t", false, false);
+                        if (first.containsOnly("0123456789.-+eE") && first.isNotEmpty()) track.beats.push_back(first.getDoubleValue());
+                    }
+                }
+                std::sort(track.beats.begin(), track.beats.end());
+                tracks.push_back(std::move(track));
+            }
+        }
+        return tracks;
+    }
+
+    enum class TempoMatch { Correct, Octave, Wrong };
+
+    // Within 0.5 BPM; an octave error is the same check against twice or half the reference
+    TempoMatch classifyTempo(double estimated, double reference)
+    {
+        constexpr double Tolerance = 0.5;
+        if (std::abs(estimated - reference) <= Tolerance) return TempoMatch::Correct;
+        if (std::abs(estimated - 2.0 * reference) <= 2.0 * Tolerance || std::abs(estimated - 0.5 * reference) <= 0.5 * Tolerance)
+            return TempoMatch::Octave;
+        return TempoMatch::Wrong;
+    }
+
+    // Beat F-measure as mir_eval computes it: beats before 5 s ignored, each reference beat
+    // matched to at most one estimate within 70 ms
+    double beatFMeasure(const std::vector<double>& reference, const std::vector<double>& estimated)
+    {
+        constexpr double SkipSeconds = 5.0, Window = 0.07;
+        std::vector<double> ref, est;
+        std::copy_if(reference.begin(), reference.end(), std::back_inserter(ref), [](double t) { return t >= SkipSeconds; });
+        std::copy_if(estimated.begin(), estimated.end(), std::back_inserter(est), [](double t) { return t >= SkipSeconds; });
+        if (ref.empty() || est.empty()) return 0.0;
+
+        // Both sorted and beats are far more than two windows apart, so a merge pass finds the pairs
+        size_t hits = 0;
+        for (size_t i = 0, j = 0; i < ref.size() && j < est.size();) {
+            if (std::abs(est[j] - ref[i]) <= Window) { ++hits; ++i; ++j; }
+            else if (est[j] < ref[i]) ++j;
+            else ++i;
+        }
+        if (hits == 0) return 0.0;
+        const double precision = (double) hits / (double) est.size();
+        const double recall = (double) hits / (double) ref.size();
+        return 2.0 * precision * recall / (precision + recall);
+    }
+
+    // High-water mark of the resident set, 0 where unknown
+    juce::int64 peakResidentBytes()
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+        #if JUCE_MAC
+        return (juce::int64) usage.ru_maxrss;            // bytes
+        #else
+        return (juce::int64) usage.ru_maxrss * 1024;     // KiB
+        #endif
+       #else
+        return 0;
+       #endif
+    }
+
+    int measureAccuracy(const Options& options)
+    {
+        const juce::File manifest = juce::File::getCurrentWorkingDirectory().getChildFile(options.accuracyPath);
+        std::vector<GroundTruthTrack> tracks = loadDataset(manifest);
+        if (tracks.empty()) {
+            std::cout << "DavidBench: no tracks in " << manifest.getFullPathName() << std::endl;
+            return 1;
+        }
+
+       #if JUCE_LINUX
+        // Resets the peak RSS, so it covers the analyses and not the startup
+        std::ofstream("/proc/self/clear_refs") << "5";
+       #endif
+        const juce::int64 startResident = peakResidentBytes();
+        const auto start = std::chrono::steady_clock::now();
+        {
+            const MutedCout mute(!options.verbose);
+            juce::ThreadPool pool(juce::ThreadPoolOptions{}.withThreadName("Accuracy").withNumberOfThreads(options.threads));
+            for (auto& track : tracks) {
+                pool.addJob([&track] {
+                    BpmAnalyzer analyzer;
+                    const auto begin = std::chrono::steady_clock::now();
+                    track.estimatedBpm = analyzer.analyzeFile(track.file, 120.0, &track.estimatedBeats, &track.lengthSeconds);
+                    track.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                    track.failed = track.estimatedBpm <= 0.0;
+                });
+            }
+            while (pool.getNumJobs() > 0) juce::Thread::sleep(10);
+        }
+        const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int withTempo = 0, correct = 0, octave = 0, wrong = 0, withBeats = 0, failed = 0;
+        double fSum = 0.0, audioSeconds = 0.0;
+        juce::Array<juce::var> perTrack;
+        for (const auto& track : tracks) {
+            audioSeconds += track.lengthSeconds;
+            if (track.failed) ++failed;
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("file", track.file.getRelativePathFrom(manifest.getParentDirectory()));
+            entry->setProperty("bpm", track.estimatedBpm);
+            entry->setProperty("seconds", track.seconds);
+            if (track.bpm > 0.0) {
+                ++withTempo;
+                const auto match = classifyTempo(track.estimatedBpm, track.bpm);
+                correct += match == TempoMatch::Correct;
+                octave += match == TempoMatch::Octave;
+                wrong += match == TempoMatch::Wrong;
+                entry->setProperty("reference_bpm", track.bpm);
+                entry->setProperty("tempo", match == TempoMatch::Correct ? "correct" : match == TempoMatch::Octave ? "octave" : "wrong");
+            }
+            if (!track.beats.empty()) {
+                ++withBeats;
+                const double f = beatFMeasure(track.beats, track.estimatedBeats);
+                fSum += f;
+                entry->setProperty("beat_f_measure", f);
+            }
+            perTrack.add(juce::var(entry));
+        }
+
+        const auto rate = [](int count, int total) { return total > 0 ? (double) count / (double) total : 0.0; };
+        auto* analysis = new juce::DynamicObject();
+        analysis->setProperty("analyzer", juce::String(BpmAnalyzer::getAnalyzerId()));
+        analysis->setProperty("tracks", (int) tracks.size());
+        analysis->setProperty("failed", failed);
+        analysis->setProperty("threads", options.threads);
+        analysis->setProperty("wall_seconds", wallSeconds);
+        analysis->setProperty("tracks_per_second", wallSeconds > 0.0 ? (double) tracks.size() / wallSeconds : 0.0);
+        analysis->setProperty("audio_seconds_per_second", wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0);
+        analysis->setProperty("peak_rss_bytes", peakResidentBytes());
+        analysis->setProperty("peak_rss_growth_bytes", peakResidentBytes() - startResident);
+        analysis->setProperty("bpm_accuracy", rate(correct, withTempo));
+        analysis->setProperty("octave_error_rate", rate(octave, withTempo));
+        analysis->setProperty("other_error_rate", rate(wrong, withTempo));
+        analysis->setProperty("beat_f_measure", withBeats > 0 ? fSum / withBeats : 0.0);
+        analysis->setProperty("per_track", perTrack);
+        const juce::var report(analysis);
+
+        std::cout << "accuracy " << manifest.getFileName() << " (" << BpmAnalyzer::getAnalyzerId() << ", "
+                  << options.threads << " threads): " << tracks.size() << " tracks in " << juce::String(wallSeconds, 1)
+                  << " s, " << juce::String((double) report["tracks_per_second"], 2) << " tracks/s, peak RSS "
+                  << juce::String((double) peakResidentBytes() / (1024.0 * 1024.0), 0) << " MB" << std::endl
+                  << "  BPM within 0.5: " << juce::String(100.0 * rate(correct, withTempo), 1) << "%, octave errors "
+                  << juce::String(100.0 * rate(octave, withTempo), 1) << "%, other "
+                  << juce::String(100.0 * rate(wrong, withTempo), 1) << "% (" << withTempo << " tracks)" << std::endl
+                  << "  beat F-measure: " << juce::String((double) report["beat_f_measure"], 3)
+                  << " (" << withBeats << " tracks), " << failed << " failed" << std::endl;
+
+        if (options.baselinePath.isNotEmpty()) {
+            const juce::var baseline = juce::JSON::parse(juce::File::getCurrentWorkingDirectory().getChildFile(options.baselinePath))["analysis"];
+            if (baseline.isObject()) {
+                std::cout << "  against " << options.baselinePath << " (" << baseline["analyzer"].toString() << "):" << std::endl;
+                for (const char* field : { "tracks_per_second", "peak_rss_bytes", "bpm_accuracy", "octave_error_rate", "beat_f_measure" }) {
+                    const double now = report[field], before = baseline[field];
+                    std::cout << "    " << juce::String(field).paddedRight(' ', 20) << juce::String(before, 3) << " -> "
+                              << juce::String(now, 3);
+                    if (before != 0.0) std::cout << " (" << (now >= before ? "+" : "") << juce::String(100.0 * (now - before) / before, 1) << "%)";
+                    std::cout << std::endl;
+                }
+            } else {
+                std::cout << "DavidBench: no accuracy report in " << options.baselinePath << std::endl;
+            }
+        }
+
+        if (options.jsonPath.isNotEmpty()) {
+            auto* root = new juce::DynamicObject();
+            root->setProperty("context", juce::var(makeContext()));
+            root->setProperty("analysis", report);
+            const juce::File jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(options.jsonPath);
+            if (!jsonFile.replaceWithText(juce::JSON::toString(juce::var(root)) + "\n")) {
+                std::cout << "DavidBench: could not write " << jsonFile.getFullPathName() << std::endl;
+                return 1;
+            }
+            std::cout << "DavidBench: report written to " << jsonFile.getFullPathName() << std::endl;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // The library model is a Qt item model; nothing here needs a display
+    QCoreApplication app(argc, argv);
+    const juce::ScopedJuceInitialiser_GUI juceInit;
+    const Options options = parseOptions(argc, argv);
+    if (options.replayPath.isNotEmpty())
+        return replaySession(options);
+    if (options.rtCheck)
+        return checkRealtimeSafety(options);
+    if (options.accuracyPath.isNotEmpty())
+        return measureAccuracy(options);
+    if (options.scaling)
+        return measureScaling(options);
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    const juce::File track = writeTestTrack();
+    if (!track.existsAsFile()) {
+        std::cout << "DavidBench: could not write the test track" << std::endl;
+        return 1;
+    }
+
+    Runner runner(options, formatManager, track);
+    runner.runDeckModes();
+    runner.runMixer(2, false);
+    runner.runMixer(4, false);
+    runner.runMixer(4, true);
+    runner.runSession();
+    runner.runWaveform();
+    runner.runBpm();
+    runner.runLibrary(10000);
+    runner.runLibrary(100000);
+
+    if (options.jsonPath.isNotEmpty()) {
+        const juce::File jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(options.jsonPath);
+        if (!writeJson(jsonFile, runner.getResults())) {
+            std::cout << "DavidBench: could not write " << jsonFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        std::cout << "DavidBench: results written to " << jsonFile.getFullPathName() << std::endl;
+    }
+    return 0;
+}
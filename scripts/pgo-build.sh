@@ -0,0 +1,33 @@
+#!/bin/sh
+# Profile-guided Release build of David.
+#
+#   scripts/pgo-build.sh [build-dir]          (default: build-pgo)
+#
+# 1. Instrumented build of DavidBench, which links the same pulsedj_engine objects as the app
+# 2. Training run: DavidBench --quick plays both decks through the mixer with keylock, loops,
+#    scratching, EQ and crossfader moves, and runs the analysers and library sort / search
+# 3. The same build directory reconfigured with DAVID_PGO=USE, then everything rebuilt
+#
+# Clang's raw profiles are merged with llvm-profdata (override with LLVM_PROFDATA=...).
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=$(mkdir -p "${1:-build-pgo}" && cd "${1:-build-pgo}" && pwd)
+PROFILE_DIR="$BUILD_DIR/pgo-profiles"
+JOBS=$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4)
+
+rm -rf "$PROFILE_DIR"
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release -DDAVID_BUILD_BENCHMARKS=ON \
+      -DDAVID_PGO=GENERATE -DDAVID_PGO_DIR="$PROFILE_DIR"
+cmake --build "$BUILD_DIR" --target DavidBench -j "$JOBS"
+
+echo "pgo-build: training run"
+"$BUILD_DIR/DavidBench" --quick
+
+if ls "$PROFILE_DIR"/*.profraw > /dev/null 2>&1; then
+    "${LLVM_PROFDATA:-llvm-profdata}" merge -output="$PROFILE_DIR/merged.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DDAVID_PGO=USE
+cmake --build "$BUILD_DIR" -j "$JOBS"
+echo "pgo-build: optimised binaries in $BUILD_DIR"
@@ -0,0 +1,73 @@
+#include "AnalysisArena.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+namespace {
+    // The heap behind the arena once its own buffer is full; counts what the track spilled
+    class Overflow : public std::pmr::memory_resource {
+    public:
+        size_t bytes{0};
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override {
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+        void do_deallocate(void* p, size_t size, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    struct ThreadArena {
+        int depth{0};
+        size_t capacity{0};
+        std::unique_ptr<std::byte[]> buffer;
+        Overflow overflow;
+        std::optional<std::pmr::monotonic_buffer_resource> pool;
+
+        void open() {
+            if (pool) return;
+            if (!buffer) {
+                capacity = AnalysisArena::InitialBytes;
+                buffer.reset(new std::byte[capacity]);
+            }
+            pool.emplace(buffer.get(), capacity, &overflow);
+        }
+
+        // The whole track at once; the next one gets a buffer large enough for this one
+        void rewind() {
+            pool.reset();
+            const size_t wanted = std::min(AnalysisArena::MaxRetainedBytes, capacity + overflow.bytes);
+            if (wanted > capacity) {
+                buffer.reset();
+                capacity = wanted;
+                buffer.reset(new std::byte[capacity]);
+            }
+            overflow.bytes = 0;
+        }
+    };
+
+    ThreadArena& threadArena() {
+        static thread_local ThreadArena arena;
+        return arena;
+    }
+}
+
+AnalysisArena::Track::Track() {
+    auto& arena = threadArena();
+    if (arena.depth++ == 0) arena.open();
+}
+
+AnalysisArena::Track::~Track() {
+    auto& arena = threadArena();
+    if (--arena.depth == 0) arena.rewind();
+}
+
+std::pmr::memory_resource* AnalysisArena::resource() noexcept {
+    auto& arena = threadArena();
+    if (arena.depth > 0 && arena.pool) return &*arena.pool;
+    return std::pmr::new_delete_resource();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Scratch memory for the track analysis running on this thread.
+ *
+ * The detectors build many short-lived buffers per track: interval and vote lists per scan
+ * section, onset lists per detector, the tempo histogram, autocorrelations, the beat tracker's
+ * tables. With the library analysed on every core those all went through the global heap and
+ * the workers contended on it. Instead each thread owns a monotonic arena
+ * (std::pmr::monotonic_buffer_resource): allocation is a pointer bump, nothing is freed until
+ * the track is done, and then the whole arena is rewound in one go.
+ *
+ * A Track scope opens the arena for one track; scopes on one thread nest (the decode pass and
+ * the estimate after it), the last one to close rewinds it. Memory that outlives the track
+ * (BpmAnalyzer::Features, results) must not come from here. The arena's own buffer is kept
+ * between tracks and grows to what the largest track needed, up to MaxRetainedBytes; anything
+ * beyond goes to the heap and is returned on rewind.
+ *
+ * Not thread-safe by design: a buffer taken from resource() is only touched on its thread.
+ */
+namespace AnalysisArena {
+    constexpr size_t InitialBytes = 256 * 1024;
+    constexpr size_t MaxRetainedBytes = 16 * 1024 * 1024;
+
+    template <typename T>
+    using Vector = std::pmr::vector<T>;
+    template <typename K, typename V>
+    using HashMap = std::pmr::unordered_map<K, V>;
+
+    // Keeps this thread's arena open; close it on the thread that opened it
+    class Track {
+    public:
+        Track();
+        ~Track();
+        Track(const Track&) = delete;
+        Track& operator=(const Track&) = delete;
+    };
+
+    // This thread's arena; the default heap resource when no Track is open
+    std::pmr::memory_resource* resource() noexcept;
+
+    // Buffers from this thread's arena
+    template <typename T>
+    Vector<T> vector(size_t size = 0, const T& value = T()) { return Vector<T>(size, value, resource()); }
+}
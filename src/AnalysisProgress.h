@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * A deck's analysis state and progress, written by the analysis worker and sampled by the UI.
+ *
+ * Workers only store into atomics, nothing is posted to the event loop per progress tick. The UI
+ * polls takeChange() on FrameClock::frame and redraws only when something was reported since
+ * its last look, so an overview and its label change at most once per frame however often, and
+ * from however many workers, progress comes in.
+ */
+class AnalysisProgress {
+public:
+    enum class State { Idle, Active, Failed, Done };
+
+    struct Snapshot {
+        State state{State::Idle};
+        double progress{0.0};   // 0..1
+    };
+
+    // Worker side, any thread; never blocks
+    void begin() noexcept { publish(State::Active, 0.0); }
+    void report(double progress) noexcept {
+        value.store(progress, std::memory_order_relaxed);
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+    void fail() noexcept { publish(State::Failed, value.load(std::memory_order_relaxed)); }
+    void finish(bool succeeded) noexcept { publish(succeeded ? State::Done : State::Failed, 1.0); }
+
+    // UI thread: true, with the latest values, if anything was reported since the last call
+    bool takeChange(Snapshot& out) noexcept {
+        const uint32_t now = sequence.load(std::memory_order_acquire);
+        if (now == seen) return false;
+        seen = now;
+        out.state = state.load(std::memory_order_relaxed);
+        out.progress = value.load(std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    void publish(State s, double progress) noexcept {
+        state.store(s, std::memory_order_relaxed);
+        value.store(progress, std::memory_order_relaxed);
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    std::atomic<State> state{State::Idle};
+    std::atomic<double> value{0.0};
+    std::atomic<uint32_t> sequence{0};
+    uint32_t seen{0};   // UI thread only
+};
@@ -45,6 +45,11 @@ public:
         return appDataDir + "/bpm_cache";
     }
     
+    // Mp3FrameIndex files, one per MP3 track
+    QString getMp3IndexDirectory() const {
+        return getCacheDirectory() + "/mp3_index";
+    }
+    
     QString getPresetsDirectory() const {
         return appDataDir + "/presets";
     }
@@ -58,6 +63,21 @@ public:
         return getLibraryDirectory() + "/libraryItems.xml";
     }
     
+    // Binary library store (LibraryDatabase), read on startup
+    QString getLibraryIndexPath() const {
+        return getLibraryDirectory() + "/library.bin";
+    }
+    
+    // Crash-recovery snapshot (SessionSnapshot); only there while the app runs
+    QString getSessionSnapshotPath() const {
+        return getConfigDirectory() + "/session.snapshot";
+    }
+    
+    // Append-only journal of the tracks played (PlayHistory)
+    QString getPlayHistoryPath() const {
+        return getLibraryDirectory() + "/history.journal";
+    }
+    
     QString getSettingsPath() const {
         return getConfigDirectory() + "/settings.ini";
     }
@@ -76,6 +96,7 @@ public:
             getCacheDirectory(),
             getWaveformCacheDirectory(),
             getBpmCacheDirectory(),
+            getMp3IndexDirectory(),
             getPresetsDirectory(),
             getLogsDirectory()
         };
@@ -0,0 +1,141 @@
+#include "ArtworkCache.h"
+#include "AppConfig.h"
+#include "TagReader.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
+#include <iostream>
+
+#include <juce_core/juce_core.h>
+
+namespace {
+    constexpr int JpegQuality = 85;
+    // Decoding a thumbnail is quick; a few threads keep a fast scroll from queueing up
+    constexpr int MaxWorkers = 2;
+
+    QImage makeThumbnail(const QByteArray& encoded)
+    {
+        const QImage image = QImage::fromData(encoded);
+        if (image.isNull()) return QImage();
+        return image.scaled(ArtworkCache::ThumbnailSize, ArtworkCache::ThumbnailSize,
+                            Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+}
+
+ArtworkCache& ArtworkCache::instance()
+{
+    static ArtworkCache cache;
+    return cache;
+}
+
+ArtworkCache::ArtworkCache()
+    : directory(AppConfig::instance().getCacheDirectory() + "/artwork")
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const int cacheMB = std::max(16, prefs.value("Performance/DiskCacheMB", 256).toInt());
+    memoryCache.setMaxCost(cacheMB * 1024);
+    pool.setMaxThreadCount(MaxWorkers);
+    pool.setExpiryTimeout(30000);
+    if (!QDir().mkpath(directory)) {
+        std::cout << "ArtworkCache: cannot create " << directory.toStdString() << std::endl;
+    }
+    evictorId = MemoryBudget::getInstance().addEvictor([this](int64_t bytesToFree) { return trim(bytesToFree); });
+}
+
+ArtworkCache::~ArtworkCache()
+{
+    MemoryBudget::getInstance().removeEvictor(evictorId);
+    pool.clear();
+    pool.waitForDone();
+}
+
+QString ArtworkCache::getThumbnailFile(const QString& filePath) const
+{
+    // Size and mtime in the key: a retagged file gets a new thumbnail, the old one is orphaned
+    const QFileInfo info(filePath);
+    const QByteArray key = filePath.toUtf8() + '|' + QByteArray::number(info.size()) + '|'
+                         + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    return directory + "/" + QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex() + ".jpg";
+}
+
+void ArtworkCache::storeCoverArt(const QString& filePath, const QByteArray& encoded)
+{
+    const QString thumbnailFile = getThumbnailFile(filePath);
+    if (QFileInfo::exists(thumbnailFile)) return;   // unchanged file, rescanned
+    const QImage thumbnail = makeThumbnail(encoded);
+    if (thumbnail.isNull()) return;
+
+    QSaveFile file(thumbnailFile);
+    if (!file.open(QIODevice::WriteOnly) || !thumbnail.save(&file, "JPG", JpegQuality) || !file.commit()) {
+        std::cout << "ArtworkCache: cannot write thumbnail for " << filePath.toStdString() << std::endl;
+        return;
+    }
+
+    // A rescan may bring art (or new art) for a track already shown
+    bool shown = false;
+    {
+        QMutexLocker locker(&lock);
+        shown = memoryCache.remove(filePath) | withoutArt.remove(filePath);
+        memory.resize((int64_t) memoryCache.totalCost() * 1024);
+    }
+    if (shown) insert(filePath, thumbnail);
+}
+
+QImage ArtworkCache::getThumbnail(const QString& filePath)
+{
+    QMutexLocker locker(&lock);
+    if (const QImage* cached = memoryCache.object(filePath)) return *cached;
+    if (withoutArt.contains(filePath) || pending.contains(filePath)) return QImage();
+
+    pending.insert(filePath);
+    pool.start([this, filePath]() { loadThumbnail(filePath); });
+    return QImage();
+}
+
+void ArtworkCache::insert(const QString& filePath, const QImage& thumbnail)
+{
+    if (!thumbnail.isNull()) MemoryBudget::getInstance().makeRoom(thumbnail.sizeInBytes());
+    {
+        QMutexLocker locker(&lock);
+        pending.remove(filePath);
+        if (thumbnail.isNull()) withoutArt.insert(filePath);
+        else memoryCache.insert(filePath, new QImage(thumbnail), std::max<qsizetype>(1, thumbnail.sizeInBytes() / 1024));
+        memory.resize((int64_t) memoryCache.totalCost() * 1024);
+    }
+    emit thumbnailReady(filePath);
+}
+
+int64_t ArtworkCache::trim(int64_t bytesToFree)
+{
+    QMutexLocker locker(&lock);
+    const qsizetype before = memoryCache.totalCost();
+    // Lowering the maximum drops the least recently used thumbnails until the rest fits
+    const qsizetype maxCost = memoryCache.maxCost();
+    memoryCache.setMaxCost(std::max<qsizetype>(0, before - (qsizetype) ((bytesToFree + 1023) / 1024)));
+    memoryCache.setMaxCost(maxCost);
+    memory.resize((int64_t) memoryCache.totalCost() * 1024);
+    return (int64_t) (before - memoryCache.totalCost()) * 1024;
+}
+
+void ArtworkCache::loadThumbnail(const QString& filePath)
+{
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+
+    QImage thumbnail(getThumbnailFile(filePath));
+    if (thumbnail.isNull()) {
+        // Scanned before thumbnails existed, or the art changed: take it from the tags once
+        TagReader::Tags tags;
+        tags.wantCoverArt = true;
+        if (TagReader::read(juce::File(filePath.toStdString()), tags) && !tags.coverArt.isEmpty()) {
+            const QByteArray encoded((const char*) tags.coverArt.getData(), (int) tags.coverArt.getSize());
+            thumbnail = makeThumbnail(encoded);
+            if (!thumbnail.isNull()) thumbnail.save(getThumbnailFile(filePath), "JPG", JpegQuality);
+        }
+    }
+    insert(filePath, thumbnail);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include "MemoryBudget.h"
+
+/**
+ * Cover-art thumbnails for the library table and the decks.
+ *
+ * The tag scan hands each track's embedded picture to storeCoverArt(), which decodes and
+ * downscales it to ThumbnailSize on the calling (worker) thread and writes a JPEG to
+ * AppConfig::getCacheDirectory()/artwork, keyed by path, size and modification time so a
+ * retagged file simply misses. getThumbnail() answers from an in-memory LRU bounded by
+ * Performance/DiskCacheMB; on a miss it returns a null image and loads the thumbnail in the
+ * background (from disk, or from the file's tags for tracks scanned before), then emits
+ * thumbnailReady(). Nothing is decoded on the GUI thread. The in-memory thumbnails count towards
+ * the MemoryBudget, which can trim them (least recently used first) when it needs the room.
+ */
+class ArtworkCache : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int ThumbnailSize = 96;
+
+    // First call from the GUI thread, so thumbnailReady is delivered there
+    static ArtworkCache& instance();
+
+    // Any thread; encoded is the picture as stored in the tags (JPEG / PNG)
+    void storeCoverArt(const QString& filePath, const QByteArray& encoded);
+
+    // Null if not cached yet (a load is queued) or the track has no art
+    QImage getThumbnail(const QString& filePath);
+
+signals:
+    // A thumbnail requested through getThumbnail is available now
+    void thumbnailReady(const QString& filePath);
+
+private:
+    ArtworkCache();
+    ~ArtworkCache() override;
+
+    QString getThumbnailFile(const QString& filePath) const;
+    void insert(const QString& filePath, const QImage& thumbnail);
+    void loadThumbnail(const QString& filePath);
+    // MemoryBudget evictor; returns the bytes freed
+    int64_t trim(int64_t bytesToFree);
+
+    QString directory;
+    QThreadPool pool;
+    QMutex lock;
+    QCache<QString, QImage> memoryCache;   // cost in KB
+    QSet<QString> pending;                 // loads in flight
+    QSet<QString> withoutArt;              // looked up this session, nothing found
+    MemoryBudget::Allocation memory{MemoryBudget::Pool::Artwork};   // follows memoryCache's cost
+    int evictorId{0};
+};
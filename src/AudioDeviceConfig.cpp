@@ -0,0 +1,209 @@
+#include "AudioDeviceConfig.h"
+#include <iostream>
+
+namespace {
+    // Device types that bypass the system mixer, best first
+    const char* const kExclusiveTypes[] = { "ASIO", "Windows Audio (Exclusive Mode)", "CoreAudio", "JACK", "ALSA" };
+
+    juce::AudioIODeviceType* findType(juce::AudioDeviceManager& manager, const juce::String& name)
+    {
+        for (auto* type : manager.getAvailableDeviceTypes())
+            if (type->getTypeName() == name) return type;
+        return nullptr;
+    }
+
+    // Inputs are named even while closed, so the latency calibration can open them on this device
+    juce::String inputFor(juce::AudioIODeviceType* type, const juce::String& outputName)
+    {
+        const juce::StringArray inputs = type != nullptr ? type->getDeviceNames(true) : juce::StringArray();
+        if (type == nullptr || !type->hasSeparateInputsAndOutputs() || inputs.contains(outputName))
+            return outputName;
+        return inputs.isEmpty() ? juce::String() : inputs[juce::jmax(0, type->getDefaultDeviceIndex(true))];
+    }
+}
+
+juce::String AudioDeviceConfig::Result::describe() const
+{
+    juce::String text;
+    text << typeName << ": " << deviceName << ", " << juce::String(sampleRate, 0) << " Hz, " << bufferSize
+         << " samples, output latency " << juce::String(outputLatencyMs(), 1) << " ms";
+    return text;
+}
+
+juce::StringArray AudioDeviceConfig::listOutputDevices(juce::AudioDeviceManager& manager)
+{
+    juce::StringArray names;
+    for (auto* type : manager.getAvailableDeviceTypes()) {
+        type->scanForDevices();
+        for (const auto& device : type->getDeviceNames(false))
+            names.add(type->getTypeName() + ": " + device);
+    }
+    return names;
+}
+
+AudioDeviceConfig::Choice AudioDeviceConfig::choose(juce::AudioDeviceManager& manager, const Request& request)
+{
+    // An explicit pick from the preferences, if that device is still there
+    if (request.deviceName.isNotEmpty() && request.deviceName != DefaultDeviceName) {
+        const juce::String typeName = request.deviceName.upToFirstOccurrenceOf(": ", false, false);
+        const juce::String deviceName = request.deviceName.fromFirstOccurrenceOf(": ", false, false);
+        if (auto* type = findType(manager, typeName))
+            if (type->getDeviceNames(false).contains(deviceName))
+                return { typeName, deviceName };
+        std::cout << "AudioDeviceConfig: " << request.deviceName << " not found, choosing automatically" << std::endl;
+    }
+
+    if (request.exclusive) {
+        for (const char* typeName : kExclusiveTypes) {
+            auto* type = findType(manager, typeName);
+            if (type == nullptr) continue;
+            const juce::StringArray names = type->getDeviceNames(false);
+            if (names.isEmpty()) continue;
+            if (type->getTypeName() != "ALSA")
+                return { typeName, names[juce::jmax(0, type->getDefaultDeviceIndex(false))] };
+            // ALSA lists "default", pulse/pipewire and dmix next to the cards; only hw: opens the card itself
+            for (const auto& name : names)
+                if (name.contains("Direct hardware device")) return { typeName, name };
+        }
+        std::cout << "AudioDeviceConfig: no exclusive device found, using the shared default" << std::endl;
+    }
+
+    // The first type is the platform's shared one (ALSA on Linux, WASAPI shared on Windows)
+    auto& types = manager.getAvailableDeviceTypes();
+    if (types.isEmpty()) return {};
+    auto* type = types.getFirst();
+    const juce::StringArray names = type->getDeviceNames(false);
+    return { type->getTypeName(), names.isEmpty() ? juce::String() : names[juce::jmax(0, type->getDefaultDeviceIndex(false))] };
+}
+
+AudioDeviceConfig::Result AudioDeviceConfig::apply(juce::AudioDeviceManager& manager, const Request& request)
+{
+    const Choice choice = choose(manager, request);
+    if (choice.deviceName.isEmpty()) {
+        Result r = current(manager);
+        r.error = "No audio output device available";
+        return r;
+    }
+
+    const juce::String previousType = manager.getCurrentAudioDeviceType();
+    const juce::AudioDeviceManager::AudioDeviceSetup previousSetup = manager.getAudioDeviceSetup();
+    if (choice.typeName != previousType) manager.setCurrentAudioDeviceType(choice.typeName, true);
+
+    auto* type = manager.getCurrentDeviceTypeObject();
+    juce::AudioDeviceManager::AudioDeviceSetup setup = manager.getAudioDeviceSetup();
+    setup.outputDeviceName = choice.deviceName;
+    setup.inputDeviceName = inputFor(type, choice.deviceName);
+    setup.useDefaultInputChannels = false;
+    setup.inputChannels.clear();
+    setup.useDefaultOutputChannels = true;
+    setup.outputChannels.clear();
+    setup.sampleRate = request.sampleRate;
+    setup.bufferSize = request.bufferSize;
+
+    juce::String error = manager.setAudioDeviceSetup(setup, true);
+    if (error.isEmpty() && manager.getCurrentAudioDevice() == nullptr) error = "The device did not open";
+    if (error.isNotEmpty()) {
+        std::cout << "AudioDeviceConfig: " << choice.typeName << ": " << choice.deviceName << " failed: "
+                  << error << ", restoring the previous device" << std::endl;
+        if (manager.getCurrentAudioDeviceType() != previousType) manager.setCurrentAudioDeviceType(previousType, true);
+        manager.setAudioDeviceSetup(previousSetup, true);
+        Result r = current(manager);
+        r.error = error;
+        return r;
+    }
+
+    if (request.headphoneCueOutputs) enableCueOutputs(manager);
+    if (request.numInputs > 0) enableInputs(manager, request.numInputs);
+    const Result r = current(manager);
+    logResult(r, request);
+    return r;
+}
+
+AudioDeviceConfig::Result AudioDeviceConfig::open(juce::AudioDeviceManager& manager, const Request& request)
+{
+    // Scanning the types (in choose) opens nothing
+    const Choice choice = choose(manager, request);
+    juce::String error = "No audio output device available";
+    if (choice.deviceName.isNotEmpty()) {
+        // A saved state is the one way into initialise() that names the type and device up front
+        juce::XmlElement state("DEVICESETUP");
+        state.setAttribute("deviceType", choice.typeName);
+        state.setAttribute("audioOutputDeviceName", choice.deviceName);
+        state.setAttribute("audioInputDeviceName", inputFor(findType(manager, choice.typeName), choice.deviceName));
+        state.setAttribute("audioDeviceRate", request.sampleRate);
+        state.setAttribute("audioDeviceBufferSize", request.bufferSize);
+        state.setAttribute("audioDeviceInChans", "0");
+        error = manager.initialise(0, 2, &state, false);
+        if (error.isEmpty() && manager.getCurrentAudioDevice() == nullptr) error = "The device did not open";
+    }
+    if (error.isNotEmpty()) {
+        std::cout << "AudioDeviceConfig: " << choice.typeName << ": " << choice.deviceName << " failed: "
+                  << error << ", opening the system default" << std::endl;
+        manager.initialiseWithDefaultDevices(0, 2);
+        Result r = current(manager);
+        r.error = error;
+        return r;
+    }
+
+    if (request.headphoneCueOutputs) enableCueOutputs(manager);
+    if (request.numInputs > 0) enableInputs(manager, request.numInputs);
+    const Result r = current(manager);
+    logResult(r, request);
+    return r;
+}
+
+void AudioDeviceConfig::enableCueOutputs(juce::AudioDeviceManager& manager)
+{
+    // Headphone cue bus: outputs 3/4 when the device has a second pair
+    auto* device = manager.getCurrentAudioDevice();
+    if (device == nullptr || device->getOutputChannelNames().size() < 4) return;
+    juce::AudioDeviceManager::AudioDeviceSetup setup = manager.getAudioDeviceSetup();
+    setup.useDefaultOutputChannels = false;
+    setup.outputChannels.clear();
+    setup.outputChannels.setRange(0, 4, true);
+    const juce::String cueError = manager.setAudioDeviceSetup(setup, true);
+    if (cueError.isNotEmpty())
+        std::cout << "AudioDeviceConfig: headphone cue outputs unavailable: " << cueError << std::endl;
+}
+
+void AudioDeviceConfig::enableInputs(juce::AudioDeviceManager& manager, int numInputs)
+{
+    // Timecode vinyl (a stereo pair per turntable) and the mic: the first inputs
+    auto* device = manager.getCurrentAudioDevice();
+    if (device == nullptr) return;
+    const int available = juce::jmin(numInputs, device->getInputChannelNames().size());
+    if (available < numInputs)
+        std::cout << "AudioDeviceConfig: " << numInputs << " inputs asked for, the device has "
+                  << available << std::endl;
+    if (available <= 0) return;
+    juce::AudioDeviceManager::AudioDeviceSetup setup = manager.getAudioDeviceSetup();
+    setup.useDefaultInputChannels = false;
+    setup.inputChannels.clear();
+    setup.inputChannels.setRange(0, available, true);
+    const juce::String inputError = manager.setAudioDeviceSetup(setup, true);
+    if (inputError.isNotEmpty())
+        std::cout << "AudioDeviceConfig: inputs unavailable: " << inputError << std::endl;
+}
+
+void AudioDeviceConfig::logResult(const Result& r, const Request& request)
+{
+    std::cout << "AudioDeviceConfig: " << r.describe() << " (asked for " << request.sampleRate << " Hz, "
+              << request.bufferSize << " samples" << (request.exclusive ? ", exclusive" : "") << ")" << std::endl;
+}
+
+AudioDeviceConfig::Result AudioDeviceConfig::current(juce::AudioDeviceManager& manager)
+{
+    Result r;
+    r.typeName = manager.getCurrentAudioDeviceType();
+    if (auto* device = manager.getCurrentAudioDevice()) {
+        r.deviceName = device->getName();
+        r.sampleRate = device->getCurrentSampleRate();
+        r.bufferSize = device->getCurrentBufferSizeSamples();
+        r.outputLatencySamples = device->getOutputLatencyInSamples();
+        r.numOutputs = device->getActiveOutputChannels().countNumberOfSetBits();
+        r.numInputs = device->getActiveInputChannels().countNumberOfSetBits();
+    } else {
+        r.error = "No audio device running";
+    }
+    return r;
+}
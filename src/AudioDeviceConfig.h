@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Opens the audio device the preferences ask for (Audio/Device, BufferSize, SampleRate,
+ * ExclusiveMode) on a juce::AudioDeviceManager and reports what the driver actually gave.
+ *
+ * Shared mode keeps the system's default device type and device (PulseAudio/PipeWire through
+ * ALSA "default" on Linux), only with the requested rate and block size. Exclusive mode looks
+ * for a device that bypasses the system mixer, in this order: ASIO, WASAPI exclusive, CoreAudio,
+ * JACK (when a server runs), then an ALSA "hw:" device. A device name picked in the preferences
+ * wins over both and can be of any type. Rates and block sizes the device doesn't offer are
+ * rounded to the nearest one it does (AudioDeviceManager does that); if the device can't be
+ * opened at all, the previous setup is restored and the result carries the error. Inputs stay
+ * closed unless timecode vinyl or the microphone asks for them.
+ *
+ * Call with the DeckMixer detached and re-prepare the players from the result afterwards.
+ */
+class AudioDeviceConfig {
+public:
+    static constexpr const char* DefaultDeviceName = "Default Audio Device";
+
+    struct Request {
+        juce::String deviceName;            // empty or DefaultDeviceName: chosen by mode
+        int bufferSize{512};
+        double sampleRate{44100.0};
+        bool exclusive{false};
+        bool headphoneCueOutputs{false};    // outputs 3/4 too, when the device has them
+        int numInputs{0};                   // inputs 1..n for timecode vinyl and the mic, as many as the device has
+        bool operator==(const Request& o) const {
+            return deviceName == o.deviceName && bufferSize == o.bufferSize && sampleRate == o.sampleRate
+                && exclusive == o.exclusive && headphoneCueOutputs == o.headphoneCueOutputs
+                && numInputs == o.numInputs;
+        }
+        bool operator!=(const Request& o) const { return !(*this == o); }
+    };
+
+    struct Result {
+        juce::String error;                 // empty if the requested device is running
+        juce::String typeName;
+        juce::String deviceName;
+        double sampleRate{0.0};
+        int bufferSize{0};
+        int outputLatencySamples{0};        // as the driver reports it, without the block
+        int numOutputs{0};
+        int numInputs{0};
+        bool ok() const { return error.isEmpty() && sampleRate > 0.0; }
+        // One block plus the driver's output latency
+        double outputLatencyMs() const { return sampleRate > 0.0 ? 1000.0 * (bufferSize + outputLatencySamples) / sampleRate : 0.0; }
+        juce::String describe() const;
+    };
+
+    // Device names offered in the preferences, "Type: Device", after DefaultDeviceName
+    static juce::StringArray listOutputDevices(juce::AudioDeviceManager& manager);
+
+    // Opens the device for `request`; on failure the previous device is running again
+    static Result apply(juce::AudioDeviceManager& manager, const Request& request);
+    // First open on a manager without a device: straight to the requested device, where
+    // initialiseWithDefaultDevices() and apply() open the system default first and then again.
+    // Falls back to the system default if the requested device won't open (the error is kept).
+    static Result open(juce::AudioDeviceManager& manager, const Request& request);
+    // What is running now
+    static Result current(juce::AudioDeviceManager& manager);
+
+private:
+    struct Choice {
+        juce::String typeName;
+        juce::String deviceName;
+    };
+    static Choice choose(juce::AudioDeviceManager& manager, const Request& request);
+    static void enableCueOutputs(juce::AudioDeviceManager& manager);
+    static void enableInputs(juce::AudioDeviceManager& manager, int numInputs);
+    static void logResult(const Result& result, const Request& request);
+};
@@ -0,0 +1,92 @@
+#include "AudioFingerprint.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int FftOrder = 11;
+    static_assert((1 << FftOrder) == AudioFingerprint::FrameSize, "FFT size");
+    // Below the Nyquist frequency of SampleRate, above MaxHz
+    constexpr double LowPassHz = 2400.0;
+}
+
+AudioFingerprint::AudioFingerprint()
+    : fft(FftOrder), window((size_t) FrameSize), ring((size_t) FrameSize, 0.0f), fftData((size_t) FrameSize * 2)
+{
+    for (int i = 0; i < FrameSize; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float) i / (float) FrameSize);
+    for (int b = 0; b <= NumBands; ++b) {
+        const double hz = MinHz * std::pow(MaxHz / MinHz, (double) b / NumBands);
+        bandEdges[(size_t) b] = (int) std::lround(hz * FrameSize / SampleRate);
+    }
+    frames.reserve((size_t) MaxFrames);
+}
+
+void AudioFingerprint::prepare(const juce::AudioFormatReader& reader)
+{
+    const double rate = reader.sampleRate > 0.0 ? reader.sampleRate : 44100.0;
+    step = rate / SampleRate;
+    // Butterworth, 4th order: the two stages' Q
+    lowPass[0].setCoefficients(juce::IIRCoefficients::makeLowPass(rate, LowPassHz, 0.5412));
+    lowPass[1].setCoefficients(juce::IIRCoefficients::makeLowPass(rate, LowPassHz, 1.3066));
+}
+
+void AudioFingerprint::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64)
+{
+    if (!wantsMore()) return;
+    const int channels = block.getNumChannels();
+    if (channels == 0) return;
+
+    mono.resize((size_t) numSamples);
+    juce::FloatVectorOperations::copy(mono.data(), block.getReadPointer(0), numSamples);
+    for (int ch = 1; ch < channels; ++ch)
+        juce::FloatVectorOperations::add(mono.data(), block.getReadPointer(ch), numSamples);
+    juce::FloatVectorOperations::multiply(mono.data(), 1.0f / (float) channels, numSamples);
+    lowPass[0].processSamples(mono.data(), numSamples);
+    lowPass[1].processSamples(mono.data(), numSamples);
+
+    // Linear interpolation between the filtered source samples, one output every `step`
+    for (const float x : mono) {
+        for (; phase < 1.0; phase += step) {
+            ring[(size_t) (ringFill % FrameSize)] = lastSample + (x - lastSample) * (float) phase;
+            ++ringFill;
+            if (ringFill >= FrameSize && ++sinceFrame >= Hop) {
+                sinceFrame = 0;
+                addFrame();
+                if (!wantsMore()) return;
+            }
+        }
+        phase -= 1.0;
+        lastSample = x;
+    }
+}
+
+void AudioFingerprint::addFrame()
+{
+    // The ring in time order, windowed
+    const int start = ringFill % FrameSize;
+    double sumSquares = 0.0;
+    for (int i = 0; i < FrameSize; ++i) {
+        const float v = ring[(size_t) ((start + i) % FrameSize)];
+        sumSquares += (double) v * v;
+        fftData[(size_t) i] = v * window[(size_t) i];
+    }
+    std::fill(fftData.begin() + FrameSize, fftData.end(), 0.0f);
+    fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    std::array<float, NumBands> energy{};
+    for (int b = 0; b < NumBands; ++b)
+        for (int bin = bandEdges[(size_t) b]; bin < bandEdges[(size_t) b + 1]; ++bin)
+            energy[(size_t) b] += fftData[(size_t) bin] * fftData[(size_t) bin];
+
+    if (!audible) audible = std::sqrt(sumSquares / FrameSize) >= SilenceRms;
+    if (audible && havePrevious) {
+        std::uint32_t bits = 0;
+        for (int m = 0; m < NumBands - 1; ++m) {
+            const float change = (energy[(size_t) m] - energy[(size_t) m + 1]) - (previous[(size_t) m] - previous[(size_t) m + 1]);
+            if (change > 0.0f) bits |= 1u << m;
+        }
+        frames.push_back(bits);
+    }
+    previous = energy;
+    havePrevious = true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "TrackDecodePipeline.h"
+
+/**
+ * Compact acoustic fingerprint of a track, one more sink of the analysis pass (TrackAnalysis):
+ * Haitsma-Kalker sub-fingerprints of 32 bits, one per Hop at SampleRate, over the first
+ * MaxFrames frames from the first audible one (about 24 s). The mono mix is low-passed and
+ * resampled to SampleRate; each FrameSize Hann frame is split into 33 bands log-spaced between
+ * MinHz and MaxHz, and bit m is the sign of the change, from the previous frame, of the energy
+ * difference between bands m and m + 1. Loudness, EQ and the codec barely touch those signs, so
+ * an MP3, an AIFF and a remaster of the same recording agree in most bits whatever their rate.
+ *
+ * FingerprintIndex finds tracks by them; BpmCache keeps them. 4 bytes per frame, 2 KB a track.
+ */
+class AudioFingerprint : public TrackDecodePipeline::Sink {
+public:
+    static constexpr double SampleRate = 5512.5;
+    static constexpr int FrameSize = 2048;       // 0.37 s
+    static constexpr int Hop = 256;              // 46 ms
+    static constexpr int MaxFrames = 512;
+    static constexpr int NumBands = 33;
+    static constexpr double MinHz = 300.0;
+    static constexpr double MaxHz = 2000.0;
+    static constexpr float SilenceRms = 0.003f;  // about -50 dBFS: frames below don't start it
+
+    static double secondsPerFrame() { return Hop / SampleRate; }
+
+    AudioFingerprint();
+
+    void prepare(const juce::AudioFormatReader& reader) override;
+    void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+    bool wantsMore() const override { return (int) frames.size() < MaxFrames; }
+
+    // Empty if the track had nothing audible
+    std::vector<std::uint32_t> takeFingerprint() { return std::move(frames); }
+
+private:
+    void addFrame();
+
+    juce::dsp::FFT fft;
+    std::vector<float> window;
+    std::array<int, NumBands + 1> bandEdges{};   // FFT bins
+    juce::IIRFilter lowPass[2];                  // 4th-order Butterworth as two stages
+    double step{8.0};                            // source samples per output sample
+    double phase{0.0};
+    float lastSample{0.0f};
+    std::vector<float> ring;                     // the last FrameSize resampled samples
+    int ringFill{0};
+    int sinceFrame{0};
+    std::vector<float> mono;
+    std::vector<float> fftData;
+    std::array<float, NumBands> previous{};
+    bool havePrevious{false};
+    bool audible{false};
+    std::vector<std::uint32_t> frames;
+};
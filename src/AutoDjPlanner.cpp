@@ -0,0 +1,153 @@
+#include "AutoDjPlanner.h"
+#include "KeyDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int HalfPhraseBeats = AutoDjPlanner::PhraseBeats / 2;
+    constexpr int BarBeats = 4;
+}
+
+AutoDjPlanner::Track AutoDjPlanner::Track::fromCache(const BpmCache::Entry& entry)
+{
+    Track track;
+    track.bpm = entry.bpm;
+    track.firstBeatSec = entry.firstBeatOffset;
+    track.lengthSec = entry.totalSeconds;
+    track.key = entry.key;
+    track.novelty = entry.novelty;
+    track.noveltyHopSeconds = entry.noveltyHopSeconds;
+    track.structure = entry.structure;
+    return track;
+}
+
+double AutoDjPlanner::energy(const Track& track, double fromSec, double toSec)
+{
+    if (track.novelty.empty() || track.noveltyHopSeconds <= 0.0) return -1.0;
+    const auto size = (long) track.novelty.size();
+    const long first = std::clamp((long) std::floor(fromSec / track.noveltyHopSeconds), 0L, size);
+    const long last = std::clamp((long) std::ceil(toSec / track.noveltyHopSeconds), 0L, size);
+    if (last <= first) return -1.0;
+    double sum = 0.0;
+    for (long i = first; i < last; ++i) sum += track.novelty[(size_t) i];
+    return sum / (double) (last - first);
+}
+
+int AutoDjPlanner::introBeats(const Track& in)
+{
+    const double beatSec = 60.0 / in.bpm;
+    if (in.structure.isValid()) {
+        const auto& phrases = in.structure.phrases;
+        const auto body = std::find_if(phrases.begin(), phrases.end(), [](const TrackStructure::Phrase& phrase) {
+            return phrase.section != TrackStructure::Section::Intro;
+        });
+        if (body != phrases.begin() && body != phrases.end()) {
+            const int beats = (int) std::lround((body->startSec - in.structure.downbeatSec) / beatSec);
+            return std::clamp(beats, MinMixBeats, MaxMixBeats);
+        }
+    }
+    const double half = HalfPhraseBeats * beatSec;
+    const double opening = energy(in, in.firstBeatSec, in.firstBeatSec + half);
+    if (opening < 0.0) return DefaultMixBeats;
+    for (int beats = HalfPhraseBeats; beats <= MaxMixBeats; beats += HalfPhraseBeats) {
+        const double from = in.firstBeatSec + beats * beatSec;
+        const double next = energy(in, from, from + half);
+        if (next < 0.0) break;
+        if (next > 0.0 && next >= RiseRatio * opening) return std::clamp(beats, MinMixBeats, MaxMixBeats);
+    }
+    return DefaultMixBeats;
+}
+
+double AutoDjPlanner::dropScore(const Track& out, double at, double mixSec)
+{
+    const double before = energy(out, at - mixSec, at);
+    const double after = energy(out, at, at + mixSec);
+    return before > 0.0 && after >= 0.0 ? after / before : 1.0;
+}
+
+AutoDjPlanner::Plan AutoDjPlanner::plan(const Track& out, const Track& in, double earliestOutSec)
+{
+    Plan result;
+    if (!out.isUsable() || !in.isUsable()) return result;
+
+    result.tempoChange = out.bpm / in.bpm - 1.0;
+    result.matchTempo = std::abs(result.tempoChange) <= MaxTempoChange;
+    result.mixBeats = result.matchTempo ? introBeats(in) : UnmatchedFadeSeconds * out.bpm / 60.0;
+    result.rampBeats = result.matchTempo ? RampBeats : 0.0;
+    result.inStartSec = std::max(0.0, in.structure.isValid() ? in.structure.downbeatSec : in.firstBeatSec);
+    const auto compatible = KeyDetector::getCompatible(out.key);
+    result.keyCompatible = out.key >= 0 && in.key >= 0
+                           && std::find(compatible.begin(), compatible.end(), in.key) != compatible.end();
+
+    const double beatSec = 60.0 / out.bpm;
+    const double lastBeat = out.firstBeatSec + std::floor((out.lengthSec - out.firstBeatSec) / beatSec) * beatSec;
+    const double mixSec = result.mixBeats * beatSec;
+
+    // The analysed outro where it fits, else the analysed phrase starts like the grid's below
+    if (out.structure.isValid()) {
+        const auto& phrases = out.structure.phrases;
+        const int outro = out.structure.findLastRun(TrackStructure::Section::Outro);
+        if (outro >= 0) {
+            const double at = phrases[(size_t) outro].startSec;
+            if (at >= earliestOutSec && at + mixSec <= lastBeat) {
+                result.outStartSec = at;
+                result.valid = true;
+                return result;
+            }
+        }
+        double best = -1.0, bestScore = 0.0;
+        int considered = 0;
+        for (size_t i = phrases.size(); i-- > 0 && considered < OutroCandidates;) {
+            const double at = phrases[i].startSec;
+            if (at < earliestOutSec) break;
+            if (at + mixSec > lastBeat) continue;
+            ++considered;
+            const double score = dropScore(out, at, mixSec);
+            if (best < 0.0 || score < bestScore * 0.8) {
+                best = at;
+                bestScore = score;
+            }
+        }
+        if (best >= 0.0) {
+            result.outStartSec = best;
+            result.valid = true;
+            return result;
+        }
+    }
+
+    // Phrase boundaries first; a track too far along for one gets the next whole bar
+    for (const int step : { PhraseBeats, BarBeats }) {
+        const double stepSec = step * beatSec;
+        const long lastStep = (long) std::floor((lastBeat - mixSec - out.firstBeatSec) / stepSec);
+        double best = -1.0, bestScore = 0.0;
+        int considered = 0;
+        for (long k = lastStep; k >= 0 && considered < OutroCandidates; --k) {
+            const double at = out.firstBeatSec + (double) k * stepSec;
+            if (at < earliestOutSec) break;
+            ++considered;
+            // Without an envelope the latest boundary stands
+            const double score = dropScore(out, at, mixSec);
+            if (best < 0.0 || score < bestScore * 0.8) {
+                best = at;
+                bestScore = score;
+            }
+        }
+        if (best >= 0.0) {
+            result.outStartSec = best;
+            result.valid = true;
+            return result;
+        }
+    }
+
+    // Too close to the end for the whole mix: what is left of it from the next bar
+    const double barSec = BarBeats * beatSec;
+    const double nextBar = out.firstBeatSec + std::ceil((earliestOutSec - out.firstBeatSec) / barSec) * barSec;
+    const double barsLeft = std::floor((lastBeat - nextBar) / barSec);
+    if (barsLeft >= 1.0) {
+        result.outStartSec = nextBar;
+        result.mixBeats = std::min(result.mixBeats, barsLeft * BarBeats);
+        result.valid = true;
+    }
+    return result;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include "BpmCache.h"
+
+/**
+ * Where and how AutoDJ mixes one track into the next, worked out ahead of time from what the
+ * analysis cache (BpmCache) holds for both: BPM, first beat, length, key and the onset novelty
+ * envelope. Pure computation, for a background job; DeckMixer::scheduleTransition executes the
+ * result on the audio thread.
+ *
+ * Phrases are PhraseBeats long from the first beat of the constant grid, the one the mixer's
+ * phase lock uses. The length of the mix is the incoming track's intro: the beats until its
+ * novelty energy first rises to RiseRatio times that of its opening, in whole half-phrases
+ * between MinMixBeats and MaxMixBeats (DefaultMixBeats without an envelope). The mix starts on
+ * a phrase boundary of the outgoing track that leaves the whole mix before its last beat; of
+ * the last OutroCandidates of those, the one the energy drops most after (the outro) wins, a
+ * later one on a tie. Past the last of them, the mix starts on the next bar and is cut to the
+ * bars that are left. The incoming track comes in on its first beat.
+ *
+ * Where the analysis found a TrackStructure, it takes over: the intro runs to the incoming
+ * track's first phrase past its Intro, which also comes in on its first downbeat, and the mix
+ * starts where the outgoing track's last Outro run does if that leaves room for it, otherwise on
+ * one of its phrase starts.
+ *
+ * Tracks within MaxTempoChange of each other are beat-mixed: the incoming deck runs at the
+ * outgoing tempo through the fade and glides to its own over RampBeats afterwards. Further
+ * apart, the mix is a plain UnmatchedFadeSeconds crossfade from the same phrase boundary.
+ */
+class AutoDjPlanner {
+public:
+    static constexpr int PhraseBeats = 32;
+    static constexpr int MinMixBeats = 16;
+    static constexpr int MaxMixBeats = 64;
+    static constexpr int DefaultMixBeats = 32;
+    static constexpr double RiseRatio = 1.5;
+    static constexpr int OutroCandidates = 3;
+    static constexpr double MaxTempoChange = 0.08;
+    static constexpr int RampBeats = 32;
+    static constexpr double UnmatchedFadeSeconds = 8.0;
+
+    struct Track {
+        double bpm{0.0};
+        double firstBeatSec{0.0};
+        double lengthSec{0.0};
+        int key{-1};
+        std::vector<float> novelty;
+        double noveltyHopSeconds{0.0};
+        TrackStructure structure;
+
+        static Track fromCache(const BpmCache::Entry& entry);
+        bool isUsable() const { return bpm > 0.0 && lengthSec > 0.0; }
+    };
+
+    struct Plan {
+        bool valid{false};
+        double outStartSec{0.0};    // outgoing track time the incoming deck starts at
+        double inStartSec{0.0};     // where the incoming deck is cued
+        double mixBeats{0.0};       // crossfade, in beats of the outgoing track
+        bool matchTempo{false};
+        double rampBeats{0.0};
+        double tempoChange{0.0};    // incoming tempo during the fade over its own, minus one
+        bool keyCompatible{false};
+    };
+
+    // earliestOutSec: no start before this outgoing track time (where it is now plus a lead)
+    static Plan plan(const Track& out, const Track& in, double earliestOutSec);
+
+private:
+    // Mean novelty over [fromSec, toSec); negative without an envelope there
+    static double energy(const Track& track, double fromSec, double toSec);
+    static int introBeats(const Track& in);
+    // Energy after `at` over that before it, across mixSec; lower is a deeper drop, 1 without an envelope
+    static double dropScore(const Track& out, double at, double mixSec);
+};
@@ -0,0 +1,102 @@
+#include "BeatGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+BeatGrid::BeatGrid(const std::vector<Segment>& segments, double trackLengthSec, TrackStructure trackStructure)
+    : trackLength(trackLengthSec), structure(std::move(trackStructure))
+{
+    for (const auto& segment : segments) {
+        if (segment.bpm <= 0.0) continue;
+        const double secondsPerBeat = 60.0 / segment.bpm;
+        if (anchors.empty()) {
+            anchors.push_back({ segment.startSec, 0.0, secondsPerBeat });
+            continue;
+        }
+        const Anchor& last = anchors.back();
+        if (segment.startSec <= last.timeSec) continue;
+        anchors.push_back({ segment.startSec, last.beat + (segment.startSec - last.timeSec) / last.secondsPerBeat,
+                            secondsPerBeat });
+    }
+
+    if (anchors.empty() || trackLength <= 0.0) {
+        anchors.clear();
+        return;
+    }
+    firstBeatOffset = anchors.front().timeSec;
+    bpm = 60.0 / anchors.front().secondsPerBeat;
+}
+
+BeatGrid::Ptr BeatGrid::constant(double bpm, double firstBeatOffsetSec, double trackLengthSec, TrackStructure trackStructure)
+{
+    auto grid = std::make_shared<const BeatGrid>(std::vector<Segment>{ { firstBeatOffsetSec, bpm } }, trackLengthSec,
+                                                 std::move(trackStructure));
+    return grid->isValid() ? grid : nullptr;
+}
+
+const BeatGrid::Anchor& BeatGrid::anchorAtTime(double timeSeconds) const
+{
+    auto it = std::upper_bound(anchors.begin(), anchors.end(), timeSeconds,
+                               [](double t, const Anchor& a) { return t < a.timeSec; });
+    return it == anchors.begin() ? *it : *(it - 1);
+}
+
+const BeatGrid::Anchor& BeatGrid::anchorAtBeat(double beat) const
+{
+    auto it = std::upper_bound(anchors.begin(), anchors.end(), beat,
+                               [](double b, const Anchor& a) { return b < a.beat; });
+    return it == anchors.begin() ? *it : *(it - 1);
+}
+
+double BeatGrid::getBeatPositionAtTime(double timeSeconds) const
+{
+    if (anchors.empty()) return 0.0;
+    const Anchor& a = anchorAtTime(timeSeconds);
+    return a.beat + (timeSeconds - a.timeSec) / a.secondsPerBeat;
+}
+
+double BeatGrid::getTimeAtBeat(double beat) const
+{
+    if (anchors.empty()) return 0.0;
+    const Anchor& a = anchorAtBeat(beat);
+    return a.timeSec + (beat - a.beat) * a.secondsPerBeat;
+}
+
+double BeatGrid::getBpmAtTime(double timeSeconds) const
+{
+    return anchors.empty() ? bpm : 60.0 / anchorAtTime(timeSeconds).secondsPerBeat;
+}
+
+void BeatGrid::getBeatsInRange(double startSec, double endSec, std::vector<double>& out) const
+{
+    if (anchors.empty()) return;
+    startSec = std::max(startSec, 0.0);
+    endSec = std::min(endSec, trackLength);
+    if (endSec < startSec) return;
+
+    for (double beat = std::ceil(getBeatPositionAtTime(startSec) - 1.0e-9);; beat += 1.0) {
+        const double t = getTimeAtBeat(beat);
+        if (t > endSec) break;
+        if (t >= startSec) out.push_back(t);
+    }
+}
+
+double BeatGrid::getNearestBeatTime(double timeSeconds) const
+{
+    if (anchors.empty()) return timeSeconds;
+
+    const double beat = getBeatPositionAtTime(timeSeconds);
+    double best = timeSeconds, bestDistance = -1.0;
+    for (double candidate : { std::floor(beat), std::ceil(beat) }) {
+        // Grid lines before the first in-track beat (or after the end) aren't playable
+        double t = getTimeAtBeat(candidate);
+        while (t < 0.0) t = getTimeAtBeat(candidate += 1.0);
+        while (t > trackLength && candidate > 0.0) t = getTimeAtBeat(candidate -= 1.0);
+        const double distance = std::abs(t - timeSeconds);
+        if (bestDistance < 0.0 || distance < bestDistance) {
+            best = t;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
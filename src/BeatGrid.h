@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "TrackStructure.h"
+
+/**
+ * Beat grid of one deck's track: a tempo map of piecewise-constant segments (live-played tracks
+ * drift, so one BPM isn't enough).
+ *
+ * A grid never changes once built. A deck publishes a new one with DJAudioPlayer::setBeatGrid()
+ * when the analysis delivers, and readers on any thread (quantise on the audio thread, renderers
+ * and pads on the UI) take a reference and use it without locks. Beat and time lookups are a
+ * binary search over the segment anchors; beats are generated on request for the window being
+ * drawn or quantised against. The bars and phrases the analysis found on the grid
+ * (TrackStructure) travel with it.
+ */
+class BeatGrid {
+public:
+    using Ptr = std::shared_ptr<const BeatGrid>;
+
+    // Start of a constant-tempo segment; the first one lies on beat 0
+    struct Segment {
+        double startSec{0.0};
+        double bpm{120.0};
+    };
+
+    // Segments sorted by start; ones with a non-positive BPM or out of order are dropped
+    BeatGrid(const std::vector<Segment>& segments, double trackLengthSec, TrackStructure trackStructure = {});
+
+    // One segment at bpm from the first beat, nullptr without a usable BPM or length
+    static Ptr constant(double bpm, double firstBeatOffsetSec, double trackLengthSec, TrackStructure trackStructure = {});
+
+    bool isValid() const { return !anchors.empty(); }
+
+    // Fractional beat index at a time (0 on the first beat, negative before it)
+    double getBeatPositionAtTime(double timeSeconds) const;
+    // Inverse of getBeatPositionAtTime
+    double getTimeAtBeat(double beat) const;
+
+    // Beat times within [startSec, endSec] and inside the track, ascending, appended to out
+    void getBeatsInRange(double startSec, double endSec, std::vector<double>& out) const;
+    // Closest beat inside the track, or timeSeconds itself without a grid
+    double getNearestBeatTime(double timeSeconds) const;
+
+    double getBpm() const { return bpm; }       // of the first segment
+    double getBpmAtTime(double timeSeconds) const;
+    double getFirstBeatOffset() const { return firstBeatOffset; }
+    double getTrackLength() const { return trackLength; }
+    // Invalid when the analysis found none
+    const TrackStructure& getStructure() const { return structure; }
+
+private:
+    struct Anchor {
+        double timeSec;
+        double beat;            // beat index at timeSec
+        double secondsPerBeat;
+    };
+
+    // Segment containing timeSeconds / beat; the first one also covers everything before it
+    const Anchor& anchorAtTime(double timeSeconds) const;
+    const Anchor& anchorAtBeat(double beat) const;
+
+    double bpm{0.0};
+    double firstBeatOffset{0.0};
+    double trackLength{0.0};
+    std::vector<Anchor> anchors;    // sorted by time (and so by beat)
+    TrackStructure structure;
+};
@@ -1,6 +1,7 @@
 #include "BeatIndicator.h"
 #include <QPainter>
 #include <QColor>
+#include <algorithm>
 #include <cmath>
 
 BeatIndicator::BeatIndicator(QWidget* parent) : QWidget(parent) {
@@ -12,14 +13,14 @@ void BeatIndicator::setBeatPositionDeckA(double beat) {
     // Keep beat within one bar (0.0 to 4.0)
     currentBeatA = std::fmod(beat, 4.0);
     if (currentBeatA < 0.0) currentBeatA += 4.0;
-    update();
+    updateIfChanged();
 }
 
 void BeatIndicator::setBeatPositionDeckB(double beat) {
     // Keep beat within one bar (0.0 to 4.0)
     currentBeatB = std::fmod(beat, 4.0);
     if (currentBeatB < 0.0) currentBeatB += 4.0;
-    update();
+    updateIfChanged();
 }
 
 void BeatIndicator::setBpmDeckA(double newBpm) {
@@ -47,10 +48,10 @@ void BeatIndicator::setTempoFactorDeckB(double factor) {
 void BeatIndicator::setFirstBeatOffsetDeckA(double seconds) { firstBeatOffsetA = seconds; }
 void BeatIndicator::setFirstBeatOffsetDeckB(double seconds) { firstBeatOffsetB = seconds; }
 
-// NEW: Calculate beat position from track time using global beat grid
+// NEW: Calculate beat position from track time using the deck's analysed grid
 void BeatIndicator::setTrackPositionDeckA(double positionSeconds) {
     // Use original BPM for beat calculation (tempo scaling is already in positionSeconds)
-    double baseBpm = (bpmA > 0.0) ? bpmA : GlobalBeatGrid::getInstance().getCurrentBpm();
+    double baseBpm = bpmA;
     if (baseBpm <= 0.0) {
         setBeatPositionDeckA(0.0);
         return;
@@ -79,7 +80,7 @@ void BeatIndicator::setTrackPositionDeckA(double positionSeconds) {
 
 void BeatIndicator::setTrackPositionDeckB(double positionSeconds) {
     // Use original BPM for beat calculation (tempo scaling is already in positionSeconds)
-    double baseBpm = (bpmB > 0.0) ? bpmB : GlobalBeatGrid::getInstance().getCurrentBpm();
+    double baseBpm = bpmB;
     if (baseBpm <= 0.0) {
         setBeatPositionDeckB(0.0);
         return;
@@ -106,90 +107,84 @@ void BeatIndicator::setTrackPositionDeckB(double positionSeconds) {
     setBeatPositionDeckB(beatInCycle + fractionalBeat);
 }
 
+namespace {
+    int cellIndex(double beat) { return std::clamp((int) std::floor(beat), 0, 3); }
+}
+
+void BeatIndicator::updateIfChanged() {
+    const std::array<int, 4> state{ cellIndex(currentBeatA), (int) (BOX_W * (currentBeatA - std::floor(currentBeatA))),
+                                    cellIndex(currentBeatB), (int) (BOX_W * (currentBeatB - std::floor(currentBeatB))) };
+    if (state == shownState) return;
+    shownState = state;
+    update();
+}
+
+void BeatIndicator::layout(int& startX, int& topY, int& bottomY) const {
+    // Centered grid: exact content width = 3*BOX_SPACING + BOX_W
+    startX = (int) std::round((width() - TOTAL_WIDTH) * 0.5);
+    topY = (int) std::round((height() - (2 * BOX_H + ROW_GAP)) * 0.5);
+    bottomY = topY + BOX_H + ROW_GAP;
+}
+
+void BeatIndicator::resizeEvent(QResizeEvent* event) {
+    unlitLayer = QPixmap();
+    QWidget::resizeEvent(event);
+}
+
+void BeatIndicator::updateLayerCache() {
+    const qreal dpr = devicePixelRatioF();
+    if (!unlitLayer.isNull() && unlitLayer.devicePixelRatio() == dpr) return;
+
+    int startX, topY, bottomY;
+    layout(startX, topY, bottomY);
+    auto render = [&](bool lit) {
+        QPixmap layer((size() * dpr));
+        layer.setDevicePixelRatio(dpr);
+        QPainter p(&layer);
+        p.setRenderHint(QPainter::Antialiasing, true);
+        p.fillRect(rect(), QColor(20, 20, 25));
+        p.setFont(QFont("Arial", 8, QFont::Bold));
+        for (int i = 0; i < 4; ++i) {
+            const int x = startX + i * BOX_SPACING;
+            // Top row (blue boxes for Deck A), bottom row (orange boxes for Deck B); numbers 1..4
+            p.setBrush(lit ? QColor(100, 150, 255) : QColor(40, 60, 80));
+            p.setPen(QPen(QColor(200, 200, 255), 1));
+            p.drawRect(x, topY, BOX_W, BOX_H);
+            p.setPen(QPen(QColor(255, 255, 255), 1));
+            p.drawText(x, topY, BOX_W, BOX_H, Qt::AlignCenter, QString::number(i + 1));
+
+            p.setBrush(lit ? QColor(255, 150, 50) : QColor(80, 50, 20));
+            p.setPen(QPen(QColor(255, 200, 100), 1));
+            p.drawRect(x, bottomY, BOX_W, BOX_H);
+            p.setPen(QPen(QColor(255, 255, 255), 1));
+            p.drawText(x, bottomY, BOX_W, BOX_H, Qt::AlignCenter, QString::number(i + 1));
+        }
+        return layer;
+    };
+    unlitLayer = render(false);
+    litLayer = render(true);
+}
+
 void BeatIndicator::paintEvent(QPaintEvent* event) {
     Q_UNUSED(event);
-    
+    updateLayerCache();
+
     QPainter p(this);
-    p.setRenderHint(QPainter::Antialiasing, true);
-    
-    // Background
-    p.fillRect(rect(), QColor(20, 20, 25));
-    
-    // Calculate which beat we're currently in for each deck (0-3)
-    int currentBeatIndexA = (int)std::floor(currentBeatA);
-    if (currentBeatIndexA >= 4) currentBeatIndexA = 3;
-    if (currentBeatIndexA < 0) currentBeatIndexA = 0;
-    
-    int currentBeatIndexB = (int)std::floor(currentBeatB);
-    if (currentBeatIndexB >= 4) currentBeatIndexB = 3;
-    if (currentBeatIndexB < 0) currentBeatIndexB = 0;
-    
-    // Check if we're on a strong beat (beat 0 = beat 1) to show orange line
-    bool strongBeatA = (currentBeatIndexA == 0);
-    bool strongBeatB = (currentBeatIndexB == 0);
-    
-    // Centered grid: exact content width = 3*BOX_SPACING + BOX_W
-    const int contentW = 3 * BOX_SPACING + BOX_W;
-    const int startX = (int) std::round((width() - contentW) * 0.5);
-    const int topY = (int) std::round((height() - (2 * BOX_H + ROW_GAP)) * 0.5);
-    const int bottomY = topY + BOX_H + ROW_GAP;
-    
-    // Orange line for strong beat (sync with white beat grid lines)
-    // Strong beat lines removed for a cleaner compact look
-    
-    for (int i = 0; i < 4; ++i) {
-        int x = startX + i * BOX_SPACING;
-        
-    // Top row (blue boxes for Deck A) - flat rectangles
-    QColor topColor = (i == currentBeatIndexA) ? QColor(100, 150, 255) : QColor(40, 60, 80);
-        p.setBrush(QBrush(topColor));
-    p.setPen(QPen(QColor(200, 200, 255), 1));
-    p.drawRect(x, topY, BOX_W, BOX_H);
-        
-        // Beat number in top box - always show 1,2,3,4
-    p.setPen(QPen(QColor(255, 255, 255), 1));
-    p.setFont(QFont("Arial", 8, QFont::Bold));
-    p.drawText(x, topY, BOX_W, BOX_H, Qt::AlignCenter, QString::number(i + 1));
-        
-        // Bottom row (orange boxes for Deck B)
-        QColor bottomColor = (i == currentBeatIndexB) ? QColor(255, 150, 50) : QColor(80, 50, 20);
-        p.setBrush(QBrush(bottomColor));
-        p.setPen(QPen(QColor(255, 200, 100), 1));
-    p.drawRect(x, bottomY, BOX_W, BOX_H);
-        
-        // Beat number in bottom box - always show 1,2,3,4
-    p.setPen(QPen(QColor(255, 255, 255), 1));
-    p.drawText(x, bottomY, BOX_W, BOX_H, Qt::AlignCenter, QString::number(i + 1));
-    }
-    
-    // Draw progress bar showing position within current beat for Deck A
-    double beatProgressA = currentBeatA - std::floor(currentBeatA);
-    int progressXA = startX + currentBeatIndexA * BOX_SPACING;
-    int progressWidthA = (int)(BOX_W * beatProgressA);
-    
-    // Progress overlay on current beat for Deck A (top row)
-    if (progressWidthA > 0) {
-        QColor progressColorA(255, 255, 255, 120);
-        p.setBrush(QBrush(progressColorA));
-        p.setPen(Qt::NoPen);
-    p.drawRect(progressXA, topY, progressWidthA, BOX_H);
-    }
-    
-    // Draw progress bar showing position within current beat for Deck B
-    double beatProgressB = currentBeatB - std::floor(currentBeatB);
-    int progressXB = startX + currentBeatIndexB * BOX_SPACING;
-    int progressWidthB = (int)(BOX_W * beatProgressB);
-    
-    // Progress overlay on current beat for Deck B (bottom row)
-    if (progressWidthB > 0) {
-        QColor progressColorB(255, 255, 255, 120);
-        p.setBrush(QBrush(progressColorB));
-        p.setPen(Qt::NoPen);
-    p.drawRect(progressXB, bottomY, progressWidthB, BOX_H);
-    }
-    
-    // No A/B labels: nur die Zahlen 1..4 in den Kästchen
-    
-    // Strong beat indicator text
-    // Removed the "BEAT" labels for minimal UI
+    p.drawPixmap(0, 0, unlitLayer);
+
+    int startX, topY, bottomY;
+    layout(startX, topY, bottomY);
+    const qreal dpr = litLayer.devicePixelRatio();
+    auto drawCell = [&](double beat, int y) {
+        // The lit cell with its outline (pen extends one pixel past the box)
+        const int index = cellIndex(beat);
+        const QRect cell(startX + index * BOX_SPACING, y, BOX_W + 1, BOX_H + 1);
+        p.drawPixmap(cell, litLayer, QRectF(cell.x() * dpr, cell.y() * dpr, cell.width() * dpr, cell.height() * dpr));
+        // Position within the beat as a translucent overlay
+        const int progressWidth = (int) (BOX_W * (beat - std::floor(beat)));
+        if (progressWidth > 0)
+            p.fillRect(QRect(cell.x(), y, progressWidth, BOX_H), QColor(255, 255, 255, 120));
+    };
+    drawCell(currentBeatA, topY);
+    drawCell(currentBeatB, bottomY);
 }
@@ -1,7 +1,8 @@
 #pragma once
 #include <QWidget>
 #include <QPaintEvent>
-#include "GlobalBeatGrid.h"
+#include <QPixmap>
+#include <array>
 
 class BeatIndicator : public QWidget {
     Q_OBJECT
@@ -35,11 +36,23 @@ public:
     
 protected:
     void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
     
 private:
+    // Both rows unlit / all lit, drawn once at the device pixel ratio; a paint copies the unlit
+    // layer and the current cell of the lit one, then the progress bar on top
+    void updateLayerCache();
+    void layout(int& startX, int& topY, int& bottomY) const;
+    // What the last update() will show: cell per deck and progress width in pixels. Moving
+    // positions that do not change it (a paused deck, sub-pixel progress) repaint nothing.
+    void updateIfChanged();
+    QPixmap unlitLayer;
+    QPixmap litLayer;
+    std::array<int, 4> shownState{ -1, -1, -1, -1 };
+
     double currentBeatA = 0.0; // Current beat position for Deck A (0.0 to 4.0)
     double currentBeatB = 0.0; // Current beat position for Deck B (0.0 to 4.0)
-    // Original analyzed BPMs (per deck). If 0.0, fall back to GlobalBeatGrid
+    // Original analyzed BPMs (per deck). 0.0 until that deck has been analysed
     double bpmA = 0.0;
     double bpmB = 0.0;
     // Tempo factors per deck (1.0 = original speed)
@@ -1,11 +1,20 @@
 #include "BpmAnalyzer.h"
-#include "GlobalBeatGrid.h"
+#include "DecoderRegistry.h"
+#include "KeyDetector.h"
+#include "OnsetEngine.h"
+#include "TempoEstimator.h"
+#include "EventTrace.h"
+#include "MemoryBudget.h"
+#include "AnalysisArena.h"
 #include <algorithm>
 #include <numeric>
 #include <cmath>
 #include <unordered_map>
 #include <vector>
 #include <limits>
+#include <array>
+#include <iterator>
+#include <atomic>
 
 #if defined(AUBIO_FOUND)
     #if defined(__has_include)
@@ -23,7 +32,6 @@ namespace BpmDSP {
     
     struct ScanSection {
         double start, end, energy, rhythmicStrength, bpmConfidence;
-        std::vector<double> detectedBPMs;
         std::vector<double> onsets;
         
         ScanSection(double s, double e) : start(s), end(e), energy(0), rhythmicStrength(0), bpmConfidence(0) {}
@@ -52,7 +60,7 @@ namespace BpmDSP {
             double usableLength = totalDuration - 2 * skip;
             
             // 5 Sections: Start, Early-Mid, Mid, Late-Mid, End
-            std::vector<double> positions = {0.1, 0.3, 0.5, 0.7, 0.9};
+            const double positions[] = {0.1, 0.3, 0.5, 0.7, 0.9};
             double sectionLength = 35.0;
             
             for (double pos : positions) {
@@ -70,7 +78,7 @@ namespace BpmDSP {
             double usableLength = totalDuration - 2 * skip;
             
             // 6 strategische Positionen für lange EDM/Techno Tracks
-            std::vector<double> positions = {0.15, 0.3, 0.45, 0.6, 0.75, 0.9};
+            const double positions[] = {0.15, 0.3, 0.45, 0.6, 0.75, 0.9};
             double sectionLength = 40.0;
             
             for (double pos : positions) {
@@ -87,13 +95,16 @@ namespace BpmDSP {
         return sections;
     }
     
-    // Präzise BPM-Analyse mit verbesserter Intervall-Erkennung
-    std::vector<double> analyzePreciseBPM(const std::vector<double>& beats, double sectionQuality) {
-        std::vector<double> bpmCandidates;
+    // Präzise BPM-Analyse mit verbesserter Intervall-Erkennung; the votes and lists come from
+    // the thread's AnalysisArena
+    template <typename Times>
+    AnalysisArena::Vector<double> analyzePreciseBPM(const Times& beats, double sectionQuality) {
+        auto bpmCandidates = AnalysisArena::vector<double>();
         if (beats.size() < 6) return bpmCandidates;
         
         // Berechne alle Intervalle
-        std::vector<double> intervals;
+        auto intervals = AnalysisArena::vector<double>();
+        intervals.reserve(beats.size());
         for (size_t i = 1; i < beats.size(); ++i) {
             double interval = beats[i] - beats[i-1];
             if (interval >= 0.23 && interval <= 1.5) { // Erweiterte Range: 40-260 BPM
@@ -107,7 +118,8 @@ namespace BpmDSP {
         std::sort(intervals.begin(), intervals.end());
         double median = intervals[intervals.size() / 2];
         
-        std::vector<double> filtered;
+        auto filtered = AnalysisArena::vector<double>();
+        filtered.reserve(intervals.size());
         double tolerance = median * 0.25; // 25% Toleranz um den Median
         
         for (double interval : intervals) {
@@ -142,7 +154,7 @@ namespace BpmDSP {
         double primaryBPM = 60.0 / avgInterval;
         
         // Generiere BPM-Kandidaten mit harmonischen Verhältnissen
-        std::vector<double> harmonics = {
+        const double harmonics[] = {
             primaryBPM,           // 1x
             primaryBPM * 2.0,     // 2x (Half-Time)
             primaryBPM / 2.0,     // 1/2x (Double-Time)
@@ -167,7 +179,7 @@ namespace BpmDSP {
         double totalWeight = sectionQuality * consistency * filtered.size();
         int baseVotes = std::max(1, (int)(totalWeight / 5.0));
         
-        for (size_t i = 0; i < harmonics.size(); ++i) {
+        for (size_t i = 0; i < std::size(harmonics); ++i) {
             double bpm = harmonics[i];
             
             // Range-Korrektur
@@ -240,282 +252,538 @@ namespace BpmDSP {
         return bestAlignment;
     }
     
-    // Section-Qualitätsbewertung
-    double evaluateSectionQuality(const ScanSection& section, const std::vector<float>& audio, int sampleRate) {
-        int startSample = (int)(section.start * sampleRate);
-        int endSample = std::min((int)(section.end * sampleRate), (int)audio.size());
-        int length = endSample - startSample;
-        
-        if (length < sampleRate) return 0.0;
-        
-        // Energie-Analyse
-        double energy = 0.0;
-        for (int i = startSample; i < endSample; ++i) {
-            energy += audio[i] * audio[i];
-        }
-        energy = std::sqrt(energy / length);
-        
-        // Dynamik-Analyse (RMS-Varianz)
-        const int frameSize = sampleRate / 100; // 10ms Frames
-        std::vector<double> frameEnergies;
-        
-        for (int i = startSample; i + frameSize < endSample; i += frameSize/2) {
-            double frameEnergy = 0.0;
-            for (int j = 0; j < frameSize; ++j) {
-                frameEnergy += audio[i + j] * audio[i + j];
+    // Section-Qualitätsbewertung, Sample für Sample: Energie und RMS-Varianz der 10ms Frames
+    // (50% Überlappung) laufen mit, ohne dass das Audio der Section gehalten wird
+    class SectionQuality {
+    public:
+        SectionQuality(int sampleRate, int64 length)
+            : sampleRate(sampleRate), length(length), frameSize(std::max(2, sampleRate / 100)),
+              squares((size_t)frameSize, 0.0) {}
+
+        void add(float sample) {
+            const double sq = (double)sample * (double)sample;
+            energy += sq;
+            // Laufende Summe über die letzten frameSize Samples
+            double& slot = squares[(size_t)(count % frameSize)];
+            windowSum += sq - slot;
+            slot = sq;
+            ++count;
+
+            const int64 frameStart = count - frameSize;
+            if (frameStart >= 0 && frameStart % (frameSize / 2) == 0 && frameStart + frameSize < length) {
+                const double frameEnergy = std::sqrt(std::max(0.0, windowSum) / frameSize);
+                ++frames;
+                const double delta = frameEnergy - frameMean;
+                frameMean += delta / (double)frames;
+                frameM2 += delta * (frameEnergy - frameMean);
             }
-            frameEnergies.push_back(std::sqrt(frameEnergy / frameSize));
         }
-        
-        double dynamicRange = 0.0;
-        if (!frameEnergies.empty()) {
-            double meanEnergy = std::accumulate(frameEnergies.begin(), frameEnergies.end(), 0.0) / frameEnergies.size();
-            double variance = 0.0;
-            for (double fe : frameEnergies) {
-                variance += (fe - meanEnergy) * (fe - meanEnergy);
+
+        double evaluate(const ScanSection& section) const {
+            if (length < sampleRate) return 0.0;
+
+            // Energie-Analyse
+            const double rms = std::sqrt(energy / (double)length);
+            // Dynamik-Analyse (RMS-Varianz)
+            const double dynamicRange = frames > 0 ? std::sqrt(frameM2 / (double)frames) : 0.0;
+
+            // Kombinierte Qualität
+            double quality = 0.0;
+            quality += std::min(50.0, rms * 20000.0);           // Energie-Komponente
+            quality += std::min(30.0, dynamicRange * 10000.0);  // Dynamik-Komponente
+
+            // Position-Bonus (mittlere Sections sind oft besser)
+            double trackPosition = (section.start + section.end) * 0.5;
+            double totalDuration = section.end + section.start; // Approximation
+            double relativePosition = trackPosition / totalDuration;
+
+            if (relativePosition > 0.2 && relativePosition < 0.8) {
+                quality += 20.0; // Mittlere Sections bevorzugen
             }
-            dynamicRange = std::sqrt(variance / frameEnergies.size());
-        }
-        
-        // Kombinierte Qualität
-        double quality = 0.0;
-        quality += std::min(50.0, energy * 20000.0);        // Energie-Komponente
-        quality += std::min(30.0, dynamicRange * 10000.0);  // Dynamik-Komponente
-        
-        // Position-Bonus (mittlere Sections sind oft besser)
-        double trackPosition = (section.start + section.end) * 0.5;
-        double totalDuration = section.end + section.start; // Approximation
-        double relativePosition = trackPosition / totalDuration;
-        
-        if (relativePosition > 0.2 && relativePosition < 0.8) {
-            quality += 20.0; // Mittlere Sections bevorzugen
+
+            return quality;
         }
-        
-        return quality;
-    }
+
+    private:
+        int sampleRate;
+        int64 length;
+        int frameSize;
+        std::vector<double> squares;   // Ringpuffer, ein Frame lang
+        double energy{0.0}, windowSum{0.0};
+        int64 count{0};
+        int64 frames{0};
+        double frameMean{0.0}, frameM2{0.0};
+    };
 }
 
+// What the estimate needs from the analysed window; the PCM itself is gone by then
+struct BpmAnalyzer::Features {
+    double sampleRate{0.0};
+    juce::int64 totalSamples{0};              // whole file, not just the window
+    double analysisRate{0.0};                 // of the decimated downmix the detectors ran on
+    std::vector<BpmDSP::ScanSection> sections; // energy = section quality, onsets of all methods
+    std::vector<double> candidates;           // BPM votes of all sections
+    std::vector<float> novelty;               // spectral flux per hop, smoothed, unit variance
+    int hopSize{256};                         // at analysisRate
+    int windowSize{2048};
+    TrackStructure::Envelope loudness;        // whole file
+    int key{-1};                              // KeyDetector index
+};
+
 #if defined(HAVE_AUBIO_HEADER)
-double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnalyze,
-                                std::vector<double>* outBeatsSeconds,
-                                double* outTotalLengthSeconds,
-                                std::string* outAlgorithmUsed,
-                                double* outFirstBeatOffset,
-                                ProgressFn progress,
-                                StatusFn errorOut) {
-    
-    if (progress) progress(0.0);
-    auto* reader = formatManager.createReaderFor(file);
-    if (!reader) { if (errorOut) errorOut("reader create failed"); return 0.0; }
-
-    std::unique_ptr<juce::AudioFormatReader> r(reader);
-    int sampleRate = (int)r->sampleRate;
-    int64 totalSamples = r->lengthInSamples;
-    double totalDuration = (double)totalSamples / (double)sampleRate;
-    int64 samplesToRead = std::min<int64>((int64)(maxSecondsToAnalyze * sampleRate), totalSamples);
-    
-    if (outTotalLengthSeconds) *outTotalLengthSeconds = totalDuration;
+namespace {
+    // Workers for the per-block jobs of a pass; every job keeps its own state, so they only
+    // share the hop input (read-only) and run side by side
+    juce::ThreadPool& detectorPool() {
+        static juce::ThreadPool pool(juce::ThreadPoolOptions{}
+                                         .withThreadName("BPM detectors")
+                                         .withNumberOfThreads(std::max(1, juce::SystemStats::getNumCpus() - 1)));
+        return pool;
+    }
+
+    // aubio's detection delay: onsets are reported this far before the end of their frame
+    constexpr double OnsetDelayHops = 4.3;
 
-    if (progress) progress(0.05);
-    // Audio laden
-    juce::AudioBuffer<float> buffer((int)r->numChannels, (int)samplesToRead);
-    r->read(&buffer, 0, (int)samplesToRead, 0, true, true);
+    // aubio beat tracker of one section (the onset functions come from the shared OnsetEngine)
+    struct TempoTracker {
+        aubio_tempo_t* tempo{nullptr};
+        fvec_t* out{nullptr};
+        std::vector<double> beats;   // track time
 
-    // Mono-Konvertierung
-    std::vector<float> mono(samplesToRead);
-    if (buffer.getNumChannels() == 1) {
-        for (int i = 0; i < (int)samplesToRead; ++i) {
-            mono[i] = buffer.getSample(0, i);
+        ~TempoTracker() { close(); }
+
+        uint_t hop_s{0};
+
+        // Window and hop of the OnsetEngine, at the analysis rate
+        bool open(uint_t sampleRate, uint_t win_s, uint_t hopSize) {
+            hop_s = hopSize;
+            tempo = new_aubio_tempo("default", win_s, hop_s, sampleRate);
+            out = new_fvec(1);
+            if (!tempo || !out) return false;
+            // Fein-justierte Thresholds für verschiedene Genres
+            aubio_tempo_set_threshold(tempo, 0.15f);           // Sehr sensitiv
+            aubio_tempo_set_silence(tempo, -65.0f);
+            return true;
         }
-    } else {
-        float scale = 1.0f / buffer.getNumChannels();
-        for (int i = 0; i < (int)samplesToRead; ++i) {
-            float sum = 0.0f;
-            for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
-                sum += buffer.getSample(ch, i);
+
+        void close() {
+            if (tempo) del_aubio_tempo(tempo);
+            if (out) del_fvec(out);
+            tempo = nullptr; out = nullptr;
+        }
+
+        // hops consecutive hops starting at `samples`; `offset` maps the tracker's clock to track
+        // time, beats outside [start, end] are dropped
+        void run(const float* samples, int hops, double offset, double start, double end) {
+            fvec_t input{hop_s, const_cast<float*>(samples)};
+            for (int h = 0; h < hops; ++h, input.data += hop_s) {
+                // Tempo-Erkennung
+                aubio_tempo_do(tempo, &input, out);
+                if (!aubio_tempo_was_tatum(tempo)) continue;
+                double t = offset + aubio_tempo_get_last_s(tempo);
+                if (t >= start && t <= end && (beats.empty() || t - beats.back() > 0.025))
+                    beats.push_back(t);
             }
-            mono[i] = sum * scale;
         }
+    };
+}
+#endif
+
+// Per-pass state: section accumulators and, with aubio, the detectors of the sections in reach
+struct BpmAnalyzer::FeatureExtractor::State {
+    struct Section {
+        Section(int64 start, int64 end, int sampleRate) : startSample(start), endSample(end), quality(sampleRate, end - start) {}
+        int64 startSample, endSample;
+        BpmDSP::SectionQuality quality;
+        bool finished{false};
+#if defined(HAVE_AUBIO_HEADER)
+        // Opened at the section's first hop, so the tracker's clock starts there
+        int64 firstHop{-1};
+        TempoTracker tempo;
+        // Multi-Onset-Erkennung: complex, hfc, mkl with their own thresholds
+        std::array<OnsetPicker, 3> pickers{ { { 0.15f, 0.008 },     // EDM/Techno optimiert, sehr schnelle Erkennung
+                                              { 0.2f, 0.010 },
+                                              { 0.18f, 0.008 } } };
+        AnalysisArena::Vector<double> onsets[3]{ AnalysisArena::vector<double>(), AnalysisArena::vector<double>(),
+                                                 AnalysisArena::vector<double>() };
+#endif
+    };
+
+    // Opened first, closed last: the section buffers below live in it
+    AnalysisArena::Track arena;
+    std::shared_ptr<Features> features;
+    std::vector<Section> sections;   // parallel to features->sections
+    int64 wanted{0};
+    int64 received{0};
+    bool failed{false};
+    double reportedProgress{0.0};
+    std::vector<float> mono;         // decimated downmix not yet handed to the detectors
+    std::vector<float> downmix;      // of the block being pushed, before decimation
+    OnsetDecimator decimator;
+    // The window in decimated samples: sections, hops and `wanted` count in these
+    int64 analysisWanted{0};
+    int64 analysed{0};
+    MemoryBudget::Allocation memory{MemoryBudget::Pool::Analysis};
+
+    // Loudness envelope of the whole track: RMS per hop of the downmix and of its low band
+    static constexpr double LoudnessHopSeconds = 0.02;
+    int64 scanned{0};
+    int loudnessHop{0};
+    int hopFill{0};
+    double hopFull{0.0}, hopLow{0.0};
+    float lowState{0.0f};
+    float lowCoeff{0.0f};
+
+    void scanLoudness(const float* const* channels, int numChannels, int n) {
+        const float scale = 1.0f / (float)numChannels;
+        for (int i = 0; i < n; ++i) {
+            float sum = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch) sum += channels[ch][i];
+            const float x = sum * scale;
+            lowState += lowCoeff * (x - lowState);
+            hopFull += (double)x * x;
+            hopLow += (double)lowState * lowState;
+            if (++hopFill == loudnessHop) flushLoudness();
+        }
+        scanned += n;
     }
 
-    if (progress) progress(0.15);
-    // Erstelle Scan-Sections
-    double analysisDuration = (double)samplesToRead / (double)sampleRate;
-    auto sections = BpmDSP::createScanSections(analysisDuration);
-    
-    // Aubio Setup - Ultra-präzise Konfiguration
-    uint_t win_s = 2048;  // Größeres Fenster für bessere Frequenzauflösung
-    uint_t hop_s = 256;   // Kleinerer Hop für höhere Zeitauflösung
-    
-    aubio_tempo_t* tempo = new_aubio_tempo("default", win_s, hop_s, sampleRate);
-    aubio_onset_t* onset_complex = new_aubio_onset("complex", win_s, hop_s, sampleRate);
-    aubio_onset_t* onset_hfc = new_aubio_onset("hfc", win_s, hop_s, sampleRate);
-    aubio_onset_t* onset_mkl = new_aubio_onset("mkl", win_s, hop_s, sampleRate);
-    // QM-like novelty function (spectral flux)
-    aubio_onset_t* onset_specflux = new_aubio_onset("specflux", win_s, hop_s, sampleRate);
-    
-    if (!tempo || !onset_complex || !onset_hfc || !onset_mkl || !onset_specflux) {
-        if (tempo) del_aubio_tempo(tempo);
-        if (onset_complex) del_aubio_onset(onset_complex);
-        if (onset_hfc) del_aubio_onset(onset_hfc);
-        if (onset_mkl) del_aubio_onset(onset_mkl);
-        if (onset_specflux) del_aubio_onset(onset_specflux);
-        return 0.0;
+    void flushLoudness() {
+        if (hopFill == 0) return;
+        features->loudness.full.push_back((float)std::sqrt(hopFull / hopFill));
+        features->loudness.low.push_back((float)std::sqrt(hopLow / hopFill));
+        hopFull = hopLow = 0.0;
+        hopFill = 0;
     }
-    
-    // Fein-justierte Thresholds für verschiedene Genres
-    aubio_tempo_set_threshold(tempo, 0.15f);           // Sehr sensitiv
-    aubio_tempo_set_silence(tempo, -65.0f);
-    aubio_onset_set_threshold(onset_complex, 0.15f);   // EDM/Techno optimiert
-    aubio_onset_set_minioi_ms(onset_complex, 8);       // Sehr schnelle Erkennung
-    aubio_onset_set_threshold(onset_hfc, 0.2f);
-    aubio_onset_set_minioi_ms(onset_hfc, 10);
-    aubio_onset_set_threshold(onset_mkl, 0.18f);
-    aubio_onset_set_minioi_ms(onset_mkl, 8);
-    
-    fvec_t* input = new_fvec(hop_s);
-    fvec_t* tempo_out = new_fvec(1);
-    fvec_t* onset_out = new_fvec(1);
-    
-    std::vector<double> globalCandidates;
-    // Spectral flux novelty function across whole analysis
-    std::vector<float> novelty; novelty.reserve((size_t)(samplesToRead / hop_s + 8));
-    std::vector<double> noveltyTimes; noveltyTimes.reserve((size_t)(samplesToRead / hop_s + 8));
-    
-    // Analysiere jede Section separat
-    for (size_t si = 0; si < sections.size(); ++si) {
-        auto& section = sections[si];
-        std::vector<double> tempoBeats, complexOnsets, hfcOnsets, mklOnsets;
-        
-        int startSample = (int)(section.start * sampleRate);
-        int endSample = std::min((int)(section.end * sampleRate), (int)mono.size());
-        
-        // Section-Audio verarbeiten
-    for (int i = startSample; i + hop_s < endSample; i += hop_s) {
-            for (uint_t j = 0; j < hop_s; ++j) {
-                input->data[j] = mono[i + j];
-            }
-            
-            double currentTime = (double)i / (double)sampleRate;
-            
-            // Tempo-Erkennung
-            aubio_tempo_do(tempo, input, tempo_out);
-            if (aubio_tempo_was_tatum(tempo)) {
-                double t = aubio_tempo_get_last_s(tempo);
-                if (t >= section.start && t <= section.end && 
-                    (tempoBeats.empty() || t - tempoBeats.back() > 0.025)) {
-                    tempoBeats.push_back(t);
-                }
-            }
-            
-            // Multi-Onset-Erkennung
-            aubio_onset_do(onset_complex, input, onset_out);
-            if (aubio_onset_get_last(onset_complex) != 0) {
-                double t = aubio_onset_get_last_s(onset_complex);
-                if (t >= section.start && t <= section.end && 
-                    (complexOnsets.empty() || t - complexOnsets.back() > 0.012)) {
-                    complexOnsets.push_back(t);
-                }
-            }
-            
-            aubio_onset_do(onset_hfc, input, onset_out);
-            if (aubio_onset_get_last(onset_hfc) != 0) {
-                double t = aubio_onset_get_last_s(onset_hfc);
-                if (t >= section.start && t <= section.end && 
-                    (hfcOnsets.empty() || t - hfcOnsets.back() > 0.012)) {
-                    hfcOnsets.push_back(t);
-                }
+
+    // One spectrum per hop for every onset function of the window, and the chroma taken from it
+    std::unique_ptr<OnsetEngine> engine;
+    size_t hop_s{OnsetEngine::HopSize};
+    KeyDetector key;
+    static constexpr int KeyFrameStride = 4;   // frames overlap 7/8, every 4th is plenty for chroma
+    int64 hopsSeen{0};
+
+    OnsetEngine::Frame analyseHop(const float* samples) {
+        auto frame = engine->process(samples);
+        if (hopsSeen++ % KeyFrameStride == 0) {
+            const auto& magnitudes = engine->getMagnitudes();
+            key.addSpectrum(magnitudes.data(), (int)magnitudes.size());
+        }
+        return frame;
+    }
+
+#if defined(HAVE_AUBIO_HEADER)
+    std::vector<OnsetEngine::Frame> frames;   // of the hops in `mono`
+
+    // All complete hops in `mono`: the onset engine and the tempo tracker of each section in
+    // reach run as separate jobs (the engine on the decoding thread); the pickers follow
+    void processHops() {
+        const int hops = (int)(mono.size() / hop_s);
+        const int64 blockStart = analysed - (int64)mono.size();
+        const double sampleRate = features->analysisRate;
+
+        // Number of leading hops that end before `limit`
+        auto hopsBefore = [&](int64 limit) {
+            return (int)juce::jlimit<int64>(0, hops, (limit - blockStart - 1) / (int64)hop_s);
+        };
+        // First hop at or after `start`
+        auto firstHopFrom = [&](int64 start) {
+            return (int)juce::jlimit<int64>(0, hops, (start - blockStart + (int64)hop_s - 1) / (int64)hop_s);
+        };
+
+        std::vector<std::function<void()>> jobs;
+        for (size_t si = 0; si < sections.size(); ++si) {
+            auto& s = sections[si];
+            if (s.finished) continue;
+            const int first = firstHopFrom(s.startSample), last = hopsBefore(s.endSample);
+            if (last <= first) continue;
+
+            if (s.firstHop < 0) {
+                s.firstHop = blockStart + (int64)first * hop_s;
+                if (!s.tempo.open((uint_t)sampleRate, (uint_t)engine->getWindowSize(), (uint_t)hop_s)) { failed = true; return; }
             }
-            
-            aubio_onset_do(onset_mkl, input, onset_out);
-            if (aubio_onset_get_last(onset_mkl) != 0) {
-                double t = aubio_onset_get_last_s(onset_mkl);
-                if (t >= section.start && t <= section.end && 
-                    (mklOnsets.empty() || t - mklOnsets.back() > 0.012)) {
-                    mklOnsets.push_back(t);
+            const auto& section = features->sections[si];
+            const double offset = (double)s.firstHop / sampleRate;
+            jobs.push_back([&s, samples = mono.data() + (size_t)first * hop_s, n = last - first, offset, &section] {
+                s.tempo.run(samples, n, offset, section.start, section.end);
+            });
+        }
+
+        std::atomic<int> remaining{(int)jobs.size()};
+        juce::WaitableEvent done;
+        for (auto& job : jobs)
+            detectorPool().addJob([&job, &remaining, &done] {
+                job();
+                if (--remaining == 0) done.signal();
+            });
+
+        frames.resize((size_t)hops);
+        for (int h = 0; h < hops; ++h) frames[(size_t)h] = analyseHop(mono.data() + (size_t)h * hop_s);
+        // specflux novelty across the whole window
+        for (int h = 0, n = hopsBefore(analysisWanted); h < n; ++h)
+            features->novelty.push_back(frames[(size_t)h].values[OnsetEngine::SpectralFlux]);
+
+        for (size_t si = 0; si < sections.size(); ++si) {
+            auto& s = sections[si];
+            if (s.finished || s.firstHop < 0) continue;
+            const auto& section = features->sections[si];
+            const int first = firstHopFrom(s.startSample), last = hopsBefore(s.endSample);
+            for (int h = first; h < last; ++h) {
+                const auto& frame = frames[(size_t)h];
+                const double frameTime = ((double)(blockStart + (int64)(h + 1) * hop_s) - OnsetDelayHops * hop_s) / sampleRate;
+                const OnsetEngine::Function functions[] = { OnsetEngine::ComplexDomain, OnsetEngine::Hfc, OnsetEngine::Mkl };
+                for (size_t p = 0; p < s.pickers.size(); ++p) {
+                    double t = 0.0;
+                    if (s.pickers[p].process(frame.values[functions[p]], frame.levelDb, frameTime, t)
+                        && t >= section.start && t <= section.end)
+                        s.onsets[p].push_back(t);
                 }
             }
         }
-        
+
+        if (!jobs.empty()) done.wait();
+        mono.erase(mono.begin(), mono.begin() + (ptrdiff_t)((size_t)hops * hop_s));
+
+        // Sections whose last hop has gone by
+        for (size_t si = 0; si < sections.size(); ++si)
+            if (!sections[si].finished && sections[si].endSample <= analysed)
+                finishSection(si);
+    }
+#endif
+
+    // The next n samples of the window
+    void push(const float* const* channels, int numChannels, int n) {
+        // Mono-Konvertierung, then down to the analysis rate
+        downmix.resize((size_t)n);
+        const float scale = 1.0f / numChannels;
+        for (int i = 0; i < n; ++i) {
+            float sum = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch) sum += channels[ch][i];
+            downmix[(size_t)i] = numChannels == 1 ? sum : sum * scale;
+        }
+        received += n;
+        const size_t offset = mono.size();
+        decimator.process(downmix.data(), n, mono);
+
+        const int64 blockStart = analysed;
+        analysed += (int64)(mono.size() - offset);
+        const float* samples = mono.data() + offset;
+        for (auto& s : sections) {
+            const int64 from = std::max(s.startSample, blockStart), to = std::min(s.endSample, analysed);
+            for (int64 i = from; i < to; ++i) s.quality.add(samples[i - blockStart]);
+        }
+#if defined(HAVE_AUBIO_HEADER)
+        if (mono.size() >= hop_s) processHops();
+#else
+        // No onset voting without aubio: the spectral flux goes to TempoEstimator, the spectrum
+        // still gives the key
+        const size_t hops = mono.size() / hop_s;
+        for (size_t h = 0; h < hops; ++h)
+            features->novelty.push_back(analyseHop(mono.data() + h * hop_s).values[OnsetEngine::SpectralFlux]);
+        mono.erase(mono.begin(), mono.begin() + (ptrdiff_t)(hops * hop_s));
+#endif
+    }
+
+    void finishSection(size_t si) {
+        auto& s = sections[si];
+        auto& section = features->sections[si];
+        s.finished = true;
+
         // Section-Qualität bewerten
-        double quality = BpmDSP::evaluateSectionQuality(section, mono, sampleRate);
-        
+        double quality = s.quality.evaluate(section);
+        section.energy = quality;
+#if defined(HAVE_AUBIO_HEADER)
+        s.tempo.close();
+
         // Präzise BPM-Analyse pro Methode
-        auto tempoCandidates = BpmDSP::analyzePreciseBPM(tempoBeats, quality * 1.5);
-        auto complexCandidates = BpmDSP::analyzePreciseBPM(complexOnsets, quality * 1.2);
-        auto hfcCandidates = BpmDSP::analyzePreciseBPM(hfcOnsets, quality);
-        auto mklCandidates = BpmDSP::analyzePreciseBPM(mklOnsets, quality * 1.1);
-        
-        // Alle Candidates sammeln
-        globalCandidates.insert(globalCandidates.end(), tempoCandidates.begin(), tempoCandidates.end());
-        globalCandidates.insert(globalCandidates.end(), complexCandidates.begin(), complexCandidates.end());
-        globalCandidates.insert(globalCandidates.end(), hfcCandidates.begin(), hfcCandidates.end());
-        globalCandidates.insert(globalCandidates.end(), mklCandidates.begin(), mklCandidates.end());
-        
+        auto& candidates = features->candidates;
+        auto vote = [&](const auto& times, double weight) {
+            auto methodCandidates = BpmDSP::analyzePreciseBPM(times, quality * weight);
+            candidates.insert(candidates.end(), methodCandidates.begin(), methodCandidates.end());
+        };
+        vote(s.tempo.beats, 1.5);
+        vote(s.onsets[0], 1.2);   // complex
+        vote(s.onsets[1], 1.0);   // hfc
+        vote(s.onsets[2], 1.1);   // mkl
+
         // Speichere Onsets für spätere Validierung
-        section.onsets = complexOnsets;
-        section.onsets.insert(section.onsets.end(), hfcOnsets.begin(), hfcOnsets.end());
-        section.onsets.insert(section.onsets.end(), mklOnsets.begin(), mklOnsets.end());
+        for (auto& times : s.onsets) {
+            section.onsets.insert(section.onsets.end(), times.begin(), times.end());
+            times.clear();
+        }
         std::sort(section.onsets.begin(), section.onsets.end());
-        
-        section.energy = quality;
-        if (progress) {
-            double base = 0.2;
-            double span = 0.5;
-            double frac = (double)(si + 1) / std::max<size_t>(1, sections.size());
-            progress(base + span * frac);
+        s.tempo.beats = {};
+#endif
+    }
+};
+
+BpmAnalyzer::FeatureExtractor::FeatureExtractor(double maxSeconds) : maxSecondsToAnalyze(maxSeconds) {}
+
+BpmAnalyzer::FeatureExtractor::~FeatureExtractor() = default;
+
+void BpmAnalyzer::FeatureExtractor::prepare(const juce::AudioFormatReader& reader) {
+    state = std::make_unique<State>();
+    auto features = std::make_shared<Features>();
+    features->sampleRate = reader.sampleRate;
+    features->totalSamples = reader.lengthInSamples;
+    state->features = features;
+
+    state->wanted = std::min<int64>((int64)(maxSecondsToAnalyze * reader.sampleRate), reader.lengthInSamples);
+    if ((int)reader.sampleRate <= 0 || state->wanted <= 0) { state->wanted = 0; return; }
+
+    // The detectors run on the downmix decimated to 22-24 kHz, window and hop scaled with it:
+    // the same resolution in time at a half to an eighth of the cost
+    const int factor = OnsetDecimator::factorFor(reader.sampleRate);
+    state->decimator = OnsetDecimator(factor);
+    state->engine = std::make_unique<OnsetEngine>(factor);
+    state->hop_s = (size_t)state->engine->getHopSize();
+    features->analysisRate = reader.sampleRate / factor;
+    features->hopSize = state->engine->getHopSize();
+    features->windowSize = state->engine->getWindowSize();
+    state->analysisWanted = state->wanted / factor;
+    const int sampleRate = (int)features->analysisRate;
+
+    // Erstelle Scan-Sections; the window is known up front, so they are laid out before decoding
+    features->sections = BpmDSP::createScanSections((double)state->wanted / reader.sampleRate);
+    state->sections.reserve(features->sections.size());
+    for (const auto& section : features->sections) {
+        const int64 start = (int64)(section.start * sampleRate);
+        const int64 end = std::min<int64>((int64)(section.end * sampleRate), state->analysisWanted);
+        state->sections.emplace_back(start, end, sampleRate);
+    }
+    state->key.prepare(features->analysisRate, features->windowSize);
+
+    state->loudnessHop = std::max(1, (int)std::lround(State::LoudnessHopSeconds * reader.sampleRate));
+    state->lowCoeff = (float)(1.0 - std::exp(-2.0 * juce::MathConstants<double>::pi * TrackStructure::Envelope::LowBandHz / reader.sampleRate));
+    features->loudness.hopSeconds = state->loudnessHop / reader.sampleRate;
+    const auto loudnessHops = (size_t)(reader.lengthInSamples / state->loudnessHop + 2);
+    features->loudness.full.reserve(loudnessHops);
+    features->loudness.low.reserve(loudnessHops);
+
+    features->novelty.reserve((size_t)(state->analysisWanted / features->hopSize + 8));
+    state->memory.resize((int64_t)((features->novelty.capacity() + 2 * loudnessHops) * sizeof(float) + sizeof(State)));
+}
+
+void BpmAnalyzer::FeatureExtractor::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) {
+    if (!state) return;
+    const int numCh = block.getNumChannels();
+    if (numCh <= 0) return;
+    // The loudness envelope takes the whole track, the detectors their window
+    if (position == state->scanned) state->scanLoudness(block.getArrayOfReadPointers(), numCh, numSamples);
+    const int n = (int)std::min<int64>(numSamples, state->wanted - position);
+    if (n > 0) {
+        state->push(block.getArrayOfReadPointers(), numCh, n);
+        if (state->failed) state->wanted = 0;
+    }
+
+    if (progress) {
+        const int64 total = std::max<int64>(1, state->features->totalSamples);
+        const double frac = std::min(1.0, (double)state->scanned / (double)total);
+        if (frac - state->reportedProgress >= 0.05 || state->scanned >= total) {
+            state->reportedProgress = frac;
+            progress(frac);
         }
     }
+}
 
-    if (progress) progress(0.75);
-    // Also compute a global spectral-flux novelty curve (QM-like) over the whole buffer
-    {
-        int endSample = (int)samplesToRead;
-        float prevOut = 0.0f;
-        for (int i = 0; i + (int)hop_s < endSample; i += hop_s) {
-            for (uint_t j = 0; j < hop_s; ++j) {
-                input->data[j] = mono[i + j];
-            }
-            aubio_onset_do(onset_specflux, input, onset_out);
-            float v = onset_out->data[0];
-            // Half-wave rectified differential (spectral flux style)
-            float diff = v - prevOut;
-            if (diff < 0.0f) diff = 0.0f;
-            novelty.push_back(diff);
-            noveltyTimes.push_back((double)i / (double)sampleRate);
-            prevOut = v;
-        }
-        // Light smoothing (3-tap moving average)
-        if (novelty.size() >= 3) {
-            std::vector<float> sm(novelty.size());
-            sm[0] = novelty[0];
-            for (size_t k = 1; k + 1 < novelty.size(); ++k) {
-                sm[k] = (novelty[k - 1] + novelty[k] + novelty[k + 1]) / 3.0f;
-            }
-            sm.back() = novelty.back();
-            novelty.swap(sm);
-        }
-        // Normalize to unit variance
-        if (!novelty.empty()) {
-            double mean = std::accumulate(novelty.begin(), novelty.end(), 0.0) / novelty.size();
-            double var = 0.0;
-            for (auto v : novelty) { double d = v - mean; var += d * d; }
-            var = (novelty.size() > 1) ? var / (novelty.size() - 1) : 0.0;
-            double stdv = (var > 1e-12) ? std::sqrt(var) : 1.0;
-            for (auto& v : novelty) v = (float)((v - mean) / stdv);
+bool BpmAnalyzer::FeatureExtractor::wantsMore() const {
+    return state && state->wanted > 0
+        && (state->received < state->wanted || state->scanned < state->features->totalSamples);
+}
+
+void BpmAnalyzer::FeatureExtractor::finish(bool completed) {
+    juce::ignoreUnused(completed);
+    if (!state) return;
+    // Sections running up to the end of the window (or of a truncated decode)
+    state->mono = {};
+    state->flushLoudness();
+    for (size_t si = 0; si < state->sections.size(); ++si)
+        if (!state->sections[si].finished) state->finishSection(si);
+    state->features->key = state->key.estimate();
+
+    auto& novelty = state->features->novelty;
+    // Light smoothing (3-tap moving average)
+    if (novelty.size() >= 3) {
+        auto sm = AnalysisArena::vector<float>(novelty.size());
+        sm[0] = novelty[0];
+        for (size_t k = 1; k + 1 < novelty.size(); ++k) {
+            sm[k] = (novelty[k - 1] + novelty[k] + novelty[k + 1]) / 3.0f;
         }
+        sm.back() = novelty.back();
+        std::copy(sm.begin(), sm.end(), novelty.begin());
     }
+    // Normalize to unit variance
+    if (!novelty.empty()) {
+        double mean = std::accumulate(novelty.begin(), novelty.end(), 0.0) / novelty.size();
+        double var = 0.0;
+        for (auto v : novelty) { double d = v - mean; var += d * d; }
+        var = (novelty.size() > 1) ? var / (novelty.size() - 1) : 0.0;
+        double stdv = (var > 1e-12) ? std::sqrt(var) : 1.0;
+        for (auto& v : novelty) v = (float)((v - mean) / stdv);
+    }
+}
+
+std::shared_ptr<const BpmAnalyzer::Features> BpmAnalyzer::FeatureExtractor::takeFeatures() {
+    if (!state || state->failed || state->received == 0) return nullptr;
+    auto features = std::move(state->features);
+    state.reset();
+    return features;
+}
+
+double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnalyze,
+                                std::vector<double>* outBeatsSeconds,
+                                double* outTotalLengthSeconds,
+                                std::string* outAlgorithmUsed,
+                                double* outFirstBeatOffset,
+                                ProgressFn progress,
+                                StatusFn errorOut,
+                                TrackStructure* outStructure) {
+    EVENT_TRACE_PHASES(phase, "BpmAnalyzer::analyzeFile: decode", "analysis");
+    if (progress) progress(0.0);
+    auto r = DecoderRegistry::getInstance().acquireReader(file);
+    if (!r) { if (errorOut) errorOut("reader create failed"); return 0.0; }
 
-    // Cleanup
-    del_aubio_tempo(tempo);
-    del_aubio_onset(onset_complex);
-    del_aubio_onset(onset_hfc);
-    del_aubio_onset(onset_mkl);
-    del_aubio_onset(onset_specflux);
-    del_fvec(input);
-    del_fvec(tempo_out);
-    del_fvec(onset_out);
+    FeatureExtractor extractor(maxSecondsToAnalyze);
+    if (progress) extractor.setProgress([&progress](double frac) { progress(0.05 + 0.7 * frac); });
+    TrackDecodePipeline pipeline(*r);
+    pipeline.addSink(&extractor);
+    // A deck's analysis job: it reads ahead of the library's
+    pipeline.setScheduledIo(file, IoScheduler::Priority::Deck);
+    pipeline.run();
 
+    auto features = extractor.takeFeatures();
+    if (!features) { if (errorOut) errorOut("no audio decoded"); return 0.0; }
+    EVENT_TRACE_NEXT(phase, "BpmAnalyzer::analyzeFile: analyze");
+    double firstBeat = 0.0;
+    const double bpm = analyzeFeatures(*features, outBeatsSeconds, outTotalLengthSeconds, outAlgorithmUsed,
+                                       &firstBeat, progress, errorOut);
+    if (outFirstBeatOffset) *outFirstBeatOffset = firstBeat;
+    if (outStructure) *outStructure = getStructure(*features, bpm, firstBeat);
+    return bpm;
+}
+
+#if defined(HAVE_AUBIO_HEADER)
+double BpmAnalyzer::analyzeFeatures(const Features& features,
+                                    std::vector<double>* outBeatsSeconds,
+                                    double* outTotalLengthSeconds,
+                                    std::string* outAlgorithmUsed,
+                                    double* outFirstBeatOffset,
+                                    ProgressFn progress,
+                                    StatusFn errorOut) {
+    
+    EVENT_TRACE_PHASES(phase, "BpmAnalyzer: candidate histogram", "analysis");
+    AnalysisArena::Track arena;
+    if (progress) progress(0.75);
+    const double sampleRate = features.sampleRate;
+    if (sampleRate <= 0.0) { if (errorOut) errorOut("no audio decoded"); return 0.0; }
+    double totalDuration = (double)features.totalSamples / sampleRate;
+    const int hop_s = features.hopSize;
+    const double analysisRate = features.analysisRate;
+    const auto& sections = features.sections;
+    const auto& globalCandidates = features.candidates;
+    const auto& novelty = features.novelty;
+    
+    if (outTotalLengthSeconds) *outTotalLengthSeconds = totalDuration;
     if (globalCandidates.empty()) {
         if (errorOut) errorOut("no bpm candidates");
         if (outBeatsSeconds) outBeatsSeconds->clear();
@@ -524,7 +792,7 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
     }
 
     // Ultra-hochauflösende BPM-Clusterung (0.1 BPM Auflösung)
-    std::unordered_map<int, int> histogram;
+    AnalysisArena::HashMap<int, int> histogram(AnalysisArena::resource());
     for (double bpm : globalCandidates) {
         if (bpm >= 40.0 && bpm <= 260.0) {
             int bin = (int)(bpm * 10 + 0.5); // 0.1 BPM Bins
@@ -561,7 +829,7 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
     auto computeQMFromNovelty = [&](double minBPM, double maxBPM) {
         struct Result { double bpm{0}, period{0}, phase{0}, score{0}; } res;
         if (novelty.size() < 64) return res; // too short
-        const double hopSec = (double)hop_s / (double)sampleRate;
+        const double hopSec = (double)hop_s / analysisRate;
         int minLag = (int)std::round((60.0 / maxBPM) / hopSec);
         int maxLag = (int)std::round((60.0 / minBPM) / hopSec);
         minLag = std::max(minLag, 2);
@@ -569,7 +837,7 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
         if (minLag >= maxLag) return res;
 
         // Autocorrelation
-        std::vector<double> acf((size_t)maxLag + 1, 0.0);
+        auto acf = AnalysisArena::vector<double>((size_t)maxLag + 1, 0.0);
         for (int L = minLag; L <= maxLag; ++L) {
             double s = 0.0;
             for (size_t t = (size_t)L; t < novelty.size(); ++t) {
@@ -608,7 +876,7 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
         const size_t N = (size_t)novelty.size();
         auto evalPhase = [&](double phaseSec) {
             double s = 0.0; int cnt = 0;
-            for (double t = noveltyTimes[startIdx] + phaseSec; t < noveltyTimes[endIdx - 1]; t += periodSec) {
+            for (double t = startIdx * hopSec + phaseSec; t < (endIdx - 1) * hopSec; t += periodSec) {
                 size_t idx = (size_t)std::llround(t / hopSec);
                 if (idx < N) { s += novelty[idx]; cnt++; }
             }
@@ -624,10 +892,12 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
     };
 
     if (progress) progress(0.85);
+    EVENT_TRACE_NEXT(phase, "BpmAnalyzer: spectral-flux ACF");
     auto qm = computeQMFromNovelty(60.0, 180.0);
+    EVENT_TRACE_NEXT(phase, "BpmAnalyzer: octave check + refine");
     
     // Intelligente Oktav-Validierung mit Section-Consensus
-    std::vector<double> octaveCandidates = {
+    const double octaveCandidates[] = {
         estimatedBPM, estimatedBPM * 2.0, estimatedBPM / 2.0,
         estimatedBPM * 4.0, estimatedBPM / 4.0,
         estimatedBPM * 1.5, estimatedBPM / 1.5,
@@ -749,6 +1019,7 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
     }
     
     // Optimiertes Beat-Grid
+    EVENT_TRACE_NEXT(phase, "BpmAnalyzer: beat grid");
     if (outBeatsSeconds && chosenBPM > 0.0) {
         outBeatsSeconds->clear();
         double period = 60.0 / chosenBPM;
@@ -795,91 +1066,85 @@ double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnaly
         if (outFirstBeatOffset) *outFirstBeatOffset = 0.0;
     }
 
-    // NEW: Update global beat grid with analysis results
-    if (updateGlobalGrid && chosenBPM > 0.0) {
-        double firstBeat = (outFirstBeatOffset && *outFirstBeatOffset > 0.0) ? *outFirstBeatOffset : 0.0;
-        double trackLength = (outTotalLengthSeconds) ? *outTotalLengthSeconds : totalDuration;
-        
-        GlobalBeatGrid::getInstance().setBeatGridParams(chosenBPM, firstBeat, trackLength);
-    }
-
     if (progress) progress(1.0);
     return chosenBPM;
 }
 
 #else
-// Fallback mit gleicher Multi-Section-Logik
-double BpmAnalyzer::analyzeFile(const juce::File& file, double maxSecondsToAnalyze,
-                                std::vector<double>* outBeatsSeconds,
-                                double* outTotalLengthSeconds,
-                                std::string* outAlgorithmUsed,
-                                double* outFirstBeatOffset,
-                                ProgressFn progress,
-                                StatusFn errorOut) {
-    
-    if (progress) progress(0.0);
-    auto* reader = formatManager.createReaderFor(file);
-    if (!reader) { if (errorOut) errorOut("reader create failed"); return 0.0; }
-
-    std::unique_ptr<juce::AudioFormatReader> r(reader);
-    int sampleRate = (int)r->sampleRate;
-    int64 totalSamples = r->lengthInSamples;
-    double totalDuration = (double)totalSamples / (double)sampleRate;
-    int64 samplesToRead = std::min<int64>((int64)(maxSecondsToAnalyze * sampleRate), totalSamples);
-
-    juce::AudioBuffer<float> buffer((int)r->numChannels, (int)samplesToRead);
-    r->read(&buffer, 0, (int)samplesToRead, 0, true, true);
+// Without aubio: TempoEstimator on the spectral-flux novelty of the window
+double BpmAnalyzer::analyzeFeatures(const Features& features,
+                                    std::vector<double>* outBeatsSeconds,
+                                    double* outTotalLengthSeconds,
+                                    std::string* outAlgorithmUsed,
+                                    double* outFirstBeatOffset,
+                                    ProgressFn progress,
+                                    StatusFn errorOut) {
+    EVENT_TRACE_SCOPE("BpmAnalyzer: native tempo estimator", "analysis");
+    AnalysisArena::Track arena;
+    const double sampleRate = features.sampleRate;
+    if (sampleRate <= 0.0) { if (errorOut) errorOut("no audio decoded"); return 0.0; }
+    const double totalDuration = (double)features.totalSamples / sampleRate;
+    if (outTotalLengthSeconds) *outTotalLengthSeconds = totalDuration;
+    if (outBeatsSeconds) outBeatsSeconds->clear();
+    if (outFirstBeatOffset) *outFirstBeatOffset = 0.0;
 
-    std::vector<float> mono(samplesToRead);
-    if (buffer.getNumChannels() == 1) {
-        for (int i = 0; i < (int)samplesToRead; ++i) {
-            mono[i] = buffer.getSample(0, i);
-        }
-    } else {
-        float scale = 1.0f / buffer.getNumChannels();
-        for (int i = 0; i < (int)samplesToRead; ++i) {
-            float sum = 0.0f;
-            for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
-                sum += buffer.getSample(ch, i);
-            }
-            mono[i] = sum * scale;
-        }
+    if (progress) progress(0.75);
+    // A flux frame peaks about half a window after its onset, one hop of it within the frame
+    const double hopSeconds = features.hopSize / features.analysisRate;
+    const double latency = (features.windowSize / 2 - features.hopSize) / features.analysisRate;
+    const auto tempo = TempoEstimator::estimate(features.novelty, hopSeconds, latency);
+    if (!tempo.isValid()) {
+        if (errorOut) errorOut("no tempo found");
+        if (outAlgorithmUsed) *outAlgorithmUsed = "Native SpecFlux Tempo Estimator (no data)";
+        return 0.0;
     }
 
-    if (progress) progress(0.15);
-    double analysisDuration = (double)samplesToRead / (double)sampleRate;
-    auto sections = BpmDSP::createScanSections(analysisDuration);
-    
-    std::vector<double> allCandidates;
-    
-    // Analysiere jede Section
-    for (size_t si = 0; si < sections.size(); ++si) {
-        const auto& section = sections[si];
-        double quality = BpmDSP::evaluateSectionQuality(section, mono, sampleRate);
-        if (quality < 15.0) continue;
-        
-        // [Verkürzte Fallback-Implementierung mit gleicher Multi-Section-Logik]
-        // ... Autocorrelation-based analysis per section ...
-        // [Code ähnlich wie vorher, aber mit sections-basierter Analyse]
-        if (progress) {
-            double base = 0.2;
-            double span = 0.6;
-            double frac = (double)(si + 1) / std::max<size_t>(1, sections.size());
-            progress(base + span * frac);
-        }
+    if (outAlgorithmUsed) {
+        *outAlgorithmUsed = "Native SpecFlux Tempo Estimator (FFT ACF comb, DP beat tracker, "
+                            + std::to_string(tempo.beatsSec.size()) + " beats)";
     }
-    
-    // [Rest der Fallback-Implementierung]
-    
-    if (outTotalLengthSeconds) *outTotalLengthSeconds = totalDuration;
-    if (outFirstBeatOffset) *outFirstBeatOffset = 0.0; // Fallback: kein Beat-Offset erkannt
-    
-    // NEW: Update global beat grid even in fallback mode
-    if (updateGlobalGrid) {
-        GlobalBeatGrid::getInstance().setBeatGridParams(120.0, 0.0, totalDuration);
+    // Constant grid over the whole track, like the aubio path
+    if (outFirstBeatOffset) *outFirstBeatOffset = tempo.firstBeatSec;
+    if (outBeatsSeconds) {
+        const double period = 60.0 / tempo.bpm;
+        for (double t = tempo.firstBeatSec; t < totalDuration; t += period) outBeatsSeconds->push_back(t);
     }
-    
     if (progress) progress(1.0);
-    return 120.0; // Placeholder
+    return tempo.bpm;
+}
+#endif
+
+int BpmAnalyzer::getKey(const Features& features)
+{
+    return features.key;
+}
+
+void BpmAnalyzer::getBeatNovelty(const Features& features, std::vector<float>& envelope, double& hopSeconds)
+{
+    envelope.clear();
+    hopSeconds = features.analysisRate > 0.0 ? features.hopSize / features.analysisRate : 0.0;
+    if (features.novelty.empty() || hopSeconds <= 0.0) return;
+
+    // Unit variance around zero: only the rises above the mean mark onsets
+    const float peak = *std::max_element(features.novelty.begin(), features.novelty.end());
+    if (peak <= 0.0f) return;
+    envelope.reserve(features.novelty.size());
+    for (float v : features.novelty) envelope.push_back(std::max(0.0f, v) / peak);
+}
+
+TrackStructure BpmAnalyzer::getStructure(const Features& features, double bpm, double firstBeatOffset)
+{
+    const double lengthSec = features.sampleRate > 0.0 ? (double)features.totalSamples / features.sampleRate : 0.0;
+    return TrackStructure::detect(features.loudness, bpm, firstBeatOffset, lengthSec);
+}
+
+const char* BpmAnalyzer::getAnalyzerId()
+{
+    // Revision 4: the structure is part of the result. The native build replaced the fallback.
+    // Revision 5 / native 2: the detectors run on the decimated downmix.
+#if defined(HAVE_AUBIO_HEADER)
+    return "aubio/5";
+#else
+    return "native/2";
+#endif
 }
-#endif
\ No newline at end of file
@@ -2,11 +2,14 @@
 
 #include <JuceHeader.h>
 #include <functional>
-#include "GlobalBeatGrid.h"
+#include <memory>
+#include "TrackDecodePipeline.h"
+#include "TrackStructure.h"
 
 class BpmAnalyzer {
 public:
-    explicit BpmAnalyzer(juce::AudioFormatManager& fm) : formatManager(fm) {}
+    // Files are opened through DecoderRegistry
+    BpmAnalyzer() = default;
     /** Analyze file and return estimated BPM (0 if unknown).
         Optionally fills `outBeatsSeconds` with beat timestamps (seconds) and `outTotalLengthSeconds` with the file length.
         Also optionally returns the algorithm method name used for detection.
@@ -23,12 +26,57 @@ public:
                        std::string* outAlgorithmUsed = nullptr,
                        double* outFirstBeatOffset = nullptr,
                        ProgressFn progress = nullptr,
-                       StatusFn errorOut = nullptr);
+                       StatusFn errorOut = nullptr,
+                       TrackStructure* outStructure = nullptr);
 
-    // NEW: Set whether this analyzer should update the global beat grid
-    void setUpdateGlobalBeatGrid(bool update) { updateGlobalGrid = update; }
+    // Onset / tempo features of the analysed window: scan sections with their onsets and
+    // quality, the BPM votes and the spectral-flux novelty curve; and the loudness envelope of
+    // the whole track for its structure. No PCM is kept.
+    struct Features;
 
-private:
-    juce::AudioFormatManager& formatManager;
-    bool updateGlobalGrid{true}; // Default: update global grid on analysis
+    // Streams the first maxSecondsToAnalyze of a decode pass through the detectors, e.g. during
+    // the deck's shared decode pass. Blocks are downmixed sample by sample into a hop-sized
+    // buffer; only the detector state of the sections in reach is alive at any time. The
+    // loudness envelope (TrackStructure::Envelope) keeps going to the end of the track.
+    class FeatureExtractor : public TrackDecodePipeline::Sink {
+    public:
+        explicit FeatureExtractor(double maxSecondsToAnalyze = 120.0);
+        ~FeatureExtractor() override;
+        void prepare(const juce::AudioFormatReader& reader) override;
+        void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+        bool wantsMore() const override;
+        void finish(bool completed) override;
+
+        // Fraction of the window consumed (0..1), called on the decoding thread
+        void setProgress(ProgressFn fn) { progress = std::move(fn); }
+        // Null if nothing was decoded or the detectors couldn't be created
+        std::shared_ptr<const Features> takeFeatures();
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+        double maxSecondsToAnalyze;
+        ProgressFn progress;
+    };
+
+    // BPM, beat grid and first beat from the features of a finished pass
+    double analyzeFeatures(const Features& features,
+                           std::vector<double>* outBeatsSeconds = nullptr,
+                           double* outTotalLengthSeconds = nullptr,
+                           std::string* outAlgorithmUsed = nullptr,
+                           double* outFirstBeatOffset = nullptr,
+                           ProgressFn progress = nullptr,
+                           StatusFn errorOut = nullptr);
+
+    // Musical key found in the same pass (KeyDetector index, -1 if unknown)
+    static int getKey(const Features& features);
+    // Onset novelty of the analysed window for beat-phase fine-tuning: rectified spectral flux,
+    // 0..1, frame i at i * hopSeconds.
+    static void getBeatNovelty(const Features& features, std::vector<float>& envelope, double& hopSeconds);
+    // Downbeat and phrases of the whole track on the grid analyzeFeatures() found
+    static TrackStructure getStructure(const Features& features, double bpm, double firstBeatOffset);
+
+    // Identifies the detector build (aubio or native TempoEstimator) and its revision; bump the revision when
+    // results change so cached beat grids (BpmCache) are re-analysed
+    static const char* getAnalyzerId();
 };
@@ -0,0 +1,406 @@
+#include "BpmCache.h"
+#include "BpmAnalyzer.h"
+#include "ContentHash.h"
+#include "KeyDetector.h"
+#include "SharedCache.h"
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'B', 'E', 'A', 'T', '\0' };
+    constexpr int MaxBeats = 1 << 20;
+    constexpr int MaxNoveltyFrames = 1 << 22;
+    constexpr int MaxPhrases = 1 << 12;
+    constexpr int MaxFingerprintFrames = 1 << 16;
+    // Read-modify-write of a record: the analysis and the memory are stored by different jobs
+    std::mutex recordMutex;
+    constexpr const char* Extension = ".pbc";
+}
+
+BpmCache::BpmCache(const juce::File& dir) : directory(dir)
+{
+}
+
+juce::File BpmCache::getCacheFileFor(const juce::File& audioFile) const
+{
+    const auto key = juce::String::toHexString(audioFile.getFullPathName().hashCode64());
+    return directory.getChildFile(key + Extension);
+}
+
+bool BpmCache::store(const juce::File& audioFile, const Entry& entry) const
+{
+    if (!isEnabled() || entry.bpm <= 0.0) return false;
+    Record record;
+    {
+        const std::lock_guard<std::mutex> lock(recordMutex);
+        read(audioFile, record);    // keeps the memory, if there is one
+        record.hasAnalysis = true;
+        record.analyzerId = BpmAnalyzer::getAnalyzerId();
+        record.fileSize = audioFile.getSize();
+        record.modifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+        record.entry = entry;
+        if (!write(audioFile, record)) return false;
+    }
+    publishShared(audioFile, std::move(record));
+    return true;
+}
+
+bool BpmCache::storeMemory(const juce::File& audioFile, const Memory& memory) const
+{
+    if (!isEnabled()) return false;
+    const std::lock_guard<std::mutex> lock(recordMutex);
+    Record record;
+    read(audioFile, record);    // keeps the analysis, stale or not; load() checks it
+    record.memory = memory;
+    return write(audioFile, record);
+}
+
+bool BpmCache::storeLoudness(const juce::File& audioFile, const Loudness& loudness) const
+{
+    if (!isEnabled() || !loudness.valid) return false;
+    Record record;
+    {
+        const std::lock_guard<std::mutex> lock(recordMutex);
+        read(audioFile, record);
+        record.loudness = loudness;
+        record.loudnessFileSize = audioFile.getSize();
+        record.loudnessModifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+        if (!write(audioFile, record)) return false;
+    }
+    publishShared(audioFile, std::move(record));
+    return true;
+}
+
+bool BpmCache::loadLoudness(const juce::File& audioFile, Loudness& loudness) const
+{
+    if (!isEnabled()) return false;
+    Record record;
+    read(audioFile, record);
+    if (!hasCurrentLoudness(record, audioFile)) fetchShared(audioFile, record);
+    if (!hasCurrentLoudness(record, audioFile)) return false;
+    loudness = record.loudness;
+    return true;
+}
+
+bool BpmCache::storeFingerprint(const juce::File& audioFile, const std::vector<std::uint32_t>& fingerprint) const
+{
+    if (!isEnabled() || fingerprint.empty()) return false;
+    Record record;
+    {
+        const std::lock_guard<std::mutex> lock(recordMutex);
+        read(audioFile, record);
+        record.fingerprint = fingerprint;
+        record.fingerprintFileSize = audioFile.getSize();
+        record.fingerprintModifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+        if (!write(audioFile, record)) return false;
+    }
+    publishShared(audioFile, std::move(record));
+    return true;
+}
+
+bool BpmCache::loadFingerprint(const juce::File& audioFile, std::vector<std::uint32_t>& fingerprint) const
+{
+    if (!isEnabled()) return false;
+    Record record;
+    read(audioFile, record);
+    if (!hasCurrentFingerprint(record, audioFile)) fetchShared(audioFile, record);
+    if (!hasCurrentFingerprint(record, audioFile)) return false;
+    fingerprint = std::move(record.fingerprint);
+    return true;
+}
+
+bool BpmCache::load(const juce::File& audioFile, Entry& entry, Memory* memory) const
+{
+    if (memory) *memory = Memory{};
+    if (!isEnabled()) return false;
+    Record record;
+    read(audioFile, record);
+    if (!hasCurrentAnalysis(record, audioFile)) fetchShared(audioFile, record);
+    if (memory) *memory = record.memory;
+    if (!hasCurrentAnalysis(record, audioFile)) return false;
+    entry = std::move(record.entry);
+    return true;
+}
+
+bool BpmCache::loadMemory(const juce::File& audioFile, Memory& memory) const
+{
+    Record record;
+    if (!isEnabled() || !read(audioFile, record)) return false;
+    memory = record.memory;
+    return true;
+}
+
+bool BpmCache::contains(const juce::File& audioFile) const
+{
+    Entry entry;
+    return load(audioFile, entry);
+}
+
+bool BpmCache::relink(const juce::File& from, juce::int64 fromSize, juce::int64 fromModifiedMs, const juce::File& to) const
+{
+    if (!isEnabled()) return false;
+    const bool moved = from != to;
+    const std::lock_guard<std::mutex> lock(recordMutex);
+    Record record;
+    if (!read(from, record)) return false;
+    if (moved && getCacheFileFor(to).existsAsFile()) return false;
+
+    const juce::int64 size = to.getSize();
+    const juce::int64 modifiedMs = to.getLastModificationTime().toMilliseconds();
+    auto restamp = [&](juce::int64& partSize, juce::int64& partModifiedMs) {
+        if (partSize != fromSize || partModifiedMs != fromModifiedMs) return;
+        partSize = size;
+        partModifiedMs = modifiedMs;
+    };
+    restamp(record.fileSize, record.modifiedMs);
+    restamp(record.loudnessFileSize, record.loudnessModifiedMs);
+    restamp(record.fingerprintFileSize, record.fingerprintModifiedMs);
+    if (!write(to, record)) return false;
+    if (moved) getCacheFileFor(from).deleteFile();
+    return true;
+}
+
+bool BpmCache::hasCurrentAnalysis(const Record& record, const juce::File& audioFile)
+{
+    return record.hasAnalysis && record.analyzerId == BpmAnalyzer::getAnalyzerId()
+        && record.fileSize == audioFile.getSize()
+        && record.modifiedMs == audioFile.getLastModificationTime().toMilliseconds();
+}
+
+bool BpmCache::hasCurrentLoudness(const Record& record, const juce::File& audioFile)
+{
+    return record.loudness.valid && record.loudnessFileSize == audioFile.getSize()
+        && record.loudnessModifiedMs == audioFile.getLastModificationTime().toMilliseconds();
+}
+
+bool BpmCache::hasCurrentFingerprint(const Record& record, const juce::File& audioFile)
+{
+    return !record.fingerprint.empty() && record.fingerprintFileSize == audioFile.getSize()
+        && record.fingerprintModifiedMs == audioFile.getLastModificationTime().toMilliseconds();
+}
+
+void BpmCache::fetchShared(const juce::File& audioFile, Record& record) const
+{
+    if (!SharedCache::isEnabled()) return;
+    const juce::String key = ContentHash::keyFor(audioFile);
+    Record shared;
+    if (!parse(SharedCache::fileFor(directory, key, Extension), SharedCache::identityFor(key), shared)) return;
+    const bool analysis = shared.hasAnalysis && shared.analyzerId == BpmAnalyzer::getAnalyzerId();
+    if (!analysis && !shared.loudness.valid && shared.fingerprint.empty()) return;
+
+    // The shared record stands for this file's content, whatever its size and time say
+    const std::lock_guard<std::mutex> lock(recordMutex);
+    record = Record{};
+    read(audioFile, record);
+    bool taken = false;
+    if (analysis && !hasCurrentAnalysis(record, audioFile)) {
+        record.hasAnalysis = true;
+        record.analyzerId = shared.analyzerId;
+        record.fileSize = audioFile.getSize();
+        record.modifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+        record.entry = std::move(shared.entry);
+        taken = true;
+    }
+    if (shared.loudness.valid && !hasCurrentLoudness(record, audioFile)) {
+        record.loudness = shared.loudness;
+        record.loudnessFileSize = audioFile.getSize();
+        record.loudnessModifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+        taken = true;
+    }
+    if (!shared.fingerprint.empty() && !hasCurrentFingerprint(record, audioFile)) {
+        record.fingerprint = std::move(shared.fingerprint);
+        record.fingerprintFileSize = audioFile.getSize();
+        record.fingerprintModifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+        taken = true;
+    }
+    if (taken) write(audioFile, record);
+}
+
+void BpmCache::publishShared(const juce::File& audioFile, Record record) const
+{
+    if (!SharedCache::isEnabled()) return;
+    const juce::String key = ContentHash::keyFor(audioFile);
+    const juce::File target = SharedCache::fileFor(directory, key, Extension);
+    if (target == juce::File()) return;
+    const juce::String identity = SharedCache::identityFor(key);
+
+    // Stale parts of the local record say nothing about this content; another machine's stay
+    if (!hasCurrentAnalysis(record, audioFile)) record.hasAnalysis = false;
+    if (!hasCurrentLoudness(record, audioFile)) record.loudness = Loudness{};
+    if (!hasCurrentFingerprint(record, audioFile)) record.fingerprint.clear();
+    Record shared;
+    if (parse(target, identity, shared)) {
+        if (!record.hasAnalysis && shared.hasAnalysis) {
+            record.hasAnalysis = true;
+            record.analyzerId = shared.analyzerId;
+            record.entry = std::move(shared.entry);
+        }
+        if (!record.loudness.valid) record.loudness = shared.loudness;
+        if (record.fingerprint.empty()) record.fingerprint = std::move(shared.fingerprint);
+    }
+    record.memory = Memory{};
+    const auto data = serialise(identity, record);
+    SharedCache::publish(target, data.getData(), data.getSize());
+}
+
+bool BpmCache::read(const juce::File& audioFile, Record& record) const
+{
+    return parse(getCacheFileFor(audioFile), audioFile.getFullPathName(), record);
+}
+
+bool BpmCache::parse(const juce::File& cacheFile, const juce::String& identity, Record& record)
+{
+    if (!cacheFile.existsAsFile()) return false;
+
+    juce::MemoryBlock data;
+    if (!cacheFile.loadFileAsData(data) || data.getSize() < sizeof(Magic) + 4) return false;
+    juce::MemoryInputStream in(data, false);
+    char magic[sizeof(Magic)];
+    in.read(magic, sizeof(magic));
+    if (std::memcmp(magic, Magic, sizeof(Magic)) != 0) return false;
+    const int version = in.readInt();
+    if (version < 4 || version > (int) Version) return false;
+    if (in.readString() != identity) return false;
+
+    Record loaded;
+    if (in.getNumBytesRemaining() < (juce::int64) (loaded.memory.cues.size() + 4) * (juce::int64) sizeof(double) + 4)
+        return false;
+    for (double& cue : loaded.memory.cues) cue = in.readDouble();
+    loaded.memory.loopStartSec = in.readDouble();
+    loaded.memory.loopEndSec = in.readDouble();
+    loaded.memory.gridBpm = in.readDouble();
+    loaded.memory.gridFirstBeat = in.readDouble();
+    if (version >= 5 && in.readInt() != 0) {
+        loaded.loudnessFileSize = in.readInt64();
+        loaded.loudnessModifiedMs = in.readInt64();
+        loaded.loudness.integratedLufs = in.readDouble();
+        loaded.loudness.truePeakDb = in.readDouble();
+        loaded.loudness.valid = !in.isExhausted();
+    }
+    if (version >= 7) {
+        const int numFrames = in.readInt();
+        if (numFrames < 0 || numFrames > MaxFingerprintFrames) return false;
+        if (numFrames > 0) {
+            loaded.fingerprintFileSize = in.readInt64();
+            loaded.fingerprintModifiedMs = in.readInt64();
+            if (in.getNumBytesRemaining() < (juce::int64) numFrames * 4) return false;
+            loaded.fingerprint.resize((size_t) numFrames);
+            for (auto& frame : loaded.fingerprint) frame = (std::uint32_t) in.readInt();
+        }
+    }
+    // A record without (or with a damaged) analysis still has its memory
+    record = loaded;
+    if (in.readInt() == 0) return true;
+
+    loaded.analyzerId = in.readString();
+    loaded.fileSize = in.readInt64();
+    loaded.modifiedMs = in.readInt64();
+    Entry& e = loaded.entry;
+    e.bpm = in.readDouble();
+    e.totalSeconds = in.readDouble();
+    e.firstBeatOffset = in.readDouble();
+    e.algorithm = in.readString().toStdString();
+    e.key = in.readInt();
+    if (e.key < -1 || e.key >= KeyDetector::NumKeys) e.key = -1;
+    const int numBeats = in.readInt();
+    if (e.bpm <= 0.0 || numBeats < 0 || numBeats > MaxBeats
+        || in.getNumBytesRemaining() < (juce::int64) numBeats * (juce::int64) sizeof(double))
+        return true;
+    e.beatsSeconds.resize((size_t) numBeats);
+    for (double& beat : e.beatsSeconds) beat = in.readDouble();
+
+    e.noveltyHopSeconds = in.readDouble();
+    const int numFrames = in.readInt();
+    if (numFrames < 0 || numFrames > MaxNoveltyFrames || in.getNumBytesRemaining() < (juce::int64) numFrames * 2)
+        return true;
+    e.novelty.resize((size_t) numFrames);
+    for (float& v : e.novelty) v = (float) (juce::uint16) in.readShort() / 65535.0f;
+
+    if (version >= 6) {
+        TrackStructure& s = e.structure;
+        s.downbeatSec = in.readDouble();
+        const int numPhrases = in.readInt();
+        if (numPhrases < 0 || numPhrases > MaxPhrases || in.getNumBytesRemaining() < (juce::int64) numPhrases * 20)
+            return true;
+        s.phrases.resize((size_t) numPhrases);
+        for (auto& phrase : s.phrases) {
+            phrase.startSec = in.readDouble();
+            phrase.endSec = in.readDouble();
+            phrase.bars = in.readShort();
+            const int section = in.readShort();
+            if (section < 0 || section >= TrackStructure::NumSections) return true;
+            phrase.section = (TrackStructure::Section) section;
+        }
+    }
+
+    loaded.hasAnalysis = true;
+    record = std::move(loaded);
+    return true;
+}
+
+bool BpmCache::write(const juce::File& audioFile, const Record& record) const
+{
+    const auto data = serialise(audioFile.getFullPathName(), record);
+    const juce::File target = getCacheFileFor(audioFile);
+    juce::TemporaryFile temp(target);
+    if (!temp.getFile().replaceWithData(data.getData(), data.getSize()) || !temp.overwriteTargetFileWithTemporary()) {
+        std::cout << "BpmCache: failed to write " << target.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+juce::MemoryBlock BpmCache::serialise(const juce::String& identity, const Record& record)
+{
+    juce::MemoryOutputStream out;
+    out.write(Magic, sizeof(Magic));
+    out.writeInt((int) Version);
+    out.writeString(identity);
+    for (double cue : record.memory.cues) out.writeDouble(cue);
+    out.writeDouble(record.memory.loopStartSec);
+    out.writeDouble(record.memory.loopEndSec);
+    out.writeDouble(record.memory.gridBpm);
+    out.writeDouble(record.memory.gridFirstBeat);
+    out.writeInt(record.loudness.valid ? 1 : 0);
+    if (record.loudness.valid) {
+        out.writeInt64(record.loudnessFileSize);
+        out.writeInt64(record.loudnessModifiedMs);
+        out.writeDouble(record.loudness.integratedLufs);
+        out.writeDouble(record.loudness.truePeakDb);
+    }
+    out.writeInt((int) record.fingerprint.size());
+    if (!record.fingerprint.empty()) {
+        out.writeInt64(record.fingerprintFileSize);
+        out.writeInt64(record.fingerprintModifiedMs);
+        for (auto frame : record.fingerprint) out.writeInt((int) frame);
+    }
+
+    out.writeInt(record.hasAnalysis ? 1 : 0);
+    if (record.hasAnalysis) {
+        const Entry& entry = record.entry;
+        out.writeString(record.analyzerId);
+        out.writeInt64(record.fileSize);
+        out.writeInt64(record.modifiedMs);
+        out.writeDouble(entry.bpm);
+        out.writeDouble(entry.totalSeconds);
+        out.writeDouble(entry.firstBeatOffset);
+        out.writeString(juce::String(entry.algorithm));
+        out.writeInt(entry.key);
+        out.writeInt((int) entry.beatsSeconds.size());
+        for (double beat : entry.beatsSeconds) out.writeDouble(beat);
+        out.writeDouble(entry.noveltyHopSeconds);
+        out.writeInt((int) entry.novelty.size());
+        for (float v : entry.novelty)
+            out.writeShort((short) (juce::uint16) juce::roundToInt(juce::jlimit(0.0f, 1.0f, v) * 65535.0f));
+        out.writeDouble(entry.structure.downbeatSec);
+        out.writeInt((int) entry.structure.phrases.size());
+        for (const auto& phrase : entry.structure.phrases) {
+            out.writeDouble(phrase.startSec);
+            out.writeDouble(phrase.endSec);
+            out.writeShort((short) phrase.bars);
+            out.writeShort((short) phrase.section);
+        }
+    }
+    return out.getMemoryBlock();
+}
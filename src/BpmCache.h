@@ -0,0 +1,123 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TrackStructure.h"
+
+/**
+ * On-disk BPM / beat grid results, one small file per track in AppConfig::getBpmCacheDirectory().
+ *
+ * Keyed like WaveformCache (hash of the path, validated against path, size and modification
+ * time) and tagged with BpmAnalyzer::getAnalyzerId(), so a changed track or a new detector
+ * misses and gets analysed again. Only successful analyses are stored. The musical key, the
+ * onset novelty envelope (16-bit) and the downbeat and phrases from the same pass ride along.
+ *
+ * The same record keeps what the DJ set on the track (Memory: hot cues, the last loop, a beatgrid
+ * edit), so a deck load gets grid and cues from one file. The memory only has to match the path:
+ * it outlives a new analyzer or an edited file, whose analysis is redone around it. store() and
+ * storeMemory() each keep the other half of the record.
+ *
+ * The track's loudness (LoudnessMeter) is a third part, validated on its own against size and
+ * modification time: it doesn't depend on the beat detector, so a new analyzer keeps it. The
+ * acoustic fingerprint (AudioFingerprint) is a fourth, kept the same way.
+ *
+ * With a SharedCache root set, an analysis or loudness missing here is looked up there by the
+ * track's ContentHash and kept locally when found; store() and storeLoudness() write theirs back.
+ * The shared record carries the key in place of the path and no memory.
+ */
+class BpmCache {
+public:
+    static constexpr juce::uint32 Version = 7;   // 6 (no fingerprint), 5 (no structure), 4 (no loudness) still read
+
+    struct Entry {
+        double bpm{0.0};
+        std::vector<double> beatsSeconds;
+        double totalSeconds{0.0};
+        double firstBeatOffset{0.0};
+        std::string algorithm;
+        int key{-1};   // KeyDetector index
+        // BpmAnalyzer::getBeatNovelty() of the pass, for the waveform's phase fine-tuning
+        std::vector<float> novelty;
+        double noveltyHopSeconds{0.0};
+        TrackStructure structure;
+    };
+
+    struct Memory {
+        std::array<double, 8> cues{ -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0 }; // seconds; negative = empty
+        double loopStartSec{0.0};   // the last loop left on the track; end <= start for none
+        double loopEndSec{0.0};
+        double gridBpm{0.0};        // beatgrid edit; 0 = the analysed grid
+        double gridFirstBeat{0.0};
+        bool hasLoop() const { return loopEndSec > loopStartSec; }
+        bool operator==(const Memory& o) const {
+            return cues == o.cues && loopStartSec == o.loopStartSec && loopEndSec == o.loopEndSec
+                && gridBpm == o.gridBpm && gridFirstBeat == o.gridFirstBeat;
+        }
+        bool operator!=(const Memory& o) const { return !(*this == o); }
+    };
+
+    struct Loudness {
+        double integratedLufs{0.0};
+        double truePeakDb{0.0};     // dBTP
+        bool valid{false};
+    };
+
+    explicit BpmCache(const juce::File& directory);
+
+    bool isEnabled() const { return directory.isDirectory(); }
+    juce::File getCacheFileFor(const juce::File& audioFile) const;
+
+    bool store(const juce::File& audioFile, const Entry& entry) const;
+    bool storeMemory(const juce::File& audioFile, const Memory& memory) const;
+    // False on any mismatch (missing, stale, other version or analyzer). `memory`, when given,
+    // is filled from the same read even if the analysis is stale (defaults when there is none).
+    bool load(const juce::File& audioFile, Entry& entry, Memory* memory = nullptr) const;
+    // Only the memory; false if the track has none stored
+    bool loadMemory(const juce::File& audioFile, Memory& memory) const;
+    bool storeLoudness(const juce::File& audioFile, const Loudness& loudness) const;
+    // False if there is none or the file has changed since
+    bool loadLoudness(const juce::File& audioFile, Loudness& loudness) const;
+    bool storeFingerprint(const juce::File& audioFile, const std::vector<std::uint32_t>& fingerprint) const;
+    // False if there is none or the file has changed since
+    bool loadFingerprint(const juce::File& audioFile, std::vector<std::uint32_t>& fingerprint) const;
+    bool contains(const juce::File& audioFile) const;
+    // The record of a track that moved (or was re-tagged) from `from` to `to` keeping its audio
+    // (ContentHash::identityFor): the parts that were current for from's size and modification
+    // time are restamped for to's and the old file removed. False if there was nothing to take,
+    // or `to` has a record of its own.
+    bool relink(const juce::File& from, juce::int64 fromSize, juce::int64 fromModifiedMs, const juce::File& to) const;
+
+private:
+    struct Record {
+        Memory memory;
+        Loudness loudness;
+        juce::int64 loudnessFileSize{0};
+        juce::int64 loudnessModifiedMs{0};
+        std::vector<std::uint32_t> fingerprint;
+        juce::int64 fingerprintFileSize{0};
+        juce::int64 fingerprintModifiedMs{0};
+        bool hasAnalysis{false};
+        juce::String analyzerId;
+        juce::int64 fileSize{0};
+        juce::int64 modifiedMs{0};
+        Entry entry;
+    };
+    static bool hasCurrentAnalysis(const Record& record, const juce::File& audioFile);
+    static bool hasCurrentLoudness(const Record& record, const juce::File& audioFile);
+    static bool hasCurrentFingerprint(const Record& record, const juce::File& audioFile);
+    // The file for audioFile as it is on disk; false if missing, unreadable or another track's
+    bool read(const juce::File& audioFile, Record& record) const;
+    bool write(const juce::File& audioFile, const Record& record) const;
+    // A record file of either layer; identity is the path or SharedCache::identityFor()
+    static bool parse(const juce::File& cacheFile, const juce::String& identity, Record& record);
+    static juce::MemoryBlock serialise(const juce::String& identity, const Record& record);
+    // The parts the local record lacks, from the shared one; record is re-read and kept locally
+    void fetchShared(const juce::File& audioFile, Record& record) const;
+    // The current parts of record, over what the shared one has
+    void publishShared(const juce::File& audioFile, Record record) const;
+
+    juce::File directory;
+};
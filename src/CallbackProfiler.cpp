@@ -0,0 +1,188 @@
+#include "CallbackProfiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const char* stageName(CallbackProfiler::DeckStage stage)
+    {
+        switch (stage) {
+            case CallbackProfiler::DeckStage::Decode:  return "decode";
+            case CallbackProfiler::DeckStage::Stretch: return "resample_keylock";
+            case CallbackProfiler::DeckStage::Eq:      return "eq";
+            default:                                   return "total";
+        }
+    }
+
+    juce::var statsToVar(const CallbackProfiler::Stats& stats)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("count", stats.count);
+        object->setProperty("min_us", stats.minUs);
+        object->setProperty("avg_us", stats.avgUs);
+        object->setProperty("p99_us", stats.p99Us);
+        object->setProperty("max_us", stats.maxUs);
+        return juce::var(object);
+    }
+}
+
+CallbackProfiler::CallbackProfiler()
+    : nsPerTick(1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond()),
+      lastReportTicks(juce::Time::getHighResolutionTicks())
+{
+}
+
+int CallbackProfiler::binFor(juce::int64 ns) noexcept
+{
+    const juce::uint64 us = (juce::uint64) std::max<juce::int64>(1, ns / 1000);
+    int octave = 0;
+    while ((us >> (octave + 1)) != 0) ++octave;
+    // Two bits below the leading one pick the quarter-octave
+    const int sub = octave >= 2 ? (int) ((us >> (octave - 2)) & 3u) : (int) ((us << (2 - octave)) & 3u);
+    return juce::jmin(NumBins - 1, octave * BinsPerOctave + sub);
+}
+
+double CallbackProfiler::binUpperUs(int bin) noexcept
+{
+    const int octave = bin / BinsPerOctave;
+    const int sub = bin % BinsPerOctave;
+    return std::ldexp(1.0 + (sub + 1) / (double) BinsPerOctave, octave);
+}
+
+void CallbackProfiler::record(Slot& slot, juce::int64 ticks) noexcept
+{
+    const juce::int64 ns = std::max<juce::int64>(0, (juce::int64) (ticks * nsPerTick));
+    auto& bin = slot.bins[(size_t) binFor(ns)];
+    bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slot.sumNs.store(slot.sumNs.load(std::memory_order_relaxed) + (juce::uint64) ns, std::memory_order_relaxed);
+    // Count last, with release: a reader that sees it sees the bin and sum that go with it
+    slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (ns < slot.windowMinNs.load(std::memory_order_relaxed)) slot.windowMinNs.store(ns, std::memory_order_relaxed);
+    if (ns > slot.windowMaxNs.load(std::memory_order_relaxed)) slot.windowMaxNs.store(ns, std::memory_order_relaxed);
+}
+
+void CallbackProfiler::recordDeck(int deck, DeckStage stage, juce::int64 ticks) noexcept
+{
+    if (deck < 0 || deck >= MaxDecks || stage == DeckStage::Count) return;
+    record(deckSlots[(size_t) deck][(size_t) stage], ticks);
+}
+
+void CallbackProfiler::recordMix(juce::int64 ticks) noexcept
+{
+    record(mixSlot, ticks);
+}
+
+void CallbackProfiler::recordCueOutput(juce::int64 ticks) noexcept
+{
+    record(cueOutputSlot, ticks);
+}
+
+void CallbackProfiler::recordCallback(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate) noexcept
+{
+    record(callbackSlot, endTicks - startTicks);
+    if (numSamples <= 0 || sampleRate <= 0.0) return;
+
+    const double periodNs = numSamples * 1.0e9 / sampleRate;
+    bufferMs.store(periodNs * 1.0e-6, std::memory_order_relaxed);
+    if ((endTicks - startTicks) * nsPerTick > periodNs)
+        overruns.fetch_add(1, std::memory_order_relaxed);
+    if (lastStartTicks != 0 && (startTicks - lastStartTicks) * nsPerTick > 1.5 * periodNs)
+        lateCallbacks.fetch_add(1, std::memory_order_relaxed);
+    lastStartTicks = startTicks;
+}
+
+CallbackProfiler::Stats CallbackProfiler::take(Slot& slot, Seen& seen)
+{
+    Stats stats;
+    const juce::uint64 count = slot.count.load(std::memory_order_acquire);
+    const juce::uint64 sumNs = slot.sumNs.load(std::memory_order_relaxed);
+    std::array<juce::uint32, NumBins> bins;
+    for (int i = 0; i < NumBins; ++i) bins[(size_t) i] = slot.bins[(size_t) i].load(std::memory_order_relaxed);
+    const juce::int64 minNs = slot.windowMinNs.exchange(std::numeric_limits<juce::int64>::max(), std::memory_order_relaxed);
+    const juce::int64 maxNs = slot.windowMaxNs.exchange(0, std::memory_order_relaxed);
+
+    const juce::uint64 n = count - seen.count;
+    if (n > 0) {
+        stats.count = (juce::int64) n;
+        stats.avgUs = (double) (sumNs - seen.sumNs) / (double) n * 1.0e-3;
+        stats.maxUs = maxNs * 1.0e-3;
+        stats.minUs = minNs == std::numeric_limits<juce::int64>::max() ? 0.0 : minNs * 1.0e-3;
+
+        // A writer may be one sample ahead in the bins; the rank is taken from the bins themselves
+        juce::uint64 binTotal = 0;
+        for (int i = 0; i < NumBins; ++i) binTotal += bins[(size_t) i] - seen.bins[(size_t) i];
+        const juce::uint64 rank = (binTotal * 99 + 99) / 100;
+        juce::uint64 below = 0;
+        for (int i = 0; i < NumBins; ++i) {
+            below += bins[(size_t) i] - seen.bins[(size_t) i];
+            if (below >= rank) {
+                stats.p99Us = juce::jmin(binUpperUs(i), stats.maxUs);
+                break;
+            }
+        }
+    }
+    seen.bins = bins;
+    seen.sumNs = sumNs;
+    seen.count = count;
+    return stats;
+}
+
+CallbackProfiler::Report CallbackProfiler::takeReport(int numDecks, int deviceXruns)
+{
+    Report report;
+    const juce::int64 now = juce::Time::getHighResolutionTicks();
+    report.windowSeconds = (now - lastReportTicks) * nsPerTick * 1.0e-9;
+    lastReportTicks = now;
+
+    report.bufferMs = bufferMs.load(std::memory_order_relaxed);
+    report.numDecks = juce::jlimit(0, MaxDecks, numDecks);
+    report.callback = take(callbackSlot, callbackSeen);
+    report.mix = take(mixSlot, mixSeen);
+    report.cueOutput = take(cueOutputSlot, cueOutputSeen);
+    for (int d = 0; d < MaxDecks; ++d)
+        for (int s = 0; s < (int) DeckStage::Count; ++s)
+            report.decks[(size_t) d][(size_t) s] = take(deckSlots[(size_t) d][(size_t) s], deckSeen[(size_t) d][(size_t) s]);
+
+    if (report.bufferMs > 0.0) {
+        const double percentPerUs = 100.0 / (report.bufferMs * 1000.0);
+        report.loadAvgPercent = report.callback.avgUs * percentPerUs;
+        report.loadP99Percent = report.callback.p99Us * percentPerUs;
+        report.loadMaxPercent = report.callback.maxUs * percentPerUs;
+    }
+    report.overruns = overruns.load(std::memory_order_relaxed);
+    report.lateCallbacks = lateCallbacks.load(std::memory_order_relaxed);
+    report.deviceXruns = deviceXruns;
+    return report;
+}
+
+juce::String CallbackProfiler::Report::toJson() const
+{
+    auto* root = new juce::DynamicObject();
+    root->setProperty("window_s", windowSeconds);
+    root->setProperty("buffer_ms", bufferMs);
+    root->setProperty("load_avg_pct", loadAvgPercent);
+    root->setProperty("load_p99_pct", loadP99Percent);
+    root->setProperty("load_max_pct", loadMaxPercent);
+    root->setProperty("overruns", overruns);
+    root->setProperty("late_callbacks", lateCallbacks);
+    root->setProperty("device_xruns", deviceXruns);
+    root->setProperty("callback", statsToVar(callback));
+    root->setProperty("mix", statsToVar(mix));
+    if (cueUnderruns >= 0) {
+        auto* cue = new juce::DynamicObject();
+        cue->setProperty("callback", statsToVar(cueOutput));
+        cue->setProperty("drift_ppm", cueDriftPpm);
+        cue->setProperty("buffered_ms", cueBufferedMs);
+        cue->setProperty("underruns", cueUnderruns);
+        root->setProperty("cue_device", juce::var(cue));
+    }
+
+    juce::Array<juce::var> deckList;
+    for (int d = 0; d < numDecks; ++d) {
+        auto* deck = new juce::DynamicObject();
+        for (int s = 0; s < (int) DeckStage::Count; ++s)
+            deck->setProperty(stageName((DeckStage) s), statsToVar(decks[(size_t) d][(size_t) s]));
+        deckList.add(juce::var(deck));
+    }
+    root->setProperty("decks", deckList);
+    return juce::JSON::toString(juce::var(root));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <limits>
+
+/**
+ * Timing of every audio callback, so buffer sizes can be chosen from numbers.
+ *
+ * The DeckMixer records each callback and, per deck, where the block's time went: pulling
+ * samples from the source (decode or read-ahead), the EQ, and resampling / keylock with the
+ * rest of the deck's chain. Outside the decks it records the mix stage (master sum, sampler,
+ * meter, recorder, cue) and the whole callback. Every slot is a log-spaced histogram (four
+ * bins per octave from 1 us) plus sum, count and window min/max, all relaxed atomics with a
+ * single writer: the thread that rendered that deck. Recording never blocks or allocates.
+ *
+ * takeReport() (UI thread, about once a second) diffs the cumulative counters against its
+ * previous call, which gives min/avg/p99/max over that window without stopping the writers.
+ * DSP load is the callback time as a share of the buffer period. Overruns are callbacks that
+ * took longer than their period, late callbacks started more than 1.5 periods after the one
+ * before; the driver's own xrun count is added when it keeps one.
+ */
+class CallbackProfiler {
+public:
+    static constexpr int MaxDecks = 8;
+
+    enum class DeckStage { Decode = 0, Stretch, Eq, Total, Count };
+
+    struct Stats {
+        juce::int64 count{0};
+        double minUs{0.0};
+        double avgUs{0.0};
+        double p99Us{0.0};
+        double maxUs{0.0};
+    };
+
+    struct Report {
+        double windowSeconds{0.0};
+        double bufferMs{0.0};
+        int numDecks{0};
+        Stats callback;
+        Stats mix;
+        // Callbacks of the headphone cue device (CueOutputDevice), resampling included; the
+        // rest is filled in by whoever owns that device, underruns -1 while there is none
+        Stats cueOutput;
+        double cueDriftPpm{0.0};
+        double cueBufferedMs{0.0};
+        juce::int64 cueUnderruns{-1};
+        std::array<std::array<Stats, (size_t) DeckStage::Count>, MaxDecks> decks{};
+        double loadAvgPercent{0.0};
+        double loadP99Percent{0.0};
+        double loadMaxPercent{0.0};
+        // Since the profiler started
+        juce::int64 overruns{0};
+        juce::int64 lateCallbacks{0};
+        int deviceXruns{-1};   // -1: the driver doesn't count them
+
+        juce::String toJson() const;
+    };
+
+    CallbackProfiler();
+
+    // Audio thread (deck slots from whichever thread renders that deck); durations in
+    // juce::Time high-resolution ticks
+    void recordDeck(int deck, DeckStage stage, juce::int64 ticks) noexcept;
+    void recordMix(juce::int64 ticks) noexcept;
+    // The cue device's own callback, on its thread
+    void recordCueOutput(juce::int64 ticks) noexcept;
+    // Whole callback; also checks it against the buffer period
+    void recordCallback(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate) noexcept;
+
+    // UI thread, one caller: statistics since the previous call
+    Report takeReport(int numDecks, int deviceXruns);
+
+private:
+    static constexpr int BinsPerOctave = 4;
+    static constexpr int NumBins = 18 * BinsPerOctave;   // up to ~260 ms
+
+    struct Slot {
+        std::array<std::atomic<juce::uint32>, NumBins> bins{};
+        std::atomic<juce::uint64> sumNs{0};
+        std::atomic<juce::uint64> count{0};
+        std::atomic<juce::int64> windowMinNs{std::numeric_limits<juce::int64>::max()};
+        std::atomic<juce::int64> windowMaxNs{0};
+    };
+    // What the reader saw of a slot last time (UI thread only)
+    struct Seen {
+        std::array<juce::uint32, NumBins> bins{};
+        juce::uint64 sumNs{0};
+        juce::uint64 count{0};
+    };
+
+    static int binFor(juce::int64 ns) noexcept;
+    static double binUpperUs(int bin) noexcept;
+    void record(Slot& slot, juce::int64 ticks) noexcept;
+    Stats take(Slot& slot, Seen& seen);
+
+    const double nsPerTick;
+    std::array<std::array<Slot, (size_t) DeckStage::Count>, MaxDecks> deckSlots;
+    Slot mixSlot;
+    Slot callbackSlot;
+    Slot cueOutputSlot;
+    std::array<std::array<Seen, (size_t) DeckStage::Count>, MaxDecks> deckSeen;
+    Seen mixSeen;
+    Seen callbackSeen;
+    Seen cueOutputSeen;
+
+    juce::int64 lastStartTicks{0};   // audio thread only
+    std::atomic<double> bufferMs{0.0};
+    std::atomic<juce::int64> overruns{0};
+    std::atomic<juce::int64> lateCallbacks{0};
+    juce::int64 lastReportTicks{0};  // UI thread only
+};
@@ -0,0 +1,384 @@
+#include "CollectionImporter.h"
+#include "KeyDetector.h"
+#include <QDate>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QUrl>
+#include <QXmlStreamReader>
+#include <algorithm>
+
+namespace {
+    constexpr int NumHotCues = 8;
+
+    // Rekordbox POSITION_MARK and Traktor CUE_V2 types
+    constexpr int RekordboxLoop = 4;
+    constexpr int TraktorGrid = 4;
+    constexpr int TraktorLoop = 5;
+
+    qint64 msecsAtDate(const QString& text, const QString& format)
+    {
+        const QDate date = QDate::fromString(text, format);
+        return date.isValid() ? date.startOfDay().toMSecsSinceEpoch() : 0;
+    }
+
+    QString joinFolder(const QString& folder, const QString& name)
+    {
+        return folder.isEmpty() ? name : folder + " / " + name;
+    }
+}
+
+CollectionImporter::CollectionImporter(const juce::File& bpmCacheDirectory)
+    : cache(bpmCacheDirectory)
+{
+}
+
+CollectionImporter::Result CollectionImporter::run(const QString& filePath, TrackBatch tracksCallback, Progress progressCallback)
+{
+    onTracks = std::move(tracksCallback);
+    onProgress = std::move(progressCallback);
+    result = {};
+    batch.clear();
+    pathByKey.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = QString("Cannot open %1").arg(filePath);
+        return result;
+    }
+    totalBytes = file.size();
+    lastReported = 0;
+
+    QXmlStreamReader xml(&file);
+    if (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("DJ_PLAYLISTS")) {
+            result.format = Format::Rekordbox;
+            readRekordbox(xml);
+        } else if (xml.name() == QLatin1String("NML")) {
+            result.format = Format::Traktor;
+            readTraktor(xml);
+        }
+    }
+    flush();
+    reportProgress(xml, true);
+
+    if (xml.hasError())
+        result.error = QString("%1 (line %2)").arg(xml.errorString()).arg(xml.lineNumber());
+    else if (result.format == Format::Unknown)
+        result.error = "Not a Rekordbox XML or Traktor NML collection";
+    pathByKey.clear();
+    return result;
+}
+
+QString CollectionImporter::pathFromRekordboxLocation(const QString& location)
+{
+    QString path = location;
+    if (path.startsWith("file://localhost", Qt::CaseInsensitive)) path = path.mid(16);
+    else if (path.startsWith("file://", Qt::CaseInsensitive)) path = path.mid(7);
+    path = QUrl::fromPercentEncoding(path.toUtf8());
+    // "/C:/Music/..." on Windows
+    static const QRegularExpression drive("^/[A-Za-z]:/");
+    if (drive.match(path).hasMatch()) path = path.mid(1);
+    return path;
+}
+
+QString CollectionImporter::pathFromTraktorLocation(const QString& volume, const QString& dir, const QString& file)
+{
+    const QString path = QString(dir).replace("/:", "/") + file;
+    // A Windows drive letter is the volume; on macOS the boot volume's name isn't part of paths
+    if (volume.endsWith(':')) return volume + path;
+    if (volume.isEmpty() || QFileInfo::exists(path)) return path;
+    return "/Volumes/" + volume + path;
+}
+
+void CollectionImporter::readRekordbox(QXmlStreamReader& xml)
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("COLLECTION")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("TRACK")) readRekordboxTrack(xml);
+                else xml.skipCurrentElement();
+            }
+        } else if (xml.name() == QLatin1String("PLAYLISTS")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("NODE")) readRekordboxPlaylists(xml, {});
+                else xml.skipCurrentElement();
+            }
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+}
+
+void CollectionImporter::readRekordboxTrack(QXmlStreamReader& xml)
+{
+    const QXmlStreamAttributes attributes = xml.attributes();
+    Track track;
+    TrackInfo& info = track.info;
+    info.filePath = pathFromRekordboxLocation(attributes.value("Location").toString());
+    info.title = attributes.value("Name").toString();
+    info.artist = attributes.value("Artist").toString();
+    info.album = attributes.value("Album").toString();
+    info.genre = attributes.value("Genre").toString();
+    info.year = attributes.value("Year").toString();
+    if (info.year == "0") info.year.clear();
+    info.duration = attributes.value("TotalTime").toDouble();
+    info.bpm = attributes.value("AverageBpm").toDouble();
+    info.key = attributes.value("Tonality").toString();
+    info.comment = attributes.value("Comments").toString();
+    info.addedMs = msecsAtDate(attributes.value("DateAdded").toString(), "yyyy-MM-dd");
+    const QString id = attributes.value("TrackID").toString();
+
+    bool haveLoop = false;
+    while (xml.readNextStartElement()) {
+        const QXmlStreamAttributes mark = xml.attributes();
+        if (xml.name() == QLatin1String("TEMPO")) {
+            const double bpm = mark.value("Bpm").toDouble();
+            if (bpm > 0.0) track.tempo.push_back({ mark.value("Inizio").toDouble(), bpm });
+        } else if (xml.name() == QLatin1String("POSITION_MARK")) {
+            // Num 0-7 is a hot cue (or hot loop), -1 a memory cue
+            const int num = mark.hasAttribute("Num") ? mark.value("Num").toInt() : -1;
+            const double start = mark.value("Start").toDouble();
+            if (num >= 0 && num < NumHotCues) {
+                track.memory.cues[(size_t) num] = start;
+                track.hasMemory = true;
+            }
+            const double end = mark.value("End").toDouble();
+            if (!haveLoop && mark.value("Type").toInt() == RekordboxLoop && end > start) {
+                track.memory.loopStartSec = start;
+                track.memory.loopEndSec = end;
+                track.hasMemory = haveLoop = true;
+            }
+        }
+        xml.skipCurrentElement();
+    }
+    std::sort(track.tempo.begin(), track.tempo.end(),
+              [](const BeatGrid::Segment& a, const BeatGrid::Segment& b) { return a.startSec < b.startSec; });
+
+    const QString path = info.filePath;
+    if (addTrack(track) && !id.isEmpty()) pathByKey.insert(id, path);
+    reportProgress(xml);
+}
+
+void CollectionImporter::readRekordboxPlaylists(QXmlStreamReader& xml, const QString& folder)
+{
+    const QXmlStreamAttributes attributes = xml.attributes();
+    const QString name = attributes.value("Name").toString();
+    // Type 1 is a playlist, 0 a folder; the outermost folder is ROOT
+    if (attributes.value("Type").toInt() == 1) {
+        const bool byLocation = attributes.value("KeyType").toInt() == 1;
+        SmartCrate crate;
+        crate.name = joinFolder(folder, name);
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("TRACK")) {
+                const QString key = xml.attributes().value("Key").toString();
+                const QString path = byLocation ? pathFromRekordboxLocation(key) : pathByKey.value(key);
+                if (!path.isEmpty()) crate.tracks.append(path);
+            }
+            xml.skipCurrentElement();
+        }
+        // An empty list would match every track
+        if (!crate.tracks.isEmpty()) result.playlists.append(std::move(crate));
+        return;
+    }
+    const QString inner = folder.isEmpty() && name == QLatin1String("ROOT") ? QString() : joinFolder(folder, name);
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("NODE")) readRekordboxPlaylists(xml, inner);
+        else xml.skipCurrentElement();
+    }
+}
+
+void CollectionImporter::readTraktor(QXmlStreamReader& xml)
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("COLLECTION")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("ENTRY")) readTraktorEntry(xml);
+                else xml.skipCurrentElement();
+            }
+        } else if (xml.name() == QLatin1String("PLAYLISTS")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == QLatin1String("NODE")) readTraktorPlaylists(xml, {});
+                else xml.skipCurrentElement();
+            }
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+}
+
+void CollectionImporter::readTraktorEntry(QXmlStreamReader& xml)
+{
+    Track track;
+    TrackInfo& info = track.info;
+    info.title = xml.attributes().value("TITLE").toString();
+    info.artist = xml.attributes().value("ARTIST").toString();
+    QString primaryKey;
+    double gridStartSec = -1.0;
+    bool haveLoop = false;
+
+    while (xml.readNextStartElement()) {
+        const QXmlStreamAttributes attributes = xml.attributes();
+        const auto element = xml.name();
+        if (element == QLatin1String("LOCATION")) {
+            const QString volume = attributes.value("VOLUME").toString();
+            const QString dir = attributes.value("DIR").toString();
+            const QString file = attributes.value("FILE").toString();
+            info.filePath = pathFromTraktorLocation(volume, dir, file);
+            primaryKey = volume + dir + file;
+        } else if (element == QLatin1String("ALBUM")) {
+            info.album = attributes.value("TITLE").toString();
+        } else if (element == QLatin1String("INFO")) {
+            info.genre = attributes.value("GENRE").toString();
+            info.comment = attributes.value("COMMENT").toString();
+            info.duration = attributes.hasAttribute("PLAYTIME_FLOAT") ? attributes.value("PLAYTIME_FLOAT").toDouble()
+                                                                      : attributes.value("PLAYTIME").toDouble();
+            info.year = attributes.value("RELEASE_DATE").toString().section('/', 0, 0);
+            if (info.key.isEmpty()) info.key = attributes.value("KEY").toString();
+            info.addedMs = msecsAtDate(attributes.value("IMPORT_DATE").toString(), "yyyy/M/d");
+        } else if (element == QLatin1String("TEMPO")) {
+            info.bpm = attributes.value("BPM").toDouble();
+        } else if (element == QLatin1String("MUSICAL_KEY")) {
+            // Traktor's key values are KeyDetector's indices: C..B major, then C..B minor
+            const int key = attributes.value("VALUE").toInt();
+            if (attributes.hasAttribute("VALUE") && key >= 0 && key < KeyDetector::NumKeys) {
+                track.key = key;
+                info.key = QString::fromStdString(KeyDetector::getName(key));
+            }
+        } else if (element == QLatin1String("CUE_V2")) {
+            // Positions in milliseconds
+            const int type = attributes.value("TYPE").toInt();
+            const double start = attributes.value("START").toDouble() / 1000.0;
+            const double length = attributes.value("LEN").toDouble() / 1000.0;
+            const int hotCue = attributes.hasAttribute("HOTCUE") ? attributes.value("HOTCUE").toInt() : -1;
+            if (type == TraktorGrid) {
+                if (gridStartSec < 0.0) gridStartSec = start;
+            } else if (hotCue >= 0 && hotCue < NumHotCues) {
+                track.memory.cues[(size_t) hotCue] = start;
+                track.hasMemory = true;
+            }
+            if (!haveLoop && type == TraktorLoop && length > 0.0) {
+                track.memory.loopStartSec = start;
+                track.memory.loopEndSec = start + length;
+                track.hasMemory = haveLoop = true;
+            }
+        }
+        xml.skipCurrentElement();
+    }
+    // One grid anchor at the track's BPM; without an anchor the BPM is only a tag
+    if (gridStartSec >= 0.0 && info.bpm > 0.0) track.tempo.push_back({ gridStartSec, info.bpm });
+
+    const QString path = info.filePath;
+    if (!path.isEmpty() && addTrack(track) && !primaryKey.isEmpty()) pathByKey.insert(primaryKey, path);
+    reportProgress(xml);
+}
+
+void CollectionImporter::readTraktorPlaylists(QXmlStreamReader& xml, const QString& folder)
+{
+    const QXmlStreamAttributes attributes = xml.attributes();
+    const QString name = attributes.value("NAME").toString();
+    const QString type = attributes.value("TYPE").toString();
+    if (type == QLatin1String("PLAYLIST")) {
+        SmartCrate crate;
+        crate.name = joinFolder(folder, name);
+        // NODE > PLAYLIST > ENTRY > PRIMARYKEY
+        while (xml.readNextStartElement()) {
+            if (xml.name() != QLatin1String("PLAYLIST")) {
+                xml.skipCurrentElement();
+                continue;
+            }
+            while (xml.readNextStartElement()) {
+                if (xml.name() != QLatin1String("ENTRY")) {
+                    xml.skipCurrentElement();
+                    continue;
+                }
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("PRIMARYKEY")) {
+                        const QString path = pathByKey.value(xml.attributes().value("KEY").toString());
+                        if (!path.isEmpty()) crate.tracks.append(path);
+                    }
+                    xml.skipCurrentElement();
+                }
+            }
+        }
+        if (!crate.tracks.isEmpty()) result.playlists.append(std::move(crate));
+        return;
+    }
+    // Folders hold their nodes in SUBNODES; the outermost one is $ROOT
+    const QString inner = folder.isEmpty() && name == QLatin1String("$ROOT") ? QString() : joinFolder(folder, name);
+    while (xml.readNextStartElement()) {
+        if (xml.name() != QLatin1String("SUBNODES")) {
+            xml.skipCurrentElement();
+            continue;
+        }
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("NODE")) readTraktorPlaylists(xml, inner);
+            else xml.skipCurrentElement();
+        }
+    }
+}
+
+bool CollectionImporter::addTrack(Track& track)
+{
+    TrackInfo& info = track.info;
+    const QFileInfo fileInfo(info.filePath);
+    if (!fileInfo.isFile()) {
+        result.missing++;
+        return false;
+    }
+    info.filePath = fileInfo.absoluteFilePath();
+    info.fileSize = fileInfo.size();
+    info.modifiedMs = fileInfo.lastModified().toMSecsSinceEpoch();
+    if (track.key < 0) track.key = KeyDetector::parse(info.key.toStdString());
+
+    const juce::File file(info.filePath.toStdString());
+    if (!track.tempo.empty() && info.duration > 0.0 && !cache.contains(file)) {
+        const char* source = result.format == Format::Rekordbox ? "rekordbox-xml" : "traktor-nml";
+        if (cache.store(file, makeEntry(track, source))) result.beatGrids++;
+    }
+    if (track.hasMemory) {
+        BpmCache::Memory existing;
+        if (!cache.loadMemory(file, existing) && cache.storeMemory(file, track.memory)) result.cues++;
+    }
+
+    batch.append(std::move(info));
+    result.tracks++;
+    if (batch.size() >= BatchSize) flush();
+    return true;
+}
+
+void CollectionImporter::flush()
+{
+    if (batch.isEmpty()) return;
+    if (onTracks) onTracks(batch);
+    batch.clear();
+}
+
+void CollectionImporter::reportProgress(const QXmlStreamReader& xml, bool force)
+{
+    if (!onProgress || !xml.device()) return;
+    const qint64 position = force ? totalBytes : xml.device()->pos();
+    if (!force && position - lastReported < ProgressBytes) return;
+    lastReported = position;
+    onProgress(position, totalBytes);
+}
+
+BpmCache::Entry CollectionImporter::makeEntry(const Track& track, const char* source)
+{
+    BpmCache::Entry entry;
+    entry.bpm = track.tempo.front().bpm;
+    entry.firstBeatOffset = track.tempo.front().startSec;
+    entry.totalSeconds = track.info.duration;
+    entry.algorithm = source;
+    entry.key = track.key;
+    // Every beat of the tempo map, each segment running to the next one's start
+    for (size_t i = 0; i < track.tempo.size(); ++i) {
+        const double start = track.tempo[i].startSec;
+        const double end = i + 1 < track.tempo.size() ? track.tempo[i + 1].startSec : entry.totalSeconds;
+        const double secondsPerBeat = 60.0 / track.tempo[i].bpm;
+        for (int beat = 0; start + beat * secondsPerBeat < end - 1e-6; ++beat)
+            entry.beatsSeconds.push_back(start + beat * secondsPerBeat);
+    }
+    return entry;
+}
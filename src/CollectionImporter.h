@@ -0,0 +1,91 @@
+#pragma once
+
+#include "BpmCache.h"
+#include "BeatGrid.h"
+#include "LibraryManager.h"
+#include "SmartCrate.h"
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class QXmlStreamReader;
+
+/**
+ * Imports another DJ application's collection export: a Rekordbox XML (DJ_PLAYLISTS) or a
+ * Traktor NML. The file is read once with QXmlStreamReader, element by element and never as a
+ * DOM, so a 200 MB collection costs memory for the playlists' path lists and a TrackID table
+ * only. Each track whose file exists becomes a TrackInfo with its tags, size and modification
+ * time, handed on in BatchSize batches for LibraryTableModel::addTracks().
+ *
+ * The beat grid (Rekordbox TEMPO markers, Traktor's grid anchor and BPM) goes to the BpmCache as
+ * the track's analysis, so loading it plays on the imported grid without running the detectors;
+ * hot cues 1-8 and the first loop go to its memory. Neither overwrites what the cache already
+ * holds for a track. Playlists come back as SmartCrates listing their tracks, named after their
+ * folder path. Memory cues and Serato's crates (binary files, not an XML export) are not read.
+ *
+ * run() blocks; call it on a pool thread. The callbacks are called on that thread.
+ */
+class CollectionImporter {
+public:
+    static constexpr int BatchSize = 512;
+    // Progress is reported about this often, in bytes of the file
+    static constexpr qint64 ProgressBytes = 1 << 20;
+
+    enum class Format { Unknown, Rekordbox, Traktor };
+
+    struct Result {
+        Format format{Format::Unknown};
+        QString error;              // empty on success
+        int tracks{0};              // added to the library (files that exist)
+        int missing{0};             // listed, but not on this disk
+        int beatGrids{0};           // stored as the track's analysis
+        int cues{0};                // tracks that got hot cues or a loop
+        QVector<SmartCrate> playlists;
+    };
+
+    using TrackBatch = std::function<void(const QVector<TrackInfo>& tracks)>;
+    using Progress = std::function<void(qint64 bytesRead, qint64 totalBytes)>;
+
+    explicit CollectionImporter(const juce::File& bpmCacheDirectory);
+
+    Result run(const QString& filePath, TrackBatch onTracks, Progress onProgress = {});
+
+    // File path from a Rekordbox Location ("file://localhost/..." percent-encoded)
+    static QString pathFromRekordboxLocation(const QString& location);
+    // File path from a Traktor LOCATION (VOLUME, "/:"-separated DIR, FILE)
+    static QString pathFromTraktorLocation(const QString& volume, const QString& dir, const QString& file);
+
+private:
+    // One collection entry as read, before it is stored
+    struct Track {
+        TrackInfo info;
+        std::vector<BeatGrid::Segment> tempo;   // sorted by start
+        BpmCache::Memory memory;
+        bool hasMemory{false};
+        int key{-1};
+    };
+
+    void readRekordbox(QXmlStreamReader& xml);
+    void readRekordboxTrack(QXmlStreamReader& xml);
+    void readRekordboxPlaylists(QXmlStreamReader& xml, const QString& folder);
+    void readTraktor(QXmlStreamReader& xml);
+    void readTraktorEntry(QXmlStreamReader& xml);
+    void readTraktorPlaylists(QXmlStreamReader& xml, const QString& folder);
+
+    // Into the batch and the BpmCache; false (and counted as missing) if the file isn't there
+    bool addTrack(Track& track);
+    void flush();
+    void reportProgress(const QXmlStreamReader& xml, bool force = false);
+    static BpmCache::Entry makeEntry(const Track& track, const char* source);
+
+    BpmCache cache;
+    TrackBatch onTracks;
+    Progress onProgress;
+    qint64 totalBytes{0};
+    qint64 lastReported{0};
+    QVector<TrackInfo> batch;
+    Result result;
+    // Playlist entries by the export's own track key: Rekordbox TrackID / Traktor PRIMARYKEY
+    QHash<QString, QString> pathByKey;
+};
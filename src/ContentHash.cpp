@@ -0,0 +1,187 @@
+#include "ContentHash.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    constexpr std::uint64_t Prime1 = 11400714785074694791ULL;
+    constexpr std::uint64_t Prime2 = 14029467366897019727ULL;
+    constexpr std::uint64_t Prime3 = 1609587929392839161ULL;
+    constexpr std::uint64_t Prime4 = 9650029242287828579ULL;
+    constexpr std::uint64_t Prime5 = 2870177450012600261ULL;
+
+    std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    std::uint64_t read64(const unsigned char* p) { return (std::uint64_t) juce::ByteOrder::littleEndianInt64(p); }
+    std::uint64_t read32(const unsigned char* p) { return (std::uint64_t) juce::ByteOrder::littleEndianInt(p); }
+
+    std::uint64_t accumulate(std::uint64_t acc, std::uint64_t input)
+    {
+        acc += input * Prime2;
+        return rotl(acc, 31) * Prime1;
+    }
+
+    std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t value)
+    {
+        acc ^= accumulate(0, value);
+        return acc * Prime1 + Prime4;
+    }
+
+    bool hasId(const char* p, const char* id) { return std::memcmp(p, id, 4) == 0; }
+
+    // ID3v2 tags (one or more) at the start of [begin, end)
+    juce::int64 skipId3v2(const unsigned char* data, juce::int64 begin, juce::int64 end)
+    {
+        while (end - begin >= 10 && std::memcmp(data + begin, "ID3", 3) == 0) {
+            const unsigned char* h = data + begin;
+            if ((h[6] | h[7] | h[8] | h[9]) & 0x80) break;   // not syncsafe: not a tag
+            const juce::int64 size = ((juce::int64) h[6] << 21) | (h[7] << 14) | (h[8] << 7) | h[9];
+            const juce::int64 total = 10 + size + ((h[5] & 0x10) ? 10 : 0);
+            if (total > end - begin) break;
+            begin += total;
+        }
+        return begin;
+    }
+
+    // ID3v1 and APEv2 tags at the end of [begin, end)
+    juce::int64 trimTrailingTags(const unsigned char* data, juce::int64 begin, juce::int64 end)
+    {
+        if (end - begin >= 128 && std::memcmp(data + end - 128, "TAG", 3) == 0) end -= 128;
+        if (end - begin >= 32 && std::memcmp(data + end - 32, "APETAGEX", 8) == 0) {
+            const juce::int64 size = juce::ByteOrder::littleEndianInt(data + end - 20);
+            const bool hasHeader = (juce::ByteOrder::littleEndianInt(data + end - 12) & 0x80000000u) != 0;
+            const juce::int64 total = size + (hasHeader ? 32 : 0);
+            if (size >= 32 && total <= end - begin) end -= total;
+        }
+        return end;
+    }
+
+    // Little-endian chunks (RIFF) or big-endian ones (FORM) from `from`; the body of `id`
+    juce::Range<juce::int64> findChunk(const unsigned char* data, juce::int64 from, juce::int64 end, const char* id,
+                                       bool bigEndian)
+    {
+        for (juce::int64 pos = from; pos + 8 <= end;) {
+            const juce::int64 size = bigEndian ? (juce::int64) juce::ByteOrder::bigEndianInt(data + pos + 4)
+                                               : (juce::int64) juce::ByteOrder::littleEndianInt(data + pos + 4);
+            if (hasId((const char*) data + pos, id))
+                return { pos + 8, std::min(end, pos + 8 + size) };
+            pos += 8 + size + (size & 1);
+        }
+        return {};
+    }
+
+    struct Memo {
+        juce::int64 size{0};
+        juce::int64 modifiedMs{0};
+        juce::String key;
+    };
+    std::mutex memoMutex;
+    std::unordered_map<juce::String, Memo> memo;
+}
+
+std::uint64_t ContentHash::xxh64(const void* input, size_t size, std::uint64_t seed)
+{
+    const auto* p = static_cast<const unsigned char*>(input);
+    const unsigned char* const end = p + size;
+    std::uint64_t h;
+
+    if (size >= 32) {
+        std::uint64_t v1 = seed + Prime1 + Prime2, v2 = seed + Prime2, v3 = seed, v4 = seed - Prime1;
+        for (const unsigned char* const limit = end - 32; p <= limit; p += 32) {
+            v1 = accumulate(v1, read64(p));
+            v2 = accumulate(v2, read64(p + 8));
+            v3 = accumulate(v3, read64(p + 16));
+            v4 = accumulate(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + Prime5;
+    }
+    h += (std::uint64_t) size;
+
+    for (; p + 8 <= end; p += 8)
+        h = rotl(h ^ accumulate(0, read64(p)), 27) * Prime1 + Prime4;
+    if (p + 4 <= end) {
+        h = rotl(h ^ (read32(p) * Prime1), 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+        h = rotl(h ^ (*p * Prime5), 11) * Prime1;
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+juce::Range<juce::int64> ContentHash::findAudioBytes(const char* bytes, juce::int64 size)
+{
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes);
+    if (size >= 12 && hasId(bytes, "RIFF") && hasId(bytes + 8, "WAVE")) {
+        const auto chunk = findChunk(data, 12, size, "data", false);
+        if (!chunk.isEmpty()) return chunk;
+    }
+    if (size >= 12 && hasId(bytes, "FORM") && (hasId(bytes + 8, "AIFF") || hasId(bytes + 8, "AIFC"))) {
+        const auto chunk = findChunk(data, 12, size, "SSND", true);
+        if (!chunk.isEmpty()) return chunk;
+    }
+
+    juce::int64 begin = skipId3v2(data, 0, size);
+    const juce::int64 end = trimTrailingTags(data, begin, size);
+    if (end - begin >= 4 && hasId(bytes + begin, "fLaC")) {
+        // Metadata blocks until the one flagged last; the frames follow
+        juce::int64 pos = begin + 4;
+        while (pos + 4 <= end) {
+            const bool last = (data[pos] & 0x80) != 0;
+            pos += 4 + ((juce::int64) data[pos + 1] << 16 | data[pos + 2] << 8 | data[pos + 3]);
+            if (last) break;
+        }
+        if (pos < end) begin = pos;
+    }
+    return { begin, std::max(begin, end) };
+}
+
+juce::String ContentHash::keyFor(const juce::File& audioFile)
+{
+    const juce::String path = audioFile.getFullPathName();
+    const juce::int64 size = audioFile.getSize();
+    const juce::int64 modifiedMs = audioFile.getLastModificationTime().toMilliseconds();
+    {
+        const std::lock_guard<std::mutex> lock(memoMutex);
+        const auto it = memo.find(path);
+        if (it != memo.end() && it->second.size == size && it->second.modifiedMs == modifiedMs) return it->second.key;
+    }
+
+    juce::MemoryMappedFile mapped(audioFile, juce::MemoryMappedFile::readOnly);
+    if (mapped.getData() == nullptr || mapped.getSize() == 0) return {};
+    const char* data = static_cast<const char*>(mapped.getData());
+    const auto audio = findAudioBytes(data, (juce::int64) mapped.getSize());
+    const auto hash = xxh64(data + audio.getStart(), (size_t) audio.getLength());
+    const juce::String key = juce::String::toHexString((juce::int64) hash).paddedLeft('0', 16);
+
+    const std::lock_guard<std::mutex> lock(memoMutex);
+    memo[path] = { size, modifiedMs, key };
+    return key;
+}
+
+std::uint64_t ContentHash::identityFor(const juce::File& audioFile)
+{
+    // Only the pages of the tag blocks and the three windows are read from the mapping
+    juce::MemoryMappedFile mapped(audioFile, juce::MemoryMappedFile::readOnly);
+    if (mapped.getData() == nullptr || mapped.getSize() == 0) return 0;
+    const char* data = static_cast<const char*>(mapped.getData());
+    const auto audio = findAudioBytes(data, (juce::int64) mapped.getSize());
+    const juce::int64 length = audio.getLength();
+    const juce::int64 window = std::min(length, IdentitySampleBytes);
+
+    std::uint64_t hash = xxh64(&length, sizeof(length));
+    for (const juce::int64 at : { audio.getStart(), audio.getStart() + (length - window) / 2, audio.getEnd() - window })
+        hash = xxh64(data + at, (size_t) window, hash);
+    return hash != 0 ? hash : 1;
+}
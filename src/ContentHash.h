@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+
+/**
+ * Content keys for the per-track caches: XXH64 over a file's audio bytes with its tags left out,
+ * so a track copied to another machine, moved, renamed or re-tagged keeps its key. Skipped are
+ * ID3v2 tags at the start and APEv2 / ID3v1 tags at the end (MP3 and the like), FLAC's metadata
+ * blocks, and for WAV and AIFF everything but the sample chunk; other containers are hashed
+ * whole, less any ID3 and APE tags.
+ *
+ * keyFor() memoises per path, size and modification time, so a file is read once per run.
+ * identityFor() is the cheap sibling the library tells moved files by: the audio bytes' length
+ * and three IdentitySampleBytes windows of them, so it reads at most that much three times.
+ * Thread-safe.
+ */
+class ContentHash {
+public:
+    static constexpr juce::int64 IdentitySampleBytes = 64 * 1024;
+
+    // The XXH64 reference hash (xxhash.com), one shot
+    static std::uint64_t xxh64(const void* data, size_t size, std::uint64_t seed = 0);
+
+    // The part of a file's bytes that is audio, judged by the container's magic
+    static juce::Range<juce::int64> findAudioBytes(const char* data, juce::int64 size);
+
+    // 16 hex digits; empty if the file can't be read
+    static juce::String keyFor(const juce::File& audioFile);
+    // Length of the audio bytes and their start, middle and end hashed; never 0 but for a file
+    // that can't be read
+    static std::uint64_t identityFor(const juce::File& audioFile);
+};
@@ -0,0 +1,318 @@
+#include "ControllerInput.h"
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "ThreadingPolicy.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    struct ActionName {
+        const char* name;
+        ControllerInput::Action action;
+        float defaultParam;
+    };
+    // One 128-tick jog turn is one platter turn: 1.8 s of track at 33 1/3 rpm
+    constexpr float kSecondsPerJogTick = 1.8f / 128.0f;
+    constexpr ActionName kActions[] = {
+        { "tempo", ControllerInput::Action::Tempo, 0.08f },
+        { "eq_high", ControllerInput::Action::EqHigh, 0.0f },
+        { "eq_mid", ControllerInput::Action::EqMid, 0.0f },
+        { "eq_low", ControllerInput::Action::EqLow, 0.0f },
+        { "filter", ControllerInput::Action::Filter, 0.0f },
+        { "volume", ControllerInput::Action::Volume, 0.0f },
+        { "crossfader", ControllerInput::Action::Crossfader, 0.0f },
+        { "jog_touch", ControllerInput::Action::JogTouch, 0.0f },
+        { "jog", ControllerInput::Action::Jog, kSecondsPerJogTick },
+        { "beat_jump", ControllerInput::Action::BeatJump, 4.0f },
+        { "brake", ControllerInput::Action::Brake, 1.0f },
+        { "spinback", ControllerInput::Action::Spinback, 2.0f },
+        { "censor", ControllerInput::Action::Censor, 0.0f },
+        { "play", ControllerInput::Action::PlayPause, 0.0f },
+        { "cue", ControllerInput::Action::Cue, 0.0f },
+        { "sync", ControllerInput::Action::Sync, 0.0f },
+        { "keylock", ControllerInput::Action::Keylock, 0.0f },
+        { "slip", ControllerInput::Action::Slip, 0.0f },
+        { "hotcue", ControllerInput::Action::HotCue, 1.0f },
+    };
+}
+
+ControllerInput::ControllerInput() : juce::Thread("Controller Input"), table((size_t) TableSize)
+{
+}
+
+ControllerInput::~ControllerInput()
+{
+    stop();
+}
+
+void ControllerInput::setDeck(int index, DJAudioPlayer* player, int mixerChannel)
+{
+    if (index < 0 || index >= MaxDecks) return;
+    decks[(size_t) index].player = player;
+    decks[(size_t) index].mixerChannel = mixerChannel;
+}
+
+bool ControllerInput::loadMapping(const juce::File& file)
+{
+    const juce::var root = juce::JSON::parse(file);
+    const juce::Array<juce::var>* bindings = root["bindings"].getArray();
+    if (bindings == nullptr) {
+        std::cout << "ControllerInput: no \"bindings\" array in " << file.getFullPathName() << std::endl;
+        return false;
+    }
+
+    std::vector<Binding> compiled((size_t) TableSize);
+    int count = 0;
+    for (const juce::var& entry : *bindings) {
+        const juce::String type = entry["type"].toString();
+        const int kind = type == "note" ? Note : type == "cc" ? ControlChange : type == "pitchbend" ? PitchBend : -1;
+        const int channel = (int) entry.getProperty("channel", 1) - 1;
+        const int number = kind == PitchBend ? 0 : (int) entry.getProperty("number", -1);
+        const juce::String actionName = entry["action"].toString();
+        const ActionName* action = nullptr;
+        for (const auto& candidate : kActions)
+            if (actionName == candidate.name) action = &candidate;
+
+        if (kind < 0 || channel < 0 || channel > 15 || number < 0 || number > 127 || action == nullptr) {
+            std::cout << "ControllerInput: skipping binding " << juce::JSON::toString(entry, true) << std::endl;
+            continue;
+        }
+        Binding& b = compiled[(size_t) tableIndex(kind, channel, number)];
+        b.action = action->action;
+        b.deck = (juce::int8) juce::jlimit(0, MaxDecks - 1, (int) entry.getProperty("deck", 0));
+        b.param = (float) (double) entry.getProperty("param", action->defaultParam);
+        ++count;
+    }
+
+    table = std::move(compiled);
+    numBindings = count;
+    std::cout << "ControllerInput: " << count << " bindings from " << file.getFileName() << std::endl;
+    return true;
+}
+
+void ControllerInput::start()
+{
+    if (isThreadRunning()) return;
+    for (const auto& info : juce::MidiInput::getAvailableDevices()) {
+        auto device = std::make_unique<Device>(*this);
+        device->input = juce::MidiInput::openDevice(info.identifier, device.get());
+        if (!device->input) {
+            std::cout << "ControllerInput: could not open " << info.name << std::endl;
+            continue;
+        }
+        devices.push_back(std::move(device));
+    }
+
+    const auto options = juce::Thread::RealtimeOptions{}.withPriority(ThreadingPolicy::getInstance().getRenderPriority());
+    if (!startRealtimeThread(options)) {
+        std::cout << "ControllerInput: realtime priority unavailable, using high priority" << std::endl;
+        startThread(juce::Thread::Priority::highest);
+    }
+    for (auto& device : devices) device->input->start();
+    std::cout << "ControllerInput: " << devices.size() << " MIDI input(s) open" << std::endl;
+}
+
+void ControllerInput::stop()
+{
+    for (auto& device : devices) device->input->stop();
+    signalThreadShouldExit();
+    wake.post();
+    stopThread(1000);
+    devices.clear();
+    for (auto& deck : decks) deck.jogTouched = false;
+    const int dropped = droppedMessages.exchange(0);
+    if (dropped > 0) std::cout << "ControllerInput: " << dropped << " messages dropped (dispatch fell behind)" << std::endl;
+}
+
+juce::StringArray ControllerInput::getOpenDeviceNames() const
+{
+    juce::StringArray names;
+    for (const auto& device : devices) names.add(device->input->getName());
+    return names;
+}
+
+void ControllerInput::Device::handleIncomingMidiMessage(juce::MidiInput*, const juce::MidiMessage& message)
+{
+    // Channel voice messages only; SysEx and clock have no binding
+    if (message.getRawDataSize() > 3 || message.getRawDataSize() < 1 || message.isMidiClock()) return;
+    Message m;
+    std::memcpy(m.bytes, message.getRawData(), (size_t) message.getRawDataSize());
+    m.timeNs = DeckMixer::nowNs();
+    if (!queue.push(m)) owner.droppedMessages.fetch_add(1, std::memory_order_relaxed);
+    owner.wake.post();
+}
+
+void ControllerInput::run()
+{
+    while (!threadShouldExit()) {
+        wake.wait();
+        Message m;
+        for (auto& device : devices)
+            while (device->queue.pop(m)) dispatch(m);
+        RemoteMessage remote;
+        while (remoteQueue.pop(remote)) apply(remote.binding, remote.value, 0, remote.timeNs);
+    }
+}
+
+bool ControllerInput::postRemote(Action action, int deck, float value, float param) noexcept
+{
+    if (action == Action::None || action == Action::Jog || deck < 0 || deck >= MaxDecks) return false;
+    RemoteMessage m;
+    m.binding.action = action;
+    m.binding.deck = (juce::int8) deck;
+    m.binding.param = param;
+    m.value = juce::jlimit(0.0f, 1.0f, value);
+    m.timeNs = DeckMixer::nowNs();
+    bool pushed;
+    {
+        std::lock_guard<std::mutex> guard(remoteLock);
+        pushed = remoteQueue.push(m);
+    }
+    if (!pushed) {
+        droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    wake.post();
+    return true;
+}
+
+bool ControllerInput::postNamed(const juce::String& name, int deck, float value, bool hasValue, float maxTempoRange) noexcept
+{
+    const auto argument = [&](float fallback) { return hasValue ? value : fallback; };
+    const auto bipolar = [&](Action action) {
+        return postRemote(action, deck, (juce::jlimit(-1.0f, 1.0f, argument(0.0f)) + 1.0f) * 0.5f, 0.0f);
+    };
+    const auto button = [&](Action action) { return postRemote(action, deck, argument(1.0f) > 0.0f ? 1.0f : 0.0f, 0.0f); };
+
+    if (name == "crossfader") return postRemote(Action::Crossfader, 0, (juce::jlimit(-1.0f, 1.0f, argument(0.0f)) + 1.0f) * 0.5f, 0.0f);
+    if (name == "tempo") {
+        if (maxTempoRange <= 0.0f) return false;
+        const float offset = (argument(1.0f) - 1.0f) / maxTempoRange;
+        return postRemote(Action::Tempo, deck, (juce::jlimit(-1.0f, 1.0f, offset) + 1.0f) * 0.5f, maxTempoRange);
+    }
+    if (name == "eq/high") return bipolar(Action::EqHigh);
+    if (name == "eq/mid") return bipolar(Action::EqMid);
+    if (name == "eq/low") return bipolar(Action::EqLow);
+    if (name == "filter") return bipolar(Action::Filter);
+    if (name == "volume") return postRemote(Action::Volume, deck, argument(0.0f), 0.0f);
+    if (name == "play") return button(Action::PlayPause);
+    if (name == "cue") return button(Action::Cue);
+    if (name == "sync") return button(Action::Sync);
+    if (name == "keylock") return button(Action::Keylock);
+    if (name == "slip") return button(Action::Slip);
+    if (name == "censor") return button(Action::Censor);
+    if (name == "hotcue") return postRemote(Action::HotCue, deck, 1.0f, argument(1.0f));
+    if (name == "beatjump") return postRemote(Action::BeatJump, deck, 1.0f, argument(4.0f));
+    if (name == "brake") return postRemote(Action::Brake, deck, 1.0f, argument(1.0f));
+    if (name == "spinback") return postRemote(Action::Spinback, deck, 1.0f, argument(2.0f));
+    return false;
+}
+
+void ControllerInput::dispatch(const Message& m) noexcept
+{
+    const int status = m.bytes[0] & 0xF0;
+    const int channel = m.bytes[0] & 0x0F;
+    int kind = Note, number = m.bytes[1] & 0x7F, raw = m.bytes[2] & 0x7F;
+    float value = raw / 127.0f;
+    switch (status) {
+        case 0x90: break;                       // velocity 0 is a note off
+        case 0x80: value = 0.0f; break;
+        case 0xB0: kind = ControlChange; break;
+        case 0xE0:
+            kind = PitchBend;
+            number = 0;
+            raw = ((m.bytes[2] & 0x7F) << 7) | (m.bytes[1] & 0x7F);
+            value = raw / 16383.0f;
+            break;
+        default: return;
+    }
+    const Binding& binding = table[(size_t) tableIndex(kind, channel, number)];
+    if (binding.action != Action::None) apply(binding, value, raw, m.timeNs);
+}
+
+void ControllerInput::apply(const Binding& b, float value, int raw, juce::uint64 timeNs) noexcept
+{
+    Deck& deck = decks[(size_t) b.deck];
+    DJAudioPlayer* player = deck.player;
+    using Type = DJAudioPlayer::Command::Type;
+    const bool pressed = value > 0.0f;
+    const float bipolar = value * 2.0f - 1.0f;
+
+    switch (b.action) {
+        case Action::Tempo: {
+            if (!player) return;
+            const double factor = 1.0 + bipolar * b.param;
+            player->postControllerCommand(Type::SetSpeed, factor);
+            toUi(b.action, b.deck, (float) factor);
+            return;
+        }
+        case Action::EqHigh:
+        case Action::EqMid:
+        case Action::EqLow:
+        case Action::Filter: {
+            if (!player) return;
+            const Type type = b.action == Action::EqHigh ? Type::SetHighGain
+                            : b.action == Action::EqMid ? Type::SetMidGain
+                            : b.action == Action::EqLow ? Type::SetLowGain : Type::SetFilter;
+            player->postControllerCommand(type, bipolar);
+            toUi(b.action, b.deck, bipolar);
+            return;
+        }
+        case Action::Volume:
+            if (!mixer || deck.mixerChannel < 0) return;
+            mixer->setChannelGain(deck.mixerChannel, value);
+            toUi(b.action, b.deck, value);
+            return;
+        case Action::Crossfader:
+            if (!mixer) return;
+            mixer->setCrossfader(bipolar);
+            toUi(b.action, b.deck, bipolar);
+            return;
+        case Action::JogTouch:
+            if (!player || pressed == deck.jogTouched) return;
+            deck.jogTouched = pressed;
+            if (pressed) deck.jogPositionSec = player->getPositionSnapshot().positionAt(timeNs);
+            player->postControllerCommand(Type::EnableScratch, pressed ? 1.0 : 0.0);
+            // The UI keeps a paused deck's transport running while it is scratched
+            toUi(b.action, b.deck, pressed ? 1.0f : 0.0f);
+            return;
+        case Action::Jog:
+            // Without a touch the platter only spins; nudging is left to the tempo fader for now
+            if (!player || !deck.jogTouched) return;
+            deck.jogPositionSec += (raw < 64 ? raw : raw - 128) * (double) b.param;
+            player->pushScratchPosition(deck.jogPositionSec, timeNs);
+            return;
+        case Action::BeatJump:
+            if (player && pressed) player->postControllerCommand(Type::BeatJump, b.param);
+            return;
+        case Action::Brake:
+        case Action::Spinback:
+            if (player && pressed)
+                player->postControllerCommand(b.action == Action::Brake ? Type::Brake : Type::Spinback, b.param, (double) timeNs);
+            return;
+        case Action::Censor:
+            if (player) player->postControllerCommand(Type::Censor, pressed ? 1.0 : 0.0, (double) timeNs);
+            return;
+        default:
+            toUi(b.action, b.deck, pressed ? 1.0f : 0.0f, b.param);
+            return;
+    }
+}
+
+void ControllerInput::toUi(Action action, int deck, float value, float param) noexcept
+{
+    UiEvent e;
+    e.action = action;
+    e.deck = deck;
+    e.value = value;
+    e.param = param;
+    if (!uiQueue.push(e)) return;   // the UI is far behind; the controls catch up with the next move
+    if (!uiWakePending.exchange(true) && uiWakeup) uiWakeup();
+}
+
+bool ControllerInput::popUiEvent(UiEvent& out) noexcept
+{
+    // Cleared before popping: an event pushed after the queue ran dry wakes the UI again
+    uiWakePending.store(false);
+    return uiQueue.pop(out);
+}
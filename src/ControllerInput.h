@@ -0,0 +1,154 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "LockFreeQueue.h"
+#include "RealtimeSemaphore.h"
+
+class DJAudioPlayer;
+class DeckMixer;
+
+/**
+ * MIDI controllers, dispatched on their own real-time thread instead of the Qt event loop.
+ *
+ * Every MIDI input is opened with juce::MidiInput; its callback only stamps the message
+ * (DeckMixer::nowNs()), pushes it into the device's own SPSC queue and posts a semaphore. The
+ * dispatch thread (render priority, see ThreadingPolicy) looks each message up in a flat table
+ * indexed by kind, channel and number, compiled from the mapping file, and acts on it right away:
+ *   - tempo, EQ, filter, jog touch/turn, beat jumps and the vinyl motions (brake, spinback,
+ *     censor, started at the message's own time) go into the deck's controller command queue
+ *     (DJAudioPlayer::postControllerCommand) and scratch input,
+ *   - volume and crossfader are DeckMixer atomics,
+ *   - play, cue, sync, keylock, slip and hot cues need the UI's transport logic and are handed
+ *     to the UI thread, together with a copy of every direct change so the widgets follow.
+ * A busy UI (library redraw, analysis results) then delays none of the sound.
+ *
+ * Mapping file (JSON), channels 1..16:
+ *   { "bindings": [ { "type": "cc", "channel": 1, "number": 13, "action": "eq_high", "deck": 0 },
+ *                   { "type": "note", "channel": 1, "number": 11, "action": "play", "deck": 0 },
+ *                   { "type": "pitchbend", "channel": 1, "action": "tempo", "deck": 0, "param": 0.08 } ] }
+ * type: note, cc, pitchbend. action: tempo (param = range, default 0.08), eq_high, eq_mid, eq_low,
+ * filter, volume, crossfader, jog_touch, jog (relative CC, 1..63 forward, 65..127 back; param =
+ * track seconds per tick, default one 128-tick turn at 33 rpm), beat_jump (param = beats, default
+ * 4, negative = back), brake (param = beats to a stop, default 1), spinback (param = beats,
+ * default 2), censor (held), play, cue, sync, keylock, slip, hotcue (param = pad 1..8).
+ *
+ * Remote surfaces (OSC, the web remote) skip the table: they name the action and deck and post it
+ * with postRemote(), or postNamed() for the control names they share. HID devices would feed the
+ * same table later. Decks, mixer, mapping and the UI wake-up are set while stopped; everything on
+ * the dispatch thread is lock- and allocation-free.
+ */
+class ControllerInput : private juce::Thread {
+public:
+    static constexpr int MaxDecks = 2;
+
+    enum class Action : juce::uint8 {
+        None = 0,
+        // Applied on the dispatch thread
+        Tempo, EqHigh, EqMid, EqLow, Filter, Volume, Crossfader, JogTouch, Jog, BeatJump,
+        Brake, Spinback, Censor,
+        // Handed to the UI thread, which owns the transport and the toggles
+        PlayPause, Cue, Sync, Keylock, Slip, HotCue
+    };
+
+    // What the UI gets: the action to run, or the new value of a control applied directly
+    // (tempo as speed factor, EQ/filter -1..1, volume 0..1, crossfader -1..1; buttons 1/0)
+    struct UiEvent {
+        Action action{Action::None};
+        int deck{0};
+        float value{0.0f};
+        float param{0.0f};
+    };
+
+    ControllerInput();
+    ~ControllerInput() override;
+
+    void setDeck(int index, DJAudioPlayer* player, int mixerChannel);
+    void setMixer(DeckMixer* mixer) { this->mixer = mixer; }
+    // Compile a mapping file into the dispatch table; false (previous table kept) if it can't be read
+    bool loadMapping(const juce::File& file);
+    int getNumBindings() const { return numBindings; }
+    // Called on the dispatch thread when the UI queue stops being empty; keep it to a post
+    void setUiWakeup(std::function<void()> wakeup) { uiWakeup = std::move(wakeup); }
+
+    // UI thread: open every MIDI input and run the dispatch thread / close them again
+    void start();
+    void stop();
+    juce::StringArray getOpenDeviceNames() const;
+
+    // UI thread: next event for the widgets; drain until false after each wake-up
+    bool popUiEvent(UiEvent& out) noexcept;
+
+    // Another control surface (OscRemote, WebRemote) through the same dispatch: `value` as a
+    // bound MIDI control would give it (0..1, bipolar controls centred on 0.5; buttons 1 pressed,
+    // 0 released), `param` as in a binding. Any thread; false if the queue is full
+    bool postRemote(Action action, int deck, float value, float param) noexcept;
+    // The remote surfaces' control names, with their natural argument (`hasValue` false takes the
+    // default): play, cue, sync, keylock, slip, censor (1/0, default 1); hotcue (pad 1..8);
+    // tempo (speed factor within maxTempoRange of 1); eq/high, eq/mid, eq/low, filter (-1..1);
+    // volume (0..1); beatjump, brake, spinback (beats); crossfader (-1..1, any deck).
+    // False for an unknown name or a full queue
+    bool postNamed(const juce::String& name, int deck, float value, bool hasValue, float maxTempoRange) noexcept;
+
+private:
+    enum Kind { Note = 0, ControlChange, PitchBend, NumKinds };
+    static constexpr int TableSize = NumKinds * 16 * 128;
+    static int tableIndex(int kind, int channel, int number) noexcept { return (kind * 16 + channel) * 128 + number; }
+
+    struct Binding {
+        Action action{Action::None};
+        juce::int8 deck{0};
+        float param{0.0f};
+    };
+
+    struct Message {
+        juce::uint8 bytes[3]{};
+        juce::uint64 timeNs{0};
+    };
+
+    struct RemoteMessage {
+        Binding binding;
+        float value{0.0f};
+        juce::uint64 timeNs{0};
+    };
+
+    // One per open input: its callback thread is the single producer of `queue`
+    struct Device : juce::MidiInputCallback {
+        explicit Device(ControllerInput& owner) : owner(owner) {}
+        void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override;
+        ControllerInput& owner;
+        std::unique_ptr<juce::MidiInput> input;
+        SpscQueue<Message, 1024> queue;
+    };
+
+    struct Deck {
+        DJAudioPlayer* player{nullptr};
+        int mixerChannel{-1};
+        bool jogTouched{false};
+        double jogPositionSec{0.0};
+    };
+
+    void run() override;
+    void dispatch(const Message& message) noexcept;
+    void apply(const Binding& binding, float value, int raw, juce::uint64 timeNs) noexcept;
+    void toUi(Action action, int deck, float value, float param = 0.0f) noexcept;
+
+    std::vector<Binding> table;     // TableSize entries
+    int numBindings{0};
+    std::array<Deck, MaxDecks> decks{};
+    DeckMixer* mixer{nullptr};
+    std::vector<std::unique_ptr<Device>> devices;
+    SpscQueue<RemoteMessage, 256> remoteQueue;
+    std::mutex remoteLock;          // between the remote producers; the dispatch thread never takes it
+    RealtimeSemaphore wake;
+
+    SpscQueue<UiEvent, 512> uiQueue;
+    std::atomic<bool> uiWakePending{false};
+    std::function<void()> uiWakeup;
+    std::atomic<int> droppedMessages{0};
+};
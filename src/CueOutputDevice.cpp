@@ -0,0 +1,276 @@
+#include "CueOutputDevice.h"
+#include "CallbackProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Share of each new fill reading in the average the correction follows
+    constexpr double FillSmoothing = 0.02;
+    // The DLL's estimate is kept this close to the nominal rate
+    constexpr double MaxClockDeviation = 0.005;
+
+    inline float hermite(float xm1, float x0, float x1, float x2, float t) noexcept
+    {
+        const float c1 = 0.5f * (x1 - xm1);
+        const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * t + c2) * t + c1) * t + x0;
+    }
+}
+
+void CueOutputDevice::ClockFilter::reset(double nominalRate) noexcept
+{
+    nominalSecondsPerFrame = 1.0 / nominalRate;
+    secondsPerFrame = nominalSecondsPerFrame;
+    started = false;
+}
+
+void CueOutputDevice::ClockFilter::update(double seconds, int frames) noexcept
+{
+    const double period = frames * secondsPerFrame;
+    const double error = seconds - expected;
+    // First callback, or one far off the prediction (a stall, a driver restart): start from here
+    // with the rate found so far
+    if (!started || std::abs(error) > 4.0 * period + 0.01) {
+        started = true;
+        expected = seconds + period;
+        return;
+    }
+    const double omega = 2.0 * juce::MathConstants<double>::pi * ClockBandwidthHz * period;
+    expected += std::sqrt(2.0) * omega * error + period;
+    secondsPerFrame = juce::jlimit(nominalSecondsPerFrame * (1.0 - MaxClockDeviation),
+                                   nominalSecondsPerFrame * (1.0 + MaxClockDeviation),
+                                   secondsPerFrame + omega * omega * error / frames);
+}
+
+CueOutputDevice::CueOutputDevice()
+    : secondsPerTick(1.0 / (double) juce::Time::getHighResolutionTicksPerSecond())
+{
+    fifoBuffer.setSize(2, FifoFrames);
+}
+
+CueOutputDevice::~CueOutputDevice()
+{
+    close();
+}
+
+juce::String CueOutputDevice::open(juce::AudioDeviceManager& manager, const juce::String& deviceName,
+                                   double masterRateHz, int masterBlock, int bufferSize)
+{
+    close();
+    const juce::String typeName = deviceName.upToFirstOccurrenceOf(": ", false, false);
+    const juce::String name = deviceName.fromFirstOccurrenceOf(": ", false, false);
+    if (auto* master = manager.getCurrentAudioDevice())
+        if (master->getTypeName() == typeName && master->getName() == name)
+            return name + " is the master device";
+
+    juce::AudioIODeviceType* type = nullptr;
+    for (auto* candidate : manager.getAvailableDeviceTypes())
+        if (candidate->getTypeName() == typeName) type = candidate;
+    if (type == nullptr) return "no " + typeName + " devices on this system";
+    type->scanForDevices();
+    if (!type->getDeviceNames(false).contains(name)) return name + " is not connected";
+    std::unique_ptr<juce::AudioIODevice> opened(type->createDevice(name, {}));
+    if (opened == nullptr) return name + " could not be created";
+
+    // The master's rate keeps the ratio at 1 plus the drift
+    double rate = masterRateHz;
+    const auto rates = opened->getAvailableSampleRates();
+    if (!rates.isEmpty() && !rates.contains(rate))
+        rate = *std::min_element(rates.begin(), rates.end(),
+                                 [&](double a, double b) { return std::abs(a - masterRateHz) < std::abs(b - masterRateHz); });
+    juce::BigInteger outputs;
+    outputs.setRange(0, std::min(2, opened->getOutputChannelNames().size()), true);
+    const juce::String error = opened->open({}, outputs, rate, bufferSize);
+    if (error.isNotEmpty()) return error;
+
+    // Everything the two callbacks touch is set up here, before either runs
+    masterNominalRate = masterRateHz;
+    cueNominalRate = opened->getCurrentSampleRate();
+    const double ratio = masterNominalRate / cueNominalRate;
+    // Drivers that vary the block ask for up to the buffer size; the rest is done in chunks
+    maxChunk = std::max(1, opened->getCurrentBufferSizeSamples());
+    targetFill = masterBlock + (int) std::ceil(maxChunk * ratio) + (int) std::ceil(masterNominalRate * MarginMs / 1000.0);
+    if (targetFill > FifoFrames / 4) {
+        opened->close();
+        return "the buffers are too large to bridge";
+    }
+    const double maxStep = ratio * (1.0 + MaxCorrection) * (1.0 + 2.0 * MaxClockDeviation);
+    window.setSize(2, (int) std::ceil(maxChunk * maxStep) + 8);
+    window.clear();
+    windowFrames = 3;
+    phase = 0.0;
+    averageFill = 0.0;
+    primed = false;
+    fifo.reset();
+    masterClock.reset(masterNominalRate);
+    cueClock.reset(cueNominalRate);
+    masterRate.store(masterNominalRate);
+    driftPpm.store(0.0);
+    bufferedMs.store(0.0);
+    underruns.store(0);
+    overruns.store(0);
+
+    device = std::move(opened);
+    armed.store(true);
+    device->start(this);
+    std::cout << "CueOutputDevice: " << deviceName.toStdString() << ", " << cueNominalRate << " Hz, "
+              << maxChunk << " samples, bridging " << targetFill << " master samples" << std::endl;
+    return {};
+}
+
+void CueOutputDevice::close()
+{
+    armed.store(false);
+    // Wait out a push() that read armed before it was cleared (at most one block)
+    while (masterInside.load())
+        juce::Thread::yield();
+    if (device != nullptr) {
+        device->stop();
+        device->close();
+        device.reset();
+    }
+}
+
+CueOutputDevice::Status CueOutputDevice::getStatus() const
+{
+    Status status;
+    status.running = armed.load() && device != nullptr && device->isPlaying();
+    if (device != nullptr) {
+        status.deviceName = device->getTypeName() + ": " + device->getName();
+        status.sampleRate = cueNominalRate;
+    }
+    status.driftPpm = driftPpm.load(std::memory_order_relaxed);
+    status.bufferedMs = bufferedMs.load(std::memory_order_relaxed);
+    status.underruns = underruns.load(std::memory_order_relaxed);
+    status.overruns = overruns.load(std::memory_order_relaxed);
+    return status;
+}
+
+void CueOutputDevice::push(const float* const* cue, int numSamples, juce::int64 callbackStartTicks) noexcept
+{
+    masterInside.store(true);
+    if (armed.load() && cue != nullptr && numSamples > 0) {
+        masterClock.update(callbackStartTicks * secondsPerTick, numSamples);
+        masterRate.store(masterClock.getRate(), std::memory_order_relaxed);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+        if (size1 + size2 < numSamples) {
+            overruns.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            for (int ch = 0; ch < 2; ++ch) {
+                if (size1 > 0) fifoBuffer.copyFrom(ch, start1, cue[ch], size1);
+                if (size2 > 0) fifoBuffer.copyFrom(ch, start2, cue[ch] + size1, size2);
+            }
+            fifo.finishedWrite(size1 + size2);
+        }
+    }
+    masterInside.store(false);
+}
+
+void CueOutputDevice::audioDeviceAboutToStart(juce::AudioIODevice*)
+{
+    // open() has set everything up by the time it starts the device
+}
+
+void CueOutputDevice::audioDeviceStopped()
+{
+}
+
+void CueOutputDevice::audioDeviceIOCallbackWithContext(const float* const*, int, float* const* outputChannelData,
+                                                       int numOutputChannels, int numSamples,
+                                                       const juce::AudioIODeviceCallbackContext&)
+{
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch] != nullptr) juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+    if (numSamples <= 0) return;
+    cueClock.update(startTicks * secondsPerTick, numSamples);
+
+    int available = fifo.getNumReady();
+    if (!primed) {
+        // After a dry spell the master's cue starts again from the target delay
+        if (available >= targetFill) {
+            primed = true;
+            averageFill = available;
+            window.clear();
+            windowFrames = 3;
+            phase = 0.0;
+        }
+    } else if (available > 4 * targetFill) {
+        // The cue device stalled: skip back to the target at once rather than slewing for minutes
+        fifo.finishedRead(available - targetFill);
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        available = targetFill;
+        averageFill = available;
+    }
+
+    if (primed) {
+        averageFill += FillSmoothing * (available - averageFill);
+        const double measured = masterRate.load(std::memory_order_relaxed) / cueClock.getRate();
+        const double correction = juce::jlimit(-MaxCorrection, MaxCorrection,
+                                               (averageFill - targetFill) / (masterNominalRate * SettleSeconds));
+        const double step = measured * (1.0 + correction);
+        for (int done = 0; done < numSamples;) {
+            const int n = std::min(maxChunk, numSamples - done);
+            if (!resample(outputChannelData, numOutputChannels, done, n, step)) {
+                underruns.fetch_add(1, std::memory_order_relaxed);
+                primed = false;
+                break;
+            }
+            done += n;
+        }
+        driftPpm.store((measured * cueNominalRate / masterNominalRate - 1.0) * 1.0e6, std::memory_order_relaxed);
+        bufferedMs.store(1000.0 * averageFill / masterNominalRate, std::memory_order_relaxed);
+    }
+
+    if (profiler != nullptr)
+        profiler->recordCueOutput(juce::Time::getHighResolutionTicks() - startTicks);
+}
+
+bool CueOutputDevice::resample(float* const* out, int numOutputChannels, int offset, int numSamples, double step) noexcept
+{
+    // Output j lies between window frames 1 + i and 2 + i (i the integer part of its position),
+    // with one frame either side for the curve
+    const int last = (int) (phase + (numSamples - 1) * step);
+    const int needed = last + 4;
+    if (needed > window.getNumSamples()) return false;
+    const int toRead = needed - windowFrames;
+    if (toRead > fifo.getNumReady()) return false;
+    if (toRead > 0) {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(toRead, start1, size1, start2, size2);
+        for (int ch = 0; ch < 2; ++ch) {
+            if (size1 > 0) window.copyFrom(ch, windowFrames, fifoBuffer, ch, start1, size1);
+            if (size2 > 0) window.copyFrom(ch, windowFrames + size1, fifoBuffer, ch, start2, size2);
+        }
+        fifo.finishedRead(size1 + size2);
+        windowFrames = needed;
+    }
+
+    for (int ch = 0; ch < std::min(2, numOutputChannels); ++ch) {
+        float* dest = out[ch];
+        if (dest == nullptr) continue;
+        dest += offset;
+        const float* x = window.getReadPointer(ch);
+        double position = phase;
+        for (int j = 0; j < numSamples; ++j) {
+            const int i = (int) position;
+            dest[j] = hermite(x[i], x[i + 1], x[i + 2], x[i + 3], (float) (position - i));
+            position += step;
+        }
+    }
+
+    // Keep the frames the next chunk still interpolates over at the front
+    const double end = phase + numSamples * step;
+    const int advance = std::min((int) end, windowFrames);
+    phase = end - advance;
+    windowFrames -= advance;
+    for (int ch = 0; ch < 2; ++ch) {
+        float* x = window.getWritePointer(ch);
+        std::copy(x + advance, x + advance + windowFrames, x);
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+class CallbackProfiler;
+
+/**
+ * The headphone cue bus on a second audio device, e.g. the laptop jack while the master goes
+ * out through the mixer's USB interface.
+ *
+ * The two devices run on their own clocks, so the cue bus crosses over through a FIFO and an
+ * adaptive resampler. DeckMixer hands each finished cue block to push(); the cue device's
+ * callback reads it back at its own rate, stepping through the master's samples by the ratio of
+ * the two clocks (4-point Hermite interpolation). That ratio comes from timestamps: each side
+ * runs a delay-locked loop over its callback start times and frame counts (ClockBandwidthHz),
+ * which gives the device's real rate against the host clock with the scheduling jitter filtered
+ * out. On top, a slow proportional term pulls the FIFO's average fill back to the target
+ * (one master block, one cue block and MarginMs) so the cue delay stays where it started. The
+ * correction is limited to MaxCorrection; a real drift is a few tens of ppm.
+ *
+ * If the FIFO runs dry (the master stopped, or too small a margin) the cue output goes silent
+ * and waits for the target fill again; a backlog (the cue device stalled) is dropped at once.
+ * Both count in getStatus(). Each cue callback's time, interpolation included, goes to the
+ * CallbackProfiler's cue slot.
+ *
+ * open() and close() run on the UI thread while the master plays; push() is skipped while
+ * nothing is open, with the same handshake as MasterRecorder.
+ */
+class CueOutputDevice : private juce::AudioIODeviceCallback {
+public:
+    static constexpr int FifoFrames = 1 << 15;
+    static constexpr double ClockBandwidthHz = 0.1;
+    static constexpr double MarginMs = 3.0;
+    // Time constant of the fill correction
+    static constexpr double SettleSeconds = 8.0;
+    static constexpr double MaxCorrection = 0.002;
+
+    struct Status {
+        bool running{false};
+        juce::String deviceName;
+        double sampleRate{0.0};
+        double driftPpm{0.0};      // the cue device's clock against the master's
+        double bufferedMs{0.0};    // average FIFO fill, in master time
+        juce::int64 underruns{0};
+        juce::int64 overruns{0};   // blocks the master couldn't hand over or that were dropped
+    };
+
+    CueOutputDevice();
+    ~CueOutputDevice() override;
+
+    // Where the cue callback's timing goes (not owned; set before open())
+    void setProfiler(CallbackProfiler* target) { profiler = target; }
+
+    // UI thread. `deviceName` as AudioDeviceConfig lists it ("Type: Device"). Opens the device's
+    // first two outputs at the master's rate if it offers it, else at the nearest; an empty
+    // string on success, the error otherwise.
+    juce::String open(juce::AudioDeviceManager& manager, const juce::String& deviceName,
+                      double masterRate, int masterBlock, int bufferSize);
+    void close();
+    bool isOpen() const { return armed.load(); }
+    Status getStatus() const;
+
+    // Master's audio callback: the finished cue bus, stereo, and when that callback started
+    void push(const float* const* cue, int numSamples, juce::int64 callbackStartTicks) noexcept;
+
+private:
+    // The rate a device really plays at, from when its callbacks start and how many frames each
+    // asks for: a second-order DLL (F. Adriaensen, "Using a DLL to filter time")
+    class ClockFilter {
+    public:
+        void reset(double nominalRate) noexcept;
+        void update(double seconds, int frames) noexcept;
+        double getRate() const noexcept { return 1.0 / secondsPerFrame; }
+
+    private:
+        double nominalSecondsPerFrame{1.0 / 44100.0};
+        double secondsPerFrame{1.0 / 44100.0};
+        double expected{0.0};   // predicted start of the next callback
+        bool started{false};
+    };
+
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                          float* const* outputChannelData, int numOutputChannels, int numSamples,
+                                          const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+    // Cue thread: numSamples (at most maxChunk) frames into `out` from `offset`, stepping `step`
+    // master frames per frame; false if the FIFO ran dry
+    bool resample(float* const* out, int numOutputChannels, int offset, int numSamples, double step) noexcept;
+
+    std::unique_ptr<juce::AudioIODevice> device;
+    CallbackProfiler* profiler{nullptr};
+    double secondsPerTick{0.0};
+    double masterNominalRate{44100.0};
+    double cueNominalRate{44100.0};
+    int targetFill{0};
+
+    juce::AbstractFifo fifo{FifoFrames};
+    juce::AudioBuffer<float> fifoBuffer;
+
+    // Master side
+    std::atomic<bool> armed{false};
+    std::atomic<bool> masterInside{false};
+    ClockFilter masterClock;
+    std::atomic<double> masterRate{44100.0};
+
+    // Cue side
+    ClockFilter cueClock;
+    juce::AudioBuffer<float> window;   // master frames being interpolated, one before the read position
+    int windowFrames{0};
+    int maxChunk{0};
+    double phase{0.0};                 // read position, from window frame 1
+    double averageFill{0.0};
+    bool primed{false};
+
+    std::atomic<double> driftPpm{0.0};
+    std::atomic<double> bufferedMs{0.0};
+    std::atomic<juce::int64> underruns{0};
+    std::atomic<juce::int64> overruns{0};
+};
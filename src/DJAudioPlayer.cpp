@@ -1,6 +1,13 @@
     // Copied from project root
 #include "DJAudioPlayer.h"
-#include <QDebug>
+#include "RealtimeAllocGuard.h"
+#include "RtTrace.h"
+#include "InMemoryTrackReader.h"
+#include "MappedTrackReader.h"
+#include "DeckMixer.h"
+#include "FlightRecorder.h"
+#include "PluginInsert.h"
+#include <algorithm>
 #include <cmath>
 
 #ifndef M_PI
@@ -8,28 +15,35 @@
 #endif
 
 DJAudioPlayer::DJAudioPlayer(AudioFormatManager &_formatManager) : formatManager(_formatManager) {
-    // Initialize with safe defaults
-    transportSource.setGain(1.0f);
+    // Initialize with safe defaults: an empty track until the first load
+    track = std::make_unique<LoadedTrack>();
+    rtTrack = track.get();
+    slicer.setInput(&rtTrack->transport, rtTrack->ramReader);
+    resampleSource.setInput(&slicer);
     resampleSource.setResamplingRatio(1.0);
     currentSpeed = 1.0;
     pitchShiftRatio = 1.0;
+    for (int i = 0; i < DeckEffectRack::NumEffects; ++i)
+        effectSettings[(size_t) i] = DeckEffectRack::getDefaultSettings(i);
 }
 
 DJAudioPlayer::~DJAudioPlayer() {
     // Safe destruction sequence to avoid segfaults
     try {
         // 1. Stop transport first
-        transportSource.stop();
+        track->transport.stop();
         
-        // 2. Disconnect transport source to prevent callbacks during destruction
-        transportSource.setSource(nullptr);
-        
-        // 3. Release resources in correct order
+        // 2. Release resources in correct order
         resampleSource.releaseResources();
-        transportSource.releaseResources();
+        track->transport.releaseResources();
         
-        // 4. Clear reader source
-        readerSource.reset();
+        // 3. Free the tracks; each disconnects its transport, then drops the read-ahead stage
+        //    and the reader source it reads from
+        pendingTrack.store(nullptr);
+        retiredTracks.clear();
+        track.reset();
+        // Whatever this deck retired earlier goes before the read-ahead thread it refers to
+        RealtimeReclaimer::getInstance().flush();
         
 #if defined(RUBBERBAND_FOUND)
     rb.reset();
@@ -44,44 +58,58 @@ DJAudioPlayer::~DJAudioPlayer() {
 
 void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
     std::cout << "DJAudioPlayer::prepareToPlay called with " << samplesPerBlockExpected << " samples, " << sampleRate << "Hz" << std::endl;
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // No callback is running: a track applied before the device started is taken over here
+    pickUpPendingTrack();
+    // A device move at the same rate keeps the DSP state (EQ, effect tails, the keylock stretcher
+    // and what it holds); a new rate starts them over, a new block size only the effect lines
+    const bool sameRate = dspPrepared && sampleRate == currentSampleRate;
+    const bool sameBlock = dspPrepared && std::max(1, samplesPerBlockExpected) == preparedBlockSize;
+    rtTrack->transport.prepareToPlay(samplesPerBlockExpected, sampleRate);
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     currentSampleRate = sampleRate;
-    
-    // PERFORMANCE: Initialize audio buffer pool for better memory management with multiple songs
-    for (auto& buffer : audioBufferPool) {
-        buffer = std::make_unique<AudioBuffer<float>>(2, samplesPerBlockExpected * 2); // Double buffer for safety
-        buffer->clear(); // Initialize to silence
+    secondsPerFrame = 1.0 / sampleRate;
+    {
+        std::lock_guard<std::mutex> guard(setupLock);
+        setup.sampleRate = sampleRate;
+        setup.blockSize = samplesPerBlockExpected;
     }
     
     lastBlockSizeHint = samplesPerBlockExpected;
+    preparedBlockSize = std::max(1, samplesPerBlockExpected);
     
-    // Prepare DSP filters for maximum possible channels (up to stereo)
-    juce::dsp::ProcessSpec spec{ sampleRate, (uint32) samplesPerBlockExpected, 2 };
-    lowShelf.reset(); lowShelf.prepare(spec);
-    midPeak.reset(); midPeak.prepare(spec);
-    highShelf.reset(); highShelf.prepare(spec);
-    svf.reset(); svf.prepare(spec);
-
-    std::cout << "DSP filters prepared for max " << spec.numChannels << " channels, audio pool initialized" << std::endl;
-
-    // Pre-calculate and cache neutral coefficients for performance
-    cachedLowCoeffs = juce::dsp::IIR::Coefficients<float>::makeLowShelf(currentSampleRate, 250.0f, 0.707f, 1.0f);
-    cachedMidCoeffs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(currentSampleRate, 2500.0f, 1.0f, 1.0f);
-    cachedHighCoeffs = juce::dsp::IIR::Coefficients<float>::makeHighShelf(currentSampleRate, 10000.0f, 0.707f, 1.0f);
-    
-    lowShelf.coefficients = cachedLowCoeffs;
-    midPeak.coefficients = cachedMidCoeffs;
-    highShelf.coefficients = cachedHighCoeffs;
-
-    // Initialize SVF for optimal performance
-    svf.setCutoffFrequency(1000.0f);
-    svf.setResonance(0.7f);
+    // Prepare the EQ/filter kernel for the device rate (up to stereo)
+    if (!sameRate) {
+        eq.prepare(sampleRate);
+        eq.setTargets(rt.highGain, rt.midGain, rt.lowGain, rt.filterKnob);
+        eq.reset();
+    }
+    // Effect delay lines are sized here for their longest times
+    if (!sameRate || !sameBlock) effects.prepare(sampleRate, samplesPerBlockExpected);
+    if (pluginInsertOwner) pluginInsertOwner->prepare(sampleRate, samplesPerBlockExpected);
+    // Scratch ring and trajectory (2 channels: mono tracks come out of the transport doubled)
+    scratchInput.prepare(sampleRate);
+    scratchWindow.setSize(2, ScratchWindowFrames);
+    scratchPull.setSize(2, ScratchPullFrames);
+    scratchFade.setSize(2, ScratchFadeFrames);
+    scratchFadePos = ScratchFadeFrames;
+    scratchWindowValid = false;
+    loopWrapFrames = std::max(LoopWrapMaxCrossfade * 2, preparedBlockSize);
+    loopWrapEnd.setSize(LoopWrapChannels, loopWrapFrames);
+    loopWrapStart.setSize(LoopWrapChannels, loopWrapFrames);
+    loopWrapPreJump.setSize(LoopWrapChannels, LoopWrapPreJumpFrames);
+
+    std::cout << "DSP filters prepared (fused EQ, " << DeckEqProcessor::SubBlockSize
+              << "-sample smoothing, effect rack)" << std::endl;
 
     dspPrepared = true;
     std::cout << "Enhanced DSP initialization complete with memory optimizations" << std::endl;
 
 #if defined(RUBBERBAND_FOUND)
+    if (sameRate && rb && rbNumChannels == rtTrack->numChannels) {
+        // Same stretcher, only its scratch follows the new block size
+        if (!sameBlock) prepareRubberBandScratch();
+        return;
+    }
     // Initialize RubberBand for keylock functionality
     reinitRubberBand();
     std::cout << "RubberBand keylock initialized successfully" << std::endl;
@@ -93,52 +121,385 @@ void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate
     keylockPrimeSamplesRemaining = (int) std::ceil((keylockPrimeMs / 1000.0) * currentSampleRate);
 }
 
-void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
-    if (readerSource.get() == nullptr) {
-        bufferToFill.clearActiveBufferRegion();
-        return;
+void DJAudioPlayer::postCommand(Command::Type type, double value, double value2) {
+    Command cmd;
+    cmd.type = type;
+    cmd.value = value;
+    cmd.value2 = value2;
+    cmd.postedNs = DeckMixer::nowNs();
+    if (!commandQueue.push(cmd)) {
+        std::cout << "DJAudioPlayer: command queue full, dropping command " << (int)type << std::endl;
     }
-    lastBlockSizeHint = bufferToFill.numSamples;
-    
-    // DEBUG: Check if we're being called and if transport is playing
-    static int debugCallCount = 0;
-    if (debugCallCount++ % 1000 == 0) {
-        std::cout << "[DJAP] getNextAudioBlock called #" << debugCallCount 
-                  << ", transport playing: " << transportSource.isPlaying() 
-                  << ", soft paused: " << softPaused.load() << std::endl;
-    }
-
-    // Apply deferred keylock toggle on the audio thread for thread safety
-    int pendingKL = keylockChangePending.exchange(-1);
-    if (pendingKL != -1) {
-        const bool enable = (pendingKL == 1);
-        keylockEnabled = enable;
-        if (debugKeylock) {
-            std::cout << "[KL] Toggle: " << (enable ? "ON" : "OFF") << ", SR=" << currentSampleRate
-                      << ", lastBlockSizeHint=" << lastBlockSizeHint << std::endl;
+    FlightRecorder::control(automationDeck, getCommandName(type), value, value2);
+    if (automation != nullptr)
+        automation->record(automationDeck, MixAutomation::Kind::DeckCommand, value, value2, (int) type);
+}
+
+bool DJAudioPlayer::postControllerCommand(Command::Type type, double value, double value2) noexcept {
+    Command cmd;
+    cmd.type = type;
+    cmd.value = value;
+    cmd.value2 = value2;
+    cmd.postedNs = DeckMixer::nowNs();
+    FlightRecorder::control(automationDeck, getCommandName(type), value, value2);
+    return controllerQueue.push(cmd);
+}
+
+const char* DJAudioPlayer::getCommandName(Command::Type type) noexcept {
+    // In Command::Type order
+    static constexpr const char* names[] = {
+        "SetSpeed", "Seek", "SeekPreroll", "SetLoop", "ClearLoop", "SetHighGain", "SetMidGain",
+        "SetLowGain", "SetFilter", "SetKeylock", "SetScratchVelocity", "EnableScratch",
+        "ResetAfterPause", "CancelPausedReset", "SetSlip", "SlipHold", "SetBeatInfo",
+        "SetEffectEnabled", "SetEffectMix", "SetEffectAmount", "SetEffectBeats", "QuantizedSeek",
+        "BeatJump", "SetTrimGain", "SetKeyShift", "Brake", "Spinback", "Censor",
+        "SetStemGain", "Slice"
+    };
+    static_assert(std::size(names) == (size_t) Command::Type::Slice + 1, "command names are out of date");
+    const auto index = (size_t) type;
+    return index < std::size(names) ? names[index] : "?";
+}
+
+bool DJAudioPlayer::isTimedCommand(Command::Type type) noexcept {
+    switch (type) {
+        case Command::Type::SetSpeed:
+        case Command::Type::SetHighGain:
+        case Command::Type::SetMidGain:
+        case Command::Type::SetLowGain:
+        case Command::Type::SetFilter:
+        case Command::Type::SetTrimGain:
+        case Command::Type::SetStemGain:
+        case Command::Type::SetScratchVelocity:
+        case Command::Type::SetEffectMix:
+        case Command::Type::SetEffectAmount:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void DJAudioPlayer::takePendingCommands(int numSamples) {
+    rtCommandCount = 0;
+    rtCommandNext = 0;
+    const bool timed = timedCommands.load(std::memory_order_relaxed) && lastBlockStartNs > 0 && currentSampleRate > 0.0;
+    const int lastSlot = std::max(0, numSamples - 1) / ControlBlockSamples * ControlBlockSamples;
+    Command cmd;
+    while (rtCommandCount < (int) rtCommands.size() && (commandQueue.pop(cmd) || controllerQueue.pop(cmd))) {
+        int at = 0;
+        if (timed && isTimedCommand(cmd.type) && cmd.postedNs > lastBlockStartNs) {
+            const double offset = (double) (cmd.postedNs - lastBlockStartNs) * currentSampleRate * 1.0e-9;
+            at = std::min(lastSlot, (int) std::min<double>(numSamples, offset) / ControlBlockSamples * ControlBlockSamples);
         }
-        if (enable) {
-            resampleSource.setResamplingRatio(1.0);
-#if defined(RUBBERBAND_FOUND)
-            // Start RubberBand when keylock is enabled - it will run CONTINUOUSLY until disabled
-            if (!rbReady) {
-                rbReady = true;
-                rbPaddedStartDone = false;
-                rbDiscardOutRemaining = 0;
-                keylockPrimeSamplesRemaining = (int) std::ceil((keylockPrimeMs / 1000.0) * currentSampleRate);
-                if (debugKeylock) std::cout << "[KL] RB started for CONTINUOUS mode" << std::endl;
+        // In order of where they apply; the queues' own order among equals (few per block)
+        int i = rtCommandCount++;
+        for (; i > 0 && rtCommands[(size_t) i - 1].atSample > at; --i) rtCommands[(size_t) i] = rtCommands[(size_t) i - 1];
+        rtCommands[(size_t) i] = { cmd, at };
+    }
+}
+
+void DJAudioPlayer::applyDueCommands(int sample) {
+    if (rtCommandNext >= rtCommandCount || rtCommands[(size_t) rtCommandNext].atSample > sample) return;
+    // SLIP: an excursion starting in this batch returns to where the deck was before any seek in it
+    const double positionBeforeCommands = frameSeconds(timelineFrame());
+    while (rtCommandNext < rtCommandCount && rtCommands[(size_t) rtCommandNext].atSample <= sample)
+        applyCommand(rtCommands[(size_t) rtCommandNext++].command);
+    updateSlipExcursion(positionBeforeCommands);
+}
+
+void DJAudioPlayer::applyCommand(const Command& cmd) {
+    switch (cmd.type) {
+        case Command::Type::SetSpeed:
+            rt.speed = cmd.value;
+            // KEYLOCK / KEY SHIFT: resampler stays at unity, RubberBand changes tempo
+            resampleSource.setResamplingRatio(stretcherEngaged() ? 1.0 : playbackRatio());
+            break;
+        case Command::Type::Seek:
+            leavePreroll();
+            rt.pendingSeekSec = -1.0;
+            rtTrack->transport.setPosition(cmd.value);
+            break;
+        case Command::Type::QuantizedSeek:
+            // Fired from getNextAudioBlock once the transport reaches the next beat
+            rt.pendingSeekSec = cmd.value;
+            break;
+        case Command::Type::BeatJump: {
+            const auto grid = getBeatGrid();
+            const double target = beatJumpTarget(grid.get(), rt.beatBpm, frameSeconds(timelineFrame()), cmd.value);
+            leavePreroll();
+            rtTrack->transport.setPosition(std::clamp(target, 0.0, rtTrack->transport.getLengthInSeconds()));
+            break;
+        }
+        case Command::Type::SeekPreroll:
+            // In preroll area - transport waits at 0 while we count in from the negative offset
+            rt.pendingSeekSec = -1.0;
+            rtTrack->transport.setPosition(0.0);
+            enterPreroll(cmd.value * prerollTimeSec);
+            break;
+        case Command::Type::SetLoop:
+            rt.loopStartSec = cmd.value;
+            rt.loopEndSec = cmd.value2;
+            rt.loopEnabled = (rt.loopEndSec > rt.loopStartSec);
+            break;
+        case Command::Type::ClearLoop:
+            rt.loopEnabled = false;
+            rt.loopStartSec = 0.0;
+            rt.loopEndSec = 0.0;
+            break;
+        case Command::Type::SetHighGain: rt.highGain = cmd.value; break;
+        case Command::Type::SetMidGain: rt.midGain = cmd.value; break;
+        case Command::Type::SetLowGain: rt.lowGain = cmd.value; break;
+        case Command::Type::SetFilter: rt.filterKnob = cmd.value; break;
+        case Command::Type::SetTrimGain: rt.trimGain = cmd.value; break;
+        case Command::Type::SetStemGain: {
+            const int stem = (int) cmd.value;
+            if (stem < 0 || stem >= StemTrackReader::NumStems) break;
+            rt.stemGains[(size_t) stem] = (float) cmd.value2;
+            if (rtTrack->stemReader != nullptr) rtTrack->stemReader->setStemGain(stem, (float) cmd.value2);
+            break;
+        }
+        case Command::Type::SetScratchVelocity: rt.scratchVelocity = cmd.value; break;
+        case Command::Type::EnableScratch: {
+            const bool enable = (cmd.value != 0.0);
+            if (enable == rt.scratchMode) break;
+            if (enable) {
+                // The record starts where it is heard; a preroll count-in goes on as negative track time
+                const bool inMotion = rt.motion.kind != Motion::None;
+                const double startSec = inMotion ? rt.motion.positionSec : audiblePositionSeconds();
+                // A running deck fades from carrying on at its tempo (or a brake, spinback or
+                // censor at its own speed) into the hand
+                const bool running = !inPrerollMode && rtTrack->transport.isPlaying() && !softPaused.load()
+                                     && !rt.motion.parked;
+                const double entryVelocity = inMotion ? rt.motion.velocity : playbackRatio();
+                rt.motion = {};
+                rt.motionPending = false;
+                motionRunning.store(false);
+                leavePreroll();
+                scratchInput.start(startSec, DeckMixer::nowNs());
+                scratchWindowValid = false;
+                timecodeRelative = false;
+                scratchFadeOnEntry = running;
+                scratchEntrySec = startSec;
+                scratchEntryVelocity = entryVelocity;
+                slicer.reset();
+                rt.scratchMode = true;
+            } else {
+                rt.scratchMode = false;
+                endScratch();
+            }
+            break;
+        }
+        case Command::Type::ResetAfterPause:
+            rt.pausedResetPending = true;
+            // Paused (or scratched) mid-motion: the deck stays where the motion had it
+            if (rt.motion.kind != Motion::None) endMotion(rt.motion.positionSec);
+            break;
+        case Command::Type::CancelPausedReset: rt.pausedResetPending = false; break;
+        case Command::Type::SetSlip: rt.slipEnabled = (cmd.value != 0.0); break;
+        case Command::Type::SlipHold: rt.slipHold = (cmd.value != 0.0); break;
+        case Command::Type::SetBeatInfo:
+            rt.beatBpm = cmd.value;
+            rt.firstBeatSec = cmd.value2;
+            break;
+        case Command::Type::SetEffectEnabled: effects.setEnabled((int) cmd.value, cmd.value2 != 0.0); break;
+        case Command::Type::SetEffectMix: effects.setMix((int) cmd.value, (float) cmd.value2); break;
+        case Command::Type::SetEffectAmount: effects.setAmount((int) cmd.value, (float) cmd.value2); break;
+        case Command::Type::SetEffectBeats: effects.setBeats((int) cmd.value, cmd.value2); break;
+        case Command::Type::SetKeylock:
+        case Command::Type::SetKeyShift: {
+            const bool wasEngaged = stretcherEngaged();
+            if (cmd.type == Command::Type::SetKeylock) rt.keylockEnabled = (cmd.value != 0.0);
+            else rt.keyShift = cmd.value;
+            if (debugKeylock)
+                RT_TRACE_DEBUG("[KL] Toggle: on={}, shift={}, SR={}, lastBlockSizeHint={}",
+                               rt.keylockEnabled, rt.keyShift, currentSampleRate, lastBlockSizeHint);
+            if (stretcherEngaged() != wasEngaged) engageStretcher(!wasEngaged);
+            break;
+        }
+        case Command::Type::Brake:
+        case Command::Type::Spinback:
+        case Command::Type::Censor:
+            // Started from getNextAudioBlock at the trigger's own place in the block
+            rt.pendingMotion = cmd;
+            rt.motionPending = true;
+            break;
+        case Command::Type::Slice: {
+            if (cmd.value < 0.0) {
+                slicer.release();
+                break;
             }
+            const auto grid = getBeatGrid();
+            if (grid == nullptr || offTimeline() || !slicer.canSlice(currentSampleRate)) break;
+            // The eight beats the playhead is in; a quantized slice leaves on the next beat
+            const double beat = grid->getBeatPositionAtTime(frameSeconds(timelineFrame()));
+            const double first = std::floor(beat / DeckSlicer::NumSlices) * DeckSlicer::NumSlices + std::floor(cmd.value);
+            const auto frameAt = [&](double b) { return secondsFrame(grid->getTimeAtBeat(b)); };
+            slicer.trigger(frameAt(first), frameAt(first + 1.0), cmd.value2 != 0.0 ? frameAt(std::ceil(beat)) : -1);
+            break;
+        }
+    }
+}
+
+void DJAudioPlayer::engageStretcher(bool engage) {
+    if (engage) {
+        resampleSource.setResamplingRatio(1.0);
+#if defined(RUBBERBAND_FOUND)
+        // Start RubberBand when keylock or a key shift is on - it will run CONTINUOUSLY until both are off
+        if (!rbReady) {
+            rbReady = true;
+            rbPaddedStartDone = false;
+            rbDiscardOutRemaining = 0;
+            keylockPrimeSamplesRemaining = (int) std::ceil((keylockPrimeMs / 1000.0) * currentSampleRate);
+            if (debugKeylock) RT_TRACE_DEBUG("[KL] RB started for CONTINUOUS mode");
+        }
 #endif
-        } else {
-            resampleSource.setResamplingRatio(currentSpeed);
+    } else {
+        resampleSource.setResamplingRatio(playbackRatio());
 #if defined(RUBBERBAND_FOUND)
-            // Stop RB completely when keylock is disabled
-            rbReady = false;
-            if (debugKeylock) {
-                std::cout << "[KL] RB stopped - keylock disabled" << std::endl;
-            }
+        // Stop RB completely: plain resampling costs nothing extra
+        rbReady = false;
+        if (debugKeylock) RT_TRACE_DEBUG("[KL] RB stopped - keylock and key shift off");
 #endif
+    }
+}
+
+void DJAudioPlayer::updateSlipExcursion(double positionBeforeCommands) {
+    const bool wanted = rt.slipEnabled && (rt.scratchMode || rt.loopEnabled || rt.slipHold);
+    if (wanted == rt.slipActive) return;
+
+    if (wanted) {
+        // Only a running deck has a timeline to slip along
+        if (!rtTrack->transport.isPlaying() || softPaused.load() || inPrerollMode) return;
+        rt.slipActive = true;
+        rt.slipPosSec = positionBeforeCommands;
+    } else {
+        rt.slipActive = false;
+        // Disabling slip mode mid-excursion keeps the current position, like releasing without slip
+        if (rt.slipEnabled)
+            rtTrack->transport.setPosition(std::min(rt.slipPosSec, rtTrack->transport.getLengthInSeconds()));
+    }
+    slipPositionSec.store(rt.slipPosSec, std::memory_order_relaxed);
+    slipActive.store(rt.slipActive, std::memory_order_relaxed);
+}
+
+void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) {
+    // Timecode positions belong to this block alone
+    const juce::ScopeGuard dropTimecode{ [this] { timecodeBlock = nullptr; } };
+    const juce::uint64 blockStartNs = DeckMixer::nowNs();
+    // A newly loaded track first, so the commands posted after the load apply to it
+    pickUpPendingTrack();
+    renderedAudio = false;
+    const int numSamples = bufferToFill.numSamples;
+    // Control changes posted since the last block: the discrete ones now, the continuous ones
+    // at their sub-block below
+    takePendingCommands(numSamples);
+    applyDueCommands(0);
+    if (rtTrack->readerSource != nullptr) lastBlockSizeHint = bufferToFill.numSamples;
+
+    if (rt.motionPending) {
+        // A motion trigger lands as far into this block as it came after the last one began:
+        // a constant block of latency instead of the jitter of when the command was picked up
+        const juce::uint64 triggerNs = (juce::uint64) rt.pendingMotion.value2;
+        const double offset = triggerNs > lastBlockStartNs && currentSampleRate > 0.0
+                                  ? (double) (triggerNs - lastBlockStartNs) * currentSampleRate * 1.0e-9 : 0.0;
+        rt.motionAtSample = (int) std::min<double>(std::max(0, numSamples - 1), offset);
+    }
+    lastBlockStartNs = blockStartNs;
+
+    const bool commandsDue = rtCommandNext < rtCommandCount;
+    const bool countInEnds = inPrerollMode && rtTrack->transport.isPlaying() && rt.prerollFrame + numSamples > 0;
+    if (rt.pendingSeekSec < 0.0 && !rt.motionPending && rt.armedStartAt < 0 && !commandsDue && !countInEnds) {
+        renderBlock(bufferToFill);
+        return;
+    }
+    // QUANTIZE / MOTION / ARMED START / CONTROLS / PREROLL: render up to the beat, the trigger,
+    // the next command or the count-in's frame 0, act on it, render the rest
+    AudioSourceChannelInfo part(bufferToFill);
+    for (int done = 0; done < numSamples; ) {
+        const int remaining = numSamples - done;
+        const int seekAt = rt.pendingSeekSec >= 0.0 ? samplesUntilQuantizedSeek(remaining) : remaining;
+        const int motionAt = rt.motionPending ? juce::jlimit(0, remaining, rt.motionAtSample - done) : remaining;
+        const int startAt = rt.armedStartAt >= 0 ? juce::jlimit(0, remaining, rt.armedStartAt - done) : remaining;
+        const int commandAt = rtCommandNext < rtCommandCount
+                                  ? juce::jlimit(0, remaining, rtCommands[(size_t) rtCommandNext].atSample - done) : remaining;
+        const int prerollAt = inPrerollMode && rtTrack->transport.isPlaying()
+                                  ? (int) juce::jlimit<juce::int64>(0, remaining, -rt.prerollFrame) : remaining;
+        const int split = std::min({ seekAt, motionAt, startAt, commandAt, prerollAt });
+        if (split > 0) {
+            part.startSample = bufferToFill.startSample + done;
+            part.numSamples = split;
+            renderBlock(part);
+            done += split;
+        }
+        if (rt.armedStartAt >= 0 && startAt == split) {
+            // The silent part was rendered soft-paused; the rest plays (unless stop() disarmed it)
+            rt.armedStartAt = -1;
+            if (armed.exchange(false)) {
+                rt.pausedResetPending = false;
+                softPaused.store(false);
+            }
+        } else if (rt.motionPending && motionAt == split) {
+            rt.motionPending = false;
+            applyPendingMotion();
+        } else if (rt.pendingSeekSec >= 0.0 && seekAt == split && split < remaining) {
+            fireQuantizedSeek();
         }
+        if (commandAt == split) applyDueCommands(done);
+    }
+}
+
+DJAudioPlayer::StageTicks DJAudioPlayer::takeStageTicks() noexcept {
+    StageTicks ticks;
+    ticks.decode = resampleSource.takeInputTicks();
+    ticks.eq = eqTicks;
+    eqTicks = 0;
+    return ticks;
+}
+
+int DJAudioPlayer::samplesUntilQuantizedSeek(int numSamples) {
+    rt.pendingFireFrame = -1;
+    const auto grid = getBeatGrid();
+    // Nothing to wait for on a deck that isn't running along its timeline
+    if (!grid || rtTrack->readerSource == nullptr || !rtTrack->transport.isPlaying() || softPaused.load() || inPrerollMode
+        || offTimeline() || currentSampleRate <= 0.0 || playbackRatio() <= 0.0)
+        return 0;
+
+    const juce::int64 frame = timelineFrame();
+    rt.pendingFireFrame = secondsFrame(grid->getTimeAtBeat(std::ceil(grid->getBeatPositionAtTime(frameSeconds(frame)) - 1.0e-9)));
+    const double samples = (double) (rt.pendingFireFrame - frame) / playbackRatio();
+    return (int) juce::jlimit<juce::int64>(0, numSamples, std::llround(samples));
+}
+
+void DJAudioPlayer::fireQuantizedSeek() {
+    // Whatever the first part of the block read past the beat (resampler chunking) is carried
+    // over, so the landing keeps the grid phase exactly
+    const juce::int64 overshoot = rt.pendingFireFrame >= 0 ? timelineFrame() - rt.pendingFireFrame : 0;
+    const juce::int64 target = std::clamp<juce::int64>(secondsFrame(rt.pendingSeekSec) + overshoot, 0,
+                                                       rtTrack->transport.getTotalLength());
+    leavePreroll();
+    rtTrack->transport.setNextReadPosition(target);
+    rt.pendingSeekSec = -1.0;
+    rt.pendingFireFrame = -1;
+}
+
+double DJAudioPlayer::beatJumpTarget(const BeatGrid* grid, double bpm, double fromSec, double beats) {
+    if (grid) return grid->getTimeAtBeat(grid->getBeatPositionAtTime(fromSec) + beats);
+    return bpm > 0.0 ? fromSec + beats * 60.0 / bpm : fromSec;
+}
+
+void DJAudioPlayer::renderBlock(const AudioSourceChannelInfo &bufferToFill) {
+    // A scratch fade belongs to the block right after the switch: paths that return before it
+    // is mixed (silence, preroll, loop wraps) drop it
+    const int fadeAtEntry = scratchFadePos;
+    const juce::ScopeGuard dropFade{ [this, fadeAtEntry] { if (scratchFadePos == fadeAtEntry) scratchFadePos = ScratchFadeFrames; } };
+    if (rtTrack->readerSource.get() == nullptr) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+    
+    // DEBUG: Check if we're being called and if transport is playing
+    if (traceCounters.calls++ % 1000 == 0) {
+        RT_TRACE_DEBUG("[DJAP] getNextAudioBlock called #{}, transport playing: {}, soft paused: {}",
+                       traceCounters.calls, rtTrack->transport.isPlaying(), softPaused.load());
     }
 
     // Immediate silence requested (e.g., right after stop) or soft-paused (keep transport running)
@@ -147,51 +508,41 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
         return;
     }
 
-    // PREROLL AUDIO HANDLING: If in preroll mode and playing, count toward track start
-    if (inPrerollMode && transportSource.isPlaying()) {
-        // Calculate how much time to advance based on sample rate and buffer size
-        double timeAdvance = double(bufferToFill.numSamples) / currentSampleRate;
-        double currentPrerollTime = prerollPosition * prerollTimeSec; // Convert to seconds
-        currentPrerollTime += timeAdvance; // Advance forward in time
-        
-        if (currentPrerollTime >= -0.01) { // Start transition slightly before 0.0 for smoother handoff
-            // Close to track start - prepare for smooth transition
-            std::cout << "Preroll count-in complete - smooth transition to track" << std::endl;
-            inPrerollMode = false;
-            prerollPosition = 0.0;
-            transportSource.setPosition(0.0);
-            
-            // KEYLOCK FIX: Reset RubberBand state for clean transition
-#if defined(RUBBERBAND_FOUND)
-            if (keylockEnabled && rbReady) {
-                // Flush RubberBand to clear any internal state
-                rb->reset();
-                rbPaddedStartDone = false;
-                rbDiscardOutRemaining = 0;
-                keylockPrimeSamplesRemaining = (int) std::ceil((keylockPrimeMs / 1000.0) * currentSampleRate);
-                if (debugKeylock) std::cout << "[KL] RubberBand reset for clean preroll transition" << std::endl;
-            }
-#endif
-            // Continue to normal audio processing below for immediate audio start
-        } else {
-            // Still in preroll - output silence and update position smoothly
-            prerollPosition = currentPrerollTime / prerollTimeSec; // Convert back to relative
-            bufferToFill.clearActiveBufferRegion();
+    // PREROLL: the count-in is the timeline below frame 0 and runs in real time, whatever the
+    // tempo. It is silence counted in frames; the transport waits at 0 and getNextAudioBlock
+    // ends a part on frame 0, so the track starts on exactly the sample after it.
+    if (inPrerollMode && rtTrack->transport.isPlaying()) {
+        bufferToFill.clearActiveBufferRegion();
+        rt.prerollFrame += bufferToFill.numSamples;
+        if (rt.prerollFrame < 0) {
+            prerollPosition = frameSeconds(rt.prerollFrame) / prerollTimeSec;
             return;
         }
+        RT_TRACE_INFO("Preroll count-in complete - track starts with the next part");
+        leavePreroll();
+        // KEYLOCK FIX: Reset RubberBand state for clean transition
+#if defined(RUBBERBAND_FOUND)
+        if (stretcherEngaged() && rbReady) {
+            // Flush RubberBand to clear any internal state
+            rb->reset();
+            rbPaddedStartDone = false;
+            rbDiscardOutRemaining = 0;
+            keylockPrimeSamplesRemaining = (int) std::ceil((keylockPrimeMs / 1000.0) * currentSampleRate);
+            if (debugKeylock) RT_TRACE_DEBUG("[KL] RubberBand reset for clean preroll transition");
+        }
+#endif
+        return;
     } else if (inPrerollMode) {
         // Preroll mode but not playing - just output silence
         bufferToFill.clearActiveBufferRegion();
-        if (transportSource.getCurrentPosition() > 0.1) {
-            transportSource.setPosition(0.0);
-        }
         return;
     }
 
     // If paused/stopped, clear once and avoid repeated heavy resets every callback
-    if (!transportSource.isPlaying()) {
+    if (!rtTrack->transport.isPlaying()) {
         bufferToFill.clearActiveBufferRegion();
-        if (pausedResetPending.exchange(false)) {
+        if (rt.pausedResetPending) {
+            rt.pausedResetPending = false;
 #if defined(RUBBERBAND_FOUND)
             // Keep RB instance; just mark for a fresh start next time without heavy reset
             rbReady = true;
@@ -201,11 +552,23 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
         }
         return;
     }
+
+    renderedAudio = true;
+
+    // SLIP: shadow playhead runs at the deck tempo, whatever scratch/loop does to the real one
+    if (rt.slipActive) {
+        rt.slipPosSec = std::min(rt.slipPosSec + playbackRatio() * bufferToFill.numSamples / currentSampleRate,
+                                 rtTrack->transport.getLengthInSeconds());
+        slipPositionSec.store(rt.slipPosSec, std::memory_order_relaxed);
+    }
     
-    // Loop checking: Must be done every buffer for precise timing with click-free crossfade
-    if (loopEnabled) {
-        double pos = transportSource.getCurrentPosition();
-        double nextPos = pos + (double(bufferToFill.numSamples) / currentSampleRate);
+    // Loop checking: Must be done every buffer for precise timing with click-free crossfade.
+    // Loops cached by the read-ahead stage wrap there without a seek, so only uncached loops
+    // (too long, not ready yet, or streaming without read-ahead) take this path.
+    if (rt.loopEnabled && !offTimeline() && !(rtTrack->readAheadSource && rtTrack->readAheadSource->isLoopCached())) {
+        const juce::int64 frame = timelineFrame();
+        double pos = frameSeconds(frame);
+        double nextPos = frameSeconds(frame + bufferToFill.numSamples);
         
         // Handle active crossfade first
         if (loopCrossfadeActive) {
@@ -224,7 +587,7 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
             if (loopCrossfadePosition >= loopCrossfadeSamples) {
                 loopCrossfadeActive = false;
                 loopCrossfadePosition = 0;
-                qDebug() << "Loop crossfade completed";
+                RT_TRACE_DEBUG("Loop crossfade completed");
             }
             
             // Return - crossfade handles the entire buffer
@@ -232,41 +595,46 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
         }
         
         // Check if we will cross the loop end point in this buffer
-        if (pos < loopEndSec && nextPos >= loopEndSec && loopEndSec > loopStartSec) {
+        if (pos < rt.loopEndSec && nextPos >= rt.loopEndSec && rt.loopEndSec > rt.loopStartSec) {
             // Calculate how many samples until loop end
-            double timeToLoopEnd = loopEndSec - pos;
+            double timeToLoopEnd = rt.loopEndSec - pos;
             int samplesToLoopEnd = (int)(timeToLoopEnd * currentSampleRate);
             
             // Clamp to buffer boundaries
             samplesToLoopEnd = std::max(0, std::min(samplesToLoopEnd, bufferToFill.numSamples));
             
             // IMPROVED: Longer crossfade with better pre-buffering for ultra-smooth loops
-            const int crossfadeLength = std::min(1024, std::min(samplesToLoopEnd, bufferToFill.numSamples / 2));
+            const int crossfadeLength = std::min(LoopWrapMaxCrossfade, std::min(samplesToLoopEnd, bufferToFill.numSamples / 2));
+            const int wrapChannels = bufferToFill.buffer->getNumChannels();
+            const bool fitsWrapScratch = bufferToFill.numSamples <= loopWrapFrames && wrapChannels <= LoopWrapChannels;
             
-            if (crossfadeLength >= 16 && samplesToLoopEnd >= crossfadeLength) {
+            if (crossfadeLength >= 16 && samplesToLoopEnd >= crossfadeLength && fitsWrapScratch) {
                 // ADVANCED STRATEGY: Pre-buffer both end and start with overlap compensation
                 
                 // Step 1: Get the complete current buffer (end portion)
-                AudioBuffer<float> endBuffer(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
+                // Views into the preallocated scratch: no allocation on the audio thread
+                auto& endBuffer = loopWrapEnd;
+                endBuffer.setSize(wrapChannels, bufferToFill.numSamples, false, false, true);
                 AudioSourceChannelInfo endInfo;
                 endInfo.buffer = &endBuffer;
                 endInfo.startSample = 0;
                 endInfo.numSamples = bufferToFill.numSamples;
                 
-                if (keylockEnabled) {
+                if (stretcherEngaged()) {
                     resampleSource.setResamplingRatio(1.0);
                 } else {
-                    resampleSource.setResamplingRatio(currentSpeed);
+                    resampleSource.setResamplingRatio(playbackRatio());
                 }
                 resampleSource.getNextAudioBlock(endInfo);
                 
                 // Step 2: Store current position and jump to loop start
-                double currentPos = transportSource.getCurrentPosition();
-                transportSource.setPosition(loopStartSec);
+                [[maybe_unused]] const double currentPos = rtTrack->transport.getCurrentPosition();
+                rtTrack->transport.setPosition(rt.loopStartSec);
                 
                 // Step 3: Get extended start portion for seamless crossfade
                 const int startBufferSize = std::max(crossfadeLength * 2, bufferToFill.numSamples);
-                AudioBuffer<float> startBuffer(bufferToFill.buffer->getNumChannels(), startBufferSize);
+                auto& startBuffer = loopWrapStart;
+                startBuffer.setSize(wrapChannels, startBufferSize, false, false, true);
                 AudioSourceChannelInfo startInfo;
                 startInfo.buffer = &startBuffer;
                 startInfo.startSample = 0;
@@ -320,36 +688,36 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
                     }
                 }
                 
-                qDebug() << "EQUAL-POWER crossfade applied: pos" << currentPos << "-> start" << loopStartSec
-                         << "crossfade:" << crossfadeLength << "samples, fadeStart:" << fadeStartIndex
-                         << "remainder:" << (bufferToFill.numSamples - (fadeStartIndex + crossfadeLength));
+                RT_TRACE_DEBUG("EQUAL-POWER crossfade applied: pos {} -> start {} crossfade: {} samples, fadeStart: {}",
+                               currentPos, rt.loopStartSec, crossfadeLength, fadeStartIndex);
                 
                 return; // Skip normal processing
             } else {
                 // For very short crossfades, use extended linear fade with pre-buffering
                 
                 // Get a small buffer before jumping to analyze waveform continuity
-                AudioBuffer<float> preJumpBuffer(bufferToFill.buffer->getNumChannels(), 32);
+                auto& preJumpBuffer = loopWrapPreJump;
+                preJumpBuffer.setSize(std::min(wrapChannels, LoopWrapChannels), LoopWrapPreJumpFrames, false, false, true);
                 AudioSourceChannelInfo preInfo;
                 preInfo.buffer = &preJumpBuffer;
                 preInfo.startSample = 0;
-                preInfo.numSamples = 32;
+                preInfo.numSamples = LoopWrapPreJumpFrames;
                 
-                if (keylockEnabled) {
+                if (stretcherEngaged()) {
                     resampleSource.setResamplingRatio(1.0);
                 } else {
-                    resampleSource.setResamplingRatio(currentSpeed);
+                    resampleSource.setResamplingRatio(playbackRatio());
                 }
                 resampleSource.getNextAudioBlock(preInfo);
                 
                 // Jump to loop start
-                transportSource.setPosition(loopStartSec);
+                rtTrack->transport.setPosition(rt.loopStartSec);
                 
                 // Get audio from new position with extended buffer
-                if (keylockEnabled) {
+                if (stretcherEngaged()) {
                     resampleSource.setResamplingRatio(1.0);
                 } else {
-                    resampleSource.setResamplingRatio(currentSpeed);
+                    resampleSource.setResamplingRatio(playbackRatio());
                 }
                 resampleSource.getNextAudioBlock(bufferToFill);
                 
@@ -357,7 +725,7 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
                 const int extendedFade = std::min(64, bufferToFill.numSamples / 2);
                 for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch) {
                     // Get last sample from pre-jump for continuity reference
-                    float lastSample = (preJumpBuffer.getNumSamples() > 0) ? 
+                    float lastSample = (ch < preJumpBuffer.getNumChannels() && preJumpBuffer.getNumSamples() > 0) ? 
                                       preJumpBuffer.getSample(ch, preJumpBuffer.getNumSamples() - 1) : 0.0f;
                     
                     for (int i = 0; i < extendedFade; ++i) {
@@ -378,21 +746,20 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
                     }
                 }
                 
-                qDebug() << "EXTENDED Hann fade-in applied: pos" << pos << "-> start" << loopStartSec 
-                         << "fadeLength:" << extendedFade;
+                RT_TRACE_DEBUG("EXTENDED Hann fade-in applied: pos {} -> start {} fadeLength: {}", pos, rt.loopStartSec, extendedFade);
                 return;
             }
         }
         // Fallback: if position is already past loop end, jump back with intelligent fade-in
-        else if (pos >= loopEndSec && loopEndSec > loopStartSec) {
-            transportSource.setPosition(loopStartSec);
-            qDebug() << "Late loop jump with intelligent fade-in: pos" << pos << "-> start" << loopStartSec;
+        else if (pos >= rt.loopEndSec && rt.loopEndSec > rt.loopStartSec) {
+            rtTrack->transport.setPosition(rt.loopStartSec);
+            RT_TRACE_DEBUG("Late loop jump with intelligent fade-in: pos {} -> start {}", pos, rt.loopStartSec);
             
             // Get audio and apply sophisticated fade-in to prevent any artifacts
-            if (keylockEnabled) {
+            if (stretcherEngaged()) {
                 resampleSource.setResamplingRatio(1.0);
             } else {
-                resampleSource.setResamplingRatio(currentSpeed);
+                resampleSource.setResamplingRatio(playbackRatio());
             }
             resampleSource.getNextAudioBlock(bufferToFill);
             
@@ -424,235 +791,70 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
         }
     }
     
+    if (rt.scratchMode) {
+        // Scratching plays the hand's path sample by sample; the pitch follows the motion, no keylock
+        renderScratch(bufferToFill);
+    } else if (rt.motion.kind != Motion::None) {
+        renderMotion(bufferToFill);
+    }
 #if defined(RUBBERBAND_FOUND)
-    // Use Rubber Band when available and ready (runs 24/7 once keylock was enabled once)
-    if (rbReady && rb) {
-        const bool isKeylockActive = keylockEnabled;
-        if (debugKeylock) std::cout << "[RB] Enter path: keylock=" << isKeylockActive 
-                                     << ", desiredOut=" << bufferToFill.numSamples
-                                     << ", chsOut=" << bufferToFill.buffer->getNumChannels() << std::endl;
+    // Use Rubber Band while keylock or a key shift needs it; otherwise the plain resampler below
+    // plays, and the EQ and effects run after either
+    else if (rbReady && rb && stretcherEngaged()) {
+        // REALTIME: everything below must run without touching the heap
+        RealtimeAllocGuard::Scope rtGuard;
+        if (debugKeylock)
+            RT_TRACE_DEBUG("[RB] Enter path: keylock={}, desiredOut={}, chsOut={}",
+                           rt.keylockEnabled, bufferToFill.numSamples, bufferToFill.buffer->getNumChannels());
         if (lastBlockSizeHint <= 0 || currentSampleRate <= 0.0) {
             // Not ready; fallback this block
-            if (debugKeylock) std::cout << "[KL][RB] Not ready: lastBlockSizeHint=" << lastBlockSizeHint
-                                        << ", SR=" << currentSampleRate << ". Fallback." << std::endl;
+            if (debugKeylock)
+                RT_TRACE_DEBUG("[KL][RB] Not ready: lastBlockSizeHint={}, SR={}. Fallback.", lastBlockSizeHint, currentSampleRate);
             resampleSource.getNextAudioBlock(bufferToFill);
             return;
         }
-        // Defensive: if no channels, just clear
-        if (bufferToFill.buffer->getNumChannels() <= 0) {
-            if (debugKeylock) std::cout << "[KL][RB] No output channels, clearing" << std::endl;
-            bufferToFill.clearActiveBufferRegion();
-            return;
-        }
-        
-        // Priming stage: feed input and output silence until primed (only if keylock is active)
-        if (keylockPrimeSamplesRemaining > 0 && isKeylockActive) {
-            const int chsRB = rbNumChannels;
-            const int chunk = lastBlockSizeHint > 0 ? lastBlockSizeHint : bufferToFill.numSamples;
-            if (rbInputBuffer.getNumChannels() < chsRB || rbInputBuffer.getNumSamples() < chunk)
-                rbInputBuffer.setSize(chsRB, chunk, false, true, true);
-            AudioSourceChannelInfo tempInfo;
-            tempInfo.buffer = &rbInputBuffer;
-            tempInfo.startSample = 0;
-            tempInfo.numSamples = chunk;
-            for (int c = 0; c < chsRB; ++c) rbInputBuffer.clear(c, 0, chunk);
-            resampleSource.setResamplingRatio(1.0);
-            resampleSource.getNextAudioBlock(tempInfo);
-            std::vector<const float*> inPtrs(chsRB);
-            for (int c = 0; c < chsRB; ++c) inPtrs[c] = rbInputBuffer.getReadPointer(c);
-            rb->process(inPtrs.data(), chunk, false);
-            keylockPrimeSamplesRemaining -= chunk;
-            if (debugKeylock) std::cout << "[RB] Priming... remaining=" << keylockPrimeSamplesRemaining << std::endl;
+        // Defensive: if no channels (or no scratch), just clear
+        if (bufferToFill.buffer->getNumChannels() <= 0 || rbMaxOutSamples <= 0) {
+            if (debugKeylock) RT_TRACE_DEBUG("[KL][RB] No output channels, clearing");
             bufferToFill.clearActiveBufferRegion();
             return;
         }
-        
-        // If keylock is off, use normal resampling and don't run RubberBand
-        if (!isKeylockActive) {
-            if (debugKeylock) std::cout << "[RB] Keylock OFF - using normal resampling" << std::endl;
-            resampleSource.setResamplingRatio(currentSpeed); // Normal pitch+tempo changes
-            resampleSource.getNextAudioBlock(bufferToFill);
-            return;
-        }
-        
-        try {
-        // When keylock is active, ALWAYS use RubberBand processing (even at 1.0x speed)
-        // This ensures consistent behavior and no audio dropout at unity speed
-        // Set desired time ratio (tempo change) and keep pitch 1.0
-        const double speed = std::clamp(currentSpeed, 0.05, 8.0);
-        double timeRatio = 1.0 / speed; // speed up -> smaller ratio
-        if (std::abs(timeRatio - rbLastTimeRatio) > 1e-4) {
-            rb->setTimeRatio(timeRatio);
-            rbLastTimeRatio = timeRatio;
-            if (debugKeylock) std::cout << "[RB] setTimeRatio=" << timeRatio << std::endl;
-        }
-        rb->setPitchScale(1.0);
-
-    // Number of output samples requested this callback
-    const int desiredOut = bufferToFill.numSamples;
-    const int chsOut = bufferToFill.buffer->getNumChannels();
-    const int chsRB = rbNumChannels; // Always talk to RB with its configured channel count
-
-        // Ensure we provide enough input using getSamplesRequired when possible
-        resampleSource.setResamplingRatio(1.0);
-
-        // Handle preferred start padding once after (re)initialisation
-        if (!rbPaddedStartDone) {
-            size_t pad = rb->getPreferredStartPad();
-            if (debugKeylock) std::cout << "[KL][RB] preferredStartPad=" << pad << std::endl;
-            if (pad > 0) {
-                // Feed silence to prime the stretcher
-                if (rbInputBuffer.getNumChannels() < chsRB || rbInputBuffer.getNumSamples() < (int)pad)
-                    rbInputBuffer.setSize(chsRB, (int)pad, false, true, true);
-                rbInputBuffer.clear();
-                std::vector<const float*> z(chsRB);
-                for (int c = 0; c < chsRB; ++c) z[c] = rbInputBuffer.getReadPointer(c);
-                rb->process(z.data(), (int)pad, false);
-            }
-            rbLatencySamples = (int)rb->getStartDelay();
-            rbLatencySeconds = rbLatencySamples / currentSampleRate;
-            rbDiscardOutRemaining = rbLatencySamples;
-            rbOutScratch.setSize(chsRB, std::max(desiredOut * 2, rbLatencySamples + desiredOut));
-            rbOutScratch.clear();
-            rbPaddedStartDone = true;
-        }
-
-        // Produce enough output to fully cover desiredOut, honouring initial start-delay discard
-        int produced = 0;
-        while (rbDiscardOutRemaining > 0 || rb->available() < (desiredOut - produced)) {
-            int needIn = (int)rb->getSamplesRequired();
-            if (needIn <= 0) {
-                double tr = std::max(1e-6, rbLastTimeRatio);
-                needIn = (int)std::ceil((desiredOut - produced) / tr);
-            }
-            if (needIn <= 0) break;
-            if (rbInputBuffer.getNumChannels() < chsRB || rbInputBuffer.getNumSamples() < needIn)
-                rbInputBuffer.setSize(chsRB, needIn, false, true, true);
-
-            int fed = 0;
-            while (fed < needIn) {
-                const int chunk = juce::jmin(lastBlockSizeHint, needIn - fed);
-                if (debugKeylock) std::cout << "[KL][RB] feeding chunk=" << chunk << "/" << needIn << std::endl;
-                AudioSourceChannelInfo tempInfo;
-                tempInfo.buffer = &rbInputBuffer;
-                tempInfo.startSample = fed;
-                tempInfo.numSamples = chunk;
-                for (int c = 0; c < chsRB; ++c) rbInputBuffer.clear(c, fed, chunk);
-                resampleSource.getNextAudioBlock(tempInfo);
-                fed += chunk;
-            }
-            std::vector<const float*> inPtrs(chsRB);
-            for (int c = 0; c < chsRB; ++c) inPtrs[c] = rbInputBuffer.getReadPointer(c);
-            rb->process(inPtrs.data(), needIn, false);
-
-            // Drain and discard initial latency into scratch buffer
-            if (rbDiscardOutRemaining > 0 && rb->available() > 0) {
-                int avail = rb->available();
-                int toTake = juce::jmin(avail, rbDiscardOutRemaining);
-                if (debugKeylock) std::cout << "[KL][RB] discard latency toTake=" << toTake << std::endl;
-                if (rbOutScratch.getNumChannels() < chsRB || rbOutScratch.getNumSamples() < toTake)
-                    rbOutScratch.setSize(chsRB, toTake, false, true, true);
-                std::vector<float*> sPtrs(chsRB);
-                for (int c = 0; c < chsRB; ++c) sPtrs[c] = rbOutScratch.getWritePointer(c);
-                rb->retrieve(sPtrs.data(), toTake);
-                rbDiscardOutRemaining -= toTake;
-            }
-
-            if (produced >= desiredOut) break;
-        }
-
-        // Now retrieve exactly what we need for this buffer
-        const int toRetrieve = std::max(0, juce::jmin(rb->available(), desiredOut));
-        if (rbOutScratch.getNumChannels() < chsRB || rbOutScratch.getNumSamples() < std::max(1, toRetrieve))
-            rbOutScratch.setSize(chsRB, std::max(1, toRetrieve), false, true, true);
-        std::vector<float*> outPtrsRB(chsRB);
-        for (int c = 0; c < chsRB; ++c) outPtrsRB[c] = rbOutScratch.getWritePointer(c);
-    const int got = (toRetrieve > 0) ? rb->retrieve(outPtrsRB.data(), toRetrieve) : 0;
-    if (debugKeylock) std::cout << "[KL][RB] retrieved got=" << got << "/" << desiredOut
-                     << ", availableAfter=" << rb->available() << std::endl;
-
-        // Robustly map/mix RubberBand output into the device buffer
-        if (got <= 0) {
-            bufferToFill.clearActiveBufferRegion();
-        } else {
-            // Case 1: RB provides >= output channels -> copy matching channels
-            if (chsRB >= chsOut) {
-                for (int c = 0; c < chsOut; ++c) {
-                    bufferToFill.buffer->copyFrom(c, bufferToFill.startSample, rbOutScratch, c, 0, got);
-                }
-            }
-            // Case 2: RB mono -> duplicate to all output channels
-            else if (chsRB == 1 && chsOut >= 1) {
-                for (int c = 0; c < chsOut; ++c) {
-                    bufferToFill.buffer->copyFrom(c, bufferToFill.startSample, rbOutScratch, 0, 0, got);
-                }
-            }
-            // Case 3: RB stereo but output mono -> mix to mono and copy
-            else if (chsRB >= 2 && chsOut == 1) {
-                if (rbOutScratch.getNumChannels() >= 2) {
-                    AudioBuffer<float> mix;
-                    mix.setSize(1, got, false, true, true);
-                    const float* lptr = rbOutScratch.getReadPointer(0);
-                    const float* rptr = rbOutScratch.getReadPointer(1);
-                    float* mptr = mix.getWritePointer(0);
-                    for (int i = 0; i < got; ++i) mptr[i] = 0.5f * (lptr[i] + rptr[i]);
-                    bufferToFill.buffer->copyFrom(0, bufferToFill.startSample, mix, 0, 0, got);
-                } else {
-                    // Fallback: copy first channel
-                    bufferToFill.buffer->copyFrom(0, bufferToFill.startSample, rbOutScratch, 0, 0, got);
-                }
-            }
-
-            // If RB had fewer channels than device, clear remaining channels to silence
-            for (int c = chsRB; c < chsOut; ++c) {
-                bufferToFill.buffer->clear(c, bufferToFill.startSample, got);
-            }
-        }
-
-        // Fill any remainder with silence for available channels
-        if (got < desiredOut) {
-            const int remain = desiredOut - got;
-            if (remain > 0) {
-                for (int c = 0; c < chsOut; ++c) {  // Use chsOut instead of min(chsOut, chsRB)
-                    auto* dst = bufferToFill.buffer->getWritePointer(c, bufferToFill.startSample + got);
-                    juce::FloatVectorOperations::clear(dst, remain);
-                }
-            }
-        }
-        resumeCompensatePending = false;
-        } catch (const std::exception& e) {
-            // If RB throws or anything goes wrong, fail safe to silence + fallback next block
-            std::cout << "RubberBand processing error: " << e.what() << std::endl;
-            bufferToFill.clearActiveBufferRegion();
-            rbReady = false;
-            return;
-        } catch (...) {
-            std::cout << "RubberBand processing unknown error" << std::endl;
-            bufferToFill.clearActiveBufferRegion();
-            rbReady = false;
-            return;
+        // A device block bigger than announced in prepareToPlay goes through in slices that fit
+        // the scratch buffers, so the stretch and its latency bookkeeping carry on unbroken
+        bool stretched = true;
+        for (int done = 0; done < bufferToFill.numSamples;) {
+            const AudioSourceChannelInfo slice(bufferToFill.buffer, bufferToFill.startSample + done,
+                                               juce::jmin(rbMaxOutSamples, bufferToFill.numSamples - done));
+            if (rbReady) stretched = renderStretched(slice) && stretched;
+            else slice.clearActiveBufferRegion();   // failed in an earlier slice
+            done += slice.numSamples;
         }
+        // Priming, or a stretcher error: nothing for the EQ and effects this block
+        if (!stretched) return;
     } else {
         // When keylock is disabled, use normal resampling (affects pitch+tempo together)
-        if (debugKeylock && keylockEnabled && std::abs(currentSpeed - 1.0) > 0.01) {
-            std::cout << "[KL] RubberBand not available - keylock disabled" << std::endl;
-        }
+        if (debugKeylock && rt.keylockEnabled && std::abs(rt.speed - 1.0) > 0.01)
+            RT_TRACE_DEBUG("[KL] RubberBand not available - keylock disabled");
+        
+        // Nothing audible to cross-fade: take a pending stand-by stretcher over directly
+        if (rbSwitchState.load(std::memory_order_acquire) != SwitchIdle && rbStandby) finishStretcherSwap();
         
         // Set speed normally (pitch and tempo change together)
-        resampleSource.setResamplingRatio(currentSpeed);
+        resampleSource.setResamplingRatio(playbackRatio());
         resampleSource.getNextAudioBlock(bufferToFill);
         
         // Debug: Log channel info occasionally for normal playback 
-        static int normalPlaybackCounter = 0;
-        if (++normalPlaybackCounter % 2000 == 0) {
-            std::cout << "[Normal] Playing: channels=" << bufferToFill.buffer->getNumChannels() 
-                      << ", samples=" << bufferToFill.numSamples << std::endl;
+        if (++traceCounters.normalPlayback % 2000 == 0) {
+            RT_TRACE_DEBUG("[Normal] Playing: channels={}, samples={}",
+                           bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
         }
     }
 #else
     // RubberBand is required - this should not happen with the new CMake setup
     #error "RubberBand is required for keylock functionality"
 #endif
+    // Just entered or left scratch mode: the side being left fades out
+    mixScratchFade(bufferToFill);
 
     // OPTIMIZED DSP processing with early exit for better performance
     if (!dspPrepared || bufferToFill.buffer->getNumChannels() == 0) {
@@ -660,112 +862,60 @@ void DJAudioPlayer::getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill
     }
 
     // DEBUG: Check if DSP is running and what the EQ values are
-    static int dspDebugCounter = 0;
-    if (++dspDebugCounter % 100 == 0) {
-        std::cout << "DSP RUNNING: low=" << lowGain << ", mid=" << midGain 
-                  << ", high=" << highGain << ", filter=" << filterKnob << std::endl;
+    if (++traceCounters.dsp % 100 == 0) {
+        RT_TRACE_DEBUG("DSP RUNNING: low={}, mid={}, high={}, filter={}",
+                       rt.lowGain, rt.midGain, rt.highGain, rt.filterKnob);
     }
 
     AudioBuffer<float>& buffer = *bufferToFill.buffer;
     const int numSamples = bufferToFill.numSamples;
     const int startSample = bufferToFill.startSample;
 
-    juce::dsp::AudioBlock<float> block(buffer);
-    auto subBlock = block.getSubBlock(startSample, numSamples);
-    auto limitedBlock = subBlock.getSubsetChannelBlock(0, std::min(buffer.getNumChannels(), 2));
-    juce::dsp::ProcessContextReplacing<float> ctx(limitedBlock);
-
-    // EQ-Parameter immer aktualisieren
-    float gainDbHigh = juce::jlimit(-12.0f, 12.0f, (float)(highGain * 12.0)); 
-    float gainLinearHigh = juce::Decibels::decibelsToGain(gainDbHigh);
-    highShelf.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighShelf(
-        currentSampleRate, 8000.0f, 0.707f, gainLinearHigh);
-
-    float gainDbMid = juce::jlimit(-12.0f, 12.0f, (float)(midGain * 12.0));
-    float gainLinearMid = juce::Decibels::decibelsToGain(gainDbMid);
-    midPeak.coefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-        currentSampleRate, 2500.0f, 1.0f, gainLinearMid);
-
-    float gainDbLow = juce::jlimit(-12.0f, 12.0f, (float)(lowGain * 12.0));
-    float gainLinearLow = juce::Decibels::decibelsToGain(gainDbLow);
-    lowShelf.coefficients = juce::dsp::IIR::Coefficients<float>::makeLowShelf(
-        currentSampleRate, 300.0f, 0.707f, gainLinearLow);
-
-    // EQ immer anwenden
-    lowShelf.process(ctx);
-    midPeak.process(ctx);
-    highShelf.process(ctx);
-
-    // Filter-Parameter immer aktualisieren
-    if (filterKnob < 0.0) {
-        double absNorm = std::abs(filterKnob);
-        double cutoffHz = 20000.0 * std::pow(0.01, absNorm);
-        svf.setType(juce::dsp::StateVariableTPTFilterType::lowpass);
-        svf.setCutoffFrequency(juce::jlimit(200.0f, 20000.0f, (float)cutoffHz));
-    } else {
-        double absNorm = filterKnob;
-        double cutoffHz = 20.0 * std::pow(250.0, absNorm);
-        svf.setType(juce::dsp::StateVariableTPTFilterType::highpass);
-        svf.setCutoffFrequency(juce::jlimit(20.0f, 5000.0f, (float)cutoffHz));
+    // Trim, ramped from the last block's so a load-time change doesn't click
+    const float trimTarget = (float) rt.trimGain;
+    if (trimTarget != 1.0f || appliedTrimGain != 1.0f) {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            buffer.applyGainRamp(ch, startSample, numSamples, appliedTrimGain, trimTarget);
+        appliedTrimGain = trimTarget;
     }
-    svf.process(ctx);
-    
-    // DEBUG: Print EQ and filter values every 500th buffer for monitoring
-    static int eqDebugCounter = 0;
-    if (++eqDebugCounter % 500 == 0) {
-        std::cout << "EQ/Filter values: low=" << lowGain << ", mid=" << midGain 
-                  << ", high=" << highGain << ", filter=" << filterKnob << std::endl;
+
+    // EQ + Filter: one fused pass over both channels, knob changes are smoothed per sub-block
+    eq.setTargets(rt.highGain, rt.midGain, rt.lowGain, rt.filterKnob);
+    if (buffer.getNumChannels() > 0) {
+        const juce::int64 eqStart = juce::Time::getHighResolutionTicks();
+        eq.process(buffer.getWritePointer(0, startSample),
+                   buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : nullptr,
+                   numSamples);
+        eqTicks += juce::Time::getHighResolutionTicks() - eqStart;
     }
-    
-    // Audio level monitoring for Master Out display
-    // Calculate RMS levels for both channels (thread-safe updates)
-    if (buffer.getNumChannels() > 0 && numSamples > 0) {
-        // Left channel (always present)
-        float leftRMS = 0.0f;
-        if (buffer.getNumChannels() >= 1) {
-            const float* leftData = buffer.getReadPointer(0, startSample);
-            float sum = 0.0f;
-            for (int i = 0; i < numSamples; ++i) {
-                float sample = leftData[i];
-                sum += sample * sample;
-            }
-            leftRMS = std::sqrt(sum / numSamples);
+
+    // Insert effects: nothing to do unless one is on or still ringing out
+    if (effects.isActive() && buffer.getNumChannels() > 0) {
+        const double ratio = offTimeline() ? std::abs(rt.scratchVelocity) : playbackRatio();
+        double beatPosition = -1.0;
+        if (rt.beatBpm > 0.0 && !offTimeline() && !inPrerollMode) {
+            // Position of the block's first sample: audible position is where the block ends
+            const double startSec = audiblePositionSeconds() - numSamples * ratio / currentSampleRate;
+            if (startSec >= rt.firstBeatSec)
+                beatPosition = (startSec - rt.firstBeatSec) * rt.beatBpm / 60.0;
         }
-        
-        // Right channel (if available, otherwise copy left)
-        float rightRMS = leftRMS; // Default to left if mono
-        if (buffer.getNumChannels() >= 2) {
-            const float* rightData = buffer.getReadPointer(1, startSample);
-            float sum = 0.0f;
-            for (int i = 0; i < numSamples; ++i) {
-                float sample = rightData[i];
-                sum += sample * sample;
-            }
-            rightRMS = std::sqrt(sum / numSamples);
+        effects.process(buffer.getWritePointer(0, startSample),
+                        buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : nullptr,
+                        numSamples, rt.beatBpm > 0.0 ? rt.beatBpm * playbackRatio() : 0.0, beatPosition);
+    }
+    // Plugin insert after the rack; one that is bypassed leaves the block as it is
+    if (auto* insert = pluginInsert.load(std::memory_order_acquire); insert != nullptr && buffer.getNumChannels() > 0)
+        insert->process(buffer.getWritePointer(0, startSample),
+                        buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : nullptr, numSamples);
+    
+    // DEBUG: Print EQ and filter values every 500th buffer for monitoring
+    if (++traceCounters.eq % 500 == 0) {
+        RT_TRACE_DEBUG("EQ/Filter values: low={}, mid={}, high={}, filter={}",
+                       rt.lowGain, rt.midGain, rt.highGain, rt.filterKnob);
+        if (rtTrack->readAheadSource && rtTrack->readAheadSource->getUnderrunCount() > 0) {
+            RT_TRACE_INFO("Read-ahead underruns: {} (prefetch hits: {})",
+                          rtTrack->readAheadSource->getUnderrunCount(), rtTrack->readAheadSource->getPrefetchHitCount());
         }
-        
-        // Convert to dB scale (0-100%) with smoothing for stable display
-        const float dbMin = -60.0f; // -60dB as 0%
-        const float dbMax = 0.0f;   // 0dB as 100%
-        
-        // Convert RMS to dB
-        float leftDb = leftRMS > 0.0f ? 20.0f * std::log10(leftRMS) : dbMin;
-        float rightDb = rightRMS > 0.0f ? 20.0f * std::log10(rightRMS) : dbMin;
-        
-        // Map to 0-100% range
-        float leftPercent = juce::jlimit(0.0f, 100.0f, ((leftDb - dbMin) / (dbMax - dbMin)) * 100.0f);
-        float rightPercent = juce::jlimit(0.0f, 100.0f, ((rightDb - dbMin) / (dbMax - dbMin)) * 100.0f);
-        
-        // Smooth the levels with simple exponential moving average for stable display
-        const float smoothing = 0.3f; // Adjust for responsiveness vs stability
-        float currentLeft = leftChannelLevel.load();
-        float currentRight = rightChannelLevel.load();
-        
-        float newLeft = currentLeft * (1.0f - smoothing) + leftPercent * smoothing;
-        float newRight = currentRight * (1.0f - smoothing) + rightPercent * smoothing;
-        
-        leftChannelLevel.store(newLeft);
-        rightChannelLevel.store(newRight);
     }
 }
 
@@ -773,11 +923,11 @@ void DJAudioPlayer::releaseResources() {
     // Safe resource release with proper error handling
     try {
         // Ensure playback is stopped before releasing processing resources
-        transportSource.stop();
+        rtTrack->transport.stop();
         
         // Release processing resources safely
         resampleSource.releaseResources();
-        transportSource.releaseResources();
+        rtTrack->transport.releaseResources();
         
 #if defined(RUBBERBAND_FOUND)
     rb.reset();
@@ -799,83 +949,182 @@ void DJAudioPlayer::loadFile(const File &file) {
         std::cout << "Reader created successfully, sample rate: " << reader->sampleRate << ", length: " << reader->lengthInSamples << std::endl;
         std::unique_ptr<AudioFormatReaderSource> newSource
                 (new AudioFormatReaderSource(reader, true));
-        transportSource.setSource(newSource.get(),
-                                  0,
-                                  nullptr,
-                                  reader->sampleRate);
-        readerSource.reset(newSource.release());
-        
-        // Ensure the newly set source is prepared if our DSP was already prepared by the device
-        if (dspPrepared && currentSampleRate > 0.0 && lastBlockSizeHint > 0) {
-            try {
-                transportSource.prepareToPlay(lastBlockSizeHint, currentSampleRate);
-                resampleSource.prepareToPlay(lastBlockSizeHint, currentSampleRate);
-            } catch (...) {
-                // Fail-safe: ignore; device callback will prepare again on next start
-            }
-        }
-        
-#if defined(RUBBERBAND_FOUND)
-        // Re-initialize RubberBand with correct channel count for the new audio file
-        reinitRubberBand();
-        std::cout << "RubberBand re-initialized for new audio file" << std::endl;
-#endif
-        
+        applyLoadedTrack(prepareTrack(std::move(newSource), reader->sampleRate));
         std::cout << "Audio file loaded successfully" << std::endl;
     } else {
         std::cout << "Failed to create reader for file: " << file.getFullPathName().toStdString() << std::endl;
     }
 }
 
-// NEW: Apply a pre-loaded audio source for threaded loading
-void DJAudioPlayer::applyLoadedSource(std::unique_ptr<AudioFormatReaderSource> source, double sampleRate) {
-    std::cout << "DJAudioPlayer::applyLoadedSource called with sample rate: " << sampleRate << std::endl;
-    
-    if (source && source->getAudioFormatReader()) {
-        // Stop any current playback before switching sources
-        bool wasPlaying = transportSource.isPlaying();
-        if (wasPlaying) {
-            transportSource.stop();
-        }
-        
-        transportSource.setSource(source.get(), 0, nullptr, sampleRate);
-        readerSource = std::move(source);
-        
-        // If the audio device has already called prepareToPlay on us, prepare the new source now
-        if (dspPrepared && currentSampleRate > 0.0 && lastBlockSizeHint > 0) {
-            try {
-                transportSource.prepareToPlay(lastBlockSizeHint, currentSampleRate);
-                resampleSource.prepareToPlay(lastBlockSizeHint, currentSampleRate);
-                std::cout << "Prepared newly loaded source for immediate playback" << std::endl;
-            } catch (...) {
-                // Ignore and let the audio graph recover next cycle
-                std::cout << "Warning: Failed to prepare newly loaded source" << std::endl;
-            }
+DJAudioPlayer::TrackSetup DJAudioPlayer::getTrackSetup() const {
+    std::lock_guard<std::mutex> guard(setupLock);
+    return setup;
+}
+
+std::unique_ptr<DJAudioPlayer::LoadedTrack> DJAudioPlayer::prepareTrack(std::unique_ptr<AudioFormatReaderSource> source,
+                                                                        double sampleRate) const {
+    if (!source || !source->getAudioFormatReader()) return nullptr;
+    const TrackSetup s = getTrackSetup();
+
+    auto next = std::make_unique<LoadedTrack>();
+    next->readerSource = std::move(source);
+    auto* reader = next->readerSource->getAudioFormatReader();
+    next->numChannels = std::clamp((int) reader->numChannels, 1, 2); // Max 2 channels for performance
+    next->ramReader = dynamic_cast<InMemoryTrackReader*>(reader);
+    next->stemReader = dynamic_cast<StemTrackReader*>(reader);
+
+    PositionableAudioSource* playbackSource = next->readerSource.get();
+    // Tracks already decoded into RAM (or played from their stems, also in RAM) gain nothing
+    // from read-ahead; memory-mapped ones read straight from the mapping, the read-ahead thread
+    // only pages in what comes next. Stem gain changes then reach the output within a block.
+    const bool inMemory = next->ramReader != nullptr || next->stemReader != nullptr;
+    auto* mapped = dynamic_cast<MappedTrackReader*>(reader);
+    if (mapped != nullptr) {
+        if (s.readAheadThread != nullptr) mapped->startTouchAhead(*s.readAheadThread);
+    } else if (s.readAheadThread != nullptr && s.readAheadMs > 0 && !inMemory) {
+        const int bufferSamples = (int) (sampleRate * s.readAheadMs / 1000.0);
+        next->readAheadSource = std::make_unique<DeckReadAheadSource>(next->readerSource.get(), *s.readAheadThread, bufferSamples);
+        playbackSource = next->readAheadSource.get();
+        std::cout << "Read-ahead enabled: " << s.readAheadMs << " ms (" << next->readAheadSource->getBufferSamples() << " samples)" << std::endl;
+    }
+
+    // Prepared before the source goes in, so setSource() prepares the whole chain right here
+    next->transport.setGain(s.gain);
+    if (s.sampleRate > 0.0) next->transport.prepareToPlay(s.blockSize, s.sampleRate);
+    next->transport.setSource(playbackSource, 0, nullptr, sampleRate);
+
+#if defined(RUBBERBAND_FOUND)
+    // Before the device is up there is nothing to build for; prepareToPlay() creates it then
+    if (s.sampleRate > 0.0) {
+        try {
+            next->stretcher = takeStretcher(s.quality, next->numChannels, s.sampleRate, s.maxProcessSize);
+            next->stretcherQuality = s.quality;
+            next->stretcherRate = s.sampleRate;
+        } catch (const std::exception& e) {
+            std::cout << "RubberBand init failed for new track: " << e.what() << std::endl;
+            next->stretcher.reset();
         }
-        
+    }
+#endif
+    return next;
+}
+
+void DJAudioPlayer::applyLoadedTrack(std::unique_ptr<LoadedTrack> next) {
+    if (!next || !next->readerSource) {
+        std::cout << "Failed to apply pre-loaded audio source" << std::endl;
+        return;
+    }
+
+    // If the player was playing before, the new track starts playing from its beginning
+    if (track->transport.isPlaying()) next->transport.start();
+
+    next->serial = ++appliedSerial;
+    LoadedTrack* published = next.get();
+    retiredTracks.push_back({ std::move(track), next->serial });
+    track = std::move(next);
+    // A track applied before the audio thread got to the previous one simply replaces it
+    pendingTrack.store(published, std::memory_order_release);
+    collectRetiredTracks();
+    std::cout << "Pre-loaded audio source applied, audio thread switches at the next block" << std::endl;
+}
+
+bool DJAudioPlayer::replaceTrackInPlace(std::unique_ptr<LoadedTrack> next) {
+    if (!next || !next->readerSource || inPrerollMode.load()) return false;
+    const bool paused = softPaused.load();
+    if (track->transport.isPlaying() && !paused) return false;
+    // A soft pause resumes from pausedPosSec either way; the stopped transport is where it stands
+    next->transport.setPosition(paused ? pausedPosSec : track->transport.getCurrentPosition());
+    applyLoadedTrack(std::move(next));
+    return true;
+}
+
+void DJAudioPlayer::pickUpPendingTrack() {
+    LoadedTrack* next = pendingTrack.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr) return;
+
+    LoadedTrack* previous = rtTrack;
+    rtTrack = next;
+    slicer.setInput(&next->transport, next->ramReader);
+    resampleSource.flushBuffers();
+    // Stems start at the deck's gains, not ramping in from unity
+    if (next->stemReader != nullptr)
+        for (int s = 0; s < StemTrackReader::NumStems; ++s) next->stemReader->setStemGain(s, rt.stemGains[(size_t) s]);
+    rt.motion = {};
+    rt.motionPending = false;
+    motionRunning.store(false);
+
+#if defined(RUBBERBAND_FOUND)
+    if (next->stretcher) {
+        // Pointer swap only: the previous stretcher leaves with the retired track, for the pool
+        previous->stretcher = std::move(rb);
+        previous->stretcherQuality = (KeylockQuality) rbRunningQuality.load();
+        previous->stretcherRate = currentSampleRate;
+        rb = std::move(next->stretcher);
+        rbNumChannels = next->numChannels;
+        rbRunningQuality = (int) next->stretcherQuality;
+        rbLastTimeRatio = 1.0;
+        rbLastPitchScale = 1.0;
+        rbReady = true;
+        rbPaddedStartDone = false;
+        rbLatencySamples = (int) rb->getStartDelay();
+        rbLatencySeconds = rbLatencySamples / currentSampleRate;
+        rbDiscardOutRemaining = 0;
+        rbInputFedTotal = 0;
+        rbOutputInputPos = 0.0;
+        // A quality switch warming up on the previous track's audio is dropped; the UI
+        // starts a new one if the profile still differs
+        if (rbSwitchState.load(std::memory_order_acquire) == SwitchRunning)
+            rbSwitchState.store(SwitchIdle, std::memory_order_release);
+    }
+#endif
+
+    pickedUpSerial.store(next->serial, std::memory_order_release);
+}
+
+void DJAudioPlayer::collectRetiredTracks() {
+    // Closing the file, unmapping it or giving back a track decoded into RAM is no job for the
+    // UI thread either: the reclaimer's thread does it
+    const juce::uint64 pickedUp = pickedUpSerial.load(std::memory_order_acquire);
+    for (auto it = retiredTracks.begin(); it != retiredTracks.end(); ) {
+        if (it->serial <= pickedUp) {
 #if defined(RUBBERBAND_FOUND)
-        // Re-initialize RubberBand with correct channel count for the new audio file
-        reinitRubberBand();
-        std::cout << "RubberBand re-initialized for new audio file" << std::endl;
+            LoadedTrack& retired = *it->track;
+            poolStretcher(std::move(retired.stretcher), retired.stretcherQuality, retired.stretcherRate);
 #endif
-        
-        // If the player was playing before, restart it with the new source
-        if (wasPlaying) {
-            transportSource.start();
-            std::cout << "Restarted playback with new source" << std::endl;
+            RealtimeReclaimer::getInstance().retire(std::move(it->track));
+            it = retiredTracks.erase(it);
+        } else {
+            ++it;
         }
-        
-        std::cout << "Pre-loaded audio source applied successfully" << std::endl;
-    } else {
-        std::cout << "Failed to apply pre-loaded audio source" << std::endl;
     }
 }
 
+void DJAudioPlayer::setReadAhead(TimeSliceThread* thread, int bufferMs) {
+    std::lock_guard<std::mutex> guard(setupLock);
+    setup.readAheadThread = thread;
+    setup.readAheadMs = std::max(0, bufferMs);
+}
+
+void DJAudioPlayer::setPrefetchPoint(int slot, double seconds) {
+    if (!track->readerSource || !track->readerSource->getAudioFormatReader()) return;
+    const double sourceRate = track->readerSource->getAudioFormatReader()->sampleRate;
+    const juce::int64 startSample = seconds < 0.0 ? -1 : (juce::int64) (seconds * sourceRate);
+    if (auto* mapped = dynamic_cast<MappedTrackReader*>(track->readerSource->getAudioFormatReader())) {
+        mapped->setTouchRegion(slot, startSample);
+        return;
+    }
+    if (!track->readAheadSource) return;
+    track->readAheadSource->setPrefetchRegion(slot, startSample);
+}
+
+
 void DJAudioPlayer::setGain(double gain) {
     if (gain < 0.0 || gain > 1.0) {
         std::cout << "DJAudioPlayer::setGain should be between 0.0 and 1.0\n";
     } else {
-        transportSource.setGain(gain);
+        track->transport.setGain(gain);
+        std::lock_guard<std::mutex> guard(setupLock);
+        setup.gain = (float) gain;
     }
 }
 
@@ -885,29 +1134,26 @@ void DJAudioPlayer::setSpeed(double ratio) {
         return;
     }
     
-    // Store the requested speed always
+    // Store the requested speed always; the audio thread applies it to resampler/RubberBand
     currentSpeed = ratio;
+    postCommand(Command::Type::SetSpeed, ratio);
     
     if (keylockEnabled) {
-        // KEYLOCK: Keep resampler at unity to preserve pitch; RubberBand will change tempo
-        resampleSource.setResamplingRatio(1.0);
         std::cout << "Keylock enabled - Tempo via RubberBand: " << ratio << "x (pitch locked)" << std::endl;
     } else {
-        // Normal speed change (affects both tempo and pitch together)
-        resampleSource.setResamplingRatio(ratio);
         std::cout << "Normal speed change: " << ratio << "x (tempo and pitch)" << std::endl;
     }
 }
 
 void DJAudioPlayer::setPosition(double posInSecs) {
-    if (posInSecs < 0 || posInSecs > transportSource.getLengthInSeconds()) {
+    if (posInSecs < 0 || posInSecs > track->transport.getLengthInSeconds()) {
         std::cout << "DJAudioPlayer::setPosition should be between 0.0 and the length of the track in seconds\n";
     } else {
         // Apply quantization if enabled
         double finalPos = quantizePosition(posInSecs);
-        transportSource.setPosition(finalPos);
+        postCommand(Command::Type::Seek, finalPos);
         // If paused/softPaused, make this the new resume position so Play continues from here
-        if (!transportSource.isPlaying() || softPaused.load()) {
+        if (!track->transport.isPlaying() || softPaused.load()) {
             pausedPosSec = finalPos;
         }
     }
@@ -922,36 +1168,58 @@ void DJAudioPlayer::setPositionRelative(double pos) {
         std::cout << "DJAudioPlayer::setPositionRelative should be between " << minRelativePos << " and 1.0 (unlimited preroll)\n";
     } else {
         if (pos < 0.0) {
-            // In preroll area - set transport to position 0 but remember the preroll offset
-            transportSource.setPosition(0.0);
-            prerollPosition = pos;  // Store the negative position
-            inPrerollMode = true;
+            // In preroll area - transport goes to 0, audio thread remembers the preroll offset
+            postCommand(Command::Type::SeekPreroll, pos);
             pausedPosSec = 0.0;
             std::cout << "Preroll position: " << pos << " (cued to start)" << std::endl;
         } else {
-            // Normal position within track
-            inPrerollMode = false;
-            prerollPosition = 0.0;
+            // Normal position within track (the Seek command also leaves preroll mode)
             const double relativePos = trackLengthSec * pos;
             // Apply quantization if enabled
             double finalPos = quantizePosition(relativePos);
             setPosition(finalPos);
             // Ensure paused resume picks up here
-            if (!transportSource.isPlaying() || softPaused.load()) {
+            if (!track->transport.isPlaying() || softPaused.load()) {
                 pausedPosSec = finalPos;
             }
         }
     }
 }
 
+void DJAudioPlayer::triggerQuantizedCue(double cueSec) {
+    cueSec = std::clamp(cueSec, 0.0, track->transport.getLengthInSeconds());
+    if (!quantizeEnabled || !getBeatGrid()) {
+        setPosition(cueSec);
+        return;
+    }
+    postCommand(Command::Type::QuantizedSeek, cueSec);
+    if (!track->transport.isPlaying() || softPaused.load()) {
+        pausedPosSec = cueSec;
+    }
+}
+
+void DJAudioPlayer::beatJump(double beats) {
+    if (!track->transport.isPlaying() || softPaused.load()) {
+        // Not moving: the resume position is the reference, no need to wait for the audio thread
+        const auto grid = getBeatGrid();
+        const double from = softPaused.load() ? pausedPosSec : track->transport.getCurrentPosition();
+        const double target = std::clamp(beatJumpTarget(grid.get(), trackBpm, from, beats), 0.0,
+                                         track->transport.getLengthInSeconds());
+        postCommand(Command::Type::Seek, target);
+        pausedPosSec = target;
+        return;
+    }
+    postCommand(Command::Type::BeatJump, beats);
+}
+
 double DJAudioPlayer::getPositionRelative() {
     // PREROLL SUPPORT: Return preroll position when in preroll mode
     if (inPrerollMode) {
         return prerollPosition;  // Return the negative position
     }
     
-    double currentPosInSecs = transportSource.getCurrentPosition();
-    double lengthInSecs = transportSource.getLengthInSeconds();
+    double currentPosInSecs = track->transport.getCurrentPosition();
+    double lengthInSecs = track->transport.getLengthInSeconds();
 
     if (lengthInSecs == 0.0) {
         return 0.0;
@@ -964,56 +1232,58 @@ void DJAudioPlayer::start() {
     // lightweight start without heavy logging to avoid UI hitches
     try {
         std::cout << "=== DJAudioPlayer::start() BEGIN ===" << std::endl;
-        std::cout << "  readerSource: " << (readerSource.get() ? "valid" : "null") << std::endl;
-        std::cout << "  transportSource.isPlaying() BEFORE: " << transportSource.isPlaying() << std::endl;
+        std::cout << "  readerSource: " << (track->readerSource.get() ? "valid" : "null") << std::endl;
+        std::cout << "  transport.isPlaying() BEFORE: " << track->transport.isPlaying() << std::endl;
         std::cout << "  softPaused BEFORE: " << softPaused.load() << std::endl;
         std::cout << "  dspPrepared: " << dspPrepared << std::endl;
         
-        if (readerSource.get() != nullptr) {
+        if (track->readerSource.get() != nullptr) {
             // PREROLL SUPPORT: Handle play from preroll position
             if (inPrerollMode) {
                 std::cout << "  Starting from preroll - will count in and transition to track start" << std::endl;
                 // Stay in preroll mode but enable count-in behavior
                 // The audio will play silence until reaching position 0.0, then start the track
-                transportSource.setPosition(0.0);
+                track->transport.setPosition(0.0);
                 // Don't exit preroll mode yet - let it transition naturally during playback
             }
             
             // Check current position and length to debug auto-stop
-            double currentPos = transportSource.getCurrentPosition();
-            double totalLength = transportSource.getLengthInSeconds();
+            double currentPos = track->transport.getCurrentPosition();
+            double totalLength = track->transport.getLengthInSeconds();
             std::cout << "  Current position: " << currentPos << " / " << totalLength << " seconds" << std::endl;
             
             // If we're at the end, reset to beginning
             if (currentPos >= totalLength - 0.1) {
                 std::cout << "  At end of file, resetting to start" << std::endl;
-                transportSource.setPosition(0.0);
+                track->transport.setPosition(0.0);
                 pausedPosSec = 0.0;
             }
             
             // TEMPORARY FIX: Enable looping to prevent auto-stop at end of file
-            transportSource.setLooping(true);
+            track->transport.setLooping(true);
             std::cout << "  Enabled looping to prevent auto-stop" << std::endl;
             
             // Seek to last exact pause position if valid
             if (pausedPosSec > 0.0 && pausedPosSec <= totalLength) {
                 std::cout << "  Seeking to pause position: " << pausedPosSec << std::endl;
-                transportSource.setPosition(pausedPosSec);
+                track->transport.setPosition(pausedPosSec);
             }
             // Clear soft pause so audio resumes immediately
+            armed.store(false);
             softPaused.store(false);
             forceSilent.store(false);
-            pausedResetPending.store(false); // cancel pending pause resets for instant resume
-            resumeCompensatePending = keylockEnabled;
+            postCommand(Command::Type::CancelPausedReset); // cancel pending pause resets for instant resume
+            resumeCompensatePending = keylockEnabled || keyShiftSemitones != 0.0;
             std::cout << "  Cleared pause flags" << std::endl;
             
-            std::cout << "  About to call transportSource.start()..." << std::endl;
-            transportSource.start();
-            std::cout << "  transportSource.start() called successfully" << std::endl;
-            std::cout << "  transportSource.isPlaying() AFTER: " << transportSource.isPlaying() << std::endl;
+            std::cout << "  About to call transport.start()..." << std::endl;
+            track->transport.start();
+            if (automation != nullptr) automation->record(automationDeck, MixAutomation::Kind::Play);
+            std::cout << "  transport.start() called successfully" << std::endl;
+            std::cout << "  transport.isPlaying() AFTER: " << track->transport.isPlaying() << std::endl;
             
             // Check position again after start
-            double newPos = transportSource.getCurrentPosition();
+            double newPos = track->transport.getCurrentPosition();
             std::cout << "  Position after start: " << newPos << " seconds" << std::endl;
         } else {
             std::cout << "  No file loaded - cannot start playback" << std::endl;
@@ -1026,20 +1296,45 @@ void DJAudioPlayer::start() {
     }
 }
 
-void DJAudioPlayer::stop() {
-    // Ultra-lightweight stop to avoid blocking the UI thread
-    try {
+bool DJAudioPlayer::armStart(double positionSec) {
+    if (track->readerSource == nullptr) return false;
+    const double target = std::clamp(positionSec, 0.0, track->transport.getLengthInSeconds());
+    // Parked first, so the transport never advances between start() and the seek
+    softPaused.store(true);
+    forceSilent.store(false);
+    postCommand(Command::Type::Seek, target);
+    postCommand(Command::Type::CancelPausedReset);
+    pausedPosSec = target;
+    resumeCompensatePending = keylockEnabled || keyShiftSemitones != 0.0;
+    track->transport.setLooping(true);   // as start(): no auto-stop at the end of the file
+    track->transport.start();
+    armed.store(true);
+    std::cout << "DJAudioPlayer: armed to start at " << target << " s" << std::endl;
+    return true;
+}
+
+bool DJAudioPlayer::startArmed(int sampleInBlock) noexcept {
+    if (!armed.load()) return false;
+    rt.armedStartAt = std::max(0, sampleInBlock);
+    return true;
+}
+
+void DJAudioPlayer::stop() {
+    // Ultra-lightweight stop to avoid blocking the UI thread
+    try {
         std::cout << "=== DJAudioPlayer::stop() BEGIN ===" << std::endl;
-        std::cout << "  transportSource.isPlaying() BEFORE: " << transportSource.isPlaying() << std::endl;
+        std::cout << "  transport.isPlaying() BEFORE: " << track->transport.isPlaying() << std::endl;
         std::cout << "  softPaused BEFORE: " << softPaused.load() << std::endl;
         
         // Soft pause: keep transport running but output silence to avoid cross-deck glitch
         softPaused.store(true);
-        // Save position for precise resume
-        pausedPosSec = transportSource.getCurrentPosition();
+        armed.store(false);
+        // Save position for precise resume; a brake or spinback has the playhead, not the transport
+        pausedPosSec = motionRunning.load() ? getPositionSnapshot().positionSec : track->transport.getCurrentPosition();
         std::cout << "  Saved pause position: " << pausedPosSec << std::endl;
         // Prepare one-time resets to avoid artifacts on resume
-        pausedResetPending.store(true);
+        postCommand(Command::Type::ResetAfterPause);
+        if (automation != nullptr) automation->record(automationDeck, MixAutomation::Kind::Pause);
         
         std::cout << "  softPaused AFTER: " << softPaused.load() << std::endl;
         std::cout << "=== DJAudioPlayer::stop() END ===" << std::endl;
@@ -1059,21 +1354,44 @@ void DJAudioPlayer::reinitRubberBand() {
         return;
     }
     
-    // Determine channel count from the loaded audio source
-    int sourceChannels = 1; // Default to mono
-    if (readerSource && readerSource->getAudioFormatReader()) {
-        sourceChannels = readerSource->getAudioFormatReader()->numChannels;
-    }
-    rbNumChannels = std::min(sourceChannels, 2); // Max 2 channels for performance
+    // Channel count of the loaded track (prepareTrack() caps it at 2 for performance)
+    rbNumChannels = rtTrack->numChannels;
     
-    std::cout << "RubberBand init: sourceChannels=" << sourceChannels << ", rbChannels=" << rbNumChannels << std::endl;
+    std::cout << "RubberBand init: rbChannels=" << rbNumChannels << std::endl;
     
+    try {
+        rb = createStretcher(rbQuality, rbNumChannels, currentSampleRate, rbMaxInSamples);
+        rbLastTimeRatio = 1.0;
+        rbLastPitchScale = 1.0;
+        rbRunningQuality = (int) rbQuality;
+        if (rbSwitchState.load() == SwitchIdle) rbStandby.reset();
+        prepareRubberBandScratch();
+        rbReady = true;
+        rbPaddedStartDone = false; // Normal padding will be done
+        rbLatencySamples = (int)rb->getStartDelay();
+        rbLatencySeconds = rbLatencySamples / currentSampleRate;
+        rbDiscardOutRemaining = 0;
+        refillStretcherPool();
+        std::cout << "Rubber Band init: CONTINUOUS when keylock ON, quality=" << (int)rbQuality << ", engine=" << rb->getEngineVersion() << ", SR=" << currentSampleRate << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << "RubberBand init failed: " << e.what() << std::endl;
+        rb.reset();
+        rbReady = false;
+    } catch (...) {
+        std::cout << "RubberBand init failed: unknown error" << std::endl;
+        rb.reset();
+        rbReady = false;
+    }
+}
+
+std::unique_ptr<RubberBand::RubberBandStretcher> DJAudioPlayer::createStretcher(KeylockQuality quality, int numChannels,
+                                                                                double sampleRate, int maxProcessSize) {
     RubberBand::RubberBandStretcher::Options opts =
         RubberBand::RubberBandStretcher::OptionProcessRealTime |
         RubberBand::RubberBandStretcher::OptionThreadingAuto;
 
     // Base config by profile
-    switch (rbQuality) {
+    switch (quality) {
         case KeylockQuality::Fast:
             opts |= RubberBand::RubberBandStretcher::OptionEngineFaster |
                     RubberBand::RubberBandStretcher::OptionTransientsCrisp |
@@ -1096,46 +1414,444 @@ void DJAudioPlayer::reinitRubberBand() {
                     RubberBand::RubberBandStretcher::OptionChannelsTogether;
             break;
     }
+    auto stretcher = std::make_unique<RubberBand::RubberBandStretcher>(sampleRate, numChannels, opts);
+    stretcher->setTimeRatio(1.0);
+    stretcher->setPitchScale(1.0);
+    if (maxProcessSize > 0) stretcher->setMaxProcessSize((size_t) maxProcessSize);
+    return stretcher;
+}
+
+std::unique_ptr<RubberBand::RubberBandStretcher> DJAudioPlayer::takeStretcher(KeylockQuality quality, int numChannels,
+                                                                              double sampleRate, int maxProcessSize) const {
+    std::unique_ptr<RubberBand::RubberBandStretcher> stretcher;
+    {
+        std::lock_guard<std::mutex> guard(stretcherPoolLock);
+        for (auto it = stretcherPool.begin(); it != stretcherPool.end(); ++it) {
+            if (it->quality != quality || it->numChannels != numChannels || it->sampleRate != sampleRate) continue;
+            stretcher = std::move(it->stretcher);
+            stretcherPool.erase(it);
+            break;
+        }
+    }
+    // Another channel count or rate (or the pool still waits for the last one): built anew
+    if (!stretcher) return createStretcher(quality, numChannels, sampleRate, maxProcessSize);
+
+    // Back to the state of a new one, without the allocations
+    stretcher->reset();
+    stretcher->setTimeRatio(1.0);
+    stretcher->setPitchScale(1.0);
+    if (maxProcessSize > 0) stretcher->setMaxProcessSize((size_t) maxProcessSize);
+    return stretcher;
+}
+
+void DJAudioPlayer::poolStretcher(std::unique_ptr<RubberBand::RubberBandStretcher> stretcher, KeylockQuality quality,
+                                  double sampleRate) {
+    if (!stretcher || sampleRate <= 0.0) return;
+    const int numChannels = (int) stretcher->getChannelCount();
+    std::unique_ptr<RubberBand::RubberBandStretcher> replaced;
+    {
+        std::lock_guard<std::mutex> guard(stretcherPoolLock);
+        auto it = std::find_if(stretcherPool.begin(), stretcherPool.end(), [&](const PooledStretcher& p) {
+            return p.quality == quality && p.numChannels == numChannels;
+        });
+        if (it == stretcherPool.end()) {
+            stretcherPool.push_back({ std::move(stretcher), quality, numChannels, sampleRate });
+            return;
+        }
+        replaced = std::move(it->stretcher);
+        *it = { std::move(stretcher), quality, numChannels, sampleRate };
+    }
+    // Freeing the FFT plans is no job for the UI thread either
+    RealtimeReclaimer::getInstance().retire(std::move(replaced));
+}
+
+void DJAudioPlayer::refillStretcherPool() {
+    std::vector<std::unique_ptr<RubberBand::RubberBandStretcher>> stale;
+    bool haveStereo = false;
+    {
+        std::lock_guard<std::mutex> guard(stretcherPoolLock);
+        for (auto it = stretcherPool.begin(); it != stretcherPool.end(); ) {
+            if (it->sampleRate != currentSampleRate) {
+                stale.push_back(std::move(it->stretcher));
+                it = stretcherPool.erase(it);
+                continue;
+            }
+            haveStereo = haveStereo || (it->quality == rbQuality && it->numChannels == 2);
+            ++it;
+        }
+    }
+    for (auto& stretcher : stale) RealtimeReclaimer::getInstance().retire(std::move(stretcher));
+    // The first load after the device came up finds its stretcher ready
+    if (!haveStereo) poolStretcher(createStretcher(rbQuality, 2, currentSampleRate, rbMaxInSamples), rbQuality, currentSampleRate);
+}
+
+void DJAudioPlayer::prepareRubberBandScratch() {
+    // Worst case per output block: the fastest tempo consumes rbMaxSpeed input frames per output
+    // frame. Both buffers are sized once here and only ever used at or below this capacity.
+    const int maxBlock = std::max(128, preparedBlockSize);
+    rbMaxOutSamples = maxBlock;
+    rbMaxInSamples = (int) std::ceil(maxBlock * rbMaxSpeed);
+
+    rbInputBuffer.setSize(2, rbMaxInSamples, false, true, false);
+    rbInputBuffer.clear();
+    rbOutScratch.setSize(2, rbMaxOutSamples, false, true, false);
+    rbOutScratch.clear();
+
+    // Pointer arrays always cover both channels; RB only reads the first rbNumChannels
+    for (int c = 0; c < 2; ++c) {
+        rbInPtrs[(size_t) c] = rbInputBuffer.getReadPointer(c);
+        rbOutPtrs[(size_t) c] = rbOutScratch.getWritePointer(c);
+    }
+
+    // Quality-switch buffers: input history plus the stand-by stretcher's own scratch
+    rbHistory.setSize(2, rbHistorySize, false, true, false);
+    rbHistory.clear();
+    rbStandbyIn.setSize(2, rbMaxInSamples, false, true, false);
+    rbStandbyIn.clear();
+    rbStandbyOut.setSize(2, rbMaxOutSamples, false, true, false);
+    rbStandbyOut.clear();
+    for (int c = 0; c < 2; ++c) {
+        rbStandbyInPtrs[(size_t) c] = rbStandbyIn.getReadPointer(c);
+        rbStandbyOutPtrs[(size_t) c] = rbStandbyOut.getWritePointer(c);
+    }
+    rbFadeLength = std::max(256, (int) (currentSampleRate * 0.04));
+
+    if (rb) rb->setMaxProcessSize((size_t) rbMaxInSamples);
+    if (rbStandby) rbStandby->setMaxProcessSize((size_t) rbMaxInSamples);
+    {
+        std::lock_guard<std::mutex> guard(setupLock);
+        setup.maxProcessSize = rbMaxInSamples;
+    }
+    std::cout << "RubberBand scratch preallocated: in=" << rbMaxInSamples
+              << " out=" << rbMaxOutSamples << " frames" << std::endl;
+}
+
+void DJAudioPlayer::setKeylockQuality(KeylockQuality q) {
+    if (q == rbQuality) return;
+    rbQuality = q;
+    {
+        std::lock_guard<std::mutex> guard(setupLock);
+        setup.quality = q;
+    }
+    if (!rb) return;  // picked up by the next reinitRubberBand()
+    serviceKeylockSwitch();
+}
+
+DJAudioPlayer::KeylockQuality DJAudioPlayer::getActiveKeylockQuality() const {
+    return (KeylockQuality) rbRunningQuality.load();
+}
+
+bool DJAudioPlayer::isKeylockSwitchPending() const {
+    return rbSwitchState.load() != SwitchIdle || rbRunningQuality.load() != (int) rbQuality;
+}
+
+void DJAudioPlayer::serviceKeylockSwitch() {
+    // The stand-by slot belongs to the audio thread until it reports Idle again
+    if (!rb || rbSwitchState.load(std::memory_order_acquire) != SwitchIdle) return;
+    if (rbRunningQuality.load() == (int) rbQuality) {
+        // the retired instance of the last switch
+        RealtimeReclaimer::getInstance().retire(std::move(rbStandby));
+        return;
+    }
+
     try {
-        rb = std::make_unique<RubberBand::RubberBandStretcher>(currentSampleRate, rbNumChannels, opts);
-        rb->setTimeRatio(1.0);
-        rb->setPitchScale(1.0);
-        rb->setMaxProcessSize((size_t) std::max(128, lastBlockSizeHint));
-        rbLastTimeRatio = 1.0;
-        rbInputBuffer.setSize(rbNumChannels, std::max(256, lastBlockSizeHint));
-        rbInputBuffer.clear();
-        rbReady = true;
-        rbPaddedStartDone = false; // Normal padding will be done
+        rbStandby = createStretcher(rbQuality, rbNumChannels, currentSampleRate, rbMaxInSamples);
+        rbStandby->setTimeRatio(rbLastTimeRatio);
+        rbStandby->setPitchScale(rbLastPitchScale);
+        rbStandbyQuality = rbQuality;
+    } catch (const std::exception& e) {
+        std::cout << "Keylock quality switch failed: " << e.what() << std::endl;
+        rbStandby.reset();
+        return;
+    }
+    std::cout << "Keylock quality switch armed: " << rbRunningQuality.load() << " -> " << (int) rbQuality << std::endl;
+    rbSwitchState.store(SwitchArmed, std::memory_order_release);
+}
+
+bool DJAudioPlayer::renderStretched(const AudioSourceChannelInfo &bufferToFill) {
+    // Priming stage: feed input and output silence until primed
+    if (keylockPrimeSamplesRemaining > 0) {
+        const int chsRB = rbNumChannels;
+        const int chunk = juce::jmin(lastBlockSizeHint > 0 ? lastBlockSizeHint : bufferToFill.numSamples,
+                                     rbMaxInSamples);
+        AudioSourceChannelInfo tempInfo;
+        tempInfo.buffer = &rbInputBuffer;
+        tempInfo.startSample = 0;
+        tempInfo.numSamples = chunk;
+        for (int c = 0; c < chsRB; ++c) rbInputBuffer.clear(c, 0, chunk);
+        resampleSource.setResamplingRatio(1.0);
+        resampleSource.getNextAudioBlock(tempInfo);
+        feedActiveStretcher(chunk);
+        keylockPrimeSamplesRemaining -= chunk;
+        if (debugKeylock) RT_TRACE_DEBUG("[RB] Priming... remaining={}", keylockPrimeSamplesRemaining);
+        bufferToFill.clearActiveBufferRegion();
+        return false;
+    }
+    
+    try {
+    // When keylock is active, ALWAYS use RubberBand processing (even at 1.0x speed)
+    // This ensures consistent behavior and no audio dropout at unity speed
+    // Set desired time ratio (tempo change); the pitch is the key shift, on top of the
+    // tempo when keylock is off, both in this one pass
+    const double speed = std::clamp(playbackRatio(), 0.05, 8.0);
+    double timeRatio = 1.0 / speed; // speed up -> smaller ratio
+    if (std::abs(timeRatio - rbLastTimeRatio) > 1e-4) {
+        rb->setTimeRatio(timeRatio);
+        rbLastTimeRatio = timeRatio;
+        if (debugKeylock) RT_TRACE_DEBUG("[RB] setTimeRatio={}", timeRatio);
+    }
+    const double pitchScale = std::pow(2.0, rt.keyShift / 12.0) * (rt.keylockEnabled ? 1.0 : speed);
+    if (std::abs(pitchScale - rbLastPitchScale) > 1e-5) {
+        rb->setPitchScale(pitchScale);
+        rbLastPitchScale = pitchScale;
+        if (debugKeylock) RT_TRACE_DEBUG("[RB] setPitchScale={}", pitchScale);
+    }
+
+    // Number of output samples requested this callback
+    const int desiredOut = bufferToFill.numSamples;
+    const int chsOut = bufferToFill.buffer->getNumChannels();
+    const int chsRB = rbNumChannels; // Always talk to RB with its configured channel count
+
+    // Ensure we provide enough input using getSamplesRequired when possible
+    resampleSource.setResamplingRatio(1.0);
+
+    // Handle preferred start padding once after (re)initialisation
+    if (!rbPaddedStartDone) {
+        size_t pad = rb->getPreferredStartPad();
+        if (debugKeylock) RT_TRACE_DEBUG("[KL][RB] preferredStartPad={}", pad);
+        if (pad > 0) {
+            // Feed silence to prime the stretcher (in chunks that fit the preallocated buffer)
+            rbInputBuffer.clear();
+            int padLeft = (int)pad;
+            while (padLeft > 0) {
+                const int chunk = juce::jmin(padLeft, rbMaxInSamples);
+                rb->process(rbInPtrs.data(), chunk, false);
+                padLeft -= chunk;
+            }
+        }
         rbLatencySamples = (int)rb->getStartDelay();
         rbLatencySeconds = rbLatencySamples / currentSampleRate;
-        rbDiscardOutRemaining = 0;
-        rbOutScratch.setSize(rbNumChannels, std::max(256, lastBlockSizeHint));
+        rbDiscardOutRemaining = rbLatencySamples;
         rbOutScratch.clear();
-        std::cout << "Rubber Band init: CONTINUOUS when keylock ON, quality=" << (int)rbQuality << ", engine=" << rb->getEngineVersion() << ", SR=" << currentSampleRate << std::endl;
-    } catch (const std::exception& e) {
-        std::cout << "RubberBand init failed: " << e.what() << std::endl;
-        rb.reset();
+        rbPaddedStartDone = true;
+        rbOutputInputPos = (double) rbInputFedTotal;
+    }
+
+    // Produce enough output to fully cover desiredOut, honouring initial start-delay discard
+    int produced = 0;
+    while (rbDiscardOutRemaining > 0 || rb->available() < (desiredOut - produced)) {
+        int needIn = (int)rb->getSamplesRequired();
+        if (needIn <= 0) {
+            double tr = std::max(1e-6, rbLastTimeRatio);
+            needIn = (int)std::ceil((desiredOut - produced) / tr);
+        }
+        if (needIn <= 0) break;
+        // Never exceed the preallocated input; the outer loop simply runs again if needed
+        needIn = juce::jmin(needIn, rbMaxInSamples);
+
+        int fed = 0;
+        while (fed < needIn) {
+            const int chunk = juce::jmin(lastBlockSizeHint, needIn - fed);
+            if (debugKeylock) RT_TRACE_DEBUG("[KL][RB] feeding chunk={}/{}", chunk, needIn);
+            AudioSourceChannelInfo tempInfo;
+            tempInfo.buffer = &rbInputBuffer;
+            tempInfo.startSample = fed;
+            tempInfo.numSamples = chunk;
+            for (int c = 0; c < chsRB; ++c) rbInputBuffer.clear(c, fed, chunk);
+            resampleSource.getNextAudioBlock(tempInfo);
+            fed += chunk;
+        }
+        feedActiveStretcher(needIn);
+
+        // Drain and discard initial latency into scratch buffer
+        if (rbDiscardOutRemaining > 0 && rb->available() > 0) {
+            int avail = rb->available();
+            int toTake = juce::jmin(avail, rbDiscardOutRemaining, rbMaxOutSamples);
+            if (debugKeylock) RT_TRACE_DEBUG("[KL][RB] discard latency toTake={}", toTake);
+            rb->retrieve(rbOutPtrs.data(), toTake);
+            rbDiscardOutRemaining -= toTake;
+        }
+
+        if (produced >= desiredOut) break;
+    }
+
+    // Now retrieve exactly what we need for this buffer
+    const int toRetrieve = std::max(0, juce::jmin(rb->available(), desiredOut, rbMaxOutSamples));
+    const int got = (toRetrieve > 0) ? (int) rb->retrieve(rbOutPtrs.data(), toRetrieve) : 0;
+    if (debugKeylock) RT_TRACE_DEBUG("[KL][RB] retrieved got={}/{}, availableAfter={}", got, desiredOut, rb->available());
+    rbOutputInputPos += got / std::max(1e-6, rbLastTimeRatio);
+
+    // Quality switch in progress: warm up / cross-fade the stand-by stretcher into rbOutScratch
+    runStandbyStretcher(got);
+
+    // Robustly map/mix RubberBand output into the device buffer
+    if (got <= 0) {
+        bufferToFill.clearActiveBufferRegion();
+    } else {
+        // Case 1: RB provides >= output channels -> copy matching channels
+        if (chsRB >= chsOut) {
+            for (int c = 0; c < chsOut; ++c) {
+                bufferToFill.buffer->copyFrom(c, bufferToFill.startSample, rbOutScratch, c, 0, got);
+            }
+        }
+        // Case 2: RB mono -> duplicate to all output channels
+        else if (chsRB == 1 && chsOut >= 1) {
+            for (int c = 0; c < chsOut; ++c) {
+                bufferToFill.buffer->copyFrom(c, bufferToFill.startSample, rbOutScratch, 0, 0, got);
+            }
+        }
+        // Case 3: RB stereo but output mono -> mix to mono and copy
+        else if (chsRB >= 2 && chsOut == 1) {
+            if (rbOutScratch.getNumChannels() >= 2) {
+                // Mix down in place into scratch channel 0 (no temporary buffer)
+                float* mptr = rbOutScratch.getWritePointer(0);
+                juce::FloatVectorOperations::add(mptr, rbOutScratch.getReadPointer(1), got);
+                juce::FloatVectorOperations::multiply(mptr, 0.5f, got);
+                bufferToFill.buffer->copyFrom(0, bufferToFill.startSample, rbOutScratch, 0, 0, got);
+            } else {
+                // Fallback: copy first channel
+                bufferToFill.buffer->copyFrom(0, bufferToFill.startSample, rbOutScratch, 0, 0, got);
+            }
+        }
+
+        // If RB had fewer channels than device, clear remaining channels to silence
+        for (int c = chsRB; c < chsOut; ++c) {
+            bufferToFill.buffer->clear(c, bufferToFill.startSample, got);
+        }
+    }
+
+    // Fill any remainder with silence for available channels
+    if (got < desiredOut) {
+        const int remain = desiredOut - got;
+        if (remain > 0) {
+            for (int c = 0; c < chsOut; ++c) {  // Use chsOut instead of min(chsOut, chsRB)
+                auto* dst = bufferToFill.buffer->getWritePointer(c, bufferToFill.startSample + got);
+                juce::FloatVectorOperations::clear(dst, remain);
+            }
+        }
+    }
+    resumeCompensatePending = false;
+    } catch (const std::exception&) {
+        // If RB throws or anything goes wrong, fail safe to silence + fallback next block
+        RT_TRACE_WARN("RubberBand processing error, keylock off until it is re-enabled");
+        bufferToFill.clearActiveBufferRegion();
         rbReady = false;
+        return false;
     } catch (...) {
-        std::cout << "RubberBand init failed: unknown error" << std::endl;
-        rb.reset();
+        RT_TRACE_WARN("RubberBand processing unknown error, keylock off until it is re-enabled");
+        bufferToFill.clearActiveBufferRegion();
         rbReady = false;
+        return false;
     }
+    return true;
 }
 
-void DJAudioPlayer::setKeylockQuality(KeylockQuality q) {
-    if (q == rbQuality) return;
-    rbQuality = q;
-    if (keylockEnabled) {
-        // Recreate stretcher with new profile
-        reinitRubberBand();
+void DJAudioPlayer::feedActiveStretcher(int numSamples) {
+    rb->process(rbInPtrs.data(), (size_t) numSamples, false);
+
+    // Keep a copy for a stand-by stretcher that may have to start from this audio
+    int pos = (int) (rbInputFedTotal % rbHistorySize);
+    int remaining = numSamples, src = 0;
+    while (remaining > 0) {
+        const int n = std::min(remaining, rbHistorySize - pos);
+        for (int c = 0; c < rbNumChannels; ++c)
+            rbHistory.copyFrom(c, pos, rbInputBuffer, c, src, n);
+        pos = (pos + n) % rbHistorySize;
+        src += n;
+        remaining -= n;
     }
+    rbInputFedTotal += numSamples;
+}
+
+void DJAudioPlayer::runStandbyStretcher(int got) {
+    const int state = rbSwitchState.load(std::memory_order_acquire);
+    if (state == SwitchIdle || !rbStandby) return;
+
+    if (state == SwitchArmed) {
+        if ((int) rbStandby->getChannelCount() != rbNumChannels) {
+            rbSwitchState.store(SwitchIdle, std::memory_order_release);
+            return;
+        }
+        // Prime with silence, then start from the input the active stretcher is outputting now
+        size_t pad = rbStandby->getPreferredStartPad();
+        rbStandbyIn.clear();
+        while (pad > 0) {
+            const size_t chunk = std::min(pad, (size_t) rbMaxInSamples);
+            rbStandby->process(rbStandbyInPtrs.data(), chunk, false);
+            pad -= chunk;
+        }
+        rbStandbyDiscard = (int) rbStandby->getStartDelay();
+        rbStandbyFeedPos = std::max<juce::int64>((juce::int64) rbOutputInputPos, rbInputFedTotal - rbHistorySize);
+        rbStandbyOwed = 0;
+        rbFadePos = 0;
+        rbSwitchState.store(SwitchRunning, std::memory_order_release);
+        return;
+    }
+
+    // Running: the stand-by owes every frame the active one has played since the switch began
+    rbStandbyOwed += got;
+    rbStandby->setTimeRatio(rbLastTimeRatio);
+    rbStandby->setPitchScale(rbLastPitchScale);
+
+    // Catch up from the history, one input buffer per block at most
+    const int toFeed = (int) std::min<juce::int64>(rbInputFedTotal - rbStandbyFeedPos, rbMaxInSamples);
+    if (toFeed > 0) {
+        int pos = (int) (rbStandbyFeedPos % rbHistorySize);
+        int done = 0;
+        while (done < toFeed) {
+            const int n = std::min(toFeed - done, rbHistorySize - pos);
+            for (int c = 0; c < rbNumChannels; ++c)
+                rbStandbyIn.copyFrom(c, done, rbHistory, c, pos, n);
+            pos = (pos + n) % rbHistorySize;
+            done += n;
+        }
+        rbStandby->process(rbStandbyInPtrs.data(), (size_t) toFeed, false);
+        rbStandbyFeedPos += toFeed;
+    }
+
+    // Drop its start delay and any frames the active stretcher already played
+    while (rbStandby->available() > 0 && (rbStandbyDiscard > 0 || rbStandbyOwed > got)) {
+        const int want = rbStandbyDiscard > 0 ? rbStandbyDiscard : rbStandbyOwed - got;
+        const int n = std::min({ (int) rbStandby->available(), want, rbMaxOutSamples });
+        rbStandby->retrieve(rbStandbyOutPtrs.data(), (size_t) n);
+        if (rbStandbyDiscard > 0) rbStandbyDiscard -= n;
+        else rbStandbyOwed -= n;
+    }
+
+    if (got <= 0 || rbStandbyDiscard > 0 || rbStandbyOwed != got || (int) rbStandby->available() < got)
+        return;  // still warming up; the active stretcher plays alone
+
+    rbStandby->retrieve(rbStandbyOutPtrs.data(), (size_t) got);
+    rbStandbyOwed = 0;
+
+    // Both stretchers play the same audio in sync now: linear cross-fade (signals are correlated)
+    const float fadeLen = (float) rbFadeLength;
+    for (int c = 0; c < rbNumChannels; ++c) {
+        float* out = rbOutScratch.getWritePointer(c);
+        const float* in = rbStandbyOut.getReadPointer(c);
+        for (int i = 0; i < got; ++i) {
+            const float g = std::min(1.0f, (float) (rbFadePos + i) / fadeLen);
+            out[i] += g * (in[i] - out[i]);
+        }
+    }
+    rbFadePos += got;
+    if (rbFadePos >= rbFadeLength) finishStretcherSwap();
+}
+
+void DJAudioPlayer::finishStretcherSwap() {
+    // Pointer swap only: the retired instance stays in rbStandby until the UI thread retires it
+    std::swap(rb, rbStandby);
+    rbRunningQuality = (int) rbStandbyQuality;
+    rbLatencySamples = (int) rb->getStartDelay();
+    rbLatencySeconds = rbLatencySamples / currentSampleRate;
+    rbSwitchState.store(SwitchIdle, std::memory_order_release);
+    if (debugKeylock) RT_TRACE_DEBUG("[KL] Quality switch complete");
 }
 #endif
 
 bool DJAudioPlayer::isPlaying() {
     // SIMPLIFIED: Direct transport check without soft pause complications
-    bool transport_playing = transportSource.isPlaying();
+    bool transport_playing = track->transport.isPlaying();
     
     // Log only when state changes to avoid spam
     static bool lastResult = false;
@@ -1148,69 +1864,493 @@ bool DJAudioPlayer::isPlaying() {
 }
 
 // Simple EQ/filter stubs (store values, no DSP applied yet) - optimized for real-time performance
+void DJAudioPlayer::setTrimGain(double gain) {
+    trimGain = std::clamp(gain, 0.0, 8.0);
+    postCommand(Command::Type::SetTrimGain, trimGain);
+}
+
+void DJAudioPlayer::setStemGain(int stem, float gain) {
+    if (stem < 0 || stem >= StemTrackReader::NumStems) return;
+    stemGains[(size_t) stem] = std::clamp(gain, 0.0f, 2.0f);
+    postCommand(Command::Type::SetStemGain, stem, stemGains[(size_t) stem]);
+}
+
+float DJAudioPlayer::getStemGain(int stem) const {
+    return stem >= 0 && stem < StemTrackReader::NumStems ? stemGains[(size_t) stem] : 0.0f;
+}
+
 void DJAudioPlayer::setHighGain(double v) {
     std::cout << "DJAudioPlayer::setHighGain called with: " << v << std::endl;
     highGain = std::clamp(v, -1.0, 1.0);
     // Coefficient update will happen in getNextAudioBlock for thread safety
+    postCommand(Command::Type::SetHighGain, highGain);
 }
 
 void DJAudioPlayer::setMidGain(double v) {
     std::cout << "DJAudioPlayer::setMidGain called with: " << v << std::endl;
     midGain = std::clamp(v, -1.0, 1.0);
     // Coefficient update will happen in getNextAudioBlock for thread safety
+    postCommand(Command::Type::SetMidGain, midGain);
 }
 
 void DJAudioPlayer::setLowGain(double v) {
     std::cout << "DJAudioPlayer::setLowGain called with: " << v << std::endl;
     lowGain = std::clamp(v, -1.0, 1.0);
     // Coefficient update will happen in getNextAudioBlock for thread safety
+    postCommand(Command::Type::SetLowGain, lowGain);
 }
 
 void DJAudioPlayer::setFilterCutoff(double v) {
     std::cout << "DJAudioPlayer::setFilterCutoff called with: " << v << std::endl;
     filterKnob = std::clamp(v, -1.0, 1.0);
     // Filter update will happen in getNextAudioBlock for thread safety
+    postCommand(Command::Type::SetFilter, filterKnob);
+}
+
+void DJAudioPlayer::setEffectEnabled(int effect, bool enabled) {
+    if (effect < 0 || effect >= DeckEffectRack::NumEffects) return;
+    effectSettings[(size_t) effect].enabled = enabled;
+    postCommand(Command::Type::SetEffectEnabled, effect, enabled ? 1.0 : 0.0);
+}
+
+void DJAudioPlayer::setEffectMix(int effect, double mix) {
+    if (effect < 0 || effect >= DeckEffectRack::NumEffects) return;
+    effectSettings[(size_t) effect].mix = (float) std::clamp(mix, 0.0, 1.0);
+    postCommand(Command::Type::SetEffectMix, effect, effectSettings[(size_t) effect].mix);
+}
+
+void DJAudioPlayer::setEffectAmount(int effect, double amount) {
+    if (effect < 0 || effect >= DeckEffectRack::NumEffects) return;
+    effectSettings[(size_t) effect].amount = (float) std::clamp(amount, 0.0, 1.0);
+    postCommand(Command::Type::SetEffectAmount, effect, effectSettings[(size_t) effect].amount);
+}
+
+void DJAudioPlayer::setEffectBeats(int effect, double beats) {
+    if (effect < 0 || effect >= DeckEffectRack::NumEffects) return;
+    effectSettings[(size_t) effect].beats = std::clamp(beats, 1.0 / 32.0, 32.0);
+    postCommand(Command::Type::SetEffectBeats, effect, effectSettings[(size_t) effect].beats);
+}
+
+DeckEffectRack::Settings DJAudioPlayer::getEffectSettings(int effect) const {
+    if (effect < 0 || effect >= DeckEffectRack::NumEffects) return {};
+    return effectSettings[(size_t) effect];
+}
+
+void DJAudioPlayer::setPluginInsert(std::unique_ptr<PluginInsert> insert) {
+    pluginInsert.store(insert.get(), std::memory_order_release);
+    std::unique_ptr<PluginInsert> replaced = std::move(pluginInsertOwner);
+    pluginInsertOwner = std::move(insert);
+    // A block may still be running the old one, and a sandboxed one takes its child down with it
+    RealtimeReclaimer::getInstance().retire(std::move(replaced));
+}
+
+double DJAudioPlayer::getPluginLatencySeconds() const {
+    if (!pluginInsertOwner || currentSampleRate <= 0.0) return 0.0;
+    return pluginInsertOwner->getLatencySamples() / currentSampleRate;
 }
 
 void DJAudioPlayer::enableLoop(double startSec, double lengthSec) {
     if (lengthSec <= 0.0) { disableLoop(); return; }
-    double len = transportSource.getLengthInSeconds();
+    double len = track->transport.getLengthInSeconds();
     loopStartSec = std::max(0.0, std::min(startSec, len));
     loopEndSec = std::max(loopStartSec, std::min(loopStartSec + lengthSec, len));
     loopEnabled = (loopEndSec > loopStartSec);
+    if (loopEnabled) {
+        postCommand(Command::Type::SetLoop, loopStartSec, loopEndSec);
+        if (!cacheLoopRegion(loopStartSec, loopEndSec))
+            setPrefetchPoint(DeckReadAheadSource::LoopSlot, loopStartSec);
+    }
+    else disableLoop();
     
     // DEBUG: Log actual loop parameters
-    qDebug() << "DJAudioPlayer::enableLoop - StartSec:" << startSec 
-             << "LengthSec:" << lengthSec
-             << "ActualStart:" << loopStartSec
-             << "ActualEnd:" << loopEndSec
-             << "ActualLength:" << (loopEndSec - loopStartSec)
-             << "Enabled:" << loopEnabled;
+    std::cout << "DJAudioPlayer::enableLoop - StartSec: " << startSec
+              << " LengthSec: " << lengthSec
+              << " ActualStart: " << loopStartSec
+              << " ActualEnd: " << loopEndSec
+              << " ActualLength: " << (loopEndSec - loopStartSec)
+              << " Enabled: " << loopEnabled << std::endl;
 }
 
 void DJAudioPlayer::disableLoop() {
     loopEnabled = false;
     loopStartSec = 0.0;
     loopEndSec = 0.0;
+    postCommand(Command::Type::ClearLoop);
+    if (track->readAheadSource) track->readAheadSource->clearLoopRegion();
+}
+
+bool DJAudioPlayer::cacheLoopRegion(double startSec, double endSec) {
+    if (!track->readAheadSource || !track->readerSource || !track->readerSource->getAudioFormatReader()) return false;
+    const double sourceRate = track->readerSource->getAudioFormatReader()->sampleRate;
+    return track->readAheadSource->setLoopRegion((juce::int64) std::llround(startSec * sourceRate),
+                                          (juce::int64) std::llround(endSec * sourceRate));
 }
 
 void DJAudioPlayer::setScratchVelocity(double velocity) {
-    // Store velocity for potential future use (e.g., inertia, vinyl emu)
-    // Actual scratch audio is driven by setPositionRelative() from the UI.
+    // Informational: while scratching the audio thread derives the velocity from the
+    // trajectory pushed with pushScratchPosition()
     scratchVelocity = velocity;
+    postCommand(Command::Type::SetScratchVelocity, velocity);
 }
 
 void DJAudioPlayer::enableScratch(bool enable) {
-    // Toggle scratch mode. During scratching, UI drives position updates and we keep audio flowing.
+    // Toggle scratch mode. While it is on, pushScratchPosition() drives the playhead.
     scratchMode = enable;
+    postCommand(Command::Type::EnableScratch, enable ? 1.0 : 0.0);
     // Ensure we don't emit stale buffered audio right after toggling
-    pausedResetPending.store(true);
+    postCommand(Command::Type::ResetAfterPause);
     // Never hard-mute here; scratching should remain audible if transport is running
 }
 
+void DJAudioPlayer::renderScratch(const AudioSourceChannelInfo &bufferToFill) {
+    RealtimeAllocGuard::Scope rtGuard;
+    auto& out = *bufferToFill.buffer;
+    const int outChannels = std::min(out.getNumChannels(), scratchWindow.getNumChannels());
+    if (scratchWindow.getNumSamples() == 0 || currentSampleRate <= 0.0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    // Entering from a running deck: what it would have played next fades into the hand
+    if (scratchFadeOnEntry) {
+        scratchFadeOnEntry = false;
+        renderScratchFade(scratchEntrySec, scratchEntryVelocity);
+    }
+
+    const juce::uint64 startNs = DeckMixer::nowNs();
+    const double nsPerSample = 1.0e9 / currentSampleRate;
+    // Timecode: a relative run moves the track from where the record was picked up
+    const bool timecode = timecodeBlock != nullptr && timecodeSamples > 0;
+    if (timecode && timecodeAbsolute) {
+        timecodeOffsetSec = 0.0;
+        timecodeRelative = false;
+    } else if (timecode && !timecodeRelative) {
+        timecodeOffsetSec = scratchInput.getPosition() - timecodeBlock[0];
+        timecodeRelative = true;
+    }
+    for (int done = 0; done < bufferToFill.numSamples; ) {
+        const int n = std::min(ScratchChunk, bufferToFill.numSamples - done);
+        const double* pos = scratchPositions.data();
+        if (timecode) {
+            // Samples past what the decoder had (a block bigger than announced) hold the last one
+            for (int i = 0; i < n; ++i)
+                scratchPositions[(size_t) i] = timecodeBlock[std::min(done + i, timecodeSamples - 1)] + timecodeOffsetSec;
+            scratchInput.follow(pos, n);
+        } else {
+            scratchInput.render(scratchPositions.data(), n, startNs + (juce::uint64) (done * nsPerSample));
+        }
+        const auto range = std::minmax_element(pos, pos + n);
+        // Four-point interpolation reads one frame before and two after each position
+        prepareScratchWindow((juce::int64) std::floor(*range.first * currentSampleRate) - 1,
+                             (juce::int64) std::floor(*range.second * currentSampleRate) + 3);
+        interpolateScratch(pos, n, out, bufferToFill.startSample + done, outChannels);
+        done += n;
+    }
+    for (int ch = outChannels; ch < out.getNumChannels(); ++ch)
+        out.clear(ch, bufferToFill.startSample, bufferToFill.numSamples);
+    // Effects and the playhead snapshot see the motion as it is played
+    rt.scratchVelocity = scratchInput.getVelocity();
+}
+
+void DJAudioPlayer::interpolateScratch(const double* pos, int n, AudioBuffer<float>& out, int startSample, int numChannels) {
+    constexpr juce::int64 mask = ScratchWindowFrames - 1;
+    for (int ch = 0; ch < numChannels; ++ch) {
+        const float* ring = scratchWindow.getReadPointer(ch);
+        float* dst = out.getWritePointer(ch, startSample);
+        // Outside the window (preroll, past the end, not decoded yet) is silence
+        auto frameAt = [&](juce::int64 f) {
+            return f >= scratchWindowStart && f < scratchWindowEnd ? ring[f & mask] : 0.0f;
+        };
+        for (int i = 0; i < n; ++i) {
+            const double frame = pos[i] * currentSampleRate;
+            const juce::int64 f = (juce::int64) std::floor(frame);
+            const float t = (float) (frame - (double) f);
+            const float y0 = frameAt(f - 1), y1 = frameAt(f), y2 = frameAt(f + 1), y3 = frameAt(f + 2);
+            // Cubic Hermite (Catmull-Rom)
+            const float c1 = 0.5f * (y2 - y0);
+            const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+            const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+            dst[i] = ((c3 * t + c2) * t + c1) * t + y1;
+        }
+    }
+}
+
+void DJAudioPlayer::renderScratchFade(double fromSec, double velocity) {
+    if (scratchWindow.getNumSamples() == 0 || currentSampleRate <= 0.0) return;
+    for (int i = 0; i < ScratchFadeFrames; ++i)
+        scratchFadePositions[(size_t) i] = fromSec + velocity * (double) i / currentSampleRate;
+    const auto range = std::minmax_element(scratchFadePositions.begin(), scratchFadePositions.end());
+    prepareScratchWindow((juce::int64) std::floor(*range.first * currentSampleRate) - 1,
+                         (juce::int64) std::floor(*range.second * currentSampleRate) + 3);
+    interpolateScratch(scratchFadePositions.data(), ScratchFadeFrames, scratchFade, 0, scratchFade.getNumChannels());
+    scratchFadePos = 0;
+}
+
+void DJAudioPlayer::mixScratchFade(const AudioSourceChannelInfo &bufferToFill) {
+    if (scratchFadePos >= ScratchFadeFrames) return;
+    const int n = std::min(bufferToFill.numSamples, ScratchFadeFrames - scratchFadePos);
+    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch) {
+        const float* from = scratchFade.getReadPointer(std::min(ch, scratchFade.getNumChannels() - 1), scratchFadePos);
+        float* dst = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
+        for (int i = 0; i < n; ++i) {
+            // Raised cosine; both sides play the same audio, so a linear-sum fade keeps the level
+            const float x = (float) (scratchFadePos + i + 1) / (float) (ScratchFadeFrames + 1);
+            const float in = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::pi * x);
+            dst[i] = dst[i] * in + from[i] * (1.0f - in);
+        }
+    }
+    scratchFadePos += n;
+}
+
+void DJAudioPlayer::prepareScratchWindow(juce::int64 firstFrame, juce::int64 endFrame) {
+    auto& transport = rtTrack->transport;
+    const juce::int64 lengthFrames = (juce::int64) (transport.getLengthInSeconds() * currentSampleRate);
+    firstFrame = std::max<juce::int64>(0, firstFrame);
+    endFrame = std::min(endFrame, lengthFrames);
+    if (endFrame <= firstFrame) return;
+
+    // Decoded into RAM at the device rate: read right where the hand is, without the transport
+    // or a seek in between, so a reseat costs nothing and never underruns
+    InMemoryTrackReader* ram = rtTrack->ramReader;
+    if (ram != nullptr && ram->sampleRate == currentSampleRate) {
+        if (!scratchWindowValid || firstFrame < scratchWindowStart || endFrame - scratchWindowEnd > ScratchWindowFrames / 2) {
+            scratchWindowStart = scratchWindowEnd = firstFrame;
+            scratchWindowValid = true;
+        }
+        const float gain = transport.getGain();
+        while (scratchWindowEnd < endFrame) {
+            const int n = (int) std::min<juce::int64>(endFrame - scratchWindowEnd, ScratchPullFrames);
+            ram->read(&scratchPull, 0, n, scratchWindowEnd, true, true);
+            if (gain != 1.0f) scratchPull.applyGain(0, n, gain);
+            appendScratchWindow(n);
+        }
+        return;
+    }
+
+    // Reseat when this is a new scratch, something else moved the transport, the hand went back
+    // past the window or jumped too far ahead to stream there. The transport's read position is
+    // off by what its sample rate converter holds, hence the slack.
+    const bool transportMoved = std::abs(transport.getNextReadPosition() - scratchWindowEnd) > 2 * ScratchPullFrames;
+    if (!scratchWindowValid || transportMoved
+        || firstFrame < scratchWindowStart || endFrame - scratchWindowEnd > ScratchWindowFrames / 2) {
+        scratchWindowStart = scratchWindowEnd = std::max<juce::int64>(0, firstFrame - ScratchBackfillFrames);
+        transport.setNextReadPosition(scratchWindowStart);
+        scratchWindowValid = true;
+    }
+
+    DeckReadAheadSource* readAhead = rtTrack->readAheadSource.get();
+    while (scratchWindowEnd < endFrame) {
+        const int n = (int) std::min<juce::int64>(endFrame - scratchWindowEnd, ScratchPullFrames);
+        AudioSourceChannelInfo pull(&scratchPull, 0, n);
+        const int underrunsBefore = readAhead ? readAhead->getUnderrunCount() : 0;
+        transport.getNextAudioBlock(pull);
+        if (readAhead && readAhead->getUnderrunCount() != underrunsBefore) {
+            // Not decoded yet after the seek: keep the gap silent and ask again next block,
+            // rather than caching the silence
+            transport.setNextReadPosition(scratchWindowEnd);
+            return;
+        }
+        appendScratchWindow(n);
+    }
+}
+
+void DJAudioPlayer::appendScratchWindow(int n) {
+    constexpr juce::int64 mask = ScratchWindowFrames - 1;
+    for (int ch = 0; ch < scratchWindow.getNumChannels(); ++ch) {
+        const int srcCh = std::min(ch, scratchPull.getNumChannels() - 1);
+        const int at = (int) (scratchWindowEnd & mask);
+        const int first = std::min(n, ScratchWindowFrames - at);
+        scratchWindow.copyFrom(ch, at, scratchPull, srcCh, 0, first);
+        if (first < n) scratchWindow.copyFrom(ch, 0, scratchPull, srcCh, first, n - first);
+    }
+    scratchWindowEnd += n;
+    scratchWindowStart = std::max(scratchWindowStart, scratchWindowEnd - ScratchWindowFrames);
+}
+
+void DJAudioPlayer::endScratch() {
+    // Normal playback continues from where the record was let go; the record going on at the
+    // speed it was let go with fades into it (rendered now, while the window still has it)
+    const double endSec = scratchInput.getPosition();
+    renderScratchFade(endSec, scratchInput.getVelocity());
+    if (endSec < 0.0) {
+        rtTrack->transport.setPosition(0.0);
+        enterPreroll(endSec);
+    } else {
+        rtTrack->transport.setPosition(std::min(endSec, rtTrack->transport.getLengthInSeconds()));
+    }
+    timecodeRelative = false;
+    flushPipeline();
+}
+
+void DJAudioPlayer::flushPipeline() {
+    resampleSource.flushBuffers();
+    rt.scratchVelocity = 0.0;
+    scratchWindowValid = false;
+#if defined(RUBBERBAND_FOUND)
+    // The stretcher still holds audio from before the jump
+    if (rbReady && rb) {
+        rb->reset();
+        rbPaddedStartDone = false;
+        rbDiscardOutRemaining = 0;
+    }
+#endif
+}
+
+void DJAudioPlayer::brake(double beats, juce::uint64 timeNs) {
+    postCommand(Command::Type::Brake, beats, (double) timeNs);
+}
+
+void DJAudioPlayer::spinback(double beats, juce::uint64 timeNs) {
+    postCommand(Command::Type::Spinback, beats, (double) timeNs);
+}
+
+void DJAudioPlayer::censor(bool held, juce::uint64 timeNs) {
+    postCommand(Command::Type::Censor, held ? 1.0 : 0.0, (double) timeNs);
+}
+
+void DJAudioPlayer::triggerSlice(int slice) {
+    if (slice < 0 || slice >= DeckSlicer::NumSlices) return;
+    postCommand(Command::Type::Slice, slice, quantizeEnabled ? 1.0 : 0.0);
+}
+
+void DJAudioPlayer::releaseSlice() {
+    postCommand(Command::Type::Slice, -1.0);
+}
+
+bool DJAudioPlayer::canSlice() const {
+    return track->ramReader != nullptr && track->ramReader->sampleRate == getDeviceSampleRate() && getBeatGrid() != nullptr;
+}
+
+void DJAudioPlayer::applyPendingMotion() {
+    const Command cmd = rt.pendingMotion;
+    auto& motion = rt.motion;
+    if (cmd.type == Command::Type::Censor && cmd.value == 0.0) {
+        if (motion.kind == Motion::Censor) endMotion(motion.shadowSec);
+        return;
+    }
+
+    // Only a record spinning along its timeline can be stopped or turned around
+    const double ratio = playbackRatio();
+    if (motion.kind != Motion::None || rt.scratchMode || inPrerollMode || rtTrack->readerSource == nullptr
+        || !rtTrack->transport.isPlaying() || softPaused.load() || forceSilent.load()
+        || scratchWindow.getNumSamples() == 0 || currentSampleRate <= 0.0 || ratio <= 0.0)
+        return;
+
+    const double startSec = audiblePositionSeconds();
+    motion = {};
+    motion.positionSec = motion.shadowSec = startSec;
+    if (cmd.type == Command::Type::Censor) {
+        motion.kind = Motion::Censor;
+        motion.velocity = -ratio;
+    } else {
+        motion.kind = cmd.type == Command::Type::Brake ? Motion::Brake : Motion::Spinback;
+        motion.velocity = cmd.type == Command::Type::Brake ? ratio : -SpinbackSpeed;
+        // Beats at the deck's tempo; without a BPM, half a second each
+        const double beatSec = (rt.beatBpm > 0.0 ? 60.0 / rt.beatBpm : 0.5) / ratio;
+        const double stopSamples = std::max(1.0, std::max(0.0, cmd.value) * beatSec * currentSampleRate);
+        motion.decay = std::exp(std::log(MotionRestSpeed) / stopSamples);
+    }
+    motion.startSpeed = std::abs(motion.velocity);
+    motionRunning.store(true);
+    slicer.reset();
+
+    // The deck's own output fades into the motion, as into a scratch
+    scratchWindowValid = false;
+    renderScratchFade(startSec, ratio);
+}
+
+void DJAudioPlayer::renderMotion(const AudioSourceChannelInfo &bufferToFill) {
+    RealtimeAllocGuard::Scope rtGuard;
+    auto& motion = rt.motion;
+    auto& out = *bufferToFill.buffer;
+    const int outChannels = std::min(out.getNumChannels(), scratchWindow.getNumChannels());
+    if (motion.parked || scratchWindow.getNumSamples() == 0 || currentSampleRate <= 0.0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    const double dt = 1.0 / currentSampleRate;
+    const bool winding = motion.kind != Motion::Censor;
+    // Near the end of a brake or spinback the level follows the speed down, like a platter's
+    auto levelAt = [&motion](double velocity) {
+        return (float) std::min(1.0, std::abs(velocity) / (MotionFadeSpeed * motion.startSpeed));
+    };
+    int done = 0;
+    while (done < bufferToFill.numSamples) {
+        const int n = std::min(ScratchChunk, bufferToFill.numSamples - done);
+        const float levelBefore = levelAt(motion.velocity);
+        for (int i = 0; i < n; ++i) {
+            scratchPositions[(size_t) i] = motion.positionSec;
+            motion.positionSec += motion.velocity * dt;
+            if (winding) motion.velocity *= motion.decay;
+        }
+        const double* pos = scratchPositions.data();
+        const auto range = std::minmax_element(pos, pos + n);
+        prepareScratchWindow((juce::int64) std::floor(*range.first * currentSampleRate) - 1,
+                             (juce::int64) std::floor(*range.second * currentSampleRate) + 3);
+        interpolateScratch(pos, n, out, bufferToFill.startSample + done, outChannels);
+        if (winding) {
+            for (int ch = 0; ch < outChannels; ++ch)
+                out.applyGainRamp(ch, bufferToFill.startSample + done, n, levelBefore, levelAt(motion.velocity));
+        }
+        done += n;
+
+        if (winding && (std::abs(motion.velocity) < MotionRestSpeed * motion.startSpeed || motion.positionSec <= 0.0)) {
+            // At rest: silent from here until the UI pauses the deck
+            motion.positionSec = std::max(0.0, motion.positionSec);
+            motion.velocity = 0.0;
+            motion.parked = true;
+            motionStopped.store(true);
+            for (int ch = 0; ch < outChannels; ++ch)
+                out.clear(ch, bufferToFill.startSample + done, bufferToFill.numSamples - done);
+            break;
+        }
+    }
+    for (int ch = outChannels; ch < out.getNumChannels(); ++ch)
+        out.clear(ch, bufferToFill.startSample, bufferToFill.numSamples);
+
+    if (motion.kind == Motion::Censor) {
+        // Where the track would be; a loop keeps it going round
+        motion.shadowSec += playbackRatio() * bufferToFill.numSamples * dt;
+        if (rt.loopEnabled && motion.shadowSec >= rt.loopEndSec)
+            motion.shadowSec = rt.loopStartSec + std::fmod(motion.shadowSec - rt.loopStartSec, rt.loopEndSec - rt.loopStartSec);
+        motion.shadowSec = std::min(motion.shadowSec, rtTrack->transport.getLengthInSeconds());
+    }
+    // Effects and the playhead snapshot see the motion as it is played
+    rt.scratchVelocity = motion.velocity;
+}
+
+void DJAudioPlayer::endMotion(double resumeSec) {
+    // Like letting go of a scratch: the motion carrying on fades into normal playback
+    if (!rt.motion.parked) renderScratchFade(rt.motion.positionSec, rt.motion.velocity);
+    rtTrack->transport.setPosition(std::clamp(resumeSec, 0.0, rtTrack->transport.getLengthInSeconds()));
+    rt.motion = {};
+    motionRunning.store(false);
+    flushPipeline();
+}
+
+void DJAudioPlayer::setSlipEnabled(bool enabled) {
+    slipEnabled = enabled;
+    postCommand(Command::Type::SetSlip, enabled ? 1.0 : 0.0);
+}
+
+void DJAudioPlayer::beginSlipHold() {
+    postCommand(Command::Type::SlipHold, 1.0);
+}
+
+void DJAudioPlayer::endSlipHold() {
+    postCommand(Command::Type::SlipHold, 0.0);
+}
+
 void DJAudioPlayer::setKeylockEnabled(bool enabled) {
     // Defer to audio thread to avoid races with getNextAudioBlock
-    keylockChangePending.store(enabled ? 1 : 0);
+    keylockEnabled = enabled;
+    postCommand(Command::Type::SetKeylock, enabled ? 1.0 : 0.0);
+}
+
+void DJAudioPlayer::setKeyShift(double semitones) {
+    keyShiftSemitones = juce::jlimit(-MaxKeyShift, MaxKeyShift, semitones);
+    postCommand(Command::Type::SetKeyShift, keyShiftSemitones);
 }
 
 void DJAudioPlayer::setQuantizeEnabled(bool enabled) {
@@ -1222,10 +2362,55 @@ void DJAudioPlayer::setBeatInfo(double bpm, double firstBeatOffset, double track
     trackBpm = bpm;
     trackFirstBeatOffset = firstBeatOffset;
     trackLengthSec = trackLength;
+    postCommand(Command::Type::SetBeatInfo, bpm, firstBeatOffset);
+}
+
+juce::int64 DJAudioPlayer::timelineFrame() const noexcept {
+    return inPrerollMode ? rt.prerollFrame : rtTrack->transport.getNextReadPosition();
+}
+
+juce::int64 DJAudioPlayer::audibleFrame() const noexcept {
+    // The transport position is where decoding is, not what is heard: take off the resampler's
+    // look-ahead and, with keylock, the input still sitting inside the stretcher. The count-in
+    // has nothing in the pipeline.
+    if (inPrerollMode) return rt.prerollFrame;
+    double lookAhead = resampleSource.getBufferedInputSamples();
+#if defined(RUBBERBAND_FOUND)
+    if (stretcherEngaged() && rbReady && rb)
+        lookAhead += (double) rbInputFedTotal - rbOutputInputPos;
+#endif
+    return std::max<juce::int64>(0, rtTrack->transport.getNextReadPosition() - (juce::int64) std::llround(lookAhead));
+}
+
+void DJAudioPlayer::enterPreroll(double seconds) noexcept {
+    rt.prerollFrame = std::min<juce::int64>(-1, secondsFrame(seconds));
+    prerollPosition = frameSeconds(rt.prerollFrame) / prerollTimeSec;
+    inPrerollMode = true;
+}
+
+void DJAudioPlayer::leavePreroll() noexcept {
+    inPrerollMode = false;
+    prerollPosition = 0.0;
+    rt.prerollFrame = 0;
+}
+
+bool DJAudioPlayer::getBeatClock(BeatClock& clock) const {
+    if (rtTrack->readerSource == nullptr || rt.beatBpm <= 0.0 || offTimeline()) return false;
+    if (!rtTrack->transport.isPlaying() || softPaused.load() || inPrerollMode) return false;
+
+    clock.positionSec = audiblePositionSeconds();
+    clock.bpm = rt.beatBpm;
+    clock.firstBeatSec = rt.firstBeatSec;
+    clock.tempo = rt.speed;
+    clock.ratio = playbackRatio();
+    return true;
 }
 
 double DJAudioPlayer::quantizePosition(double positionSec) const {
-    if (!quantizeEnabled || trackBpm <= 0.0) {
+    if (!quantizeEnabled) return positionSec;
+    if (auto grid = getBeatGrid()) return grid->getNearestBeatTime(positionSec);
+
+    if (trackBpm <= 0.0) {
         return positionSec; // No quantization if disabled or no BPM info
     }
     
@@ -1243,4 +2428,124 @@ double DJAudioPlayer::quantizePosition(double positionSec) const {
     
     // Ensure position is within track bounds
     return std::clamp(quantizedPos, 0.0, trackLengthSec);
-}
\ No newline at end of file
+}
+void DJAudioPlayer::publishPositionSnapshot(juce::uint64 blockEndNs) {
+    PositionSnapshot snap;
+    snap.hostTimeNs = blockEndNs;
+    snap.lengthSec = rtTrack->transport.getLengthInSeconds();
+    snap.prerollSec = prerollTimeSec;
+    snap.loopEnabled = rt.loopEnabled;
+    snap.loopStartSec = rt.loopStartSec;
+    snap.loopEndSec = rt.loopEndSec;
+
+    const bool running = rtTrack->readerSource != nullptr && rtTrack->transport.isPlaying()
+                         && !softPaused.load() && !forceSilent.load();
+    if (rt.scratchMode) {
+        // Wherever the hand is; the UI draws its own drag meanwhile, nothing to extrapolate
+        snap.positionSec = scratchInput.getPosition();
+        snap.ratio = 0.0;
+    } else if (rt.motion.kind != Motion::None) {
+        snap.positionSec = rt.motion.positionSec;
+        snap.ratio = 0.0;
+    } else {
+        // A stopped deck shows where it will start, not the audio still queued in the pipeline;
+        // the count-in runs in real time, whatever the tempo
+        snap.positionSec = frameSeconds(running ? audibleFrame() : timelineFrame());
+        snap.ratio = !running ? 0.0 : inPrerollMode ? 1.0 : playbackRatio();
+    }
+    positionSnapshot.store(snap);
+}
+
+double DJAudioPlayer::PositionSnapshot::positionAt(juce::uint64 nowNs) const {
+    // Only forward: a late block must not pull the playhead backwards
+    const double elapsed = nowNs > hostTimeNs ? (double) (nowNs - hostTimeNs) * 1.0e-9 : 0.0;
+    double pos = positionSec + ratio * std::min(elapsed, 0.25);
+
+    // Cross the count-in boundary at track start, and stay inside an active loop
+    if (positionSec < 0.0 && pos >= 0.0) return pos;
+    if (loopEnabled && loopEndSec > loopStartSec && positionSec < loopEndSec && pos >= loopEndSec)
+        pos = loopStartSec + std::fmod(pos - loopStartSec, loopEndSec - loopStartSec);
+    return lengthSec > 0.0 ? std::min(pos, lengthSec) : pos;
+}
+
+double DJAudioPlayer::PositionSnapshot::relativeAt(juce::uint64 nowNs) const {
+    const double pos = positionAt(nowNs);
+    if (pos < 0.0) return prerollSec > 0.0 ? pos / prerollSec : 0.0;
+    return lengthSec > 0.0 ? pos / lengthSec : 0.0;
+}
+
+void DJAudioPlayer::captureAutomationState() {
+    if (automation == nullptr || !automation->isRecording()) return;
+
+    auto logCommand = [this](Command::Type type, double value, double value2 = 0.0) {
+        automation->record(automationDeck, MixAutomation::Kind::DeckCommand, value, value2, (int) type);
+    };
+    logCommand(Command::Type::SetBeatInfo, trackBpm, trackFirstBeatOffset);
+    logCommand(Command::Type::SetKeylock, keylockEnabled ? 1.0 : 0.0);
+    logCommand(Command::Type::SetKeyShift, keyShiftSemitones);
+    logCommand(Command::Type::SetSpeed, currentSpeed);
+    logCommand(Command::Type::SetHighGain, highGain);
+    logCommand(Command::Type::SetMidGain, midGain);
+    logCommand(Command::Type::SetLowGain, lowGain);
+    logCommand(Command::Type::SetFilter, filterKnob);
+    logCommand(Command::Type::SetTrimGain, trimGain);
+    for (int s = 0; s < StemTrackReader::NumStems; ++s)
+        logCommand(Command::Type::SetStemGain, s, stemGains[(size_t) s]);
+    logCommand(Command::Type::SetSlip, slipEnabled ? 1.0 : 0.0);
+    if (loopEnabled) logCommand(Command::Type::SetLoop, loopStartSec, loopEndSec);
+    for (int i = 0; i < DeckEffectRack::NumEffects; ++i) {
+        const auto& fx = effectSettings[(size_t) i];
+        logCommand(Command::Type::SetEffectMix, i, fx.mix);
+        logCommand(Command::Type::SetEffectAmount, i, fx.amount);
+        logCommand(Command::Type::SetEffectBeats, i, fx.beats);
+        logCommand(Command::Type::SetEffectEnabled, i, fx.enabled ? 1.0 : 0.0);
+    }
+
+    if (inPrerollMode) logCommand(Command::Type::SeekPreroll, prerollPosition.load());
+    else logCommand(Command::Type::Seek, softPaused.load() ? pausedPosSec : track->transport.getCurrentPosition());
+    if (track->transport.isPlaying() && !softPaused.load())
+        automation->record(automationDeck, MixAutomation::Kind::Play);
+}
+
+void DJAudioPlayer::applyAutomationCommand(Command::Type type, double value, double value2) {
+    // Recorded values are already quantized/clamped, the public setters keep the UI-side copies
+    // (resume position, loop bounds, ...) consistent with what the live deck had
+    switch (type) {
+        case Command::Type::SetSpeed: setSpeed(value); break;
+        case Command::Type::Seek: setPositionSeconds(value); break;
+        case Command::Type::SeekPreroll: setPositionRelative(value); break;
+        case Command::Type::SetLoop: enableLoop(value, value2 - value); break;
+        case Command::Type::ClearLoop: disableLoop(); break;
+        case Command::Type::SetHighGain: setHighGain(value); break;
+        case Command::Type::SetMidGain: setMidGain(value); break;
+        case Command::Type::SetLowGain: setLowGain(value); break;
+        case Command::Type::SetFilter: setFilterCutoff(value); break;
+        case Command::Type::SetTrimGain: setTrimGain(value); break;
+        case Command::Type::SetStemGain: setStemGain((int) value, (float) value2); break;
+        case Command::Type::SetKeylock: setKeylockEnabled(value != 0.0); break;
+        case Command::Type::SetKeyShift: setKeyShift(value); break;
+        case Command::Type::SetScratchVelocity: setScratchVelocity(value); break;
+        case Command::Type::EnableScratch: enableScratch(value != 0.0); break;
+        case Command::Type::SetSlip: setSlipEnabled(value != 0.0); break;
+        case Command::Type::SlipHold:
+            if (value != 0.0) beginSlipHold(); else endSlipHold();
+            break;
+        case Command::Type::Slice:
+            if (value < 0.0) releaseSlice(); else triggerSlice((int) value);
+            break;
+        case Command::Type::SetBeatInfo: setBeatInfo(value, value2, getLengthInSeconds()); break;
+        case Command::Type::SetEffectEnabled: setEffectEnabled((int) value, value2 != 0.0); break;
+        case Command::Type::SetEffectMix: setEffectMix((int) value, value2); break;
+        case Command::Type::SetEffectAmount: setEffectAmount((int) value, value2); break;
+        case Command::Type::SetEffectBeats: setEffectBeats((int) value, value2); break;
+        case Command::Type::QuantizedSeek: triggerQuantizedCue(value); break;
+        case Command::Type::BeatJump: beatJump(value); break;
+        case Command::Type::Brake: brake(value); break;
+        case Command::Type::Spinback: spinback(value); break;
+        case Command::Type::Censor: censor(value != 0.0); break;
+        case Command::Type::ResetAfterPause:
+        case Command::Type::CancelPausedReset:
+            // Posted again by start()/stop()/enableScratch() during replay
+            break;
+    }
+}
@@ -8,12 +8,27 @@
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <mutex>
 using namespace juce;
 #include <queue>
+#include "LockFreeQueue.h"
+#include "DeckEqProcessor.h"
+#include "DeckEffectRack.h"
+#include "DeckReadAheadSource.h"
+#include "VarispeedResampler.h"
+#include "ScratchTrajectory.h"
+#include "MixAutomation.h"
+#include "BeatGrid.h"
+#include "RealtimeReclaimer.h"
+#include "StemTrackReader.h"
+#include "DeckSlicer.h"
 #if defined(RUBBERBAND_FOUND)
 #include <rubberband/RubberBandStretcher.h>
 #endif
 
+class InMemoryTrackReader;
+class PluginInsert;
+
 /**
  * A class to handle the audio functionality of a DJ deck. Works in tandem with the DeckGUI to represent a DJ deck
  * in the application
@@ -23,9 +38,71 @@ public:
     explicit DJAudioPlayer(AudioFormatManager &_formatManager);
     ~DJAudioPlayer() override;
 
+    // Typed control message: posted by the UI thread, applied at the top of getNextAudioBlock
+    struct Command {
+        enum class Type {
+            SetSpeed,           // value = speed ratio
+            Seek,               // value = position in seconds (already quantized)
+            SeekPreroll,        // value = negative relative preroll position
+            SetLoop,            // value = start sec, value2 = end sec
+            ClearLoop,
+            SetHighGain,        // value = -1..+1
+            SetMidGain,
+            SetLowGain,
+            SetFilter,          // value = -1..+1
+            SetKeylock,         // value = 0/1
+            SetScratchVelocity, // value = velocity
+            EnableScratch,      // value = 0/1
+            ResetAfterPause,    // one-time stretcher reset once transport is idle
+            CancelPausedReset,
+            SetSlip,            // value = 0/1
+            SlipHold,           // value = 0/1 (hot cue held)
+            SetBeatInfo,        // value = bpm, value2 = first beat offset (sec)
+            SetEffectEnabled,   // value = DeckEffectRack::Effect, value2 = 0/1
+            SetEffectMix,       // value = effect, value2 = 0..1
+            SetEffectAmount,    // value = effect, value2 = 0..1
+            SetEffectBeats,     // value = effect, value2 = beats
+            QuantizedSeek,      // value = target sec; a playing deck leaves on the next grid beat
+            BeatJump,           // value = beats (negative = back) from the position at that block
+            SetTrimGain,        // value = linear gain
+            SetKeyShift,        // value = semitones
+            Brake,              // value = beats to a stop, value2 = DeckMixer::nowNs() of the trigger (0 = now)
+            Spinback,           // value = beats to a stop, value2 = trigger time
+            Censor,             // value = 1 held / 0 released, value2 = trigger time
+            SetStemGain,        // value = StemTrackReader::Stem, value2 = linear gain
+            Slice               // value = slice 0..7 (-1 = released), value2 = 0/1 quantized
+        };
+        Type type{Type::SetSpeed};
+        double value{0.0};
+        double value2{0.0};
+        juce::uint64 postedNs{0};   // DeckMixer::nowNs() when posted; places continuous controls in the block
+    };
+    // "SetSpeed", ... for logs and reports; "?" for a value outside the enum
+    static const char* getCommandName(Command::Type type) noexcept;
+
+    // Controller thread (ControllerInput): a control change that bypasses the UI. It has its own
+    // queue, so the UI and the controller are each the single producer of one; no automation
+    // logging and no UI-side copies here, the UI mirrors the change through the normal setters.
+    bool postControllerCommand(Command::Type type, double value = 0.0, double value2 = 0.0) noexcept;
+
     void loadFile(const File &file);
-    // NEW: Apply a pre-loaded audio source (for threaded loading)
-    void applyLoadedSource(std::unique_ptr<AudioFormatReaderSource> source, double sampleRate);
+    // Threaded loading: the loader builds the track's playback chain with prepareTrack() and the
+    // UI hands it over with applyLoadedTrack(); the audio thread swaps it in at a block boundary
+    struct LoadedTrack;
+    // Any thread: reader, read-ahead stage, transport and stretcher, all prepared for the
+    // device; nullptr if the source has no reader
+    std::unique_ptr<LoadedTrack> prepareTrack(std::unique_ptr<AudioFormatReaderSource> source, double sampleRate) const;
+    // UI thread: play `next` from the next block on (a playing deck keeps playing, from its start)
+    void applyLoadedTrack(std::unique_ptr<LoadedTrack> next);
+    // UI thread: `next` is the loaded track played another way (e.g. from its stems, which are
+    // sample aligned with it); it takes over at the current place. Only while the deck is
+    // paused or stopped, so nothing audible jumps; false (and `next` is dropped) otherwise.
+    bool replaceTrackInPlace(std::unique_ptr<LoadedTrack> next);
+    // UI thread, periodically: hand replaced tracks the audio thread has let go of to the
+    // RealtimeReclaimer
+    void collectRetiredTracks();
+    // Rate the device last prepared the deck at; 0 before the first prepareToPlay (any thread)
+    double getDeviceSampleRate() const { return getTrackSetup().sampleRate; }
     void setGain(double gain);
     void setSpeed(double ratio);
     void setPositionRelative(double pos);
@@ -35,22 +112,55 @@ public:
     // Pause is an alias to stop playback without unloading the track
     void pause() { stop(); }
     bool isPlaying();
+    // stop() keeps the transport running and silent: isPlaying() stays true meanwhile
+    bool isSoftPaused() const { return softPaused.load(); }
+    // UI thread: start the transport parked (soft-paused) at positionSec, for DeckMixer to start
+    // the deck at an exact sample later (startArmed, an AutoDJ transition). start() and stop()
+    // disarm it. False without a track.
+    bool armStart(double positionSec);
+    bool isArmed() const { return armed.load(); }
+    // Audio thread (DeckMixer, before this deck renders): an armed deck begins playing
+    // sampleInBlock samples into its next block; false if it isn't armed
+    bool startArmed(int sampleInBlock) noexcept;
     // Transport helpers
-    double getCurrentPositionSeconds() const { return transportSource.getCurrentPosition(); }
-    double getLengthInSeconds() const { return transportSource.getLengthInSeconds(); }
+    double getCurrentPositionSeconds() const { return track->transport.getCurrentPosition(); }
+    double getLengthInSeconds() const { return track->transport.getLengthInSeconds(); }
     void setPositionSeconds(double secs) { setPosition(secs); }
+    // QUANTIZE on the audio thread: both resolve against the deck's beat grid in the block they
+    // are applied in, so the UI's event latency doesn't move them. A playing deck leaves for the
+    // cue exactly on the next beat (without quantize or a grid it seeks at once); a jump moves
+    // the playhead by whole beats and keeps its phase.
+    void triggerQuantizedCue(double cueSec);
+    void beatJump(double beats);
     // Total processing latency added by the DSP pipeline (e.g., Rubber Band), in seconds
     double getPipelineLatencySeconds() const {
+        double seconds = getPluginLatencySeconds();
 #if defined(RUBBERBAND_FOUND)
-        if (keylockEnabled && rbReady) return rbLatencySeconds;
+        if ((keylockEnabled || keyShiftSemitones != 0.0) && rbReady) seconds += rbLatencySeconds;
 #endif
-        return 0.0;
+        return seconds;
     }
+    // The plugin insert's part of it: 0 without a plugin or while it is bypassed
+    double getPluginLatencySeconds() const;
     
     // Scratch control - sets playback speed based on scratch velocity
     void setScratchVelocity(double velocity);
     void enableScratch(bool enable);
     bool isScratchMode() const { return scratchMode; }
+    // Scratch input: the record is at positionSec (negative = preroll) at timeNs, on the
+    // DeckMixer::nowNs() clock. One producer at a time (UI drag or a controller thread); while
+    // scratch mode is on the audio thread plays exactly this path, forwards and backwards.
+    void pushScratchPosition(double positionSec, juce::uint64 timeNs) { scratchInput.push(positionSec, timeNs); }
+    // Timecode vinyl (audio thread, from DeckMixer right before this deck renders): record
+    // positions for the first numSamples samples of the block. In scratch mode they drive the
+    // playhead in place of pushScratchPosition(): absolute ones are track time, relative ones
+    // move the track from where it is. Good for the next block only.
+    void setTimecodeBlock(const double* recordSec, int numSamples, bool absolute) noexcept {
+        timecodeBlock = recordSec;
+        timecodeSamples = numSamples;
+        timecodeAbsolute = absolute;
+    }
+    double getPrerollSeconds() const { return prerollTimeSec; }
 
     // Simple loop control (seconds)
     void enableLoop(double startSec, double lengthSec);
@@ -58,20 +168,115 @@ public:
     bool isLoopEnabled() const { return loopEnabled; }
     double getLoopStart() const { return loopStartSec; }
     double getLoopEnd() const { return loopEndSec; }
+
+    // Slip mode: while scratching, looping or holding a hot cue the track keeps running
+    // underneath, and playback returns to that shadow position on release. The shadow playhead
+    // is advanced by the tempo ratio on the audio thread, no second decoder is involved.
+    void setSlipEnabled(bool enabled);
+    bool isSlipEnabled() const { return slipEnabled; }
+    // Hot cue juggling: hold starts an excursion, release returns to the shadow position
+    void beginSlipHold();
+    void endSlipHold();
+    bool isSlipActive() const { return slipActive.load(std::memory_order_relaxed); }
+    double getSlipPositionSeconds() const { return slipPositionSec.load(std::memory_order_relaxed); }
+
+    // Vinyl motions of a running deck, rendered on the audio thread from the buffered samples
+    // (RAM store or scratch window) the way a scratch is; the decoder is not involved. Brake: the
+    // platter's speed falls exponentially to a stop over `beats`. Spinback: the record is flung
+    // backwards and winds down over `beats`. Both leave the deck at rest where it stopped, for
+    // takeMotionStop(). Censor: plays backwards at the tempo while held, then carries on where
+    // the track would have been. `timeNs` (DeckMixer::nowNs() of the press, 0 = next block)
+    // starts the motion inside the next block at the press's own offset: one block late, but
+    // sample-accurate and free of UI or controller jitter.
+    static constexpr double SpinbackSpeed = 3.0;     // times normal speed, backwards
+    void brake(double beats, juce::uint64 timeNs = 0);
+    void spinback(double beats, juce::uint64 timeNs = 0);
+    void censor(bool held, juce::uint64 timeNs = 0);
+    // UI thread, periodically: true once after a brake or spinback came to rest; pause the deck then
+    bool takeMotionStop() { return motionStopped.exchange(false); }
+
+    // SLICER: the eight beats of the grid around the playhead as eight slices. A held slice
+    // loops in place of the track while the track runs on underneath (DeckSlicer), and the
+    // deck carries on where it would have been on release; with quantize the slice starts on
+    // the next beat, sample-accurately. Needs a beat grid and the track in RAM at the device
+    // rate (canSlice()); nothing happens otherwise.
+    void triggerSlice(int slice);
+    void releaseSlice();
+    // UI thread: the loaded track can be sliced
+    bool canSlice() const;
     
     // Simple EQ/filter control stubs (values: -1.0 .. +1.0)
     void setHighGain(double v);
     void setMidGain(double v);
     void setLowGain(double v);
     void setFilterCutoff(double v);
+    // Level matching (AUTO GAIN): linear trim ahead of the EQ from the track's measured loudness,
+    // faded over one block
+    void setTrimGain(double gain);
+    double getTrimGain() const { return trimGain; }
+    // Stems: gain per StemTrackReader::Stem (0 mutes it), kept across tracks and applied
+    // whenever the deck plays a track from its separated stems; ramped by the reader
+    void setStemGain(int stem, float gain);
+    float getStemGain(int stem) const;
+    // UI thread: the loaded track plays from its stems
+    bool hasStems() const { return track->stemReader != nullptr; }
+
+    // Insert effects after the EQ (effect = DeckEffectRack::Effect). Times are in beats of the
+    // deck's current tempo.
+    void setEffectEnabled(int effect, bool enabled);
+    void setEffectMix(int effect, double mix);
+    void setEffectAmount(int effect, double amount);
+    void setEffectBeats(int effect, double beats);
+    DeckEffectRack::Settings getEffectSettings(int effect) const;
+    // VST3/LV2 plugin after the effect rack (nullptr removes it). The old one is destroyed off
+    // the audio thread once no block uses it any more.
+    void setPluginInsert(std::unique_ptr<PluginInsert> insert);
+    PluginInsert* getPluginInsert() const { return pluginInsertOwner.get(); }
     
     // Keylock (pitch lock) - maintains original pitch when speed changes
     void setKeylockEnabled(bool enabled);
     bool isKeylockEnabled() const { return keylockEnabled; }
+    // Key shift in semitones (+-MaxKeyShift), applied by the stretcher in the same pass as the
+    // keylock tempo. Without keylock the pitch still follows the tempo, shifted by this much.
+    // At 0 with keylock off the stretcher is bypassed.
+    static constexpr double MaxKeyShift = 12.0;
+    void setKeyShift(double semitones);
+    double getKeyShift() const { return keyShiftSemitones; }
     // Runtime keylock quality profile
     enum class KeylockQuality { Fast, Balanced, Quality };
+    // Switches without a dropout: a second stretcher is built here and cross-faded in by the
+    // audio thread. If a switch is still running, the request is started by the next call to
+    // serviceKeylockSwitch().
     void setKeylockQuality(KeylockQuality q);
     KeylockQuality getKeylockQuality() const { return rbQuality; }
+    // Profile the audio thread is actually running right now
+    KeylockQuality getActiveKeylockQuality() const;
+    bool isKeylockSwitchPending() const;
+    // UI thread, periodically: start a deferred quality switch once the previous one has finished
+    void serviceKeylockSwitch();
+
+    struct LoadedTrack {
+        std::unique_ptr<AudioFormatReaderSource> readerSource;
+        // Optional read-ahead between readerSource and the transport (declared after: dies first)
+        std::unique_ptr<DeckReadAheadSource> readAheadSource;
+        AudioTransportSource transport;
+#if defined(RUBBERBAND_FOUND)
+        // Built for this track's channels (or reset from the pool); swapped with the deck's
+        // stretcher on pickup, the retired track then carries the previous one back to the pool
+        std::unique_ptr<RubberBand::RubberBandStretcher> stretcher;
+        KeylockQuality stretcherQuality{KeylockQuality::Quality};
+        double stretcherRate{0.0};
+#endif
+        int numChannels{2};
+        // readerSource's reader when the track is decoded into RAM: scratching reads it directly
+        InMemoryTrackReader* ramReader{nullptr};
+        // readerSource's reader when the track plays from its separated stems
+        StemTrackReader* stemReader{nullptr};
+        juce::uint64 serial{0};   // order of applyLoadedTrack() calls
+    };
+    // Resampler used for non-keylock tempo and scratching
+    void setResamplerEngine(VarispeedResampler::Engine e) { resampleSource.setEngine(e); }
+    VarispeedResampler::Engine getResamplerEngine() const { return resampleSource.getEngine(); }
     
     // Quantize control - snaps cues and loops to nearest beat
     void setQuantizeEnabled(bool enabled);
@@ -82,10 +287,77 @@ public:
     double getTrackBpm() const { return trackBpm; }
     double getFirstBeatOffset() const { return trackFirstBeatOffset; }
     double getTrackLengthSeconds() const { return trackLengthSec; }
+    // The deck's beat grid, swapped in whole by the UI when an analysis delivers and read from any
+    // thread without locking; nullptr until then. The previous grid is retired, so a copy the
+    // audio thread took is never the last owner.
+    void setBeatGrid(BeatGrid::Ptr grid) {
+        RealtimeReclaimer::getInstance().retire(std::atomic_exchange(&beatGrid, std::move(grid)));
+    }
+    BeatGrid::Ptr getBeatGrid() const { return std::atomic_load(&beatGrid); }
+
+    // SYNC: beat clock of the audible output, read by DeckMixer between blocks on the audio thread
+    struct BeatClock {
+        double positionSec{0.0};    // track time at the output (pipeline look-ahead removed)
+        double bpm{0.0};            // analysed track BPM
+        double firstBeatSec{0.0};
+        double tempo{1.0};          // deck tempo as set by the UI
+        double ratio{1.0};          // track seconds per output second (tempo * sync trim)
+    };
+    // False while the deck has no steady timeline: stopped, paused, in preroll, scratching, no BPM
+    bool getBeatClock(BeatClock& clock) const;
+    // Audio thread: phase-lock trim on top of the deck tempo (1.0 = off), used from the next block
+    void setSyncTrim(double trim) noexcept { rt.syncTrim = trim; }
+    // Audio thread: deck tempo the audio thread has applied (without the trim), also while paused
+    double getRealtimeTempo() const noexcept { return rt.speed; }
+
+    // Playhead as published by the audio thread once per block. The UI extrapolates it to the
+    // moment it draws (positionAt), so it never has to read the transport itself.
+    struct PositionSnapshot {
+        double positionSec{0.0};    // audible track time at hostTimeNs; negative = preroll count-in
+        double lengthSec{0.0};
+        double prerollSec{8.0};     // preroll span, for the relative (negative) preroll position
+        double ratio{0.0};          // track seconds per second (0 while not advancing)
+        juce::uint64 hostTimeNs{0}; // when positionSec is heard (DeckMixer::nowNs() clock)
+        bool loopEnabled{false};
+        double loopStartSec{0.0};
+        double loopEndSec{0.0};
+
+        double positionAt(juce::uint64 nowNs) const;
+        // Same value range as getPositionRelative(): 0..1 in the track, negative in preroll
+        double relativeAt(juce::uint64 nowNs) const;
+    };
+    // Audio thread (DeckMixer, after the block rendered): heard-at time of the block's end
+    void publishPositionSnapshot(juce::uint64 blockEndNs);
+    // Audio thread (DeckMixer, after the block rendered): high-resolution ticks the block spent
+    // pulling from the track source and in the EQ; the rest is resampling / keylock
+    struct StageTicks {
+        juce::int64 decode{0};
+        juce::int64 eq{0};
+    };
+    StageTicks takeStageTicks() noexcept;
+    // Audio thread, after getNextAudioBlock: the block was silence (stopped, paused, preroll,
+    // no track), so a mixer can leave it out of its sums
+    bool wasBlockSilent() const noexcept { return !renderedAudio; }
+    PositionSnapshot getPositionSnapshot() const { return positionSnapshot.load(); }
     
-    // Audio level monitoring for Master Out display
-    float getLeftChannelLevel() const { return leftChannelLevel.load(); }
-    float getRightChannelLevel() const { return rightChannelLevel.load(); }
+    // Read-ahead: decode ahead on a thread shared by all decks (applies from the next load).
+    // bufferMs <= 0 or thread == nullptr streams straight from the reader like before.
+    void setReadAhead(TimeSliceThread* thread, int bufferMs);
+    int getReadAheadUnderruns() const { return track->readAheadSource ? track->readAheadSource->getUnderrunCount() : 0; }
+    // Keep a short copy of the audio at `seconds` ready for instant jumps (slot: see DeckReadAheadSource);
+    // for a memory-mapped track the region is paged in instead
+    void setPrefetchPoint(int slot, double seconds);
+
+    // Mix automation: while `log` records, every control command and play/pause of this deck
+    // is logged under `deckIndex` (UI thread)
+    void setAutomation(MixAutomation* log, int deckIndex) { automation = log; automationDeck = deckIndex; }
+    // Log the current deck state, so a recording started mid-set replays from here
+    void captureAutomationState();
+    // Offline replay of a logged DeckCommand through the public controls
+    void applyAutomationCommand(Command::Type type, double value, double value2);
+    // Off for offline renders, whose blocks don't run in wall-clock time: every command then
+    // applies at the start of the next block
+    void setTimedCommands(bool timed) { timedCommands.store(timed, std::memory_order_relaxed); }
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
     void getNextAudioBlock(const AudioSourceChannelInfo &bufferToFill) override;
@@ -93,46 +365,294 @@ public:
 
 private:
     void setPosition(double posInSecs);
+    // Audio thread (or prepareToPlay): switch to the track applyLoadedTrack() posted, if any
+    void pickUpPendingTrack();
+    // Hand the loop to the read-ahead stage's RAM cache; false if there is none or it is too long
+    bool cacheLoopRegion(double startSec, double endSec);
+    // UI thread: enqueue a control change for the audio thread
+    void postCommand(Command::Type type, double value = 0.0, double value2 = 0.0);
+    // Audio thread: drain both command queues into rtCommands, each at the sample it applies at
+    void takePendingCommands(int numSamples);
+    // Audio thread: apply the taken commands due at or before `sample` to the rt state
+    void applyDueCommands(int sample);
+    void applyCommand(const Command& cmd);
+    // Continuous controls (tempo, EQ, gains, effect knobs) may land inside a block; the rest
+    // (seeks, loops, mode switches) apply at its start, in step with play/pause
+    static bool isTimedCommand(Command::Type type) noexcept;
+    // Audio thread: start/end the slip excursion after commands changed scratch/loop/hold state
+    void updateSlipExcursion(double positionBeforeCommands);
+    // Audio thread: ratio actually played (deck tempo with the sync trim)
+    double playbackRatio() const noexcept { return rt.speed * rt.syncTrim; }
+    // Audio thread: the stretcher carries the tempo (keylock) or a key shift, the resampler stays at unity
+    bool stretcherEngaged() const noexcept { return rt.keylockEnabled || rt.keyShift != 0.0; }
+    // Audio thread: start or stop the stretcher after stretcherEngaged() changed
+    void engageStretcher(bool engage);
+    // Audio thread: the playhead follows the hand (scratch) or a motion, not the transport
+    bool offTimeline() const noexcept { return rt.scratchMode || rt.motion.kind != Motion::None; }
+    // Audio thread: start (or, for a released censor, end) the motion pendingMotion holds
+    void applyPendingMotion();
+    // Audio thread: motion output, like renderScratch() but along the motion's own speed curve
+    void renderMotion(const AudioSourceChannelInfo &bufferToFill);
+    // Audio thread: normal playback takes over again at `resumeSec`
+    void endMotion(double resumeSec);
+    // Audio thread: drop what the resampler and stretcher hold from before a jump of the playhead
+    void flushPipeline();
+    // Audio thread: the deck's timeline, in frames at the device rate. On the track it is the
+    // transport's next read frame (the reader's own 64-bit position, so nothing drifts); in the
+    // count-in it is rt.prerollFrame, below 0. Quantize, sync, loops and the published playhead
+    // all derive from it; seconds appear only where the grid and the UI want them.
+    juce::int64 timelineFrame() const noexcept;
+    // Audio thread: the timeline minus what the resampler and the stretcher have read ahead of
+    // the output, i.e. the frame being heard
+    juce::int64 audibleFrame() const noexcept;
+    double frameSeconds(juce::int64 frame) const noexcept { return (double) frame * secondsPerFrame; }
+    juce::int64 secondsFrame(double seconds) const noexcept { return (juce::int64) std::llround(seconds * currentSampleRate); }
+    double audiblePositionSeconds() const { return frameSeconds(audibleFrame()); }
+    // Audio thread: into the count-in at `seconds` (< 0) before the track, or out of it. The
+    // transport waits at 0 meanwhile; prerollPosition is published from rt.prerollFrame.
+    void enterPreroll(double seconds) noexcept;
+    void leavePreroll() noexcept;
+    // Audio thread: one stretch of output; getNextAudioBlock splits the block where a quantized
+    // seek is due
+    void renderBlock(const AudioSourceChannelInfo &bufferToFill);
+    // Audio thread: scratch mode output, played along scratchInput's trajectory
+    void renderScratch(const AudioSourceChannelInfo &bufferToFill);
+    // Audio thread: make frames [firstFrame, endFrame) available in scratchWindow where the track has them
+    void prepareScratchWindow(juce::int64 firstFrame, juce::int64 endFrame);
+    // Audio thread: append the first n frames of scratchPull to scratchWindow
+    void appendScratchWindow(int n);
+    // Audio thread: the track at `positions` (seconds, one per sample) from scratchWindow into
+    // out, cubic; the window must cover them (prepareScratchWindow)
+    void interpolateScratch(const double* positions, int numSamples, AudioBuffer<float>& out, int startSample, int numChannels);
+    // Audio thread: fill scratchFade with ScratchFadeFrames of the track moving on from fromSec
+    // at `velocity`, what the side being left would have played; mixed out by mixScratchFade()
+    void renderScratchFade(double fromSec, double velocity);
+    void mixScratchFade(const AudioSourceChannelInfo &bufferToFill);
+    // Audio thread: leave scratch mode where the record was let go
+    void endScratch();
+    // Audio thread: output samples until the pending quantized seek fires (0 = now, numSamples
+    // or more = not in this block)
+    int samplesUntilQuantizedSeek(int numSamples);
+    void fireQuantizedSeek();
+    // Beat jump target from a position, on the grid if there is one (else at bpm)
+    static double beatJumpTarget(const BeatGrid* grid, double bpm, double fromSec, double beats);
     
 #if defined(RUBBERBAND_FOUND)
     // Recreate/configure Rubber Band according to the selected quality profile
     void reinitRubberBand();
+    // Size all Rubber Band scratch buffers for the worst case so the audio thread never allocates
+    void prepareRubberBandScratch();
+    // Construct a stretcher for the given profile (allocates: UI/prepare thread only)
+    static std::unique_ptr<RubberBand::RubberBandStretcher> createStretcher(KeylockQuality q, int numChannels,
+                                                                            double sampleRate, int maxProcessSize);
+    // Any thread but the audio thread: a pooled stretcher of this shape, reset, else a new one
+    std::unique_ptr<RubberBand::RubberBandStretcher> takeStretcher(KeylockQuality q, int numChannels,
+                                                                   double sampleRate, int maxProcessSize) const;
+    // A stretcher the audio thread has let go of; replaces a pooled one of the same shape
+    void poolStretcher(std::unique_ptr<RubberBand::RubberBandStretcher> stretcher, KeylockQuality q, double sampleRate);
+    // Device (re)prepared: stretchers for another rate go, a stereo one for the profile is built
+    void refillStretcherPool();
+    // Audio thread: one slice of at most rbMaxOutSamples through the stretcher. False while priming
+    // or after a stretcher error (the slice is silent then).
+    bool renderStretched(const AudioSourceChannelInfo &bufferToFill);
+    // Audio thread: feed n frames of rbInputBuffer to the active stretcher and keep them in the history
+    void feedActiveStretcher(int numSamples);
+    // Audio thread: run the standby stretcher during a quality switch and cross-fade it into
+    // rbOutScratch (`got` frames); swaps the instances once the fade is complete
+    void runStandbyStretcher(int got);
+    void finishStretcherSwap();
 #endif
 
+    // MEMORY LAYOUT: the deck's state falls into three groups that different threads write. Cold
+    // configuration and the UI-side copies come first; the state the audio thread works on every
+    // block, the mailboxes the UI writes for it and the values it publishes for the UI each start
+    // on a cache line of their own (alignas(CacheLine) on their first member), so a knob turn
+    // or a meter poll doesn't pull the callback's lines away from its core. Keep new members in
+    // the group of the thread that writes them.
+    static constexpr size_t CacheLine = 64;
+
     AudioFormatManager &formatManager;
-    AudioTransportSource transportSource;
-    std::unique_ptr<AudioFormatReaderSource> readerSource;
-    ResamplingAudioSource resampleSource{&transportSource, false, 2};
-    // Store EQ/filter values
+
+    // LOADING: `track` is the last track applied, owned and used by the UI thread; rtTrack is the
+    // one the audio thread plays. applyLoadedTrack() publishes the new one in pendingTrack, the
+    // audio thread picks it up at the top of a block and reports its serial in pickedUpSerial.
+    // A replaced track waits in retiredTracks until the audio thread has moved past it.
+    std::unique_ptr<LoadedTrack> track;
+    juce::uint64 appliedSerial{0};
+    struct Retired {
+        std::unique_ptr<LoadedTrack> track;
+        juce::uint64 serial;    // may be freed once pickedUpSerial has reached this
+    };
+    std::vector<Retired> retiredTracks;
+
+    // What prepareTrack() builds a track for; loaders read it from their own threads
+    struct TrackSetup {
+        TimeSliceThread* readAheadThread{nullptr};
+        int readAheadMs{0};
+        double sampleRate{0.0};     // 0 until the device has prepared the deck
+        int blockSize{512};
+        int maxProcessSize{0};      // rbMaxInSamples
+        KeylockQuality quality{KeylockQuality::Quality};
+        float gain{1.0f};
+    };
+    TrackSetup getTrackSetup() const;
+    mutable std::mutex setupLock;
+    TrackSetup setup;
+
+    // UI-side copies of the control values (what the getters report)
     double highGain{0.0};
     double midGain{0.0};
     double lowGain{0.0};
     // filter knob: -1..0..+1; negative -> lowpass, positive -> highpass
     double filterKnob{0.0};
+    double trimGain{1.0};
+    std::array<float, StemTrackReader::NumStems> stemGains{ 1.0f, 1.0f, 1.0f, 1.0f };
+    std::array<DeckEffectRack::Settings, DeckEffectRack::NumEffects> effectSettings{};
+    // Plugin insert: owned by the UI side, read by the audio thread through pluginInsert
+    std::unique_ptr<PluginInsert> pluginInsertOwner;
+    double currentSpeed{1.0};
+    double pitchShiftRatio{1.0};
 
-    // DSP objects for a simple 3-band EQ + filter (optimized for real-time performance)
-    juce::dsp::IIR::Filter<float> lowShelf;
-    juce::dsp::IIR::Filter<float> midPeak;
-    juce::dsp::IIR::Filter<float> highShelf;
-    juce::dsp::StateVariableTPTFilter<float> svf; // used for filter knob (LP/HP)
-    
-    // Performance optimization: Cache coefficient objects to avoid recreation
-    juce::dsp::IIR::Coefficients<float>::Ptr cachedLowCoeffs;
-    juce::dsp::IIR::Coefficients<float>::Ptr cachedMidCoeffs;
-    juce::dsp::IIR::Coefficients<float>::Ptr cachedHighCoeffs;
-    double lastLowGain{0.0}, lastMidGain{0.0}, lastHighGain{0.0}, lastFilterKnob{0.0};
+    // Loop state
+    bool loopEnabled{false};
+    double loopStartSec{0.0};
+    double loopEndSec{0.0};
     
-    // PROFESSIONAL KEYLOCK: High-quality pitch shifting using JUCE DSP
-    std::unique_ptr<juce::dsp::ProcessorChain<
-        juce::dsp::Gain<float>,
-        juce::dsp::Reverb
-    >> pitchShiftChain;
+    // Scratch state
+    bool scratchMode{false};
+    double scratchVelocity{0.0};
+
+    // Slip state (UI copy; the audio thread publishes the shadow playhead for the waveform)
+    bool slipEnabled{false};
     
-    // Time-domain pitch shifter with better quality
-    std::unique_ptr<juce::dsp::ProcessorChain<juce::dsp::Gain<float>>> timeStretchProcessor;
+    // Keylock state
+    bool keylockEnabled{false};
+    double keyShiftSemitones{0.0};
+    // Debug logging for keylock paths
+    bool debugKeylock{false};
+    // Short warm-up delay for keylock to ensure internal buffers are primed (~5ms)
+    double keylockPrimeMs{5.0};
     
-    double currentSpeed{1.0};
-    double pitchShiftRatio{1.0};
+    // Quantize state
+    bool quantizeEnabled{false};
+    double trackBpm{120.0};
+    double trackFirstBeatOffset{0.0};
+    double trackLengthSec{0.0};
+    BeatGrid::Ptr beatGrid;     // std::atomic_load / atomic_exchange only
+    double prerollTimeSec{8.0};         // Preroll time in seconds (matches WaveformDisplay)
+
+    // Smart caching for waveform data to reduce memory allocations
+    struct WaveformCache {
+        std::vector<float> peaks;
+        double lastDuration = 0.0;
+        bool valid = false;
+        std::chrono::steady_clock::time_point lastUpdate;
+    } waveformCache;
+
+    // Mix automation log (not owned), see setAutomation()
+    MixAutomation* automation{nullptr};
+    int automationDeck{-1};
+
+#if defined(RUBBERBAND_FOUND)
+    // KEYLOCK SWITCH: stand-by stretcher for glitch-free profile changes.
+    // rbSwitchState: Idle -> UI owns rbStandby; Armed -> UI has built it and hands it over;
+    // Running -> audio thread warms it up from the input history and cross-fades.
+    enum SwitchState { SwitchIdle = 0, SwitchArmed, SwitchRunning };
+    std::unique_ptr<RubberBand::RubberBandStretcher> rbStandby;
+    KeylockQuality rbStandbyQuality{KeylockQuality::Quality};
+
+    // STRETCHER POOL: building a stretcher plans its FFTs and allocates for milliseconds, so a
+    // track load takes one of the right quality and channel count from here and only resets it.
+    // The previous track's stretcher comes back once the audio thread has let go of it. One per
+    // shape; loaders, the UI and the device thread share it under stretcherPoolLock.
+    struct PooledStretcher {
+        std::unique_ptr<RubberBand::RubberBandStretcher> stretcher;
+        KeylockQuality quality;
+        int numChannels;
+        double sampleRate;
+    };
+    mutable std::mutex stretcherPoolLock;
+    mutable std::vector<PooledStretcher> stretcherPool;
+#endif
+
+    // AUDIO THREAD: what every block reads and writes
+    alignas(CacheLine) LoadedTrack* rtTrack{nullptr};
+    // COMMAND TIMING (audio thread): the commands taken for this block, in the order they apply.
+    // A continuous control lands as far into the block as it was posted after the previous one
+    // began, rounded down to ControlBlockSamples: a constant block of latency instead of the
+    // jitter of the device's buffer size. The block is rendered in parts between them.
+    static constexpr int ControlBlockSamples = 64;
+    struct TakenCommand {
+        Command command;
+        int atSample;
+    };
+    std::array<TakenCommand, 512 + 256> rtCommands;
+    int rtCommandCount{0};
+    int rtCommandNext{0};
+    struct RealtimeState {
+        double speed{1.0};
+        double highGain{0.0};
+        double midGain{0.0};
+        double lowGain{0.0};
+        double filterKnob{0.0};
+        double trimGain{1.0};
+        std::array<float, StemTrackReader::NumStems> stemGains{ 1.0f, 1.0f, 1.0f, 1.0f };
+        bool loopEnabled{false};
+        double loopStartSec{0.0};
+        double loopEndSec{0.0};
+        bool scratchMode{false};
+        double scratchVelocity{0.0};
+        bool keylockEnabled{false};
+        double keyShift{0.0};       // semitones
+        bool pausedResetPending{false};
+        bool slipEnabled{false};
+        bool slipHold{false};
+        bool slipActive{false};
+        double slipPosSec{0.0};     // shadow playhead, advances at the playback ratio while active
+        double beatBpm{0.0};        // 0 until the analysis has delivered a grid
+        double firstBeatSec{0.0};
+        double syncTrim{1.0};       // written by DeckMixer's sync engine before each block
+        double pendingSeekSec{-1.0};    // QuantizedSeek target waiting for its beat
+        juce::int64 pendingFireFrame{-1};   // the beat it leaves on, as computed for this block
+        juce::int64 prerollFrame{0};    // the count-in's timeline frame (< 0), counted up by whole parts
+        struct Motion {
+            enum Kind { None, Brake, Spinback, Censor };
+            Kind kind{None};
+            double positionSec{0.0};
+            double velocity{0.0};       // track seconds per second, negative = backwards
+            double startSpeed{0.0};     // |velocity| at the start
+            double decay{1.0};          // per-sample velocity factor (brake, spinback)
+            double shadowSec{0.0};      // censor: where the track would be by now
+            bool parked{false};         // at rest: silent until the deck is paused
+        } motion;
+        Command pendingMotion;          // the batch's last motion command, until its sample
+        bool motionPending{false};
+        int motionAtSample{0};
+        int armedStartAt{-1};           // startArmed(): sample of the next block the deck starts at
+    } rt;
+    using Motion = RealtimeState::Motion;
+    // Speed (share of the start speed) that counts as at rest, and below which the level fades out
+    static constexpr double MotionRestSpeed = 0.01;
+    static constexpr double MotionFadeSpeed = 0.1;
+    juce::uint64 lastBlockStartNs{0};   // audio thread: DeckMixer::nowNs() as the last block began
+    float appliedTrimGain{1.0f};   // where the last block's trim ended
+    juce::int64 eqTicks{0};   // see takeStageTicks()
+    bool renderedAudio{false};   // some part of this block went past the silent paths
+    // Audio thread: block counts behind the periodic debug traces, per deck so neither the traces
+    // nor a shared counter's cache line mix decks rendered on different workers
+    struct TraceCounters {
+        int calls{0}, normalPlayback{0}, dsp{0}, eq{0};
+    } traceCounters;
+
+    // Varispeed for tempo/scratch: ratio ramps within each block, engine selectable (linear / sinc)
+    VarispeedResampler resampleSource{nullptr, 2};
+
+    // Fused 3-band EQ + LP/HP filter (smoothed, one pass over the block)
+    DeckEqProcessor eq;
+    // Insert effects (their settings arrive as commands)
+    DeckEffectRack effects;
+    // Between the transport and resampleSource, so slices are resampled and stretched like the track
+    DeckSlicer slicer;
 
 #if defined(RUBBERBAND_FOUND)
     // High-quality Rubber Band time-stretcher (required for keylock functionality)
@@ -140,6 +660,7 @@ private:
     juce::AudioBuffer<float> rbInputBuffer;
     juce::AudioBuffer<float> rbOutScratch;
     double rbLastTimeRatio{1.0};
+    double rbLastPitchScale{1.0};
     int rbNumChannels{2};
     bool rbReady{false};
     int rbLatencySamples{0};
@@ -147,80 +668,122 @@ private:
     bool rbPaddedStartDone{false};
     int rbDiscardOutRemaining{0};
     KeylockQuality rbQuality{KeylockQuality::Quality};
-#endif
+    // REALTIME: preallocated channel pointer arrays and capacities (set in prepareRubberBandScratch)
+    std::array<const float*, 2> rbInPtrs{};
+    std::array<float*, 2> rbOutPtrs{};
+    int rbMaxInSamples{0};   // max frames per rb->process() call
+    int rbMaxOutSamples{0};  // max frames per rb->retrieve() call
+    // Fastest tempo supported by keylock; bounds the input needed per output block
+    static constexpr double rbMaxSpeed = 8.0;
 
-    // Hard mute flag to kill output immediately on stop
-    std::atomic<bool> forceSilent{false};
-    // Soft pause flag: mute output without stopping transport to avoid glitches
-    std::atomic<bool> softPaused{false};
-    // Request to capture exact position on the audio thread
-    std::atomic<bool> savePosRequested{false};
-    // Request transportSource.stop() to be executed on the audio thread
-    std::atomic<bool> stopRequested{false};
-    // Perform one-time heavy resets after pause/stop inside audio thread without repeating every callback
-    std::atomic<bool> pausedResetPending{false};
+    // Recent input fed to the active stretcher, so the stand-by can start from the same audio
+    static constexpr int rbHistorySize = 32768;
+    juce::AudioBuffer<float> rbHistory;
+    juce::int64 rbInputFedTotal{0};      // real input frames fed to the active stretcher
+    double rbOutputInputPos{0.0};        // input position of the next active output frame
+    juce::AudioBuffer<float> rbStandbyIn;
+    juce::AudioBuffer<float> rbStandbyOut;
+    std::array<const float*, 2> rbStandbyInPtrs{};
+    std::array<float*, 2> rbStandbyOutPtrs{};
+    juce::int64 rbStandbyFeedPos{0};
+    int rbStandbyDiscard{0};
+    int rbStandbyOwed{0};
+    int rbFadePos{0};
+    int rbFadeLength{0};
+#endif
 
     // DSP prepare state
     double currentSampleRate{44100.0};
+    double secondsPerFrame{1.0 / 44100.0};
     bool dspPrepared{false};
     // Precise pause/resume handling
     double pausedPosSec{0.0};
     bool resumeCompensatePending{false};
     int resumeWarmupSamplesRemaining{0};
+    int keylockPrimeSamplesRemaining{0};   // see keylockPrimeMs
     int lastBlockSizeHint{512};
-    
-    // Performance optimizations for multiple loaded songs
-    static constexpr int AUDIO_POOL_SIZE = 4;
-    std::array<std::unique_ptr<AudioBuffer<float>>, AUDIO_POOL_SIZE> audioBufferPool;
-    std::atomic<int> poolIndex{0};
+    // Block size announced by the device in prepareToPlay (basis for RT buffer sizing)
+    int preparedBlockSize{512};
     
     // Loop crossfade buffers for click-free loop transitions
     juce::AudioBuffer<float> loopCrossfadeBuffer;
     bool loopCrossfadeActive{false};
     int loopCrossfadeSamples{0};
     int loopCrossfadePosition{0};
-    
-    // Smart caching for waveform data to reduce memory allocations
-    struct WaveformCache {
-        std::vector<float> peaks;
-        double lastDuration = 0.0;
-        bool valid = false;
-        std::chrono::steady_clock::time_point lastUpdate;
-    } waveformCache;
+    // Uncached loop wrap (the loop isn't served from the read-ahead cache): the block up to the loop
+    // end, the audio from the loop start and a short pre-jump tail. Sized in prepareToPlay and used
+    // as views after that; a block that doesn't fit takes the short fade.
+    static constexpr int LoopWrapMaxCrossfade = 1024;
+    static constexpr int LoopWrapPreJumpFrames = 32;
+    static constexpr int LoopWrapChannels = 8;
+    juce::AudioBuffer<float> loopWrapEnd;
+    juce::AudioBuffer<float> loopWrapStart;
+    juce::AudioBuffer<float> loopWrapPreJump;
+    int loopWrapFrames{0};
 
-    // Loop state
-    bool loopEnabled{false};
-    double loopStartSec{0.0};
-    double loopEndSec{0.0};
-    
-    // Scratch state
-    bool scratchMode{false};
-    double scratchVelocity{0.0};
-    
-    // Keylock state
-    bool keylockEnabled{false};
-    // Defer keylock toggles to audio thread: -1 none, 0 disable, 1 enable
-    std::atomic<int> keylockChangePending{-1};
-    // Debug logging for keylock paths
-    bool debugKeylock{true};
-    // Short warm-up delay for keylock to ensure internal buffers are primed (~5ms)
-    int keylockPrimeSamplesRemaining{0};
-    double keylockPrimeMs{5.0};
-    
-    // Quantize state
-    bool quantizeEnabled{false};
-    double trackBpm{120.0};
-    double trackFirstBeatOffset{0.0};
-    double trackLengthSec{0.0};
-    
-    // Preroll state for DJ-style cueing
-    double prerollPosition{0.0};        // Current preroll position (negative when in preroll)
-    bool inPrerollMode{false};          // Whether we're currently in preroll area
-    double prerollTimeSec{8.0};         // Preroll time in seconds (matches WaveformDisplay)
-    
-    // Audio level monitoring (thread-safe for real-time display)
-    std::atomic<float> leftChannelLevel{0.0f};
-    std::atomic<float> rightChannelLevel{0.0f};
+    // SCRATCH (audio thread): the trajectory from pushScratchPosition() is rendered from a ring of
+    // track audio at the device rate, pulled from the transport at 1x. It holds track frames
+    // [scratchWindowStart, scratchWindowEnd), so the hand can pull back over what just played.
+    ScratchTrajectory scratchInput;
+    static constexpr int ScratchWindowFrames = 1 << 18;    // ~5.5 s at 48 kHz, power of two
+    static constexpr int ScratchPullFrames = 1024;
+    static constexpr int ScratchBackfillFrames = 8192;     // history fetched when the window is reseated
+    static constexpr int ScratchChunk = 256;
+    juce::AudioBuffer<float> scratchWindow;
+    juce::AudioBuffer<float> scratchPull;
+    std::array<double, ScratchChunk> scratchPositions{};
+    juce::int64 scratchWindowStart{0};
+    juce::int64 scratchWindowEnd{0};
+    bool scratchWindowValid{false};
+    // Entering and leaving scratch mode cross-fade from the side being left over ~3 ms. Leaving,
+    // the fade is rendered before the transport seeks; entering, at the first scratch block.
+    static constexpr int ScratchFadeFrames = 128;
+    juce::AudioBuffer<float> scratchFade;
+    std::array<double, ScratchFadeFrames> scratchFadePositions{};
+    int scratchFadePos{ScratchFadeFrames};       // ScratchFadeFrames = no fade running
+    bool scratchFadeOnEntry{false};
+    double scratchEntrySec{0.0};
+    double scratchEntryVelocity{0.0};
+    // TIMECODE (audio thread): this block's record positions, and where a relative run started
+    const double* timecodeBlock{nullptr};
+    int timecodeSamples{0};
+    bool timecodeAbsolute{false};
+    bool timecodeRelative{false};
+    double timecodeOffsetSec{0.0};
+
+    // UI -> AUDIO: mailboxes the UI thread writes and the audio thread polls
+    alignas(CacheLine) std::atomic<LoadedTrack*> pendingTrack{nullptr};
+    // Hard mute flag to kill output immediately on stop
+    std::atomic<bool> forceSilent{false};
+    // Soft pause flag: mute output without stopping transport to avoid glitches
+    std::atomic<bool> softPaused{false};
+    // armStart(): soft-paused with the transport running, until startArmed() fires
+    std::atomic<bool> armed{false};
+    std::atomic<bool> timedCommands{true};
+    std::atomic<PluginInsert*> pluginInsert{nullptr};
+#if defined(RUBBERBAND_FOUND)
+    std::atomic<int> rbSwitchState{SwitchIdle};
+#endif
+    // Control changes from the UI thread; members the audio thread needs are mirrored into rt
+    // and only touched there. Each queue keeps its indices on lines of their own.
+    SpscQueue<Command, 512> commandQueue;
+    SpscQueue<Command, 256> controllerQueue;
+
+    // AUDIO -> UI: what the audio thread publishes, polled by the UI and the displays
+    alignas(CacheLine) std::atomic<juce::uint64> pickedUpSerial{0};
+    std::atomic<bool> motionStopped{false};
+    std::atomic<bool> motionRunning{false};
+#if defined(RUBBERBAND_FOUND)
+    std::atomic<int> rbRunningQuality{(int) KeylockQuality::Quality};
+#endif
+    // The shadow playhead while slip is active
+    std::atomic<bool> slipActive{false};
+    std::atomic<double> slipPositionSec{0.0};
+    // Preroll state for DJ-style cueing, polled through getPositionRelative()
+    std::atomic<double> prerollPosition{0.0};   // rt.prerollFrame relative to prerollTimeSec (negative in preroll)
+    std::atomic<bool> inPrerollMode{false};     // Whether we're currently in preroll area
+    // Playhead (see PositionSnapshot)
+    SeqlockValue<PositionSnapshot> positionSnapshot;
 };
 
 #endif //GUI_APP_EXAMPLE_DJAUDIOPLAYER_H
@@ -0,0 +1,356 @@
+#include "DeckEffectRack.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    float moveTowards(float current, float target, float maxDelta)
+    {
+        if (current < target) return std::min(target, current + maxDelta);
+        return std::max(target, current - maxDelta);
+    }
+
+    double wrapBeats(double position, double length)
+    {
+        const double p = std::fmod(position, length);
+        return p < 0.0 ? p + length : p;
+    }
+}
+
+const char* DeckEffectRack::getName(int effect)
+{
+    switch (effect) {
+        case Bitcrusher: return "Crush";
+        case Flanger:    return "Flanger";
+        case Gate:       return "Gate";
+        case Echo:       return "Echo";
+        case Reverb:     return "Reverb";
+        default:         return "";
+    }
+}
+
+DeckEffectRack::Settings DeckEffectRack::getDefaultSettings(int effect)
+{
+    Settings s;
+    switch (effect) {
+        case Bitcrusher: s.mix = 1.0f;  s.amount = 0.5f;  s.beats = 0.0;  break;
+        case Flanger:    s.mix = 0.8f;  s.amount = 0.6f;  s.beats = 8.0;  break;
+        case Gate:       s.mix = 0.9f;  s.amount = 0.5f;  s.beats = 0.25; break;
+        case Echo:       s.mix = 0.5f;  s.amount = 0.5f;  s.beats = 0.75; break;
+        case Reverb:     s.mix = 0.35f; s.amount = 0.6f;  s.beats = 0.0;  break;
+        default: break;
+    }
+    return s;
+}
+
+DeckEffectRack::DeckEffectRack()
+{
+    for (int i = 0; i < NumEffects; ++i)
+        slots[(size_t) i].settings = getDefaultSettings(i);
+}
+
+void DeckEffectRack::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    maxBlock = std::max(64, maximumBlockSize);
+    rampStep = (float) (1.0 / (RampSeconds * sampleRate));
+
+    modScratch.assign((size_t) maxBlock, 0.0f);
+    for (auto& line : flangerLine)
+        line.assign((size_t) std::ceil(MaxFlangerMs * 0.001 * sampleRate) + 4, 0.0f);
+    for (auto& line : echoLine)
+        line.assign((size_t) std::ceil(MaxEchoSeconds * sampleRate) + 1, 0.0f);
+    for (auto& scratch : reverbScratch)
+        scratch.assign((size_t) maxBlock, 0.0f);
+
+    gateSmoothing = (float) (1.0 - std::exp(-1.0 / (0.002 * sampleRate)));
+    echoDampCoeff = (float) (1.0 - std::exp(-2.0 * juce::MathConstants<double>::pi * 4000.0 / sampleRate));
+
+    reverb.setSampleRate(sampleRate);
+    reverbParams.dryLevel = 0.0f;
+    reverbParams.wetLevel = 1.0f / 3.0f;   // juce::Reverb scales wet by 3
+    reverbParams.damping = 0.5f;
+    reverbParams.width = 1.0f;
+    reverbParams.roomSize = -1.0f;           // forces the first setParameters()
+    reset();
+}
+
+void DeckEffectRack::reset() noexcept
+{
+    for (auto& slot : slots) {
+        slot.wet = 0.0f;
+        slot.send = 0.0f;
+        slot.tailRemaining = 0;
+    }
+    crushHoldCounter = 0;
+    crushHeld.fill(0.0f);
+    for (auto& line : flangerLine) std::fill(line.begin(), line.end(), 0.0f);
+    for (auto& line : echoLine) std::fill(line.begin(), line.end(), 0.0f);
+    flangerWrite = echoWrite = 0;
+    echoDamp.fill(0.0f);
+    gateGain = 1.0f;
+    beatPos = 0.0;
+    reverb.reset();
+    updateActiveMask();
+}
+
+void DeckEffectRack::setEnabled(int effect, bool enabled) noexcept
+{
+    if (effect < 0 || effect >= NumEffects) return;
+    auto& slot = slots[(size_t) effect];
+    if (slot.settings.enabled == enabled) return;
+
+    if (enabled && (activeMask & (1u << effect)) == 0) {
+        // Starting from idle: drop what is left in the short lines from the last use
+        if (effect == Flanger)
+            for (auto& line : flangerLine) std::fill(line.begin(), line.end(), 0.0f);
+        if (effect == Reverb) reverb.reset();
+        if (effect == Echo) echoDamp.fill(0.0f);
+    }
+    slot.settings.enabled = enabled;
+    slot.tailRemaining = enabled ? 0 : tailSamples(effect);
+    updateActiveMask();
+}
+
+void DeckEffectRack::setMix(int effect, float mix) noexcept
+{
+    if (effect >= 0 && effect < NumEffects)
+        slots[(size_t) effect].settings.mix = juce::jlimit(0.0f, 1.0f, mix);
+}
+
+void DeckEffectRack::setAmount(int effect, float amount) noexcept
+{
+    if (effect >= 0 && effect < NumEffects)
+        slots[(size_t) effect].settings.amount = juce::jlimit(0.0f, 1.0f, amount);
+}
+
+void DeckEffectRack::setBeats(int effect, double beats) noexcept
+{
+    if (effect >= 0 && effect < NumEffects)
+        slots[(size_t) effect].settings.beats = juce::jlimit(1.0 / 32.0, 32.0, beats);
+}
+
+void DeckEffectRack::updateActiveMask() noexcept
+{
+    unsigned mask = 0;
+    for (int i = 0; i < NumEffects; ++i) {
+        const auto& slot = slots[(size_t) i];
+        if (slot.settings.enabled || slot.wet > 0.0f || slot.tailRemaining > 0)
+            mask |= 1u << i;
+    }
+    activeMask = mask;
+}
+
+int DeckEffectRack::tailSamples(int effect) const noexcept
+{
+    const auto& s = slots[(size_t) effect].settings;
+    if (effect == Echo) {
+        // Repeats until they are 60 dB down
+        const double delaySec = beatsToSamples(s.beats) / sampleRate;
+        const double feedback = std::max(0.01, 0.95 * s.amount);
+        const double repeats = std::ceil(std::log(0.001) / std::log(feedback)) + 1.0;
+        return (int) (std::min(12.0, delaySec * repeats) * sampleRate);
+    }
+    if (effect == Reverb)
+        return (int) ((2.0 + 6.0 * s.amount) * sampleRate);
+    return 0;
+}
+
+double DeckEffectRack::beatsToSamples(double beats) const noexcept
+{
+    return beats * 60.0 / blockBpm * sampleRate;
+}
+
+float DeckEffectRack::wetTarget(int effect) noexcept
+{
+    auto& slot = slots[(size_t) effect];
+    if (slot.settings.enabled) return slot.settings.mix;
+    return slot.tailRemaining > 0 ? slot.settings.mix : 0.0f;
+}
+
+void DeckEffectRack::process(float* left, float* right, int numSamples, double bpm, double beatPosition) noexcept
+{
+    if (activeMask == 0 || left == nullptr || numSamples <= 0 || maxBlock == 0) return;
+
+    blockBpm = bpm > 0.0 ? juce::jlimit(20.0, 400.0, bpm) : 120.0;
+    beatsPerSample = blockBpm / (60.0 * sampleRate);
+    if (beatPosition >= 0.0) beatPos = beatPosition;
+
+    float* channels[2] = { left, right };
+    const int numChannels = right != nullptr ? 2 : 1;
+    for (int done = 0; done < numSamples; ) {
+        const int n = std::min(maxBlock, numSamples - done);
+        float* chunk[2] = { channels[0] + done, numChannels > 1 ? channels[1] + done : nullptr };
+        processChunk(chunk, numChannels, n);
+        beatPos += n * beatsPerSample;
+        done += n;
+    }
+    updateActiveMask();
+}
+
+void DeckEffectRack::processChunk(float* const* channels, int numChannels, int n) noexcept
+{
+    for (int i = 0; i < NumEffects; ++i) {
+        if ((activeMask & (1u << i)) == 0) continue;
+        auto& slot = slots[(size_t) i];
+        switch (i) {
+            case Bitcrusher: processBitcrusher(slot, channels, numChannels, n); break;
+            case Flanger:    processFlanger(slot, channels, numChannels, n); break;
+            case Gate:       processGate(slot, channels, numChannels, n); break;
+            case Echo:       processEcho(slot, channels, numChannels, n); break;
+            case Reverb:     processReverb(slot, channels, numChannels, n); break;
+            default: break;
+        }
+        slot.wet = moveTowards(slot.wet, wetTarget(i), rampStep * n);
+        slot.send = moveTowards(slot.send, slot.settings.enabled ? 1.0f : 0.0f, rampStep * n);
+        slot.tailRemaining = std::max(0, slot.tailRemaining - n);
+    }
+}
+
+void DeckEffectRack::processBitcrusher(Slot& slot, float* const* channels, int numChannels, int n) noexcept
+{
+    // Sample-and-hold downsampling plus requantisation, both scaled by amount
+    const float a = slot.settings.amount;
+    const int holdLength = 1 + (int) (a * a * 15.0f);
+    const float levels = std::exp2(15.0f - 11.0f * a);
+    const float wet0 = slot.wet;
+    const float wetDelta = (moveTowards(slot.wet, wetTarget(Bitcrusher), rampStep * n) - wet0) / (float) n;
+
+    int counter = crushHoldCounter;
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* x = channels[ch];
+        float held = crushHeld[(size_t) ch];
+        counter = crushHoldCounter;
+        for (int i = 0; i < n; ++i) {
+            if (counter == 0) held = std::round(x[i] * levels) / levels;
+            counter = counter + 1 >= holdLength ? 0 : counter + 1;
+            x[i] += (wet0 + wetDelta * (float) i) * (held - x[i]);
+        }
+        crushHeld[(size_t) ch] = held;
+    }
+    crushHoldCounter = counter;
+}
+
+void DeckEffectRack::processFlanger(Slot& slot, float* const* channels, int numChannels, int n) noexcept
+{
+    // LFO once per sample into the scratch, then both channels read the same delay curve
+    const double cycle = std::max(0.25, slot.settings.beats);
+    const double minDelay = MinFlangerMs * 0.001 * sampleRate;
+    const double depth = (MaxFlangerMs - MinFlangerMs) * 0.001 * sampleRate;
+    for (int i = 0; i < n; ++i) {
+        const double phase = wrapBeats(beatPos + i * beatsPerSample, cycle) / cycle;
+        modScratch[(size_t) i] = (float) (minDelay + depth * 0.5 * (1.0 - std::cos(juce::MathConstants<double>::twoPi * phase)));
+    }
+
+    const float feedback = 0.85f * slot.settings.amount;
+    const float wet0 = slot.wet;
+    const float wetDelta = (moveTowards(slot.wet, wetTarget(Flanger), rampStep * n) - wet0) / (float) n;
+    const int size = (int) flangerLine[0].size();
+
+    int w = flangerWrite;
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* x = channels[ch];
+        float* line = flangerLine[(size_t) ch].data();
+        w = flangerWrite;
+        for (int i = 0; i < n; ++i) {
+            float readPos = (float) w - modScratch[(size_t) i];
+            if (readPos < 0.0f) readPos += (float) size;
+            const int r0 = (int) readPos;
+            const int r1 = r0 + 1 == size ? 0 : r0 + 1;
+            const float frac = readPos - (float) r0;
+            const float delayed = line[r0] + frac * (line[r1] - line[r0]);
+
+            line[w] = x[i] + feedback * delayed;
+            w = w + 1 == size ? 0 : w + 1;
+            // Full wet is the classic 50/50 flanger sum (deepest notches)
+            x[i] += (wet0 + wetDelta * (float) i) * 0.5f * (delayed - x[i]);
+        }
+    }
+    flangerWrite = w;
+}
+
+void DeckEffectRack::processGate(Slot& slot, float* const* channels, int numChannels, int n) noexcept
+{
+    // Open for the first `amount` of every step; edges smoothed over ~2 ms to avoid clicks
+    const double step = std::max(1.0 / 32.0, slot.settings.beats);
+    const double duty = juce::jlimit(0.05, 0.95, (double) slot.settings.amount);
+    const float wet0 = slot.wet;
+    const float wetDelta = (moveTowards(slot.wet, wetTarget(Gate), rampStep * n) - wet0) / (float) n;
+
+    float g = gateGain;
+    for (int i = 0; i < n; ++i) {
+        const bool open = wrapBeats(beatPos + i * beatsPerSample, step) < duty * step;
+        const float target = open ? 1.0f : 1.0f - (wet0 + wetDelta * (float) i);
+        g += gateSmoothing * (target - g);
+        modScratch[(size_t) i] = g;
+    }
+    gateGain = g;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::multiply(channels[ch], modScratch.data(), n);
+}
+
+void DeckEffectRack::processEcho(Slot& slot, float* const* channels, int numChannels, int n) noexcept
+{
+    const int size = (int) echoLine[0].size();
+    const int delay = juce::jlimit(1, size - 1, (int) std::lround(beatsToSamples(slot.settings.beats)));
+    const float feedback = 0.95f * slot.settings.amount;
+    const float wet0 = slot.wet;
+    const float wetDelta = (moveTowards(slot.wet, wetTarget(Echo), rampStep * n) - wet0) / (float) n;
+    const float send0 = slot.send;
+    const float sendDelta = (moveTowards(slot.send, slot.settings.enabled ? 1.0f : 0.0f, rampStep * n) - send0) / (float) n;
+
+    int w = echoWrite;
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* x = channels[ch];
+        float* line = echoLine[(size_t) ch].data();
+        float damp = echoDamp[(size_t) ch];
+        w = echoWrite;
+        int r = w - delay;
+        if (r < 0) r += size;
+        for (int i = 0; i < n; ++i) {
+            const float delayed = line[r];
+            // Repeats darken a little each round, like a tape echo
+            damp += echoDampCoeff * (delayed - damp);
+            line[w] = (send0 + sendDelta * (float) i) * x[i] + feedback * damp;
+            x[i] += (wet0 + wetDelta * (float) i) * delayed;
+            w = w + 1 == size ? 0 : w + 1;
+            r = r + 1 == size ? 0 : r + 1;
+        }
+        echoDamp[(size_t) ch] = damp;
+    }
+    echoWrite = w;
+}
+
+void DeckEffectRack::processReverb(Slot& slot, float* const* channels, int numChannels, int n) noexcept
+{
+    const float roomSize = 0.3f + 0.65f * slot.settings.amount;
+    if (roomSize != reverbParams.roomSize) {
+        reverbParams.roomSize = roomSize;
+        reverb.setParameters(reverbParams);
+    }
+
+    // The reverb runs on a send so its input can close while the tail keeps ringing
+    const float send0 = slot.send;
+    const float sendDelta = (moveTowards(slot.send, slot.settings.enabled ? 1.0f : 0.0f, rampStep * n) - send0) / (float) n;
+    float* sendL = reverbScratch[0].data();
+    float* sendR = reverbScratch[1].data();
+    const float* inR = numChannels > 1 ? channels[1] : channels[0];
+    for (int i = 0; i < n; ++i) {
+        const float s = send0 + sendDelta * (float) i;
+        sendL[i] = s * channels[0][i];
+        sendR[i] = s * inR[i];
+    }
+    reverb.processStereo(sendL, sendR, n);
+
+    const float wet0 = slot.wet;
+    const float wetDelta = (moveTowards(slot.wet, wetTarget(Reverb), rampStep * n) - wet0) / (float) n;
+    if (numChannels == 1)
+        juce::FloatVectorOperations::add(sendL, sendR, n);
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* x = channels[ch];
+        const float* wetSignal = reverbScratch[(size_t) ch].data();
+        const float monoScale = numChannels == 1 ? 0.5f : 1.0f;
+        for (int i = 0; i < n; ++i)
+            x[i] += (wet0 + wetDelta * (float) i) * monoScale * wetSignal[i];
+    }
+}
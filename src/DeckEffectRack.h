@@ -0,0 +1,111 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+/**
+ * Insert effect rack for one deck, run after the EQ: bitcrusher, flanger, beat gate, echo and
+ * reverb, always in that order (the gate sits before echo/reverb so the tails fill its gaps).
+ *
+ * Every delay line and scratch buffer is sized in prepare() for the longest supported time, so
+ * switching effects or changing times on the audio thread never allocates; the deck applies
+ * settings from its command queue, never under a lock. An effect that is off and has rung out
+ * costs nothing, and with all of them off process() returns immediately. Echo and reverb spill
+ * over: switching them off closes the send and the tail decays on its own.
+ *
+ * Times are in beats of the output tempo the deck passes in (track BPM times playback ratio).
+ * With a beat grid the gate and flanger LFO lock to it, otherwise they run free.
+ */
+class DeckEffectRack {
+public:
+    enum Effect { Bitcrusher = 0, Flanger, Gate, Echo, Reverb, NumEffects };
+
+    // mix: wet level (gate: depth). amount: crush / flanger feedback / gate duty cycle /
+    // echo feedback / reverb size. beats: flanger LFO cycle / gate step / echo time.
+    struct Settings {
+        bool enabled{false};
+        float mix{0.5f};
+        float amount{0.5f};
+        double beats{0.5};
+    };
+
+    static constexpr double MaxEchoSeconds = 4.0;
+    static constexpr double MinFlangerMs = 0.5;
+    static constexpr double MaxFlangerMs = 10.0;
+    static constexpr double RampSeconds = 0.01;
+
+    static const char* getName(int effect);
+    static Settings getDefaultSettings(int effect);
+
+    DeckEffectRack();
+
+    // Allocates: call from prepareToPlay only
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    // Audio thread
+    void setEnabled(int effect, bool enabled) noexcept;
+    void setMix(int effect, float mix) noexcept;
+    void setAmount(int effect, float amount) noexcept;
+    void setBeats(int effect, double beats) noexcept;
+    bool isActive() const noexcept { return activeMask != 0; }
+
+    // Audio thread, in place on up to two channels (right may be nullptr). bpm = output tempo
+    // (<= 0: 120 assumed); beatPosition = beats since the grid's first beat at the first sample
+    // (< 0: no grid, the LFOs keep their own phase).
+    void process(float* left, float* right, int numSamples, double bpm, double beatPosition) noexcept;
+
+private:
+    struct Slot {
+        Settings settings;
+        float wet{0.0f};        // ramps to mix while on, to 0 once off (and rung out)
+        float send{0.0f};       // echo/reverb input, ramps to 0 when switched off
+        int tailRemaining{0};   // samples the echo/reverb tail may still ring
+    };
+
+    void processChunk(float* const* channels, int numChannels, int numSamples) noexcept;
+    void processBitcrusher(Slot& slot, float* const* channels, int numChannels, int n) noexcept;
+    void processFlanger(Slot& slot, float* const* channels, int numChannels, int n) noexcept;
+    void processGate(Slot& slot, float* const* channels, int numChannels, int n) noexcept;
+    void processEcho(Slot& slot, float* const* channels, int numChannels, int n) noexcept;
+    void processReverb(Slot& slot, float* const* channels, int numChannels, int n) noexcept;
+    // Where a slot's wet level ramps to: mix while on or ringing out, 0 afterwards
+    float wetTarget(int effect) noexcept;
+    int tailSamples(int effect) const noexcept;
+    double beatsToSamples(double beats) const noexcept;
+    void updateActiveMask() noexcept;
+
+    double sampleRate{44100.0};
+    int maxBlock{0};
+    float rampStep{0.0f};
+
+    std::array<Slot, NumEffects> slots{};
+    unsigned activeMask{0};
+
+    // Tempo for the block being processed
+    double blockBpm{120.0};
+    double beatPos{0.0};
+    double beatsPerSample{0.0};
+
+    // Per-block modulation (flanger delay in samples, gate gain), shared by both channels
+    std::vector<float> modScratch;
+
+    int crushHoldCounter{0};
+    std::array<float, 2> crushHeld{};
+
+    std::array<std::vector<float>, 2> flangerLine;
+    int flangerWrite{0};
+
+    float gateGain{1.0f};
+    float gateSmoothing{0.0f};
+
+    std::array<std::vector<float>, 2> echoLine;
+    int echoWrite{0};
+    std::array<float, 2> echoDamp{};
+    float echoDampCoeff{0.0f};
+
+    juce::Reverb reverb;
+    juce::Reverb::Parameters reverbParams;
+    std::array<std::vector<float>, 2> reverbScratch;
+};
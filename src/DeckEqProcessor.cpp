@@ -0,0 +1,239 @@
+#include "DeckEqProcessor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+
+    // Same band layout as the old per-filter chain
+    constexpr double kLowFreq = 300.0,  kLowQ = 0.707;
+    constexpr double kMidFreq = 2500.0, kMidQ = 1.0;
+    constexpr double kHighFreq = 8000.0, kHighQ = 0.707;
+    constexpr double kMaxGainDb = 12.0;
+    constexpr float kSvfResonance = 0.7f;
+
+    // Time constant for knob smoothing; short enough to feel direct, long enough to kill zipper steps
+    constexpr double kSmoothingMs = 15.0;
+
+    inline double gainFromKnob(double knob) {
+        const double db = std::clamp(knob * kMaxGainDb, -kMaxGainDb, kMaxGainDb);
+        return std::pow(10.0, db / 20.0);
+    }
+
+    inline float processBiquad(float x, float b0, float b1, float b2, float a1, float a2, float& z1, float& z2) {
+        const float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return y;
+    }
+}
+
+void DeckEqProcessor::prepare(double newSampleRate) {
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    const double subBlocksPerSecond = sampleRate / SubBlockSize;
+    smoothingCoeff = 1.0 - std::exp(-1000.0 / (kSmoothingMs * subBlocksPerSecond));
+    reset();
+}
+
+void DeckEqProcessor::reset() {
+    currentGain = targetGain;
+    currentFilter = targetFilter;
+    clearState();
+    coeffsValid = false;
+    updateCoefficients();
+    wet = atRest() ? 0.0f : 1.0f;
+}
+
+void DeckEqProcessor::clearState() noexcept {
+    for (auto& channel : bandState)
+        for (auto& s : channel) s = BiquadState{};
+    for (auto& s : svfState) s = SvfState{};
+}
+
+bool DeckEqProcessor::atRest() const noexcept {
+    // Flat shelves and peak are unity; a centred filter would only be the 20 Hz highpass
+    for (int b = 0; b < NumBands; ++b)
+        if (targetGain[b] != 0.0 || currentGain[b] != 0.0) return false;
+    return targetFilter == 0.0 && currentFilter == 0.0;
+}
+
+void DeckEqProcessor::setTargets(double high, double mid, double low, double filter) noexcept {
+    targetGain[High] = high;
+    targetGain[Mid] = mid;
+    targetGain[Low] = low;
+    targetFilter = std::clamp(filter, -1.0, 1.0);
+}
+
+void DeckEqProcessor::updateCoefficients() noexcept {
+    // Step the smoothed values one sub-block towards their targets
+    bool changed = !coeffsValid;
+    for (int b = 0; b < NumBands; ++b) {
+        const double diff = targetGain[b] - currentGain[b];
+        if (diff != 0.0) {
+            currentGain[b] = std::abs(diff) < 1.0e-4 ? targetGain[b] : currentGain[b] + diff * smoothingCoeff;
+            changed = true;
+        }
+    }
+    const double filterDiff = targetFilter - currentFilter;
+    if (filterDiff != 0.0) {
+        currentFilter = std::abs(filterDiff) < 1.0e-4 ? targetFilter : currentFilter + filterDiff * smoothingCoeff;
+        changed = true;
+    }
+
+    if (!changed) return;
+
+    coeffs[Low] = makeLowShelf(sampleRate, kLowFreq, kLowQ, gainFromKnob(currentGain[Low]));
+    coeffs[Mid] = makePeak(sampleRate, kMidFreq, kMidQ, gainFromKnob(currentGain[Mid]));
+    coeffs[High] = makeHighShelf(sampleRate, kHighFreq, kHighQ, gainFromKnob(currentGain[High]));
+
+    // Filter knob: < 0 sweeps a lowpass down from 20 kHz, >= 0 sweeps a highpass up from 20 Hz
+    double cutoff;
+    if (currentFilter < 0.0) {
+        svfLowpass = true;
+        cutoff = std::clamp(20000.0 * std::pow(0.01, -currentFilter), 200.0, 20000.0);
+    } else {
+        svfLowpass = false;
+        cutoff = std::clamp(20.0 * std::pow(250.0, currentFilter), 20.0, 5000.0);
+    }
+    cutoff = std::min(cutoff, sampleRate * 0.49);
+
+    svfG = (float) std::tan(kPi * cutoff / sampleRate);
+    svfR2 = 1.0f / kSvfResonance;
+    svfH = 1.0f / (1.0f + svfR2 * svfG + svfG * svfG);
+
+    coeffsValid = true;
+}
+
+void DeckEqProcessor::process(float* left, float* right, int numSamples) noexcept {
+    if (left == nullptr) return;
+    const int numChannels = right != nullptr ? 2 : 1;
+    float* channels[2] = { left, right };
+
+    // Everything at rest and faded out: the samples pass untouched
+    if (isBypassed()) return;
+
+    constexpr float fadeStep = 1.0f / FadeSamples;
+    for (int start = 0; start < numSamples; start += SubBlockSize) {
+        updateCoefficients();
+        const int n = std::min(SubBlockSize, numSamples - start);
+        const float wetTarget = atRest() ? 0.0f : 1.0f;
+        if (wet == wetTarget) {
+            if (wet != 0.0f) processSubBlock(channels, numChannels, start, n);
+            continue;
+        }
+
+        // Engaging or letting go: blend the cascade with the dry samples it was given
+        float dry[2][SubBlockSize];
+        for (int ch = 0; ch < numChannels; ++ch)
+            std::copy(channels[ch] + start, channels[ch] + start + n, dry[ch]);
+        processSubBlock(channels, numChannels, start, n);
+        const float step = wetTarget > wet ? fadeStep : -fadeStep;
+        float w = wet;
+        for (int ch = 0; ch < numChannels; ++ch) {
+            w = wet;
+            float* data = channels[ch] + start;
+            for (int i = 0; i < n; ++i) {
+                w = std::clamp(w + step, 0.0f, 1.0f);
+                data[i] = dry[ch][i] + w * (data[i] - dry[ch][i]);
+            }
+        }
+        wet = w;
+        // Faded out: the next engage starts from silence, not from a stale tail
+        if (wet == 0.0f) clearState();
+    }
+
+    // Flush denormals out of the recursive state once per block
+    auto flush = [](float& v) { if (std::abs(v) < 1.0e-15f) v = 0.0f; };
+    for (auto& channel : bandState)
+        for (auto& s : channel) { flush(s.z1); flush(s.z2); }
+    for (auto& s : svfState) { flush(s.s1); flush(s.s2); }
+}
+
+void DeckEqProcessor::processSubBlock(float* const* channels, int numChannels, int start, int n) noexcept {
+    // Coefficients into locals so the inner loop keeps them in registers
+    const Biquad lo = coeffs[Low], mi = coeffs[Mid], hi = coeffs[High];
+    const float g = svfG, r2 = svfR2, h = svfH;
+    const bool lowpass = svfLowpass;
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* data = channels[ch] + start;
+        BiquadState sLo = bandState[ch][Low], sMi = bandState[ch][Mid], sHi = bandState[ch][High];
+        SvfState sv = svfState[ch];
+
+        for (int i = 0; i < n; ++i) {
+            float x = data[i];
+            x = processBiquad(x, lo.b0, lo.b1, lo.b2, lo.a1, lo.a2, sLo.z1, sLo.z2);
+            x = processBiquad(x, mi.b0, mi.b1, mi.b2, mi.a1, mi.a2, sMi.z1, sMi.z2);
+            x = processBiquad(x, hi.b0, hi.b1, hi.b2, hi.a1, hi.a2, sHi.z1, sHi.z2);
+
+            const float yHP = h * (x - sv.s1 * (g + r2) - sv.s2);
+            const float yBP = yHP * g + sv.s1;
+            sv.s1 = yHP * g + yBP;
+            const float yLP = yBP * g + sv.s2;
+            sv.s2 = yBP * g + yLP;
+
+            data[i] = lowpass ? yLP : yHP;
+        }
+
+        bandState[ch][Low] = sLo;
+        bandState[ch][Mid] = sMi;
+        bandState[ch][High] = sHi;
+        svfState[ch] = sv;
+    }
+}
+
+// RBJ cookbook shelves/peak, identical to juce::dsp::IIR::Coefficients::makeLowShelf etc.
+DeckEqProcessor::Biquad DeckEqProcessor::makeLowShelf(double sr, double freq, double q, double gain) noexcept {
+    const double A = std::sqrt(std::max(0.0, gain));
+    const double aminus1 = A - 1.0, aplus1 = A + 1.0;
+    const double omega = 2.0 * kPi * freq / sr;
+    const double coso = std::cos(omega);
+    const double beta = std::sin(omega) * std::sqrt(A) / q;
+    const double aminus1TimesCoso = aminus1 * coso;
+
+    const double a0 = aplus1 + aminus1TimesCoso + beta;
+    Biquad c;
+    c.b0 = (float) (A * (aplus1 - aminus1TimesCoso + beta) / a0);
+    c.b1 = (float) (A * 2.0 * (aminus1 - aplus1 * coso) / a0);
+    c.b2 = (float) (A * (aplus1 - aminus1TimesCoso - beta) / a0);
+    c.a1 = (float) (-2.0 * (aminus1 + aplus1 * coso) / a0);
+    c.a2 = (float) ((aplus1 + aminus1TimesCoso - beta) / a0);
+    return c;
+}
+
+DeckEqProcessor::Biquad DeckEqProcessor::makeHighShelf(double sr, double freq, double q, double gain) noexcept {
+    const double A = std::sqrt(std::max(0.0, gain));
+    const double aminus1 = A - 1.0, aplus1 = A + 1.0;
+    const double omega = 2.0 * kPi * freq / sr;
+    const double coso = std::cos(omega);
+    const double beta = std::sin(omega) * std::sqrt(A) / q;
+    const double aminus1TimesCoso = aminus1 * coso;
+
+    const double a0 = aplus1 - aminus1TimesCoso + beta;
+    Biquad c;
+    c.b0 = (float) (A * (aplus1 + aminus1TimesCoso + beta) / a0);
+    c.b1 = (float) (A * -2.0 * (aminus1 + aplus1 * coso) / a0);
+    c.b2 = (float) (A * (aplus1 + aminus1TimesCoso - beta) / a0);
+    c.a1 = (float) (2.0 * (aminus1 - aplus1 * coso) / a0);
+    c.a2 = (float) ((aplus1 - aminus1TimesCoso - beta) / a0);
+    return c;
+}
+
+DeckEqProcessor::Biquad DeckEqProcessor::makePeak(double sr, double freq, double q, double gain) noexcept {
+    const double A = std::sqrt(std::max(0.0, gain));
+    const double omega = 2.0 * kPi * freq / sr;
+    const double alpha = std::sin(omega) / (q * 2.0);
+    const double c2 = -2.0 * std::cos(omega);
+    const double alphaTimesA = alpha * A;
+    const double alphaOverA = alpha / A;
+
+    const double a0 = 1.0 + alphaOverA;
+    Biquad c;
+    c.b0 = (float) ((1.0 + alphaTimesA) / a0);
+    c.b1 = (float) (c2 / a0);
+    c.b2 = (float) ((1.0 - alphaTimesA) / a0);
+    c.a1 = (float) (c2 / a0);
+    c.a2 = (float) ((1.0 - alphaOverA) / a0);
+    return c;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+
+/**
+ * Fused 3-band EQ + LP/HP filter for one deck.
+ *
+ * Replaces the separate juce::dsp IIR/SVF filters: low shelf, mid peak and high shelf biquads
+ * plus a TPT state-variable filter run as one interleaved cascade, so each sample of both
+ * channels is read and written exactly once per block. Knob values are smoothed and the
+ * coefficients re-derived every SubBlockSize samples, which removes zipper noise on fast sweeps.
+ * With every knob at rest (EQ flat, filter centred) the cascade is bypassed and process() costs
+ * nothing; turning a knob fades it in from the dry signal over FadeSamples, and once all are
+ * back at rest it fades out again. No allocation and no locks: safe for the audio thread.
+ */
+class DeckEqProcessor {
+public:
+    static constexpr int SubBlockSize = 32;
+    static constexpr int FadeSamples = 2 * SubBlockSize;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    // Knob targets, all -1..+1 (filter: negative = lowpass, positive = highpass)
+    void setTargets(double high, double mid, double low, double filter) noexcept;
+
+    // Process up to two channels in place. right may be nullptr for mono.
+    void process(float* left, float* right, int numSamples) noexcept;
+    bool isBypassed() const noexcept { return wet == 0.0f && atRest(); }
+
+private:
+    struct Biquad {
+        // Normalised TDF-II coefficients
+        float b0{1.0f}, b1{0.0f}, b2{0.0f}, a1{0.0f}, a2{0.0f};
+    };
+    struct BiquadState { float z1{0.0f}, z2{0.0f}; };
+    struct SvfState { float s1{0.0f}, s2{0.0f}; };
+
+    enum Band { Low = 0, Mid, High, NumBands };
+
+    void updateCoefficients() noexcept;
+    bool atRest() const noexcept;
+    void clearState() noexcept;
+    void processSubBlock(float* const* channels, int numChannels, int start, int n) noexcept;
+    static Biquad makeLowShelf(double sr, double freq, double q, double gain) noexcept;
+    static Biquad makeHighShelf(double sr, double freq, double q, double gain) noexcept;
+    static Biquad makePeak(double sr, double freq, double q, double gain) noexcept;
+
+    double sampleRate{44100.0};
+
+    // Smoothed parameters (current follows target once per sub-block)
+    std::array<double, NumBands> targetGain{ {0.0, 0.0, 0.0} };
+    std::array<double, NumBands> currentGain{ {0.0, 0.0, 0.0} };
+    double targetFilter{0.0};
+    double currentFilter{0.0};
+    double smoothingCoeff{0.0};  // one-pole coefficient per sub-block
+    bool coeffsValid{false};
+    float wet{0.0f};   // share of the cascade's output; 0 = bypassed
+
+    std::array<Biquad, NumBands> coeffs{};
+    std::array<std::array<BiquadState, NumBands>, 2> bandState{};
+
+    // TPT state-variable filter (same topology as juce::dsp::StateVariableTPTFilter)
+    float svfG{0.0f}, svfR2{1.0f / 0.7f}, svfH{1.0f};
+    bool svfLowpass{false};
+    std::array<SvfState, 2> svfState{};
+};
@@ -0,0 +1,1028 @@
+#include "DeckMixer.h"
+#include "DJAudioPlayer.h"
+#include "LightingOutput.h"
+#include "MasterLevelMonitor.h"
+#include "MasterScope.h"
+#include "MasterRecorder.h"
+#include "MultitrackRecorder.h"
+#include "MasterStreamer.h"
+#include "MicChannel.h"
+#include "MidiClockOutput.h"
+#include "NetworkTempoSync.h"
+#include "CueOutputDevice.h"
+#include "PreviewPlayer.h"
+#include "SamplerBank.h"
+#include "TimecodeDecoder.h"
+#include "RealtimeReclaimer.h"
+#include "RealtimeSemaphore.h"
+#include "RtTrace.h"
+#include "EventTrace.h"
+#include "FlightRecorder.h"
+#include "ThreadingPolicy.h"
+#include "SimdDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+    // dst[i] += src[i] * (start + step * i)
+    SIMD_DISPATCH
+    void addWithGainRamp(float* dst, const float* src, float start, float step, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i) dst[i] += src[i] * (start + step * (float) i);
+    }
+
+    // dst[i] *= start + step * i
+    SIMD_DISPATCH
+    void multiplyWithGainRamp(float* dst, float start, float step, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i) dst[i] *= start + step * (float) i;
+    }
+
+    // From the gain the last block ended on to this block's: the block's last sample is one step
+    // short of `to`, where the next block starts. A steady gain takes JUCE's plain passes.
+    void addWithGain(float* dst, const float* src, float from, float to, int numSamples) noexcept
+    {
+        if (from == to) juce::FloatVectorOperations::addWithMultiply(dst, src, to, numSamples);
+        else addWithGainRamp(dst, src, from, (to - from) / (float) numSamples, numSamples);
+    }
+
+    void multiplyWithGain(float* dst, float from, float to, int numSamples) noexcept
+    {
+        if (from == to) juce::FloatVectorOperations::multiply(dst, to, numSamples);
+        else multiplyWithGainRamp(dst, from, (to - from) / (float) numSamples, numSamples);
+    }
+
+    // Playback trim that brings `follower` to `master`'s tempo and pulls it onto the nearest
+    // master beat over responseSeconds (the pull limited to maxCorrection of the tempo)
+    double phaseLockTrim(const DJAudioPlayer::BeatClock& master, const DJAudioPlayer::BeatClock& follower,
+                         double responseSeconds, double maxCorrection, double& errorBeats)
+    {
+        // Offset to the nearest master beat, in beats (-0.5 .. +0.5, positive = follower behind)
+        const double masterBeats = (master.positionSec - master.firstBeatSec) * master.bpm / 60.0;
+        const double followerBeats = (follower.positionSec - follower.firstBeatSec) * follower.bpm / 60.0;
+        errorBeats = masterBeats - followerBeats;
+        errorBeats -= std::round(errorBeats);
+
+        // Exact tempo match plus a proportional phase pull (beats per second -> playback ratio)
+        const double matchedRatio = master.ratio * master.bpm / follower.bpm;
+        const double pull = juce::jlimit(-maxCorrection, maxCorrection,
+                                         errorBeats * 60.0 / (follower.bpm * responseSeconds * matchedRatio));
+        const double trim = matchedRatio * (1.0 + pull) / std::max(1.0e-6, follower.tempo);
+        return juce::jlimit(0.5, 2.0, trim);
+    }
+}
+
+// Dedicated render thread for one strip. Sleeps on a semaphore until the audio callback
+// posts a block, renders it, then signals completion back to the callback.
+class DeckMixer::RenderWorker : public juce::Thread {
+public:
+    RenderWorker(DeckMixer& mixer, int stripIndex)
+        : juce::Thread("DeckRender " + juce::String(stripIndex)), owner(mixer), index(stripIndex) {}
+
+    ~RenderWorker() override { shutdown(); }
+
+    bool launch(int samplesPerBlock, double sampleRate) {
+        // Pinned to its own core, one of the reserved ones when the policy isolates audio
+        auto& policy = ThreadingPolicy::getInstance();
+        if (const juce::uint32 mask = policy.getRenderAffinity(index))
+            setAffinityMask(mask);
+
+        const auto options = juce::Thread::RealtimeOptions{}
+                                 .withPriority(policy.getRenderPriority())
+                                 .withApproximateAudioProcessingTime(juce::jmax(1, samplesPerBlock), sampleRate);
+        if (startRealtimeThread(options)) {
+            policy.noteRenderWorker(true);
+            return true;
+        }
+
+        // No realtime permission (e.g. missing rtprio limits): fall back to the highest normal priority
+        std::cout << "DeckMixer: realtime priority unavailable for worker " << index
+                  << ", using high priority" << std::endl;
+        policy.noteRenderWorker(false);
+        return startThread(juce::Thread::Priority::highest);
+    }
+
+    void shutdown() {
+        if (!isThreadRunning()) return;
+        signalThreadShouldExit();
+        wake.post();
+        stopThread(1000);
+    }
+
+    void run() override {
+        RtTrace::attachCurrentThread();
+        EventTrace::attachCurrentThread();
+        while (!threadShouldExit()) {
+            wake.wait();
+            if (threadShouldExit()) break;
+            owner.renderChannel(index, owner.jobNumSamples.load(std::memory_order_acquire),
+                                owner.strips[(size_t) index].buffer);
+            done.post();
+        }
+    }
+
+    RealtimeSemaphore wake;
+    RealtimeSemaphore done;
+
+private:
+    DeckMixer& owner;
+    const int index;
+};
+
+DeckMixer::DeckMixer()
+{
+    // Built here, so the audio thread never runs the static initialisation
+    getCrossfaderTables();
+}
+
+DeckMixer::~DeckMixer()
+{
+    // Owner removes the device callback before destroying us, so no block is in flight here
+    stopWorkers();
+}
+
+void DeckMixer::setParallelRendering(bool enabled)
+{
+    if (enabled) {
+        startWorkersUpTo(numChannels.load());
+    }
+    parallelRendering.store(enabled);
+    std::cout << "DeckMixer: parallel deck rendering " << (enabled ? "enabled" : "disabled")
+              << " (" << numWorkersReady.load() << " workers)" << std::endl;
+}
+
+void DeckMixer::startWorkersUpTo(int numStrips)
+{
+    // Workers are only ever added, never removed while the device runs, so the callback can
+    // safely use any worker below numWorkersReady without further synchronisation
+    const int target = juce::jmin(numStrips, MaxChannels);
+    for (int i = numWorkersReady.load() + 1; i < target; ++i) {
+        auto worker = std::make_unique<RenderWorker>(*this, i);
+        if (!worker->launch(preparedSamples, preparedSampleRate)) {
+            std::cout << "DeckMixer: failed to start render worker " << i << std::endl;
+            return;
+        }
+        workers[(size_t) i] = std::move(worker);
+        numWorkersReady.store(i, std::memory_order_release);
+    }
+}
+
+void DeckMixer::stopWorkers()
+{
+    parallelRendering.store(false);
+    numWorkersReady.store(0);
+    for (auto& worker : workers) {
+        if (worker) worker->shutdown();
+        worker.reset();
+    }
+}
+
+float DeckMixer::getChannelRenderMs(int index) const
+{
+    if (index < 0 || index >= MaxChannels) return 0.0f;
+    return strips[(size_t) index].lastRenderMs.load();
+}
+
+float DeckMixer::getChannelPeakRenderMs(int index) const
+{
+    if (index < 0 || index >= MaxChannels) return 0.0f;
+    return strips[(size_t) index].peakRenderMs.load();
+}
+
+void DeckMixer::resetRenderStats()
+{
+    for (auto& strip : strips) {
+        strip.lastRenderMs.store(0.0f);
+        strip.peakRenderMs.store(0.0f);
+    }
+}
+
+int DeckMixer::addChannel(DJAudioPlayer* player, CrossfaderSide side)
+{
+    const int index = numChannels.load(std::memory_order_relaxed);
+    if (index >= MaxChannels) {
+        std::cout << "DeckMixer: channel pool full (" << MaxChannels << "), cannot add channel" << std::endl;
+        return -1;
+    }
+
+    auto& strip = strips[(size_t) index];
+    strip.player.store(player);
+    strip.gain.store(1.0f);
+    strip.side.store((int) side);
+    // No buffer work here: audioDeviceAboutToStart preallocates all MaxChannels strips
+
+    // Publish the fully initialised strip to the audio thread
+    numChannels.store(index + 1, std::memory_order_release);
+    if (parallelRendering.load())
+        startWorkersUpTo(index + 1);
+    std::cout << "DeckMixer: added channel " << index << " (crossfader side " << (int) side << ")" << std::endl;
+    return index;
+}
+
+void DeckMixer::setChannelPlayer(int index, DJAudioPlayer* player)
+{
+    if (index < 0 || index >= MaxChannels) return;
+    strips[(size_t) index].player.store(player);
+}
+
+void DeckMixer::setChannelGain(int index, float gain)
+{
+    if (index < 0 || index >= MaxChannels) return;
+    strips[(size_t) index].gain.store(juce::jlimit(0.0f, 1.0f, gain));
+}
+
+void DeckMixer::setChannelCrossfaderSide(int index, CrossfaderSide side)
+{
+    if (index < 0 || index >= MaxChannels) return;
+    strips[(size_t) index].side.store((int) side);
+}
+
+void DeckMixer::setChannelCue(int index, bool enabled)
+{
+    if (index < 0 || index >= MaxChannels) return;
+    strips[(size_t) index].cue.store(enabled);
+}
+
+bool DeckMixer::isChannelCue(int index) const
+{
+    if (index < 0 || index >= MaxChannels) return false;
+    return strips[(size_t) index].cue.load();
+}
+
+void DeckMixer::setChannelSync(int index, bool enabled)
+{
+    if (index < 0 || index >= MaxChannels) return;
+    strips[(size_t) index].sync.store(enabled);
+}
+
+void DeckMixer::setChannelTimecode(int index, TimecodeDecoder* decoder, int firstInput)
+{
+    if (index < 0 || index >= MaxChannels) return;
+    strips[(size_t) index].timecodeInput.store(firstInput);
+    strips[(size_t) index].timecode.store(decoder, std::memory_order_release);
+}
+
+bool DeckMixer::isChannelSync(int index) const
+{
+    if (index < 0 || index >= MaxChannels) return false;
+    return strips[(size_t) index].sync.load();
+}
+
+float DeckMixer::getChannelPhaseErrorMs(int index) const
+{
+    if (index < 0 || index >= MaxChannels) return 0.0f;
+    return strips[(size_t) index].phaseErrorMs.load();
+}
+
+juce::uint64 DeckMixer::nowNs() noexcept
+{
+    return (juce::uint64) (juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()) * 1.0e9);
+}
+
+void DeckMixer::decodeTimecode(const float* const* inputChannelData, int numInputChannels, int active, int numSamples)
+{
+    for (int i = 0; i < active; ++i) {
+        auto& strip = strips[(size_t) i];
+        TimecodeDecoder* decoder = strip.timecode.load(std::memory_order_acquire);
+        DJAudioPlayer* player = strip.player.load(std::memory_order_relaxed);
+        if (decoder == nullptr || player == nullptr) continue;
+        // Without the input pair (no inputs opened, fewer than asked for) the deck holds still
+        const int first = strip.timecodeInput.load(std::memory_order_relaxed);
+        if (first < 0 || first + 1 >= numInputChannels || !inputChannelData[first] || !inputChannelData[first + 1])
+            continue;
+        decoder->process(inputChannelData[first], inputChannelData[first + 1], numSamples);
+        player->setTimecodeBlock(decoder->getPositions(), decoder->getNumPositions(), decoder->isAbsolute());
+    }
+}
+
+void DeckMixer::setMicChannel(MicChannel* mic, int input)
+{
+    micInput.store(input, std::memory_order_relaxed);
+    micChannel.store(mic, std::memory_order_release);
+}
+
+MicChannel* DeckMixer::processMic(const float* const* inputChannelData, int numInputChannels, int numSamples)
+{
+    MicChannel* mic = micChannel.load(std::memory_order_acquire);
+    if (mic == nullptr) return nullptr;
+    const int input = micInput.load(std::memory_order_relaxed);
+    mic->process(input >= 0 && input < numInputChannels ? inputChannelData[input] : nullptr, numSamples);
+    return mic;
+}
+
+void DeckMixer::publishPositions(int active, juce::uint64 blockEndNs)
+{
+    for (int i = 0; i < active; ++i) {
+        if (DJAudioPlayer* player = strips[(size_t) i].player.load(std::memory_order_acquire))
+            player->publishPositionSnapshot(blockEndNs);
+    }
+}
+
+void DeckMixer::applyBeatSync(int active, juce::uint64 blockStartNs)
+{
+    int master = syncMaster.load(std::memory_order_relaxed);
+    DJAudioPlayer* masterPlayer = (master >= 0 && master < active)
+                                      ? strips[(size_t) master].player.load(std::memory_order_acquire) : nullptr;
+    DJAudioPlayer::BeatClock masterClock;
+    bool masterRunning = masterPlayer != nullptr && masterPlayer->getBeatClock(masterClock);
+
+    // The master's timeline at this block's first sample (valid = false while it stands)
+    const auto masterTimeline = [&] {
+        NetworkTempoSync::Timeline timeline;
+        if (masterRunning) {
+            timeline.bpm = masterClock.bpm * masterClock.ratio;
+            timeline.beat = (masterClock.positionSec - masterClock.firstBeatSec) * masterClock.bpm / 60.0;
+            timeline.timeNs = blockStartNs;
+            timeline.valid = true;
+        }
+        return timeline;
+    };
+
+    if (NetworkTempoSync* network = networkSync.load(std::memory_order_acquire)) {
+        NetworkTempoSync::Timeline session;
+        if (network->getSessionTimeline(session)) {
+            // The session is the master: a clock at its beat for this block's first sample,
+            // running at its tempo in output time; every synced strip follows it
+            masterClock = DJAudioPlayer::BeatClock{};
+            masterClock.bpm = session.bpm;
+            masterClock.positionSec = session.beatAt(blockStartNs) * 60.0 / session.bpm;
+            masterRunning = true;
+            master = -1;
+        } else if (network->getRole() == NetworkTempoSync::Role::Lead) {
+            network->publishTimeline(masterTimeline());
+        }
+    }
+    // MIDI clock follows whatever the synced decks follow, the session included
+    if (MidiClockOutput* clock = midiClock.load(std::memory_order_acquire))
+        clock->publishTimeline(masterTimeline());
+    // The lights get it with the finished master, after the mix
+    blockBeat.startNs = blockStartNs;
+    blockBeat.timeline = masterTimeline();
+    blockBeat.player = master >= 0 ? masterPlayer : nullptr;
+    blockBeat.trackSec = masterClock.positionSec;
+    blockBeat.trackRatio = masterClock.ratio;
+
+    // Runs before any strip renders, so every clock belongs to the same instant and the
+    // players' audio-thread state is not being touched by a worker right now
+    for (int i = 0; i < active; ++i) {
+        auto& strip = strips[(size_t) i];
+        DJAudioPlayer* player = strip.player.load(std::memory_order_acquire);
+        if (player == nullptr) continue;
+
+        DJAudioPlayer::BeatClock clock;
+        if (i == master || !strip.sync.load(std::memory_order_relaxed) || !masterRunning
+            || !player->getBeatClock(clock)) {
+            player->setSyncTrim(1.0);
+            strip.phaseErrorMs.store(0.0f, std::memory_order_relaxed);
+            continue;
+        }
+
+        double error = 0.0;
+        player->setSyncTrim(phaseLockTrim(masterClock, clock, SyncResponseSeconds, MaxSyncCorrection, error));
+
+        const double outputBeatMs = 60000.0 / (masterClock.bpm * std::max(1.0e-6, masterClock.ratio));
+        strip.phaseErrorMs.store((float) (error * outputBeatMs), std::memory_order_relaxed);
+    }
+}
+
+bool DeckMixer::scheduleTransition(const Transition& next)
+{
+    if (next.fromStrip < 0 || next.fromStrip >= MaxChannels || next.toStrip < 0 || next.toStrip >= MaxChannels
+        || next.fromStrip == next.toStrip || next.outBpm <= 0.0 || next.inBpm <= 0.0 || next.fadeBeats <= 0.0)
+        return false;
+    return transitionQueue.push(next);
+}
+
+void DeckMixer::cancelTransition()
+{
+    transitionQueue.push(Transition{});
+}
+
+void DeckMixer::applyTransition(int active, int numSamples)
+{
+    using State = TransitionState;
+    TransitionStatus& status = transitionRt;
+    bool changed = false;
+    Transition next;
+    while (transitionQueue.pop(next)) {
+        changed = true;
+        if (next.fromStrip < 0) {
+            if (status.state == State::Waiting || status.state == State::Fading || status.state == State::Ramping)
+                status.state = State::Cancelled;
+            continue;
+        }
+        transition = next;
+        status = TransitionStatus{ next.serial, State::Waiting, 0.0f, crossfaderPos.load(std::memory_order_relaxed) };
+        transitionElapsed = 0;
+    }
+    const juce::ScopeGuard publish{ [&] { if (changed) transitionStatus.store(status); } };
+    if (status.state != State::Waiting && status.state != State::Fading && status.state != State::Ramping) return;
+    changed = true;
+
+    auto playerAt = [&](int index) {
+        return index < active ? strips[(size_t) index].player.load(std::memory_order_acquire) : nullptr;
+    };
+    DJAudioPlayer* from = playerAt(transition.fromStrip);
+    DJAudioPlayer* to = playerAt(transition.toStrip);
+    if (from == nullptr || to == nullptr || preparedSampleRate <= 0.0) {
+        status.state = State::Cancelled;
+        return;
+    }
+    DJAudioPlayer::BeatClock outClock;
+    const bool outRunning = from->getBeatClock(outClock);
+
+    if (status.state == State::Waiting) {
+        // Waits for as long as the outgoing deck isn't running along its timeline
+        if (!outRunning) return;
+        const double ahead = (transition.triggerSec - outClock.positionSec) / std::max(1.0e-6, outClock.ratio);
+        if (ahead < -TransitionLateSeconds) {
+            status.state = State::Missed;
+            return;
+        }
+        const juce::int64 offset = std::max<juce::int64>(0, std::llround(ahead * preparedSampleRate));
+        if (offset >= numSamples) return;
+        if (!to->startArmed((int) offset)) {
+            status.state = State::Missed;
+            return;
+        }
+        transitionElapsed = -offset;
+        transitionFadeFrames = std::max<juce::int64>(1, std::llround(transition.fadeBeats * 60.0
+            / (transition.outBpm * outClock.ratio) * preparedSampleRate));
+        transitionTrim = transition.matchTempo
+            ? outClock.ratio * transition.outBpm / transition.inBpm / std::max(1.0e-6, to->getRealtimeTempo()) : 1.0;
+        status.state = State::Fading;
+    }
+
+    if (status.state == State::Fading) {
+        if (transition.matchTempo) {
+            // Phase-locked like a synced deck once it runs; until then (the block it starts in)
+            // at the matched tempo
+            DJAudioPlayer::BeatClock inClock;
+            double error = 0.0;
+            if (outRunning && to->getBeatClock(inClock))
+                transitionTrim = phaseLockTrim(outClock, inClock, SyncResponseSeconds, MaxSyncCorrection, error);
+            to->setSyncTrim(transitionTrim);
+        }
+        const double progress = juce::jlimit(0.0, 1.0, (double) transitionElapsed / (double) transitionFadeFrames);
+        status.progress = (float) progress;
+        status.crossfader = (float) (transition.crossfaderFrom + (transition.crossfaderTo - transition.crossfaderFrom) * progress);
+        crossfaderPos.store(status.crossfader);
+        if (transitionElapsed >= transitionFadeFrames) {
+            DJAudioPlayer::BeatClock inClock;
+            const double inRatio = to->getBeatClock(inClock) ? inClock.ratio : transitionTrim;
+            transitionRampFrom = transitionTrim;
+            transitionRampFrames = std::max<juce::int64>(1, std::llround(transition.rampBeats * 60.0
+                / (transition.inBpm * std::max(1.0e-6, inRatio)) * preparedSampleRate));
+            status.state = transition.matchTempo && transition.rampBeats > 0.0 ? State::Ramping : State::Done;
+        }
+    } else if (status.state == State::Ramping) {
+        const double t = juce::jlimit(0.0, 1.0, (double) (transitionElapsed - transitionFadeFrames) / (double) transitionRampFrames);
+        transitionTrim = transitionRampFrom + (1.0 - transitionRampFrom) * t;
+        to->setSyncTrim(transitionTrim);
+        if (t >= 1.0) status.state = State::Done;
+    }
+    transitionElapsed += numSamples;
+}
+
+const std::array<DeckMixer::CrossfaderTable, DeckMixer::NumCrossfaderCurves>& DeckMixer::getCrossfaderTables()
+{
+    static const auto tables = [] {
+        std::array<CrossfaderTable, NumCrossfaderCurves> built{};
+        // Quarter cosine from unity at `from` to silence at full travel
+        const auto fadeFrom = [](float from, float travel) {
+            return travel <= from ? 1.0f : (float) std::cos((travel - from) / (1.0f - from) * M_PI * 0.5);
+        };
+        for (int i = 0; i <= CrossfaderTableSteps; ++i) {
+            const float travel = (float) i / (float) CrossfaderTableSteps;
+            built[(size_t) CrossfaderCurve::Smooth][(size_t) i] = fadeFrom(0.0f, travel);
+            built[(size_t) CrossfaderCurve::Dipless][(size_t) i] = fadeFrom(0.5f, travel);
+            built[(size_t) CrossfaderCurve::ScratchCut][(size_t) i] = fadeFrom(1.0f - ScratchCutTravel, travel);
+        }
+        return built;
+    }();
+    return tables;
+}
+
+float DeckMixer::crossfaderGainFor(CrossfaderSide side, float crossfader) const
+{
+    if (side != CrossfaderSide::A && side != CrossfaderSide::B) return 1.0f;
+    const auto& table = getCrossfaderTables()[(size_t) crossfaderCurve.load(std::memory_order_relaxed)];
+    // Travel away from the strip's own side
+    const float travel = (side == CrossfaderSide::A ? crossfader + 1.0f : 1.0f - crossfader) * 0.5f;
+    const float x = juce::jlimit(0.0f, 1.0f, travel) * (float) CrossfaderTableSteps;
+    const int i = std::min((int) x, CrossfaderTableSteps - 1);
+    return table[(size_t) i] + (table[(size_t) i + 1] - table[(size_t) i]) * (x - (float) i);
+}
+
+void DeckMixer::renderChannel(int index, int numSamples, juce::AudioBuffer<float>& buffer)
+{
+    auto& strip = strips[(size_t) index];
+    buffer.clear(0, numSamples);
+
+    DJAudioPlayer* player = strip.player.load(std::memory_order_acquire);
+    strip.silent = true;
+    if (player == nullptr) {
+        strip.lastRenderMs.store(0.0f, std::memory_order_relaxed);
+        return;
+    }
+
+    static const char* const stripEvents[] = { "Deck 1 render", "Deck 2 render", "Deck 3 render", "Deck 4 render",
+                                               "Deck 5 render", "Deck 6 render", "Deck 7 render", "Deck 8 render" };
+    static_assert(std::size(stripEvents) == MaxChannels, "one event name per strip");
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    juce::AudioSourceChannelInfo info;
+    info.buffer = &buffer;
+    info.startSample = 0;
+    info.numSamples = numSamples;
+    player->getNextAudioBlock(info);
+    strip.silent = player->wasBlockSilent();
+
+    const juce::int64 elapsed = juce::Time::getHighResolutionTicks() - startTicks;
+    const auto stages = player->takeStageTicks();
+    profiler.recordDeck(index, CallbackProfiler::DeckStage::Decode, stages.decode);
+    profiler.recordDeck(index, CallbackProfiler::DeckStage::Eq, stages.eq);
+    profiler.recordDeck(index, CallbackProfiler::DeckStage::Stretch,
+                        std::max<juce::int64>(0, elapsed - stages.decode - stages.eq));
+    profiler.recordDeck(index, CallbackProfiler::DeckStage::Total, elapsed);
+
+    const float ms = (float) (juce::Time::highResolutionTicksToSeconds(elapsed) * 1000.0);
+    EventTrace::complete(stripEvents[index], "audio", startTicks, startTicks + elapsed);
+    strip.lastRenderMs.store(ms, std::memory_order_relaxed);
+    if (ms > strip.peakRenderMs.load(std::memory_order_relaxed))
+        strip.peakRenderMs.store(ms, std::memory_order_relaxed);
+}
+
+void DeckMixer::renderChannels(int numActive, int numSamples, juce::AudioBuffer<float>* strip0Target)
+{
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    const juce::ScopeGuard addRenderTicks{ [&] { renderTicks += juce::Time::getHighResolutionTicks() - startTicks; } };
+    auto& firstTarget = strip0Target != nullptr ? *strip0Target : strips[0].buffer;
+    // Parallel: strips 1..n-1 on their workers, strip 0 inline, then join before the master sum
+    const int workersReady = numWorkersReady.load(std::memory_order_acquire);
+    if (parallelRendering.load(std::memory_order_relaxed) && numActive > 1 && workersReady > 0) {
+        const int parallelUpTo = juce::jmin(numActive - 1, workersReady);
+        jobNumSamples.store(numSamples, std::memory_order_release);
+        for (int i = 1; i <= parallelUpTo; ++i)
+            workers[(size_t) i]->wake.post();
+
+        renderChannel(0, numSamples, firstTarget);
+        // Strips without a worker yet (added after enabling) render inline as well
+        for (int i = parallelUpTo + 1; i < numActive; ++i)
+            renderChannel(i, numSamples, strips[(size_t) i].buffer);
+
+        for (int i = 1; i <= parallelUpTo; ++i)
+            workers[(size_t) i]->done.wait();
+        return;
+    }
+
+    if (numActive > 0)
+        renderChannel(0, numSamples, firstTarget);
+    for (int i = 1; i < numActive; ++i)
+        renderChannel(i, numSamples, strips[(size_t) i].buffer);
+}
+
+void DeckMixer::sumCueStrips(float* const* cueOut, int active, int numSamples, const float* const* strip0)
+{
+    for (int ch = 0; ch < 2; ++ch)
+        juce::FloatVectorOperations::clear(cueOut[ch], numSamples);
+
+    for (int i = 0; i < active; ++i) {
+        auto& strip = strips[(size_t) i];
+        if (!strip.cue.load(std::memory_order_relaxed) || strip.silent) continue;
+        for (int ch = 0; ch < 2; ++ch) {
+            const float* src = (i == 0 && strip0 != nullptr) ? strip0[ch]
+                             : ch < strip.buffer.getNumChannels() ? strip.buffer.getReadPointer(ch) : nullptr;
+            if (src != nullptr)
+                juce::FloatVectorOperations::add(cueOut[ch], src, numSamples);
+        }
+    }
+}
+
+void DeckMixer::tapMultitrack(int active, int numSamples, MicChannel* mic, const float* const* strip0)
+{
+    auto* recorder = multitrackRecorder.load(std::memory_order_relaxed);
+    if (recorder == nullptr || !recorder->beginBlock(numSamples)) return;
+    static_assert(MultitrackRecorder::MaxDecks == MaxChannels, "one recorder track per strip");
+
+    const float crossfader = crossfaderPos.load();
+    for (int i = 0; i < active; ++i) {
+        auto& strip = strips[(size_t) i];
+        const bool audible = !strip.silent && strip.player.load(std::memory_order_relaxed) != nullptr;
+        const float gain = audible ? strip.gain.load() * crossfaderGainFor((CrossfaderSide) strip.side.load(), crossfader) : 0.0f;
+        const float* channels[2] = { (i == 0 && strip0 != nullptr) ? strip0[0] : strip.buffer.getReadPointer(0),
+                                     (i == 0 && strip0 != nullptr) ? strip0[1] : strip.buffer.getReadPointer(1) };
+        recorder->push(i, channels, 2, numSamples, gain);   // gain 0 writes silence
+    }
+    const float* micSignal = mic != nullptr ? mic->getSignal(numSamples) : nullptr;
+    recorder->push(MultitrackRecorder::MicTrack, micSignal != nullptr ? &micSignal : nullptr, 1, numSamples, 1.0f);
+    recorder->endBlock();
+}
+
+void DeckMixer::finishCueBus(float* const* cueOut, const float* const* masterOut, int numSamples)
+{
+    // Linear blend like a hardware cue/master knob; both ends are unity
+    const float mix = cueMix.load(std::memory_order_relaxed);
+    const float level = headphoneVolume.load(std::memory_order_relaxed);
+    const float cueGain = level * (1.0f - mix);
+    const float masterGain = level * mix;
+
+    for (int ch = 0; ch < 2; ++ch) {
+        if (cueGain != 1.0f) juce::FloatVectorOperations::multiply(cueOut[ch], cueGain, numSamples);
+        if (masterGain > 0.0f && masterOut[ch] != nullptr)
+            juce::FloatVectorOperations::addWithMultiply(cueOut[ch], masterOut[ch], masterGain, numSamples);
+    }
+}
+
+void DeckMixer::mixFused(float* const* outputChannelData, int active, int numSamples, MicChannel* mic, float* const* cueOut)
+{
+    // Strip 0 renders in place; the view only refers to the device channels (no allocation)
+    juce::AudioBuffer<float> deviceView(outputChannelData, 2, numSamples);
+    renderChannels(active, numSamples, &deviceView);
+    EVENT_TRACE_SCOPE("Mix", "audio");
+
+    // Cue and the multitrack tap have to be taken before strip 0 is scaled in place
+    tapMultitrack(active, numSamples, mic, outputChannelData);
+    if (cueOut != nullptr) {
+        sumCueStrips(cueOut, active, numSamples, outputChannelData);
+        if (auto* preview = previewPlayer.load(std::memory_order_relaxed))
+            preview->renderAdding(cueOut, 2, numSamples);
+    }
+
+    const float crossfader = crossfaderPos.load();
+    const float master = masterVolume.load();
+    const float masterFrom = std::exchange(masterRampGain, master);
+    auto* monitor = levelMonitor.load();
+
+    // Every strip ramps from where its last block ended to fader x crossfader x master now
+    std::array<float, MaxChannels> fromGains{}, toGains{};
+    for (int i = 0; i < active; ++i) {
+        auto& strip = strips[(size_t) i];
+        const float gain = strip.player.load(std::memory_order_relaxed) == nullptr ? 0.0f
+                         : strip.gain.load() * crossfaderGainFor((CrossfaderSide) strip.side.load(), crossfader);
+        fromGains[(size_t) i] = std::exchange(strip.rampGain, gain) * masterFrom;
+        toGains[(size_t) i] = gain * master;
+    }
+
+    for (int ch = 0; ch < 2; ++ch) {
+        float* out = outputChannelData[ch];
+        if (active == 0 || (fromGains[0] <= 0.0f && toGains[0] <= 0.0f)) juce::FloatVectorOperations::clear(out, numSamples);
+        else if (fromGains[0] != 1.0f || toGains[0] != 1.0f) multiplyWithGain(out, fromGains[0], toGains[0], numSamples);
+
+        for (int i = 1; i < active; ++i) {
+            if (strips[(size_t) i].silent || (fromGains[(size_t) i] <= 0.0f && toGains[(size_t) i] <= 0.0f)) continue;
+            addWithGain(out, strips[(size_t) i].buffer.getReadPointer(ch), fromGains[(size_t) i], toGains[(size_t) i], numSamples);
+        }
+    }
+    if (auto* sampler = samplerBank.load(std::memory_order_relaxed))
+        sampler->renderAdding(outputChannelData, 2, numSamples, master * samplerGain.load());
+    const bool micDirect = mic != nullptr && mic->isDirectMonitor();
+    if (mic != nullptr) {
+        mic->applyDuck(outputChannelData, 2, numSamples);
+        if (!micDirect) mic->addTo(outputChannelData, 2, numSamples, master);
+    }
+    limiter.process(outputChannelData, 2, numSamples);
+    if (micDirect) mic->addTo(outputChannelData, 2, numSamples, 1.0f);
+
+    // Meter while the finished block is still in cache
+    if (monitor != nullptr)
+        monitor->process(outputChannelData, 2, numSamples);
+    if (auto* scope = masterScope.load(std::memory_order_relaxed))
+        scope->push(outputChannelData, 2, numSamples);
+    if (auto* recorder = masterRecorder.load(std::memory_order_relaxed))
+        recorder->push(outputChannelData, 2, numSamples);
+    if (auto* streamer = masterStreamer.load(std::memory_order_relaxed))
+        streamer->push(outputChannelData, 2, numSamples);
+    if (auto* lighting = lightingOutput.load(std::memory_order_relaxed))
+        lighting->pushBlock(outputChannelData, 2, numSamples, blockBeat.startNs, blockBeat.timeline, blockBeat.player,
+                            blockBeat.trackSec, blockBeat.trackRatio);
+    if (cueOut != nullptr)
+        finishCueBus(cueOut, outputChannelData, numSamples);
+}
+
+void DeckMixer::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                                 float* const* outputChannelData, int numOutputChannels,
+                                                 int numSamples, const juce::AudioIODeviceCallbackContext& context)
+{
+    // Whatever the UI swaps out while this block runs is destroyed after it, off this thread
+    RealtimeReclaimer::ReadScope reclaimScope;
+    // Core and priority of this thread, once per device start
+    ThreadingPolicy::getInstance().applyToAudioThread();
+    RtTrace::attachCurrentThread();
+    EventTrace::attachCurrentThread("Audio callback");
+    EVENT_TRACE_SCOPE("Audio callback", "audio");
+
+    // Whole callback and the mix stage (everything outside the strips), on every return path
+    const auto callbackStartTicks = juce::Time::getHighResolutionTicks();
+    renderTicks = 0;
+    const juce::ScopeGuard recordTiming{ [&] {
+        const auto endTicks = juce::Time::getHighResolutionTicks();
+        profiler.recordMix(std::max<juce::int64>(0, endTicks - callbackStartTicks - renderTicks));
+        profiler.recordCallback(callbackStartTicks, endTicks, numSamples, preparedSampleRate);
+        FlightRecorder::callback(callbackStartTicks, endTicks, numSamples, preparedSampleRate);
+    } };
+
+    // When the start of this block will be heard: host time if the driver gives one, otherwise
+    // now plus the output latency the device reported. A calibrated latency corrects either by
+    // what the driver leaves out.
+    const double nsPerSample = preparedSampleRate > 0.0 ? 1.0e9 / preparedSampleRate : 0.0;
+    const int latencyCorrection = latencyCorrectionSamples.load(std::memory_order_relaxed) + limiter.getLatencySamples();
+    const juce::uint64 blockStartNs = (juce::uint64) std::max<juce::int64>(0,
+        (context.hostTimeNs != nullptr ? (juce::int64) *context.hostTimeNs
+                                       : (juce::int64) nowNs() + (juce::int64) (outputLatencySamples * nsPerSample))
+        + (juce::int64) (latencyCorrection * nsPerSample));
+
+    if (++callCount % 5000 == 0) {  // Less frequent logging
+        RT_TRACE_DEBUG("DeckMixer running ({} callbacks, {} channels, parallel={}), {} ms buffer",
+                       callCount, getNumChannels(), parallelRendering.load(), bufferDurationMs.load());
+        for (int i = 0; i < getNumChannels(); ++i)
+            RT_TRACE_DEBUG("DeckMixer strip {} render ms: {}/{}", i, getChannelRenderMs(i), getChannelPeakRenderMs(i));
+    }
+
+    if (numSamples <= preparedSamples) {
+        renderBlock(inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples,
+                    blockStartNs, callbackStartTicks);
+        return;
+    }
+
+    // The device handed over more than it announced. The strip buffers keep the size
+    // prepareToRender gave them, so the block renders in slices of at most that size.
+    // Channels past MaxDeviceChannels stay silent.
+    const int numSliceInputs = std::min(numInputChannels, MaxDeviceChannels);
+    const int numSliceOutputs = std::min(numOutputChannels, MaxDeviceChannels);
+    for (int ch = numSliceOutputs; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch]) juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+    if (preparedSamples <= 0) {
+        for (int ch = 0; ch < numSliceOutputs; ++ch)
+            if (outputChannelData[ch]) juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+        return;
+    }
+
+    std::array<const float*, MaxDeviceChannels> sliceInputs{};
+    std::array<float*, MaxDeviceChannels> sliceOutputs{};
+    for (int offset = 0; offset < numSamples; offset += preparedSamples) {
+        const int sliceSamples = std::min(preparedSamples, numSamples - offset);
+        for (int ch = 0; ch < numSliceInputs; ++ch)
+            sliceInputs[(size_t) ch] = inputChannelData[ch] ? inputChannelData[ch] + offset : nullptr;
+        for (int ch = 0; ch < numSliceOutputs; ++ch)
+            sliceOutputs[(size_t) ch] = outputChannelData[ch] ? outputChannelData[ch] + offset : nullptr;
+        renderBlock(sliceInputs.data(), numSliceInputs, sliceOutputs.data(), numSliceOutputs, sliceSamples,
+                    blockStartNs + (juce::uint64) (offset * nsPerSample), callbackStartTicks);
+    }
+}
+
+void DeckMixer::renderBlock(const float* const* inputChannelData, int numInputChannels,
+                            float* const* outputChannelData, int numOutputChannels, int numSamples,
+                            juce::uint64 blockStartNs, juce::int64 callbackStartTicks)
+{
+    const double nsPerSample = preparedSampleRate > 0.0 ? 1.0e9 / preparedSampleRate : 0.0;
+    const juce::uint64 blockEndNs = blockStartNs + (juce::uint64) (juce::jmax(0, numSamples) * nsPerSample);
+    // Before the decks drain their command queues: a command posted from now on is heard at
+    // the earliest in the next block, which starts at the new count
+    renderedFrames.fetch_add(juce::jmax(0, numSamples), std::memory_order_relaxed);
+
+    const int active = numChannels.load(std::memory_order_acquire);
+    if (numSamples > 0) {
+        applyBeatSync(active, blockStartNs);
+        applyTransition(active, numSamples);
+        decodeTimecode(inputChannelData, numInputChannels, active, numSamples);
+    }
+    // The mic's input block goes out in this same block
+    MicChannel* mic = numSamples > 0 ? processMic(inputChannelData, numInputChannels, numSamples) : nullptr;
+
+    // Outputs 3/4 carry the cue bus when the device has them, unless a second device does;
+    // further channels mirror the master
+    auto* cueDevice = cueOutputDevice.load(std::memory_order_relaxed);
+    const bool externalCueBus = cueDevice != nullptr && cueDevice->isOpen() && numSamples <= externalCue.getNumSamples();
+    const bool deviceCueBus = !externalCueBus && numOutputChannels >= 4 && outputChannelData[2] && outputChannelData[3];
+    const bool cueBus = externalCueBus || deviceCueBus;
+    cueOutputAvailable.store(cueBus, std::memory_order_relaxed);
+    float* const* cueOut = externalCueBus ? externalCue.getArrayOfWritePointers()
+                         : deviceCueBus ? outputChannelData + 2 : nullptr;
+    const int firstMirrored = deviceCueBus ? 4 : 2;
+
+    const bool fused = lowLatencyMode.load(std::memory_order_relaxed) && numSamples > 0
+                       && numOutputChannels >= 2 && outputChannelData[0] && outputChannelData[1];
+    if (fused) {
+        mixFused(outputChannelData, active, numSamples, mic, cueOut);
+        if (externalCueBus) cueDevice->push(cueOut, numSamples, callbackStartTicks);
+        publishPositions(active, blockEndNs);
+        for (int ch = firstMirrored; ch < numOutputChannels; ++ch) {
+            if (outputChannelData[ch])
+                juce::FloatVectorOperations::copy(outputChannelData[ch], outputChannelData[ch % 2], numSamples);
+        }
+        applyOutputFade(outputChannelData, numOutputChannels, numSamples);
+        return;
+    }
+
+    // Clear all output channels first
+    for (int ch = 0; ch < numOutputChannels; ++ch) {
+        if (outputChannelData[ch]) {
+            juce::FloatVectorOperations::clear(outputChannelData[ch], juce::jmax(0, numSamples));
+        }
+    }
+    if (numSamples <= 0) return;
+
+    // Stage 1: render every strip into its own buffer
+    renderChannels(active, numSamples);
+    publishPositions(active, blockEndNs);
+    tapMultitrack(active, numSamples, mic);
+
+    // Stage 2: master sum with per-strip gain and crossfader law
+    EVENT_TRACE_SCOPE("Mix", "audio");
+    const float crossfader = crossfaderPos.load();
+    const float master = masterVolume.load();
+    const int mixChannels = std::min(numOutputChannels, 2);
+
+    for (int i = 0; i < active; ++i) {
+        auto& strip = strips[(size_t) i];
+        // The ramp runs from the gain the last block ended on, added or not
+        const float gain = strip.gain.load() * crossfaderGainFor((CrossfaderSide) strip.side.load(), crossfader);
+        const float from = std::exchange(strip.rampGain, gain);
+        // No deck, or a stopped or paused one: nothing to add
+        if (strip.silent || (from <= 0.0f && gain <= 0.0f)) continue;
+
+        for (int ch = 0; ch < mixChannels; ++ch) {
+            if (outputChannelData[ch] && ch < strip.buffer.getNumChannels())
+                addWithGain(outputChannelData[ch], strip.buffer.getReadPointer(ch), from, gain, numSamples);
+        }
+    }
+
+    if (auto* sampler = samplerBank.load(std::memory_order_relaxed))
+        sampler->renderAdding(outputChannelData, mixChannels, numSamples, samplerGain.load());
+
+    // Talkover ducks the music; the mic joins it unless it is monitored direct
+    const bool micDirect = mic != nullptr && mic->isDirectMonitor();
+    if (mic != nullptr) {
+        mic->applyDuck(outputChannelData, mixChannels, numSamples);
+        if (!micDirect) mic->addTo(outputChannelData, mixChannels, numSamples, 1.0f);
+    }
+
+    // Apply master volume, ramped from the last block's
+    const float masterFrom = std::exchange(masterRampGain, master);
+    if (master != 1.0f || masterFrom != 1.0f) {
+        for (int ch = 0; ch < mixChannels; ++ch) {
+            if (outputChannelData[ch])
+                multiplyWithGain(outputChannelData[ch], masterFrom, master, numSamples);
+        }
+    }
+    if (mixChannels > 0 && outputChannelData[0] && (mixChannels == 1 || outputChannelData[1]))
+        limiter.process(outputChannelData, mixChannels, numSamples);
+    if (micDirect) mic->addTo(outputChannelData, mixChannels, numSamples, 1.0f);
+
+    if (auto* monitor = levelMonitor.load())
+        monitor->process(outputChannelData, mixChannels, numSamples);
+    if (auto* scope = masterScope.load(std::memory_order_relaxed))
+        scope->push(outputChannelData, mixChannels, numSamples);
+    if (auto* recorder = masterRecorder.load(std::memory_order_relaxed))
+        recorder->push(outputChannelData, mixChannels, numSamples);
+    if (auto* streamer = masterStreamer.load(std::memory_order_relaxed))
+        streamer->push(outputChannelData, mixChannels, numSamples);
+    if (auto* lighting = lightingOutput.load(std::memory_order_relaxed))
+        lighting->pushBlock(outputChannelData, mixChannels, numSamples, blockBeat.startNs, blockBeat.timeline,
+                            blockBeat.player, blockBeat.trackSec, blockBeat.trackRatio);
+
+    // Headphone bus from the strip buffers rendered above (pre-fader, post-EQ)
+    if (cueBus) {
+        sumCueStrips(cueOut, active, numSamples);
+        if (auto* preview = previewPlayer.load(std::memory_order_relaxed))
+            preview->renderAdding(cueOut, 2, numSamples);
+        finishCueBus(cueOut, outputChannelData, numSamples);
+        if (externalCueBus) cueDevice->push(cueOut, numSamples, callbackStartTicks);
+    }
+
+    // Remaining output channels mirror the stereo master
+    for (int ch = firstMirrored; ch < numOutputChannels; ++ch) {
+        if (outputChannelData[ch] && outputChannelData[ch % 2]) {
+            juce::FloatVectorOperations::copy(outputChannelData[ch], outputChannelData[ch % 2], numSamples);
+        }
+    }
+    applyOutputFade(outputChannelData, numOutputChannels, numSamples);
+}
+
+void DeckMixer::applyOutputFade(float* const* outputChannelData, int numOutputChannels, int numSamples)
+{
+    const float target = fadeTarget.load(std::memory_order_relaxed);
+    if (fadeGain == target) {
+        if (target == 0.0f) {
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+                if (outputChannelData[ch]) juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+        }
+        return;
+    }
+    // Linear ramp, the same per-sample steps on every channel
+    const float step = (float) (1000.0 / (std::max(1.0f, fadeMs.load(std::memory_order_relaxed)) * preparedSampleRate));
+    const float direction = target > fadeGain ? step : -step;
+    const float start = fadeGain;
+    for (int ch = 0; ch < numOutputChannels; ++ch) {
+        float* out = outputChannelData[ch];
+        if (!out) continue;
+        float gain = start;
+        for (int i = 0; i < numSamples; ++i) {
+            gain = direction > 0.0f ? std::min(target, gain + direction) : std::max(target, gain + direction);
+            out[i] *= gain;
+        }
+    }
+    fadeGain = direction > 0.0f ? std::min(target, start + direction * (float) numSamples)
+                                : std::max(target, start + direction * (float) numSamples);
+    if (fadeGain == 0.0f) outputSilent.store(true, std::memory_order_release);
+}
+
+void DeckMixer::fadeOutput(float ms)
+{
+    fadeMs.store(ms);
+    outputSilent.store(false);
+    fadeTarget.store(0.0f);
+}
+
+void DeckMixer::audioDeviceAboutToStart(juce::AudioIODevice* device)
+{
+    // Every start fades in, whether the device is new or the callback was swapped back in
+    fadeGain = 0.0f;
+    fadeMs.store(DefaultFadeMs);
+    outputSilent.store(false);
+    fadeTarget.store(1.0f);
+    prepareToRender(device->getActiveOutputChannels().countNumberOfSetBits(), device->getCurrentBufferSizeSamples(),
+                    device->getCurrentSampleRate(), device->getOutputLatencyInSamples());
+
+    std::cout << "DeckMixer: Device starting - " << device->getName().toStdString()
+              << ", Channels: " << preparedChannels
+              << ", Buffer: " << preparedSamples
+              << ", Sample Rate: " << device->getCurrentSampleRate() << std::endl;
+    FlightRecorder::event("device start", -1, device->getCurrentSampleRate());
+}
+
+void DeckMixer::prepareToRender(int numOutputChannels, int blockSize, double sampleRate, int latencySamples)
+{
+    preparedChannels = std::max(2, numOutputChannels);
+    preparedSamples = blockSize;
+    preparedSampleRate = sampleRate;
+    outputLatencySamples = latencySamples;
+    updateLatencyCorrection();
+    if (preparedSampleRate > 0.0)
+        bufferDurationMs.store(1000.0 * preparedSamples / preparedSampleRate);
+
+    // Preallocate every strip's buffer up front so the callback never allocates
+    for (auto& strip : strips)
+        strip.buffer.setSize(preparedChannels, preparedSamples, false, true, false);
+    externalCue.setSize(2, preparedSamples, false, true, false);
+
+    limiter.prepare(preparedSampleRate, preparedSamples);
+    if (auto* monitor = levelMonitor.load())
+        monitor->prepare(preparedSampleRate, preparedSamples);
+    if (auto* scope = masterScope.load())
+        scope->prepare(preparedSampleRate);
+    if (auto* sampler = samplerBank.load())
+        sampler->prepare(preparedSampleRate, preparedSamples);
+    if (auto* preview = previewPlayer.load())
+        preview->prepare(preparedSampleRate, preparedSamples);
+    if (auto* lighting = lightingOutput.load())
+        lighting->prepare(preparedSampleRate);
+    if (auto* mic = micChannel.load())
+        mic->prepare(preparedSampleRate, preparedSamples);
+    for (auto& strip : strips)
+        if (auto* decoder = strip.timecode.load())
+            decoder->prepare(preparedSampleRate, preparedSamples);
+}
+
+void DeckMixer::setMeasuredOutputLatency(int samples, double sampleRate, int blockSize)
+{
+    {
+        std::lock_guard<std::mutex> guard(calibrationLock);
+        measuredLatencySamples = samples;
+        measuredSampleRate = sampleRate;
+        measuredBlockSize = blockSize;
+    }
+    updateLatencyCorrection();
+}
+
+void DeckMixer::updateLatencyCorrection()
+{
+    std::lock_guard<std::mutex> guard(calibrationLock);
+    const bool applies = measuredLatencySamples >= 0 && measuredSampleRate == preparedSampleRate
+                      && measuredBlockSize == preparedSamples;
+    latencyCorrectionSamples.store(applies ? measuredLatencySamples - outputLatencySamples : 0, std::memory_order_relaxed);
+    if (applies)
+        std::cout << "DeckMixer: using measured output latency " << measuredLatencySamples << " samples (device reports "
+                  << outputLatencySamples << ")" << std::endl;
+}
+
+void DeckMixer::audioDeviceStopped()
+{
+    cueOutputAvailable.store(false);
+    if (auto* monitor = levelMonitor.load())
+        monitor->reset();
+    std::cout << "DeckMixer: Device stopped" << std::endl;
+    FlightRecorder::event("device stop");
+}
+
+void DeckMixer::audioDeviceError(const juce::String& errorMessage)
+{
+    deviceError.store(true);
+    std::cout << "DeckMixer: Device error - " << errorMessage.toStdString() << std::endl;
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CallbackProfiler.h"
+#include "LockFreeQueue.h"
+#include "MasterLimiter.h"
+#include "NetworkTempoSync.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+class DJAudioPlayer;
+class MasterLevelMonitor;
+class MasterScope;
+class MicChannel;
+class MasterRecorder;
+class MultitrackRecorder;
+class MasterStreamer;
+class MidiClockOutput;
+class LightingOutput;
+class SamplerBank;
+class PreviewPlayer;
+class CueOutputDevice;
+class TimecodeDecoder;
+
+/**
+ * N-channel mixer graph used as the main device callback.
+ *
+ * Holds a fixed pool of channel strips (decks, sampler players, ...) each with its own gain
+ * and crossfader assignment. Every strip renders into its own preallocated buffer first
+ * (renderChannel), and only then are all strips summed into the device output. Rendering
+ * is independent per strip, so it can be spread across worker threads before the sum.
+ *
+ * In low-latency mode the mix is fused instead: strip 0 renders straight into the device
+ * buffer and master gain is folded into every strip gain, so the block is touched as few times
+ * as possible. The master meter (MasterLevelMonitor), the scope tap (MasterScope), the master
+ * recorder (MasterRecorder) and the live stream (MasterStreamer) get the finished block in both
+ * paths, after the master limiter (MasterLimiter), whose lookahead delay counts as output latency.
+ *
+ * Strip gains (fader times crossfader) and master volume are ramped per sample from where the
+ * last block ended to this block's value, inside the same multiply-add passes, so a fast cut
+ * doesn't zipper at any buffer size. The crossfader contour is a precomputed table.
+ *
+ * Devices with four or more outputs get a headphone cue bus (PFL) on outputs 3/4. It is summed
+ * from the same rendered strip buffers as the master, taken before the channel fader, so cueing
+ * never renders a deck twice. Cue/master mix and headphone level are set on the mixer.
+ *
+ * Device switches fade: fadeOutput() ramps every output to silence before the callback is
+ * removed, and each device start ramps back in over DefaultFadeMs. The meter and the master
+ * recorder sit before the fade, so neither dips. A driver error is latched for the UI to fail
+ * over to another device (takeDeviceError).
+ *
+ * Beat sync is phase-locked here as well: before each block the mixer compares every follower's
+ * beat phase with the sync master and trims the follower's playback ratio slightly (see
+ * applyBeatSync), so alignment no longer depends on UI timer jitter. With a NetworkTempoSync
+ * session the phase is compared at the host time the block starts playing: a follower session
+ * replaces the master strip, a leading one gets the master strip's timeline published.
+ * A MidiClockOutput gets the timeline followed, either way, for its clock pulses, and a
+ * LightingOutput the same with each finished master block.
+ *
+ * A microphone (MicChannel) on one device input is run at the top of the block as well and
+ * summed into the same block's output: talkover ducks the decks and the sampler by the mic's
+ * envelope, then the mic joins the master, or skips master volume and the limiter when it is
+ * monitored direct.
+ *
+ * Strips under timecode vinyl control (setChannelTimecode) have their input pair decoded at the
+ * top of the block, before anything renders, and the deck plays the positions of that same
+ * block: a turntable is one device buffer behind the hand, no more.
+ *
+ * AutoDJ transitions (scheduleTransition, planned by AutoDjPlanner) run here too, right after
+ * the beat sync: the incoming deck, armed by the UI (DJAudioPlayer::armStart), is started at the
+ * sample where the outgoing deck's audible position crosses the planned phrase boundary, then
+ * the crossfader is moved block by block over the planned beats while the incoming deck is held
+ * at the outgoing tempo and beat phase, and afterwards its tempo glides back to its own. The UI
+ * only arms, schedules and follows getTransitionStatus(); it is never on the timing path.
+ */
+class DeckMixer : public juce::AudioIODeviceCallback {
+public:
+    static constexpr int MaxChannels = 8;
+    static constexpr float DefaultFadeMs = 20.0f;
+
+    // Which side of the crossfader a strip follows
+    enum class CrossfaderSide { Thru = 0, A, B };
+    // Crossfader contour (Audio/CrossfaderCurve). Smooth: constant power over the whole travel,
+    // both sides 3 dB down in the centre. Dipless: both at unity up to the centre, each fading
+    // over the far half. ScratchCut: both at unity until the last ScratchCutTravel of the travel.
+    enum class CrossfaderCurve { Smooth = 0, Dipless, ScratchCut };
+    static constexpr int NumCrossfaderCurves = 3;
+    static constexpr float ScratchCutTravel = 0.04f;
+
+    DeckMixer();
+    ~DeckMixer() override;
+
+    // Channel management (UI thread). Returns the strip index, or -1 if the pool is full.
+    int addChannel(DJAudioPlayer* player, CrossfaderSide side = CrossfaderSide::Thru);
+    void setChannelPlayer(int index, DJAudioPlayer* player);
+    int getNumChannels() const { return numChannels.load(std::memory_order_acquire); }
+
+    // Mixer controls (atomic, safe from any thread)
+    void setChannelGain(int index, float gain);
+    void setChannelCrossfaderSide(int index, CrossfaderSide side);
+    void setCrossfader(float pos) { crossfaderPos.store(juce::jlimit(-1.0f, 1.0f, pos)); }
+    void setMasterVolume(float vol) { masterVolume.store(juce::jlimit(0.0f, 1.0f, vol)); }
+    void setCrossfaderCurve(CrossfaderCurve curve) { crossfaderCurve.store(juce::jlimit(0, NumCrossfaderCurves - 1, (int) curve)); }
+
+    // Headphone cue bus (outputs 3/4): per-strip PFL enable, cue/master blend
+    // (0 = cue only, 1 = master only) and headphone level
+    void setChannelCue(int index, bool enabled);
+    bool isChannelCue(int index) const;
+    void setCueMix(float mix) { cueMix.store(juce::jlimit(0.0f, 1.0f, mix)); }
+    void setHeadphoneVolume(float vol) { headphoneVolume.store(juce::jlimit(0.0f, 1.0f, vol)); }
+    // True while the cue bus goes somewhere: the running device's second output pair or a
+    // CueOutputDevice
+    bool hasCueOutput() const { return cueOutputAvailable.load(); }
+    // Headphone cue on a second device (not owned; outlives the mixer). While it is open the
+    // cue bus goes there instead of outputs 3/4, which then mirror the master like the rest.
+    void setCueOutputDevice(CueOutputDevice* device) { cueOutputDevice.store(device); }
+
+    // Beat sync: strips with sync enabled follow the master strip's tempo and phase (-1 = none)
+    void setSyncMaster(int index) { syncMaster.store(index >= 0 && index < MaxChannels ? index : -1); }
+    int getSyncMaster() const { return syncMaster.load(); }
+    void setChannelSync(int index, bool enabled);
+    bool isChannelSync(int index) const;
+    // Last measured phase offset of a follower against the master (ms of output time, + = behind)
+    float getChannelPhaseErrorMs(int index) const;
+    // Network session (not owned; cleared before it goes away): followed in place of the master
+    // strip while it has a locked leader, or fed the master strip's timeline when leading
+    void setNetworkSync(NetworkTempoSync* sync) { networkSync.store(sync); }
+    // MIDI beat clock (not owned; cleared before it goes away): given the same timeline every block
+    void setMidiClock(MidiClockOutput* clock) { midiClock.store(clock); }
+    // DMX lighting (not owned; cleared before it goes away, set before the device starts so it
+    // is prepared): gets the finished master with that timeline every block
+    void setLightingOutput(LightingOutput* lighting) { lightingOutput.store(lighting); }
+    // Timecode vinyl (DVS): the strip's player follows `decoder`, fed from the device inputs
+    // firstInput and firstInput + 1 (not owned; nullptr detaches; prepare the decoder for the
+    // running device first, the mixer re-prepares it on every device start)
+    void setChannelTimecode(int index, TimecodeDecoder* decoder, int firstInput);
+
+    // AutoDJ: one planned transition at a time, from a playing strip to one whose player is armed
+    struct Transition {
+        juce::uint32 serial{0};
+        int fromStrip{-1};
+        int toStrip{-1};
+        double triggerSec{0.0};     // fromStrip's audible track time the incoming deck starts at
+        double fadeBeats{32.0};     // crossfade, in beats of the outgoing track
+        double outBpm{0.0};         // analysed BPMs of the two tracks
+        double inBpm{0.0};
+        bool matchTempo{true};      // incoming held at the outgoing tempo and phase during the fade
+        double rampBeats{0.0};      // then back to its own tempo over this many of its beats
+        float crossfaderFrom{-1.0f};
+        float crossfaderTo{1.0f};
+    };
+    enum class TransitionState { Idle, Waiting, Fading, Ramping, Done, Missed, Cancelled };
+    struct TransitionStatus {
+        juce::uint32 serial{0};
+        TransitionState state{TransitionState::Idle};
+        float progress{0.0f};       // of the crossfade, 0..1
+        float crossfader{0.0f};     // where the transition has put the crossfader
+    };
+    // Published through a SeqlockValue, which copies it word by word
+    static_assert(std::is_trivially_copyable_v<TransitionStatus>, "TransitionStatus must stay trivially copyable");
+    // A trigger more than this late (the outgoing deck jumped past it) is missed, not fired
+    static constexpr double TransitionLateSeconds = 0.02;
+    // UI thread: replaces the pending or running transition. Cancelling leaves the crossfader and
+    // the incoming deck where they are; its tempo goes back to its own (or its sync).
+    bool scheduleTransition(const Transition& transition);
+    void cancelTransition();
+    // Any thread: as of the last block
+    TransitionStatus getTransitionStatus() const { return transitionStatus.load(); }
+
+    // Fused zero-copy mix (Performance/LowLatencyMode); falls back per block for non-stereo devices
+    void setLowLatencyMode(bool enabled) { lowLatencyMode.store(enabled); }
+    bool isLowLatencyMode() const { return lowLatencyMode.load(); }
+    // Master meter fed from the final mix pass (not owned; set before the device starts)
+    void setLevelMonitor(MasterLevelMonitor* monitor) { levelMonitor.store(monitor); }
+    // Scope/goniometer tap, after the meter (not owned; set before the device starts)
+    void setMasterScope(MasterScope* scope) { masterScope.store(scope); }
+    // Master recording tap, after the meter (not owned; outlives the mixer)
+    void setMasterRecorder(MasterRecorder* recorder) { masterRecorder.store(recorder); }
+    // Per-strip and mic recording tap, post-fader and before master volume (not owned; outlives
+    // the mixer)
+    void setMultitrackRecorder(MultitrackRecorder* recorder) { multitrackRecorder.store(recorder); }
+    // Live stream tap, next to the recorder (not owned; outlives the mixer)
+    void setMasterStreamer(MasterStreamer* streamer) { masterStreamer.store(streamer); }
+    // Sampler bus, summed into the master after the strips (not owned; set before the device starts)
+    void setSamplerBank(SamplerBank* bank) { samplerBank.store(bank); }
+    void setSamplerGain(float gain) { samplerGain.store(juce::jlimit(0.0f, 1.0f, gain)); }
+    // Library preview, added to the headphone bus after the cued strips (not owned; set before
+    // the device starts)
+    void setPreviewPlayer(PreviewPlayer* player) { previewPlayer.store(player); }
+    // Microphone strip fed from device input `input` (not owned; set before the device starts;
+    // the mixer prepares it on every device start). A missing input keeps it silent.
+    void setMicChannel(MicChannel* mic, int input);
+
+    // Optional parallel mode: every strip except the first renders on its own pinned,
+    // high-priority worker thread; the callback thread renders strip 0 and joins before the sum
+    void setParallelRendering(bool enabled);
+    bool isParallelRendering() const { return parallelRendering.load(); }
+
+    // Per-strip render timing (milliseconds), for checking keylock headroom against the buffer
+    float getChannelRenderMs(int index) const;
+    float getChannelPeakRenderMs(int index) const;
+    void resetRenderStats();
+    double getBufferDurationMs() const { return bufferDurationMs.load(); }
+    // Callback, mix and per-deck stage timing histograms (CallbackProfiler::takeReport on the UI thread)
+    CallbackProfiler& getProfiler() { return profiler; }
+    // Brickwall on the master bus (enable and lookahead from any thread)
+    MasterLimiter& getLimiter() { return limiter; }
+    const MasterLimiter& getLimiter() const { return limiter; }
+
+    // Clock of the playhead snapshots (DJAudioPlayer::PositionSnapshot::hostTimeNs): monotonic ns,
+    // the same domain as the host time CoreAudio passes in the callback context
+    static juce::uint64 nowNs() noexcept;
+    // Frames rendered since the mixer was created, counting the block in progress (any thread);
+    // the audio clock MixAutomation stamps its events with
+    juce::int64 getRenderedFrames() const { return renderedFrames.load(std::memory_order_relaxed); }
+
+    // Output latency measured by LatencyCalibrator, used instead of the device's report while the
+    // device runs at the format it was measured at; samples < 0 goes back to the report
+    void setMeasuredOutputLatency(int samples, double sampleRate, int blockSize);
+    // What the snapshots assume: the measured latency if it applies, otherwise the reported one
+    int getOutputLatencySamples() const { return outputLatencySamples + latencyCorrectionSamples.load(std::memory_order_relaxed); }
+    // Delay the master bus adds on top of it (the limiter's lookahead), any thread
+    int getMasterLatencySamples() const { return limiter.getLatencySamples(); }
+
+    // Device switch (UI thread): ramp the output to silence over `ms`, then wait for isOutputSilent()
+    // (or give up: a dead device renders nothing) before removing the callback
+    void fadeOutput(float ms = DefaultFadeMs);
+    bool isOutputSilent() const { return outputSilent.load(std::memory_order_acquire); }
+    // True once after the driver reported an error (device unplugged, stream broken)
+    bool takeDeviceError() { return deviceError.exchange(false); }
+
+    // Preallocate for a stream without a device (offline render); audioDeviceAboutToStart uses it too
+    void prepareToRender(int numOutputChannels, int blockSize, double sampleRate, int latencySamples = 0);
+
+    // AudioIODeviceCallback
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                          float* const* outputChannelData, int numOutputChannels,
+                                          int numSamples, const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+    void audioDeviceError(const juce::String& errorMessage) override;
+
+private:
+    // Device channels a block sliced to the prepared size can carry
+    static constexpr int MaxDeviceChannels = 64;
+    // One block of at most preparedSamples: everything the callback does but its timing;
+    // blockStartNs is when the block's first sample is heard
+    void renderBlock(const float* const* inputChannelData, int numInputChannels, float* const* outputChannelData,
+                     int numOutputChannels, int numSamples, juce::uint64 blockStartNs, juce::int64 callbackStartTicks);
+    // Render one strip into `target` (its private buffer, or the device buffer for strip 0 in
+    // the fused path; no shared state touched; safe to run in parallel)
+    void renderChannel(int index, int numSamples, juce::AudioBuffer<float>& target);
+    // Render all active strips; strip 0 goes to `strip0Target` if given. Joins before returning.
+    void renderChannels(int numActive, int numSamples, juce::AudioBuffer<float>* strip0Target = nullptr);
+    // Low-latency path: render and mix straight into the stereo device buffers
+    void mixFused(float* const* outputChannelData, int active, int numSamples, MicChannel* mic, float* const* cueOut);
+    // Cue bus: sum the pre-fader buffers of every cued strip into `cueOut` (two channels).
+    // `strip0` overrides strip 0's source when it was rendered into the device buffer.
+    void sumCueStrips(float* const* cueOut, int active, int numSamples, const float* const* strip0 = nullptr);
+    // Blend the finished master into the cue bus and apply headphone level
+    void finishCueBus(float* const* cueOut, const float* const* masterOut, int numSamples);
+    // Audio thread, before rendering: phase-lock every synced strip to the master strip, or to
+    // the network session; blockStartNs is when the block's first sample is heard
+    void applyBeatSync(int active, juce::uint64 blockStartNs);
+    // Audio thread, after the beat sync: start, fade and tempo of the scheduled transition
+    void applyTransition(int active, int numSamples);
+    // Audio thread, before rendering: decode the timecode inputs and hand the positions to the players
+    void decodeTimecode(const float* const* inputChannelData, int numInputChannels, int active, int numSamples);
+    // Audio thread, before the mix: the mic's block from its input; the mic itself, or nullptr if none
+    MicChannel* processMic(const float* const* inputChannelData, int numInputChannels, int numSamples);
+    // Audio thread, after rendering and before strip 0 is scaled: every strip after its fader and
+    // the crossfader, and the mic, to the multitrack recorder. `strip0` as in sumCueStrips.
+    void tapMultitrack(int active, int numSamples, MicChannel* mic, const float* const* strip0 = nullptr);
+    // Audio thread, after rendering: hand every strip's playhead to the UI
+    void publishPositions(int active, juce::uint64 blockEndNs);
+    // Audio thread, last: ramp every output towards the fade target
+    void applyOutputFade(float* const* outputChannelData, int numOutputChannels, int numSamples);
+
+    struct ChannelStrip {
+        std::atomic<DJAudioPlayer*> player{nullptr};
+        std::atomic<float> gain{1.0f};
+        std::atomic<int> side{(int) CrossfaderSide::Thru};
+        std::atomic<bool> cue{false};
+        std::atomic<bool> sync{false};
+        std::atomic<float> phaseErrorMs{0.0f};
+        std::atomic<TimecodeDecoder*> timecode{nullptr};
+        std::atomic<int> timecodeInput{0};
+        juce::AudioBuffer<float> buffer;
+        bool silent{true};   // audio thread: the last rendered block is all zeros, left out of the sums
+        float rampGain{0.0f};   // audio thread: fader x crossfader the last block's ramp ended on
+        std::atomic<float> lastRenderMs{0.0f};
+        std::atomic<float> peakRenderMs{0.0f};
+    };
+
+    class RenderWorker;
+    friend class RenderWorker;
+    void startWorkersUpTo(int numStrips);
+    void stopWorkers();
+
+    // The strip's gain under the crossfader, read off the current curve's table
+    float crossfaderGainFor(CrossfaderSide side, float crossfader) const;
+    // Gain of side A against the travel towards B (0..1) for every curve, CrossfaderTableSteps
+    // steps interpolated linearly; side B reads it mirrored. Built once, by the constructor.
+    static constexpr int CrossfaderTableSteps = 512;
+    using CrossfaderTable = std::array<float, CrossfaderTableSteps + 1>;
+    static const std::array<CrossfaderTable, NumCrossfaderCurves>& getCrossfaderTables();
+
+    std::array<ChannelStrip, MaxChannels> strips;
+    std::atomic<int> numChannels{0};
+
+    std::atomic<float> crossfaderPos{0.0f};  // -1.0 = A only, 0.0 = center, +1.0 = B only
+    std::atomic<float> masterVolume{1.0f};
+    std::atomic<int> crossfaderCurve{(int) CrossfaderCurve::Dipless};
+    float masterRampGain{1.0f};   // audio thread: master volume the last block's ramp ended on
+    std::atomic<bool> lowLatencyMode{false};
+    std::atomic<MasterLevelMonitor*> levelMonitor{nullptr};
+    std::atomic<MasterScope*> masterScope{nullptr};
+    std::atomic<MasterRecorder*> masterRecorder{nullptr};
+    std::atomic<MultitrackRecorder*> multitrackRecorder{nullptr};
+    std::atomic<MasterStreamer*> masterStreamer{nullptr};
+    std::atomic<SamplerBank*> samplerBank{nullptr};
+    std::atomic<float> samplerGain{1.0f};
+    std::atomic<PreviewPlayer*> previewPlayer{nullptr};
+    std::atomic<MicChannel*> micChannel{nullptr};
+    std::atomic<int> micInput{0};
+    std::atomic<float> cueMix{0.0f};
+    std::atomic<float> headphoneVolume{0.7f};
+    std::atomic<bool> cueOutputAvailable{false};
+    std::atomic<CueOutputDevice*> cueOutputDevice{nullptr};
+    juce::AudioBuffer<float> externalCue;   // the cue bus on its way to the CueOutputDevice
+    std::atomic<int> syncMaster{-1};
+    std::atomic<NetworkTempoSync*> networkSync{nullptr};
+    std::atomic<MidiClockOutput*> midiClock{nullptr};
+    std::atomic<LightingOutput*> lightingOutput{nullptr};
+    // Audio thread: the followed timeline of this block, from applyBeatSync to the lights
+    struct BlockBeat {
+        juce::uint64 startNs{0};
+        NetworkTempoSync::Timeline timeline;
+        const DJAudioPlayer* player{nullptr};
+        double trackSec{0.0};
+        double trackRatio{1.0};
+    } blockBeat;
+
+    // Transition: UI -> audio thread (fromStrip < 0 cancels), status audio thread -> UI
+    SpscQueue<Transition, 8> transitionQueue;
+    SeqlockValue<TransitionStatus> transitionStatus;
+    // Audio thread
+    Transition transition;
+    TransitionStatus transitionRt;
+    juce::int64 transitionElapsed{0};   // output frames since the incoming deck started
+    juce::int64 transitionFadeFrames{1};
+    juce::int64 transitionRampFrames{1};
+    double transitionTrim{1.0};         // incoming deck's trim, last set
+    double transitionRampFrom{1.0};
+
+    // Phase-lock loop: a beat offset is closed over SyncResponseSeconds, with the correction
+    // limited to MaxSyncCorrection of the tempo so it stays inaudible
+    static constexpr double SyncResponseSeconds = 0.5;
+    static constexpr double MaxSyncCorrection = 0.01;
+
+    int preparedChannels{2};
+    int preparedSamples{0};
+    double preparedSampleRate{44100.0};
+    int outputLatencySamples{0};
+    std::atomic<int> latencyCorrectionSamples{0};   // measured minus reported output latency
+    std::mutex calibrationLock;                     // never taken on the audio thread
+    int measuredLatencySamples{-1};
+    double measuredSampleRate{0.0};
+    int measuredBlockSize{0};
+    void updateLatencyCorrection();
+    std::atomic<double> bufferDurationMs{0.0};
+    // Output fade: target and length from the UI, the gain itself is audio-thread state
+    // (and set in audioDeviceAboutToStart, while this callback isn't attached)
+    std::atomic<float> fadeTarget{1.0f};
+    std::atomic<float> fadeMs{DefaultFadeMs};
+    std::atomic<bool> outputSilent{false};
+    std::atomic<bool> deviceError{false};
+    float fadeGain{1.0f};
+    CallbackProfiler profiler;
+    MasterLimiter limiter;
+    juce::int64 renderTicks{0};   // audio thread: time the current callback spent in renderChannels
+    int callCount{0};             // audio thread: callbacks so far, for the periodic debug trace
+    std::atomic<juce::int64> renderedFrames{0};
+
+    // Worker i renders strip i (index 0 unused: the callback thread renders strip 0)
+    std::array<std::unique_ptr<RenderWorker>, MaxChannels> workers;
+    std::atomic<int> numWorkersReady{0};   // workers[1..numWorkersReady] are running
+    std::atomic<bool> parallelRendering{false};
+    std::atomic<int> jobNumSamples{0};
+};
@@ -0,0 +1,275 @@
+#include "DeckReadAheadSource.h"
+
+#include <algorithm>
+#include <cmath>
+
+DeckReadAheadSource::DeckReadAheadSource(juce::AudioFormatReaderSource* src, juce::TimeSliceThread& sharedThread,
+                                         int bufferSize, int numChannels)
+    : source(src),
+      thread(sharedThread),
+      buffering(src, sharedThread, false, juce::jmax(4096, bufferSize), numChannels, true),
+      bufferSamples(juce::jmax(4096, bufferSize)) {
+    const double sourceRate = (source && source->getAudioFormatReader()) ? source->getAudioFormatReader()->sampleRate : 44100.0;
+    prefetchLength = juce::jmax(1024, (int) (sourceRate * PrefetchSeconds));
+
+    // Preallocate every prefetch slot now; the audio thread only ever copies out of them
+    for (auto& region : regions)
+        region.data.setSize(numChannels, prefetchLength);
+    loop.data.setSize(numChannels, (int) (sourceRate * MaxCachedLoopSeconds) + LoopSeamFadeSamples + prefetchLength);
+
+    seamFadeIn.resize(LoopSeamFadeSamples);
+    seamFadeOut.resize(LoopSeamFadeSamples);
+    for (int i = 0; i < LoopSeamFadeSamples; ++i) {
+        const double phase = (i + 0.5) / LoopSeamFadeSamples * juce::MathConstants<double>::halfPi;
+        seamFadeIn[(size_t) i] = (float) std::sin(phase);
+        seamFadeOut[(size_t) i] = (float) std::cos(phase);
+    }
+
+    thread.addTimeSliceClient(this);
+}
+
+DeckReadAheadSource::~DeckReadAheadSource() {
+    // Blocks until a running useTimeSlice() has returned, so the reader is not touched afterwards
+    thread.removeTimeSliceClient(this);
+}
+
+void DeckReadAheadSource::setPrefetchRegion(int slot, juce::int64 startSample) {
+    if (slot < 0 || slot >= MaxPrefetchRegions) return;
+    regions[(size_t) slot].requestedStart.store(startSample < 0 ? -1 : startSample);
+    thread.notify();
+}
+
+bool DeckReadAheadSource::setLoopRegion(juce::int64 startSample, juce::int64 endSample) {
+    const juce::int64 maxLength = loop.data.getNumSamples() - LoopSeamFadeSamples - prefetchLength;
+    if (startSample < 0 || endSample <= startSample || endSample - startSample > maxLength) {
+        clearLoopRegion();
+        return false;
+    }
+    loop.requestedEnd.store(endSample);
+    loop.requestedStart.store(startSample);
+    loop.active.store(true);
+    thread.notify();
+    return true;
+}
+
+void DeckReadAheadSource::clearLoopRegion() {
+    loop.active.store(false);
+}
+
+bool DeckReadAheadSource::isLoopCached() const {
+    const juce::int64 start = loop.readyStart.load();
+    return loop.active.load() && start >= 0
+        && start == loop.requestedStart.load() && loop.readyEnd.load() == loop.requestedEnd.load();
+}
+
+int DeckReadAheadSource::useTimeSlice() {
+    auto* reader = source ? source->getAudioFormatReader() : nullptr;
+    if (reader == nullptr) return 500;
+
+    // Loop cache first: it is what the next seam is waiting for
+    const juce::int64 loopStart = loop.requestedStart.load();
+    const juce::int64 loopEnd = loop.requestedEnd.load();
+    if (loopStart >= 0 && (loopStart != loop.readyStart.load() || loopEnd != loop.readyEnd.load())) {
+        loop.readyStart.store(-1);
+        while (loop.inUse.load())
+            juce::Thread::yield();
+
+        loop.data.clear();
+        const int toRead = (int) std::min<juce::int64>(loop.data.getNumSamples(), reader->lengthInSamples - loopStart);
+        if (toRead > 0)
+            reader->read(&loop.data, 0, toRead, loopStart, true, true);
+        loop.readyLength.store(std::max(0, toRead));
+        loop.readyEnd.store(loopEnd);
+        loop.readyStart.store(loopStart);
+        return 1;
+    }
+
+    for (auto& region : regions) {
+        const juce::int64 requested = region.requestedStart.load();
+        if (requested == region.readyStart.load()) continue;
+
+        // Retire the old copy first and wait for the audio thread to let go of it
+        region.readyStart.store(-1);
+        while (region.inUse.load())
+            juce::Thread::yield();
+
+        if (requested < 0) continue;
+
+        // Runs on the same thread as the BufferingAudioSource reads, so the reader is never shared
+        region.data.clear();
+        const int toRead = (int) std::min<juce::int64>(prefetchLength, reader->lengthInSamples - requested);
+        if (toRead > 0)
+            reader->read(&region.data, 0, toRead, requested, true, true);
+        region.readyStart.store(requested);
+
+        // One region per slice keeps the ring buffer refill responsive
+        return 1;
+    }
+    return 100;
+}
+
+bool DeckReadAheadSource::serveFromPrefetch(const juce::AudioSourceChannelInfo& info, juce::int64 position) {
+    for (auto& region : regions) {
+        const juce::int64 start = region.readyStart.load();
+        if (start < 0 || position < start || position + info.numSamples > start + prefetchLength)
+            continue;
+
+        region.inUse.store(true);
+        if (region.readyStart.load() != start) {  // retired while we were looking
+            region.inUse.store(false);
+            continue;
+        }
+
+        const int offset = (int) (position - start);
+        const int channels = juce::jmin(info.buffer->getNumChannels(), region.data.getNumChannels());
+        for (int ch = 0; ch < channels; ++ch)
+            info.buffer->copyFrom(ch, info.startSample, region.data, ch, offset, info.numSamples);
+        for (int ch = channels; ch < info.buffer->getNumChannels(); ++ch)
+            info.buffer->clear(ch, info.startSample, info.numSamples);
+        region.inUse.store(false);
+        return true;
+    }
+    return false;
+}
+
+bool DeckReadAheadSource::serveFromLoopCache(const juce::AudioSourceChannelInfo& info, juce::int64 position) {
+    if (!loop.active.load()) return false;
+    const juce::int64 start = loop.readyStart.load();
+    const juce::int64 end = loop.readyEnd.load();
+    if (start < 0 || position < start || position >= end) return false;
+
+    loop.inUse.store(true);
+    if (loop.readyStart.load() != start || loop.readyEnd.load() != end) {
+        loop.inUse.store(false);
+        return false;
+    }
+
+    const int length = (int) (end - start);
+    // The tail past the loop end must be in the cache, otherwise there is nothing to fade from
+    const int fade = std::min({ LoopSeamFadeSamples, length / 2, loop.readyLength.load() - length });
+    const int channels = juce::jmin(info.buffer->getNumChannels(), loop.data.getNumChannels());
+
+    int offset = (int) (position - start);
+    for (int done = 0; done < info.numSamples; ) {
+        if (offset >= length) {
+            offset = 0;
+            seamFading = fade > 0;
+        }
+        int chunk = std::min(info.numSamples - done, length - offset);
+
+        if (seamFading && offset < fade) {
+            // Just wrapped: loop start fades in while the audio that followed the loop end fades out
+            chunk = std::min(chunk, fade - offset);
+            for (int ch = 0; ch < channels; ++ch) {
+                const float* head = loop.data.getReadPointer(ch, offset);
+                const float* tail = loop.data.getReadPointer(ch, length + offset);
+                float* out = info.buffer->getWritePointer(ch, info.startSample + done);
+                for (int i = 0; i < chunk; ++i) {
+                    const size_t curve = (size_t) ((offset + i) * LoopSeamFadeSamples / fade);
+                    out[i] = head[i] * seamFadeIn[curve] + tail[i] * seamFadeOut[curve];
+                }
+            }
+        } else {
+            seamFading = false;
+            for (int ch = 0; ch < channels; ++ch)
+                info.buffer->copyFrom(ch, info.startSample + done, loop.data, ch, offset, chunk);
+        }
+        done += chunk;
+        offset += chunk;
+    }
+    for (int ch = channels; ch < info.buffer->getNumChannels(); ++ch)
+        info.buffer->clear(ch, info.startSample, info.numSamples);
+    loop.inUse.store(false);
+
+    if (offset >= length) {
+        // Block ended exactly on the seam: wrap now so the next block starts inside the loop
+        offset = 0;
+        seamFading = fade > 0;
+    }
+    loopPlayPos.store(start + offset);
+    return true;
+}
+
+bool DeckReadAheadSource::serveFromLoopRunOut(const juce::AudioSourceChannelInfo& info, juce::int64 position) {
+    const juce::int64 start = loop.readyStart.load();
+    if (start < 0 || position < start || position + info.numSamples > start + loop.readyLength.load())
+        return false;
+
+    loop.inUse.store(true);
+    if (loop.readyStart.load() != start) {
+        loop.inUse.store(false);
+        return false;
+    }
+    const int offset = (int) (position - start);
+    const int channels = juce::jmin(info.buffer->getNumChannels(), loop.data.getNumChannels());
+    for (int ch = 0; ch < channels; ++ch)
+        info.buffer->copyFrom(ch, info.startSample, loop.data, ch, offset, info.numSamples);
+    for (int ch = channels; ch < info.buffer->getNumChannels(); ++ch)
+        info.buffer->clear(ch, info.startSample, info.numSamples);
+    loop.inUse.store(false);
+    return true;
+}
+
+void DeckReadAheadSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    buffering.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void DeckReadAheadSource::releaseResources() {
+    buffering.releaseResources();
+}
+
+void DeckReadAheadSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& info) {
+    const bool wasServingLoop = servingLoop.load();
+    const juce::int64 loopPosition = wasServingLoop ? loopPlayPos.load() : buffering.getNextReadPosition();
+    if (serveFromLoopCache(info, loopPosition)) {
+        servingLoop.store(true);
+        return;
+    }
+    if (wasServingLoop) {
+        // Loop released: the ring buffer restarts from here, the cache covers the refill time
+        servingLoop.store(false);
+        seamFading = false;
+        buffering.setNextReadPosition(loopPosition);
+    }
+
+    // Zero timeout: only asks whether the ring buffer already covers this block, never waits
+    if (buffering.waitForNextAudioBlockReady(info, 0)) {
+        buffering.getNextAudioBlock(info);
+        return;
+    }
+
+    const juce::int64 position = buffering.getNextReadPosition();
+    if (serveFromPrefetch(info, position) || serveFromLoopRunOut(info, position)) {
+        prefetchHits.fetch_add(1, std::memory_order_relaxed);
+        // Keep the ring buffer's play head in step so it refills from where we are
+        buffering.setNextReadPosition(position + info.numSamples);
+        return;
+    }
+
+    underruns.fetch_add(1, std::memory_order_relaxed);
+    buffering.getNextAudioBlock(info);  // plays whatever part is valid, silence for the rest
+}
+
+void DeckReadAheadSource::setNextReadPosition(juce::int64 newPosition) {
+    // A seek always leaves the wrap; the next block re-enters it if the target is inside the loop
+    servingLoop.store(false);
+    seamFading = false;
+    buffering.setNextReadPosition(newPosition);
+}
+
+juce::int64 DeckReadAheadSource::getNextReadPosition() const {
+    return servingLoop.load() ? loopPlayPos.load() : buffering.getNextReadPosition();
+}
+
+juce::int64 DeckReadAheadSource::getTotalLength() const {
+    return buffering.getTotalLength();
+}
+
+bool DeckReadAheadSource::isLooping() const {
+    return buffering.isLooping();
+}
+
+void DeckReadAheadSource::setLooping(bool shouldLoop) {
+    // BufferingAudioSource asks its source for the looping state, so set it there
+    if (source) source->setLooping(shouldLoop);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+/**
+ * Read-ahead stage between a deck's reader source and its AudioTransportSource.
+ *
+ * Wraps a juce::BufferingAudioSource that decodes ahead on a TimeSliceThread shared by all
+ * decks, so disk/decoder stalls (USB sticks, network shares) never reach the audio callback.
+ * On top of that it keeps short prefetched copies of the cue and loop start regions: if a jump
+ * lands there before the ring buffer has refilled, the block is served from the prefetch copy
+ * instead of going silent. Blocks that can be served from neither are counted as underruns.
+ *
+ * Short loops are cached whole: the loop region plus a crossfade tail is read once on the
+ * read-ahead thread, and while the loop is active playback wraps inside that copy with an
+ * equal-power seam fade. Beat rolls then never seek the decoder, and the wrap is sample-exact.
+ */
+class DeckReadAheadSource : public juce::PositionableAudioSource,
+                            private juce::TimeSliceClient {
+public:
+    // Prefetch slots: main cue, loop start, then hot cues 1..8
+    static constexpr int CueSlot = 0;
+    static constexpr int LoopSlot = 1;
+    static constexpr int FirstHotCueSlot = 2;
+    static constexpr int MaxPrefetchRegions = 10;
+    static constexpr double PrefetchSeconds = 0.75;
+    // Longest loop served from RAM; longer loops seek at the seam like before
+    static constexpr double MaxCachedLoopSeconds = 8.0;
+    static constexpr int LoopSeamFadeSamples = 256;
+
+    // `source` is not owned and must outlive this object; its reader is only touched on `thread`
+    DeckReadAheadSource(juce::AudioFormatReaderSource* source, juce::TimeSliceThread& thread,
+                        int bufferSamples, int numChannels = 2);
+    ~DeckReadAheadSource() override;
+
+    // UI thread: (re)prefetch the region starting at `startSample`; a negative value clears the slot
+    void setPrefetchRegion(int slot, juce::int64 startSample);
+    // UI thread: cache the loop [startSample, endSample) and wrap inside it once ready;
+    // false if the loop is too long to cache
+    bool setLoopRegion(juce::int64 startSample, juce::int64 endSample);
+    // UI thread: stop wrapping; the cached audio stays as a run-out prefetch until the next loop
+    void clearLoopRegion();
+    // Audio thread: true once the active loop is cached, i.e. the seam needs no handling upstream
+    bool isLoopCached() const;
+
+    int getUnderrunCount() const { return underruns.load(std::memory_order_relaxed); }
+    int getPrefetchHitCount() const { return prefetchHits.load(std::memory_order_relaxed); }
+    void resetCounters() { underruns.store(0); prefetchHits.store(0); }
+    int getBufferSamples() const { return bufferSamples; }
+
+    // PositionableAudioSource
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override;
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+    void setLooping(bool shouldLoop) override;
+
+private:
+    int useTimeSlice() override;
+    // Audio thread: copy the block out of a ready prefetch region; false if none covers it
+    bool serveFromPrefetch(const juce::AudioSourceChannelInfo& info, juce::int64 position);
+    // Audio thread: render the block from the loop cache, wrapping at the loop end; false if
+    // the loop is inactive, not cached yet or `position` lies outside it
+    bool serveFromLoopCache(const juce::AudioSourceChannelInfo& info, juce::int64 position);
+    // Audio thread: linear read from the loop cache (run-out after the loop was released)
+    bool serveFromLoopRunOut(const juce::AudioSourceChannelInfo& info, juce::int64 position);
+
+    struct PrefetchRegion {
+        std::atomic<juce::int64> requestedStart{-1};  // written by the UI thread
+        std::atomic<juce::int64> readyStart{-1};      // written by the read-ahead thread
+        std::atomic<bool> inUse{false};               // audio thread is copying from `data`
+        juce::AudioBuffer<float> data;
+    };
+
+    juce::AudioFormatReaderSource* source;
+    juce::TimeSliceThread& thread;
+    juce::BufferingAudioSource buffering;
+    const int bufferSamples;
+    int prefetchLength{0};
+
+    std::array<PrefetchRegion, MaxPrefetchRegions> regions;
+
+    struct LoopCache {
+        std::atomic<juce::int64> requestedStart{-1};  // UI thread
+        std::atomic<juce::int64> requestedEnd{-1};
+        std::atomic<bool> active{false};
+        std::atomic<juce::int64> readyStart{-1};      // read-ahead thread
+        std::atomic<juce::int64> readyEnd{-1};
+        std::atomic<int> readyLength{0};              // valid samples in `data`
+        std::atomic<bool> inUse{false};
+        juce::AudioBuffer<float> data;                // loop + seam tail + run-out
+    } loop;
+    std::vector<float> seamFadeIn;                    // equal-power curves, LoopSeamFadeSamples long
+    std::vector<float> seamFadeOut;
+
+    // Audio thread state while wrapping inside the loop cache
+    std::atomic<bool> servingLoop{false};
+    std::atomic<juce::int64> loopPlayPos{0};
+    bool seamFading{false};
+
+    std::atomic<int> underruns{0};
+    std::atomic<int> prefetchHits{0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckReadAheadSource)
+};
@@ -3,6 +3,11 @@
 #include <QSettings>
 #include <QString>
 #include <QDebug>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "AppConfig.h"
 
 /**
@@ -17,9 +22,15 @@
  * - Gain/Volume
  * - Visual Trim
  * - Loop Einstellungen
+ *
+ * Changes stay in memory: a toggle only marks the persisted values dirty, and a background
+ * thread writes them at most once every FlushIntervalMs, so a click never waits for the disk on
+ * the UI thread. shutdown() writes whatever is still pending.
  */
 class DeckSettings {
 public:
+    static constexpr int FlushIntervalMs = 3000;
+
     // Einzelne Deck-Konfiguration - VEREINFACHT: Nur wichtige Einstellungen speichern
     struct DeckConfig {
         // Transport & Tempo - NUR DIESE WERDEN GESPEICHERT
@@ -92,33 +103,29 @@ public:
         qDebug() << "  Deck B: Keylock=" << deckB.keylockEnabled << "Quantize=" << deckB.quantizeEnabled;
     }
     
-    // Speichere alle Deck-Settings - NUR KEYLOCK UND QUANTIZE
+    // Speichere alle Deck-Settings - NUR KEYLOCK UND QUANTIZE, now, on the calling thread
     void saveSettings() {
-        // Stelle sicher, dass Config-Verzeichnis existiert
-        AppConfig::instance().createDirectories();
-        
-        QString settingsPath = AppConfig::instance().getConfigDirectory() + "/deck_settings.ini";
-        QSettings settings(settingsPath, QSettings::IniFormat);
-        
-        // Lösche alte Settings komplett für saubere Neuanlage
-        settings.clear();
-        
-        // Deck A speichern - NUR keylock und quantize
-        settings.beginGroup("DeckA");
-        settings.setValue("keylock", deckA.keylockEnabled);
-        settings.setValue("quantize", deckA.quantizeEnabled);
-        settings.endGroup();
-        
-        // Deck B speichern - NUR keylock und quantize  
-        settings.beginGroup("DeckB");
-        settings.setValue("keylock", deckB.keylockEnabled);
-        settings.setValue("quantize", deckB.quantizeEnabled);
-        settings.endGroup();
-        
-        // Explizit synchronisieren
-        settings.sync();
-        
-        qDebug() << "BetaPulseX: Nur Keylock/Quantize gespeichert nach" << settingsPath;
+        Persisted snapshot;
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            snapshot = pending = persistedState();
+            pendingDirty = false;
+        }
+        write(snapshot);
+    }
+    
+    // Closing: stops the flush thread and writes what it hadn't yet
+    void shutdown() {
+        bool dirty = false;
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            stopping = true;
+            dirty = pendingDirty;
+            pendingDirty = false;
+        }
+        flushWake.notify_all();
+        if (flushThread.joinable()) flushThread.join();
+        if (dirty) write(pending);
     }
     
     // Getter für Deck-Konfigurationen
@@ -206,15 +213,8 @@ public:
         deckA = DeckConfig(); // Default constructor - alle Werte auf Standard
         deckB = DeckConfig(); // Default constructor - alle Werte auf Standard
         
-        // Lösche alle gespeicherten Settings
-        QString settingsPath = AppConfig::instance().getConfigDirectory() + "/deck_settings.ini";
-        QSettings settings(settingsPath, QSettings::IniFormat);
-        settings.clear();
-        
-        // Speichere Standard-Werte (nur Keylock/Quantize = false)
-        if (autoSaveEnabled) {
-            saveSettings();
-        }
+        // Speichere Standard-Werte (nur Keylock/Quantize = false); the write replaces the whole file
+        autoSave();
         
         qDebug() << "BetaPulseX: Alle Deck-Settings auf Standard zurückgesetzt";
     }
@@ -224,17 +224,95 @@ public:
         autoSaveEnabled = enabled;
     }
 
+    ~DeckSettings() {
+        shutdown();
+    }
+
 private:
     DeckConfig deckA;
     DeckConfig deckB;
     bool autoSaveEnabled = true;
     
+    // What goes into deck_settings.ini, copied on the UI thread for the flush thread
+    struct Persisted {
+        std::array<bool, 2> keylock{};
+        std::array<bool, 2> quantize{};
+        unsigned serial = 0;    // a write older than the last one is dropped
+    };
+    // Under flushMutex
+    Persisted persistedState() {
+        Persisted p;
+        p.serial = ++snapshotSerial;
+        p.keylock = { deckA.keylockEnabled, deckB.keylockEnabled };
+        p.quantize = { deckA.quantizeEnabled, deckB.quantizeEnabled };
+        return p;
+    }
+    
+    std::mutex flushMutex;
+    std::condition_variable flushWake;
+    std::thread flushThread;
+    Persisted pending;
+    bool pendingDirty = false;
+    bool stopping = false;
+    unsigned snapshotSerial = 0;
+    std::mutex writeMutex;      // the flush thread and saveSettings() never write at once
+    unsigned writtenSerial = 0;
+    
     DeckSettings() = default;
     
     void autoSave() {
-        if (autoSaveEnabled) {
-            saveSettings();
+        if (!autoSaveEnabled) return;
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            if (stopping) return;
+            pending = persistedState();
+            pendingDirty = true;
+            if (!flushThread.joinable()) flushThread = std::thread([this]() { flushLoop(); });
         }
+        flushWake.notify_all();
+    }
+    
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(flushMutex);
+        while (!stopping) {
+            flushWake.wait(lock, [this]() { return pendingDirty || stopping; });
+            // Everything changed in the next few seconds goes out with this one write
+            flushWake.wait_for(lock, std::chrono::milliseconds(FlushIntervalMs), [this]() { return stopping; });
+            if (stopping || !pendingDirty) continue;   // shutdown() writes what is left
+            const Persisted snapshot = pending;
+            pendingDirty = false;
+            lock.unlock();
+            write(snapshot);
+            lock.lock();
+        }
+    }
+    
+    void write(const Persisted& p) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (p.serial < writtenSerial) return;
+        writtenSerial = p.serial;
+        // Stelle sicher, dass Config-Verzeichnis existiert
+        AppConfig::instance().createDirectories();
+        
+        QString settingsPath = AppConfig::instance().getConfigDirectory() + "/deck_settings.ini";
+        QSettings settings(settingsPath, QSettings::IniFormat);
+        
+        // Lösche alte Settings komplett für saubere Neuanlage
+        settings.clear();
+        
+        // NUR keylock und quantize
+        const char* groups[] = { "DeckA", "DeckB" };
+        for (int deck = 0; deck < 2; ++deck) {
+            settings.beginGroup(groups[deck]);
+            settings.setValue("keylock", p.keylock[(size_t) deck]);
+            settings.setValue("quantize", p.quantize[(size_t) deck]);
+            settings.endGroup();
+        }
+        
+        // Explizit synchronisieren
+        settings.sync();
+        
+        qDebug() << "BetaPulseX: Nur Keylock/Quantize gespeichert nach" << settingsPath;
     }
 };
 
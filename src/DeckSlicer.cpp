@@ -0,0 +1,175 @@
+#include "DeckSlicer.h"
+#include "InMemoryTrackReader.h"
+#include <algorithm>
+
+DeckSlicer::DeckSlicer()
+{
+    // Two channels: a mono track is read doubled, as the transport plays it
+    for (auto& buffer : voiceBuffers)
+        buffer.setSize(2, ChunkFrames);
+}
+
+void DeckSlicer::setInput(juce::AudioTransportSource* newTransport, InMemoryTrackReader* newRam) noexcept
+{
+    transport = newTransport;
+    ram = newRam;
+    reset();
+}
+
+bool DeckSlicer::canSlice(double deviceSampleRate) const noexcept
+{
+    return ram != nullptr && deviceSampleRate > 0.0 && ram->sampleRate == deviceSampleRate;
+}
+
+void DeckSlicer::trigger(juce::int64 startFrame, juce::int64 endFrame, juce::int64 atFrame) noexcept
+{
+    // A slice has to hold its fade in and the seam's fade out
+    if (transport == nullptr || ram == nullptr || startFrame < 0 || endFrame - startFrame <= 2 * FadeFrames) return;
+    pending = { true, false, startFrame, endFrame, atFrame, transport->getNextReadPosition() };
+}
+
+void DeckSlicer::release() noexcept
+{
+    // A quantized tap let go before its beat still plays its slice
+    if (pending.waiting) {
+        pending.oneShot = true;
+        return;
+    }
+    for (auto& v : voices)
+        v.target = 0.0f;
+}
+
+void DeckSlicer::reset() noexcept
+{
+    voices = {};
+    pending = {};
+}
+
+void DeckSlicer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    if (transport != nullptr) transport->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void DeckSlicer::releaseResources()
+{
+    if (transport != nullptr) transport->releaseResources();
+}
+
+void DeckSlicer::getNextAudioBlock(const juce::AudioSourceChannelInfo& info)
+{
+    if (transport == nullptr) {
+        info.clearActiveBufferRegion();
+        return;
+    }
+    // The transport always runs: it is the shadow playhead the deck returns to
+    const juce::int64 blockStart = transport->getNextReadPosition();
+    transport->getNextAudioBlock(info);
+    if (!isActive() || ram == nullptr || !transport->isPlaying()) return;
+
+    int fireAt = info.numSamples;
+    if (pending.waiting) {
+        if (pending.atFrame < 0 || blockStart >= pending.atFrame || blockStart < pending.armedAt)
+            fireAt = 0;     // now, already passed, or the transport jumped back over it
+        else if (pending.atFrame - blockStart < info.numSamples)
+            fireAt = (int) (pending.atFrame - blockStart);
+    }
+    if (fireAt > 0) render(info, 0, fireAt);
+    if (fireAt < info.numSamples) {
+        fire();
+        render(info, fireAt, info.numSamples - fireAt);
+    }
+}
+
+void DeckSlicer::fire() noexcept
+{
+    // The free voice, else the quieter one; whatever else plays fades out under it
+    Voice* slot = !voices[0].active ? &voices[0]
+                : !voices[1].active ? &voices[1]
+                : voices[0].gain <= voices[1].gain ? &voices[0] : &voices[1];
+    for (auto& v : voices)
+        if (&v != slot) v.target = 0.0f;
+    *slot = {};
+    slot->active = true;
+    slot->oneShot = pending.oneShot;
+    slot->startFrame = pending.startFrame;
+    slot->endFrame = pending.endFrame;
+    slot->position = pending.startFrame;
+    slot->target = 1.0f;
+    pending = {};
+}
+
+void DeckSlicer::readVoice(Voice& v, juce::AudioBuffer<float>& buffer, int n) noexcept
+{
+    // Past the slice's end only while fading out: the tail is what follows it in the track
+    ram->read(&buffer, 0, n, v.position, true, true);
+    v.position += n;
+}
+
+void DeckSlicer::render(const juce::AudioSourceChannelInfo& info, int offset, int numSamples) noexcept
+{
+    auto& out = *info.buffer;
+    const int numChannels = out.getNumChannels();
+    const float step = 1.0f / (float) FadeFrames;
+    const float trackGain = transport->getGain();
+
+    for (int done = 0; done < numSamples;) {
+        if (!voices[0].active && !voices[1].active) return;
+
+        // A held slice loops by cross-fading into itself on the other voice FadeFrames before
+        // its end; a one-shot fades back to the transport there
+        for (size_t i = 0; i < voices.size(); ++i) {
+            Voice& v = voices[i];
+            if (!v.active || v.target == 0.0f || v.position + FadeFrames < v.endFrame) continue;
+            v.target = 0.0f;
+            if (v.oneShot) continue;
+            Voice& next = voices[1 - i];
+            next = {};
+            next.active = true;
+            next.startFrame = v.startFrame;
+            next.endFrame = v.endFrame;
+            next.position = v.startFrame;
+            next.target = 1.0f;
+        }
+        int len = std::min(ChunkFrames, numSamples - done);
+        for (const auto& v : voices)
+            if (v.active && v.target > 0.0f)
+                len = (int) std::min<juce::int64>(len, v.endFrame - FadeFrames - v.position);
+        len = std::max(1, len);
+
+        for (size_t i = 0; i < voices.size(); ++i)
+            if (voices[i].active) readVoice(voices[i], voiceBuffers[i], len);
+
+        const int first = info.startSample + offset + done;
+        Voice& a = voices[0];
+        Voice& b = voices[1];
+        const bool settled = (a.active != b.active) && (a.active ? a : b).gain == 1.0f && (a.active ? a : b).target == 1.0f;
+        if (settled) {
+            // One voice alone at full level: the track's output is replaced outright
+            const auto& source = voiceBuffers[a.active ? 0 : 1];
+            for (int ch = 0; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::copyWithMultiply(out.getWritePointer(ch, first),
+                                                              source.getReadPointer(std::min(ch, 1)), trackGain, len);
+        } else {
+            float* const* dst = out.getArrayOfWritePointers();
+            const float* const* va = voiceBuffers[0].getArrayOfReadPointers();
+            const float* const* vb = voiceBuffers[1].getArrayOfReadPointers();
+            for (int s = 0; s < len; ++s) {
+                for (auto& v : voices) {
+                    if (!v.active) continue;
+                    v.gain = v.gain < v.target ? std::min(v.target, v.gain + step) : std::max(v.target, v.gain - step);
+                }
+                const float ga = a.active ? a.gain : 0.0f;
+                const float gb = b.active ? b.gain : 0.0f;
+                const float base = std::max(0.0f, 1.0f - ga - gb);
+                for (int ch = 0; ch < numChannels; ++ch) {
+                    const int src = std::min(ch, 1);
+                    float& sample = dst[ch][first + s];
+                    sample = sample * base + trackGain * (ga * va[src][s] + gb * vb[src][s]);
+                }
+            }
+        }
+        for (auto& v : voices)
+            if (v.active && v.gain == 0.0f && v.target == 0.0f) v = {};
+        done += len;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class InMemoryTrackReader;
+
+/**
+ * Slicer stage between a deck's AudioTransportSource and its tempo resampler.
+ *
+ * The transport plays on underneath as the shadow playhead; a triggered slice replaces its
+ * output with track frames [startFrame, endFrame) read straight out of the in-memory track,
+ * looping while the pad is held. Nothing seeks the transport or its decoder, so on release the
+ * track takes over again exactly where it would have been. Because the stage sits before the
+ * resampler and the stretcher, tempo, keylock, EQ and effects apply to slices as to the track.
+ *
+ * Every change is a FadeFrames linear cross-fade: transport to slice, slice to slice (two
+ * voices, the old one fading out under the new one) and slice back to the transport. A
+ * trigger can wait for a transport frame (the next beat with quantize) and starts on exactly
+ * that sample of the block it falls in. Buffers are sized in the constructor; the audio
+ * thread never allocates.
+ */
+class DeckSlicer : public juce::AudioSource {
+public:
+    static constexpr int NumSlices = 8;
+    static constexpr int FadeFrames = 96;       // ~2 ms
+    static constexpr int ChunkFrames = 1024;    // voice frames read from RAM per pass
+
+    DeckSlicer();
+
+    // Audio thread (or before it runs): play from another track. Voices and a waiting trigger
+    // are dropped; ram may be nullptr (a streamed track cannot be sliced).
+    void setInput(juce::AudioTransportSource* transport, InMemoryTrackReader* ram) noexcept;
+    // The track is in RAM at the rate the device plays it, so track frames are output frames
+    bool canSlice(double deviceSampleRate) const noexcept;
+
+    // Audio thread: loop track frames [startFrame, endFrame) in place of the transport from
+    // transport frame atFrame on (< 0: at once). A trigger waiting for its frame is replaced.
+    void trigger(juce::int64 startFrame, juce::int64 endFrame, juce::int64 atFrame) noexcept;
+    // Audio thread: fade back to the transport. A slice still waiting for its frame plays once.
+    void release() noexcept;
+    // Audio thread: back to the transport at once, no fade (the deck leaves the timeline)
+    void reset() noexcept;
+    bool isActive() const noexcept { return voices[0].active || voices[1].active || pending.waiting; }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override;
+
+private:
+    struct Voice {
+        bool active{false};
+        bool oneShot{false};        // fades out on its own at the end of the slice
+        juce::int64 startFrame{0};
+        juce::int64 endFrame{0};
+        juce::int64 position{0};    // next track frame it plays
+        float gain{0.0f};
+        float target{0.0f};
+    };
+    struct Trigger {
+        bool waiting{false};
+        bool oneShot{false};
+        juce::int64 startFrame{0};
+        juce::int64 endFrame{0};
+        juce::int64 atFrame{-1};
+        juce::int64 armedAt{0};     // transport frame when it was set; a jump back fires it
+    };
+
+    // Start the pending slice on the voice not in use (or the quieter one)
+    void fire() noexcept;
+    // Mix the voices over out[offset, offset + numSamples), chunk by chunk
+    void render(const juce::AudioSourceChannelInfo& info, int offset, int numSamples) noexcept;
+    // Read n frames of v into buffer from its position on, wrapping at its end
+    void readVoice(Voice& v, juce::AudioBuffer<float>& buffer, int n) noexcept;
+
+    juce::AudioTransportSource* transport{nullptr};
+    InMemoryTrackReader* ram{nullptr};
+    std::array<Voice, 2> voices;
+    Trigger pending;
+    std::array<juce::AudioBuffer<float>, 2> voiceBuffers;
+
+    JUCE_DECLARE_NON_COPYABLE(DeckSlicer)
+};
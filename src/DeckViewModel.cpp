@@ -0,0 +1,65 @@
+#include "DeckViewModel.h"
+#include <cmath>
+
+namespace {
+    // Rounded to the precision shown: equal keys, equal text
+    qint64 shownAt(double value, double scale) { return (qint64) std::llround(value * scale); }
+}
+
+void DeckViewModel::bindTempoLabels(QLabel* bpmDefaultLabel, QLabel* bpmCurrentLabel, QLabel* tempoValueLabel)
+{
+    bpmDefault = { bpmDefaultLabel };
+    bpmCurrent = { bpmCurrentLabel };
+    tempoValue = { tempoValueLabel };
+}
+
+void DeckViewModel::bindOverviewLabel(QLabel* label, const QString& prefix)
+{
+    overview = { label };
+    overviewPrefix = prefix;
+}
+
+void DeckViewModel::setTempo(const Tempo& tempo)
+{
+    displayedBpm = tempo.detectedBpm > 0.0 ? tempo.detectedBpm * tempo.factor : 0.0;
+    // Keys are >= 0 with a value and 0 without, so "--" and 0.0 share one
+    update(bpmDefault, tempo.detectedBpm > 0.0 ? shownAt(tempo.detectedBpm, 10.0) : 0, [&]() {
+        return tempo.detectedBpm > 0.0 ? QString("BPM: %1").arg(QString::number(tempo.detectedBpm, 'f', 1)) : QString("BPM: --");
+    });
+    update(bpmCurrent, displayedBpm > 0.0 ? shownAt(displayedBpm, 10.0) : 0, [&]() {
+        return displayedBpm > 0.0 ? QString("Curr: %1").arg(QString::number(displayedBpm, 'f', 1)) : QString("Curr: --");
+    });
+    update(tempoValue, shownAt(tempo.factor, 1000.0), [&]() { return QString::number(tempo.factor, 'f', 3) + "x"; });
+}
+
+void DeckViewModel::setOverview(const Overview& state)
+{
+    // State in the top bits, the one number it shows below: percent, or BPM and trim in 0.1 ms
+    qint64 key;
+    if (state.analysisActive) key = (qint64(1) << 60) | (qint64) std::lround(state.analysisProgress * 100.0);
+    else if (state.analysisFailed) key = qint64(2) << 60;
+    else key = (state.originalBpm > 0.0 ? (qint64) std::lround(state.originalBpm) << 32 : 0)
+               | (qint64) (quint32) shownAt(state.visualTrimSec, 10000.0);
+    if (!state.analysisActive && !state.analysisFailed && state.algorithm != overviewAlgorithm) {
+        overviewAlgorithm = state.algorithm;
+        overview.key = -1;
+    }
+
+    update(overview, key, [&]() {
+        QString suffix;
+        if (state.analysisActive) {
+            suffix = QString(" (Analyzing %1%)").arg((int) std::lround(state.analysisProgress * 100.0));
+        } else if (state.analysisFailed) {
+            suffix = QString(" (Analysis failed)");
+        } else {
+            const double trimMs = state.visualTrimSec * 1000.0;
+            const QString algText = state.algorithm.isEmpty() ? QString() : QString(" - %1").arg(state.algorithm);
+            const QString trimText = std::abs(trimMs) > 0.0001 ? QString("  |  trim %1 ms").arg(QString::number(trimMs, 'f', 1)) : QString();
+            suffix = QString(" (BPM: %1%2)%3")
+                         .arg(state.originalBpm > 0.0 ? QString::number((int) std::round(state.originalBpm)) : QString("--"))
+                         .arg(algText)
+                         .arg(trimText);
+        }
+        return overviewPrefix + "  " + suffix;
+    });
+}
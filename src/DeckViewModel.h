@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QLabel>
+#include <QPointer>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * What one deck's text labels show, diffed against what they showed last.
+ *
+ * The deck widget and the main window hand in their state whenever it may have changed: on
+ * each tempo tick, sync step, analysis progress report and timer pass. Most of those change
+ * nothing on screen. Every field keeps the inputs it was last formatted from, rounded to the
+ * precision it is shown at, along with the string made from them. A field whose inputs are
+ * the same keeps its string and its label is not touched. QLabel::setText() relayouts the
+ * label's parents even for identical text, so skipping it matters on every tick.
+ *
+ * GUI thread only. Labels are bound once; an unbound or deleted label is skipped.
+ */
+class DeckViewModel {
+public:
+    struct Tempo {
+        double detectedBpm{0.0};
+        double factor{1.0};
+    };
+    struct Overview {
+        bool analysisActive{false};
+        bool analysisFailed{false};
+        double analysisProgress{0.0};   // 0..1
+        double originalBpm{0.0};
+        QString algorithm;
+        double visualTrimSec{0.0};
+    };
+
+    void bindTempoLabels(QLabel* bpmDefault, QLabel* bpmCurrent, QLabel* tempoValue);
+    // prefix: "DECK A - OVERVIEW" and the like, in front of the analysis state
+    void bindOverviewLabel(QLabel* label, const QString& prefix);
+
+    void setTempo(const Tempo& tempo);
+    void setOverview(const Overview& overview);
+    // The speed-adjusted BPM as shown (0 without a detected BPM)
+    double getDisplayedBpm() const { return displayedBpm; }
+
+private:
+    // One label's text and the key of the inputs it was formatted from
+    struct Field {
+        QPointer<QLabel> label;
+        qint64 key{-1};
+        QString text;
+    };
+    // Formats and sets the field only when key differs from the last one
+    template <typename Format>
+    static void update(Field& field, qint64 key, Format&& format);
+
+    Field bpmDefault, bpmCurrent, tempoValue, overview;
+    QString overviewPrefix;
+    QString overviewAlgorithm;   // part of the overview's key, compared as a string
+    double displayedBpm{0.0};
+};
+
+template <typename Format>
+void DeckViewModel::update(Field& field, qint64 key, Format&& format)
+{
+    if (field.label.isNull() || key == field.key) return;
+    field.key = key;
+    field.text = format();
+    field.label->setText(field.text);
+}
@@ -2,6 +2,12 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLBuffer>
 #include "WaveformGenerator.h"
+#include "FrameClock.h"
+#include "EventTrace.h"
+#include "FrameTimeHud.h"
+#include "GlResources.h"
+#include "TrackDragMimeData.h"
+#include "WaveformRaster.h"
 #include <QPainter>
 #include <QTimer>
 #include <QTime>
@@ -9,10 +15,23 @@
 #include <QLinearGradient>
 #include <algorithm>
 
+namespace {
+    // Same colours as WaveformDisplay for consistency
+    const QColor cueColors[8] = {
+        QColor(255, 80, 80),   // Red
+        QColor(255, 150, 80),  // Orange  
+        QColor(255, 220, 80),  // Yellow
+        QColor(150, 255, 80),  // Light Green
+        QColor(80, 255, 150),  // Cyan
+        QColor(80, 180, 255),  // Blue
+        QColor(150, 80, 255),  // Purple
+        QColor(255, 80, 200)   // Magenta
+    };
+}
+
 DeckWaveformOverview::DeckWaveformOverview(QWidget* parent)
     : QOpenGLWidget(parent)
 {
-    formatManager.registerBasicFormats(); // Includes MP3 support with JUCE_USE_MP3AUDIOFORMAT=1
     setAttribute(Qt::WA_OpaquePaintEvent, true);
     setAutoFillBackground(false);
     setAcceptDrops(true);
@@ -21,38 +40,41 @@ DeckWaveformOverview::DeckWaveformOverview(QWidget* parent)
     cuePoints.fill(-1.0);
     cuePointsValid = false;
     
-    // Smooth playhead timer (exponential smoothing for ultra-smooth marker movement)
-    smoothTimer = new QTimer(this);
-    smoothTimer->setInterval(16); // ~60 FPS
-    connect(smoothTimer, &QTimer::timeout, this, [this]() {
-        if (playheadPos < 0.0) { update(); return; }
-        if (displayedPlayheadPos < 0.0) displayedPlayheadPos = playheadPos;
-        double diff = playheadPos - displayedPlayheadPos;
-        // Exponential smoothing: responsive but stable
-        const double alpha = 0.35; // 0..1, higher = faster follow
-        displayedPlayheadPos += diff * alpha;
-        // Snap when very close to avoid micro-jitter
-        if (std::abs(playheadPos - displayedPlayheadPos) < 0.0008) displayedPlayheadPos = playheadPos;
-        update();
+    // Smooth playhead on the shared frame clock (exponential smoothing for ultra-smooth marker movement)
+    connect(&FrameClock::instance(), &FrameClock::frame, this, [this]() {
+        if (playheadPos < 0.0) {
+            displayedPlayheadPos = -1.0;
+        } else {
+            if (displayedPlayheadPos < 0.0) displayedPlayheadPos = playheadPos;
+            double diff = playheadPos - displayedPlayheadPos;
+            // Exponential smoothing: responsive but stable
+            const double alpha = 0.35; // 0..1, higher = faster follow
+            displayedPlayheadPos += diff * alpha;
+            // Snap when very close to avoid micro-jitter
+            if (std::abs(playheadPos - displayedPlayheadPos) < 0.0008) displayedPlayheadPos = playheadPos;
+        }
+        // Everything else is static, so a frame is only worth it once the line changes column
+        if (playheadColumn() != paintedPlayheadX) update();
     });
-    smoothTimer->start();
 }
 
 DeckWaveformOverview::~DeckWaveformOverview()
 {
     makeCurrent();
-    if (program) { delete program; program = nullptr; }
-    if (lineProgram) { delete lineProgram; lineProgram = nullptr; }
-    if (vbo.isCreated()) vbo.destroy();
+    program.reset();
+    lineProgram.reset();
+    mesh.reset();
     if (vao.isCreated()) vao.destroy();
     if (lineVbo.isCreated()) lineVbo.destroy();
     if (lineVao.isCreated()) lineVao.destroy();
+    frameHud.releaseGL();
     doneCurrent();
 }
 
 void DeckWaveformOverview::initializeGL()
 {
     initializeOpenGLFunctions();
+    frameHud.initializeGL();
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -140,24 +162,10 @@ void DeckWaveformOverview::initializeGL()
         }
     )GLSL";
 
-    program = new QOpenGLShaderProgram(this);
-    program->addShaderFromSourceCode(QOpenGLShader::Vertex, vsrc);
-    program->addShaderFromSourceCode(QOpenGLShader::Fragment, fsrc);
-    program->link();
-
-    // Create VAO/VBO for main waveform
+    // Shared by all decks; the mesh buffer comes from GlResources per waveform
+    program = GlResources::instance().program("DeckWaveformOverview.wave", vsrc, fsrc);
     vao.create();
-    vao.bind();
-    vbo.create();
-    vbo.bind();
-    vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    
-    program->bind();
-    program->enableAttributeArray(0);
-    program->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(float)*3); // x, y, intensity
-    vao.release();
-    vbo.release();
-    program->release();
+    meshDirty = true;
 
     // Create simple line shader for playhead
     const char* lineVsrc = R"GLSL(
@@ -176,10 +184,8 @@ void DeckWaveformOverview::initializeGL()
         }
     )GLSL";
     
-    lineProgram = new QOpenGLShaderProgram(this);
-    lineProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, lineVsrc);
-    lineProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, lineFsrc);
-    lineProgram->link();
+    lineProgram = GlResources::instance().program("DeckWaveformOverview.line", lineVsrc, lineFsrc);
+    if (!lineProgram) return;
 
     // Playhead line VAO/VBO
     lineVao.create();
@@ -187,6 +193,7 @@ void DeckWaveformOverview::initializeGL()
     lineVbo.create();
     lineVbo.bind();
     lineVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    lineVbo.allocate(OverlayVertexCapacity * 2 * (int)sizeof(float));
     lineProgram->bind();
     lineProgram->enableAttributeArray(0);
     lineProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2, sizeof(float)*2);
@@ -200,16 +207,23 @@ void DeckWaveformOverview::resizeGL(int w, int h)
     viewportW = std::max(1, w);
     viewportH = std::max(1, h);
     glViewport(0, 0, viewportW, viewportH);
-    meshDirty = true;
+    // The mesh lives in [0,1] space, so a resize needs no rebuild; the software strip does
+    stripDirty = true;
 }
 
 void DeckWaveformOverview::paintGL()
 {
+    EVENT_TRACE_SCOPE("DeckWaveformOverview::paintGL", "ui");
+    FrameTimeHud::Frame hudFrame(frameHud);
     // Professional dark background with subtle gradient
     glClearColor(0.02f, 0.02f, 0.025f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    if (!waveform.empty() && viewportW > 0 && viewportH > 0 && program) {
+    // Shaders unless acceleration is off or GL itself runs on the CPU
+    const bool gpu = program && lineProgram && GlResources::instance().gpuWaveforms();
+    if (!gpu && waveform && !waveform->empty() && viewportW > 0 && viewportH > 0) {
+        drawSoftwareStrip();
+    } else if (waveform && !waveform->empty() && viewportW > 0 && viewportH > 0 && program) {
         rebuildMeshIfNeeded();
         if (vertexCount > 0) {
             program->bind();
@@ -227,22 +241,17 @@ void DeckWaveformOverview::paintGL()
         }
     }
 
-    // Draw cue points as vertical lines
-    if (cuePointsValid && totalLength > 0.0) {
-        drawCuePoints();
+    if (structure.isValid() && totalLength > 0.0) {
+        drawPhrases();
     }
-    
+
     // Draw ghost loop region first (behind active loop)
     if (ghostLoopEnabled && totalLength > 0.0) {
         drawGhostLoopRegion();
     }
     
     // Draw active loop region
-    qDebug() << "DeckWaveformOverview::paintGL loop check: loopEnabled=" << loopEnabled 
-             << ", loopStartSec=" << loopStartSec << ", loopEndSec=" << loopEndSec 
-             << ", totalLength=" << totalLength;
     if (loopEnabled && totalLength > 0.0) {
-        qDebug() << "DeckWaveformOverview::paintGL calling drawLoopRegion";
         drawLoopRegion();
     }
     
@@ -254,19 +263,66 @@ void DeckWaveformOverview::paintGL()
         debugP.drawText(8, 13, QString("LOOP %1-%2").arg(loopStartSec, 0, 'f', 1).arg(loopEndSec, 0, 'f', 1));
     }
 
-    // Professional playhead with glow effect
-    if (displayedPlayheadPos >= 0.0f && lineProgram) {
-        // Main playhead line
+    // Cue and playhead lines from the overlay buffer, cue numbers on top
+    if (gpu) drawOverlayLines();
+    else drawOverlayLinesSoftware();
+    if (cuePointsValid && totalLength > 0.0) {
+        drawCuePoints();
+    }
+    paintedPlayheadX = playheadColumn();
+}
+
+int DeckWaveformOverview::playheadColumn() const
+{
+    return displayedPlayheadPos >= 0.0 ? (int)std::lround(displayedPlayheadPos * width()) : -1;
+}
+
+void DeckWaveformOverview::updateCueLines()
+{
+    cueLinesDirty = false;
+    cueLineCount = 0;
+    const double effectiveLength = totalLength - audioStartOffset;
+    if (!cuePointsValid || effectiveLength <= 0.0) return;
+
+    float verts[2 * 2 * 8];
+    for (int i = 0; i < 8; ++i) {
+        // Cue points before audio start aren't shown
+        if (cuePoints[i] < audioStartOffset) continue;
+        const double relativePos = (cuePoints[i] - audioStartOffset) / effectiveLength;
+        if (relativePos > 1.0) continue;
+        const float x = (float)(relativePos * 2.0 - 1.0);
+        float* v = &verts[cueLineCount * 4];
+        v[0] = x; v[1] = -1.0f; v[2] = x; v[3] = 1.0f;
+        cueLineSlots[cueLineCount++] = i;
+    }
+    if (cueLineCount > 0)
+        lineVbo.write(2 * 2 * (int)sizeof(float), verts, cueLineCount * 4 * (int)sizeof(float));
+}
+
+void DeckWaveformOverview::drawOverlayLines()
+{
+    if (!lineProgram) return;
+    const bool showPlayhead = displayedPlayheadPos >= 0.0;
+
+    lineVao.bind();
+    lineVbo.bind();
+    if (cueLinesDirty) updateCueLines();
+    if (showPlayhead) {
         const float x = (float)(displayedPlayheadPos * 2.0 - 1.0);
         const float verts[4] = { x, -1.0f, x, 1.0f };
-        
-        lineVao.bind();
-        lineVbo.bind();
-        if (lineVbo.size() < (int)sizeof(verts)) lineVbo.allocate(sizeof(verts));
         lineVbo.write(0, verts, sizeof(verts));
-        
-        lineProgram->bind();
-        
+    }
+
+    lineProgram->bind();
+    glLineWidth(1.5f);
+    for (int l = 0; l < cueLineCount; ++l) {
+        const QColor& c = cueColors[cueLineSlots[l]];
+        lineProgram->setUniformValue("uColor", QVector3D(c.redF(), c.greenF(), c.blueF()));
+        glDrawArrays(GL_LINES, 2 + l * 2, 2);
+    }
+
+    // Professional playhead with glow effect
+    if (showPlayhead) {
         // Draw glow effect (thicker, transparent)
         lineProgram->setUniformValue("uColor", QVector3D(0.0f, 1.0f, 0.5f));
         glLineWidth(6.0f);
@@ -276,10 +332,74 @@ void DeckWaveformOverview::paintGL()
         lineProgram->setUniformValue("uColor", QVector3D(1.0f, 1.0f, 1.0f));
         glLineWidth(2.0f);
         glDrawArrays(GL_LINES, 0, 2);
-        
-        lineProgram->release();
-        lineVbo.release();
-        lineVao.release();
+    }
+    
+    lineProgram->release();
+    lineVbo.release();
+    lineVao.release();
+}
+
+void DeckWaveformOverview::drawSoftwareStrip()
+{
+    const qreal pixelRatio = devicePixelRatioF();
+    const int w = (int)std::lround(width() * pixelRatio);
+    const int h = (int)std::lround(height() * pixelRatio);
+    if (w <= 0 || h <= 0) return;
+    if (stripDirty || softwareStrip.size() != QSize(w, h)) {
+        stripDirty = false;
+        // Upper half from the centre line, like the mesh: per column the loudest bin it covers,
+        // brighter where the level changes fast (the shader's intensity)
+        const size_t n = waveform->size();
+        const int centre = h / 2;
+        WaveformRaster::Columns columns;
+        columns.resize(w);
+        columns.colour.resize((size_t)w);
+        float previous = 0.0f;
+        for (int x = 0; x < w; ++x) {
+            const size_t first = (size_t)((double)x * n / w);
+            const size_t end = std::max(first + 1, (size_t)((double)(x + 1) * n / w));
+            std::int8_t peak = 0;
+            for (size_t i = first; i < std::min(end, n); ++i) peak = std::max(peak, (*waveform)[i]);
+            const float amplitude = std::clamp(WaveformCache::amplitude(peak), 0.0f, 1.0f);
+            columns.top[x] = centre - (std::int32_t)std::lround(amplitude * 0.45f * h);
+            columns.bottom[x] = centre + 1;
+            const float intensity = std::min(1.0f, std::abs(amplitude - previous) * 8.0f) * 0.7f;
+            previous = amplitude;
+            const float brightness = 0.4f + amplitude * 0.6f;
+            columns.colour[x] = qPremultiply(qRgba((int)(255.0f * brightness * (0.2f + 0.2f * intensity)),
+                                                   (int)(255.0f * brightness * (0.4f + 0.4f * intensity)),
+                                                   (int)(255.0f * brightness * (0.8f + 0.2f * intensity)), 220));
+        }
+        QImage strip(w, h, QImage::Format_ARGB32_Premultiplied);
+        strip.fill(Qt::transparent);
+        WaveformRaster::fill(strip, columns, {}, qPremultiply(qRgba(102, 204, 255, 255)), 1);
+        softwareStrip = QPixmap::fromImage(std::move(strip));
+        softwareStrip.setDevicePixelRatio(pixelRatio);
+    }
+    QPainter p(this);
+    p.drawPixmap(0, 0, softwareStrip);
+}
+
+void DeckWaveformOverview::drawOverlayLinesSoftware()
+{
+    const double effectiveLength = totalLength - audioStartOffset;
+    QPainter p(this);
+    if (cuePointsValid && effectiveLength > 0.0) {
+        for (int i = 0; i < 8; ++i) {
+            if (cuePoints[i] < audioStartOffset) continue;
+            const double relativePos = (cuePoints[i] - audioStartOffset) / effectiveLength;
+            if (relativePos > 1.0) continue;
+            const double x = relativePos * width();
+            p.setPen(QPen(cueColors[i], 1.5));
+            p.drawLine(QPointF(x, 0.0), QPointF(x, height()));
+        }
+    }
+    if (displayedPlayheadPos >= 0.0) {
+        const double x = displayedPlayheadPos * width();
+        p.setPen(QPen(QColor(0, 255, 128, 230), 6.0));
+        p.drawLine(QPointF(x, 0.0), QPointF(x, height()));
+        p.setPen(QPen(QColor(255, 255, 255, 230), 2.0));
+        p.drawLine(QPointF(x, 0.0), QPointF(x, height()));
     }
 }
 
@@ -287,7 +407,7 @@ void DeckWaveformOverview::loadAndRenderWaveform()
 {
     // No heavy work on UI thread; rely on setWaveformData from background
     // Keep as no-op to avoid blocking. If waveform already set, just refresh.
-    meshDirty = true;
+    cueLinesDirty = true;
     update();
 }
 
@@ -314,7 +434,7 @@ void DeckWaveformOverview::setPlayhead(double relative)
     } else {
         playheadPos = relative;
     }
-    update();
+    // The smoothing timer repaints once the playhead reaches another column
 }
 
 void DeckWaveformOverview::mousePressEvent(QMouseEvent* event)
@@ -359,11 +479,8 @@ void DeckWaveformOverview::dragEnterEvent(QDragEnterEvent* event) {
 }
 
 void DeckWaveformOverview::dropEvent(QDropEvent* event) {
-    auto urls = event->mimeData()->urls();
-    if (!urls.isEmpty()) {
-        auto path = urls.first().toLocalFile();
-        emit fileDropped(path);
-    }
+    const QString path = TrackDragMimeData::firstFilePath(event->mimeData());
+    if (!path.isEmpty()) emit fileDropped(path);
 }
 
 void DeckWaveformOverview::setBeatInfo(double bpm_, double firstBeatOffset_, double totalLength_) {
@@ -388,12 +505,14 @@ void DeckWaveformOverview::setAudioStartOffset(double audioStartTime) {
 void DeckWaveformOverview::setCuePoints(const std::array<double, 8>& newCuePoints) {
     cuePoints = newCuePoints;
     cuePointsValid = true;
+    cueLinesDirty = true;
     update();
 }
 
 void DeckWaveformOverview::clearCuePoints() {
     cuePoints.fill(-1.0);
     cuePointsValid = false;
+    cueLinesDirty = true;
     update();
 }
 
@@ -426,78 +545,75 @@ void DeckWaveformOverview::setGhostLoopRegion(bool enabled, double startSec, dou
 
 void DeckWaveformOverview::rebuildMeshIfNeeded()
 {
-    if (!meshDirty || waveform.empty()) return;
+    if (!meshDirty || !waveform || waveform->empty() || !program) return;
     meshDirty = false;
-    
-    // Build high-quality triangle strip with intensity data
-    std::vector<float> verts;
-    const size_t n = waveform.size();
-    
-    // Pre-allocate for performance: 3 floats per vertex, 2 vertices per sample
-    verts.reserve(n * 2 * 3);
-    
-    // Calculate intensity (derivative-based for dynamic highlighting)
-    std::vector<float> intensity(n, 0.0f);
-    for (size_t i = 1; i < n - 1; ++i) {
-        float derivative = std::abs(waveform[i + 1] - waveform[i - 1]);
-        intensity[i] = std::min(1.0f, derivative * 8.0f); // Scale for visibility
-    }
-    
-    for (size_t i = 0; i < n; ++i) {
-        float x = (float)i / (float)(n - 1); // 0..1
-        float amplitude = std::min(1.0f, waveform[i]);
-        float intens = intensity[i];
-        
-        // Create triangle strip: bottom vertex at center (0.5), top at amplitude
-        float yCenter = 0.5f;  // Center line in [0,1] space
-        float yTop = 0.5f + amplitude * 0.45f; // Upper half with margin
-        
-        // Bottom vertex (center line)
-        verts.push_back(x);
-        verts.push_back(yCenter);
-        verts.push_back(intens * 0.3f); // Lower intensity at center
-        
-        // Top vertex (amplitude peak)
-        verts.push_back(x);
-        verts.push_back(yTop);
-        verts.push_back(intens);
+
+    // Another deck showing the same waveform may have uploaded it already
+    mesh = GlResources::instance().mesh(waveform);
+    if (!mesh->uploaded) {
+        std::vector<float> samples(waveform->size());
+        for (size_t i = 0; i < samples.size(); ++i) samples[i] = std::max(0.0f, WaveformCache::amplitude((*waveform)[i]));
+
+        // Build high-quality triangle strip with intensity data
+        std::vector<float> verts;
+        const size_t n = samples.size();
+
+        // Pre-allocate for performance: 3 floats per vertex, 2 vertices per sample
+        verts.reserve(n * 2 * 3);
+
+        // Calculate intensity (derivative-based for dynamic highlighting)
+        std::vector<float> intensity(n, 0.0f);
+        for (size_t i = 1; i < n - 1; ++i) {
+            float derivative = std::abs(samples[i + 1] - samples[i - 1]);
+            intensity[i] = std::min(1.0f, derivative * 8.0f); // Scale for visibility
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            float x = (float)i / (float)(n - 1); // 0..1
+            float amplitude = std::min(1.0f, samples[i]);
+            float intens = intensity[i];
+
+            // Create triangle strip: bottom vertex at center (0.5), top at amplitude
+            float yCenter = 0.5f;  // Center line in [0,1] space
+            float yTop = 0.5f + amplitude * 0.45f; // Upper half with margin
+
+            // Bottom vertex (center line)
+            verts.push_back(x);
+            verts.push_back(yCenter);
+            verts.push_back(intens * 0.3f); // Lower intensity at center
+
+            // Top vertex (amplitude peak)
+            verts.push_back(x);
+            verts.push_back(yTop);
+            verts.push_back(intens);
+        }
+
+        // One upload per waveform; the buffer isn't touched again
+        mesh->buffer.bind();
+        mesh->buffer.allocate(verts.data(), (int)verts.size() * (int)sizeof(float));
+        mesh->buffer.release();
+        mesh->vertexCount = (int)(verts.size() / 3);
+        mesh->memory.resize((int64_t)(verts.size() * sizeof(float)));
+        mesh->uploaded = true;
     }
+    vertexCount = mesh->vertexCount;
 
-    vertexCount = (int)(verts.size() / 3);
-    
+    // VAOs are per context, so this view points its own at the shared buffer
     vao.bind();
-    vbo.bind();
-    const int bytes = (int)verts.size() * (int)sizeof(float);
-    if (vbo.size() < bytes) vbo.allocate(bytes);
-    vbo.write(0, verts.data(), bytes);
-    
+    mesh->buffer.bind();
     program->bind();
     program->enableAttributeArray(0);
     program->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(float)*3);
     program->release();
-    
-    vbo.release();
+    mesh->buffer.release();
     vao.release();
 }
 
-// NEW: Draw cue points as vertical lines using simple Qt painting over OpenGL
+// Cue numbers over the lines drawn by drawOverlayLines()
 void DeckWaveformOverview::drawCuePoints() {
     // Use QPainter over OpenGL context for simple line drawing
     QPainter p(this);
     p.setRenderHint(QPainter::Antialiasing, true);
-    qDebug() << "DeckWaveformOverview::drawLoopRegion called: loopEnabled=" << loopEnabled << ", loopStartSec=" << loopStartSec << ", loopEndSec=" << loopEndSec;
-    
-    // Define cue point colors (same as WaveformDisplay for consistency)
-    static const QColor cueColors[8] = {
-        QColor(255, 80, 80),   // Red
-        QColor(255, 150, 80),  // Orange  
-        QColor(255, 220, 80),  // Yellow
-        QColor(150, 255, 80),  // Light Green
-        QColor(80, 255, 150),  // Cyan
-        QColor(80, 180, 255),  // Blue
-        QColor(150, 80, 255),  // Purple
-        QColor(255, 80, 200)   // Magenta
-    };
     
     for (int i = 0; i < 8; ++i) {
         if (cuePoints[i] < 0.0) continue; // Skip unset cue points
@@ -520,12 +636,6 @@ void DeckWaveformOverview::drawCuePoints() {
         // Calculate screen position
         int screenX = (int)(relativePos * width());
         
-        // Draw cue line
-        QPen cuePen(cueColors[i], 1.5);
-        cuePen.setStyle(Qt::SolidLine);
-        p.setPen(cuePen);
-        p.drawLine(screenX, 0, screenX, height());
-        
         // Draw small cue number at bottom
         p.setFont(QFont("Arial", 6, QFont::Bold));
         QString cueLabel = QString::number(i + 1);
@@ -610,6 +720,25 @@ void DeckWaveformOverview::drawLoopRegion() {
     p.drawText(labelX, labelY - 1, loopLabel);
 }
 
+void DeckWaveformOverview::drawPhrases() {
+    // Same mapping as the loop region: track time past the audio start over what is left
+    const double effectiveLength = totalLength - audioStartOffset;
+    if (effectiveLength <= 0.0) return;
+    QPainter p(this);
+    const int stripHeight = std::max(2, height() / 12);
+    for (const auto& phrase : structure.phrases) {
+        const double relativeStart = std::clamp((phrase.startSec - audioStartOffset) / effectiveLength, 0.0, 1.0);
+        const double relativeEnd = std::clamp((phrase.endSec - audioStartOffset) / effectiveLength, 0.0, 1.0);
+        const int x0 = (int)(relativeStart * width());
+        const int x1 = (int)(relativeEnd * width());
+        if (x1 <= x0) continue;
+        QColor color = QColor::fromRgb((QRgb) TrackStructure::getSectionColor(phrase.section));
+        color.setAlpha(190);
+        // A dark gap at each phrase start keeps neighbours of the same kind apart
+        p.fillRect(x0 + 1, height() - stripHeight, x1 - x0 - 1, stripHeight, color);
+    }
+}
+
 // NEW: Draw ghost loop region as very transparent box for last used loop
 void DeckWaveformOverview::drawGhostLoopRegion() {
     if (!ghostLoopEnabled) return;
@@ -6,6 +6,8 @@
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLShaderProgram>
 #include <QImage>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <QString>
 #include <QMouseEvent>
@@ -13,7 +15,10 @@
 #include <QDropEvent>
 #include <QMimeData>
 #include <JuceHeader.h>
+#include "FrameTimeHud.h"
+#include "GlResources.h"
 #include "GlobalBeatGrid.h"
+#include "TrackStructure.h"
 
 // Compact per-deck waveform overview rendered with OpenGL (upper half fill)
 class DeckWaveformOverview : public QOpenGLWidget, protected QOpenGLFunctions
@@ -38,14 +43,19 @@ public:
     
     // NEW: Ghost loop visualization support
     void setGhostLoopRegion(bool enabled, double startSec = 0.0, double endSec = 0.0);
+    // Phrases from the analysis, as a section strip along the bottom
+    void setStructure(const TrackStructure& trackStructure) { structure = trackStructure; update(); }
     // Visual latency compensation in seconds (UI leads audio by this amount)
     void setVisualLatencyComp(double seconds) { visualLatencyComp = std::clamp(seconds, -0.25, 0.25); }
-    // New: set precomputed waveform data from a background thread result (called on UI thread)
-    void setWaveformData(const std::vector<float>& data, double audioStartOffsetSec, double lengthSec) {
-        waveform = data;
+    // New: set precomputed waveform data from a background thread result (called on UI thread).
+    // The peaks (WaveformGenerator::Result::maxBins, x127) are shared with the producer, not copied.
+    void setWaveformData(std::shared_ptr<const std::vector<std::int8_t>> data, double audioStartOffsetSec, double lengthSec) {
+        waveform = std::move(data);
         audioStartOffset = audioStartOffsetSec;
         totalLength = lengthSec;
         meshDirty = true;
+        stripDirty = true;
+        cueLinesDirty = true;
         update();
     }
 
@@ -70,20 +80,33 @@ protected:
 
 private:
     // GPU resources
-    QOpenGLShaderProgram* program{nullptr};
-    QOpenGLShaderProgram* lineProgram{nullptr};
-    QOpenGLBuffer vbo{ QOpenGLBuffer::VertexBuffer };
+    std::shared_ptr<QOpenGLShaderProgram> program;
+    std::shared_ptr<QOpenGLShaderProgram> lineProgram;
+    std::shared_ptr<GlResources::Mesh> mesh;   // shared with other views of the same waveform
     QOpenGLVertexArrayObject vao;
+    // Overlay lines: playhead at 0, cue lines after it. Allocated once, updated in place.
+    static constexpr int OverlayVertexCapacity = 2 + 2 * 8;
     QOpenGLBuffer lineVbo{ QOpenGLBuffer::VertexBuffer };
     QOpenGLVertexArrayObject lineVao;
+    FrameTimeHud frameHud{this, "DeckWaveformOverview"};
+    bool cueLinesDirty{true};
+    int cueLineCount{0};
+    std::array<int, 8> cueLineSlots{}; // cue index of each line in the buffer
 
-    // CPU-side waveform samples (0..1 upper-half amplitude per column)
-    std::vector<float> waveform;
+    // CPU-side waveform peaks (quantised upper-half amplitude per column, WaveformCache::amplitude()).
+    // The mesh is uploaded once per waveform (static draw, shared through GlResources) and drawn as-is after that.
+    std::shared_ptr<const std::vector<std::int8_t>> waveform;
     bool meshDirty{true};
     int vertexCount{0}; // number of vertices in VBO
     float amplitudeScale{1.2f}; // Increased for better visibility
 
-    juce::AudioFormatManager formatManager;
+    // Software path (GlResources::gpuWaveforms() false, or no shaders): the whole strip is
+    // rasterized once per waveform and size (WaveformRaster) and a frame only blits it
+    QPixmap softwareStrip;
+    bool stripDirty{true};
+    void drawSoftwareStrip();
+    void drawOverlayLinesSoftware();
+
     QString currentFilePath;
     double playheadPos{-1.0};
     double visualLatencyComp{0.0};
@@ -110,15 +133,20 @@ private:
     double ghostLoopStartSec{0.0};
     double ghostLoopEndSec{0.0};
 
+    TrackStructure structure;
+
     void loadAndRenderWaveform();
     void rebuildMeshIfNeeded();
     void drawCuePoints(); // NEW: Draw cue points as lines
     void drawLoopRegion(); // NEW: Draw loop region
     void drawGhostLoopRegion(); // NEW: Draw ghost loop region
-    void uploadMesh();
-    void drawPlayhead();
-    // Smooth display of playhead to avoid janky movement
-    QTimer* smoothTimer{nullptr};
+    void drawPhrases();
+    void updateCueLines();
+    void drawOverlayLines();
+    // Smooth display of playhead to avoid janky movement (stepped by FrameClock)
     double displayedPlayheadPos{ -1.0 };
+    // Column the playhead was last painted at; the timer repaints only when it changes
+    int paintedPlayheadX{ -1 };
+    int playheadColumn() const;
     bool isDragging{false};
 };
@@ -0,0 +1,115 @@
+#include "DecoderRegistry.h"
+#include <iostream>
+
+namespace {
+    struct PooledEntry {
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::String path;
+        juce::int64 modifiedMs{0};
+        juce::int64 size{0};
+    };
+    // Readers handed back on this thread, most recently used last; closed when the thread ends
+    thread_local std::vector<PooledEntry> threadPool;
+}
+
+DecoderRegistry& DecoderRegistry::getInstance()
+{
+    static DecoderRegistry instance;
+    return instance;
+}
+
+void DecoderRegistry::addFastSeekFormat(FormatFactory factory)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (built) {
+        std::cout << "DecoderRegistry: formats already registered, fast-seek format ignored" << std::endl;
+        return;
+    }
+    fastSeekFormats.push_back(std::move(factory));
+}
+
+void DecoderRegistry::useIndexedMp3(const juce::File& indexDirectory, IndexedMp3Format::Backend backend)
+{
+    if (!indexDirectory.isDirectory() && !indexDirectory.createDirectory()) {
+        std::cout << "DecoderRegistry: cannot create " << indexDirectory.getFullPathName() << std::endl;
+    }
+    addFastSeekFormat([indexDirectory, backend]() -> std::unique_ptr<juce::AudioFormat> {
+        return std::make_unique<IndexedMp3Format>(indexDirectory, backend);
+    });
+}
+
+juce::AudioFormatManager& DecoderRegistry::getFormatManager()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!built) {
+        manager = std::make_unique<juce::AudioFormatManager>();
+        // First match wins when opening a file
+        for (auto& factory : fastSeekFormats)
+            if (auto format = factory()) manager->registerFormat(format.release(), false);
+        manager->registerBasicFormats();
+        built = true;
+
+        std::cout << "DecoderRegistry: " << manager->getNumKnownFormats() << " formats" << std::endl;
+        for (int i = 0; i < manager->getNumKnownFormats(); ++i) {
+            auto* format = manager->getKnownFormat(i);
+            std::cout << "Supported format: " << format->getFormatName().toStdString()
+                      << " (" << format->getFileExtensions().joinIntoString(", ").toStdString() << ")" << std::endl;
+        }
+    }
+    return *manager;
+}
+
+void DecoderRegistry::shutdown()
+{
+    threadPool.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    manager.reset();
+    built = false;
+}
+
+DecoderRegistry::PooledReader DecoderRegistry::acquireReader(const juce::File& file)
+{
+    PooledReader lease;
+    lease.path = file.getFullPathName();
+    lease.modifiedMs = file.getLastModificationTime().toMilliseconds();
+    lease.size = file.getSize();
+
+    auto& readers = threadPool;
+    for (auto it = readers.begin(); it != readers.end(); ++it) {
+        if (it->path != lease.path) continue;
+        if (it->modifiedMs == lease.modifiedMs && it->size == lease.size) {
+            lease.reader = std::move(it->reader);
+            readers.erase(it);
+            return lease;
+        }
+        // Changed on disk since: the old reader goes
+        readers.erase(it);
+        break;
+    }
+    lease.reader.reset(getFormatManager().createReaderFor(file));
+    return lease;
+}
+
+void DecoderRegistry::giveBack(PooledReader& lease)
+{
+    auto& readers = threadPool;
+    readers.push_back({ std::move(lease.reader), lease.path, lease.modifiedMs, lease.size });
+    if ((int) readers.size() > ReadersPerThread) readers.erase(readers.begin());
+}
+
+DecoderRegistry::PooledReader& DecoderRegistry::PooledReader::operator=(PooledReader&& other) noexcept
+{
+    if (this != &other) {
+        if (reader) giveBack(*this);
+        reader = std::move(other.reader);
+        path = std::move(other.path);
+        modifiedMs = other.modifiedMs;
+        size = other.size;
+    }
+    return *this;
+}
+
+DecoderRegistry::PooledReader::~PooledReader()
+{
+    if (reader) giveBack(*this);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "IndexedMp3Format.h"
+
+/**
+ * The one juce::AudioFormatManager of the app, shared by the decks, the analysis passes, the
+ * waveform generator, offline renders and replays.
+ *
+ * Formats are registered once, on the first getFormatManager(): the fast-seek backends added
+ * at startup (IndexedMp3Format for MP3 through useIndexedMp3) ahead of JUCE's basic formats, so
+ * they win for their extensions. After that the manager is only read, which any thread may do
+ * at once; hooks added later are refused.
+ *
+ * Passes that open the same track again on the same worker (waveform, then beat grid, then a
+ * re-analysis) take their reader from acquireReader(): each thread keeps its last few readers,
+ * and a lease for a file that hasn't changed on disk gets one of those back instead of a new
+ * one, so the decoder isn't set up and the MP3 index isn't read again. Readers that stay with
+ * their owner (deck sources) are opened through the manager as before.
+ */
+class DecoderRegistry {
+public:
+    static constexpr int ReadersPerThread = 2;
+
+    using FormatFactory = std::function<std::unique_ptr<juce::AudioFormat>()>;
+
+    // A reader on loan from the calling thread's pool; goes back to it when destroyed
+    class PooledReader {
+    public:
+        PooledReader() = default;
+        PooledReader(PooledReader&&) noexcept = default;
+        PooledReader& operator=(PooledReader&& other) noexcept;
+        ~PooledReader();
+
+        juce::AudioFormatReader* get() const noexcept { return reader.get(); }
+        juce::AudioFormatReader* operator->() const noexcept { return reader.get(); }
+        juce::AudioFormatReader& operator*() const noexcept { return *reader; }
+        explicit operator bool() const noexcept { return reader != nullptr; }
+
+    private:
+        friend class DecoderRegistry;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::String path;
+        juce::int64 modifiedMs{0};
+        juce::int64 size{0};
+    };
+
+    static DecoderRegistry& getInstance();
+
+    // Startup, before the first getFormatManager()
+    void addFastSeekFormat(FormatFactory factory);
+    void useIndexedMp3(const juce::File& indexDirectory, IndexedMp3Format::Backend backend);
+
+    // Any thread; registers the formats on the first call
+    juce::AudioFormatManager& getFormatManager();
+    // The calling thread's unused reader for this file if it hasn't changed, else a new one;
+    // empty if no format opens it
+    PooledReader acquireReader(const juce::File& file);
+
+    // End of main(), once nothing decodes any more: the formats go before static destruction,
+    // where JUCE's leak checks would report them
+    void shutdown();
+
+private:
+    DecoderRegistry() = default;
+    static void giveBack(PooledReader& lease);
+
+    std::mutex mutex;
+    std::vector<FormatFactory> fastSeekFormats;
+    std::unique_ptr<juce::AudioFormatManager> manager;
+    bool built{false};
+};
@@ -0,0 +1,70 @@
+#include "DirectoryListingCache.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+
+DirectoryListingCache::DirectoryListingCache(const QStringList& nameFilters, QObject* parent)
+    : QObject(parent), nameFilters(nameFilters)
+{
+    // Two, so a folder on a slow share doesn't hold up one on a local disk
+    pool.setMaxThreadCount(2);
+    pool.setExpiryTimeout(30000);
+}
+
+DirectoryListingCache::~DirectoryListingCache()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+bool DirectoryListingCache::find(const QString& directory, QStringList& files) const
+{
+    QMutexLocker locker(&lock);
+    const auto it = listings.constFind(directory);
+    if (it == listings.constEnd()) return false;
+    files = it->files;
+    return true;
+}
+
+void DirectoryListingCache::request(const QString& directory)
+{
+    {
+        QMutexLocker locker(&lock);
+        auto it = listings.find(directory);
+        if (it != listings.end()) it->lastUsed = ++clock;
+    }
+    pool.start([this, directory]() { list(directory); });
+}
+
+void DirectoryListingCache::list(const QString& directory)
+{
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+    const QFileInfo info(directory);
+    const qint64 modifiedMs = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+    {
+        QMutexLocker locker(&lock);
+        const auto it = listings.constFind(directory);
+        if (it != listings.constEnd() && it->modifiedMs == modifiedMs) return;
+    }
+
+    QStringList files;
+    if (modifiedMs >= 0) {
+        const QDir dir(directory);
+        for (const QFileInfo& entry : dir.entryInfoList(nameFilters, QDir::Files)) files.append(entry.absoluteFilePath());
+    }
+
+    {
+        QMutexLocker locker(&lock);
+        listings.insert(directory, { modifiedMs, files, ++clock });
+        while (listings.size() > MaxDirectories) {
+            const auto oldest = std::min_element(listings.begin(), listings.end(),
+                [](const Listing& a, const Listing& b) { return a.lastUsed < b.lastUsed; });
+            listings.erase(oldest);
+        }
+    }
+    QMetaObject::invokeMethod(this, [this, directory, files, modifiedMs]() { emit listed(directory, files, modifiedMs); },
+                              Qt::QueuedConnection);
+}
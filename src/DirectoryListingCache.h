@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+/**
+ * Audio files directly inside a directory, for the library's folder browser. Listing a folder
+ * on a network share can take seconds, so it never happens on the GUI thread: request() lists
+ * on a pool thread and listed() brings the files back.
+ *
+ * Listings are kept by directory together with the directory's modification time, which moves
+ * whenever an entry is added, removed or renamed. A folder visited before is shown from here at
+ * once (find()); its request() then only stats the directory and lists it again if it changed.
+ * At most MaxDirectories listings are kept, the least recently requested dropped first.
+ *
+ * GUI thread only, apart from the workers.
+ */
+class DirectoryListingCache : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int MaxDirectories = 256;
+
+    DirectoryListingCache(const QStringList& nameFilters, QObject* parent = nullptr);
+    ~DirectoryListingCache() override;
+
+    // The listing from the last visit; it may be stale until request() has checked it
+    bool find(const QString& directory, QStringList& files) const;
+    void request(const QString& directory);
+
+signals:
+    // A new or changed listing and the directory's modification time; a directory that is
+    // gone lists as empty, at -1
+    void listed(const QString& directory, const QStringList& files, qint64 modifiedMs);
+
+private:
+    struct Listing {
+        qint64 modifiedMs{0};
+        QStringList files;
+        quint64 lastUsed{0};
+    };
+
+    void list(const QString& directory);
+
+    const QStringList nameFilters;
+    QThreadPool pool;
+    mutable QMutex lock;   // listings and clock: the GUI thread against the workers
+    QHash<QString, Listing> listings;
+    quint64 clock{0};
+};
@@ -0,0 +1,504 @@
+#include "DirectoryScanner.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #if __has_include(<linux/io_uring.h>)
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #if defined(STATX_SIZE) && defined(__NR_io_uring_setup)
+   #define DIRECTORY_SCANNER_IO_URING 1
+  #endif
+ #endif
+#elif defined(__APPLE__)
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <sys/attr.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#else
+ #include <chrono>
+ #include <filesystem>
+#endif
+
+#ifndef DIRECTORY_SCANNER_IO_URING
+ #define DIRECTORY_SCANNER_IO_URING 0
+#endif
+
+namespace {
+    using Batch = DirectoryScanner::Batch;
+
+    bool hasExtension(const char* name, const std::vector<std::string>& extensions)
+    {
+        const char* dot = std::strrchr(name, '.');
+        if (dot == nullptr || dot == name) return false;
+        const size_t length = std::strlen(dot);
+        return std::any_of(extensions.begin(), extensions.end(), [&](const std::string& extension) {
+            if (extension.size() != length) return false;
+            for (size_t i = 0; i < length; ++i)
+                if (std::tolower((unsigned char) dot[i]) != std::tolower((unsigned char) extension[i])) return false;
+            return true;
+        });
+    }
+
+    std::string childPath(const std::string& directory, const char* name)
+    {
+        std::string path = directory;
+        if (path.empty() || path.back() != '/') path += '/';
+        return path + name;
+    }
+
+#if defined(__linux__) || defined(__APPLE__)
+    int64_t toMs(const struct timespec& time) { return (int64_t) time.tv_sec * 1000 + time.tv_nsec / 1000000; }
+
+    // A link to a file found in the listing: the file it points to
+    bool statFollowing(int dirFd, const char* name, int64_t& size, int64_t& modifiedMs)
+    {
+        struct stat st;
+        if (fstatat(dirFd, name, &st, 0) != 0 || !S_ISREG(st.st_mode)) return false;
+        size = (int64_t) st.st_size;
+ #if defined(__APPLE__)
+        modifiedMs = toMs(st.st_mtimespec);
+ #else
+        modifiedMs = toMs(st.st_mtim);
+ #endif
+        return true;
+    }
+#endif
+
+#if defined(__linux__)
+    // One entry of a directory listing to stat relative to the directory
+    struct StatRequest {
+        const char* name;
+        int flags;          // AT_SYMLINK_NOFOLLOW or 0
+        bool done{false};
+        int error{0};
+        mode_t mode{0};
+        int64_t size{0};
+        int64_t modifiedMs{0};
+    };
+
+    void statSync(int dirFd, StatRequest& request)
+    {
+        struct stat st;
+        if (fstatat(dirFd, request.name, &st, request.flags) != 0) {
+            request.error = errno;
+        } else {
+            request.mode = st.st_mode;
+            request.size = (int64_t) st.st_size;
+            request.modifiedMs = toMs(st.st_mtim);
+        }
+        request.done = true;
+    }
+
+ #if DIRECTORY_SCANNER_IO_URING
+    // Set once a kernel turned the ring or its STATX down; every thread stats one by one then
+    std::atomic<bool> ringUnavailable{false};
+
+    // A minimal io_uring for IORING_OP_STATX only, one per scanning thread
+    class StatRing {
+    public:
+        static constexpr unsigned Entries = 256;
+
+        ~StatRing()
+        {
+            if (sqRing != MAP_FAILED) munmap(sqRing, sqRingBytes);
+            if (cqRing != MAP_FAILED) munmap(cqRing, cqRingBytes);
+            if (sqes != MAP_FAILED) munmap(sqes, sqesBytes);
+            if (fd >= 0) close(fd);
+        }
+
+        bool open()
+        {
+            if (ringUnavailable.load(std::memory_order_relaxed)) return false;
+            if (fd >= 0) return true;
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = (int) syscall(__NR_io_uring_setup, Entries, &params);
+            if (fd < 0) {
+                ringUnavailable.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+            sqRing = mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            cqRing = mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            sqes = mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+                ringUnavailable.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            auto* sq = static_cast<char*>(sqRing);
+            auto* cq = static_cast<char*>(cqRing);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            capacity = params.sq_entries;
+            return true;
+        }
+
+        // Stats every request, Entries at a time; what the ring couldn't do is left !done
+        void statAll(int dirFd, std::vector<StatRequest>& requests)
+        {
+            buffers.resize(std::min<size_t>(requests.size(), capacity));
+            for (size_t first = 0; first < requests.size(); first += capacity) {
+                const unsigned count = (unsigned) std::min<size_t>(capacity, requests.size() - first);
+                if (!submit(dirFd, requests, first, count)) return;
+            }
+        }
+
+    private:
+        bool submit(int dirFd, std::vector<StatRequest>& requests, size_t first, unsigned count)
+        {
+            unsigned tail = *sqTail;
+            for (unsigned i = 0; i < count; ++i, ++tail) {
+                const unsigned index = tail & sqMask;
+                io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes)[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_STATX;
+                sqe.fd = dirFd;
+                sqe.addr = (unsigned long long) (uintptr_t) requests[first + i].name;
+                sqe.len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+                sqe.off = (unsigned long long) (uintptr_t) &buffers[i];
+                sqe.statx_flags = (unsigned) requests[first + i].flags;
+                sqe.user_data = i;
+                sqArray[index] = index;
+            }
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+            // Submit all and wait for all; an interrupted wait just waits again
+            int submitted = -1;
+            do submitted = (int) syscall(__NR_io_uring_enter, fd, count, count, IORING_ENTER_GETEVENTS, nullptr, 0);
+            while (submitted < 0 && errno == EINTR);
+            if (submitted <= 0) {
+                ringUnavailable.store(true, std::memory_order_relaxed);
+                return false;
+            }
+
+            unsigned reaped = 0, unsupported = 0;
+            while (reaped < (unsigned) submitted) {
+                unsigned head = *cqHead;
+                const unsigned available = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                for (; head != available; ++head, ++reaped) {
+                    const io_uring_cqe& cqe = cqes[head & cqMask];
+                    StatRequest& request = requests[first + (size_t) cqe.user_data];
+                    const struct statx& result = buffers[(size_t) cqe.user_data];
+                    if (cqe.res == -EINVAL) {
+                        ++unsupported;   // no IORING_OP_STATX before Linux 5.6: left to statSync
+                        continue;
+                    }
+                    request.done = true;
+                    if (cqe.res < 0) {
+                        request.error = -cqe.res;
+                        continue;
+                    }
+                    request.mode = result.stx_mode;
+                    request.size = (int64_t) result.stx_size;
+                    request.modifiedMs = (int64_t) result.stx_mtime.tv_sec * 1000 + result.stx_mtime.tv_nsec / 1000000;
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+                if (reaped < (unsigned) submitted) {
+                    int waited = -1;
+                    do waited = (int) syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    while (waited < 0 && errno == EINTR);
+                }
+            }
+            if (unsupported == (unsigned) submitted || submitted < (int) count) {
+                ringUnavailable.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+        int fd{-1};
+        void* sqRing{MAP_FAILED};
+        void* cqRing{MAP_FAILED};
+        void* sqes{MAP_FAILED};
+        size_t sqRingBytes{0}, cqRingBytes{0}, sqesBytes{0};
+        unsigned* sqTail{nullptr};
+        unsigned sqMask{0};
+        unsigned* sqArray{nullptr};
+        unsigned* cqHead{nullptr};
+        unsigned* cqTail{nullptr};
+        unsigned cqMask{0};
+        io_uring_cqe* cqes{nullptr};
+        unsigned capacity{0};
+        std::vector<struct statx> buffers;
+    };
+ #endif
+
+    void statBatch(int dirFd, std::vector<StatRequest>& requests)
+    {
+ #if DIRECTORY_SCANNER_IO_URING
+        static thread_local StatRing ring;
+        if (requests.size() > 1 && ring.open()) ring.statAll(dirFd, requests);
+ #endif
+        for (auto& request : requests)
+            if (!request.done) statSync(dirFd, request);
+    }
+
+    void listDirectory(const std::string& path, const DirectoryScanner::Options& options, Batch& batch,
+                       std::vector<std::string>& subdirectories)
+    {
+        const int dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) return;
+        DIR* dir = fdopendir(dirFd);
+        if (dir == nullptr) {
+            close(dirFd);
+            return;
+        }
+
+        // The names stay valid until closedir; d_type spares the stat of most entries' type
+        std::vector<std::string> names;
+        std::vector<StatRequest> requests;
+        while (const dirent* entry = readdir(dir)) {
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+            const bool audio = hasExtension(name, options.extensions);
+            const bool wanted = (entry->d_type == DT_DIR && options.recursive)
+                                || ((entry->d_type == DT_REG || entry->d_type == DT_LNK) && audio)
+                                || (entry->d_type == DT_UNKNOWN && (audio || options.recursive));
+            if (!wanted) continue;
+            names.emplace_back(name);
+            // Links are followed for files only; whatever they point to decides below
+            requests.push_back({ nullptr, entry->d_type == DT_LNK ? 0 : AT_SYMLINK_NOFOLLOW });
+        }
+        for (size_t i = 0; i < names.size(); ++i) requests[i].name = names[i].c_str();
+        statBatch(dirFd, requests);
+
+        for (const auto& request : requests) {
+            if (request.error != 0) continue;
+            if (S_ISDIR(request.mode) && request.flags != 0) {
+                if (!options.recursive) continue;
+                auto child = childPath(path, request.name);
+                batch.directories.push_back({ child, request.modifiedMs });
+                subdirectories.push_back(std::move(child));
+            } else if (hasExtension(request.name, options.extensions)) {
+                DirectoryScanner::File file{ childPath(path, request.name), request.size, request.modifiedMs };
+                if (S_ISREG(request.mode) || (S_ISLNK(request.mode) && statFollowing(dirFd, request.name, file.size, file.modifiedMs)))
+                    batch.files.push_back(std::move(file));
+            }
+        }
+        closedir(dir);
+    }
+
+    bool statDirectory(const std::string& path, int64_t& modifiedMs)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+        modifiedMs = toMs(st.st_mtim);
+        return true;
+    }
+
+#elif defined(__APPLE__)
+    void listDirectory(const std::string& path, const DirectoryScanner::Options& options, Batch& batch,
+                       std::vector<std::string>& subdirectories)
+    {
+        const int dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) return;
+
+        attrlist request;
+        std::memset(&request, 0, sizeof(request));
+        request.bitmapcount = ATTR_BIT_MAP_COUNT;
+        request.commonattr = ATTR_CMN_RETURNED_ATTRS | ATTR_CMN_NAME | ATTR_CMN_ERROR | ATTR_CMN_OBJTYPE | ATTR_CMN_MODTIME;
+        request.fileattr = ATTR_FILE_DATALENGTH;
+
+        // Each call fills the buffer with as many entries as fit; 0 at the end of the directory
+        std::vector<char> buffer(256 * 1024);
+        for (;;) {
+            const int count = getattrlistbulk(dirFd, &request, buffer.data(), buffer.size(), 0);
+            if (count <= 0) break;
+            const char* entry = buffer.data();
+            for (int i = 0; i < count; ++i) {
+                // length, returned attributes, then each returned attribute in bit order
+                uint32_t length;
+                std::memcpy(&length, entry, sizeof(length));
+                const char* field = entry + sizeof(uint32_t);
+                attribute_set_t returned;
+                std::memcpy(&returned, field, sizeof(returned));
+                field += sizeof(attribute_set_t);
+                const char* next = entry + length;
+                entry = next;
+
+                if (returned.commonattr & ATTR_CMN_ERROR) {
+                    uint32_t error;
+                    std::memcpy(&error, field, sizeof(error));
+                    field += sizeof(uint32_t);
+                    if (error != 0) continue;
+                }
+                if (!(returned.commonattr & ATTR_CMN_NAME)) continue;
+                attrreference_t nameRef;
+                std::memcpy(&nameRef, field, sizeof(nameRef));
+                const char* name = field + nameRef.attr_dataoffset;
+                field += sizeof(attrreference_t);
+                fsobj_type_t type = VNON;
+                if (returned.commonattr & ATTR_CMN_OBJTYPE) {
+                    std::memcpy(&type, field, sizeof(type));
+                    field += sizeof(fsobj_type_t);
+                }
+                int64_t modifiedMs = 0;
+                if (returned.commonattr & ATTR_CMN_MODTIME) {
+                    struct timespec modified;
+                    std::memcpy(&modified, field, sizeof(modified));
+                    modifiedMs = toMs(modified);
+                    field += sizeof(struct timespec);
+                }
+                off_t size = 0;
+                if (returned.fileattr & ATTR_FILE_DATALENGTH) std::memcpy(&size, field, sizeof(size));
+
+                if (type == VDIR) {
+                    if (!options.recursive) continue;
+                    auto child = childPath(path, name);
+                    batch.directories.push_back({ child, modifiedMs });
+                    subdirectories.push_back(std::move(child));
+                } else if ((type == VREG || type == VLNK) && hasExtension(name, options.extensions)) {
+                    DirectoryScanner::File file{ childPath(path, name), (int64_t) size, modifiedMs };
+                    if (type == VREG || statFollowing(dirFd, name, file.size, file.modifiedMs))
+                        batch.files.push_back(std::move(file));
+                }
+            }
+        }
+        close(dirFd);
+    }
+
+    bool statDirectory(const std::string& path, int64_t& modifiedMs)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+        modifiedMs = toMs(st.st_mtimespec);
+        return true;
+    }
+
+#else
+    int64_t toMs(std::filesystem::file_time_type time)
+    {
+        // No clock_cast before C++20: both clocks' distance to now
+        using namespace std::chrono;
+        const auto system = time_point_cast<system_clock::duration>(time - std::filesystem::file_time_type::clock::now() + system_clock::now());
+        return (int64_t) duration_cast<milliseconds>(system.time_since_epoch()).count();
+    }
+
+    void listDirectory(const std::string& path, const DirectoryScanner::Options& options, Batch& batch,
+                       std::vector<std::string>& subdirectories)
+    {
+        namespace fs = std::filesystem;
+        std::error_code error;
+        for (fs::directory_iterator it(fs::u8path(path), fs::directory_options::skip_permission_denied, error), end;
+             !error && it != end; it.increment(error)) {
+            const auto& entry = *it;
+            const std::string name = entry.path().filename().u8string();
+            std::error_code ec;
+            if (entry.is_directory(ec) && !entry.is_symlink(ec)) {
+                if (!options.recursive) continue;
+                const auto modified = entry.last_write_time(ec);
+                auto child = childPath(path, name.c_str());
+                batch.directories.push_back({ child, ec ? 0 : toMs(modified) });
+                subdirectories.push_back(std::move(child));
+            } else if (hasExtension(name.c_str(), options.extensions) && entry.is_regular_file(ec)) {
+                const auto size = entry.file_size(ec);
+                if (ec) continue;
+                const auto modified = entry.last_write_time(ec);
+                batch.files.push_back({ childPath(path, name.c_str()), (int64_t) size, ec ? 0 : toMs(modified) });
+            }
+        }
+    }
+
+    bool statDirectory(const std::string& path, int64_t& modifiedMs)
+    {
+        std::error_code error;
+        const auto p = std::filesystem::u8path(path);
+        if (!std::filesystem::is_directory(p, error)) return false;
+        const auto modified = std::filesystem::last_write_time(p, error);
+        modifiedMs = error ? 0 : toMs(modified);
+        return true;
+    }
+#endif
+}
+
+void DirectoryScanner::scan(const std::string& root, const Options& options, const BatchCallback& onBatch)
+{
+    std::string top = root;
+    while (top.size() > 1 && top.back() == '/') top.pop_back();
+    int64_t rootModified = 0;
+    if (!statDirectory(top, rootModified)) return;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::string> pending{ top };
+    int busy = 0;
+    bool stopped = false;
+    std::mutex callbackLock;
+    auto deliver = [&](Batch& batch) {
+        if (batch.files.empty() && batch.directories.empty()) return;
+        std::lock_guard<std::mutex> guard(callbackLock);
+        onBatch(std::move(batch));
+        batch = {};
+    };
+
+    auto work = [&](bool first) {
+        Batch batch;
+        if (first) batch.directories.push_back({ top, rootModified });
+        for (;;) {
+            std::string directory;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopped || !pending.empty() || busy == 0; });
+                if (stopped || pending.empty()) break;   // empty with nobody listing: done
+                // Depth first per thread keeps the open directories few
+                directory = std::move(pending.back());
+                pending.pop_back();
+                ++busy;
+            }
+            std::vector<std::string> subdirectories;
+            const bool stop = options.shouldStop && options.shouldStop();
+            if (!stop) listDirectory(directory, options, batch, subdirectories);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                --busy;
+                if (stop) stopped = true;
+                for (auto& sub : subdirectories) pending.push_back(std::move(sub));
+            }
+            wake.notify_all();
+            if (batch.files.size() >= BatchFiles) deliver(batch);
+        }
+        deliver(batch);
+    };
+
+    const int cores = (int) std::max(1u, std::thread::hardware_concurrency());
+    const int threads = options.recursive ? std::clamp(options.threads > 0 ? options.threads : cores, 1, MaxThreads) : 1;
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; ++i) helpers.emplace_back(work, false);
+    work(true);
+    for (auto& helper : helpers) helper.join();
+}
+
+const char* DirectoryScanner::getBackendName()
+{
+#if defined(__linux__)
+ #if DIRECTORY_SCANNER_IO_URING
+    return ringUnavailable.load(std::memory_order_relaxed) ? "fstatat" : "io_uring";
+ #else
+    return "fstatat";
+ #endif
+#elif defined(__APPLE__)
+    return "getattrlistbulk";
+#else
+    return "std::filesystem";
+#endif
+}
@@ -0,0 +1,209 @@
+#include "EventTrace.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr int MaxThreads = 32;
+    constexpr juce::int64 InstantMark = -1;   // end ticks of an instant event
+
+    // Seqlock slot: odd sequence while the owner rewrites it
+    struct Event {
+        std::atomic<juce::uint64> sequence{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<const char*> category{nullptr};
+        std::atomic<juce::int64> startTicks{0};
+        std::atomic<juce::int64> endTicks{0};
+    };
+
+    enum RingState { Free = 0, Owned, Released };
+
+    struct Ring {
+        std::atomic<int> state{Free};
+        std::atomic<Event*> events{nullptr};           // RingCapacity, allocated on first claim, never freed
+        std::atomic<juce::uint64> head{0};             // next index the owner writes
+        std::atomic<juce::uint64> firstIndex{0};       // events of the current owner start here
+        std::atomic<int> threadId{0};                  // 0 until the claim is complete
+        std::atomic<const char*> label{nullptr};       // attachCurrentThread() name (a literal)
+        std::array<char, 48> juceName{};               // juce::Thread name, written before threadId
+    };
+
+    struct Copied {
+        const char* name;
+        const char* category;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+        int threadId;
+    };
+
+    class Hub {
+    public:
+        Ring* claim(const char* threadName) noexcept
+        {
+            // Finished threads keep their history until every ring has been handed out once
+            for (int pass = 0; pass < 2; ++pass) {
+                for (auto& ring : rings) {
+                    int expected = pass == 0 ? Free : Released;
+                    if (!ring.state.compare_exchange_strong(expected, Owned, std::memory_order_acquire)) continue;
+                    // Hidden from the exporter while it changes hands
+                    ring.threadId.store(0, std::memory_order_relaxed);
+                    if (ring.events.load(std::memory_order_relaxed) == nullptr)
+                        ring.events.store(new Event[(size_t) EventTrace::RingCapacity], std::memory_order_relaxed);
+                    ring.label.store(threadName, std::memory_order_relaxed);
+                    ring.juceName.fill('\0');
+                    if (auto* juceThread = juce::Thread::getCurrentThread())
+                        std::strncpy(ring.juceName.data(), juceThread->getThreadName().toRawUTF8(), ring.juceName.size() - 1);
+                    ring.firstIndex.store(ring.head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    ring.threadId.store(nextThreadId.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_release);
+                    return &ring;
+                }
+            }
+            return nullptr;
+        }
+
+        std::vector<Copied> copyAll(std::vector<std::pair<int, std::string>>& threadNames)
+        {
+            std::vector<Copied> out;
+            for (auto& ring : rings) {
+                const int tid = ring.threadId.load(std::memory_order_acquire);
+                if (tid == 0) continue;
+                const Event* events = ring.events.load(std::memory_order_relaxed);
+                const juce::uint64 head = ring.head.load(std::memory_order_acquire);
+                const juce::uint64 first = std::max(ring.firstIndex.load(std::memory_order_relaxed),
+                                                    head > (juce::uint64) EventTrace::RingCapacity ? head - EventTrace::RingCapacity : 0);
+                // Recycled while being read: its events now belong to another thread
+                if (ring.threadId.load(std::memory_order_acquire) != tid) continue;
+                const char* label = ring.label.load(std::memory_order_relaxed);
+                std::string threadName(label != nullptr ? label : ring.juceName.data());
+                threadNames.emplace_back(tid, threadName.empty() ? "thread " + std::to_string(tid) : threadName);
+
+                for (juce::uint64 i = first; i < head; ++i) {
+                    const Event& e = events[(size_t) (i % EventTrace::RingCapacity)];
+                    const juce::uint64 before = e.sequence.load(std::memory_order_acquire);
+                    Copied c{ e.name.load(std::memory_order_relaxed), e.category.load(std::memory_order_relaxed),
+                              e.startTicks.load(std::memory_order_relaxed), e.endTicks.load(std::memory_order_relaxed), tid };
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    // Overwritten (or being overwritten) since `head` was read
+                    if (before != 2 * i + 2 || e.sequence.load(std::memory_order_relaxed) != before) continue;
+                    out.push_back(c);
+                }
+            }
+            return out;
+        }
+
+        const juce::int64 originTicks{ juce::Time::getHighResolutionTicks() };
+
+    private:
+        std::array<Ring, MaxThreads> rings;
+        std::atomic<int> nextThreadId{0};
+    };
+
+    Hub& hub()
+    {
+        static Hub instance;
+        return instance;
+    }
+
+    struct ThreadRing {
+        Ring* ring{nullptr};
+        bool attached{false};
+        ~ThreadRing()
+        {
+            // Events stay exportable until another thread recycles the ring
+            if (ring != nullptr) ring->state.store(Released, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadRing threadRing;
+
+    Ring* currentRing(const char* threadName = nullptr) noexcept
+    {
+        auto& local = threadRing;
+        if (!local.attached) {
+            local.attached = true;
+            local.ring = hub().claim(threadName);
+        }
+        return local.ring;
+    }
+
+    void record(const char* name, const char* category, juce::int64 startTicks, juce::int64 endTicks) noexcept
+    {
+        Ring* ring = currentRing();
+        if (ring == nullptr) return;
+        const juce::uint64 index = ring->head.load(std::memory_order_relaxed);
+        Event& e = ring->events.load(std::memory_order_relaxed)[(size_t) (index % EventTrace::RingCapacity)];
+        e.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.name.store(name, std::memory_order_relaxed);
+        e.category.store(category, std::memory_order_relaxed);
+        e.startTicks.store(startTicks, std::memory_order_relaxed);
+        e.endTicks.store(endTicks, std::memory_order_relaxed);
+        e.sequence.store(2 * index + 2, std::memory_order_release);
+        ring->head.store(index + 1, std::memory_order_release);
+    }
+
+    juce::String escaped(const char* text)
+    {
+        return juce::String(text != nullptr ? text : "").replace("\\", "\\\\").replace("\"", "\\\"");
+    }
+}
+
+namespace EventTrace {
+
+    void start() { hub(); }
+
+    void attachCurrentThread(const char* threadName) noexcept
+    {
+        Ring* ring = currentRing(threadName);
+        // Attached earlier by an event of its own: the explicit name wins
+        if (ring != nullptr && threadName != nullptr) ring->label.store(threadName, std::memory_order_relaxed);
+    }
+
+    void complete(const char* name, const char* category, juce::int64 startTicks, juce::int64 endTicks) noexcept
+    {
+        record(name, category, startTicks, endTicks);
+    }
+
+    void instant(const char* name, const char* category) noexcept
+    {
+        record(name, category, juce::Time::getHighResolutionTicks(), InstantMark);
+    }
+
+    bool exportChromeJson(const juce::File& file)
+    {
+        std::vector<std::pair<int, std::string>> threadNames;
+        std::vector<Copied> events = hub().copyAll(threadNames);
+        std::sort(events.begin(), events.end(), [](const Copied& a, const Copied& b) { return a.startTicks < b.startTicks; });
+
+        const double usPerTick = 1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        const juce::int64 origin = hub().originTicks;
+        juce::MemoryOutputStream json;
+        json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]() { if (!first) json << ",\n"; first = false; };
+
+        for (const auto& [tid, name] : threadNames) {
+            separator();
+            json << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid
+                 << ",\"args\":{\"name\":\"" << escaped(name.c_str()) << "\"}}";
+        }
+        for (const auto& e : events) {
+            separator();
+            json << "{\"name\":\"" << escaped(e.name) << "\",\"cat\":\"" << escaped(e.category)
+                 << "\",\"pid\":1,\"tid\":" << e.threadId
+                 << ",\"ts\":" << juce::String((e.startTicks - origin) * usPerTick, 3);
+            if (e.endTicks == InstantMark) json << ",\"ph\":\"i\",\"s\":\"t\"}";
+            else json << ",\"ph\":\"X\",\"dur\":" << juce::String((e.endTicks - e.startTicks) * usPerTick, 3) << "}";
+        }
+        json << "\n]}\n";
+
+        file.deleteFile();
+        juce::FileOutputStream out(file);
+        if (!out.openedOk()) return false;
+        out.write(json.getData(), json.getDataSize());
+        out.flush();
+        return out.getStatus().wasOk();
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Timeline of what the engine and the UI spend their time on, for chrome://tracing / Perfetto.
+ *
+ * EVENT_TRACE_SCOPE("name", "category") records one complete event from construction to the
+ * end of the scope; Scope::next() closes the current phase and opens another under the same
+ * scope. Events go into a flight-recorder ring per thread (the newest RingCapacity are kept):
+ * two clock reads and a few relaxed stores, no lock, no allocation after the thread's first
+ * event. Names and categories must be string literals, only their pointers are stored.
+ *
+ * exportChromeJson() copies every ring without stopping the writers (a record being written
+ * meanwhile is skipped) and writes the Trace Event Format, one track per thread. The
+ * Tools > Export Event Trace menu action calls it right after reproducing a slow load.
+ * Building with EVENT_TRACE_ENABLED=0 turns every marker into nothing.
+ */
+namespace EventTrace {
+
+    static constexpr int RingCapacity = 8192;   // events per thread
+
+    // Message thread, at startup: fixes the time origin before any thread records
+    void start();
+
+    // Names the calling thread's track (a string literal; juce::Thread names are picked up on
+    // their own) and claims its ring. Real-time threads call it at their start, where the one
+    // allocation a new ring needs is harmless.
+    void attachCurrentThread(const char* threadName = nullptr) noexcept;
+
+    void complete(const char* name, const char* category, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+    void instant(const char* name, const char* category) noexcept;
+
+    // Any thread; false if the file could not be written
+    bool exportChromeJson(const juce::File& file);
+
+    class Scope {
+    public:
+        Scope(const char* name, const char* category) noexcept
+            : name(name), category(category), startTicks(juce::Time::getHighResolutionTicks()) {}
+        ~Scope() { complete(name, category, startTicks, juce::Time::getHighResolutionTicks()); }
+
+        // Ends the current phase and starts the next one
+        void next(const char* nextName) noexcept
+        {
+            const juce::int64 now = juce::Time::getHighResolutionTicks();
+            complete(name, category, startTicks, now);
+            name = nextName;
+            startTicks = now;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        const char* category;
+        juce::int64 startTicks;
+    };
+}
+
+#ifndef EVENT_TRACE_ENABLED
+ #define EVENT_TRACE_ENABLED 1
+#endif
+
+#if EVENT_TRACE_ENABLED
+ #define EVENT_TRACE_SCOPE(name, category) ::EventTrace::Scope JUCE_JOIN_MACRO(eventTraceScope_, __LINE__)(name, category)
+ #define EVENT_TRACE_PHASES(variable, name, category) ::EventTrace::Scope variable(name, category)
+ #define EVENT_TRACE_NEXT(variable, name) variable.next(name)
+ #define EVENT_TRACE_INSTANT(name, category) ::EventTrace::instant(name, category)
+#else
+ #define EVENT_TRACE_SCOPE(name, category) ((void) 0)
+ #define EVENT_TRACE_PHASES(variable, name, category) ((void) 0)
+ #define EVENT_TRACE_NEXT(variable, name) ((void) 0)
+ #define EVENT_TRACE_INSTANT(name, category) ((void) 0)
+#endif
@@ -0,0 +1,110 @@
+#include "FingerprintIndex.h"
+#include "AudioFingerprint.h"
+#include <algorithm>
+
+namespace {
+    bool isUninformative(std::uint32_t value) { return value == 0 || value == ~0u; }
+}
+
+void FingerprintIndex::add(const juce::String& path, std::vector<std::uint32_t> fingerprint)
+{
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = trackByPath.find(path);
+    if (it != trackByPath.end()) {
+        // Its postings stay behind and are skipped
+        tracks[(size_t) it->second].fingerprint.clear();
+        trackByPath.erase(it);
+    }
+    if (fingerprint.empty()) return;
+
+    const auto track = (std::int32_t) tracks.size();
+    for (int frame = 0; frame < (int) fingerprint.size(); frame += Stride)
+        if (!isUninformative(fingerprint[(size_t) frame]))
+            pending.push_back({ fingerprint[(size_t) frame], track, frame });
+    tracks.push_back({ path, std::move(fingerprint) });
+    trackByPath[path] = track;
+}
+
+void FingerprintIndex::remove(const juce::String& path)
+{
+    add(path, {});
+}
+
+int FingerprintIndex::size() const
+{
+    const std::lock_guard<std::mutex> lock(mutex);
+    return (int) trackByPath.size();
+}
+
+void FingerprintIndex::mergePending() const
+{
+    if (pending.empty()) return;
+    const auto byValue = [](const Posting& a, const Posting& b) { return a.value < b.value; };
+    std::sort(pending.begin(), pending.end(), byValue);
+    const auto middle = postings.insert(postings.end(), pending.begin(), pending.end());
+    std::inplace_merge(postings.begin(), middle, postings.end(), byValue);
+    pending.clear();
+}
+
+std::vector<FingerprintIndex::Match> FingerprintIndex::find(const std::vector<std::uint32_t>& fingerprint,
+                                                            const juce::String& excludePath, int limit) const
+{
+    const std::lock_guard<std::mutex> lock(mutex);
+    mergePending();
+    const auto excluded = trackByPath.find(excludePath);
+    const int excludedTrack = excluded != trackByPath.end() ? excluded->second : -1;
+
+    // (track, offset) -> hits; the query's frame q sits at the posting's frame
+    std::unordered_map<std::uint64_t, int> votes;
+    const auto byValue = [](const Posting& a, const Posting& b) { return a.value < b.value; };
+    for (int q = 0; q < (int) fingerprint.size(); ++q) {
+        const std::uint32_t value = fingerprint[(size_t) q];
+        if (isUninformative(value)) continue;
+        const auto range = std::equal_range(postings.begin(), postings.end(), Posting{ value, 0, 0 }, byValue);
+        if (range.second - range.first > MaxPostingsPerValue) continue;
+        for (auto p = range.first; p != range.second; ++p) {
+            if (p->track == excludedTrack || tracks[(size_t) p->track].fingerprint.empty()) continue;
+            const auto offset = (std::uint32_t) (p->frame - q);
+            ++votes[((std::uint64_t) (std::uint32_t) p->track << 32) | offset];
+        }
+    }
+
+    // The best-supported offset of each track
+    std::unordered_map<int, std::pair<int, int>> candidates;   // track -> (votes, offset)
+    for (const auto& [key, count] : votes) {
+        if (count < MinVotes) continue;
+        auto& best = candidates[(int) (key >> 32)];
+        if (count > best.first) best = { count, (int) (std::int32_t) (key & 0xffffffffu) };
+    }
+
+    std::vector<Match> matches;
+    for (const auto& [track, best] : candidates) {
+        const auto& other = tracks[(size_t) track].fingerprint;
+        double similar = 0.0;
+        int offset = best.second;
+        // The sub-fingerprints' phase may fall between two frames
+        for (int d = -1; d <= 1; ++d) {
+            const double s = similarity(other, fingerprint, best.second + d);
+            if (s > similar) {
+                similar = s;
+                offset = best.second + d;
+            }
+        }
+        if (1.0 - similar <= MaxBitErrorRate)
+            matches.push_back({ tracks[(size_t) track].path, similar, offset * AudioFingerprint::secondsPerFrame() });
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.similarity > b.similarity; });
+    if ((int) matches.size() > limit) matches.resize((size_t) std::max(0, limit));
+    return matches;
+}
+
+double FingerprintIndex::similarity(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b, int offset)
+{
+    const int from = std::max(0, -offset);
+    const int to = std::min((int) b.size(), (int) a.size() - offset);
+    if (to - from < MinOverlap) return 0.0;
+    int errors = 0;
+    for (int j = from; j < to; ++j)
+        errors += juce::countNumberOfBits(a[(size_t) (j + offset)] ^ b[(size_t) j]);
+    return 1.0 - (double) errors / (32.0 * (to - from));
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Inverted index of AudioFingerprint sub-fingerprints over the library, for duplicate
+ * detection: the same recording as MP3, AIFF or a remaster.
+ *
+ * Every Stride-th sub-fingerprint of a track is a posting (value, track, frame) in one array
+ * sorted by value, so a lookup is a binary search per sub-fingerprint of the query,
+ * O(q log n) in the library size n; values more common than MaxPostingsPerValue (stationary
+ * sounds every track shares) are skipped. Hits vote for a track at the frame offset they imply;
+ * a track with MinVotes at one offset is compared bit by bit there, and kept if the bit error
+ * rate over at least MinOverlap frames stays under MaxBitErrorRate (0.35, Haitsma-Kalker).
+ *
+ * Fingerprints stay in memory (2 KB a track) for that check. Thread-safe; additions are merged
+ * into the sorted array by the next find().
+ */
+class FingerprintIndex {
+public:
+    static constexpr int Stride = 4;
+    static constexpr int MaxPostingsPerValue = 256;
+    static constexpr int MinVotes = 3;
+    static constexpr int MinOverlap = 128;        // frames, 6 s
+    static constexpr double MaxBitErrorRate = 0.35;
+
+    struct Match {
+        juce::String path;
+        double similarity{0.0};     // 1 - bit error rate
+        double offsetSeconds{0.0};  // where the query's fingerprint starts in the match's
+    };
+
+    // Replaces what the path had; an empty fingerprint only removes it
+    void add(const juce::String& path, std::vector<std::uint32_t> fingerprint);
+    void remove(const juce::String& path);
+    int size() const;
+
+    // Other tracks holding the same recording, most similar first
+    std::vector<Match> find(const std::vector<std::uint32_t>& fingerprint, const juce::String& excludePath,
+                            int limit = 8) const;
+
+    // Fraction of bits two fingerprints share over their overlap when b starts `offset` frames
+    // into a; 0 if they overlap by fewer than MinOverlap frames
+    static double similarity(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b, int offset);
+
+private:
+    struct Posting {
+        std::uint32_t value;
+        std::int32_t track;
+        std::int32_t frame;
+    };
+    struct Track {
+        juce::String path;
+        std::vector<std::uint32_t> fingerprint;   // empty once removed
+    };
+
+    void mergePending() const;
+
+    mutable std::mutex mutex;
+    std::vector<Track> tracks;                     // by track number; removed ones stay as gaps
+    std::unordered_map<juce::String, int> trackByPath;
+    mutable std::vector<Posting> postings;         // sorted by value
+    mutable std::vector<Posting> pending;
+};
@@ -0,0 +1,404 @@
+#include "FlightRecorder.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+ #include <fcntl.h>
+ #include <io.h>
+ #include <sys/stat.h>
+#else
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+namespace {
+    enum Kind { Empty = 0, Callback, Overrun, Late, DeviceXruns, Control, Event };
+
+    // Seqlock record: 2 * index + 1 while written, 2 * index + 2 once complete. All zero at
+    // start, so the ring lives in .bss and costs no memory until it is written.
+    struct Record {
+        std::atomic<juce::uint64> sequence{0};
+        std::atomic<int> kind{Empty};
+        std::atomic<int> index{0};                 // deck, or the callback's block size
+        std::atomic<const char*> name{nullptr};
+        std::atomic<juce::int64> ticks{0};
+        std::atomic<double> a{0.0};
+        std::atomic<double> b{0.0};
+    };
+
+    Record records[FlightRecorder::Capacity];
+    std::atomic<juce::uint64> head{0};
+
+    const double ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+
+    void write(Kind kind, int index, const char* name, juce::int64 ticks, double a, double b) noexcept
+    {
+        const juce::uint64 i = head.fetch_add(1, std::memory_order_relaxed);
+        auto& r = records[i & (FlightRecorder::Capacity - 1)];
+        r.sequence.store(2 * i + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        r.kind.store(kind, std::memory_order_relaxed);
+        r.index.store(index, std::memory_order_relaxed);
+        r.name.store(name, std::memory_order_relaxed);
+        r.ticks.store(ticks, std::memory_order_relaxed);
+        r.a.store(a, std::memory_order_relaxed);
+        r.b.store(b, std::memory_order_relaxed);
+        r.sequence.store(2 * i + 2, std::memory_order_release);
+    }
+
+    struct Copy {
+        int kind;
+        int index;
+        const char* name;
+        juce::int64 ticks;
+        double a, b;
+    };
+
+    // Record i if it is complete and still the one written as i
+    bool read(juce::uint64 i, Copy& out) noexcept
+    {
+        const auto& r = records[i & (FlightRecorder::Capacity - 1)];
+        const juce::uint64 before = r.sequence.load(std::memory_order_acquire);
+        if (before != 2 * i + 2) return false;
+        out.kind = r.kind.load(std::memory_order_relaxed);
+        out.index = r.index.load(std::memory_order_relaxed);
+        out.name = r.name.load(std::memory_order_relaxed);
+        out.ticks = r.ticks.load(std::memory_order_relaxed);
+        out.a = r.a.load(std::memory_order_relaxed);
+        out.b = r.b.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return r.sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    // Audio thread only
+    juce::int64 lastCallbackTicks{0};
+    juce::int64 recentXruns[FlightRecorder::BurstXruns]{};
+    juce::uint64 xruns{0};
+    std::atomic<bool> burstPending{false};
+
+    void noteXrun(juce::int64 ticks) noexcept
+    {
+        recentXruns[xruns++ % FlightRecorder::BurstXruns] = ticks;
+        // The oldest of the last BurstXruns
+        if (xruns >= (juce::uint64) FlightRecorder::BurstXruns
+            && ticks - recentXruns[xruns % FlightRecorder::BurstXruns] <= (juce::int64) (FlightRecorder::BurstSeconds * ticksPerSecond))
+            burstPending.store(true, std::memory_order_relaxed);
+    }
+
+    // UI thread only
+    int lastDeviceXruns{-1};
+    double lastBurstDumpMs{-1.0e12};
+    std::mutex configLock;
+    juce::File logsDirectory;
+    std::atomic<bool> automatic{false};
+
+    //==========================================================================
+    // Output with nothing a signal handler may not call: a stack buffer, write() and numbers
+    // formatted by hand
+    class Writer {
+    public:
+        explicit Writer(const char* path) noexcept
+        {
+           #if JUCE_WINDOWS
+            fd = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+           #else
+            fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+           #endif
+        }
+
+        ~Writer()
+        {
+            flush();
+           #if JUCE_WINDOWS
+            if (fd >= 0) _close(fd);
+           #else
+            if (fd >= 0) ::close(fd);
+           #endif
+        }
+
+        bool isOpen() const noexcept { return fd >= 0; }
+
+        Writer& text(const char* s) noexcept
+        {
+            while (s != nullptr && *s != '\0') put(*s++);
+            return *this;
+        }
+
+        Writer& integer(juce::int64 v) noexcept
+        {
+            char digits[24];
+            int n = 0;
+            const bool negative = v < 0;
+            juce::uint64 u = negative ? (juce::uint64) 0 - (juce::uint64) v : (juce::uint64) v;
+            do { digits[n++] = (char) ('0' + u % 10); u /= 10; } while (u != 0);
+            if (negative) put('-');
+            while (n > 0) put(digits[--n]);
+            return *this;
+        }
+
+        Writer& fixed(double v, int decimals) noexcept
+        {
+            if (std::isnan(v)) return text("nan");
+            if (std::abs(v) > 9.0e15) return text(v < 0.0 ? "-inf" : "inf");
+            juce::int64 scale = 1;
+            for (int d = 0; d < decimals; ++d) scale *= 10;
+            const juce::int64 scaled = (juce::int64) std::llround(std::abs(v) * (double) scale);
+            if (v < 0.0 && scaled != 0) put('-');
+            integer(scaled / scale);
+            if (decimals > 0) {
+                put('.');
+                juce::int64 fraction = scaled % scale;
+                for (juce::int64 s = scale / 10; s > 0; s /= 10) { put((char) ('0' + fraction / s)); fraction %= s; }
+            }
+            return *this;
+        }
+
+        void flush() noexcept
+        {
+            size_t done = 0;
+            while (fd >= 0 && done < used) {
+               #if JUCE_WINDOWS
+                const int n = _write(fd, buffer + done, (unsigned) (used - done));
+               #else
+                const ssize_t n = ::write(fd, buffer + done, used - done);
+                if (n < 0 && errno == EINTR) continue;
+               #endif
+                if (n <= 0) break;
+                done += (size_t) n;
+            }
+            used = 0;
+        }
+
+    private:
+        void put(char c) noexcept
+        {
+            if (used == sizeof(buffer)) flush();
+            buffer[used++] = c;
+        }
+
+        int fd{-1};
+        char buffer[4096];
+        size_t used{0};
+    };
+
+    // The last DumpSeconds, oldest first, times in seconds before the newest record
+    bool writeDump(const char* path, const char* reason) noexcept
+    {
+        Writer out(path);
+        if (!out.isOpen()) return false;
+
+        const juce::uint64 end = head.load(std::memory_order_acquire);
+        const juce::uint64 begin = end > (juce::uint64) FlightRecorder::Capacity ? end - FlightRecorder::Capacity : 0;
+        juce::int64 newest = 0;
+        Copy c{};
+        for (juce::uint64 i = end; i > begin && newest == 0; --i)
+            if (read(i - 1, c)) newest = c.ticks;
+        const juce::int64 oldest = newest - (juce::int64) (FlightRecorder::DumpSeconds * ticksPerSecond);
+
+        out.text("PulseDJ flight recorder: ").text(reason).text("\n")
+           .text("written at ").integer(juce::Time::currentTimeMillis()).text(" ms since 1970 (UTC)\n")
+           .text("last ").fixed(FlightRecorder::DumpSeconds, 0).text(" s, oldest first; time in seconds before the newest record\n\n");
+
+        juce::int64 callbacks = 0, overruns = 0, late = 0, controls = 0;
+        for (juce::uint64 i = begin; i < end; ++i) {
+            if (!read(i, c) || c.ticks < oldest) continue;
+            out.fixed((double) (c.ticks - newest) / ticksPerSecond, 6).text("  ");
+            switch (c.kind) {
+                case Callback:
+                case Overrun:
+                    ++callbacks;
+                    if (c.kind == Overrun) ++overruns;
+                    out.text(c.kind == Overrun ? "OVERRUN  " : "callback ").integer(c.index).text(" samples ")
+                       .fixed(c.a, 1).text(" us of ").fixed(c.b, 1).text(" us");
+                    break;
+                case Late:
+                    ++late;
+                    out.text("LATE     gap ").fixed(c.a, 1).text(" us, period ").fixed(c.b, 1).text(" us");
+                    break;
+                case DeviceXruns:
+                    out.text("DRIVER   xruns ").fixed(c.a, 0).text(" (+").fixed(c.b, 0).text(")");
+                    break;
+                case Control:
+                    ++controls;
+                    out.text("control  deck ").integer(c.index).text(" ").text(c.name).text(" ")
+                       .fixed(c.a, 4).text(" ").fixed(c.b, 4);
+                    break;
+                case Event:
+                    out.text("event    deck ").integer(c.index).text(" ").text(c.name).text(" ").fixed(c.a, 3);
+                    break;
+                default:
+                    out.text("?");
+                    break;
+            }
+            out.text("\n");
+        }
+        out.text("\n").integer(callbacks).text(" callbacks, ").integer(overruns).text(" overruns, ").integer(late)
+           .text(" late callbacks, ").integer(controls).text(" controls\n");
+        return true;
+    }
+
+    //==========================================================================
+    // Crash dumps: the path is fixed when they are enabled, the handler only formats and writes
+    char crashPath[1024]{};
+    std::atomic<bool> crashing{false};
+
+    void crashDump(const char* reason) noexcept
+    {
+        if (crashing.exchange(true) || crashPath[0] == '\0') return;
+        writeDump(crashPath, reason);
+    }
+
+   #if JUCE_WINDOWS
+    LPTOP_LEVEL_EXCEPTION_FILTER previousFilter = nullptr;
+    bool handlersInstalled = false;
+
+    LONG WINAPI onUnhandledException(EXCEPTION_POINTERS* info)
+    {
+        crashDump("crash: unhandled exception");
+        return previousFilter != nullptr ? previousFilter(info) : EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    void installHandlers(bool install)
+    {
+        if (install == handlersInstalled) return;
+        if (install) previousFilter = SetUnhandledExceptionFilter(onUnhandledException);
+        else SetUnhandledExceptionFilter(previousFilter);
+        handlersInstalled = install;
+    }
+   #else
+    constexpr int FatalSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    struct sigaction previousActions[std::size(FatalSignals)];
+    bool handlersInstalled = false;
+
+    const char* signalReason(int sig) noexcept
+    {
+        switch (sig) {
+            case SIGSEGV: return "crash: SIGSEGV";
+            case SIGBUS: return "crash: SIGBUS";
+            case SIGFPE: return "crash: SIGFPE";
+            case SIGILL: return "crash: SIGILL";
+            case SIGABRT: return "crash: SIGABRT";
+            default: return "crash";
+        }
+    }
+
+    void onFatalSignal(int sig)
+    {
+        crashDump(signalReason(sig));
+        // SA_RESETHAND put the default action back: die the way the signal meant to
+        ::raise(sig);
+    }
+
+    void installHandlers(bool install)
+    {
+        if (install == handlersInstalled) return;
+        for (size_t s = 0; s < std::size(FatalSignals); ++s) {
+            if (install) {
+                struct sigaction action {};
+                action.sa_handler = onFatalSignal;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESETHAND | SA_NODEFER;
+                sigaction(FatalSignals[s], &action, &previousActions[s]);
+            } else {
+                sigaction(FatalSignals[s], &previousActions[s], nullptr);
+            }
+        }
+        handlersInstalled = install;
+    }
+   #endif
+
+    juce::File newDumpFile(const juce::File& directory, const char* prefix)
+    {
+        return directory.getNonexistentChildFile(juce::String(prefix) + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"),
+                                                 ".txt", false);
+    }
+}
+
+void FlightRecorder::configure(const juce::File& directory, bool automaticDumps)
+{
+    std::lock_guard<std::mutex> guard(configLock);
+    logsDirectory = directory;
+    automatic.store(automaticDumps, std::memory_order_relaxed);
+    if (automaticDumps && directory.createDirectory()) {
+        const auto path = newDumpFile(directory, "flight-recorder-crash-").getFullPathName();
+        const auto* utf8 = path.toRawUTF8();
+        const size_t length = std::min(std::strlen(utf8), sizeof(crashPath) - 1);
+        std::memcpy(crashPath, utf8, length);
+        crashPath[length] = '\0';
+    }
+    installHandlers(automaticDumps);
+}
+
+void FlightRecorder::callback(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate) noexcept
+{
+    const double usPerTick = 1.0e6 / ticksPerSecond;
+    const double periodUs = sampleRate > 0.0 ? 1.0e6 * numSamples / sampleRate : 0.0;
+    const double tookUs = (double) (endTicks - startTicks) * usPerTick;
+    if (lastCallbackTicks != 0 && periodUs > 0.0) {
+        const double gapUs = (double) (startTicks - lastCallbackTicks) * usPerTick;
+        if (gapUs > 1.5 * periodUs) {
+            write(Late, numSamples, nullptr, startTicks, gapUs, periodUs);
+            noteXrun(startTicks);
+        }
+    }
+    lastCallbackTicks = startTicks;
+
+    const bool overrun = periodUs > 0.0 && tookUs > periodUs;
+    write(overrun ? Overrun : Callback, numSamples, nullptr, startTicks, tookUs, periodUs);
+    if (overrun) noteXrun(startTicks);
+}
+
+void FlightRecorder::control(int deck, const char* name, double value, double value2) noexcept
+{
+    write(Control, deck, name, juce::Time::getHighResolutionTicks(), value, value2);
+}
+
+void FlightRecorder::event(const char* name, int deck, double value) noexcept
+{
+    write(Event, deck, name, juce::Time::getHighResolutionTicks(), value, 0.0);
+}
+
+void FlightRecorder::poll(int deviceXruns)
+{
+    if (deviceXruns >= 0 && deviceXruns != lastDeviceXruns) {
+        // The first reading of a device is its baseline
+        if (lastDeviceXruns >= 0 && deviceXruns > lastDeviceXruns) {
+            write(DeviceXruns, -1, nullptr, juce::Time::getHighResolutionTicks(), deviceXruns, deviceXruns - lastDeviceXruns);
+            if (deviceXruns - lastDeviceXruns >= BurstXruns) burstPending.store(true, std::memory_order_relaxed);
+        }
+        lastDeviceXruns = deviceXruns;
+    }
+
+    if (!burstPending.exchange(false, std::memory_order_relaxed) || !automatic.load(std::memory_order_relaxed)) return;
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    if (now - lastBurstDumpMs < DumpSeconds * 1000.0) return;
+    lastBurstDumpMs = now;
+    // A few MB of text; the file write stays off the UI thread
+    std::thread([] {
+        const auto file = dump("xrun burst");
+        if (file.existsAsFile())
+            std::cout << "FlightRecorder: xrun burst, wrote " << file.getFullPathName().toStdString() << std::endl;
+    }).detach();
+}
+
+juce::File FlightRecorder::dump(const char* reason)
+{
+    juce::File directory;
+    {
+        std::lock_guard<std::mutex> guard(configLock);
+        directory = logsDirectory;
+    }
+    if (directory == juce::File() || !directory.createDirectory()) return {};
+    const auto file = newDumpFile(directory, "flight-recorder-");
+    if (!writeDump(file.getFullPathName().toRawUTF8(), reason)) return {};
+    return file;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Always-on flight recorder, so a dropout reported from a gig comes with data.
+ *
+ * Every audio callback (start, duration, block size, period), overruns and late callbacks, the
+ * driver's xrun count, the deck and mixer controls and a few engine events (device start and
+ * stop, track loads) go into one fixed ring of Capacity records: an atomic index claim and a
+ * handful of relaxed stores behind a per-record sequence number, no lock and no allocation, so
+ * the audio thread and the controller thread write to it like the UI does. At 48 kHz with
+ * 64-sample blocks the ring holds a little over a minute; dumps cover the last DumpSeconds.
+ *
+ * A dump is a text file in the logs directory (AppConfig::getLogsDirectory()), one record per
+ * line with its time before the newest record. It is written
+ *   - on demand (Tools > Save Flight Recorder),
+ *   - after an xrun burst: BurstXruns overruns or late callbacks within BurstSeconds, at most
+ *     once per DumpSeconds (poll() starts the write off the calling thread),
+ *   - on a crash (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT; an unhandled exception on Windows)
+ *     from the signal handler, with nothing but write() and hand-rolled number formatting.
+ * The last two follow Advanced/CrashReporting (configure()).
+ *
+ * Names passed in must be string literals (or otherwise live forever): only the pointer is kept.
+ */
+namespace FlightRecorder {
+
+    static constexpr int Capacity = 1 << 16;       // records
+    static constexpr double DumpSeconds = 60.0;
+    static constexpr int BurstXruns = 4;
+    static constexpr double BurstSeconds = 2.0;
+
+    // UI thread: where dumps go and whether bursts and crashes write one. Installs or removes
+    // the crash handlers.
+    void configure(const juce::File& logsDirectory, bool automaticDumps);
+
+    // Audio thread, once per callback, in juce::Time high-resolution ticks
+    void callback(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate) noexcept;
+    // Any thread: a control change (deck -1 for the mixer)
+    void control(int deck, const char* name, double value, double value2 = 0.0) noexcept;
+    // Any thread: an engine event
+    void event(const char* name, int deck = -1, double value = 0.0) noexcept;
+
+    // UI thread, about once a second: records a change of the driver's xrun count (-1: the
+    // driver keeps none) and writes the burst dump when one is due
+    void poll(int deviceXruns);
+
+    // Any thread but a signal handler: the last DumpSeconds into a new file in the logs
+    // directory; the file, or a nonexistent one if it couldn't be written
+    juce::File dump(const char* reason);
+}
@@ -0,0 +1,70 @@
+#include "FrameClock.h"
+#include "DeckMixer.h"
+#include <QGuiApplication>
+#include <QOpenGLWidget>
+#include <QScreen>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+FrameClock& FrameClock::instance()
+{
+    // Owned by the application so the timer goes away with the event loop
+    static FrameClock* clock = new FrameClock(QCoreApplication::instance());
+    return *clock;
+}
+
+FrameClock::FrameClock(QObject* parent) : QObject(parent)
+{
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &FrameClock::tick);
+    updateRefreshRate();
+    if (auto* screen = QGuiApplication::primaryScreen())
+        connect(screen, &QScreen::refreshRateChanged, this, [this]() { updateRefreshRate(); });
+    timer.start();
+}
+
+void FrameClock::updateRefreshRate()
+{
+    const QScreen* screen = QGuiApplication::primaryScreen();
+    const double hz = screen && screen->refreshRate() >= 24.0 ? screen->refreshRate() : 60.0;
+    refreshPeriodMs = 1000.0 / hz;
+    updateInterval();
+}
+
+void FrameClock::setRateCap(double hz)
+{
+    rateCapHz = std::max(0.0, hz);
+    updateInterval();
+    std::cout << "FrameClock: " << (rateCapHz > 0.0 ? "capped at " + std::to_string((int) rateCapHz) + " Hz" : std::string("uncapped"))
+              << ", ticking every " << framePeriodMs << " ms" << std::endl;
+}
+
+void FrameClock::updateInterval()
+{
+    framePeriodMs = rateCapHz > 0.0 ? std::max(refreshPeriodMs, 1000.0 / rateCapHz) : refreshPeriodMs;
+    timer.setInterval((int) std::floor(framePeriodMs));
+}
+
+void FrameClock::followSwapsOf(QOpenGLWidget* widget)
+{
+    if (pacerConnection) disconnect(pacerConnection);
+    pacer = widget;
+    if (!widget) return;
+    // A swap marks the start of a refresh interval: restart the period from there
+    pacerConnection = connect(widget, &QOpenGLWidget::frameSwapped, this, [this]() {
+        // Swaps more than two refreshes after the tick were not drawn for it (a resize, a stall)
+        const double delay = (double) (DeckMixer::nowNs() - frameNs);
+        if (frameNs != 0 && delay >= 0.0 && delay < 2.0e6 * refreshPeriodMs)
+            swapDelayNs += 0.1 * (delay - swapDelayNs);
+        timer.start();
+    });
+}
+
+void FrameClock::tick()
+{
+    frameNs = DeckMixer::nowNs();
+    emit advance(frameNs);
+    emit frame(frameNs);
+}
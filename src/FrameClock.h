@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class QOpenGLWidget;
+
+/**
+ * One clock for everything on screen that moves.
+ *
+ * Ticks once per display refresh. Each tick first emits advance() so the transport state
+ * (deck positions) is sampled once, then frame() so every widget animates from that same
+ * snapshot — waveforms, overviews, platters and pads stay in phase instead of running on
+ * their own timers. The tick is re-phased to the buffer swaps of one GL view, so work lands
+ * right after vsync. Widgets only repaint on frame() when their picture actually changed,
+ * which leaves the clock as the single periodic wake-up while nothing plays.
+ *
+ * setRateCap() slows the ticks below the refresh rate (the battery power profile); the
+ * display latency still counts one refresh of scan-out, which the cap doesn't change.
+ */
+class FrameClock : public QObject {
+    Q_OBJECT
+public:
+    static FrameClock& instance();
+
+    // Align ticks to this widget's frameSwapped (the busiest GL view)
+    void followSwapsOf(QOpenGLWidget* widget);
+    // Time base of the current tick, DeckMixer::nowNs()
+    quint64 getFrameNs() const { return frameNs; }
+    // Time between ticks: the refresh period, or longer under a rate cap
+    double getFramePeriodMs() const { return framePeriodMs; }
+    // At most this many ticks per second; 0 lifts the cap
+    void setRateCap(double hz);
+    double getRateCap() const { return rateCapHz; }
+    // From a tick to its picture reaching the screen: the measured tick-to-swap time (smoothed)
+    // plus one refresh of scan-out. Deck positions are sampled for this moment, not the tick.
+    quint64 getDisplayLatencyNs() const { return (quint64) (swapDelayNs + refreshPeriodMs * 1.0e6); }
+    quint64 getPresentationNs() const { return frameNs + getDisplayLatencyNs(); }
+
+signals:
+    void advance(quint64 frameNs);
+    void frame(quint64 frameNs);
+
+private:
+    explicit FrameClock(QObject* parent);
+    void tick();
+    void updateRefreshRate();
+    void updateInterval();
+
+    QTimer timer;
+    QPointer<QOpenGLWidget> pacer;
+    QMetaObject::Connection pacerConnection;
+    quint64 frameNs{0};
+    double refreshPeriodMs{1000.0 / 60.0};
+    double framePeriodMs{1000.0 / 60.0};
+    double rateCapHz{0.0};
+    double swapDelayNs{0.0};
+};
@@ -0,0 +1,156 @@
+#include "FrameTimeHud.h"
+#include "FrameClock.h"
+#include <QOpenGLContext>
+#include <QOpenGLWidget>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#if !QT_CONFIG(opengles2)
+#include <QOpenGLTimerQuery>
+#endif
+
+namespace {
+    bool hudEnabled = false;
+    std::vector<FrameTimeHud*>& liveHuds()
+    {
+        static std::vector<FrameTimeHud*> huds;   // message thread only, like every GL view
+        return huds;
+    }
+}
+
+void FrameTimeHud::setEnabled(bool enabled)
+{
+    hudEnabled = enabled;
+    // Repaint now, so the overlay shows up (or goes away) on views that are idle
+    for (auto* hud : liveHuds()) hud->widget->update();
+}
+
+bool FrameTimeHud::isEnabled()
+{
+    return hudEnabled;
+}
+
+FrameTimeHud::FrameTimeHud(QOpenGLWidget* widget, const char* label) : widget(widget), label(label)
+{
+    clock.start();
+    liveHuds().push_back(this);
+}
+
+FrameTimeHud::~FrameTimeHud()
+{
+    auto& huds = liveHuds();
+    huds.erase(std::remove(huds.begin(), huds.end(), this), huds.end());
+}
+
+void FrameTimeHud::initializeGL()
+{
+    gpuTimingAvailable = false;
+#if !QT_CONFIG(opengles2)
+    gpuTimingAvailable = true;
+    for (auto& query : queries) {
+        query = std::make_unique<QOpenGLTimerQuery>();
+        if (!query->create()) { gpuTimingAvailable = false; break; }
+    }
+    if (!gpuTimingAvailable) releaseGL();
+#endif
+    queryPending.fill(false);
+    queryRunning = false;
+}
+
+void FrameTimeHud::releaseGL()
+{
+    for (auto& query : queries) query.reset();
+    gpuTimingAvailable = false;
+}
+
+FrameTimeHud::Frame::Frame(FrameTimeHud& hud) : hud(hud), active(FrameTimeHud::isEnabled())
+{
+    if (active) hud.begin();
+}
+
+FrameTimeHud::Frame::~Frame()
+{
+    if (active) hud.end();
+}
+
+void FrameTimeHud::begin()
+{
+    const qint64 now = clock.nsecsElapsed();
+    collectGpuResults();
+
+    const double periodNs = FrameClock::instance().getFramePeriodMs() * 1.0e6;
+    if (lastPaintStartNs >= 0 && periodNs > 0.0) {
+        const qint64 gap = now - lastPaintStartNs;
+        if (gap < IdleGapNs && gap > 1.5 * periodNs)
+            droppedFrames += (quint64) std::llround(gap / periodNs) - 1;
+    }
+    lastPaintStartNs = now;
+    paintStartNs = now;
+
+#if !QT_CONFIG(opengles2)
+    // A slot still waiting for its result leaves this frame without a GPU time
+    if (gpuTimingAvailable && !queryPending[(size_t) queryIndex]) {
+        queries[(size_t) queryIndex]->begin();
+        queryRunning = true;
+    }
+#endif
+}
+
+void FrameTimeHud::end()
+{
+#if !QT_CONFIG(opengles2)
+    if (queryRunning) {
+        queries[(size_t) queryIndex]->end();
+        queryPending[(size_t) queryIndex] = true;
+        queryIndex = (queryIndex + 1) % QueryRingSize;
+        queryRunning = false;
+    }
+#endif
+
+    const qint64 now = clock.nsecsElapsed();
+    cpuMs = (now - paintStartNs) / 1.0e6;
+    cpuPeakMs = std::max(cpuPeakMs, cpuMs);
+    ++frames;
+    if (now - windowStartNs >= 1000000000) {
+        shownCpuPeakMs = cpuPeakMs;
+        shownGpuPeakMs = gpuPeakMs;
+        cpuPeakMs = gpuPeakMs = 0.0;
+        windowStartNs = now;
+    }
+    draw();
+}
+
+void FrameTimeHud::collectGpuResults()
+{
+#if !QT_CONFIG(opengles2)
+    if (!gpuTimingAvailable) return;
+    for (int i = 0; i < QueryRingSize; ++i) {
+        // The oldest slot first, so gpuMs ends up with the newest result
+        const size_t slot = (size_t) ((queryIndex + i) % QueryRingSize);
+        if (!queryPending[slot] || !queries[slot]->isResultAvailable()) continue;
+        gpuMs = queries[slot]->waitForResult() / 1.0e6;
+        gpuPeakMs = std::max(gpuPeakMs, gpuMs);
+        queryPending[slot] = false;
+    }
+#endif
+}
+
+void FrameTimeHud::draw()
+{
+    const QString name = widget->objectName().isEmpty() ? QString::fromLatin1(label) : widget->objectName();
+    const QString gpu = gpuMs >= 0.0 ? QString("GPU %1 ms (max %2)").arg(gpuMs, 0, 'f', 2).arg(shownGpuPeakMs, 0, 'f', 2)
+                                     : QString(gpuTimingAvailable ? "GPU --" : "GPU n/a (no timer queries)");
+    const QString text = QString("%1\nCPU %2 ms (max %3)\n%4\ndropped %5 of %6")
+        .arg(name).arg(cpuMs, 0, 'f', 2).arg(shownCpuPeakMs, 0, 'f', 2).arg(gpu).arg(droppedFrames).arg(frames);
+
+    QPainter p(widget);
+    QFont font("Monospace", 8);
+    font.setStyleHint(QFont::TypeWriter);
+    p.setFont(font);
+    const QRect box = p.fontMetrics().boundingRect(QRect(0, 0, 400, 200), Qt::AlignLeft, text).adjusted(-4, -3, 4, 3);
+    const QRect placed = box.translated(widget->width() - box.width() - 6 - box.left(), 6 - box.top());
+    p.fillRect(placed, QColor(0, 0, 0, 170));
+    p.setPen(QColor(120, 255, 140));
+    p.drawText(placed.adjusted(4, 3, -4, -3), Qt::AlignLeft, text);
+}
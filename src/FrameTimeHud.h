@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <array>
+#include <memory>
+
+class QOpenGLWidget;
+class QOpenGLTimerQuery;
+
+/**
+ * Frame-time overlay for one GL view (View > Frame Time HUD).
+ *
+ * A Frame on the stack of paintGL times the paint on the CPU and, where the context has timer
+ * queries (GL 3.3 / ARB_timer_query), on the GPU. Queries are read back a few frames late from
+ * a small ring so the paint never waits on the GPU. A frame counts as dropped when the widget
+ * was animating and the gap to the previous paint is more than one and a half refresh periods
+ * of the FrameClock. When the Frame ends, the view's last CPU / GPU time, the peak over the last
+ * second and the dropped count are drawn in its top right corner.
+ *
+ * Off by default. While off, a Frame costs one flag check and no GL call.
+ */
+class FrameTimeHud {
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    FrameTimeHud(QOpenGLWidget* widget, const char* label);
+    ~FrameTimeHud();
+
+    // initializeGL, and the widget's destructor between makeCurrent() and doneCurrent()
+    void initializeGL();
+    void releaseGL();
+
+    class Frame {
+    public:
+        explicit Frame(FrameTimeHud& hud);
+        ~Frame();
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+    private:
+        FrameTimeHud& hud;
+        bool active;
+    };
+
+private:
+    void begin();
+    void end();
+    void collectGpuResults();
+    void draw();
+
+    static constexpr int QueryRingSize = 4;
+    // Frames further apart than this were not one animation (the view went idle)
+    static constexpr qint64 IdleGapNs = 250000000;
+
+    QOpenGLWidget* widget;
+    const char* label;
+    bool gpuTimingAvailable{false};
+    std::array<std::unique_ptr<QOpenGLTimerQuery>, QueryRingSize> queries;
+    std::array<bool, QueryRingSize> queryPending{};
+    int queryIndex{0};
+    bool queryRunning{false};
+
+    QElapsedTimer clock;
+    qint64 paintStartNs{-1};
+    qint64 lastPaintStartNs{-1};
+    qint64 windowStartNs{0};
+
+    double cpuMs{0.0}, gpuMs{-1.0};        // last frame (GPU: last result read)
+    double cpuPeakMs{0.0}, gpuPeakMs{0.0};  // over the window in progress
+    double shownCpuPeakMs{0.0}, shownGpuPeakMs{0.0};
+    quint64 droppedFrames{0};
+    quint64 frames{0};
+};
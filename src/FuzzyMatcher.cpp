@@ -0,0 +1,83 @@
+#include "FuzzyMatcher.h"
+#include <algorithm>
+
+FuzzyMatcher::FuzzyMatcher(const std::string& query)
+{
+    // Words separated by anything that isn't a letter or digit, as the folded texts are
+    std::string joined, word;
+    auto endWord = [&]() {
+        if (word.empty()) return;
+        words.push_back(compile(word));
+        if (!joined.empty()) joined += ' ';
+        joined += word;
+        word.clear();
+    };
+    for (char c : query) {
+        if (c == ' ') endWord();
+        else word += c;
+    }
+    endWord();
+    if (words.size() > 1) phrase = compile(joined);
+}
+
+int FuzzyMatcher::allowedErrors(int length)
+{
+    return length < 4 ? 0 : length < 8 ? 1 : MaxErrors;
+}
+
+FuzzyMatcher::Pattern FuzzyMatcher::compile(const std::string& text)
+{
+    Pattern pattern;
+    pattern.length = std::min((int) text.size(), MaxPatternLength);
+    pattern.maxErrors = allowedErrors(pattern.length);
+    for (int i = 0; i < pattern.length; ++i)
+        pattern.masks[(unsigned char) text[(size_t) i]] |= std::uint64_t(1) << i;
+    return pattern;
+}
+
+int FuzzyMatcher::score(const char* text, size_t length) const
+{
+    if (words.empty()) return -1;
+    int best = phrase.length > 0 ? distance(phrase, text, length) : -1;
+    if (best == 0) return 0;
+
+    int total = 0;
+    for (const Pattern& word : words) {
+        const int d = distance(word, text, length);
+        if (d < 0 || (total += d) > MaxErrors) return best;
+    }
+    return best < 0 ? total : std::min(best, total);
+}
+
+int FuzzyMatcher::distance(const Pattern& pattern, const char* text, size_t length)
+{
+    // Shift-and: bit i of state[d] is set when pattern[0..i] ends at the current byte with at
+    // most d edits. Bits below d start set (those pattern bytes deleted).
+    const int k = pattern.maxErrors;
+    const std::uint64_t found = std::uint64_t(1) << (pattern.length - 1);
+    std::array<std::uint64_t, MaxErrors + 1> state{};
+    for (int d = 1; d <= k; ++d) state[(size_t) d] = (std::uint64_t(1) << d) - 1;
+
+    int best = -1;
+    for (size_t i = 0; i < length; ++i) {
+        const std::uint64_t mask = pattern.masks[(unsigned char) text[i]];
+        std::uint64_t previous = state[0];   // state[d - 1] before this byte
+        state[0] = ((state[0] << 1) | 1) & mask;
+        for (int d = 1; d <= k; ++d) {
+            const std::uint64_t old = state[(size_t) d];
+            state[(size_t) d] = (((old << 1) | 1) & mask)   // match
+                              | previous                        // extra byte in the text
+                              | ((previous << 1) | 1)           // substitution
+                              | ((state[(size_t) d - 1] << 1) | 1);   // pattern byte missing from the text
+            previous = old;
+        }
+        for (int d = 0; d <= (best < 0 ? k : best - 1); ++d) {
+            if (state[(size_t) d] & found) {
+                best = d;
+                break;
+            }
+        }
+        if (best == 0) break;
+    }
+    return best;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Typo-tolerant search over the library's folded title / artist text (lower-case ASCII, see
+ * LibraryTableModel): bit-parallel approximate substring matching (Wu-Manber bitap). A pattern
+ * of up to MaxPatternLength bytes is one 64-bit state word per allowed error, so a text is
+ * scanned once, a few word operations per byte, however many errors are allowed.
+ *
+ * A query matches if it appears as one phrase within allowedErrors() of its length, or if each
+ * of its words does on its own within theirs, at most MaxErrors edits in all; "daft pnk" finds
+ * "Daft Punk", and so does "punk daft". Queries shorter than four bytes allow no errors.
+ *
+ * Immutable once built; score() may be called from any number of threads.
+ */
+class FuzzyMatcher {
+public:
+    static constexpr int MaxErrors = 2;
+    static constexpr int MaxPatternLength = 64;
+
+    // query: folded like the texts it is matched against
+    explicit FuzzyMatcher(const std::string& query);
+
+    bool isEmpty() const { return words.empty(); }
+
+    // Edits the query needs to appear in text; -1 if it doesn't within the allowance
+    int score(const char* text, size_t length) const;
+
+    // None below 4 bytes, one below 8, MaxErrors from there
+    static int allowedErrors(int length);
+
+private:
+    struct Pattern {
+        std::array<std::uint64_t, 256> masks{};   // bit i: pattern[i] is the byte
+        int length{0};
+        int maxErrors{0};
+    };
+
+    static Pattern compile(const std::string& text);
+    // Fewest edits at which the pattern occurs as a substring of text; -1 past its maxErrors
+    static int distance(const Pattern& pattern, const char* text, size_t length);
+
+    Pattern phrase;
+    std::vector<Pattern> words;
+};
@@ -0,0 +1,181 @@
+#include "GigPrep.h"
+#include "AppConfig.h"
+#include "BpmCache.h"
+#include "DecoderRegistry.h"
+#include "HotTrackCache.h"
+#include "InMemoryTrackReader.h"
+#include "MemoryBudget.h"
+#include "ThreadingPolicy.h"
+#include "TrackAnalysis.h"
+#include "TrackDecodePipeline.h"
+#include "WaveformGenerator.h"
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // A deck's load pass holding the file: wait this long for it before giving up
+    constexpr int BusyRetries = 50;
+    constexpr int BusyRetryMs = 200;
+
+    // Sees every decoded sample; a damaged frame that decodes to garbage shows up as NaN or inf
+    class DecodeCheck : public TrackDecodePipeline::Sink {
+    public:
+        void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override
+        {
+            if (badPosition >= 0) return;
+            for (int ch = 0; ch < block.getNumChannels(); ++ch) {
+                const float* samples = block.getReadPointer(ch);
+                for (int i = 0; i < numSamples; ++i) {
+                    if (!std::isfinite(samples[i])) {
+                        badPosition = position + i;
+                        return;
+                    }
+                }
+            }
+        }
+
+        juce::int64 badPosition{-1};
+    };
+}
+
+GigPrep::GigPrep(QObject* parent) : QObject(parent)
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const int cores = prefs.value("Performance/CpuCores", -1).toInt();
+    pool.setMaxThreadCount(cores > 0 ? cores : std::max(1, QThread::idealThreadCount() - 2));
+    pool.setExpiryTimeout(30000);
+}
+
+GigPrep::~GigPrep()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void GigPrep::prepare(const QString& name, const QStringList& files, double deviceSampleRate)
+{
+    // The previous run's queued tracks return at once, the ones in flight at their next block
+    cancel();
+    pool.waitForDone();
+
+    QStringList unique = files;
+    unique.removeDuplicates();
+    unique.removeAll(QString());
+    const int generation = ++currentGeneration;
+    currentName = name;
+    total = (int) unique.size();
+    done.store(0);
+    prepared.store(0);
+    failed.clear();
+    HotTrackCache::getInstance().unpinAll();
+    if (unique.isEmpty()) {
+        emit finished(name, 0, {}, false);
+        return;
+    }
+
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const bool keepSamples = prefs.value("Performance/PrepareSamplesInRam", false).toBool();
+    std::cout << "GigPrep: preparing " << total << " track(s) of " << name.toStdString()
+              << (keepSamples ? ", samples in RAM" : "") << std::endl;
+    remaining.store(total);
+    for (const QString& file : unique)
+        pool.start([this, file, generation, deviceSampleRate, keepSamples]() {
+            prepareTrack(file, generation, deviceSampleRate, keepSamples);
+        });
+}
+
+void GigPrep::cancel()
+{
+    ++currentGeneration;
+}
+
+void GigPrep::prepareTrack(const QString& path, int generation, double deviceSampleRate, bool keepSamples)
+{
+    if (isStale(generation)) return trackDone(generation, false, {});
+    ThreadingPolicy::getInstance().applyToWorkerThread();
+    const juce::File file(path.toStdString());
+    const QString fileName = QFileInfo(path).fileName();
+    if (!file.existsAsFile()) return trackDone(generation, false, fileName + ": missing");
+
+    // Everything a deck load would otherwise compute, whatever the library analysis leaves out
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    TrackAnalysis::Options options;
+    options.loudness = prefs.value("Decks/AutoGainAdjust", true).toBool();
+    options.fingerprint = false;
+    options.shouldStop = [this, generation] { return isStale(generation); };
+    const BpmCache bpmCache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString()));
+    auto analysis = TrackAnalysis::run(file, bpmCache, options);
+    // A deck is loading it: its pass fills the same caches
+    for (int retry = 0; analysis.status == TrackAnalysis::Status::Busy && retry < BusyRetries && !isStale(generation); ++retry) {
+        QThread::msleep(BusyRetryMs);
+        analysis = TrackAnalysis::run(file, bpmCache, options);
+    }
+    if (isStale(generation)) return trackDone(generation, false, {});
+    if (analysis.status == TrackAnalysis::Status::Failed || analysis.status == TrackAnalysis::Status::Busy)
+        return trackDone(generation, false, fileName + ": analysis failed");
+
+    // The whole file, start to end, as a deck would play it; also warms the page cache
+    auto reader = DecoderRegistry::getInstance().acquireReader(file);
+    if (!reader) return trackDone(generation, false, fileName + ": no decoder opens it");
+    std::unique_ptr<InMemoryTrackReader::Builder> ramStore;
+    if (keepSamples) {
+        auto& budget = MemoryBudget::getInstance();
+        budget.makeRoom(InMemoryTrackReader::bytesNeededFor(*reader, InMemoryTrackReader::SampleFormat::Compressed, deviceSampleRate));
+        ramStore = InMemoryTrackReader::Builder::create(*reader, budget.getAvailableBytes(), deviceSampleRate, true);
+    }
+    DecodeCheck check;
+    TrackDecodePipeline pipeline(*reader);
+    pipeline.setScheduledIo(file, IoScheduler::Priority::Background);
+    pipeline.setStopCondition([this, generation] { return isStale(generation); });
+    pipeline.addSink(&check);
+    pipeline.addSink(ramStore.get());
+    const bool decoded = pipeline.run();
+    if (isStale(generation)) return trackDone(generation, false, {});
+    const double rate = reader->sampleRate > 0.0 ? reader->sampleRate : 44100.0;
+    if (!decoded)
+        return trackDone(generation, false, QString("%1: decode error at %2 s").arg(fileName).arg(pipeline.getSamplesDecoded() / rate, 0, 'f', 1));
+    if (check.badPosition >= 0)
+        return trackDone(generation, false, QString("%1: invalid samples at %2 s").arg(fileName).arg(check.badPosition / rate, 0, 'f', 1));
+
+    // What the deck's load task looks up first, pinned for the set
+    HotTrackCache& hot = HotTrackCache::getInstance();
+    hot.pin(file);
+    WaveformGenerator gen;
+    WaveformGenerator::Result wave;
+    if (gen.loadCached(file, HotTrackCache::OverviewBins, wave))
+        hot.storeWaveform(file, std::make_shared<const WaveformGenerator::Result>(std::move(wave)));
+    auto grid = std::make_shared<BpmCache::Entry>();
+    if (bpmCache.load(file, *grid)) hot.storeBeatGrid(file, grid);
+    if (ramStore) {
+        std::shared_ptr<const InMemoryTrackReader> samples = ramStore->takeReader();
+        if (samples) hot.storeSamples(file, std::move(samples));
+    }
+    trackDone(generation, true, {});
+}
+
+void GigPrep::trackDone(int generation, bool ok, const QString& failure)
+{
+    if (ok) prepared.fetch_add(1);
+    if (!failure.isEmpty()) {
+        QMutexLocker lock(&failedLock);
+        failed.append(failure);
+    }
+    const int finishedTracks = done.fetch_add(1) + 1;
+    if (!isStale(generation)) emit progress(finishedTracks, total);
+    if (remaining.fetch_sub(1) != 1) return;
+
+    QStringList failures;
+    {
+        QMutexLocker lock(&failedLock);
+        failures = failed;
+    }
+    const bool cancelled = isStale(generation);
+    std::cout << "GigPrep: " << prepared.load() << " of " << total << " track(s) prepared and pinned"
+              << (cancelled ? " (cancelled)" : "") << ", " << failures.size() << " failed" << std::endl;
+    emit finished(currentName, prepared.load(), failures, cancelled);
+}
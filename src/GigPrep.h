@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+
+/**
+ * Gig preparation: everything a crate's tracks need for a deck load, done before the set so
+ * every load during it is a warm-cache hit.
+ *
+ * For each track one TrackAnalysis pass fills what the caches still lack (beat grid, key,
+ * loudness when auto gain is on, waveform summary, spectrogram), whatever the library's
+ * background analysis is set to. A second, full decode then checks that the file decodes
+ * cleanly to its end with no non-finite samples; with Performance/PrepareSamplesInRam the same
+ * pass keeps the track compressed in RAM (InMemoryTrackReader), as long as the MemoryBudget
+ * has room. The overview bins, beat grid and samples go into the HotTrackCache and the track
+ * is pinned there, so neither its LRU nor the budget's eviction drop it during the set.
+ *
+ * Performance/CpuCores workers at normal priority: the DJ is waiting for it. A new prepare()
+ * replaces the pinned set; cancel() stops after the tracks in flight and leaves what was
+ * prepared so far pinned.
+ */
+class GigPrep : public QObject {
+    Q_OBJECT
+
+public:
+    explicit GigPrep(QObject* parent = nullptr);
+    ~GigPrep() override;
+
+    // UI thread. deviceSampleRate: the rate RAM samples are stored at (0: the file's)
+    void prepare(const QString& name, const QStringList& files, double deviceSampleRate);
+    void cancel();
+    bool isRunning() const { return remaining.load(std::memory_order_relaxed) > 0; }
+
+signals:
+    // From the worker threads
+    void progress(int done, int total);
+    // failed: "file: reason" per track that didn't analyse or decode cleanly
+    void finished(const QString& name, int prepared, const QStringList& failed, bool cancelled);
+
+private:
+    void prepareTrack(const QString& path, int generation, double deviceSampleRate, bool keepSamples);
+    // The last one to finish reports
+    void trackDone(int generation, bool prepared, const QString& failure);
+    bool isStale(int generation) const { return generation != currentGeneration.load(std::memory_order_relaxed); }
+
+    QThreadPool pool;
+    std::atomic<int> currentGeneration{0};
+    std::atomic<int> remaining{0};
+    std::atomic<int> done{0};
+    std::atomic<int> prepared{0};
+    int total{0};
+    QString currentName;
+    QMutex failedLock;
+    QStringList failed;
+};
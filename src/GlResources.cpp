@@ -0,0 +1,232 @@
+#include "GlResources.h"
+#include "AppConfig.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFunctions>
+#include <QSaveFile>
+#include <QtEndian>
+#include <iostream>
+
+namespace {
+    QOpenGLFunctions* currentFunctions()
+    {
+        QOpenGLContext* context = QOpenGLContext::currentContext();
+        return context ? context->functions() : nullptr;
+    }
+
+    // Shader cache file: magic, binary format, binary
+    constexpr quint32 ProgramCacheMagic = 0x50444a53;   // "PDJS"
+
+    bool programBinariesSupported(QOpenGLContext& context)
+    {
+        const QSurfaceFormat format = context.format();
+        const bool api = context.isOpenGLES() ? format.majorVersion() >= 3
+                                              : format.version() >= qMakePair(4, 1)
+                                                    || context.hasExtension(QByteArrayLiteral("GL_ARB_get_program_binary"));
+        if (!api) return false;
+        GLint formats = 0;
+        context.functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    QString programCacheFile(QOpenGLExtraFunctions& gl, const QString& name, const char* vertexSource, const char* fragmentSource)
+    {
+        // A binary only loads into the driver build that made it
+        QCryptographicHash key(QCryptographicHash::Sha1);
+        for (GLenum which : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            if (const auto* text = reinterpret_cast<const char*>(gl.glGetString(which))) key.addData(text, (int) qstrlen(text));
+            key.addData("\n", 1);
+        }
+        key.addData(vertexSource, (int) qstrlen(vertexSource));
+        key.addData("\n", 1);
+        key.addData(fragmentSource, (int) qstrlen(fragmentSource));
+        const QString directory = AppConfig::instance().getCacheDirectory() + "/shaders";
+        if (!QDir().mkpath(directory)) return QString();
+        return directory + "/" + name + "-" + QString::fromLatin1(key.result().toHex().left(16)) + ".bin";
+    }
+
+    bool loadProgramBinary(QOpenGLExtraFunctions& gl, QOpenGLShaderProgram& program, const QString& path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        const QByteArray data = file.readAll();
+        if (data.size() <= 8 || qFromLittleEndian<quint32>(data.constData()) != ProgramCacheMagic) return false;
+        const GLenum format = qFromLittleEndian<quint32>(data.constData() + 4);
+        if (!program.create()) return false;
+        gl.glProgramBinary(program.programId(), format, data.constData() + 8, data.size() - 8);
+        // With no shaders added, link() only reads back the status glProgramBinary left
+        if (program.link()) return true;
+        // Rejected (a driver update the key missed): rebuilt from source and rewritten
+        file.close();
+        QFile::remove(path);
+        return false;
+    }
+
+    void storeProgramBinary(QOpenGLExtraFunctions& gl, QOpenGLShaderProgram& program, const QString& path)
+    {
+        GLint length = 0;
+        gl.glGetProgramiv(program.programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        QByteArray data(8 + length, Qt::Uninitialized);
+        GLenum format = 0;
+        GLsizei written = 0;
+        gl.glGetProgramBinary(program.programId(), length, &written, &format, data.data() + 8);
+        if (written <= 0) return;
+        qToLittleEndian<quint32>(ProgramCacheMagic, data.data());
+        qToLittleEndian<quint32>(format, data.data() + 4);
+        data.resize(8 + written);
+
+        // Binaries of the same program for older drivers or sources are dead weight
+        const QFileInfo target(path);
+        const QString prefix = target.fileName().section('-', 0, -2) + "-";
+        for (const QFileInfo& stale : QDir(target.absolutePath()).entryInfoList({ prefix + "*.bin" }, QDir::Files))
+            if (stale.fileName() != target.fileName()) QFile::remove(stale.absoluteFilePath());
+
+        QSaveFile file(path);
+        if (file.open(QIODevice::WriteOnly) && file.write(data) == data.size()) file.commit();
+    }
+}
+
+GlResources& GlResources::instance()
+{
+    static GlResources resources;
+    return resources;
+}
+
+bool GlResources::gpuWaveforms()
+{
+    if (!accelerationEnabled) return false;
+    if (softwareGl < 0) {
+        QOpenGLFunctions* gl = currentFunctions();
+        if (!gl) return true;
+        const auto* renderer = reinterpret_cast<const char*>(gl->glGetString(GL_RENDERER));
+        const QString name = renderer ? QString::fromLatin1(renderer) : QString();
+        softwareGl = isSoftwareRenderer(name) ? 1 : 0;
+        if (softwareGl)
+            std::cout << "GlResources: " << name.toStdString() << " renders in software, drawing waveforms on the CPU" << std::endl;
+    }
+    return softwareGl == 0;
+}
+
+bool GlResources::isSoftwareRenderer(const QString& renderer)
+{
+    static const char* const software[] = { "llvmpipe", "softpipe", "swrast", "SwiftShader",
+                                             "Microsoft Basic Render", "GDI Generic", "Software Rasterizer" };
+    for (const char* name : software)
+        if (renderer.contains(QLatin1String(name), Qt::CaseInsensitive)) return true;
+    return false;
+}
+
+GlResources::WaveTextures::WaveTextures()
+{
+    QOpenGLFunctions* gl = currentFunctions();
+    if (!gl) return;
+    gl->glGenTextures(1, &minMax);
+    gl->glGenTextures(1, &bands);
+    for (GLuint tex : { minMax, bands }) {
+        gl->glBindTexture(GL_TEXTURE_2D, tex);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GlResources::WaveTextures::~WaveTextures()
+{
+    QOpenGLFunctions* gl = currentFunctions();
+    if (!gl) {
+        std::cout << "GlResources: waveform textures released without a current context" << std::endl;
+        return;
+    }
+    if (minMax) gl->glDeleteTextures(1, &minMax);
+    if (bands) gl->glDeleteTextures(1, &bands);
+}
+
+GlResources::Mesh::Mesh()
+{
+    buffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    buffer.create();
+}
+
+GlResources::Mesh::~Mesh()
+{
+    if (buffer.isCreated()) buffer.destroy();
+}
+
+std::shared_ptr<QOpenGLShaderProgram> GlResources::program(const QString& name, const char* vertexSource, const char* fragmentSource)
+{
+    if (auto existing = programs[name].lock()) return existing;
+
+    std::shared_ptr<QOpenGLShaderProgram> built = buildProgram(name, vertexSource, fragmentSource);
+    if (!built) return nullptr;
+    programs[name] = built;
+    return built;
+}
+
+std::unique_ptr<QOpenGLShaderProgram> GlResources::buildProgram(const QString& name, const char* vertexSource,
+                                                                const char* fragmentSource)
+{
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    QOpenGLExtraFunctions* gl = context && programBinariesSupported(*context) ? context->extraFunctions() : nullptr;
+    const QString cacheFile = gl ? programCacheFile(*gl, name, vertexSource, fragmentSource) : QString();
+
+    if (!cacheFile.isEmpty()) {
+        auto cached = std::make_unique<QOpenGLShaderProgram>();
+        if (loadProgramBinary(*gl, *cached, cacheFile)) {
+            std::cout << "GlResources: loaded " << name.toStdString() << " from the shader cache" << std::endl;
+            return cached;
+        }
+    }
+
+    auto built = std::make_unique<QOpenGLShaderProgram>();
+    if (!built->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource)
+        || !built->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource)) {
+        std::cout << "GlResources: program " << name.toStdString() << " failed to build: "
+                  << built->log().toStdString() << std::endl;
+        return nullptr;
+    }
+    if (!cacheFile.isEmpty()) gl->glProgramParameteri(built->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!built->link()) {
+        std::cout << "GlResources: program " << name.toStdString() << " failed to build: "
+                  << built->log().toStdString() << std::endl;
+        return nullptr;
+    }
+    std::cout << "GlResources: compiled " << name.toStdString() << std::endl;
+    if (!cacheFile.isEmpty()) storeProgramBinary(*gl, *built, cacheFile);
+    return built;
+}
+
+template <typename T>
+std::shared_ptr<T> GlResources::findOrCreate(std::unordered_map<const void*, OwnedEntry<T>>& map,
+                                             const std::shared_ptr<const void>& owner)
+{
+    if (!owner) return nullptr;
+    // Drop entries whose data or GL copy is gone
+    for (auto it = map.begin(); it != map.end();) {
+        if (it->second.owner.expired() || it->second.value.expired()) it = map.erase(it);
+        else ++it;
+    }
+
+    auto& entry = map[owner.get()];
+    if (auto existing = entry.value.lock()) return existing;
+    auto created = std::make_shared<T>();
+    entry.owner = owner;
+    entry.value = created;
+    return created;
+}
+
+std::shared_ptr<GlResources::WaveTextures> GlResources::waveTextures(const std::shared_ptr<const void>& owner)
+{
+    return findOrCreate(textures, owner);
+}
+
+std::shared_ptr<GlResources::Mesh> GlResources::mesh(const std::shared_ptr<const void>& owner)
+{
+    return findOrCreate(meshes, owner);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QString>
+#include <QtGui/qopengl.h>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "MemoryBudget.h"
+
+/**
+ * GL objects shared by every waveform view.
+ *
+ * With Qt::AA_ShareOpenGLContexts (set in main) all QOpenGLWidget contexts are in one share
+ * group, so shader programs, textures and buffers created in one view can be used by all.
+ * Views ask for a program by name and get the one compiled by the first view; they ask for
+ * the textures or mesh of a waveform summary by the summary's shared pointer and get the
+ * upload made by the first view that showed it. A second deck on the same track, or the
+ * scrolling and overview views of one deck, draw from the same GPU copy.
+ *
+ * Everything is handed out as a shared_ptr and freed with the last view that holds it, so
+ * holders must drop them with a context of the share group current (paintGL, or between
+ * makeCurrent() and doneCurrent() in the destructor). Not VAOs: those are per context in GL,
+ * so each view keeps its own and points it at the shared buffers.
+ *
+ * Message thread only, like every GL view.
+ */
+class GlResources {
+public:
+    static GlResources& instance();
+
+    // Whether views draw their waveforms with shaders or with the software rasterizer
+    // (WaveformRaster). Performance/EnableGpuAcceleration off forces software; otherwise the
+    // shaders are used unless the context's GL is itself a CPU rasterizer (llvmpipe, SwiftShader,
+    // WARP, GDI Generic...), where running fragment shaders per pixel is slower than uploading
+    // a CPU-drawn image. Decided for the first context asked with and kept from then on.
+    void setAccelerationEnabled(bool enabled) { accelerationEnabled = enabled; }
+    bool gpuWaveforms();
+    static bool isSoftwareRenderer(const QString& renderer);
+
+    // Summary pyramid textures as laid out by WaveformDisplay::uploadWaveformTextures()
+    struct WaveTextures {
+        WaveTextures();
+        ~WaveTextures();
+        GLuint minMax{0};   // RG8_SNORM
+        GLuint bands{0};    // RGB8: low, mid, high energy
+        std::vector<int> levelTexelOffsets; // level 0 = source bins, i = pyramid[i - 1]
+        bool hasBands{false};
+        bool uploaded{false};
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::GpuTextures};
+    };
+
+    // Static vertex buffer built from one waveform
+    struct Mesh {
+        Mesh();
+        ~Mesh();
+        QOpenGLBuffer buffer{ QOpenGLBuffer::VertexBuffer };
+        int vertexCount{0};
+        bool uploaded{false};
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::GpuTextures};
+    };
+
+    // Compiled and linked once per name; nullptr (and a log line) when the sources don't build
+    std::shared_ptr<QOpenGLShaderProgram> program(const QString& name, const char* vertexSource, const char* fragmentSource);
+
+    // A program for the current context, not shared: the linked binary from the disk cache when
+    // the driver takes it back, else compiled from source and its binary stored for next time.
+    // Cache files live in AppConfig::getCacheDirectory()/shaders, one per program name, keyed by
+    // GL vendor, renderer and version and by the sources, so a driver update or an edited shader
+    // only costs one compile. Any thread with a current context (WaveformRenderer builds its own).
+    static std::unique_ptr<QOpenGLShaderProgram> buildProgram(const QString& name, const char* vertexSource,
+                                                              const char* fragmentSource);
+
+    // Keyed by the data the GL copy is made from; a new owner at a reused address gets a new entry
+    std::shared_ptr<WaveTextures> waveTextures(const std::shared_ptr<const void>& owner);
+    std::shared_ptr<Mesh> mesh(const std::shared_ptr<const void>& owner);
+
+private:
+    GlResources() = default;
+
+    template <typename T>
+    struct OwnedEntry {
+        std::weak_ptr<const void> owner;
+        std::weak_ptr<T> value;
+    };
+    template <typename T>
+    static std::shared_ptr<T> findOrCreate(std::unordered_map<const void*, OwnedEntry<T>>& map,
+                                           const std::shared_ptr<const void>& owner);
+
+    bool accelerationEnabled{true};
+    int softwareGl{-1};     // -1 not asked yet
+    std::map<QString, std::weak_ptr<QOpenGLShaderProgram>> programs;
+    std::unordered_map<const void*, OwnedEntry<WaveTextures>> textures;
+    std::unordered_map<const void*, OwnedEntry<Mesh>> meshes;
+};
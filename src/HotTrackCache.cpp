@@ -0,0 +1,117 @@
+#include "HotTrackCache.h"
+#include "MemoryBudget.h"
+#include <algorithm>
+#include <iostream>
+
+HotTrackCache::HotTrackCache()
+{
+    evictorId = MemoryBudget::getInstance().addEvictor([this](int64_t bytesToFree) { return evict(bytesToFree); });
+}
+
+HotTrackCache::~HotTrackCache()
+{
+    MemoryBudget::getInstance().removeEvictor(evictorId);
+}
+
+HotTrackCache::Entry HotTrackCache::find(const juce::File& audioFile)
+{
+    const juce::String path = audioFile.getFullPathName();
+    const juce::int64 size = audioFile.getSize();
+    const juce::int64 modified = audioFile.getLastModificationTime().toMilliseconds();
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto it = slots.begin(); it != slots.end(); ++it) {
+        if (it->path != path) continue;
+        if (it->size != size || it->modified != modified) {
+            slots.erase(it);   // changed on disk
+            return {};
+        }
+        slots.splice(slots.begin(), slots, it);
+        return it->entry;
+    }
+    return {};
+}
+
+HotTrackCache::Slot& HotTrackCache::touch(const juce::File& audioFile)
+{
+    const juce::String path = audioFile.getFullPathName();
+    const juce::int64 size = audioFile.getSize();
+    const juce::int64 modified = audioFile.getLastModificationTime().toMilliseconds();
+
+    for (auto it = slots.begin(); it != slots.end(); ++it) {
+        if (it->path != path) continue;
+        if (it->size != size || it->modified != modified) it->entry = {};
+        it->size = size;
+        it->modified = modified;
+        slots.splice(slots.begin(), slots, it);
+        return slots.front();
+    }
+
+    slots.push_front({ path, size, modified, false, {} });
+    trim();
+    return slots.front();
+}
+
+void HotTrackCache::trim()
+{
+    int unpinned = 0;
+    for (auto it = slots.begin(); it != slots.end();) {
+        if (!it->pinned && ++unpinned > MaxEntries) it = slots.erase(it);
+        else ++it;
+    }
+}
+
+void HotTrackCache::storeSamples(const juce::File& audioFile, std::shared_ptr<const InMemoryTrackReader> samples)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    touch(audioFile).entry.samples = std::move(samples);
+}
+
+void HotTrackCache::storeWaveform(const juce::File& audioFile, WaveformGenerator::SharedResult waveform)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    touch(audioFile).entry.waveform = std::move(waveform);
+}
+
+void HotTrackCache::storeBeatGrid(const juce::File& audioFile, std::shared_ptr<const BpmCache::Entry> beatGrid)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    touch(audioFile).entry.beatGrid = std::move(beatGrid);
+}
+
+void HotTrackCache::pin(const juce::File& audioFile)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    touch(audioFile).pinned = true;
+}
+
+void HotTrackCache::unpinAll()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto& slot : slots) slot.pinned = false;
+    trim();
+}
+
+int HotTrackCache::getPinnedCount()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (int) std::count_if(slots.begin(), slots.end(), [](const Slot& slot) { return slot.pinned; });
+}
+
+int64_t HotTrackCache::evict(int64_t bytesToFree)
+{
+    auto& budget = MemoryBudget::getInstance();
+    const int64_t before = budget.getTotalBytes();
+    auto freed = [&]() { return before - budget.getTotalBytes(); };
+
+    std::lock_guard<std::mutex> guard(lock);
+    // Samples first: they are the bulk of it, and all a reload loses is the decode
+    for (auto it = slots.rbegin(); it != slots.rend() && freed() < bytesToFree; ++it) {
+        if (it->pinned || !it->entry.samples) continue;
+        std::cout << "HotTrackCache: releasing samples of " << it->path << std::endl;
+        it->entry.samples.reset();
+    }
+    for (auto it = slots.rbegin(); it != slots.rend() && freed() < bytesToFree; ++it)
+        if (!it->pinned) it->entry.waveform.reset();
+    return freed();
+}
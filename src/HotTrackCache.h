@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BpmCache.h"
+#include "InMemoryTrackReader.h"
+#include "WaveformGenerator.h"
+#include <list>
+#include <memory>
+#include <mutex>
+
+/**
+ * The last few tracks loaded onto a deck or prefetched from the library selection, with what the
+ * load produced: the decoded samples (when DecodeTracksToRam is on), the top overview bins and
+ * the beat grid.
+ *
+ * Loading one of them again - reloading a deck, or doubling a track onto the other deck -
+ * shares that data instead of opening, decoding and analysing the file a second time; the deck
+ * only gets a new InMemoryTrackReader view over the same samples. Entries are matched by path,
+ * size and modification time, so a file changed on disk misses. At most MaxEntries tracks are
+ * kept. Everything cached counts towards the MemoryBudget; as its first evictor the cache gives
+ * up samples, then overview bins, least recently used first, when another allocation needs the
+ * room.
+ *
+ * Pinned tracks (the crate GigPrep prepared) stay in addition to the MaxEntries others and are
+ * never evicted; a file changed on disk drops its pin with the entry. Thread-safe.
+ */
+class HotTrackCache {
+public:
+    // Enough for a 4-deck set plus a crate's worth of next tracks; compressed, 20 five-minute tracks
+    // of samples stay well under 1 GB
+    static constexpr int MaxEntries = 20;
+    // Bin count of the cached overview, the same the decks' top waveform is loaded with
+    static constexpr int OverviewBins = 16000;
+
+    struct Entry {
+        std::shared_ptr<const InMemoryTrackReader> samples;   // createView() per deck; may be null
+        WaveformGenerator::SharedResult waveform;             // top overview bins; may be null
+        std::shared_ptr<const BpmCache::Entry> beatGrid;      // may be null
+    };
+
+    static HotTrackCache& getInstance() {
+        static HotTrackCache instance;
+        return instance;
+    }
+
+    // Marks the track most recently used; all members null if it isn't cached
+    Entry find(const juce::File& audioFile);
+
+    void storeSamples(const juce::File& audioFile, std::shared_ptr<const InMemoryTrackReader> samples);
+    void storeWaveform(const juce::File& audioFile, WaveformGenerator::SharedResult waveform);
+    void storeBeatGrid(const juce::File& audioFile, std::shared_ptr<const BpmCache::Entry> beatGrid);
+
+    // Keeps the track's entry, whatever is stored for it now or later, until unpinAll()
+    void pin(const juce::File& audioFile);
+    void unpinAll();
+    int getPinnedCount();
+
+private:
+    HotTrackCache();
+    ~HotTrackCache();
+
+    // MemoryBudget evictor: drops cached samples, then waveforms, least recently used first
+    // (data a deck still uses stays alive until it unloads it); returns the bytes freed
+    int64_t evict(int64_t bytesToFree);
+
+    struct Slot {
+        juce::String path;
+        juce::int64 size{0};
+        juce::int64 modified{0};
+        bool pinned{false};
+        Entry entry;
+    };
+
+    // Existing or new slot for the file at the front; lock held
+    Slot& touch(const juce::File& audioFile);
+    // Least recently used unpinned slots beyond MaxEntries; lock held
+    void trim();
+
+    std::mutex lock;
+    std::list<Slot> slots;   // most recently used first
+    int evictorId{0};
+};
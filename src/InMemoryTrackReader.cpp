@@ -0,0 +1,433 @@
+#include "InMemoryTrackReader.h"
+#include "SimdDispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+std::atomic<int64_t> InMemoryTrackReader::totalBytesInUse{0};
+
+namespace {
+    // Decks are stereo; extra channels of surround files are not kept in RAM
+    constexpr int kMaxStoredChannels = 2;
+
+    int storedChannelsFor(const juce::AudioFormatReader& source) {
+        return juce::jlimit(1, kMaxStoredChannels, (int) source.numChannels);
+    }
+
+    // What Compressed usually comes to, against the 16-bit size (budgeting before the pass)
+    constexpr double kCompressedEstimate = 0.65;
+
+    // Rates this close are the same rate (and nothing is converted)
+    bool convertsTo(const juce::AudioFormatReader& source, double targetSampleRate) {
+        return targetSampleRate > 0.0 && source.sampleRate > 0.0 && std::abs(targetSampleRate - source.sampleRate) > 0.5;
+    }
+
+    juce::int64 storedLengthFor(const juce::AudioFormatReader& source, double targetSampleRate) {
+        if (!convertsTo(source, targetSampleRate)) return source.lengthInSamples;
+        return (juce::int64) std::ceil((double) source.lengthInSamples * targetSampleRate / source.sampleRate);
+    }
+
+    // Sample-rate conversion kernel: 64 taps, Kaiser beta 8.6 (about -85 dB outside the band)
+    constexpr int kTaps = 64;
+    constexpr int kTapsBefore = kTaps / 2 - 1;
+    constexpr int kPhases = 512;
+    constexpr double kKaiserBeta = 8.6;
+
+    double besselI0(double x) {
+        double sum = 1.0, term = 1.0;
+        const double halfX = x * 0.5;
+        for (int k = 1; k < 64; ++k) {
+            term *= (halfX / k) * (halfX / k);
+            sum += term;
+            if (term < 1.0e-14 * sum) break;
+        }
+        return sum;
+    }
+
+    // Output j is input position firstPos + j * step (relative to input[0], which is at least
+    // kTapsBefore samples in); rows interpolate between neighbouring phases
+    SIMD_DISPATCH
+    void convolveRun(const float* input, float* output, int numOutput, double firstPos, double step,
+                     const float* table, const float* delta) noexcept {
+        for (int j = 0; j < numOutput; ++j) {
+            const double pos = firstPos + (double) j * step;
+            const double whole = std::floor(pos);
+            const double phase = (pos - whole) * kPhases;
+            const int row = std::min(kPhases - 1, (int) phase);
+            const float w = (float) (phase - row);
+            const float* taps = table + (size_t) row * kTaps;
+            const float* slope = delta + (size_t) row * kTaps;
+            const float* x = input + (std::ptrdiff_t) whole - kTapsBefore;
+            // Eight partial sums, so the tap loop vectorises without reassociating floats
+            float lanes[8] = {};
+            for (int k = 0; k < kTaps; k += 8)
+                for (int l = 0; l < 8; ++l)
+                    lanes[l] += (taps[k + l] + w * slope[k + l]) * x[k + l];
+            output[j] = ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+        }
+    }
+}
+
+// Streaming fixed-ratio converter for the Builder: input is appended block by block, every
+// output sample whose kernel is covered is produced right away
+class InMemoryTrackReader::Builder::Converter {
+public:
+    Converter(int channels, double inRate, double outRate, juce::int64 outputLength)
+        : step(inRate / outRate), outLength(outputLength), pending((size_t) channels), output((size_t) channels) {
+        // Below the lower Nyquist, a little inside it so the transition band stays out of the audio
+        const double cutoff = 0.94 * std::min(1.0, outRate / inRate);
+        table.assign((size_t) (kPhases + 1) * kTaps, 0.0f);
+        delta.assign(table.size(), 0.0f);
+        const double i0Beta = besselI0(kKaiserBeta);
+        const double halfWidth = kTaps / 2.0;
+        for (int p = 0; p <= kPhases; ++p) {
+            const double frac = (double) p / kPhases;
+            double values[kTaps];
+            double sum = 0.0;
+            for (int k = 0; k < kTaps; ++k) {
+                const double t = (double) (k - kTapsBefore) - frac;
+                const double x = cutoff * t;
+                const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+                const double r = t / halfWidth;
+                const double window = std::abs(r) >= 1.0 ? 0.0 : besselI0(kKaiserBeta * std::sqrt(1.0 - r * r)) / i0Beta;
+                values[k] = sinc * window;
+                sum += values[k];
+            }
+            // Unity at DC for every phase
+            for (int k = 0; k < kTaps; ++k)
+                table[(size_t) p * kTaps + (size_t) k] = (float) (values[k] / sum);
+        }
+        for (int p = 0; p < kPhases; ++p)
+            for (int k = 0; k < kTaps; ++k)
+                delta[(size_t) p * kTaps + (size_t) k] = table[(size_t) (p + 1) * kTaps + (size_t) k] - table[(size_t) p * kTaps + (size_t) k];
+        // Silence before the first sample
+        for (auto& channel : pending) channel.assign((size_t) kTapsBefore, 0.0f);
+        pendingStart = -kTapsBefore;
+    }
+
+    // Appends numSamples input samples and hands every output sample it can make to `builder`
+    void push(Builder& builder, const float* const* channels, int numSamples) {
+        for (size_t ch = 0; ch < pending.size(); ++ch)
+            pending[ch].insert(pending[ch].end(), channels[ch], channels[ch] + numSamples);
+        inputEnd += numSamples;
+        render(builder);
+    }
+
+    // End of the input: the kernel runs out over silence
+    void flush(Builder& builder) {
+        for (auto& channel : pending) channel.insert(channel.end(), (size_t) kTaps, 0.0f);
+        inputEnd += kTaps;
+        render(builder);
+    }
+
+private:
+    void render(Builder& builder) {
+        // Output k reads input floor(k * step) - kTapsBefore .. + kTaps - 1; one sample of slack
+        // for the rounding of the positions
+        const juce::int64 available = inputEnd - (kTaps - kTapsBefore) - 1;
+        juce::int64 endOut = available < 0 ? 0 : (juce::int64) std::floor((double) available / step) + 1;
+        endOut = std::min(endOut, outLength);
+        const int count = (int) std::max<juce::int64>(0, endOut - outIndex);
+        if (count > 0) {
+            const double firstPos = (double) outIndex * step - (double) pendingStart;
+            float* outPtrs[kMaxStoredChannels];
+            for (size_t ch = 0; ch < pending.size(); ++ch) {
+                output[ch].resize((size_t) count);
+                convolveRun(pending[ch].data(), output[ch].data(), count, firstPos, step, table.data(), delta.data());
+                outPtrs[ch] = output[ch].data();
+            }
+            builder.store(outPtrs, (int) pending.size(), (size_t) outIndex, count);
+            outIndex += count;
+        }
+        // Keep what the next output's kernel still reaches back to
+        const juce::int64 keepFrom = (juce::int64) std::floor((double) outIndex * step) - kTapsBefore;
+        const juce::int64 drop = std::min<juce::int64>(keepFrom - pendingStart, (juce::int64) pending[0].size());
+        if (drop > 0) {
+            for (auto& channel : pending) channel.erase(channel.begin(), channel.begin() + (std::ptrdiff_t) drop);
+            pendingStart += drop;
+        }
+    }
+
+    const double step;              // input samples per output sample
+    const juce::int64 outLength;
+    std::vector<float> table, delta;
+    std::vector<std::vector<float>> pending;   // input from pendingStart on
+    std::vector<std::vector<float>> output;
+    juce::int64 pendingStart{0};
+    juce::int64 inputEnd{0};
+    juce::int64 outIndex{0};
+};
+
+InMemoryTrackReader::InMemoryTrackReader(const juce::AudioFormatReader& source, SampleFormat sampleFormat)
+    : juce::AudioFormatReader(nullptr, "In-Memory Track"), format(sampleFormat), samples(std::make_shared<Samples>()) {
+    sampleRate = source.sampleRate;
+    lengthInSamples = source.lengthInSamples;
+    numChannels = (unsigned int) storedChannelsFor(source);
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+    metadataValues = source.metadataValues;
+    if (format == SampleFormat::Compressed)
+        cache = std::make_unique<BlockCache>((int) numChannels);
+}
+
+InMemoryTrackReader::BlockCache::BlockCache(int numChannels)
+    : samples((size_t) BlockCacheSlots * (size_t) numChannels * SampleBlockCodec::BlockFrames, 0.0f),
+      scratch((size_t) SampleBlockCodec::MaxChannels * SampleBlockCodec::BlockFrames, 0) {
+    block.fill(-1);
+}
+
+std::unique_ptr<InMemoryTrackReader> InMemoryTrackReader::createView() const {
+    // *this stands in for the source: same rate, length, channels and metadata
+    std::unique_ptr<InMemoryTrackReader> view(new InMemoryTrackReader(*this, format));
+    view->samples = samples;
+    return view;
+}
+
+int64_t InMemoryTrackReader::bytesNeededFor(const juce::AudioFormatReader& source, SampleFormat sampleFormat,
+                                            double targetSampleRate) {
+    const int64_t bytesPerSample = sampleFormat == SampleFormat::Float32 ? (int64_t) sizeof(float) : (int64_t) sizeof(int16_t);
+    const int64_t bytes = (int64_t) storedLengthFor(source, targetSampleRate) * storedChannelsFor(source) * bytesPerSample;
+    return sampleFormat == SampleFormat::Compressed ? (int64_t) ((double) bytes * kCompressedEstimate) : bytes;
+}
+
+std::unique_ptr<InMemoryTrackReader> InMemoryTrackReader::decodeFrom(juce::AudioFormatReader& source, int64_t budgetBytes) {
+    auto builder = Builder::create(source, budgetBytes);
+    if (builder == nullptr)
+        return nullptr;
+    TrackDecodePipeline pipeline(source);
+    pipeline.addSink(builder.get());
+    pipeline.run();
+    return builder->takeReader();
+}
+
+InMemoryTrackReader::Builder::~Builder() = default;
+
+std::unique_ptr<InMemoryTrackReader::Builder> InMemoryTrackReader::Builder::create(const juce::AudioFormatReader& source,
+                                                                                   int64_t budgetBytes, double targetSampleRate,
+                                                                                   bool compressed) {
+    if (source.lengthInSamples <= 0 || source.numChannels == 0)
+        return nullptr;
+    const bool convert = convertsTo(source, targetSampleRate);
+    const juce::int64 storedLength = storedLengthFor(source, targetSampleRate);
+    // std::vector index and the reader API both use int-sized chunks; refuse absurd lengths
+    if (storedLength > (juce::int64) std::numeric_limits<int>::max())
+        return nullptr;
+
+    SampleFormat chosen;
+    const SampleFormat smallest = compressed ? SampleFormat::Compressed : SampleFormat::Int16;
+    if (compressed && bytesNeededFor(source, SampleFormat::Compressed, targetSampleRate) <= budgetBytes) {
+        chosen = SampleFormat::Compressed;
+    } else if (!compressed && bytesNeededFor(source, SampleFormat::Float32, targetSampleRate) <= budgetBytes) {
+        chosen = SampleFormat::Float32;
+    } else if (!compressed && bytesNeededFor(source, SampleFormat::Int16, targetSampleRate) <= budgetBytes) {
+        chosen = SampleFormat::Int16;
+    } else {
+        std::cout << "InMemoryTrackReader: track needs " << (bytesNeededFor(source, smallest, targetSampleRate) >> 20)
+                  << " MB, budget is " << (std::max<int64_t>(0, budgetBytes) >> 20) << " MB - streaming instead" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<InMemoryTrackReader> result(new InMemoryTrackReader(source, chosen));
+    if (convert) {
+        result->sampleRate = targetSampleRate;
+        result->lengthInSamples = storedLength;
+    }
+    const int channels = (int) result->numChannels;
+    const int length = (int) storedLength;
+
+    try {
+        if (chosen == SampleFormat::Float32) {
+            result->samples->floatData.assign((size_t) channels, std::vector<float>((size_t) length));
+        } else if (chosen == SampleFormat::Int16) {
+            result->samples->int16Data.assign((size_t) channels, std::vector<int16_t>((size_t) length));
+        } else {
+            result->samples->compressedData.reserve((size_t) bytesNeededFor(source, chosen, targetSampleRate));
+            result->samples->blockOffsets.reserve((size_t) (length / SampleBlockCodec::BlockFrames + 2));
+            result->samples->blockOffsets.push_back(0);
+        }
+    } catch (const std::bad_alloc&) {
+        std::cout << "InMemoryTrackReader: allocation failed - streaming instead" << std::endl;
+        return nullptr;
+    }
+
+    result->samples->sizeInBytes = bytesNeededFor(source, chosen, targetSampleRate);
+    totalBytesInUse.fetch_add(result->samples->sizeInBytes);
+    result->samples->memory.resize(result->samples->sizeInBytes);
+
+    std::unique_ptr<Builder> builder(new Builder());
+    if (chosen == SampleFormat::Compressed)
+        builder->staging.assign((size_t) channels, std::vector<int16_t>((size_t) SampleBlockCodec::BlockFrames));
+    if (convert)
+        builder->converter = std::make_unique<Converter>(channels, source.sampleRate, targetSampleRate, storedLength);
+    builder->track = std::move(result);
+    return builder;
+}
+
+void InMemoryTrackReader::Builder::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) {
+    if (track == nullptr)
+        return;
+    const int channels = std::min((int) track->numChannels, block.getNumChannels());
+    if (converter != nullptr) {
+        // The pass runs front to back, so the converter just follows it; a mono block feeds both
+        const float* inputs[kMaxStoredChannels];
+        for (int ch = 0; ch < (int) track->numChannels; ++ch)
+            inputs[ch] = block.getReadPointer(std::min(ch, channels - 1));
+        converter->push(*this, inputs, numSamples);
+        return;
+    }
+    const float* inputs[kMaxStoredChannels];
+    for (int ch = 0; ch < channels; ++ch)
+        inputs[ch] = block.getReadPointer(ch);
+    store(inputs, channels, (size_t) position, numSamples);
+}
+
+void InMemoryTrackReader::Builder::store(const float* const* channels, int numChannels, size_t pos, int numSamples) {
+    if (track->format == SampleFormat::Compressed) {
+        // Front to back: whole blocks go to the codec as they fill
+        jassert(pos == (track->samples->blockOffsets.size() - 1) * (size_t) SampleBlockCodec::BlockFrames + (size_t) stagingFill);
+        juce::ignoreUnused(pos);
+        for (int done = 0; done < numSamples; ) {
+            const int n = std::min(numSamples - done, SampleBlockCodec::BlockFrames - stagingFill);
+            for (size_t ch = 0; ch < staging.size(); ++ch) {
+                const float* src = channels[std::min((int) ch, numChannels - 1)] + done;
+                int16_t* dst = staging[ch].data() + stagingFill;
+                for (int i = 0; i < n; ++i)
+                    dst[i] = (int16_t) juce::roundToInt(juce::jlimit(-1.0f, 1.0f, src[i]) * 32767.0f);
+            }
+            stagingFill += n;
+            done += n;
+            if (stagingFill == SampleBlockCodec::BlockFrames) encodeStaged();
+        }
+        return;
+    }
+    for (int ch = 0; ch < numChannels; ++ch) {
+        const float* src = channels[ch];
+        if (track->format == SampleFormat::Float32) {
+            std::memcpy(track->samples->floatData[(size_t) ch].data() + pos, src, (size_t) numSamples * sizeof(float));
+        } else {
+            int16_t* dst = track->samples->int16Data[(size_t) ch].data() + pos;
+            for (int i = 0; i < numSamples; ++i)
+                dst[i] = (int16_t) juce::roundToInt(juce::jlimit(-1.0f, 1.0f, src[i]) * 32767.0f);
+        }
+    }
+}
+
+void InMemoryTrackReader::Builder::finish(bool completed) {
+    if (track == nullptr)
+        return;
+    if (!completed) {
+        std::cout << "InMemoryTrackReader: decode failed - streaming instead" << std::endl;
+        track.reset();
+        return;
+    }
+    if (converter != nullptr) {
+        converter->flush(*this);
+        converter.reset();
+    }
+    if (track->format == SampleFormat::Compressed) {
+        if (stagingFill > 0) encodeStaged();
+        // What it really came to, instead of the estimate
+        auto& store = *track->samples;
+        store.compressedData.shrink_to_fit();
+        const int64_t actual = (int64_t) (store.compressedData.size() + store.blockOffsets.size() * sizeof(uint32_t));
+        totalBytesInUse.fetch_add(actual - store.sizeInBytes);
+        store.sizeInBytes = actual;
+        store.memory.resize(actual);
+    }
+    std::cout << "InMemoryTrackReader: decoded " << track->lengthInSamples << " samples x " << track->numChannels << " ch into "
+              << (track->getSizeInBytes() >> 20) << " MB (" << (track->format == SampleFormat::Float32 ? "float" : track->format == SampleFormat::Int16 ? "16-bit" : "compressed")
+              << "), total in RAM " << (totalBytesInUse.load() >> 20) << " MB" << std::endl;
+}
+
+void InMemoryTrackReader::Builder::encodeStaged() {
+    const int16_t* inputs[SampleBlockCodec::MaxChannels];
+    for (size_t ch = 0; ch < staging.size(); ++ch) inputs[ch] = staging[ch].data();
+    auto& store = *track->samples;
+    SampleBlockCodec::encode(inputs, (int) staging.size(), stagingFill, store.compressedData);
+    store.blockOffsets.push_back((uint32_t) store.compressedData.size());
+    stagingFill = 0;
+}
+
+int InMemoryTrackReader::cachedBlock(juce::int64 block) noexcept {
+    BlockCache& c = *cache;
+    int slot = 0;
+    for (int s = 0; s < BlockCacheSlots; ++s) {
+        if (c.block[(size_t) s] == block) {
+            c.lastUse[(size_t) s] = ++c.clock;
+            return s;
+        }
+        if (c.lastUse[(size_t) s] < c.lastUse[(size_t) slot]) slot = s;
+    }
+
+    const auto& offsets = samples->blockOffsets;
+    if (block < 0 || block + 1 >= (juce::int64) offsets.size()) return -1;
+    const int frames = (int) std::min<juce::int64>(SampleBlockCodec::BlockFrames, lengthInSamples - block * SampleBlockCodec::BlockFrames);
+    float* dest[SampleBlockCodec::MaxChannels];
+    for (int ch = 0; ch < (int) numChannels; ++ch)
+        dest[ch] = c.samples.data() + ((size_t) slot * numChannels + (size_t) ch) * SampleBlockCodec::BlockFrames;
+    const uint32_t start = offsets[(size_t) block];
+    c.block[(size_t) slot] = -1;
+    if (!SampleBlockCodec::decode(samples->compressedData.data() + start, offsets[(size_t) block + 1] - start,
+                                  (int) numChannels, frames, dest, c.scratch.data()))
+        return -1;
+    c.block[(size_t) slot] = block;
+    c.lastUse[(size_t) slot] = ++c.clock;
+    return slot;
+}
+
+bool InMemoryTrackReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                      juce::int64 startSampleInFile, int numSamples) {
+    // Part of the request that lies inside the track; AudioFormatReader::read already clamps,
+    // but AudioFormatReaderSource may ask for negative positions around the start
+    const juce::int64 first = std::max<juce::int64>(0, startSampleInFile);
+    const juce::int64 last = std::min<juce::int64>(lengthInSamples, startSampleInFile + numSamples);
+    const int lead = (int) (first - startSampleInFile);
+    const int valid = last > first ? (int) (last - first) : 0;
+
+    for (int ch = 0; ch < numDestChannels; ++ch) {
+        auto* dest = reinterpret_cast<float*>(destChannels[ch]);
+        if (dest == nullptr) continue;
+        dest += startOffsetInDestBuffer;
+
+        if (ch >= (int) numChannels || valid == 0) {
+            juce::FloatVectorOperations::clear(dest, numSamples);
+            continue;
+        }
+
+        if (lead > 0)
+            juce::FloatVectorOperations::clear(dest, lead);
+
+        if (format == SampleFormat::Float32) {
+            std::memcpy(dest + lead, samples->floatData[(size_t) ch].data() + first, (size_t) valid * sizeof(float));
+        } else if (format == SampleFormat::Compressed) {
+            float* out = dest + lead;
+            for (juce::int64 pos = first; pos < last; ) {
+                const juce::int64 block = pos / SampleBlockCodec::BlockFrames;
+                const int offset = (int) (pos - block * SampleBlockCodec::BlockFrames);
+                const int n = (int) std::min<juce::int64>(last - pos, SampleBlockCodec::BlockFrames - offset);
+                const int slot = cachedBlock(block);
+                if (slot < 0)
+                    juce::FloatVectorOperations::clear(out, n);
+                else
+                    std::memcpy(out, cache->samples.data() + ((size_t) slot * numChannels + (size_t) ch) * SampleBlockCodec::BlockFrames + offset,
+                                (size_t) n * sizeof(float));
+                out += n;
+                pos += n;
+            }
+        } else {
+            const int16_t* src = samples->int16Data[(size_t) ch].data() + first;
+            float* out = dest + lead;
+            constexpr float scale = 1.0f / 32767.0f;
+            for (int i = 0; i < valid; ++i)
+                out[i] = (float) src[i] * scale;
+        }
+
+        const int tail = numSamples - lead - valid;
+        if (tail > 0)
+            juce::FloatVectorOperations::clear(dest + lead + valid, tail);
+    }
+    return true;
+}
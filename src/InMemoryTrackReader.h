@@ -0,0 +1,119 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MemoryBudget.h"
+#include "SampleBlockCodec.h"
+#include "TrackDecodePipeline.h"
+
+/**
+ * AudioFormatReader over a fully decoded track held in RAM.
+ *
+ * The whole file is decoded once on the loader thread; afterwards every read (seeks, hot cues,
+ * loop wraps, reverse scratching) is just a copy out of the sample store and never touches the
+ * MP3/FLAC decoder again. Samples are kept as float when the memory budget allows it, otherwise
+ * as 16-bit to halve the footprint. Compressed keeps the 16-bit samples losslessly packed in
+ * independent blocks (SampleBlockCodec, about a third of float): every reader decodes the
+ * blocks it plays into a small LRU of its own (BlockCacheSlots blocks, allocated with the
+ * reader), so loops and short seeks back are served from it and the audio thread only decodes
+ * a block when playback enters it. Because it is a normal AudioFormatReader, the rest of the
+ * playback chain (AudioFormatReaderSource -> AudioTransportSource) stays unchanged. The samples
+ * are shared: createView() gives another reader over the same store, e.g. for a second deck
+ * playing the same track, and the RAM is released with the last reader.
+ *
+ * The Builder can convert the track to the device's rate on the way in (64-tap Kaiser-windowed
+ * sinc, polyphase), so a 48 kHz file on a 44.1 kHz device plays without the transport's
+ * real-time rate correction and the deck's tempo resampler is the only one on the audio thread.
+ * Positions stay in seconds, so cues and grids don't care which rate the samples are at.
+ */
+class InMemoryTrackReader : public juce::AudioFormatReader {
+public:
+    enum class SampleFormat { Float32, Int16, Compressed };
+    static constexpr int BlockCacheSlots = 8;
+
+    ~InMemoryTrackReader() override = default;
+
+    // Decodes `source` completely. Returns nullptr if the track doesn't fit into `budgetBytes`
+    // (even as 16-bit) or decoding fails - the caller should then keep streaming from `source`.
+    static std::unique_ptr<InMemoryTrackReader> decodeFrom(juce::AudioFormatReader& source, int64_t budgetBytes);
+
+    // Fills an in-memory track from a shared decode pass instead of decoding on its own
+    class Builder : public TrackDecodePipeline::Sink {
+    public:
+        // nullptr under the same conditions decodeFrom() would return nullptr before decoding.
+        // targetSampleRate > 0: the track is stored at that rate instead of the source's.
+        // compressed: Compressed instead of Float32 (or Int16 when float doesn't fit).
+        static std::unique_ptr<Builder> create(const juce::AudioFormatReader& source, int64_t budgetBytes,
+                                               double targetSampleRate = 0.0, bool compressed = false);
+        ~Builder() override;
+        void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+        void finish(bool completed) override;
+        // The finished track, or nullptr if decoding failed
+        std::unique_ptr<InMemoryTrackReader> takeReader() { return std::move(track); }
+
+    private:
+        class Converter;
+        Builder() = default;
+        void store(const float* const* channels, int numChannels, size_t position, int numSamples);
+        void encodeStaged();
+
+        std::unique_ptr<InMemoryTrackReader> track;
+        std::unique_ptr<Converter> converter;   // only when the rate changes
+        // Compressed: the block being filled
+        std::vector<std::vector<int16_t>> staging;
+        int stagingFill{0};
+    };
+
+    // Bytes needed to hold `source` in the given format (at targetSampleRate, if > 0); an
+    // estimate for Compressed
+    static int64_t bytesNeededFor(const juce::AudioFormatReader& source, SampleFormat format, double targetSampleRate = 0.0);
+
+    // Total RAM held by all live in-memory tracks (for budgeting across decks)
+    static int64_t getTotalBytesInUse() { return totalBytesInUse.load(); }
+
+    SampleFormat getSampleFormat() const { return format; }
+    int64_t getSizeInBytes() const { return samples->sizeInBytes; }
+
+    // Another reader over the same samples; nothing is copied or decoded
+    std::unique_ptr<InMemoryTrackReader> createView() const;
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    InMemoryTrackReader(const juce::AudioFormatReader& source, SampleFormat format);
+
+    // Compressed: decoded blocks of this reader, least recently used goes first
+    struct BlockCache {
+        std::array<juce::int64, BlockCacheSlots> block;
+        std::array<juce::uint32, BlockCacheSlots> lastUse{};
+        juce::uint32 clock{0};
+        std::vector<float> samples;     // [slot][channel][frame]
+        std::vector<int32_t> scratch;
+        BlockCache(int numChannels);
+    };
+    // Slot holding `block`, decoded now if it isn't cached; -1 if the block is damaged
+    int cachedBlock(juce::int64 block) noexcept;
+
+    struct Samples {
+        std::vector<std::vector<float>> floatData;     // per channel, Float32 mode
+        std::vector<std::vector<int16_t>> int16Data;   // per channel, Int16 mode
+        std::vector<uint8_t> compressedData;           // Compressed mode: the blocks back to back
+        std::vector<uint32_t> blockOffsets;            // start of every block, and the end
+        int64_t sizeInBytes{0};
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::DecodedTracks};
+        ~Samples() { totalBytesInUse.fetch_sub(sizeInBytes); }
+    };
+
+    SampleFormat format;
+    std::shared_ptr<Samples> samples;   // written only by the Builder, before any read
+    std::unique_ptr<BlockCache> cache;  // Compressed only
+
+    static std::atomic<int64_t> totalBytesInUse;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InMemoryTrackReader)
+};
@@ -0,0 +1,248 @@
+#include "IndexedMp3Format.h"
+#include "Mp3FrameIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#if MPG123_FOUND
+ #include <mpg123.h>
+ #include <mutex>
+#endif
+
+namespace {
+    // Frames decoded and dropped in front of a seek target, so the bit reservoir is filled
+    constexpr int SeekPrerollFrames = 2;
+
+    class Decoder {
+    public:
+        virtual ~Decoder() = default;
+        // The next read() starts at `sample`
+        virtual bool seek(juce::int64 sample) = 0;
+        virtual bool read(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer, int numSamples) = 0;
+    };
+
+    // JUCE's decoder, restarted on a frame boundary for every seek
+    class JuceDecoder : public Decoder {
+    public:
+        JuceDecoder(const juce::uint8* fileData, size_t fileSize, const Mp3FrameIndex& frameIndex)
+            : data(fileData), size(fileSize), index(frameIndex) {}
+
+        bool seek(juce::int64 sample) override {
+            const int frame = (int) juce::jlimit<juce::int64>(0, index.getNumFrames() - 1, sample / index.getSamplesPerFrame());
+            const int start = std::max(0, frame - SeekPrerollFrames);
+            const auto offset = (size_t) index.getFrameOffset(start);
+            decoder.reset(format.createReaderFor(new juce::MemoryInputStream(data + offset, size - offset, false), true));
+            // JUCE's reader skips to `position` on the first read, decoding from its stream start
+            position = sample - (juce::int64) start * index.getSamplesPerFrame();
+            return decoder != nullptr;
+        }
+
+        bool read(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer, int numSamples) override {
+            if (!decoder) return false;
+            const bool ok = decoder->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, position, numSamples);
+            position += numSamples;
+            return ok;
+        }
+
+    private:
+        const juce::uint8* data;
+        size_t size;
+        const Mp3FrameIndex& index;
+        juce::MP3AudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> decoder;
+        juce::int64 position{0};   // in the decoder's own stream
+    };
+
+#if MPG123_FOUND
+    // libmpg123 reading from the mapping, with the frame index given up front
+    class Mpg123Decoder : public Decoder {
+    public:
+        static constexpr int ScratchFrames = 4096;
+
+        static std::unique_ptr<Mpg123Decoder> create(const juce::uint8* fileData, size_t fileSize, const Mp3FrameIndex& index) {
+            std::unique_ptr<Mpg123Decoder> decoder(new Mpg123Decoder(fileData, fileSize, index.getNumChannels()));
+            return decoder->open(index) ? std::move(decoder) : nullptr;
+        }
+
+        ~Mpg123Decoder() override {
+            if (handle == nullptr) return;
+            mpg123_close(handle);
+            mpg123_delete(handle);
+        }
+
+        bool seek(juce::int64 sample) override {
+            return mpg123_seek(handle, (off_t) sample, SEEK_SET) >= 0;
+        }
+
+        bool read(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer, int numSamples) override {
+            float* const* dest = reinterpret_cast<float* const*>(destChannels);
+            while (numSamples > 0) {
+                const int wanted = std::min(numSamples, ScratchFrames);
+                size_t bytes = 0;
+                const int result = mpg123_read(handle, scratch.data(), (size_t) (wanted * channels) * sizeof(float), &bytes);
+                const int got = (int) (bytes / (sizeof(float) * (size_t) channels));
+                if (got == 0) {
+                    if (result == MPG123_NEW_FORMAT) continue;   // once, before the first samples
+                    for (int ch = 0; ch < numDestChannels; ++ch)
+                        if (dest[ch] != nullptr) std::fill_n(dest[ch] + startOffsetInDestBuffer, numSamples, 0.0f);
+                    return false;
+                }
+                for (int ch = 0; ch < numDestChannels; ++ch) {
+                    if (dest[ch] == nullptr) continue;
+                    const float* in = scratch.data() + std::min(ch, channels - 1);
+                    float* out = dest[ch] + startOffsetInDestBuffer;
+                    for (int i = 0; i < got; ++i) out[i] = in[i * channels];
+                }
+                startOffsetInDestBuffer += got;
+                numSamples -= got;
+            }
+            return true;
+        }
+
+    private:
+        struct Source {
+            const juce::uint8* data;
+            size_t size;
+            size_t position{0};
+        };
+
+        Mpg123Decoder(const juce::uint8* fileData, size_t fileSize, int numChannels)
+            : source{ fileData, fileSize }, channels(numChannels), scratch((size_t) (ScratchFrames * numChannels)) {}
+
+        bool open(const Mp3FrameIndex& index) {
+            static std::once_flag initialised;
+            std::call_once(initialised, []() { mpg123_init(); });
+
+            int error = MPG123_OK;
+            handle = mpg123_new(nullptr, &error);
+            if (handle == nullptr) return false;
+            mpg123_param(handle, MPG123_ADD_FLAGS, MPG123_QUIET, 0.0);
+            mpg123_param(handle, MPG123_REMOVE_FLAGS, MPG123_GAPLESS, 0.0);
+            mpg123_format_none(handle);
+            mpg123_format(handle, index.getSampleRate(), channels == 1 ? MPG123_MONO : MPG123_STEREO, MPG123_ENC_FLOAT_32);
+            if (mpg123_replace_reader_handle(handle, &readCallback, &seekCallback, nullptr) != MPG123_OK
+                || mpg123_open_handle(handle, &source) != MPG123_OK)
+                return false;
+
+            std::vector<off_t> offsets((size_t) index.getNumFrames());
+            for (int i = 0; i < index.getNumFrames(); ++i) offsets[(size_t) i] = (off_t) index.getFrameOffset(i);
+            if (mpg123_set_index(handle, offsets.data(), 1, offsets.size()) != MPG123_OK) return false;
+
+            long rate = 0;
+            int numChannels = 0, encoding = 0;
+            return mpg123_getformat(handle, &rate, &numChannels, &encoding) == MPG123_OK
+                && rate == index.getSampleRate() && numChannels == channels;
+        }
+
+        static ssize_t readCallback(void* handle, void* buffer, size_t bytes) {
+            auto* s = static_cast<Source*>(handle);
+            bytes = std::min(bytes, s->size - s->position);
+            std::memcpy(buffer, s->data + s->position, bytes);
+            s->position += bytes;
+            return (ssize_t) bytes;
+        }
+
+        static off_t seekCallback(void* handle, off_t offset, int whence) {
+            auto* s = static_cast<Source*>(handle);
+            const off_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (off_t) s->position : (off_t) s->size;
+            const off_t target = base + offset;
+            if (target < 0 || target > (off_t) s->size) return -1;
+            s->position = (size_t) target;
+            return target;
+        }
+
+        Source source;
+        int channels;
+        std::vector<float> scratch;   // interleaved
+        mpg123_handle* handle{nullptr};
+    };
+#endif
+
+    class IndexedMp3Reader : public juce::AudioFormatReader {
+    public:
+        static IndexedMp3Reader* open(juce::InputStream* stream, const juce::File& file, const juce::File& indexDirectory,
+                                      IndexedMp3Format::Backend backend) {
+            auto map = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+            if (map->getData() == nullptr || map->getSize() == 0) return nullptr;
+
+            auto index = std::make_unique<Mp3FrameIndex>();
+            if (!index->load(indexDirectory, file)) {
+                if (!index->build(map->getData(), map->getSize())) return nullptr;
+                index->store(indexDirectory, file);
+            }
+
+            const auto* data = static_cast<const juce::uint8*>(map->getData());
+            std::unique_ptr<Decoder> decoder;
+#if MPG123_FOUND
+            if (backend == IndexedMp3Format::Backend::Mpg123) {
+                decoder = Mpg123Decoder::create(data, map->getSize(), *index);
+                if (!decoder) std::cout << "IndexedMp3Format: libmpg123 cannot open " << file.getFullPathName() << std::endl;
+            }
+#else
+            juce::ignoreUnused(backend);
+#endif
+            if (!decoder) decoder = std::make_unique<JuceDecoder>(data, map->getSize(), *index);
+            if (!decoder->seek(0)) return nullptr;
+            return new IndexedMp3Reader(stream, std::move(map), std::move(index), std::move(decoder));
+        }
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                         juce::int64 startSampleInFile, int numSamples) override {
+            if (startSampleInFile != position && !decoder->seek(startSampleInFile)) {
+                position = -1;
+                for (int ch = 0; ch < numDestChannels; ++ch)
+                    if (destChannels[ch] != nullptr)
+                        std::memset(destChannels[ch] + startOffsetInDestBuffer, 0, sizeof(float) * (size_t) numSamples);
+                return false;
+            }
+            position = startSampleInFile + numSamples;
+            return decoder->read(destChannels, numDestChannels, startOffsetInDestBuffer, numSamples);
+        }
+
+    private:
+        IndexedMp3Reader(juce::InputStream* stream, std::unique_ptr<juce::MemoryMappedFile> fileMap,
+                         std::unique_ptr<Mp3FrameIndex> frameIndex, std::unique_ptr<Decoder> frameDecoder)
+            : juce::AudioFormatReader(stream, "MP3 file"), map(std::move(fileMap)), index(std::move(frameIndex)),
+              decoder(std::move(frameDecoder)) {
+            sampleRate = index->getSampleRate();
+            numChannels = (unsigned int) index->getNumChannels();
+            lengthInSamples = index->getTotalSamples();
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+        }
+
+        // Declaration order: the decoder reads the map and the index
+        std::unique_ptr<juce::MemoryMappedFile> map;
+        std::unique_ptr<Mp3FrameIndex> index;
+        std::unique_ptr<Decoder> decoder;
+        juce::int64 position{0};   // where the decoder continues
+    };
+}
+
+IndexedMp3Format::IndexedMp3Format(const juce::File& directory, Backend decoderBackend)
+    : indexDirectory(directory), backend(isMpg123Available() ? decoderBackend : Backend::Juce)
+{
+}
+
+bool IndexedMp3Format::isMpg123Available()
+{
+#if MPG123_FOUND
+    return true;
+#else
+    return false;
+#endif
+}
+
+juce::AudioFormatReader* IndexedMp3Format::createReaderFor(juce::InputStream* stream, bool deleteStreamIfOpeningFails)
+{
+    // The manager hands files over as FileInputStreams; the reader decodes from its own mapping
+    // and only keeps the stream for ownership
+    if (auto* fileStream = dynamic_cast<juce::FileInputStream*>(stream)) {
+        if (auto* reader = IndexedMp3Reader::open(stream, fileStream->getFile(), indexDirectory, backend))
+            return reader;
+    }
+    return juce::MP3AudioFormat::createReaderFor(stream, deleteStreamIfOpeningFails);
+}
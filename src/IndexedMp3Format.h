@@ -0,0 +1,35 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * JUCE's MP3 format with constant-time seeking.
+ *
+ * Readers opened on MP3 files memory-map the file and take frame positions from an
+ * Mp3FrameIndex, cached in indexDirectory and built on the first open (usually the library
+ * analysis pass). A seek restarts the decoder a couple of frames ahead of the target, like
+ * JUCE's own reader does for frames it has already passed - a jump past those makes JUCE
+ * decode everything in between, which is what made hot cues and needle drops on long VBR
+ * files slow. Streams that aren't files, and files the index can't describe (free-format
+ * bitrates), get JUCE's plain reader.
+ *
+ * The decoder is JUCE's, or libmpg123 (Backend::Mpg123) when built with MPG123_FOUND, which
+ * decodes faster and is handed the same index. Gapless trimming stays off either way so sample
+ * positions match JUCE's reader, and with them the beat grids already cached.
+ */
+class IndexedMp3Format : public juce::MP3AudioFormat {
+public:
+    enum class Backend { Juce, Mpg123 };
+
+    // Mpg123 falls back to Juce if the build has no libmpg123. The app registers it through
+    // DecoderRegistry::useIndexedMp3, ahead of JUCE's basic formats so that it opens .mp3 files.
+    IndexedMp3Format(const juce::File& indexDirectory, Backend backend);
+
+    static bool isMpg123Available();
+
+    juce::AudioFormatReader* createReaderFor(juce::InputStream* stream, bool deleteStreamIfOpeningFails) override;
+
+private:
+    juce::File indexDirectory;
+    Backend backend;
+};
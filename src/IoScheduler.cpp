@@ -0,0 +1,127 @@
+#include "IoScheduler.h"
+#include <algorithm>
+#include <condition_variable>
+
+#if ! JUCE_WINDOWS
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+struct IoScheduler::Device {
+    std::mutex mutex;
+    std::condition_variable turnFree;
+    bool busy{false};        // a block is being read
+    int decksWaiting{0};
+};
+
+IoScheduler& IoScheduler::getInstance()
+{
+    static IoScheduler instance;
+    return instance;
+}
+
+IoScheduler::Device& IoScheduler::deviceFor(const juce::File& file)
+{
+    std::uint64_t id = 0;
+#if JUCE_WINDOWS
+    id = (std::uint32_t) file.getVolumeSerialNumber();
+#else
+    struct stat info;
+    if (::stat(file.getFullPathName().toRawUTF8(), &info) == 0) id = (std::uint64_t) info.st_dev;
+#endif
+    std::lock_guard<std::mutex> lock(devicesMutex);
+    auto& device = devices[id];
+    if (!device) device = std::make_unique<Device>();
+    return *device;
+}
+
+IoScheduler::ReadAhead::ReadAhead(const juce::File& file, Priority priority)
+    : device(&IoScheduler::getInstance().deviceFor(file)), priority(priority)
+{
+#if JUCE_WINDOWS
+    stream = std::make_unique<juce::FileInputStream>(file);
+    if (stream->openedOk()) fileBytes = stream->getTotalLength();
+#else
+    fd = ::open(file.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        struct stat info;
+        if (::fstat(fd, &info) == 0) fileBytes = (juce::int64) info.st_size;
+        // A larger readahead window for this file
+ #if JUCE_MAC
+        ::fcntl(fd, F_RDAHEAD, 1);
+ #else
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+ #endif
+    }
+#endif
+    if (fileBytes > 0) buffer.malloc((size_t) BlockBytes);
+}
+
+IoScheduler::ReadAhead::~ReadAhead()
+{
+#if ! JUCE_WINDOWS
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+void IoScheduler::ReadAhead::reached(juce::int64 position, juce::int64 length)
+{
+    if (length <= 0 || next >= fileBytes) return;
+    // Compressed files aren't linear in samples; the blocks ahead make up for that
+    const auto byte = (juce::int64) ((double) fileBytes * (double) position / (double) length);
+    readTo(byte + (juce::int64) BlocksAhead * BlockBytes);
+}
+
+void IoScheduler::ReadAhead::readTo(juce::int64 end)
+{
+    end = std::min(end, fileBytes);
+    while (next < end) {
+        const int bytes = (int) std::min<juce::int64>(BlockBytes, fileBytes - next);
+        // Failed: the decoder reads for itself, unscheduled, and reports the error
+        if (!readBlock(next, bytes)) {
+            next = fileBytes;
+            return;
+        }
+        next += bytes;
+    }
+}
+
+bool IoScheduler::ReadAhead::readBlock(juce::int64 offset, int bytes)
+{
+    Device& d = *device;
+    {
+        std::unique_lock<std::mutex> lock(d.mutex);
+        if (priority == Priority::Deck) {
+            ++d.decksWaiting;
+            d.turnFree.wait(lock, [&d] { return !d.busy; });
+            --d.decksWaiting;
+        } else {
+            d.turnFree.wait(lock, [&d] { return !d.busy && d.decksWaiting == 0; });
+        }
+        d.busy = true;
+    }
+
+    bool ok = true;
+#if JUCE_WINDOWS
+    ok = stream->setPosition(offset) && stream->read(buffer.get(), bytes) == bytes;
+#else
+    for (int done = 0; done < bytes;) {
+        const ssize_t got = ::pread(fd, buffer.get() + done, (size_t) (bytes - done), (off_t) (offset + done));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            ok = false;
+            break;
+        }
+        done += (int) got;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(d.mutex);
+        d.busy = false;
+    }
+    d.turnFree.notify_all();
+    return ok;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/**
+ * Takes turns on each storage device for the passes that read whole tracks, so two deck loads
+ * and the library analysis on one spinning disk or SD card don't seek against each other.
+ *
+ * A pass reads its file through a ReadAhead: ahead of the decoder, in aligned blocks of
+ * BlockBytes, each block one read while the pass holds its device's turn. The decoder (a
+ * stream, a mapping, the MP3 index reader alike) then finds the file in the page cache. One
+ * block is read per device at a time; whoever waits with Priority::Deck gets the next turn
+ * before any Background reader, so a deck load waits at most for the block already in flight.
+ *
+ * Files are opened with the sequential-access hint where the platform has one (posix_fadvise on
+ * Linux, F_RDAHEAD on macOS). The device is the file system's st_dev, the volume serial number
+ * on Windows.
+ */
+class IoScheduler {
+public:
+    enum class Priority { Deck, Background };
+
+    static constexpr int BlockBytes = 2 << 20;
+    static constexpr int BlocksAhead = 2;
+
+    static IoScheduler& getInstance();
+
+private:
+    struct Device;
+
+public:
+    // One file read front to back
+    class ReadAhead {
+    public:
+        ReadAhead(const juce::File& file, Priority priority);
+        ~ReadAhead();
+
+        ReadAhead(const ReadAhead&) = delete;
+        ReadAhead& operator=(const ReadAhead&) = delete;
+
+        // The decoder is at sample `position` of `length`: the file is read to BlocksAhead blocks past it
+        void reached(juce::int64 position, juce::int64 length);
+        // Everything up to `end` bytes into the file
+        void readTo(juce::int64 end);
+        juce::int64 getFileBytes() const { return fileBytes; }
+
+    private:
+        bool readBlock(juce::int64 offset, int bytes);
+
+        Device* device{nullptr};
+        Priority priority;
+        juce::int64 fileBytes{0};
+        juce::int64 next{0};   // first byte not read yet
+        juce::HeapBlock<char> buffer;
+#if JUCE_WINDOWS
+        std::unique_ptr<juce::FileInputStream> stream;
+#else
+        int fd{-1};
+#endif
+    };
+
+private:
+    IoScheduler() = default;
+
+    Device& deviceFor(const juce::File& file);
+
+    std::mutex devicesMutex;
+    std::map<std::uint64_t, std::unique_ptr<Device>> devices;   // never removed: a handful at most
+};
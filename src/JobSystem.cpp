@@ -0,0 +1,136 @@
+#include "JobSystem.h"
+#include "AppConfig.h"
+#include "ThreadingPolicy.h"
+#include "EventTrace.h"
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
+#include <iostream>
+
+int JobSystem::workersFromSettings()
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const int cores = prefs.value("Performance/CpuCores", -1).toInt();
+    if (cores > 0) return cores;
+    return std::min(4, std::max(2, QThread::idealThreadCount() / 2));
+}
+
+JobSystem::JobSystem(int workerCount)
+    : workers(std::max(1, workerCount))
+{
+    pool.setMaxThreadCount(workers);
+    pool.setExpiryTimeout(30000);   // idle threads go after 30 s
+    std::cout << "JobSystem: " << workers << " workers (system has "
+              << QThread::idealThreadCount() << " cores)" << std::endl;
+}
+
+JobSystem::~JobSystem()
+{
+    shuttingDown.store(true);
+    pool.waitForDone();
+}
+
+JobSystem::JobId JobSystem::submit(Priority priority, CancelToken token, Work work, std::initializer_list<JobId> after)
+{
+    QMutexLocker locker(&lock);
+    const JobId id = nextId++;
+    Job& job = jobs[id];
+    job.priority = priority;
+    job.token = std::move(token);
+    job.work = std::move(work);
+    for (const JobId dependency : after) {
+        auto it = jobs.find(dependency);
+        if (it == jobs.end()) continue;   // finished already
+        it->second.dependents.push_back(id);
+        ++job.waitingFor;
+    }
+    if (priority != Priority::Background) deckJobs.fetch_add(1, std::memory_order_relaxed);
+    if (job.waitingFor == 0) ready[(size_t) priority].push_back(id);
+    dispatch();
+    return id;
+}
+
+void JobSystem::setLowPower(bool enabled)
+{
+    if (lowPower.exchange(enabled) == enabled) return;
+    std::cout << "JobSystem: " << (enabled ? "low power, background jobs one at a time" : "full worker count") << std::endl;
+    // Background jobs held back by the limit can start now
+    QMutexLocker locker(&lock);
+    dispatch();
+}
+
+JobSystem::Load JobSystem::getLoad()
+{
+    QMutexLocker locker(&lock);
+    Load load;
+    for (const auto& queue : ready) load.ready += (int) queue.size();
+    load.running = running;
+    load.waiting = (int) jobs.size() - load.ready - running;
+    return load;
+}
+
+void JobSystem::dispatch()
+{
+    while (running < workers) {
+        std::deque<JobId>* queue = nullptr;
+        for (size_t p = 0; p < ready.size() && queue == nullptr; ++p) {
+            if (ready[p].empty()) continue;
+            // The last worker stays free for deck work; in low power, one background job at a time
+            if (p == (size_t) Priority::Background
+                && ((workers > 1 && runningBackground >= workers - 1)
+                    || (lowPower.load(std::memory_order_relaxed) && runningBackground >= 1))) break;
+            queue = &ready[p];
+        }
+        if (queue == nullptr) return;
+
+        const JobId id = queue->front();
+        queue->pop_front();
+        ++running;
+        if (jobs.at(id).priority == Priority::Background) ++runningBackground;
+        // Never more started than the pool has threads, so nothing waits in the pool's own queue
+        pool.start([this, id] { execute(id); });
+    }
+}
+
+void JobSystem::execute(JobId id)
+{
+    Priority priority;
+    CancelToken token;
+    Work work;
+    {
+        QMutexLocker locker(&lock);
+        Job& job = jobs.at(id);
+        priority = job.priority;
+        token = job.token;
+        work = std::move(job.work);
+    }
+
+    const bool idle = priority == Priority::Background && lowPower.load(std::memory_order_relaxed);
+    QThread::currentThread()->setPriority(idle ? QThread::IdlePriority
+                                          : priority == Priority::Background ? QThread::LowestPriority
+                                                                             : QThread::LowPriority);
+    ThreadingPolicy::getInstance().applyToWorkerThread();
+    EventTrace::attachCurrentThread("Job worker");
+    if (!token.isCancelled() && !shuttingDown.load(std::memory_order_relaxed)) {
+        EVENT_TRACE_SCOPE(priority == Priority::DeckLoad ? "Job: deck load"
+                          : priority == Priority::DeckAnalysis ? "Job: deck analysis" : "Job: background", "jobs");
+        try {
+            work(token);
+        } catch (const std::exception& e) {
+            std::cout << "JobSystem: job failed: " << e.what() << std::endl;
+        }
+    }
+    work = nullptr;   // captured state goes before the dependents start
+
+    QMutexLocker locker(&lock);
+    auto it = jobs.find(id);
+    for (const JobId next : it->second.dependents) {
+        Job& dependent = jobs.at(next);
+        if (--dependent.waitingFor == 0) ready[(size_t) dependent.priority].push_back(next);
+    }
+    jobs.erase(it);
+    if (priority != Priority::Background) deckJobs.fetch_sub(1, std::memory_order_relaxed);
+    if (priority == Priority::Background) --runningBackground;
+    --running;
+    dispatch();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QMutex>
+#include <QThreadPool>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Background jobs for deck work: loading and decoding a track, analysing it, writing the caches.
+ *
+ * A job starts once every job it was submitted after has finished, so a load, its beat analysis
+ * and the cache write form one chain without the tasks starting each other. Ready jobs run in
+ * priority order: deck loads, then their analysis, then background work, which never occupies the
+ * last worker so a deck load always finds one free. Each job carries a CancelToken; one cancelled
+ * before it starts is skipped (its dependents still run and see whatever it left behind), one
+ * already running checks isCancelled() and stops early. A deck renews its CancelSource for every
+ * track loaded onto it, which drops what is still queued for the previous one. Worker count is
+ * Performance/CpuCores (auto: half the cores, 2 to 4). While deck work is pending, hasDeckWork()
+ * tells the library analysis to step aside. In low-power mode background jobs run one at a time
+ * at idle priority; deck loads and their analysis keep every worker.
+ */
+class JobSystem {
+public:
+    enum class Priority { DeckLoad = 0, DeckAnalysis, Background };
+
+    class CancelSource;
+    class CancelToken {
+    public:
+        CancelToken() = default;   // never cancelled
+        bool isCancelled() const noexcept { return flag && flag->load(std::memory_order_relaxed); }
+
+    private:
+        friend class CancelSource;
+        explicit CancelToken(std::shared_ptr<const std::atomic<bool>> f) : flag(std::move(f)) {}
+        std::shared_ptr<const std::atomic<bool>> flag;
+    };
+
+    class CancelSource {
+    public:
+        CancelSource() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+        CancelToken token() const { return CancelToken(flag); }
+        void cancel() noexcept { flag->store(true, std::memory_order_relaxed); }
+        // Cancels everything handed out so far; returns the token for what comes next
+        CancelToken renew() {
+            cancel();
+            flag = std::make_shared<std::atomic<bool>>(false);
+            return token();
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    using JobId = quint64;
+    using Work = std::function<void(const CancelToken&)>;
+
+    explicit JobSystem(int workers = workersFromSettings());
+    // Skips what hasn't started and waits for the running jobs
+    ~JobSystem();
+
+    // Any thread. Dependencies that already finished don't hold the job back.
+    JobId submit(Priority priority, CancelToken token, Work work, std::initializer_list<JobId> after = {});
+
+    // Deck loads or deck analysis queued, waiting or running; any thread
+    bool hasDeckWork() const noexcept { return deckJobs.load(std::memory_order_relaxed) > 0; }
+    bool waitForDone(int msecs) { return pool.waitForDone(msecs); }
+    int getWorkerCount() const { return workers; }
+    // Queue depths for telemetry; any thread (takes the lock briefly)
+    struct Load {
+        int ready{0};       // could start, waiting for a worker
+        int waiting{0};     // held back by a dependency
+        int running{0};
+    };
+    Load getLoad();
+    // Any thread
+    void setLowPower(bool enabled);
+
+    static int workersFromSettings();
+
+private:
+    struct Job {
+        Priority priority{Priority::Background};
+        CancelToken token;
+        Work work;
+        int waitingFor{0};               // unfinished dependencies
+        std::vector<JobId> dependents;
+    };
+
+    // Starts ready jobs while workers are free; lock held
+    void dispatch();
+    void execute(JobId id);
+
+    const int workers;
+    QThreadPool pool;
+    QMutex lock;
+    std::unordered_map<JobId, Job> jobs;   // submitted, not finished
+    std::array<std::deque<JobId>, 3> ready;
+    JobId nextId{1};
+    int running{0};
+    int runningBackground{0};
+    std::atomic<int> deckJobs{0};
+    std::atomic<bool> shuttingDown{false};
+    std::atomic<bool> lowPower{false};
+};
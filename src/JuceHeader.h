@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * The JUCE modules the engine builds against, in place of a generated JuceHeader.h.
+ *
+ * juce_generate_juce_header() only works for JUCE targets, and pulsedj_engine is a plain static
+ * library, so the engine, the app and the benchmarks all include this one. It lists exactly the
+ * modules pulsedj_engine links; a module added there gets its header added here.
+ */
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include <juce_events/juce_events.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_dsp/juce_dsp.h>
+#include <juce_osc/juce_osc.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+ using namespace juce;
+#endif
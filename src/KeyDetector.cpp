@@ -0,0 +1,140 @@
+#include "KeyDetector.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace {
+    // Krumhansl-Kessler key profiles, tonic first
+    constexpr double MajorProfile[12] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+    constexpr double MinorProfile[12] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+    constexpr const char* PitchNames[12] = { "C", "C#", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B" };
+
+    double correlate(const std::array<double, 12>& chroma, const double* profile, int tonic)
+    {
+        double meanC = 0.0, meanP = 0.0;
+        for (int i = 0; i < 12; ++i) { meanC += chroma[(size_t) i]; meanP += profile[i]; }
+        meanC /= 12.0; meanP /= 12.0;
+        double num = 0.0, varC = 0.0, varP = 0.0;
+        for (int i = 0; i < 12; ++i) {
+            const double c = chroma[(size_t) ((tonic + i) % 12)] - meanC;
+            const double p = profile[i] - meanP;
+            num += c * p; varC += c * c; varP += p * p;
+        }
+        return (varC > 0.0 && varP > 0.0) ? num / std::sqrt(varC * varP) : 0.0;
+    }
+
+    // Camelot wheel position (1-12) of a major key's tonic; the relative minor shares it
+    int camelotNumber(int majorTonic) { return (majorTonic * 7 % 12 + 7) % 12 + 1; }
+}
+
+void KeyDetector::prepare(double sampleRate, int fftSize)
+{
+    chroma.fill(0.0);
+    frames = 0;
+    const int numBins = fftSize / 2 + 1;
+    binPitchClass.assign((size_t) numBins, -1);
+    for (int k = 1; k < numBins; ++k) {
+        const double hz = k * sampleRate / fftSize;
+        if (hz < MinHz || hz > MaxHz) continue;
+        // MIDI note 69 = A4; pitch class 0 = C
+        const int midi = (int) std::lround(69.0 + 12.0 * std::log2(hz / 440.0));
+        binPitchClass[(size_t) k] = ((midi % 12) + 12) % 12;
+    }
+}
+
+void KeyDetector::addSpectrum(const float* magnitudes, int numBins)
+{
+    std::array<double, 12> frame{};
+    double total = 0.0;
+    const int n = std::min(numBins, (int) binPitchClass.size());
+    for (int k = 0; k < n; ++k) {
+        const int pc = binPitchClass[(size_t) k];
+        if (pc < 0) continue;
+        frame[(size_t) pc] += magnitudes[k];
+        total += magnitudes[k];
+    }
+    if (total <= 1.0e-9) return;
+    for (int i = 0; i < 12; ++i) chroma[(size_t) i] += frame[(size_t) i] / total;
+    ++frames;
+}
+
+int KeyDetector::estimate() const
+{
+    if (frames == 0) return -1;
+    int best = -1;
+    double bestScore = -2.0;
+    for (int tonic = 0; tonic < 12; ++tonic) {
+        const double major = correlate(chroma, MajorProfile, tonic);
+        const double minor = correlate(chroma, MinorProfile, tonic);
+        if (major > bestScore) { bestScore = major; best = tonic; }
+        if (minor > bestScore) { bestScore = minor; best = 12 + tonic; }
+    }
+    return best;
+}
+
+std::string KeyDetector::getCamelot(int key)
+{
+    if (key < 0 || key >= NumKeys) return {};
+    const bool minor = key >= 12;
+    const int majorTonic = minor ? (key - 12 + 3) % 12 : key;
+    return std::to_string(camelotNumber(majorTonic)) + (minor ? "A" : "B");
+}
+
+std::array<int, 4> KeyDetector::getCompatible(int key)
+{
+    std::array<int, 4> keys{ -1, -1, -1, -1 };
+    if (key < 0 || key >= NumKeys) return keys;
+    const std::string camelot = getCamelot(key);
+    const int number = std::atoi(camelot.c_str());
+    const char letter = camelot.back();
+    keys[0] = key;
+    keys[1] = parse(std::to_string(number % 12 + 1) + letter);
+    keys[2] = parse(std::to_string((number + 10) % 12 + 1) + letter);
+    keys[3] = parse(std::to_string(number) + (letter == 'A' ? 'B' : 'A'));
+    return keys;
+}
+
+std::string KeyDetector::getName(int key)
+{
+    if (key < 0 || key >= NumKeys) return {};
+    return std::string(PitchNames[key % 12]) + (key >= 12 ? "m" : "");
+}
+
+int KeyDetector::parse(const std::string& text)
+{
+    std::string s;
+    for (char c : text)
+        if (!std::isspace((unsigned char) c)) s += c;
+    if (s.empty()) return -1;
+
+    // Camelot: 1-12 followed by A (minor) or B (major)
+    if (std::isdigit((unsigned char) s[0])) {
+        size_t pos = 0;
+        while (pos < s.size() && std::isdigit((unsigned char) s[pos])) ++pos;
+        const int number = std::atoi(s.substr(0, pos).c_str());
+        if (number < 1 || number > 12 || pos + 1 != s.size()) return -1;
+        const char letter = (char) std::toupper((unsigned char) s[pos]);
+        if (letter != 'A' && letter != 'B') return -1;
+        for (int tonic = 0; tonic < 12; ++tonic)
+            if (camelotNumber(tonic) == number) return letter == 'B' ? tonic : 12 + (tonic + 9) % 12;
+        return -1;
+    }
+
+    // Note name, accidental, then an optional mode
+    static constexpr int Naturals[7] = { 9, 11, 0, 2, 4, 5, 7 };   // A..G
+    const char letter = (char) std::toupper((unsigned char) s[0]);
+    if (letter < 'A' || letter > 'G') return -1;
+    int pc = Naturals[letter - 'A'];
+    size_t pos = 1;
+    if (pos < s.size() && (s[pos] == '#' || s[pos] == 'b')) {
+        pc += s[pos] == '#' ? 1 : -1;
+        ++pos;
+    }
+    pc = (pc + 12) % 12;
+
+    std::string mode = s.substr(pos);
+    std::transform(mode.begin(), mode.end(), mode.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+    if (mode.empty() || mode == "maj" || mode == "major") return pc;
+    if (mode == "m" || mode == "min" || mode == "minor") return 12 + pc;
+    return -1;
+}
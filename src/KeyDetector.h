@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ * Musical key from a chromagram, fed with the magnitude spectra the onset engine already computes.
+ *
+ * Spectrum bins between MinHz and MaxHz are folded onto the 12 pitch classes (A4 = 440 Hz),
+ * each frame normalised so loud passages don't outvote the rest, and summed over the analysed
+ * window. The estimate is the major / minor Krumhansl-Kessler profile that correlates best
+ * with the summed chroma. Keys are indices 0-11 (C..B major) and 12-23 (C..B minor).
+ */
+class KeyDetector {
+public:
+    static constexpr int NumKeys = 24;
+    static constexpr double MinHz = 65.0;
+    static constexpr double MaxHz = 5000.0;
+
+    void prepare(double sampleRate, int fftSize);
+    // numBins = fftSize / 2 + 1 magnitudes of one frame
+    void addSpectrum(const float* magnitudes, int numBins);
+    // -1 until a frame with energy was added
+    int estimate() const;
+
+    // "8B", "8A", ... ("" for -1)
+    static std::string getCamelot(int key);
+    // "C", "Am", "F#m", ...
+    static std::string getName(int key);
+    // Camelot ("8A") or a key name from a tag ("Am", "C# minor", "Dbmaj"); -1 if not a key
+    static int parse(const std::string& text);
+    // Keys that mix harmonically with key: itself, one step either way on the Camelot wheel
+    // and its relative major / minor (all -1 for -1)
+    static std::array<int, 4> getCompatible(int key);
+
+private:
+    std::vector<int> binPitchClass;   // -1 outside MinHz..MaxHz
+    std::array<double, 12> chroma{};
+    int frames{0};
+};
@@ -0,0 +1,78 @@
+#include "KeylockGovernor.h"
+#include "DeckMixer.h"
+
+#include <algorithm>
+#include <iostream>
+
+void KeylockGovernor::addDeck(DJAudioPlayer* player, int mixerChannel) {
+    if (player == nullptr || mixerChannel < 0) return;
+    decks.push_back({ player, mixerChannel, 0.0f });
+}
+
+void KeylockGovernor::tick(DeckMixer& mixer) {
+    // Deferred switches (requested while another one was still fading) start from here
+    for (auto& deck : decks)
+        deck.player->serviceKeylockSwitch();
+
+    const double bufferMs = mixer.getBufferDurationMs();
+    if (bufferMs <= 0.0) return;
+
+    // Serial rendering adds the decks up; in parallel mode the slowest deck sets the deadline
+    float totalMs = 0.0f, maxMs = 0.0f;
+    for (auto& deck : decks) {
+        deck.peakMs = mixer.getChannelPeakRenderMs(deck.mixerChannel);
+        totalMs += deck.peakMs;
+        maxMs = std::max(maxMs, deck.peakMs);
+    }
+    mixer.resetRenderStats();
+    lastLoad = (float) ((mixer.isParallelRendering() ? maxMs : totalMs) / bufferMs);
+
+    if (!enabled) return;
+    if (cooldownTicks > 0) { --cooldownTicks; return; }
+
+    // A key shift runs the stretcher too, keylock or not
+    auto keylocked = [](const Deck& d) {
+        return (d.player->isKeylockEnabled() || d.player->getKeyShift() != 0.0) && !d.player->isKeylockSwitchPending();
+    };
+
+    if (lastLoad > overloadLoad) {
+        headroomTicks = 0;
+        if (++overloadTicks < overloadTicksToStepDown) return;
+        overloadTicks = 0;
+
+        // Lower the most expensive deck that still has a cheaper profile
+        Deck* target = nullptr;
+        for (auto& deck : decks) {
+            if (!keylocked(deck) || deck.player->getKeylockQuality() == Quality::Fast) continue;
+            if (target == nullptr || deck.peakMs > target->peakMs) target = &deck;
+        }
+        if (target == nullptr) return;
+
+        const auto lower = (Quality) ((int) target->player->getKeylockQuality() - 1);
+        std::cout << "KeylockGovernor: load " << lastLoad << " - stepping deck " << target->mixerChannel
+                  << " down to profile " << (int) lower << std::endl;
+        target->player->setKeylockQuality(lower);
+        cooldownTicks = cooldownAfterChange;
+    } else if (lastLoad < headroomLoad) {
+        overloadTicks = 0;
+        if (++headroomTicks < headroomTicksToStepUp) return;
+        headroomTicks = 0;
+
+        // Raise the cheapest deck first, never above the preferred profile
+        Deck* target = nullptr;
+        for (auto& deck : decks) {
+            if (!keylocked(deck) || deck.player->getKeylockQuality() >= preferred) continue;
+            if (target == nullptr || deck.player->getKeylockQuality() < target->player->getKeylockQuality()) target = &deck;
+        }
+        if (target == nullptr) return;
+
+        const auto higher = (Quality) ((int) target->player->getKeylockQuality() + 1);
+        std::cout << "KeylockGovernor: load " << lastLoad << " - stepping deck " << target->mixerChannel
+                  << " up to profile " << (int) higher << std::endl;
+        target->player->setKeylockQuality(higher);
+        cooldownTicks = cooldownAfterChange;
+    } else {
+        overloadTicks = 0;
+        headroomTicks = 0;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "DJAudioPlayer.h"
+#include <vector>
+
+class DeckMixer;
+
+/**
+ * Steps keylock quality down when the audio callback runs out of headroom, and back up when
+ * there is room again.
+ *
+ * Ticked from a UI timer. Each tick reads the per-deck render times the DeckMixer collected
+ * since the last tick and compares them with the buffer duration. A sustained overload lowers
+ * the most expensive keylocked deck by one profile; sustained headroom raises the cheapest one
+ * back towards the user's preferred profile. Quality changes go through
+ * DJAudioPlayer::setKeylockQuality(), which cross-fades between stretchers, so a step never
+ * drops audio.
+ */
+class KeylockGovernor {
+public:
+    using Quality = DJAudioPlayer::KeylockQuality;
+
+    void addDeck(DJAudioPlayer* player, int mixerChannel);
+    void clearDecks() { decks.clear(); }
+    void setPreferredQuality(Quality q) { preferred = q; }
+    Quality getPreferredQuality() const { return preferred; }
+    void setEnabled(bool shouldRun) { enabled = shouldRun; }
+    bool isEnabled() const { return enabled; }
+
+    // UI thread, every ~500 ms
+    void tick(DeckMixer& mixer);
+
+    // Load of the last tick (render time / buffer time), for display
+    float getLastLoad() const { return lastLoad; }
+
+private:
+    struct Deck {
+        DJAudioPlayer* player{nullptr};
+        int mixerChannel{-1};
+        float peakMs{0.0f};
+    };
+
+    std::vector<Deck> decks;
+    Quality preferred{Quality::Quality};
+    bool enabled{true};
+
+    int overloadTicks{0};
+    int headroomTicks{0};
+    int cooldownTicks{0};
+    float lastLoad{0.0f};
+
+    static constexpr float overloadLoad = 0.80f;   // peak render time vs. buffer duration
+    static constexpr float headroomLoad = 0.40f;
+    static constexpr int overloadTicksToStepDown = 2;
+    static constexpr int headroomTicksToStepUp = 10;
+    static constexpr int cooldownAfterChange = 4;
+};
@@ -0,0 +1,155 @@
+#include "LatencyCalibrator.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+LatencyCalibrator::LatencyCalibrator() = default;
+
+void LatencyCalibrator::audioDeviceAboutToStart(juce::AudioIODevice* device)
+{
+    deviceName = device->getName();
+    sampleRate = device->getCurrentSampleRate();
+    blockSize = device->getCurrentBufferSizeSamples();
+    reportedInputSamples = device->getInputLatencyInSamples();
+    reportedOutputSamples = device->getOutputLatencyInSamples();
+
+    // Hann-windowed linear sweep: a sharp correlation peak that survives speakers and rooms
+    const int chirpLength = std::max(64, (int) std::lround(ChirpSeconds * sampleRate));
+    const double f0 = 500.0, f1 = std::min(8000.0, 0.4 * sampleRate);
+    const double duration = chirpLength / sampleRate;
+    chirp.assign((size_t) chirpLength, 0.0f);
+    for (int i = 0; i < chirpLength; ++i) {
+        const double t = i / sampleRate;
+        const double phase = juce::MathConstants<double>::twoPi * (f0 * t + (f1 - f0) * t * t / (2.0 * duration));
+        const double window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * i / (chirpLength - 1));
+        chirp[(size_t) i] = (float) (ChirpLevel * window * std::sin(phase));
+    }
+
+    // One extra interval so the last ping's echo is in the recording too
+    intervalSamples = (int) std::lround(PingIntervalSeconds * sampleRate);
+    recording.assign((size_t) intervalSamples * (NumPings + 1), 0.0f);
+    position.store(0, std::memory_order_relaxed);
+    sawInput.store(false, std::memory_order_relaxed);
+    finished.store(false, std::memory_order_release);
+
+    std::cout << "LatencyCalibrator: " << deviceName << ", " << blockSize << " samples @ " << sampleRate
+              << " Hz, reported in " << reportedInputSamples << " / out " << reportedOutputSamples << " samples" << std::endl;
+}
+
+void LatencyCalibrator::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                                         float* const* outputChannelData, int numOutputChannels,
+                                                         int numSamples, const juce::AudioIODeviceCallbackContext&)
+{
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        if (outputChannelData[ch] != nullptr)
+            juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+    if (recording.empty() || finished.load(std::memory_order_relaxed)) return;
+
+    const juce::int64 start = position.load(std::memory_order_relaxed);
+    const juce::int64 length = (juce::int64) recording.size();
+    const juce::int64 pingsEnd = (juce::int64) intervalSamples * NumPings;
+    const int n = (int) std::min<juce::int64>(numSamples, length - start);
+
+    // Output and input of one callback share sample indices, so the lag found later is the
+    // whole loop: output buffering, converters, the cable or room, and input buffering.
+    for (int i = 0; i < n; ++i) {
+        const juce::int64 pos = start + i;
+        const int inPing = (int) (pos % intervalSamples);
+        const float sample = (pos < pingsEnd && inPing < (int) chirp.size()) ? chirp[(size_t) inPing] : 0.0f;
+        for (int ch = 0; ch < numOutputChannels; ++ch)
+            if (outputChannelData[ch] != nullptr) outputChannelData[ch][i] = sample;
+
+        float in = 0.0f;
+        for (int ch = 0; ch < numInputChannels; ++ch)
+            if (inputChannelData[ch] != nullptr) in += inputChannelData[ch][i];
+        recording[(size_t) pos] = in;
+    }
+    if (numInputChannels > 0) sawInput.store(true, std::memory_order_relaxed);
+
+    position.store(start + n, std::memory_order_relaxed);
+    if (start + n >= length) finished.store(true, std::memory_order_release);
+}
+
+double LatencyCalibrator::getProgress() const
+{
+    if (recording.empty()) return 0.0;
+    return juce::jlimit(0.0, 1.0, (double) position.load(std::memory_order_relaxed) / (double) recording.size());
+}
+
+LatencyCalibrator::Result LatencyCalibrator::analyse() const
+{
+    Result result;
+    result.deviceName = deviceName;
+    result.sampleRate = sampleRate;
+    result.blockSize = blockSize;
+    result.reportedInputSamples = reportedInputSamples;
+    result.reportedOutputSamples = reportedOutputSamples;
+
+    if (!finished.load(std::memory_order_acquire)) {
+        result.error = recording.empty() ? "the audio device never started" : "the measurement did not finish";
+        return result;
+    }
+    if (!sawInput.load(std::memory_order_relaxed)) {
+        result.error = "the audio device has no active input channels";
+        return result;
+    }
+
+    // Matched filter per ping over one interval of lags, with the correlation's RMS as the noise floor
+    const int chirpLength = (int) chirp.size();
+    const int maxLag = intervalSamples;
+    std::vector<int> lags;
+    std::vector<double> snrs;
+    std::vector<float> corr((size_t) maxLag);
+    for (int ping = 0; ping < NumPings; ++ping) {
+        const float* segment = recording.data() + (size_t) ping * intervalSamples;
+        double peak = 0.0, sumSquares = 0.0;
+        int peakLag = 0;
+        for (int lag = 0; lag < maxLag; ++lag) {
+            const float* x = segment + lag;
+            double acc = 0.0;
+            for (int i = 0; i < chirpLength; ++i) acc += (double) chirp[(size_t) i] * x[i];
+            corr[(size_t) lag] = (float) acc;
+            sumSquares += acc * acc;
+            if (std::abs(acc) > peak) { peak = std::abs(acc); peakLag = lag; }
+        }
+        const double rms = std::sqrt(sumSquares / maxLag);
+        const double snr = rms > 0.0 ? 20.0 * std::log10(peak / rms) : 0.0;
+        if (snr >= MinSignalToNoiseDb) {
+            lags.push_back(peakLag);
+            snrs.push_back(snr);
+        }
+    }
+
+    if ((int) lags.size() < NumPings / 2) {
+        result.error = "the test signal did not come back on the inputs (heard " + juce::String((int) lags.size())
+                     + " of " + juce::String(NumPings) + " pings); check the loopback cable or microphone and the input level";
+        return result;
+    }
+
+    std::vector<int> sorted = lags;
+    std::nth_element(sorted.begin(), sorted.begin() + (std::ptrdiff_t) sorted.size() / 2, sorted.end());
+    const int median = sorted[sorted.size() / 2];
+    const int tolerance = std::max(1, (int) std::lround(sampleRate / 1000.0));
+    double weakest = 0.0;
+    for (size_t i = 0; i < lags.size(); ++i) {
+        if (std::abs(lags[i] - median) > tolerance) continue;
+        weakest = result.pingsFound == 0 ? snrs[i] : std::min(weakest, snrs[i]);
+        ++result.pingsFound;
+    }
+    if (result.pingsFound < NumPings / 2) {
+        result.error = "the pings came back at inconsistent delays (" + juce::String(result.pingsFound) + " of "
+                     + juce::String(NumPings) + " agree); reduce background noise or use a loopback cable";
+        return result;
+    }
+
+    result.roundTripSamples = median;
+    result.signalToNoiseDb = weakest;
+    const int unreported = median - reportedInputSamples - reportedOutputSamples;
+    result.outputLatencySamples = std::max(0, reportedOutputSamples + unreported / 2);
+    result.valid = true;
+
+    std::cout << "LatencyCalibrator: round trip " << median << " samples (" << result.toMs(median) << " ms), "
+              << result.pingsFound << "/" << NumPings << " pings, weakest " << weakest << " dB, output latency "
+              << result.outputLatencySamples << " samples (" << result.toMs(result.outputLatencySamples) << " ms)" << std::endl;
+    return result;
+}
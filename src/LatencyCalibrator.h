@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * Measures the real output latency of the running device with a loopback ping.
+ *
+ * Installed as the device callback in place of the DeckMixer for a few seconds. It plays
+ * NumPings short chirps on every output, records what comes back on the inputs (a loopback
+ * cable, or a microphone at the speakers), and analyse() matches each chirp in the recording.
+ * The median lag is the round trip from the callback writing a sample to the callback reading
+ * it back in.
+ *
+ * Drivers only report their own buffering, and some report nothing. The part of the round
+ * trip the device does not account for (converters, USB, DSP in the interface) is split evenly
+ * between input and output, because nothing tells the two apart from one loop. The DeckMixer
+ * uses the resulting output latency for the heard-at time of its playhead snapshots.
+ */
+class LatencyCalibrator : public juce::AudioIODeviceCallback {
+public:
+    static constexpr int NumPings = 8;
+    static constexpr double PingIntervalSeconds = 0.4;   // also the longest round trip it can see
+    static constexpr double ChirpSeconds = 0.02;
+    static constexpr float ChirpLevel = 0.25f;           // -12 dBFS
+    static constexpr double MinSignalToNoiseDb = 12.0;
+
+    struct Result {
+        bool valid{false};
+        juce::String error;
+        juce::String deviceName;
+        double sampleRate{0.0};
+        int blockSize{0};
+        int roundTripSamples{0};        // median over the pings that were found
+        int reportedInputSamples{0};
+        int reportedOutputSamples{0};
+        int outputLatencySamples{0};    // reported output plus half the unreported rest
+        int pingsFound{0};              // within a millisecond of the median
+        double signalToNoiseDb{0.0};    // of the weakest ping that was used
+
+        double toMs(int samples) const { return sampleRate > 0.0 ? 1000.0 * samples / sampleRate : 0.0; }
+    };
+
+    LatencyCalibrator();
+
+    // Any thread
+    bool isFinished() const { return finished.load(std::memory_order_acquire); }
+    double getProgress() const;
+
+    // UI thread, once isFinished() (or to explain why it never got there)
+    Result analyse() const;
+
+    // AudioIODeviceCallback
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                          float* const* outputChannelData, int numOutputChannels,
+                                          int numSamples, const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override {}
+
+private:
+    std::vector<float> chirp;
+    std::vector<float> recording;   // sum of all inputs, sample-aligned with what was played
+    int intervalSamples{0};
+    std::atomic<juce::int64> position{0};
+    std::atomic<bool> finished{false};
+    std::atomic<bool> sawInput{false};
+
+    juce::String deviceName;
+    double sampleRate{0.0};
+    int blockSize{0};
+    int reportedInputSamples{0};
+    int reportedOutputSamples{0};
+};
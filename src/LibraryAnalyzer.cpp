@@ -0,0 +1,158 @@
+#include "LibraryAnalyzer.h"
+#include "JobSystem.h"
+#include "ThreadingPolicy.h"
+#include "AppConfig.h"
+#include "BpmCache.h"
+#include "KeyDetector.h"
+#include "TrackAnalysis.h"
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
+#include <iostream>
+
+// Drains the queue until it's empty or the service stops
+class LibraryAnalyzer::Worker : public QRunnable {
+public:
+    explicit Worker(LibraryAnalyzer& owner) : owner(owner) { setAutoDelete(true); }
+
+    void run() override {
+        ThreadingPolicy::getInstance().applyToWorkerThread();
+        QString file;
+        while (owner.takeNext(file)) {
+            QThread::currentThread()->setPriority(owner.lowPower.load(std::memory_order_relaxed)
+                                                  ? QThread::IdlePriority : QThread::LowestPriority);
+            owner.analyze(file);
+        }
+    }
+
+private:
+    LibraryAnalyzer& owner;
+};
+
+LibraryAnalyzer::LibraryAnalyzer(QObject* parent) : QObject(parent)
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const int cores = prefs.value("Performance/CpuCores", -1).toInt();
+    const int workers = cores > 0 ? cores : std::max(1, QThread::idealThreadCount() - 2);
+    pool.setMaxThreadCount(workers);
+    pool.setExpiryTimeout(30000);
+    std::cout << "LibraryAnalyzer: " << workers << " worker(s)" << std::endl;
+}
+
+LibraryAnalyzer::~LibraryAnalyzer()
+{
+    stopping.store(true);
+    {
+        QMutexLocker lock(&queueLock);
+        queue.clear();
+    }
+    pool.waitForDone();
+}
+
+void LibraryAnalyzer::enqueue(const QStringList& files)
+{
+    {
+        QMutexLocker lock(&queueLock);
+        for (const auto& file : files) {
+            if (file.isEmpty() || known.contains(file)) continue;
+            known.insert(file);
+            queue.push_back(file);
+        }
+    }
+    startWorkers();
+}
+
+void LibraryAnalyzer::promote(const QString& file)
+{
+    if (file.isEmpty()) return;
+    {
+        QMutexLocker lock(&queueLock);
+        auto it = std::find(queue.begin(), queue.end(), file);
+        if (it != queue.end()) queue.erase(it);
+        else if (known.contains(file)) return;   // analysed already (or in flight)
+        known.insert(file);
+        queue.push_front(file);
+    }
+    startWorkers();
+}
+
+int LibraryAnalyzer::getPendingCount() const
+{
+    QMutexLocker lock(&queueLock);
+    return (int) queue.size();
+}
+
+void LibraryAnalyzer::setLowPower(bool enabled)
+{
+    if (lowPower.exchange(enabled) == enabled) return;
+    std::cout << "LibraryAnalyzer: " << (enabled ? "low power, one idle-priority worker" : "full worker count") << std::endl;
+    // Leaving low power: bring the other workers back for what is queued
+    if (!enabled) startWorkers();
+}
+
+void LibraryAnalyzer::startWorkers()
+{
+    QMutexLocker lock(&queueLock);
+    const int limit = lowPower.load(std::memory_order_relaxed) ? 1 : pool.maxThreadCount();
+    while (!isStopping() && activeWorkers < limit && activeWorkers < (int) queue.size()) {
+        ++activeWorkers;
+        pool.start(new Worker(*this));
+    }
+}
+
+bool LibraryAnalyzer::takeNext(QString& file)
+{
+    QMutexLocker lock(&queueLock);
+    // In low power every worker but one leaves after its track
+    if (isStopping() || queue.empty() || (lowPower.load(std::memory_order_relaxed) && activeWorkers > 1)) {
+        --activeWorkers;
+        return false;
+    }
+    file = queue.front();
+    queue.pop_front();
+    return true;
+}
+
+void LibraryAnalyzer::waitForHeadroom() const
+{
+    const JobSystem* jobs = deckJobs.load(std::memory_order_relaxed);
+    while (!isStopping() && (callbackLoad.load(std::memory_order_relaxed) > BusyLoad
+                             || (jobs != nullptr && jobs->hasDeckWork())))
+        QThread::msleep(100);
+}
+
+void LibraryAnalyzer::analyze(const QString& path)
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    TrackAnalysis::Options options;
+    options.beatGrid = prefs.value("Library/DeepAnalysis", true).toBool();
+    options.waveform = prefs.value("Library/AutoCreateWaveforms", true).toBool();
+    options.fingerprint = prefs.value("Library/DetectDuplicates", true).toBool();
+    if (!options.beatGrid && !options.waveform && !options.fingerprint) return;
+    // Loudness for AUTO GAIN rides along with the deep analysis
+    options.loudness = options.beatGrid && prefs.value("Decks/AutoGainAdjust", true).toBool();
+    options.pace = [this] { waitForHeadroom(); };
+    options.shouldStop = [this] { return isStopping(); };
+
+    const BpmCache bpmCache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString()));
+    const auto result = TrackAnalysis::run(juce::File(path.toStdString()), bpmCache, options);
+    if (result.status == TrackAnalysis::Status::Busy) {
+        // The deck's pass fills the caches; the file comes round again with the next enqueue
+        QMutexLocker lock(&queueLock);
+        known.remove(path);
+        return;
+    }
+    if (!isStopping() && options.beatGrid && (result.bpmFromCache || result.status == TrackAnalysis::Status::Analysed))
+        emit trackAnalyzed(path, result.bpm, QString::fromStdString(KeyDetector::getCamelot(result.key)));
+
+    if (isStopping() || result.fingerprint.empty()) return;
+    const juce::String file(path.toStdString());
+    const auto matches = fingerprints.find(result.fingerprint, file);
+    fingerprints.add(file, result.fingerprint);
+    if (matches.empty()) return;
+    QStringList duplicates;
+    for (const auto& match : matches) duplicates.append(QString::fromStdString(match.path.toStdString()));
+    emit duplicatesFound(path, duplicates);
+}
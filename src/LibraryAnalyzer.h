@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QObject>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <deque>
+#include "FingerprintIndex.h"
+
+class JobSystem;
+
+/**
+ * Background analysis of the whole library: BPM / beat grid (BpmCache) and the waveform summary
+ * (WaveformCache) for every track that has neither yet, so loading it onto a deck later is a
+ * cache hit. Each track is one TrackAnalysis pass, the same one pulsedj-analyze runs.
+ *
+ * Tracks are queued in library order and analysed by Performance/CpuCores workers (auto: all
+ * cores but two) at the lowest thread priority, one decode pass per track. promote() moves a
+ * track to the front, e.g. when it is dropped on a deck. A file whose waveform is already being
+ * analysed elsewhere (a deck's load pass) is left to that pass. While the audio callback is
+ * busier than BusyLoad, or while a deck load or its analysis is pending in the window's
+ * JobSystem, workers pause between decode blocks. Library/DeepAnalysis and
+ * Library/AutoCreateWaveforms select what is computed; both off disables the service. The key
+ * detected in the BPM pass is stored with the beat grid and reported for the Camelot column.
+ * With Library/DetectDuplicates (default on) every track's acoustic fingerprint, fresh or
+ * cached, goes into a FingerprintIndex, and the tracks it matches are reported as duplicates.
+ * In low-power mode (on battery) a single worker carries on at idle priority; the others
+ * finish their current track and exit.
+ */
+class LibraryAnalyzer : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr float BusyLoad = 0.6f;   // render time / buffer time
+
+    explicit LibraryAnalyzer(QObject* parent = nullptr);
+    ~LibraryAnalyzer() override;
+
+    // Files already queued or analysed are skipped
+    void enqueue(const QStringList& files);
+    void promote(const QString& file);
+
+    // Latest audio callback load, from the UI thread
+    void setCallbackLoad(float load) { callbackLoad.store(load, std::memory_order_relaxed); }
+    // Deck work to give way to; must outlive this analyzer
+    void setDeckJobs(const JobSystem* jobs) { deckJobs.store(jobs, std::memory_order_relaxed); }
+    // UI thread
+    void setLowPower(bool enabled);
+
+    int getPendingCount() const;
+    // Fingerprints of the tracks analysed so far; any thread
+    const FingerprintIndex& getFingerprints() const { return fingerprints; }
+
+signals:
+    // UI thread; bpm is 0 if only the waveform was computed or detection failed, camelotKey
+    // ("8A") empty if unknown. Also sent for tracks answered from the cache.
+    void trackAnalyzed(const QString& file, double bpm, const QString& camelotKey);
+    // UI thread; other library files holding the same recording as file, most similar first
+    void duplicatesFound(const QString& file, const QStringList& duplicates);
+
+private:
+    class Worker;
+
+    bool takeNext(QString& file);
+    void analyze(const QString& file);
+    void startWorkers();
+    void waitForHeadroom() const;
+    bool isStopping() const { return stopping.load(std::memory_order_relaxed); }
+
+    QThreadPool pool;
+    mutable QMutex queueLock;
+    std::deque<QString> queue;
+    QSet<QString> known;
+    int activeWorkers{0};
+    std::atomic<float> callbackLoad{0.0f};
+    std::atomic<const JobSystem*> deckJobs{nullptr};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> lowPower{false};
+    FingerprintIndex fingerprints;
+};
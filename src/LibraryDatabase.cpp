@@ -0,0 +1,122 @@
+#include "LibraryDatabase.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'L', 'I', 'B', '\0', '\0' };
+    constexpr quint32 MaxEntries = 1u << 24;
+
+    void writeTrack(QDataStream& out, const TrackInfo& track)
+    {
+        out << track.filePath << track.title << track.artist << track.album << track.genre << track.year
+            << track.duration << track.bpm << track.key << track.fileSize << track.modifiedMs << track.comment
+            << track.addedMs << track.uid << track.identity;
+    }
+
+    void readTrack(QDataStream& in, quint32 version, TrackInfo& track)
+    {
+        in >> track.filePath >> track.title >> track.artist >> track.album >> track.genre >> track.year
+           >> track.duration >> track.bpm >> track.key >> track.fileSize >> track.modifiedMs >> track.comment;
+        if (version >= 2) in >> track.addedMs;
+        else track.addedMs = track.modifiedMs;   // best guess for libraries from before
+        if (version >= 4) in >> track.uid >> track.identity;
+    }
+
+    void writeCrate(QDataStream& out, const SmartCrate& crate)
+    {
+        out << crate.name << crate.minBpm << crate.maxBpm << crate.keys << crate.genres << (qint32) crate.addedWithinDays
+            << crate.tracks;
+    }
+
+    void readCrate(QDataStream& in, quint32 version, SmartCrate& crate)
+    {
+        qint32 days = 0;
+        in >> crate.name >> crate.minBpm >> crate.maxBpm >> crate.keys >> crate.genres >> days;
+        crate.addedWithinDays = days;
+        if (version >= 3) in >> crate.tracks;
+    }
+}
+
+bool LibraryDatabase::load(const QString& filePath, Contents& contents)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < (qint64) sizeof(Magic) + 4) return false;
+
+    // One mapped read; falls back to a plain read where mapping isn't available
+    QByteArray data;
+    if (uchar* mapped = file.map(0, file.size()))
+        data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), (int) file.size());
+    else
+        data = file.readAll();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    char magic[sizeof(Magic)];
+    quint32 version = 0;
+    if (in.readRawData(magic, sizeof(magic)) != (int) sizeof(magic) || std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+        return false;
+    in >> version;
+    if (version < 1 || version > Version) return false;
+
+    Contents loaded;
+    quint32 numDirectories = 0, numTracks = 0;
+    in >> numDirectories;
+    if (in.status() != QDataStream::Ok || numDirectories > MaxEntries) return false;
+    loaded.directories.resize((int) numDirectories);
+    for (auto& dir : loaded.directories) in >> dir.path >> dir.modifiedMs;
+
+    in >> numTracks;
+    if (in.status() != QDataStream::Ok || numTracks > MaxEntries) return false;
+    loaded.tracks.reserve((int) numTracks);
+    for (quint32 i = 0; i < numTracks && in.status() == QDataStream::Ok; ++i) {
+        TrackInfo track;
+        readTrack(in, version, track);
+        loaded.tracks.append(std::move(track));
+    }
+    if (version >= 2) {
+        quint32 numCrates = 0;
+        in >> numCrates;
+        if (in.status() != QDataStream::Ok || numCrates > MaxEntries) return false;
+        loaded.crates.resize((int) numCrates);
+        for (auto& crate : loaded.crates) readCrate(in, version, crate);
+    }
+    if (in.status() != QDataStream::Ok) {
+        std::cout << "LibraryDatabase: " << filePath.toStdString() << " is truncated, ignoring it" << std::endl;
+        return false;
+    }
+
+    contents = std::move(loaded);
+    return true;
+}
+
+bool LibraryDatabase::save(const QString& filePath, const Contents& contents)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cout << "LibraryDatabase: failed to open " << filePath.toStdString() << std::endl;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.writeRawData(Magic, sizeof(Magic));
+    out << Version;
+    out << (quint32) contents.directories.size();
+    for (const auto& dir : contents.directories) out << dir.path << dir.modifiedMs;
+    out << (quint32) contents.tracks.size();
+    for (const auto& track : contents.tracks) writeTrack(out, track);
+    out << (quint32) contents.crates.size();
+    for (const auto& crate : contents.crates) writeCrate(out, crate);
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        std::cout << "LibraryDatabase: failed to write " << filePath.toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
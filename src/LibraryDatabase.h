@@ -0,0 +1,36 @@
+#pragma once
+
+#include "LibraryManager.h"
+#include <QString>
+#include <QVector>
+
+/**
+ * Binary on-disk store of the library, AppConfig::getLibraryIndexPath().
+ *
+ * Holds every track's tags and analysis results (BPM, key) together with its size and
+ * modification time, plus each scanned directory with its modification time at scan. On
+ * startup LibraryManager reads it in one mapped pass and only rescans the directories whose
+ * modification time moved, so an unchanged library costs no tag reads at all. The smart crate
+ * definitions are kept here too. Written through QSaveFile, so a crash mid-save leaves the
+ * previous file in place. Version 1 files (no crates, no date added), version 2 files (no
+ * crate track lists) and version 3 files (no track ids and identities) are still read.
+ */
+class LibraryDatabase {
+public:
+    static constexpr quint32 Version = 4;
+
+    struct Directory {
+        QString path;
+        qint64 modifiedMs = 0;
+    };
+
+    struct Contents {
+        QVector<TrackInfo> tracks;
+        QVector<Directory> directories;
+        QVector<SmartCrate> crates;
+    };
+
+    // False if missing, truncated or written by an unknown version
+    static bool load(const QString& filePath, Contents& contents);
+    static bool save(const QString& filePath, const Contents& contents);
+};
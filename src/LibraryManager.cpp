@@ -1,11 +1,34 @@
 #include "LibraryManager.h"
+#include "DirectoryListingCache.h"
+#include "AppConfig.h"
+#include "ArtworkCache.h"
+#include "BpmCache.h"
+#include "CollectionImporter.h"
+#include "ContentHash.h"
+#include "KeyDetector.h"
+#include "LibraryDatabase.h"
+#include "StemCache.h"
+#include "TagReader.h"
+#include "TrackDragMimeData.h"
+#include "WaveformCache.h"
+#include "WaveformThumbnails.h"
 #include <QApplication>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QLocale>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QSignalBlocker>
+#include <QSpinBox>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDirIterator>
 #include <QStandardPaths>
 #include <QSettings>
 #include <QSortFilterProxyModel>
+#include <QKeyEvent>
 #include <QMouseEvent>
 #include <QDrag>
 #include <QUrl>
@@ -21,99 +44,178 @@
 #include <QPushButton>
 #include <QComboBox>
 #include <QLineEdit>
+#include <QMenu>
+#include <QPainter>
 #include <QProgressBar>
+#include <QDateTime>
+#include <QSet>
+#include <QThreadPool>
+#include <QPointer>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <memory>
+#include <string>
 
 // JUCE includes for audio format reading and ID3 tag extraction
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_core/juce_core.h>
 
-// ID3LoaderThread Implementation
-ID3LoaderThread::ID3LoaderThread(const QStringList& files, juce::AudioFormatManager* formatManager, QObject* parent)
-    : QThread(parent), filesToProcess(files), audioFormatManager(formatManager)
+static const QStringList AudioNameFilters = {"*.mp3", "*.wav", "*.flac", "*.aac", "*.ogg", "*.m4a"};
+
+// AudioNameFilters as the DirectoryScanner takes them: ".mp3"
+static std::vector<std::string> audioExtensions()
 {
+    std::vector<std::string> extensions;
+    for (const QString& filter : AudioNameFilters) extensions.push_back(filter.mid(1).toStdString());
+    return extensions;
 }
 
-void ID3LoaderThread::run()
+QString TrackInfo::getCamelotString() const
 {
-    int current = 0;
-    int total = filesToProcess.size();
-    
-    for (const QString& filePath : filesToProcess) {
-        if (shouldStop) break;
-        
-        TrackInfo track = loadTrackInfo(filePath);
-        emit trackLoaded(track);
-        
-        current++;
-        emit progressUpdated(current, total);
-        
-        // Small delay to prevent UI blocking
-        msleep(1);
+    const int parsed = KeyDetector::parse(key.toStdString());
+    if (parsed >= 0) return QString::fromStdString(KeyDetector::getCamelot(parsed));
+    return key.isEmpty() ? "--" : key;
+}
+
+// TagScannerThread Implementation
+TagScannerThread::TagScannerThread(const QStringList& files, juce::AudioFormatManager* formatManager,
+                                   QHash<quint64, TrackInfo> moved, QObject* parent)
+    : QThread(parent), filesToProcess(files), audioFormatManager(formatManager), moved(std::move(moved))
+{
+}
+
+void TagScannerThread::run()
+{
+    QThreadPool pool;
+    const int workers = std::clamp(QThread::idealThreadCount(), 1, MaxWorkers);
+    pool.setMaxThreadCount(workers);
+    for (int i = 0; i < workers; ++i) {
+        pool.start([this]() { scanFiles(); });
     }
+    pool.waitForDone();
+    if (relinked > 0) std::cout << "LibraryManager: " << relinked.load() << " moved tracks relinked" << std::endl;
     
     emit finished();
 }
 
-TrackInfo ID3LoaderThread::loadTrackInfo(const QString& filePath)
+void TagScannerThread::scanFiles()
+{
+    const int total = filesToProcess.size();
+    QVector<TrackInfo> batch;
+    batch.reserve(BatchSize);
+    
+    auto flush = [&]() {
+        if (batch.isEmpty()) return;
+        const int done = filesDone.fetch_add(batch.size()) + batch.size();
+        emit tracksLoaded(batch);
+        emit progressUpdated(done, total);
+        batch.clear();
+    };
+    
+    for (int i = nextFile.fetch_add(1); i < total && !shouldStop; i = nextFile.fetch_add(1)) {
+        TrackInfo track = loadTrackInfo(filesToProcess[i]);
+        relink(track);
+        batch.append(track);
+        if (batch.size() >= BatchSize) flush();
+    }
+    flush();
+}
+
+TrackInfo TagScannerThread::loadTrackInfo(const QString& filePath) const
 {
     TrackInfo track(filePath);
+    auto toQt = [](const juce::String& s) { return QString::fromUtf8(s.toRawUTF8()); };
     
     try {
         juce::File audioFile(filePath.toStdString());
-        QFileInfo fileInfo(filePath);
         
-        // Basic file info
-        track.fileSize = fileInfo.size();
+        // Basic file info; the directory scan has it already
+        const auto known = knownStats.constFind(filePath);
+        if (known != knownStats.constEnd()) {
+            track.fileSize = known->size;
+            track.modifiedMs = known->modifiedMs;
+        } else {
+            QFileInfo fileInfo(filePath);
+            track.fileSize = fileInfo.size();
+            track.modifiedMs = fileInfo.lastModified().toMSecsSinceEpoch();
+            if (!fileInfo.exists()) {
+                return track;
+            }
+        }
+        track.identity = ContentHash::identityFor(audioFile);
         
-        if (!audioFile.exists()) {
-            return track;
+        TagReader::Tags tags;
+        tags.wantCoverArt = true;
+        const bool parsed = TagReader::read(audioFile, tags);
+        if (!tags.coverArt.isEmpty()) {
+            ArtworkCache::instance().storeCoverArt(filePath,
+                QByteArray::fromRawData((const char*) tags.coverArt.getData(), (int) tags.coverArt.getSize()));
+        }
+        if (parsed) {
+            track.title = toQt(tags.title);
+            track.artist = toQt(tags.artist);
+            track.album = toQt(tags.album);
+            track.genre = toQt(tags.genre);
+            track.year = toQt(tags.year);
+            track.comment = toQt(tags.comment);
+            track.key = toQt(tags.key);
+            track.bpm = tags.bpm;
+            track.duration = tags.durationSeconds;
         }
         
-        // Try to create a reader for the audio file
-        std::unique_ptr<juce::AudioFormatReader> reader(audioFormatManager->createReaderFor(audioFile));
+        // Decoder fallback: unknown containers, or no duration in the headers (raw AAC)
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        if (!parsed || track.duration <= 0.0) {
+            reader.reset(audioFormatManager->createReaderFor(audioFile));
+        }
         
         if (reader) {
             // Get duration
             if (reader->sampleRate > 0) {
                 track.duration = reader->lengthInSamples / reader->sampleRate;
             }
-            
+        }
+        
+        if (reader && !parsed) {
             // Try to get metadata from the reader
             juce::StringPairArray metadata = reader->metadataValues;
             
             // Extract ID3 tags
-            track.title = QString::fromStdString(metadata.getValue("TITLE", "").toStdString());
-            track.artist = QString::fromStdString(metadata.getValue("ARTIST", "").toStdString());
-            track.album = QString::fromStdString(metadata.getValue("ALBUM", "").toStdString());
-            track.genre = QString::fromStdString(metadata.getValue("GENRE", "").toStdString());
-            track.year = QString::fromStdString(metadata.getValue("YEAR", "").toStdString());
-            track.comment = QString::fromStdString(metadata.getValue("COMMENT", "").toStdString());
+            track.title = toQt(metadata.getValue("TITLE", ""));
+            track.artist = toQt(metadata.getValue("ARTIST", ""));
+            track.album = toQt(metadata.getValue("ALBUM", ""));
+            track.genre = toQt(metadata.getValue("GENRE", ""));
+            track.year = toQt(metadata.getValue("YEAR", ""));
+            track.comment = toQt(metadata.getValue("COMMENT", ""));
             
             // Try alternative tag names
             if (track.title.isEmpty()) {
-                track.title = QString::fromStdString(metadata.getValue("TIT2", "").toStdString());
+                track.title = toQt(metadata.getValue("TIT2", ""));
             }
             if (track.artist.isEmpty()) {
-                track.artist = QString::fromStdString(metadata.getValue("TPE1", "").toStdString());
+                track.artist = toQt(metadata.getValue("TPE1", ""));
             }
             if (track.album.isEmpty()) {
-                track.album = QString::fromStdString(metadata.getValue("TALB", "").toStdString());
+                track.album = toQt(metadata.getValue("TALB", ""));
             }
             if (track.genre.isEmpty()) {
-                track.genre = QString::fromStdString(metadata.getValue("TCON", "").toStdString());
+                track.genre = toQt(metadata.getValue("TCON", ""));
             }
             if (track.year.isEmpty()) {
-                track.year = QString::fromStdString(metadata.getValue("TYER", "").toStdString());
+                track.year = toQt(metadata.getValue("TYER", ""));
                 if (track.year.isEmpty()) {
-                    track.year = QString::fromStdString(metadata.getValue("TDRC", "").toStdString());
+                    track.year = toQt(metadata.getValue("TDRC", ""));
                 }
             }
             
             // Try to extract BPM
-            QString bpmStr = QString::fromStdString(metadata.getValue("BPM", "").toStdString());
+            QString bpmStr = toQt(metadata.getValue("BPM", ""));
             if (bpmStr.isEmpty()) {
-                bpmStr = QString::fromStdString(metadata.getValue("TBPM", "").toStdString());
+                bpmStr = toQt(metadata.getValue("TBPM", ""));
             }
             if (!bpmStr.isEmpty()) {
                 bool ok;
@@ -124,9 +226,9 @@ TrackInfo ID3LoaderThread::loadTrackInfo(const QString& filePath)
             }
             
             // Try to extract key
-            track.key = QString::fromStdString(metadata.getValue("KEY", "").toStdString());
+            track.key = toQt(metadata.getValue("KEY", ""));
             if (track.key.isEmpty()) {
-                track.key = QString::fromStdString(metadata.getValue("TKEY", "").toStdString());
+                track.key = toQt(metadata.getValue("TKEY", ""));
             }
         }
         
@@ -146,16 +248,68 @@ TrackInfo ID3LoaderThread::loadTrackInfo(const QString& filePath)
     return track;
 }
 
+void TagScannerThread::relink(TrackInfo& track)
+{
+    const auto found = track.identity != 0 ? moved.constFind(track.identity) : moved.constEnd();
+    if (found == moved.constEnd()) return;
+    const TrackInfo& old = found.value();
+    track.uid = old.uid;
+    track.addedMs = old.addedMs;
+    if (track.bpm <= 0.0) track.bpm = old.bpm;
+    if (track.key.isEmpty()) track.key = old.key;
+
+    // Same stamps, same path: nothing in the caches went stale
+    if (old.filePath == track.filePath && old.fileSize == track.fileSize && old.modifiedMs == track.modifiedMs) return;
+    const juce::File from(old.filePath.toStdString()), to(track.filePath.toStdString());
+    const juce::File waveforms(AppConfig::instance().getWaveformCacheDirectory().toStdString());
+    BpmCache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString())).relink(from, old.fileSize, old.modifiedMs, to);
+    WaveformCache(waveforms).relink(from, old.fileSize, old.modifiedMs, to);
+    StemCache(waveforms).relink(from, old.fileSize, old.modifiedMs, to);
+    if (old.filePath != track.filePath) ++relinked;
+}
+
 // LibraryTableModel Implementation
+// Wheel position first (1A, 1B, 2A, ...), unknown keys last
+static int camelotOrder(int key)
+{
+    if (key < 0) return 1000;
+    const std::string camelot = KeyDetector::getCamelot(key);
+    return std::stoi(camelot) * 2 + (camelot.back() == 'B' ? 1 : 0);
+}
+
 LibraryTableModel::LibraryTableModel(QObject* parent)
     : QAbstractTableModel(parent)
 {
+    collator = makeCollator(QLocale());
+    rowIcons.setMaxCost(2048);
+    rowCells.setMaxCost(2048);
+    fuzzyPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+    connect(&ArtworkCache::instance(), &ArtworkCache::thumbnailReady, this, &LibraryTableModel::onThumbnailReady);
+    connect(&WaveformThumbnails::instance(), &WaveformThumbnails::thumbnailReady,
+            this, &LibraryTableModel::onWaveformThumbnailReady);
+}
+
+void LibraryTableModel::onThumbnailReady(const QString& filePath)
+{
+    const auto it = trackIdByPath.constFind(filePath);
+    if (it == trackIdByPath.constEnd()) return;
+    rowIcons.remove(it.value());
+    const int row = findRow(it.value());
+    if (row >= 0) emit dataChanged(index(row, TitleColumn), index(row, TitleColumn), {Qt::DecorationRole});
+}
+
+void LibraryTableModel::onWaveformThumbnailReady(const QString& filePath)
+{
+    const auto it = trackIdByPath.constFind(filePath);
+    if (it == trackIdByPath.constEnd()) return;
+    const int row = findRow(it.value());
+    if (row >= 0) emit dataChanged(index(row, WaveformColumn), index(row, WaveformColumn), {Qt::DecorationRole});
 }
 
 int LibraryTableModel::rowCount(const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
-    return filteredTracks.size();
+    return (int) filteredRows.size();
 }
 
 int LibraryTableModel::columnCount(const QModelIndex& parent) const
@@ -166,30 +320,49 @@ int LibraryTableModel::columnCount(const QModelIndex& parent) const
 
 QVariant LibraryTableModel::data(const QModelIndex& index, int role) const
 {
-    if (!index.isValid() || index.row() >= filteredTracks.size()) {
-        return QVariant();
-    }
-    
-    const TrackInfo* track = filteredTracks[index.row()];
-    if (!track) return QVariant();
+    if (!index.isValid() || index.row() >= (int) filteredRows.size()) return QVariant();
+    const TrackId id = filteredRows[index.row()];
     
     if (role == Qt::DisplayRole) {
-        switch (index.column()) {
-            case TitleColumn: return track->getDisplayTitle();
-            case ArtistColumn: return track->getDisplayArtist();
-            case AlbumColumn: return track->album.isEmpty() ? "Unknown Album" : track->album;
-            case DurationColumn: return track->getDurationString();
-            case BpmColumn: return track->getBpmString();
-            case GenreColumn: return track->genre.isEmpty() ? "Unknown" : track->genre;
-            case YearColumn: return track->year.isEmpty() ? "--" : track->year;
-            case FileSizeColumn: return track->getFileSizeString();
-            default: return QVariant();
+        if (index.column() < 0 || index.column() >= ColumnCount) return QVariant();
+        auto* cells = rowCells.object(id);
+        if (!cells) {
+            cells = new std::array<QString, ColumnCount>(makeCellText(tracks.get(id)));
+            rowCells.insert(id, cells);
         }
+        return (*cells)[index.column()];
+    }
+    
+    // The view asks for every role of every cell; the path is only made for those that use it
+    const bool titleRole = (role == Qt::DecorationRole || role == Qt::ForegroundRole) && index.column() == TitleColumn;
+    if (!titleRole && role != Qt::ToolTipRole && role != Qt::UserRole) return QVariant();
+    if (role == Qt::DecorationRole)
+        if (const QPixmap* icon = rowIcons.object(id)) return *icon;
+    
+    const QString filePath = tracks.text(id, TrackStore::FilePath);
+    if (role == Qt::DecorationRole) {
+        const QImage thumbnail = ArtworkCache::instance().getThumbnail(filePath);
+        if (thumbnail.isNull()) return QVariant();   // loading, or no art
+        auto* icon = new QPixmap(QPixmap::fromImage(thumbnail.scaled(RowIconSize, RowIconSize,
+                                                    Qt::KeepAspectRatio, Qt::SmoothTransformation)));
+        rowIcons.insert(id, icon);
+        return *icon;
     } else if (role == Qt::ToolTipRole) {
-        return track->filePath;
+        if (duplicatesByPath.contains(filePath)) {
+            const QStringList versions = getVersions(filePath);
+            if (versions.size() > 1 && versions.first() != filePath)
+                return filePath + tr("\nBetter version in the library: ") + versions.first();
+            if (versions.size() > 1)
+                return filePath + tr("\nBest of %1 versions in the library").arg(versions.size());
+        }
+        return filePath;
+    } else if (role == Qt::ForegroundRole) {
+        if (!duplicatesByPath.contains(filePath)) return QVariant();
+        const QStringList versions = getVersions(filePath);
+        if (versions.size() > 1 && versions.first() != filePath) return QColor(150, 150, 150);
     } else if (role == Qt::UserRole) {
         // Return the file path for drag operations
-        return track->filePath;
+        return filePath;
     }
     
     return QVariant();
@@ -204,9 +377,11 @@ QVariant LibraryTableModel::headerData(int section, Qt::Orientation orientation,
             case AlbumColumn: return tr("Album");
             case DurationColumn: return tr("Duration");
             case BpmColumn: return tr("BPM");
+            case KeyColumn: return tr("Key");
             case GenreColumn: return tr("Genre");
             case YearColumn: return tr("Year");
             case FileSizeColumn: return tr("Size");
+            case WaveformColumn: return tr("Waveform");
             default: return QVariant();
         }
     }
@@ -223,128 +398,993 @@ Qt::ItemFlags LibraryTableModel::flags(const QModelIndex& index) const
 
 QStringList LibraryTableModel::mimeTypes() const
 {
-    return QStringList() << "text/uri-list";
+    return QStringList() << TrackDragMimeData::TrackIdsFormat << "text/uri-list";
 }
 
 QMimeData* LibraryTableModel::mimeData(const QModelIndexList& indexes) const
 {
-    QMimeData* mimeData = new QMimeData();
-    QList<QUrl> urls;
-    
-    QSet<int> rows; // Avoid duplicates from multiple columns
+    // Ids in view order, once per row however many of its columns are selected; paths are
+    // left to the drop target (TrackDragMimeData)
+    std::vector<int> rows;
+    rows.reserve((size_t) indexes.size());
     for (const QModelIndex& index : indexes) {
-        if (index.isValid()) {
-            rows.insert(index.row());
+        if (index.isValid() && index.row() < (int) filteredRows.size()) rows.push_back(index.row());
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    std::vector<int> ids;
+    ids.reserve(rows.size());
+    for (int row : rows) ids.push_back(filteredRows[row]);
+    
+    // Resolved against the library as it is now, whatever it goes through before the drop
+    return new TrackDragMimeData(std::move(ids), [library = tracks.snapshot()](int id) {
+        return library->text(id, TrackStore::FilePath);
+    });
+}
+
+void LibraryTableModel::addTrack(const TrackInfo& track)
+{
+    addTracks({ track });
+}
+
+void LibraryTableModel::addTracks(const QVector<TrackInfo>& batch)
+{
+    // Past this many separate insert positions a single reset is cheaper for the view
+    constexpr int MaxInsertRuns = 16;
+    if (batch.isEmpty()) return;
+    
+    std::vector<TrackId> incoming;
+    incoming.reserve(batch.size());
+    int64_t addedBytes = 0;
+    for (const auto& track : batch) {
+        if (trackIdByPath.contains(track.filePath)) continue;
+        TrackInfo added = track;
+        if (added.addedMs <= 0) added.addedMs = QDateTime::currentMSecsSinceEpoch();
+        // A copy of a moved file relinked first gets an id of its own
+        while (added.uid == 0 || trackIdByUid.contains(added.uid)) added.uid = QRandomGenerator::global()->generate64();
+        const TrackId id = tracks.add(added);
+        trackIdByUid.insert(added.uid, id);
+        trackKeys.push_back(makeKeys(added));
+        trackIdByPath.insert(added.filePath, id);
+        trackIdsByDirectory[added.filePath.left(added.filePath.lastIndexOf('/'))].push_back(id);
+        const QString title = added.getDisplayTitle(), artist = added.getDisplayArtist();
+        searchText += QStringList{ title, artist, added.album, added.genre, added.comment }.join('\n').toLower().toStdString();
+        searchOffsets.push_back((quint32) searchText.size());
+        indexTrack(id);
+        fuzzyText += foldForSearch(title + ' ' + artist);
+        fuzzyOffsets.push_back((quint32) fuzzyText.size());
+        addedBytes += estimateTrackBytes(id);
+        filterMask.push_back(!filterUtf8.empty() && searchTextOf(id).find(filterUtf8) != std::string_view::npos);
+        filterScore.push_back(0);
+        if (!filterMask.back() && fuzzyMatcher) {
+            const int edits = fuzzyScore(id);
+            if (edits >= 0) {
+                filterMask.back() = true;
+                filterScore.back() = (quint8) (1 + edits);
+            }
         }
+        updateCrateMembership(id);
+        if (matchesFilter(id)) incoming.push_back(id);
+    }
+    for (auto& ids : sortedIds) ids.clear();
+    bpmIndexStale = true;
+    memory.resize(memory.getBytes() + addedBytes);
+    publishSnapshot();
+    if (incoming.empty()) return;
+    
+    auto before = [this](TrackId a, TrackId b) { return isBefore(a, b); };
+    std::stable_sort(incoming.begin(), incoming.end(), before);
+    
+    // Insert row of each new track, after existing equal ones; non-decreasing since incoming is sorted
+    std::vector<int> rows(incoming.size());
+    int runs = 0;
+    for (size_t i = 0; i < incoming.size(); ++i) {
+        rows[i] = (int) (std::upper_bound(filteredRows.begin(), filteredRows.end(), incoming[i], before) - filteredRows.begin());
+        if (i == 0 || rows[i] != rows[i - 1]) runs++;
     }
     
-    for (int row : rows) {
-        if (row < filteredTracks.size()) {
-            const TrackInfo* track = filteredTracks[row];
-            if (track) {
-                urls.append(QUrl::fromLocalFile(track->filePath));
-            }
+    if (runs > MaxInsertRuns) {
+        beginResetModel();
+        // Merged by the insert rows already found, without comparing again
+        std::vector<TrackId> merged;
+        merged.reserve(filteredRows.size() + incoming.size());
+        int next = 0;
+        for (size_t i = 0; i < incoming.size(); ++i) {
+            merged.insert(merged.end(), filteredRows.begin() + next, filteredRows.begin() + rows[i]);
+            merged.push_back(incoming[i]);
+            next = rows[i];
         }
+        merged.insert(merged.end(), filteredRows.begin() + next, filteredRows.end());
+        filteredRows.swap(merged);
+        endResetModel();
+        return;
     }
     
-    mimeData->setUrls(urls);
-    return mimeData;
-}
-
-void LibraryTableModel::addTrack(const TrackInfo& track)
-{
-    allTracks.push_back(track);
-    updateFilteredTracks();
+    // Back to front, so the rows computed for earlier runs stay valid
+    size_t end = incoming.size();
+    while (end > 0) {
+        size_t first = end - 1;
+        while (first > 0 && rows[first - 1] == rows[end - 1]) first--;
+        const int row = rows[end - 1];
+        beginInsertRows(QModelIndex(), row, row + (int) (end - first) - 1);
+        filteredRows.insert(filteredRows.begin() + row, incoming.begin() + first, incoming.begin() + end);
+        endInsertRows();
+        end = first;
+    }
 }
 
 void LibraryTableModel::clearTracks()
 {
     beginResetModel();
-    allTracks.clear();
-    filteredTracks.clear();
+    tracks.clear();
+    trackKeys.clear();
+    rowCells.clear();
+    trackIdByPath.clear();
+    trackIdByUid.clear();
+    trackIdsByDirectory.clear();
+    searchText.clear();
+    searchOffsets.assign(1, 0);
+    searchIndex.clear();
+    filterMask.clear();
+    fuzzyText.clear();
+    fuzzyOffsets.assign(1, 0);
+    filterScore.clear();
+    filteredRows.clear();
+    memory.resize(0);
+    for (auto& ids : sortedIds) ids.clear();
+    for (int& stamp : sortStamps) stamp++;
+    for (auto& bucket : bpmIndex) bucket.clear();
+    bpmIndexStale = true;
+    rowIcons.clear();
+    genreIds.clear();
+    genreNames.clear();
+    for (auto& state : crates) {
+        state.genreMatches.clear();
+        state.members.clear();
+        state.size = 0;
+    }
     endResetModel();
+    publishSnapshot();
+}
+
+void LibraryTableModel::removeTracks(const QStringList& filePaths)
+{
+    bool any = false;
+    for (const QString& path : filePaths) {
+        auto found = trackIdByPath.find(path);
+        if (found == trackIdByPath.end()) continue;
+        const TrackId id = found.value();
+        trackIdByPath.erase(found);
+        if (trackIdByUid.value(tracks.uid(id), -1) == id) trackIdByUid.remove(tracks.uid(id));
+        tracks.setRemoved(id);
+        bpmIndexStale = true;
+        for (auto& state : crates) {
+            if (!state.members[id]) continue;
+            state.members[id] = false;
+            state.size--;
+        }
+        auto& siblings = trackIdsByDirectory[path.left(path.lastIndexOf('/'))];
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), id), siblings.end());
+        any = true;
+    }
+    if (!any) return;
+    publishSnapshot();
+    
+    // Contiguous runs, back to front so earlier rows keep their numbers
+    for (int last = (int) filteredRows.size() - 1; last >= 0; --last) {
+        if (!tracks.isRemoved(filteredRows[last])) continue;
+        int first = last;
+        while (first > 0 && tracks.isRemoved(filteredRows[first - 1])) --first;
+        beginRemoveRows(QModelIndex(), first, last);
+        filteredRows.erase(filteredRows.begin() + first, filteredRows.begin() + last + 1);
+        endRemoveRows();
+        last = first;
+    }
+}
+
+QHash<quint64, TrackInfo> LibraryTableModel::getRemovedTracks() const
+{
+    QHash<quint64, TrackInfo> removed;
+    for (TrackId id = 0; id < tracks.size(); ++id) {
+        // One relinked already lives on under its id
+        if (tracks.isRemoved(id) && tracks.identity(id) != 0 && !trackIdByUid.contains(tracks.uid(id)))
+            removed.insert(tracks.identity(id), tracks.get(id));
+    }
+    return removed;
+}
+
+void LibraryTableModel::setTrackIdentity(const QString& filePath, quint64 identity)
+{
+    const auto found = trackIdByPath.constFind(filePath);
+    if (found == trackIdByPath.constEnd()) return;
+    tracks.setIdentity(found.value(), identity);
+    publishSnapshot();
+}
+
+TrackStore::Snapshot LibraryTableModel::getSnapshot() const
+{
+    // The GUI thread sees its own changes at once; other threads what was last published
+    if (QThread::currentThread() == thread()) return tracks.snapshot();
+    return std::atomic_load(&published);
+}
+
+void LibraryTableModel::publishSnapshot()
+{
+    // Once per pass of the event loop, however many changes it brings
+    if (publishPending) return;
+    publishPending = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        publishPending = false;
+        std::atomic_store(&published, tracks.snapshot());
+    }, Qt::QueuedConnection);
+}
+
+std::optional<TrackInfo> LibraryTableModel::getTrackByPath(const QString& filePath) const
+{
+    auto found = trackIdByPath.constFind(filePath);
+    if (found == trackIdByPath.constEnd()) return std::nullopt;
+    return tracks.get(found.value());
+}
+
+QStringList LibraryTableModel::getFilesInDirectory(const QString& directory) const
+{
+    QStringList paths;
+    auto found = trackIdsByDirectory.constFind(directory);
+    if (found == trackIdsByDirectory.constEnd()) return paths;
+    for (TrackId id : found.value()) paths.append(tracks.text(id, TrackStore::FilePath));
+    return paths;
+}
+
+QVector<TrackInfo> LibraryTableModel::getAllTracks() const
+{
+    QVector<TrackInfo> all;
+    all.reserve(trackIdByPath.size());
+    for (TrackId id = 0; id < tracks.size(); ++id) {
+        if (!tracks.isRemoved(id)) all.append(tracks.get(id));
+    }
+    return all;
+}
+
+std::optional<TrackInfo> LibraryTableModel::getTrack(int row) const
+{
+    if (row < 0 || row >= (int) filteredRows.size()) return std::nullopt;
+    return tracks.get(filteredRows[row]);
+}
+
+QString LibraryTableModel::getFilePath(int row) const
+{
+    if (row < 0 || row >= (int) filteredRows.size()) return QString();
+    return tracks.text(filteredRows[row], TrackStore::FilePath);
+}
+
+void LibraryTableModel::addDuplicates(const QString& filePath, const QStringList& duplicates)
+{
+    QStringList changed{ filePath };
+    for (const QString& other : duplicates) {
+        if (other == filePath) continue;
+        duplicatesByPath[filePath].insert(other);
+        duplicatesByPath[other].insert(filePath);
+        changed.append(other);
+    }
+    // Every version's best may have changed
+    for (const QString& version : getVersions(filePath)) changed.append(version);
+    refreshRows(changed);
+}
+
+QStringList LibraryTableModel::getVersions(const QString& filePath) const
+{
+    QStringList versions{ filePath };
+    // Transitively: A and C may both match B without matching each other
+    for (int i = 0; i < versions.size(); ++i) {
+        const auto found = duplicatesByPath.constFind(versions[i]);
+        if (found == duplicatesByPath.constEnd()) continue;
+        for (const QString& other : found.value())
+            if (!versions.contains(other) && trackIdByPath.contains(other)) versions.append(other);
+    }
+    const auto score = [this](const QString& path) {
+        const auto track = getTrackByPath(path);
+        return track ? qualityScore(*track) : 0;
+    };
+    std::stable_sort(versions.begin(), versions.end(),
+                     [&](const QString& a, const QString& b) { return score(a) > score(b); });
+    return versions;
+}
+
+int LibraryTableModel::qualityScore(const TrackInfo& track)
+{
+    static const QSet<QString> lossless{ "wav", "wave", "aif", "aiff", "flac", "bwf" };
+    const bool isLossless = lossless.contains(QFileInfo(track.filePath).suffix().toLower());
+    const int kbps = track.duration > 0.0 ? (int) (track.fileSize * 8 / track.duration / 1000.0) : 0;
+    return (isLossless ? 1 << 20 : 0) + kbps;
+}
+
+void LibraryTableModel::refreshRows(const QStringList& filePaths)
+{
+    for (const QString& path : filePaths) {
+        const auto found = trackIdByPath.constFind(path);
+        if (found == trackIdByPath.constEnd()) continue;
+        const int row = findRow(found.value());
+        if (row >= 0) emit dataChanged(index(row, 0), index(row, ColumnCount - 1), {Qt::ForegroundRole, Qt::ToolTipRole});
+    }
+}
+
+int LibraryTableModel::findRow(TrackId id) const
+{
+    auto it = std::find(filteredRows.begin(), filteredRows.end(), id);
+    return it != filteredRows.end() ? (int) (it - filteredRows.begin()) : -1;
+}
+
+QStringList LibraryTableModel::getCrateFilePaths(int index) const
+{
+    QStringList paths;
+    if (index < 0 || index >= (int) crates.size()) return paths;
+    const auto& members = crates[(size_t) index].members;
+    for (TrackId id = 0; id < tracks.size() && id < (TrackId) members.size(); ++id) {
+        if (members[(size_t) id] && !tracks.isRemoved(id)) paths.append(tracks.text(id, TrackStore::FilePath));
+    }
+    return paths;
+}
+
+QStringList LibraryTableModel::getAllFilePaths() const
+{
+    QStringList paths;
+    paths.reserve(trackIdByPath.size());
+    for (TrackId id = 0; id < tracks.size(); ++id) {
+        if (!tracks.isRemoved(id)) paths.append(tracks.text(id, TrackStore::FilePath));
+    }
+    return paths;
 }
 
-const TrackInfo* LibraryTableModel::getTrack(int row) const
+void LibraryTableModel::setTrackAnalysis(const QString& filePath, double bpm, const QString& camelotKey)
 {
-    if (row >= 0 && row < filteredTracks.size()) {
-        return filteredTracks[row];
+    auto found = trackIdByPath.constFind(filePath);
+    if (found == trackIdByPath.constEnd()) return;
+    
+    const TrackId id = found.value();
+    const double oldBpm = tracks.bpm(id);
+    const bool setBpm = bpm > 0.0 && oldBpm <= 0.0;
+    const bool setKey = !camelotKey.isEmpty() && tracks.utf8(id, TrackStore::Key).empty();
+    if (!setBpm && !setKey) return;
+    
+    // Move the track between BPM index buckets; looked up by the values it is filed under
+    auto byBpm = [this](TrackId a, TrackId b) { return tracks.bpm(a) < tracks.bpm(b); };
+    if (!bpmIndexStale && oldBpm > 0.0) {
+        auto& bucket = getBpmBucket(id);
+        auto range = std::equal_range(bucket.begin(), bucket.end(), id, byBpm);
+        auto filed = std::find(range.first, range.second, id);
+        if (filed != range.second) bucket.erase(filed);
+    }
+    if (setBpm) tracks.setBpm(id, bpm);
+    if (setKey) tracks.setText(id, TrackStore::Key, camelotKey);
+    publishSnapshot();
+    trackKeys[id].key = KeyDetector::parse(std::string(tracks.utf8(id, TrackStore::Key)));
+    trackKeys[id].camelot = camelotOrder(trackKeys[id].key);
+    rowCells.remove(id);
+    sortedIds[SortByBpm].clear();
+    sortedIds[SortByKey].clear();
+    sortStamps[SortByBpm]++;
+    sortStamps[SortByKey]++;
+    if (!bpmIndexStale && tracks.bpm(id) > 0.0) {
+        auto& bucket = getBpmBucket(id);
+        bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), id, byBpm), id);
+    }
+    
+    auto before = [this](TrackId a, TrackId b) { return isBefore(a, b); };
+    const int row = findRow(id);
+    if (updateCrateMembership(id)) {
+        // Entered or left the active crate
+        if (row >= 0) {
+            beginRemoveRows(QModelIndex(), row, row);
+            filteredRows.erase(filteredRows.begin() + row);
+            endRemoveRows();
+        } else if (matchesFilter(id)) {
+            const int target = (int) (std::upper_bound(filteredRows.begin(), filteredRows.end(), id, before) - filteredRows.begin());
+            beginInsertRows(QModelIndex(), target, target);
+            filteredRows.insert(filteredRows.begin() + target, id);
+            endInsertRows();
+        }
+        return;
     }
-    return nullptr;
+    if (row < 0) return;
+    emit dataChanged(index(row, BpmColumn), index(row, KeyColumn));
+    
+    // Sorted by the column that just changed: move the row to its new place
+    if (currentSortMode != SortByBpm && currentSortMode != SortByKey) return;
+    const bool afterPrev = row == 0 || !before(id, filteredRows[row - 1]);
+    const bool beforeNext = row + 1 == (int) filteredRows.size() || !before(filteredRows[row + 1], id);
+    if (afterPrev && beforeNext) return;
+    
+    // Target among the other rows; beginMoveRows wants the destination in pre-move numbering
+    int target;
+    if (!afterPrev)
+        target = (int) (std::upper_bound(filteredRows.begin(), filteredRows.begin() + row, id, before) - filteredRows.begin());
+    else
+        target = (int) (std::upper_bound(filteredRows.begin() + row + 1, filteredRows.end(), id, before) - filteredRows.begin());
+    
+    if (!beginMoveRows(QModelIndex(), row, row, QModelIndex(), target)) return;
+    if (target < row) std::rotate(filteredRows.begin() + target, filteredRows.begin() + row, filteredRows.begin() + row + 1);
+    else std::rotate(filteredRows.begin() + row, filteredRows.begin() + row + 1, filteredRows.begin() + target);
+    endMoveRows();
 }
 
 void LibraryTableModel::setSortMode(SortMode mode, Qt::SortOrder order)
 {
-    currentSortMode = mode;
-    currentSortOrder = order;
-    sortFilteredTracks();
+    if (mode < 0 || mode >= SortModeCount) return;
+    pendingSortMode = mode;
+    pendingSortOrder = order;
+    viewPending = true;
+    if (ensureSortedIds(mode)) applyPendingView();
+}
+
+bool LibraryTableModel::ensureSortedIds(SortMode mode)
+{
+    if (sortedIds[mode].size() == (size_t) tracks.size() || tracks.size() < AsyncSortTracks) {
+        getSortedIds(mode);
+        return true;
+    }
+    if (!sortRunning) startSort(mode);
+    return false;
+}
+
+void LibraryTableModel::startSort(SortMode mode)
+{
+    sortRunning = true;
+    emit busyChanged(true);
+    QPointer<LibraryTableModel> self(this);
+    QThreadPool::globalInstance()->start([self, mode, stamp = sortStamps[mode], library = tracks.snapshot(),
+                                          camelot = getCamelotColumn(mode), locale = collator.locale()]() {
+        std::vector<TrackId> ids = sortIds(*library, mode, camelot, locale);
+        QMetaObject::invokeMethod(qApp, [self, mode, stamp, ids = std::move(ids)]() mutable {
+            if (self) self->onSortDone(mode, stamp, std::move(ids));
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LibraryTableModel::onSortDone(SortMode mode, int stamp, std::vector<TrackId> ids)
+{
+    sortRunning = false;
+    const int appended = tracks.size() - (int) ids.size();
+    if (stamp == sortStamps[mode] && appended >= 0 && appended <= MaxMergedTracks) {
+        // Tracks added since the snapshot go in behind their equals, where a full sort puts them
+        auto less = [this, mode](TrackId a, TrackId b) { return isLessThan(mode, a, b); };
+        std::vector<TrackId> extra((size_t) appended);
+        std::iota(extra.begin(), extra.end(), (TrackId) ids.size());
+        std::stable_sort(extra.begin(), extra.end(), less);
+        std::vector<TrackId> merged;
+        merged.reserve((size_t) tracks.size());
+        auto next = ids.begin();
+        for (TrackId id : extra) {
+            const auto at = std::upper_bound(next, ids.end(), id, less);
+            merged.insert(merged.end(), next, at);
+            merged.push_back(id);
+            next = at;
+        }
+        merged.insert(merged.end(), next, ids.end());
+        sortedIds[mode].swap(merged);
+    }
+    // Otherwise stale: ensureSortedIds sorts again if the view still waits for it
+    if (viewPending && !ensureSortedIds(pendingSortMode)) return;
+    if (viewPending) applyPendingView();
+    emit busyChanged(false);
+}
+
+void LibraryTableModel::applyPendingView()
+{
+    viewPending = false;
+    currentSortMode = pendingSortMode;
+    currentSortOrder = pendingSortOrder;
+    if (pendingReset) {
+        pendingReset = false;
+        beginResetModel();
+        rebuildFilteredRows();
+        endResetModel();
+        return;
+    }
+    
+    emit layoutAboutToBeChanged();
+    const std::vector<TrackId> oldRows = filteredRows;
+    rebuildFilteredRows();
+    
+    // Keep selection and current index on the same tracks
+    std::vector<int> newRowOf((size_t) tracks.size(), -1);
+    for (int row = 0; row < (int) filteredRows.size(); ++row) newRowOf[filteredRows[row]] = row;
+    const QModelIndexList persistent = persistentIndexList();
+    QModelIndexList moved;
+    moved.reserve(persistent.size());
+    for (const QModelIndex& idx : persistent) {
+        const int row = idx.row() < (int) oldRows.size() ? newRowOf[oldRows[idx.row()]] : -1;
+        moved.append(row >= 0 ? index(row, idx.column()) : QModelIndex());
+    }
+    changePersistentIndexList(persistent, moved);
+    emit layoutChanged();
 }
 
 void LibraryTableModel::setFilterText(const QString& filter)
 {
-    filterText = filter.toLower();
+    const QString text = filter.toLower();
+    if (text == filterText) return;
+    
+    // A query containing the previous one can only match a subset of its results
+    const bool refine = !filterText.isEmpty() && text.contains(filterText);
+    filterText = text;
+    filterUtf8 = text.toStdString();
+    updateFilterMask(refine);
     updateFilteredTracks();
 }
 
-void LibraryTableModel::updateFilteredTracks()
+void LibraryTableModel::setFuzzySearch(bool enabled)
 {
-    beginResetModel();
+    if (enabled == fuzzySearch) return;
+    fuzzySearch = enabled;
+    if (filterText.isEmpty()) return;
+    updateFilterMask(false);
+    updateFilteredTracks();
+}
+
+std::string LibraryTableModel::foldForSearch(const QString& text)
+{
+    // Compatibility decomposition splits "é" into "e" and a combining mark, which is dropped
+    const QString decomposed = text.normalized(QString::NormalizationForm_KD).toLower();
+    std::string folded;
+    folded.reserve((size_t) decomposed.size());
+    for (const QChar c : decomposed) {
+        const char16_t u = c.unicode();
+        if ((u >= 'a' && u <= 'z') || (u >= '0' && u <= '9')) folded += (char) u;
+        else if (c.isMark()) continue;
+        else if (!folded.empty() && folded.back() != ' ') folded += ' ';
+    }
+    return folded;
+}
+
+// Three bytes packed into one key
+static quint64 trigramAt(std::string_view text, size_t i)
+{
+    return (quint64((unsigned char) text[i]) << 16) | (quint64((unsigned char) text[i + 1]) << 8) | (unsigned char) text[i + 2];
+}
+
+std::string_view LibraryTableModel::searchTextOf(TrackId id) const
+{
+    const quint32 begin = searchOffsets[(size_t) id];
+    return std::string_view(searchText.data() + begin, searchOffsets[(size_t) id + 1] - begin);
+}
+
+int64_t LibraryTableModel::estimateTrackBytes(TrackId id) const
+{
+    const auto searchBytes = (int64_t) searchTextOf(id).size();
+    // The store's row and text; a posting (and id list entries elsewhere) per searchable byte
+    return tracks.bytes(id) + (int64_t) sizeof(TrackKeys)
+         + searchBytes * (1 + (int64_t) sizeof(TrackId))
+         + (int64_t) (fuzzyOffsets[(size_t) id + 1] - fuzzyOffsets[(size_t) id]);
+}
+
+void LibraryTableModel::indexTrack(TrackId id)
+{
+    const std::string_view text = searchTextOf(id);
+    for (size_t i = 0; i + 2 < text.size(); ++i) {
+        auto& postings = searchIndex[trigramAt(text, i)];
+        if (postings.empty() || postings.back() != id) postings.push_back(id);
+    }
+}
+
+void LibraryTableModel::updateFilterMask(bool refine)
+{
+    std::fill(filterScore.begin(), filterScore.end(), 0);
+    fuzzyMatcher.reset();
+    if (filterText.isEmpty()) {
+        std::fill(filterMask.begin(), filterMask.end(), false);
+        return;
+    }
     
-    filteredTracks.clear();
-    for (const auto& track : allTracks) {
-        if (matchesFilter(track)) {
-            filteredTracks.push_back(&track);
+    // Candidates: the previous matches when refining, else the intersection of the query's
+    // trigram postings (too short for a trigram: every track). Each is then verified.
+    std::vector<TrackId> candidates;
+    if (refine) {
+        for (TrackId id = 0; id < (TrackId) filterMask.size(); ++id)
+            if (filterMask[id]) candidates.push_back(id);
+    } else if (filterUtf8.size() >= 3) {
+        std::vector<const std::vector<TrackId>*> lists;
+        for (size_t i = 0; i + 2 < filterUtf8.size(); ++i) {
+            auto it = searchIndex.constFind(trigramAt(filterUtf8, i));
+            if (it == searchIndex.constEnd()) { lists.clear(); lists.push_back(nullptr); break; }
+            lists.push_back(&it.value());
+        }
+        if (lists.front()) {
+            std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+            candidates = *lists.front();
+            std::vector<TrackId> narrowed;
+            for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+                narrowed.clear();
+                std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                                      std::back_inserter(narrowed));
+                candidates.swap(narrowed);
+            }
         }
+    } else {
+        candidates.resize((size_t) tracks.size());
+        for (TrackId id = 0; id < (TrackId) candidates.size(); ++id) candidates[id] = id;
     }
     
-    sortFilteredTracks();
-    endResetModel();
+    std::fill(filterMask.begin(), filterMask.end(), false);
+    for (TrackId id : candidates)
+        if (searchTextOf(id).find(filterUtf8) != std::string_view::npos) filterMask[id] = true;
+
+    // Typos can't be found through trigrams or by refining: the fuzzy pass reads every track
+    if (fuzzySearch && filterText.size() >= 3) {
+        fuzzyMatcher = std::make_unique<FuzzyMatcher>(foldForSearch(filterText));
+        if (fuzzyMatcher->isEmpty()) fuzzyMatcher.reset();
+        else addFuzzyMatches();
+    }
 }
 
-void LibraryTableModel::sortFilteredTracks()
+int LibraryTableModel::fuzzyScore(TrackId id) const
 {
-    std::sort(filteredTracks.begin(), filteredTracks.end(), [this](const TrackInfo* a, const TrackInfo* b) {
-        bool result = isLessThan(a, b);
-        return currentSortOrder == Qt::AscendingOrder ? result : !result;
-    });
+    const quint32 begin = fuzzyOffsets[(size_t) id];
+    return fuzzyMatcher->score(fuzzyText.data() + begin, fuzzyOffsets[(size_t) id + 1] - begin);
 }
 
-bool LibraryTableModel::matchesFilter(const TrackInfo& track) const
+void LibraryTableModel::addFuzzyMatches()
 {
-    if (filterText.isEmpty()) return true;
+    // Chunks write only their own tracks' edits; the bit vector mask is filled in afterwards
+    const TrackId count = tracks.size();
+    std::vector<qint8> edits((size_t) count, -1);
+    auto scan = [this, &edits](TrackId from, TrackId to) {
+        for (TrackId id = from; id < to; ++id)
+            if (!tracks.isRemoved(id)) edits[(size_t) id] = (qint8) fuzzyScore(id);
+    };
+    if (count <= FuzzyChunkTracks) {
+        scan(0, count);
+    } else {
+        for (TrackId from = 0; from < count; from += FuzzyChunkTracks)
+            fuzzyPool.start([&scan, from, count]() { scan(from, std::min<TrackId>(count, from + FuzzyChunkTracks)); });
+        fuzzyPool.waitForDone();
+    }
+    for (TrackId id = 0; id < count; ++id) {
+        if (filterMask[id] || edits[(size_t) id] < 0) continue;
+        filterMask[id] = true;
+        filterScore[(size_t) id] = (quint8) (1 + edits[(size_t) id]);
+    }
+}
+
+void LibraryTableModel::updateFilteredTracks()
+{
+    pendingReset = true;
+    viewPending = true;
+    if (ensureSortedIds(pendingSortMode)) applyPendingView();
+}
+
+void LibraryTableModel::rebuildFilteredRows()
+{
+    // The cached order is ascending; reversed it is still sorted for isBefore in descending mode
+    const auto& ids = getSortedIds(currentSortMode);
+    filteredRows.clear();
+    auto keep = [this](TrackId id) { if (matchesFilter(id)) filteredRows.push_back(id); };
+    if (currentSortOrder == Qt::AscendingOrder) std::for_each(ids.begin(), ids.end(), keep);
+    else std::for_each(ids.rbegin(), ids.rend(), keep);
+    // Fuzzy matches rank by their edits, each rank in the sort order
+    if (fuzzyMatcher) {
+        std::stable_sort(filteredRows.begin(), filteredRows.end(),
+                         [this](TrackId a, TrackId b) { return filterScore[(size_t) a] < filterScore[(size_t) b]; });
+    }
+}
+
+const std::vector<LibraryTableModel::TrackId>& LibraryTableModel::getSortedIds(SortMode mode)
+{
+    auto& ids = sortedIds[mode];
+    if (ids.size() != (size_t) tracks.size()) ids = sortIds(tracks, mode, getCamelotColumn(mode), collator.locale());
+    return ids;
+}
+
+std::vector<int> LibraryTableModel::getCamelotColumn(SortMode mode) const
+{
+    std::vector<int> camelot;
+    if (mode != SortByKey) return camelot;
+    camelot.reserve(trackKeys.size());
+    for (const TrackKeys& keys : trackKeys) camelot.push_back(keys.camelot);
+    return camelot;
+}
+
+QCollator LibraryTableModel::makeCollator(const QLocale& locale)
+{
+    QCollator collator(locale);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    collator.setNumericMode(true);   // "Track 2" before "Track 10"
+    return collator;
+}
+
+bool LibraryTableModel::isTextMode(SortMode mode)
+{
+    return mode == SortByTitle || mode == SortByArtist || mode == SortByAlbum || mode == SortByGenre;
+}
+
+bool LibraryTableModel::isColumnLess(const TrackColumns& columns, SortMode mode, TrackId a, TrackId b)
+{
+    switch (mode) {
+        case SortByDuration: return columns.duration(a) < columns.duration(b);
+        case SortByBpm: return columns.bpm(a) < columns.bpm(b);
+        case SortByYear: return columns.utf8(a, TrackStore::Year) < columns.utf8(b, TrackStore::Year);
+        case SortByFileSize: return columns.fileSize(a) < columns.fileSize(b);
+        default: return false;
+    }
+}
+
+std::vector<LibraryTableModel::TrackId> LibraryTableModel::sortIds(const TrackColumns& columns, SortMode mode,
+                                                                   const std::vector<int>& camelot, const QLocale& locale)
+{
+    // Contiguous id ranges sorted in parallel, then merged pairwise, the pairs of a round in
+    // parallel too. Parts hold ascending ids and merges keep the left run's equals first, so
+    // the order is the one a single stable sort gives.
+    const int count = columns.size();
+    const int parts = std::clamp(count / MinSortPartTracks, 1, std::max(1, QThread::idealThreadCount()));
+    const int partSize = std::max(1, (count + parts - 1) / parts);
+    const bool text = isTextMode(mode);
+    std::vector<std::vector<QCollatorSortKey>> keys((size_t) parts);   // collation keys by part, for the sort only
+    auto less = [&](TrackId a, TrackId b) {
+        if (text) return keys[(size_t) (a / partSize)][(size_t) (a % partSize)].compare(keys[(size_t) (b / partSize)][(size_t) (b % partSize)]) < 0;
+        if (mode == SortByKey) return camelot[(size_t) a] < camelot[(size_t) b];
+        return isColumnLess(columns, mode, a, b);
+    };
+    
+    std::vector<TrackId> ids((size_t) count);
+    std::iota(ids.begin(), ids.end(), 0);
+    auto sortPart = [&](int part) {
+        const TrackId begin = part * partSize, end = std::min(count, begin + partSize);
+        if (text) {
+            // QCollator isn't shared between threads
+            const QCollator collator = makeCollator(locale);
+            keys[(size_t) part].reserve((size_t) std::max(0, end - begin));
+            for (TrackId id = begin; id < end; ++id) keys[(size_t) part].push_back(collator.sortKey(sortText(columns, mode, id)));
+        }
+        std::stable_sort(ids.begin() + begin, ids.begin() + std::max(begin, end), less);
+    };
+    if (parts == 1) {
+        sortPart(0);
+        return ids;
+    }
     
-    return track.getDisplayTitle().toLower().contains(filterText) ||
-           track.getDisplayArtist().toLower().contains(filterText) ||
-           track.album.toLower().contains(filterText) ||
-           track.genre.toLower().contains(filterText);
+    QThreadPool pool;
+    pool.setMaxThreadCount(parts);
+    for (int part = 0; part < parts; ++part) pool.start([&sortPart, part]() { sortPart(part); });
+    pool.waitForDone();
+    for (int width = partSize; width < count; width *= 2) {
+        for (int low = 0; low + width < count; low += 2 * width) {
+            pool.start([&ids, &less, low, width, count]() {
+                std::inplace_merge(ids.begin() + low, ids.begin() + low + width, ids.begin() + std::min(count, low + 2 * width), less);
+            });
+        }
+        pool.waitForDone();
+    }
+    return ids;
+}
+
+bool LibraryTableModel::matchesFilter(TrackId id) const
+{
+    return !tracks.isRemoved(id) && (filterText.isEmpty() || filterMask[id])
+        && (activeCrate < 0 || crates[activeCrate].members[id]) && (!folderFiltered || isInFolder(id));
+}
+
+bool LibraryTableModel::isInFolder(TrackId id) const
+{
+    const std::string_view path = tracks.utf8(id, TrackStore::FilePath);
+    return path.rfind('/') == folderFilter.size() && path.compare(0, folderFilter.size(), folderFilter) == 0;
+}
+
+void LibraryTableModel::setFolderFilter(const QString& directory)
+{
+    QString folder = directory;
+    while (folder.endsWith('/')) folder.chop(1);
+    const std::string utf8 = folder.toStdString();
+    if (directory.isEmpty() == !folderFiltered && utf8 == folderFilter) return;
+    folderFiltered = !directory.isEmpty();
+    folderFilter = folderFiltered ? utf8 : std::string();
+    updateFilteredTracks();
+}
+
+void LibraryTableModel::setCrates(const QVector<SmartCrate>& newCrates)
+{
+    crates.clear();
+    activeCrate = -1;
+    for (const auto& crate : newCrates) {
+        crates.push_back({ crate, {}, {}, {}, 0 });
+        evaluateCrate(crates.back());
+    }
+    updateFilteredTracks();
+}
+
+QVector<SmartCrate> LibraryTableModel::getCrates() const
+{
+    QVector<SmartCrate> result;
+    result.reserve((int) crates.size());
+    for (const auto& state : crates) result.append(state.crate);
+    return result;
+}
+
+void LibraryTableModel::setCrate(int index, const SmartCrate& crate)
+{
+    if (index < 0 || index > (int) crates.size()) return;
+    if (index == (int) crates.size()) crates.push_back({});
+    crates[index] = { crate, {}, {}, {}, 0 };
+    evaluateCrate(crates[index]);
+    if (index == activeCrate) updateFilteredTracks();
+}
+
+void LibraryTableModel::removeCrate(int index)
+{
+    if (index < 0 || index >= (int) crates.size()) return;
+    const bool wasActive = index == activeCrate;
+    crates.erase(crates.begin() + index);
+    if (wasActive) activeCrate = -1;
+    else if (activeCrate > index) activeCrate--;
+    if (wasActive) updateFilteredTracks();
+}
+
+void LibraryTableModel::setActiveCrate(int index)
+{
+    if (index >= (int) crates.size()) index = -1;
+    if (index < 0 && activeCrate < 0) return;
+    activeCrate = index;
+    // A date-added window slides with the clock: re-evaluate when the crate is opened
+    if (index >= 0 && crates[index].crate.addedWithinDays > 0) evaluateCrate(crates[index]);
+    updateFilteredTracks();
+}
+
+void LibraryTableModel::rebuildBpmIndex()
+{
+    for (auto& bucket : bpmIndex) bucket.clear();
+    for (TrackId id = 0; id < tracks.size(); ++id) {
+        if (!tracks.isRemoved(id) && tracks.bpm(id) > 0.0) getBpmBucket(id).push_back(id);
+    }
+    for (auto& bucket : bpmIndex) {
+        std::stable_sort(bucket.begin(), bucket.end(), [this](TrackId a, TrackId b) {
+            return tracks.bpm(a) < tracks.bpm(b);
+        });
+    }
+    bpmIndexStale = false;
 }
 
-bool LibraryTableModel::isLessThan(const TrackInfo* a, const TrackInfo* b) const
+QVector<TrackInfo> LibraryTableModel::findCompatibleTracks(double bpm, int key, double tolerancePercent, int limit,
+                                                           const QString& excludePath)
 {
-    if (!a || !b) return false;
+    QVector<TrackInfo> result;
+    if (bpm <= 0.0 || limit <= 0) return result;
+    if (bpmIndexStale) rebuildBpmIndex();
+    
+    std::vector<const std::vector<TrackId>*> buckets;
+    if (key >= 0) {
+        for (int compatible : KeyDetector::getCompatible(key))
+            if (compatible >= 0) buckets.push_back(&bpmIndex[compatible]);
+    } else {
+        for (const auto& bucket : bpmIndex) buckets.push_back(&bucket);
+    }
+    
+    const double low = bpm * (1.0 - tolerancePercent / 100.0);
+    const double high = bpm * (1.0 + tolerancePercent / 100.0);
+    const std::string exclude = excludePath.toStdString();
+    std::vector<TrackId> candidates;
+    for (const auto* bucket : buckets) {
+        auto first = std::lower_bound(bucket->begin(), bucket->end(), low,
+                                      [this](TrackId id, double value) { return tracks.bpm(id) < value; });
+        for (auto it = first; it != bucket->end() && tracks.bpm(*it) <= high; ++it) {
+            if (tracks.utf8(*it, TrackStore::FilePath) != exclude) candidates.push_back(*it);
+        }
+    }
     
-    switch (currentSortMode) {
-        case SortByTitle:
-            return a->getDisplayTitle().toLower() < b->getDisplayTitle().toLower();
-        case SortByArtist:
-            return a->getDisplayArtist().toLower() < b->getDisplayArtist().toLower();
-        case SortByAlbum:
-            return a->album.toLower() < b->album.toLower();
-        case SortByDuration:
-            return a->duration < b->duration;
-        case SortByBpm:
-            return a->bpm < b->bpm;
-        case SortByGenre:
-            return a->genre.toLower() < b->genre.toLower();
-        case SortByYear:
-            return a->year < b->year;
-        case SortByFileSize:
-            return a->fileSize < b->fileSize;
-        default:
-            return false;
+    auto distance = [this, bpm](TrackId id) { return std::abs(tracks.bpm(id) - bpm); };
+    const size_t count = std::min(candidates.size(), (size_t) limit);
+    std::partial_sort(candidates.begin(), candidates.begin() + (std::ptrdiff_t) count, candidates.end(),
+                      [&distance](TrackId a, TrackId b) { return distance(a) < distance(b); });
+    result.reserve((int) count);
+    for (size_t i = 0; i < count; ++i) result.append(tracks.get(candidates[i]));
+    return result;
+}
+
+int LibraryTableModel::internGenre(const QString& genre)
+{
+    const QString lower = genre.trimmed().toLower();
+    auto found = genreIds.constFind(lower);
+    if (found != genreIds.constEnd()) return found.value();
+    genreNames.append(lower);
+    return genreIds.insert(lower, (int) genreNames.size() - 1).value();
+}
+
+bool LibraryTableModel::crateMatches(CrateState& state, TrackId id)
+{
+    const TrackKeys& keys = trackKeys[id];
+    if (!state.predicate.matchesColumns(tracks.bpm(id), keys.key, tracks.addedMs(id))) return false;
+    if (state.predicate.hasPaths() && !state.predicate.matchesPath(tracks.text(id, TrackStore::FilePath))) return false;
+    if (keys.genreId >= (int) state.genreMatches.size()) state.genreMatches.resize(genreNames.size(), -1);
+    qint8& genre = state.genreMatches[keys.genreId];
+    if (genre < 0) genre = state.predicate.matchesGenre(genreNames[keys.genreId]) ? 1 : 0;
+    return genre == 1;
+}
+
+void LibraryTableModel::evaluateCrate(CrateState& state)
+{
+    state.predicate = state.crate.compile(QDateTime::currentMSecsSinceEpoch());
+    state.genreMatches.assign(genreNames.size(), -1);
+    state.members.assign((size_t) tracks.size(), false);
+    state.size = 0;
+    for (TrackId id = 0; id < tracks.size(); ++id) {
+        if (tracks.isRemoved(id) || !crateMatches(state, id)) continue;
+        state.members[id] = true;
+        state.size++;
+    }
+}
+
+bool LibraryTableModel::updateCrateMembership(TrackId id)
+{
+    bool activeChanged = false;
+    for (int i = 0; i < (int) crates.size(); ++i) {
+        CrateState& state = crates[i];
+        if ((int) state.members.size() <= id) state.members.resize((size_t) tracks.size(), false);
+        const bool member = !tracks.isRemoved(id) && crateMatches(state, id);
+        if (member == state.members[id]) continue;
+        state.members[id] = member;
+        state.size += member ? 1 : -1;
+        if (i == activeCrate) activeChanged = true;
+    }
+    return activeChanged;
+}
+
+std::array<QString, LibraryTableModel::ColumnCount> LibraryTableModel::makeCellText(const TrackInfo& track)
+{
+    static const QString UnknownAlbum = QStringLiteral("Unknown Album");
+    static const QString UnknownGenre = QStringLiteral("Unknown");
+    static const QString NoValue = QStringLiteral("--");
+    
+    std::array<QString, ColumnCount> cells;
+    cells[TitleColumn] = track.getDisplayTitle();
+    cells[ArtistColumn] = track.getDisplayArtist();
+    cells[AlbumColumn] = track.album.isEmpty() ? UnknownAlbum : track.album;
+    cells[DurationColumn] = track.getDurationString();
+    cells[BpmColumn] = track.getBpmString();
+    cells[KeyColumn] = track.getCamelotString();
+    cells[GenreColumn] = track.genre.isEmpty() ? UnknownGenre : track.genre;
+    cells[YearColumn] = track.year.isEmpty() ? NoValue : track.year;
+    cells[FileSizeColumn] = track.getFileSizeString();
+    return cells;
+}
+
+LibraryTableModel::TrackKeys LibraryTableModel::makeKeys(const TrackInfo& track)
+{
+    const int key = KeyDetector::parse(track.key.toStdString());
+    return { camelotOrder(key), key, internGenre(track.genre) };
+}
+
+QString LibraryTableModel::sortText(const TrackColumns& columns, SortMode mode, TrackId id)
+{
+    switch (mode) {
+        case SortByTitle: {
+            const QString title = columns.text(id, TrackStore::Title);
+            return title.isEmpty() ? QFileInfo(columns.text(id, TrackStore::FilePath)).baseName() : title;
+        }
+        case SortByArtist: {
+            const QString artist = columns.text(id, TrackStore::Artist);
+            return artist.isEmpty() ? QStringLiteral("Unknown Artist") : artist;
+        }
+        case SortByAlbum: return columns.text(id, TrackStore::Album);
+        case SortByGenre: return columns.text(id, TrackStore::Genre);
+        default: return QString();
     }
 }
 
+bool LibraryTableModel::isLessThan(SortMode mode, TrackId a, TrackId b) const
+{
+    // One track against a few others (an insert, a moved row); whole sorts go through sortIds
+    if (isTextMode(mode)) return collator.compare(sortText(tracks, mode, a), sortText(tracks, mode, b)) < 0;
+    if (mode == SortByKey) return trackKeys[a].camelot < trackKeys[b].camelot;
+    return isColumnLess(tracks, mode, a, b);
+}
+
+bool LibraryTableModel::isBefore(TrackId a, TrackId b) const
+{
+    // The filter's rank first while fuzzy matches are shown (rebuildFilteredRows)
+    if (fuzzyMatcher && filterScore[(size_t) a] != filterScore[(size_t) b])
+        return filterScore[(size_t) a] < filterScore[(size_t) b];
+    // Swapped rather than negated for descending, so equal tracks stay a strict weak ordering
+    return currentSortOrder == Qt::AscendingOrder ? isLessThan(currentSortMode, a, b)
+                                                  : isLessThan(currentSortMode, b, a);
+}
+
 // LibraryTableView Implementation
 LibraryTableView::LibraryTableView(QWidget* parent)
     : QTableView(parent)
@@ -354,11 +1394,15 @@ LibraryTableView::LibraryTableView(QWidget* parent)
     setSelectionBehavior(QAbstractItemView::SelectRows);
     setSelectionMode(QAbstractItemView::ExtendedSelection);
     setAlternatingRowColors(true);
+    setIconSize(QSize(LibraryTableModel::RowIconSize, LibraryTableModel::RowIconSize));
     
     // Configure headers
     horizontalHeader()->setStretchLastSection(true);
     horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
     verticalHeader()->setVisible(false);
+    // Fixed row heights: the view never asks off-screen rows for a size hint
+    verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 6);
     
     // Set column widths
     setColumnWidth(LibraryTableModel::TitleColumn, 250);
@@ -366,14 +1410,60 @@ LibraryTableView::LibraryTableView(QWidget* parent)
     setColumnWidth(LibraryTableModel::AlbumColumn, 200);
     setColumnWidth(LibraryTableModel::DurationColumn, 80);
     setColumnWidth(LibraryTableModel::BpmColumn, 60);
+    setColumnWidth(LibraryTableModel::KeyColumn, 60);
     setColumnWidth(LibraryTableModel::GenreColumn, 100);
     setColumnWidth(LibraryTableModel::YearColumn, 60);
     setColumnWidth(LibraryTableModel::FileSizeColumn, 80);
 }
 
+void LibraryWaveformDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    // Background, alternate row and selection as any other cell draws them
+    QStyleOptionViewItem opt(option);
+    initStyleOption(&opt, index);
+    QStyle* style = opt.widget ? opt.widget->style() : QApplication::style();
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter, opt.widget);
+
+    const QRect area = opt.rect.adjusted(2, 1, -2, -1);
+    const QSize size(std::min(area.width(), WaveformThumbnails::Width), std::min(area.height(), WaveformThumbnails::Height));
+    if (size.width() <= 0 || size.height() <= 0) return;
+    const QRect target(area.left(), area.center().y() - size.height() / 2, size.width(), size.height());
+
+    const QString filePath = index.data(Qt::UserRole).toString();
+    const QPixmap* page = nullptr;
+    QRect cell;
+    if (WaveformThumbnails::instance().find(filePath, page, cell)) {
+        // Cropped, not scaled, in a column narrower than the thumbnail
+        const qreal scale = (qreal) cell.width() / WaveformThumbnails::Width;
+        const int rowOffset = (WaveformThumbnails::Height - size.height()) / 2;
+        painter->drawPixmap(QRectF(target), *page,
+                            QRectF(cell.x(), cell.y() + rowOffset * scale, size.width() * scale, size.height() * scale));
+    } else {
+        painter->setPen(QColor(70, 70, 70));
+        painter->drawLine(target.left(), target.center().y(), target.right(), target.center().y());
+    }
+
+    const auto* view = qobject_cast<const LibraryTableView*>(opt.widget);
+    if (view != nullptr && !filePath.isEmpty() && filePath == view->getPreviewFile()) {
+        const int x = target.left() + (int) (view->getPreviewPosition() * WaveformThumbnails::Width);
+        if (x <= target.right()) {
+            painter->setPen(QColor(255, 255, 255));
+            painter->drawLine(x, target.top(), x, target.bottom());
+        }
+    }
+}
+
+QSize LibraryWaveformDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    Q_UNUSED(option);
+    Q_UNUSED(index);
+    return QSize(WaveformThumbnails::Width + 4, WaveformThumbnails::Height + 2);
+}
+
 void LibraryTableView::startDrag(Qt::DropActions supportedActions)
 {
-    QModelIndexList indexes = selectedIndexes();
+    // A row each, not a cell each
+    QModelIndexList indexes = selectionModel()->selectedRows();
     if (indexes.isEmpty()) return;
     
     QMimeData* mimeData = model()->mimeData(indexes);
@@ -390,16 +1480,64 @@ void LibraryTableView::startDrag(Qt::DropActions supportedActions)
     drag->exec(supportedActions);
 }
 
+void LibraryTableView::setPreviewPosition(const QString& filePath, double fraction)
+{
+    if (filePath == previewFile && fraction == previewPosition) return;
+    previewFile = filePath;
+    previewPosition = fraction;
+    updatePreviewRow();
+}
+
+double LibraryTableView::waveformFraction(int x) const
+{
+    // The thumbnail starts 2 px into the cell and is cropped, never scaled, in a narrower column
+    const int left = columnViewportPosition(LibraryTableModel::WaveformColumn) + 2;
+    return std::clamp((double) (x - left) / WaveformThumbnails::Width, 0.0, 1.0);
+}
+
+void LibraryTableView::updatePreviewRow()
+{
+    // The column's visible cells: cheaper than finding the row, and the thumbnails are blits
+    if (isColumnHidden(LibraryTableModel::WaveformColumn)) return;
+    viewport()->update(QRect(columnViewportPosition(LibraryTableModel::WaveformColumn), 0,
+                             columnWidth(LibraryTableModel::WaveformColumn), viewport()->height()));
+}
+
 void LibraryTableView::mousePressEvent(QMouseEvent* event)
 {
     if (event->button() == Qt::LeftButton) {
         dragStartPosition = event->pos();
+        // A press on the mini waveform previews from there and drags scrub instead of dragging the row
+        const QModelIndex index = indexAt(event->pos());
+        if (index.isValid() && index.column() == LibraryTableModel::WaveformColumn) {
+            scrubFile = index.data(Qt::UserRole).toString();
+            if (!scrubFile.isEmpty()) emit previewRequested(scrubFile, waveformFraction(event->pos().x()));
+        }
     }
     QTableView::mousePressEvent(event);
 }
 
+void LibraryTableView::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) scrubFile.clear();
+    QTableView::mouseReleaseEvent(event);
+}
+
+void LibraryTableView::keyPressEvent(QKeyEvent* event)
+{
+    if (event->key() == Qt::Key_Escape && !previewFile.isEmpty()) {
+        emit previewStopRequested();
+        return;
+    }
+    QTableView::keyPressEvent(event);
+}
+
 void LibraryTableView::mouseMoveEvent(QMouseEvent* event)
 {
+    if (!scrubFile.isEmpty() && (event->buttons() & Qt::LeftButton)) {
+        emit previewRequested(scrubFile, waveformFraction(event->pos().x()));
+        return;
+    }
     if (!(event->buttons() & Qt::LeftButton)) {
         QTableView::mouseMoveEvent(event);
         return;
@@ -427,17 +1565,61 @@ LibraryManager::LibraryManager(juce::AudioFormatManager* formatManager, QWidget*
     // Setup filter update timer (debounce filtering)
     filterUpdateTimer = new QTimer(this);
     filterUpdateTimer->setSingleShot(true);
-    filterUpdateTimer->setInterval(300); // 300ms delay
+    filterUpdateTimer->setInterval(100); // the search index makes each update cheap
     connect(filterUpdateTimer, &QTimer::timeout, this, &LibraryManager::onFilterTextChanged);
+    
+    highlightTimer = new QTimer(this);
+    highlightTimer->setSingleShot(true);
+    highlightTimer->setInterval(150);
+    connect(highlightTimer, &QTimer::timeout, this, [this]() {
+        const QModelIndex current = tableView->currentIndex();
+        if (!current.isValid()) return;
+        QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+        const int extraRows = std::max(0, prefs.value("Library/PrefetchRows", 2).toInt());
+        QStringList files;
+        for (int row = current.row(); row <= current.row() + extraRows; ++row) {
+            const QString file = model->getFilePath(row);
+            if (file.isEmpty()) break;
+            files << file;
+        }
+        if (!files.isEmpty()) emit tracksHighlighted(files);
+    });
+    
+    // Analysis results trickle in one track at a time; write them out in bursts
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(5000);
+    connect(saveTimer, &QTimer::timeout, this, [this]() {
+        if (!databasePath.isEmpty()) saveLibrary(databasePath);
+    });
+    
+    // A copied album touches its directory several times in a row; rescan once it settles
+    directoryWatcher = new QFileSystemWatcher(this);
+    connect(directoryWatcher, &QFileSystemWatcher::directoryChanged, this, &LibraryManager::onDirectoryChanged);
+    rescanTimer = new QTimer(this);
+    rescanTimer->setSingleShot(true);
+    rescanTimer->setInterval(1000);
+    connect(rescanTimer, &QTimer::timeout, this, [this]() {
+        if (isLoading) {
+            rescanTimer->start();   // addFiles would only queue; let the running scan finish first
+            return;
+        }
+        QSet<QString> directories;
+        directories.swap(changedDirectories);
+        rescanDirectories(directories);
+    });
 }
 
 LibraryManager::~LibraryManager()
 {
+    *identityStop = true;
+    *scanStop = true;
     if (loaderThread && loaderThread->isRunning()) {
         loaderThread->stop();
         loaderThread->wait(3000);
         loaderThread->deleteLater();
     }
+    if (saveScheduled && !databasePath.isEmpty()) saveLibrary(databasePath);
 }
 
 void LibraryManager::setupUI()
@@ -498,8 +1680,21 @@ void LibraryManager::setupUI()
     fileSystemTree->setDragEnabled(true);
     fileSystemTree->setDragDropMode(QAbstractItemView::DragOnly);
     
+    // Mixing candidates for the master deck's track
+    auto* compatibleHeader = new QLabel("Compatible Tracks", leftPanel);
+    compatibleHeader->setStyleSheet("font-weight: bold; padding: 5px; background-color: #2a2a2a; border-bottom: 1px solid #555;");
+    compatibleList = new DraggableListWidget(leftPanel);
+    compatibleList->setDragEnabled(true);
+    compatibleList->setStyleSheet("QListWidget { background-color: #1a1a1a; border: 1px solid #555; }");
+    connect(compatibleList, &QListWidget::itemDoubleClicked, this, [this](QListWidgetItem* item) {
+        const QString path = item->data(Qt::UserRole).toString();
+        if (!path.isEmpty()) emit fileSelected(path);
+    });
+    
     leftLayout->addWidget(browserHeader);
-    leftLayout->addWidget(fileSystemTree);
+    leftLayout->addWidget(fileSystemTree, 3);
+    leftLayout->addWidget(compatibleHeader);
+    leftLayout->addWidget(compatibleList, 2);
     
     // === RIGHT PANEL: Track Table ===
     auto* rightPanel = new QWidget();
@@ -517,6 +1712,7 @@ void LibraryManager::setupUI()
     sortComboBox->addItem("Album", LibraryTableModel::SortByAlbum);
     sortComboBox->addItem("Duration", LibraryTableModel::SortByDuration);
     sortComboBox->addItem("BPM", LibraryTableModel::SortByBpm);
+    sortComboBox->addItem("Key", LibraryTableModel::SortByKey);
     sortComboBox->addItem("Genre", LibraryTableModel::SortByGenre);
     sortComboBox->addItem("Year", LibraryTableModel::SortByYear);
     sortComboBox->addItem("File Size", LibraryTableModel::SortByFileSize);
@@ -530,6 +1726,16 @@ void LibraryManager::setupUI()
         filterUpdateTimer->start(); // Restart timer on each keystroke
     });
     
+    // Smart crates: "All Tracks", then one entry per crate
+    auto* crateLabel = new QLabel("Crate:", rightPanel);
+    crateComboBox = new QComboBox(rightPanel);
+    crateComboBox->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    connect(crateComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &LibraryManager::onCrateChanged);
+    // Picking a crate, even the one already shown, leaves the folder browser
+    connect(crateComboBox, QOverload<int>::of(&QComboBox::activated), this, &LibraryManager::leaveFolderView);
+    
+    controlsLayout->addWidget(crateLabel);
+    controlsLayout->addWidget(crateComboBox);
     controlsLayout->addWidget(sortLabel);
     controlsLayout->addWidget(sortComboBox);
     controlsLayout->addStretch();
@@ -541,26 +1747,52 @@ void LibraryManager::setupUI()
     
     addFilesButton = new QPushButton("Add Files...", rightPanel);
     addFolderButton = new QPushButton("Add Folder...", rightPanel);
+    importButton = new QPushButton("Import Collection...", rightPanel);
+    importButton->setToolTip("Rekordbox XML or Traktor NML: tracks, beat grids, hot cues and playlists");
     refreshButton = new QPushButton("Refresh", rightPanel);
     clearLibraryButton = new QPushButton("Clear Library", rightPanel);
+    auto* newCrateButton = new QPushButton("New Crate...", rightPanel);
+    editCrateButton = new QPushButton("Edit Crate...", rightPanel);
+    deleteCrateButton = new QPushButton("Delete Crate", rightPanel);
+    prepareCrateButton = new QPushButton("Prepare for Gig", rightPanel);
+    prepareCrateButton->setToolTip("Analyse, verify and cache every track of the crate and keep it cached for the set");
     
     connect(addFilesButton, &QPushButton::clicked, this, &LibraryManager::onAddFilesClicked);
     connect(addFolderButton, &QPushButton::clicked, this, &LibraryManager::onAddFolderClicked);
+    connect(importButton, &QPushButton::clicked, this, &LibraryManager::onImportClicked);
     connect(refreshButton, &QPushButton::clicked, this, &LibraryManager::onRefreshClicked);
     connect(clearLibraryButton, &QPushButton::clicked, this, &LibraryManager::onClearLibraryClicked);
+    connect(newCrateButton, &QPushButton::clicked, this, &LibraryManager::onNewCrateClicked);
+    connect(editCrateButton, &QPushButton::clicked, this, &LibraryManager::onEditCrateClicked);
+    connect(deleteCrateButton, &QPushButton::clicked, this, &LibraryManager::onDeleteCrateClicked);
+    connect(prepareCrateButton, &QPushButton::clicked, this, &LibraryManager::onPrepareCrateClicked);
     
     buttonsLayout->addWidget(addFilesButton);
     buttonsLayout->addWidget(addFolderButton);
+    buttonsLayout->addWidget(importButton);
     buttonsLayout->addWidget(refreshButton);
     buttonsLayout->addStretch();
+    buttonsLayout->addWidget(newCrateButton);
+    buttonsLayout->addWidget(editCrateButton);
+    buttonsLayout->addWidget(deleteCrateButton);
+    buttonsLayout->addWidget(prepareCrateButton);
     buttonsLayout->addWidget(clearLibraryButton);
     
     // Table view
     model = new LibraryTableModel(rightPanel);
     tableView = new LibraryTableView(rightPanel);
     tableView->setModel(model);
+    // The Waveform column sits next to the title; rows only ask for their thumbnail while it is shown
+    tableView->setItemDelegateForColumn(LibraryTableModel::WaveformColumn, new LibraryWaveformDelegate(tableView));
+    tableView->horizontalHeader()->moveSection(LibraryTableModel::WaveformColumn, LibraryTableModel::TitleColumn + 1);
+    tableView->setColumnWidth(LibraryTableModel::WaveformColumn, WaveformThumbnails::Width + 4);
+    applyViewSettings();
     
     connect(tableView, &QTableView::doubleClicked, this, &LibraryManager::onTableDoubleClicked);
+    connect(tableView, &LibraryTableView::previewRequested, this, &LibraryManager::previewRequested);
+    connect(tableView, &LibraryTableView::previewStopRequested, this, &LibraryManager::previewStopRequested);
+    tableView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(tableView, &QWidget::customContextMenuRequested, this, &LibraryManager::onTableContextMenu);
     connect(tableView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &LibraryManager::onSelectionChanged);
     
     // Status and progress for right panel
@@ -568,8 +1800,27 @@ void LibraryManager::setupUI()
     statusLabel = new QLabel("Ready", rightPanel);
     progressBar = new QProgressBar(rightPanel);
     progressBar->setVisible(false);
+    // Busy, no range: shown for a background sort only once it takes long enough to notice
+    busyIndicator = new QProgressBar(rightPanel);
+    busyIndicator->setRange(0, 0);
+    busyIndicator->setMaximumWidth(60);
+    busyIndicator->setTextVisible(false);
+    busyIndicator->setVisible(false);
+    busyTimer = new QTimer(this);
+    busyTimer->setSingleShot(true);
+    busyTimer->setInterval(50);
+    connect(busyTimer, &QTimer::timeout, busyIndicator, &QWidget::show);
+    connect(model, &LibraryTableModel::busyChanged, this, [this](bool busy) {
+        if (busy) {
+            if (!busyTimer->isActive() && !busyIndicator->isVisible()) busyTimer->start();
+            return;
+        }
+        busyTimer->stop();
+        busyIndicator->hide();
+    });
     
     statusLayout->addWidget(statusLabel, 1);
+    statusLayout->addWidget(busyIndicator);
     statusLayout->addWidget(progressBar);
     
     // Assemble right panel
@@ -590,6 +1841,7 @@ void LibraryManager::setupUI()
     // Add splitter to main layout
     mainLayout->addWidget(mainSplitter);
     
+    updateCrateSelector();
     updateStatusLabel();
 }
 
@@ -624,6 +1876,8 @@ void LibraryManager::setupFileSystemModel()
     // Connect file system tree selection
     connect(fileSystemTree->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &LibraryManager::onFileSystemSelectionChanged);
+    folderListings = new DirectoryListingCache(AudioNameFilters, this);
+    connect(folderListings, &DirectoryListingCache::listed, this, &LibraryManager::onDirectoryListed);
     
     // Enable drag from file system tree
     fileSystemTree->setDragEnabled(true);
@@ -632,7 +1886,7 @@ void LibraryManager::setupFileSystemModel()
 
 void LibraryManager::addFiles(const QStringList& files)
 {
-    if (files.isEmpty() || isLoading) return;
+    if (files.isEmpty()) return;
     
     // Filter for supported audio files
     QStringList audioFiles;
@@ -646,10 +1900,27 @@ void LibraryManager::addFiles(const QStringList& files)
         }
     }
     
-    if (audioFiles.isEmpty()) {
+    if (audioFiles.isEmpty() && !isLoading) {
         QMessageBox::information(this, "No Audio Files", "No supported audio files found.");
         return;
     }
+    scanFiles(audioFiles);
+}
+
+void LibraryManager::scanFiles(QStringList audioFiles)
+{
+    if (isLoading) {
+        pendingFiles += audioFiles;
+        return;
+    }
+    
+    // Tags of files already in the library aren't read again
+    audioFiles.removeIf([this](const QString& file) { return model->contains(file); });
+    if (audioFiles.isEmpty()) {
+        watchScannedDirectories();
+        scheduleSave();   // scannedDirectories may have changed
+        return;
+    }
     
     // Start background loading
     isLoading = true;
@@ -657,10 +1928,17 @@ void LibraryManager::addFiles(const QStringList& files)
     progressBar->setRange(0, audioFiles.size());
     progressBar->setValue(0);
     
-    loaderThread = new ID3LoaderThread(audioFiles, audioFormatManager, this);
-    connect(loaderThread, &ID3LoaderThread::trackLoaded, this, &LibraryManager::onTrackLoaded);
-    connect(loaderThread, &ID3LoaderThread::progressUpdated, this, &LibraryManager::onLoadingProgress);
-    connect(loaderThread, &ID3LoaderThread::finished, this, &LibraryManager::onLoadingFinished);
+    loaderThread = new TagScannerThread(audioFiles, audioFormatManager, model->getRemovedTracks(), this);
+    QHash<QString, TagScannerThread::FileStat> stats;
+    for (const QString& file : audioFiles) {
+        const auto found = scannedFileStats.constFind(file);
+        if (found != scannedFileStats.constEnd()) stats.insert(file, *found);
+    }
+    for (auto it = stats.constBegin(); it != stats.constEnd(); ++it) scannedFileStats.remove(it.key());
+    loaderThread->setKnownStats(std::move(stats));
+    connect(loaderThread, &TagScannerThread::tracksLoaded, this, &LibraryManager::onTracksLoaded);
+    connect(loaderThread, &TagScannerThread::progressUpdated, this, &LibraryManager::onLoadingProgress);
+    connect(loaderThread, &TagScannerThread::finished, this, &LibraryManager::onLoadingFinished);
     
     loaderThread->start();
     
@@ -669,24 +1947,64 @@ void LibraryManager::addFiles(const QStringList& files)
 
 void LibraryManager::addDirectory(const QString& directory, bool recursive)
 {
-    if (directory.isEmpty() || isLoading) return;
-    
-    QStringList audioFiles = getSupportedAudioFiles(directory, recursive);
-    addFiles(audioFiles);
+    if (directory.isEmpty()) return;
+    
+    // Walked on the pool; every batch found goes into the tag scan while the walk goes on
+    const QString root = QDir::cleanPath(QFileInfo(directory).absoluteFilePath());
+    ++directoryScans;
+    statusLabel->setText(QString("Scanning %1...").arg(QDir(root).dirName()));
+    QPointer<LibraryManager> self(this);
+    QThreadPool::globalInstance()->start([self, root, recursive, stop = scanStop]() {
+        DirectoryScanner::Options options;
+        options.extensions = audioExtensions();
+        options.recursive = recursive;
+        options.shouldStop = [stop] { return stop->load(); };
+        const auto started = std::chrono::steady_clock::now();
+        int found = 0;
+        DirectoryScanner::scan(root.toStdString(), options, [&](DirectoryScanner::Batch&& batch) {
+            found += (int) batch.files.size();
+            QMetaObject::invokeMethod(qApp, [self, stop, batch = std::move(batch)]() mutable {
+                if (!self || *stop) return;
+                self->directoryScanFiles += (int) batch.files.size();
+                self->scanFiles(self->takeScanBatch(batch));
+                if (!self->isLoading)
+                    self->statusLabel->setText(QString("Scanning: %1 files found...").arg(self->directoryScanFiles));
+            }, Qt::QueuedConnection);
+        });
+        std::cout << "LibraryManager: " << root.toStdString() << ": " << found << " audio files in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count()
+                  << " ms (" << DirectoryScanner::getBackendName() << ")" << std::endl;
+        QMetaObject::invokeMethod(qApp, [self]() {
+            if (!self) return;
+            if (--self->directoryScans == 0) self->directoryScanFiles = 0;
+            // A walk that found nothing new still has directories to watch and save
+            if (!self->isLoading) self->scanFiles({});
+        }, Qt::QueuedConnection);
+    });
 }
 
-QStringList LibraryManager::getSupportedAudioFiles(const QString& directory, bool recursive)
+QStringList LibraryManager::takeScanBatch(DirectoryScanner::Batch& batch)
 {
+    for (const auto& directory : batch.directories)
+        scannedDirectories.insert(QString::fromStdString(directory.path), directory.modifiedMs);
     QStringList files;
-    QStringList nameFilters = {"*.mp3", "*.wav", "*.flac", "*.aac", "*.ogg", "*.m4a"};
-    
-    QDirIterator::IteratorFlag flags = recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags;
-    QDirIterator it(directory, nameFilters, QDir::Files, flags);
-    
-    while (it.hasNext()) {
-        files.append(it.next());
+    files.reserve((int) batch.files.size());
+    for (const auto& file : batch.files) {
+        const QString path = QString::fromStdString(file.path);
+        scannedFileStats.insert(path, { file.size, file.modifiedMs });
+        files.append(path);
     }
-    
+    return files;
+}
+
+QStringList LibraryManager::getSupportedAudioFiles(const QString& directory, bool recursive)
+{
+    DirectoryScanner::Options options;
+    options.extensions = audioExtensions();
+    options.recursive = recursive;
+    QStringList files;
+    DirectoryScanner::scan(QDir::cleanPath(QFileInfo(directory).absoluteFilePath()).toStdString(), options,
+                           [&](DirectoryScanner::Batch&& batch) { files += takeScanBatch(batch); });
     return files;
 }
 
@@ -696,9 +2014,9 @@ QStringList LibraryManager::getSelectedFiles() const
     QModelIndexList indexes = tableView->selectionModel()->selectedRows();
     
     for (const QModelIndex& index : indexes) {
-        const TrackInfo* track = model->getTrack(index.row());
-        if (track) {
-            files.append(track->filePath);
+        const QString file = model->getFilePath(index.row());
+        if (!file.isEmpty()) {
+            files.append(file);
         }
     }
     
@@ -709,10 +2027,7 @@ QString LibraryManager::getCurrentFile() const
 {
     QModelIndex current = tableView->currentIndex();
     if (current.isValid()) {
-        const TrackInfo* track = model->getTrack(current.row());
-        if (track) {
-            return track->filePath;
-        }
+        return model->getFilePath(current.row());
     }
     return QString();
 }
@@ -724,18 +2039,228 @@ void LibraryManager::clearLibrary()
         loaderThread->wait(1000);
     }
     
+    // Walks still running would add to the cleared library
+    *scanStop = true;
+    scanStop = std::make_shared<std::atomic<bool>>(false);
     model->clearTracks();
+    scannedDirectories.clear();
+    scannedFileStats.clear();
+    changedDirectories.clear();
+    pendingFiles.clear();
+    const QStringList watched = directoryWatcher->directories();
+    if (!watched.isEmpty()) directoryWatcher->removePaths(watched);
+    scheduleSave();
+    updateStatusLabel();
+}
+
+bool LibraryManager::saveLibrary(const QString& filePath)
+{
+    LibraryDatabase::Contents contents;
+    contents.tracks = model->getAllTracks();
+    contents.crates = model->getCrates();
+    contents.directories.reserve(scannedDirectories.size());
+    for (auto it = scannedDirectories.constBegin(); it != scannedDirectories.constEnd(); ++it) {
+        contents.directories.append({ it.key(), it.value() });
+    }
+    
+    saveScheduled = false;
+    saveTimer->stop();
+    return LibraryDatabase::save(filePath, contents);
+}
+
+struct LibraryManager::StoredLibrary {
+    LibraryDatabase::Contents contents;
+    QSet<QString> modified;     // directories whose listing changed since they were scanned
+};
+
+bool LibraryManager::readStore(const QString& filePath, bool rescanChanged, StoredLibrary& stored)
+{
+    if (!LibraryDatabase::load(filePath, stored.contents)) return false;
+    if (!rescanChanged) return true;
+    for (const auto& dir : stored.contents.directories) {
+        const QFileInfo info(dir.path);
+        if (!info.isDir() || info.lastModified().toMSecsSinceEpoch() != dir.modifiedMs) {
+            stored.modified.insert(dir.path);
+        }
+    }
+    return true;
+}
+
+void LibraryManager::applyStore(const QString& filePath, StoredLibrary& stored)
+{
+    for (const auto& dir : stored.contents.directories) {
+        scannedDirectories.insert(dir.path, dir.modifiedMs);
+    }
+    
+    // Crates first, so their membership builds up as the tracks go in
+    model->setCrates(stored.contents.crates);
+    updateCrateSelector();
+    model->addTracks(stored.contents.tracks);
+    std::cout << "LibraryManager: " << stored.contents.tracks.size() << " tracks from " << filePath.toStdString()
+              << ", " << stored.modified.size() << " directories to rescan" << std::endl;
+    emit libraryUpdated();
+    
+    // Also starts watching everything the store knows about
+    rescanDirectories(stored.modified);
+    fillTrackIdentities();
+}
+
+void LibraryManager::fillTrackIdentities()
+{
+    constexpr int Batch = 256;
+    if (fillingIdentities) return;
+    fillingIdentities = true;
+    QPointer<LibraryManager> self(this);
+    // Read from a snapshot: the library goes on ingesting (and may be cleared) meanwhile
+    QThreadPool::globalInstance()->start([self, library = model->getSnapshot(), stop = identityStop]() {
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+        QVector<QPair<QString, quint64>> batch;
+        auto post = [&](bool last) {
+            QMetaObject::invokeMethod(qApp, [self, batch, last]() {
+                if (!self) return;
+                for (const auto& [path, identity] : batch) self->model->setTrackIdentity(path, identity);
+                if (!last) return;
+                self->fillingIdentities = false;
+                self->scheduleSave();
+            }, Qt::QueuedConnection);
+            batch.clear();
+        };
+        for (int id = 0; id < library->size(); ++id) {
+            if (*stop) return;
+            if (library->isRemoved(id) || library->identity(id) != 0) continue;
+            const QString file = library->text(id, TrackStore::FilePath);
+            const quint64 identity = ContentHash::identityFor(juce::File(file.toStdString()));
+            if (identity != 0) batch.append({ file, identity });
+            if (batch.size() >= Batch) post(false);
+        }
+        post(true);
+    });
+}
+
+bool LibraryManager::loadLibrary(const QString& filePath, bool rescanChanged)
+{
+    databasePath = filePath;
+    StoredLibrary stored;
+    if (!readStore(filePath, rescanChanged, stored)) return false;
+    applyStore(filePath, stored);
+    return true;
+}
+
+void LibraryManager::loadLibraryAsync(const QString& filePath, bool rescanChanged, std::function<void(bool)> done)
+{
+    QPointer<LibraryManager> self(this);
+    QThreadPool::globalInstance()->start([self, filePath, rescanChanged, done]() {
+        auto stored = std::make_shared<StoredLibrary>();
+        const bool loaded = readStore(filePath, rescanChanged, *stored);
+        // qApp outlives the manager; the guard is only checked back on the UI thread
+        QMetaObject::invokeMethod(qApp, [self, filePath, stored, loaded, done]() {
+            if (!self) return;
+            self->databasePath = filePath;
+            if (loaded) self->applyStore(filePath, *stored);
+            if (done) done(loaded);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LibraryManager::rescanDirectories(const QSet<QString>& directories)
+{
+    QStringList toRemove, toLoad;
+    for (const QString& path : directories) {
+        QStringList known = model->getFilesInDirectory(path);
+        const QDir dir(path);
+        if (!dir.exists()) {
+            toRemove += known;
+            scannedDirectories.remove(path);
+            directoryWatcher->removePath(path);
+            continue;
+        }
+        scannedDirectories.insert(path, QFileInfo(path).lastModified().toMSecsSinceEpoch());
+        
+        QSet<QString> vanished(known.begin(), known.end());
+        for (const QFileInfo& info : dir.entryInfoList(AudioNameFilters, QDir::Files)) {
+            const QString file = info.absoluteFilePath();
+            vanished.remove(file);
+            const auto track = model->getTrackByPath(file);
+            if (track && track->fileSize == info.size()
+                && track->modifiedMs == info.lastModified().toMSecsSinceEpoch()) {
+                continue;
+            }
+            if (track) {
+                // Changed: read its tags again, but it stays as old as it was
+                toRemove.append(file);
+                reloadedAddedMs.insert(file, track->addedMs);
+            }
+            toLoad.append(file);
+        }
+        toRemove += QStringList(vanished.begin(), vanished.end());
+        
+        // A directory added with its subdirectories picks up new ones
+        const QFileInfoList subdirs = dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+        const bool recursive = std::any_of(subdirs.begin(), subdirs.end(), [this](const QFileInfo& sub) {
+            return scannedDirectories.contains(sub.absoluteFilePath());
+        });
+        for (const QFileInfo& sub : subdirs) {
+            if (recursive && !scannedDirectories.contains(sub.absoluteFilePath())) {
+                toLoad += getSupportedAudioFiles(sub.absoluteFilePath(), true);
+            }
+        }
+    }
+    
+    model->removeTracks(toRemove);
+    watchScannedDirectories();
     updateStatusLabel();
+    if (!directories.isEmpty()) scheduleSave();
+    if (!toLoad.isEmpty()) addFiles(toLoad);
 }
 
-void LibraryManager::onTrackLoaded(const TrackInfo& track)
+void LibraryManager::watchScannedDirectories()
 {
-    model->addTrack(track);
+    const QStringList watched = directoryWatcher->directories();
+    const QSet<QString> watchedSet(watched.begin(), watched.end());
+    QStringList missing;
+    for (auto it = scannedDirectories.constBegin(); it != scannedDirectories.constEnd(); ++it) {
+        if (!watchedSet.contains(it.key())) missing.append(it.key());
+    }
+    if (missing.isEmpty()) return;
+    
+    const QStringList failed = directoryWatcher->addPaths(missing);
+    if (!failed.isEmpty()) {
+        std::cout << "LibraryManager: could not watch " << failed.size()
+                  << " directories (system watch limit?), they update on the next start" << std::endl;
+    }
+}
+
+void LibraryManager::onDirectoryChanged(const QString& path)
+{
+    changedDirectories.insert(path);
+    if (!rescanTimer->isActive()) rescanTimer->start();
+}
+
+void LibraryManager::scheduleSave()
+{
+    if (databasePath.isEmpty()) return;
+    saveScheduled = true;
+    if (!saveTimer->isActive()) saveTimer->start();
+}
+
+void LibraryManager::onTracksLoaded(const QVector<TrackInfo>& tracks)
+{
+    if (!reloadedAddedMs.isEmpty()) {
+        QVector<TrackInfo> reloaded = tracks;
+        for (auto& track : reloaded)
+            if (reloadedAddedMs.contains(track.filePath)) track.addedMs = reloadedAddedMs.take(track.filePath);
+        model->addTracks(reloaded);
+        updateStatusLabel();
+        return;
+    }
+    model->addTracks(tracks);
     updateStatusLabel();
 }
 
 void LibraryManager::onLoadingProgress(int current, int total)
 {
+    // Workers report independently, so counts can arrive slightly out of order
+    current = std::max(current, progressBar->value());
     progressBar->setValue(current);
     statusLabel->setText(QString("Loading files... %1/%2").arg(current).arg(total));
 }
@@ -750,6 +2275,16 @@ void LibraryManager::onLoadingFinished()
         loaderThread->deleteLater();
         loaderThread = nullptr;
     }
+    watchScannedDirectories();
+    scheduleSave();
+    refreshCompatibleTracks();
+    emit libraryUpdated();
+    
+    if (!pendingFiles.isEmpty()) {
+        QStringList files;
+        files.swap(pendingFiles);
+        scanFiles(files);
+    }
 }
 
 void LibraryManager::onSortModeChanged()
@@ -792,6 +2327,72 @@ void LibraryManager::onAddFolderClicked()
     }
 }
 
+void LibraryManager::onImportClicked()
+{
+    const QString file = QFileDialog::getOpenFileName(
+        this,
+        "Import Collection",
+        QStandardPaths::writableLocation(QStandardPaths::MusicLocation),
+        "DJ Collections (*.xml *.nml);;Rekordbox XML (*.xml);;Traktor NML (*.nml);;All Files (*)"
+    );
+    if (!file.isEmpty()) importCollection(file);
+}
+
+void LibraryManager::importCollection(const QString& filePath)
+{
+    if (importing) return;
+    importing = true;
+    importButton->setEnabled(false);
+    progressBar->setVisible(true);
+    progressBar->setRange(0, 1000);
+    progressBar->setValue(0);
+    statusLabel->setText(QString("Importing %1...").arg(QFileInfo(filePath).fileName()));
+
+    QPointer<LibraryManager> self(this);
+    const juce::File bpmCacheDirectory(AppConfig::instance().getBpmCacheDirectory().toStdString());
+    QThreadPool::globalInstance()->start([self, filePath, bpmCacheDirectory]() {
+        CollectionImporter importer(bpmCacheDirectory);
+        // qApp outlives the manager; the guard is only checked back on the UI thread
+        auto onTracks = [self](const QVector<TrackInfo>& tracks) {
+            QMetaObject::invokeMethod(qApp, [self, tracks]() {
+                if (!self) return;
+                self->model->addTracks(tracks);
+                self->updateStatusLabel();
+            }, Qt::QueuedConnection);
+        };
+        auto onProgress = [self](qint64 bytesRead, qint64 totalBytes) {
+            const int permille = totalBytes > 0 ? (int) (bytesRead * 1000 / totalBytes) : 0;
+            QMetaObject::invokeMethod(qApp, [self, permille]() {
+                if (self) self->progressBar->setValue(permille);
+            }, Qt::QueuedConnection);
+        };
+        auto result = std::make_shared<CollectionImporter::Result>(importer.run(filePath, onTracks, onProgress));
+        QMetaObject::invokeMethod(qApp, [self, result]() {
+            if (!self) return;
+            self->importing = false;
+            self->importButton->setEnabled(true);
+            self->progressBar->setVisible(self->isLoading);
+            // A playlist imported again replaces its crate
+            for (const SmartCrate& playlist : result->playlists) {
+                int index = 0;
+                while (index < self->model->getCrateCount() && self->model->getCrate(index).name != playlist.name) ++index;
+                self->model->setCrate(index, playlist);
+            }
+            self->updateCrateSelector();
+            self->updateStatusLabel();
+            self->scheduleSave();
+            self->refreshCompatibleTracks();
+            self->fillTrackIdentities();
+            emit self->libraryUpdated();
+            QString summary = QString("Imported %1 tracks, %2 beat grids, %3 playlists")
+                .arg(result->tracks).arg(result->beatGrids).arg(result->playlists.size());
+            if (result->missing > 0) summary += QString(" (%1 files not found)").arg(result->missing);
+            if (!result->error.isEmpty()) summary = QString("Import stopped: %1. %2").arg(result->error, summary);
+            self->statusLabel->setText(summary);
+        }, Qt::QueuedConnection);
+    });
+}
+
 void LibraryManager::onRefreshClicked()
 {
     // Refresh the current folder view
@@ -807,25 +2408,51 @@ void LibraryManager::onFileSystemSelectionChanged()
     QModelIndexList selected = fileSystemTree->selectionModel()->selectedIndexes();
     if (selected.isEmpty()) return;
     
-    QModelIndex index = selected.first();
-    QString path = fileSystemModel->filePath(index);
-    QFileInfo info(path);
+    // The model's own file info: nothing here waits for the disk
+    const QModelIndex index = selected.first();
+    const QString path = fileSystemModel->filePath(index);
+    const bool isDir = fileSystemModel->isDir(index);
+    browsedDirectory = isDir ? path : QFileInfo(path).absolutePath();
     
-    if (info.isDir()) {
-        // If it's a directory, load all audio files from it
-        QStringList audioFiles = getSupportedAudioFiles(path, false); // Don't recurse
-        if (!audioFiles.isEmpty()) {
-            // Clear current library and load this folder
-            model->clearTracks();
-            addFiles(audioFiles);
-        }
-    } else if (info.isFile()) {
-        // If it's a file, load just this file
-        QStringList singleFile;
-        singleFile << path;
-        model->clearTracks();
-        addFiles(singleFile);
+    // The library's tracks in the folder show at once; the listing adds the ones it lacks
+    model->setFolderFilter(browsedDirectory);
+    updateStatusLabel();
+    if (!isDir) {
+        scanFiles({ path });
+        return;
     }
+    QStringList files;
+    if (folderListings->find(browsedDirectory, files)) addBrowsedFiles(files);
+    folderListings->request(browsedDirectory);
+}
+
+void LibraryManager::onDirectoryListed(const QString& directory, const QStringList& files, qint64 modifiedMs)
+{
+    // Watched and rescanned from now on, as a folder added by hand is
+    if (!files.isEmpty() && modifiedMs >= 0 && scannedDirectories.value(directory, -1) != modifiedMs) {
+        scannedDirectories.insert(directory, modifiedMs);
+        watchScannedDirectories();
+        scheduleSave();
+    }
+    // A folder clicked past while it was being listed is still cached for the next visit
+    if (directory == browsedDirectory && model->hasFolderFilter()) addBrowsedFiles(files);
+}
+
+void LibraryManager::addBrowsedFiles(const QStringList& files)
+{
+    QStringList unknown;
+    for (const QString& file : files)
+        if (!model->contains(file)) unknown.append(file);
+    if (!unknown.isEmpty()) scanFiles(unknown);
+}
+
+void LibraryManager::leaveFolderView()
+{
+    if (!model->hasFolderFilter()) return;
+    browsedDirectory.clear();
+    fileSystemTree->clearSelection();
+    model->setFolderFilter({});
+    updateStatusLabel();
 }
 
 void LibraryManager::onClearLibraryClicked()
@@ -845,19 +2472,49 @@ void LibraryManager::onClearLibraryClicked()
 
 void LibraryManager::onTableDoubleClicked(const QModelIndex& index)
 {
-    const TrackInfo* track = model->getTrack(index.row());
-    if (track) {
-        emit fileSelected(track->filePath);
+    const QString file = model->getFilePath(index.row());
+    if (!file.isEmpty()) {
+        emit fileSelected(file);
     }
 }
 
-void LibraryManager::onSelectionChanged()
+void LibraryManager::onTableContextMenu(const QPoint& pos)
 {
-    // Optional: emit signal when selection changes
-    QString currentFile = getCurrentFile();
-    if (!currentFile.isEmpty()) {
-        // Could emit a preview signal here
+    const QModelIndex index = tableView->indexAt(pos);
+    const QString file = index.isValid() ? model->getFilePath(index.row()) : QString();
+    if (file.isEmpty()) return;
+    const QStringList versions = model->getVersions(file);
+    if (versions.size() < 2) return;
+    
+    QMenu menu(this);
+    menu.addSection(tr("Versions of this recording"));
+    for (int i = 0; i < versions.size(); ++i) {
+        const auto version = model->getTrackByPath(versions[i]);
+        if (!version) continue;
+        const QFileInfo info(version->filePath);
+        const int kbps = version->duration > 0.0 ? (int) (version->fileSize * 8 / version->duration / 1000.0) : 0;
+        QString text = QString("%1 - %2  (%3, %4 kbps)").arg(version->getDisplayArtist(), version->getDisplayTitle(),
+                                                            info.suffix().toUpper()).arg(kbps);
+        if (i == 0) text += tr("  - best");
+        if (version->filePath == file) text += tr("  - this one");
+        QAction* action = menu.addAction(text);
+        action->setToolTip(version->filePath);
+        const QString path = version->filePath;
+        connect(action, &QAction::triggered, this, [this, path]() { emit fileSelected(path); });
     }
+    menu.exec(tableView->viewport()->mapToGlobal(pos));
+}
+
+void LibraryManager::onSelectionChanged()
+{
+    if (!getCurrentFile().isEmpty()) highlightTimer->start();
+}
+
+void LibraryManager::applyViewSettings()
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    tableView->setColumnHidden(LibraryTableModel::WaveformColumn, !prefs.value("Library/ShowWaveforms", false).toBool());
+    model->setFuzzySearch(prefs.value("Library/FuzzySearch", true).toBool());
 }
 
 void LibraryManager::updateStatusLabel()
@@ -869,9 +2526,187 @@ void LibraryManager::updateStatusLabel()
     
     if (total == 0) {
         statusLabel->setText("Library is empty. Add some music files!");
+    } else if (model->hasFolderFilter()) {
+        statusLabel->setText(QString("%1 tracks in %2").arg(filtered).arg(QDir(browsedDirectory).dirName()));
     } else if (filtered == total) {
         statusLabel->setText(QString("%1 tracks").arg(total));
     } else {
         statusLabel->setText(QString("%1 of %2 tracks").arg(filtered).arg(total));
     }
+    
+    for (int i = 0; i < model->getCrateCount() && i + 1 < crateComboBox->count(); ++i) {
+        crateComboBox->setItemText(i + 1, QString("%1 (%2)").arg(model->getCrate(i).name).arg(model->getCrateSize(i)));
+    }
+}
+
+void LibraryManager::onPrepareCrateClicked()
+{
+    if (gigPrepRunning) {
+        emit gigPrepCancelRequested();
+        return;
+    }
+    const int crate = model->getActiveCrate();
+    if (crate < 0) return;
+    emit gigPrepRequested(model->getCrate(crate).name, model->getCrateFilePaths(crate));
+}
+
+void LibraryManager::setGigPrepProgress(int done, int total)
+{
+    gigPrepRunning = total > 0;
+    prepareCrateButton->setText(gigPrepRunning ? QString("Preparing %1/%2 (Cancel)").arg(done).arg(total) : QString("Prepare for Gig"));
+    prepareCrateButton->setEnabled(gigPrepRunning || model->getActiveCrate() >= 0);
+}
+
+void LibraryManager::showCompatibleTracks(const QString& referencePath, double bpm)
+{
+    if (referencePath == compatibleReference && std::abs(bpm - compatibleBpm) < 0.05) return;
+    compatibleReference = referencePath;
+    compatibleBpm = bpm;
+    refreshCompatibleTracks();
+}
+
+QVector<TrackInfo> LibraryManager::findCompatible(const QString& referencePath, double bpm, int limit) const
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const double range = prefs.value("Library/CompatibleBpmRange", 6.0).toDouble();
+    const auto reference = model->getTrackByPath(referencePath);
+    const int key = reference ? KeyDetector::parse(reference->key.toStdString()) : -1;
+    return model->findCompatibleTracks(bpm, key, range, limit, referencePath);
+}
+
+QStringList LibraryManager::getCompatibleFiles(const QString& referencePath, double bpm, int limit) const
+{
+    QStringList files;
+    if (referencePath.isEmpty() || bpm <= 0.0) return files;
+    for (const TrackInfo& track : findCompatible(referencePath, bpm, limit)) files.append(track.filePath);
+    return files;
+}
+
+void LibraryManager::refreshCompatibleTracks()
+{
+    constexpr int MaxCandidates = 50;
+    compatibleList->clear();
+    if (compatibleReference.isEmpty() || compatibleBpm <= 0.0) return;
+    
+    for (const TrackInfo& track : findCompatible(compatibleReference, compatibleBpm, MaxCandidates)) {
+        const double shift = (track.bpm / compatibleBpm - 1.0) * 100.0;
+        auto* item = new QListWidgetItem(QString("%1 - %2\n%3 BPM (%4%5%)  %6")
+            .arg(track.getDisplayArtist(), track.getDisplayTitle(), track.getBpmString())
+            .arg(shift >= 0.0 ? "+" : "").arg(QString::number(shift, 'f', 1)).arg(track.getCamelotString()));
+        item->setData(Qt::UserRole, track.filePath);
+        item->setToolTip(track.filePath);
+        compatibleList->addItem(item);
+    }
+}
+
+void LibraryManager::updateCrateSelector()
+{
+    const QSignalBlocker blocker(crateComboBox);
+    crateComboBox->clear();
+    crateComboBox->addItem("All Tracks", -1);
+    for (int i = 0; i < model->getCrateCount(); ++i) {
+        crateComboBox->addItem(model->getCrate(i).name, i);
+        crateComboBox->setItemData(i + 1, model->getCrate(i).describe(), Qt::ToolTipRole);
+    }
+    crateComboBox->setCurrentIndex(model->getActiveCrate() + 1);
+    editCrateButton->setEnabled(model->getActiveCrate() >= 0);
+    deleteCrateButton->setEnabled(model->getActiveCrate() >= 0);
+    prepareCrateButton->setEnabled(gigPrepRunning || model->getActiveCrate() >= 0);
+}
+
+// Rules form for a new or existing crate; false if cancelled
+static bool editSmartCrate(QWidget* parent, SmartCrate& crate)
+{
+    QDialog dialog(parent);
+    dialog.setWindowTitle(crate.name.isEmpty() ? "New Smart Crate" : "Edit Smart Crate");
+    auto* form = new QFormLayout(&dialog);
+    
+    auto* nameEdit = new QLineEdit(crate.name, &dialog);
+    auto bpmSpin = [&dialog](double value) {
+        auto* spin = new QDoubleSpinBox(&dialog);
+        spin->setRange(0.0, 300.0);
+        spin->setDecimals(1);
+        spin->setSpecialValueText("Any");
+        spin->setValue(value);
+        return spin;
+    };
+    auto* minBpmSpin = bpmSpin(crate.minBpm);
+    auto* maxBpmSpin = bpmSpin(crate.maxBpm);
+    auto* keysEdit = new QLineEdit(crate.keys.join(' '), &dialog);
+    keysEdit->setPlaceholderText("Any key, e.g. 8A 9A Am");
+    auto* genresEdit = new QLineEdit(crate.genres.join(", "), &dialog);
+    genresEdit->setPlaceholderText("Any genre, e.g. House, Techno");
+    auto* addedSpin = new QSpinBox(&dialog);
+    addedSpin->setRange(0, 3650);
+    addedSpin->setSpecialValueText("Any time");
+    addedSpin->setSuffix(" days");
+    addedSpin->setValue(crate.addedWithinDays);
+    
+    form->addRow("Name:", nameEdit);
+    form->addRow("Min BPM:", minBpmSpin);
+    form->addRow("Max BPM:", maxBpmSpin);
+    form->addRow("Keys:", keysEdit);
+    form->addRow("Genres:", genresEdit);
+    form->addRow("Added within:", addedSpin);
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    QObject::connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(buttons);
+    
+    if (dialog.exec() != QDialog::Accepted) return false;
+    crate.name = nameEdit->text().trimmed().isEmpty() ? QString("Smart Crate") : nameEdit->text().trimmed();
+    crate.minBpm = minBpmSpin->value();
+    crate.maxBpm = maxBpmSpin->value();
+    crate.keys = keysEdit->text().split(QRegularExpression("[\\s,]+"), Qt::SkipEmptyParts);
+    crate.genres.clear();
+    for (const QString& genre : genresEdit->text().split(',', Qt::SkipEmptyParts)) {
+        if (!genre.trimmed().isEmpty()) crate.genres.append(genre.trimmed());
+    }
+    crate.addedWithinDays = addedSpin->value();
+    return true;
+}
+
+void LibraryManager::onCrateChanged()
+{
+    model->setActiveCrate(crateComboBox->currentData().toInt());
+    editCrateButton->setEnabled(model->getActiveCrate() >= 0);
+    deleteCrateButton->setEnabled(model->getActiveCrate() >= 0);
+    prepareCrateButton->setEnabled(gigPrepRunning || model->getActiveCrate() >= 0);
+    updateStatusLabel();
+}
+
+void LibraryManager::onNewCrateClicked()
+{
+    SmartCrate crate;
+    if (!editSmartCrate(this, crate)) return;
+    model->setCrate(model->getCrateCount(), crate);
+    model->setActiveCrate(model->getCrateCount() - 1);
+    updateCrateSelector();
+    updateStatusLabel();
+    scheduleSave();
+}
+
+void LibraryManager::onEditCrateClicked()
+{
+    const int index = model->getActiveCrate();
+    if (index < 0) return;
+    SmartCrate crate = model->getCrate(index);
+    if (!editSmartCrate(this, crate)) return;
+    model->setCrate(index, crate);
+    updateCrateSelector();
+    updateStatusLabel();
+    scheduleSave();
+}
+
+void LibraryManager::onDeleteCrateClicked()
+{
+    const int index = model->getActiveCrate();
+    if (index < 0) return;
+    const auto answer = QMessageBox::question(this, "Delete Crate",
+        QString("Delete the smart crate \"%1\"? The tracks stay in the library.").arg(model->getCrate(index).name));
+    if (answer != QMessageBox::Yes) return;
+    model->removeCrate(index);
+    updateCrateSelector();
+    updateStatusLabel();
+    scheduleSave();
 }
@@ -1,10 +1,16 @@
 #pragma once
 
+#include "DirectoryScanner.h"
+#include "KeyDetector.h"
+#include "MemoryBudget.h"
+#include "SmartCrate.h"
+#include "TrackStore.h"
 #include <QObject>
 #include <QString>
 #include <QStringList>
 #include <QAbstractTableModel>
 #include <QTableView>
+#include <QStyledItemDelegate>
 #include <QHeaderView>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -17,6 +23,7 @@
 #include <QTimer>
 #include <QProgressBar>
 #include <QThread>
+#include <QThreadPool>
 #include <QMutex>
 #include <QMimeData>
 #include <QApplication>
@@ -24,14 +31,30 @@
 #include <QSplitter>
 #include <QTreeView>
 #include <QFileSystemModel>
+#include <QFileSystemWatcher>
+#include <QCollator>
+#include <QCache>
+#include <QPixmap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include "DraggableListWidget.h"
+#include "FuzzyMatcher.h"
+#include <array>
+#include <atomic>
+#include <functional>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
 // Forward declarations
 namespace juce {
     class AudioFormatManager;
     class File;
 }
+class DirectoryListingCache;
 
 // Structure to hold track metadata
 struct TrackInfo {
@@ -45,6 +68,10 @@ struct TrackInfo {
     double bpm = 0.0;
     QString key;
     qint64 fileSize = 0;
+    qint64 modifiedMs = 0; // file modification time when the tags were read
+    qint64 addedMs = 0;    // when the track entered the library; set by the model if 0
+    quint64 uid = 0;       // persistent, kept when the file moves; set by the model if 0
+    quint64 identity = 0;  // ContentHash::identityFor() the audio; 0 until computed
     QString comment;
     
     TrackInfo() = default;
@@ -76,13 +103,16 @@ struct TrackInfo {
         return bpm > 0.0 ? QString::number(static_cast<int>(bpm)) : "--";
     }
     
+    // Key in Camelot notation ("8A"), converted from the tag where possible
+    QString getCamelotString() const;
+
     // Get file size string
     QString getFileSizeString() const {
         if (fileSize <= 0) return "--";
         double size = fileSize;
-        QStringList units = {"B", "KB", "MB", "GB"};
+        static const char* const units[] = {"B", "KB", "MB", "GB"};
         int unitIndex = 0;
-        while (size >= 1024.0 && unitIndex < units.size() - 1) {
+        while (size >= 1024.0 && unitIndex < 3) {
             size /= 1024.0;
             unitIndex++;
         }
@@ -90,27 +120,53 @@ struct TrackInfo {
     }
 };
 
-// Background thread for loading ID3 tags
-class ID3LoaderThread : public QThread {
+// Background tag scan: up to MaxWorkers pool threads read container headers with TagReader;
+// only files it can't parse (or can't time) are opened with an AudioFormatReader. Embedded
+// cover art is thumbnailed into the ArtworkCache on the same threads.
+class TagScannerThread : public QThread {
     Q_OBJECT
     
 public:
-    explicit ID3LoaderThread(const QStringList& files, juce::AudioFormatManager* formatManager, QObject* parent = nullptr);
+    // Tracks are handed to the model in chunks so a large import isn't one model update per file
+    static constexpr int BatchSize = 256;
+    // Header reads are I/O bound; more threads than this only queue up on the disk
+    static constexpr int MaxWorkers = 8;
+
+    // moved: tracks that left the library by their identity. A scanned file with the same
+    // audio takes over such a track's id, date added and analysis, and its cache records.
+    explicit TagScannerThread(const QStringList& files, juce::AudioFormatManager* formatManager,
+                              QHash<quint64, TrackInfo> moved = {}, QObject* parent = nullptr);
+    
+    // Size and modification time the DirectoryScanner already read; those files aren't stat'ed again
+    struct FileStat {
+        qint64 size = 0;
+        qint64 modifiedMs = 0;
+    };
+    void setKnownStats(QHash<QString, FileStat> stats) { knownStats = std::move(stats); }
     
 protected:
     void run() override;
     
 signals:
-    void trackLoaded(const TrackInfo& track);
+    // Emitted from the worker threads, in no particular file order
+    void tracksLoaded(const QVector<TrackInfo>& batch);
     void progressUpdated(int current, int total);
     void finished();
     
 private:
     QStringList filesToProcess;
     juce::AudioFormatManager* audioFormatManager;
-    bool shouldStop = false;
-    
-    TrackInfo loadTrackInfo(const QString& filePath);
+    std::atomic<bool> shouldStop{false};
+    std::atomic<int> nextFile{0};
+    std::atomic<int> filesDone{0};
+    const QHash<quint64, TrackInfo> moved;
+    QHash<QString, FileStat> knownStats;
+    std::atomic<int> relinked{0};
+    
+    void scanFiles();
+    TrackInfo loadTrackInfo(const QString& filePath) const;
+    // From the moved track it is, if any: BpmCache, WaveformCache and StemCache records follow it
+    void relink(TrackInfo& track);
     
 public slots:
     void stop() { shouldStop = true; }
@@ -127,12 +183,17 @@ public:
         AlbumColumn,
         DurationColumn,
         BpmColumn,
+        KeyColumn,
         GenreColumn,
         YearColumn,
         FileSizeColumn,
+        WaveformColumn,   // mini overview (LibraryWaveformDelegate); shown with Library/ShowWaveforms
         ColumnCount
     };
     
+    // Cover art next to the title
+    static constexpr int RowIconSize = 18;
+
     enum SortMode {
         SortByTitle = 0,
         SortByArtist,
@@ -141,7 +202,9 @@ public:
         SortByBpm,
         SortByGenre,
         SortByYear,
-        SortByFileSize
+        SortByFileSize,
+        SortByKey,
+        SortModeCount
     };
     
     explicit LibraryTableModel(QObject* parent = nullptr);
@@ -153,32 +216,221 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     Qt::ItemFlags flags(const QModelIndex& index) const override;
     
-    // Drag and drop support
+    // Drag and drop support: a TrackDragMimeData of the rows' track ids
     QStringList mimeTypes() const override;
     QMimeData* mimeData(const QModelIndexList& indexes) const override;
     
     // Custom methods
     void addTrack(const TrackInfo& track);
+    // Merges a chunk into the sorted, filtered view with row inserts instead of a model reset.
+    // Files already in the library are skipped.
+    void addTracks(const QVector<TrackInfo>& batch);
+    // Deletes their rows; unknown paths are ignored
+    void removeTracks(const QStringList& filePaths);
     void clearTracks();
-    const TrackInfo* getTrack(int row) const;
+    // Made from the store on each call; nullopt for a row or path not in the library
+    std::optional<TrackInfo> getTrack(int row) const;
+    std::optional<TrackInfo> getTrackByPath(const QString& filePath) const;
+    // Just the path, without making the rest of the track
+    QString getFilePath(int row) const;
+    bool contains(const QString& filePath) const { return trackIdByPath.contains(filePath); }
+    QVector<TrackInfo> getAllTracks() const;
+    QStringList getAllFilePaths() const;
+    // Library files directly inside directory (no subdirectories)
+    QStringList getFilesInDirectory(const QString& directory) const;
+    // Tracks removed this session that have an identity, by it: where a moved file's new path
+    // finds the entry it had (TagScannerThread)
+    QHash<quint64, TrackInfo> getRemovedTracks() const;
+    void setTrackIdentity(const QString& filePath, quint64 identity);
+    // Fills in analysed BPM / key (Camelot) where the tags had none
+    void setTrackAnalysis(const QString& filePath, double bpm, const QString& camelotKey);
+    // Files holding the same recording (LibraryAnalyzer::duplicatesFound); both ways, by path,
+    // so they outlive a reload. A track with a better version is dimmed and its tooltip says so.
+    void addDuplicates(const QString& filePath, const QStringList& duplicates);
+    // filePath and its duplicates in the library, best quality first: lossless, then by bitrate
+    QStringList getVersions(const QString& filePath) const;
+    // What getVersions ranks by; lossless files above any lossy one
+    static int qualityScore(const TrackInfo& track);
     void setSortMode(SortMode mode, Qt::SortOrder order = Qt::AscendingOrder);
+    // Tracks whose text contains the filter come first; with fuzzy search on, tracks whose
+    // title / artist match it with up to FuzzyMatcher::MaxErrors typos follow, fewest edits first
     void setFilterText(const QString& filter);
+    void setFuzzySearch(bool enabled);
+    // Lower-case ASCII with accents dropped and every other character a single space
+    static std::string foldForSearch(const QString& text);
+    
+    // Smart crates. Membership is evaluated once per crate, then kept up to date per track as
+    // tracks are added, analysed or removed. The active crate (-1 = none) narrows the view
+    // together with the filter text.
+    void setCrates(const QVector<SmartCrate>& crates);
+    QVector<SmartCrate> getCrates() const;
+    int getCrateCount() const { return (int) crates.size(); }
+    const SmartCrate& getCrate(int index) const { return crates[index].crate; }
+    int getCrateSize(int index) const { return crates[index].size; }
+    // The crate's tracks in library order
+    QStringList getCrateFilePaths(int index) const;
+    // index == getCrateCount() appends
+    void setCrate(int index, const SmartCrate& crate);
+    void removeCrate(int index);
+    void setActiveCrate(int index);
+    int getActiveCrate() const { return activeCrate; }
+    // The folder browser: only tracks directly inside directory, together with the crate and
+    // the filter text; an empty string shows the whole library again
+    void setFolderFilter(const QString& directory);
+    bool hasFolderFilter() const { return folderFiltered; }
+    
+    // Mixing candidates: analysed tracks within tolerancePercent of bpm whose key is
+    // compatible with key (KeyDetector::getCompatible; key -1 = any key), nearest tempo first.
+    // Answered from per-key BPM indexes, O(log n + k).
+    QVector<TrackInfo> findCompatibleTracks(double bpm, int key, double tolerancePercent, int limit,
+                                            const QString& excludePath);
+    
+    // The library as a TrackStore snapshot, for reading off the GUI thread: a background job
+    // takes one and queries it for as long as it likes, without locks, while the model goes on
+    // changing. Any thread; off the GUI thread it is the state as of the last published change
+    // (one pass of the GUI event loop behind at most). Ids are the model's until clearTracks.
+    TrackStore::Snapshot getSnapshot() const;
     
     // Get filtered tracks count
-    int getFilteredCount() const { return filteredTracks.size(); }
-    int getTotalCount() const { return allTracks.size(); }
+    int getFilteredCount() const { return (int) filteredRows.size(); }
+    int getTotalCount() const { return (int) trackIdByPath.size(); }
+    
+signals:
+    // A sort is running in the background; the view shows its old order meanwhile
+    void busyChanged(bool busy);
     
 private:
-    std::vector<TrackInfo> allTracks;
-    std::vector<const TrackInfo*> filteredTracks;
+    // Index into the TrackStore. Tracks are only appended (or all cleared), so ids stay valid
+    // while the store grows. A removed track stays behind as a tombstone.
+    using TrackId = int;
+    
+    // Computed once per track at ingest, so sorting and crates don't parse per comparison
+    struct TrackKeys {
+        int camelot;
+        int key;       // KeyDetector index, -1 if unknown
+        int genreId;   // into genreNames
+    };
+    
+    TrackStore tracks;                  // by TrackId; QStrings only made for what is read
+    // What getSnapshot() hands other threads; std::atomic_load / atomic_store only
+    TrackStore::Snapshot published = tracks.snapshot();
+    bool publishPending = false;
+    void publishSnapshot();
+    std::vector<TrackKeys> trackKeys;   // by TrackId
+    // Formatted cells of the rows recently shown; data() is asked for each several times a paint
+    mutable QCache<TrackId, std::array<QString, ColumnCount>> rowCells;
+    QHash<QString, TrackId> trackIdByPath;   // live tracks only
+    QHash<quint64, TrackId> trackIdByUid;    // live tracks only
+    QHash<QString, std::vector<TrackId>> trackIdsByDirectory;
+    std::vector<TrackId> filteredRows;   // sorted, filtered view
+    // All ids in ascending order per sort mode, built on first use; empty = stale
+    std::array<std::vector<TrackId>, SortModeCount> sortedIds;
+    // Past AsyncSortTracks tracks an order that isn't cached is sorted on a pool thread from a
+    // snapshot (startSort). The view keeps its rows until the result is in; then the pending
+    // sort mode, filter or crate is applied in one layoutChanged or reset (applyPendingView).
+    static constexpr int AsyncSortTracks = 20000;
+    static constexpr int MinSortPartTracks = 16384;   // sortIds parts; smaller ones aren't worth a thread
+    // Tracks added during an async sort then merged into its result; more and it sorts again
+    static constexpr int MaxMergedTracks = 8192;
+    std::array<int, SortModeCount> sortStamps{};   // bumped when an order goes stale other than by adds
+    bool sortRunning = false;
+    bool viewPending = false;    // the view waits for pendingSortMode's order
+    bool pendingReset = false;   // and the filter changed too
+    SortMode pendingSortMode = SortByTitle;
+    Qt::SortOrder pendingSortOrder = Qt::AscendingOrder;
+    // True if mode's order is ready (cached, or sorted here since the library is small); else
+    // a sort is started or already running
+    bool ensureSortedIds(SortMode mode);
+    void startSort(SortMode mode);
+    void onSortDone(SortMode mode, int stamp, std::vector<TrackId> ids);
+    void applyPendingView();
+    // Lower-case title / artist / album / genre / comment of every track back to back, UTF-8
+    std::string searchText;
+    std::vector<quint32> searchOffsets{0};   // by TrackId, and one past the last track
+    std::string_view searchTextOf(TrackId id) const;
+    std::string filterUtf8;                 // filterText as searchText holds it
+    // Byte trigram -> ascending ids whose searchText contains it
+    QHash<quint64, std::vector<TrackId>> searchIndex;
+    std::vector<bool> filterMask;   // by TrackId; tracks matching filterText
+    // Folded title / artist of every track back to back: the column the fuzzy matcher scans
+    std::string fuzzyText;
+    std::vector<quint32> fuzzyOffsets{0};   // by TrackId, and one past the last track
+    std::vector<quint8> filterScore;        // by TrackId: 0 contains filterText, 1 + edits for a fuzzy match
+    std::unique_ptr<FuzzyMatcher> fuzzyMatcher;   // for filterText while fuzzy search is on
+    bool fuzzySearch = true;
+    QThreadPool fuzzyPool;                  // chunks of the fuzzy scan
+    static constexpr int FuzzyChunkTracks = 8192;
+    MemoryBudget::Allocation memory{MemoryBudget::Pool::Library};   // estimated, per ingested track
+    QCollator collator;
     SortMode currentSortMode = SortByTitle;
     Qt::SortOrder currentSortOrder = Qt::AscendingOrder;
     QString filterText;
-    
+    // Row-sized cover art; pixmaps are GUI-thread only, so scaled from the ArtworkCache here
+    mutable QCache<TrackId, QPixmap> rowIcons;
+    
+    // Genres interned at ingest, so a crate's genre rule is decided once per distinct genre
+    QHash<QString, int> genreIds;
+    QStringList genreNames;   // lower case, by id
+    
+    struct CrateState {
+        SmartCrate crate;
+        SmartCrate::Predicate predicate;
+        std::vector<qint8> genreMatches;   // by genre id; -1 = not decided yet
+        std::vector<bool> members;         // by TrackId
+        int size = 0;
+    };
+    std::vector<CrateState> crates;
+    int activeCrate = -1;
+    std::string folderFilter;   // UTF-8, without a trailing '/'
+    bool folderFiltered = false;
+    bool isInFolder(TrackId id) const;
+    
+    QHash<QString, QSet<QString>> duplicatesByPath;
+    // Repaints the rows of these paths that are in view
+    void refreshRows(const QStringList& filePaths);
+    
+    // Tracks with a BPM by key (KeyDetector index; the last bucket is unknown keys), ascending
+    // BPM. Rebuilt on the first query after a bulk change, kept up to date per analysed track.
+    std::array<std::vector<TrackId>, KeyDetector::NumKeys + 1> bpmIndex;
+    bool bpmIndexStale = true;
+    std::vector<TrackId>& getBpmBucket(TrackId id) { return bpmIndex[trackKeys[id].key >= 0 ? trackKeys[id].key : KeyDetector::NumKeys]; }
+    void rebuildBpmIndex();
+    
+    TrackKeys makeKeys(const TrackInfo& track);
+    int internGenre(const QString& genre);
+    bool crateMatches(CrateState& state, TrackId id);
+    void evaluateCrate(CrateState& state);
+    // Re-evaluates one track against every crate; true if its active-crate membership changed
+    bool updateCrateMembership(TrackId id);
+    static std::array<QString, ColumnCount> makeCellText(const TrackInfo& track);
+    // What the collator orders a text column by; the display title and artist, as shown
+    static QString sortText(const TrackColumns& columns, SortMode mode, TrackId id);
+    static bool isTextMode(SortMode mode);
+    // The numeric columns and the year, as isLessThan orders them
+    static bool isColumnLess(const TrackColumns& columns, SortMode mode, TrackId a, TrackId b);
+    // Case-insensitive, numbers by value
+    static QCollator makeCollator(const QLocale& locale);
+    // Ids ascending by mode, on all cores; safe on a snapshot from any thread. camelot: the
+    // Camelot order by id, for SortByKey only
+    static std::vector<TrackId> sortIds(const TrackColumns& columns, SortMode mode,
+                                        const std::vector<int>& camelot, const QLocale& locale);
+    std::vector<int> getCamelotColumn(SortMode mode) const;
+    // Rough RAM an ingested track holds across the store, its keys, search text and postings
+    int64_t estimateTrackBytes(TrackId id) const;
+    void indexTrack(TrackId id);
+    void updateFilterMask(bool refine);
+    // Marks unmatched tracks the fuzzy matcher accepts, the library split into chunks over fuzzyPool
+    void addFuzzyMatches();
+    int fuzzyScore(TrackId id) const;
+    const std::vector<TrackId>& getSortedIds(SortMode mode);
+    void rebuildFilteredRows();
     void updateFilteredTracks();
-    void sortFilteredTracks();
-    bool matchesFilter(const TrackInfo& track) const;
-    bool isLessThan(const TrackInfo* a, const TrackInfo* b) const;
+    int findRow(TrackId id) const;
+    bool matchesFilter(TrackId id) const;
+    bool isLessThan(SortMode mode, TrackId a, TrackId b) const;
+    bool isBefore(TrackId a, TrackId b) const;   // isLessThan in the current order
+    void onThumbnailReady(const QString& filePath);
+    void onWaveformThumbnailReady(const QString& filePath);
 };
 
 // Custom table view with drag support
@@ -187,15 +439,46 @@ class LibraryTableView : public QTableView {
     
 public:
     explicit LibraryTableView(QWidget* parent = nullptr);
+
+    // Playhead over the previewing track's mini waveform; an empty path hides it
+    void setPreviewPosition(const QString& filePath, double fraction);
+    const QString& getPreviewFile() const { return previewFile; }
+    double getPreviewPosition() const { return previewPosition; }
+
+signals:
+    // Pressed or dragged across a row's mini waveform: preview the track from that point
+    void previewRequested(const QString& filePath, double fraction);
+    // Escape
+    void previewStopRequested();
     
 protected:
     void startDrag(Qt::DropActions supportedActions) override;
     void mousePressEvent(QMouseEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
     
 private:
+    // Where x falls along the thumbnail, 0..1
+    double waveformFraction(int x) const;
+    void updatePreviewRow();
+
     QPoint dragStartPosition;
     bool dragInProgress = false;
+    QString scrubFile;   // while a press on a waveform is held
+    QString previewFile;
+    double previewPosition = 0.0;
+};
+
+// Waveform column: blits the row's thumbnail from the WaveformThumbnails atlas, or a flat line
+// while it is being looked up or generated, and the preview playhead over the previewing track
+class LibraryWaveformDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
 };
 
 // Main library manager widget
@@ -209,60 +492,182 @@ public:
     // Add files to library
     void addFiles(const QStringList& files);
     void addDirectory(const QString& directory, bool recursive = true);
+    // A Rekordbox XML or Traktor NML export, streamed on a pool thread (CollectionImporter):
+    // its tracks arrive in batches, its grids and cues go to the BpmCache, its playlists
+    // become crates (replacing crates of the same name) once the whole file is read
+    void importCollection(const QString& filePath);
     
     // Get current selection
     QStringList getSelectedFiles() const;
     QString getCurrentFile() const;
+    // Every track in the library, regardless of the filter
+    QStringList getAllFiles() const { return model->getAllFilePaths(); }
+    // nullopt if the file isn't in the library
+    std::optional<TrackInfo> findTrack(const QString& filePath) const { return model->getTrackByPath(filePath); }
+    // For background jobs (LibraryTableModel::getSnapshot)
+    TrackStore::Snapshot getLibrarySnapshot() const { return model->getSnapshot(); }
+    void setTrackAnalysis(const QString& filePath, double bpm, const QString& camelotKey) {
+        model->setTrackAnalysis(filePath, bpm, camelotKey);
+        scheduleSave();
+    }
+    void addDuplicates(const QString& filePath, const QStringList& duplicates) {
+        model->addDuplicates(filePath, duplicates);
+    }
+    // Re-reads Library/ShowWaveforms (the Waveform column, off by default)
+    void applyViewSettings();
+    // Preview playhead on the track list; an empty path hides it
+    void setPreviewPosition(const QString& filePath, double fraction) { tableView->setPreviewPosition(filePath, fraction); }
+    
+    // Compatible Tracks panel: candidates to mix into referencePath playing at bpm (the tempo
+    // after the pitch fader). Within Library/CompatibleBpmRange percent (default 6) and a
+    // Camelot-compatible key; an empty path or bpm 0 clears the list.
+    void showCompatibleTracks(const QString& referencePath, double bpm);
+    // The same candidates as files, best first (AutoDJ picks its next track from them)
+    QStringList getCompatibleFiles(const QString& referencePath, double bpm, int limit) const;
+    // Gig preparation state on the crate buttons; total 0: not running
+    void setGigPrepProgress(int done, int total);
     
     // Library management
     void clearLibrary();
-    void saveLibrary(const QString& filePath);
-    void loadLibrary(const QString& filePath);
+    // LibraryDatabase store; after a load, changes are saved back to the same file on their own
+    bool saveLibrary(const QString& filePath);
+    // With rescanChanged, directories modified since their last scan are scanned again: tracks
+    // gone or changed there are dropped and new or changed files loaded. False if there was no
+    // usable store.
+    bool loadLibrary(const QString& filePath, bool rescanChanged = true);
+    // loadLibrary without blocking the UI: the store is read and its directories checked on a
+    // pool thread, the tracks go into the model back on this thread, then `done` gets what
+    // loadLibrary would have returned. Nothing is saved to filePath before the load lands.
+    void loadLibraryAsync(const QString& filePath, bool rescanChanged, std::function<void(bool)> done);
+    // Brings the given directories' tracks in line with the disk: drops vanished files, reloads
+    // changed ones and loads new files (and new subdirectories of recursively added directories).
+    // Also what the directory watcher calls.
+    void rescanDirectories(const QSet<QString>& directories);
     
 signals:
     void fileSelected(const QString& filePath);
     void filesDropped(const QStringList& files);
+    // A batch of files finished loading into the library
+    void libraryUpdated();
+    // The highlighted track followed by the next Library/PrefetchRows (default 2) rows, once the
+    // selection has settled; worth preparing for a deck load
+    void tracksHighlighted(const QStringList& files);
+    // "Prepare for Gig" on the active crate (GigPrep); pressed again while running: cancelled
+    void gigPrepRequested(const QString& crateName, const QStringList& files);
+    void gigPrepCancelRequested();
+    // From the track list's mini waveforms (LibraryTableView)
+    void previewRequested(const QString& filePath, double fraction);
+    void previewStopRequested();
     
 private slots:
-    void onTrackLoaded(const TrackInfo& track);
+    void onTracksLoaded(const QVector<TrackInfo>& batch);
     void onLoadingProgress(int current, int total);
     void onLoadingFinished();
     void onSortModeChanged();
     void onFilterTextChanged();
+    void onCrateChanged();
+    void onNewCrateClicked();
+    void onEditCrateClicked();
+    void onDeleteCrateClicked();
+    void onPrepareCrateClicked();
     void onAddFilesClicked();
     void onAddFolderClicked();
+    void onImportClicked();
     void onRefreshClicked();
     void onClearLibraryClicked();
     void onTableDoubleClicked(const QModelIndex& index);
+    // Versions of the track under the cursor, to load the best one
+    void onTableContextMenu(const QPoint& pos);
+    void onDirectoryChanged(const QString& path);
     void onSelectionChanged();
     void onFileSystemSelectionChanged();
+    void onDirectoryListed(const QString& directory, const QStringList& files, qint64 modifiedMs);
     
 private:
     // UI components
     QSplitter* mainSplitter;
     QTreeView* fileSystemTree;
     QFileSystemModel* fileSystemModel;
+    // Folder browser: listed off the GUI thread, the library narrowed to the folder meanwhile
+    DirectoryListingCache* folderListings;
+    QString browsedDirectory;
+    void addBrowsedFiles(const QStringList& files);
+    void leaveFolderView();
     LibraryTableView* tableView;
     LibraryTableModel* model;
     QComboBox* sortComboBox;
     QLineEdit* filterLineEdit;
+    QComboBox* crateComboBox;
+    QPushButton* editCrateButton;
+    QPushButton* deleteCrateButton;
+    QPushButton* prepareCrateButton;
+    bool gigPrepRunning = false;
     QPushButton* addFilesButton;
     QPushButton* addFolderButton;
+    QPushButton* importButton;
     QPushButton* refreshButton;
     QPushButton* clearLibraryButton;
     QLabel* statusLabel;
     QProgressBar* progressBar;
+    QProgressBar* busyIndicator;   // the model sorting in the background
+    QTimer* busyTimer;
+    DraggableListWidget* compatibleList;
+    QString compatibleReference;
+    double compatibleBpm = 0.0;
+    void refreshCompatibleTracks();
+    // Library/CompatibleBpmRange and the reference's key applied to the model's index
+    QVector<TrackInfo> findCompatible(const QString& referencePath, double bpm, int limit) const;
     
     // Background loading
-    ID3LoaderThread* loaderThread;
+    TagScannerThread* loaderThread;
     juce::AudioFormatManager* audioFormatManager;
     
     // State
     bool isLoading = false;
+    bool importing = false;   // a collection import is running
     QTimer* filterUpdateTimer;
+    QTimer* highlightTimer;   // arrowing through the list doesn't prefetch every row passed
+    
+    // Persistence: scanned directory -> its modification time at scan
+    QHash<QString, qint64> scannedDirectories;
+    // Found by the DirectoryScanner, handed to the next tag scan that reads them
+    QHash<QString, TagScannerThread::FileStat> scannedFileStats;
+    // Directory walks of addDirectory() running on the pool
+    int directoryScans = 0;
+    int directoryScanFiles = 0;
+    std::shared_ptr<std::atomic<bool>> scanStop = std::make_shared<std::atomic<bool>>(false);
+    QString databasePath;
+    QTimer* saveTimer;
+    bool saveScheduled = false;
+    void scheduleSave();
+    // What loadLibrary reads off the disk, apart from the model
+    struct StoredLibrary;
+    static bool readStore(const QString& filePath, bool rescanChanged, StoredLibrary& stored);
+    void applyStore(const QString& filePath, StoredLibrary& stored);
+    // Identities for tracks that have none, read from a library snapshot on a pool thread at the
+    // lowest priority, so a library from before they existed can have its files moved too
+    void fillTrackIdentities();
+    bool fillingIdentities = false;
+    std::shared_ptr<std::atomic<bool>> identityStop = std::make_shared<std::atomic<bool>>(false);
+    
+    // Live updates: every scanned directory is watched; change bursts are coalesced
+    QFileSystemWatcher* directoryWatcher;
+    QTimer* rescanTimer;
+    QSet<QString> changedDirectories;
+    QStringList pendingFiles;   // added while a scan was running
+    QHash<QString, qint64> reloadedAddedMs;   // changed files being read again: their date added
+    void watchScannedDirectories();
     
     void setupUI();
     void setupFileSystemModel();
     void updateStatusLabel();
+    // Rebuilds the crate list from the model; updateStatusLabel refreshes the counts
+    void updateCrateSelector();
+    // Also records each directory visited in scannedDirectories. Blocks; addDirectory() walks
+    // on the pool and streams what it finds into the tag scan.
     QStringList getSupportedAudioFiles(const QString& directory, bool recursive = true);
+    // One DirectoryScanner batch: its directories recorded, its files' stats kept for the tag scan
+    QStringList takeScanBatch(DirectoryScanner::Batch& batch);
+    // Tag scan of files known to exist and be audio; those already in the library are skipped
+    void scanFiles(QStringList audioFiles);
 };
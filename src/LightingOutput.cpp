@@ -0,0 +1,313 @@
+#include "LightingOutput.h"
+#include "DeckMixer.h"
+#include "DJAudioPlayer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr int ArtNetHeader = 18;
+    constexpr int SacnHeader = 126;
+    constexpr char SourceName[] = "PulseDJ-X";
+    // Flashes fall to e^-FlashDecay of full by the end of their beat (bar, phrase flash: bar)
+    constexpr double FlashDecay = 5.0;
+    // The frame on a beat goes out just after it, so the beat has begun in what it shows
+    constexpr juce::uint64 BeatFrameDelayNs = 200000;
+    // A beat this close after the last frame waits for the next; this close to the regular
+    // frame it takes its place
+    constexpr juce::uint64 MinFrameGapNs = 2000000;
+    // Blocks stop arriving when the device stops; the rig goes dark after this
+    constexpr juce::int64 StaleNs = 250000000;
+
+    inline juce::uint8 toDmx(double value) { return (juce::uint8) juce::jlimit(0, 255, (int) std::lround(value * 255.0)); }
+    inline double flash(double beats) { return beats >= 0.0 && beats < 1.0 ? std::exp(-FlashDecay * beats) : 0.0; }
+    inline double positiveMod(double x, double m) { const double r = std::fmod(x, m); return r < 0.0 ? r + m : r; }
+
+    inline void putBig16(juce::uint8* p, int value)
+    {
+        p[0] = (juce::uint8) ((value >> 8) & 0xff);
+        p[1] = (juce::uint8) (value & 0xff);
+    }
+    // ACN flags (0x7) and the length of the layer from p on
+    inline void putFlagsLength(juce::uint8* p, int length) { putBig16(p, 0x7000 | (length & 0x0fff)); }
+}
+
+LightingOutput::LightingOutput()
+    : juce::Thread("Lighting Output")
+{
+    packet.allocate((size_t) (SacnHeader + Slots), true);
+}
+
+LightingOutput::~LightingOutput()
+{
+    stop();
+}
+
+LightingOutput::Protocol LightingOutput::protocolFromString(const juce::String& name)
+{
+    if (name.equalsIgnoreCase("artnet") || name.equalsIgnoreCase("art-net")) return Protocol::ArtNet;
+    if (name.equalsIgnoreCase("sacn") || name.equalsIgnoreCase("e1.31")) return Protocol::Sacn;
+    return Protocol::Off;
+}
+
+bool LightingOutput::start(const Settings& newSettings)
+{
+    stop();
+    if (newSettings.protocol == Protocol::Off) return true;
+
+    settings = newSettings;
+    settings.startChannel = juce::jlimit(1, Slots - NumChannels + 1, settings.startChannel);
+    if (settings.protocol == Protocol::ArtNet) {
+        settings.universe = juce::jlimit(0, 0x7fff, settings.universe);
+        destination = settings.address.isNotEmpty() ? settings.address : juce::String("255.255.255.255");
+        port = ArtNetPort;
+    } else {
+        settings.universe = juce::jlimit(1, 63999, settings.universe);
+        destination = "239.255." + juce::String((settings.universe >> 8) & 0xff) + "." + juce::String(settings.universe & 0xff);
+        port = SacnPort;
+    }
+
+    socket = std::make_unique<juce::DatagramSocket>(true);
+    if (socket->getRawSocketHandle() < 0) {
+        std::cout << "LightingOutput: could not open a UDP socket" << std::endl;
+        socket.reset();
+        return false;
+    }
+    auto& random = juce::Random::getSystemRandom();
+    for (auto& byte : cid) byte = (juce::uint8) random.nextInt(256);
+    sequence = 0;
+    historyCount = historyNext = 0;
+    energy = {};
+    dmx = {};
+    Block stale;
+    while (blocks.pop(stale)) {}
+    framesSent.store(0);
+
+    startThread(juce::Thread::Priority::high);
+    std::cout << "LightingOutput: " << (settings.protocol == Protocol::ArtNet ? "Art-Net" : "sACN") << " universe "
+              << settings.universe << " to " << destination << ":" << port << ", channels " << settings.startChannel
+              << "-" << settings.startChannel + NumChannels - 1 << ", " << settings.leadMs << " ms lead" << std::endl;
+    return true;
+}
+
+void LightingOutput::stop()
+{
+    stopThread(1000);
+    if (socket == nullptr) return;
+    dmx = {};
+    send();
+    socket.reset();
+}
+
+void LightingOutput::prepare(double sampleRate)
+{
+    if (sampleRate <= 0.0) return;
+    const double twoPi = 2.0 * juce::MathConstants<double>::pi;
+    lowCoefficient = 1.0 - std::exp(-twoPi * LowBandHz / sampleRate);
+    highCoefficient = 1.0 - std::exp(-twoPi * HighBandHz / sampleRate);
+    lowState = highState = 0.0f;
+}
+
+void LightingOutput::pushBlock(const float* const* channels, int numChannels, int numSamples, juce::uint64 blockStartNs,
+                               const NetworkTempoSync::Timeline& timeline, const DJAudioPlayer* player,
+                               double trackSec, double trackRatio) noexcept
+{
+    if (numSamples <= 0 || numChannels <= 0 || channels[0] == nullptr) return;
+    const float* left = channels[0];
+    const float* right = numChannels > 1 && channels[1] != nullptr ? channels[1] : left;
+    const float lowK = (float) lowCoefficient;
+    const float highK = (float) highCoefficient;
+    float low = lowState, high = highState;
+    float sumFull = 0.0f, sumLow = 0.0f, sumMid = 0.0f, sumHigh = 0.0f;
+    for (int i = 0; i < numSamples; ++i) {
+        const float x = 0.5f * (left[i] + right[i]);
+        low += lowK * (x - low);
+        high += highK * (x - high);
+        const float mid = high - low;
+        const float top = x - high;
+        sumFull += x * x;
+        sumLow += low * low;
+        sumMid += mid * mid;
+        sumHigh += top * top;
+    }
+    lowState = low;
+    highState = high;
+
+    Block block;
+    block.timeNs = blockStartNs;
+    block.timeline = timeline;
+    block.player = player;
+    block.trackSec = trackSec;
+    block.trackRatio = trackRatio;
+    const float scale = 1.0f / (float) numSamples;
+    block.full = std::sqrt(sumFull * scale);
+    block.low = std::sqrt(sumLow * scale);
+    block.mid = std::sqrt(sumMid * scale);
+    block.high = std::sqrt(sumHigh * scale);
+    blocks.push(block);   // dropped when the frame thread is this far behind
+}
+
+bool LightingOutput::blockAt(juce::uint64 t, Block& block)
+{
+    if (historyCount == 0) return false;
+    // Blocks arrive in order: the last one heard by t, else (t before all of them) the oldest
+    const int oldest = (historyNext - historyCount + HistorySize) % HistorySize;
+    block = history[(size_t) oldest];
+    for (int n = 1; n < historyCount; ++n) {
+        const Block& candidate = history[(size_t) ((oldest + n) % HistorySize)];
+        if (candidate.timeNs > t) break;
+        block = candidate;
+    }
+    return true;
+}
+
+void LightingOutput::render(juce::uint64 t, double elapsedSeconds)
+{
+    Block block;
+    const bool live = blockAt(t, block) && (juce::int64) t - (juce::int64) block.timeNs < StaleNs;
+
+    const std::array<float, 4> measured = live ? std::array<float, 4>{ block.full, block.low, block.mid, block.high }
+                                               : std::array<float, 4>{};
+    const float release = (float) std::exp(-elapsedSeconds / ReleaseSeconds);
+    constexpr std::array<Channel, 4> bandChannels{ Dimmer, LowEnergy, MidEnergy, HighEnergy };
+    std::array<juce::uint8, NumChannels> values{};
+    for (size_t band = 0; band < energy.size(); ++band) {
+        energy[band] = std::max(measured[band], energy[band] * release);
+        const float db = juce::Decibels::gainToDecibels(energy[band], FloorDb - 1.0f);
+        values[(size_t) bandChannels[band]] = toDmx((db - FloorDb) / (CeilingDb - FloorDb));
+    }
+
+    if (live && block.timeline.valid && block.timeline.bpm > 0.0) {
+        const NetworkTempoSync::Timeline& timeline = block.timeline;
+        double beat = timeline.beatAt(t);
+        double barBeat = beat;                                   // beats since a downbeat
+        double phraseBeat = positiveMod(beat, TrackStructure::PhraseBars * TrackStructure::BeatsPerBar);
+        int section = -1;
+
+        const BeatGrid::Ptr grid = block.player != nullptr ? block.player->getBeatGrid() : nullptr;
+        if (grid && grid->isValid() && grid->getStructure().isValid()) {
+            const TrackStructure& structure = grid->getStructure();
+            const double trackSec = block.trackSec + ((double) t - (double) block.timeNs) / 1.0e9 * block.trackRatio;
+            beat = grid->getBeatPositionAtTime(trackSec);
+            barBeat = beat - std::round(grid->getBeatPositionAtTime(structure.downbeatSec));
+            const int phrase = structure.phraseAt(trackSec);
+            if (phrase >= 0) {
+                phraseBeat = beat - std::round(grid->getBeatPositionAtTime(structure.phrases[(size_t) phrase].startSec));
+                section = (int) structure.phrases[(size_t) phrase].section;
+            }
+        }
+
+        if (beat >= 0.0) {
+            const double phase = beat - std::floor(beat);
+            const double inBar = positiveMod(barBeat, TrackStructure::BeatsPerBar);
+            values[BeatFlash] = toDmx(flash(phase));
+            values[BarFlash] = toDmx(flash(inBar));
+            values[PhraseFlash] = toDmx(flash(phraseBeat / TrackStructure::BeatsPerBar));
+            values[BeatPhase] = toDmx(phase);
+            values[BarPhase] = toDmx(inBar / TrackStructure::BeatsPerBar);
+            values[Section] = (juce::uint8) (section >= 0 ? 40 * (1 + section) : 0);
+            values[Tempo] = (juce::uint8) juce::jlimit(0, 255, (int) std::lround(timeline.bpm - 50.0));
+        }
+    }
+
+    std::copy(values.begin(), values.end(), dmx.begin() + (settings.startChannel - 1));
+}
+
+int LightingOutput::buildArtNet()
+{
+    juce::uint8* p = packet.get();
+    std::memcpy(p, "Art-Net", 8);                  // with its terminating zero
+    p[8] = 0x00;                                   // OpDmx (0x5000), little endian
+    p[9] = 0x50;
+    p[10] = 0;                                     // protocol version 14
+    p[11] = 14;
+    sequence = (juce::uint8) (sequence == 255 ? 1 : sequence + 1);   // 0 would switch ordering off
+    p[12] = sequence;
+    p[13] = 0;                                     // physical port
+    p[14] = (juce::uint8) (settings.universe & 0xff);
+    p[15] = (juce::uint8) ((settings.universe >> 8) & 0x7f);
+    putBig16(p + 16, Slots);
+    std::memcpy(p + ArtNetHeader, dmx.data(), (size_t) Slots);
+    return ArtNetHeader + Slots;
+}
+
+int LightingOutput::buildSacn()
+{
+    const int size = SacnHeader + Slots;
+    juce::uint8* p = packet.get();
+    std::memset(p, 0, (size_t) SacnHeader);
+    // Root layer
+    putBig16(p, 0x0010);                           // preamble size
+    std::memcpy(p + 4, "ASC-E1.17", 9);            // zero padded to 12
+    putFlagsLength(p + 16, size - 16);
+    p[21] = 0x04;                                  // VECTOR_ROOT_E131_DATA
+    std::copy(cid.begin(), cid.end(), p + 22);
+    // Framing layer
+    putFlagsLength(p + 38, size - 38);
+    p[43] = 0x02;                                  // VECTOR_E131_DATA_PACKET
+    std::memcpy(p + 44, SourceName, sizeof(SourceName));
+    p[108] = 100;                                  // priority
+    p[111] = ++sequence;
+    putBig16(p + 113, settings.universe);
+    // DMP layer
+    putFlagsLength(p + 115, size - 115);
+    p[117] = 0x02;                                 // VECTOR_DMP_SET_PROPERTY
+    p[118] = 0xa1;                                 // address and data type
+    putBig16(p + 121, 1);                          // address increment
+    putBig16(p + 123, Slots + 1);                  // start code and the slots
+    std::memcpy(p + SacnHeader, dmx.data(), (size_t) Slots);
+    return size;
+}
+
+void LightingOutput::send()
+{
+    const int size = settings.protocol == Protocol::ArtNet ? buildArtNet() : buildSacn();
+    if (socket->write(destination, port, packet.get(), size) == size)
+        framesSent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LightingOutput::run()
+{
+    const juce::uint64 frameNs = (juce::uint64) (1.0e9 / FrameRateHz);
+    juce::uint64 due = DeckMixer::nowNs();
+    juce::uint64 lastFrame = due;
+
+    while (!threadShouldExit()) {
+        Block block;
+        while (blocks.pop(block)) {
+            history[(size_t) historyNext] = block;
+            historyNext = (historyNext + 1) % HistorySize;
+            historyCount = std::min(historyCount + 1, HistorySize);
+        }
+
+        const juce::uint64 now = DeckMixer::nowNs();
+        if (now < due) {
+            const juce::uint64 remainingMs = (due - now) / 1000000;
+            if (remainingMs > 0) wait((int) std::min<juce::uint64>(remainingMs, 5));
+            else juce::Thread::yield();
+            continue;
+        }
+
+        // What is heard `lead` after this frame leaves
+        const juce::int64 leadNs = (juce::int64) (settings.leadMs * 1.0e6);
+        const juce::uint64 t = (juce::uint64) std::max<juce::int64>(0, (juce::int64) now + leadNs);
+        render(t, (double) (now - lastFrame) / 1.0e9);
+        send();
+        lastFrame = now;
+
+        // Next regular frame, or the next beat's if that comes first
+        due = now + frameNs;
+        if (historyCount > 0) {
+            const Block& latest = history[(size_t) ((historyNext + HistorySize - 1) % HistorySize)];
+            const NetworkTempoSync::Timeline& timeline = latest.timeline;
+            if (timeline.valid && timeline.bpm > 0.0) {
+                const double next = std::floor(timeline.beatAt(t)) + 1.0;
+                const double beatNs = (double) timeline.timeNs + (next - timeline.beat) * 60.0e9 / timeline.bpm;
+                const juce::int64 beatFrame = (juce::int64) beatNs - leadNs + (juce::int64) BeatFrameDelayNs;
+                if (beatFrame > (juce::int64) (now + MinFrameGapNs) && (juce::uint64) beatFrame < due + MinFrameGapNs)
+                    due = (juce::uint64) beatFrame;
+            }
+        }
+    }
+}
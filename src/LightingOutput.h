@@ -0,0 +1,135 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include "LockFreeQueue.h"
+#include "NetworkTempoSync.h"
+
+class DJAudioPlayer;
+
+/**
+ * DMX for the lighting rig, sent as Art-Net or sACN (E1.31) over UDP: one universe with a small
+ * fixed personality (Channel, from the start channel on) that a lighting desk patches like a
+ * fixture. Flashes on every beat, bar and phrase of the sync master, the phase through the beat
+ * and bar, the analysed section, the tempo, and the master bus's energy in three bands.
+ *
+ * The audio thread does no more than measure: after the master is finished, pushBlock() splits
+ * it into bands with two one-pole filters, takes each band's RMS and queues it with the sync
+ * master's timeline for the block and the host time the block is heard. Everything else runs
+ * on this thread. A frame sent at time S shows what is heard at S plus the lead
+ * (Lighting/LeadMs: the node's and fixtures' own latency), the beat interpolated from the
+ * timeline to that moment. Besides FrameRateHz, a frame goes out exactly when a beat is due, so
+ * the flash lands on the audible beat rather than on the next 25 ms tick.
+ *
+ * Bars and phrases come from the master deck's beat grid and TrackStructure when the analysis
+ * found them (the thread reads the grid itself); without (a LAN session as master, a track not
+ * analysed yet) beats count in bars of four and phrases of TrackStructure::PhraseBars bars.
+ * Nothing runs on the GUI thread but start() and stop().
+ */
+class LightingOutput : private juce::Thread {
+public:
+    enum class Protocol { Off, ArtNet, Sacn };
+
+    // DMX slots from the start channel on, 0..255 each
+    enum Channel {
+        Dimmer,      // full-band master energy
+        BeatFlash,   // 255 on the beat, decaying through it
+        BarFlash,    // the same on each downbeat
+        PhraseFlash, // the same on each phrase start, over a bar
+        LowEnergy,
+        MidEnergy,
+        HighEnergy,
+        BeatPhase,   // 0..255 through the beat
+        BarPhase,    // 0..255 through the bar
+        Section,     // 0 unknown, then 40 * (1 + TrackStructure::Section)
+        Tempo,       // bpm - 50
+        NumChannels
+    };
+
+    static constexpr int ArtNetPort = 6454;
+    static constexpr int SacnPort = 5568;
+    static constexpr int Slots = 512;
+    static constexpr double FrameRateHz = 40.0;
+    static constexpr double LowBandHz = 150.0;
+    static constexpr double HighBandHz = 2500.0;
+    // Energy mapped from the floor (0) to the ceiling (255), RMS in dBFS
+    static constexpr float FloorDb = -42.0f;
+    static constexpr float CeilingDb = -6.0f;
+    static constexpr double ReleaseSeconds = 0.15;
+
+    struct Settings {
+        Protocol protocol{Protocol::Off};
+        juce::String address;        // Art-Net node; empty broadcasts (sACN always multicasts)
+        int universe{1};             // Art-Net counts from 0, sACN from 1
+        int startChannel{1};         // 1..512
+        double leadMs{0.0};
+    };
+
+    LightingOutput();
+    ~LightingOutput() override;
+
+    // Lighting/Protocol preference ("off", "artnet", "sacn")
+    static Protocol protocolFromString(const juce::String& name);
+
+    // UI thread: opens the socket and starts the frame thread; false if the socket can't be opened
+    bool start(const Settings& settings);
+    // Sends a blackout frame and stops
+    void stop();
+    bool isRunning() const { return socket != nullptr; }
+    juce::int64 getFramesSent() const { return framesSent.load(std::memory_order_relaxed); }
+
+    // Device thread, before the first block
+    void prepare(double sampleRate);
+    // Audio thread, the finished master: its band energies with the sync master's timeline
+    // (`player` the master deck, nullptr for a LAN session; `trackSec` its track time at
+    // blockStartNs, advancing `trackRatio` track seconds per second)
+    void pushBlock(const float* const* channels, int numChannels, int numSamples, juce::uint64 blockStartNs,
+                   const NetworkTempoSync::Timeline& timeline, const DJAudioPlayer* player,
+                   double trackSec, double trackRatio) noexcept;
+
+private:
+    struct Block {
+        juce::uint64 timeNs{0};     // when the block is heard
+        NetworkTempoSync::Timeline timeline;
+        const DJAudioPlayer* player{nullptr};
+        double trackSec{0.0};
+        double trackRatio{1.0};
+        float full{0.0f}, low{0.0f}, mid{0.0f}, high{0.0f};   // RMS
+    };
+    static constexpr int QueueSize = 1024;
+    static constexpr int HistorySize = 256;
+
+    void run() override;
+    // The block heard at `t` from what has arrived; false before the first one
+    bool blockAt(juce::uint64 t, Block& block);
+    void render(juce::uint64 t, double elapsedSeconds);
+    void send();
+    int buildArtNet();
+    int buildSacn();
+
+    Settings settings;
+    std::unique_ptr<juce::DatagramSocket> socket;
+    juce::String destination;
+    int port{ArtNetPort};
+    std::array<juce::uint8, 16> cid{};        // sACN component id, one per run
+    juce::uint8 sequence{0};
+
+    // Audio thread
+    double lowCoefficient{0.0};
+    double highCoefficient{0.0};
+    float lowState{0.0f};
+    float highState{0.0f};
+
+    SpscQueue<Block, QueueSize> blocks;       // audio thread -> frame thread
+    std::atomic<juce::int64> framesSent{0};
+
+    // Frame thread
+    std::array<Block, HistorySize> history{};
+    int historyCount{0};
+    int historyNext{0};
+    std::array<float, 4> energy{};            // full, low, mid, high, released
+    std::array<juce::uint8, Slots> dmx{};
+    juce::HeapBlock<juce::uint8> packet;
+};
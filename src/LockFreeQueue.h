@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Bounded single-producer/single-consumer ring buffer.
+ *
+ * push() must only be called from one thread (e.g. the Qt UI thread) and pop() from one other
+ * thread (e.g. the audio callback). Neither side locks or allocates, so pop() is safe to call
+ * from a real-time context. Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Returns false if the queue is full (the item is dropped)
+    bool push(const T& item) noexcept {
+        const size_t w = writeIndex.load(std::memory_order_relaxed);
+        const size_t r = readIndex.load(std::memory_order_acquire);
+        if (w - r >= Capacity) return false;
+        slots[w & (Capacity - 1)] = item;
+        writeIndex.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty
+    bool pop(T& out) noexcept {
+        const size_t r = readIndex.load(std::memory_order_relaxed);
+        const size_t w = writeIndex.load(std::memory_order_acquire);
+        if (r == w) return false;
+        out = slots[r & (Capacity - 1)];
+        readIndex.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const noexcept {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+    size_t size() const noexcept {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() noexcept { return Capacity; }
+
+private:
+    std::array<T, Capacity> slots{};
+    // Separate cache lines so producer and consumer don't false-share
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    alignas(64) std::atomic<size_t> readIndex{0};
+};
+
+/**
+ * Single-writer snapshot cell (seqlock) for small trivially copyable values.
+ *
+ * store() is wait-free and meant for one writer thread (e.g. the audio callback); load() can
+ * be called from any thread and retries while a store is in progress, so a reader always gets
+ * one complete value. The payload lives in relaxed atomic words, so there is no data race.
+ */
+template <typename T>
+class SeqlockValue {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockValue needs a trivially copyable type");
+
+public:
+    void store(const T& value) noexcept {
+        Words words{};
+        std::memcpy(words.data(), static_cast<const void*>(&value), sizeof(T));
+        const unsigned seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < NumWords; ++i)
+            payload[i].store(words[i], std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const noexcept {
+        Words words{};
+        for (;;) {
+            const unsigned before = sequence.load(std::memory_order_acquire);
+            if ((before & 1u) != 0) continue;
+            for (size_t i = 0; i < NumWords; ++i)
+                words[i] = payload[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) break;
+        }
+        // Through void*: a payload with default member initializers is trivially copyable but not
+        // trivial, which -Wclass-memaccess would flag on a typed pointer
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t NumWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    using Words = std::array<uint64_t, NumWords>;
+
+    std::atomic<unsigned> sequence{0};
+    std::array<std::atomic<uint64_t>, NumWords> payload{};
+};
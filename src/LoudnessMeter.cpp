@@ -0,0 +1,177 @@
+#include "LoudnessMeter.h"
+#include "SimdDispatch.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr double SegmentSeconds = 0.1;       // gating blocks are 400 ms, overlapping by 75 %
+    constexpr int SegmentsPerBlock = 4;
+    constexpr double AbsoluteGateLufs = -70.0;
+    constexpr double RelativeGateLu = -10.0;
+
+    double toLufs(double meanSquare) { return -0.691 + 10.0 * std::log10(std::max(meanSquare, 1.0e-20)); }
+
+    // Both K-weighting stages over a channel pair; sums of the squared output per lane.
+    // The recursion runs sample by sample, so the vectors go across the two channels.
+    SIMD_DISPATCH
+    void kWeightedSquares(const float* a, const float* b, int numSamples, const LoudnessMeter::Biquad& shelf,
+                          const LoudnessMeter::Biquad& highPass, LoudnessMeter::FilterState& state,
+                          double* sums) noexcept
+    {
+        constexpr int L = LoudnessMeter::Lanes;
+        double s1[2][L], s2[2][L], acc[L] = {};
+        for (int st = 0; st < 2; ++st)
+            for (int l = 0; l < L; ++l) {
+                s1[st][l] = state.s1[st][l];
+                s2[st][l] = state.s2[st][l];
+            }
+        for (int i = 0; i < numSamples; ++i) {
+            const double x[L] = { a[i], b[i] };
+            for (int l = 0; l < L; ++l) {
+                const double y = shelf.b0 * x[l] + s1[0][l];
+                s1[0][l] = shelf.b1 * x[l] - shelf.a1 * y + s2[0][l];
+                s2[0][l] = shelf.b2 * x[l] - shelf.a2 * y;
+                const double z = highPass.b0 * y + s1[1][l];
+                s1[1][l] = highPass.b1 * y - highPass.a1 * z + s2[1][l];
+                s2[1][l] = highPass.b2 * y - highPass.a2 * z;
+                acc[l] += z * z;
+            }
+        }
+        for (int st = 0; st < 2; ++st)
+            for (int l = 0; l < L; ++l) {
+                state.s1[st][l] = s1[st][l];
+                state.s2[st][l] = s2[st][l];
+            }
+        for (int l = 0; l < L; ++l) sums[l] = acc[l];
+    }
+}
+
+void LoudnessMeter::prepare(const juce::AudioFormatReader& reader)
+{
+    const double rate = reader.sampleRate > 0.0 ? reader.sampleRate : 44100.0;
+    numChannels = (int) reader.numChannels;
+
+    // BS.1770 stage 1, the head's high shelf, and stage 2, the RLB high-pass, for any rate
+    // (the published 48 kHz coefficients come out of these analogue prototypes)
+    {
+        const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / rate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / rate);
+        const double a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    states.assign((size_t) std::max(1, (numChannels + 1) / 2), FilterState{});
+    segmentLength = std::max(1, juce::roundToInt(SegmentSeconds * rate));
+    segmentFill = 0;
+    segmentSum = 0.0;
+    segments.clear();
+    segments.reserve((size_t) (reader.lengthInSamples / segmentLength + 1));
+    peakMeter.prepare(rate, TrackDecodePipeline::BlockSamples);
+    truePeak = 0.0f;
+    result = {};
+}
+
+void LoudnessMeter::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position)
+{
+    juce::ignoreUnused(position);
+    const int channels = std::min(numChannels, block.getNumChannels());
+    if (channels <= 0 || segmentLength <= 0) return;
+
+    for (int done = 0; done < numSamples; ) {
+        const int n = std::min(numSamples - done, segmentLength - segmentFill);
+        for (int ch = 0; ch < channels; ch += Lanes) {
+            // An odd channel out runs in both lanes and counts once
+            const bool pair = ch + 1 < channels;
+            const float* a = block.getReadPointer(ch, done);
+            const float* b = block.getReadPointer(pair ? ch + 1 : ch, done);
+            double sums[Lanes];
+            kWeightedSquares(a, b, n, shelf, highPass, states[(size_t) (ch / Lanes)], sums);
+            segmentSum += sums[0] + (pair ? sums[1] : 0.0);
+        }
+        segmentFill += n;
+        done += n;
+        if (segmentFill == segmentLength) addSegment();
+    }
+
+    peakMeter.process(block.getArrayOfReadPointers(), channels, numSamples);
+    const auto snapshot = peakMeter.getSnapshot();
+    truePeak = std::max({ truePeak, snapshot.truePeak[0], snapshot.truePeak[1] });
+}
+
+void LoudnessMeter::addSegment()
+{
+    segments.push_back(segmentSum / segmentLength);
+    segmentSum = 0.0;
+    segmentFill = 0;
+}
+
+void LoudnessMeter::finish(bool completed)
+{
+    result = {};
+    if (!completed || segmentLength <= 0) return;
+    if (segmentFill > 0) {
+        // The tail counts as a step of its own length
+        segments.push_back(segmentSum / segmentFill);
+        segmentSum = 0.0;
+        segmentFill = 0;
+    }
+
+    // 400 ms gating blocks; a track shorter than one block is one block
+    std::vector<double> blocks;
+    if ((int) segments.size() < SegmentsPerBlock) {
+        if (!segments.empty()) {
+            double sum = 0.0;
+            for (double s : segments) sum += s;
+            blocks.push_back(sum / (double) segments.size());
+        }
+    } else {
+        blocks.reserve(segments.size());
+        double window = 0.0;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            window += segments[i];
+            if (i >= (size_t) SegmentsPerBlock) window -= segments[i - SegmentsPerBlock];
+            if (i + 1 >= (size_t) SegmentsPerBlock) blocks.push_back(std::max(0.0, window) / SegmentsPerBlock);
+        }
+    }
+
+    auto gatedMean = [&blocks](double gateLufs, double& mean) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (double z : blocks)
+            if (toLufs(z) > gateLufs) { sum += z; ++count; }
+        if (count == 0) return false;
+        mean = sum / (double) count;
+        return true;
+    };
+    double mean = 0.0;
+    // Silence throughout: everything is gated away, which reads as the absolute gate
+    result.integratedLufs = AbsoluteGateLufs;
+    if (gatedMean(AbsoluteGateLufs, mean) && gatedMean(toLufs(mean) + RelativeGateLu, mean))
+        result.integratedLufs = toLufs(mean);
+    result.truePeakDb = juce::Decibels::gainToDecibels(truePeak, -100.0f);
+    result.valid = true;
+}
+
+double LoudnessMeter::trimGainFor(const BpmCache::Loudness& loudness, double targetLufs)
+{
+    if (!loudness.valid) return 1.0;
+    double db = targetLufs - loudness.integratedLufs;
+    if (db > 0.0) db = std::min(db, std::max(0.0, TruePeakCeilingDb - loudness.truePeakDb));
+    return juce::Decibels::decibelsToGain(juce::jlimit(-MaxTrimDb, MaxTrimDb, db));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "BpmCache.h"
+#include "MasterLevelMonitor.h"
+#include "TrackDecodePipeline.h"
+
+/**
+ * Integrated loudness (EBU R128 / ITU-R BS.1770-4) and true peak of a whole track, measured as
+ * one more sink of the load or library decode pass, so it costs no extra decode.
+ *
+ * Every channel goes through the K-weighting pre-filter (the BS.1770 high shelf and RLB
+ * high-pass, recomputed for the file's rate); the mean square of each 100 ms step is kept, and
+ * at the end the 400 ms blocks they overlap into are gated at -70 LUFS and 10 LU below their
+ * own average. The true peak comes from MasterLevelMonitor's 4x polyphase interpolator, the
+ * same one the master meter runs.
+ *
+ * The result is what BpmCache stores for the track; trimGainFor() turns it into the deck trim
+ * that Decks/AutoGainAdjust applies.
+ */
+class LoudnessMeter : public TrackDecodePipeline::Sink {
+public:
+    static constexpr double DefaultTargetLufs = -10.0;   // Decks/AutoGainTargetLufs
+    static constexpr double MaxTrimDb = 12.0;
+    static constexpr double TruePeakCeilingDb = -1.0;    // a boost stops here
+
+    void prepare(const juce::AudioFormatReader& reader) override;
+    void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+    void finish(bool completed) override;
+
+    // After a completed pass (valid = false otherwise)
+    const BpmCache::Loudness& getResult() const { return result; }
+
+    // Linear deck trim that brings `loudness` to targetLufs: within +-MaxTrimDb, and a boost never
+    // pushes the true peak past TruePeakCeilingDb. Unity for an unmeasured track.
+    static double trimGainFor(const BpmCache::Loudness& loudness, double targetLufs);
+
+    // K-weighting as two biquads (direct form II transposed); a channel pair runs through them
+    // side by side, one vector lane each
+    struct Biquad {
+        double b0{1.0}, b1{0.0}, b2{0.0}, a1{0.0}, a2{0.0};
+    };
+    static constexpr int Lanes = 2;
+    struct FilterState {
+        double s1[2][Lanes]{};   // [stage][lane]
+        double s2[2][Lanes]{};
+    };
+
+private:
+    void addSegment();
+
+    Biquad shelf, highPass;
+    std::vector<FilterState> states;   // one per channel pair
+    int numChannels{0};
+    int segmentLength{0};              // samples in 100 ms
+    int segmentFill{0};
+    double segmentSum{0.0};            // sum of squares over the channels, this segment
+    std::vector<double> segments;      // mean square of each 100 ms step
+    MasterLevelMonitor peakMeter;
+    float truePeak{0.0f};
+    BpmCache::Loudness result;
+};
@@ -0,0 +1,90 @@
+#include "MappedTrackReader.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    constexpr juce::int64 PageBytes = 4096;
+}
+
+std::unique_ptr<MappedTrackReader> MappedTrackReader::open(const juce::File& file, juce::AudioFormatManager& formats) {
+    juce::AudioFormat* format = formats.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr) return nullptr;
+
+    // Only the uncompressed formats implement this; everything else returns null
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+    if (!mapped || mapped->lengthInSamples <= 0) return nullptr;
+    if (!mapped->mapEntireFile() || mapped->getMappedSection().getLength() < mapped->lengthInSamples) {
+        std::cout << "MappedTrackReader: cannot map " << file.getFullPathName() << ", streaming instead" << std::endl;
+        return nullptr;
+    }
+    return std::unique_ptr<MappedTrackReader>(new MappedTrackReader(std::move(mapped)));
+}
+
+MappedTrackReader::MappedTrackReader(std::unique_ptr<juce::MemoryMappedAudioFormatReader> source)
+    : juce::AudioFormatReader(nullptr, source->getFormatName()), mapped(std::move(source)) {
+    sampleRate = mapped->sampleRate;
+    bitsPerSample = mapped->bitsPerSample;
+    lengthInSamples = mapped->lengthInSamples;
+    numChannels = mapped->numChannels;
+    usesFloatingPointData = mapped->usesFloatingPointData;
+    metadataValues = mapped->metadataValues;
+
+    const juce::int64 bytesPerFrame = std::max<juce::int64>(1, (juce::int64) numChannels * bitsPerSample / 8);
+    samplesPerPage = std::max<juce::int64>(1, PageBytes / bytesPerFrame);
+    for (auto& region : touchRegions) region.store(-1, std::memory_order_relaxed);
+    touchedRegions.fill(-1);
+}
+
+MappedTrackReader::~MappedTrackReader() {
+    // Waits for a slice in progress
+    if (touchThread != nullptr) touchThread->removeTimeSliceClient(this);
+}
+
+void MappedTrackReader::startTouchAhead(juce::TimeSliceThread& thread) {
+    if (touchThread != nullptr) return;
+    touchThread = &thread;
+    thread.addTimeSliceClient(this);
+}
+
+void MappedTrackReader::setTouchRegion(int slot, juce::int64 startSample) {
+    if (slot < 0 || slot >= MaxTouchRegions) return;
+    touchRegions[(size_t) slot].store(startSample, std::memory_order_relaxed);
+    if (touchThread != nullptr) touchThread->moveToFrontOfQueue(this);
+}
+
+bool MappedTrackReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                    juce::int64 startSampleInFile, int numSamples) {
+    readPosition.store(startSampleInFile + numSamples, std::memory_order_relaxed);
+    return mapped->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+}
+
+void MappedTrackReader::touchRange(juce::int64 start, juce::int64 end) const {
+    start = std::max<juce::int64>(0, start);
+    end = std::min(end, lengthInSamples);
+    for (juce::int64 sample = start; sample < end; sample += samplesPerPage) mapped->touchSample(sample);
+}
+
+int MappedTrackReader::useTimeSlice() {
+    bool touched = false;
+
+    // Ahead of playback; a jump outside the run touched so far starts a new run there
+    const juce::int64 position = readPosition.load(std::memory_order_relaxed);
+    if (position < touchedStart || position > touchedEnd) touchedStart = touchedEnd = position;
+    const juce::int64 target = std::min(position + (juce::int64) (TouchAheadSeconds * sampleRate), lengthInSamples);
+    if (target > touchedEnd) {
+        touchRange(touchedEnd, target);
+        touchedEnd = target;
+        touched = true;
+    }
+
+    const juce::int64 regionSamples = (juce::int64) (TouchRegionSeconds * sampleRate);
+    for (size_t slot = 0; slot < touchRegions.size(); ++slot) {
+        const juce::int64 start = touchRegions[slot].load(std::memory_order_relaxed);
+        if (start == touchedRegions[slot]) continue;
+        if (start >= 0) touchRange(start, start + regionSamples);
+        touchedRegions[slot] = start;
+        touched = true;
+    }
+    return touched ? 10 : 50;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+
+/**
+ * Playback reader for uncompressed files (WAV, AIFF) that memory-maps the whole file.
+ *
+ * Samples are converted straight from the mapping into the caller's buffer: no decoder, no
+ * read-ahead ring buffer and no heap copy of the track, and a seek is only a new offset. The
+ * mapping is backed by the OS page cache, so it does not count towards
+ * Performance/MemoryLimitMB.
+ *
+ * What can still stall is a page fault on the first read of a region. Once startTouchAhead() is
+ * called, the decks' read-ahead thread touches one sample per page for the next
+ * TouchAheadSeconds after the last read and for each touch region (cue, loop start, hot cues),
+ * so the audio thread finds them resident.
+ */
+class MappedTrackReader : public juce::AudioFormatReader,
+                          private juce::TimeSliceClient {
+public:
+    static constexpr double TouchAheadSeconds = 4.0;
+    static constexpr double TouchRegionSeconds = 1.0;
+    static constexpr int MaxTouchRegions = 10;
+
+    // Null if the file's format can't be memory-mapped (anything but PCM WAV/AIFF) or the map fails
+    static std::unique_ptr<MappedTrackReader> open(const juce::File& file, juce::AudioFormatManager& formats);
+    ~MappedTrackReader() override;
+
+    // UI thread; the thread must outlive the reader
+    void startTouchAhead(juce::TimeSliceThread& thread);
+    // UI thread: keep TouchRegionSeconds from startSample resident; negative clears the slot
+    void setTouchRegion(int slot, juce::int64 startSample);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    explicit MappedTrackReader(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped);
+
+    int useTimeSlice() override;
+    void touchRange(juce::int64 start, juce::int64 end) const;
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped;
+    juce::int64 samplesPerPage{1};
+    juce::TimeSliceThread* touchThread{nullptr};
+
+    std::atomic<juce::int64> readPosition{0};          // end of the last read, any thread
+    std::array<std::atomic<juce::int64>, MaxTouchRegions> touchRegions;
+    // Touch thread only
+    juce::int64 touchedStart{0}, touchedEnd{0};
+    std::array<juce::int64, MaxTouchRegions> touchedRegions;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedTrackReader)
+};
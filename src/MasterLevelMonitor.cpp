@@ -1,73 +1,186 @@
 #include "MasterLevelMonitor.h"
+#include "SimdDispatch.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
-void MasterLevelMonitor::audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
-                                                        int numInputChannels,
-                                                        float* const* outputChannelData,
-                                                        int numOutputChannels,
-                                                        int numberOfSamples,
-                                                        const juce::AudioIODeviceCallbackContext& context)
-{
-    juce::ignoreUnused(context, inputChannelData, numInputChannels);
-    
-    // Calculate RMS levels for left and right channels
-    float leftSum = 0.0f;
-    float rightSum = 0.0f;
-    
-    if (outputChannelData && numOutputChannels >= 2 && numberOfSamples > 0)
+namespace {
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+            if (term < 1.0e-12 * sum) break;
+        }
+        return sum;
+    }
+
+    float absMax(const float* data, int numSamples)
     {
-        for (int i = 0; i < numberOfSamples; ++i)
-        {
-            if (outputChannelData[0])
-                leftSum += outputChannelData[0][i] * outputChannelData[0][i];
-            if (outputChannelData[1])
-                rightSum += outputChannelData[1][i] * outputChannelData[1][i];
+        const auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+        return std::max(-range.getStart(), range.getEnd());
+    }
+
+    SIMD_DISPATCH
+    float sumOfSquares(const float* data, int numSamples) noexcept
+    {
+        // Eight partial sums so the compiler can keep them in vector registers
+        float lanes[8] = {};
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+            for (int k = 0; k < 8; ++k)
+                lanes[k] += data[i + k] * data[i + k];
+        for (; i < numSamples; ++i)
+            lanes[0] += data[i] * data[i];
+        return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    }
+}
+
+MasterLevelMonitor::MasterLevelMonitor()
+{
+    // 48-tap Kaiser-windowed sinc interpolator split into 4 phases, each normalised to unity DC
+    constexpr int numTaps = Oversampling * TapsPerPhase;
+    const double centre = (numTaps - 1) * 0.5;
+    const double beta = 6.0;
+    const double i0Beta = besselI0(beta);
+
+    for (int p = 0; p < Oversampling; ++p) {
+        double sum = 0.0;
+        for (int k = 0; k < TapsPerPhase; ++k) {
+            const double t = (Oversampling * k + p - centre) / Oversampling;
+            const double sinc = std::abs(t) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * t)
+                                                                / (juce::MathConstants<double>::pi * t);
+            const double w = (Oversampling * k + p - centre) / (centre + 1.0);
+            const double window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - w * w))) / i0Beta;
+            phases[(size_t) p][(size_t) k] = (float) (sinc * window);
+            sum += sinc * window;
         }
-        
-        float leftRms = std::sqrt(leftSum / numberOfSamples);
-        float rightRms = std::sqrt(rightSum / numberOfSamples);
-        
-        // Convert to dB (-60dB to 0dB range)
-        float dbMin = -60.0f;
-        float dbMax = 0.0f;
-        
-        float leftDb = leftRms > 0.000001f ? 20.0f * std::log10(leftRms) : dbMin;
-        float rightDb = rightRms > 0.000001f ? 20.0f * std::log10(rightRms) : dbMin;
-        
-        leftDb = std::max(leftDb, dbMin);
-        rightDb = std::max(rightDb, dbMin);
-        
-        // Convert to percentage (0-100%)
-        float leftPercent = juce::jlimit(0.0f, 100.0f, ((leftDb - dbMin) / (dbMax - dbMin)) * 100.0f);
-        float rightPercent = juce::jlimit(0.0f, 100.0f, ((rightDb - dbMin) / (dbMax - dbMin)) * 100.0f);
-        
-        // Apply exponential smoothing
-        float currentLeft = leftChannelLevel.load();
-        float currentRight = rightChannelLevel.load();
-        
-        float newLeft = currentLeft * (1.0f - smoothingFactor) + leftPercent * smoothingFactor;
-        float newRight = currentRight * (1.0f - smoothingFactor) + rightPercent * smoothingFactor;
-        
-        leftChannelLevel.store(newLeft);
-        rightChannelLevel.store(newRight);
+        for (auto& c : phases[(size_t) p])
+            c = (float) (c / sum);
     }
 }
 
-void MasterLevelMonitor::audioDeviceAboutToStart(juce::AudioIODevice* device)
+void MasterLevelMonitor::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    maxBlock = std::max(64, maximumBlockSize);
+    for (auto& h : history)
+        h.assign((size_t) (maxBlock + TapsPerPhase - 1), 0.0f);
+    phaseScratch.assign((size_t) maxBlock, 0.0f);
+    reset();
+}
+
+void MasterLevelMonitor::reset()
 {
-    // Initialize to zero levels
-    leftChannelLevel.store(0.0f);
-    rightChannelLevel.store(0.0f);
+    for (auto& h : history)
+        std::fill(h.begin(), h.end(), 0.0f);
+    heldPeak.fill(0.0f);
+    heldTruePeak.fill(0.0f);
+    meanSquare.fill(0.0f);
+    blockCount = 0;
+
+    const juce::uint32 seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int ch = 0; ch < MaxChannels; ++ch) {
+        outPeak[(size_t) ch].store(0.0f, std::memory_order_relaxed);
+        outRms[(size_t) ch].store(0.0f, std::memory_order_relaxed);
+        outTruePeak[(size_t) ch].store(0.0f, std::memory_order_relaxed);
+    }
+    outBlocks.store(0, std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
 }
 
-void MasterLevelMonitor::audioDeviceStopped()
+void MasterLevelMonitor::processChunk(int ch, const float* data, int numSamples, float& blockPeak,
+                                      float& blockTruePeak, float& blockSquares)
 {
-    // Reset levels to zero when device stops
-    leftChannelLevel.store(0.0f);
-    rightChannelLevel.store(0.0f);
+    auto& h = history[(size_t) ch];
+    float* current = h.data() + (TapsPerPhase - 1);
+    juce::FloatVectorOperations::copy(current, data, numSamples);
+
+    blockPeak = std::max(blockPeak, absMax(current, numSamples));
+
+    blockSquares += sumOfSquares(current, numSamples);
+
+    // True peak: each phase is a short FIR run as block-wide multiply-adds
+    float* scratch = phaseScratch.data();
+    for (const auto& coeffs : phases) {
+        juce::FloatVectorOperations::clear(scratch, numSamples);
+        for (int k = 0; k < TapsPerPhase; ++k)
+            juce::FloatVectorOperations::addWithMultiply(scratch, current - k, coeffs[(size_t) k], numSamples);
+        blockTruePeak = std::max(blockTruePeak, absMax(scratch, numSamples));
+    }
+
+    // Keep the last samples as filter history for the next chunk
+    std::memmove(h.data(), current + numSamples - (TapsPerPhase - 1), sizeof(float) * (TapsPerPhase - 1));
+}
+
+void MasterLevelMonitor::process(const float* const* channels, int numChannels, int numSamples)
+{
+    if (maxBlock == 0 || channels == nullptr || numSamples <= 0) return;
+    const int measured = std::min(numChannels, MaxChannels);
+    if (measured <= 0) return;
+
+    std::array<float, MaxChannels> blockPeak{}, blockTruePeak{}, blockSquares{};
+    for (int ch = 0; ch < measured; ++ch) {
+        if (channels[ch] == nullptr) continue;
+        for (int done = 0; done < numSamples; ) {
+            const int n = std::min(maxBlock, numSamples - done);
+            processChunk(ch, channels[ch] + done, n, blockPeak[(size_t) ch], blockTruePeak[(size_t) ch],
+                         blockSquares[(size_t) ch]);
+            done += n;
+        }
+    }
+    if (measured == 1) {
+        blockPeak[1] = blockPeak[0];
+        blockTruePeak[1] = blockTruePeak[0];
+        blockSquares[1] = blockSquares[0];
+    }
+
+    // Ballistics per block: peaks fall at a fixed dB rate, RMS is an exponential average
+    const float blockSeconds = (float) (numSamples / sampleRate);
+    const float peakDecay = std::pow(10.0f, -PeakReleaseDbPerSecond * blockSeconds / 20.0f);
+    const float rmsAlpha = 1.0f - std::exp(-blockSeconds / RmsWindowSeconds);
+    for (size_t ch = 0; ch < (size_t) MaxChannels; ++ch) {
+        heldPeak[ch] = std::max(blockPeak[ch], heldPeak[ch] * peakDecay);
+        heldTruePeak[ch] = std::max({ blockTruePeak[ch], blockPeak[ch], heldTruePeak[ch] * peakDecay });
+        meanSquare[ch] += rmsAlpha * (blockSquares[ch] / numSamples - meanSquare[ch]);
+    }
+    ++blockCount;
+
+    const juce::uint32 seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t ch = 0; ch < (size_t) MaxChannels; ++ch) {
+        outPeak[ch].store(heldPeak[ch], std::memory_order_relaxed);
+        outRms[ch].store(std::sqrt(meanSquare[ch]), std::memory_order_relaxed);
+        outTruePeak[ch].store(heldTruePeak[ch], std::memory_order_relaxed);
+    }
+    outBlocks.store(blockCount, std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+MasterLevelMonitor::Snapshot MasterLevelMonitor::getSnapshot() const
+{
+    Snapshot snap;
+    for (;;) {
+        const juce::uint32 before = sequence.load(std::memory_order_acquire);
+        if ((before & 1u) != 0) continue;   // writer is mid-publish (a handful of stores)
+        for (size_t ch = 0; ch < (size_t) MaxChannels; ++ch) {
+            snap.peak[ch] = outPeak[ch].load(std::memory_order_relaxed);
+            snap.rms[ch] = outRms[ch].load(std::memory_order_relaxed);
+            snap.truePeak[ch] = outTruePeak[ch].load(std::memory_order_relaxed);
+        }
+        snap.blocks = outBlocks.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) return snap;
+    }
 }
 
-std::pair<float, float> MasterLevelMonitor::getLevels() const
+float MasterLevelMonitor::toMeterScale(float linear)
 {
-    return std::make_pair(leftChannelLevel.load(), rightChannelLevel.load());
+    // -60 dB .. 0 dB mapped to 0 .. 1, same range as the old Master Out bars
+    if (linear <= 0.001f) return 0.0f;
+    return juce::jlimit(0.0f, 1.0f, (20.0f * std::log10(linear) + 60.0f) / 60.0f);
 }
@@ -2,41 +2,76 @@
 #define MASTERLEVELMONITOR_H
 
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
+#include <vector>
 
 /**
- * Audio callback that monitors the final master output levels
- * for display in the Master Out level bars
+ * Master-bus metering stage, run by DeckMixer on the finished mix in its final pass.
+ *
+ * Per channel it measures sample peak, RMS (300 ms exponential window) and true peak
+ * (4x polyphase oversampling, BS.1770 style). All loops are vector operations over the whole
+ * block. Results are published as one snapshot behind a sequence counter, so the UI always
+ * reads values that belong to the same block.
  */
-class MasterLevelMonitor : public juce::AudioIODeviceCallback
+class MasterLevelMonitor
 {
 public:
-    MasterLevelMonitor() = default;
-    ~MasterLevelMonitor() override = default;
+    static constexpr int MaxChannels = 2;
 
-    // AudioIODeviceCallback implementation
-    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
-                                          int numInputChannels,
-                                          float* const* outputChannelData,
-                                          int numOutputChannels,
-                                          int numberOfSamples,
-                                          const juce::AudioIODeviceCallbackContext& context) override;
+    // Linear values (1.0 = 0 dBFS). Peaks fall back at PeakReleaseDbPerSecond.
+    struct Snapshot {
+        std::array<float, MaxChannels> peak{};
+        std::array<float, MaxChannels> rms{};
+        std::array<float, MaxChannels> truePeak{};
+        juce::uint32 blocks{0};   // blocks measured since prepare()
+    };
 
-    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
-    void audioDeviceStopped() override;
+    MasterLevelMonitor();
 
-    // Get current levels (thread-safe)
-    float getLeftChannelLevel() const { return leftChannelLevel.load(); }
-    float getRightChannelLevel() const { return rightChannelLevel.load(); }
-    std::pair<float, float> getLevels() const;
+    // Device thread, before the first block
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset();
+
+    // Audio thread: meter the final mix
+    void process(const float* const* channels, int numChannels, int numSamples);
+
+    // Any thread: latest consistent snapshot
+    Snapshot getSnapshot() const;
+
+    // Display helper: linear level to 0..1 over -60..0 dB
+    static float toMeterScale(float linear);
 
 private:
-    // Thread-safe level storage
-    std::atomic<float> leftChannelLevel{0.0f};
-    std::atomic<float> rightChannelLevel{0.0f};
-    
-    // For level smoothing
-    float smoothingFactor = 0.3f;
+    static constexpr int Oversampling = 4;
+    static constexpr int TapsPerPhase = 12;
+    static constexpr float PeakReleaseDbPerSecond = 20.0f;
+    static constexpr float RmsWindowSeconds = 0.3f;
+
+    void processChunk(int ch, const float* data, int numSamples, float& blockPeak, float& blockTruePeak,
+                      float& blockSquares);
+
+    // Polyphase interpolator coefficients [phase][tap]
+    std::array<std::array<float, TapsPerPhase>, Oversampling> phases{};
+
+    // Per channel: last TapsPerPhase - 1 input samples followed by the current block
+    std::array<std::vector<float>, MaxChannels> history;
+    std::vector<float> phaseScratch;
+    int maxBlock{0};
+    double sampleRate{44100.0};
+
+    // Meter state (audio thread)
+    std::array<float, MaxChannels> heldPeak{};
+    std::array<float, MaxChannels> heldTruePeak{};
+    std::array<float, MaxChannels> meanSquare{};
+    juce::uint32 blockCount{0};
+
+    // Seqlock-published snapshot: odd sequence = write in progress
+    std::atomic<juce::uint32> sequence{0};
+    std::array<std::atomic<float>, MaxChannels> outPeak{};
+    std::array<std::atomic<float>, MaxChannels> outRms{};
+    std::array<std::atomic<float>, MaxChannels> outTruePeak{};
+    std::atomic<juce::uint32> outBlocks{0};
 };
 
 #endif // MASTERLEVELMONITOR_H
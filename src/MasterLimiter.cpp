@@ -0,0 +1,132 @@
+#include "MasterLimiter.h"
+#include "SimdDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // out[i] = max(x[i .. i + w - 1]) for i < n; x holds n + w - 1 values. Prefix and suffix
+    // scans run per w-sized chunk, so every window is one suffix and one prefix.
+    SIMD_DISPATCH
+    void slidingMax(const float* x, int n, int w, float* prefix, float* suffix, float* out) noexcept
+    {
+        const int total = n + w - 1;
+        for (int start = 0; start < total; start += w) {
+            const int end = std::min(total, start + w);
+            prefix[start] = x[start];
+            for (int j = start + 1; j < end; ++j) prefix[j] = std::max(prefix[j - 1], x[j]);
+            suffix[end - 1] = x[end - 1];
+            for (int j = end - 2; j >= start; --j) suffix[j] = std::max(suffix[j + 1], x[j]);
+        }
+        const float* later = prefix + (w - 1);
+        for (int i = 0; i < n; ++i) out[i] = std::max(suffix[i], later[i]);
+    }
+}
+
+void MasterLimiter::prepare(double rate, int maximumBlockSize)
+{
+    sampleRate = rate > 0.0 ? rate : 44100.0;
+    maxBlock = std::max(1, maximumBlockSize);
+    capacity = (int) std::ceil(MaxLookaheadMs * 0.001 * sampleRate) + 1;
+    ceiling = juce::Decibels::decibelsToGain(CeilingDb);
+    releaseCoeff = (float) (1.0 - std::exp(-1.0 / (ReleaseMs * 0.001 * sampleRate)));
+
+    for (auto& line : delayLine) line.assign((size_t) capacity, 0.0f);
+    peaks.assign((size_t) (capacity + maxBlock), 0.0f);
+    prefix.assign(peaks.size(), 0.0f);
+    suffix.assign(peaks.size(), 0.0f);
+    held.assign((size_t) maxBlock, 0.0f);
+    box.assign((size_t) capacity, 1.0f);
+    running = false;
+    latencySamples.store(0, std::memory_order_relaxed);
+    gainReductionDb.store(0.0f, std::memory_order_relaxed);
+}
+
+void MasterLimiter::reset(int windowLength) noexcept
+{
+    window = juce::jlimit(1, capacity, windowLength);
+    for (auto& line : delayLine) std::fill(line.begin(), line.end(), 0.0f);
+    std::fill(peaks.begin(), peaks.end(), 0.0f);
+    std::fill(box.begin(), box.end(), 1.0f);
+    delayPos = 0;
+    boxPos = 0;
+    boxSum = window;
+    envelope = 1.0f;
+    latencySamples.store(window - 1, std::memory_order_relaxed);
+}
+
+void MasterLimiter::process(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    if (capacity == 0 || numSamples <= 0) return;
+    numChannels = std::min(numChannels, MaxChannels);
+
+    if (!enabledTarget.load(std::memory_order_relaxed) || numChannels <= 0) {
+        if (running) {
+            running = false;
+            latencySamples.store(0, std::memory_order_relaxed);
+            gainReductionDb.store(0.0f, std::memory_order_relaxed);
+        }
+        return;
+    }
+    const int wanted = juce::jlimit(1, capacity, juce::roundToInt(lookaheadTarget.load(std::memory_order_relaxed) * 0.001 * sampleRate) + 1);
+    if (!running || wanted != window) {
+        reset(wanted);
+        running = true;
+    }
+
+    float deepest = 1.0f;
+    for (int done = 0; done < numSamples; ) {
+        const int n = std::min(maxBlock, numSamples - done);
+        deepest = std::min(deepest, processChunk(channels, numChannels, done, n));
+        done += n;
+    }
+    gainReductionDb.store(juce::Decibels::gainToDecibels(deepest), std::memory_order_relaxed);
+}
+
+float MasterLimiter::processChunk(float* const* channels, int numChannels, int offset, int n) noexcept
+{
+    const int history = window - 1;
+    float* const current = peaks.data() + history;
+
+    // Peak of the channels for every sample, behind the last window's worth of history
+    juce::FloatVectorOperations::abs(current, channels[0] + offset, n);
+    if (numChannels > 1) {
+        juce::FloatVectorOperations::abs(held.data(), channels[1] + offset, n);
+        juce::FloatVectorOperations::max(current, current, held.data(), n);
+    }
+    slidingMax(peaks.data(), n, window, prefix.data(), suffix.data(), held.data());
+
+    float deepest = 1.0f;
+    for (int i = 0; i < n; ++i) {
+        // Instant attack to what the window needs, exponential release back up
+        const float required = held[(size_t) i] > ceiling ? ceiling / held[(size_t) i] : 1.0f;
+        envelope = std::min(required, envelope + releaseCoeff * (1.0f - envelope));
+        boxSum += envelope - box[(size_t) boxPos];
+        box[(size_t) boxPos] = envelope;
+        if (++boxPos == window) boxPos = 0;
+        held[(size_t) i] = (float) (boxSum / window);
+        deepest = std::min(deepest, held[(size_t) i]);
+    }
+
+    // Delay by window - 1 and apply the gain; the clip only catches float rounding
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* data = channels[ch] + offset;
+        if (history > 0) {
+            float* line = delayLine[ch].data();
+            int pos = delayPos;
+            for (int i = 0; i < n; ++i) {
+                const float in = data[i];
+                data[i] = line[pos];
+                line[pos] = in;
+                if (++pos == history) pos = 0;
+            }
+        }
+        juce::FloatVectorOperations::multiply(data, held.data(), n);
+        juce::FloatVectorOperations::clip(data, data, -ceiling, ceiling, n);
+    }
+    if (history > 0) delayPos = (delayPos + n) % history;
+
+    // The chunk's last window - 1 peaks are the next chunk's history
+    if (history > 0) std::memmove(peaks.data(), current + n - history, sizeof(float) * (size_t) history);
+    return deepest;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * Brickwall lookahead limiter on the master bus, run by DeckMixer after master volume and the
+ * sampler and before the meter, the recorder and the stream, so none of them ever sees more
+ * than CeilingDb.
+ *
+ * The output is delayed by the lookahead. Over that window the gain is the one the loudest
+ * sample in it needs: the per-sample peak of the channels goes through a sliding-window max
+ * (van Herk / Gil-Werman: a prefix and a suffix max per window-sized chunk, then one vector
+ * max of the two), which holds the reduction for the window. A box average of the same length
+ * turns the hold into a ramp that has arrived by the time the peak leaves the delay line, so
+ * nothing clips and nothing steps. Release is exponential over ReleaseMs.
+ *
+ * Delay line and scratch are sized for MaxLookaheadMs in prepare(); a lookahead change takes
+ * effect at the next block and starts the limiter over (a short gap, once). The delay is
+ * getLatencySamples(), which DeckMixer counts into its output latency.
+ */
+class MasterLimiter {
+public:
+    static constexpr int MaxChannels = 2;
+    static constexpr float MinLookaheadMs = 1.0f;
+    static constexpr float MaxLookaheadMs = 5.0f;
+    static constexpr float DefaultLookaheadMs = 1.5f;   // Audio/LimiterLookaheadMs
+    static constexpr float CeilingDb = -0.3f;
+    static constexpr float ReleaseMs = 80.0f;
+
+    // Device thread, before the first block: allocates for the longest lookahead
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    // Any thread; applied on the audio thread at the next block
+    void setEnabled(bool enabled) { enabledTarget.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabledTarget.load(std::memory_order_relaxed); }
+    void setLookaheadMs(float ms) { lookaheadTarget.store(juce::jlimit(MinLookaheadMs, MaxLookaheadMs, ms), std::memory_order_relaxed); }
+    float getLookaheadMs() const { return lookaheadTarget.load(std::memory_order_relaxed); }
+
+    // Audio thread: limit the finished mix in place (at most MaxChannels)
+    void process(float* const* channels, int numChannels, int numSamples) noexcept;
+
+    // Any thread: delay the limiter adds while it runs (0 when bypassed), and the deepest gain
+    // reduction of the last block (dB, <= 0)
+    int getLatencySamples() const { return latencySamples.load(std::memory_order_relaxed); }
+    float getGainReductionDb() const { return gainReductionDb.load(std::memory_order_relaxed); }
+
+private:
+    void reset(int windowLength) noexcept;
+    // Returns the lowest gain it applied
+    float processChunk(float* const* channels, int numChannels, int offset, int numSamples) noexcept;
+
+    double sampleRate{44100.0};
+    int maxBlock{0};
+    int capacity{0};            // longest window, samples
+    float ceiling{1.0f};
+    float releaseCoeff{0.0f};
+
+    // Audio thread
+    bool running{false};
+    int window{1};              // lookahead + 1 samples
+    std::vector<float> delayLine[MaxChannels];   // window - 1 samples, ring
+    int delayPos{0};
+    std::vector<float> peaks;   // last window - 1 peaks followed by the chunk's
+    std::vector<float> prefix, suffix, held;
+    std::vector<float> box;     // the last window smoothed gains, ring
+    int boxPos{0};
+    double boxSum{0.0};
+    float envelope{1.0f};
+
+    std::atomic<bool> enabledTarget{true};
+    std::atomic<float> lookaheadTarget{DefaultLookaheadMs};
+    std::atomic<int> latencySamples{0};
+    std::atomic<float> gainReductionDb{0.0f};
+};
@@ -0,0 +1,141 @@
+#include "MasterRecorder.h"
+#include <iostream>
+
+MasterRecorder::MasterRecorder()
+{
+}
+
+MasterRecorder::~MasterRecorder()
+{
+    stop();
+    writerThread.stopThread(2000);
+}
+
+bool MasterRecorder::start(const juce::File& file, double sampleRate, int bitsPerSample)
+{
+    stop();
+    if (sampleRate <= 0.0) {
+        std::cout << "MasterRecorder: no running device, cannot record" << std::endl;
+        return false;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    juce::FlacAudioFormat flacFormat;
+    const bool flac = file.hasFileExtension("flac");
+    juce::AudioFormat& format = flac ? static_cast<juce::AudioFormat&>(flacFormat) : wavFormat;
+    const int bits = flac ? std::min(bitsPerSample, 24) : bitsPerSample;
+
+    file.deleteFile();
+    auto stream = file.createOutputStream();
+    if (stream == nullptr) {
+        std::cout << "MasterRecorder: cannot write " << file.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+    writer.reset(format.createWriterFor(stream.get(), sampleRate, NumChannels, bits, {}, 0));
+    if (writer == nullptr) {
+        std::cout << "MasterRecorder: no " << format.getFormatName().toStdString() << " writer for "
+                  << bits << " bit / " << sampleRate << " Hz" << std::endl;
+        return false;
+    }
+    stream.release();   // owned by the writer now
+
+    // Everything the audio thread touches is sized here, before it is armed
+    const int fifoSamples = (int) std::ceil(sampleRate * FifoSeconds);
+    fifo = std::make_unique<juce::AbstractFifo>(fifoSamples);
+    fifoBuffer.setSize(NumChannels, fifoSamples, false, true, false);
+
+    currentFile = file;
+    recordingSampleRate = sampleRate;
+    samplesPerFlush = (int) (sampleRate * 5.0);   // header rewritten every few seconds, a crash keeps the set
+    samplesSinceFlush = 0;
+    samplesWritten.store(0);
+    droppedSamples.store(0);
+    overflowCount.store(0);
+
+    if (!writerThread.isThreadRunning())
+        writerThread.startThread(juce::Thread::Priority::normal);
+    writerThread.addTimeSliceClient(this);
+    armed.store(true);
+
+    std::cout << "MasterRecorder: recording " << file.getFullPathName().toStdString() << " ("
+              << sampleRate << " Hz, " << bits << " bit, FIFO " << FifoSeconds << " s)" << std::endl;
+    return true;
+}
+
+void MasterRecorder::stop()
+{
+    if (!armed.exchange(false)) return;
+
+    // Wait out a push() that read armed before it was cleared (at most one block)
+    while (audioThreadInside.load())
+        juce::Thread::yield();
+
+    writerThread.removeTimeSliceClient(this);
+    while (drain() == 0) {}
+    writer.reset();   // writes the final header and closes the file
+    fifo.reset();
+
+    std::cout << "MasterRecorder: stopped, " << getRecordedSeconds() << " s written";
+    if (overflowCount.load() > 0)
+        std::cout << ", " << overflowCount.load() << " overflows (" << droppedSamples.load() << " samples dropped)";
+    std::cout << std::endl;
+}
+
+void MasterRecorder::push(const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    audioThreadInside.store(true);
+    if (armed.load() && channels != nullptr && numChannels > 0 && numSamples > 0) {
+        int start1, size1, start2, size2;
+        fifo->prepareToWrite(numSamples, start1, size1, start2, size2);
+        if (size1 + size2 < numSamples) {
+            droppedSamples.fetch_add(numSamples, std::memory_order_relaxed);
+            overflowCount.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            for (int ch = 0; ch < NumChannels; ++ch) {
+                const float* src = channels[std::min(ch, numChannels - 1)];
+                if (src == nullptr) {
+                    fifoBuffer.clear(ch, start1, size1);
+                    if (size2 > 0) fifoBuffer.clear(ch, start2, size2);
+                    continue;
+                }
+                fifoBuffer.copyFrom(ch, start1, src, size1);
+                if (size2 > 0) fifoBuffer.copyFrom(ch, start2, src + size1, size2);
+            }
+            fifo->finishedWrite(size1 + size2);
+        }
+    }
+    audioThreadInside.store(false);
+}
+
+int MasterRecorder::useTimeSlice()
+{
+    return drain();
+}
+
+int MasterRecorder::drain()
+{
+    // Returns 0 while there is more to write, otherwise the ms to sleep before polling again
+    if (fifo == nullptr || writer == nullptr) return 50;
+
+    int start1, size1, start2, size2;
+    fifo->prepareToRead(fifo->getNumReady(), start1, size1, start2, size2);
+    if (size1 + size2 <= 0) return 20;
+
+    writer->writeFromAudioSampleBuffer(fifoBuffer, start1, size1);
+    if (size2 > 0)
+        writer->writeFromAudioSampleBuffer(fifoBuffer, start2, size2);
+    fifo->finishedRead(size1 + size2);
+    samplesWritten.fetch_add(size1 + size2, std::memory_order_relaxed);
+
+    samplesSinceFlush += size1 + size2;
+    if (samplesSinceFlush >= samplesPerFlush) {
+        samplesSinceFlush = 0;
+        writer->flush();
+    }
+    return 0;
+}
+
+double MasterRecorder::getRecordedSeconds() const
+{
+    return recordingSampleRate > 0.0 ? (double) samplesWritten.load() / recordingSampleRate : 0.0;
+}
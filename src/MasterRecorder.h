@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+/**
+ * Records the master bus to WAV/FLAC while playing.
+ *
+ * DeckMixer hands every finished master block to push() on the audio thread. push() only copies
+ * into a FIFO that is allocated when the recording starts (FifoSeconds of audio), so a long set
+ * never allocates, locks or waits on the audio thread. A TimeSliceThread drains the FIFO and
+ * encodes to disk, the same split AudioFormatWriter::ThreadedWriter uses, but the writer thread
+ * polls instead of being woken from push(): waking it means signalling a WaitableEvent, which
+ * takes a mutex on every block. If the disk stalls long enough to fill the FIFO, the block is
+ * dropped and counted in getDroppedSamples() rather than blocking the callback.
+ *
+ * WAV files switch to RF64 by themselves past 4 GB, so multi-hour sets are fine in either format.
+ */
+class MasterRecorder : private juce::TimeSliceClient {
+public:
+    static constexpr int NumChannels = 2;
+    static constexpr double FifoSeconds = 10.0;
+
+    MasterRecorder();
+    ~MasterRecorder() override;
+
+    // UI thread. .flac records FLAC, anything else WAV. The sample rate must be the running
+    // device's; restart the recording when the device changes.
+    bool start(const juce::File& file, double sampleRate, int bitsPerSample = 24);
+    void stop();
+    bool isRecording() const { return armed.load(); }
+
+    // Audio thread: append the finished master block (mono is written to both channels)
+    void push(const float* const* channels, int numChannels, int numSamples) noexcept;
+
+    // Any thread
+    double getRecordedSeconds() const;
+    juce::int64 getDroppedSamples() const { return droppedSamples.load(std::memory_order_relaxed); }
+    int getOverflowCount() const { return overflowCount.load(std::memory_order_relaxed); }
+    juce::File getFile() const { return currentFile; }
+    double getSampleRate() const { return recordingSampleRate; }
+
+private:
+    int useTimeSlice() override;
+    int drain();
+
+    juce::TimeSliceThread writerThread{"MasterRecorderWriter"};
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    std::unique_ptr<juce::AbstractFifo> fifo;
+    juce::AudioBuffer<float> fifoBuffer;
+    juce::File currentFile;
+    double recordingSampleRate{0.0};
+    int samplesPerFlush{0};
+    int samplesSinceFlush{0};
+
+    // Handshake with the audio thread: stop() waits until push() is out before freeing the FIFO
+    std::atomic<bool> armed{false};
+    std::atomic<bool> audioThreadInside{false};
+
+    std::atomic<juce::int64> samplesWritten{0};
+    std::atomic<juce::int64> droppedSamples{0};
+    std::atomic<int> overflowCount{0};
+
+    JUCE_DECLARE_NON_COPYABLE(MasterRecorder)
+};
@@ -0,0 +1,108 @@
+#include "MasterScope.h"
+#include "SimdDispatch.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    struct Moments {
+        float lr, ll, rr;
+    };
+
+    SIMD_DISPATCH
+    Moments sideMoments(const float* left, const float* right, int numFrames) noexcept
+    {
+        // Eight partial sums each so the compiler can keep them in vector registers
+        float lr[8] = {}, ll[8] = {}, rr[8] = {};
+        int i = 0;
+        for (; i + 8 <= numFrames; i += 8)
+            for (int k = 0; k < 8; ++k) {
+                lr[k] += left[i + k] * right[i + k];
+                ll[k] += left[i + k] * left[i + k];
+                rr[k] += right[i + k] * right[i + k];
+            }
+        for (; i < numFrames; ++i) {
+            lr[0] += left[i] * right[i];
+            ll[0] += left[i] * left[i];
+            rr[0] += right[i] * right[i];
+        }
+        Moments m{0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < 8; ++k) {
+            m.lr += lr[k];
+            m.ll += ll[k];
+            m.rr += rr[k];
+        }
+        return m;
+    }
+}
+
+void MasterScope::prepare(double sampleRate)
+{
+    decimation = std::max(1, (int) std::lround(sampleRate / TargetRate));
+    frameRate.store(sampleRate / decimation, std::memory_order_relaxed);
+    reset();
+}
+
+void MasterScope::reset()
+{
+    pending = 0;
+    sumLeft = sumRight = 0.0f;
+}
+
+void MasterScope::push(const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    if (!active.load(std::memory_order_relaxed) || numChannels <= 0 || numSamples <= 0) return;
+    const float* left = channels[0];
+    const float* right = numChannels > 1 ? channels[1] : channels[0];
+    const int frames = (pending + numSamples) / decimation;
+
+    const juce::uint64 start = written.load(std::memory_order_relaxed);
+    claimed.store(start + (juce::uint64) frames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const float scale = 1.0f / (float) decimation;
+    juce::uint64 frame = start;
+    for (int i = 0; i < numSamples; ++i) {
+        sumLeft += left[i];
+        sumRight += right[i];
+        if (++pending < decimation) continue;
+        const size_t slot = (size_t) (frame++ & Mask) * 2;
+        ring[slot].store(sumLeft * scale, std::memory_order_relaxed);
+        ring[slot + 1].store(sumRight * scale, std::memory_order_relaxed);
+        pending = 0;
+        sumLeft = sumRight = 0.0f;
+    }
+    written.store(frame, std::memory_order_release);
+}
+
+int MasterScope::readLatest(float* left, float* right, int maxFrames) const noexcept
+{
+    const juce::uint64 end = written.load(std::memory_order_acquire);
+    const int n = (int) std::min<juce::uint64>({ (juce::uint64) std::max(0, maxFrames), end, (juce::uint64) Capacity });
+    const juce::uint64 begin = end - (juce::uint64) n;
+    for (int i = 0; i < n; ++i) {
+        const size_t slot = (size_t) ((begin + (juce::uint64) i) & Mask) * 2;
+        left[i] = ring[slot].load(std::memory_order_relaxed);
+        right[i] = ring[slot + 1].load(std::memory_order_relaxed);
+    }
+
+    // Slots the writer claimed during the copy held our oldest frames: drop those
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const juce::uint64 reach = claimed.load(std::memory_order_relaxed);
+    const juce::uint64 firstIntact = reach > (juce::uint64) Capacity ? reach - (juce::uint64) Capacity : 0;
+    if (firstIntact <= begin) return n;
+    const int lost = (int) std::min<juce::uint64>(firstIntact - begin, (juce::uint64) n);
+    std::copy(left + lost, left + n, left);
+    std::copy(right + lost, right + n, right);
+    return n - lost;
+}
+
+float MasterScope::correlation(const float* left, const float* right, int numFrames) noexcept
+{
+    if (numFrames <= 0) return 0.0f;
+    const Moments m = sideMoments(left, right, numFrames);
+    const float energy = m.ll * m.rr;
+    // Below -80 dBFS on either side there is nothing to correlate
+    const float floor = 1.0e-8f * (float) numFrames;
+    if (m.ll < floor || m.rr < floor || energy <= 0.0f) return 0.0f;
+    return juce::jlimit(-1.0f, 1.0f, m.lr / std::sqrt(energy));
+}
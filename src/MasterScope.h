@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Master-bus tap for the oscilloscope, goniometer and phase-correlation view.
+ *
+ * DeckMixer hands it the finished master block right after the meter. It box-averages the
+ * block down to about TargetRate frames per second and writes the frames into a ring of
+ * relaxed atomics. That is all the audio thread does; scaling, the correlation and drawing
+ * are the reader's work. While no view is open the scope is disabled and push() returns
+ * after one flag check.
+ *
+ * The ring is not a queue. The reader never consumes frames. It copies the newest ones
+ * whenever it wants a picture, as many as it draws, and readLatest() leaves out any frames
+ * the writer overwrote during the copy. The writer never waits for a slow reader.
+ */
+class MasterScope
+{
+public:
+    static constexpr int Capacity = 16384;   // frames; power of two
+    static constexpr double TargetRate = 24000.0;
+
+    // Device thread, before the first block
+    void prepare(double sampleRate);
+    void reset();
+
+    // Any thread: a disabled scope skips its blocks (the view turns it on while it shows)
+    void setEnabled(bool enabled) { active.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Audio thread: the final mix, mono read as both sides
+    void push(const float* const* channels, int numChannels, int numSamples) noexcept;
+
+    // Any one reader: the newest frames (at most maxFrames), oldest first. Returns how many.
+    int readLatest(float* left, float* right, int maxFrames) const noexcept;
+    // Frames written since prepare(); unchanged means there is nothing new to draw
+    juce::uint64 getWrittenFrames() const noexcept { return written.load(std::memory_order_acquire); }
+    // Ring frames per second
+    double getFrameRate() const noexcept { return frameRate.load(std::memory_order_relaxed); }
+
+    // Pearson correlation of the two sides: +1 mono, 0 unrelated, -1 out of phase. 0 for silence.
+    static float correlation(const float* left, const float* right, int numFrames) noexcept;
+
+private:
+    static constexpr juce::uint64 Mask = Capacity - 1;
+
+    std::atomic<bool> active{false};
+    std::atomic<double> frameRate{TargetRate};
+
+    // Audio thread: the frame being averaged
+    int decimation{1};
+    int pending{0};
+    float sumLeft{0.0f}, sumRight{0.0f};
+
+    // Interleaved left/right. claimed runs ahead of written over the frames being stored, so a
+    // reader can tell which of the frames it copied were overwritten meanwhile.
+    std::array<std::atomic<float>, 2 * Capacity> ring{};
+    std::atomic<juce::uint64> claimed{0};
+    std::atomic<juce::uint64> written{0};
+};
@@ -0,0 +1,282 @@
+#include "MasterScopeView.h"
+#include "EventTrace.h"
+#include "FrameClock.h"
+#include "GlResources.h"
+#include "MasterScope.h"
+#include <QPainter>
+#include <QPainterPath>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int CorrelationBarHeight = 18;
+    // Below this (about -80 dBFS) a picture counts as silence
+    constexpr float SilenceLevel = 1.0e-4f;
+    constexpr float InvSqrt2 = 0.70710678f;
+
+    const QColor leftColor(80, 200, 255);
+    const QColor rightColor(255, 150, 80);
+    const QColor goniometerColor(120, 255, 160);
+    const QColor guideColor(255, 255, 255, 40);
+
+    // Point of one frame in an area: along time for a trace, mid/side for the goniometer
+    QPointF tracePoint(const QRectF& area, int index, int count, float value)
+    {
+        const double x = area.left() + area.width() * index / std::max(1, count - 1);
+        return { x, area.center().y() - std::clamp(value, -1.0f, 1.0f) * area.height() * 0.5 };
+    }
+    QPointF goniometerPoint(const QRectF& area, float l, float r)
+    {
+        const float mid = std::clamp((l + r) * InvSqrt2, -1.0f, 1.0f);
+        const float side = std::clamp((r - l) * InvSqrt2, -1.0f, 1.0f);
+        return { area.center().x() + side * area.width() * 0.5, area.center().y() - mid * area.height() * 0.5 };
+    }
+}
+
+MasterScopeView::MasterScopeView(MasterScope& scope, QWidget* parent) : QOpenGLWidget(parent), scope(scope)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent, true);
+    setAutoFillBackground(false);
+    setMinimumSize(480, 240);
+    left.resize(ScopeFrames);
+    right.resize(ScopeFrames);
+    interleaved.resize(2 * ScopeFrames);
+    connect(&FrameClock::instance(), &FrameClock::frame, this, &MasterScopeView::tick);
+}
+
+MasterScopeView::~MasterScopeView()
+{
+    scope.setEnabled(false);
+    makeCurrent();
+    program.reset();
+    if (vbo.isCreated()) vbo.destroy();
+    if (vao.isCreated()) vao.destroy();
+    frameHud.releaseGL();
+    doneCurrent();
+}
+
+void MasterScopeView::showEvent(QShowEvent* event)
+{
+    scope.setEnabled(true);
+    QOpenGLWidget::showEvent(event);
+}
+
+void MasterScopeView::hideEvent(QHideEvent* event)
+{
+    // Closed or minimised: the audio thread stops writing the ring
+    scope.setEnabled(false);
+    QOpenGLWidget::hideEvent(event);
+}
+
+void MasterScopeView::initializeGL()
+{
+    initializeOpenGLFunctions();
+    frameHud.initializeGL();
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // One buffer of left/right pairs; uMode picks what a point means
+    const char* vsrc = R"GLSL(
+        #version 330 core
+        layout(location=0) in vec2 aLR;
+        uniform int uMode;    // 0 left trace, 1 right trace, 2 goniometer
+        uniform int uCount;   // points in a trace
+        void main(){
+            if (uMode == 2) {
+                float mid = (aLR.x + aLR.y) * 0.70710678;
+                float side = (aLR.y - aLR.x) * 0.70710678;
+                gl_Position = vec4(clamp(side, -1.0, 1.0), clamp(mid, -1.0, 1.0), 0.0, 1.0);
+            } else {
+                float x = float(gl_VertexID) / float(max(uCount - 1, 1)) * 2.0 - 1.0;
+                float v = uMode == 0 ? aLR.x : aLR.y;
+                gl_Position = vec4(x, clamp(v, -1.0, 1.0), 0.0, 1.0);
+            }
+        }
+    )GLSL";
+    const char* fsrc = R"GLSL(
+        #version 330 core
+        uniform vec4 uColor;
+        out vec4 FragColor;
+        void main(){
+            FragColor = uColor;
+        }
+    )GLSL";
+    program = GlResources::instance().program("MasterScopeView.strip", vsrc, fsrc);
+    if (!program) return;
+
+    vao.create();
+    vao.bind();
+    vbo.create();
+    vbo.bind();
+    vbo.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    vbo.allocate(2 * ScopeFrames * (int) sizeof(float));
+    program->bind();
+    program->enableAttributeArray(0);
+    program->setAttributeBuffer(0, GL_FLOAT, 0, 2, 2 * sizeof(float));
+    vao.release();
+    program->release();
+    uploaded = false;
+}
+
+void MasterScopeView::tick()
+{
+    if (!isVisible()) return;
+    const quint64 written = scope.getWrittenFrames();
+    if (written == readFrames) return;
+    readFrames = written;
+
+    frames = scope.readLatest(left.data(), right.data(), ScopeFrames);
+    const auto loud = [](float v) { return std::abs(v) > SilenceLevel; };
+    const bool silent = std::none_of(left.begin(), left.begin() + frames, loud)
+                     && std::none_of(right.begin(), right.begin() + frames, loud);
+
+    const int gonioFrom = std::max(0, frames - GoniometerFrames);
+    const double target = MasterScope::correlation(left.data() + gonioFrom, right.data() + gonioFrom, frames - gonioFrom);
+    const double periodSec = FrameClock::instance().getFramePeriodMs() * 0.001;
+    const double previous = correlation;
+    correlation += (target - correlation) * (1.0 - std::exp(-periodSec / CorrelationTimeConstantSec));
+
+    // Silence already on screen, with the meter at rest, draws the same picture again
+    if (silent && paintedSilence && std::abs(correlation - previous) < 0.001) return;
+    paintedSilence = silent;
+    uploaded = false;
+    update();
+}
+
+void MasterScopeView::paintGL()
+{
+    EVENT_TRACE_SCOPE("MasterScopeView::paintGL", "ui");
+    FrameTimeHud::Frame hudFrame(frameHud);
+    glClearColor(0.02f, 0.02f, 0.025f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Goniometer square on the right, traces to its left, correlation bar underneath both
+    const int plotHeight = std::max(1, height() - CorrelationBarHeight);
+    const int side = std::min(plotHeight, width() / 2);
+    const QRect goniometerArea(width() - side, (plotHeight - side) / 2, side, side);
+    const QRect scopeArea(0, 0, std::max(1, width() - side), plotHeight);
+
+    const bool gpu = program && GlResources::instance().gpuWaveforms();
+    if (frames > 1 && !gpu) {
+        drawStripsSoftware(scopeArea, goniometerArea);
+    } else if (frames > 1) {
+        if (!uploaded) {
+            for (int i = 0; i < frames; ++i) {
+                interleaved[(size_t) (2 * i)] = left[(size_t) i];
+                interleaved[(size_t) (2 * i + 1)] = right[(size_t) i];
+            }
+            vbo.bind();
+            vbo.write(0, interleaved.data(), 2 * frames * (int) sizeof(float));
+            vbo.release();
+            uploaded = true;
+        }
+        // GL viewports count device pixels from the bottom left
+        const qreal dpr = devicePixelRatioF();
+        const auto viewport = [&](const QRect& area) {
+            glViewport((GLint) std::lround(area.x() * dpr), (GLint) std::lround((height() - area.bottom() - 1) * dpr),
+                       (GLsizei) std::lround(area.width() * dpr), (GLsizei) std::lround(area.height() * dpr));
+        };
+        program->bind();
+        vao.bind();
+        program->setUniformValue("uCount", frames);
+        const int half = scopeArea.height() / 2;
+        viewport(QRect(scopeArea.x(), scopeArea.y(), scopeArea.width(), half));
+        program->setUniformValue("uMode", 0);
+        program->setUniformValue("uColor", leftColor);
+        glDrawArrays(GL_LINE_STRIP, 0, frames);
+        viewport(QRect(scopeArea.x(), scopeArea.y() + half, scopeArea.width(), scopeArea.height() - half));
+        program->setUniformValue("uMode", 1);
+        program->setUniformValue("uColor", rightColor);
+        glDrawArrays(GL_LINE_STRIP, 0, frames);
+        viewport(goniometerArea);
+        const int gonioFrom = std::max(0, frames - GoniometerFrames);
+        program->setUniformValue("uMode", 2);
+        program->setUniformValue("uColor", QColor(goniometerColor.red(), goniometerColor.green(), goniometerColor.blue(), 160));
+        glDrawArrays(GL_LINE_STRIP, gonioFrom, frames - gonioFrom);
+        vao.release();
+        program->release();
+        glViewport(0, 0, (GLsizei) std::lround(width() * dpr), (GLsizei) std::lround(height() * dpr));
+    }
+    drawOverlay(scopeArea, goniometerArea);
+}
+
+void MasterScopeView::drawStripsSoftware(const QRect& scopeArea, const QRect& goniometerArea)
+{
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing, false);
+    const int half = scopeArea.height() / 2;
+    const QRectF leftArea(scopeArea.x(), scopeArea.y(), scopeArea.width(), half);
+    const QRectF rightArea(scopeArea.x(), scopeArea.y() + half, scopeArea.width(), scopeArea.height() - half);
+
+    QPainterPath leftPath, rightPath, gonioPath;
+    leftPath.moveTo(tracePoint(leftArea, 0, frames, left[0]));
+    rightPath.moveTo(tracePoint(rightArea, 0, frames, right[0]));
+    for (int i = 1; i < frames; ++i) {
+        leftPath.lineTo(tracePoint(leftArea, i, frames, left[(size_t) i]));
+        rightPath.lineTo(tracePoint(rightArea, i, frames, right[(size_t) i]));
+    }
+    const int gonioFrom = std::max(0, frames - GoniometerFrames);
+    gonioPath.moveTo(goniometerPoint(goniometerArea, left[(size_t) gonioFrom], right[(size_t) gonioFrom]));
+    for (int i = gonioFrom + 1; i < frames; ++i)
+        gonioPath.lineTo(goniometerPoint(goniometerArea, left[(size_t) i], right[(size_t) i]));
+
+    p.setPen(leftColor);
+    p.drawPath(leftPath);
+    p.setPen(rightColor);
+    p.drawPath(rightPath);
+    p.setPen(QColor(goniometerColor.red(), goniometerColor.green(), goniometerColor.blue(), 160));
+    p.drawPath(gonioPath);
+}
+
+void MasterScopeView::drawOverlay(const QRect& scopeArea, const QRect& goniometerArea)
+{
+    QPainter p(this);
+    QFont font("Monospace", 8);
+    font.setStyleHint(QFont::TypeWriter);
+    p.setFont(font);
+
+    // Trace zero lines and channel names
+    const int half = scopeArea.height() / 2;
+    p.setPen(guideColor);
+    p.drawLine(scopeArea.left(), scopeArea.top() + half / 2, scopeArea.right(), scopeArea.top() + half / 2);
+    p.drawLine(scopeArea.left(), scopeArea.top() + half + (scopeArea.height() - half) / 2, scopeArea.right(),
+               scopeArea.top() + half + (scopeArea.height() - half) / 2);
+    p.drawLine(scopeArea.left(), scopeArea.top() + half, scopeArea.right(), scopeArea.top() + half);
+    p.setPen(leftColor);
+    p.drawText(scopeArea.left() + 4, scopeArea.top() + 12, "L");
+    p.setPen(rightColor);
+    p.drawText(scopeArea.left() + 4, scopeArea.top() + half + 12, "R");
+
+    // Goniometer: full-scale diamond, the L and R axes on the diagonals, M straight up
+    const QRectF g(goniometerArea);
+    const QPointF c = g.center();
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setPen(guideColor);
+    p.drawLine(g.left(), g.top(), g.right(), g.bottom());
+    p.drawLine(g.right(), g.top(), g.left(), g.bottom());
+    p.drawLine(QPointF(c.x(), g.top()), QPointF(c.x(), g.bottom()));
+    p.drawLine(QPointF(g.left(), c.y()), QPointF(g.right(), c.y()));
+    const QPointF diamond[4] = { {c.x(), g.top()}, {g.right(), c.y()}, {c.x(), g.bottom()}, {g.left(), c.y()} };
+    p.drawPolygon(diamond, 4);
+    p.setPen(QColor(255, 255, 255, 140));
+    p.drawText(QPointF(g.left() + 4, g.top() + 12), "L");
+    p.drawText(QPointF(g.right() - 10, g.top() + 12), "R");
+    p.drawText(QPointF(c.x() + 4, g.top() + 12), "M");
+    p.setRenderHint(QPainter::Antialiasing, false);
+
+    // Correlation: -1 at the left, +1 at the right, filled from the centre
+    const QRect bar(0, height() - CorrelationBarHeight, width(), CorrelationBarHeight);
+    p.fillRect(bar, QColor(12, 12, 14));
+    const int centre = bar.left() + bar.width() / 2;
+    const int reach = (int) std::lround(correlation * (bar.width() / 2 - 2));
+    const QRect fill = reach >= 0 ? QRect(centre, bar.top() + 3, reach, bar.height() - 6)
+                                  : QRect(centre + reach, bar.top() + 3, -reach, bar.height() - 6);
+    p.fillRect(fill, correlation >= 0.0 ? QColor(80, 220, 120) : QColor(240, 80, 70));
+    p.setPen(guideColor);
+    p.drawLine(centre, bar.top(), centre, bar.bottom());
+    p.setPen(QColor(220, 220, 220));
+    p.drawText(bar.adjusted(4, 0, -4, 0), Qt::AlignVCenter | Qt::AlignLeft, "-1");
+    p.drawText(bar.adjusted(4, 0, -4, 0), Qt::AlignVCenter | Qt::AlignRight, "+1");
+    p.drawText(bar, Qt::AlignCenter, QString("Correlation %1").arg(correlation, 0, 'f', 2));
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLShaderProgram>
+#include <memory>
+#include <vector>
+#include "FrameTimeHud.h"
+
+class MasterScope;
+
+/**
+ * Master-bus sound-check view (View > Master Scope): oscilloscope, goniometer and
+ * phase-correlation meter.
+ *
+ * On each FrameClock tick it copies the newest frames out of the MasterScope ring. Only a new
+ * picture schedules a repaint, and silence that is already on screen is not drawn again. The
+ * frames go to the GPU as one buffer of left/right pairs. Both scope traces and the goniometer
+ * are line strips drawn from that buffer. The vertex shader places each point: along time for
+ * a trace, mid against side for the goniometer, where mono is a vertical line and anti-phase a
+ * horizontal one. The correlation bar and the guides are painted over it.
+ *
+ * The scope is enabled only while the view is shown. Software GL (GlResources::gpuWaveforms()
+ * false) draws the same strips with QPainter.
+ */
+class MasterScopeView : public QOpenGLWidget, protected QOpenGLFunctions
+{
+    Q_OBJECT
+public:
+    // Newest frames drawn by the traces and by the goniometer
+    static constexpr int ScopeFrames = 2048;
+    static constexpr int GoniometerFrames = 1024;
+    // Correlation meter ballistics
+    static constexpr double CorrelationTimeConstantSec = 0.3;
+
+    explicit MasterScopeView(MasterScope& scope, QWidget* parent = nullptr);
+    ~MasterScopeView() override;
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    void tick();
+    void drawStripsSoftware(const QRect& scopeArea, const QRect& goniometerArea);
+    void drawOverlay(const QRect& scopeArea, const QRect& goniometerArea);
+
+    MasterScope& scope;
+    std::shared_ptr<QOpenGLShaderProgram> program;
+    QOpenGLBuffer vbo{ QOpenGLBuffer::VertexBuffer };
+    QOpenGLVertexArrayObject vao;
+    FrameTimeHud frameHud{this, "MasterScopeView"};
+
+    // Frames of the current picture, oldest first
+    std::vector<float> left, right, interleaved;
+    int frames{0};
+    bool uploaded{false};
+    quint64 readFrames{0};     // scope's written count at the last read
+    bool paintedSilence{false};
+    double correlation{0.0};   // smoothed
+};
@@ -0,0 +1,342 @@
+#include "MasterStreamer.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr int EncodeBlockSamples = 2048;
+    constexpr size_t SendChunkBytes = 16384;
+    // After a bitrate change the queue needs a moment to show the effect
+    constexpr double StepDownHoldSeconds = 5.0;
+}
+
+// The writer's output: appends to the streamer's byte queue, or swallows the tail of a stream
+// that a new connection will never send
+class MasterStreamer::QueueStream : public juce::OutputStream {
+public:
+    explicit QueueStream(MasterStreamer& owner) : owner(owner) {}
+
+    bool write(const void* data, size_t numBytes) override {
+        position += (juce::int64) numBytes;
+        if (discard || numBytes == 0) return true;
+        {
+            const std::lock_guard<std::mutex> lock(owner.queueMutex);
+            if (owner.queue.getSize() < owner.queued + numBytes)
+                owner.queue.setSize(std::max(owner.queued + numBytes, owner.queue.getSize() * 2));
+            owner.queue.copyFrom(data, (int) owner.queued, numBytes);
+            owner.queued += numBytes;
+        }
+        owner.queueReady.signal();
+        return true;
+    }
+    void flush() override {}
+    bool setPosition(juce::int64) override { return false; }
+    juce::int64 getPosition() override { return position; }
+
+    bool discard{false};
+
+private:
+    MasterStreamer& owner;
+    juce::int64 position{0};
+};
+
+// Icecast source connection: sends the queued Ogg bytes, reconnects after ReconnectDelayMs
+class MasterStreamer::Sender : public juce::Thread {
+public:
+    explicit Sender(MasterStreamer& owner) : juce::Thread("MasterStreamerSender"), owner(owner) {}
+
+    void stop() {
+        signalThreadShouldExit();
+        owner.queueReady.signal();
+        {
+            // A write stuck on a dead uplink returns once the socket is closed
+            const std::lock_guard<std::mutex> lock(socketMutex);
+            if (socket) socket->close();
+        }
+        stopThread(ReconnectDelayMs + 2000);
+    }
+
+private:
+    void run() override {
+        const Config& config = owner.currentConfig;
+        juce::HeapBlock<char> chunk(SendChunkBytes);
+        bool reportedFailure = false;
+        while (!threadShouldExit()) {
+            owner.state.store(State::Connecting);
+            {
+                const std::lock_guard<std::mutex> lock(socketMutex);
+                socket = std::make_unique<juce::StreamingSocket>();
+            }
+            juce::String error;
+            if (!socket->connect(config.host, config.port, 3000)) error = "cannot connect";
+            else error = handshake(config);
+            if (error.isNotEmpty()) {
+                if (!reportedFailure)
+                    std::cout << "MasterStreamer: " << config.host << ":" << config.port << config.mount
+                              << ": " << error << ", retrying every " << ReconnectDelayMs / 1000 << " s" << std::endl;
+                reportedFailure = true;
+                closeSocket();
+                wait(ReconnectDelayMs);
+                continue;
+            }
+            reportedFailure = false;
+
+            // Every connection starts a stream of its own, headers first
+            int wanted;
+            {
+                const std::lock_guard<std::mutex> lock(owner.queueMutex);
+                wanted = owner.generation + 1;
+            }
+            owner.restartRequested.store(true);
+            owner.state.store(State::Live);
+            std::cout << "MasterStreamer: live on " << config.host << ":" << config.port << config.mount << std::endl;
+
+            while (!threadShouldExit()) {
+                owner.queueReady.wait(50);
+                size_t numBytes = 0;
+                {
+                    const std::lock_guard<std::mutex> lock(owner.queueMutex);
+                    if (owner.generation < wanted || owner.queued == 0) continue;
+                    numBytes = std::min(owner.queued, SendChunkBytes);
+                    std::memcpy(chunk.get(), owner.queue.getData(), numBytes);
+                    owner.queue.removeSection(0, numBytes);
+                    owner.queued -= numBytes;
+                }
+                if (socket->write(chunk.get(), (int) numBytes) != (int) numBytes) {
+                    std::cout << "MasterStreamer: connection lost" << std::endl;
+                    break;
+                }
+            }
+            closeSocket();
+            if (!threadShouldExit()) wait(ReconnectDelayMs);
+        }
+    }
+
+    // Empty on success, otherwise what the server said
+    juce::String handshake(const Config& config) {
+        const juce::String credentials = juce::Base64::toBase64(config.user + ":" + config.password);
+        const juce::String request = "PUT " + config.mount + " HTTP/1.1\r\n"
+            "Host: " + config.host + ":" + juce::String(config.port) + "\r\n"
+            "Authorization: Basic " + credentials + "\r\n"
+            "User-Agent: PulseDJ-X\r\n"
+            "Content-Type: audio/ogg\r\n"
+            "Ice-Name: " + config.name + "\r\n"
+            "Ice-Public: 0\r\n"
+            "Expect: 100-continue\r\n\r\n";
+        const juce::CharPointer_UTF8 text = request.toUTF8();
+        if (socket->write(text.getAddress(), (int) text.sizeInBytes() - 1) < 0) return "cannot send the request";
+
+        juce::String response;
+        char c = 0;
+        while (!response.endsWith("\r\n\r\n") && response.length() < 4096) {
+            if (socket->waitUntilReady(true, 3000) != 1 || socket->read(&c, 1, true) != 1) return "no response";
+            response += c;
+        }
+        const int status = response.fromFirstOccurrenceOf(" ", false, false).getIntValue();
+        if (status == 100 || status == 200) return {};
+        return response.upToFirstOccurrenceOf("\r\n", false, false);
+    }
+
+    void closeSocket() {
+        const std::lock_guard<std::mutex> lock(socketMutex);
+        if (socket) socket->close();
+        socket.reset();
+    }
+
+    MasterStreamer& owner;
+    std::mutex socketMutex;
+    std::unique_ptr<juce::StreamingSocket> socket;
+};
+
+MasterStreamer::MasterStreamer() : juce::Thread("MasterStreamerEncoder")
+{
+    qualityOptions = format.getQualityOptions();
+}
+
+MasterStreamer::~MasterStreamer()
+{
+    stop();
+}
+
+bool MasterStreamer::start(const Config& config, double sampleRate)
+{
+    stop();
+    if (sampleRate <= 0.0 || config.host.isEmpty()) {
+        std::cout << "MasterStreamer: needs a running device and a server" << std::endl;
+        return false;
+    }
+
+    // The highest option at or below the configured bitrate
+    maxQualityIndex = 0;
+    for (int i = 0; i < qualityOptions.size(); ++i)
+        if (qualityOptions[i].getIntValue() <= config.bitrateKbps) maxQualityIndex = i;
+
+    const int fifoSamples = (int) std::ceil(sampleRate * FifoSeconds);
+    fifo = std::make_unique<juce::AbstractFifo>(fifoSamples);
+    fifoBuffer.setSize(NumChannels, fifoSamples, false, true, false);
+    encodeBuffer.setSize(NumChannels, EncodeBlockSamples);
+    {
+        const std::lock_guard<std::mutex> lock(queueMutex);
+        queue.setSize(0);
+        queued = 0;
+    }
+
+    currentConfig = config;
+    streamSampleRate = sampleRate;
+    qualityIndex = maxQualityIndex;
+    bitrateKbps.store(qualityOptions[qualityIndex].getIntValue());
+    encoderLoad.store(0.0);
+    droppedSamples.store(0);
+    restartRequested.store(false);
+    state.store(State::Connecting);
+
+    armed.store(true);
+    startThread(juce::Thread::Priority::normal);
+    sender = std::make_unique<Sender>(*this);
+    sender->startThread(juce::Thread::Priority::normal);
+    std::cout << "MasterStreamer: streaming to " << config.host << ":" << config.port << config.mount
+              << " (Ogg Vorbis, up to " << bitrateKbps.load() << " kbps)" << std::endl;
+    return true;
+}
+
+void MasterStreamer::stop()
+{
+    if (!armed.exchange(false)) return;
+
+    // Wait out a push() that read armed before it was cleared (at most one block)
+    while (audioThreadInside.load())
+        juce::Thread::yield();
+
+    if (sender) sender->stop();
+    sender.reset();
+    signalThreadShouldExit();
+    stopThread(2000);
+    writer.reset();
+    sink = nullptr;
+    fifo.reset();
+    state.store(State::Stopped);
+
+    std::cout << "MasterStreamer: stopped";
+    if (droppedSamples.load() > 0) std::cout << ", " << droppedSamples.load() << " samples dropped";
+    std::cout << std::endl;
+}
+
+void MasterStreamer::push(const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    audioThreadInside.store(true);
+    if (armed.load() && channels != nullptr && numChannels > 0 && numSamples > 0) {
+        int start1, size1, start2, size2;
+        fifo->prepareToWrite(numSamples, start1, size1, start2, size2);
+        if (size1 + size2 < numSamples) {
+            droppedSamples.fetch_add(numSamples, std::memory_order_relaxed);
+        } else {
+            for (int ch = 0; ch < NumChannels; ++ch) {
+                const float* src = channels[std::min(ch, numChannels - 1)];
+                if (src == nullptr) {
+                    fifoBuffer.clear(ch, start1, size1);
+                    if (size2 > 0) fifoBuffer.clear(ch, start2, size2);
+                    continue;
+                }
+                fifoBuffer.copyFrom(ch, start1, src, size1);
+                if (size2 > 0) fifoBuffer.copyFrom(ch, start2, src + size1, size2);
+            }
+            fifo->finishedWrite(size1 + size2);
+        }
+    }
+    audioThreadInside.store(false);
+}
+
+void MasterStreamer::run()
+{
+    while (!threadShouldExit()) {
+        if (restartRequested.exchange(false)) restartEncoder(qualityIndex, true);
+        const int waitMs = encode();
+        if (waitMs > 0) wait(waitMs);
+    }
+}
+
+void MasterStreamer::restartEncoder(int index, bool discard)
+{
+    if (writer) {
+        sink->discard = discard;
+        writer.reset();   // ends the Ogg stream (into the queue unless discarded)
+    }
+    sink = nullptr;
+    if (discard) {
+        const std::lock_guard<std::mutex> lock(queueMutex);
+        queued = 0;
+        ++generation;
+    }
+
+    // A new logical stream chained onto the old one; Icecast and players take the switch
+    auto stream = std::make_unique<QueueStream>(*this);
+    writer.reset(format.createWriterFor(stream.get(), streamSampleRate, NumChannels, 16, {}, index));
+    if (writer == nullptr) {
+        std::cout << "MasterStreamer: no Ogg Vorbis encoder for " << streamSampleRate << " Hz" << std::endl;
+        return;
+    }
+    sink = stream.release();   // owned by the writer now
+    if (index != qualityIndex)
+        std::cout << "MasterStreamer: " << qualityOptions[qualityIndex] << " -> " << qualityOptions[index] << std::endl;
+    qualityIndex = index;
+    bitrateKbps.store(qualityOptions[index].getIntValue());
+    sinceChangeSeconds = calmSeconds = 0.0;
+}
+
+int MasterStreamer::encode()
+{
+    // Returns 0 while there is more to encode, otherwise the ms to wait before looking again
+    if (fifo == nullptr) return 50;
+    const int ready = fifo->getNumReady();
+    if (ready < EncodeBlockSamples) return 10;
+
+    const int numSamples = std::min(ready, encodeBuffer.getNumSamples());
+    // Not live: nothing would be sent, keep the FIFO empty without encoding
+    if (writer == nullptr || state.load() != State::Live) {
+        fifo->finishedRead(numSamples);
+        return 0;
+    }
+    // The uplink is far behind: stop draining, push() drops from here on
+    if (queuedSeconds() > MaxQueueSeconds) return 20;
+
+    int start1, size1, start2, size2;
+    fifo->prepareToRead(numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < NumChannels; ++ch) {
+        encodeBuffer.copyFrom(ch, 0, fifoBuffer, ch, start1, size1);
+        if (size2 > 0) encodeBuffer.copyFrom(ch, size1, fifoBuffer, ch, start2, size2);
+    }
+    fifo->finishedRead(size1 + size2);
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    writer->writeFromAudioSampleBuffer(encodeBuffer, 0, size1 + size2);
+    const double encodeSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    adaptBitrate(size1 + size2, encodeSeconds);
+    return 0;
+}
+
+void MasterStreamer::adaptBitrate(int numSamples, double encodeSeconds)
+{
+    const double audioSeconds = numSamples / streamSampleRate;
+    const double load = 0.9 * encoderLoad.load(std::memory_order_relaxed) + 0.1 * (encodeSeconds / audioSeconds);
+    encoderLoad.store(load, std::memory_order_relaxed);
+    sinceChangeSeconds += audioSeconds;
+    calmSeconds += audioSeconds;
+
+    const double backlog = queuedSeconds();
+    if (backlog > BackpressureSeconds || load > MaxEncoderLoad) {
+        calmSeconds = 0.0;
+        if (qualityIndex > 0 && sinceChangeSeconds >= StepDownHoldSeconds) restartEncoder(qualityIndex - 1, false);
+    } else if (backlog > 0.25 * BackpressureSeconds || load > 0.5 * MaxEncoderLoad) {
+        // Not in trouble, but not quiet enough to try more either
+        calmSeconds = 0.0;
+    } else if (qualityIndex < maxQualityIndex && calmSeconds >= StepUpSeconds) {
+        restartEncoder(qualityIndex + 1, false);
+    }
+}
+
+double MasterStreamer::queuedSeconds() const
+{
+    const double bytesPerSecond = bitrateKbps.load(std::memory_order_relaxed) * 125.0;
+    const std::lock_guard<std::mutex> lock(queueMutex);
+    return bytesPerSecond > 0.0 ? (double) queued / bytesPerSecond : 0.0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+/**
+ * Streams the master bus live to an Icecast server (Ogg Vorbis, HTTP PUT source protocol).
+ *
+ * The audio side is MasterRecorder's: DeckMixer hands every finished master block to push(),
+ * which only copies into a FIFO sized when the stream starts, and drops the block (counted) if
+ * the FIFO is full. Nothing on the audio thread ever waits on the encoder or the network.
+ *
+ * Two threads sit behind it. The encoder drains the FIFO and encodes into an in-memory byte
+ * queue; the sender writes that queue to the socket and reconnects when the server goes away.
+ * The encoder watches both ends: when the queue backs up (the uplink can't keep up) or encoding
+ * takes more than MaxEncoderLoad of real time, it finishes the Ogg stream and chains a new one
+ * at the next lower bitrate, and climbs back one step after StepUpSeconds without trouble. Past
+ * MaxQueueSeconds it stops draining, so the FIFO fills and push() drops audio instead.
+ */
+class MasterStreamer : private juce::Thread {
+public:
+    static constexpr int NumChannels = 2;
+    static constexpr double FifoSeconds = 4.0;
+    static constexpr double MaxEncoderLoad = 0.25;    // share of real time the encoder may use
+    static constexpr double BackpressureSeconds = 1.5;
+    static constexpr double MaxQueueSeconds = 6.0;
+    static constexpr double StepUpSeconds = 30.0;
+    static constexpr int ReconnectDelayMs = 3000;
+
+    struct Config {
+        juce::String host;
+        int port{8000};
+        juce::String mount{"/live.ogg"};
+        juce::String user{"source"};
+        juce::String password;
+        juce::String name{"PulseDJ-X"};
+        int bitrateKbps{128};      // the highest it goes; stepped down under load
+    };
+
+    enum class State { Stopped, Connecting, Live };
+
+    MasterStreamer();
+    ~MasterStreamer() override;
+
+    // UI thread. The sample rate must be the running device's; restart when the device changes.
+    bool start(const Config& config, double sampleRate);
+    void stop();
+    bool isStreaming() const { return armed.load(); }
+
+    // Audio thread: append the finished master block (mono goes to both channels)
+    void push(const float* const* channels, int numChannels, int numSamples) noexcept;
+
+    // Any thread
+    State getState() const { return state.load(); }
+    int getBitrateKbps() const { return bitrateKbps.load(std::memory_order_relaxed); }
+    double getEncoderLoad() const { return encoderLoad.load(std::memory_order_relaxed); }
+    juce::int64 getDroppedSamples() const { return droppedSamples.load(std::memory_order_relaxed); }
+    double getSampleRate() const { return streamSampleRate; }
+
+private:
+    class Sender;
+    class QueueStream;
+
+    void run() override;
+    // Finish the current Ogg stream and begin a new one at `qualityIndex`; `discard` drops what
+    // is queued and the old stream's tail (a fresh connection starts with the new headers)
+    void restartEncoder(int qualityIndex, bool discard);
+    int encode();
+    void adaptBitrate(int numSamples, double encodeSeconds);
+    double queuedSeconds() const;
+
+    juce::OggVorbisAudioFormat format;
+    juce::StringArray qualityOptions;
+    Config currentConfig;
+    double streamSampleRate{0.0};
+    int maxQualityIndex{0};
+
+    // Audio thread -> encoder
+    std::unique_ptr<juce::AbstractFifo> fifo;
+    juce::AudioBuffer<float> fifoBuffer;
+    std::atomic<bool> armed{false};
+    std::atomic<bool> audioThreadInside{false};
+
+    // Encoder -> sender: Ogg bytes, and the stream generation they belong to
+    mutable std::mutex queueMutex;
+    juce::MemoryBlock queue;
+    size_t queued{0};
+    int generation{0};
+    juce::WaitableEvent queueReady;
+
+    // Encoder thread only
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    QueueStream* sink{nullptr};          // owned by writer
+    juce::AudioBuffer<float> encodeBuffer;
+    int qualityIndex{0};
+    double sinceChangeSeconds{0.0};      // of audio encoded since the last bitrate change
+    double calmSeconds{0.0};             // ... since the queue or the encoder last looked busy
+
+    std::unique_ptr<Sender> sender;
+    std::atomic<bool> restartRequested{false};   // set by the sender on every new connection
+    std::atomic<State> state{State::Stopped};
+    std::atomic<int> bitrateKbps{0};
+    std::atomic<double> encoderLoad{0.0};
+    std::atomic<juce::int64> droppedSamples{0};
+
+    JUCE_DECLARE_NON_COPYABLE(MasterStreamer)
+};
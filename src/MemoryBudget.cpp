@@ -0,0 +1,91 @@
+#include "MemoryBudget.h"
+#include <algorithm>
+#include <iostream>
+
+const char* MemoryBudget::getPoolName(Pool pool)
+{
+    switch (pool) {
+        case Pool::DecodedTracks: return "Decoded tracks";
+        case Pool::Waveforms: return "Waveforms";
+        case Pool::Analysis: return "Analysis buffers";
+        case Pool::Library: return "Library";
+        case Pool::Artwork: return "Artwork thumbnails";
+        case Pool::GpuTextures: return "GPU textures";
+        case Pool::Stems: return "Stems";
+        case Pool::NumPools: break;
+    }
+    return "?";
+}
+
+MemoryBudget& MemoryBudget::getInstance()
+{
+    static MemoryBudget instance;
+    return instance;
+}
+
+int64_t MemoryBudget::getTotalBytes() const noexcept
+{
+    int64_t total = 0;
+    for (const auto& pool : pools) total += pool.load(std::memory_order_relaxed);
+    return total;
+}
+
+int MemoryBudget::addEvictor(Evictor evictor)
+{
+    std::lock_guard<std::mutex> guard(evictorLock);
+    evictors.emplace_back(nextEvictorId, std::move(evictor));
+    return nextEvictorId++;
+}
+
+void MemoryBudget::removeEvictor(int id)
+{
+    // Waits for a running makeRoom(), so the evictor is not called after this returns
+    std::lock_guard<std::mutex> eviction(evictionLock);
+    std::lock_guard<std::mutex> guard(evictorLock);
+    evictors.erase(std::remove_if(evictors.begin(), evictors.end(),
+                                  [id](const auto& entry) { return entry.first == id; }),
+                   evictors.end());
+}
+
+std::vector<MemoryBudget::Evictor> MemoryBudget::getEvictors()
+{
+    std::lock_guard<std::mutex> guard(evictorLock);
+    std::vector<Evictor> order;
+    for (const auto& entry : evictors) order.push_back(entry.second);
+    return order;
+}
+
+bool MemoryBudget::makeRoom(int64_t incomingBytes)
+{
+    std::lock_guard<std::mutex> eviction(evictionLock);
+    if (getAvailableBytes() >= incomingBytes) return true;
+
+    const int64_t before = getTotalBytes();
+    for (const auto& evictor : getEvictors()) {
+        const int64_t missing = incomingBytes - getAvailableBytes();
+        if (missing <= 0) break;
+        evictor(missing);
+    }
+
+    const bool fits = getAvailableBytes() >= incomingBytes;
+    std::cout << "MemoryBudget: evicted " << ((before - getTotalBytes()) >> 20) << " MB for a "
+              << (incomingBytes >> 20) << " MB allocation, " << (getTotalBytes() >> 20) << " of "
+              << (getLimitBytes() >> 20) << " MB in use" << (fits ? "" : " (still over budget)") << std::endl;
+    return fits;
+}
+
+int64_t MemoryBudget::shed(int64_t bytesToFree)
+{
+    std::lock_guard<std::mutex> eviction(evictionLock);
+    const int64_t before = getTotalBytes();
+    for (const auto& evictor : getEvictors()) {
+        const int64_t missing = bytesToFree - (before - getTotalBytes());
+        if (missing <= 0) break;
+        evictor(missing);
+    }
+
+    const int64_t freed = before - getTotalBytes();
+    std::cout << "MemoryBudget: shed " << (freed >> 20) << " of " << (bytesToFree >> 20) << " MB asked for, "
+              << (getTotalBytes() >> 20) << " MB in use" << std::endl;
+    return freed;
+}
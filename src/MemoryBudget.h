@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * Where the app's RAM goes, per subsystem, and the Performance/MemoryLimitMB budget over all of it.
+ *
+ * Owners of large buffers report them into a pool: either through an Allocation member that
+ * follows the buffer's lifetime (copies count again, moves hand the bytes over), or with add()
+ * and release() for stores that track their own size. Counting is a relaxed atomic add, so it
+ * is fine on every thread except the audio callback, which never allocates anyway.
+ *
+ * Caches that can give memory back register an Evictor. Before a large allocation the owner
+ * calls makeRoom(): the evictors are asked, in registration order, to free their least recently
+ * used entries until the new buffer fits under the limit. Playing decks are never evicted; an
+ * allocation that still doesn't fit is the owner's call (the RAM decode streams instead). When
+ * the OS itself runs short, MemoryPressureMonitor asks the same evictors through shed().
+ * Preferences > Performance shows the live breakdown.
+ */
+class MemoryBudget {
+public:
+    enum class Pool {
+        DecodedTracks,   // InMemoryTrackReader samples
+        Waveforms,       // overview bins and zoom pyramids handed to the displays
+        Analysis,        // buffers of decode passes in flight (BPM / key / waveform summary)
+        Library,         // the library model's tracks, keys, cells and search index
+        Artwork,         // cover-art thumbnails in memory
+        GpuTextures,     // waveform textures uploaded by the GL displays
+        Stems,           // separated stems of the loaded tracks (StemTrackReader)
+        NumPools
+    };
+    static constexpr int NumPools = (int) Pool::NumPools;
+    static const char* getPoolName(Pool pool);
+
+    static MemoryBudget& getInstance();
+
+    // Any thread
+    void add(Pool pool, int64_t bytes) noexcept { pools[(size_t) pool].fetch_add(bytes, std::memory_order_relaxed); }
+    void release(Pool pool, int64_t bytes) noexcept { pools[(size_t) pool].fetch_sub(bytes, std::memory_order_relaxed); }
+    int64_t getBytes(Pool pool) const noexcept { return pools[(size_t) pool].load(std::memory_order_relaxed); }
+    int64_t getTotalBytes() const noexcept;
+
+    // Performance/MemoryLimitMB; set at startup and when the preferences are saved
+    void setLimitBytes(int64_t bytes) noexcept { limitBytes.store(bytes, std::memory_order_relaxed); }
+    int64_t getLimitBytes() const noexcept { return limitBytes.load(std::memory_order_relaxed); }
+    // Room left under the limit (negative when over it)
+    int64_t getAvailableBytes() const noexcept { return getLimitBytes() - getTotalBytes(); }
+
+    // Frees up to bytesToFree, least recently used first; returns what it freed. Called with
+    // no lock of the budget held, so it may report releases of its own.
+    using Evictor = std::function<int64_t(int64_t bytesToFree)>;
+    int addEvictor(Evictor evictor);
+    void removeEvictor(int id);
+
+    // Evicts until incomingBytes more fit under the limit; true if they do
+    bool makeRoom(int64_t incomingBytes);
+    // Evicts up to bytesToFree whatever the limit (the OS is short on memory, see
+    // MemoryPressureMonitor); returns what was freed
+    int64_t shed(int64_t bytesToFree);
+
+    // Counts `bytes` against a pool for as long as it lives
+    class Allocation {
+    public:
+        explicit Allocation(Pool pool, int64_t bytes = 0) noexcept : pool(pool) { resize(bytes); }
+        Allocation(const Allocation& other) noexcept : Allocation(other.pool, other.bytes) {}
+        Allocation(Allocation&& other) noexcept : pool(other.pool), bytes(std::exchange(other.bytes, 0)) {}
+        Allocation& operator=(const Allocation& other) noexcept
+        {
+            if (this != &other) { resize(0); pool = other.pool; resize(other.bytes); }
+            return *this;
+        }
+        Allocation& operator=(Allocation&& other) noexcept
+        {
+            if (this != &other) { resize(0); pool = other.pool; bytes = std::exchange(other.bytes, 0); }
+            return *this;
+        }
+        ~Allocation() { resize(0); }
+
+        void resize(int64_t newBytes) noexcept
+        {
+            if (newBytes != bytes) getInstance().add(pool, newBytes - bytes);
+            bytes = newBytes;
+        }
+        int64_t getBytes() const noexcept { return bytes; }
+
+    private:
+        Pool pool;
+        int64_t bytes{0};
+    };
+
+private:
+    MemoryBudget() = default;
+    // Copy of the registered evictors, in order, so none is called with evictorLock held
+    std::vector<Evictor> getEvictors();
+
+    std::array<std::atomic<int64_t>, NumPools> pools{};
+    std::atomic<int64_t> limitBytes{(int64_t) 1024 * 1024 * 1024};
+
+    std::mutex evictorLock;
+    std::vector<std::pair<int, Evictor>> evictors;
+    int nextEvictorId{1};
+    std::mutex evictionLock;   // one makeRoom() at a time
+};
@@ -0,0 +1,211 @@
+#include "MemoryPressureMonitor.h"
+#include "MemoryBudget.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+    const char* levelName(MemoryPressureMonitor::Level level)
+    {
+        switch (level) {
+            case MemoryPressureMonitor::Level::Normal: return "normal";
+            case MemoryPressureMonitor::Level::Warning: return "warning";
+            case MemoryPressureMonitor::Level::Critical: return "critical";
+        }
+        return "?";
+    }
+
+#if defined(__linux__)
+    // "full avg10" of a PSI file: the share of the last 10 s in which every task stalled on memory
+    double readFullAvg10(const std::string& path)
+    {
+        std::ifstream in(path);
+        for (std::string line; std::getline(in, line);) {
+            if (line.rfind("full ", 0) != 0) continue;
+            const size_t at = line.find("avg10=");
+            return at == std::string::npos ? 0.0 : std::atof(line.c_str() + at + 6);
+        }
+        return 0.0;
+    }
+#endif
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor() : juce::Thread("Memory Pressure")
+{
+#if defined(__APPLE__)
+    // The dispatch source needs no thread of ours; its handler runs on a private serial queue
+    auto* queue = dispatch_queue_create("pulsedj.memorypressure", DISPATCH_QUEUE_SERIAL);
+    auto source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                         DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN
+                                             | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                         queue);
+    dispatch_set_context(source, this);
+    dispatch_source_set_event_handler_f(source, &MemoryPressureMonitor::dispatchHandler);
+    dispatch_resume(source);
+    dispatchSource = source;
+    dispatchQueue = queue;
+#else
+    startThread(juce::Thread::Priority::low);
+#endif
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+#if defined(__APPLE__)
+    auto source = (dispatch_source_t) dispatchSource;
+    auto queue = (dispatch_queue_t) dispatchQueue;
+    dispatch_source_cancel(source);
+    // A handler already running finishes before the queue runs this
+    dispatch_sync_f(queue, nullptr, [](void*) {});
+    dispatch_release(source);
+    dispatch_release(queue);
+#else
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+#endif
+}
+
+void MemoryPressureMonitor::respond(Level newLevel)
+{
+    const Level previous = level.exchange(newLevel, std::memory_order_relaxed);
+    if (newLevel != previous)
+        std::cout << "MemoryPressureMonitor: " << levelName(previous) << " -> " << levelName(newLevel) << std::endl;
+    if (newLevel == Level::Normal) return;
+
+    // Rising pressure sheds at once; pressure that persists sheds again only after the cooldown
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    if (newLevel <= previous && nowMs - lastShedMs < CooldownMs) return;
+    lastShedMs = nowMs;
+
+    auto& budget = MemoryBudget::getInstance();
+    const int64_t cached = budget.getBytes(MemoryBudget::Pool::DecodedTracks) + budget.getBytes(MemoryBudget::Pool::Waveforms)
+                         + budget.getBytes(MemoryBudget::Pool::Artwork);
+    if (cached <= 0) return;
+    budget.shed(newLevel == Level::Critical ? cached : cached / 2);
+    shedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+#if defined(__APPLE__)
+void MemoryPressureMonitor::dispatchHandler(void* context)
+{
+    auto* self = static_cast<MemoryPressureMonitor*>(context);
+    const auto flags = dispatch_source_get_data((dispatch_source_t) self->dispatchSource);
+    self->respond((flags & DISPATCH_MEMORYPRESSURE_CRITICAL) != 0 ? Level::Critical
+                  : (flags & DISPATCH_MEMORYPRESSURE_WARN) != 0 ? Level::Warning : Level::Normal);
+}
+#endif
+
+#if defined(__linux__)
+int MemoryPressureMonitor::openPsiTrigger()
+{
+    // The process's own cgroup first (a memory.high or a container limit is hit long before the
+    // whole machine is short), then the system-wide file
+    std::vector<std::string> candidates;
+    std::ifstream cgroups("/proc/self/cgroup");
+    for (std::string line; std::getline(cgroups, line);)
+        if (line.rfind("0::/", 0) == 0 && line.size() > 4)
+            candidates.push_back("/sys/fs/cgroup" + line.substr(3) + "/memory.pressure");
+    candidates.push_back("/proc/pressure/memory");
+
+    const std::string trigger = "some " + std::to_string(PsiStallUs) + " " + std::to_string(PsiWindowUs);
+    for (const auto& path : candidates) {
+        const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) continue;
+        if (::write(fd, trigger.c_str(), trigger.size() + 1) >= 0) {
+            std::cout << "MemoryPressureMonitor: PSI trigger on " << path << std::endl;
+            psiPath = path;
+            return fd;
+        }
+        ::close(fd);
+    }
+    return -1;
+}
+
+void MemoryPressureMonitor::pollMemAvailable()
+{
+    std::ifstream in("/proc/meminfo");
+    juce::int64 totalKb = 0, availableKb = -1;
+    for (std::string line; std::getline(in, line);) {
+        std::istringstream fields(line);
+        std::string key;
+        juce::int64 value = 0;
+        fields >> key >> value;
+        if (key == "MemTotal:") totalKb = value;
+        else if (key == "MemAvailable:") availableKb = value;
+    }
+    if (totalKb <= 0 || availableKb < 0) return;
+    const double share = (double) availableKb / (double) totalKb;
+    respond(share < CriticalAvailableShare ? Level::Critical : share < WarningAvailableShare ? Level::Warning : Level::Normal);
+}
+#endif
+
+void MemoryPressureMonitor::run()
+{
+#if defined(__linux__)
+    const int fd = openPsiTrigger();
+    if (fd < 0) {
+        std::cout << "MemoryPressureMonitor: no PSI, polling MemAvailable" << std::endl;
+        while (!threadShouldExit()) {
+            pollMemAvailable();
+            wait(PollIntervalMs);
+        }
+        return;
+    }
+    // The trigger fires at most once per window while the stall lasts; a quiet window after
+    // the last one means the pressure is over
+    double lastEventMs = 0.0;
+    while (!threadShouldExit()) {
+        pollfd pfd{ fd, POLLPRI, 0 };
+        const int ready = ::poll(&pfd, 1, 250);   // short, so threadShouldExit() is seen
+        if (ready < 0 && errno != EINTR) break;
+        if (ready > 0 && (pfd.revents & POLLERR) != 0) {
+            std::cout << "MemoryPressureMonitor: PSI trigger gone (cgroup removed)" << std::endl;
+            break;
+        }
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        if (ready > 0 && (pfd.revents & POLLPRI) != 0) {
+            lastEventMs = nowMs;
+            // Every task stalled for a tenth of the time: the machine is thrashing
+            respond(readFullAvg10(psiPath) >= 10.0 ? Level::Critical : Level::Warning);
+        } else if (getLevel() != Level::Normal && nowMs - lastEventMs > 2.0 * PsiWindowUs / 1000.0) {
+            respond(Level::Normal);
+        }
+    }
+    ::close(fd);
+#elif defined(_WIN32)
+    HANDLE lowMemory = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    if (lowMemory == nullptr) {
+        std::cout << "MemoryPressureMonitor: no low-memory notification" << std::endl;
+        return;
+    }
+    while (!threadShouldExit()) {
+        // The notification stays signalled for as long as memory is low
+        if (WaitForSingleObject(lowMemory, 250) != WAIT_OBJECT_0) {
+            if (getLevel() != Level::Normal) respond(Level::Normal);
+            continue;
+        }
+        MEMORYSTATUSEX status{};
+        status.dwLength = sizeof(status);
+        const bool critical = GlobalMemoryStatusEx(&status) && status.ullTotalPhys > 0
+                              && (double) status.ullAvailPhys / (double) status.ullTotalPhys < CriticalAvailableShare;
+        respond(critical ? Level::Critical : Level::Warning);
+        wait(PollIntervalMs);
+    }
+    CloseHandle(lowMemory);
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <string>
+
+/**
+ * Gives cache memory back when the OS runs short, whatever the MemoryBudget limit says.
+ *
+ * The budget only limits what the app itself allocates. On a gig laptop a streaming encoder or
+ * a browser can take the memory the caches sit on, and the first sign of that is the OS paging
+ * the audio thread's data out. So this listens to the OS's own memory-pressure signal and sheds
+ * through MemoryBudget::shed(), which asks the same evictors makeRoom() does. They drop their
+ * least recently used entries first: HotTrackCache's RAM-decoded samples, then its overviews,
+ * then the artwork thumbnails. Pinned crate tracks are never evicted, and a loaded deck keeps
+ * its samples alive through its own reference.
+ *
+ *  - Linux: a PSI trigger on the process's cgroup v2 memory.pressure, else on
+ *    /proc/pressure/memory. Without PSI it falls back to polling MemAvailable.
+ *  - macOS: a dispatch memory-pressure source.
+ *  - Windows: the low-memory resource notification.
+ *
+ * Warning-level pressure sheds half of what the caches hold, critical pressure everything they
+ * can give up. A rise sheds at once; pressure that persists sheds again after CooldownMs.
+ */
+class MemoryPressureMonitor : private juce::Thread {
+public:
+    enum class Level { Normal, Warning, Critical };
+
+    static constexpr int CooldownMs = 5000;
+    // Linux PSI trigger: some task stalled on memory this long within each window
+    static constexpr int PsiStallUs = 150000;
+    static constexpr int PsiWindowUs = 2000000;   // unprivileged triggers need whole 2 s windows
+    // Without PSI: available memory, as a share of physical, that counts as pressure
+    static constexpr double WarningAvailableShare = 0.10;
+    static constexpr double CriticalAvailableShare = 0.04;
+    static constexpr int PollIntervalMs = 1000;
+
+    MemoryPressureMonitor();
+    ~MemoryPressureMonitor() override;
+
+    // Any thread: the last level reported, and how many times anything was shed
+    Level getLevel() const noexcept { return level.load(std::memory_order_relaxed); }
+    int getShedCount() const noexcept { return shedCount.load(std::memory_order_relaxed); }
+
+private:
+    void run() override;
+    // Monitor thread (or the dispatch queue): act on a pressure report
+    void respond(Level newLevel);
+
+#if defined(__linux__)
+    // The PSI file that accepted a trigger, opened for polling; -1 if none did
+    int openPsiTrigger();
+    void pollMemAvailable();
+    std::string psiPath;   // the file the trigger is armed on, read for its "full" share
+#endif
+#if defined(__APPLE__)
+    static void dispatchHandler(void* context);
+    void* dispatchSource{nullptr};   // dispatch_source_t
+    void* dispatchQueue{nullptr};    // dispatch_queue_t the handler runs on
+#endif
+
+    std::atomic<Level> level{Level::Normal};
+    std::atomic<int> shedCount{0};
+    double lastShedMs{-1.0e9};
+};
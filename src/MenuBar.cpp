@@ -3,6 +3,10 @@
 #include "PreferencesDialog.h"
 #include "AppConfig.h"
 #include "DeckSettings.h"
+#include "EventTrace.h"
+#include "FlightRecorder.h"
+#include "FrameTimeHud.h"
+#include "SharedCache.h"
 #include <QApplication>
 #include <QFileDialog>
 #include <QStandardPaths>
@@ -12,10 +16,13 @@
 #include <QJsonParseError>
 #include <QSettings>
 #include <QTimer>
+#include <QSignalBlocker>
 #include <QDesktopServices>
 #include <QUrl>
 #include <QFile>
 #include <QTextStream>
+#include <algorithm>
+#include <cmath>
 
 MenuBar::MenuBar(QtMainWindow* parent) 
     : QMenuBar(parent), mainWindow(parent), preferencesDialog(nullptr) {
@@ -98,6 +105,41 @@ void MenuBar::createMenuActions() {
     exportSettingsAction->setShortcut(QKeySequence::SaveAs);
     exportSettingsAction->setStatusTip("Export current settings to a file");
     
+    recordMixAction = new QAction("Record Mix", this);
+    recordMixAction->setStatusTip("Log every deck and mixer move so the set can be rendered to a file");
+    recordMixAction->setCheckable(true);
+
+    recordMasterAction = new QAction("Record Master Output...", this);
+    recordMasterAction->setStatusTip("Record the master output to WAV/FLAC while playing");
+    recordMasterAction->setCheckable(true);
+
+    recordMultitrackAction = new QAction("Record Multitrack...", this);
+    recordMultitrackAction->setStatusTip("Record every deck and the mic to separate WAV files while playing");
+    recordMultitrackAction->setCheckable(true);
+
+    streamMasterAction = new QAction("Stream Master Output", this);
+    streamMasterAction->setStatusTip("Stream the master output live to the Icecast server set in the preferences");
+    streamMasterAction->setCheckable(true);
+
+    renderMixAction = new QAction("Render Recorded Mix...", this);
+    renderMixAction->setStatusTip("Render the recorded mix to WAV/FLAC faster than real time");
+
+    exportAudioTimingAction = new QAction("Export Audio Timing...", this);
+    exportAudioTimingAction->setStatusTip("Save the last second of audio callback timing as JSON");
+
+    exportEventTraceAction = new QAction("Export Event Trace...", this);
+    exportEventTraceAction->setStatusTip("Save the recent load, analysis, paint and audio timeline for chrome://tracing or Perfetto");
+
+    saveFlightRecorderAction = new QAction("Save Flight Recorder", this);
+    saveFlightRecorderAction->setStatusTip("Write the last minute of audio callbacks, xruns and control changes to the logs folder");
+
+    calibrateLatencyAction = new QAction("Calibrate Latency...", this);
+    calibrateLatencyAction->setStatusTip("Measure the audio output latency over a loopback cable or microphone and align the waveforms to it");
+
+    autoDjAction = new QAction("Auto DJ", this);
+    autoDjAction->setStatusTip("Keep the music going: load a compatible track on the idle deck and mix it in on a phrase");
+    autoDjAction->setCheckable(true);
+
     exitAction = new QAction("Exit", this);
     exitAction->setShortcut(QKeySequence::Quit);
     exitAction->setStatusTip("Exit BetaPulseX");
@@ -123,14 +165,44 @@ void MenuBar::createMenuActions() {
     alwaysOnTopAction = new QAction("Always On Top", this);
     alwaysOnTopAction->setStatusTip("Keep window always on top");
     alwaysOnTopAction->setCheckable(true);
+
+    frameTimeHudAction = new QAction("Frame Time HUD", this);
+    frameTimeHudAction->setStatusTip("Show CPU and GPU frame time and dropped frames on every waveform view");
+    frameTimeHudAction->setCheckable(true);
+
+    masterScopeAction = new QAction("Master Scope", this);
+    masterScopeAction->setStatusTip("Show an oscilloscope, a goniometer and the phase correlation of the master output");
+    masterScopeAction->setCheckable(true);
     
     // Connect actions to slots
     connect(preferencesAction, &QAction::triggered, this, &MenuBar::showPreferences);
     connect(fullScreenAction, &QAction::triggered, this, &MenuBar::toggleFullScreen);
     connect(alwaysOnTopAction, &QAction::triggered, this, &MenuBar::toggleAlwaysOnTop);
+    connect(frameTimeHudAction, &QAction::toggled, this, [](bool enabled) { FrameTimeHud::setEnabled(enabled); });
+    connect(masterScopeAction, &QAction::toggled, this, [this](bool visible) { mainWindow->setMasterScopeVisible(visible); });
     connect(importSettingsAction, &QAction::triggered, this, &MenuBar::importSettings);
     connect(exportSettingsAction, &QAction::triggered, this, &MenuBar::exportSettings);
     connect(resetSettingsAction, &QAction::triggered, this, &MenuBar::resetSettings);
+    connect(recordMixAction, &QAction::toggled, this, [this](bool enabled) { mainWindow->setMixRecording(enabled); });
+    connect(recordMasterAction, &QAction::triggered, this, [this](bool enabled) {
+        // Unchecks itself again if the file dialog was cancelled or the file could not be opened
+        recordMasterAction->setChecked(mainWindow->setMasterRecording(enabled));
+    });
+    connect(recordMultitrackAction, &QAction::triggered, this, [this](bool enabled) {
+        recordMultitrackAction->setChecked(mainWindow->setMultitrackRecording(enabled));
+    });
+    connect(streamMasterAction, &QAction::triggered, this, [this](bool enabled) {
+        streamMasterAction->setChecked(mainWindow->setMasterStreaming(enabled));
+    });
+    connect(renderMixAction, &QAction::triggered, this, [this]() {
+        mainWindow->renderRecordedMix();
+        recordMixAction->setChecked(mainWindow->isMixRecording());
+    });
+    connect(exportAudioTimingAction, &QAction::triggered, this, &MenuBar::exportAudioTiming);
+    connect(exportEventTraceAction, &QAction::triggered, this, &MenuBar::exportEventTrace);
+    connect(saveFlightRecorderAction, &QAction::triggered, this, &MenuBar::saveFlightRecorder);
+    connect(calibrateLatencyAction, &QAction::triggered, this, [this]() { mainWindow->calibrateLatency(); });
+    connect(autoDjAction, &QAction::toggled, this, [this](bool enabled) { mainWindow->setAutoDj(enabled); });
     connect(exitAction, &QAction::triggered, mainWindow, &QWidget::close);
     connect(aboutAction, &QAction::triggered, this, &MenuBar::showAbout);
 }
@@ -141,6 +213,12 @@ void MenuBar::setupMenus() {
     fileMenu->addAction(importSettingsAction);
     fileMenu->addAction(exportSettingsAction);
     fileMenu->addSeparator();
+    fileMenu->addAction(recordMasterAction);
+    fileMenu->addAction(recordMultitrackAction);
+    fileMenu->addAction(streamMasterAction);
+    fileMenu->addAction(recordMixAction);
+    fileMenu->addAction(renderMixAction);
+    fileMenu->addSeparator();
     fileMenu->addAction(exitAction);
     
     // Edit menu
@@ -153,6 +231,14 @@ void MenuBar::setupMenus() {
     viewMenu = addMenu("View");
     viewMenu->addAction(fullScreenAction);
     viewMenu->addAction(alwaysOnTopAction);
+    viewMenu->addSeparator();
+    viewMenu->addAction(masterScopeAction);
+    viewMenu->addAction(frameTimeHudAction);
+    // The scope window can also be closed on its own
+    connect(viewMenu, &QMenu::aboutToShow, this, [this]() {
+        const QSignalBlocker blocker(masterScopeAction);
+        masterScopeAction->setChecked(mainWindow->isMasterScopeVisible());
+    });
     // ...existing code...
     // Tools menu
     toolsMenu = addMenu("Tools");
@@ -160,6 +246,29 @@ void MenuBar::setupMenus() {
     toolsMenu->addAction("MIDI Controllers")->setEnabled(false);
     toolsMenu->addSeparator();
     toolsMenu->addAction("Analyze Library")->setEnabled(false);
+    toolsMenu->addSeparator();
+    toolsMenu->addAction(exportAudioTimingAction);
+    toolsMenu->addAction(exportEventTraceAction);
+    toolsMenu->addAction(saveFlightRecorderAction);
+    toolsMenu->addSeparator();
+    QMenu* pluginMenu = toolsMenu->addMenu("Deck Plugins");
+    pluginMenu->addAction("Load Plugin on Deck A...", this, [this]() { mainWindow->loadDeckPlugin(0); });
+    pluginMenu->addAction("Load Plugin on Deck B...", this, [this]() { mainWindow->loadDeckPlugin(1); });
+    pluginMenu->addSeparator();
+    pluginMenu->addAction("Re-enable Bypassed Plugins", this, [this]() { mainWindow->reenableDeckPlugins(); });
+    pluginMenu->addAction("Remove Deck Plugins", this, [this]() {
+        mainWindow->removeDeckPlugin(0);
+        mainWindow->removeDeckPlugin(1);
+    });
+    toolsMenu->addSeparator();
+    toolsMenu->addAction(calibrateLatencyAction);
+    toolsMenu->addSeparator();
+    toolsMenu->addAction(autoDjAction);
+    // AutoDJ also turns itself off (a hand on the crossfader, nothing left to play)
+    connect(toolsMenu, &QMenu::aboutToShow, this, [this]() {
+        const QSignalBlocker blocker(autoDjAction);
+        autoDjAction->setChecked(mainWindow->isAutoDjEnabled());
+    });
     // Help menu
     helpMenu = addMenu("Help");
     helpMenu->addAction("User Manual")->setEnabled(false);
@@ -232,6 +341,20 @@ void MenuBar::setupSystemMonitoring() {
     
     cpuLabel = new QLabel("CPU");
     cpuLabel->setStyleSheet("color: #888; font-size: 8px;");
+
+    // DSP load: how much of each buffer period the audio callback needs (p99 over a second)
+    dspBar = new QProgressBar();
+    dspBar->setRange(0, 100);
+    dspBar->setValue(0);
+    dspBar->setFixedSize(30, 12);
+    dspBar->setTextVisible(true);
+    dspBar->setStyleSheet(
+        "QProgressBar { background: #333; border: none; border-radius: 2px; color: white; font-size: 8px; }"
+        "QProgressBar::chunk { background: #00aa00; border-radius: 2px; }"
+    );
+
+    dspLabel = new QLabel("DSP");
+    dspLabel->setStyleSheet("color: #888; font-size: 8px;");
     
     // RAM usage indicator
     ramBar = new QProgressBar();
@@ -272,6 +395,14 @@ void MenuBar::setupSystemMonitoring() {
     cpuLayout->addWidget(cpuBar);
     cpuLayout->addWidget(cpuLabel);
     systemLayout->addWidget(cpuWidget);
+
+    auto dspWidget = new QWidget();
+    auto dspLayout = new QVBoxLayout(dspWidget);
+    dspLayout->setContentsMargins(0, 0, 0, 0);
+    dspLayout->setSpacing(0);
+    dspLayout->addWidget(dspBar);
+    dspLayout->addWidget(dspLabel);
+    systemLayout->addWidget(dspWidget);
     
     auto ramWidget = new QWidget();
     auto ramLayout = new QVBoxLayout(ramWidget);
@@ -347,91 +478,148 @@ void MenuBar::setupSystemMonitoring() {
     setCornerWidget(systemWidget, Qt::TopRightCorner);
     
     // Setup system monitoring timer
+    statsSampler = std::make_unique<SystemStatsSampler>();
     systemTimer = new QTimer(this);
     connect(systemTimer, &QTimer::timeout, this, &MenuBar::updateSystemStats);
     systemTimer->start(2000); // Update every 2 seconds
+
+    meterTimer = new QTimer(this);
+    connect(meterTimer, &QTimer::timeout, this, &MenuBar::updateMeters);
+    meterTimer->start(50);
+
+    timingTimer = new QTimer(this);
+    connect(timingTimer, &QTimer::timeout, this, &MenuBar::updateAudioTiming);
+    timingTimer->start(1000);
 }
 
 void MenuBar::updateSystemStats() {
-    // Update CPU usage by reading /proc/stat
-    QFile cpuFile("/proc/stat");
-    if (cpuFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&cpuFile);
-        QString line = in.readLine();
-        if (line.startsWith("cpu ")) {
-            QStringList values = line.split(" ", Qt::SkipEmptyParts);
-            if (values.size() >= 5) {
-                static long long lastIdle = 0, lastTotal = 0;
-                long long idle = values[4].toLongLong();
-                long long total = 0;
-                for (int i = 1; i < values.size(); ++i) {
-                    total += values[i].toLongLong();
-                }
-                
-                if (lastTotal > 0) {
-                    long long totalDiff = total - lastTotal;
-                    long long idleDiff = idle - lastIdle;
-                    if (totalDiff > 0) {
-                        double cpuUsage = 100.0 * (totalDiff - idleDiff) / totalDiff;
-                        updateCpuUsage(cpuUsage);
-                    }
-                }
-                
-                lastIdle = idle;
-                lastTotal = total;
-            }
-        }
-        cpuFile.close();
+    // Nothing new since the last tick (the sampler runs on its own clock)
+    const auto stats = statsSampler->getSnapshot();
+    if (stats.rounds == shownStatsRound) return;
+    shownStatsRound = stats.rounds;
+
+    if (stats.systemCpuPercent >= 0.0f) updateCpuUsage(stats.systemCpuPercent);
+    QString cpuTip = stats.systemCpuPercent >= 0.0f ? QString("System CPU: %1%").arg(stats.systemCpuPercent, 0, 'f', 0)
+                                                    : QString("System CPU: unknown");
+    if (stats.processCpuPercent >= 0.0f)
+        cpuTip += QString("\nBetaPulseX: %1% of a core").arg(stats.processCpuPercent, 0, 'f', 1);
+    if (stats.audioThreadCpuPercent >= 0.0f)
+        cpuTip += QString("\nAudio thread: %1% of a core").arg(stats.audioThreadCpuPercent, 0, 'f', 1);
+    cpuLabel->parentWidget()->setToolTip(cpuTip);
+
+    if (stats.memoryUsedPercent >= 0.0f) updateRamUsage(stats.memoryUsedPercent);
+    ramLabel->parentWidget()->setToolTip(QString("BetaPulseX resident: %1 MB").arg(stats.processResidentBytes >> 20));
+
+    if (stats.batteryPercent >= 0) {
+        updateBatteryLevel(stats.batteryPercent, stats.charging);
+    } else {
+        // No battery found, set to 100% (desktop system)
+        updateBatteryLevel(100, false);
     }
-    
-    // Update RAM usage - force to 62% until we fix the real calculation
-    updateRamUsage(62.0);
-    
-    // Update battery level by reading battery capacity
-    QFile batteryCapacityFile("/sys/class/power_supply/BAT0/capacity");
-    if (batteryCapacityFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&batteryCapacityFile);
-        int batteryLevel = in.readLine().trimmed().toInt();
-        
-        // Check charging status
-        QFile batteryStatusFile("/sys/class/power_supply/BAT0/status");
-        bool isCharging = false;
-        if (batteryStatusFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream statusIn(&batteryStatusFile);
-            QString status = statusIn.readLine().trimmed();
-            isCharging = (status == "Charging");
-            batteryStatusFile.close();
-        }
-        
-        updateBatteryLevel(batteryLevel, isCharging);
-        batteryCapacityFile.close();
+    if (mainWindow) mainWindow->setOnBattery(stats.onBattery);
+}
+
+void MenuBar::updateMeters() {
+    if (!mainWindow) return;
+    const auto levels = mainWindow->getMasterLevelMonitor().getSnapshot();
+    updateMasterLevels(MasterLevelMonitor::toMeterScale(levels.rms[0]),
+                       MasterLevelMonitor::toMeterScale(levels.rms[1]));
+    // Inter-sample overs show up in the tooltip, where the bars have no room for a clip LED
+    const float truePeak = std::max(levels.truePeak[0], levels.truePeak[1]);
+    const float truePeakDb = truePeak > 0.000001f ? 20.0f * std::log10(truePeak) : -120.0f;
+    masterLeftBar->parentWidget()->setToolTip(QString("Master true peak: %1 dBTP").arg(truePeakDb, 0, 'f', 1));
+}
+
+void MenuBar::updateAudioTiming() {
+    if (!mainWindow) return;
+    const auto report = mainWindow->takeCallbackReport();
+    lastAudioTimingJson = QString::fromStdString(report.toJson().toStdString());
+    if (report.callback.count == 0) {
+        dspBar->setValue(0);
+        dspBar->setFormat("--");
+        dspLabel->parentWidget()->setToolTip("Audio callback not running");
+        return;
+    }
+
+    const int load = static_cast<int>(std::lround(report.loadP99Percent));
+    dspBar->setValue(std::min(load, 100));
+    dspBar->setFormat(QString("%1%").arg(load));
+    // Above ~70% of the period a slow block is one scheduling hiccup away from a dropout
+    const QString color = report.loadMaxPercent >= 100.0 ? "#ff4444" : report.loadP99Percent >= 70.0 ? "#ffaa00" : "#00aa00";
+    dspBar->setStyleSheet(
+        QString("QProgressBar { background: #333; border: none; border-radius: 2px; color: white; font-size: 8px; }"
+                "QProgressBar::chunk { background: %1; border-radius: 2px; }").arg(color)
+    );
+
+    auto us = [](double value) { return QString::number(value, 'f', 0); };
+    QString tip = QString("Audio callback, %1 ms buffer: avg %2 / p99 %3 / max %4 us (%5% / %6% / %7%)")
+                      .arg(report.bufferMs, 0, 'f', 1)
+                      .arg(us(report.callback.avgUs), us(report.callback.p99Us), us(report.callback.maxUs))
+                      .arg(report.loadAvgPercent, 0, 'f', 0)
+                      .arg(report.loadP99Percent, 0, 'f', 0)
+                      .arg(report.loadMaxPercent, 0, 'f', 0);
+    tip += QString("\nMix: p99 %1 us").arg(us(report.mix.p99Us));
+    if (report.cueUnderruns >= 0)
+        tip += QString("\nCue device: p99 %1 us, drift %2 ppm, %3 ms buffered, %4 underruns")
+                   .arg(us(report.cueOutput.p99Us))
+                   .arg(report.cueDriftPpm, 0, 'f', 1)
+                   .arg(report.cueBufferedMs, 0, 'f', 1)
+                   .arg(report.cueUnderruns);
+    for (int d = 0; d < report.numDecks; ++d) {
+        const auto& deck = report.decks[(size_t) d];
+        auto p99 = [&](CallbackProfiler::DeckStage stage) { return us(deck[(size_t) stage].p99Us); };
+        tip += QString("\nDeck %1: p99 %2 us (decode %3, resample/keylock %4, EQ %5)")
+                   .arg(d + 1)
+                   .arg(p99(CallbackProfiler::DeckStage::Total), p99(CallbackProfiler::DeckStage::Decode),
+                        p99(CallbackProfiler::DeckStage::Stretch), p99(CallbackProfiler::DeckStage::Eq));
+    }
+    tip += QString("\nOverruns: %1, late callbacks: %2").arg(report.overruns).arg(report.lateCallbacks);
+    if (report.deviceXruns >= 0) tip += QString(", driver xruns: %1").arg(report.deviceXruns);
+    dspLabel->parentWidget()->setToolTip(tip);
+}
+
+void MenuBar::exportAudioTiming() {
+    if (lastAudioTimingJson.isEmpty()) {
+        QMessageBox::information(this, "Export Audio Timing", "No audio timing has been measured yet.");
+        return;
+    }
+    // Taken now so the file holds the window the tooltip was showing
+    const QString json = lastAudioTimingJson;
+    QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/BetaPulseX_AudioTiming.json";
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Audio Timing", defaultPath, "JSON Files (*.json)");
+    if (fileName.isEmpty()) return;
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(json.toUtf8());
+        file.close();
     } else {
-        // Try BAT1 if BAT0 doesn't exist
-        QFile batteryCapacityFile1("/sys/class/power_supply/BAT1/capacity");
-        if (batteryCapacityFile1.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream in(&batteryCapacityFile1);
-            int batteryLevel = in.readLine().trimmed().toInt();
-            
-            QFile batteryStatusFile1("/sys/class/power_supply/BAT1/status");
-            bool isCharging = false;
-            if (batteryStatusFile1.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QTextStream statusIn(&batteryStatusFile1);
-                QString status = statusIn.readLine().trimmed();
-                isCharging = (status == "Charging");
-                batteryStatusFile1.close();
-            }
-            
-            updateBatteryLevel(batteryLevel, isCharging);
-            batteryCapacityFile1.close();
-        } else {
-            // No battery found, set to 100% (desktop system)
-            updateBatteryLevel(100, false);
-        }
+        QMessageBox::warning(this, "Export Failed",
+            QString("Failed to write audio timing to:\n%1").arg(fileName));
+    }
+}
+
+void MenuBar::exportEventTrace() {
+    QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/BetaPulseX_Trace.json";
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Event Trace", defaultPath, "JSON Files (*.json)");
+    if (fileName.isEmpty()) return;
+
+    if (!EventTrace::exportChromeJson(juce::File(fileName.toStdString()))) {
+        QMessageBox::warning(this, "Export Failed",
+            QString("Failed to write the event trace to:\n%1").arg(fileName));
+    }
+}
+
+void MenuBar::saveFlightRecorder() {
+    const auto file = FlightRecorder::dump("on demand");
+    if (file.existsAsFile()) {
+        QMessageBox::information(this, "Flight Recorder Saved",
+            QString("The last minute of audio timing and controls was written to:\n%1")
+                .arg(QString::fromStdString(file.getFullPathName().toStdString())));
+    } else {
+        QMessageBox::warning(this, "Save Failed",
+            QString("Failed to write the flight recorder to:\n%1").arg(AppConfig::instance().getLogsDirectory()));
     }
-    
-    // TODO: Connect to actual audio output levels from DJAudioPlayer
-    // For now, show 0% until proper audio monitoring is implemented
-    updateMasterLevels(0.0, 0.0);
 }
 
 void MenuBar::showPreferences() {
@@ -441,6 +629,18 @@ void MenuBar::showPreferences() {
         // Connect settings change signal
         connect(preferencesDialog, &PreferencesDialog::settingsChanged, [this]() {
             qDebug() << "BetaPulseX: Settings changed, reloading configuration";
+            if (mainWindow) mainWindow->refreshPowerProfile();
+            if (mainWindow) mainWindow->refreshLibraryView();
+            if (mainWindow) mainWindow->refreshDeckViews();
+            if (mainWindow) mainWindow->applyAudioDeviceSettings();
+            if (mainWindow) mainWindow->applyPluginSettings();
+            {
+                QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+                const QString sharedCache = prefs.value("Library/SharedCachePath", "").toString();
+                SharedCache::setRoot(sharedCache.isEmpty() ? juce::File() : juce::File(sharedCache.toStdString()));
+                FlightRecorder::configure(juce::File(AppConfig::instance().getLogsDirectory().toStdString()),
+                                          prefs.value("Advanced/CrashReporting", true).toBool());
+            }
             // Emit signal to main window or handle configuration reload
         });
     }
@@ -461,7 +661,7 @@ void MenuBar::exportSettings() {
         QJsonObject jsonObj;
         
         // Export all settings groups
-        QStringList groups = {"Audio", "Decks", "Interface", "Library", "Performance", "Advanced"};
+        QStringList groups = {"Audio", "Decks", "Interface", "Library", "Performance", "Plugins", "Advanced"};
         
         for (const QString& group : groups) {
             config.beginGroup(group);
@@ -536,7 +736,7 @@ void MenuBar::importSettings() {
             QSettings config(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
             
             // Import settings groups
-            QStringList groups = {"Audio", "Decks", "Interface", "Library", "Performance", "Advanced"};
+            QStringList groups = {"Audio", "Decks", "Interface", "Library", "Performance", "Plugins", "Advanced"};
             
             for (const QString& group : groups) {
                 if (jsonObj.contains(group)) {
@@ -13,6 +13,8 @@
 #include <QTimer>
 #include <QFile>
 #include <QTextStream>
+#include <memory>
+#include "SystemStatsSampler.h"
 
 class QtMainWindow;
 class PreferencesDialog;
@@ -37,6 +39,11 @@ public:
 
 private slots:
     void updateSystemStats();
+    void updateMeters();
+    void updateAudioTiming();
+    void exportAudioTiming();
+    void exportEventTrace();
+    void saveFlightRecorder();
     void showPreferences();
     void exportSettings();
     void importSettings();
@@ -66,6 +73,18 @@ private:
     QAction* importSettingsAction;
     QAction* exportSettingsAction;
     QAction* resetSettingsAction;
+    QAction* recordMixAction;
+    QAction* renderMixAction;
+    QAction* recordMasterAction;
+    QAction* recordMultitrackAction;
+    QAction* streamMasterAction;
+    QAction* exportAudioTimingAction;
+    QAction* exportEventTraceAction;
+    QAction* saveFlightRecorderAction;
+    QAction* calibrateLatencyAction;
+    QAction* autoDjAction;
+    QAction* frameTimeHudAction;
+    QAction* masterScopeAction;
     QAction* exitAction;
     QAction* aboutAction;
     QAction* fullScreenAction;
@@ -81,14 +100,23 @@ private:
     QProgressBar* masterLeftBar;
     QProgressBar* masterRightBar;
     QProgressBar* cpuBar;
+    QProgressBar* dspBar;   // audio callback p99 as a share of the buffer period
     QProgressBar* ramBar;
     QProgressBar* batteryBar;
     QLabel* cpuLabel;
+    QLabel* dspLabel;
     QLabel* ramLabel;
     QLabel* batteryLabel;
 
+    // Reads /proc and the battery off the UI thread; systemTimer only shows its snapshot
+    std::unique_ptr<SystemStatsSampler> statsSampler;
+    juce::uint32 shownStatsRound{0};
+
     // System monitoring timer
     QTimer* systemTimer;
+    QTimer* meterTimer;   // Master Out bars, polls the mixer's meter snapshot
+    QTimer* timingTimer;  // DSP bar, one callback profiler window per tick
+    QString lastAudioTimingJson;
 
     // Preferences dialog
     PreferencesDialog* preferencesDialog;
@@ -0,0 +1,102 @@
+#include "MicChannel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    float coeffFor(double ms, double sampleRate) noexcept
+    {
+        return (float) std::exp(-1000.0 / (ms * sampleRate));
+    }
+}
+
+void MicChannel::prepare(double rate, int maximumBlockSize)
+{
+    sampleRate = rate > 0.0 ? rate : 44100.0;
+    signal.assign((size_t) std::max(1, maximumBlockSize), 0.0f);
+    duckGains.assign(signal.size(), 1.0f);
+    eq.prepare(sampleRate);
+    envelopeRelease = coeffFor(EnvelopeReleaseMs, sampleRate);
+    duckAttack = coeffFor(DuckAttackMs, sampleRate);
+    duckRelease = coeffFor(DuckReleaseMs, sampleRate);
+    currentGain = 0.0f;
+    envelope = 0.0f;
+    duckGain = 1.0f;
+    blockSamples = 0;
+    audible = ducking = false;
+}
+
+void MicChannel::setEq(float high, float mid, float low)
+{
+    eqHigh.store(juce::jlimit(-1.0f, 1.0f, high), std::memory_order_relaxed);
+    eqMid.store(juce::jlimit(-1.0f, 1.0f, mid), std::memory_order_relaxed);
+    eqLow.store(juce::jlimit(-1.0f, 1.0f, low), std::memory_order_relaxed);
+}
+
+void MicChannel::process(const float* input, int numSamples) noexcept
+{
+    // A block bigger than announced keeps the music and drops the mic
+    blockSamples = numSamples <= (int) signal.size() ? numSamples : 0;
+    const bool enabled = enabledTarget.load(std::memory_order_relaxed) && input != nullptr;
+    const float target = enabled ? juce::Decibels::decibelsToGain(gainDb.load(std::memory_order_relaxed)) : 0.0f;
+    if (!enabled && currentGain == 0.0f) eq.reset();
+    audible = blockSamples > 0 && input != nullptr && (target > 0.0f || currentGain > 0.0f);
+
+    float blockPeak = 0.0f;
+    if (audible) {
+        // Level ramped across the block, so switching on or turning the knob doesn't click
+        const float step = (target - currentGain) / (float) blockSamples;
+        float gain = currentGain;
+        for (int i = 0; i < blockSamples; ++i) {
+            gain += step;
+            signal[(size_t) i] = input[i] * gain;
+        }
+        currentGain = target;
+        eq.setTargets(eqHigh.load(std::memory_order_relaxed), eqMid.load(std::memory_order_relaxed),
+                      eqLow.load(std::memory_order_relaxed), 0.0);
+        eq.process(signal.data(), nullptr, blockSamples);
+        blockPeak = juce::FloatVectorOperations::findMaximum(signal.data(), blockSamples);
+        blockPeak = std::max(blockPeak, -juce::FloatVectorOperations::findMinimum(signal.data(), blockSamples));
+    } else {
+        currentGain = target;
+    }
+    peak.store(blockPeak, std::memory_order_relaxed);
+
+    // Talkover: duck while the envelope says somebody speaks, recover slowly once they stop
+    const bool talk = audible && talkover.load(std::memory_order_relaxed);
+    if (!talk && duckGain >= 1.0f) {
+        envelope = 0.0f;
+        ducking = false;
+        duckGainDb.store(0.0f, std::memory_order_relaxed);
+        return;
+    }
+    const float threshold = juce::Decibels::decibelsToGain(DuckThresholdDb);
+    const float depth = juce::Decibels::decibelsToGain(duckDb.load(std::memory_order_relaxed));
+    for (int i = 0; i < blockSamples; ++i) {
+        const float level = talk ? std::abs(signal[(size_t) i]) : 0.0f;
+        envelope = level > envelope ? level : envelope * envelopeRelease;
+        const bool speaking = envelope > threshold;
+        const float targetGain = speaking ? depth : 1.0f;
+        const float coeff = targetGain < duckGain ? duckAttack : duckRelease;
+        duckGain = targetGain + (duckGain - targetGain) * coeff;
+        if (!speaking && duckGain > 0.9999f) duckGain = 1.0f;
+        duckGains[(size_t) i] = duckGain;
+    }
+    ducking = blockSamples > 0;
+    duckGainDb.store(juce::Decibels::gainToDecibels(duckGain), std::memory_order_relaxed);
+}
+
+void MicChannel::applyDuck(float* const* channels, int numChannels, int numSamples) const noexcept
+{
+    if (!ducking || numSamples != blockSamples) return;
+    for (int ch = 0; ch < numChannels; ++ch)
+        if (channels[ch] != nullptr)
+            juce::FloatVectorOperations::multiply(channels[ch], duckGains.data(), numSamples);
+}
+
+void MicChannel::addTo(float* const* channels, int numChannels, int numSamples, float gain) const noexcept
+{
+    if (!audible || numSamples != blockSamples || gain <= 0.0f) return;
+    for (int ch = 0; ch < numChannels; ++ch)
+        if (channels[ch] != nullptr)
+            juce::FloatVectorOperations::addWithMultiply(channels[ch], signal.data(), gain, numSamples);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "DeckEqProcessor.h"
+
+/**
+ * Microphone channel strip: one device input with gain, the decks' 3-band EQ and talkover.
+ *
+ * DeckMixer hands the input block to process() at the top of the callback and mixes the result
+ * into the same callback's output, so the mic is one device buffer (plus the driver's own
+ * latency) behind the voice, no more. By default it joins the music before master volume and
+ * the limiter; with direct monitoring it bypasses both and is added after the limiter, so the
+ * lookahead doesn't delay it either. The meter, the recorder and the stream get it in both cases.
+ *
+ * Talkover: an envelope follower on the processed mic (instant attack, EnvelopeReleaseMs)
+ * decides whether somebody is speaking; while it is above DuckThresholdDb the music bus ducks
+ * to the talkover depth over DuckAttackMs and comes back over DuckReleaseMs once it falls
+ * below. The gain is computed per sample in process() and applied by the mixer to the summed
+ * decks and sampler, before the mic is added.
+ *
+ * Level, EQ and switches are atomics set from any thread; an on/off change ramps over one block.
+ */
+class MicChannel {
+public:
+    static constexpr float MinGainDb = -24.0f;
+    static constexpr float MaxGainDb = 12.0f;
+    static constexpr float DefaultDuckDb = -12.0f;     // Mic/TalkoverDuckDb
+    static constexpr float DuckThresholdDb = -40.0f;
+    static constexpr float EnvelopeReleaseMs = 150.0f;
+    static constexpr float DuckAttackMs = 15.0f;
+    static constexpr float DuckReleaseMs = 500.0f;
+
+    // Device thread, before the first block
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    // Any thread
+    void setEnabled(bool enabled) { enabledTarget.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabledTarget.load(std::memory_order_relaxed); }
+    void setGainDb(float db) { gainDb.store(juce::jlimit(MinGainDb, MaxGainDb, db), std::memory_order_relaxed); }
+    // Knobs -1..+1, as DeckEqProcessor takes them
+    void setEq(float high, float mid, float low);
+    void setTalkover(bool enabled) { talkover.store(enabled, std::memory_order_relaxed); }
+    bool isTalkover() const { return talkover.load(std::memory_order_relaxed); }
+    void setDuckDb(float db) { duckDb.store(juce::jlimit(-60.0f, 0.0f, db), std::memory_order_relaxed); }
+    void setDirectMonitor(bool direct) { directMonitor.store(direct, std::memory_order_relaxed); }
+    bool isDirectMonitor() const { return directMonitor.load(std::memory_order_relaxed); }
+    // Peak of the last block after gain and EQ, and how far the music is ducked (dB, <= 0)
+    float getPeak() const { return peak.load(std::memory_order_relaxed); }
+    float getDuckGainDb() const { return duckGainDb.load(std::memory_order_relaxed); }
+
+    // Audio thread: run the input block (nullptr: the input isn't open) through the strip and
+    // the envelope follower
+    void process(const float* input, int numSamples) noexcept;
+    // Audio thread, after process(): duck the music bus in place, then add the mic to it
+    void applyDuck(float* const* channels, int numChannels, int numSamples) const noexcept;
+    void addTo(float* const* channels, int numChannels, int numSamples, float gain) const noexcept;
+    // Audio thread, after process(): the block's mic after gain and EQ (mono), nullptr when silent
+    const float* getSignal(int numSamples) const noexcept
+    {
+        return audible && numSamples == blockSamples ? signal.data() : nullptr;
+    }
+
+private:
+    double sampleRate{44100.0};
+    DeckEqProcessor eq;
+    std::vector<float> signal;      // this block's mic, mono
+    std::vector<float> duckGains;   // this block's music gain per sample
+    int blockSamples{0};
+    bool audible{false};            // signal holds something to add
+    bool ducking{false};            // duckGains holds something other than unity
+
+    // Audio thread
+    float currentGain{0.0f};
+    float envelope{0.0f};
+    float duckGain{1.0f};
+    float envelopeRelease{0.0f}, duckAttack{0.0f}, duckRelease{0.0f};
+
+    std::atomic<bool> enabledTarget{false};
+    std::atomic<float> gainDb{0.0f};
+    std::atomic<float> eqHigh{0.0f}, eqMid{0.0f}, eqLow{0.0f};
+    std::atomic<bool> talkover{false};
+    std::atomic<float> duckDb{DefaultDuckDb};
+    std::atomic<bool> directMonitor{false};
+    std::atomic<float> peak{0.0f};
+    std::atomic<float> duckGainDb{0.0f};
+};
@@ -0,0 +1,181 @@
+#include "MidiClockOutput.h"
+#include "DeckMixer.h"
+#include "ThreadingPolicy.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Song Position and Continue go out this long before the pulse they start the receiver on
+    constexpr juce::int64 RestartLeadNs = 1000000;
+    // Longest coarse sleep, so a tempo change is seen well within a pulse
+    constexpr int MaxSleepMs = 10;
+    // Share of each new pulse in the average jitter, and the peak's decay per pulse
+    constexpr double JitterSmoothing = 0.01;
+    constexpr double PeakDecay = 0.999;
+    constexpr juce::uint32 LogIntervalMs = 60000;
+}
+
+MidiClockOutput::MidiClockOutput()
+    : juce::Thread("MIDI Clock")
+{
+}
+
+MidiClockOutput::~MidiClockOutput()
+{
+    stop();
+}
+
+juce::StringArray MidiClockOutput::getDeviceNames()
+{
+    juce::StringArray names;
+    for (const auto& info : juce::MidiOutput::getAvailableDevices()) names.add(info.name);
+    return names;
+}
+
+bool MidiClockOutput::start(const juce::String& deviceName, double leadMs)
+{
+    stop();
+    for (const auto& info : juce::MidiOutput::getAvailableDevices()) {
+        if (info.name != deviceName && info.identifier != deviceName) continue;
+        output = juce::MidiOutput::openDevice(info.identifier);
+        break;
+    }
+    if (!output) {
+        std::cout << "MidiClockOutput: could not open " << deviceName << std::endl;
+        return false;
+    }
+
+    setLeadMs(leadMs);
+    published.store(NetworkTempoSync::Timeline{});
+    jitterMs.store(0.0);
+    maxJitterMs.store(0.0);
+    pulses.store(0);
+    const auto options = juce::Thread::RealtimeOptions{}.withPriority(ThreadingPolicy::getInstance().getRenderPriority());
+    if (!startRealtimeThread(options)) {
+        std::cout << "MidiClockOutput: realtime priority unavailable, using high priority" << std::endl;
+        startThread(juce::Thread::Priority::highest);
+    }
+    std::cout << "MidiClockOutput: clock to " << output->getName() << ", " << leadMs << " ms lead" << std::endl;
+    return true;
+}
+
+void MidiClockOutput::stop()
+{
+    // run() sends Stop on its way out
+    signalThreadShouldExit();
+    stopThread(1000);
+    output.reset();
+    running.store(false);
+    bpm.store(0.0);
+}
+
+MidiClockOutput::Status MidiClockOutput::getStatus() const
+{
+    Status status;
+    status.open = output != nullptr;
+    if (output) status.deviceName = output->getName();
+    status.running = running.load(std::memory_order_relaxed);
+    status.bpm = bpm.load(std::memory_order_relaxed);
+    status.jitterMs = jitterMs.load(std::memory_order_relaxed);
+    status.maxJitterMs = maxJitterMs.load(std::memory_order_relaxed);
+    status.pulses = pulses.load(std::memory_order_relaxed);
+    return status;
+}
+
+void MidiClockOutput::send(const juce::MidiMessage& message)
+{
+    output->sendMessageNow(message);
+}
+
+bool MidiClockOutput::waitUntil(juce::uint64 dueNs)
+{
+    const juce::uint64 now = DeckMixer::nowNs();
+    if (dueNs <= now) return true;
+    const juce::int64 coarseNs = (juce::int64) (dueNs - now) - (juce::int64) (SpinMs * 1.0e6);
+    if (coarseNs >= 1000000) {
+        wait(std::min(MaxSleepMs, (int) (coarseNs / 1000000)));
+        return false;
+    }
+    while (DeckMixer::nowNs() < dueNs) {
+        if (threadShouldExit()) return false;
+    }
+    return true;
+}
+
+void MidiClockOutput::notePulse(juce::int64 lateNs)
+{
+    const double late = (double) std::max<juce::int64>(0, lateNs) / 1.0e6;
+    const double average = jitterMs.load(std::memory_order_relaxed);
+    jitterMs.store(average + JitterSmoothing * (late - average), std::memory_order_relaxed);
+    maxJitterMs.store(std::max(late, maxJitterMs.load(std::memory_order_relaxed) * PeakDecay), std::memory_order_relaxed);
+    pulses.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MidiClockOutput::run()
+{
+    bool started = false;
+    juce::int64 next = 0;   // the pulse to send next, counted from the timeline's beat 0
+    juce::uint32 nextLog = juce::Time::getMillisecondCounter() + LogIntervalMs;
+
+    while (!threadShouldExit()) {
+        const NetworkTempoSync::Timeline timeline = published.load();
+        const juce::uint64 now = DeckMixer::nowNs();
+        // The timeline is stamped with when its block is heard, ahead of now by the output latency
+        const bool live = timeline.valid && timeline.bpm > 0.0
+                          && (juce::int64) now - (juce::int64) timeline.timeNs < (juce::int64) StaleMs * 1000000;
+        if (!live) {
+            if (started) {
+                send(juce::MidiMessage::midiStop());
+                started = false;
+                running.store(false);
+            }
+            bpm.store(0.0);
+            wait(2);
+            continue;
+        }
+        bpm.store(timeline.bpm, std::memory_order_relaxed);
+
+        const juce::int64 lead = leadNs.load(std::memory_order_relaxed);
+        // Sent `lead` before pulse k's beat is heard
+        const auto dueOf = [&](juce::int64 k) {
+            const double t = (double) timeline.timeNs + ((double) k / PulsesPerBeat - timeline.beat) * 60.0e9 / timeline.bpm - (double) lead;
+            return (juce::uint64) std::max(0.0, t);
+        };
+        const double pulseNow = timeline.beatAt((juce::uint64) std::max<juce::int64>(0, (juce::int64) now + lead)) * PulsesPerBeat;
+
+        if (started && std::abs(pulseNow - (double) next) > PulsesPerBeat) {
+            // A seek or a new master: the receiver is put on the new position below
+            send(juce::MidiMessage::midiStop());
+            started = false;
+            running.store(false);
+        }
+        if (!started) {
+            // From the next sixteenth (there is no position before the grid's first beat)
+            const juce::int64 first = (juce::int64) std::ceil(std::max(0.0, pulseNow) / PulsesPerSixteenth) * PulsesPerSixteenth;
+            const juce::uint64 due = dueOf(first);
+            if (!waitUntil(due > (juce::uint64) RestartLeadNs ? due - (juce::uint64) RestartLeadNs : 0)) continue;
+            send(juce::MidiMessage::songPositionPointer((int) (first / PulsesPerSixteenth)));
+            send(first == 0 ? juce::MidiMessage::midiStart() : juce::MidiMessage::midiContinue());
+            next = first;
+            started = true;
+            running.store(true);
+            continue;
+        }
+
+        // A pulse that is already due (the master jumped ahead by less than a beat) goes out at once
+        const juce::uint64 due = dueOf(next);
+        if (!waitUntil(due)) continue;
+        send(juce::MidiMessage::midiClock());
+        notePulse((juce::int64) DeckMixer::nowNs() - (juce::int64) due);
+        ++next;
+
+        if ((juce::int32) (juce::Time::getMillisecondCounter() - nextLog) >= 0) {
+            nextLog += LogIntervalMs;
+            std::cout << "MidiClockOutput: " << timeline.bpm << " bpm, jitter " << jitterMs.load() * 1000.0
+                      << " us average, " << maxJitterMs.load() * 1000.0 << " us peak" << std::endl;
+        }
+    }
+
+    if (started) send(juce::MidiMessage::midiStop());
+}
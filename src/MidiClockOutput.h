@@ -0,0 +1,78 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include "LockFreeQueue.h"
+#include "NetworkTempoSync.h"
+
+/**
+ * MIDI beat clock for lighting desks and drum machines: 24 clock pulses per beat of the sync
+ * master, with Start/Continue/Stop and a Song Position Pointer so the receiver knows which
+ * sixteenth it is on.
+ *
+ * DeckMixer publishes the master's timeline every block from applyBeatSync, the same one a
+ * leading NetworkTempoSync gets (the LAN session's when following): bpm and beat at the host
+ * time the block starts to be heard. This thread turns that into the DeckMixer::nowNs() moment
+ * each pulse is due and sends it then, so a pulse comes out when its beat leaves the speakers;
+ * the device output latency is already in the timeline. The lead setting moves every pulse
+ * earlier by the receiver's own latency (positive) or later (negative).
+ *
+ * Pulses are timed against the clock, not counted off a period: the thread waits in coarse
+ * sleeps until SpinMs before a pulse, re-reading the timeline after each, and spins out the
+ * rest, which keeps the jitter well below a millisecond on a realtime thread. A tempo change
+ * moves the next pulse; a jump under a beat sends the pulses in between at once, a larger one
+ * (a seek, a new master) repositions the receiver with Stop, Song Position and Continue at the
+ * next sixteenth. A stopped master (or none) sends Stop.
+ */
+class MidiClockOutput : private juce::Thread {
+public:
+    static constexpr int PulsesPerBeat = 24;
+    static constexpr int PulsesPerSixteenth = PulsesPerBeat / 4;
+    static constexpr double SpinMs = 1.5;
+    // A timeline older than this means the audio device stopped calling back
+    static constexpr int StaleMs = 250;
+
+    struct Status {
+        bool open{false};
+        bool running{false};        // the receiver has been started
+        juce::String deviceName;
+        double bpm{0.0};
+        double jitterMs{0.0};       // average lateness of a pulse against its due time
+        double maxJitterMs{0.0};    // decaying peak of the same
+        juce::int64 pulses{0};
+    };
+
+    MidiClockOutput();
+    ~MidiClockOutput() override;
+
+    // UI thread: opens the MIDI output whose name or identifier is `deviceName` (Sync/MidiClock)
+    // and starts the clock thread; false if there is no such device
+    bool start(const juce::String& deviceName, double leadMs);
+    void stop();
+    bool isOpen() const { return output != nullptr; }
+    // Sync/MidiClockLeadMs: how much earlier than the audio a pulse is sent
+    void setLeadMs(double ms) { leadNs.store((juce::int64) (ms * 1.0e6)); }
+    Status getStatus() const;
+    static juce::StringArray getDeviceNames();
+
+    // Audio thread: the sync master's timeline (valid = false while it stands)
+    void publishTimeline(const NetworkTempoSync::Timeline& timeline) noexcept { published.store(timeline); }
+
+private:
+    void run() override;
+    void send(const juce::MidiMessage& message);
+    // Waits until `dueNs`; false if the timeline should be read again first (or the thread exits)
+    bool waitUntil(juce::uint64 dueNs);
+    void notePulse(juce::int64 lateNs);
+
+    std::unique_ptr<juce::MidiOutput> output;
+    SeqlockValue<NetworkTempoSync::Timeline> published;   // audio thread -> clock thread
+    std::atomic<juce::int64> leadNs{0};
+
+    std::atomic<bool> running{false};
+    std::atomic<double> bpm{0.0};
+    std::atomic<double> jitterMs{0.0};
+    std::atomic<double> maxJitterMs{0.0};
+    std::atomic<juce::int64> pulses{0};
+};
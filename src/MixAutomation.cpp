@@ -0,0 +1,166 @@
+#include "MixAutomation.h"
+#include "FlightRecorder.h"
+#include <iostream>
+
+void MixAutomation::setFrameClock(std::function<juce::int64()> clock)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    frameClock = std::move(clock);
+}
+
+void MixAutomation::startRecording(double deviceSampleRate, int deviceBlockSize)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        events.clear();
+        events.reserve(16384);
+        startMs = juce::Time::getMillisecondCounterHiRes();
+        startFrame = frameClock ? frameClock() : -1;
+        sampleRate = startFrame >= 0 ? deviceSampleRate : 0.0;
+        blockSize = startFrame >= 0 ? deviceBlockSize : 0;
+    }
+    recording.store(true);
+    std::cout << "MixAutomation: recording started" << std::endl;
+}
+
+void MixAutomation::stopRecording()
+{
+    if (!recording.load()) return;
+    record(-1, Kind::End);
+    recording.store(false);
+    std::cout << "MixAutomation: recording stopped, " << getEvents().size() << " events, "
+              << getDurationSeconds() << " s" << std::endl;
+}
+
+void MixAutomation::record(int deck, Kind kind, double value, double value2, int commandType,
+                           const juce::String& path)
+{
+    // Deck commands reach the flight recorder from DJAudioPlayer, controller moves included
+    if (kind != Kind::DeckCommand) FlightRecorder::control(deck, getKindName(kind), value, value2);
+    if (!recording.load(std::memory_order_relaxed)) return;
+
+    Event e;
+    e.deck = deck;
+    e.kind = kind;
+    e.commandType = commandType;
+    e.value = value;
+    e.value2 = value2;
+    e.path = path;
+
+    std::lock_guard<std::mutex> guard(lock);
+    e.timeSec = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+    if (startFrame >= 0) {
+        const juce::int64 now = frameClock();
+        // -1 while the device is closed
+        if (now >= startFrame) e.frame = now - startFrame;
+    }
+    events.push_back(std::move(e));
+}
+
+const char* MixAutomation::getKindName(Kind kind) noexcept
+{
+    switch (kind) {
+        case Kind::LoadTrack: return "LoadTrack";
+        case Kind::Play: return "Play";
+        case Kind::Pause: return "Pause";
+        case Kind::DeckCommand: return "DeckCommand";
+        case Kind::ChannelGain: return "ChannelGain";
+        case Kind::Crossfader: return "Crossfader";
+        case Kind::MasterVolume: return "MasterVolume";
+        case Kind::End: return "End";
+    }
+    return "?";
+}
+
+std::vector<MixAutomation::Event> MixAutomation::getEvents() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return events;
+}
+
+double MixAutomation::getDurationSeconds() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return events.empty() ? 0.0 : events.back().timeSec;
+}
+
+bool MixAutomation::isEmpty() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return events.empty();
+}
+
+double MixAutomation::getSampleRate() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return sampleRate;
+}
+
+int MixAutomation::getBlockSize() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return blockSize;
+}
+
+bool MixAutomation::saveToFile(const juce::File& file) const
+{
+    juce::Array<juce::var> list;
+    for (const auto& e : getEvents()) {
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("t", e.timeSec);
+        if (e.frame >= 0) obj->setProperty("f", e.frame);
+        obj->setProperty("deck", e.deck);
+        obj->setProperty("kind", (int) e.kind);
+        obj->setProperty("cmd", e.commandType);
+        obj->setProperty("v", e.value);
+        obj->setProperty("v2", e.value2);
+        if (e.path.isNotEmpty()) obj->setProperty("path", e.path);
+        list.add(juce::var(obj));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("version", 2);
+    if (getSampleRate() > 0.0) {
+        root->setProperty("sampleRate", getSampleRate());
+        root->setProperty("blockSize", getBlockSize());
+    }
+    root->setProperty("events", list);
+    if (!file.replaceWithText(juce::JSON::toString(juce::var(root), true))) {
+        std::cout << "MixAutomation: failed to write " << file.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MixAutomation::loadFromFile(const juce::File& file)
+{
+    const juce::var root = juce::JSON::parse(file);
+    const auto* list = root.getProperty("events", juce::var()).getArray();
+    if (list == nullptr) {
+        std::cout << "MixAutomation: no events in " << file.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+
+    std::vector<Event> loaded;
+    loaded.reserve((size_t) list->size());
+    for (const auto& item : *list) {
+        Event e;
+        e.timeSec = item.getProperty("t", 0.0);
+        e.frame = (juce::int64) item.getProperty("f", -1);
+        e.deck = item.getProperty("deck", -1);
+        e.kind = (Kind) (int) item.getProperty("kind", (int) Kind::End);
+        e.commandType = item.getProperty("cmd", 0);
+        e.value = item.getProperty("v", 0.0);
+        e.value2 = item.getProperty("v2", 0.0);
+        e.path = item.getProperty("path", juce::String()).toString();
+        loaded.push_back(std::move(e));
+    }
+
+    recording.store(false);
+    std::lock_guard<std::mutex> guard(lock);
+    events = std::move(loaded);
+    sampleRate = root.getProperty("sampleRate", 0.0);
+    blockSize = root.getProperty("blockSize", 0);
+    startFrame = -1;
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * Timestamped log of everything that shapes a mix: track loads, play/pause, every deck control
+ * command and the mixer faders.
+ *
+ * Recorded live from the UI thread (DJAudioPlayer::postCommand is the single funnel for deck
+ * controls, the mixer controls are logged by QtMainWindow). OfflineMixRenderer replays the log
+ * into fresh players at block boundaries, just like the audio thread applied the commands live.
+ *
+ * With a frame clock set (the live DeckMixer's frame counter), every event also carries the
+ * audio frame it took effect at, and the log records the device's sample rate and block size.
+ * SessionReplay uses those to apply each event at exactly the block it hit live, so a set
+ * recorded at a gig replays deterministically (DavidBench --replay).
+ */
+class MixAutomation {
+public:
+    enum class Kind {
+        LoadTrack,      // path = audio file
+        Play,
+        Pause,
+        DeckCommand,    // commandType = DJAudioPlayer::Command::Type, value/value2 as posted
+        ChannelGain,    // value = 0..1
+        Crossfader,     // value = -1..+1
+        MasterVolume,   // value = 0..1
+        End             // recording stopped; sets the length of the render
+    };
+
+    struct Event {
+        double timeSec{0.0};    // since startRecording()
+        juce::int64 frame{-1};  // audio frames since startRecording(); -1 without a frame clock
+        int deck{-1};           // -1 for mixer-wide events
+        Kind kind{Kind::End};
+        int commandType{0};
+        double value{0.0};
+        double value2{0.0};
+        juce::String path;
+    };
+
+    // UI thread. Frames rendered by the audio device so far, counting the block in progress
+    // (the first frame a command posted now can be heard at); -1 while no device runs.
+    void setFrameClock(std::function<juce::int64()> clock);
+
+    // UI thread. Starting clears the previous log; pass the running device's format (0 = none).
+    void startRecording(double deviceSampleRate = 0.0, int deviceBlockSize = 0);
+    void stopRecording();
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // UI thread; ignored while not recording (the FlightRecorder gets the mixer events anyway)
+    void record(int deck, Kind kind, double value = 0.0, double value2 = 0.0, int commandType = 0,
+                const juce::String& path = {});
+
+    // "LoadTrack", ... for logs and reports
+    static const char* getKindName(Kind kind) noexcept;
+
+    std::vector<Event> getEvents() const;
+    double getDurationSeconds() const;
+    bool isEmpty() const;
+    // Device format at startRecording() (or from the loaded file); 0 if unknown
+    double getSampleRate() const;
+    int getBlockSize() const;
+
+    // JSON, so a recorded set can be rendered again later
+    bool saveToFile(const juce::File& file) const;
+    bool loadFromFile(const juce::File& file);
+
+private:
+    mutable std::mutex lock;
+    std::vector<Event> events;
+    double startMs{0.0};
+    std::function<juce::int64()> frameClock;
+    juce::int64 startFrame{-1};
+    double sampleRate{0.0};
+    int blockSize{0};
+    std::atomic<bool> recording{false};
+};
@@ -0,0 +1,188 @@
+#include "Mp3FrameIndex.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'M', 'P', '3', 'I', '\0' };
+    // How far to look for the next frame after junk between frames
+    constexpr size_t MaxResyncBytes = 65536;
+
+    struct FrameHeader {
+        int versionBits{0};   // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+        int layer{0};
+        int sampleRate{0};
+        int numChannels{0};
+        int length{0};        // bytes, header included
+        int samplesPerFrame{0};
+
+        bool sameStreamAs(const FrameHeader& other) const {
+            return versionBits == other.versionBits && layer == other.layer && sampleRate == other.sampleRate;
+        }
+    };
+
+    bool parseHeader(const juce::uint8* p, FrameHeader& h) {
+        if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+        const int versionBits = (p[1] >> 3) & 3;
+        const int layerBits = (p[1] >> 1) & 3;
+        const int bitrateIndex = p[2] >> 4;
+        const int rateIndex = (p[2] >> 2) & 3;
+        if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+            return false;
+
+        static constexpr short bitrates[5][14] = {
+            { 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },   // MPEG-1 layer I
+            { 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },      // MPEG-1 layer II
+            { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },       // MPEG-1 layer III
+            { 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },      // MPEG-2/2.5 layer I
+            { 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },           // MPEG-2/2.5 layer II, III
+        };
+        static constexpr int baseRates[3] = { 44100, 48000, 32000 };
+
+        const bool mpeg1 = versionBits == 3;
+        h.versionBits = versionBits;
+        h.layer = 4 - layerBits;
+        h.sampleRate = baseRates[rateIndex] >> (mpeg1 ? 0 : versionBits == 2 ? 1 : 2);
+        h.numChannels = ((p[3] >> 6) & 3) == 3 ? 1 : 2;
+
+        const int table = mpeg1 ? h.layer - 1 : (h.layer == 1 ? 3 : 4);
+        const int bitrate = bitrates[table][bitrateIndex - 1] * 1000;
+        const int padding = (p[2] >> 1) & 1;
+        if (h.layer == 1) {
+            h.samplesPerFrame = 384;
+            h.length = (12 * bitrate / h.sampleRate + padding) * 4;
+        } else if (h.layer == 3 && !mpeg1) {
+            h.samplesPerFrame = 576;
+            h.length = 72 * bitrate / h.sampleRate + padding;
+        } else {
+            h.samplesPerFrame = 1152;
+            h.length = 144 * bitrate / h.sampleRate + padding;
+        }
+        return h.length > 4;
+    }
+
+    // A header at pos, confirmed by another one of the same stream right after it (or the end)
+    bool isFrameAt(const juce::uint8* data, size_t size, size_t pos, FrameHeader& h, const FrameHeader* reference) {
+        if (pos + 4 > size || !parseHeader(data + pos, h)) return false;
+        if (reference != nullptr && !h.sameStreamAs(*reference)) return false;
+        const size_t next = pos + (size_t) h.length;
+        if (next + 4 > size) return next <= size;
+        FrameHeader following;
+        return parseHeader(data + next, following) && following.sameStreamAs(h);
+    }
+
+    size_t skipId3v2(const juce::uint8* data, size_t size) {
+        size_t pos = 0;
+        // Some taggers write more than one tag
+        while (pos + 10 <= size && std::memcmp(data + pos, "ID3", 3) == 0) {
+            const juce::uint8* p = data + pos;
+            if (((p[6] | p[7] | p[8] | p[9]) & 0x80) != 0) break;
+            const size_t tagSize = ((size_t) p[6] << 21) | ((size_t) p[7] << 14) | ((size_t) p[8] << 7) | (size_t) p[9];
+            pos += 10 + tagSize + ((p[5] & 0x10) != 0 ? 10 : 0);
+        }
+        return pos;
+    }
+
+    // LAME/Xing info frame: no audio, JUCE's decoder skips it as well
+    bool isInfoFrame(const juce::uint8* data, size_t size, size_t pos, const FrameHeader& h) {
+        if (h.layer != 3) return false;
+        const size_t sideInfo = h.versionBits == 3 ? (h.numChannels == 1 ? 17 : 32) : (h.numChannels == 1 ? 9 : 17);
+        const size_t tag = pos + 4 + sideInfo;
+        if (tag + 4 > size) return false;
+        return std::memcmp(data + tag, "Xing", 4) == 0 || std::memcmp(data + tag, "Info", 4) == 0;
+    }
+}
+
+bool Mp3FrameIndex::build(const void* dataPointer, size_t size)
+{
+    offsets.clear();
+    const auto* data = static_cast<const juce::uint8*>(dataPointer);
+    if (data == nullptr || size > 0xffffffffu) return false;
+
+    // First frame: the first header confirmed by the one after it
+    size_t pos = skipId3v2(data, size);
+    FrameHeader first;
+    const size_t searchEnd = std::min(size, pos + MaxResyncBytes);
+    while (pos < searchEnd && !isFrameAt(data, size, pos, first, nullptr)) ++pos;
+    if (pos >= searchEnd) return false;
+
+    sampleRate = first.sampleRate;
+    numChannels = first.numChannels;
+    samplesPerFrame = first.samplesPerFrame;
+    offsets.reserve(size / (size_t) first.length + 16);
+    if (isInfoFrame(data, size, pos, first)) pos += (size_t) first.length;
+
+    FrameHeader h;
+    while (pos + 4 <= size) {
+        if (!parseHeader(data + pos, h) || !h.sameStreamAs(first)) {
+            // Junk or a trailing tag (ID3v1, APE): carry on at the next confirmed frame, if any
+            const size_t end = std::min(size, pos + MaxResyncBytes);
+            while (pos < end && !isFrameAt(data, size, pos, h, &first)) ++pos;
+            if (pos >= end) break;
+        }
+        if (pos + (size_t) h.length > size) break;   // truncated last frame
+        offsets.push_back((juce::uint32) pos);
+        pos += (size_t) h.length;
+    }
+    return !offsets.empty();
+}
+
+bool Mp3FrameIndex::store(const juce::File& directory, const juce::File& audioFile) const
+{
+    if (offsets.empty() || !directory.isDirectory()) return false;
+
+    juce::MemoryOutputStream out;
+    out.write(Magic, sizeof(Magic));
+    out.writeInt((int) Version);
+    out.writeString(audioFile.getFullPathName());
+    out.writeInt64(audioFile.getSize());
+    out.writeInt64(audioFile.getLastModificationTime().toMilliseconds());
+    out.writeInt(sampleRate);
+    out.writeInt(numChannels);
+    out.writeInt(samplesPerFrame);
+    out.writeInt((int) offsets.size());
+    for (juce::uint32 offset : offsets) out.writeInt((int) offset);
+
+    const juce::File target = directory.getChildFile(juce::String::toHexString(audioFile.getFullPathName().hashCode64()) + ".mpi");
+    juce::TemporaryFile temp(target);
+    if (!temp.getFile().replaceWithData(out.getData(), out.getDataSize()) || !temp.overwriteTargetFileWithTemporary()) {
+        std::cout << "Mp3FrameIndex: failed to write " << target.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Mp3FrameIndex::load(const juce::File& directory, const juce::File& audioFile)
+{
+    const juce::File cacheFile = directory.getChildFile(juce::String::toHexString(audioFile.getFullPathName().hashCode64()) + ".mpi");
+    if (!cacheFile.existsAsFile()) return false;
+
+    juce::MemoryBlock data;
+    if (!cacheFile.loadFileAsData(data) || data.getSize() < sizeof(Magic) + 4) return false;
+    juce::MemoryInputStream in(data, false);
+    char magic[sizeof(Magic)];
+    in.read(magic, sizeof(magic));
+    if (std::memcmp(magic, Magic, sizeof(Magic)) != 0 || in.readInt() != (int) Version) return false;
+    if (in.readString() != audioFile.getFullPathName()) return false;
+    const juce::int64 fileSize = audioFile.getSize();
+    if (in.readInt64() != fileSize) return false;
+    if (in.readInt64() != audioFile.getLastModificationTime().toMilliseconds()) return false;
+
+    const int rate = in.readInt();
+    const int channels = in.readInt();
+    const int frameSamples = in.readInt();
+    const int count = in.readInt();
+    if (rate <= 0 || channels < 1 || channels > 2 || frameSamples <= 0 || count <= 0
+        || (juce::int64) count * 4 > in.getNumBytesRemaining())
+        return false;
+
+    std::vector<juce::uint32> loaded((size_t) count);
+    for (auto& offset : loaded) {
+        offset = (juce::uint32) in.readInt();
+        if ((juce::int64) offset >= fileSize) return false;
+    }
+    offsets = std::move(loaded);
+    sampleRate = rate;
+    numChannels = channels;
+    samplesPerFrame = frameSamples;
+    return true;
+}
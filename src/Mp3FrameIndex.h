@@ -0,0 +1,41 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+ * Byte offset of every audio frame of an MP3 file, from a walk over the frame headers (nothing
+ * is decoded; a few milliseconds per track once the file is in the page cache).
+ *
+ * Frame 0 is the first frame of audio: a LAME/Xing "Info" frame in front is not counted, the
+ * same way JUCE's decoder skips it, so sample positions agree with JUCE's reader. The length
+ * is exact for VBR files without an info frame too, where JUCE can only estimate it. Free
+ * formats (no bitrate in the header) are not indexed.
+ *
+ * Cached per track in a directory of its own, keyed and validated like the BpmCache.
+ */
+class Mp3FrameIndex {
+public:
+    static constexpr juce::uint32 Version = 1;
+
+    // False if the data doesn't look like MPEG audio
+    bool build(const void* data, size_t size);
+
+    bool store(const juce::File& directory, const juce::File& audioFile) const;
+    // False on any mismatch (missing, stale, other version)
+    bool load(const juce::File& directory, const juce::File& audioFile);
+
+    bool isEmpty() const { return offsets.empty(); }
+    int getNumFrames() const { return (int) offsets.size(); }
+    juce::int64 getFrameOffset(int frame) const { return (juce::int64) offsets[(size_t) frame]; }
+    int getSamplesPerFrame() const { return samplesPerFrame; }
+    juce::int64 getTotalSamples() const { return (juce::int64) offsets.size() * samplesPerFrame; }
+    int getSampleRate() const { return sampleRate; }
+    int getNumChannels() const { return numChannels; }
+
+private:
+    std::vector<juce::uint32> offsets;
+    int samplesPerFrame{1152};
+    int sampleRate{0};
+    int numChannels{0};
+};
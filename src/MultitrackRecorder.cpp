@@ -0,0 +1,228 @@
+#include "MultitrackRecorder.h"
+#include <iostream>
+
+MultitrackRecorder::MultitrackRecorder()
+{
+}
+
+MultitrackRecorder::~MultitrackRecorder()
+{
+    stop();
+    writerThread.stopThread(2000);
+}
+
+bool MultitrackRecorder::start(const juce::File& directory, const juce::String& baseName, double sampleRate,
+                               int numDecks, bool includeMic, bool flac, int bitsPerSample)
+{
+    stop();
+    if (sampleRate <= 0.0) {
+        std::cout << "MultitrackRecorder: no running device, cannot record" << std::endl;
+        return false;
+    }
+    numDecks = juce::jlimit(0, MaxDecks, numDecks);
+    if (numDecks == 0 && !includeMic) return false;
+    if (!directory.createDirectory()) {
+        std::cout << "MultitrackRecorder: cannot create " << directory.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    juce::FlacAudioFormat flacFormat;
+    juce::AudioFormat& format = flac ? static_cast<juce::AudioFormat&>(flacFormat) : wavFormat;
+    const int bits = flac ? std::min(bitsPerSample, 24) : bitsPerSample;
+    const juce::String extension = flac ? ".flac" : ".wav";
+
+    // Everything the audio thread touches is sized here, before it is armed
+    const int fifoSamples = (int) std::ceil(sampleRate * FifoSeconds);
+    for (auto& track : tracks)
+        track.file = juce::File();
+    for (int t = 0; t < MaxTracks; ++t) {
+        const bool isMic = t == MicTrack;
+        if (isMic ? !includeMic : t >= numDecks) continue;
+
+        Track& track = tracks[(size_t) t];
+        track.numChannels = isMic ? 1 : 2;
+        track.file = directory.getChildFile(baseName + (isMic ? juce::String(" Mic") : " Deck " + juce::String(t + 1)) + extension);
+        track.file.deleteFile();
+        // A large stream buffer: the writer hands each file a whole chunk at a time
+        auto stream = track.file.createOutputStream(StreamBufferBytes);
+        if (stream != nullptr)
+            track.writer.reset(format.createWriterFor(stream.get(), sampleRate, (unsigned int) track.numChannels, bits, {}, 0));
+        if (track.writer == nullptr) {
+            std::cout << "MultitrackRecorder: cannot write " << track.file.getFullPathName().toStdString() << std::endl;
+            closeAll();
+            return false;
+        }
+        stream.release();   // owned by the writer now
+        track.fifo = std::make_unique<juce::AbstractFifo>(fifoSamples);
+        track.buffer.setSize(track.numChannels, fifoSamples, false, true, false);
+        track.pushed = false;
+        track.used = true;
+    }
+
+    currentDirectory = directory;
+    recordingSampleRate = sampleRate;
+    chunkSamples = (int) (sampleRate * ChunkSeconds);
+    samplesPerFlush = (int) (sampleRate * 30.0);   // every header rewrite is a seek per file
+    samplesSinceFlush = 0;
+    blockSamples = 0;
+    samplesWritten.store(0);
+    droppedSamples.store(0);
+    overflowCount.store(0);
+
+    if (!writerThread.isThreadRunning())
+        writerThread.startThread(juce::Thread::Priority::normal);
+    writerThread.addTimeSliceClient(this);
+    armed.store(true);
+
+    std::cout << "MultitrackRecorder: recording " << numDecks << " deck(s)" << (includeMic ? " and the mic" : "")
+              << " to " << directory.getFullPathName().toStdString() << " (" << sampleRate << " Hz, " << bits
+              << " bit, FIFO " << FifoSeconds << " s per track)" << std::endl;
+    return true;
+}
+
+void MultitrackRecorder::stop()
+{
+    if (!armed.exchange(false)) return;
+
+    // Wait out a block that began before armed was cleared (at most one block)
+    while (audioThreadInside.load())
+        juce::Thread::yield();
+
+    writerThread.removeTimeSliceClient(this);
+    while (drain(true) == 0) {}
+    closeAll();
+
+    std::cout << "MultitrackRecorder: stopped, " << getRecordedSeconds() << " s written";
+    if (overflowCount.load() > 0)
+        std::cout << ", " << overflowCount.load() << " overflows (" << droppedSamples.load() << " samples dropped)";
+    std::cout << std::endl;
+}
+
+void MultitrackRecorder::closeAll()
+{
+    for (auto& track : tracks) {
+        track.writer.reset();   // writes the final header and closes the file
+        track.fifo.reset();
+        track.used = false;
+    }
+}
+
+bool MultitrackRecorder::beginBlock(int numSamples) noexcept
+{
+    audioThreadInside.store(true);
+    blockSamples = 0;
+    if (!armed.load() || numSamples <= 0) {
+        audioThreadInside.store(false);
+        return false;
+    }
+    // All tracks or none, so the files stay aligned
+    for (auto& track : tracks) {
+        if (track.used && track.fifo->getFreeSpace() < numSamples) {
+            droppedSamples.fetch_add(numSamples, std::memory_order_relaxed);
+            overflowCount.fetch_add(1, std::memory_order_relaxed);
+            audioThreadInside.store(false);
+            return false;
+        }
+    }
+    blockSamples = numSamples;
+    return true;
+}
+
+void MultitrackRecorder::push(int track, const float* const* channels, int numChannels, int numSamples, float gain) noexcept
+{
+    if (blockSamples == 0 || track < 0 || track >= MaxTracks || numSamples != blockSamples) return;
+    Track& t = tracks[(size_t) track];
+    if (!t.used || t.pushed) return;
+    if (channels == nullptr || numChannels <= 0 || gain <= 0.0f) return writeSilence(t, numSamples);
+
+    int start1, size1, start2, size2;
+    t.fifo->prepareToWrite(numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < t.numChannels; ++ch) {
+        const float* src = channels[std::min(ch, numChannels - 1)];
+        if (src == nullptr) {
+            t.buffer.clear(ch, start1, size1);
+            if (size2 > 0) t.buffer.clear(ch, start2, size2);
+            continue;
+        }
+        t.buffer.copyFrom(ch, start1, src, size1, gain);
+        if (size2 > 0) t.buffer.copyFrom(ch, start2, src + size1, size2, gain);
+    }
+    t.fifo->finishedWrite(size1 + size2);
+    t.pushed = true;
+}
+
+void MultitrackRecorder::writeSilence(Track& track, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    track.fifo->prepareToWrite(numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < track.numChannels; ++ch) {
+        track.buffer.clear(ch, start1, size1);
+        if (size2 > 0) track.buffer.clear(ch, start2, size2);
+    }
+    track.fifo->finishedWrite(size1 + size2);
+    track.pushed = true;
+}
+
+void MultitrackRecorder::endBlock() noexcept
+{
+    if (blockSamples > 0) {
+        for (auto& track : tracks) {
+            if (track.used && !track.pushed) writeSilence(track, blockSamples);
+            track.pushed = false;
+        }
+        blockSamples = 0;
+    }
+    audioThreadInside.store(false);
+}
+
+int MultitrackRecorder::useTimeSlice()
+{
+    return drain(false);
+}
+
+int MultitrackRecorder::drain(bool all)
+{
+    // Returns 0 while there is more to write, otherwise the ms to sleep before polling again.
+    // Every track gets the same count, the least any of them holds, so the files grow in step.
+    int ready = -1;
+    for (auto& track : tracks) {
+        if (!track.used || track.fifo == nullptr || track.writer == nullptr) continue;
+        const int trackReady = track.fifo->getNumReady();
+        ready = ready < 0 ? trackReady : std::min(ready, trackReady);
+    }
+    if (ready <= 0) return 50;
+    if (!all && ready < chunkSamples) return 50;
+
+    for (auto& track : tracks) {
+        if (!track.used || track.fifo == nullptr || track.writer == nullptr) continue;
+        int start1, size1, start2, size2;
+        track.fifo->prepareToRead(ready, start1, size1, start2, size2);
+        track.writer->writeFromAudioSampleBuffer(track.buffer, start1, size1);
+        if (size2 > 0)
+            track.writer->writeFromAudioSampleBuffer(track.buffer, start2, size2);
+        track.fifo->finishedRead(size1 + size2);
+    }
+    samplesWritten.fetch_add(ready, std::memory_order_relaxed);
+
+    samplesSinceFlush += ready;
+    if (samplesSinceFlush >= samplesPerFlush) {
+        samplesSinceFlush = 0;
+        for (auto& track : tracks)
+            if (track.used && track.writer != nullptr) track.writer->flush();
+    }
+    return 0;
+}
+
+double MultitrackRecorder::getRecordedSeconds() const
+{
+    return recordingSampleRate > 0.0 ? (double) samplesWritten.load() / recordingSampleRate : 0.0;
+}
+
+juce::Array<juce::File> MultitrackRecorder::getFiles() const
+{
+    juce::Array<juce::File> files;
+    for (const auto& track : tracks)
+        if (track.file != juce::File()) files.add(track.file);
+    return files;
+}
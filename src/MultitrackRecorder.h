@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+
+/**
+ * Records every deck strip and the mic to files of their own while playing, for re-mixing a
+ * set afterwards.
+ *
+ * DeckMixer taps each strip after its channel fader and crossfader (before master volume and
+ * the limiter) and the mic after its gain and EQ. Every track has its own FIFO, sized when the
+ * recording starts, and the audio thread only copies into them, as MasterRecorder does. One
+ * TimeSliceThread drains all of them: it waits until every track holds ChunkSeconds and then
+ * writes that chunk to each file in turn, so a disk with eight files open still sees a few
+ * large sequential writes per second instead of one small write per file per block.
+ *
+ * All files stay sample-aligned: a block is taken for every track or for none (beginBlock()
+ * checks every FIFO first), and a track the mixer has nothing for in a block (a deck added
+ * after the start, no mic this block) gets silence. A block dropped because a FIFO is full is
+ * counted in getDroppedSamples() and missing from every file alike.
+ */
+class MultitrackRecorder : private juce::TimeSliceClient {
+public:
+    static constexpr int MaxDecks = 8;   // DeckMixer::MaxChannels
+    static constexpr int MicTrack = MaxDecks;
+    static constexpr int MaxTracks = MaxDecks + 1;
+    static constexpr double FifoSeconds = 10.0;
+    static constexpr double ChunkSeconds = 1.0;
+    static constexpr int StreamBufferBytes = 1 << 20;
+
+    MultitrackRecorder();
+    ~MultitrackRecorder() override;
+
+    // UI thread. Writes <baseName> Deck 1.wav ... and <baseName> Mic.wav (mono) into directory,
+    // FLAC if flac is set. The sample rate must be the running device's.
+    bool start(const juce::File& directory, const juce::String& baseName, double sampleRate, int numDecks,
+               bool includeMic, bool flac = false, int bitsPerSample = 24);
+    void stop();
+    bool isRecording() const { return armed.load(); }
+
+    // Audio thread, once per block: beginBlock() says whether this block is recorded; push()
+    // each track that has something (channels nullptr or gain 0: silence), then endBlock()
+    bool beginBlock(int numSamples) noexcept;
+    void push(int track, const float* const* channels, int numChannels, int numSamples, float gain) noexcept;
+    void endBlock() noexcept;
+
+    // Any thread
+    double getRecordedSeconds() const;
+    juce::int64 getDroppedSamples() const { return droppedSamples.load(std::memory_order_relaxed); }
+    int getOverflowCount() const { return overflowCount.load(std::memory_order_relaxed); }
+    juce::File getDirectory() const { return currentDirectory; }
+    juce::Array<juce::File> getFiles() const;
+    double getSampleRate() const { return recordingSampleRate; }
+
+private:
+    struct Track {
+        bool used{false};
+        int numChannels{2};
+        juce::File file;
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        std::unique_ptr<juce::AbstractFifo> fifo;
+        juce::AudioBuffer<float> buffer;
+        bool pushed{false};   // audio thread: written in the current block
+    };
+
+    int useTimeSlice() override;
+    // Writes what every track has; all: also less than a chunk (at stop)
+    int drain(bool all);
+    void writeSilence(Track& track, int numSamples) noexcept;
+    void closeAll();
+
+    juce::TimeSliceThread writerThread{"MultitrackRecorderWriter"};
+    std::array<Track, MaxTracks> tracks;
+    juce::File currentDirectory;
+    double recordingSampleRate{0.0};
+    int chunkSamples{0};
+    int samplesPerFlush{0};
+    int samplesSinceFlush{0};
+
+    // Same handshake as MasterRecorder, held from beginBlock() to endBlock()
+    std::atomic<bool> armed{false};
+    std::atomic<bool> audioThreadInside{false};
+    int blockSamples{0};   // audio thread: the accepted block's length, 0 when not recording it
+
+    std::atomic<juce::int64> samplesWritten{0};
+    std::atomic<juce::int64> droppedSamples{0};
+    std::atomic<int> overflowCount{0};
+
+    JUCE_DECLARE_NON_COPYABLE(MultitrackRecorder)
+};
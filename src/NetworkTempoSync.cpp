@@ -0,0 +1,270 @@
+#include "NetworkTempoSync.h"
+#include "DeckMixer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'S', 'Y', 'N', 'C', '\0' };
+    constexpr int HeaderSize = (int) sizeof(Magic) + 1 + 8;
+    // Round trips longer than this say nothing useful about the clock offset
+    constexpr juce::int64 MaxRoundTripNs = 500000000;
+
+    bool due(juce::uint32 now, juce::uint32 at) { return (juce::int32) (now - at) >= 0; }
+}
+
+NetworkTempoSync::NetworkTempoSync()
+    : juce::Thread("Network Tempo Sync"), id((juce::uint64) juce::Random::getSystemRandom().nextInt64() | 1u)
+{
+}
+
+NetworkTempoSync::~NetworkTempoSync()
+{
+    stop();
+}
+
+NetworkTempoSync::Role NetworkTempoSync::roleFromString(const juce::String& name)
+{
+    if (name.equalsIgnoreCase("follow")) return Role::Follow;
+    if (name.equalsIgnoreCase("lead")) return Role::Lead;
+    return Role::Off;
+}
+
+bool NetworkTempoSync::start(Role newRole)
+{
+    stop();
+    if (newRole == Role::Off) return true;
+
+    socket = std::make_unique<juce::DatagramSocket>(false);
+    // Several instances on one machine share the port; the group loops back to each of them
+    socket->setEnablePortReuse(true);
+    if (!socket->bindToPort(Port) || !socket->joinMulticast(MulticastGroup)) {
+        std::cout << "NetworkTempoSync: could not join " << MulticastGroup << ":" << Port << std::endl;
+        socket.reset();
+        return false;
+    }
+    socket->setMulticastLoopbackEnabled(true);
+
+    leaderId = 0;
+    numSampled = nextSample = 0;
+    peers = {};
+    conflictLogged = false;
+    role.store(newRole);
+    startThread(juce::Thread::Priority::high);
+    std::cout << "NetworkTempoSync: " << (newRole == Role::Lead ? "leading" : "following")
+              << " on " << MulticastGroup << ":" << Port << std::endl;
+    return true;
+}
+
+void NetworkTempoSync::stop()
+{
+    signalThreadShouldExit();
+    if (socket) socket->shutdown();
+    stopThread(1000);
+    socket.reset();
+    role.store(Role::Off);
+    session.store(Timeline{});
+    locked.store(false);
+    numPeers.store(0);
+}
+
+bool NetworkTempoSync::getSessionTimeline(Timeline& timeline) const noexcept
+{
+    if (role.load(std::memory_order_relaxed) != Role::Follow) return false;
+    const Timeline t = session.load();
+    if (!t.valid) return false;
+    timeline = t;
+    return true;
+}
+
+void NetworkTempoSync::publishTimeline(const Timeline& timeline) noexcept
+{
+    local.store(timeline);
+}
+
+void NetworkTempoSync::run()
+{
+    char buffer[256];
+    juce::uint32 nextBeacon = juce::Time::getMillisecondCounter();
+    juce::uint32 nextPing = nextBeacon;
+    while (!threadShouldExit()) {
+        const int ready = socket->waitUntilReady(true, 20);
+        if (ready < 0) break;
+        if (ready > 0) {
+            const int size = socket->read(buffer, (int) sizeof(buffer), false);
+            if (size > 0) receive(buffer, size);
+        }
+
+        const juce::uint32 now = juce::Time::getMillisecondCounter();
+        if (role.load() == Role::Lead && due(now, nextBeacon)) {
+            sendBeacon();
+            nextBeacon = now + BeaconIntervalMs;
+        }
+        if (role.load() == Role::Follow && leaderId != 0) {
+            if (now - leaderSeenMs > (juce::uint32) LeaderTimeoutMs) dropLeader();
+            else if (due(now, nextPing)) {
+                sendPing();
+                nextPing = now + PingIntervalMs;
+            }
+        }
+
+        int seen = 0;
+        for (const Peer& peer : peers)
+            if (peer.id != 0 && now - peer.lastSeenMs <= (juce::uint32) LeaderTimeoutMs) ++seen;
+        numPeers.store(seen, std::memory_order_relaxed);
+    }
+}
+
+void NetworkTempoSync::receive(const void* data, int size)
+{
+    if (size < HeaderSize) return;
+    juce::MemoryInputStream in(data, (size_t) size, false);
+    char magic[sizeof(Magic)];
+    in.read(magic, sizeof(magic));
+    if (std::memcmp(magic, Magic, sizeof(Magic)) != 0) return;
+    const auto type = (Packet) in.readByte();
+    const auto sender = (juce::uint64) in.readInt64();
+    if (sender == id) return;   // our own, looped back
+    notePeer(sender);
+
+    const Role current = role.load();
+    switch (type) {
+        case Packet::Beacon: {
+            if (in.getNumBytesRemaining() < 24) return;
+            const juce::int64 leaderNs = in.readInt64();
+            const double bpm = in.readDouble();
+            const double beat = in.readDouble();
+            if (current == Role::Follow) {
+                onBeacon(sender, leaderNs, bpm, beat);
+            } else if (current == Role::Lead && !conflictLogged) {
+                std::cout << "NetworkTempoSync: another peer leads the session too; set one to follow" << std::endl;
+                conflictLogged = true;
+            }
+            return;
+        }
+        case Packet::Ping: {
+            if (current != Role::Lead || in.getNumBytesRemaining() < 16) return;
+            if ((juce::uint64) in.readInt64() != id) return;
+            const juce::int64 sentNs = in.readInt64();
+            juce::MemoryOutputStream pong;
+            pong.write(Magic, sizeof(Magic));
+            pong.writeByte((char) Packet::Pong);
+            pong.writeInt64((juce::int64) id);
+            pong.writeInt64((juce::int64) sender);
+            pong.writeInt64(sentNs);
+            pong.writeInt64((juce::int64) DeckMixer::nowNs());
+            send(pong);
+            return;
+        }
+        case Packet::Pong: {
+            if (current != Role::Follow || sender != leaderId || in.getNumBytesRemaining() < 24) return;
+            if ((juce::uint64) in.readInt64() != id) return;
+            const juce::int64 sentNs = in.readInt64();
+            onPong(sentNs, in.readInt64());
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+void NetworkTempoSync::onBeacon(juce::uint64 sender, juce::int64 leaderNs, double bpm, double beat)
+{
+    if (leaderId == 0) {
+        leaderId = sender;
+        numSampled = nextSample = 0;
+        std::cout << "NetworkTempoSync: following peer " << juce::String::toHexString((juce::int64) sender) << std::endl;
+    }
+    if (sender != leaderId) return;
+    leaderSeenMs = juce::Time::getMillisecondCounter();
+
+    juce::int64 offsetNs = 0;
+    const bool estimated = estimateOffset(offsetNs);
+    locked.store(estimated, std::memory_order_relaxed);
+    Timeline t;
+    if (estimated && bpm > 0.0) {
+        t.bpm = bpm;
+        t.beat = beat;
+        t.timeNs = (juce::uint64) std::max<juce::int64>(0, leaderNs - offsetNs);
+        t.valid = true;
+    }
+    session.store(t);
+}
+
+void NetworkTempoSync::onPong(juce::int64 sentNs, juce::int64 leaderNs)
+{
+    const juce::int64 roundTrip = (juce::int64) DeckMixer::nowNs() - sentNs;
+    if (roundTrip < 0 || roundTrip > MaxRoundTripNs) return;
+    // The leader read its clock about halfway through the round trip
+    Sample& s = samples[(size_t) nextSample];
+    s.roundTripNs = roundTrip;
+    s.offsetNs = leaderNs - (sentNs + roundTrip / 2);
+    nextSample = (nextSample + 1) % NumSamples;
+    numSampled = std::min(numSampled + 1, NumSamples);
+    roundTripMs.store(roundTrip / 1.0e6, std::memory_order_relaxed);
+}
+
+bool NetworkTempoSync::estimateOffset(juce::int64& offsetNs) const
+{
+    if (numSampled < MinSamples) return false;
+    std::array<Sample, NumSamples> sorted = samples;
+    std::sort(sorted.begin(), sorted.begin() + numSampled,
+              [](const Sample& a, const Sample& b) { return a.roundTripNs < b.roundTripNs; });
+    // Queueing only ever adds to a round trip, so the shortest ones are the least skewed
+    const int best = std::max(1, numSampled / 4);
+    std::array<juce::int64, NumSamples> offsets{};
+    for (int i = 0; i < best; ++i) offsets[(size_t) i] = sorted[(size_t) i].offsetNs;
+    std::nth_element(offsets.begin(), offsets.begin() + best / 2, offsets.begin() + best);
+    offsetNs = offsets[(size_t) (best / 2)];
+    return true;
+}
+
+void NetworkTempoSync::sendBeacon()
+{
+    const Timeline t = local.load();
+    const juce::uint64 now = DeckMixer::nowNs();
+    juce::MemoryOutputStream beacon;
+    beacon.write(Magic, sizeof(Magic));
+    beacon.writeByte((char) Packet::Beacon);
+    beacon.writeInt64((juce::int64) id);
+    beacon.writeInt64((juce::int64) now);
+    beacon.writeDouble(t.valid ? t.bpm : 0.0);
+    beacon.writeDouble(t.valid ? t.beatAt(now) : 0.0);
+    send(beacon);
+}
+
+void NetworkTempoSync::sendPing()
+{
+    juce::MemoryOutputStream ping;
+    ping.write(Magic, sizeof(Magic));
+    ping.writeByte((char) Packet::Ping);
+    ping.writeInt64((juce::int64) id);
+    ping.writeInt64((juce::int64) leaderId);
+    ping.writeInt64((juce::int64) DeckMixer::nowNs());
+    send(ping);
+}
+
+void NetworkTempoSync::send(const juce::MemoryOutputStream& packet)
+{
+    socket->write(MulticastGroup, Port, packet.getData(), (int) packet.getDataSize());
+}
+
+void NetworkTempoSync::notePeer(juce::uint64 sender)
+{
+    const juce::uint32 now = juce::Time::getMillisecondCounter();
+    Peer* slot = nullptr;
+    for (Peer& peer : peers) {
+        if (peer.id == sender) { peer.lastSeenMs = now; return; }
+        if (!slot && (peer.id == 0 || now - peer.lastSeenMs > (juce::uint32) LeaderTimeoutMs)) slot = &peer;
+    }
+    if (slot) *slot = Peer{ sender, now };
+}
+
+void NetworkTempoSync::dropLeader()
+{
+    std::cout << "NetworkTempoSync: leader gone quiet, waiting for a session" << std::endl;
+    leaderId = 0;
+    numSampled = nextSample = 0;
+    session.store(Timeline{});
+    locked.store(false);
+}
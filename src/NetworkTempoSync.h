@@ -0,0 +1,112 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include "LockFreeQueue.h"
+
+/**
+ * Tempo and beat phase shared with other machines on the LAN (drum machines bridged in, a second
+ * laptop running PulseDJ-X), in the spirit of Ableton Link but with a protocol of its own: the
+ * Link SDK isn't part of this build.
+ *
+ * One peer leads the session and multicasts its timeline ten times a second: its bpm and the
+ * beat at a moment on its own DeckMixer::nowNs() clock. Followers never use the arrival time of
+ * a packet; they measure the offset between the leader's clock and theirs with ping/pong round
+ * trips, keep the round trips with the least queueing and map the leader's timeline onto their
+ * own clock with that offset. Network jitter therefore only shows up as a round trip that is
+ * thrown away.
+ *
+ * All networking runs on this thread. The audio thread only touches two SeqlockValues: the
+ * session timeline it follows (getSessionTimeline) and, when leading, the timeline of the local
+ * sync master it publishes (publishTimeline). DeckMixer maps either onto the host time of the
+ * block being rendered, so the phase is compared at the sample the block starts with.
+ */
+class NetworkTempoSync : private juce::Thread {
+public:
+    static constexpr int Port = 20809;
+    static constexpr const char* MulticastGroup = "224.76.78.76";
+    static constexpr int BeaconIntervalMs = 100;
+    static constexpr int PingIntervalMs = 250;
+    static constexpr int LeaderTimeoutMs = 2000;
+
+    enum class Role { Off, Follow, Lead };
+
+    // beat(t) = beat + (t - timeNs) * bpm / 60 s, on the local DeckMixer::nowNs() clock
+    struct Timeline {
+        double bpm{0.0};
+        double beat{0.0};
+        juce::uint64 timeNs{0};
+        bool valid{false};
+        double beatAt(juce::uint64 t) const noexcept { return beat + ((double) t - (double) timeNs) * bpm / 60.0e9; }
+    };
+
+    NetworkTempoSync();
+    ~NetworkTempoSync() override;
+
+    // UI thread: join the session in `role` (Off stops); false if the socket can't be opened
+    bool start(Role role);
+    void stop();
+    Role getRole() const { return role.load(); }
+    // Sync/Network preference value ("off", "follow", "lead")
+    static Role roleFromString(const juce::String& name);
+
+    // Audio thread: the leader's timeline on our clock; false while not following a locked leader
+    bool getSessionTimeline(Timeline& timeline) const noexcept;
+    // Audio thread, leading: the local sync master's timeline (valid = false while it stands)
+    void publishTimeline(const Timeline& timeline) noexcept;
+
+    // Any thread, for the UI
+    int getNumPeers() const { return numPeers.load(std::memory_order_relaxed); }
+    bool isLocked() const { return locked.load(std::memory_order_relaxed); }
+    double getRoundTripMs() const { return roundTripMs.load(std::memory_order_relaxed); }
+
+private:
+    enum class Packet : juce::uint8 { Beacon = 1, Ping = 2, Pong = 3 };
+
+    struct Sample {
+        juce::int64 roundTripNs{0};
+        juce::int64 offsetNs{0};   // leader clock minus ours
+    };
+    static constexpr int NumSamples = 32;
+    static constexpr int MinSamples = 4;
+
+    struct Peer {
+        juce::uint64 id{0};
+        juce::uint32 lastSeenMs{0};
+    };
+    static constexpr int MaxPeers = 16;
+
+    void run() override;
+    void receive(const void* data, int size);
+    void onBeacon(juce::uint64 sender, juce::int64 leaderNs, double bpm, double beat);
+    void onPong(juce::int64 sentNs, juce::int64 leaderNs);
+    void sendBeacon();
+    void sendPing();
+    void send(const juce::MemoryOutputStream& packet);
+    void notePeer(juce::uint64 sender);
+    // Median offset of the quarter of the samples with the shortest round trips
+    bool estimateOffset(juce::int64& offsetNs) const;
+    void dropLeader();
+
+    std::unique_ptr<juce::DatagramSocket> socket;
+    std::atomic<Role> role{Role::Off};
+    const juce::uint64 id;
+
+    SeqlockValue<Timeline> session;     // net thread -> audio thread
+    SeqlockValue<Timeline> local;       // audio thread -> net thread
+
+    // Net thread only
+    juce::uint64 leaderId{0};
+    juce::uint32 leaderSeenMs{0};
+    std::array<Sample, NumSamples> samples{};
+    int numSampled{0};
+    int nextSample{0};
+    std::array<Peer, MaxPeers> peers{};
+    bool conflictLogged{false};
+
+    std::atomic<int> numPeers{0};
+    std::atomic<bool> locked{false};
+    std::atomic<double> roundTripMs{0.0};
+};
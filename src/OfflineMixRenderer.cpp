@@ -0,0 +1,174 @@
+#include "OfflineMixRenderer.h"
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "DecoderRegistry.h"
+#include <algorithm>
+#include <iostream>
+
+OfflineMixRenderer::OfflineMixRenderer(std::vector<MixAutomation::Event> eventLog, Settings renderSettings)
+    : juce::Thread("OfflineMixRenderer"), events(std::move(eventLog)), settings(std::move(renderSettings))
+{
+}
+
+OfflineMixRenderer::~OfflineMixRenderer()
+{
+    stopThread(10000);
+}
+
+juce::String OfflineMixRenderer::getError() const
+{
+    const juce::ScopedLock sl(errorLock);
+    return error;
+}
+
+void OfflineMixRenderer::fail(const juce::String& message)
+{
+    std::cout << "OfflineMixRenderer: " << message.toStdString() << std::endl;
+    const juce::ScopedLock sl(errorLock);
+    error = message;
+}
+
+void OfflineMixRenderer::run()
+{
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+    if (renderMix())
+        progress.store(1.0);
+    renderSeconds.store((juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0);
+    finished.store(true);
+}
+
+void OfflineMixRenderer::applyEvent(const MixAutomation::Event& e, DJAudioPlayer* player, DeckMixer& mixer)
+{
+    switch (e.kind) {
+        case MixAutomation::Kind::LoadTrack:
+            if (player) player->loadFile(juce::File(e.path));
+            break;
+        case MixAutomation::Kind::Play:
+            if (player) player->start();
+            break;
+        case MixAutomation::Kind::Pause:
+            if (player) player->stop();
+            break;
+        case MixAutomation::Kind::DeckCommand:
+            if (player) player->applyAutomationCommand((DJAudioPlayer::Command::Type) e.commandType,
+                                                       e.value, e.value2);
+            break;
+        case MixAutomation::Kind::ChannelGain:
+            mixer.setChannelGain(e.deck, (float) e.value);
+            break;
+        case MixAutomation::Kind::Crossfader:
+            mixer.setCrossfader((float) e.value);
+            break;
+        case MixAutomation::Kind::MasterVolume:
+            mixer.setMasterVolume((float) e.value);
+            break;
+        case MixAutomation::Kind::End:
+            break;
+    }
+}
+
+bool OfflineMixRenderer::renderMix()
+{
+    if (events.empty()) {
+        fail("nothing recorded");
+        return false;
+    }
+
+    const double sampleRate = settings.sampleRate > 0.0 ? settings.sampleRate : 44100.0;
+    const int blockSize = juce::jlimit(64, 8192, settings.blockSize);
+    const double durationSec = events.back().timeSec;
+    const juce::int64 totalSamples = (juce::int64) std::ceil(durationSec * sampleRate);
+    if (totalSamples <= 0) {
+        fail("recording is empty");
+        return false;
+    }
+
+    // Private decks and mixer, laid out like the live ones (deck 0 = A, deck 1 = B)
+    int numDecks = 2;
+    for (const auto& e : events)
+        numDecks = std::max(numDecks, e.deck + 1);
+    numDecks = std::min(numDecks, DeckMixer::MaxChannels);
+
+    juce::AudioFormatManager& formatManager = DecoderRegistry::getInstance().getFormatManager();
+
+    std::vector<std::unique_ptr<DJAudioPlayer>> players;
+    auto mixer = std::make_unique<DeckMixer>();
+    for (int i = 0; i < numDecks; ++i) {
+        players.push_back(std::make_unique<DJAudioPlayer>(formatManager));
+        players.back()->setTimedCommands(false);   // events land on block starts here
+        players.back()->prepareToPlay(blockSize, sampleRate);
+        const auto side = i == 0 ? DeckMixer::CrossfaderSide::A
+                        : i == 1 ? DeckMixer::CrossfaderSide::B : DeckMixer::CrossfaderSide::Thru;
+        mixer->addChannel(players.back().get(), side);
+    }
+    mixer->prepareToRender(2, blockSize, sampleRate);
+    mixer->setParallelRendering(settings.parallelDecks);
+
+    // Writer: encoding runs on its own thread behind a FIFO
+    juce::WavAudioFormat wavFormat;
+    juce::FlacAudioFormat flacFormat;
+    const bool flac = settings.outputFile.hasFileExtension("flac");
+    juce::AudioFormat& format = flac ? static_cast<juce::AudioFormat&>(flacFormat) : wavFormat;
+    const int bits = flac ? std::min(settings.bitsPerSample, 24) : settings.bitsPerSample;
+
+    settings.outputFile.deleteFile();
+    auto stream = settings.outputFile.createOutputStream();
+    if (stream == nullptr) {
+        fail("cannot write " + settings.outputFile.getFullPathName());
+        return false;
+    }
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        format.createWriterFor(stream.get(), sampleRate, 2, bits, {}, 0));
+    if (writer == nullptr) {
+        fail("no " + format.getFormatName() + " writer for " + juce::String(bits) + " bit / "
+             + juce::String(sampleRate) + " Hz");
+        return false;
+    }
+    stream.release();   // owned by the writer now
+
+    juce::TimeSliceThread writerThread("MixExportWriter");
+    writerThread.startThread(juce::Thread::Priority::normal);
+    auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(
+        writer.release(), writerThread, blockSize * 64);
+
+    juce::AudioBuffer<float> block(2, blockSize);
+    juce::AudioIODeviceCallbackContext context;
+    size_t nextEvent = 0;
+
+    std::cout << "OfflineMixRenderer: rendering " << durationSec << " s, " << numDecks << " decks to "
+              << settings.outputFile.getFullPathName().toStdString() << std::endl;
+
+    for (juce::int64 done = 0; done < totalSamples; ) {
+        if (threadShouldExit()) {
+            fail("cancelled");
+            break;
+        }
+        const int n = (int) std::min<juce::int64>(blockSize, totalSamples - done);
+
+        // Everything logged up to the start of this block, in the order it happened
+        const double blockStartSec = done / sampleRate;
+        while (nextEvent < events.size() && events[nextEvent].timeSec <= blockStartSec) {
+            const auto& e = events[nextEvent++];
+            applyEvent(e, (e.deck >= 0 && e.deck < numDecks) ? players[(size_t) e.deck].get() : nullptr, *mixer);
+        }
+
+        float* out[2] = { block.getWritePointer(0), block.getWritePointer(1) };
+        mixer->audioDeviceIOCallbackWithContext(nullptr, 0, out, 2, n, context);
+
+        // FIFO full: the encoder is the bottleneck, wait for it instead of dropping audio
+        while (!threadedWriter->write(block.getArrayOfReadPointers(), n)) {
+            if (threadShouldExit()) break;
+            juce::Thread::sleep(1);
+        }
+        done += n;
+        progress.store((double) done / (double) totalSamples);
+    }
+
+    // Flushes the FIFO and closes the file
+    threadedWriter.reset();
+    writerThread.stopThread(5000);
+    mixer.reset();       // stops the render workers before the players go
+    players.clear();
+
+    return getError().isEmpty();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "MixAutomation.h"
+
+class DJAudioPlayer;
+class DeckMixer;
+
+/**
+ * Renders a recorded mix to a WAV/FLAC file faster than real time.
+ *
+ * Runs on its own thread with private players and its own DeckMixer, so the live decks are
+ * never touched. The automation log is replayed at block boundaries (where the audio thread
+ * applied the commands live); the mixer is driven directly through its device callback, with
+ * parallel deck rendering on its worker threads. Encoded blocks go to a background writer
+ * thread (AudioFormatWriter::ThreadedWriter), so disk and encoder time overlap the rendering.
+ */
+class OfflineMixRenderer : public juce::Thread {
+public:
+    struct Settings {
+        juce::File outputFile;          // .flac for FLAC, anything else is written as WAV
+        double sampleRate{44100.0};
+        int blockSize{1024};
+        int bitsPerSample{24};
+        bool parallelDecks{true};
+    };
+
+    OfflineMixRenderer(std::vector<MixAutomation::Event> events, Settings settings);
+    ~OfflineMixRenderer() override;
+
+    // 0..1 while running; any thread
+    double getProgress() const { return progress.load(); }
+    bool hasFinished() const { return finished.load(); }
+    // Empty on success (valid once hasFinished())
+    juce::String getError() const;
+    double getRenderSeconds() const { return renderSeconds.load(); }
+
+    void run() override;
+
+    // Applies one logged event to a private deck (player = its deck, null for mixer events)
+    static void applyEvent(const MixAutomation::Event& event, DJAudioPlayer* player, DeckMixer& mixer);
+
+private:
+    bool renderMix();
+    void fail(const juce::String& message);
+
+    const std::vector<MixAutomation::Event> events;
+    const Settings settings;
+
+    std::atomic<double> progress{0.0};
+    std::atomic<bool> finished{false};
+    std::atomic<double> renderSeconds{0.0};
+    juce::CriticalSection errorLock;
+    juce::String error;
+};
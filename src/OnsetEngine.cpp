@@ -0,0 +1,174 @@
+#include "OnsetEngine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Keeps MKL finite on bins that were silent in the previous frame
+    constexpr float MklFloor = 1.0e-3f;
+
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+            if (term < 1.0e-12 * sum) break;
+        }
+        return sum;
+    }
+}
+
+int OnsetEngine::orderFor(int decimation)
+{
+    int order = WindowOrder;
+    for (int f = decimation; f > 1 && order > 8; f >>= 1) --order;
+    return order;
+}
+
+OnsetEngine::OnsetEngine(int decimation)
+    : windowOrder(orderFor(decimation)), windowSize(1 << windowOrder), hopSize(HopSize >> (WindowOrder - windowOrder)),
+      numBins(windowSize / 2 + 1), fft(windowOrder), window((size_t) windowSize), history((size_t) windowSize, 0.0f),
+      fftData((size_t) windowSize * 2, 0.0f), prevMag((size_t) numBins, 0.0f), prevPhase((size_t) numBins, 0.0f),
+      prevPhase2((size_t) numBins, 0.0f)
+{
+    for (int i = 0; i < windowSize; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float) i / (float) windowSize);
+}
+
+void OnsetEngine::reset()
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+    std::fill(prevMag.begin(), prevMag.end(), 0.0f);
+    std::fill(prevPhase.begin(), prevPhase.end(), 0.0f);
+    std::fill(prevPhase2.begin(), prevPhase2.end(), 0.0f);
+}
+
+OnsetEngine::Frame OnsetEngine::process(const float* hop)
+{
+    Frame frame;
+
+    // Slide the analysis window by one hop
+    std::copy(history.begin() + hopSize, history.end(), history.begin());
+    std::copy(hop, hop + hopSize, history.end() - hopSize);
+
+    double energy = 0.0;
+    for (int i = 0; i < hopSize; ++i) energy += (double) hop[i] * hop[i];
+    frame.levelDb = (float) (10.0 * std::log10(energy / hopSize + 1.0e-16));
+
+    for (int i = 0; i < windowSize; ++i) fftData[(size_t) i] = history[(size_t) i] * window[(size_t) i];
+    fft.performRealOnlyForwardTransform(fftData.data(), true);
+
+    const float scale = 2.0f / (float) windowSize;
+    float complexDomain = 0.0f, hfc = 0.0f, mkl = 0.0f, flux = 0.0f;
+    for (int k = 0; k < numBins; ++k) {
+        const float re = fftData[(size_t) k * 2], im = fftData[(size_t) k * 2 + 1];
+        const float mag = std::sqrt(re * re + im * im) * scale;
+        const float phase = std::atan2(im, re);
+        const float oldMag = prevMag[(size_t) k];
+
+        // Distance to the frame predicted from the last two (steady magnitude and phase advance)
+        const float deviation = phase - 2.0f * prevPhase[(size_t) k] + prevPhase2[(size_t) k];
+        complexDomain += std::sqrt(std::abs(oldMag * oldMag + mag * mag - 2.0f * oldMag * mag * std::cos(deviation)));
+        hfc += (float) (k + 1) * mag;
+        mkl += std::log1p(mag / (oldMag + MklFloor));
+        flux += std::max(0.0f, mag - oldMag);
+
+        prevMag[(size_t) k] = mag;
+        prevPhase2[(size_t) k] = prevPhase[(size_t) k];
+        prevPhase[(size_t) k] = phase;
+    }
+
+    frame.values[ComplexDomain] = complexDomain;
+    frame.values[Hfc] = hfc;
+    frame.values[Mkl] = mkl;
+    frame.values[SpectralFlux] = flux;
+    return frame;
+}
+
+int OnsetDecimator::factorFor(double sampleRate)
+{
+    int factor = 1;
+    while (factor < MaxFactor && sampleRate / (factor * 2) >= MinOutputRate) factor *= 2;
+    return factor;
+}
+
+OnsetDecimator::OnsetDecimator(int decimation) : factor(juce::jlimit(1, MaxFactor, decimation))
+{
+    if (factor == 1) return;
+
+    // Kaiser-windowed sinc, unity DC gain; the centre tap sits TapsPerOutput / 2 outputs back
+    const int numTaps = TapsPerOutput * factor + 1;
+    const double centre = (numTaps - 1) * 0.5;
+    const double cutoff = 0.9 * 0.5 / factor;   // cycles per input sample
+    const double beta = 8.0;
+    const double i0Beta = besselI0(beta);
+    taps.resize((size_t) numTaps);
+    double sum = 0.0;
+    for (int k = 0; k < numTaps; ++k) {
+        const double t = k - centre;
+        const double x = juce::MathConstants<double>::twoPi * cutoff * t;
+        const double sinc = std::abs(t) < 1.0e-9 ? 1.0 : std::sin(x) / x;
+        const double w = t / (centre + 1.0);
+        const double window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - w * w))) / i0Beta;
+        taps[(size_t) k] = (float) (sinc * window);
+        sum += sinc * window;
+    }
+    for (auto& c : taps) c = (float) (c / sum);
+
+    history.assign((size_t) numTaps - 1, 0.0f);
+    next = history.size();
+    latencyLeft = TapsPerOutput / 2;
+}
+
+void OnsetDecimator::process(const float* input, int n, std::vector<float>& out)
+{
+    if (n <= 0) return;
+    if (factor == 1) {
+        out.insert(out.end(), input, input + n);
+        return;
+    }
+
+    history.insert(history.end(), input, input + n);
+    const size_t numTaps = taps.size();
+    for (; next < history.size(); next += (size_t) factor) {
+        const float* x = history.data() + next + 1 - numTaps;
+        float acc = 0.0f;
+        for (size_t k = 0; k < numTaps; ++k) acc += taps[k] * x[k];
+        if (latencyLeft > 0) --latencyLeft;
+        else out.push_back(acc);
+    }
+    // Keep the inputs the next output reaches back to
+    const size_t drop = next + 1 - numTaps;
+    history.erase(history.begin(), history.begin() + (ptrdiff_t) drop);
+    next -= drop;
+}
+
+bool OnsetPicker::process(float value, float levelDb, double frameSeconds, double& onsetSeconds)
+{
+    std::copy(values.begin() + 1, values.end(), values.begin());
+    std::copy(levels.begin() + 1, levels.end(), levels.begin());
+    std::copy(times.begin() + 1, times.end(), times.begin());
+    values.back() = value;
+    levels.back() = levelDb;
+    times.back() = frameSeconds;
+    if (filled < Length) { ++filled; return false; }
+
+    // Adaptive threshold around the candidate PostFrames frames back
+    std::array<float, Length> sorted = values;
+    std::nth_element(sorted.begin(), sorted.begin() + Length / 2, sorted.end());
+    const float median = sorted[(size_t) Length / 2];
+    float mean = 0.0f;
+    for (float v : values) mean += v;
+    mean /= (float) Length;
+
+    const float candidate = values[(size_t) PreFrames];
+    const bool peak = candidate > values[(size_t) PreFrames - 1] && candidate >= values[(size_t) PreFrames + 1];
+    if (!peak || candidate - median - mean * threshold <= 0.0f || levels[(size_t) PreFrames] < silenceDb)
+        return false;
+
+    const double t = times[(size_t) PreFrames];
+    if (t - lastOnset < minIoi) return false;
+    lastOnset = t;
+    onsetSeconds = t;
+    return true;
+}
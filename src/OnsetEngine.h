@@ -0,0 +1,107 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+/**
+ * Onset detection functions from one shared spectrum per hop.
+ *
+ * aubio runs a phase vocoder per onset object, so complex-domain, HFC, MKL and spectral flux
+ * over the same audio cost four FFTs per frame. The engine windows the last WindowSize samples
+ * once per hop, takes one juce::dsp::FFT and derives all four functions from its magnitudes and
+ * phases. OnsetPicker turns a function into onset times with aubio-style adaptive thresholding
+ * (median + threshold x mean over a short window) and a minimum inter-onset interval.
+ */
+class OnsetEngine {
+public:
+    static constexpr int WindowOrder = 11;
+    static constexpr int WindowSize = 1 << WindowOrder;   // 2048
+    static constexpr int HopSize = 256;
+
+    enum Function { ComplexDomain = 0, Hfc, Mkl, SpectralFlux, NumFunctions };
+
+    struct Frame {
+        std::array<float, NumFunctions> values{};
+        float levelDb{-160.0f};   // of the hop that completed the frame
+    };
+
+    // decimation: OnsetDecimator factor of the stream fed in (a power of two up to 8)
+    explicit OnsetEngine(int decimation = 1);
+
+    int getWindowSize() const { return windowSize; }
+    int getHopSize() const { return hopSize; }
+
+    // Next getHopSize() mono samples
+    Frame process(const float* hop);
+    void reset();
+    // Magnitude spectrum of the last processed frame, getWindowSize() / 2 + 1 bins
+    const std::vector<float>& getMagnitudes() const { return prevMag; }
+
+private:
+    static int orderFor(int decimation);
+
+    const int windowOrder, windowSize, hopSize, numBins;
+    juce::dsp::FFT fft;
+    std::vector<float> window;       // Hann
+    std::vector<float> history;      // last windowSize input samples
+    std::vector<float> fftData;      // 2 x windowSize, real-only transform in place
+    std::vector<float> prevMag, prevPhase, prevPhase2;
+};
+
+/**
+ * Anti-aliased integer decimation of the analysis downmix.
+ *
+ * Tempo and onsets live well below 10 kHz, yet a 96 kHz file would feed the onset engine and
+ * aubio four times the samples a 24 kHz stream carries. The decimator low-passes with a
+ * Kaiser-windowed sinc (cut off at 90% of the new Nyquist) and, in polyphase form, computes only
+ * the outputs it keeps: TapsPerOutput multiply-adds per input sample whatever the factor. Its
+ * group delay is an exact number of outputs and is dropped, so output m is input m x factor and
+ * onset times don't shift.
+ */
+class OnsetDecimator {
+public:
+    static constexpr double MinOutputRate = 20000.0;
+    static constexpr int MaxFactor = 8;
+    static constexpr int TapsPerOutput = 32;
+
+    // Largest power of two up to MaxFactor that keeps the rate at or above MinOutputRate
+    static int factorFor(double sampleRate);
+
+    explicit OnsetDecimator(int factor = 1);
+    int getFactor() const { return factor; }
+
+    // Appends the outputs the next n input samples complete to out
+    void process(const float* input, int n, std::vector<float>& out);
+
+private:
+    int factor;
+    std::vector<float> taps;      // TapsPerOutput x factor + 1, symmetric
+    std::vector<float> history;   // inputs the next output still reaches back to
+    size_t next{0};               // index in history of the next output's newest input
+    int latencyLeft{0};           // outputs still to drop for the group delay
+};
+
+class OnsetPicker {
+public:
+    OnsetPicker(float threshold, double minIoiSeconds, float silenceDb = -70.0f)
+        : threshold(threshold), minIoi(minIoiSeconds), silenceDb(silenceDb) {}
+
+    // Function value of the next frame and the time it stands for; true with that time once a
+    // peak is confirmed (PostFrames frames later)
+    bool process(float value, float levelDb, double frameSeconds, double& onsetSeconds);
+
+private:
+    static constexpr int PreFrames = 1;
+    static constexpr int PostFrames = 5;
+    static constexpr int Length = PreFrames + PostFrames + 1;
+
+    float threshold;
+    double minIoi;
+    float silenceDb;
+    std::array<float, Length> values{};
+    std::array<float, Length> levels{};
+    std::array<double, Length> times{};
+    int filled{0};
+    double lastOnset{-1.0e9};
+};
@@ -0,0 +1,180 @@
+#include "OscRemote.h"
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "MasterLevelMonitor.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // First argument as a number; false without one
+    bool argument(const juce::OSCMessage& message, float& value)
+    {
+        if (message.isEmpty()) return false;
+        const auto& arg = message[0];
+        if (arg.isFloat32()) value = arg.getFloat32();
+        else if (arg.isInt32()) value = (float) arg.getInt32();
+        else return false;
+        return true;
+    }
+
+    juce::String deckAddress(int deck, const char* name)
+    {
+        return "/pulsedj/deck/" + juce::String(deck + 1) + "/" + name;
+    }
+
+    float toDb(float linear) { return juce::Decibels::gainToDecibels(linear, -100.0f); }
+}
+
+OscRemote::OscRemote()
+    : juce::Thread("OSC Telemetry")
+{
+}
+
+OscRemote::~OscRemote()
+{
+    stop();
+}
+
+void OscRemote::setDeck(int index, DJAudioPlayer* player)
+{
+    if (index >= 0 && index < MaxDecks) decks[(size_t) index] = player;
+}
+
+bool OscRemote::start(const Settings& newSettings)
+{
+    stop();
+    settings = newSettings;
+    settings.telemetryHz = juce::jlimit(1.0, 100.0, settings.telemetryHz);
+
+    if (settings.port > 0) {
+        if (!receiver.connect(settings.port)) {
+            std::cout << "OscRemote: could not listen on port " << settings.port << std::endl;
+            return false;
+        }
+        receiver.addListener(this);
+        receiving = true;
+    }
+    if (settings.telemetryHost.isNotEmpty() && settings.telemetryPort > 0) {
+        sending = sender.connect(settings.telemetryHost, settings.telemetryPort);
+        if (sending) startThread(juce::Thread::Priority::low);
+        else std::cout << "OscRemote: no telemetry, could not reach " << settings.telemetryHost << std::endl;
+    }
+    std::cout << "OscRemote: control on port " << settings.port << ", telemetry to " << settings.telemetryHost << ":"
+              << settings.telemetryPort << " at " << settings.telemetryHz << " Hz" << std::endl;
+    return true;
+}
+
+void OscRemote::stop()
+{
+    stopThread(1000);
+    if (receiving) {
+        receiver.removeListener(this);
+        receiver.disconnect();
+        receiving = false;
+    }
+    if (sending) {
+        sender.disconnect();
+        sending = false;
+    }
+}
+
+void OscRemote::publishPerformance(const Performance& latest)
+{
+    std::lock_guard<std::mutex> guard(performanceLock);
+    performance = latest;
+    performanceMs = std::max<juce::uint32>(1, juce::Time::getMillisecondCounter());
+}
+
+void OscRemote::oscBundleReceived(const juce::OSCBundle& bundle)
+{
+    for (const auto& element : bundle) {
+        if (element.isMessage()) oscMessageReceived(element.getMessage());
+        else if (element.isBundle()) oscBundleReceived(element.getBundle());
+    }
+}
+
+void OscRemote::oscMessageReceived(const juce::OSCMessage& message)
+{
+    if (controller == nullptr) return;
+    const juce::StringArray parts = juce::StringArray::fromTokens(message.getAddressPattern().toString(), "/", "");
+    // parts[0] is the empty string before the leading slash
+    if (parts.size() < 3 || parts[1] != "pulsedj") return;
+
+    float value = 0.0f;
+    const bool hasValue = argument(message, value);
+    if (parts[2] == "crossfader") {
+        controller->postNamed("crossfader", 0, value, hasValue, MaxTempoRange);
+        return;
+    }
+    if (parts[2] != "deck" || parts.size() < 5) return;
+    const int deck = parts[3].getIntValue() - 1;
+    if (deck < 0 || deck >= MaxDecks) return;
+    const juce::String name = parts.size() > 5 ? parts[4] + "/" + parts[5] : parts[4];
+    controller->postNamed(name, deck, value, hasValue, MaxTempoRange);
+}
+
+void OscRemote::run()
+{
+    const double periodMs = 1000.0 / settings.telemetryHz;
+    double next = juce::Time::getMillisecondCounterHiRes();
+    while (!threadShouldExit()) {
+        sendTelemetry();
+        next += periodMs;
+        const double now = juce::Time::getMillisecondCounterHiRes();
+        if (next < now) next = now;   // fell behind: no burst to catch up
+        wait((int) (next - now));
+    }
+}
+
+void OscRemote::sendTelemetry()
+{
+    juce::OSCBundle bundle;
+    const juce::uint64 now = DeckMixer::nowNs();
+    for (int i = 0; i < MaxDecks; ++i) {
+        const DJAudioPlayer* player = decks[(size_t) i];
+        if (player == nullptr) continue;
+        const auto snapshot = player->getPositionSnapshot();
+        const double position = snapshot.positionAt(now);
+        const BeatGrid::Ptr grid = player->getBeatGrid();
+        const bool playing = snapshot.ratio > 0.0;
+        // What it plays at: the analysed tempo there times the track seconds per second
+        const double bpm = grid && grid->isValid() ? grid->getBpmAtTime(std::max(0.0, position)) * (playing ? snapshot.ratio : 1.0) : 0.0;
+        bundle.addElement(juce::OSCMessage(deckAddress(i, "position"), (float) position));
+        bundle.addElement(juce::OSCMessage(deckAddress(i, "length"), (float) snapshot.lengthSec));
+        bundle.addElement(juce::OSCMessage(deckAddress(i, "bpm"), (float) bpm));
+        bundle.addElement(juce::OSCMessage(deckAddress(i, "playing"), playing ? 1 : 0));
+    }
+
+    if (levelMonitor != nullptr) {
+        const auto levels = levelMonitor->getSnapshot();
+        const float peak = *std::max_element(levels.peak.begin(), levels.peak.end());
+        const float rms = *std::max_element(levels.rms.begin(), levels.rms.end());
+        bundle.addElement(juce::OSCMessage("/pulsedj/master/peak", toDb(peak)));
+        bundle.addElement(juce::OSCMessage("/pulsedj/master/rms", toDb(rms)));
+    }
+
+    Performance perf;
+    juce::uint32 publishedMs;
+    {
+        std::lock_guard<std::mutex> guard(performanceLock);
+        perf = performance;
+        publishedMs = performanceMs;
+    }
+    if (publishedMs != 0) {
+        const float age = (float) (juce::Time::getMillisecondCounter() - publishedMs) / 1000.0f;
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/load", (float) perf.loadAvgPercent));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/load_p99", (float) perf.loadP99Percent));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/load_max", (float) perf.loadMaxPercent));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/callback_p99", (float) perf.callbackP99Us));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/overruns", (juce::int32) perf.overruns));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/late", (juce::int32) perf.lateCallbacks));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/xruns", (juce::int32) perf.deviceXruns));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/jobs_ready", (juce::int32) perf.jobsReady));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/jobs_waiting", (juce::int32) perf.jobsWaiting));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/jobs_running", (juce::int32) perf.jobsRunning));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/analysis_pending", (juce::int32) perf.analysisPending));
+        bundle.addElement(juce::OSCMessage("/pulsedj/perf/age", age));
+    }
+
+    if (!bundle.isEmpty()) sender.send(bundle);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <mutex>
+#include "ControllerInput.h"
+
+class DJAudioPlayer;
+class MasterLevelMonitor;
+
+/**
+ * OSC for show controllers and monitoring: remote control in, deck state and performance
+ * counters out.
+ *
+ * Control arrives on the OSC receiver's own thread and is mapped there onto ControllerInput
+ * actions (postNamed), so a remote move takes the same path into the deck's controller command
+ * queue as a MIDI one, and the widgets follow the same way. Decks count from 1:
+ *   /pulsedj/deck/N/play, cue, sync, keylock, slip   1 pressed / 0 released (no argument: 1)
+ *   /pulsedj/deck/N/hotcue pad                        1..8
+ *   /pulsedj/deck/N/tempo factor                      speed factor, within MaxTempoRange of 1
+ *   /pulsedj/deck/N/eq/high, eq/mid, eq/low, filter   -1..1
+ *   /pulsedj/deck/N/volume                            0..1
+ *   /pulsedj/deck/N/beatjump beats, brake beats, spinback beats, censor 1/0
+ *   /pulsedj/crossfader                               -1..1
+ *
+ * Telemetry goes out from this thread as one bundle every 1 / telemetryHz seconds, read from
+ * the engine's lock-free snapshots (each deck's PositionSnapshot and beat grid, the master
+ * meter), never from the widgets:
+ *   /pulsedj/deck/N/position, length (seconds), bpm, playing (0/1)
+ *   /pulsedj/master/peak, rms (dBFS)
+ *   /pulsedj/perf/load, load_p99, load_max (% of the buffer period), callback_p99 (us),
+ *   overruns, late, xruns, jobs_ready, jobs_waiting, jobs_running, analysis_pending, and age:
+ *   seconds since the counters were last refreshed, which grows if the UI stalls.
+ * The performance counters come from whoever takes the CallbackProfiler report
+ * (publishPerformance), about once a second.
+ */
+class OscRemote : private juce::Thread,
+                  private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback> {
+public:
+    static constexpr int MaxDecks = ControllerInput::MaxDecks;
+    static constexpr int DefaultPort = 9000;
+    static constexpr int DefaultTelemetryPort = 9001;
+    static constexpr double DefaultTelemetryHz = 10.0;
+    static constexpr float MaxTempoRange = 0.5f;
+
+    struct Settings {
+        int port{DefaultPort};                    // control in; 0 = telemetry only
+        juce::String telemetryHost{"127.0.0.1"};  // empty = no telemetry
+        int telemetryPort{DefaultTelemetryPort};
+        double telemetryHz{DefaultTelemetryHz};
+    };
+
+    struct Performance {
+        double loadAvgPercent{0.0};
+        double loadP99Percent{0.0};
+        double loadMaxPercent{0.0};
+        double callbackP99Us{0.0};
+        juce::int64 overruns{0};
+        juce::int64 lateCallbacks{0};
+        int deviceXruns{-1};
+        int jobsReady{0};
+        int jobsWaiting{0};
+        int jobsRunning{0};
+        int analysisPending{0};
+    };
+
+    OscRemote();
+    ~OscRemote() override;
+
+    // While stopped (not owned)
+    void setDeck(int index, DJAudioPlayer* player);
+    void setControllerInput(ControllerInput* input) { controller = input; }
+    void setLevelMonitor(MasterLevelMonitor* monitor) { levelMonitor = monitor; }
+
+    // UI thread: false if the control port can't be opened
+    bool start(const Settings& settings);
+    void stop();
+
+    // Any thread
+    void publishPerformance(const Performance& performance);
+
+private:
+    void oscMessageReceived(const juce::OSCMessage& message) override;
+    void oscBundleReceived(const juce::OSCBundle& bundle) override;
+    void run() override;
+    void sendTelemetry();
+
+    Settings settings;
+    juce::OSCReceiver receiver{"OSC Remote"};
+    juce::OSCSender sender;
+    bool receiving{false};
+    bool sending{false};
+    std::array<DJAudioPlayer*, MaxDecks> decks{};
+    ControllerInput* controller{nullptr};
+    MasterLevelMonitor* levelMonitor{nullptr};
+
+    std::mutex performanceLock;
+    Performance performance;
+    juce::uint32 performanceMs{0};   // getMillisecondCounter() when published, 0 before
+};
@@ -1,10 +1,16 @@
 #include "PerformancePads.h"
 #include "DJAudioPlayer.h"
+#include "DeckMixer.h"
 #include "BeatIndicator.h"
-#include "GlobalBeatGrid.h"
+#include "SamplerBank.h"
+#include <QApplication>
+#include <QFileDialog>
 #include <QString>
 #include <QTimer>
+#include "FrameClock.h"
 #include <QFont>
+#include <QStyle>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -26,17 +32,32 @@ PerformancePads::PerformancePads(DeckId deck, QWidget* parent)
     cueModeBtn = new QPushButton("Cue", this);
     loopModeBtn = new QPushButton("Loop", this);  
     jumpModeBtn = new QPushButton("Jump", this);  
+    fxModeBtn = new QPushButton("FX", this);
+    samplerModeBtn = new QPushButton("Smp", this);
+    vinylModeBtn = new QPushButton("Vinyl", this);
+    stemModeBtn = new QPushButton("Stem", this);
+    sliceModeBtn = new QPushButton("Slice", this);
     cueModeBtn->setCheckable(true);
     loopModeBtn->setCheckable(true);
     jumpModeBtn->setCheckable(true);
+    fxModeBtn->setCheckable(true);
+    samplerModeBtn->setCheckable(true);
+    vinylModeBtn->setCheckable(true);
+    stemModeBtn->setCheckable(true);
+    sliceModeBtn->setCheckable(true);
     cueModeBtn->setChecked(true);
     
     // Make mode buttons wider for better appearance
-    int buttonWidth = 55;  // Increased from 50 for better proportions
+    int buttonWidth = 29;  // eight modes share the row
     int buttonHeight = 26; // Back to 26 for better readability
     cueModeBtn->setFixedSize(buttonWidth, buttonHeight);
     loopModeBtn->setFixedSize(buttonWidth, buttonHeight);
     jumpModeBtn->setFixedSize(buttonWidth, buttonHeight);
+    fxModeBtn->setFixedSize(buttonWidth, buttonHeight);
+    samplerModeBtn->setFixedSize(buttonWidth, buttonHeight);
+    vinylModeBtn->setFixedSize(buttonWidth, buttonHeight);
+    stemModeBtn->setFixedSize(buttonWidth, buttonHeight);
+    sliceModeBtn->setFixedSize(buttonWidth, buttonHeight);
     
     // Improved styling for mode buttons
     QString modeButtonStyle = "QPushButton { font-size: 9px; font-weight: bold; padding: 3px; border-radius: 0px; border: 1px solid #666; } "
@@ -46,15 +67,30 @@ PerformancePads::PerformancePads(DeckId deck, QWidget* parent)
     cueModeBtn->setStyleSheet(modeButtonStyle);
     loopModeBtn->setStyleSheet(modeButtonStyle);
     jumpModeBtn->setStyleSheet(modeButtonStyle);
+    fxModeBtn->setStyleSheet(modeButtonStyle);
+    samplerModeBtn->setStyleSheet(modeButtonStyle);
+    vinylModeBtn->setStyleSheet(modeButtonStyle);
+    stemModeBtn->setStyleSheet(modeButtonStyle);
+    sliceModeBtn->setStyleSheet(modeButtonStyle);
     
     modes->addWidget(cueModeBtn);
     modes->addWidget(loopModeBtn);
     modes->addWidget(jumpModeBtn);
+    modes->addWidget(fxModeBtn);
+    modes->addWidget(samplerModeBtn);
+    modes->addWidget(vinylModeBtn);
+    modes->addWidget(stemModeBtn);
+    modes->addWidget(sliceModeBtn);
     root->addLayout(modes);
 
     connect(cueModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeCue);
     connect(loopModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeLoop);
     connect(jumpModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeJump);
+    connect(fxModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeFx);
+    connect(samplerModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeSampler);
+    connect(vinylModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeVinyl);
+    connect(stemModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeStems);
+    connect(sliceModeBtn, &QPushButton::clicked, this, &PerformancePads::setModeSlicer);
     qDebug() << "Connected mode buttons for PerformancePads";
 
     // Pads: 2 columns x 4 rows, wider for better usability
@@ -62,6 +98,13 @@ PerformancePads::PerformancePads(DeckId deck, QWidget* parent)
     grid->setSpacing(3);
     grid->setContentsMargins(0,0,0,0);
 
+    // Both pad looks live in one sheet, parsed once; a state change flips the padActive
+    // property and re-polishes that one pad (setPadActive)
+    setStyleSheet("QPushButton[pad=\"true\"] { background-color: #444; color: #fff; font-size: 10px; border: 1px solid #666; border-radius: 0px; padding:5px; text-align:center; } "
+                  "QPushButton[pad=\"true\"]:hover { background-color: #555; } "
+                  "QPushButton[pad=\"true\"]:pressed { background-color: #333; } "
+                  "QPushButton[pad=\"true\"][padActive=\"true\"] { background-color: #00ff41; color: #000; font-weight: bold; border: 2px solid #fff; }");
+
     for (int i = 0; i < 8; ++i) {
         auto* btn = new QPushButton(this);
         // Compact but still readable
@@ -75,8 +118,8 @@ PerformancePads::PerformancePads(DeckId deck, QWidget* parent)
         f.setPointSize(10);
         f.setBold(true);
         btn->setFont(f);
-        // initial simple alignment via stylesheet; full styles applied in refreshPadStyles()
-        btn->setStyleSheet("padding:5px; text-align:center;");
+        btn->setProperty("pad", true);
+        btn->setProperty("padActive", false);
         pads[i] = btn;
         int col = (i / 4); // 0 oder 1
         int row = (i % 4); // 0..3
@@ -85,16 +128,34 @@ PerformancePads::PerformancePads(DeckId deck, QWidget* parent)
             qDebug() << "Pad button" << i << "lambda triggered"; 
             onPadPressed(i); 
         });
+        connect(btn, &QPushButton::pressed, this, [this, i]() { onPadDown(i); });
+        connect(btn, &QPushButton::released, this, [this, i]() { onPadUp(i); });
         qDebug() << "Connected pad button" << i << "to onPadPressed lambda";
     }
     root->addLayout(grid);
 
     updatePadLabels();
     
-    // Timer to continuously update pad styles (especially for loop highlighting)
-    styleUpdateTimer = new QTimer(this);
-    connect(styleUpdateTimer, &QTimer::timeout, this, &PerformancePads::refreshPadStyles);
-    styleUpdateTimer->start(200); // Update every 200ms
+    // Loop and effect state change through the pads or the deck's loopChanged (setLoopState).
+    // Sampler voices end on the audio thread, so that mode checks the bank's play-state
+    // counter once per frame and restyles only when it moved; stem mode relabels once the deck
+    // switches to (or away from) its stems, slicer mode once the track can (or can't) be sliced.
+    connect(&FrameClock::instance(), &FrameClock::frame, this, [this]() {
+        if (currentMode == Mode::Stems && player && player->hasStems() != stemsShown) updatePadLabels();
+        if (currentMode == Mode::Slicer && player && (int) player->canSlice() != slicerShown) updatePadLabels();
+        if (currentMode != Mode::Sampler || !samplerBank) return;
+        const quint32 version = samplerBank->getPlayStateVersion();
+        if (version == samplerStateVersion) return;
+        samplerStateVersion = version;
+        refreshPadStyles();
+    });
+}
+
+void PerformancePads::setLoopState(bool enabled, double startSec, double endSec) {
+    Q_UNUSED(startSec); Q_UNUSED(endSec);
+    // Loop left from elsewhere (deck button, track load): no pad holds it any more
+    if (!enabled) activeLoopPad = -1;
+    refreshPadStyles();
 }
 
 void PerformancePads::setAudioPlayer(DJAudioPlayer* p) {
@@ -105,9 +166,15 @@ void PerformancePads::setBeatIndicator(BeatIndicator* indicator) {
     beatIndicator = indicator;
 }
 
+void PerformancePads::setSamplerBank(SamplerBank* bank, int firstSlot) {
+    samplerBank = bank;
+    samplerFirstSlot = firstSlot;
+    if (currentMode == Mode::Sampler) updatePadLabels();
+}
+
 void PerformancePads::setModeCue() {
     currentMode = Mode::Cue;
-    cueModeBtn->setChecked(true); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false);
+    cueModeBtn->setChecked(true); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(false);
     updatePadLabels();
     refreshPadStyles();
     emit modeChanged(currentMode);
@@ -115,7 +182,7 @@ void PerformancePads::setModeCue() {
 void PerformancePads::setModeLoop() {
     qDebug() << "PerformancePads::setModeLoop called";
     currentMode = Mode::BeatLoop;
-    cueModeBtn->setChecked(false); loopModeBtn->setChecked(true); jumpModeBtn->setChecked(false);
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(true); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(false);
     updatePadLabels();
     // leaving loop mode: clear highlight semantics but keep loop running until user toggles off
     refreshPadStyles();
@@ -123,11 +190,55 @@ void PerformancePads::setModeLoop() {
 }
 void PerformancePads::setModeJump() {
     currentMode = Mode::BeatJump;
-    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(true);
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(true); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(false);
+    updatePadLabels();
+    emit modeChanged(currentMode);
+}
+void PerformancePads::setModeFx() {
+    currentMode = Mode::Fx;
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(true); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(false);
+    updatePadLabels();
+    emit modeChanged(currentMode);
+}
+
+void PerformancePads::setModeSampler() {
+    currentMode = Mode::Sampler;
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(true); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(false);
     updatePadLabels();
     emit modeChanged(currentMode);
 }
 
+void PerformancePads::setModeVinyl() {
+    currentMode = Mode::Vinyl;
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(true); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(false);
+    updatePadLabels();
+    emit modeChanged(currentMode);
+}
+
+void PerformancePads::setModeStems() {
+    currentMode = Mode::Stems;
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(true); sliceModeBtn->setChecked(false);
+    updatePadLabels();
+    emit modeChanged(currentMode);
+}
+
+void PerformancePads::setModeSlicer() {
+    currentMode = Mode::Slicer;
+    cueModeBtn->setChecked(false); loopModeBtn->setChecked(false); jumpModeBtn->setChecked(false); fxModeBtn->setChecked(false); samplerModeBtn->setChecked(false); vinylModeBtn->setChecked(false); stemModeBtn->setChecked(false); sliceModeBtn->setChecked(true);
+    updatePadLabels();
+    emit modeChanged(currentMode);
+}
+
+static QString formatBeats(double beats) {
+    // 0.25 -> "1/4", 0.75 -> "3/4", 2 -> "2"
+    if (beats >= 1.0 && std::abs(beats - std::round(beats)) < 1e-6) return QString::number((int) std::round(beats));
+    for (int den : {2, 4, 8, 16, 32}) {
+        const double num = beats * den;
+        if (std::abs(num - std::round(num)) < 1e-6) return QString("%1/%2").arg((int) std::round(num)).arg(den);
+    }
+    return QString::number(beats, 'g', 3);
+}
+
 void PerformancePads::updatePadLabels() {
     if (currentMode == Mode::Cue) {
         for (int i = 0; i < 8; ++i) {
@@ -142,9 +253,53 @@ void PerformancePads::updatePadLabels() {
         // Two banks: left column: 1,2,4,8; right column: 16,32,1/2,1/4
         const char* texts[8] = {"1", "2", "4", "8", "16", "32", "1/2", "1/4"};
         for (int i = 0; i < 8; ++i) pads[i]->setText(QString("Loop %1").arg(texts[i]));
-    } else {
+    } else if (currentMode == Mode::BeatJump) {
         const char* texts[8] = {"-32", "-16", "-8", "-4", "+4", "+8", "+16", "+32"};
         for (int i = 0; i < 8; ++i) pads[i]->setText(QString("Jump %1").arg(texts[i]));
+    } else if (currentMode == Mode::Sampler) {
+        for (int i = 0; i < 8; ++i) {
+            const int slot = samplerFirstSlot + i;
+            QString label = QString("SMP %1").arg(slot + 1);
+            if (samplerBank && samplerBank->hasSample(slot)) {
+                label = QString::fromStdString(samplerBank->getSlotName(slot).substring(0, 12).toStdString());
+                if (samplerBank->getPlayMode(slot) == SamplerBank::PlayMode::Loop) label += " (L)";
+            }
+            pads[i]->setText(label);
+        }
+    } else if (currentMode == Mode::Vinyl) {
+        // Left column: brakes over 1,2,4,8 beats; right column: spinbacks over 1,2,4 and censor (held)
+        const char* texts[8] = {"Brake 1", "Brake 2", "Brake 4", "Brake 8", "Spin 1", "Spin 2", "Spin 4", "Censor"};
+        for (int i = 0; i < 8; ++i) pads[i]->setText(texts[i]);
+    } else if (currentMode == Mode::Stems) {
+        // Left column mutes and unmutes a stem; right column: acapella, instrumental, drums only,
+        // all back. Until the deck plays from its stems the gains are only kept for when it does.
+        stemsShown = player && player->hasStems();
+        const char* texts[4] = {"Acapella", "Instrumental", "Drums Only", "All Stems"};
+        for (int i = 0; i < StemTrackReader::NumStems; ++i) {
+            const QString name = StemTrackReader::getStemName(i);
+            pads[i]->setText(stemsShown ? name : name + " (wait)");
+            pads[i + 4]->setText(texts[i]);
+        }
+    } else if (currentMode == Mode::Slicer) {
+        // The eight beats the playhead is in, one per pad; a streamed track jumps instead of slicing
+        slicerShown = player ? (int) player->canSlice() : 0;
+        const bool hasGrid = player && player->getBeatGrid();
+        for (int i = 0; i < 8; ++i) {
+            const QString label = QString("Slice %1").arg(i + 1);
+            pads[i]->setText(!hasGrid ? label + " (no grid)" : slicerShown ? label : label + " (jump)");
+        }
+    } else {
+        // Pads 1-5 toggle the rack's effects, 6/7 halve/double the focused effect's time, 8 kills all
+        for (int i = 0; i < DeckEffectRack::NumEffects; ++i) {
+            QString label = DeckEffectRack::getName(i);
+            if (player && (i == DeckEffectRack::Flanger || i == DeckEffectRack::Gate || i == DeckEffectRack::Echo))
+                label += " " + formatBeats(player->getEffectSettings(i).beats);
+            pads[i]->setText(label);
+        }
+        const QString focus = DeckEffectRack::getName(fxFocus);
+        pads[5]->setText(focus + " /2");
+        pads[6]->setText(focus + " x2");
+        pads[7]->setText("FX Off");
     }
     refreshPadStyles();
 }
@@ -155,6 +310,11 @@ void PerformancePads::onPadPressed(int idx) {
         qDebug() << "PerformancePads::onPadPressed - No player available!";
         return;
     }
+    // Slip hot cue was already handled on press/release
+    if (slipSwallowClick == idx) {
+        slipSwallowClick = -1;
+        return;
+    }
     switch (currentMode) {
         case Mode::Cue:
             qDebug() << "PerformancePads::onPadPressed - Cue mode";
@@ -168,7 +328,103 @@ void PerformancePads::onPadPressed(int idx) {
             qDebug() << "PerformancePads::onPadPressed - BeatJump mode";
             triggerJump(idx);
             break;
+        case Mode::Fx:
+            triggerFx(idx);
+            break;
+        case Mode::Sampler:
+            triggerSample(idx);
+            break;
+        case Mode::Vinyl:
+        case Mode::Slicer:
+            // Started on press (onPadDown)
+            break;
+        case Mode::Stems:
+            triggerStems(idx);
+            break;
+    }
+}
+
+void PerformancePads::triggerSample(int idx) {
+    if (!samplerBank) return;
+    const int slot = samplerFirstSlot + idx;
+    const auto modifiers = QApplication::keyboardModifiers();
+    // Empty pad (or shift-click) loads a sample; ctrl-click switches one-shot/loop
+    if (!samplerBank->hasSample(slot) || (modifiers & Qt::ShiftModifier)) {
+        const QString file = QFileDialog::getOpenFileName(this, QString("Load Sample %1").arg(slot + 1), QString(),
+                                                          "Audio Files (*.wav *.aiff *.aif *.flac *.mp3 *.ogg)");
+        if (!file.isEmpty()) samplerBank->loadSample(slot, juce::File(file.toStdString()));
+        updatePadLabels();
+        return;
+    }
+    if (modifiers & Qt::ControlModifier) {
+        const bool loop = samplerBank->getPlayMode(slot) == SamplerBank::PlayMode::Loop;
+        samplerBank->setPlayMode(slot, loop ? SamplerBank::PlayMode::OneShot : SamplerBank::PlayMode::Loop);
+        updatePadLabels();
     }
+    // A plain click on a loaded pad already triggered in onPadDown
+}
+
+void PerformancePads::triggerFx(int idx) {
+    if (idx < DeckEffectRack::NumEffects) {
+        player->setEffectEnabled(idx, !player->getEffectSettings(idx).enabled);
+        fxFocus = idx;
+    } else if (idx == 5 || idx == 6) {
+        const double beats = player->getEffectSettings(fxFocus).beats;
+        player->setEffectBeats(fxFocus, idx == 5 ? beats * 0.5 : beats * 2.0);
+    } else {
+        for (int i = 0; i < DeckEffectRack::NumEffects; ++i)
+            player->setEffectEnabled(i, false);
+    }
+    updatePadLabels();
+}
+
+void PerformancePads::onPadDown(int idx) {
+    // SLIP: a stored hot cue plays only while held, then the deck returns to the shadow playhead
+    slipSwallowClick = -1;
+    // Samples fire on press, not on release: one queue push to the audio thread
+    if (currentMode == Mode::Sampler && samplerBank && samplerBank->hasSample(samplerFirstSlot + idx)
+        && (QApplication::keyboardModifiers() & (Qt::ShiftModifier | Qt::ControlModifier)) == 0) {
+        samplerBank->trigger(samplerFirstSlot + idx);
+        return;
+    }
+    if (currentMode == Mode::Vinyl) {
+        triggerVinyl(idx, true);
+        return;
+    }
+    if (currentMode == Mode::Slicer) {
+        triggerSlice(idx, true);
+        return;
+    }
+    if (!player || currentMode != Mode::Cue || !player->isSlipEnabled() || cuePoints[idx] < 0.0) return;
+    if (slipHoldPad >= 0) return;
+    slipHoldPad = idx;
+    player->beginSlipHold();
+    recallCue(idx);
+}
+
+void PerformancePads::pressPad(int idx, bool down) {
+    if (idx < 0 || idx >= 8) return;
+    if (down) {
+        onPadDown(idx);
+    } else {
+        onPadUp(idx);
+        onPadPressed(idx);
+    }
+}
+
+void PerformancePads::onPadUp(int idx) {
+    if (currentMode == Mode::Vinyl) {
+        triggerVinyl(idx, false);
+        return;
+    }
+    if (currentMode == Mode::Slicer) {
+        triggerSlice(idx, false);
+        return;
+    }
+    if (slipHoldPad != idx || !player) return;
+    player->endSlipHold();
+    slipHoldPad = -1;
+    slipSwallowClick = idx;
 }
 
 void PerformancePads::storeCue(int idx) {
@@ -184,9 +440,23 @@ void PerformancePads::storeCue(int idx) {
     emit cuePointsChanged(cuePoints);
 }
 
+void PerformancePads::setCuePoints(const std::array<double, 8>& cues) {
+    cuePoints = cues;
+    updatePadLabels();
+    emit cuePointsChanged(cuePoints);
+}
+
+void PerformancePads::setGhostLoop(double startSec, double endSec) {
+    ghostLoopEnabled = endSec > startSec;
+    ghostLoopStartSec = ghostLoopEnabled ? startSec : 0.0;
+    ghostLoopEndSec = ghostLoopEnabled ? endSec : 0.0;
+    emit ghostLoopChanged(ghostLoopEnabled, ghostLoopStartSec, ghostLoopEndSec);
+}
+
 void PerformancePads::recallCue(int idx) {
     if (cuePoints[idx] >= 0.0) {
-        player->setPositionSeconds(cuePoints[idx]);
+        // With quantize the audio thread leaves for the cue on the next beat
+        player->triggerQuantizedCue(cuePoints[idx]);
     }
 }
 
@@ -234,6 +504,11 @@ void PerformancePads::triggerLoop(int idx) {
         }
     }
     
+    // Variable-tempo grids: the loop spans whole beats of the grid from its start
+    if (auto grid = player ? player->getBeatGrid() : nullptr) {
+        lengthSec = grid->getTimeAtBeat(grid->getBeatPositionAtTime(start) + beats[idx]) - start;
+    }
+    
     // Clear ghost loop when starting a new active loop
     ghostLoopEnabled = false;
     emit ghostLoopChanged(false, 0.0, 0.0);
@@ -256,37 +531,117 @@ void PerformancePads::triggerLoop(int idx) {
 
 void PerformancePads::triggerJump(int idx) {
     static const int beats[8] = {-32,-16,-8,-4, +4,+8,+16,+32};
-    double secPerBeat = getSecondsPerBeat();
-    double delta = beats[idx] * secPerBeat;
-    double pos = player->getCurrentPositionSeconds();
-    double len = player->getLengthInSeconds();
-    double rawTarget = std::max(0.0, std::min(pos + delta, len));
-    
-    // Apply quantization for jump target only if quantize is enabled
-    double target;
-    if (player && player->isQuantizeEnabled()) {
-        target = quantizeToNearestBeat(rawTarget);
+    static const int phrases[8] = {-4,-3,-2,-1, +1,+2,+3,+4};
+    // Shift jumps by phrases where the analysis found them
+    if ((QApplication::keyboardModifiers() & Qt::ShiftModifier) && jumpPhrases(phrases[idx])) return;
+    // Resolved on the audio thread against the track's grid: whole beats, phase kept
+    player->beatJump(beats[idx]);
+}
+
+bool PerformancePads::jumpPhrases(int count) {
+    auto grid = player ? player->getBeatGrid() : nullptr;
+    if (!grid || !grid->getStructure().isValid()) return false;
+    const auto& phrases = grid->getStructure().phrases;
+    const double pos = player->getCurrentPositionSeconds();
+    const int from = std::max(0, grid->getStructure().phraseAt(pos));
+    const int to = std::clamp(from + count, 0, (int) phrases.size() - 1);
+    if (to == from) return true;
+    const auto& target = phrases[(size_t) to];
+    const double into = std::max(0.0, pos - phrases[(size_t) from].startSec);
+    const double dest = target.startSec + std::min(into, target.endSec - target.startSec);
+    // As whole beats, so the audio thread keeps the phase as for any beat jump
+    const int beats = (int) std::lround(grid->getBeatPositionAtTime(dest) - grid->getBeatPositionAtTime(pos));
+    if (beats != 0) player->beatJump(beats);
+    return true;
+}
+
+void PerformancePads::triggerVinyl(int idx, bool down) {
+    if (!player) return;
+    // Stamped here, so the audio thread starts the motion at the press's place in its block
+    const juce::uint64 now = DeckMixer::nowNs();
+    static const double beats[7] = {1, 2, 4, 8, 1, 2, 4};
+    if (idx == 7) player->censor(down, now);
+    else if (!down) return;
+    else if (idx < 4) player->brake(beats[idx], now);
+    else player->spinback(beats[idx], now);
+}
+
+void PerformancePads::triggerSlice(int idx, bool down) {
+    auto grid = player ? player->getBeatGrid() : nullptr;
+    if (!grid) return;
+    if (!down) {
+        // Another pad pressed since took over; only its release lets go
+        if (slicerHeldPad != idx) return;
+        slicerHeldPad = -1;
+        if (slipHoldPad >= 0) {
+            player->endSlipHold();
+            slipHoldPad = -1;
+        } else {
+            player->releaseSlice();
+        }
+        refreshPadStyles();
+        return;
+    }
+    slicerHeldPad = idx;
+    if (player->canSlice()) {
+        player->triggerSlice(idx);
     } else {
-        target = rawTarget; // Use raw target position without quantization
+        // Streamed: a jump to the slice's beat; with slip on, back on the track's timeline on release
+        const double pos = player->getCurrentPositionSeconds();
+        const double first = std::floor(grid->getBeatPositionAtTime(pos) / 8.0) * 8.0;
+        if (slipHoldPad < 0 && player->isSlipEnabled()) {
+            slipHoldPad = idx;
+            player->beginSlipHold();
+        }
+        player->triggerQuantizedCue(std::max(0.0, grid->getTimeAtBeat(first + idx)));
     }
-    
-    player->setPositionSeconds(target);
+    refreshPadStyles();
+}
+
+void PerformancePads::triggerStems(int idx) {
+    // Which stems each right-hand pad keeps (bits in StemTrackReader::Stem order)
+    static const int presets[4] = {
+        1 << StemTrackReader::Vocals,
+        (1 << StemTrackReader::Drums) | (1 << StemTrackReader::Bass) | (1 << StemTrackReader::Other),
+        1 << StemTrackReader::Drums,
+        0xf,
+    };
+    if (idx < StemTrackReader::NumStems) {
+        player->setStemGain(idx, player->getStemGain(idx) > 0.0f ? 0.0f : 1.0f);
+    } else {
+        for (int s = 0; s < StemTrackReader::NumStems; ++s)
+            player->setStemGain(s, (presets[idx - 4] >> s) & 1 ? 1.0f : 0.0f);
+    }
+    refreshPadStyles();
 }
 
 void PerformancePads::refreshPadStyles() {
     // Highlight active loop pad when in loop mode; otherwise normal style
     for (int i = 0; i < 8; ++i) {
         bool active = (currentMode == Mode::BeatLoop) && (i == activeLoopPad) && player && player->isLoopEnabled();
-        if (active) {
-            pads[i]->setStyleSheet("QPushButton { background-color: #00ff41; color: #000; font-weight: bold; font-size: 10px; border: 2px solid #fff; border-radius: 0px; padding:5px; text-align:center; } ");
-        } else {
-            pads[i]->setStyleSheet("QPushButton { background-color: #444; color: #fff; font-size: 10px; border: 1px solid #666; border-radius: 0px; padding:5px; text-align:center; } "
-                                  "QPushButton:hover { background-color: #555; } "
-                                  "QPushButton:pressed { background-color: #333; }");
-        }
+        if (currentMode == Mode::Fx)
+            active = player && i < DeckEffectRack::NumEffects && player->getEffectSettings(i).enabled;
+        else if (currentMode == Mode::Sampler)
+            active = samplerBank && samplerBank->isSlotPlaying(samplerFirstSlot + i);
+        else if (currentMode == Mode::Stems)
+            active = player && i < StemTrackReader::NumStems && player->getStemGain(i) > 0.0f;
+        else if (currentMode == Mode::Slicer)
+            active = i == slicerHeldPad;
+        setPadActive(i, active);
     }
 }
 
+void PerformancePads::setPadActive(int idx, bool active) {
+    // Re-polishing is the only cost, and only for a pad whose state flipped
+    if (padStyleActive[idx] == (int)active) return;
+    padStyleActive[idx] = (int)active;
+    QPushButton* pad = pads[idx];
+    pad->setProperty("padActive", active);
+    pad->style()->unpolish(pad);
+    pad->style()->polish(pad);
+    pad->update();
+}
+
 // Beat and BPM utilities
 double PerformancePads::getCurrentBpm() const {
     // Get deck-specific BPM from BeatIndicator if available
@@ -304,11 +659,10 @@ double PerformancePads::getCurrentBpm() const {
         }
     }
     
-    // Fallback to GlobalBeatGrid
-    double globalBpm = GlobalBeatGrid::getInstance().getCurrentBpm();
-    if (globalBpm > 0.0) {
-        qDebug() << "PerformancePads: Using GlobalBeatGrid BPM" << globalBpm;
-        return globalBpm;
+    // Fallback to the deck's beat grid
+    if (auto grid = player ? player->getBeatGrid() : nullptr) {
+        qDebug() << "PerformancePads: Using beat grid BPM" << grid->getBpm();
+        return grid->getBpm();
     }
     // Last resort fallback
     qDebug() << "PerformancePads: Using fallback BPM 120.0";
@@ -322,8 +676,9 @@ double PerformancePads::getSecondsPerBeat() const {
 
 // NEW: Get original BPM (not tempo-scaled) for loop length calculations
 double PerformancePads::getOriginalSecondsPerBeat() const {
-    // Get the original track BPM from GlobalBeatGrid (not tempo-scaled)
-    double originalBpm = GlobalBeatGrid::getInstance().getCurrentBpm();
+    // Get the original track BPM from the deck's beat grid (not tempo-scaled), at the playhead
+    auto grid = player ? player->getBeatGrid() : nullptr;
+    double originalBpm = grid ? grid->getBpmAtTime(player->getCurrentPositionSeconds()) : 0.0;
     if (originalBpm > 0.0) {
         qDebug() << "PerformancePads: Using original BPM" << originalBpm << "for loop length calculation";
         return 60.0 / originalBpm;
@@ -353,9 +708,9 @@ double PerformancePads::getOriginalSecondsPerBeat() const {
 double PerformancePads::quantizeToNearestBeat(double positionSeconds) const {
     if (!player) return positionSeconds;
     
-    // Use the actual beat grid from GlobalBeatGrid for precise quantization
-    const auto& beatPositions = GlobalBeatGrid::getInstance().getBeatPositionsSeconds();
-    if (beatPositions.empty()) {
+    // Use the deck's beat grid for precise quantization
+    auto grid = player->getBeatGrid();
+    if (!grid) {
         // Fallback to simple math if no beat grid is available
         double secPerBeat = getSecondsPerBeat();
         if (secPerBeat <= 0.0) return positionSeconds;
@@ -364,17 +719,5 @@ double PerformancePads::quantizeToNearestBeat(double positionSeconds) const {
         return nearestBeat * secPerBeat;
     }
     
-    // Find the closest beat in the actual beat grid
-    double closestBeat = beatPositions[0];
-    double minDistance = std::abs(positionSeconds - closestBeat);
-    
-    for (double beatTime : beatPositions) {
-        double distance = std::abs(positionSeconds - beatTime);
-        if (distance < minDistance) {
-            minDistance = distance;
-            closestBeat = beatTime;
-        }
-    }
-    
-    return closestBeat;
+    return grid->getNearestBeatTime(positionSeconds);
 }
@@ -9,24 +9,37 @@
 #include <QTimer>
 #include <array>
 #include <vector>
-#include "GlobalBeatGrid.h"
+#include "BeatGrid.h"
 
 class DJAudioPlayer;
 class BeatIndicator;
+class SamplerBank;
 
 class PerformancePads : public QWidget {
     Q_OBJECT
 public:
-    enum class Mode { Cue = 0, BeatLoop = 1, BeatJump = 2 };
+    enum class Mode { Cue = 0, BeatLoop = 1, BeatJump = 2, Fx = 3, Sampler = 4, Vinyl = 5, Stems = 6, Slicer = 7 };
     public:
     enum class DeckId { A, B };
     
     PerformancePads(DeckId deckId, QWidget* parent = nullptr);
     void setAudioPlayer(DJAudioPlayer* player);
     void setBeatIndicator(BeatIndicator* indicator); // NEW: Set beat indicator reference
+    // Sampler mode plays bank slots firstSlot..firstSlot+7
+    void setSamplerBank(SamplerBank* bank, int firstSlot);
     
     // NEW: Get current cue points for waveform display
     const std::array<double, 8>& getCuePoints() const { return cuePoints; }
+    // Hardware pad (controller hot cue): pressing and releasing pad idx like the mouse does
+    void pressPad(int idx, bool down);
+    // Session restore: cue points as they were saved (seconds; negative for empty)
+    void setCuePoints(const std::array<double, 8>& cues);
+    // Track memory: the loop last left on the track, shown until a new loop starts (end <= start: none)
+    void setGhostLoop(double startSec, double endSec);
+
+public slots:
+    // Deck loop state (QtDeckWidget::loopChanged), for loops changed outside the pads
+    void setLoopState(bool enabled, double startSec, double endSec);
 
 signals:
     void modeChanged(Mode mode);
@@ -37,15 +50,31 @@ private slots:
     void setModeCue();
     void setModeLoop();
     void setModeJump();
+    void setModeFx();
+    void setModeSampler();
+    void setModeVinyl();
+    void setModeStems();
+    void setModeSlicer();
     void onPadPressed(int idx);
+    void onPadDown(int idx);
+    void onPadUp(int idx);
 
 private:
     void updatePadLabels();
     void refreshPadStyles();
+    void setPadActive(int idx, bool active);
     void storeCue(int idx);
     void recallCue(int idx);
     void triggerLoop(int idx);
     void triggerJump(int idx);
+    // Jump by whole analysed phrases, keeping the place in the phrase; false without phrases
+    bool jumpPhrases(int count);
+    void triggerFx(int idx);
+    void triggerSample(int idx);
+    void triggerVinyl(int idx, bool down);
+    void triggerStems(int idx);
+    // Held slice pad: the slice loops until release (or a slip jump to it for a streamed track)
+    void triggerSlice(int idx, bool down);
     
     // Beat and BPM utilities
     double getCurrentBpm() const;
@@ -58,13 +87,27 @@ private:
     BeatIndicator* beatIndicator = nullptr; // NEW: Reference to beat indicator
     DeckId deckId;
     Mode currentMode{Mode::Cue};
+    int slipHoldPad{-1};     // hot cue pad held in slip mode (jumps on press, returns on release)
+    int slipSwallowClick{-1}; // its clicked() after release must not recall the cue again
     std::array<QPushButton*, 8> pads{};
     std::array<double, 8> cuePoints{}; // seconds; -1 for empty
     int activeLoopPad{-1};
     QPushButton* cueModeBtn{nullptr};
     QPushButton* loopModeBtn{nullptr};
     QPushButton* jumpModeBtn{nullptr};
-    QTimer* styleUpdateTimer{nullptr};
+    QPushButton* fxModeBtn{nullptr};
+    QPushButton* samplerModeBtn{nullptr};
+    QPushButton* vinylModeBtn{nullptr};
+    QPushButton* stemModeBtn{nullptr};
+    QPushButton* sliceModeBtn{nullptr};
+    bool stemsShown{false};  // the labels were made for a deck playing from its stems
+    int slicerHeldPad{-1};   // the slice pad pressed last; only its release lets go
+    int slicerShown{-1};     // canSlice() the labels were made for, -1 = not yet
+    SamplerBank* samplerBank{nullptr};
+    int samplerFirstSlot{0};
+    int fxFocus{0};          // effect the time pads (halve/double) act on
+    std::array<int, 8> padStyleActive{ -1, -1, -1, -1, -1, -1, -1, -1 }; // style last applied, -1 = none
+    quint32 samplerStateVersion{0};   // SamplerBank::getPlayStateVersion() last styled
     
     // Ghost loop state for visual feedback after loop is disabled
     bool ghostLoopEnabled{false};
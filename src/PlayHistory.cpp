@@ -0,0 +1,226 @@
+#include "PlayHistory.h"
+#include "ContentHash.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'H', 'I', 'S', 'T', '\0' };
+    constexpr int Version = 1;
+    constexpr juce::uint32 SlotMagic = 0x504c4159;   // "PLAY"
+    constexpr int HeaderBytes = PlayHistory::RecordBytes;   // a slot's worth, room to spare
+    constexpr int MaxTagBytes = 127;
+
+    struct Header {
+        char magic[8];
+        juce::int32 version;
+        juce::int32 recordBytes;
+        juce::int64 count;   // bumped after each record; the checksums have the last word
+    };
+
+    // Cut at a character boundary
+    int fitUtf8(const char* text, int available)
+    {
+        int bytes = (int) std::strlen(text);
+        if (bytes <= available) return bytes;
+        bytes = available;
+        while (bytes > 0 && (((unsigned char) text[bytes]) & 0xc0) == 0x80) --bytes;
+        return bytes;
+    }
+}
+
+struct PlayHistory::Slot {
+    juce::uint32 magic;
+    juce::uint32 checksum;   // XXH64 of everything after it, low half
+    juce::uint64 trackId;
+    juce::int64 loadedAtMs;
+    juce::int64 startedAtMs;
+    juce::int64 playedAtMs;
+    float bpm;
+    float tempoFactor;
+    juce::int8 deck;
+    juce::int8 key;
+    juce::uint8 titleBytes;
+    juce::uint8 artistBytes;
+    juce::uint16 pathBytes;
+    juce::uint16 reserved;
+    char text[PlayHistory::RecordBytes - 56];   // title, artist, path; not terminated
+};
+
+namespace {
+    juce::uint32 checksumOf(const void* slot)
+    {
+        constexpr size_t skip = 8;   // magic and the checksum itself
+        return (juce::uint32) ContentHash::xxh64(static_cast<const char*>(slot) + skip, PlayHistory::RecordBytes - skip);
+    }
+}
+
+PlayHistory::PlayHistory(const juce::File& file) : juce::Thread("Play History"), file(file)
+{
+    static_assert(sizeof(Slot) == RecordBytes, "journal records are fixed-size");
+    if (!open()) std::cout << "PlayHistory: cannot open " << file.getFullPathName() << std::endl;
+    startThread(juce::Thread::Priority::low);
+}
+
+PlayHistory::~PlayHistory()
+{
+    signalThreadShouldExit();
+    wake.signal();
+    stopThread(2000);
+}
+
+bool PlayHistory::post(const Record& record)
+{
+    if (!queue.push(record)) return false;
+    wake.signal();
+    return true;
+}
+
+void PlayHistory::run()
+{
+    while (!threadShouldExit()) {
+        wake.wait(-1);
+        Record record;
+        while (queue.pop(record)) {
+            if (record.trackId == 0)
+                record.trackId = (juce::uint64) ContentHash::keyFor(juce::File(record.path)).getHexValue64();
+            if (!append(record))
+                std::cout << "PlayHistory: cannot append to " << file.getFullPathName() << std::endl;
+        }
+    }
+}
+
+bool PlayHistory::open()
+{
+    if (!file.existsAsFile() || file.getSize() < HeaderBytes) {
+        // New (or a header that never made it to disk): start over
+        juce::MemoryBlock header((size_t) HeaderBytes, true);
+        Header h{};
+        std::memcpy(h.magic, Magic, sizeof(Magic));
+        h.version = Version;
+        h.recordBytes = RecordBytes;
+        std::memcpy(header.getData(), &h, sizeof(h));
+        if (!file.getParentDirectory().createDirectory() || !file.replaceWithData(header.getData(), header.getSize())) return false;
+    }
+
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite);
+    if (mapping->getData() == nullptr) {
+        mapping.reset();
+        return false;
+    }
+    const auto* h = static_cast<const Header*>(mapping->getData());
+    if (std::memcmp(h->magic, Magic, sizeof(Magic)) != 0 || h->version != Version || h->recordBytes != RecordBytes) {
+        mapping.reset();
+        return false;
+    }
+
+    capacity = ((juce::int64) mapping->getSize() - HeaderBytes) / RecordBytes;
+    const auto* slots = reinterpret_cast<const Slot*>(static_cast<const char*>(mapping->getData()) + HeaderBytes);
+    // The count may lag the last record written before a crash, or lead a torn one
+    count = std::clamp<juce::int64>(h->count, 0, capacity);
+    while (count < capacity && isValid(slots[count])) ++count;
+    while (count > 0 && !isValid(slots[count - 1])) --count;
+    return true;
+}
+
+bool PlayHistory::grow()
+{
+    const juce::int64 size = HeaderBytes + (capacity + GrowRecords) * RecordBytes;
+    mapping.reset();
+    bool grown = false;
+    {
+        juce::FileOutputStream out(file);
+        if (out.openedOk()) {
+            const juce::HeapBlock<char> zeros((size_t) RecordBytes, true);
+            out.setPosition(out.getFile().getSize());
+            while (out.getPosition() < size && out.write(zeros, (size_t) RecordBytes)) {}
+            out.flush();
+            grown = out.getStatus().wasOk();
+        }
+    }
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite);
+    if (mapping->getData() == nullptr) {
+        mapping.reset();
+        capacity = 0;
+        return false;
+    }
+    capacity = ((juce::int64) mapping->getSize() - HeaderBytes) / RecordBytes;
+    return grown;
+}
+
+bool PlayHistory::append(const Record& record)
+{
+    Slot slot{};
+    slot.magic = SlotMagic;
+    slot.trackId = record.trackId;
+    slot.loadedAtMs = record.loadedAtMs;
+    slot.startedAtMs = record.startedAtMs;
+    slot.playedAtMs = record.playedAtMs;
+    slot.bpm = (float) record.bpm;
+    slot.tempoFactor = (float) record.tempoFactor;
+    slot.deck = (juce::int8) record.deck;
+    slot.key = (juce::int8) record.key;
+
+    const juce::CharPointer_UTF8 title = record.title.toUTF8(), artist = record.artist.toUTF8(), path = record.path.toUTF8();
+    const int titleBytes = fitUtf8(title, MaxTagBytes);
+    const int artistBytes = fitUtf8(artist, MaxTagBytes);
+    const int pathBytes = fitUtf8(path, (int) sizeof(slot.text) - titleBytes - artistBytes);
+    std::memcpy(slot.text, title, (size_t) titleBytes);
+    std::memcpy(slot.text + titleBytes, artist, (size_t) artistBytes);
+    std::memcpy(slot.text + titleBytes + artistBytes, path, (size_t) pathBytes);
+    slot.titleBytes = (juce::uint8) titleBytes;
+    slot.artistBytes = (juce::uint8) artistBytes;
+    slot.pathBytes = (juce::uint16) pathBytes;
+    slot.checksum = checksumOf(&slot);
+
+    const juce::ScopedLock sl(lock);
+    if (!mapping && !open()) return false;
+    if (count >= capacity && !grow()) return false;
+    char* base = static_cast<char*>(mapping->getData());
+    std::memcpy(base + HeaderBytes + count * RecordBytes, &slot, sizeof(slot));
+    ++count;
+    reinterpret_cast<Header*>(base)->count = count;
+    return true;
+}
+
+bool PlayHistory::isValid(const Slot& slot)
+{
+    return slot.magic == SlotMagic && slot.checksum == checksumOf(&slot)
+        && slot.titleBytes + slot.artistBytes + slot.pathBytes <= (int) sizeof(slot.text);
+}
+
+PlayHistory::Record PlayHistory::decode(const Slot& slot)
+{
+    Record record;
+    record.trackId = slot.trackId;
+    record.loadedAtMs = slot.loadedAtMs;
+    record.startedAtMs = slot.startedAtMs;
+    record.playedAtMs = slot.playedAtMs;
+    record.deck = slot.deck;
+    record.bpm = slot.bpm;
+    record.tempoFactor = slot.tempoFactor;
+    record.key = slot.key;
+    const char* text = slot.text;
+    record.title = juce::String::fromUTF8(text, slot.titleBytes);
+    record.artist = juce::String::fromUTF8(text + slot.titleBytes, slot.artistBytes);
+    record.path = juce::String::fromUTF8(text + slot.titleBytes + slot.artistBytes, slot.pathBytes);
+    return record;
+}
+
+std::vector<PlayHistory::Record> PlayHistory::recent(int wanted) const
+{
+    std::vector<Record> records;
+    const juce::ScopedLock sl(lock);
+    if (!mapping) return records;
+    const auto* slots = reinterpret_cast<const Slot*>(static_cast<const char*>(mapping->getData()) + HeaderBytes);
+    const juce::int64 first = std::max<juce::int64>(0, count - std::max(0, wanted));
+    records.reserve((size_t) (count - first));
+    for (juce::int64 i = count - 1; i >= first; --i) records.push_back(decode(slots[i]));
+    return records;
+}
+
+int PlayHistory::size() const
+{
+    const juce::ScopedLock sl(lock);
+    return (int) count;
+}
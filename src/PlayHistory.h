@@ -0,0 +1,71 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeQueue.h"
+#include <memory>
+#include <vector>
+
+/**
+ * Append-only journal of the tracks played, for set lists and royalty reports: one fixed-size
+ * record per track that passed the "played" threshold on a deck, with its content key, when it
+ * was loaded, started and counted as played, the deck, BPM, tempo and key, and its path, title
+ * and artist.
+ *
+ * The file is memory-mapped and grows GrowRecords at a time. A record is copied into the mapping
+ * whole and carries a checksum; the header's count is bumped after it. The pages belong to the
+ * OS the moment they are written, so a crash of the app loses nothing posted before it, and a
+ * record torn by a power cut fails its checksum and is where the journal ends when opened next.
+ * Nothing is ever rewritten.
+ *
+ * post() is called on the UI thread and never waits; the writer thread computes the track's
+ * ContentHash and appends. recent() reads the journal's tail straight from the mapping, so
+ * "recently played" costs a few hundred bytes per record and never the library database.
+ */
+class PlayHistory : private juce::Thread {
+public:
+    static constexpr int RecordBytes = 512;
+    static constexpr int GrowRecords = 64;
+
+    struct Record {
+        juce::uint64 trackId{0};       // ContentHash key; left 0, post() fills it in
+        juce::int64 loadedAtMs{0};
+        juce::int64 startedAtMs{0};    // first played
+        juce::int64 playedAtMs{0};     // passed the threshold
+        int deck{0};
+        double bpm{0.0};               // analysed; 0 if unknown
+        double tempoFactor{1.0};
+        int key{-1};                   // KeyDetector index
+        juce::String path;
+        juce::String title;            // title and artist are cut to 127 bytes each, the path
+        juce::String artist;           // to what is left of the record
+    };
+
+    explicit PlayHistory(const juce::File& file);
+    ~PlayHistory() override;
+
+    // UI thread: queue a record for the writer; false if it is still behind on earlier ones
+    bool post(const Record& record);
+
+    // The newest `count` records, newest first
+    std::vector<Record> recent(int count) const;
+    int size() const;
+
+private:
+    struct Slot;
+
+    void run() override;
+    bool open();
+    bool append(const Record& record);
+    // Unmapped, extended by GrowRecords slots and mapped again
+    bool grow();
+    static bool isValid(const Slot& slot);
+    static Record decode(const Slot& slot);
+
+    juce::File file;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    juce::int64 count{0};      // valid records
+    juce::int64 capacity{0};   // slots the mapping holds
+    juce::CriticalSection lock;   // the mapping, count and capacity: writer against recent()
+    SpscQueue<Record, 16> queue;
+    juce::WaitableEvent wake;
+};
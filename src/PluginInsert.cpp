@@ -0,0 +1,169 @@
+#include "PluginInsert.h"
+#include "PluginSandbox.h"
+#include "RtTrace.h"
+#include <cmath>
+#include <iostream>
+
+namespace {
+    enum BypassReason { OverBudget = 1, NonFinite = 2, SandboxLate = 3 };
+
+    bool allFinite(const float* samples, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            if (!std::isfinite(samples[i])) return false;
+        return true;
+    }
+}
+
+std::unique_ptr<juce::AudioPluginInstance> PluginInsert::createInstance(const juce::File& pluginFile, double sampleRate,
+                                                                        int maximumBlockSize, juce::String& error)
+{
+    juce::AudioPluginFormatManager formats;
+    formats.addDefaultFormats();
+    juce::OwnedArray<juce::PluginDescription> types;
+    const juce::String path = pluginFile.getFullPathName();
+    for (auto* format : formats.getFormats())
+        if (format->fileMightContainThisPluginType(path))
+            format->findAllTypesForFile(types, path);
+    if (types.isEmpty()) {
+        error = "no VST3 or LV2 plugin in " + pluginFile.getFileName();
+        return {};
+    }
+
+    auto instance = formats.createPluginInstance(*types[0], sampleRate, maximumBlockSize, error);
+    if (instance == nullptr) return {};
+    // Stereo in and out where the plugin allows it, otherwise whatever buses it has
+    juce::AudioProcessor::BusesLayout stereo;
+    stereo.inputBuses.add(juce::AudioChannelSet::stereo());
+    stereo.outputBuses.add(juce::AudioChannelSet::stereo());
+    if (!instance->setBusesLayout(stereo)) instance->enableAllBuses();
+    if (instance->getTotalNumOutputChannels() == 0) {
+        error = instance->getName() + " has no audio outputs";
+        return {};
+    }
+    instance->setRateAndBufferSizeDetails(sampleRate, maximumBlockSize);
+    instance->prepareToPlay(sampleRate, maximumBlockSize);
+    return instance;
+}
+
+bool PluginInsert::processInstance(juce::AudioPluginInstance& instance, juce::AudioBuffer<float>& scratch,
+                                   juce::MidiBuffer& midi, float* left, float* right, int numSamples) noexcept
+{
+    // A view on the preallocated channels, nothing allocated per block
+    juce::AudioBuffer<float> block(scratch.getArrayOfWritePointers(), scratch.getNumChannels(), numSamples);
+    block.copyFrom(0, 0, left, numSamples);
+    block.copyFrom(1, 0, right != nullptr ? right : left, numSamples);
+    for (int ch = 2; ch < block.getNumChannels(); ++ch) block.clear(ch, 0, numSamples);
+
+    instance.processBlock(block, midi);
+    midi.clear();
+
+    if (!allFinite(block.getReadPointer(0), numSamples) || !allFinite(block.getReadPointer(1), numSamples))
+        return false;
+    juce::FloatVectorOperations::copy(left, block.getReadPointer(0), numSamples);
+    if (right != nullptr) juce::FloatVectorOperations::copy(right, block.getReadPointer(1), numSamples);
+    return true;
+}
+
+std::unique_ptr<PluginInsert> PluginInsert::create(const juce::File& pluginFile, bool sandboxed, double sampleRate,
+                                                   int maximumBlockSize, juce::String& error)
+{
+    std::unique_ptr<PluginInsert> insert(new PluginInsert());
+    insert->file = pluginFile;
+    if (sandboxed) {
+        insert->sandbox = std::make_unique<PluginSandbox>();
+        if (!insert->sandbox->launch(pluginFile, sampleRate, maximumBlockSize, error)) return {};
+        insert->name = insert->sandbox->getPluginName();
+        insert->sampleRate = sampleRate;
+        insert->maxBlock = maximumBlockSize;
+    } else {
+        insert->instance = createInstance(pluginFile, sampleRate, maximumBlockSize, error);
+        if (insert->instance == nullptr) return {};
+        insert->name = insert->instance->getName();
+        insert->sampleRate = sampleRate;
+        insert->maxBlock = juce::jmax(1, maximumBlockSize);
+        insert->allocateScratch();
+    }
+    std::cout << "PluginInsert: loaded " << insert->name.toStdString() << (sandboxed ? " (sandboxed)" : "")
+              << ", latency " << insert->getLatencySamples() << " samples" << std::endl;
+    return insert;
+}
+
+PluginInsert::~PluginInsert()
+{
+    if (instance != nullptr) instance->releaseResources();
+}
+
+void PluginInsert::prepare(double newSampleRate, int maximumBlockSize)
+{
+    maximumBlockSize = juce::jmax(1, maximumBlockSize);
+    if (sandbox != nullptr) {
+        if (sandbox->isAlive() && sandbox->getSampleRate() == newSampleRate && sandbox->getMaximumBlockSize() >= maximumBlockSize)
+            return;
+        juce::String error;
+        if (!sandbox->launch(file, newSampleRate, maximumBlockSize, error))
+            std::cout << "PluginInsert: " << name.toStdString() << " did not restart: " << error.toStdString() << std::endl;
+    } else if (instance != nullptr && (newSampleRate != sampleRate || maximumBlockSize != maxBlock)) {
+        instance->releaseResources();
+        instance->setRateAndBufferSizeDetails(newSampleRate, maximumBlockSize);
+        instance->prepareToPlay(newSampleRate, maximumBlockSize);
+    }
+    sampleRate = newSampleRate;
+    maxBlock = maximumBlockSize;
+    if (instance != nullptr) allocateScratch();
+}
+
+void PluginInsert::allocateScratch()
+{
+    scratch.setSize(juce::jmax(2, instance->getTotalNumInputChannels(), instance->getTotalNumOutputChannels()), maxBlock);
+    midi.ensureSize(256);
+}
+
+void PluginInsert::process(float* left, float* right, int numSamples) noexcept
+{
+    if (left == nullptr || numSamples <= 0 || numSamples > maxBlock || bypassed.load(std::memory_order_relaxed))
+        return;
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    bool ok = true;
+    double elapsedMs = 0.0;
+    if (sandbox != nullptr) {
+        // The child's time is what counts; the hand-over here is two copies
+        ok = sandbox->process(left, right, numSamples);
+        elapsedMs = sandbox->getLastChildMs();
+        if (!sandbox->isAlive()) return bypass(SandboxLate);
+    } else {
+        if (!processInstance(*instance, scratch, midi, left, right, numSamples)) return bypass(NonFinite);
+        elapsedMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+
+    const double blockMs = 1000.0 * numSamples / sampleRate;
+    loadPercent.store((float) (100.0 * elapsedMs / blockMs), std::memory_order_relaxed);
+    const bool overBudget = !ok || elapsedMs > blockMs * budgetPercent.load(std::memory_order_relaxed) / 100.0;
+    overBudgetRun = overBudget ? overBudgetRun + 1 : 0;
+    if (overBudgetRun >= OverBudgetBlocks)
+        bypass(ok ? OverBudget : SandboxLate);
+}
+
+void PluginInsert::bypass(int reason) noexcept
+{
+    if (bypassed.exchange(true)) return;
+    overBudgetRun = 0;
+    RT_TRACE_WARN("PluginInsert: plugin bypassed (reason {}: 1 over budget, 2 non-finite output, 3 sandbox late or gone), load {}%",
+                  reason, loadPercent.load(std::memory_order_relaxed));
+}
+
+bool PluginInsert::clearBypass()
+{
+    // A sandbox can't be relaunched under the audio thread; the deck loads the plugin again
+    if (sandbox != nullptr && !sandbox->isAlive()) return false;
+    bypassed.store(false);
+    return true;
+}
+
+int PluginInsert::getLatencySamples() const
+{
+    if (isBypassed()) return 0;
+    if (sandbox != nullptr) return sandbox->isAlive() ? sandbox->getLatencySamples() : 0;
+    return instance != nullptr ? instance->getLatencySamples() : 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+class PluginSandbox;
+
+/**
+ * One VST3/LV2 effect on a deck's insert, after the built-in effect rack.
+ *
+ * The plugin runs in this process, or in a PluginSandbox child process when it is on the
+ * Plugins/Sandboxed list of plugins known to crash or hang; a crash there leaves the deck dry
+ * instead of taking the app down. Either way every block is held to a CPU budget, a share of
+ * the block's duration (Plugins/CpuBudgetPercent). A plugin over it for OverBudgetBlocks
+ * blocks in a row, one whose output is NaN or inf, or a sandbox that keeps missing its
+ * deadline is bypassed, and the deck plays dry until the DJ re-enables it (clearBypass()).
+ * A non-finite block never reaches the mix: it is checked before it replaces the dry signal.
+ *
+ * The plugin's latency, plus the sandbox's hand-over block, counts in the deck's pipeline
+ * latency, which beat sync and the displays compensate for; a bypassed plugin counts none.
+ */
+class PluginInsert {
+public:
+    static constexpr double DefaultBudgetPercent = 30.0;
+    static constexpr int OverBudgetBlocks = 3;
+
+    // UI thread: load the first plugin in pluginFile (a .vst3 bundle or an LV2 bundle
+    // directory), prepared for the device. nullptr and error set if it doesn't load.
+    static std::unique_ptr<PluginInsert> create(const juce::File& pluginFile, bool sandboxed, double sampleRate,
+                                                int maximumBlockSize, juce::String& error);
+    // Shared with the sandbox's child: stereo in and out where the plugin allows it, prepared
+    static std::unique_ptr<juce::AudioPluginInstance> createInstance(const juce::File& pluginFile, double sampleRate,
+                                                                     int maximumBlockSize, juce::String& error);
+    // Audio thread: run one block in place through scratch (sized for the plugin's channels and
+    // the block); false, with left/right untouched, if the output wasn't finite
+    static bool processInstance(juce::AudioPluginInstance& instance, juce::AudioBuffer<float>& scratch,
+                                juce::MidiBuffer& midi, float* left, float* right, int numSamples) noexcept;
+
+    ~PluginInsert();
+
+    // From the deck's prepareToPlay, never while the audio thread runs the insert. A sandbox is
+    // relaunched when the rate or block size changes.
+    void prepare(double sampleRate, int maximumBlockSize);
+    void setBudgetPercent(double percent) { budgetPercent.store(juce::jlimit(1.0, 100.0, percent)); }
+
+    // Audio thread, in place on up to two channels (right may be nullptr)
+    void process(float* left, float* right, int numSamples) noexcept;
+
+    // Any thread
+    juce::String getName() const { return name; }
+    juce::File getFile() const { return file; }
+    bool isSandboxed() const { return sandbox != nullptr; }
+    bool isBypassed() const { return bypassed.load(std::memory_order_relaxed); }
+    // False if the sandbox's child is gone: load the plugin again instead
+    bool clearBypass();
+    int getLatencySamples() const;
+    // Last block's processing time as a share of the block's duration, in percent
+    float getLoadPercent() const { return loadPercent.load(std::memory_order_relaxed); }
+
+private:
+    PluginInsert() = default;
+    void bypass(int reason) noexcept;
+    void allocateScratch();
+
+    juce::File file;
+    juce::String name;
+    std::unique_ptr<juce::AudioPluginInstance> instance;
+    std::unique_ptr<PluginSandbox> sandbox;
+    juce::AudioBuffer<float> scratch;
+    juce::MidiBuffer midi;
+    double sampleRate{44100.0};
+    int maxBlock{0};
+
+    std::atomic<double> budgetPercent{DefaultBudgetPercent};
+    std::atomic<bool> bypassed{false};
+    std::atomic<float> loadPercent{0.0f};
+    int overBudgetRun{0};   // audio thread
+};
@@ -0,0 +1,338 @@
+#include "PluginSandbox.h"
+#include "PluginInsert.h"
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+// Lives at the start of the shared file; the four channels follow at HeaderBytes
+struct PluginSandbox::Shared {
+    std::atomic<uint32_t> request{0};    // bumped by the parent when a block is in
+    std::atomic<uint32_t> reply{0};      // set to request by the child when it is out
+    std::atomic<int32_t> numSamples{0};
+    std::atomic<int32_t> childMicros{0};
+    std::atomic<int32_t> failed{0};      // the child's last block came out non-finite
+    std::atomic<int32_t> waiting{0};     // the child sleeps on request
+    std::atomic<int32_t> quit{0};
+    int32_t maxBlock{0};
+};
+
+namespace {
+    constexpr size_t HeaderBytes = 64;
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<int32_t>::is_always_lock_free,
+                  "the shared counters must work across processes");
+
+    // Not FUTEX_*_PRIVATE: the word is in memory two processes map
+    void wakeWaiter(std::atomic<uint32_t>& word) noexcept
+    {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+        juce::ignoreUnused(word);
+#endif
+    }
+
+    void waitForChange(std::atomic<uint32_t>& word, uint32_t seen, int timeoutMs) noexcept
+    {
+#if defined(__linux__)
+        timespec timeout{ timeoutMs / 1000, (long) (timeoutMs % 1000) * 1000000L };
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+#else
+        juce::ignoreUnused(word, seen, timeoutMs);
+        juce::Thread::sleep(1);
+#endif
+    }
+
+    juce::File sharedDirectory()
+    {
+#if defined(__linux__)
+        const juce::File shm("/dev/shm");
+        if (shm.isDirectory()) return shm;
+#endif
+        return juce::File::getSpecialLocation(juce::File::tempDirectory);
+    }
+
+    juce::MemoryBlock toMessage(const juce::var& value)
+    {
+        const juce::String json = juce::JSON::toString(value, true);
+        return juce::MemoryBlock(json.toRawUTF8(), json.getNumBytesAsUTF8());
+    }
+}
+
+//==============================================================================
+// Child process: the plugin, prepared on the message thread, run by one audio thread that
+// sleeps until the parent hands over a block
+class PluginSandbox::Worker : public juce::ChildProcessWorker, private juce::Thread {
+public:
+    Worker() : juce::Thread("PluginSandboxAudio") {}
+    ~Worker() override
+    {
+        stopThread(2000);
+    }
+
+    void handleMessageFromCoordinator(const juce::MemoryBlock& message) override
+    {
+        const juce::var request = juce::JSON::parse(message.toString());
+        juce::MessageManager::callAsync([this, request] { load(request); });
+    }
+
+    void handleConnectionLost() override
+    {
+        juce::MessageManager::getInstance()->stopDispatchLoop();
+    }
+
+private:
+    void load(const juce::var& request)
+    {
+        juce::String error;
+        const juce::File pluginFile(request["plugin"].toString());
+        const double sampleRate = (double) request["sampleRate"];
+        maxBlock = juce::jmax(1, (int) request["blockSize"]);
+        const juce::File sharedFile(request["shared"].toString());
+
+        mapping = std::make_unique<juce::MemoryMappedFile>(sharedFile, juce::MemoryMappedFile::readWrite, false);
+        const size_t bytes = HeaderBytes + 4 * (size_t) maxBlock * sizeof(float);
+        if (mapping->getData() == nullptr || mapping->getSize() < bytes)
+            error = "cannot map " + sharedFile.getFullPathName();
+        else
+            instance = PluginInsert::createInstance(pluginFile, sampleRate, maxBlock, error);
+
+        auto* reply = new juce::DynamicObject();
+        reply->setProperty("ok", instance != nullptr);
+        reply->setProperty("error", error);
+        if (instance != nullptr) {
+            shared = static_cast<Shared*>(mapping->getData());
+            auto* base = reinterpret_cast<float*>(static_cast<char*>(mapping->getData()) + HeaderBytes);
+            for (int i = 0; i < 4; ++i) channels[i] = base + (size_t) i * (size_t) maxBlock;
+            scratch.setSize(juce::jmax(2, instance->getTotalNumInputChannels(), instance->getTotalNumOutputChannels()), maxBlock);
+            midi.ensureSize(256);
+            reply->setProperty("name", instance->getName());
+            reply->setProperty("latency", instance->getLatencySamples());
+            startThread(juce::Thread::Priority::highest);
+        }
+        sendMessageToCoordinator(toMessage(juce::var(reply)));
+    }
+
+    void run() override
+    {
+        uint32_t seen = shared->request.load(std::memory_order_acquire);
+        while (!threadShouldExit() && shared->quit.load() == 0) {
+            const uint32_t request = shared->request.load(std::memory_order_acquire);
+            if (request == seen) {
+                // Re-checked after announcing the wait, so a block handed over in between isn't slept through
+                shared->waiting.store(1);
+                if (shared->request.load() == seen) waitForChange(shared->request, seen, 100);
+                shared->waiting.store(0);
+                continue;
+            }
+            seen = request;
+
+            const int numSamples = juce::jlimit(0, maxBlock, (int) shared->numSamples.load(std::memory_order_relaxed));
+            const auto start = juce::Time::getHighResolutionTicks();
+            std::memcpy(channels[2], channels[0], (size_t) numSamples * sizeof(float));
+            std::memcpy(channels[3], channels[1], (size_t) numSamples * sizeof(float));
+            const bool finite = PluginInsert::processInstance(*instance, scratch, midi, channels[2], channels[3], numSamples);
+            const double micros = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e6;
+            shared->childMicros.store((int32_t) juce::jmin(micros, 1.0e9), std::memory_order_relaxed);
+            shared->failed.store(finite ? 0 : 1, std::memory_order_relaxed);
+            shared->reply.store(seen, std::memory_order_release);
+        }
+    }
+
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    std::unique_ptr<juce::AudioPluginInstance> instance;
+    Shared* shared{nullptr};
+    float* channels[4]{};
+    int maxBlock{0};
+    juce::AudioBuffer<float> scratch;
+    juce::MidiBuffer midi;
+};
+
+bool PluginSandbox::isWorkerCommandLine(const juce::String& commandLine)
+{
+    return commandLine.contains(CommandLineId);
+}
+
+int PluginSandbox::runWorker(const juce::String& commandLine)
+{
+    // Plugins expect a JUCE message thread; in the child it is the main thread
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    Worker worker;
+    if (!worker.initialiseFromCommandLine(commandLine, CommandLineId))
+        return 1;
+    juce::MessageManager::getInstance()->runDispatchLoop();
+    return 0;
+}
+
+//==============================================================================
+PluginSandbox::PluginSandbox()
+{
+}
+
+PluginSandbox::~PluginSandbox()
+{
+    shutdown();
+}
+
+bool PluginSandbox::launch(const juce::File& pluginFile, double sampleRate, int maximumBlockSize, juce::String& error)
+{
+    shutdown();
+    maxBlock = juce::jmax(1, maximumBlockSize);
+    launchedRate = sampleRate;
+    loadOk = false;
+    loadError.clear();
+    loadReplied.reset();
+
+    // Zero-filled, so the counters start at 0 on both sides
+    sharedFile = sharedDirectory().getNonexistentChildFile("pulsedj-plugin", ".shm", false);
+    const size_t bytes = HeaderBytes + 4 * (size_t) maxBlock * sizeof(float);
+    const juce::MemoryBlock zeros(bytes, true);
+    if (!sharedFile.replaceWithData(zeros.getData(), zeros.getSize())) {
+        error = "cannot create " + sharedFile.getFullPathName();
+        shutdown();
+        return false;
+    }
+    mapping = std::make_unique<juce::MemoryMappedFile>(sharedFile, juce::MemoryMappedFile::readWrite, false);
+    if (mapping->getData() == nullptr || mapping->getSize() < bytes) {
+        error = "cannot map " + sharedFile.getFullPathName();
+        shutdown();
+        return false;
+    }
+    static_assert(sizeof(Shared) <= HeaderBytes, "the header overlaps the channels");
+    shared = new (mapping->getData()) Shared();
+    shared->maxBlock = maxBlock;
+    auto* base = reinterpret_cast<float*>(static_cast<char*>(mapping->getData()) + HeaderBytes);
+    for (int i = 0; i < 4; ++i) sharedChannels[i] = base + (size_t) i * (size_t) maxBlock;
+
+    if (!launchWorkerProcess(juce::File::getSpecialLocation(juce::File::currentExecutableFile), CommandLineId, 0, 0)) {
+        error = "cannot start the sandbox process";
+        shutdown();
+        return false;
+    }
+    auto* request = new juce::DynamicObject();
+    request->setProperty("plugin", pluginFile.getFullPathName());
+    request->setProperty("sampleRate", sampleRate);
+    request->setProperty("blockSize", maxBlock);
+    request->setProperty("shared", sharedFile.getFullPathName());
+    sendMessageToWorker(toMessage(juce::var(request)));
+    if (!loadReplied.wait(LaunchTimeoutMs) || !loadOk) {
+        error = loadOk || loadError.isNotEmpty() ? loadError : juce::String("the sandbox did not answer");
+        shutdown();
+        return false;
+    }
+
+    // The ring starts one block deep in silence: the hand-over's latency
+    lastInput.setSize(2, maxBlock);
+    outRing.setSize(2, 2 * maxBlock);
+    outRing.clear();
+    ringRead = 0;
+    ringWrite = ringFill = maxBlock;
+    sentSamples = dryPending = 0;
+    alive.store(true);
+    std::cout << "PluginSandbox: " << pluginName.toStdString() << " running in a child process ("
+              << pluginLatency << " + " << maxBlock << " samples latency)" << std::endl;
+    return true;
+}
+
+void PluginSandbox::shutdown()
+{
+    alive.store(false);
+    if (shared != nullptr) {
+        shared->quit.store(1);
+        shared->request.fetch_add(1);
+        wakeWaiter(shared->request);
+    }
+    killWorkerProcess();
+    shared = nullptr;
+    for (auto*& channel : sharedChannels) channel = nullptr;
+    mapping.reset();
+    if (sharedFile != juce::File()) sharedFile.deleteFile();
+    sharedFile = juce::File();
+}
+
+void PluginSandbox::handleMessageFromWorker(const juce::MemoryBlock& message)
+{
+    const juce::var reply = juce::JSON::parse(message.toString());
+    loadOk = (bool) reply["ok"];
+    loadError = reply["error"].toString();
+    pluginName = reply["name"].toString();
+    pluginLatency = juce::jmax(0, (int) reply["latency"]);
+    loadReplied.signal();
+}
+
+void PluginSandbox::handleConnectionLost()
+{
+    if (alive.exchange(false))
+        std::cout << "PluginSandbox: the child hosting " << pluginName.toStdString() << " is gone, deck plays dry" << std::endl;
+    if (loadError.isEmpty()) loadError = "the sandbox process exited";
+    loadReplied.signal();
+}
+
+bool PluginSandbox::process(float* left, float* right, int numSamples) noexcept
+{
+    if (!alive.load(std::memory_order_relaxed) || shared == nullptr || numSamples <= 0 || numSamples > maxBlock)
+        return false;
+    float* io[2] = { left, right != nullptr ? right : left };
+    const bool childFree = shared->reply.load(std::memory_order_acquire) == shared->request.load(std::memory_order_relaxed);
+    bool wet = true;
+
+    // The previous block back: the child's output, or the block dry if the child missed it
+    if (sentSamples > 0 && childFree && shared->failed.load(std::memory_order_relaxed) == 0) {
+        const float* out[2] = { sharedChannels[2], sharedChannels[3] };
+        pushOutput(out, sentSamples);
+    } else if (sentSamples > 0 || dryPending > 0) {
+        pushOutput(lastInput.getArrayOfReadPointers(), sentSamples > 0 ? sentSamples : dryPending);
+        wet = false;
+    }
+
+    // This block in, unless the child is still busy with an earlier one
+    for (int ch = 0; ch < 2; ++ch) lastInput.copyFrom(ch, 0, io[ch], numSamples);
+    if (childFree) {
+        std::memcpy(sharedChannels[0], io[0], (size_t) numSamples * sizeof(float));
+        std::memcpy(sharedChannels[1], io[1], (size_t) numSamples * sizeof(float));
+        shared->numSamples.store(numSamples, std::memory_order_relaxed);
+        shared->request.fetch_add(1, std::memory_order_release);
+        if (shared->waiting.load() != 0) wakeWaiter(shared->request);
+        sentSamples = numSamples;
+        dryPending = 0;
+    } else {
+        sentSamples = 0;
+        dryPending = numSamples;
+    }
+
+    // What plays now is one block behind
+    const int numChannels = right != nullptr ? 2 : 1;
+    const int capacity = outRing.getNumSamples();
+    const int first = juce::jmin(numSamples, capacity - ringRead);
+    for (int ch = 0; ch < numChannels; ++ch) {
+        std::memcpy(io[ch], outRing.getReadPointer(ch, ringRead), (size_t) first * sizeof(float));
+        if (first < numSamples)
+            std::memcpy(io[ch] + first, outRing.getReadPointer(ch), (size_t) (numSamples - first) * sizeof(float));
+    }
+    ringRead = (ringRead + numSamples) % capacity;
+    ringFill -= numSamples;
+    return wet;
+}
+
+void PluginSandbox::pushOutput(const float* const* channels, int numSamples) noexcept
+{
+    const int capacity = outRing.getNumSamples();
+    numSamples = juce::jmin(numSamples, capacity - ringFill);
+    const int first = juce::jmin(numSamples, capacity - ringWrite);
+    for (int ch = 0; ch < 2; ++ch) {
+        outRing.copyFrom(ch, ringWrite, channels[ch], first);
+        if (first < numSamples) outRing.copyFrom(ch, 0, channels[ch] + first, numSamples - first);
+    }
+    ringWrite = (ringWrite + numSamples) % capacity;
+    ringFill += numSamples;
+}
+
+double PluginSandbox::getLastChildMs() const noexcept
+{
+    return shared != nullptr ? shared->childMicros.load(std::memory_order_relaxed) / 1000.0 : 0.0;
+}
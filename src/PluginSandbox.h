@@ -0,0 +1,83 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+/**
+ * Runs one VST3/LV2 plugin in a child process, for plugins known to crash or hang.
+ *
+ * The child is this executable started with the sandbox's command line; main() hands that to
+ * runWorker() before anything else starts. Loading and its result go over JUCE's
+ * ChildProcessCoordinator pipe. The audio goes through a file both processes map (in /dev/shm
+ * on Linux), so a block costs two copies and no message.
+ *
+ * The audio thread never waits for the child. Each block it collects the child's output for
+ * the previous block and hands over the current one, which costs exactly one block of latency
+ * (getLatencySamples(), on top of the plugin's own). A child that misses a block's deadline
+ * has that block played dry; a child that dies leaves the deck dry until the plugin is loaded
+ * again. On Linux the child sleeps on a futex on the shared request counter, which the audio
+ * thread wakes; elsewhere it polls every millisecond.
+ */
+class PluginSandbox : private juce::ChildProcessCoordinator {
+public:
+    static constexpr const char* CommandLineId = "pulsedjpluginsandbox";
+    static constexpr int LaunchTimeoutMs = 10000;
+
+    PluginSandbox();
+    ~PluginSandbox() override;
+
+    // Child process, from main(): true if the command line starts a sandbox
+    static bool isWorkerCommandLine(const juce::String& commandLine);
+    // Child process: hosts the plugin until the parent goes away; the exit code
+    static int runWorker(const juce::String& commandLine);
+
+    // Not the audio thread: start the child and load the plugin in it. Blocks until the child
+    // reports, LaunchTimeoutMs at most.
+    bool launch(const juce::File& pluginFile, double sampleRate, int maximumBlockSize, juce::String& error);
+    juce::String getPluginName() const { return pluginName; }
+    double getSampleRate() const { return launchedRate; }
+    int getMaximumBlockSize() const { return maxBlock; }
+    // The plugin's own latency plus the block the hand-over costs
+    int getLatencySamples() const { return pluginLatency + maxBlock; }
+    bool isAlive() const { return alive.load(std::memory_order_relaxed); }
+
+    // Audio thread, in place. False when the block comes out dry: the child missed the
+    // previous block's deadline or is gone.
+    bool process(float* left, float* right, int numSamples) noexcept;
+    // Audio thread: how long the child took over the last block it finished
+    double getLastChildMs() const noexcept;
+
+private:
+    struct Shared;
+    class Worker;
+
+    void handleMessageFromWorker(const juce::MemoryBlock& message) override;
+    void handleConnectionLost() override;
+    void shutdown();
+    // Local ring the child's output (or the dry block it missed) goes through, one block deep
+    void pushOutput(const float* const* channels, int numSamples) noexcept;
+
+    juce::File sharedFile;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    Shared* shared{nullptr};
+    float* sharedChannels[4]{};   // input L/R, output L/R
+
+    juce::WaitableEvent loadReplied;
+    bool loadOk{false};
+    juce::String loadError;
+    juce::String pluginName;
+    int pluginLatency{0};
+    double launchedRate{0.0};
+    int maxBlock{0};
+    std::atomic<bool> alive{false};
+
+    // Audio thread
+    juce::AudioBuffer<float> lastInput;   // the most recent block, played dry if the child misses it
+    juce::AudioBuffer<float> outRing;
+    int ringRead{0}, ringWrite{0}, ringFill{0};
+    int sentSamples{0};    // block the child is working on
+    int dryPending{0};     // block that wasn't sent because the child was still busy
+
+    JUCE_DECLARE_NON_COPYABLE(PluginSandbox)
+};
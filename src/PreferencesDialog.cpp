@@ -1,4 +1,6 @@
 #include "PreferencesDialog.h"
+#include "MemoryBudget.h"
+#include "AudioDeviceConfig.h"
 #include <QApplication>
 #include <QScreen>
 #include <QHeaderView>
@@ -88,6 +90,8 @@ void PreferencesDialog::createAudioTab() {
     QFormLayout* deviceLayout = new QFormLayout(deviceGroup);
     
     audioDeviceCombo = new QComboBox();
+    // Placed with the headphone settings below, filled from the same scan
+    cueDeviceCombo = new QComboBox();
     populateAudioDevices();
     deviceLayout->addRow("Device:", audioDeviceCombo);
     
@@ -101,7 +105,7 @@ void PreferencesDialog::createAudioTab() {
     sampleRateCombo->setCurrentText("44100");
     deviceLayout->addRow("Sample Rate:", sampleRateCombo);
     
-    exclusiveModeCheck = new QCheckBox("Exclusive Mode (WASAPI)");
+    exclusiveModeCheck = new QCheckBox("Exclusive Mode (ASIO, WASAPI exclusive, JACK or ALSA hardware device)");
     deviceLayout->addRow(exclusiveModeCheck);
     
     layout->addWidget(deviceGroup);
@@ -115,6 +119,15 @@ void PreferencesDialog::createAudioTab() {
     keylockQualityCombo->setCurrentIndex(1);
     qualityLayout->addRow("Keylock Quality:", keylockQualityCombo);
     
+    keylockAutoQualityCheck = new QCheckBox("Lower keylock quality automatically under CPU load");
+    keylockAutoQualityCheck->setChecked(true);
+    qualityLayout->addRow(keylockAutoQualityCheck);
+    
+    varispeedQualityCombo = new QComboBox();
+    varispeedQualityCombo->addItems({"Linear (low CPU)", "High Quality (sinc)"});
+    varispeedQualityCombo->setCurrentIndex(1);
+    qualityLayout->addRow("Tempo/Scratch Resampler:", varispeedQualityCombo);
+    
     layout->addWidget(qualityGroup);
     
     // Volume Group
@@ -138,6 +151,23 @@ void PreferencesDialog::createAudioTab() {
     volumeLayout->addWidget(headphoneVolumeSlider, 1, 1);
     headphoneVolumeLabel = new QLabel("70%");
     volumeLayout->addWidget(headphoneVolumeLabel, 1, 2);
+
+    headphoneCueOutputCheck = new QCheckBox("Headphone cue on outputs 3/4 (needs a 4-output device)");
+    headphoneCueOutputCheck->setChecked(false);
+    volumeLayout->addWidget(headphoneCueOutputCheck, 2, 0, 1, 3);
+
+    // A second interface's clock drifts against the master's; the cue is resampled to follow it
+    volumeLayout->addWidget(new QLabel("Headphone Device:"), 3, 0);
+    cueDeviceCombo->setToolTip("Headphone cue on a separate output device, e.g. the laptop jack "
+                               "while the master plays through the mixer's interface");
+    volumeLayout->addWidget(cueDeviceCombo, 3, 1, 1, 2);
+
+    volumeLayout->addWidget(new QLabel("Crossfader Curve:"), 4, 0);
+    crossfaderCurveCombo = new QComboBox();
+    crossfaderCurveCombo->addItems({"Smooth (constant power)", "Dipless", "Scratch cut"});
+    crossfaderCurveCombo->setCurrentIndex(1);
+    crossfaderCurveCombo->setToolTip("Scratch cut keeps both decks at full level until the last few percent of the travel");
+    volumeLayout->addWidget(crossfaderCurveCombo, 4, 1, 1, 2);
     
     layout->addWidget(volumeGroup);
     layout->addStretch();
@@ -174,6 +204,14 @@ void PreferencesDialog::createDeckTab() {
     deckASpeedDefault->setSuffix("x");
     deckALayout->addRow("Default Speed:", deckASpeedDefault);
     
+    deckAReadAheadMs = new QSpinBox();
+    deckAReadAheadMs->setRange(0, 10000);
+    deckAReadAheadMs->setSingleStep(250);
+    deckAReadAheadMs->setValue(1500);
+    deckAReadAheadMs->setSuffix(" ms");
+    deckAReadAheadMs->setSpecialValueText("Off (stream directly)");
+    deckALayout->addRow("Read-ahead Buffer:", deckAReadAheadMs);
+    
     layout->addWidget(deckAGroup);
     
     // Deck B Defaults
@@ -193,6 +231,14 @@ void PreferencesDialog::createDeckTab() {
     deckBSpeedDefault->setSuffix("x");
     deckBLayout->addRow("Default Speed:", deckBSpeedDefault);
     
+    deckBReadAheadMs = new QSpinBox();
+    deckBReadAheadMs->setRange(0, 10000);
+    deckBReadAheadMs->setSingleStep(250);
+    deckBReadAheadMs->setValue(1500);
+    deckBReadAheadMs->setSuffix(" ms");
+    deckBReadAheadMs->setSpecialValueText("Off (stream directly)");
+    deckBLayout->addRow("Read-ahead Buffer:", deckBReadAheadMs);
+    
     layout->addWidget(deckBGroup);
     
     // Behavior Group
@@ -201,6 +247,10 @@ void PreferencesDialog::createDeckTab() {
     
     syncOnLoad = new QCheckBox("Auto-sync tempo when loading tracks");
     behaviorLayout->addRow(syncOnLoad);
+
+    autoCue = new QCheckBox("Auto-cue to the first audible sound on load");
+    autoCue->setChecked(true);
+    behaviorLayout->addRow(autoCue);
     
     autoGainAdjust = new QCheckBox("Auto-adjust gain for consistent volume");
     autoGainAdjust->setChecked(true);
@@ -279,12 +329,23 @@ void PreferencesDialog::createInterfaceTab() {
     waveformQualitySlider = new QSlider(Qt::Horizontal);
     waveformQualitySlider->setRange(25, 100);
     waveformQualitySlider->setValue(75);
+    waveformQualitySlider->setToolTip("How much of a hi-DPI screen's resolution the scrolling waveforms use; "
+                                      "75 and up draws every physical pixel. Applies on the next start.");
     QLabel* qualityLowLabel = new QLabel("Low");
     QLabel* qualityHighLabel = new QLabel("High");
     qualitySliderLayout->addWidget(qualityLowLabel);
     qualitySliderLayout->addWidget(waveformQualitySlider);
     qualitySliderLayout->addWidget(qualityHighLabel);
     waveformLayout->addRow("Waveform Quality:", qualitySliderLayout);
+
+    waveformStyleCombo = new QComboBox();
+    waveformStyleCombo->addItems({"Waveform", "Spectrogram"});
+    waveformStyleCombo->setToolTip("What the scrolling deck views show; S on a view switches it too");
+    waveformLayout->addRow("Deck View:", waveformStyleCombo);
+
+    showPhaseCompare = new QCheckBox("Show phase comparison view");
+    showPhaseCompare->setToolTip("Both decks' waveforms and beat grids on one time axis under the deck views");
+    waveformLayout->addRow(showPhaseCompare);
     
     layout->addWidget(waveformGroup);
     layout->addStretch();
@@ -349,6 +410,16 @@ void PreferencesDialog::createLibraryTab() {
     cachePathLayout->addWidget(cachePathButton);
     pathsLayout->addRow("Cache Path:", cachePathLayout);
     
+    // Shared analysis cache (SharedCache), e.g. on a NAS
+    QHBoxLayout* sharedCachePathLayout = new QHBoxLayout();
+    sharedCachePathEdit = new QLineEdit();
+    sharedCachePathEdit->setPlaceholderText("Optional folder shared with other machines...");
+    sharedCachePathEdit->setToolTip("Analyses missing here are taken from this folder, and new ones are written back to it");
+    sharedCachePathButton = new QPushButton("Browse...");
+    sharedCachePathLayout->addWidget(sharedCachePathEdit);
+    sharedCachePathLayout->addWidget(sharedCachePathButton);
+    pathsLayout->addRow("Shared Cache:", sharedCachePathLayout);
+    
     layout->addWidget(pathsGroup);
     
     // Analysis Group
@@ -363,6 +434,10 @@ void PreferencesDialog::createLibraryTab() {
     deepAnalysis->setChecked(true);
     analysisLayout->addRow(deepAnalysis);
     
+    detectDuplicates = new QCheckBox("Detect duplicates by acoustic fingerprint");
+    detectDuplicates->setChecked(true);
+    analysisLayout->addRow(detectDuplicates);
+    
     autoCreateWaveforms = new QCheckBox("Auto-create waveform previews");
     autoCreateWaveforms->setChecked(true);
     analysisLayout->addRow(autoCreateWaveforms);
@@ -382,6 +457,14 @@ void PreferencesDialog::createLibraryTab() {
     sortDefaultCombo->addItems({"Artist", "Title", "Album", "BPM", "Date Added", "Genre"});
     behaviorLayout->addRow("Default Sort:", sortDefaultCombo);
     
+    showWaveformColumn = new QCheckBox("Show mini waveforms in the track list");
+    showWaveformColumn->setChecked(false);
+    behaviorLayout->addRow(showWaveformColumn);
+
+    fuzzySearch = new QCheckBox("Typo-tolerant search (up to two typos in title / artist)");
+    fuzzySearch->setChecked(true);
+    behaviorLayout->addRow(fuzzySearch);
+    
     layout->addWidget(behaviorGroup);
     
     // Actions Group
@@ -416,6 +499,14 @@ void PreferencesDialog::createLibraryTab() {
         }
     });
     
+    connect(sharedCachePathButton, &QPushButton::clicked, [this]() {
+        QString path = QFileDialog::getExistingDirectory(this, "Select Shared Cache Folder", 
+                                                        sharedCachePathEdit->text());
+        if (!path.isEmpty()) {
+            sharedCachePathEdit->setText(path);
+        }
+    });
+    
     connect(rescanButton, &QPushButton::clicked, this, &PreferencesDialog::onRescanLibrary);
     connect(clearCacheButton, &QPushButton::clicked, this, &PreferencesDialog::onClearCache);
 }
@@ -441,6 +532,12 @@ void PreferencesDialog::createPerformanceTab() {
     threadPrioritySlider->setValue(50);
     cpuLayout->addRow("Thread Priority:", threadPrioritySlider);
     
+    lowPowerOnBattery = new QCheckBox("Low-power UI on battery");
+    lowPowerOnBattery->setChecked(true);
+    lowPowerOnBattery->setToolTip("While the laptop runs on battery: 30 fps animation and one idle-priority "
+                                  "analysis worker. Audio is not affected.");
+    cpuLayout->addRow(lowPowerOnBattery);
+    
     layout->addWidget(cpuGroup);
     
     // Memory Group
@@ -453,19 +550,65 @@ void PreferencesDialog::createPerformanceTab() {
     memoryLimitSpinBox->setSuffix(" MB");
     memoryLayout->addRow("Memory Limit:", memoryLimitSpinBox);
     
+    decodeTracksToRam = new QCheckBox("Decode tracks into RAM (instant seeks, uses Memory Limit)");
+    decodeTracksToRam->setChecked(false);
+    memoryLayout->addRow(decodeTracksToRam);
+
+    compressTracksInRam = new QCheckBox("Keep RAM tracks compressed (lossless 16-bit, about a third of the memory)");
+    compressTracksInRam->setChecked(true);
+    memoryLayout->addRow(compressTracksInRam);
+
+    prepareSamplesInRam = new QCheckBox("Keep tracks prepared for a gig in RAM (compressed, uses Memory Limit)");
+    prepareSamplesInRam->setChecked(false);
+    memoryLayout->addRow(prepareSamplesInRam);
+    
+    memoryMapUncompressed = new QCheckBox("Memory-map WAV/AIFF files (no decoding, no extra RAM)");
+    memoryMapUncompressed->setChecked(true);
+    memoryLayout->addRow(memoryMapUncompressed);
+    
     diskCacheSlider = new QSlider(Qt::Horizontal);
     diskCacheSlider->setRange(64, 1024);
     diskCacheSlider->setValue(256);
     memoryLayout->addRow("Disk Cache:", diskCacheSlider);
     
+    memoryUsageLabel = new QLabel();
+    memoryUsageLabel->setTextFormat(Qt::RichText);
+    memoryLayout->addRow("In Use:", memoryUsageLabel);
+    // Refreshed while the dialog is open; the counters are plain atomics, reading them is free
+    memoryUsageTimer = new QTimer(this);
+    memoryUsageTimer->setInterval(1000);
+    connect(memoryUsageTimer, &QTimer::timeout, this, &PreferencesDialog::updateMemoryUsage);
+    memoryUsageTimer->start();
+    updateMemoryUsage();
+    
     layout->addWidget(memoryGroup);
     
+    // Plugin Group
+    QGroupBox* pluginGroup = new QGroupBox("Deck Plugins");
+    QFormLayout* pluginLayout = new QFormLayout(pluginGroup);
+    
+    pluginCpuBudget = new QSpinBox();
+    pluginCpuBudget->setRange(5, 90);
+    pluginCpuBudget->setValue(30);
+    pluginCpuBudget->setSuffix(" % of a buffer");
+    pluginCpuBudget->setToolTip("A plugin that takes longer than this for a few buffers in a row is bypassed");
+    pluginLayout->addRow("CPU Budget:", pluginCpuBudget);
+    
+    sandboxedPlugins = new QLineEdit();
+    sandboxedPlugins->setPlaceholderText("e.g. SomeReverb, OldDelay");
+    sandboxedPlugins->setToolTip("Plugins whose file name contains one of these (comma-separated) run in a separate "
+                                 "process, so a crash leaves the deck dry. Costs one buffer of latency.");
+    pluginLayout->addRow("Run Sandboxed:", sandboxedPlugins);
+    
+    layout->addWidget(pluginGroup);
+    
     // Graphics Group
     QGroupBox* graphicsGroup = new QGroupBox("Graphics Settings");
     QFormLayout* graphicsLayout = new QFormLayout(graphicsGroup);
     
     enableGpuAcceleration = new QCheckBox("Enable GPU acceleration");
     enableGpuAcceleration->setChecked(true);
+    enableGpuAcceleration->setToolTip("Off: waveforms are drawn by the CPU rasterizer, which can be faster on virtual machines and some integrated GPUs");
     graphicsLayout->addRow(enableGpuAcceleration);
     
     renderQualityCombo = new QComboBox();
@@ -479,7 +622,7 @@ void PreferencesDialog::createPerformanceTab() {
     QGroupBox* advancedGroup = new QGroupBox("Advanced Performance");
     QFormLayout* advancedLayout = new QFormLayout(advancedGroup);
     
-    lowLatencyMode = new QCheckBox("Low-latency mode (uses more CPU)");
+    lowLatencyMode = new QCheckBox("Low-latency mode (fused zero-copy mix)");
     advancedLayout->addRow(lowLatencyMode);
     
     backgroundProcessing = new QCheckBox("Background processing");
@@ -520,6 +663,8 @@ void PreferencesDialog::createAdvancedTab() {
     
     crashReporting = new QCheckBox("Enable crash reporting");
     crashReporting->setChecked(true);
+    crashReporting->setToolTip("On a crash or a burst of audio dropouts, write the last minute of audio timing and "
+                               "controls to a flight-recorder file in the logs folder");
     debugLayout->addRow(crashReporting);
     
     betaFeatures = new QCheckBox("Enable beta features");
@@ -686,18 +831,26 @@ void PreferencesDialog::loadSettings() {
     settings.bufferSize = config.value("Audio/BufferSize", 512).toInt();
     settings.sampleRate = config.value("Audio/SampleRate", 44100).toInt();
     settings.keylockQuality = config.value("Audio/KeylockQuality", 1).toInt();
+    settings.varispeedQuality = config.value("Audio/VarispeedQuality", 1).toInt();
+    settings.keylockAutoQuality = config.value("Performance/KeylockAutoQuality", true).toBool();
     settings.exclusiveMode = config.value("Audio/ExclusiveMode", false).toBool();
     settings.masterVolume = config.value("Audio/MasterVolume", 0.8).toDouble();
     settings.headphoneVolume = config.value("Audio/HeadphoneVolume", 0.7).toDouble();
+    settings.headphoneCueOutput = config.value("Audio/HeadphoneCueOutput", false).toBool();
+    settings.cueDevice = config.value("Audio/CueDevice", "").toString();
+    settings.crossfaderCurve = config.value("Audio/CrossfaderCurve", 1).toInt();
     
     // Load Deck settings
     settings.deckAKeylockDefault = config.value("Decks/DeckAKeylockDefault", false).toBool();
     settings.deckAQuantizeDefault = config.value("Decks/DeckAQuantizeDefault", false).toBool();
     settings.deckASpeedDefault = config.value("Decks/DeckASpeedDefault", 1.0).toDouble();
+    settings.deckAReadAheadMs = config.value("Decks/DeckAReadAheadMs", 1500).toInt();
     settings.deckBKeylockDefault = config.value("Decks/DeckBKeylockDefault", false).toBool();
     settings.deckBQuantizeDefault = config.value("Decks/DeckBQuantizeDefault", false).toBool();
     settings.deckBSpeedDefault = config.value("Decks/DeckBSpeedDefault", 1.0).toDouble();
+    settings.deckBReadAheadMs = config.value("Decks/DeckBReadAheadMs", 1500).toInt();
     settings.syncOnLoad = config.value("Decks/SyncOnLoad", false).toBool();
+    settings.autoCue = config.value("Decks/AutoCue", true).toBool();
     settings.autoGainAdjust = config.value("Decks/AutoGainAdjust", true).toBool();
     settings.loopLengthDefault = config.value("Decks/LoopLengthDefault", 4).toInt();
     settings.scratchSensitivity = config.value("Decks/ScratchSensitivity", 50).toInt();
@@ -712,6 +865,8 @@ void PreferencesDialog::loadSettings() {
     settings.showBeatNumbers = config.value("Interface/ShowBeatNumbers", false).toBool();
     settings.animatedWaveforms = config.value("Interface/AnimatedWaveforms", true).toBool();
     settings.waveformQuality = config.value("Interface/WaveformQuality", 75).toInt();
+    settings.waveformStyle = config.value("Interface/WaveformStyle", 0).toInt();
+    settings.showPhaseCompare = config.value("Interface/ShowPhaseCompare", false).toBool();
     settings.fullscreenMode = config.value("Interface/FullscreenMode", false).toBool();
     
     // Load Library settings
@@ -719,16 +874,27 @@ void PreferencesDialog::loadSettings() {
                                        QStandardPaths::writableLocation(QStandardPaths::MusicLocation)).toString();
     settings.cachePath = config.value("Library/CachePath", 
                                      AppConfig::instance().getConfigDirectory() + "/cache").toString();
+    settings.sharedCachePath = config.value("Library/SharedCachePath", "").toString();
     settings.autoScanOnStartup = config.value("Library/AutoScanOnStartup", true).toBool();
     settings.deepAnalysis = config.value("Library/DeepAnalysis", true).toBool();
+    settings.detectDuplicates = config.value("Library/DetectDuplicates", true).toBool();
     settings.autoCreateWaveforms = config.value("Library/AutoCreateWaveforms", true).toBool();
     settings.maxRecentTracks = config.value("Library/MaxRecentTracks", 20).toInt();
     settings.sortDefault = config.value("Library/SortDefault", "Artist").toString();
+    settings.showWaveformColumn = config.value("Library/ShowWaveforms", false).toBool();
+    settings.fuzzySearch = config.value("Library/FuzzySearch", true).toBool();
     
     // Load Performance settings
     settings.cpuCores = config.value("Performance/CpuCores", -1).toInt();
     settings.memoryLimitMB = config.value("Performance/MemoryLimitMB", 1024).toInt();
+    settings.decodeTracksToRam = config.value("Performance/DecodeTracksToRam", false).toBool();
+    settings.compressTracksInRam = config.value("Performance/CompressTracksInRam", true).toBool();
+    settings.prepareSamplesInRam = config.value("Performance/PrepareSamplesInRam", false).toBool();
+    settings.pluginCpuBudget = config.value("Plugins/CpuBudgetPercent", 30).toInt();
+    settings.sandboxedPlugins = config.value("Plugins/Sandboxed", "").toString();
+    settings.memoryMapUncompressed = config.value("Performance/MemoryMapUncompressed", true).toBool();
     settings.threadPriority = config.value("Performance/ThreadPriority", 50).toInt();
+    settings.lowPowerOnBattery = config.value("Performance/LowPowerOnBattery", true).toBool();
     settings.enableGpuAcceleration = config.value("Performance/EnableGpuAcceleration", true).toBool();
     settings.lowLatencyMode = config.value("Performance/LowLatencyMode", false).toBool();
     settings.renderQuality = config.value("Performance/RenderQuality", "High").toString();
@@ -753,18 +919,26 @@ void PreferencesDialog::saveSettings() {
     config.setValue("Audio/BufferSize", bufferSizeCombo->currentText().toInt());
     config.setValue("Audio/SampleRate", sampleRateCombo->currentText().toInt());
     config.setValue("Audio/KeylockQuality", keylockQualityCombo->currentIndex());
+    config.setValue("Audio/VarispeedQuality", varispeedQualityCombo->currentIndex());
+    config.setValue("Performance/KeylockAutoQuality", keylockAutoQualityCheck->isChecked());
     config.setValue("Audio/ExclusiveMode", exclusiveModeCheck->isChecked());
     config.setValue("Audio/MasterVolume", masterVolumeSlider->value() / 100.0);
     config.setValue("Audio/HeadphoneVolume", headphoneVolumeSlider->value() / 100.0);
+    config.setValue("Audio/HeadphoneCueOutput", headphoneCueOutputCheck->isChecked());
+    config.setValue("Audio/CueDevice", cueDeviceCombo->currentIndex() > 0 ? cueDeviceCombo->currentText() : QString());
+    config.setValue("Audio/CrossfaderCurve", crossfaderCurveCombo->currentIndex());
     
     // Save Deck settings
     config.setValue("Decks/DeckAKeylockDefault", deckAKeylockDefault->isChecked());
     config.setValue("Decks/DeckAQuantizeDefault", deckAQuantizeDefault->isChecked());
     config.setValue("Decks/DeckASpeedDefault", deckASpeedDefault->value());
+    config.setValue("Decks/DeckAReadAheadMs", deckAReadAheadMs->value());
     config.setValue("Decks/DeckBKeylockDefault", deckBKeylockDefault->isChecked());
     config.setValue("Decks/DeckBQuantizeDefault", deckBQuantizeDefault->isChecked());
     config.setValue("Decks/DeckBSpeedDefault", deckBSpeedDefault->value());
+    config.setValue("Decks/DeckBReadAheadMs", deckBReadAheadMs->value());
     config.setValue("Decks/SyncOnLoad", syncOnLoad->isChecked());
+    config.setValue("Decks/AutoCue", autoCue->isChecked());
     config.setValue("Decks/AutoGainAdjust", autoGainAdjust->isChecked());
     config.setValue("Decks/LoopLengthDefault", loopLengthDefault->value());
     config.setValue("Decks/ScratchSensitivity", scratchSensitivity->currentIndex());
@@ -779,21 +953,35 @@ void PreferencesDialog::saveSettings() {
     config.setValue("Interface/ShowBeatNumbers", showBeatNumbers->isChecked());
     config.setValue("Interface/AnimatedWaveforms", animatedWaveforms->isChecked());
     config.setValue("Interface/WaveformQuality", waveformQualitySlider->value());
+    config.setValue("Interface/WaveformStyle", waveformStyleCombo->currentIndex());
+    config.setValue("Interface/ShowPhaseCompare", showPhaseCompare->isChecked());
     config.setValue("Interface/FullscreenMode", fullscreenMode->isChecked());
     
     // Save Library settings
     config.setValue("Library/Path", libraryPathEdit->text());
     config.setValue("Library/CachePath", cachePathEdit->text());
+    config.setValue("Library/SharedCachePath", sharedCachePathEdit->text().trimmed());
     config.setValue("Library/AutoScanOnStartup", autoScanOnStartup->isChecked());
     config.setValue("Library/DeepAnalysis", deepAnalysis->isChecked());
+    config.setValue("Library/DetectDuplicates", detectDuplicates->isChecked());
     config.setValue("Library/AutoCreateWaveforms", autoCreateWaveforms->isChecked());
     config.setValue("Library/MaxRecentTracks", maxRecentTracks->value());
     config.setValue("Library/SortDefault", sortDefaultCombo->currentText());
+    config.setValue("Library/ShowWaveforms", showWaveformColumn->isChecked());
+    config.setValue("Library/FuzzySearch", fuzzySearch->isChecked());
     
     // Save Performance settings
     config.setValue("Performance/CpuCores", cpuCoresSpinBox->value());
     config.setValue("Performance/MemoryLimitMB", memoryLimitSpinBox->value());
+    MemoryBudget::getInstance().setLimitBytes((int64_t) memoryLimitSpinBox->value() * 1024 * 1024);
+    config.setValue("Performance/DecodeTracksToRam", decodeTracksToRam->isChecked());
+    config.setValue("Performance/CompressTracksInRam", compressTracksInRam->isChecked());
+    config.setValue("Performance/PrepareSamplesInRam", prepareSamplesInRam->isChecked());
+    config.setValue("Plugins/CpuBudgetPercent", pluginCpuBudget->value());
+    config.setValue("Plugins/Sandboxed", sandboxedPlugins->text().trimmed());
+    config.setValue("Performance/MemoryMapUncompressed", memoryMapUncompressed->isChecked());
     config.setValue("Performance/ThreadPriority", threadPrioritySlider->value());
+    config.setValue("Performance/LowPowerOnBattery", lowPowerOnBattery->isChecked());
     config.setValue("Performance/EnableGpuAcceleration", enableGpuAcceleration->isChecked());
     config.setValue("Performance/LowLatencyMode", lowLatencyMode->isChecked());
     config.setValue("Performance/RenderQuality", renderQualityCombo->currentText());
@@ -832,9 +1020,17 @@ void PreferencesDialog::updateUIFromSettings() {
     bufferSizeCombo->setCurrentText(QString::number(settings.bufferSize));
     sampleRateCombo->setCurrentText(QString::number(settings.sampleRate));
     keylockQualityCombo->setCurrentIndex(settings.keylockQuality);
+    varispeedQualityCombo->setCurrentIndex(settings.varispeedQuality);
+    keylockAutoQualityCheck->setChecked(settings.keylockAutoQuality);
     exclusiveModeCheck->setChecked(settings.exclusiveMode);
     masterVolumeSlider->setValue(static_cast<int>(settings.masterVolume * 100));
     headphoneVolumeSlider->setValue(static_cast<int>(settings.headphoneVolume * 100));
+    headphoneCueOutputCheck->setChecked(settings.headphoneCueOutput);
+    crossfaderCurveCombo->setCurrentIndex(qBound(0, settings.crossfaderCurve, 2));
+    {
+        const int index = settings.cueDevice.isEmpty() ? 0 : cueDeviceCombo->findText(settings.cueDevice);
+        cueDeviceCombo->setCurrentIndex(qMax(0, index));
+    }
     updateVolumeLabel(masterVolumeSlider, masterVolumeLabel, "");
     updateVolumeLabel(headphoneVolumeSlider, headphoneVolumeLabel, "");
     
@@ -842,10 +1038,13 @@ void PreferencesDialog::updateUIFromSettings() {
     deckAKeylockDefault->setChecked(settings.deckAKeylockDefault);
     deckAQuantizeDefault->setChecked(settings.deckAQuantizeDefault);
     deckASpeedDefault->setValue(settings.deckASpeedDefault);
+    deckAReadAheadMs->setValue(settings.deckAReadAheadMs);
     deckBKeylockDefault->setChecked(settings.deckBKeylockDefault);
     deckBQuantizeDefault->setChecked(settings.deckBQuantizeDefault);
     deckBSpeedDefault->setValue(settings.deckBSpeedDefault);
+    deckBReadAheadMs->setValue(settings.deckBReadAheadMs);
     syncOnLoad->setChecked(settings.syncOnLoad);
+    autoCue->setChecked(settings.autoCue);
     autoGainAdjust->setChecked(settings.autoGainAdjust);
     loopLengthDefault->setValue(settings.loopLengthDefault);
     scratchSensitivity->setCurrentIndex(settings.scratchSensitivity);
@@ -865,22 +1064,35 @@ void PreferencesDialog::updateUIFromSettings() {
     showBeatNumbers->setChecked(settings.showBeatNumbers);
     animatedWaveforms->setChecked(settings.animatedWaveforms);
     waveformQualitySlider->setValue(settings.waveformQuality);
+    waveformStyleCombo->setCurrentIndex(settings.waveformStyle);
+    showPhaseCompare->setChecked(settings.showPhaseCompare);
     fullscreenMode->setChecked(settings.fullscreenMode);
     
     // Library
     libraryPathEdit->setText(settings.libraryPath);
     cachePathEdit->setText(settings.cachePath);
+    sharedCachePathEdit->setText(settings.sharedCachePath);
     autoScanOnStartup->setChecked(settings.autoScanOnStartup);
     deepAnalysis->setChecked(settings.deepAnalysis);
+    detectDuplicates->setChecked(settings.detectDuplicates);
     autoCreateWaveforms->setChecked(settings.autoCreateWaveforms);
     maxRecentTracks->setValue(settings.maxRecentTracks);
     int sortIndex = sortDefaultCombo->findText(settings.sortDefault);
     if (sortIndex >= 0) sortDefaultCombo->setCurrentIndex(sortIndex);
+    showWaveformColumn->setChecked(settings.showWaveformColumn);
+    fuzzySearch->setChecked(settings.fuzzySearch);
     
     // Performance
     cpuCoresSpinBox->setValue(settings.cpuCores);
     memoryLimitSpinBox->setValue(settings.memoryLimitMB);
+    decodeTracksToRam->setChecked(settings.decodeTracksToRam);
+    compressTracksInRam->setChecked(settings.compressTracksInRam);
+    prepareSamplesInRam->setChecked(settings.prepareSamplesInRam);
+    pluginCpuBudget->setValue(settings.pluginCpuBudget);
+    sandboxedPlugins->setText(settings.sandboxedPlugins);
+    memoryMapUncompressed->setChecked(settings.memoryMapUncompressed);
     threadPrioritySlider->setValue(settings.threadPriority);
+    lowPowerOnBattery->setChecked(settings.lowPowerOnBattery);
     enableGpuAcceleration->setChecked(settings.enableGpuAcceleration);
     lowLatencyMode->setChecked(settings.lowLatencyMode);
     int renderIndex = renderQualityCombo->findText(settings.renderQuality);
@@ -896,6 +1108,22 @@ void PreferencesDialog::updateUIFromSettings() {
 }
 
 // Helper methods
+void PreferencesDialog::updateMemoryUsage() {
+    const auto& budget = MemoryBudget::getInstance();
+    auto mb = [](int64_t bytes) { return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB"; };
+    QString text = "<table>";
+    for (int i = 0; i < MemoryBudget::NumPools; ++i) {
+        const auto pool = (MemoryBudget::Pool) i;
+        text += QString("<tr><td>%1</td><td align=\"right\">&nbsp;&nbsp;%2</td></tr>")
+                    .arg(QString::fromUtf8(MemoryBudget::getPoolName(pool)), mb(budget.getBytes(pool)));
+    }
+    const int64_t total = budget.getTotalBytes();
+    const int64_t limit = budget.getLimitBytes();
+    text += QString("<tr><td><b>Total</b></td><td align=\"right\">&nbsp;&nbsp;<b%1>%2</b> of %3</td></tr></table>")
+                .arg(total > limit ? QString(" style=\"color:#e05050\"") : QString(), mb(total), mb(limit));
+    memoryUsageLabel->setText(text);
+}
+
 void PreferencesDialog::updateVolumeLabel(QSlider* slider, QLabel* label, const QString& prefix) {
     label->setText(prefix + QString::number(slider->value()) + "%");
 }
@@ -917,11 +1145,14 @@ QString PreferencesDialog::formatFontName(const QFont& font) {
 }
 
 void PreferencesDialog::populateAudioDevices() {
-    audioDeviceCombo->addItem("Default Audio Device");
-    audioDeviceCombo->addItem("ASIO Driver");
-    audioDeviceCombo->addItem("DirectSound");
-    audioDeviceCombo->addItem("WASAPI");
-    // Add more devices as detected by the system
+    audioDeviceCombo->addItem(AudioDeviceConfig::DefaultDeviceName);
+    cueDeviceCombo->addItem("None");
+    // A scan of its own: no device is opened, and the running one is left alone
+    juce::AudioDeviceManager scan;
+    for (const auto& name : AudioDeviceConfig::listOutputDevices(scan)) {
+        audioDeviceCombo->addItem(QString::fromStdString(name.toStdString()));
+        cueDeviceCombo->addItem(QString::fromStdString(name.toStdString()));
+    }
 }
 
 void PreferencesDialog::populateThemes() {
@@ -22,6 +22,7 @@
 #include <QStyleFactory>
 #include <QColorDialog>
 #include <QFontDialog>
+#include <QTimer>
 #include "DeckSettings.h"
 #include "AppConfig.h"
 
@@ -105,21 +106,29 @@ private:
     QComboBox* bufferSizeCombo;
     QComboBox* sampleRateCombo;
     QComboBox* keylockQualityCombo;
+    QComboBox* varispeedQualityCombo;
+    QCheckBox* keylockAutoQualityCheck;
     QCheckBox* exclusiveModeCheck;
     QSlider* masterVolumeSlider;
     QLabel* masterVolumeLabel;
     QSlider* headphoneVolumeSlider;
     QLabel* headphoneVolumeLabel;
+    QCheckBox* headphoneCueOutputCheck;
+    QComboBox* cueDeviceCombo;
+    QComboBox* crossfaderCurveCombo;
     
     // === DECK TAB ===
     QWidget* deckTab;
     QCheckBox* deckAKeylockDefault;
     QCheckBox* deckAQuantizeDefault;
     QDoubleSpinBox* deckASpeedDefault;
+    QSpinBox* deckAReadAheadMs;
     QCheckBox* deckBKeylockDefault;
     QCheckBox* deckBQuantizeDefault;
     QDoubleSpinBox* deckBSpeedDefault;
+    QSpinBox* deckBReadAheadMs;
     QCheckBox* syncOnLoad;
+    QCheckBox* autoCue;
     QCheckBox* autoGainAdjust;
     QSpinBox* loopLengthDefault;
     QComboBox* scratchSensitivity;
@@ -136,6 +145,8 @@ private:
     QCheckBox* showBeatNumbers;
     QCheckBox* animatedWaveforms;
     QSlider* waveformQualitySlider;
+    QComboBox* waveformStyleCombo;
+    QCheckBox* showPhaseCompare;
     QCheckBox* fullscreenMode;
     
     // === LIBRARY TAB ===
@@ -144,24 +155,38 @@ private:
     QPushButton* libraryPathButton;
     QLineEdit* cachePathEdit;
     QPushButton* cachePathButton;
+    QLineEdit* sharedCachePathEdit;
+    QPushButton* sharedCachePathButton;
     QCheckBox* autoScanOnStartup;
     QCheckBox* deepAnalysis;
+    QCheckBox* detectDuplicates;
     QCheckBox* autoCreateWaveforms;
     QPushButton* rescanButton;
     QPushButton* clearCacheButton;
     QSpinBox* maxRecentTracks;
     QComboBox* sortDefaultCombo;
+    QCheckBox* showWaveformColumn;
+    QCheckBox* fuzzySearch;
     
     // === PERFORMANCE TAB ===
     QWidget* performanceTab;
     QSpinBox* cpuCoresSpinBox;
     QSpinBox* memoryLimitSpinBox;
+    QCheckBox* decodeTracksToRam;
+    QCheckBox* compressTracksInRam;
+    QCheckBox* prepareSamplesInRam;
+    QSpinBox* pluginCpuBudget;
+    QLineEdit* sandboxedPlugins;
+    QCheckBox* memoryMapUncompressed;
     QSlider* threadPrioritySlider;
+    QCheckBox* lowPowerOnBattery;
     QCheckBox* enableGpuAcceleration;
     QCheckBox* lowLatencyMode;
     QComboBox* renderQualityCombo;
     QCheckBox* backgroundProcessing;
     QSlider* diskCacheSlider;
+    QLabel* memoryUsageLabel;   // live MemoryBudget breakdown
+    QTimer* memoryUsageTimer;
     
     // === ADVANCED TAB ===
     QWidget* advancedTab;
@@ -181,18 +206,26 @@ private:
         int bufferSize = 512;
         int sampleRate = 44100;
         int keylockQuality = 1; // 0=Fast, 1=Balanced, 2=Quality
+        int varispeedQuality = 1; // 0=Linear, 1=High Quality (sinc)
+        bool keylockAutoQuality = true; // step keylock quality down under CPU load
         bool exclusiveMode = false;
         double masterVolume = 0.8;
         double headphoneVolume = 0.7;
+        bool headphoneCueOutput = false; // cue bus on outputs 3/4
+        QString cueDevice;               // cue bus on a second device, drift-compensated; empty = none
+        int crossfaderCurve = 1;         // 0=Smooth, 1=Dipless, 2=Scratch cut
         
         // Decks
         bool deckAKeylockDefault = false;
         bool deckAQuantizeDefault = false;
         double deckASpeedDefault = 1.0;
+        int deckAReadAheadMs = 1500;
         bool deckBKeylockDefault = false;
         bool deckBQuantizeDefault = false;
         double deckBSpeedDefault = 1.0;
+        int deckBReadAheadMs = 1500;
         bool syncOnLoad = false;
+        bool autoCue = true;
         bool autoGainAdjust = true;
         int loopLengthDefault = 4;
         int scratchSensitivity = 50;
@@ -208,21 +241,34 @@ private:
         bool showBeatNumbers = false;
         bool animatedWaveforms = true;
         int waveformQuality = 75;
+        int waveformStyle = 0;   // WaveformDisplay::DisplayStyle: 0=Waveform, 1=Spectrogram
+        bool showPhaseCompare = false;
         bool fullscreenMode = false;
         
         // Library
         QString libraryPath;
         QString cachePath;
+        QString sharedCachePath;   // SharedCache root; empty = off
         bool autoScanOnStartup = true;
         bool deepAnalysis = true;
+        bool detectDuplicates = true;
         bool autoCreateWaveforms = true;
         int maxRecentTracks = 20;
         QString sortDefault = "Artist";
+        bool showWaveformColumn = false;
+        bool fuzzySearch = true;
         
         // Performance
         int cpuCores = -1; // -1 = auto-detect
         int memoryLimitMB = 1024;
+        bool decodeTracksToRam = false;
+        bool compressTracksInRam = true;
+        bool prepareSamplesInRam = false;
+        int pluginCpuBudget = 30;        // Plugins/CpuBudgetPercent
+        QString sandboxedPlugins;        // Plugins/Sandboxed, comma-separated name fragments
+        bool memoryMapUncompressed = true;
         int threadPriority = 50;
+        bool lowPowerOnBattery = true; // frame rate cap and one analysis worker on battery
         bool enableGpuAcceleration = true;
         bool lowLatencyMode = false;
         QString renderQuality = "High";
@@ -240,6 +286,7 @@ private:
     
     // Helper methods
     void updateVolumeLabel(QSlider* slider, QLabel* label, const QString& prefix);
+    void updateMemoryUsage();
     void setColorButtonColor(QPushButton* button, const QColor& color);
     QColor getColorFromButton(QPushButton* button);
     QString formatFontName(const QFont& font);
@@ -0,0 +1,201 @@
+#include "PreviewPlayer.h"
+#include "DeckReadAheadSource.h"
+#include "DecoderRegistry.h"
+#include "HotTrackCache.h"
+#include "RealtimeReclaimer.h"
+#include <algorithm>
+#include <cmath>
+
+PreviewPlayer::Chain::~Chain() = default;
+
+PreviewPlayer::~PreviewPlayer()
+{
+    release();
+}
+
+bool PreviewPlayer::play(const juce::File& file, double fraction)
+{
+    collectGarbage();
+
+    auto chain = std::make_unique<Chain>();
+    chain->file = file;
+    chain->sampleRate = deviceRate.load();
+    chain->blockSize = std::max(1, maxBlock.load());
+
+    // Decoded samples if a deck or the prefetcher left them in the cache, else the file
+    const auto cached = HotTrackCache::getInstance().find(file);
+    juce::AudioFormatReader* reader = nullptr;
+    if (cached.samples) reader = cached.samples->createView().release();
+    else if (readAheadThread != nullptr) reader = DecoderRegistry::getInstance().getFormatManager().createReaderFor(file);
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0) {
+        delete reader;
+        return false;
+    }
+
+    const double fileRate = reader->sampleRate;
+    chain->length = reader->lengthInSamples;
+    chain->readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+    chain->source = chain->readerSource.get();
+    if (!cached.samples) {
+        chain->readAhead = std::make_unique<DeckReadAheadSource>(chain->readerSource.get(), *readAheadThread,
+                                                                 (int) (fileRate * ReadAheadSeconds));
+        chain->source = chain->readAhead.get();
+    }
+
+    const juce::int64 start = juce::jlimit<juce::int64>(0, chain->length - 1, (juce::int64) (fraction * (double) chain->length));
+    chain->source->setNextReadPosition(start);
+    chain->position.store(start);
+    chain->resampler = std::make_unique<juce::ResamplingAudioSource>(chain->source, false, 2);
+    chain->resampler->setResamplingRatio(fileRate / chain->sampleRate);
+    chain->resampler->prepareToPlay(chain->blockSize, chain->sampleRate);
+    chain->scratch.setSize(2, chain->blockSize);
+
+    chains.push_back(std::move(chain));
+    target.store(chains.back().get());
+    return true;
+}
+
+void PreviewPlayer::seek(double fraction)
+{
+    Chain* chain = target.load();
+    if (chain == nullptr) return;
+    const juce::int64 position = juce::jlimit<juce::int64>(0, chain->length - 1, (juce::int64) (fraction * (double) chain->length));
+    // Read on the read-ahead thread while the playing position fades out
+    if (chain->readAhead) chain->readAhead->setPrefetchRegion(DeckReadAheadSource::CueSlot, position);
+    chain->seekTo.store(position);
+}
+
+void PreviewPlayer::stop()
+{
+    target.store(nullptr);
+    collectGarbage();
+}
+
+juce::File PreviewPlayer::getFile() const
+{
+    const Chain* chain = target.load();
+    return chain != nullptr ? chain->file : juce::File();
+}
+
+bool PreviewPlayer::isPlaying() const
+{
+    const Chain* chain = target.load();
+    return chain != nullptr && (!chain->ended.load() || chain->seekTo.load() >= 0);
+}
+
+double PreviewPlayer::getPosition() const
+{
+    const Chain* chain = target.load();
+    if (chain == nullptr) return 0.0;
+    const juce::int64 seek = chain->seekTo.load();
+    return (double) (seek >= 0 ? seek : chain->position.load()) / (double) chain->length;
+}
+
+void PreviewPlayer::collectGarbage()
+{
+    // target is stored before playing is read here, and the other way round on the audio
+    // thread, so a chain it is about to take is either still wanted or seen as taken
+    const Chain* wanted = target.load();
+    const Chain* held = playing.load();
+    for (auto it = chains.begin(); it != chains.end();) {
+        if (it->get() != wanted && it->get() != held) {
+            RealtimeReclaimer::getInstance().retire(std::move(*it));
+            it = chains.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PreviewPlayer::release()
+{
+    target.store(nullptr);
+    playing.store(nullptr);
+    current = nullptr;
+    if (chains.empty()) return;
+    for (auto& chain : chains) RealtimeReclaimer::getInstance().retire(std::move(chain));
+    chains.clear();
+    RealtimeReclaimer::getInstance().flush();
+}
+
+void PreviewPlayer::prepare(double sampleRate, int maximumBlockSize)
+{
+    if (sampleRate > 0.0) deviceRate.store(sampleRate);
+    if (maximumBlockSize > 0) maxBlock.store(maximumBlockSize);
+}
+
+void PreviewPlayer::jump(Chain& chain, juce::int64 position) noexcept
+{
+    chain.resampler->flushBuffers();
+    chain.source->setNextReadPosition(position);
+    chain.position.store(position);
+    chain.ended.store(false);
+}
+
+void PreviewPlayer::renderAdding(float* const* output, int numChannels, int numSamples) noexcept
+{
+    const int channels = std::min(numChannels, 2);
+    const double rate = deviceRate.load(std::memory_order_relaxed);
+    const float level = gain.load(std::memory_order_relaxed);
+    const float step = 1.0f / std::max(1.0f, (float) (FadeSeconds * rate));
+
+    int done = 0;
+    while (done < numSamples) {
+        Chain* wanted = target.load();
+        const bool leaving = current != wanted || (current != nullptr && current->seekTo.load(std::memory_order_relaxed) >= 0);
+        if (leaving && (current == nullptr || envelope <= 0.0f || current->ended.load(std::memory_order_relaxed))) {
+            // Faded out: take the other chain or position
+            envelope = 0.0f;
+            if (current != wanted) {
+                current = wanted;
+                playing.store(current);
+                // Replaced again before it was taken, so it may be retired already
+                if (current != nullptr && target.load() != current) {
+                    current = nullptr;
+                    playing.store(nullptr);
+                    continue;
+                }
+            }
+            if (current == nullptr) return;
+            const juce::int64 seek = current->seekTo.exchange(-1);
+            if (seek >= 0) jump(*current, seek);
+            continue;
+        }
+        if (current == nullptr || current->ended.load(std::memory_order_relaxed)) return;
+        if (current->sampleRate != rate) {
+            // Prepared for a device that is gone; the next play() builds for this one
+            current->ended.store(true);
+            return;
+        }
+
+        int n = std::min(numSamples - done, current->blockSize);
+        if (leaving) n = std::min(n, (int) std::ceil(envelope / step));
+        const juce::AudioSourceChannelInfo info(&current->scratch, 0, n);
+        current->resampler->getNextAudioBlock(info);
+
+        const float delta = leaving ? -step : step;
+        float faded = envelope;
+        for (int ch = 0; ch < channels; ++ch) {
+            const float* in = current->scratch.getReadPointer(ch);
+            float* out = output[ch] + done;
+            if (envelope >= 1.0f && !leaving) {
+                juce::FloatVectorOperations::addWithMultiply(out, in, level, n);
+                continue;
+            }
+            faded = envelope;
+            for (int i = 0; i < n; ++i) {
+                faded = juce::jlimit(0.0f, 1.0f, faded + delta);
+                out[i] += in[i] * faded * level;
+            }
+        }
+        envelope = faded;
+
+        const juce::int64 position = current->source->getNextReadPosition();
+        current->position.store(std::min(position, current->length));
+        if (position >= current->length) {
+            current->ended.store(true);
+            envelope = 0.0f;
+        }
+        done += n;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class DeckReadAheadSource;
+
+/**
+ * Headphone preview of a library track, mixed by DeckMixer into the cue bus after the cued
+ * strips, so it follows the headphone level and cue/master blend like a cued deck would.
+ *
+ * A preview is a voice of its own: a reader, a resampler to the device rate and a short fade
+ * envelope. It never touches a deck, its transport or the stretcher pool. A track in the
+ * HotTrackCache plays from a view over its decoded samples, so a seek is a position change;
+ * anything else streams through a DeckReadAheadSource on the decks' read-ahead thread.
+ *
+ * The UI builds the whole chain and publishes it with one pointer store. The audio thread fades
+ * whatever it plays out over FadeSeconds before it switches to another chain or position and
+ * fades the new one in, so scrubbing by dragging across the mini waveform jumps without clicks.
+ * Chains the audio thread has moved on from are retired through the RealtimeReclaimer by
+ * collectGarbage() (any UI call does it too).
+ *
+ * Without a headphone output (a stereo device) there is no cue bus and the preview is silent.
+ */
+class PreviewPlayer {
+public:
+    static constexpr double FadeSeconds = 0.004;
+    // Streamed read-ahead, at the file's rate
+    static constexpr double ReadAheadSeconds = 2.0;
+
+    PreviewPlayer() = default;
+    ~PreviewPlayer();
+
+    PreviewPlayer(const PreviewPlayer&) = delete;
+    PreviewPlayer& operator=(const PreviewPlayer&) = delete;
+
+    // UI thread. Streamed previews decode ahead here (not owned, outlives the player; without it
+    // only cached tracks preview)
+    void setReadAheadThread(juce::TimeSliceThread* thread) { readAheadThread = thread; }
+    // Starts `file` at `fraction` of its length, replacing what was previewing; false if it
+    // can't be opened
+    bool play(const juce::File& file, double fraction);
+    // Same track: jumps there, restarting it if it had played to the end
+    void seek(double fraction);
+    void stop();
+    juce::File getFile() const;
+    // Playing or fading in; false once the track ran out
+    bool isPlaying() const;
+    // Where the audio thread is, or the seek it hasn't taken yet; 0..1
+    double getPosition() const;
+    void setGain(float newGain) { gain.store(juce::jlimit(0.0f, 1.0f, newGain)); }
+    // Retires the chains the audio thread has moved on from
+    void collectGarbage();
+    // Shutdown, before the read-ahead thread stops: retires every chain and waits for them
+    void release();
+
+    // Audio thread (DeckMixer). A changed rate or block size applies to the next play()
+    void prepare(double sampleRate, int maximumBlockSize);
+    // Adds the preview to a stereo (or mono) bus
+    void renderAdding(float* const* output, int numChannels, int numSamples) noexcept;
+
+private:
+    struct Chain {
+        juce::File file;
+        std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+        std::unique_ptr<DeckReadAheadSource> readAhead;           // streamed only
+        juce::PositionableAudioSource* source{nullptr};          // readAhead or readerSource
+        std::unique_ptr<juce::ResamplingAudioSource> resampler;
+        juce::AudioBuffer<float> scratch;                        // 2 x blockSize
+        juce::int64 length{0};
+        double sampleRate{0.0};                                  // the device's, prepared for
+        int blockSize{0};
+        std::atomic<juce::int64> seekTo{-1};                     // UI -> audio
+        std::atomic<juce::int64> position{0};                    // audio -> UI
+        std::atomic<bool> ended{false};
+        ~Chain();
+    };
+
+    Chain* live() const { return chains.empty() ? nullptr : chains.back().get(); }
+    static void jump(Chain& chain, juce::int64 position) noexcept;
+
+    juce::TimeSliceThread* readAheadThread{nullptr};
+    // UI side: every chain not retired yet, the live one last (nullptr published when stopped)
+    std::vector<std::unique_ptr<Chain>> chains;
+    bool stopped{true};
+
+    std::atomic<Chain*> target{nullptr};     // UI -> audio: what should play
+    std::atomic<Chain*> playing{nullptr};    // audio -> UI: what the audio thread holds
+    std::atomic<float> gain{1.0f};
+    std::atomic<double> deviceRate{44100.0};
+    std::atomic<int> maxBlock{512};
+
+    // Audio side
+    Chain* current{nullptr};
+    float envelope{0.0f};
+};
@@ -1,5 +1,7 @@
 #include "QtDeckWidget.h"
+#include "ArtworkCache.h"
 #include "DJAudioPlayer.h"
+#include "TrackDragMimeData.h"
 #include "WaveformGenerator.h"
 #include <QHBoxLayout>
 #include <QVBoxLayout>
@@ -55,13 +57,16 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     cueBtn = new QPushButton("Cue", controlsWidget);
     keylockBtn = new QPushButton("Key", controlsWidget);
     quantizeBtn = new QPushButton("Q", controlsWidget);
+    slipBtn = new QPushButton("Slip", controlsWidget);
     syncBtn = new QPushButton("Sync", controlsWidget);
     speedSlider = new QSlider(Qt::Vertical, controlsWidget);
     tempoValueLabel = new QLabel("1.000x", controlsWidget);
     tempoSpin = new QDoubleSpinBox(controlsWidget);
+    keyShiftSpin = new QSpinBox(controlsWidget);
     bpmDefaultLabel = new QLabel("BPM: --", controlsWidget);
     bpmCurrentLabel = new QLabel("Curr: --", controlsWidget);
     speedLabel = new QLabel("Speed", controlsWidget);
+    viewModel.bindTempoLabels(bpmDefaultLabel, bpmCurrentLabel, tempoValueLabel);
 
     // Style the controls (more compact)
     playPauseBtn->setStyleSheet("QPushButton { background-color: #0066cc; color: white; border: none; padding: 4px; font-weight: bold; border-radius: 0px; font-size: 10px; } QPushButton:hover { background-color: #0052a3; }");
@@ -69,15 +74,18 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     cueBtn->setStyleSheet("QPushButton { background-color: #ff6600; color: white; border: none; padding: 4px; border-radius: 0px; font-size: 10px; } QPushButton:hover { background-color: #e55a00; }");
     keylockBtn->setStyleSheet("QPushButton { background-color: #333; color: white; border: none; padding: 4px; border-radius: 0px; font-size: 10px; } QPushButton:hover { background-color: #444; } QPushButton:checked { background-color: #00cc66; }");
     quantizeBtn->setStyleSheet("QPushButton { background-color: #333; color: white; border: none; padding: 4px; border-radius: 0px; font-size: 10px; } QPushButton:hover { background-color: #444; } QPushButton:checked { background-color: #cc6600; }");
+    slipBtn->setStyleSheet("QPushButton { background-color: #333; color: white; border: none; padding: 4px; border-radius: 0px; font-size: 10px; } QPushButton:hover { background-color: #444; } QPushButton:checked { background-color: #aa2299; }");
     syncBtn->setStyleSheet("QPushButton { background-color: #008844; color: white; border: none; padding: 4px; border-radius: 0px; font-size: 10px; } QPushButton:hover { background-color: #00733a; } QPushButton:checked { background-color: #00aa55; }");
     
     // Make keylock and quantize buttons checkable
     keylockBtn->setCheckable(true);
     quantizeBtn->setCheckable(true);
+    slipBtn->setCheckable(true);
     
     // Add tooltips
     keylockBtn->setToolTip("Keylock - maintains original pitch when speed changes");
     quantizeBtn->setToolTip("Quantize - snaps cues and loops to nearest beat");
+    slipBtn->setToolTip("Slip - track keeps running during scratch, loops and held hot cues; playback returns there on release");
     syncBtn->setToolTip("Sync tempo & phase to the other deck");
     
     // Tempo fader: ±16% with 0.001 precision via slider
@@ -92,6 +100,12 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     tempoSpin->setSingleStep(0.0005);
     tempoSpin->setValue(1.0000);
     tempoSpin->setKeyboardTracking(false);
+    // Key shift: whole semitones, "+2 st"; 0 leaves the stretcher off unless keylock is on
+    keyShiftSpin->setRange((int) -DJAudioPlayer::MaxKeyShift, (int) DJAudioPlayer::MaxKeyShift);
+    keyShiftSpin->setValue(0);
+    keyShiftSpin->setSuffix(" st");
+    keyShiftSpin->setKeyboardTracking(false);
+    keyShiftSpin->setToolTip("Key shift in semitones - moves the key without changing the tempo");
     
     speedLabel->setStyleSheet("color: #fff; font-size: 9px; font-weight: bold;");
     bpmDefaultLabel->setStyleSheet("color: #0088ff; font-size: 9px; font-weight: bold;");
@@ -105,12 +119,14 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     connect(cueBtn, &QPushButton::released, this, &QtDeckWidget::onCueReleased);
     connect(keylockBtn, &QPushButton::clicked, this, &QtDeckWidget::onKeylockToggle);
     connect(quantizeBtn, &QPushButton::clicked, this, &QtDeckWidget::onQuantizeToggle);
+    connect(slipBtn, &QPushButton::clicked, this, &QtDeckWidget::onSlipToggle);
     syncBtn->setCheckable(true);
     connect(syncBtn, &QPushButton::clicked, this, &QtDeckWidget::onSync);          // immediate one-shot sync
     connect(syncBtn, &QPushButton::toggled, this, &QtDeckWidget::onSyncToggled);   // follow mode on/off
     connect(speedSlider, &QSlider::valueChanged, this, &QtDeckWidget::onSpeedChanged);
     // Two-way bind spin <-> slider
     connect(tempoSpin, qOverload<double>(&QDoubleSpinBox::valueChanged), this, &QtDeckWidget::onTempoSpinChanged);
+    connect(keyShiftSpin, qOverload<int>(&QSpinBox::valueChanged), this, &QtDeckWidget::onKeyShiftChanged);
     // Double-click reset on slider
     speedSlider->installEventFilter(this);
     
@@ -134,14 +150,25 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     controlsLayout->setSpacing(2);  // Reduced from 3
     controlsLayout->setContentsMargins(4, 4, 4, 4);  // Reduced from 6
     
-    // Header section: Title and track name
-    auto headerLayout = new QVBoxLayout;
-    headerLayout->setSpacing(1);
+    // Header section: cover art next to title and track name
+    auto headerLayout = new QHBoxLayout;
+    headerLayout->setSpacing(4);
+    artLabel = new QLabel(controlsWidget);
+    artLabel->setFixedSize(41, 41);
+    artLabel->setAlignment(Qt::AlignCenter);
+    artLabel->setStyleSheet("background: #222; border: 1px solid #444;");
+    headerLayout->addWidget(artLabel);
+    auto titleLayout = new QVBoxLayout;
+    titleLayout->setSpacing(1);
     deckTitleLabel->setFixedHeight(20);
     songNameLabel->setFixedHeight(20); // Increased from 14 to 20 for better readability
-    headerLayout->addWidget(deckTitleLabel);
-    headerLayout->addWidget(songNameLabel);
+    titleLayout->addWidget(deckTitleLabel);
+    titleLayout->addWidget(songNameLabel);
+    headerLayout->addLayout(titleLayout, 1);
     controlsLayout->addLayout(headerLayout);
+    connect(&ArtworkCache::instance(), &ArtworkCache::thumbnailReady, this, [this](const QString& path) {
+        if (path == currentFilePath) updateArtwork();
+    });
     
     // Waveform overview (more compact)
     waveform->setFixedHeight(25);
@@ -169,6 +196,13 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     
     // Connect performance pads cue points to waveform displays (after pads are created)
     connect(pads, &PerformancePads::cuePointsChanged, waveform, &DeckWaveformOverview::setCuePoints);
+    connect(this, &QtDeckWidget::loopChanged, pads, &PerformancePads::setLoopState);
+    // Keep the stored hot cues prefetched so jumps to them never wait on the disk
+    connect(pads, &PerformancePads::cuePointsChanged, this, [this](const std::array<double, 8>& cues) {
+        if (!player) return;
+        for (int i = 0; i < (int) cues.size(); ++i)
+            player->setPrefetchPoint(DeckReadAheadSource::FirstHotCueSlot + i, cues[(size_t) i]);
+    });
     
     // Turntable section: Transport buttons, turntable, BPM and tempo slider below
     auto turntableSection = new QVBoxLayout;
@@ -182,16 +216,19 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     cueBtn->setFixedHeight(20);        // Smaller height
     keylockBtn->setFixedHeight(20);    // Smaller height
     quantizeBtn->setFixedHeight(20);   // Smaller height
+    slipBtn->setFixedHeight(20);
     playPauseBtn->setFixedWidth(40);   // Smaller width
     loadBtn->setFixedWidth(40);        // Smaller width
     cueBtn->setFixedWidth(30);         // Smaller width for Cue
     keylockBtn->setFixedWidth(30);     // Smaller width for Key
     quantizeBtn->setFixedWidth(25);    // Smaller width for Q
+    slipBtn->setFixedWidth(30);
     transportLayout->addWidget(playPauseBtn);
     transportLayout->addWidget(loadBtn);
     transportLayout->addWidget(cueBtn);
     transportLayout->addWidget(keylockBtn);
     transportLayout->addWidget(quantizeBtn);
+    transportLayout->addWidget(slipBtn);
     transportLayout->addWidget(syncBtn);
     turntableSection->addLayout(transportLayout);
     
@@ -218,10 +255,12 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
     speedSlider->setFixedWidth(20);  // Narrower
     tempoValueLabel->setFixedHeight(12);
     tempoSpin->setFixedWidth(60);
+    keyShiftSpin->setFixedWidth(60);
     speedSection->addWidget(speedLabel, 0, Qt::AlignCenter);
     speedSection->addWidget(speedSlider, 0, Qt::AlignCenter);
     speedSection->addWidget(tempoValueLabel, 0, Qt::AlignCenter);
     speedSection->addWidget(tempoSpin, 0, Qt::AlignCenter);
+    speedSection->addWidget(keyShiftSpin, 0, Qt::AlignCenter);
 
     auto bpmTempoPanel = new QVBoxLayout;
     bpmTempoPanel->setSpacing(2);
@@ -304,7 +343,30 @@ QtDeckWidget::QtDeckWidget(DJAudioPlayer* player_, QWidget* parent, const QStrin
 
 void QtDeckWidget::loadFile(const QString &path) {
     currentFilePath = path;  // Store the current file path
-    // Don't generate waveform on UI thread; schedule lightweight background generation
+    QFileInfo fi(path);
+    songNameLabel->setText(fi.fileName());
+    updateArtwork();
+    if (player) {
+        // NEW: Start threaded loading instead of blocking synchronous load
+        emit fileLoadingStarted(path);  // Signal to start background loading
+        
+        // Update UI immediately to show loading state
+        playPauseBtn->setText("Loading...");
+        playPauseBtn->setEnabled(false);
+        loadBtn->setText("Loading...");
+        loadBtn->setEnabled(false);
+        
+        waveform->setPlayhead(0.0);
+        playing = false;
+        turntable->stop();
+        
+        // Reset cue point and cueing state when loading new file
+        cuePosition = 0.0;
+        isCueing = false;
+        trackApplied = false;
+    }
+    // Don't generate waveform on UI thread; schedule lightweight background generation.
+    // Started after fileLoadingStarted so it waits for the loader's decode pass instead of decoding too.
     if (!path.isEmpty()) {
         class SmallOverviewTask : public QRunnable {
         public:
@@ -318,14 +380,11 @@ void QtDeckWidget::loadFile(const QString &path) {
                     WaveformGenerator::Result res;
                     const int bins = 4000;
                     if (!gen.generate(juce::File(filePath.toStdString()), bins, res)) return;
-                    auto data = std::make_shared<std::vector<float>>(res.maxBins.size());
-                    for (size_t i = 0; i < res.maxBins.size(); ++i) {
-                        (*data)[i] = std::min(1.0f, std::abs(res.maxBins[i]));
-                    }
+                    auto data = std::make_shared<const std::vector<std::int8_t>>(std::move(res.maxBins));
                     const double audioStart = res.audioStartOffsetSec;
                     const double lengthSec = res.lengthSeconds;
                     QMetaObject::invokeMethod(wf, [w = wf, data, audioStart, lengthSec]() {
-                        if (w) w->setWaveformData(*data, audioStart, lengthSec);
+                        if (w) w->setWaveformData(data, audioStart, lengthSec);
                     }, Qt::QueuedConnection);
                 } catch (...) {}
             }
@@ -336,26 +395,6 @@ void QtDeckWidget::loadFile(const QString &path) {
         // Use global QThreadPool to run background task
         QThreadPool::globalInstance()->start(new SmallOverviewTask(waveform, path));
     }
-    QFileInfo fi(path);
-    songNameLabel->setText(fi.fileName());
-    if (player) {
-        // NEW: Start threaded loading instead of blocking synchronous load
-        emit fileLoadingStarted(path);  // Signal to start background loading
-        
-        // Update UI immediately to show loading state
-        playPauseBtn->setText("Loading...");
-        playPauseBtn->setEnabled(false);
-        loadBtn->setText("Loading...");
-        loadBtn->setEnabled(false);
-        
-        waveform->setPlayhead(0.0);
-        playing = false;
-        turntable->stop();
-        
-        // Reset cue point and cueing state when loading new file
-        cuePosition = 0.0;
-        isCueing = false;
-    }
     // do NOT start turntable here
 }
 
@@ -367,22 +406,39 @@ void QtDeckWidget::onFileLoadingComplete(const QString& filePath) {
         playPauseBtn->setEnabled(true);
         loadBtn->setText("Unload");
         loadBtn->setEnabled(true);
+        trackApplied = true;
+        // An auto-cue that arrived with the cached waveform, before the track was in the player
+        if (cuePosition > 0.0) {
+            const double cue = cuePosition;
+            cuePosition = 0.0;
+            setAutoCue(cue);
+        }
         
         // Emit the file loaded signal for other components (BPM analysis, etc.)
         emit fileLoaded();
     }
 }
 
+void QtDeckWidget::setAutoCue(double seconds) {
+    if (!player || currentFilePath.isEmpty() || seconds <= 0.0 || cuePosition != 0.0 || isCueing) return;
+    cuePosition = seconds;
+    // Applied once the player has the track
+    if (!trackApplied) return;
+    player->setPrefetchPoint(DeckReadAheadSource::CueSlot, cuePosition);
+    if (!playing && player->getCurrentPositionSeconds() < cuePosition) {
+        player->setPositionSeconds(cuePosition);
+        const double length = player->getLengthInSeconds();
+        if (length > 0.0) waveform->setPlayhead(cuePosition / length);
+    }
+}
+
 void QtDeckWidget::dragEnterEvent(QDragEnterEvent* event) {
     if (event->mimeData()->hasUrls()) event->acceptProposedAction();
 }
 
 void QtDeckWidget::dropEvent(QDropEvent* event) {
-    auto urls = event->mimeData()->urls();
-    if (!urls.isEmpty()) {
-        auto path = urls.first().toLocalFile();
-        loadFile(path);
-    }
+    const QString path = TrackDragMimeData::firstFilePath(event->mimeData());
+    if (!path.isEmpty()) loadFile(path);
 }
 
 bool QtDeckWidget::eventFilter(QObject* obj, QEvent* event) {
@@ -399,9 +455,8 @@ bool QtDeckWidget::eventFilter(QObject* obj, QEvent* event) {
         }
         if (event->type() == QEvent::Drop) {
             auto de = static_cast<QDropEvent*>(event);
-            auto urls = de->mimeData()->urls();
-            if (!urls.isEmpty()) {
-                auto path = urls.first().toLocalFile();
+            const QString path = TrackDragMimeData::firstFilePath(de->mimeData());
+            if (!path.isEmpty()) {
                 loadFile(path);
                 return true;
             }
@@ -477,6 +532,17 @@ void QtDeckWidget::onPlayPause() {
     std::cout << "### QtDeckWidget::onPlayPause() END ###" << std::endl;
 }
 
+void QtDeckWidget::updateArtwork() {
+    // Null while the cache loads it in the background; thumbnailReady brings us back here
+    const QImage thumbnail = currentFilePath.isEmpty() ? QImage() : ArtworkCache::instance().getThumbnail(currentFilePath);
+    if (thumbnail.isNull()) {
+        artLabel->clear();
+        return;
+    }
+    artLabel->setPixmap(QPixmap::fromImage(thumbnail.scaled(artLabel->contentsRect().size(),
+                                                            Qt::KeepAspectRatio, Qt::SmoothTransformation)));
+}
+
 void QtDeckWidget::onLoad() {
     if (loadBtn->text() == "Load") {
         // Load file dialog
@@ -486,6 +552,7 @@ void QtDeckWidget::onLoad() {
         // Unload current file
         currentFilePath.clear();
         songNameLabel->setText("No Track Loaded");
+        updateArtwork();
         loadBtn->setText("Load");
         playPauseBtn->setText("Play");
         if (player) {
@@ -508,6 +575,7 @@ void QtDeckWidget::onCue() {
         double rawPos = player->getCurrentPositionSeconds();
         // Apply quantization if enabled
         cuePosition = player->quantizePosition(rawPos);
+        player->setPrefetchPoint(DeckReadAheadSource::CueSlot, cuePosition);
         cueClickPending = false;
         cueClickTimer->stop();
         // Visual feedback could be added here (e.g., brief color change)
@@ -527,6 +595,7 @@ void QtDeckWidget::onCuePressed() {
             double rawPos = player->getCurrentPositionSeconds();
             // Apply quantization if enabled
             cuePosition = player->quantizePosition(rawPos);
+            player->setPrefetchPoint(DeckReadAheadSource::CueSlot, cuePosition);
         }
         
         // Start cueing: play from cue point
@@ -567,11 +636,8 @@ void QtDeckWidget::onSpeedChanged(int v) {
     double factor = v / 1000.0;
     applyTempo(factor);
     // update displayed BPM according to detected BPM * factor
-    double displayed = detectedBpm > 0.0 ? detectedBpm * factor : 0.0;
-    if (bpmCurrentLabel) {
-        bpmCurrentLabel->setText(displayed > 0.0 ? QString("Curr: %1").arg(QString::number(displayed, 'f', 1)) : "Curr: --");
-    }
-    emit displayedBpmChanged(displayed);
+    viewModel.setTempo({ detectedBpm, factor });
+    emit displayedBpmChanged(viewModel.getDisplayedBpm());
     // CRITICAL FIX: Emit tempo factor change for beat grid adjustment
     emit tempoFactorChanged(factor);
 }
@@ -585,6 +651,33 @@ void QtDeckWidget::setTempoFactor(double factor) {
     applyTempo(factor);
 }
 
+void QtDeckWidget::handleControllerButton(ControllerInput::Action action, bool pressed, int pad) {
+    using Action = ControllerInput::Action;
+    // Press and release arrive like a mouse on the buttons: pressed, released, clicked
+    switch (action) {
+        case Action::Cue:
+            if (pressed) onCuePressed();
+            else { onCueReleased(); onCue(); }
+            break;
+        case Action::HotCue:
+            if (pads) pads->pressPad(pad, pressed);
+            break;
+        case Action::PlayPause: if (pressed) playPauseBtn->click(); break;
+        case Action::Sync: if (pressed) syncBtn->click(); break;
+        case Action::Keylock: if (pressed) keylockBtn->click(); break;
+        case Action::Slip: if (pressed) slipBtn->click(); break;
+        default: break;
+    }
+}
+
+void QtDeckWidget::notePlaybackStarted() {
+    if (playing) return;
+    playPauseBtn->setText("Pause");
+    turntable->start();
+    playing = true;
+    emit playStateChanged(playing);
+}
+
 void QtDeckWidget::onSync() {
     emit syncRequested(this);
 }
@@ -611,8 +704,6 @@ void QtDeckWidget::applyTempo(double factor) {
     // Update player/turntable
     player->setSpeed(clamped);
     turntable->setSpeed(clamped);
-    // update numeric labels
-    if (tempoValueLabel) tempoValueLabel->setText(QString::number(clamped, 'f', 3) + "x");
     // keep spin in sync exactly (4dp)
     if (tempoSpin && std::abs(tempoSpin->value() - clamped) > 0.00005) {
         tempoSpin->blockSignals(true);
@@ -629,12 +720,9 @@ void QtDeckWidget::applyTempo(double factor) {
             speedSlider->blockSignals(false);
         }
     }
-    // update BPM label and emit signals
-    double displayed = detectedBpm > 0.0 ? detectedBpm * clamped : 0.0;
-    if (bpmCurrentLabel) {
-        bpmCurrentLabel->setText(displayed > 0.0 ? QString("Curr: %1").arg(QString::number(displayed, 'f', 1)) : "Curr: --");
-    }
-    emit displayedBpmChanged(displayed);
+    // update the tempo and BPM labels (only what changed) and emit signals
+    viewModel.setTempo({ detectedBpm, clamped });
+    emit displayedBpmChanged(viewModel.getDisplayedBpm());
     emit tempoFactorChanged(clamped);
 }
 
@@ -642,13 +730,7 @@ void QtDeckWidget::setDetectedBpm(double bpm) {
     detectedBpm = bpm;
     // if speed slider is at some value, update displayed BPM
     double factor = speedSlider ? speedSlider->value() / 1000.0 : 1.0;
-    double displayed = detectedBpm > 0.0 ? detectedBpm * factor : 0.0;
-    if (bpmDefaultLabel) {
-        bpmDefaultLabel->setText(detectedBpm > 0.0 ? QString("BPM: %1").arg(QString::number(detectedBpm, 'f', 1)) : "BPM: --");
-    }
-    if (bpmCurrentLabel) {
-        bpmCurrentLabel->setText(displayed > 0.0 ? QString("Curr: %1").arg(QString::number(displayed, 'f', 1)) : "Curr: --");
-    }
+    viewModel.setTempo({ detectedBpm, factor });
     
     // Update turntable with detected BPM for beat synchronization
     if (turntable && detectedBpm > 0.0) {
@@ -662,7 +744,7 @@ void QtDeckWidget::setDetectedBpm(double bpm) {
         }
     }
     
-    emit displayedBpmChanged(displayed);
+    emit displayedBpmChanged(viewModel.getDisplayedBpm());
 }
 
 void QtDeckWidget::syncPlayState() {
@@ -673,6 +755,9 @@ void QtDeckWidget::syncPlayState() {
     if (playPauseBtn->text() == "Loading...") {
         return;
     }
+
+    // A brake or spinback came to rest: the deck pauses where the platter stopped
+    if (player->takeMotionStop() && playing) onPlayPause();
     
     static int lastUpdateCount = 0;
     static int currentUpdateCount = 0;
@@ -781,6 +866,11 @@ void QtDeckWidget::onKeylockToggle() {
     }
 }
 
+void QtDeckWidget::onKeyShiftChanged(int semitones) {
+    if (!player) return;
+    player->setKeyShift(semitones);
+}
+
 void QtDeckWidget::onQuantizeToggle() {
     if (!player) return;
     
@@ -795,6 +885,14 @@ void QtDeckWidget::onQuantizeToggle() {
     }
 }
 
+void QtDeckWidget::onSlipToggle() {
+    if (!player) return;
+    
+    bool enabled = slipBtn->isChecked();
+    player->setSlipEnabled(enabled);
+    slipBtn->setText(enabled ? "SLIP ✓" : "Slip");
+}
+
 void QtDeckWidget::setBeatIndicator(BeatIndicator* indicator) {
     if (pads) {
         pads->setBeatIndicator(indicator);
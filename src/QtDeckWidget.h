@@ -5,12 +5,15 @@
 #include <QSlider>
 #include <QLabel>
 #include <QDoubleSpinBox>
+#include <QSpinBox>
 #include <memory>
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include "DeckWaveformOverview.h"
 #include "QtTurntableWidget.h"
 #include "PerformancePads.h"
+#include "ControllerInput.h"
+#include "DeckViewModel.h"
 class DJAudioPlayer;
 
 class QtDeckWidget : public QWidget {
@@ -34,29 +37,42 @@ public:
     void setDeckTitle(const QString& title);
     void setBeatIndicator(class BeatIndicator* indicator); // NEW: Set beat indicator
     QString getCurrentFilePath() const { return currentFilePath; }
+    bool isPlaying() const { return playing; }
     Q_SLOT void setDetectedBpm(double bpm);
     // Tempo helpers
     double getTempoFactor() const;                 // Current speed factor (1.0 = original)
     double getDetectedBpm() const { return detectedBpm; }
     void setTempoFactor(double factor);            // Programmatically set tempo
+    // Controller buttons (play, cue, sync, keylock, slip, hot cues): same as the deck's own buttons
+    void handleControllerButton(ControllerInput::Action action, bool pressed, int pad = 0);
+    // The player was started on the audio thread (an armed AutoDJ start): the UI follows
+    // without starting it again
+    void notePlaybackStarted();
     
     // Getter for Rekordbox-style layout (waveform now integrated into controls)
     QWidget* getControlsWidget() const { return controlsWidget; }
     DeckWaveformOverview* getWaveform() const { return waveform; }
+    // The deck's labels, including the overview header the main window binds
+    DeckViewModel& getViewModel() { return viewModel; }
     PerformancePads* getPerformancePads() const { return pads; } // NEW: Access to performance pads
     
     // BetaPulseX: Getter für Settings-Integration
     QPushButton* getKeylockButton() const { return keylockBtn; }
     QPushButton* getQuantizeButton() const { return quantizeBtn; }
+    QPushButton* getSlipButton() const { return slipBtn; }
     QSlider* getSpeedSlider() const { return speedSlider; }
     
     // NEW: Handle threaded file loading completion
     void onFileLoadingComplete(const QString& filePath);
+    // Auto-cue at the audible start the waveform analysis found: it becomes the cue point and,
+    // while the deck hasn't played past it, the play position. A cue already set wins.
+    void setAutoCue(double seconds);
 
 public slots:
     // BetaPulseX: Public slots für Settings-Integration
     void onKeylockToggle();
     void onQuantizeToggle();
+    void onSlipToggle();
 
 private slots:
     void onPlayPause();
@@ -70,7 +86,9 @@ private slots:
     void onSync();
     void onSyncToggled(bool enabled);
     void onTempoSpinChanged(double v);
+    void onKeyShiftChanged(int semitones);
     void applyTempo(double factor);
+    void updateArtwork();
 
 private:
     DJAudioPlayer* player;
@@ -79,24 +97,29 @@ private:
     QWidget* controlsWidget;  // Separate widget for controls
     QLabel* deckTitleLabel;
     QLabel* songNameLabel;
+    QLabel* artLabel;         // cover art from the ArtworkCache
     QPushButton* playPauseBtn;
     QPushButton* loadBtn;
     QPushButton* cueBtn;
     QPushButton* keylockBtn;
     QPushButton* quantizeBtn;
+    QPushButton* slipBtn;
     QPushButton* syncBtn;
     QSlider* speedSlider;
     QLabel* speedLabel;
     QLabel* tempoValueLabel;
     QDoubleSpinBox* tempoSpin;
+    QSpinBox* keyShiftSpin;  // semitones, for harmonic mixing
     QLabel* bpmDefaultLabel; // Shows detected/default BPM
     QLabel* bpmCurrentLabel; // Shows speed-adjusted BPM
+    DeckViewModel viewModel;  // what the labels show; sets only those that changed
     PerformancePads* pads{nullptr};
     bool playing{false};
     QString currentFilePath;
     double detectedBpm{0.0};
     QTimer* statusTimer; // Timer for status synchronization
     double cuePosition{0.0}; // Stored cue point
+    bool trackApplied{false}; // The loaded file is in the player (onFileLoadingComplete)
     bool isCueing{false}; // True when cue button is held down
     QTimer* cueClickTimer; // Timer for detecting double-clicks on cue
     bool cueClickPending{false}; // True when waiting for potential second click
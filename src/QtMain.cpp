@@ -1,10 +1,29 @@
 #include "QtMainWindow.h"
 #include "AppConfig.h"
+#include "DecoderRegistry.h"
+#include "FlightRecorder.h"
+#include "PluginSandbox.h"
+#include "RtTrace.h"
+#include "SharedCache.h"
+#include "EventTrace.h"
+#include "StartupTimeline.h"
+#include "WaveformGenerator.h"
 #include <QApplication>
 #include <QDebug>
+#include <QSettings>
 
 int main(int argc, char** argv)
 {
+    // Started as a plugin sandbox's child: host the plugin and nothing else, no Qt
+    juce::StringArray arguments;
+    for (int i = 1; i < argc; ++i) arguments.add(juce::CharPointer_UTF8(argv[i]));
+    const juce::String commandLine = arguments.joinIntoString(" ");
+    if (PluginSandbox::isWorkerCommandLine(commandLine))
+        return PluginSandbox::runWorker(commandLine);
+
+    StartupTimeline::begin();
+    // One share group for every GL view, so shaders and waveform uploads are made once (GlResources)
+    QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
     QApplication app(argc, argv);
     
     // BetaPulseX: Initialisiere App-Konfiguration und erstelle Verzeichnisse
@@ -16,15 +35,44 @@ int main(int argc, char** argv)
     if (!AppConfig::instance().createDirectories()) {
         qWarning() << "Failed to create app directories - some features may not work!";
     }
+    // The engine library does not know about AppConfig
+    WaveformGenerator::setCacheDirectory(juce::File(AppConfig::instance().getWaveformCacheDirectory().toStdString()));
+    // MP3s through the frame-indexed reader for instant seeks, for every subsystem
+    {
+        QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+        DecoderRegistry::getInstance().useIndexedMp3(
+            juce::File(AppConfig::instance().getMp3IndexDirectory().toStdString()),
+            prefs.value("Performance/Mp3Decoder", "mpg123").toString() == "juce" ? IndexedMp3Format::Backend::Juce
+                                                                                : IndexedMp3Format::Backend::Mpg123);
+        const QString sharedCache = prefs.value("Library/SharedCachePath", "").toString();
+        if (!sharedCache.isEmpty()) SharedCache::setRoot(juce::File(sharedCache.toStdString()));
+        // Recording always; dumps on crashes and xrun bursts only with crash reporting on
+        FlightRecorder::configure(juce::File(AppConfig::instance().getLogsDirectory().toStdString()),
+                                  prefs.value("Advanced/CrashReporting", true).toBool());
+    }
 
-    QtMainWindow w;
-    // Make window wider by default and enforce a minimum size so loading tracks
-    // can't slightly shift or expand the main window layout.
-    const int defaultW = 1400;
-    const int defaultH = 900;
-    w.resize(defaultW, defaultH);
-    w.setMinimumSize(defaultW, defaultH);
-    w.show();
+    // Audio-thread log records are printed from here on
+    RtTrace::start();
+    EventTrace::start();
+    EventTrace::attachCurrentThread("UI");
+    StartupTimeline::mark("application");
 
-    return app.exec();
+    int result = 0;
+    {
+        QtMainWindow w;
+        // Make window wider by default and enforce a minimum size so loading tracks
+        // can't slightly shift or expand the main window layout.
+        const int defaultW = 1400;
+        const int defaultH = 900;
+        w.resize(defaultW, defaultH);
+        w.setMinimumSize(defaultW, defaultH);
+        // The window's first show starts the audio device and the library load (QtMainWindow::showEvent)
+        w.show();
+
+        result = app.exec();
+    }
+    // The window and its players are gone
+    DecoderRegistry::getInstance().shutdown();
+    RtTrace::stop();
+    return result;
 }
@@ -2,8 +2,15 @@
 #include "DJAudioPlayer.h"
 #include "BpmAnalyzer.h"
 #include "WaveformDisplay.h"
+#include "GlResources.h"
+#include "FrameClock.h"
+#include "EventTrace.h"
+#include "FlightRecorder.h"
+#include "PluginInsert.h"
+#include "LibraryAnalyzer.h"
 #include "BeatIndicator.h"
 #include "PreferencesDialog.h"
+#include "MasterScopeView.h"
 #include <iostream>
 #include <QApplication>
 #include <QMessageBox>
@@ -17,157 +24,6 @@
 #include <QJsonParseError>
 #include <QRegularExpression>
 
-// StereoAudioCallback - Main JUCE audio callback method
-void StereoAudioCallback::audioDeviceIOCallback(const float* const* inputChannelData, int numInputChannels,
-                                               float* const* outputChannelData, int numOutputChannels, 
-                                               int numSamples) {
-    // Create dummy context and call the full implementation
-    juce::AudioIODeviceCallbackContext context;
-    audioDeviceIOCallbackWithContext(inputChannelData, numInputChannels, 
-                                    outputChannelData, numOutputChannels, 
-                                    numSamples, context);
-}
-
-// StereoAudioCallback implementation for proper stereo mixing of both decks
-void StereoAudioCallback::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
-                                                          float* const* outputChannelData, int numOutputChannels,
-                                                          int numSamples, const juce::AudioIODeviceCallbackContext& context) {
-    static int callCount = 0;
-    static bool infoLogged = false;
-    
-    // Log device info once, then reduce spam
-    if (!infoLogged) {
-        std::cout << "Stereo Mixer callback: outputChannels=" << numOutputChannels 
-                  << ", samples=" << numSamples << std::endl;
-        infoLogged = true;
-    }
-    
-    if (++callCount % 5000 == 0) {  // Less frequent logging
-        std::cout << "Mixer running (" << callCount << " callbacks)" << std::endl;
-    }
-    
-    if (numSamples <= 0) {
-        // Clear output if no samples
-        for (int ch = 0; ch < numOutputChannels; ++ch) {
-            if (outputChannelData[ch]) {
-                juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
-            }
-        }
-        return;
-    }
-    
-    // Ensure buffers are sized correctly for stereo
-    const int bufferChannels = std::max(2, numOutputChannels);
-    if (tempBufferA.getNumChannels() != bufferChannels || tempBufferA.getNumSamples() < numSamples) {
-        tempBufferA.setSize(bufferChannels, numSamples, false, false, true);
-    }
-    if (tempBufferB.getNumChannels() != bufferChannels || tempBufferB.getNumSamples() < numSamples) {
-        tempBufferB.setSize(bufferChannels, numSamples, false, false, true);
-    }
-    
-    // Clear buffers
-    tempBufferA.clear();
-    tempBufferB.clear();
-    
-    // Get audio from both players
-    juce::AudioSourceChannelInfo bufferInfoA;
-    bufferInfoA.buffer = &tempBufferA;
-    bufferInfoA.startSample = 0;
-    bufferInfoA.numSamples = numSamples;
-    
-    juce::AudioSourceChannelInfo bufferInfoB;
-    bufferInfoB.buffer = &tempBufferB;
-    bufferInfoB.startSample = 0;
-    bufferInfoB.numSamples = numSamples;
-    
-    // Get audio from Player A
-    if (audioPlayerA) {
-        audioPlayerA->getNextAudioBlock(bufferInfoA);
-    }
-    
-    // Get audio from Player B
-    if (audioPlayerB) {
-        audioPlayerB->getNextAudioBlock(bufferInfoB);
-    }
-    
-    // Clear all output channels first
-    for (int ch = 0; ch < numOutputChannels; ++ch) {
-        if (outputChannelData[ch]) {
-            juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
-        }
-    }
-    
-    // Load mixer parameters (atomic reads)
-    const float volA = volumeA.load();
-    const float volB = volumeB.load();
-    const float crossfader = crossfaderPos.load();
-    const float master = masterVolume.load();
-    
-    // Calculate crossfader gains (equal power law for smooth transitions)
-    float gainA, gainB;
-    if (crossfader <= 0.0f) {
-        // Left side: A stays full, B fades out
-        float fadePos = std::abs(crossfader); // 0.0 to 1.0
-        gainA = 1.0f;
-        gainB = std::cos(fadePos * M_PI * 0.5f); // Cosine fade
-    } else {
-        // Right side: A fades out, B stays full  
-        float fadePos = crossfader; // 0.0 to 1.0
-        gainA = std::cos(fadePos * M_PI * 0.5f); // Cosine fade
-        gainB = 1.0f;
-    }
-    
-    // Apply volume controls
-    gainA *= volA;
-    gainB *= volB;
-    
-    // Mix both players to output with proper stereo channel mapping
-    for (int ch = 0; ch < std::min(numOutputChannels, 2); ++ch) {
-        if (outputChannelData[ch]) {
-            // Mix Player A
-            if (ch < tempBufferA.getNumChannels()) {
-                juce::FloatVectorOperations::addWithMultiply(
-                    outputChannelData[ch], 
-                    tempBufferA.getReadPointer(ch), 
-                    gainA, 
-                    numSamples
-                );
-            }
-            
-            // Mix Player B
-            if (ch < tempBufferB.getNumChannels()) {
-                juce::FloatVectorOperations::addWithMultiply(
-                    outputChannelData[ch], 
-                    tempBufferB.getReadPointer(ch), 
-                    gainB, 
-                    numSamples
-                );
-            }
-            
-            // Apply master volume
-            if (master != 1.0f) {
-                juce::FloatVectorOperations::multiply(outputChannelData[ch], master, numSamples);
-            }
-        }
-    }
-    
-    // If more than 2 output channels, copy stereo to remaining channels
-    for (int ch = 2; ch < numOutputChannels; ++ch) {
-        if (outputChannelData[ch] && outputChannelData[ch % 2]) {
-            juce::FloatVectorOperations::copy(outputChannelData[ch], outputChannelData[ch % 2], numSamples);
-        }
-    }
-}
-
-void StereoAudioCallback::audioDeviceAboutToStart(juce::AudioIODevice* device) {
-    std::cout << "StereoAudioCallback: Device starting - " << device->getName().toStdString() 
-              << ", Channels: " << device->getActiveOutputChannels().toInteger() 
-              << ", Sample Rate: " << device->getCurrentSampleRate() << std::endl;
-}
-
-void StereoAudioCallback::audioDeviceStopped() {
-    std::cout << "StereoAudioCallback: Device stopped" << std::endl;
-}
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -193,102 +49,63 @@ void StereoAudioCallback::audioDeviceStopped() {
 #include <QFile>
 #include <QTextStream>
 #include <QTimer>
+#include <QProgressDialog>
+#include <QSignalBlocker>
+#include <QFileInfo>
 #include <iostream>
 #include "WaveformGenerator.h"
 #include "AppConfig.h"
 #include "DeckSettings.h"
+#include "InMemoryTrackReader.h"
+#include "MemoryBudget.h"
+#include "MappedTrackReader.h"
+#include "BpmCache.h"
+#include "LoudnessMeter.h"
+#include "SpectrogramCache.h"
+#include "StemCache.h"
+#include "StemSeparator.h"
+#include "HotTrackCache.h"
+#include "DecoderRegistry.h"
+#include "TrackPrefetcher.h"
+#include "GigPrep.h"
+#include "JobSystem.h"
+#include "ThreadingPolicy.h"
+#include "StartupTimeline.h"
 
 // Static members for shared format manager
-juce::AudioFormatManager* QtMainWindow::sharedFormatManager = nullptr;
-int QtMainWindow::formatManagerRefCount = 0;
 
-// NEW: Thread-safe audio file loading for non-blocking UI
-class AudioFileLoadTask : public QRunnable {
+// Beat grid, key and novelty curve for a deck's track: from the HotTrackCache or BpmCache when it
+// was analysed before, else from the features the load's decode pass collected (or a decode of
+// its own). Runs as the job after the deck's AudioFileLoadTask, which provides its input; the
+// BpmCache file is written by a background job after this one (storeResult()). Progress goes to
+// the deck's AnalysisProgress, which the UI samples once per frame. The track's cues, loop and
+// grid edit come from the same BpmCache read and reach the deck before the analysis does.
+class BpmAnalysisTask {
 public:
-    AudioFileLoadTask(QtMainWindow* mainWindow, QString filePath, bool isDeckA) 
-        : window(mainWindow), filePath(std::move(filePath)), isDeckA(isDeckA) {
-        setAutoDelete(true);
-    }
-    
-    void run() override {
-        if (!window) return;
-        
-        try {
-            // PERFORMANCE: Set lower thread priority to prevent UI blocking
-            QThread::currentThread()->setPriority(QThread::LowPriority);
-            
-            // Load audio file data in background thread
-            juce::File audioFile(filePath.toStdString());
-            std::unique_ptr<juce::AudioFormatReader> reader(window->sharedFormatManager->createReaderFor(audioFile));
-            
-            if (reader) {
-                // Create the reader source in background thread
-                auto readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
-                double sampleRate = readerSource->getAudioFormatReader()->sampleRate;
-                
-                // Thread-safe UI update: Apply loaded file to player on main thread
-                QMetaObject::invokeMethod(window, [=, source = readerSource.release()]() mutable {
-                    if (window) {
-                        DJAudioPlayer* player = isDeckA ? window->playerA : window->playerB;
-                        QtDeckWidget* deckWidget = isDeckA ? window->deckA : window->deckB;
-                        if (player && deckWidget) {
-                            // Apply the pre-loaded audio source to the player
-                            std::unique_ptr<juce::AudioFormatReaderSource> sourcePtr(source);
-                            player->applyLoadedSource(std::move(sourcePtr), sampleRate);
-                            
-                            // Update UI elements on main thread
-                            deckWidget->onFileLoadingComplete(filePath);
-                        }
-                    }
-                }, Qt::QueuedConnection);
-                
-            } else {
-                // Thread-safe error handling
-                QMetaObject::invokeMethod(window, [=]() {
-                    if (window) {
-                        QFileInfo fi(filePath);
-                        window->setStatusTip(QString("Failed to load audio file: %1").arg(fi.fileName()));
-                    }
-                }, Qt::QueuedConnection);
-            }
-            
-        } catch (const std::exception& e) {
-            // Thread-safe error handling
-            QMetaObject::invokeMethod(window, [=, error = QString::fromStdString(e.what())]() {
-                if (window) {
-                    QFileInfo fi(filePath);
-                    window->setStatusTip(QString("Audio loading error: %1 - %2").arg(fi.fileName()).arg(error));
-                }
-            }, Qt::QueuedConnection);
-        }
-    }
-    
-private:
-    QPointer<QtMainWindow> window;
-    QString filePath;
-    bool isDeckA;
-};
+    BpmAnalysisTask(QtMainWindow* mainWindow, BpmAnalyzer* analyzer, AnalysisProgress* progress,
+                    juce::File file, bool isDeckA)
+        : window(mainWindow), analyzer(analyzer), progress(progress), audioFile(std::move(file)), isDeckA(isDeckA) {}
+
+    // Load job, once the track is on the deck; run() does nothing without it
+    void provide(std::shared_ptr<const BpmAnalyzer::Features> passFeatures,
+                 std::shared_ptr<const BpmCache::Entry> knownGrid) {
+        features = std::move(passFeatures);
+        known = std::move(knownGrid);
+        provided = true;
+    }
+
+    void run(const JobSystem::CancelToken& token) {
+        if (!window || !analyzer || !provided) return;
+        EVENT_TRACE_SCOPE("BpmAnalysisTask::run", "analysis");
+        // The lambdas below outlive this task, they only capture copies
+        const QPointer<QtMainWindow> w = window;
+        const bool onDeckA = isDeckA;
+        const QString filename = QString::fromStdString(audioFile.getFileNameWithoutExtension().toStdString());
 
-// Enhanced threaded BPM analysis task with better performance and UI responsiveness
-class BpmAnalysisTask : public QRunnable {
-public:
-    BpmAnalysisTask(QtMainWindow* mainWindow, juce::File file, bool isDeckA) 
-        : window(mainWindow), audioFile(std::move(file)), isDeckA(isDeckA) {
-        setAutoDelete(true);
-    }
-    
-    void run() override {
-        if (!window) return;
-        
         // Signal analysis start to keep user informed
-        QMetaObject::invokeMethod(window, [this]() {
-            if (window) {
-                QString filename = QString::fromStdString(audioFile.getFileNameWithoutExtension().toStdString());
-                window->setStatusTip(QString("Analyzing BPM: %1...").arg(filename));
-            if (isDeckA) { window->analysisActiveA = true; window->analysisFailedA = false; window->analysisProgressA = 0.0; }
-            else { window->analysisActiveB = true; window->analysisFailedB = false; window->analysisProgressB = 0.0; }
-            window->updateOverviewLabel(isDeckA);
-            }
+        progress->begin();
+        QMetaObject::invokeMethod(w, [=]() {
+            if (w && !token.isCancelled()) w->setStatusTip(QString("Analyzing BPM: %1...").arg(filename));
         }, Qt::QueuedConnection);
         
         try {
@@ -296,186 +113,395 @@ public:
             double totalSec = 0.0;
             std::string algorithm;
             double firstBeatOffset = 0.0;
-            
-            // PERFORMANCE: Set lower thread priority to prevent UI blocking
-            QThread::currentThread()->setPriority(QThread::LowPriority);
-            
-            // Analyze with progress updates to keep UI responsive
-            // Mark analysis active on corresponding waveform
-            QMetaObject::invokeMethod(window, [this]() {
-                if (!window) return;
-                WaveformDisplay* wf = isDeckA ? window->overviewTopA : window->overviewTopB;
-                if (wf) { wf->setAnalysisFailed(false); wf->setAnalysisActive(true); wf->setAnalysisProgress(0.0); }
+            std::vector<float> novelty;
+            double noveltyHopSec = 0.0;
+            TrackStructure structure;
+
+            // Only the latest value is kept; the next frame shows it. A superseded run leaves
+            // the deck's progress to the analysis of its new track.
+            AnalysisProgress* report = progress;
+            auto progressCb = [report, token](double p) { if (!token.isCancelled()) report->report(p); };
+            auto errorCb = [report, token](const std::string&) { if (!token.isCancelled()) report->fail(); };
+
+            // A track analysed before gets its grid from the cache, no decoding or detection;
+            // one loaded moments ago (reload, instant double) only reads its memory there
+            const BpmCache cache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString()));
+            BpmCache::Memory memory;
+            std::shared_ptr<const BpmCache::Entry> cached = known;
+            if (cached) {
+                cache.loadMemory(audioFile, memory);
+            } else {
+                auto loaded = std::make_shared<BpmCache::Entry>();
+                if (cache.load(audioFile, *loaded, &memory)) {
+                    cached = loaded;
+                    HotTrackCache::getInstance().storeBeatGrid(audioFile, cached);
+                }
+            }
+            const QString path = QString::fromStdString(audioFile.getFullPathName().toStdString());
+            QMetaObject::invokeMethod(w, [=]() {
+                if (w && !token.isCancelled()) w->applyTrackMemory(onDeckA, path, memory);
             }, Qt::QueuedConnection);
-
-        auto progressCb = [wptr = QPointer<QtMainWindow>(window), left = isDeckA](double p){
-                if (!wptr) return;
-                QMetaObject::invokeMethod(wptr, [wptr, p, left]() {
-                    if (!wptr) return;
-            WaveformDisplay* wf = left ? wptr->overviewTopA : wptr->overviewTopB;
-            if (wf) wf->setAnalysisProgress(p);
-            if (left) { wptr->analysisProgressA = p; } else { wptr->analysisProgressB = p; }
-            wptr->updateOverviewLabel(left);
-                }, Qt::QueuedConnection);
-            };
-        auto errorCb = [wptr = QPointer<QtMainWindow>(window), left = isDeckA](const std::string&){
-                if (!wptr) return;
-                QMetaObject::invokeMethod(wptr, [wptr, left]() {
-                    if (!wptr) return;
-            WaveformDisplay* wf = left ? wptr->overviewTopA : wptr->overviewTopB;
-            if (wf) { wf->setAnalysisFailed(true); wf->setAnalysisActive(false); }
-            if (left) { wptr->analysisFailedA = true; wptr->analysisActiveA = false; }
-            else { wptr->analysisFailedB = true; wptr->analysisActiveB = false; }
-            wptr->updateOverviewLabel(left);
-                }, Qt::QueuedConnection);
-            };
-
-            double bpm = window->bpmAnalyzer->analyzeFile(audioFile, 120.0, &beatsSec, &totalSec, &algorithm, &firstBeatOffset, progressCb, errorCb);
+            double bpm = 0.0;
+            if (cached) {
+                bpm = cached->bpm;
+                beatsSec = cached->beatsSeconds;
+                totalSec = cached->totalSeconds;
+                algorithm = cached->algorithm;
+                firstBeatOffset = cached->firstBeatOffset;
+                novelty = cached->novelty;
+                noveltyHopSec = cached->noveltyHopSeconds;
+                structure = cached->structure;
+            } else {
+                // Features from the deck's shared decode pass when available, else decode on our own
+                bpm = features
+                    ? analyzer->analyzeFeatures(*features, &beatsSec, &totalSec, &algorithm, &firstBeatOffset, progressCb, errorCb)
+                    : analyzer->analyzeFile(audioFile, 120.0, &beatsSec, &totalSec, &algorithm, &firstBeatOffset, progressCb, errorCb,
+                                            &structure);
+                const int key = features ? BpmAnalyzer::getKey(*features) : -1;
+                if (features) {
+                    BpmAnalyzer::getBeatNovelty(*features, novelty, noveltyHopSec);
+                    structure = BpmAnalyzer::getStructure(*features, bpm, firstBeatOffset);
+                }
+                if (bpm > 0.0) {
+                    detected = std::make_shared<const BpmCache::Entry>(
+                        BpmCache::Entry{ bpm, beatsSec, totalSec, firstBeatOffset, algorithm, key, novelty, noveltyHopSec,
+                                         structure });
+                    HotTrackCache::getInstance().storeBeatGrid(audioFile, detected);
+                }
+            }
             
+            // A grid set by hand wins over the detected one; the detection stays cached below it,
+            // and so do the phrases found on it
+            if (memory.gridBpm > 0.0 && totalSec > 0.0) {
+                bpm = memory.gridBpm;
+                firstBeatOffset = memory.gridFirstBeat;
+                beatsSec.clear();
+                for (double t = firstBeatOffset; t < totalSec; t += 60.0 / bpm) beatsSec.push_back(t);
+            }
+
+            if (token.isCancelled()) return;
+            progress->finish(bpm > 0.0);
             // Thread-safe result delivery with immediate status update
-    QMetaObject::invokeMethod(window, [=]() {
-                if (window) {
-            window->handleBpmAnalysisResult(bpm, beatsSec, totalSec, algorithm, firstBeatOffset, isDeckA);
-            QString filename = QString::fromStdString(audioFile.getFileNameWithoutExtension().toStdString());
-            window->setStatusTip(QString("Analysis complete: %1 (%2 BPM)")
+    QMetaObject::invokeMethod(w, [=]() {
+                if (!w || token.isCancelled()) return;
+            w->handleBpmAnalysisResult(bpm, beatsSec, totalSec, algorithm, firstBeatOffset, onDeckA, novelty, noveltyHopSec,
+                                       structure);
+            w->setStatusTip(QString("Analysis complete: %1 (%2 BPM)")
                 .arg(filename)
                 .arg(QString::number(bpm, 'f', 1)));
-                    WaveformDisplay* wf = isDeckA ? window->overviewTopA : window->overviewTopB;
-                    if (wf) { wf->setAnalysisActive(false); wf->setAnalysisFailed(bpm <= 0.0); wf->setAnalysisProgress(1.0); }
-                    if (isDeckA) { window->analysisActiveA = false; window->analysisFailedA = (bpm <= 0.0); window->analysisProgressA = 1.0; }
-                    else { window->analysisActiveB = false; window->analysisFailedB = (bpm <= 0.0); window->analysisProgressB = 1.0; }
-                    window->updateOverviewLabel(isDeckA);
-                }
             }, Qt::QueuedConnection);
             
         } catch (const std::exception& e) {
+            if (token.isCancelled()) return;
+            progress->fail();
             // Thread-safe error handling
-        QMetaObject::invokeMethod(window, [this, error = QString::fromStdString(e.what())]() {
-                if (window) {
-                    QString filename = QString::fromStdString(audioFile.getFileNameWithoutExtension().toStdString());
-                    window->setStatusTip(QString("Analysis failed: %1 - %2").arg(filename).arg(error));
-            WaveformDisplay* wf = isDeckA ? window->overviewTopA : window->overviewTopB;
-            if (wf) { wf->setAnalysisFailed(true); wf->setAnalysisActive(false); }
-            if (isDeckA) { window->analysisFailedA = true; window->analysisActiveA = false; }
-            else { window->analysisFailedB = true; window->analysisActiveB = false; }
-            window->updateOverviewLabel(isDeckA);
-                }
+        QMetaObject::invokeMethod(w, [=, error = QString::fromStdString(e.what())]() {
+                if (!w || token.isCancelled()) return;
+                    w->noteBeatInfo(onDeckA, 0.0);
+                    w->setStatusTip(QString("Analysis failed: %1 - %2").arg(filename).arg(error));
             }, Qt::QueuedConnection);
         }
     }
+
+    // Background job after run(): a freshly detected grid goes to the BpmCache file, even if
+    // the deck has moved on since
+    void storeResult() const {
+        if (!detected) return;
+        EVENT_TRACE_SCOPE("BpmAnalysisTask::storeResult", "analysis");
+        BpmCache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString())).store(audioFile, *detected);
+    }
     
 private:
     QPointer<QtMainWindow> window; // Safe pointer that becomes null if window is destroyed
+    BpmAnalyzer* analyzer;         // owned by the window, outlives the jobs
+    AnalysisProgress* progress;    // the deck's, likewise
     juce::File audioFile;
     bool isDeckA;
+    bool provided{false};
+    std::shared_ptr<const BpmAnalyzer::Features> features;
+    std::shared_ptr<const BpmCache::Entry> known;
+    std::shared_ptr<const BpmCache::Entry> detected;
 };
 
-// NEW: Background task to generate WaveformDisplay data without blocking UI
-class TopWaveformDisplayTask : public QRunnable {
+// Loads a track onto a deck and decodes it once for everything that needs the PCM: the top
+// overview waveform (and the waveform cache the deck overview reads), the BPM window and, with
+// DecodeTracksToRam, the in-memory sample store, and with AutoGainAdjust the loudness the deck
+// trim comes from (cached after the first load). A streaming or memory-mapped source is handed
+// to the player before the pass so the track is playable right away; an in-memory one after it.
+// Once the deck's next load cancels it, the pass stops and nothing more reaches the deck.
+class AudioFileLoadTask {
 public:
-    TopWaveformDisplayTask(QtMainWindow* mainWindow, QString filePath, bool isDeckA)
-        : window(mainWindow), filePath(std::move(filePath)), isDeckA(isDeckA) {
-        setAutoDelete(true);
-    }
-
-    void run() override {
-        if (!window) return;
-        try {
-            QThread::currentThread()->setPriority(QThread::LowestPriority);
-            WaveformGenerator gen;
-            WaveformGenerator::Result res;
-            // High-res bins for smooth top overview
-            const int binCount = 16000;
-            if (!gen.generate(juce::File(filePath.toStdString()), binCount, res)) return;
-
-            auto maxBins = std::make_shared<std::vector<float>>(res.maxBins);
-            auto minBins = std::make_shared<std::vector<float>>(res.minBins);
-
-            const double audioStart = res.audioStartOffsetSec;
-            const double lengthSec = res.lengthSeconds;
-
-            const bool onDeckA = isDeckA;
-            QMetaObject::invokeMethod(window, [w = window, maxBins, minBins, audioStart, lengthSec, onDeckA]() {
-                if (!w) return;
-                WaveformDisplay* wf = onDeckA ? w->overviewTopA : w->overviewTopB;
-                if (wf) wf->setSourceBins(*maxBins, *minBins, audioStart, lengthSec);
-            }, Qt::QueuedConnection);
-        } catch (...) {
-            // Ignore errors; overview is non-critical
-        }
-    }
-
-private:
-    QPointer<QtMainWindow> window;
-    QString filePath;
-    bool isDeckA;
-};
+    // ownsWaveform: the caller claimed the file via WaveformGenerator::claimAnalysis().
+    // analysis: the job after this one, handed the pass's BPM features.
+    AudioFileLoadTask(QtMainWindow* mainWindow, QString filePath, bool isDeckA, bool ownsWaveform,
+                      std::shared_ptr<BpmAnalysisTask> analysis)
+        : window(mainWindow), filePath(std::move(filePath)), isDeckA(isDeckA), ownsWaveform(ownsWaveform),
+          analysis(std::move(analysis)) {}
 
-// NEW: Threaded Waveform Loading Task to prevent UI blocking
-class WaveformLoadTask : public QRunnable {
-public:
-    WaveformLoadTask(QtMainWindow* mainWindow, QString filePath, bool isDeckA) 
-        : window(mainWindow), filePath(std::move(filePath)), isDeckA(isDeckA) {
-        setAutoDelete(true);
+    ~AudioFileLoadTask() {
+        releaseWaveform();
     }
     
-    void run() override {
+    void run(const JobSystem::CancelToken& jobToken) {
         if (!window) return;
+        token = jobToken;
+        EVENT_TRACE_PHASES(phase, "AudioFileLoadTask: open reader", "load");
         
         try {
-            // PERFORMANCE: Set lower thread priority to prevent UI blocking
-            QThread::currentThread()->setPriority(QThread::LowPriority);
-            
-            // Signal loading start
-            QMetaObject::invokeMethod(window, [this]() {
-                if (window) {
-                    QString filename = QFileInfo(filePath).baseName();
-                    window->setStatusTip(QString("Loading waveform: %1...").arg(filename));
+            juce::File audioFile(filePath.toStdString());
+            // Loaded recently (reload, instant double): share what that load produced
+            const HotTrackCache::Entry hot = HotTrackCache::getInstance().find(audioFile);
+            QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+            std::unique_ptr<juce::AudioFormatReader> reader;
+            bool mapped = false;
+            if (hot.samples) {
+                reader = hot.samples->createView();
+            } else if (prefs.value("Performance/MemoryMapUncompressed", true).toBool()) {
+                // WAV/AIFF play straight from the file mapping: no decode, no RAM copy
+                reader = MappedTrackReader::open(audioFile, *window->sharedFormatManager);
+                mapped = reader != nullptr;
+            }
+            if (!reader) reader.reset(window->sharedFormatManager->createReaderFor(audioFile));
+            if (!reader) {
+                // Thread-safe error handling
+                QMetaObject::invokeMethod(window, [w = window, path = filePath]() {
+                    if (w) w->setStatusTip(QString("Failed to load audio file: %1").arg(QFileInfo(path).fileName()));
+                }, Qt::QueuedConnection);
+                return;
+            }
+
+            // Separated before: the deck plays the stems (already in RAM), the pass below still
+            // reads the track itself for whatever analysis it lacks
+            StemTrackReader::StemsPtr stems;
+            if (prefs.value("Stems/Enabled", true).toBool()) {
+                const StemCache stemCache(juce::File(AppConfig::instance().getWaveformCacheDirectory().toStdString()));
+                if (stemCache.contains(audioFile)) {
+                    MemoryBudget::getInstance().makeRoom(stemCache.getCacheFileFor(audioFile).getSize());
+                    stems = stemCache.load(audioFile);
+                    // Decoded to another length than the track's (a different decoder): not aligned
+                    if (stems && stems->lengthInSamples != reader->lengthInSamples) stems.reset();
                 }
-            }, Qt::QueuedConnection);
-            
-            // Get track length for immediate UI update
-            juce::File f(filePath.toStdString());
-            auto* reader = QtMainWindow::sharedFormatManager->createReaderFor(f);
-            double trackLength = 0.0;
-            if (reader) {
-                trackLength = reader->lengthInSamples / reader->sampleRate;
-                delete reader;
             }
-            
-            // Thread-safe waveform loading completion
-            QMetaObject::invokeMethod(window, [=]() {
-                if (window) {
-                    // Get the appropriate waveform display
-                    WaveformDisplay* waveform = isDeckA ? window->overviewTopA : window->overviewTopB;
-                    if (waveform) {
-                        // Load waveform and set up defaults
-                        waveform->loadFile(filePath);
-                        waveform->setPlayhead(0.0);
-                        waveform->setTrackLength(trackLength);
-                        waveform->update();
-                        
-                        QString filename = QFileInfo(filePath).baseName();
-                        window->setStatusTip(QString("Waveform loaded: %1").arg(filename));
-                    }
+
+            // Optional: decode the whole track into RAM so seeks/scratching never hit the decoder,
+            // converted to the device rate on the way so the deck only resamples for tempo, and
+            // (CompressTracksInRam) packed losslessly so more tracks stay hot
+            std::unique_ptr<InMemoryTrackReader::Builder> ramStore;
+            if (!stems && !hot.samples && !mapped && prefs.value("Performance/DecodeTracksToRam", false).toBool()) {
+                const DJAudioPlayer* target = isDeckA ? window->playerA : window->playerB;
+                const double deviceRate = target ? target->getDeviceSampleRate() : 0.0;
+                const bool compressed = prefs.value("Performance/CompressTracksInRam", true).toBool();
+                // Caches (samples kept only for a possible reload first) make room for the track being loaded
+                auto& budget = MemoryBudget::getInstance();
+                budget.makeRoom(InMemoryTrackReader::bytesNeededFor(*reader, compressed ? InMemoryTrackReader::SampleFormat::Compressed
+                                                                                        : InMemoryTrackReader::SampleFormat::Float32, deviceRate));
+                ramStore = InMemoryTrackReader::Builder::create(*reader, budget.getAvailableBytes(), deviceRate, compressed);
+            }
+
+            // Top overview bins; shared from the last load, or straight from the cache for a known track.
+            // They carry the audible start, which cues the deck as soon as they are shown.
+            EVENT_TRACE_NEXT(phase, "AudioFileLoadTask: cached waveform");
+            autoCue = prefs.value("Decks/AutoCue", true).toBool();
+            WaveformGenerator gen;
+            WaveformGenerator::Result wave;
+            bool haveWave = false;
+            if (hot.waveform) {
+                postWaveform(hot.waveform);
+                haveWave = true;
+            } else if (ownsWaveform && gen.loadCached(audioFile, TopOverviewBins, wave)) {
+                HotTrackCache::getInstance().storeWaveform(audioFile, postWaveform(std::move(wave)));
+                haveWave = true;
+            }
+            // The spectrogram view's columns; nullptr clears the last track's until this pass has them
+            const SpectrogramCache spectrogramCache(WaveformGenerator::getCacheDirectory());
+            Spectrogram::SharedData spectrogram = spectrogramCache.load(audioFile);
+            postSpectrogram(spectrogram);
+            const bool needSpectrogram = ownsWaveform && !spectrogram;
+            // Known beat grid: the analysis job answers from the cache, the pass needn't run the detectors
+            const BpmCache bpmCache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString()));
+            const bool bpmCached = hot.beatGrid || bpmCache.contains(audioFile);
+            // AUTO GAIN: a measured track gets its trim now, a new one plays at unity until the pass has it
+            const bool autoGain = prefs.value("Decks/AutoGainAdjust", true).toBool();
+            const double targetLufs = prefs.value("Decks/AutoGainTargetLufs", LoudnessMeter::DefaultTargetLufs).toDouble();
+            BpmCache::Loudness loudness;
+            const bool loudnessKnown = autoGain && bpmCache.loadLoudness(audioFile, loudness);
+            postTrim(LoudnessMeter::trimGainFor(loudness, targetLufs));
+            const bool measureLoudness = autoGain && !loudnessKnown;
+            const bool needPass = ramStore || (ownsWaveform && !haveWave) || needSpectrogram || !bpmCached || measureLoudness;
+
+            // Streaming playback gets its own reader; the pass below reads the other one
+            std::unique_ptr<juce::AudioFormatReader> analysisReader;
+            if (ramStore) {
+                analysisReader = std::move(reader);
+            } else if (stems) {
+                if (needPass) analysisReader = std::move(reader);
+                postSource(std::make_unique<StemTrackReader>(stems));
+            } else {
+                if (needPass) {
+                    if (hot.samples) analysisReader = hot.samples->createView();
+                    else analysisReader.reset(window->sharedFormatManager->createReaderFor(audioFile));
                 }
-            }, Qt::QueuedConnection);
+                postSource(std::move(reader));
+            }
+            if (needPass && !analysisReader) return;
+            // Fresh analysis: show bins as the pass reaches them, the intro within the first blocks
+            WaveformGenerator::SummaryBuilder waveSink;
+            waveSink.setPartialListener(TopOverviewBins, [this](WaveformGenerator::SummaryBuilder::Partial&& partial) {
+                auto bins = std::make_shared<WaveformGenerator::SummaryBuilder::Partial>(std::move(partial));
+                QMetaObject::invokeMethod(window, [w = window, path = filePath, onDeckA = isDeckA, bins]() {
+                    if (!w) return;
+                    QtDeckWidget* deck = onDeckA ? w->deckA : w->deckB;
+                    WaveformDisplay* wf = onDeckA ? w->overviewTopA : w->overviewTopB;
+                    if (!deck || !wf || deck->getCurrentFilePath() != path) return;
+                    if (bins->firstBin == 0) wf->beginSourceBins(bins->binCount, bins->audioStartOffsetSec, bins->lengthSeconds);
+                    wf->updateSourceBins(bins->firstBin, bins->maxBins, bins->minBins);
+                }, Qt::QueuedConnection);
+            });
+            BpmAnalyzer::FeatureExtractor bpmSink(120.0);
+            LoudnessMeter loudnessSink;
+            Spectrogram spectrogramSink;
+
+            EVENT_TRACE_NEXT(phase, "AudioFileLoadTask: decode pass");
+            if (needPass) {
+                TrackDecodePipeline pipeline(*analysisReader);
+                pipeline.setStopCondition([this] { return token.isCancelled(); });
+                // A RAM copy is read from memory; a file goes ahead of the library analysis on its disk
+                if (!hot.samples) pipeline.setScheduledIo(audioFile, IoScheduler::Priority::Deck);
+                if (ownsWaveform && !haveWave) pipeline.addSink(&waveSink);
+                if (!bpmCached) pipeline.addSink(&bpmSink);
+                if (measureLoudness) pipeline.addSink(&loudnessSink);
+                if (needSpectrogram) pipeline.addSink(&spectrogramSink);
+                pipeline.addSink(ramStore.get());
+                pipeline.run();
+            }
+            if (measureLoudness && loudnessSink.getResult().valid) {
+                bpmCache.storeLoudness(audioFile, loudnessSink.getResult());
+                postTrim(LoudnessMeter::trimGainFor(loudnessSink.getResult(), targetLufs));
+            }
+
+            EVENT_TRACE_NEXT(phase, "AudioFileLoadTask: publish");
+            if (ramStore) {
+                std::shared_ptr<const InMemoryTrackReader> samples = ramStore->takeReader();
+                if (samples) {
+                    HotTrackCache::getInstance().storeSamples(audioFile, samples);
+                    postSource(samples->createView());
+                } else {
+                    postSource(std::move(analysisReader));
+                }
+            }
+
+            // The finished summary adds the zoom pyramid and band colours
+            if (waveSink.isComplete()) {
+                gen.publish(audioFile, waveSink.getSummary(), TopOverviewBins, wave);
+                HotTrackCache::getInstance().storeWaveform(audioFile, postWaveform(std::move(wave)));
+            }
+            if (needSpectrogram && !token.isCancelled()) {
+                if ((spectrogram = spectrogramSink.takeData())) {
+                    spectrogramCache.store(audioFile, *spectrogram);
+                    postSpectrogram(spectrogram);
+                }
+            }
+            releaseWaveform();
+            // Another deck was analysing the same file: its summary is in the cache by now
+            if (!ownsWaveform && !haveWave && gen.generate(audioFile, TopOverviewBins, wave)) postWaveform(std::move(wave));
+            if (!ownsWaveform && !spectrogram && (spectrogram = spectrogramCache.load(audioFile))) postSpectrogram(spectrogram);
+
+            // The analysis job runs next; a superseded load leaves it nothing to do
+            if (!token.isCancelled()) analysis->provide(bpmSink.takeFeatures(), hot.beatGrid);
             
         } catch (const std::exception& e) {
             // Thread-safe error handling
-            QMetaObject::invokeMethod(window, [this, error = QString::fromStdString(e.what())]() {
-                if (window) {
-                    QString filename = QFileInfo(filePath).baseName();
-                    window->setStatusTip(QString("Waveform loading failed: %1 - %2").arg(filename).arg(error));
-                }
+            QMetaObject::invokeMethod(window, [w = window, path = filePath, error = QString::fromStdString(e.what())]() {
+                if (w) w->setStatusTip(QString("Audio loading error: %1 - %2").arg(QFileInfo(path).fileName()).arg(error));
             }, Qt::QueuedConnection);
         }
     }
     
 private:
+    static constexpr int TopOverviewBins = HotTrackCache::OverviewBins; // high-res bins for smooth top overview
+
+    // UI thread: only while the deck still has this track
+    void postTrim(double gain) {
+        if (token.isCancelled()) return;
+        QMetaObject::invokeMethod(window, [w = window, path = filePath, onDeckA = isDeckA, gain]() {
+            if (!w) return;
+            QtDeckWidget* deck = onDeckA ? w->deckA : w->deckB;
+            DJAudioPlayer* player = onDeckA ? w->playerA : w->playerB;
+            if (!deck || !player || deck->getCurrentFilePath() != path) return;
+            player->setTrimGain(gain);
+        }, Qt::QueuedConnection);
+    }
+
+    // The player's whole playback chain is built and prepared here; the main thread only hands
+    // it over and the audio thread swaps it in at its next block
+    void postSource(std::unique_ptr<juce::AudioFormatReader> reader) {
+        DJAudioPlayer* target = isDeckA ? window->playerA : window->playerB;
+        if (!target || token.isCancelled()) return;
+        const double sampleRate = reader->sampleRate;
+        EVENT_TRACE_SCOPE("AudioFileLoadTask: prepare track", "load");
+        auto* loaded = target->prepareTrack(std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true),
+                                            sampleRate).release();
+        QMetaObject::invokeMethod(window, [w = window, path = filePath, onDeckA = isDeckA, loaded, cancel = token]() {
+            EVENT_TRACE_SCOPE("Deck load: apply track", "ui");
+            std::unique_ptr<DJAudioPlayer::LoadedTrack> loadedPtr(loaded);
+            // A later load on this deck wins, however the two finish
+            if (!w || cancel.isCancelled()) return;
+            DJAudioPlayer* player = onDeckA ? w->playerA : w->playerB;
+            QtDeckWidget* deckWidget = onDeckA ? w->deckA : w->deckB;
+            if (player && deckWidget) {
+                w->noteTrackLoaded(onDeckA, path);
+                player->applyLoadedTrack(std::move(loadedPtr));
+                
+                // Update UI elements on main thread
+                deckWidget->onFileLoadingComplete(path);
+                w->finishInstantDouble(onDeckA, path);
+            }
+        }, Qt::QueuedConnection);
+    }
+
+    WaveformGenerator::SharedResult postWaveform(WaveformGenerator::Result&& result) {
+        // Moved into one shared allocation; the display keeps a reference, nothing is copied
+        WaveformGenerator::SharedResult wave = std::make_shared<const WaveformGenerator::Result>(std::move(result));
+        postWaveform(wave);
+        return wave;
+    }
+
+    void postWaveform(WaveformGenerator::SharedResult wave) {
+        QMetaObject::invokeMethod(window, [w = window, path = filePath, onDeckA = isDeckA, wave, cue = autoCue, cancel = token]() {
+            EVENT_TRACE_SCOPE("Deck load: show waveform", "ui");
+            if (!w || cancel.isCancelled()) return;
+            QtDeckWidget* deck = onDeckA ? w->deckA : w->deckB;
+            WaveformDisplay* wf = onDeckA ? w->overviewTopA : w->overviewTopB;
+            if (!deck || !wf || deck->getCurrentFilePath() != path) return;
+            wf->setSourceBins(wave);
+            if (cue) deck->setAutoCue(wave->audioStartOffsetSec);
+        }, Qt::QueuedConnection);
+    }
+
+    void postSpectrogram(Spectrogram::SharedData spectrogram) {
+        QMetaObject::invokeMethod(window, [w = window, path = filePath, onDeckA = isDeckA, spectrogram, cancel = token]() {
+            if (!w || cancel.isCancelled()) return;
+            QtDeckWidget* deck = onDeckA ? w->deckA : w->deckB;
+            WaveformDisplay* wf = onDeckA ? w->overviewTopA : w->overviewTopB;
+            if (!deck || !wf || deck->getCurrentFilePath() != path) return;
+            wf->setSpectrogram(std::move(spectrogram));
+        }, Qt::QueuedConnection);
+    }
+
+    void releaseWaveform() {
+        if (!ownsWaveform || waveformReleased) return;
+        WaveformGenerator::releaseAnalysis(juce::File(filePath.toStdString()));
+        waveformReleased = true;
+    }
+
     QPointer<QtMainWindow> window;
     QString filePath;
     bool isDeckA;
+    bool ownsWaveform;
+    bool waveformReleased{false};
+    bool autoCue{false};
+    std::shared_ptr<BpmAnalysisTask> analysis;
+    JobSystem::CancelToken token;
 };
 
 QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
@@ -489,41 +515,45 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     // BetaPulseX: Setup Menu System
     menuBar = new MenuBar(this);
     
-    // Initialize or reuse shared format manager for better performance
-    if (!sharedFormatManager) {
-        sharedFormatManager = new juce::AudioFormatManager();
-        
-        // Register JUCE's basic formats (includes built-in MP3 support with JUCE_USE_MP3AUDIOFORMAT=1)
-        sharedFormatManager->registerBasicFormats();
-        
-        std::cout << "Audio format manager initialized with " 
-                  << sharedFormatManager->getNumKnownFormats() << " formats" << std::endl;
-        
-        // List supported formats
-        for (int i = 0; i < sharedFormatManager->getNumKnownFormats(); ++i) {
-            auto* format = sharedFormatManager->getKnownFormat(i);
-            std::cout << "Supported format: " << format->getFormatName().toStdString() 
-                      << " (" << format->getFileExtensions().joinIntoString(", ").toStdString() << ")" << std::endl;
-        }
-    }
-    formatManagerRefCount++;
+    // The app's one format manager; main() set up its MP3 backend
+    sharedFormatManager = &DecoderRegistry::getInstance().getFormatManager();
+    StartupTimeline::mark("decoders registered");
 
-        // Enhanced thread pool configuration for BPM analysis and waveform loading performance
-    bpmThreadPool = std::make_unique<QThreadPool>();
-    
-    // PERFORMANCE: Optimize thread count for both BMP analysis and waveform loading
-    int idealThreads = QThread::idealThreadCount();
-    int maxBmpThreads = std::min(4, std::max(2, idealThreads / 2)); // Increased to 4 max for waveform+BMP
-    bpmThreadPool->setMaxThreadCount(maxBmpThreads);
-    
-    // Set expiry timeout to clean up idle threads (saves memory)
-    bpmThreadPool->setExpiryTimeout(30000); // 30 seconds
-    
-    std::cout << "Audio processing thread pool: " << maxBmpThreads 
-              << " threads (system has " << idealThreads << " cores)" << std::endl;
+    // Deck loads, their analysis and cache writes; Performance/CpuCores workers
+    jobSystem = std::make_unique<JobSystem>();
 
     playerA = new DJAudioPlayer(*sharedFormatManager);
     playerB = new DJAudioPlayer(*sharedFormatManager);
+    samplerBank.setFormatManager(sharedFormatManager);
+    playerA->setAutomation(&mixAutomation, 0);
+    playerB->setAutomation(&mixAutomation, 1);
+    // Frame stamps for SessionReplay; the mixer outlives every device restart
+    mixAutomation.setFrameClock([this]() -> juce::int64 {
+        return deckMixer && deviceManager.getCurrentAudioDevice() ? deckMixer->getRenderedFrames() : -1;
+    });
+    
+    // READ-AHEAD: one background decoder thread feeds every deck, buffer size per deck
+    readAheadThread = std::make_unique<juce::TimeSliceThread>("Deck Read-Ahead");
+    readAheadThread->startThread(juce::Thread::Priority::high);
+    {
+        QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+        playerA->setReadAhead(readAheadThread.get(), prefs.value("Decks/DeckAReadAheadMs", 1500).toInt());
+        playerB->setReadAhead(readAheadThread.get(), prefs.value("Decks/DeckBReadAheadMs", 1500).toInt());
+        previewPlayer.setReadAheadThread(readAheadThread.get());
+        MemoryBudget::getInstance().setLimitBytes((int64_t) prefs.value("Performance/MemoryLimitMB", 1024).toInt() * 1024 * 1024);
+        memoryPressureMonitor = std::make_unique<MemoryPressureMonitor>();
+        // 0 = linear, 1 = windowed sinc
+        const auto engine = prefs.value("Audio/VarispeedQuality", 1).toInt() == 0
+            ? VarispeedResampler::Engine::Linear : VarispeedResampler::Engine::Sinc;
+        playerA->setResamplerEngine(engine);
+        playerB->setResamplerEngine(engine);
+        // 0 = fast, 1 = balanced, 2 = quality; the governor never steps above this
+        const auto keylockQuality = (DJAudioPlayer::KeylockQuality) juce::jlimit(0, 2, prefs.value("Audio/KeylockQuality", 1).toInt());
+        playerA->setKeylockQuality(keylockQuality);
+        playerB->setKeylockQuality(keylockQuality);
+        keylockGovernor.setPreferredQuality(keylockQuality);
+        keylockGovernor.setEnabled(prefs.value("Performance/KeylockAutoQuality", true).toBool());
+    }
 
     qDebug() << "QtMainWindow: About to create deck widgets";
     std::cout << "=== CREATING DECK WIDGETS ===" << std::endl;
@@ -534,19 +564,28 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     qDebug() << "QtMainWindow: Deck B created";
     std::cout << "=== DECK B CREATED ===" << std::endl;
 
-    // BetaPulseX: Lade und wende gespeicherte Deck-Einstellungen an (verzögert)
-    // Verwende QTimer::singleShot um sicherzustellen, dass alle Widgets initialisiert sind
-    std::cout << "*** SCHEDULING applyDeckSettings() with 100ms delay ***" << std::endl;
-    QTimer::singleShot(100, this, [this]() {
-        std::cout << "*** QTimer callback FIRED - calling applyDeckSettings() ***" << std::endl;
-        applyDeckSettings();
-    });
+    // Saved deck settings are applied once the window is up (runStartupStages)
 
     // Top overview waveforms (two stacked, centered playhead)
     overviewTopA = new WaveformDisplay(this);
     overviewTopB = new WaveformDisplay(this);
     overviewTopA->setScrollMode(true);
     overviewTopB->setScrollMode(true);
+    {
+        QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+        const int waveformQuality = prefs.value("Interface/WaveformQuality", 75).toInt();
+        overviewTopA->setWaveformQuality(waveformQuality);
+        overviewTopB->setWaveformQuality(waveformQuality);
+    }
+    phaseCompare = new WaveformDisplay(this);
+    phaseCompare->setPhaseCompare(overviewTopA, overviewTopB);
+    phaseCompare->setObjectName("Phase compare");
+    refreshDeckViews();
+    // Names the frame-time HUD shows
+    overviewTopA->setObjectName("Waveform A");
+    overviewTopB->setObjectName("Waveform B");
+    if (deckA->getWaveform()) deckA->getWaveform()->setObjectName("Overview A");
+    if (deckB->getWaveform()) deckB->getWaveform()->setObjectName("Overview B");
     // Click-to-seek on top overview waveforms (works while paused)
     connect(overviewTopA, &WaveformDisplay::positionClicked, this, [this](double absRel){
         if (!playerA) return;
@@ -579,10 +618,12 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     // Connect beat indicator to deck widgets for performance pads
     deckA->setBeatIndicator(beatIndicator);
     deckB->setBeatIndicator(beatIndicator);
+    if (deckA->getPerformancePads()) deckA->getPerformancePads()->setSamplerBank(&samplerBank, 0);
+    if (deckB->getPerformancePads()) deckB->getPerformancePads()->setSamplerBank(&samplerBank, 8);
 
     // Scratch interactions for overview waveforms - proper vinyl-style scratching
     connect(overviewTopA, &WaveformDisplay::scratchStart, this, [this]() {
-        if (!playerA) return;
+        if (!playerA || timecodeDecoderA) return;
         // Remember previous state, but ensure audio flows during scratching
         scratchWasPlayingA = playerA->isPlaying();
         playerA->enableScratch(true);
@@ -591,23 +632,21 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
         }
     });
     connect(overviewTopA, &WaveformDisplay::scratchMove, this, [this](double absRel) {
-        if (!playerA) return;
+        if (!playerA || timecodeDecoderA) return;
         // PREROLL SUPPORT: Allow unlimited negative positions for DJ cueing
         // Remove clamping to allow preroll positions
         absRel = std::min(1.0, absRel); // Only clamp maximum, allow unlimited negative
-        // Only update audio player position - UI is already updated by the waveform itself
-        playerA->setPositionRelative(absRel);
+        // Stamped here and integrated on the audio thread; the UI is already updated by the waveform itself
+        const double seconds = absRel < 0.0 ? absRel * playerA->getPrerollSeconds() : absRel * playerA->getLengthInSeconds();
+        playerA->pushScratchPosition(seconds, DeckMixer::nowNs());
         // Update deck waveform to stay in sync
         if (deckA && deckA->getWaveform()) {
             deckA->getWaveform()->setPlayhead(absRel);
         }
     });
-    connect(overviewTopA, &WaveformDisplay::scratchVelocityChanged, this, [this](double velocity) {
-        if (!playerA) return;
-        playerA->setScratchVelocity(velocity);
-    });
     connect(overviewTopA, &WaveformDisplay::scratchEnd, this, [this]() {
-        if (!playerA) return;
+        // The turntable owns the deck under timecode control
+        if (!playerA || timecodeDecoderA) return;
         
         // Mark exact scratch end time for timer system
         lastScratchEndA = QDateTime::currentMSecsSinceEpoch();
@@ -631,7 +670,7 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     });
 
     connect(overviewTopB, &WaveformDisplay::scratchStart, this, [this]() {
-        if (!playerB) return;
+        if (!playerB || timecodeDecoderB) return;
         // Remember previous state, but ensure audio flows during scratching
         scratchWasPlayingB = playerB->isPlaying();
         playerB->enableScratch(true);
@@ -640,23 +679,21 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
         }
     });
     connect(overviewTopB, &WaveformDisplay::scratchMove, this, [this](double absRel) {
-        if (!playerB) return;
+        if (!playerB || timecodeDecoderB) return;
         // PREROLL SUPPORT: Allow unlimited negative positions for DJ cueing
         // Remove clamping to allow preroll positions
         absRel = std::min(1.0, absRel); // Only clamp maximum, allow unlimited negative
-        // Only update audio player position - UI is already updated by the waveform itself
-        playerB->setPositionRelative(absRel);
+        // Stamped here and integrated on the audio thread; the UI is already updated by the waveform itself
+        const double seconds = absRel < 0.0 ? absRel * playerB->getPrerollSeconds() : absRel * playerB->getLengthInSeconds();
+        playerB->pushScratchPosition(seconds, DeckMixer::nowNs());
         // Update deck waveform to stay in sync
         if (deckB && deckB->getWaveform()) {
             deckB->getWaveform()->setPlayhead(absRel);
         }
     });
-    connect(overviewTopB, &WaveformDisplay::scratchVelocityChanged, this, [this](double velocity) {
-        if (!playerB) return;
-        playerB->setScratchVelocity(velocity);
-    });
     connect(overviewTopB, &WaveformDisplay::scratchEnd, this, [this]() {
-        if (!playerB) return;
+        // The turntable owns the deck under timecode control
+        if (!playerB || timecodeDecoderB) return;
         
         // Mark exact scratch end time for timer system
         lastScratchEndB = QDateTime::currentMSecsSinceEpoch();
@@ -681,64 +718,24 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
 
     // NEW: Handle threaded audio file loading to prevent UI blocking
     connect(deckA, &QtDeckWidget::fileLoadingStarted, [this](const QString& filePath) {
-        if (!filePath.isEmpty()) {
-            // Start audio file loading in background thread
-            bpmThreadPool->start(new AudioFileLoadTask(this, filePath, true));
-        }
+        if (!filePath.isEmpty()) startDeckLoad(true, filePath);
     });
     
     connect(deckB, &QtDeckWidget::fileLoadingStarted, [this](const QString& filePath) {
-        if (!filePath.isEmpty()) {
-            // Start audio file loading in background thread
-            bpmThreadPool->start(new AudioFileLoadTask(this, filePath, false));
-        }
+        if (!filePath.isEmpty()) startDeckLoad(false, filePath);
     });
-
-        // When deck files load, forward to overview waveforms and reset position
-    connect(deckA, &QtDeckWidget::fileLoaded, [this]() {
-        QString filePath = deckA->getCurrentFilePath();
-        if (!filePath.isEmpty()) {
-            // PERFORMANCE FIX: Generate top overview waveform in background
-            bpmThreadPool->start(new TopWaveformDisplayTask(this, filePath, true));
-            
-            // Start BPM analysis asynchronously using thread pool
-            if (!bpmAnalyzer) bpmAnalyzer = new BpmAnalyzer(*sharedFormatManager);
-            juce::File f(filePath.toStdString());
-            bpmThreadPool->start(new BpmAnalysisTask(this, f, true));
-        }
+    connect(deckA, &QtDeckWidget::fileLoaded, this, [this]() {
+        if (webRemote) webRemote->setTrack(0, juce::File(deckA->getCurrentFilePath().toStdString()));
     });
-
-    connect(deckB, &QtDeckWidget::fileLoaded, [this]() {
-        QString filePath = deckB->getCurrentFilePath();
-        if (!filePath.isEmpty()) {
-            // Generate top overview waveform in background immediately (waveform visible)
-            bpmThreadPool->start(new TopWaveformDisplayTask(this, filePath, false));
-
-            // Start BPM analysis asynchronously using thread pool for Deck B (beat grid later)
-            if (!bpmAnalyzer) bpmAnalyzer = new BpmAnalyzer(*sharedFormatManager);
-            juce::File f(filePath.toStdString());
-            bpmThreadPool->start(new BpmAnalysisTask(this, f, false));
-        }
+    connect(deckB, &QtDeckWidget::fileLoaded, this, [this]() {
+        if (webRemote) webRemote->setTrack(1, juce::File(deckB->getCurrentFilePath().toStdString()));
     });
+
+    // Top overview bins and BPM analysis come out of AudioFileLoadTask's shared decode pass
     // When playhead updates on deck, update overview playhead and beat indicator
     connect(deckA, &QtDeckWidget::playheadUpdated, this, [this](double relative) {
-        double deviceLatencySec = 0.0;
-        if (auto* dev = deviceManager.getCurrentAudioDevice()) {
-            const double sr = dev->getCurrentSampleRate();
-            if (sr > 0.0) {
-                // Prefer device-reported output latency, else approximate with 1.5x buffer size
-                const int buf = dev->getCurrentBufferSizeSamples();
-                const int outLat = dev->getOutputLatencyInSamples();
-                if (outLat > 0) deviceLatencySec = outLat / sr; else deviceLatencySec = (buf > 0 ? (1.5 * buf) / sr : 0.0);
-            }
-        }
-        double pipelineLatencySec = playerA ? playerA->getPipelineLatencySeconds() : 0.0;
         // Align center with audible output: subtract total playback latency
-        double visualDelay = std::clamp(pipelineLatencySec + deviceLatencySec, 0.0, 0.25);
-        // Predict frame/display pipeline delay to the next vsync to avoid visual lead
-        constexpr double uiFudgeSec = 0.012; // ~12 ms safety (display/vsync)
-        // Apply optional user trim (positive delays visuals more)
-        double totalDelay = visualDelay + uiFudgeSec + std::clamp(userVisualTrimA, -0.05, 0.05);
+        const double totalDelay = getVisualDelaySeconds(playerA, userVisualTrimA);
         // Compute audible-relative playhead and feed it directly
         if (playerA) {
             double len = std::max(1e-9, playerA->getLengthInSeconds());
@@ -759,19 +756,7 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
         }
     });
     connect(deckB, &QtDeckWidget::playheadUpdated, this, [this](double relative) {
-        double deviceLatencySec = 0.0;
-        if (auto* dev = deviceManager.getCurrentAudioDevice()) {
-            const double sr = dev->getCurrentSampleRate();
-            if (sr > 0.0) {
-                const int buf = dev->getCurrentBufferSizeSamples();
-                const int outLat = dev->getOutputLatencyInSamples();
-                if (outLat > 0) deviceLatencySec = outLat / sr; else deviceLatencySec = (buf > 0 ? (1.5 * buf) / sr : 0.0);
-            }
-        }
-        double pipelineLatencySec = playerB ? playerB->getPipelineLatencySeconds() : 0.0;
-    double visualDelay = std::clamp(pipelineLatencySec + deviceLatencySec, 0.0, 0.25);
-    constexpr double uiFudgeSec = 0.012; // ~12 ms safety (display/vsync)
-    double totalDelay = visualDelay + uiFudgeSec + std::clamp(userVisualTrimB, -0.05, 0.05);
+        const double totalDelay = getVisualDelaySeconds(playerB, userVisualTrimB);
         if (playerB) {
             double len = std::max(1e-9, playerB->getLengthInSeconds());
             double audibleRel = std::clamp(relative - (totalDelay / len), 0.0, 1.0);
@@ -823,6 +808,27 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
         connect(deckB, &QtDeckWidget::loopChanged, deckB->getWaveform(), &DeckWaveformOverview::setLoopRegion);
     }
     
+    // Cues and the loop last left go to the track's BpmCache record
+    for (const bool isA : { true, false }) {
+        QtDeckWidget* deck = isA ? deckA : deckB;
+        PerformancePads* pads = deck ? deck->getPerformancePads() : nullptr;
+        if (!pads) continue;
+        connect(pads, &PerformancePads::cuePointsChanged, this, [this, isA](const std::array<double, 8>& cues) {
+            BpmCache::Memory& memory = isA ? trackMemoryA : trackMemoryB;
+            if (memory.cues == cues) return;
+            memory.cues = cues;
+            storeTrackMemory(isA);
+        });
+        connect(pads, &PerformancePads::ghostLoopChanged, this, [this, isA](bool enabled, double startSec, double endSec) {
+            // Cleared when a new loop starts; that loop is kept once it is left
+            BpmCache::Memory& memory = isA ? trackMemoryA : trackMemoryB;
+            if (!enabled || (memory.loopStartSec == startSec && memory.loopEndSec == endSec)) return;
+            memory.loopStartSec = startSec;
+            memory.loopEndSec = endSec;
+            storeTrackMemory(isA);
+        });
+    }
+
     // Connect ghost loop status from performance pads to top waveform displays
     if (deckA->getPerformancePads()) {
         connect(deckA->getPerformancePads(), &PerformancePads::ghostLoopChanged, overviewTopA, &WaveformDisplay::setGhostLoopRegion);
@@ -975,11 +981,20 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
         // who == deckA means A wants to follow B when enabled
         syncAEnabled = enabled;
         if (enabled) doSync(who); // immediate align
+        // Phase lock from then on runs in the mixer, once per audio block
+        if (deckMixer) {
+            deckMixer->setChannelSync(mixerChannelA, enabled);
+            if (enabled) deckMixer->setSyncMaster(mixerChannelB);
+        }
     });
     connect(deckB, &QtDeckWidget::syncToggled, this, [this, doSync](QtDeckWidget* who, bool enabled){
         // who == deckB means B wants to follow A when enabled
         syncBEnabled = enabled;
         if (enabled) doSync(who); // immediate align
+        if (deckMixer) {
+            deckMixer->setChannelSync(mixerChannelB, enabled);
+            if (enabled) deckMixer->setSyncMaster(mixerChannelA);
+        }
     });
 
     // Update overview labels to show only original analyzed BPM (not speed-scaled)
@@ -992,10 +1007,7 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     updateOverviewLabel(false);
     });
 
-    // Defer audio device initialization until after Qt setup
-    QTimer::singleShot(100, this, [this]() {
-        initializeAudio();
-    });
+    // The audio device opens once the window is up (runStartupStages)
 
     // Initialize new LibraryManager with ID3 tag support
     libraryManager = new LibraryManager(sharedFormatManager, this);
@@ -1013,14 +1025,83 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
         }
     });
     
-    // Auto-populate with user's Music folder on startup
-    QTimer::singleShot(500, this, [this]() {
-        QDir musicDir(QDir::homePath());
-        musicDir.cd("Music");
-        if (musicDir.exists()) {
-            libraryManager->addDirectory(musicDir.absolutePath(), false); // Non-recursive for quick startup
+    // Audition from the mini waveform without touching a deck; Escape in the list stops it
+    previewTimer = new QTimer(this);
+    previewTimer->setInterval(40);
+    connect(previewTimer, &QTimer::timeout, this, [this]() {
+        if (previewPlayer.isPlaying()) {
+            libraryManager->setPreviewPosition(QString::fromStdString(previewPlayer.getFile().getFullPathName().toStdString()),
+                                               previewPlayer.getPosition());
+            return;
+        }
+        // Ran out: gone from the list, and its chain retired
+        previewPlayer.stop();
+        libraryManager->setPreviewPosition(QString(), 0.0);
+        previewTimer->stop();
+    });
+    connect(libraryManager, &LibraryManager::previewRequested, this, &QtMainWindow::previewTrack);
+    connect(libraryManager, &LibraryManager::previewStopRequested, this, [this]() {
+        previewPlayer.stop();
+        libraryManager->setPreviewPosition(QString(), 0.0);
+        previewTimer->stop();
+    });
+    
+    // Analyse what the library holds in the background; results land in the BPM column
+    libraryAnalyzer = new LibraryAnalyzer(this);
+    libraryAnalyzer->setDeckJobs(jobSystem.get());
+    connect(libraryManager, &LibraryManager::libraryUpdated, this, [this]() {
+        libraryAnalyzer->enqueue(libraryManager->getAllFiles());
+    });
+    connect(libraryAnalyzer, &LibraryAnalyzer::trackAnalyzed, libraryManager, &LibraryManager::setTrackAnalysis);
+    connect(libraryAnalyzer, &LibraryAnalyzer::duplicatesFound, libraryManager, &LibraryManager::addDuplicates);
+    
+    // Prepare the highlighted tracks for a deck load: page cache and cached analysis now,
+    // tracks never analysed to the front of the library queue (highlighted one first)
+    trackPrefetcher = new TrackPrefetcher();
+    connect(libraryManager, &LibraryManager::tracksHighlighted, this, [this](const QStringList& files) {
+        if (trackPrefetcher) trackPrefetcher->prefetch(files);
+        if (libraryAnalyzer)
+            for (auto it = files.crbegin(); it != files.crend(); ++it) libraryAnalyzer->promote(*it);
+    });
+
+    // Before a set: the active crate analysed, verified and pinned in the hot cache
+    gigPrep = new GigPrep(this);
+    connect(libraryManager, &LibraryManager::gigPrepRequested, this, [this](const QString& name, const QStringList& files) {
+        if (!gigPrep) return;
+        libraryManager->setGigPrepProgress(0, (int) files.size());
+        gigPrep->prepare(name, files, playerA ? playerA->getDeviceSampleRate() : 0.0);
+    });
+    connect(libraryManager, &LibraryManager::gigPrepCancelRequested, this, [this]() {
+        if (gigPrep) gigPrep->cancel();
+    });
+    connect(gigPrep, &GigPrep::progress, libraryManager, &LibraryManager::setGigPrepProgress);
+    connect(gigPrep, &GigPrep::finished, this, [this](const QString& name, int prepared, const QStringList& failed, bool cancelled) {
+        if (gigPrep && gigPrep->isRunning()) return;   // a cancelled run ending behind the next one
+        libraryManager->setGigPrepProgress(0, 0);
+        QString text = QString("%1 track(s) of \"%2\" are analysed, cached and pinned for the set.").arg(prepared).arg(name);
+        if (cancelled) text += "\nPreparation was cancelled; the rest of the crate loads as usual.";
+        if (!failed.isEmpty()) {
+            QMessageBox box(QMessageBox::Warning, "Gig Preparation", text + QString("\n\n%1 track(s) failed:").arg(failed.size()),
+                            QMessageBox::Ok, this);
+            box.setDetailedText(failed.join('\n'));
+            box.exec();
+        } else {
+            QMessageBox::information(this, "Gig Preparation", text);
         }
     });
+    
+    // Compatible tracks follow the master deck's track and its tempo as the pitch fader moves
+    for (QtDeckWidget* deck : { deckA, deckB }) {
+        connect(deck, &QtDeckWidget::fileLoadingStarted, this, [this, deck]() {
+            lastLoadedDeck = deck;
+            updateCompatibleTracks();
+        });
+        connect(deck, &QtDeckWidget::displayedBpmChanged, this, &QtMainWindow::updateCompatibleTracks);
+        connect(deck, &QtDeckWidget::playStateChanged, this, &QtMainWindow::updateCompatibleTracks);
+        connect(deck, &QtDeckWidget::syncToggled, this, &QtMainWindow::updateCompatibleTracks);
+    }
+    
+    // The stored library loads after the audio device (loadStoredLibrary)
 
     crossfader = new QSlider(Qt::Horizontal, this);
     crossfader->setRange(0, 100);
@@ -1047,12 +1128,17 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     deckBLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
     deckALabel->setFixedHeight(16);
     deckBLabel->setFixedHeight(16);
+    deckA->getViewModel().bindOverviewLabel(deckALabel, "DECK A - OVERVIEW");
+    deckB->getViewModel().bindOverviewLabel(deckBLabel, "DECK B - OVERVIEW");
     
     overviewLayout->setSpacing(2);
     overviewLayout->addWidget(deckALabel);
     overviewLayout->addWidget(overviewTopA);
     overviewLayout->addWidget(deckBLabel);
     overviewLayout->addWidget(overviewTopB);
+    phaseCompare->setFixedHeight(60);
+    phaseCompare->setStyleSheet("border: 1px solid #333; background-color: #0a0a0a;");
+    overviewLayout->addWidget(phaseCompare);
     
     // Main deck controls side by side (more compact spacing)
     auto decksLayout = new QHBoxLayout;
@@ -1179,6 +1265,85 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     volumeLayout->addLayout(rightVolLayout);
     
     mixerSection->addLayout(volumeLayout);
+
+    // Headphone cue: PFL buttons and the cue/master knob (bus on outputs 3/4)
+    auto cueLayout = new QHBoxLayout;
+    cueLayout->setSpacing(4);
+    const QString cueButtonStyle = "QPushButton { color: #fff; font-size: 9px; font-weight: bold; background-color: #333; }"
+                                   "QPushButton:checked { background-color: #d4a000; color: #000; }";
+    leftCueButton = new QPushButton("CUE", this);
+    leftCueButton->setCheckable(true);
+    leftCueButton->setFixedSize(34, 18);
+    leftCueButton->setStyleSheet(cueButtonStyle);
+    leftCueButton->setToolTip("Deck A to headphones (pre-fader)");
+    rightCueButton = new QPushButton("CUE", this);
+    rightCueButton->setCheckable(true);
+    rightCueButton->setFixedSize(34, 18);
+    rightCueButton->setStyleSheet(cueButtonStyle);
+    rightCueButton->setToolTip("Deck B to headphones (pre-fader)");
+    cueLayout->addWidget(leftCueButton);
+    cueLayout->addWidget(rightCueButton);
+    mixerSection->addLayout(cueLayout);
+
+    auto cueMixLayout = new QHBoxLayout;
+    cueMixLayout->setSpacing(2);
+    auto cueMixLabel = new QLabel("CUE", this);
+    cueMixLabel->setStyleSheet("color: #fff; font-size: 8px;");
+    auto cueMasterLabel = new QLabel("MST", this);
+    cueMasterLabel->setStyleSheet("color: #fff; font-size: 8px;");
+    cueMixKnob = new QDial(this);
+    cueMixKnob->setRange(0, 100);
+    cueMixKnob->setValue(0);
+    cueMixKnob->setNotchesVisible(true);
+    cueMixKnob->setFixedSize(35, 35);
+    cueMixKnob->setToolTip("Headphone mix: cue <-> master");
+    cueMixLayout->addWidget(cueMixLabel);
+    cueMixLayout->addWidget(cueMixKnob);
+    cueMixLayout->addWidget(cueMasterLabel);
+    mixerSection->addLayout(cueMixLayout);
+
+    // Microphone: on/off, talkover ducking, level and a 3-band EQ (input in Mic/Input)
+    auto micLayout = new QHBoxLayout;
+    micLayout->setSpacing(2);
+    micButton = new QPushButton("MIC", this);
+    micButton->setCheckable(true);
+    micButton->setFixedSize(34, 18);
+    micButton->setStyleSheet(cueButtonStyle);
+    micButton->setToolTip("Microphone on");
+    talkoverButton = new QPushButton("TALK", this);
+    talkoverButton->setCheckable(true);
+    talkoverButton->setFixedSize(34, 18);
+    talkoverButton->setStyleSheet(cueButtonStyle);
+    talkoverButton->setToolTip("Talkover: duck the music while the mic has a voice");
+    micGainKnob = new QDial(this);
+    micGainKnob->setRange((int) MicChannel::MinGainDb, (int) MicChannel::MaxGainDb);
+    micGainKnob->setValue(0);
+    micGainKnob->setNotchesVisible(true);
+    micGainKnob->setFixedSize(30, 30);
+    micGainKnob->setToolTip("Mic level (dB)");
+    micLayout->addWidget(micButton);
+    micLayout->addWidget(talkoverButton);
+    micLayout->addWidget(micGainKnob);
+    mixerSection->addLayout(micLayout);
+
+    auto micEqLayout = new QHBoxLayout;
+    micEqLayout->setSpacing(2);
+    auto makeMicEq = [this](const char* tip) {
+        auto* dial = new QDial(this);
+        dial->setRange(-100, 100);
+        dial->setValue(0);
+        dial->setNotchesVisible(true);
+        dial->setFixedSize(26, 26);
+        dial->setToolTip(tip);
+        return dial;
+    };
+    micHigh = makeMicEq("Mic High");
+    micMid = makeMicEq("Mic Mid");
+    micLow = makeMicEq("Mic Low");
+    micEqLayout->addWidget(micHigh);
+    micEqLayout->addWidget(micMid);
+    micEqLayout->addWidget(micLow);
+    mixerSection->addLayout(micEqLayout);
     mixerSection->addStretch();
     
     auto mixerWidget = new QWidget(this);
@@ -1220,6 +1385,14 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     
     // Connect volume sliders
     connect(leftVolumeSlider, &QSlider::valueChanged, this, &QtMainWindow::onLeftVolumeChanged);
+    connect(leftCueButton, &QPushButton::toggled, this, &QtMainWindow::onLeftCueToggled);
+    connect(rightCueButton, &QPushButton::toggled, this, &QtMainWindow::onRightCueToggled);
+    connect(cueMixKnob, &QDial::valueChanged, this, &QtMainWindow::onCueMixChanged);
+    connect(micButton, &QPushButton::toggled, this, &QtMainWindow::onMicToggled);
+    connect(talkoverButton, &QPushButton::toggled, this, &QtMainWindow::onTalkoverToggled);
+    connect(micGainKnob, &QDial::valueChanged, this, &QtMainWindow::onMicGainChanged);
+    for (QDial* dial : { micHigh, micMid, micLow })
+        connect(dial, &QDial::valueChanged, this, &QtMainWindow::onMicEqChanged);
     connect(rightVolumeSlider, &QSlider::valueChanged, this, &QtMainWindow::onRightVolumeChanged);
     
     // Bottom section: Library (now with LibraryManager)
@@ -1249,12 +1422,39 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     mainLayout->addLayout(libLayout, 2);         // Library at bottom (increased from 1 to 2)
     setLayout(mainLayout);
 
-    // PREROLL SUPPORT: Timer for automatic position updates during playback
-    positionUpdateTimer = new QTimer(this);
-    positionUpdateTimer->setInterval(80); // Slower for even more stability (12.5 FPS)
-    connect(positionUpdateTimer, &QTimer::timeout, this, &QtMainWindow::updatePlaybackPositions);
-    positionUpdateTimer->start();
-    std::cout << "Position update timer started at 12.5 FPS for maximum stability" << std::endl;
+    // PREROLL SUPPORT: Automatic position updates during playback
+    // Sampled once per frame before the widgets draw: positions are extrapolated from the audio
+    // thread's snapshots to the frame time, so a tick costs a seqlock read per deck
+    connect(&FrameClock::instance(), &FrameClock::advance, this, &QtMainWindow::updatePlaybackPositions);
+    // Analysis progress the workers reported since the last frame, at most one redraw per deck
+    connect(&FrameClock::instance(), &FrameClock::frame, this, [this]() {
+        applyAnalysisProgress(true);
+        applyAnalysisProgress(false);
+        attachPendingStems(true);
+        attachPendingStems(false);
+        tickAutoDj();
+    });
+    // Ticks follow the top waveform's buffer swaps, or deck A's overview once a render thread
+    // draws the top waveform
+    if (overviewTopA->isThreadedRendering() && deckA && deckA->getWaveform())
+        FrameClock::instance().followSwapsOf(deckA->getWaveform());
+    else
+        FrameClock::instance().followSwapsOf(overviewTopA);
+    std::cout << "Position updates running on the frame clock (snapshot extrapolation)" << std::endl;
+
+    // KEYLOCK: load check twice a second, also services deferred stretcher switches and frees
+    // the tracks the decks have switched away from
+    keylockGovernorTimer = new QTimer(this);
+    keylockGovernorTimer->setInterval(500);
+    connect(keylockGovernorTimer, &QTimer::timeout, this, [this]() {
+        if (deckMixer) keylockGovernor.tick(*deckMixer);
+        if (playerA) playerA->collectRetiredTracks();
+        if (playerB) playerB->collectRetiredTracks();
+        if (libraryAnalyzer) libraryAnalyzer->setCallbackLoad(keylockGovernor.getLastLoad());
+        if (ThreadingPolicy::getInstance().takeAudioThreadReport())
+            std::cout << "ThreadingPolicy: " << ThreadingPolicy::getInstance().describe() << std::endl;
+    });
+    keylockGovernorTimer->start();
 
     // BetaPulseX: Lade alle Deck-Einstellungen aus zentraler Config
     {
@@ -1275,66 +1475,364 @@ QtMainWindow::QtMainWindow(QWidget* parent) : QWidget(parent)
     }
 }
 
-void QtMainWindow::initializeAudio()
+void QtMainWindow::showEvent(QShowEvent* event)
 {
-    // LINUX-FRIENDLY: Initialize audio like a normal Linux application
-    // Don't try to monopolize the audio device - work with PulseAudio/PipeWire
-    try {
-        std::cout << "Initializing audio as normal Linux application (shared audio)..." << std::endl;
-        
-        // Clean any previous callbacks
-        if (stereoCallback) {
-            deviceManager.removeAudioCallback(stereoCallback.get());
-        }
-        deviceManager.removeAudioCallback(&masterLevelMonitor);
-        
-        // SIMPLE APPROACH: Just use default devices without trying to configure them
-        // This lets PulseAudio/PipeWire handle the device management
-        std::cout << "Using default audio devices (letting system handle device management)..." << std::endl;
-        
-        juce::String audioError = deviceManager.initialiseWithDefaultDevices(0, 2);
-        if (audioError.isNotEmpty()) {
-            std::cout << "Default audio init error: " << audioError.toStdString() << std::endl;
-            return;
-        }
-        
-        // DON'T try to reconfigure the device - just use what the system gives us
-        auto* currentDevice = deviceManager.getCurrentAudioDevice();
-        if (currentDevice) {
-            std::cout << "Using system default audio device: " << currentDevice->getName().toStdString() << std::endl;
-            std::cout << "Sample rate: " << currentDevice->getCurrentSampleRate() << " Hz" << std::endl;
-            std::cout << "Buffer size: " << currentDevice->getCurrentBufferSizeSamples() << " samples" << std::endl;
-            std::cout << "Available output channels: " << currentDevice->getActiveOutputChannels().toInteger() << std::endl;
-            
-            // Accept whatever the system provides - don't force anything
-            int availableChannels = currentDevice->getActiveOutputChannels().toInteger();
-            if (availableChannels >= 2) {
-                std::cout << "SUCCESS: System provides stereo (" << availableChannels << " channels)" << std::endl;
-            } else {
-                std::cout << "INFO: System provides " << availableChannels << " channel(s) - will work fine" << std::endl;
-            }
-        } else {
-            std::cout << "WARNING: No audio device available" << std::endl;
-            return;
-        }
-        
-        // Prepare players with current device settings
-        if (playerA) {
-            playerA->prepareToPlay(deviceManager.getCurrentAudioDevice()->getCurrentBufferSizeSamples(),
-                                   deviceManager.getCurrentAudioDevice()->getCurrentSampleRate());
+    QWidget::showEvent(event);
+    if (startupStagesRun) return;
+    startupStagesRun = true;
+    StartupTimeline::mark("window shown");
+    // Queued, so the first frame is painted before the device opens
+    QTimer::singleShot(0, this, &QtMainWindow::runStartupStages);
+}
+
+void QtMainWindow::runStartupStages()
+{
+    applyDeckSettings();
+    initializeAudio();
+    StartupTimeline::mark("audio open");
+    StartupTimeline::interactive();
+    startSessionSnapshots();
+    startPlayHistory();
+    // Another turn of the event loop, so input that queued up during the open goes first
+    QTimer::singleShot(0, this, &QtMainWindow::loadStoredLibrary);
+}
+
+void QtMainWindow::startSessionSnapshots()
+{
+    // Still on disk: the last session didn't get to performCleanup
+    const juce::File file(AppConfig::instance().getSessionSnapshotPath().toStdString());
+    SessionSnapshot::State saved;
+    const bool crashed = SessionSnapshot::read(file, saved);
+    sessionSnapshot = std::make_unique<SessionSnapshot>(file);
+    if (crashed) {
+        lastPostedSnapshot = saved;
+        restoreSession(saved);
+    }
+
+    snapshotTimer = new QTimer(this);
+    snapshotTimer->setInterval(SnapshotIntervalMs);
+    connect(snapshotTimer, &QTimer::timeout, this, [this]() {
+        // A half-restored session would overwrite the one worth restoring
+        if (pendingRestores > 0 && QDateTime::currentMSecsSinceEpoch() < restoreDeadlineMs) return;
+        SessionSnapshot::State state = captureSession();
+        if (state == lastPostedSnapshot) return;
+        state.savedAtMs = juce::Time::currentTimeMillis();
+        if (sessionSnapshot->post(state)) lastPostedSnapshot = state;
+    });
+    snapshotTimer->start();
+}
+
+void QtMainWindow::startPlayHistory()
+{
+    playHistory = std::make_unique<PlayHistory>(juce::File(AppConfig::instance().getPlayHistoryPath().toStdString()));
+    historyTimer = new QTimer(this);
+    historyTimer->setInterval(HistoryTickMs);
+    connect(historyTimer, &QTimer::timeout, this, &QtMainWindow::tickPlayHistory);
+    historyTimer->start();
+}
+
+void QtMainWindow::tickPlayHistory()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < (int) deckPlays.size(); ++i) {
+        const bool isA = i == 0;
+        QtDeckWidget* deck = isA ? deckA : deckB;
+        DJAudioPlayer* player = isA ? playerA : playerB;
+        QSlider* fader = isA ? leftVolumeSlider : rightVolumeSlider;
+        DeckPlay& play = deckPlays[(size_t) i];
+        if (!deck || !player || play.logged || play.path.isEmpty() || deck->getCurrentFilePath() != play.path) continue;
+        // Cued in the headphones only doesn't count
+        if (!deck->isPlaying() || (fader && fader->value() == 0)) continue;
+        if (play.startedAtMs == 0) play.startedAtMs = now;
+        play.playedSec += HistoryTickMs / 1000.0;
+
+        const double length = player->getLengthInSeconds();
+        if (play.playedSec < (length > 0.0 ? std::min(PlayedThresholdSec, length * 0.5) : PlayedThresholdSec)) continue;
+        PlayHistory::Record record;
+        record.loadedAtMs = play.loadedAtMs;
+        record.startedAtMs = play.startedAtMs;
+        record.playedAtMs = now;
+        record.deck = i;
+        record.bpm = deck->getDetectedBpm();
+        record.tempoFactor = deck->getTempoFactor();
+        record.path = juce::String(play.path.toStdString());
+        if (const auto track = libraryManager ? libraryManager->findTrack(play.path) : std::nullopt) {
+            record.title = juce::String(track->title.toStdString());
+            record.artist = juce::String(track->artist.toStdString());
+            record.key = KeyDetector::parse(track->key.toStdString());
+        }
+        // A full queue is tried again on the next tick
+        play.logged = playHistory && playHistory->post(record);
+    }
+}
+
+SessionSnapshot::State QtMainWindow::captureSession() const
+{
+    SessionSnapshot::State state;
+    state.crossfader = crossfader ? crossfader->value() : 50;
+    const juce::uint64 now = DeckMixer::nowNs();
+    for (int i = 0; i < SessionSnapshot::NumDecks; ++i) {
+        const bool isA = i == 0;
+        QtDeckWidget* deck = isA ? deckA : deckB;
+        DJAudioPlayer* player = isA ? playerA : playerB;
+        SessionSnapshot::Deck& d = state.decks[(size_t) i];
+        if (!deck || !player) continue;
+        d.trackPath = juce::String(deck->getCurrentFilePath().toStdString());
+        // The player's lock-free snapshot, as heard now
+        const DJAudioPlayer::PositionSnapshot position = player->getPositionSnapshot();
+        d.positionSec = std::max(0.0, position.positionAt(now));
+        d.loopEnabled = position.loopEnabled;
+        d.loopStartSec = position.loopStartSec;
+        d.loopEndSec = position.loopEndSec;
+        d.tempoFactor = deck->getTempoFactor();
+        d.playing = deck->isPlaying();
+        d.keylock = deck->getKeylockButton() && deck->getKeylockButton()->isChecked();
+        if (deck->getPerformancePads()) d.cues = deck->getPerformancePads()->getCuePoints();
+        d.eqHigh = (isA ? leftHigh : rightHigh)->value();
+        d.eqMid = (isA ? leftMid : rightMid)->value();
+        d.eqLow = (isA ? leftLow : rightLow)->value();
+        d.filter = (isA ? leftFilter : rightFilter)->value();
+        d.volume = (isA ? leftVolumeSlider : rightVolumeSlider)->value();
+    }
+    return state;
+}
+
+void QtMainWindow::restoreSession(const SessionSnapshot::State& state)
+{
+    std::cout << "Restoring the session saved at "
+              << juce::Time(state.savedAtMs).toString(true, true, true, true) << std::endl;
+    if (crossfader) crossfader->setValue(state.crossfader);
+    restoreDeadlineMs = QDateTime::currentMSecsSinceEpoch() + 30000;
+    for (int i = 0; i < SessionSnapshot::NumDecks; ++i) restoreDeck(i, state.decks[(size_t) i]);
+}
+
+void QtMainWindow::restoreDeck(int index, const SessionSnapshot::Deck& saved)
+{
+    const bool isA = index == 0;
+    QtDeckWidget* deck = isA ? deckA : deckB;
+    DJAudioPlayer* player = isA ? playerA : playerB;
+    if (!deck || !player) return;
+
+    // The controls go through their slots, so the players follow
+    (isA ? leftHigh : rightHigh)->setValue(saved.eqHigh);
+    (isA ? leftMid : rightMid)->setValue(saved.eqMid);
+    (isA ? leftLow : rightLow)->setValue(saved.eqLow);
+    (isA ? leftFilter : rightFilter)->setValue(saved.filter);
+    (isA ? leftVolumeSlider : rightVolumeSlider)->setValue(saved.volume);
+    if (deck->getKeylockButton() && deck->getKeylockButton()->isChecked() != saved.keylock)
+        deck->getKeylockButton()->click();
+    if (deck->getPerformancePads()) deck->getPerformancePads()->setCuePoints(saved.cues);
+
+    const QString path = QString::fromStdString(saved.trackPath.toStdString());
+    if (path.isEmpty() || !QFileInfo::exists(path)) return;
+    // Position, tempo and loop once the track is in; the load takes the usual path through
+    // the hot-track, waveform and beat-grid caches
+    ++pendingRestores;
+    connect(deck, &QtDeckWidget::fileLoaded, this, [this, deck, player, saved, path]() {
+        --pendingRestores;
+        if (deck->getCurrentFilePath() != path) return;
+        deck->setTempoFactor(saved.tempoFactor);
+        player->setPositionSeconds(saved.positionSec);
+        if (saved.loopEnabled && saved.loopEndSec > saved.loopStartSec)
+            player->enableLoop(saved.loopStartSec, saved.loopEndSec - saved.loopStartSec);
+        std::cout << "Restored " << path.toStdString() << " at " << saved.positionSec << " s"
+                  << (saved.playing ? " (was playing)" : "") << std::endl;
+    }, Qt::SingleShotConnection);
+    deck->loadFile(path);
+}
+
+void QtMainWindow::loadStoredLibrary()
+{
+    // Restore the stored library (rescanning changed directories), else populate from Music
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const bool rescan = prefs.value("Library/AutoScanOnStartup", true).toBool();
+    libraryManager->loadLibraryAsync(AppConfig::instance().getLibraryIndexPath(), rescan, [this](bool loaded) {
+        StartupTimeline::mark(loaded ? "library loaded" : "no stored library");
+        if (loaded) return;
+        QDir musicDir(QDir::homePath());
+        musicDir.cd("Music");
+        if (musicDir.exists()) {
+            libraryManager->addDirectory(musicDir.absolutePath(), false); // Non-recursive for quick startup
         }
-        if (playerB) {
-            playerB->prepareToPlay(deviceManager.getCurrentAudioDevice()->getCurrentBufferSizeSamples(),
-                                   deviceManager.getCurrentAudioDevice()->getCurrentSampleRate());
+    });
+}
+
+void QtMainWindow::initializeAudio()
+{
+    // Shared through PulseAudio/PipeWire unless Audio/ExclusiveMode asks for the card itself
+    try {
+        std::cout << "Initializing audio..." << std::endl;
+        
+        // Clean any previous callbacks
+        if (deckMixer) {
+            deviceManager.removeAudioCallback(deckMixer.get());
+        }
+        // A recording is tied to the old device's sample rate
+        masterRecorder.stop();
+        multitrackRecorder.stop();
+        masterStreamer.stop();
+        
+        // The device, rate and block size from the preferences (the nearest the device offers),
+        // plus outputs 3/4 for the headphone cue bus if asked for, in one open; the system
+        // default if that device won't open
+        appliedAudioRequest = readAudioDeviceRequest();
+        const AudioDeviceConfig::Result deviceResult = AudioDeviceConfig::open(deviceManager, appliedAudioRequest);
+        if (!deviceResult.ok())
+            std::cout << "Preferred audio device unavailable (" << deviceResult.error.toStdString() << "), using the default" << std::endl;
+
+        auto* currentDevice = deviceManager.getCurrentAudioDevice();
+        if (currentDevice) {
+            std::cout << "Using audio device: " << currentDevice->getName().toStdString() << std::endl;
+            std::cout << "Sample rate: " << currentDevice->getCurrentSampleRate() << " Hz" << std::endl;
+            std::cout << "Buffer size: " << currentDevice->getCurrentBufferSizeSamples() << " samples" << std::endl;
+            std::cout << "Available output channels: " << currentDevice->getActiveOutputChannels().toInteger() << std::endl;
+            
+            // Accept whatever the system provides - don't force anything
+            int availableChannels = currentDevice->getActiveOutputChannels().toInteger();
+            if (availableChannels >= 2) {
+                std::cout << "SUCCESS: System provides stereo (" << availableChannels << " channels)" << std::endl;
+            } else {
+                std::cout << "INFO: System provides " << availableChannels << " channel(s) - will work fine" << std::endl;
+            }
+        } else {
+            std::cout << "WARNING: No audio device available" << std::endl;
+            return;
         }
         
-        // Use simple audio callback - let JUCE handle the channel mapping
-        std::cout << "Setting up audio callback for playerA" << std::endl;
-        stereoCallback = std::make_unique<StereoAudioCallback>(playerA, playerB);
-        deviceManager.addAudioCallback(stereoCallback.get());
+        // Prepare players with current device settings
+        prepareDecksForDevice(*currentDevice);
         
-        // Add master level monitor
-        deviceManager.addAudioCallback(&masterLevelMonitor);
+        // Mixer graph: one channel strip per deck, A/B on either side of the crossfader
+        std::cout << "Setting up deck mixer" << std::endl;
+        // Cores and priorities for the device and render threads, before either starts
+        {
+            QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+            ThreadingPolicy::Config threading;
+            threading.threadPriority = prefs.value("Performance/ThreadPriority", 50).toInt();
+            threading.isolateAudioCores = prefs.value("Performance/IsolateAudioCores", true).toBool();
+            ThreadingPolicy::getInstance().configure(threading);
+        }
+        deckMixer = std::make_unique<DeckMixer>();
+        mixerChannelA = deckMixer->addChannel(playerA, DeckMixer::CrossfaderSide::A);
+        mixerChannelB = deckMixer->addChannel(playerB, DeckMixer::CrossfaderSide::B);
+        if (leftVolumeSlider) onLeftVolumeChanged(leftVolumeSlider->value());
+        if (rightVolumeSlider) onRightVolumeChanged(rightVolumeSlider->value());
+        // Optional: render each deck on its own pinned high-priority worker (Performance tab)
+        {
+            QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+            deckMixer->setParallelRendering(prefs.value("Performance/ParallelDeckRendering", false).toBool());
+            // Fused zero-copy mix straight into the device buffers
+            deckMixer->setLowLatencyMode(prefs.value("Performance/LowLatencyMode", false).toBool());
+            deckMixer->setHeadphoneVolume((float) prefs.value("Audio/HeadphoneVolume", 0.7).toDouble());
+            // 0 = smooth, 1 = dipless, 2 = scratch cut
+            deckMixer->setCrossfaderCurve((DeckMixer::CrossfaderCurve) prefs.value("Audio/CrossfaderCurve", 1).toInt());
+            // Brickwall on the master so two hot decks can't clip the converter
+            deckMixer->getLimiter().setEnabled(prefs.value("Audio/MasterLimiter", true).toBool());
+            deckMixer->getLimiter().setLookaheadMs((float) prefs.value("Audio/LimiterLookaheadMs", MasterLimiter::DefaultLookaheadMs).toDouble());
+            // Synced decks follow the LAN session, or the sync master leads it
+            const auto role = NetworkTempoSync::roleFromString(prefs.value("Sync/Network", "off").toString().toStdString());
+            networkSync.reset();
+            if (role != NetworkTempoSync::Role::Off) {
+                networkSync = std::make_unique<NetworkTempoSync>();
+                if (networkSync->start(role)) deckMixer->setNetworkSync(networkSync.get());
+                else networkSync.reset();
+            }
+            midiClock.reset();
+            const QString clockDevice = prefs.value("Sync/MidiClock", QString()).toString();
+            if (!clockDevice.isEmpty()) {
+                midiClock = std::make_unique<MidiClockOutput>();
+                if (midiClock->start(juce::String(clockDevice.toStdString()), prefs.value("Sync/MidiClockLeadMs", 0.0).toDouble()))
+                    deckMixer->setMidiClock(midiClock.get());
+                else midiClock.reset();
+            }
+            lightingOutput.reset();
+            LightingOutput::Settings lighting;
+            lighting.protocol = LightingOutput::protocolFromString(prefs.value("Lighting/Protocol", "off").toString().toStdString());
+            if (lighting.protocol != LightingOutput::Protocol::Off) {
+                lighting.address = prefs.value("Lighting/Address", QString()).toString().toStdString();
+                lighting.universe = prefs.value("Lighting/Universe", lighting.protocol == LightingOutput::Protocol::Sacn ? 1 : 0).toInt();
+                lighting.startChannel = prefs.value("Lighting/StartChannel", 1).toInt();
+                lighting.leadMs = prefs.value("Lighting/LeadMs", 0.0).toDouble();
+                lightingOutput = std::make_unique<LightingOutput>();
+                if (lightingOutput->start(lighting)) deckMixer->setLightingOutput(lightingOutput.get());
+                else lightingOutput.reset();
+            }
+        }
+        if (leftCueButton) onLeftCueToggled(leftCueButton->isChecked());
+        if (rightCueButton) onRightCueToggled(rightCueButton->isChecked());
+        if (cueMixKnob) onCueMixChanged(cueMixKnob->value());
+        // Beat sync state may have been toggled before the mixer existed
+        deckMixer->setChannelSync(mixerChannelA, syncAEnabled);
+        deckMixer->setChannelSync(mixerChannelB, syncBEnabled);
+        deckMixer->setSyncMaster(syncAEnabled ? mixerChannelB : mixerChannelA);
+        // Master meter runs inside the mixer's final pass (a second device callback would only
+        // see JUCE's scratch buffer, not the mix)
+        deckMixer->setLevelMonitor(&masterLevelMonitor);
+        deckMixer->setMasterScope(&masterScope);
+        deckMixer->setMasterRecorder(&masterRecorder);
+        deckMixer->setMultitrackRecorder(&multitrackRecorder);
+        deckMixer->setMasterStreamer(&masterStreamer);
+        deckMixer->setSamplerBank(&samplerBank);
+        deckMixer->setPreviewPlayer(&previewPlayer);
+        deckMixer->setCueOutputDevice(&cueOutputDevice);
+        openCueDevice(*currentDevice);
+        applyMicSettings();
+        startTimecodeControl(*currentDevice);
+        keylockGovernor.clearDecks();
+        keylockGovernor.addDeck(playerA, mixerChannelA);
+        keylockGovernor.addDeck(playerB, mixerChannelB);
+        applyLatencyCalibration();
+        deviceManager.addAudioCallback(deckMixer.get());
+
+        // Controllers act on the decks and the mixer directly, the UI only mirrors them
+        controllerInput = std::make_unique<ControllerInput>();
+        controllerInput->setDeck(0, playerA, mixerChannelA);
+        controllerInput->setDeck(1, playerB, mixerChannelB);
+        controllerInput->setMixer(deckMixer.get());
+        controllerInput->setUiWakeup([this]() {
+            QMetaObject::invokeMethod(this, [this]() { drainControllerEvents(); }, Qt::QueuedConnection);
+        });
+        const juce::File mapping((AppConfig::instance().getConfigDirectory() + "/controllers.json").toStdString());
+        if (mapping.existsAsFile()) controllerInput->loadMapping(mapping);
+        controllerInput->start();
+        {
+            QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+            oscRemote.reset();
+            if (prefs.value("Remote/Osc", false).toBool()) {
+                OscRemote::Settings remote;
+                remote.port = prefs.value("Remote/OscPort", OscRemote::DefaultPort).toInt();
+                remote.telemetryHost = prefs.value("Remote/TelemetryHost", "127.0.0.1").toString().toStdString();
+                remote.telemetryPort = prefs.value("Remote/TelemetryPort", OscRemote::DefaultTelemetryPort).toInt();
+                remote.telemetryHz = prefs.value("Remote/TelemetryHz", OscRemote::DefaultTelemetryHz).toDouble();
+                oscRemote = std::make_unique<OscRemote>();
+                oscRemote->setDeck(0, playerA);
+                oscRemote->setDeck(1, playerB);
+                oscRemote->setControllerInput(controllerInput.get());
+                oscRemote->setLevelMonitor(&masterLevelMonitor);
+                if (!oscRemote->start(remote)) oscRemote.reset();
+            }
+            webRemote.reset();
+            if (prefs.value("Remote/Web", false).toBool()) {
+                WebRemote::Settings web;
+                web.port = prefs.value("Remote/WebPort", WebRemote::DefaultPort).toInt();
+                web.fps = prefs.value("Remote/WebFps", WebRemote::DefaultFps).toDouble();
+                webRemote = std::make_unique<WebRemote>();
+                webRemote->setDeck(0, playerA);
+                webRemote->setDeck(1, playerB);
+                webRemote->setControllerInput(controllerInput.get());
+                webRemote->setWaveformCacheDirectory(juce::File(AppConfig::instance().getWaveformCacheDirectory().toStdString()));
+                if (deckA) webRemote->setTrack(0, juce::File(deckA->getCurrentFilePath().toStdString()));
+                if (deckB) webRemote->setTrack(1, juce::File(deckB->getCurrentFilePath().toStdString()));
+                if (!webRemote->start(web)) webRemote.reset();
+            }
+        }
+
+        if (!deviceWatchTimer) {
+            deviceWatchTimer = new QTimer(this);
+            deviceWatchTimer->setInterval(250);
+            connect(deviceWatchTimer, &QTimer::timeout, this, &QtMainWindow::checkAudioDevice);
+        }
+        deviceWatchTimer->start();
         
         std::cout << "Audio initialization complete - app ready to play audio like normal Linux application" << std::endl;
         std::cout << "IMPORTANT: Load an audio file before pressing Play!" << std::endl;
@@ -1369,206 +1867,1120 @@ void QtMainWindow::initializeAudio()
     }
 }
 
-QtMainWindow::~QtMainWindow()
-{
-    std::cout << "QtMainWindow destructor called" << std::endl;
-    // Only clean up if closeEvent hasn't already done it
-    if (!cleanupCompleted) {
-        performCleanup();
+QtMainWindow::~QtMainWindow()
+{
+    std::cout << "QtMainWindow destructor called" << std::endl;
+    // Only clean up if closeEvent hasn't already done it
+    if (!cleanupCompleted) {
+        performCleanup();
+    }
+}
+
+void QtMainWindow::performCleanup()
+{
+    if (cleanupCompleted) return; // Prevent double cleanup
+    autoDjStage = AutoDjStage::Off;
+    
+    std::cout << "Performing cleanup..." << std::endl;
+    try {
+        if (keylockGovernorTimer) keylockGovernorTimer->stop();
+        if (deviceWatchTimer) deviceWatchTimer->stop();
+        // A clean exit leaves no snapshot behind, so the next start has nothing to restore
+        if (snapshotTimer) snapshotTimer->stop();
+        if (sessionSnapshot) {
+            sessionSnapshot->discard();
+            sessionSnapshot.reset();
+        }
+        if (historyTimer) historyTimer->stop();
+        playHistory.reset();   // writes what is still queued
+        if (mixRenderTimer) mixRenderTimer->stop();
+        mixRenderer.reset();   // cancels a running export
+        oscRemote.reset();   // posts into the controller
+        webRemote.reset();
+        // The waveform render threads read the players
+        if (overviewTopA) overviewTopA->setThreadedRendering(nullptr);
+        if (overviewTopB) overviewTopB->setThreadedRendering(nullptr);
+        controllerInput.reset();   // no controller commands once the players start going away
+        masterRecorder.stop();   // finishes the file before the mixer goes away
+        multitrackRecorder.stop();
+        masterStreamer.stop();
+        delete masterScopeView;   // its destructor disables masterScope, which dies before the children
+        // 1. Stop all audio players
+        if (playerA) {
+            playerA->stop();
+            std::cout << "Player A stopped" << std::endl;
+        }
+        if (playerB) {
+            playerB->stop();
+            std::cout << "Player B stopped" << std::endl;
+        }
+        
+        // 2. Remove audio callbacks before closing device
+        // deviceManager.removeAudioCallback(&mixer); // Removed - no longer using mixer
+        if (deckMixer) {
+            deviceManager.removeAudioCallback(deckMixer.get());
+            deckMixer->setNetworkSync(nullptr);
+            deckMixer->setMidiClock(nullptr);
+            deckMixer->setLightingOutput(nullptr);
+            deckMixer->setChannelTimecode(mixerChannelA, nullptr, 0);
+            deckMixer->setChannelTimecode(mixerChannelB, nullptr, 0);
+        }
+        networkSync.reset();
+        midiClock.reset();
+        lightingOutput.reset();
+        timecodeDecoderA.reset();
+        timecodeDecoderB.reset();
+        if (latencyCalibrationTimer) latencyCalibrationTimer->stop();
+        if (latencyCalibrator) {
+            deviceManager.removeAudioCallback(latencyCalibrator.get());
+            latencyCalibrator.reset();
+        }
+        std::cout << "Audio callbacks removed" << std::endl;
+        
+        // 4. No sources to disconnect (using custom callback now)
+        std::cout << "No sources to disconnect (using deck mixer callback)" << std::endl;
+        
+        // 5. Close audio device
+        deviceManager.closeAudioDevice();
+        cueOutputDevice.close();
+        std::cout << "Audio device closed" << std::endl;
+        
+        // 6. Wait for any pending BPM analysis (the library service stops after its current block)
+        delete libraryAnalyzer;
+        libraryAnalyzer = nullptr;
+        delete trackPrefetcher;
+        trackPrefetcher = nullptr;
+        delete gigPrep;
+        gigPrep = nullptr;
+        // Queued deck jobs are dropped, running ones finish before the analyzer and players go
+        deckCancelA.cancel();
+        deckCancelB.cancel();
+        if (jobSystem) {
+            jobSystem.reset();
+            std::cout << "Deck jobs finished" << std::endl;
+        }
+        
+        // 7. Delete players safely
+        delete playerA;
+        playerA = nullptr;
+        std::cout << "Player A deleted" << std::endl;
+        
+        delete playerB;
+        playerB = nullptr;
+        std::cout << "Player B deleted" << std::endl;
+        
+        // Players and preview are gone, nothing reads ahead any more
+        previewPlayer.release();
+        if (readAheadThread) {
+            readAheadThread->stopThread(2000);
+            readAheadThread.reset();
+        }
+        
+        delete bpmAnalyzer;
+        bpmAnalyzer = nullptr;
+        std::cout << "BPM analyzer deleted" << std::endl;
+        
+        cleanupCompleted = true;
+        std::cout << "Cleanup complete" << std::endl;
+        
+    } catch (const std::exception& e) {
+        std::cout << "Exception during cleanup: " << e.what() << std::endl;
+        cleanupCompleted = true; // Mark as completed even if there was an error
+    } catch (...) {
+        std::cout << "Unknown exception during cleanup" << std::endl;
+        cleanupCompleted = true;
+    }
+}
+
+void QtMainWindow::closeEvent(QCloseEvent* event)
+{
+    std::cout << "QtMainWindow::closeEvent called - shutting down..." << std::endl;
+    // BetaPulseX: Speichere alle Deck-Einstellungen
+    try {
+        // Aktualisiere Visual Trim in den Deck-Settings
+        DeckSettings::instance().setVisualTrim(0, userVisualTrimA);  // Deck A
+        DeckSettings::instance().setVisualTrim(1, userVisualTrimB);  // Deck B
+        
+        // Speichere alle Deck-Settings zentral (what the flush thread hadn't written yet)
+        DeckSettings::instance().shutdown();
+        
+        qDebug() << "BetaPulseX: All deck settings saved successfully";
+    } catch (...) {
+        // Continue even if settings fail
+        qWarning() << "Failed to save deck settings";
+    }
+    
+    // Disable deck controls immediately
+    if (deckA) deckA->getControlsWidget()->setEnabled(false);
+    if (deckB) deckB->getControlsWidget()->setEnabled(false);
+    
+    // Perform cleanup
+    performCleanup();
+    
+    std::cout << "Accepting close event and quitting application" << std::endl;
+    event->accept();
+    QApplication::quit();
+}
+
+void QtMainWindow::onCrossfader(int v) {
+    std::cout << "Crossfader changed to: " << v << std::endl;
+    // v: 0 => full A (left), 50 => center, 100 => full B (right)
+    // Convert to -1.0f (full A) to +1.0f (full B)
+    float crossPos = (float(v) - 50.0f) / 50.0f;  // -1.0 to +1.0
+    // A hand on the crossfader takes the mix back from AutoDJ
+    if (isAutoDjEnabled()) setAutoDj(false);
+    if (deckMixer) {
+        deckMixer->setCrossfader(crossPos);
+    }
+    mixAutomation.record(-1, MixAutomation::Kind::Crossfader, crossPos);
+}
+
+// EQ/filter slot implementations
+void QtMainWindow::onLeftHighChanged(int v) {
+    std::cout << "onLeftHighChanged called with value: " << v << std::endl;
+    // map -100..100 to -1.0..1.0
+    double val = v / 100.0;
+    if (playerA) {
+        std::cout << "  Calling playerA->setHighGain(" << val << ")" << std::endl;
+        playerA->setHighGain(val);
+    } else {
+        std::cout << "  ERROR: playerA is null!" << std::endl;
+    }
+}
+
+void QtMainWindow::onLeftMidChanged(int v) {
+    std::cout << "onLeftMidChanged called with value: " << v << std::endl;
+    double val = v / 100.0;
+    if (playerA) {
+        std::cout << "  Calling playerA->setMidGain(" << val << ")" << std::endl;
+        playerA->setMidGain(val);
+    } else {
+        std::cout << "  ERROR: playerA is null!" << std::endl;
+    }
+}
+
+void QtMainWindow::onLeftLowChanged(int v) {
+    std::cout << "onLeftLowChanged called with value: " << v << std::endl;
+    double val = v / 100.0;
+    if (playerA) playerA->setLowGain(val);
+}
+
+void QtMainWindow::onLeftFilterChanged(int v) {
+    std::cout << "onLeftFilterChanged called with value: " << v << std::endl;
+    // map -100..100 to -1..1 (center 0 = bypass)
+    double norm = v / 100.0;
+    if (playerA) {
+        std::cout << "  Calling playerA->setFilterCutoff(" << norm << ")" << std::endl;
+        playerA->setFilterCutoff(norm);
+    } else {
+        std::cout << "  ERROR: playerA is null!" << std::endl;
+    }
+}
+
+void QtMainWindow::onRightHighChanged(int v) {
+    std::cout << "onRightHighChanged called with value: " << v << std::endl;
+    double val = v / 100.0;
+    if (playerB) playerB->setHighGain(val);
+}
+
+void QtMainWindow::onRightMidChanged(int v) {
+    std::cout << "onRightMidChanged called with value: " << v << std::endl;
+    double val = v / 100.0;
+    if (playerB) playerB->setMidGain(val);
+}
+
+void QtMainWindow::onRightLowChanged(int v) {
+    std::cout << "onRightLowChanged called with value: " << v << std::endl;
+    double val = v / 100.0;
+    if (playerB) playerB->setLowGain(val);
+}
+
+void QtMainWindow::onRightFilterChanged(int v) {
+    // map -100..100 to -1..1 (center 0 = bypass)
+    double norm = v / 100.0;
+    if (playerB) playerB->setFilterCutoff(norm);
+}
+
+void QtMainWindow::onLeftVolumeChanged(int v) {
+    std::cout << "Left volume changed to: " << v << std::endl;
+    if (deckMixer) {
+        float volume = juce::jlimit(0.0f, 1.0f, (float)v / 100.0f);
+        deckMixer->setChannelGain(mixerChannelA, volume);
+        mixAutomation.record(0, MixAutomation::Kind::ChannelGain, volume);
+    }
+}
+
+void QtMainWindow::onRightVolumeChanged(int v) {
+    std::cout << "Right volume changed to: " << v << std::endl;
+    if (deckMixer) {
+        float volume = juce::jlimit(0.0f, 1.0f, (float)v / 100.0f);
+        deckMixer->setChannelGain(mixerChannelB, volume);
+        mixAutomation.record(1, MixAutomation::Kind::ChannelGain, volume);
+    }
+}
+
+void QtMainWindow::drainControllerEvents() {
+    if (!controllerInput) return;
+    using Action = ControllerInput::Action;
+    ControllerInput::UiEvent e;
+    while (controllerInput->popUiEvent(e)) {
+        const bool isDeckA = e.deck == 0;
+        QtDeckWidget* deck = isDeckA ? deckA : deckB;
+        DJAudioPlayer* player = isDeckA ? playerA : playerB;
+        const int dialValue = (int) std::lround(e.value * 100.0f);
+        // The setters re-post what the controller already applied: harmless, and the UI copies,
+        // the automation log and the labels stay right
+        switch (e.action) {
+            case Action::Tempo: if (deck) deck->setTempoFactor(e.value); break;
+            case Action::EqHigh: (isDeckA ? leftHigh : rightHigh)->setValue(dialValue); break;
+            case Action::EqMid: (isDeckA ? leftMid : rightMid)->setValue(dialValue); break;
+            case Action::EqLow: (isDeckA ? leftLow : rightLow)->setValue(dialValue); break;
+            case Action::Filter: (isDeckA ? leftFilter : rightFilter)->setValue(dialValue); break;
+            case Action::Volume: (isDeckA ? leftVolumeSlider : rightVolumeSlider)->setValue(dialValue); break;
+            case Action::Crossfader: if (crossfader) crossfader->setValue((int) std::lround((e.value + 1.0f) * 50.0f)); break;
+            case Action::JogTouch:
+                if (!player) break;
+                // Like a touch on the waveform: the transport runs while the record is held
+                if (e.value > 0.0f) {
+                    (isDeckA ? scratchWasPlayingA : scratchWasPlayingB) = player->isPlaying();
+                    if (!player->isPlaying()) player->start();
+                } else {
+                    (isDeckA ? lastScratchEndA : lastScratchEndB) = QDateTime::currentMSecsSinceEpoch();
+                }
+                break;
+            default:
+                if (deck) deck->handleControllerButton(e.action, e.value > 0.0f, (int) e.param - 1);
+                break;
+        }
+    }
+}
+
+void QtMainWindow::noteTrackLoaded(bool isDeckA, const QString& filePath) {
+    (isDeckA ? loadedTrackPathA : loadedTrackPathB) = filePath;
+    deckPlays[isDeckA ? 0 : 1] = { filePath, QDateTime::currentMSecsSinceEpoch() };
+    mixAutomation.record(isDeckA ? 0 : 1, MixAutomation::Kind::LoadTrack, 0.0, 0.0, 0,
+                         juce::String(filePath.toStdString()));
+}
+
+void QtMainWindow::applyTrackMemory(bool isDeckA, const QString& filePath, const BpmCache::Memory& memory) {
+    QtDeckWidget* deck = isDeckA ? deckA : deckB;
+    PerformancePads* pads = deck ? deck->getPerformancePads() : nullptr;
+    if (!pads || deck->getCurrentFilePath() != filePath) return;
+    (isDeckA ? memoryPathA : memoryPathB) = filePath;
+    (isDeckA ? trackMemoryA : trackMemoryB) = memory;
+    // The pads' change signals come back to storeTrackMemory(); nothing new to write yet
+    applyingTrackMemory = true;
+    pads->setCuePoints(memory.cues);
+    pads->setGhostLoop(memory.loopStartSec, memory.loopEndSec);
+    applyingTrackMemory = false;
+}
+
+namespace {
+    // Holds a background pass between blocks while a deck load or its analysis is pending
+    class DeckWorkBackoff : public TrackDecodePipeline::Sink {
+    public:
+        DeckWorkBackoff(const JobSystem& jobs, JobSystem::CancelToken token) : jobs(jobs), token(std::move(token)) {}
+        void consume(const juce::AudioBuffer<float>&, int, juce::int64) override {
+            while (jobs.hasDeckWork() && !token.isCancelled()) QThread::msleep(50);
+        }
+
+    private:
+        const JobSystem& jobs;
+        JobSystem::CancelToken token;
+    };
+}
+
+void QtMainWindow::separateStems(bool isDeckA, const QString& filePath, const JobSystem::CancelToken& token) {
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    if (!prefs.value("Stems/Enabled", true).toBool() || token.isCancelled()) return;
+    const juce::File file(filePath.toStdString());
+    const StemCache stemCache(juce::File(AppConfig::instance().getWaveformCacheDirectory().toStdString()));
+    // Loaded from the cache already (or no cache to keep them in)
+    if (!stemCache.isEnabled() || stemCache.contains(file)) return;
+    std::unique_ptr<juce::AudioFormatReader> reader(sharedFormatManager->createReaderFor(file));
+    if (!reader) return;
+
+    EVENT_TRACE_SCOPE("Stems: separate", "load");
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+    StemSeparator separator;
+    DeckWorkBackoff backoff(*jobSystem, token);
+    TrackDecodePipeline pipeline(*reader);
+    pipeline.setStopCondition([&token] { return token.isCancelled(); });
+    pipeline.addSink(&backoff);
+    pipeline.addSink(&separator);
+    pipeline.run();
+    StemTrackReader::StemsPtr stems = separator.takeStems();
+    if (!stems) return;
+    std::cout << "QtMainWindow: stems of " << file.getFileName().toStdString() << " in "
+              << (int) (juce::Time::getMillisecondCounterHiRes() - startMs) << " ms" << std::endl;
+    stemCache.store(file, *stems);
+
+    QMetaObject::invokeMethod(this, [this, isDeckA, filePath, stems, token]() {
+        if (token.isCancelled()) return;
+        (isDeckA ? pendingStemsA : pendingStemsB) = { filePath, stems };
+        attachPendingStems(isDeckA);
+    }, Qt::QueuedConnection);
+}
+
+void QtMainWindow::attachPendingStems(bool isDeckA) {
+    PendingStems& pending = isDeckA ? pendingStemsA : pendingStemsB;
+    if (!pending.stems) return;
+    QtDeckWidget* deck = isDeckA ? deckA : deckB;
+    DJAudioPlayer* player = isDeckA ? playerA : playerB;
+    if (!deck || !player || deck->getCurrentFilePath() != pending.path || player->hasStems()) {
+        pending = {};
+        return;
+    }
+    if (player->isPlaying() && !player->isSoftPaused()) return;   // once it is paused
+    if (player->isArmed()) return;   // AutoDJ's cue: a new source would drop it
+
+    const double sampleRate = pending.stems->sampleRate;
+    auto loaded = player->prepareTrack(std::make_unique<juce::AudioFormatReaderSource>(new StemTrackReader(pending.stems), true), sampleRate);
+    if (player->replaceTrackInPlace(std::move(loaded)))
+        std::cout << "QtMainWindow: deck " << (isDeckA ? "A" : "B") << " plays from its stems" << std::endl;
+    pending = {};
+}
+
+void QtMainWindow::storeTrackMemory(bool isDeckA) {
+    QtDeckWidget* deck = isDeckA ? deckA : deckB;
+    const QString& path = isDeckA ? memoryPathA : memoryPathB;
+    if (applyingTrackMemory || !jobSystem || !deck || path.isEmpty() || deck->getCurrentFilePath() != path) return;
+    const BpmCache::Memory memory = isDeckA ? trackMemoryA : trackMemoryB;
+    const juce::File file(path.toStdString());
+    jobSystem->submit(JobSystem::Priority::Background, {}, [file, memory](const JobSystem::CancelToken&) {
+        BpmCache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString())).storeMemory(file, memory);
+    });
+}
+
+void QtMainWindow::instantDouble(bool toDeckA) {
+    QtDeckWidget* source = toDeckA ? deckB : deckA;
+    QtDeckWidget* target = toDeckA ? deckA : deckB;
+    if (!source || !target) return;
+    const QString path = source->getCurrentFilePath();
+    if (path.isEmpty()) return;
+
+    std::cout << "QtMainWindow: instant double onto deck " << (toDeckA ? "A" : "B") << std::endl;
+    target->setTempoFactor(source->getTempoFactor());
+    (toDeckA ? instantDoublePathA : instantDoublePathB) = path;
+    target->loadFile(path);
+}
+
+void QtMainWindow::startDeckLoad(bool isDeckA, const QString& filePath) {
+    if (!jobSystem) return;
+    EVENT_TRACE_INSTANT(isDeckA ? "Deck A: load track" : "Deck B: load track", "load");
+    // Claim the waveform before the deck overview asks for it, so it waits for this pass
+    const bool ownsWaveform = WaveformGenerator::claimAnalysis(juce::File(filePath.toStdString()));
+    // Whatever is still queued or running for the deck's previous track is of no use any more
+    const JobSystem::CancelToken token = (isDeckA ? deckCancelA : deckCancelB).renew();
+    if (!bpmAnalyzer) bpmAnalyzer = new BpmAnalyzer();
+
+    // decode -> beat analysis -> BpmCache write
+    auto analysis = std::make_shared<BpmAnalysisTask>(this, bpmAnalyzer,
+        isDeckA ? &analysisReportA : &analysisReportB, juce::File(filePath.toStdString()), isDeckA);
+    auto load = std::make_shared<AudioFileLoadTask>(this, filePath, isDeckA, ownsWaveform, analysis);
+    const JobSystem::JobId loadJob = jobSystem->submit(JobSystem::Priority::DeckLoad, token,
+        [load](const JobSystem::CancelToken& t) { load->run(t); });
+    const JobSystem::JobId analysisJob = jobSystem->submit(JobSystem::Priority::DeckAnalysis, token,
+        [analysis](const JobSystem::CancelToken& t) { analysis->run(t); }, { loadJob });
+    jobSystem->submit(JobSystem::Priority::Background, {},
+        [analysis](const JobSystem::CancelToken&) { analysis->storeResult(); }, { analysisJob });
+    // Stems last: the longest job by far, and the deck plays without them meanwhile
+    jobSystem->submit(JobSystem::Priority::Background, token,
+        [this, isDeckA, filePath](const JobSystem::CancelToken& t) { separateStems(isDeckA, filePath, t); }, { analysisJob });
+
+    if (libraryAnalyzer) libraryAnalyzer->promote(filePath);
+}
+
+void QtMainWindow::finishInstantDouble(bool isDeckA, const QString& filePath) {
+    QString& pending = isDeckA ? instantDoublePathA : instantDoublePathB;
+    if (pending.isEmpty()) return;
+    const bool matches = pending == filePath;
+    pending.clear();
+    DJAudioPlayer* player = isDeckA ? playerA : playerB;
+    DJAudioPlayer* other = isDeckA ? playerB : playerA;
+    if (!matches || !player || !other) return;
+
+    // The other deck kept playing during the load; pick it up where it is now.
+    // The deck's play button follows the transport on its next syncPlayState()
+    player->setPositionSeconds(other->getCurrentPositionSeconds());
+    if (other->isPlaying()) player->start();
+}
+
+void QtMainWindow::setMixRecording(bool enabled) {
+    if (enabled == mixAutomation.isRecording()) return;
+    if (!enabled) {
+        mixAutomation.stopRecording();
+        // Keep the log next to the settings so a set can be rendered again after a restart,
+        // or replayed block by block on another machine (DavidBench --replay)
+        mixAutomation.saveToFile(juce::File((AppConfig::instance().getConfigDirectory() + "/last_mix_automation.json").toStdString()));
+        return;
+    }
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    mixAutomation.startRecording(device ? device->getCurrentSampleRate() : 0.0,
+                                 device ? device->getCurrentBufferSizeSamples() : 0);
+    // Start from what is on the decks and mixer right now
+    const QString* paths[2] = { &loadedTrackPathA, &loadedTrackPathB };
+    DJAudioPlayer* players[2] = { playerA, playerB };
+    for (int deck = 0; deck < 2; ++deck) {
+        if (!players[deck] || paths[deck]->isEmpty()) continue;
+        mixAutomation.record(deck, MixAutomation::Kind::LoadTrack, 0.0, 0.0, 0, juce::String(paths[deck]->toStdString()));
+        players[deck]->captureAutomationState();
+    }
+    if (leftVolumeSlider) mixAutomation.record(0, MixAutomation::Kind::ChannelGain, leftVolumeSlider->value() / 100.0);
+    if (rightVolumeSlider) mixAutomation.record(1, MixAutomation::Kind::ChannelGain, rightVolumeSlider->value() / 100.0);
+    if (crossfader) mixAutomation.record(-1, MixAutomation::Kind::Crossfader, (crossfader->value() - 50.0) / 50.0);
+}
+
+void QtMainWindow::renderRecordedMix() {
+    if (mixAutomation.isRecording()) setMixRecording(false);
+    if (mixRenderer && !mixRenderer->hasFinished()) {
+        QMessageBox::information(this, "Render Mix", "A mix is already being rendered.");
+        return;
+    }
+    if (mixAutomation.isEmpty()) {
+        mixAutomation.loadFromFile(juce::File((AppConfig::instance().getConfigDirectory() + "/last_mix_automation.json").toStdString()));
+        if (mixAutomation.isEmpty()) {
+            QMessageBox::information(this, "Render Mix", "Record a mix first (File > Record Mix).");
+            return;
+        }
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, "Render Mix",
+        QStandardPaths::writableLocation(QStandardPaths::MusicLocation) + "/mix.flac",
+        "FLAC (*.flac);;WAV (*.wav)");
+    if (path.isEmpty()) return;
+
+    OfflineMixRenderer::Settings settings;
+    settings.outputFile = juce::File(path.toStdString());
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        settings.sampleRate = device->getCurrentSampleRate();
+    mixRenderer = std::make_unique<OfflineMixRenderer>(mixAutomation.getEvents(), settings);
+    mixRenderer->startThread(juce::Thread::Priority::normal);
+
+    auto* progressDialog = new QProgressDialog("Rendering mix...", "Cancel", 0, 1000, this);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->show();
+
+    if (!mixRenderTimer) mixRenderTimer = new QTimer(this);
+    mixRenderTimer->disconnect();
+    mixRenderTimer->setInterval(100);
+    connect(mixRenderTimer, &QTimer::timeout, this, [this, progressDialog, path]() {
+        if (!mixRenderer) { mixRenderTimer->stop(); return; }
+        if (progressDialog->wasCanceled()) mixRenderer->signalThreadShouldExit();
+        progressDialog->setValue((int) (mixRenderer->getProgress() * 1000.0));
+        if (!mixRenderer->hasFinished()) return;
+
+        mixRenderTimer->stop();
+        const juce::String error = mixRenderer->getError();
+        const double seconds = mixRenderer->getRenderSeconds();
+        mixRenderer.reset();
+        progressDialog->close();
+        if (error.isEmpty())
+            QMessageBox::information(this, "Render Mix", QString("Mix written to %1 in %2 s.").arg(path).arg(seconds, 0, 'f', 1));
+        else if (error != "cancelled")
+            QMessageBox::warning(this, "Render Mix", QString("Render failed: %1").arg(QString::fromStdString(error.toStdString())));
+    });
+    mixRenderTimer->start();
+}
+
+double QtMainWindow::getVisualDelaySeconds(const DJAudioPlayer* player, double trimSec) const {
+    double outputLatencySec = 0.0;
+    double masterLatencySec = 0.0;
+    if (auto* dev = deviceManager.getCurrentAudioDevice()) {
+        const double sr = dev->getCurrentSampleRate();
+        if (sr > 0.0) {
+            // The mixer's latency (calibrated if measured for this format), else approximate
+            // with 1.5x buffer size for drivers that report none
+            const int buf = dev->getCurrentBufferSizeSamples();
+            const int outLat = deckMixer ? deckMixer->getOutputLatencySamples() : dev->getOutputLatencyInSamples();
+            outputLatencySec = outLat > 0 ? outLat / sr : (buf > 0 ? (1.5 * buf) / sr : 0.0);
+            // The master limiter's lookahead
+            if (deckMixer) masterLatencySec = deckMixer->getMasterLatencySamples() / sr;
+        }
+    }
+    const double pipelineLatencySec = (player ? player->getPipelineLatencySeconds() : 0.0) + masterLatencySec;
+    // The frame drawn now is seen a display latency later, which eats into the audio delay
+    const double displayLatencySec = FrameClock::instance().getDisplayLatencyNs() * 1.0e-9;
+    return std::clamp(pipelineLatencySec + outputLatencySec - displayLatencySec, 0.0, 0.25)
+           + std::clamp(trimSec, -0.05, 0.05);
+}
+
+void QtMainWindow::applyLatencyCalibration() {
+    if (!deckMixer) return;
+    auto* device = deviceManager.getCurrentAudioDevice();
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const bool sameDevice = device && prefs.value("Latency/Device").toString() == QString::fromStdString(device->getName().toStdString());
+    // The mixer only uses it while the device runs at the measured rate and buffer size
+    deckMixer->setMeasuredOutputLatency(sameDevice ? prefs.value("Latency/OutputSamples", -1).toInt() : -1,
+                                        prefs.value("Latency/SampleRate", 0.0).toDouble(),
+                                        prefs.value("Latency/BlockSize", 0).toInt());
+}
+
+void QtMainWindow::startTimecodeControl(juce::AudioIODevice& device)
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const auto* format = TimecodeDecoder::findFormat(prefs.value("DVS/Format", "off").toString().toStdString());
+    if (format == nullptr) return;
+    const bool deckAOn = prefs.value("DVS/DeckA", true).toBool();
+    const bool deckBOn = prefs.value("DVS/DeckB", true).toBool();
+    if (!deckAOn && !deckBOn) return;
+
+    // One code table for both turntables
+    const auto table = TimecodeDecoder::buildTable(*format);
+    auto attach = [&](std::unique_ptr<TimecodeDecoder>& decoder, DJAudioPlayer* player, QtDeckWidget* deck,
+                      int channel, int firstInput) {
+        if (!player || channel < 0) return;
+        decoder = std::make_unique<TimecodeDecoder>(table);
+        decoder->prepare(device.getCurrentSampleRate(), device.getCurrentBufferSizeSamples());
+        deckMixer->setChannelTimecode(channel, decoder.get(), firstInput);
+        // The record is the transport: the deck scratches along with it, playing or not
+        auto engage = [player]() {
+            player->enableScratch(true);
+            if (!player->isPlaying()) player->start();
+        };
+        engage();
+        if (deck) connect(deck, &QtDeckWidget::fileLoaded, this, engage);
+    };
+    if (deckAOn) attach(timecodeDecoderA, playerA, deckA, mixerChannelA, 0);
+    if (deckBOn) attach(timecodeDecoderB, playerB, deckB, mixerChannelB, 2);
+    std::cout << "Timecode vinyl: " << format->description << " on" << (timecodeDecoderA ? " deck A (inputs 1/2)" : "")
+              << (timecodeDecoderB ? " deck B (inputs 3/4)" : "") << ", device has "
+              << device.getActiveInputChannels().countNumberOfSetBits() << " inputs open" << std::endl;
+}
+
+void QtMainWindow::applyMicSettings()
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    // Direct monitoring skips master volume and the limiter's lookahead
+    micChannel.setDirectMonitor(prefs.value("Mic/DirectMonitor", false).toBool());
+    micChannel.setDuckDb((float) prefs.value("Mic/TalkoverDuckDb", MicChannel::DefaultDuckDb).toDouble());
+    if (deckMixer) deckMixer->setMicChannel(&micChannel, prefs.value("Mic/Input", 0).toInt() - 1);
+}
+
+AudioDeviceConfig::Request QtMainWindow::readAudioDeviceRequest() const
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    AudioDeviceConfig::Request request;
+    request.deviceName = prefs.value("Audio/Device", "").toString().toStdString();
+    request.bufferSize = prefs.value("Audio/BufferSize", 512).toInt();
+    request.sampleRate = prefs.value("Audio/SampleRate", 44100).toDouble();
+    request.exclusive = prefs.value("Audio/ExclusiveMode", false).toBool();
+    request.headphoneCueOutputs = prefs.value("Audio/HeadphoneCueOutput", false).toBool();
+    // Timecode vinyl reads deck A's turntable from inputs 1/2, deck B's from 3/4
+    if (TimecodeDecoder::findFormat(prefs.value("DVS/Format", "off").toString().toStdString()) != nullptr) {
+        if (prefs.value("DVS/DeckB", true).toBool()) request.numInputs = 4;
+        else if (prefs.value("DVS/DeckA", true).toBool()) request.numInputs = 2;
+    }
+    // The mic's input (Mic/Input, 1-based; 0 = no mic) may share them or lie beyond
+    request.numInputs = std::max(request.numInputs, prefs.value("Mic/Input", 0).toInt());
+    return request;
+}
+
+void QtMainWindow::applyAudioDeviceSettings()
+{
+    const AudioDeviceConfig::Request request = readAudioDeviceRequest();
+    applyMicSettings();
+    if (deckMixer) {
+        QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+        deckMixer->setCrossfaderCurve((DeckMixer::CrossfaderCurve) prefs.value("Audio/CrossfaderCurve", 1).toInt());
+    }
+    // The calibration has the device to itself until it restores the setup
+    if (!deckMixer || latencyCalibrator) return;
+    if (request == appliedAudioRequest) {
+        // Only the cue device changed: the master keeps running
+        QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+        if (prefs.value("Audio/CueDevice", "").toString() != appliedCueDevice)
+            if (auto* device = deviceManager.getCurrentAudioDevice()) openCueDevice(*device);
+        return;
+    }
+    appliedAudioRequest = request;
+    const AudioDeviceConfig::Result result = migrateAudioDevice(&request);
+
+    const QString running = QString::fromStdString(AudioDeviceConfig::current(deviceManager).describe().toStdString());
+    if (result.ok())
+        QMessageBox::information(this, "Audio Device", QString("Now running on %1.").arg(running));
+    else
+        QMessageBox::warning(this, "Audio Device", QString("The audio device could not be opened: %1\n\nStill running on %2.")
+            .arg(QString::fromStdString(result.error.toStdString()), running));
+}
+
+AudioDeviceConfig::Result QtMainWindow::migrateAudioDevice(const AudioDeviceConfig::Request* request)
+{
+    // Fade out first; a device that died renders nothing, so the wait is bounded
+    deckMixer->fadeOutput();
+    const double fadeStartMs = juce::Time::getMillisecondCounterHiRes();
+    while (!deckMixer->isOutputSilent()
+           && juce::Time::getMillisecondCounterHiRes() - fadeStartMs < 2.0 * DeckMixer::DefaultFadeMs + 10.0)
+        juce::Thread::sleep(1);
+
+    // No callback runs on the players from here until the mixer is attached again, so they are
+    // prepared for the new format on this thread and the audio thread never does any of it
+    deviceManager.removeAudioCallback(deckMixer.get());
+    const AudioDeviceConfig::Result result = request != nullptr ? AudioDeviceConfig::apply(deviceManager, *request)
+                                                                : AudioDeviceConfig::current(deviceManager);
+    if (auto* device = deviceManager.getCurrentAudioDevice()) {
+        // A recording keeps going across a move at the same rate; its file can't change rate
+        if (masterRecorder.isRecording() && masterRecorder.getSampleRate() != device->getCurrentSampleRate())
+            masterRecorder.stop();
+        if (multitrackRecorder.isRecording() && multitrackRecorder.getSampleRate() != device->getCurrentSampleRate())
+            multitrackRecorder.stop();
+        if (masterStreamer.isStreaming() && masterStreamer.getSampleRate() != device->getCurrentSampleRate())
+            masterStreamer.stop();
+        prepareDecksForDevice(*device);
+        openCueDevice(*device);
+    }
+    applyLatencyCalibration();
+    // Fades back in from the first block (DeckMixer::audioDeviceAboutToStart)
+    deviceManager.addAudioCallback(deckMixer.get());
+    return result;
+}
+
+void QtMainWindow::prepareDecksForDevice(juce::AudioIODevice& device)
+{
+    preparedDeviceRate = device.getCurrentSampleRate();
+    preparedDeviceBlock = device.getCurrentBufferSizeSamples();
+    // Same rate: tracks, positions, loops and the keylock stretchers carry over unchanged
+    if (playerA) playerA->prepareToPlay(preparedDeviceBlock, preparedDeviceRate);
+    if (playerB) playerB->prepareToPlay(preparedDeviceBlock, preparedDeviceRate);
+}
+
+void QtMainWindow::openCueDevice(juce::AudioIODevice& master)
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    appliedCueDevice = prefs.value("Audio/CueDevice", "").toString();
+    cueOutputDevice.close();
+    if (appliedCueDevice.isEmpty() || !deckMixer) return;
+    cueOutputDevice.setProfiler(&deckMixer->getProfiler());
+    const juce::String error = cueOutputDevice.open(deviceManager, appliedCueDevice.toStdString(),
+                                                    master.getCurrentSampleRate(), master.getCurrentBufferSizeSamples(),
+                                                    prefs.value("Audio/BufferSize", 512).toInt());
+    // The cue falls back to outputs 3/4, if there are any
+    if (error.isNotEmpty())
+        std::cout << "Cue device " << appliedCueDevice.toStdString() << " not opened: " << error.toStdString() << std::endl;
+}
+
+void QtMainWindow::checkAudioDevice()
+{
+    // The calibration has the device to itself until it restores the setup
+    if (!deckMixer || latencyCalibrator) return;
+    auto* device = deviceManager.getCurrentAudioDevice();
+    const bool failed = deckMixer->takeDeviceError() || device == nullptr || !device->isPlaying();
+    if (failed) {
+        // One attempt every two seconds while nothing opens
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        if (nowMs - lastFailoverMs < 2000.0) return;
+        lastFailoverMs = nowMs;
+        std::cout << "Audio device lost, failing over to the default output" << std::endl;
+        AudioDeviceConfig::Request fallback = appliedAudioRequest;
+        fallback.deviceName = {};
+        fallback.exclusive = false;
+        const AudioDeviceConfig::Result result = migrateAudioDevice(&fallback);
+        std::cout << (result.ok() ? "Audio now on " + result.describe() : "No audio output: " + result.error).toStdString() << std::endl;
+        return;
+    }
+    // JUCE reopens a device that left the device list by itself, maybe at another format
+    if (device->getCurrentSampleRate() != preparedDeviceRate || device->getCurrentBufferSizeSamples() != preparedDeviceBlock) {
+        std::cout << "Audio device format changed, preparing the decks again" << std::endl;
+        migrateAudioDevice(nullptr);
+    }
+}
+
+void QtMainWindow::setOnBattery(bool onBattery)
+{
+    if (onBattery == onBatteryPower) return;
+    onBatteryPower = onBattery;
+    std::cout << "Power: running on " << (onBattery ? "battery" : "mains power") << std::endl;
+    refreshPowerProfile();
+}
+
+void QtMainWindow::refreshPowerProfile()
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    applyPowerProfile(onBatteryPower && prefs.value("Performance/LowPowerOnBattery", true).toBool());
+}
+
+void QtMainWindow::refreshLibraryView()
+{
+    if (libraryManager) libraryManager->applyViewSettings();
+}
+
+void QtMainWindow::refreshDeckViews()
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const auto style = prefs.value("Interface/WaveformStyle", 0).toInt() == 1 ? WaveformDisplay::DisplayStyle::Spectrogram
+                                                                             : WaveformDisplay::DisplayStyle::Waveform;
+    if (overviewTopA) overviewTopA->setDisplayStyle(style);
+    if (overviewTopB) overviewTopB->setDisplayStyle(style);
+    // Performance/EnableGpuAcceleration off: every view rasterizes its waveform on the CPU
+    const bool accelerated = prefs.value("Performance/EnableGpuAcceleration", true).toBool();
+    GlResources::instance().setAccelerationEnabled(accelerated);
+    for (QWidget* view : std::initializer_list<QWidget*>{ overviewTopA, overviewTopB,
+                                                          deckA ? deckA->getWaveform() : nullptr,
+                                                          deckB ? deckB->getWaveform() : nullptr })
+        if (view) view->update();
+    // Interface/ThreadedWaveforms: the top waveforms scroll on render threads of their own,
+    // whatever the GUI thread is doing; the spectrogram style is always drawn here
+    const bool threaded = prefs.value("Interface/ThreadedWaveforms", true).toBool() && accelerated
+                          && style == WaveformDisplay::DisplayStyle::Waveform;
+    if (overviewTopA && threaded != overviewTopA->isThreadedRendering())
+        overviewTopA->setThreadedRendering(threaded ? playerA : nullptr);
+    if (overviewTopB && threaded != overviewTopB->isThreadedRendering())
+        overviewTopB->setThreadedRendering(threaded ? playerB : nullptr);
+    if (phaseCompare) phaseCompare->setVisible(prefs.value("Interface/ShowPhaseCompare", false).toBool());
+}
+
+void QtMainWindow::loadDeckPlugin(int deck)
+{
+    DJAudioPlayer* player = deck == 0 ? playerA : playerB;
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (!player || !device) {
+        QMessageBox::warning(this, "Deck Plugins", "No audio device is running.");
+        return;
+    }
+    // VST3 and LV2 plugins are bundle directories
+#if defined(Q_OS_WIN)
+    const QString pluginDir = "C:/Program Files/Common Files/VST3";
+#elif defined(Q_OS_MAC)
+    const QString pluginDir = "/Library/Audio/Plug-Ins/VST3";
+#else
+    const QString pluginDir = QDir::homePath() + "/.vst3";
+#endif
+    const QString path = QFileDialog::getExistingDirectory(this, QString("Plugin for Deck %1 (.vst3 or .lv2)").arg(deck == 0 ? 'A' : 'B'),
+                                                           QDir(pluginDir).exists() ? pluginDir : QDir::homePath());
+    if (path.isEmpty()) return;
+
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const QString fileName = QFileInfo(path).fileName();
+    bool sandboxed = false;
+    for (const QString& pattern : prefs.value("Plugins/Sandboxed", "").toString().split(',', Qt::SkipEmptyParts))
+        sandboxed = sandboxed || fileName.contains(pattern.trimmed(), Qt::CaseInsensitive);
+
+    juce::String error;
+    auto insert = PluginInsert::create(juce::File(path.toStdString()), sandboxed, device->getCurrentSampleRate(),
+                                       device->getCurrentBufferSizeSamples(), error);
+    if (!insert) {
+        QMessageBox::warning(this, "Deck Plugins", QString("Could not load %1: %2").arg(fileName, QString::fromStdString(error.toStdString())));
+        return;
+    }
+    insert->setBudgetPercent(prefs.value("Plugins/CpuBudgetPercent", PluginInsert::DefaultBudgetPercent).toDouble());
+    player->setPluginInsert(std::move(insert));
+}
+
+void QtMainWindow::removeDeckPlugin(int deck)
+{
+    if (DJAudioPlayer* player = deck == 0 ? playerA : playerB)
+        player->setPluginInsert(nullptr);
+}
+
+void QtMainWindow::reenableDeckPlugins()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    for (DJAudioPlayer* player : { playerA, playerB }) {
+        PluginInsert* insert = player ? player->getPluginInsert() : nullptr;
+        if (!insert || !insert->isBypassed() || insert->clearBypass() || !device) continue;
+        // Its sandbox process died: a fresh one
+        juce::String error;
+        auto reloaded = PluginInsert::create(insert->getFile(), true, device->getCurrentSampleRate(),
+                                             device->getCurrentBufferSizeSamples(), error);
+        if (!reloaded) {
+            QMessageBox::warning(this, "Deck Plugins", QString("Could not reload %1: %2")
+                .arg(QString::fromStdString(insert->getName().toStdString()), QString::fromStdString(error.toStdString())));
+            continue;
+        }
+        player->setPluginInsert(std::move(reloaded));
+    }
+    applyPluginSettings();
+}
+
+void QtMainWindow::applyPluginSettings()
+{
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    const double budget = prefs.value("Plugins/CpuBudgetPercent", PluginInsert::DefaultBudgetPercent).toDouble();
+    for (DJAudioPlayer* player : { playerA, playerB })
+        if (PluginInsert* insert = player ? player->getPluginInsert() : nullptr)
+            insert->setBudgetPercent(budget);
+}
+
+void QtMainWindow::applyPowerProfile(bool lowPower)
+{
+    if (lowPower == lowPowerMode) return;
+    lowPowerMode = lowPower;
+    // Only what the UI and the background workers burn; the audio engine and deck loads run as before.
+    // Stopped decks already leave the frame clock (platters, pads, beat indicator repaint on change).
+    FrameClock::instance().setRateCap(lowPower ? LowPowerFrameRate : 0.0);
+    if (jobSystem) jobSystem->setLowPower(lowPower);
+    if (libraryAnalyzer) libraryAnalyzer->setLowPower(lowPower);
+}
+
+void QtMainWindow::calibrateLatency() {
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (!device || !deckMixer) {
+        QMessageBox::warning(this, "Calibrate Latency", "No audio device is running.");
+        return;
+    }
+    if (latencyCalibrator) return;   // already measuring
+    if (QMessageBox::question(this, "Calibrate Latency",
+            "Connect output 1/2 to input 1/2 with a cable, or hold a microphone to the speakers, "
+            "and turn the volume down.\n\nThe decks are muted while eight short chirps play (about four seconds).",
+            QMessageBox::Ok | QMessageBox::Cancel) != QMessageBox::Ok)
+        return;
+
+    // Inputs are off in the normal setup (initialiseWithDefaultDevices(0, 2)); open two for the loop
+    const juce::AudioDeviceManager::AudioDeviceSetup previousSetup = deviceManager.getAudioDeviceSetup();
+    juce::AudioDeviceManager::AudioDeviceSetup setup = previousSetup;
+    setup.useDefaultInputChannels = false;
+    setup.inputChannels.clear();
+    setup.inputChannels.setRange(0, 2, true);
+    deviceManager.removeAudioCallback(deckMixer.get());
+    const juce::String error = deviceManager.setAudioDeviceSetup(setup, true);
+    latencyCalibrator = std::make_unique<LatencyCalibrator>();
+    if (error.isEmpty()) deviceManager.addAudioCallback(latencyCalibrator.get());
+
+    auto* progressDialog = new QProgressDialog("Measuring latency...", "Cancel", 0, 1000, this);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->show();
+
+    if (!latencyCalibrationTimer) latencyCalibrationTimer = new QTimer(this);
+    latencyCalibrationTimer->disconnect();
+    latencyCalibrationTimer->setInterval(100);
+    const qint64 startMs = QDateTime::currentMSecsSinceEpoch();
+    // Twice the measurement time, in case the device never delivers a callback
+    const qint64 timeoutMs = (qint64) (2000.0 * LatencyCalibrator::PingIntervalSeconds * (LatencyCalibrator::NumPings + 1));
+    connect(latencyCalibrationTimer, &QTimer::timeout, this, [this, progressDialog, previousSetup, error, startMs, timeoutMs]() {
+        progressDialog->setValue((int) (latencyCalibrator->getProgress() * 1000.0));
+        const bool cancelled = progressDialog->wasCanceled();
+        if (error.isEmpty() && !cancelled && !latencyCalibrator->isFinished()
+            && QDateTime::currentMSecsSinceEpoch() - startMs < timeoutMs)
+            return;
+
+        latencyCalibrationTimer->stop();
+        progressDialog->close();
+        deviceManager.removeAudioCallback(latencyCalibrator.get());
+        deviceManager.setAudioDeviceSetup(previousSetup, true);
+        const LatencyCalibrator::Result result = latencyCalibrator->analyse();
+        latencyCalibrator.reset();
+        if (result.valid) {
+            QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+            prefs.setValue("Latency/Device", QString::fromStdString(result.deviceName.toStdString()));
+            prefs.setValue("Latency/SampleRate", result.sampleRate);
+            prefs.setValue("Latency/BlockSize", result.blockSize);
+            prefs.setValue("Latency/OutputSamples", result.outputLatencySamples);
+        }
+        applyLatencyCalibration();
+        deviceManager.addAudioCallback(deckMixer.get());
+
+        if (cancelled) return;
+        if (!error.isEmpty()) {
+            QMessageBox::warning(this, "Calibrate Latency",
+                QString("Could not open the audio inputs: %1").arg(QString::fromStdString(error.toStdString())));
+            return;
+        }
+        if (!result.valid) {
+            QMessageBox::warning(this, "Calibrate Latency",
+                QString("Measurement failed: %1.").arg(QString::fromStdString(result.error.toStdString())));
+            return;
+        }
+
+        const double displayMs = FrameClock::instance().getDisplayLatencyNs() * 1.0e-6;
+        auto ms = [](double v) { return QString::number(v, 'f', 1); };
+        QString summary = QString("Round trip: %1 ms (%2 of %3 pings, weakest %4 dB)\n"
+                                  "Device reports: input %5 ms, output %6 ms\n"
+                                  "Output latency used: %7 ms\n"
+                                  "Display latency: %8 ms\n")
+            .arg(ms(result.toMs(result.roundTripSamples))).arg(result.pingsFound).arg(LatencyCalibrator::NumPings)
+            .arg(result.signalToNoiseDb, 0, 'f', 0)
+            .arg(ms(result.toMs(result.reportedInputSamples)), ms(result.toMs(result.reportedOutputSamples)),
+                 ms(result.toMs(result.outputLatencySamples)), ms(displayMs));
+        summary += QString("Audio-to-visual offset: deck A %1 ms, deck B %2 ms")
+            .arg(ms(1000.0 * getVisualDelaySeconds(playerA, userVisualTrimA)),
+                 ms(1000.0 * getVisualDelaySeconds(playerB, userVisualTrimB)));
+        QMessageBox::information(this, "Calibrate Latency", summary);
+    });
+    latencyCalibrationTimer->start();
+}
+
+CallbackProfiler::Report QtMainWindow::takeCallbackReport() {
+    if (!deckMixer) return {};
+    // Drivers that keep no count (most non-ASIO/CoreAudio ones) report -1
+    auto* device = deviceManager.getCurrentAudioDevice();
+    auto report = deckMixer->getProfiler().takeReport(deckMixer->getNumChannels(),
+                                                      device != nullptr ? device->getXRunCount() : -1);
+    FlightRecorder::poll(report.deviceXruns);
+    if (cueOutputDevice.isOpen()) {
+        const auto cue = cueOutputDevice.getStatus();
+        report.cueDriftPpm = cue.driftPpm;
+        report.cueBufferedMs = cue.bufferedMs;
+        report.cueUnderruns = cue.underruns;
+    }
+    if (oscRemote) {
+        OscRemote::Performance perf;
+        perf.loadAvgPercent = report.loadAvgPercent;
+        perf.loadP99Percent = report.loadP99Percent;
+        perf.loadMaxPercent = report.loadMaxPercent;
+        perf.callbackP99Us = report.callback.p99Us;
+        perf.overruns = report.overruns;
+        perf.lateCallbacks = report.lateCallbacks;
+        perf.deviceXruns = report.deviceXruns;
+        if (jobSystem) {
+            const auto load = jobSystem->getLoad();
+            perf.jobsReady = load.ready;
+            perf.jobsWaiting = load.waiting;
+            perf.jobsRunning = load.running;
+        }
+        if (libraryAnalyzer) perf.analysisPending = libraryAnalyzer->getPendingCount();
+        oscRemote->publishPerformance(perf);
+    }
+    return report;
+}
+
+bool QtMainWindow::setMasterRecording(bool enabled) {
+    if (!enabled) {
+        if (masterRecorder.isRecording()) {
+            masterRecorder.stop();
+            if (masterRecorder.getOverflowCount() > 0)
+                QMessageBox::warning(this, "Record Master", QString("The disk could not keep up: %1 ms of audio were dropped.")
+                    .arg(1000.0 * masterRecorder.getDroppedSamples() / masterRecorder.getSampleRate(), 0, 'f', 0));
+        }
+        return false;
+    }
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (!device) {
+        QMessageBox::warning(this, "Record Master", "No audio device is running.");
+        return false;
+    }
+    const QString stamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm");
+    const QString path = QFileDialog::getSaveFileName(this, "Record Master Output",
+        QStandardPaths::writableLocation(QStandardPaths::MusicLocation) + "/set_" + stamp + ".flac",
+        "FLAC (*.flac);;WAV (*.wav)");
+    if (path.isEmpty()) return false;
+
+    if (!masterRecorder.start(juce::File(path.toStdString()), device->getCurrentSampleRate())) {
+        QMessageBox::warning(this, "Record Master", QString("Could not start recording to %1").arg(path));
+        return false;
     }
+    return true;
 }
 
-void QtMainWindow::performCleanup()
-{
-    if (cleanupCompleted) return; // Prevent double cleanup
-    
-    std::cout << "Performing cleanup..." << std::endl;
-    try {
-        // 1. Stop all audio players
-        if (playerA) {
-            playerA->stop();
-            std::cout << "Player A stopped" << std::endl;
-        }
-        if (playerB) {
-            playerB->stop();
-            std::cout << "Player B stopped" << std::endl;
-        }
-        
-        // 2. Remove audio callbacks before closing device
-        // deviceManager.removeAudioCallback(&mixer); // Removed - no longer using mixer
-        if (stereoCallback) {
-            deviceManager.removeAudioCallback(stereoCallback.get());
-        }
-        deviceManager.removeAudioCallback(&masterLevelMonitor);
-        std::cout << "Audio callbacks removed" << std::endl;
-        
-        // 4. No sources to disconnect (using custom callback now)
-        std::cout << "No sources to disconnect (using stereo callback)" << std::endl;
-        
-        // 5. Close audio device
-        deviceManager.closeAudioDevice();
-        std::cout << "Audio device closed" << std::endl;
-        
-        // 6. Wait for any pending BPM analysis
-        if (bpmThreadPool) {
-            bpmThreadPool->waitForDone(1000); // Reduced timeout
-            std::cout << "BPM thread pool finished" << std::endl;
-        }
-        
-        // 7. Delete players safely
-        delete playerA;
-        playerA = nullptr;
-        std::cout << "Player A deleted" << std::endl;
-        
-        delete playerB;
-        playerB = nullptr;
-        std::cout << "Player B deleted" << std::endl;
-        
-        delete bpmAnalyzer;
-        bpmAnalyzer = nullptr;
-        std::cout << "BPM analyzer deleted" << std::endl;
-        
-        // 8. Handle shared format manager cleanup
-        formatManagerRefCount--;
-        if (formatManagerRefCount <= 0 && sharedFormatManager) {
-            delete sharedFormatManager;
-            sharedFormatManager = nullptr;
-            formatManagerRefCount = 0;
-            std::cout << "Format manager cleaned up" << std::endl;
+bool QtMainWindow::setMultitrackRecording(bool enabled) {
+    if (!enabled) {
+        if (multitrackRecorder.isRecording()) {
+            multitrackRecorder.stop();
+            if (multitrackRecorder.getOverflowCount() > 0)
+                QMessageBox::warning(this, "Record Multitrack", QString("The disk could not keep up: %1 ms of audio were dropped from every track.")
+                    .arg(1000.0 * multitrackRecorder.getDroppedSamples() / multitrackRecorder.getSampleRate(), 0, 'f', 0));
         }
-        
-        cleanupCompleted = true;
-        std::cout << "Cleanup complete" << std::endl;
-        
-    } catch (const std::exception& e) {
-        std::cout << "Exception during cleanup: " << e.what() << std::endl;
-        cleanupCompleted = true; // Mark as completed even if there was an error
-    } catch (...) {
-        std::cout << "Unknown exception during cleanup" << std::endl;
-        cleanupCompleted = true;
+        return false;
     }
-}
 
-void QtMainWindow::closeEvent(QCloseEvent* event)
-{
-    std::cout << "QtMainWindow::closeEvent called - shutting down..." << std::endl;
-    // BetaPulseX: Speichere alle Deck-Einstellungen
-    try {
-        // Aktualisiere Visual Trim in den Deck-Settings
-        DeckSettings::instance().setVisualTrim(0, userVisualTrimA);  // Deck A
-        DeckSettings::instance().setVisualTrim(1, userVisualTrimB);  // Deck B
-        
-        // Speichere alle Deck-Settings zentral
-        DeckSettings::instance().saveSettings();
-        
-        qDebug() << "BetaPulseX: All deck settings saved successfully";
-    } catch (...) {
-        // Continue even if settings fail
-        qWarning() << "Failed to save deck settings";
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (!device || !deckMixer) {
+        QMessageBox::warning(this, "Record Multitrack", "No audio device is running.");
+        return false;
     }
-    
-    // Disable deck controls immediately
-    if (deckA) deckA->getControlsWidget()->setEnabled(false);
-    if (deckB) deckB->getControlsWidget()->setEnabled(false);
-    
-    // Perform cleanup
-    performCleanup();
-    
-    std::cout << "Accepting close event and quitting application" << std::endl;
-    event->accept();
-    QApplication::quit();
-}
+    const QString parent = QFileDialog::getExistingDirectory(this, "Record Multitrack To",
+        QStandardPaths::writableLocation(QStandardPaths::MusicLocation));
+    if (parent.isEmpty()) return false;
 
-void QtMainWindow::onCrossfader(int v) {
-    std::cout << "Crossfader changed to: " << v << std::endl;
-    // v: 0 => full A (left), 50 => center, 100 => full B (right)
-    // Convert to -1.0f (full A) to +1.0f (full B)
-    float crossPos = (float(v) - 50.0f) / 50.0f;  // -1.0 to +1.0
-    if (stereoCallback) {
-        stereoCallback->setCrossfader(crossPos);
+    // One folder per set; WAV, which every DAW takes and costs the writer no encoding
+    const QString stamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm");
+    const juce::File directory = juce::File(parent.toStdString()).getChildFile("set_" + stamp.toStdString());
+    if (!multitrackRecorder.start(directory, "set_" + stamp.toStdString(), device->getCurrentSampleRate(),
+                                  deckMixer->getNumChannels(), micChannel.isEnabled())) {
+        QMessageBox::warning(this, "Record Multitrack", QString("Could not start recording to %1")
+            .arg(QString::fromStdString(directory.getFullPathName().toStdString())));
+        return false;
     }
+    return true;
 }
 
-// EQ/filter slot implementations
-void QtMainWindow::onLeftHighChanged(int v) {
-    std::cout << "onLeftHighChanged called with value: " << v << std::endl;
-    // map -100..100 to -1.0..1.0
-    double val = v / 100.0;
-    if (playerA) {
-        std::cout << "  Calling playerA->setHighGain(" << val << ")" << std::endl;
-        playerA->setHighGain(val);
-    } else {
-        std::cout << "  ERROR: playerA is null!" << std::endl;
-    }
+bool QtMainWindow::setMasterStreaming(bool enabled) {
+    if (!enabled) {
+        if (masterStreamer.isStreaming()) {
+            masterStreamer.stop();
+            if (masterStreamer.getDroppedSamples() > 0)
+                QMessageBox::warning(this, "Stream Master", QString("The encoder could not keep up: %1 ms of audio were dropped.")
+                    .arg(1000.0 * masterStreamer.getDroppedSamples() / masterStreamer.getSampleRate(), 0, 'f', 0));
+        }
+        return false;
+    }
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (!device) {
+        QMessageBox::warning(this, "Stream Master", "No audio device is running.");
+        return false;
+    }
+    QSettings prefs(AppConfig::instance().getConfigDirectory() + "/preferences.ini", QSettings::IniFormat);
+    MasterStreamer::Config config;
+    config.host = prefs.value("Streaming/Host").toString().toStdString();
+    config.port = prefs.value("Streaming/Port", config.port).toInt();
+    config.mount = prefs.value("Streaming/Mount", config.mount.toRawUTF8()).toString().toStdString();
+    config.user = prefs.value("Streaming/User", config.user.toRawUTF8()).toString().toStdString();
+    config.password = prefs.value("Streaming/Password").toString().toStdString();
+    config.name = prefs.value("Streaming/Name", config.name.toRawUTF8()).toString().toStdString();
+    config.bitrateKbps = prefs.value("Streaming/BitrateKbps", config.bitrateKbps).toInt();
+    if (config.host.isEmpty()) {
+        QMessageBox::warning(this, "Stream Master", "Set the Icecast server (Streaming/Host, Port, Mount, Password) in preferences.ini first.");
+        return false;
+    }
+    // Connects in the background and keeps retrying; the log says when it is live
+    if (!masterStreamer.start(config, device->getCurrentSampleRate())) {
+        QMessageBox::warning(this, "Stream Master", "Could not start the stream.");
+        return false;
+    }
+    return true;
 }
 
-void QtMainWindow::onLeftMidChanged(int v) {
-    std::cout << "onLeftMidChanged called with value: " << v << std::endl;
-    double val = v / 100.0;
-    if (playerA) {
-        std::cout << "  Calling playerA->setMidGain(" << val << ")" << std::endl;
-        playerA->setMidGain(val);
-    } else {
-        std::cout << "  ERROR: playerA is null!" << std::endl;
+void QtMainWindow::setMasterScopeVisible(bool visible) {
+    if (!visible) {
+        if (masterScopeView) masterScopeView->hide();
+        return;
+    }
+    if (!masterScopeView) {
+        masterScopeView = new MasterScopeView(masterScope, this);
+        masterScopeView->setWindowFlags(Qt::Tool);
+        masterScopeView->setWindowTitle("Master Scope");
+        masterScopeView->resize(720, 300);
     }
+    masterScopeView->show();
+    masterScopeView->raise();
 }
 
-void QtMainWindow::onLeftLowChanged(int v) {
-    std::cout << "onLeftLowChanged called with value: " << v << std::endl;
-    double val = v / 100.0;
-    if (playerA) playerA->setLowGain(val);
+bool QtMainWindow::isMasterScopeVisible() const {
+    return masterScopeView && masterScopeView->isVisible();
 }
 
-void QtMainWindow::onLeftFilterChanged(int v) {
-    std::cout << "onLeftFilterChanged called with value: " << v << std::endl;
-    // map -100..100 to -1..1 (center 0 = bypass)
-    double norm = v / 100.0;
-    if (playerA) {
-        std::cout << "  Calling playerA->setFilterCutoff(" << norm << ")" << std::endl;
-        playerA->setFilterCutoff(norm);
-    } else {
-        std::cout << "  ERROR: playerA is null!" << std::endl;
-    }
+void QtMainWindow::onLeftCueToggled(bool enabled) {
+    if (deckMixer) deckMixer->setChannelCue(mixerChannelA, enabled);
 }
 
-void QtMainWindow::onRightHighChanged(int v) {
-    std::cout << "onRightHighChanged called with value: " << v << std::endl;
-    double val = v / 100.0;
-    if (playerB) playerB->setHighGain(val);
+void QtMainWindow::onRightCueToggled(bool enabled) {
+    if (deckMixer) deckMixer->setChannelCue(mixerChannelB, enabled);
 }
 
-void QtMainWindow::onRightMidChanged(int v) {
-    std::cout << "onRightMidChanged called with value: " << v << std::endl;
-    double val = v / 100.0;
-    if (playerB) playerB->setMidGain(val);
+void QtMainWindow::onCueMixChanged(int v) {
+    // 0 = cue only, 100 = master only
+    if (deckMixer) deckMixer->setCueMix(juce::jlimit(0.0f, 1.0f, (float) v / 100.0f));
 }
 
-void QtMainWindow::onRightLowChanged(int v) {
-    std::cout << "onRightLowChanged called with value: " << v << std::endl;
-    double val = v / 100.0;
-    if (playerB) playerB->setLowGain(val);
+void QtMainWindow::onMicToggled(bool enabled) {
+    micChannel.setEnabled(enabled);
 }
 
-void QtMainWindow::onRightFilterChanged(int v) {
-    // map -100..100 to -1..1 (center 0 = bypass)
-    double norm = v / 100.0;
-    if (playerB) playerB->setFilterCutoff(norm);
+void QtMainWindow::onTalkoverToggled(bool enabled) {
+    micChannel.setTalkover(enabled);
 }
 
-void QtMainWindow::onLeftVolumeChanged(int v) {
-    std::cout << "Left volume changed to: " << v << std::endl;
-    if (stereoCallback) {
-        float volume = juce::jlimit(0.0f, 1.0f, (float)v / 100.0f);
-        stereoCallback->setVolumeA(volume);
-    }
+void QtMainWindow::onMicGainChanged(int db) {
+    micChannel.setGainDb((float) db);
 }
 
-void QtMainWindow::onRightVolumeChanged(int v) {
-    std::cout << "Right volume changed to: " << v << std::endl;
-    if (stereoCallback) {
-        float volume = juce::jlimit(0.0f, 1.0f, (float)v / 100.0f);
-        stereoCallback->setVolumeB(volume);
-    }
+void QtMainWindow::onMicEqChanged() {
+    // -100..100 to -1..1, the deck EQ's knob range
+    micChannel.setEq(micHigh->value() / 100.0f, micMid->value() / 100.0f, micLow->value() / 100.0f);
 }
 
 void QtMainWindow::keyPressEvent(QKeyEvent* event) {
@@ -1620,6 +3032,14 @@ void QtMainWindow::keyPressEvent(QKeyEvent* event) {
             }
             event->accept();
             break;
+        case Qt::Key_F9: // Instant double: deck B's track onto deck A
+            instantDouble(true);
+            event->accept();
+            break;
+        case Qt::Key_F10: // Instant double: deck A's track onto deck B
+            instantDouble(false);
+            event->accept();
+            break;
         case Qt::Key_Plus:
         case Qt::Key_Equal:  // Handle both + and = key (same physical key)
             // Increase beat grid zoom on both waveforms
@@ -1663,15 +3083,20 @@ void QtMainWindow::keyPressEvent(QKeyEvent* event) {
 }
 
 void QtMainWindow::handleBpmAnalysisResult(double bpm, const std::vector<double>& beatsSec, double totalSec, 
-                                         const std::string& algorithm, double firstBeatOffset, bool isDeckA) {
+                                         const std::string& algorithm, double firstBeatOffset, bool isDeckA,
+                                         const std::vector<float>& novelty, double noveltyHopSec,
+                                         const TrackStructure& structure) {
+    noteBeatInfo(isDeckA, bpm);
     if (isDeckA) {
         // Handle Deck A results
         if (deckA) deckA->setDetectedBpm(bpm);
         if (deckA && deckA->getWaveform()) {
             deckA->getWaveform()->setBeatInfo(bpm, firstBeatOffset, totalSec);
+            deckA->getWaveform()->setStructure(structure);
         }
         if (playerA) {
             playerA->setBeatInfo(bpm, firstBeatOffset, totalSec);
+            playerA->setBeatGrid(BeatGrid::constant(bpm, firstBeatOffset, totalSec, structure));
         }
         // Update beat indicator with per-deck BPM and first beat offset
         if (beatIndicator) {
@@ -1686,6 +3111,8 @@ void QtMainWindow::handleBpmAnalysisResult(double bpm, const std::vector<double>
                 for (double t : beatsSec) rel.append(t / totalSec);
                 overviewTopA->setBeats(rel);
             }
+            overviewTopA->setBeatNovelty(novelty, noveltyHopSec);
+            overviewTopA->setStructure(structure);
         }
         if (deckALabel) {
             algorithmA = QString::fromStdString(algorithm);
@@ -1696,9 +3123,11 @@ void QtMainWindow::handleBpmAnalysisResult(double bpm, const std::vector<double>
         if (deckB) deckB->setDetectedBpm(bpm);
         if (deckB && deckB->getWaveform()) {
             deckB->getWaveform()->setBeatInfo(bpm, firstBeatOffset, totalSec);
+            deckB->getWaveform()->setStructure(structure);
         }
         if (playerB) {
             playerB->setBeatInfo(bpm, firstBeatOffset, totalSec);
+            playerB->setBeatGrid(BeatGrid::constant(bpm, firstBeatOffset, totalSec, structure));
         }
         // Update beat indicator with per-deck BPM and first beat offset
         if (beatIndicator) {
@@ -1713,6 +3142,8 @@ void QtMainWindow::handleBpmAnalysisResult(double bpm, const std::vector<double>
                 for (double t : beatsSec) rel.append(t / totalSec);
                 overviewTopB->setBeats(rel);
             }
+            overviewTopB->setBeatNovelty(novelty, noveltyHopSec);
+            overviewTopB->setStructure(structure);
         }
         if (deckBLabel) {
             algorithmB = QString::fromStdString(algorithm);
@@ -1721,31 +3152,331 @@ void QtMainWindow::handleBpmAnalysisResult(double bpm, const std::vector<double>
     }
 }
 
-void QtMainWindow::updateOverviewLabel(bool isDeckA)
+void QtMainWindow::previewTrack(const QString& filePath, double fraction)
 {
-    QLabel* lbl = isDeckA ? deckALabel : deckBLabel;
-    if (!lbl) return;
-    bool active = isDeckA ? analysisActiveA : analysisActiveB;
-    bool failed = isDeckA ? analysisFailedA : analysisFailedB;
-    double prog = isDeckA ? analysisProgressA : analysisProgressB;
-    double originalBpm = (isDeckA ? overviewTopA : overviewTopB) ? (isDeckA ? overviewTopA->originalBpm : overviewTopB->originalBpm) : 0.0;
-    QString algText = (isDeckA ? algorithmA : algorithmB).isEmpty() ? QString("") : QString(" - %1").arg(isDeckA ? algorithmA : algorithmB);
-    QString prefix = isDeckA ? "DECK A - OVERVIEW" : "DECK B - OVERVIEW";
-    QString suffix;
-    if (active) {
-        int percent = (int)std::round(prog * 100.0);
-        suffix = QString(" (Analyzing %1%)").arg(percent);
-    } else if (failed) {
-        suffix = QString(" (Analysis failed)");
-    } else {
-    const double trimMs = (isDeckA ? userVisualTrimA : userVisualTrimB) * 1000.0;
-    QString trimText = (std::abs(trimMs) > 0.0001) ? QString("  |  trim %1 ms").arg(QString::number(trimMs, 'f', 1)) : QString("");
-    suffix = QString(" (BPM: %1%2)%3")
-             .arg(originalBpm > 0.0 ? QString::number((int)std::round(originalBpm)) : QString("--"))
-             .arg(algText)
-             .arg(trimText);
+    const juce::File file(filePath.toStdString());
+    // The same track again is a scrub: a seek within what is already open
+    if (previewPlayer.getFile() == file) {
+        previewPlayer.seek(fraction);
+    } else if (!previewPlayer.play(file, fraction)) {
+        std::cout << "Preview: can't open " << filePath.toStdString() << std::endl;
+        return;
+    }
+    if (deckMixer && !deckMixer->hasCueOutput())
+        std::cout << "Preview: no headphone output on this device, nothing to hear it on" << std::endl;
+    libraryManager->setPreviewPosition(filePath, fraction);
+    previewTimer->start();
+}
+
+QtDeckWidget* QtMainWindow::getMasterDeck() const
+{
+    // A following deck takes its tempo from the other one
+    if (syncAEnabled != syncBEnabled) return syncAEnabled ? deckB : deckA;
+    const bool playingA = deckA && deckA->isPlaying();
+    const bool playingB = deckB && deckB->isPlaying();
+    if (playingA != playingB) return playingA ? deckA : deckB;
+    return lastLoadedDeck ? lastLoadedDeck : deckA;
+}
+
+void QtMainWindow::updateCompatibleTracks()
+{
+    if (!libraryManager) return;
+    QtDeckWidget* master = getMasterDeck();
+    if (!master) return;
+    const double bpm = master->getDetectedBpm() * master->getTempoFactor();
+    libraryManager->showCompatibleTracks(master->getCurrentFilePath(), bpm);
+}
+
+void QtMainWindow::noteBeatInfo(bool isDeckA, double bpm)
+{
+    (isDeckA ? beatInfoPathA : beatInfoPathB) = isDeckA ? loadedTrackPathA : loadedTrackPathB;
+    (isDeckA ? beatInfoBpmA : beatInfoBpmB) = bpm;
+}
+
+void QtMainWindow::setAutoDj(bool enabled)
+{
+    if (enabled == isAutoDjEnabled()) return;
+    if (!enabled) {
+        if (autoDjStage == AutoDjStage::Scheduled && deckMixer) deckMixer->cancelTransition();
+        // A deck still waiting for its cue goes back to paused; one already mixing in keeps playing
+        DJAudioPlayer* in = autoDjOutIsA ? playerB : playerA;
+        if (in && in->isArmed()) in->stop();
+        autoDjStage = AutoDjStage::Off;
+        ++autoDjSerial;   // a plan still being worked out lands nowhere
+        std::cout << "AutoDJ: off" << std::endl;
+        return;
+    }
+    if (!deckA || !deckB || !playerA || !playerB || !deckMixer || !jobSystem) return;
+
+    // Mixing out of the deck that plays (the one heard when both do), else the one with a track
+    const bool playingA = deckA->isPlaying();
+    const bool playingB = deckB->isPlaying();
+    if (playingA && playingB) autoDjOutIsA = !crossfader || crossfader->value() <= 50;
+    else if (playingA || playingB) autoDjOutIsA = playingA;
+    else if (!deckA->getCurrentFilePath().isEmpty() || !deckB->getCurrentFilePath().isEmpty())
+        autoDjOutIsA = !deckA->getCurrentFilePath().isEmpty();
+    else {
+        std::cout << "AutoDJ: load a track on a deck first" << std::endl;
+        return;
+    }
+
+    QtDeckWidget* out = autoDjOutIsA ? deckA : deckB;
+    QtDeckWidget* in = autoDjOutIsA ? deckB : deckA;
+    if (!out->isPlaying()) out->handleControllerButton(ControllerInput::Action::PlayPause, true);
+    if (in->isPlaying()) in->handleControllerButton(ControllerInput::Action::PlayPause, true);
+
+    autoDjPlayed.clear();
+    autoDjPlayed.insert(out->getCurrentFilePath());
+    autoDjNextPath.clear();
+    autoDjStage = AutoDjStage::Loading;
+    std::cout << "AutoDJ: on, mixing out of deck " << (autoDjOutIsA ? "A" : "B") << std::endl;
+}
+
+void QtMainWindow::tickAutoDj()
+{
+    if (autoDjStage == AutoDjStage::Off || !deckMixer || !deckA || !deckB || !playerA || !playerB) return;
+    QtDeckWidget* outDeck = autoDjOutIsA ? deckA : deckB;
+    QtDeckWidget* inDeck = autoDjOutIsA ? deckB : deckA;
+    DJAudioPlayer* inPlayer = autoDjOutIsA ? playerB : playerA;
+    const QString inPath = inDeck->getCurrentFilePath();
+
+    if (autoDjStage == AutoDjStage::Loading) {
+        if (inPath.isEmpty() || inPath != autoDjNextPath) {
+            // A track the DJ put on the idle deck goes next
+            if (!inPath.isEmpty() && !inDeck->isPlaying() && !autoDjPlayed.contains(inPath)) {
+                autoDjNextPath = inPath;
+            } else {
+                const QString next = pickAutoDjTrack();
+                if (next.isEmpty()) {
+                    std::cout << "AutoDJ: nothing left in the library to play" << std::endl;
+                    setAutoDj(false);
+                    return;
+                }
+                autoDjNextPath = next;
+                if (inDeck->isPlaying()) inDeck->handleControllerButton(ControllerInput::Action::PlayPause, true);
+                inDeck->loadFile(next);
+            }
+        }
+        // Planned from the track's own grid, so only once it is loaded and analysed
+        if ((autoDjOutIsA ? loadedTrackPathB : loadedTrackPathA) != autoDjNextPath
+            || (autoDjOutIsA ? beatInfoPathB : beatInfoPathA) != autoDjNextPath)
+            return;
+        if ((autoDjOutIsA ? beatInfoBpmB : beatInfoBpmA) <= 0.0) {
+            std::cout << "AutoDJ: no beat grid for " << autoDjNextPath.toStdString() << ", skipping it" << std::endl;
+            autoDjPlayed.insert(autoDjNextPath);
+            autoDjNextPath.clear();
+            return;
+        }
+        planAutoDjTransition();
+        return;
+    }
+
+    // The DJ loaded something else on the incoming deck before it started: that one goes next
+    const bool replaced = inPath != autoDjNextPath && !autoDjInStarted;
+    if (autoDjStage == AutoDjStage::Planning) {
+        if (replaced) {
+            ++autoDjSerial;
+            autoDjNextPath.clear();
+            autoDjStage = AutoDjStage::Loading;
+        }
+        return;
+    }
+
+    const DeckMixer::TransitionStatus status = deckMixer->getTransitionStatus();
+    if (status.serial != autoDjSerial) return;   // not picked up by the audio thread yet
+    switch (status.state) {
+        case DeckMixer::TransitionState::Waiting:
+            if (replaced) {
+                deckMixer->cancelTransition();
+            } else if (!outDeck->isPlaying()) {
+                std::cout << "AutoDJ: the playing deck was stopped" << std::endl;
+                setAutoDj(false);
+            }
+            return;
+        case DeckMixer::TransitionState::Fading:
+        case DeckMixer::TransitionState::Ramping:
+        case DeckMixer::TransitionState::Done:
+            if (!autoDjInStarted) {
+                autoDjInStarted = true;
+                inDeck->notePlaybackStarted();
+                mixAutomation.record(autoDjOutIsA ? 1 : 0, MixAutomation::Kind::Play);
+                std::cout << "AutoDJ: deck " << (autoDjOutIsA ? "B" : "A") << " mixing in" << std::endl;
+            }
+            showAutoDjCrossfader(status.crossfader, false);
+            if (status.state != DeckMixer::TransitionState::Done) return;
+            if (outDeck->isPlaying()) outDeck->handleControllerButton(ControllerInput::Action::PlayPause, true);
+            autoDjPlayed.insert(autoDjNextPath);
+            autoDjOutIsA = !autoDjOutIsA;
+            autoDjNextPath.clear();
+            autoDjInStarted = false;
+            autoDjStage = AutoDjStage::Loading;
+            return;
+        case DeckMixer::TransitionState::Missed:
+        case DeckMixer::TransitionState::Cancelled:
+            if (inPlayer->isArmed()) inPlayer->stop();
+            if (replaced) {
+                autoDjNextPath.clear();
+                autoDjStage = AutoDjStage::Loading;
+            } else {
+                std::cout << "AutoDJ: missed the mix point, planning the next one" << std::endl;
+                planAutoDjTransition();
+            }
+            return;
+        default:
+            return;
+    }
+}
+
+QString QtMainWindow::pickAutoDjTrack() const
+{
+    constexpr int Candidates = 50;
+    if (!libraryManager) return {};
+    QtDeckWidget* out = autoDjOutIsA ? deckA : deckB;
+    const QString outPath = out ? out->getCurrentFilePath() : QString();
+    const double bpm = out ? out->getDetectedBpm() * out->getTempoFactor() : 0.0;
+    // Best match for the playing track first (the library's compatible-tracks order), else
+    // the library from the top
+    auto pick = [&](const QSet<QString>& played) -> QString {
+        for (const QString& path : libraryManager->getCompatibleFiles(outPath, bpm, Candidates))
+            if (!played.contains(path) && QFileInfo::exists(path)) return path;
+        for (const QString& path : libraryManager->getAllFiles())
+            if (path != outPath && !played.contains(path) && QFileInfo::exists(path)) return path;
+        return {};
+    };
+    // Nothing from the journal's last RecentTracks plays either (earlier sets), while the
+    // library has anything else
+    constexpr int RecentTracks = 100;
+    QSet<QString> played = autoDjPlayed;
+    if (playHistory)
+        for (const PlayHistory::Record& record : playHistory->recent(RecentTracks))
+            played.insert(QString::fromStdString(record.path.toStdString()));
+    const QString fresh = pick(played);
+    return fresh.isEmpty() ? pick(autoDjPlayed) : fresh;
+}
+
+void QtMainWindow::planAutoDjTransition()
+{
+    QtDeckWidget* outDeck = autoDjOutIsA ? deckA : deckB;
+    DJAudioPlayer* out = autoDjOutIsA ? playerA : playerB;
+    DJAudioPlayer* in = autoDjOutIsA ? playerB : playerA;
+    autoDjStage = AutoDjStage::Planning;
+    const juce::uint32 serial = ++autoDjSerial;
+
+    // The grids are the players' (a grid set by hand wins), the rest of the analysis is cached
+    AutoDjPlanner::Track outGrid, inGrid;
+    outGrid.bpm = out->getTrackBpm();
+    outGrid.firstBeatSec = out->getFirstBeatOffset();
+    outGrid.lengthSec = out->getTrackLengthSeconds();
+    inGrid.bpm = in->getTrackBpm();
+    inGrid.firstBeatSec = in->getFirstBeatOffset();
+    inGrid.lengthSec = in->getTrackLengthSeconds();
+    const double earliestSec = out->getCurrentPositionSeconds() + AutoDjLeadSeconds * outDeck->getTempoFactor();
+    const juce::File outFile(outDeck->getCurrentFilePath().toStdString());
+    const juce::File inFile(autoDjNextPath.toStdString());
+
+    // Deck work: small, and it must not queue behind the stem separations
+    jobSystem->submit(JobSystem::Priority::DeckAnalysis, (autoDjOutIsA ? deckCancelB : deckCancelA).token(),
+        [this, serial, outGrid, inGrid, earliestSec, outFile, inFile](const JobSystem::CancelToken& token) {
+            EVENT_TRACE_SCOPE("AutoDJ: plan transition", "analysis");
+            const BpmCache cache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString()));
+            const auto describe = [&cache](const juce::File& file, const AutoDjPlanner::Track& grid) {
+                // The analysis just done is in the HotTrackCache before its BpmCache write
+                std::shared_ptr<const BpmCache::Entry> known = HotTrackCache::getInstance().find(file).beatGrid;
+                BpmCache::Entry entry;
+                if (!known && !cache.load(file, entry)) return grid;
+                AutoDjPlanner::Track track = AutoDjPlanner::Track::fromCache(known ? *known : entry);
+                track.bpm = grid.bpm;
+                track.firstBeatSec = grid.firstBeatSec;
+                if (grid.lengthSec > 0.0) track.lengthSec = grid.lengthSec;
+                return track;
+            };
+            const AutoDjPlanner::Plan plan = AutoDjPlanner::plan(describe(outFile, outGrid), describe(inFile, inGrid), earliestSec);
+            if (token.isCancelled()) return;
+            QMetaObject::invokeMethod(this, [this, serial, plan]() { applyAutoDjPlan(serial, plan); }, Qt::QueuedConnection);
+        });
+}
+
+void QtMainWindow::applyAutoDjPlan(juce::uint32 serial, const AutoDjPlanner::Plan& plan)
+{
+    if (serial != autoDjSerial || autoDjStage != AutoDjStage::Planning || !deckMixer) return;
+    DJAudioPlayer* out = autoDjOutIsA ? playerA : playerB;
+    DJAudioPlayer* in = autoDjOutIsA ? playerB : playerA;
+    if (!plan.valid) {
+        std::cout << "AutoDJ: no room left in the playing track for a mix" << std::endl;
+        setAutoDj(false);
+        return;
+    }
+
+    DeckMixer::Transition transition;
+    transition.serial = serial;
+    transition.fromStrip = autoDjOutIsA ? mixerChannelA : mixerChannelB;
+    transition.toStrip = autoDjOutIsA ? mixerChannelB : mixerChannelA;
+    transition.triggerSec = plan.outStartSec;
+    transition.fadeBeats = plan.mixBeats;
+    transition.outBpm = out->getTrackBpm();
+    transition.inBpm = in->getTrackBpm();
+    transition.matchTempo = plan.matchTempo;
+    transition.rampBeats = plan.rampBeats;
+    transition.crossfaderFrom = autoDjOutIsA ? -1.0f : 1.0f;
+    transition.crossfaderTo = -transition.crossfaderFrom;
+    if (!in->armStart(plan.inStartSec) || !deckMixer->scheduleTransition(transition)) {
+        std::cout << "AutoDJ: could not schedule the transition" << std::endl;
+        setAutoDj(false);
+        return;
+    }
+    // Over to the outgoing side while the incoming deck is still silent
+    showAutoDjCrossfader(transition.crossfaderFrom, true);
+    autoDjInStarted = false;
+    autoDjStage = AutoDjStage::Scheduled;
+    std::cout << "AutoDJ: mixing in at " << plan.outStartSec << " s over " << plan.mixBeats << " beats"
+              << (plan.matchTempo ? ", beat-matched" : ", plain fade")
+              << (plan.keyCompatible ? ", keys compatible" : "") << std::endl;
+}
+
+void QtMainWindow::showAutoDjCrossfader(float position, bool toMixer)
+{
+    if (toMixer && deckMixer) deckMixer->setCrossfader(position);
+    if (crossfader) {
+        const QSignalBlocker blocker(crossfader);
+        crossfader->setValue((int) std::lround(position * 50.0f + 50.0f));
+    }
+    if (position != autoDjShownCrossfader) {
+        autoDjShownCrossfader = position;
+        mixAutomation.record(-1, MixAutomation::Kind::Crossfader, position);
     }
-    lbl->setText(prefix + "  " + suffix);
+}
+
+void QtMainWindow::applyAnalysisProgress(bool isDeckA)
+{
+    AnalysisProgress::Snapshot report;
+    if (!(isDeckA ? analysisReportA : analysisReportB).takeChange(report)) return;
+
+    const bool active = report.state == AnalysisProgress::State::Active;
+    const bool failed = report.state == AnalysisProgress::State::Failed;
+    (isDeckA ? analysisActiveA : analysisActiveB) = active;
+    (isDeckA ? analysisFailedA : analysisFailedB) = failed;
+    (isDeckA ? analysisProgressA : analysisProgressB) = report.progress;
+    if (WaveformDisplay* wf = isDeckA ? overviewTopA : overviewTopB) {
+        wf->setAnalysisActive(active);
+        wf->setAnalysisFailed(failed);
+        wf->setAnalysisProgress(report.progress);
+    }
+    updateOverviewLabel(isDeckA);
+}
+
+void QtMainWindow::updateOverviewLabel(bool isDeckA)
+{
+    QtDeckWidget* deck = isDeckA ? deckA : deckB;
+    if (!deck || !(isDeckA ? deckALabel : deckBLabel)) return;
+    // Called on every tempo tick and progress report; the view-model sets the text only when it changes
+    DeckViewModel::Overview state;
+    state.analysisActive = isDeckA ? analysisActiveA : analysisActiveB;
+    state.analysisFailed = isDeckA ? analysisFailedA : analysisFailedB;
+    state.analysisProgress = isDeckA ? analysisProgressA : analysisProgressB;
+    if (WaveformDisplay* wf = isDeckA ? overviewTopA : overviewTopB) state.originalBpm = wf->originalBpm;
+    state.algorithm = isDeckA ? algorithmA : algorithmB;
+    state.visualTrimSec = isDeckA ? userVisualTrimA : userVisualTrimB;
+    deck->getViewModel().setOverview(state);
 }
 
 // Window drag functionality for frameless window
@@ -2310,44 +4041,30 @@ bool QtMainWindow::eventFilter(QObject *obj, QEvent *event) {
     return QWidget::eventFilter(obj, event);
 }
 
-// PREROLL SUPPORT: Update playback positions automatically for smooth UI
+// PREROLL SUPPORT: Update playback positions automatically for smooth UI.
+// The audio thread publishes one snapshot per block; here it is only extrapolated to "now", so
+// the playhead moves every frame and the GUI thread never touches the transport.
 void QtMainWindow::updatePlaybackPositions() {
-    // Only update when not scratching to prevent interference
-    static double lastPosA = -999.0;
-    static double lastPosB = -999.0;
-    static int debugCounter = 0;
-    
-    qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-    
-    // Debug: Print position updates occasionally
-    if (++debugCounter % 200 == 0) {
-        std::cout << "[Timer] Update positions - A: " << (playerA ? playerA->getPositionRelative() : -999.0) 
-                  << ", B: " << (playerB ? playerB->getPositionRelative() : -999.0) << std::endl;
-    }
-    
+    const qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    // Sampled for when this frame is on screen; the user trim (positive delays visuals) on top
+    const juce::uint64 presentationNs = FrameClock::instance().getPresentationNs();
+    auto shownAt = [presentationNs](double trimSec) {
+        return (juce::uint64) std::max<juce::int64>(0, (juce::int64) presentationNs
+                                                       - (juce::int64) (std::clamp(trimSec, -0.05, 0.05) * 1.0e9));
+    };
+
     // Update Deck A position - with post-scratch delay to prevent conflicts
     bool canUpdateA = playerA && overviewTopA && !overviewTopA->isScratching() && 
                       (currentTime - lastScratchEndA > 100); // 100ms delay after scratch end
     
+    // A threaded view samples the snapshot itself, with the same trim
+    if (overviewTopA) overviewTopA->setThreadedVisualTrim(userVisualTrimA);
+    if (overviewTopB) overviewTopB->setThreadedVisualTrim(userVisualTrimB);
     if (canUpdateA) {
-        double relativePos = playerA->getPositionRelative();
-        
-        // Even smarter threshold: very small in preroll for smooth movement, moderate in song
-        double threshold = (relativePos < 0.0) ? 0.0002 : 0.008; // Preroll: 0.0002, Song: 0.008
-        
-        if (std::abs(relativePos - lastPosA) > threshold) {
-            lastPosA = relativePos;
-            
-            // Update waveform displays - be explicit about the position
-            overviewTopA->setPlayhead(relativePos);
-            if (deckA && deckA->getWaveform()) {
-                deckA->getWaveform()->setPlayhead(relativePos);
-            }
-            
-            // Debug: Log significant position changes
-            if (debugCounter % 50 == 0) {
-                std::cout << "[Timer] Deck A position updated to: " << relativePos << std::endl;
-            }
+        const double relativePos = playerA->getPositionSnapshot().relativeAt(shownAt(userVisualTrimA));
+        overviewTopA->setPlayhead(relativePos);
+        if (deckA && deckA->getWaveform()) {
+            deckA->getWaveform()->setPlayhead(relativePos);
         }
     } else if (overviewTopA && overviewTopA->isScratching()) {
         // Update scratch end time when scratching is detected
@@ -2359,28 +4076,17 @@ void QtMainWindow::updatePlaybackPositions() {
                       (currentTime - lastScratchEndB > 100); // 100ms delay after scratch end
     
     if (canUpdateB) {
-        double relativePos = playerB->getPositionRelative();
-        
-        // Even smarter threshold: very small in preroll for smooth movement, moderate in song
-        double threshold = (relativePos < 0.0) ? 0.0002 : 0.008; // Preroll: 0.0002, Song: 0.008
-        
-        if (std::abs(relativePos - lastPosB) > threshold) {
-            lastPosB = relativePos;
-            
-            // Update waveform displays - be explicit about the position
-            overviewTopB->setPlayhead(relativePos);
-            if (deckB && deckB->getWaveform()) {
-                deckB->getWaveform()->setPlayhead(relativePos);
-            }
-            
-            // Debug: Log significant position changes
-            if (debugCounter % 50 == 0) {
-                std::cout << "[Timer] Deck B position updated to: " << relativePos << std::endl;
-            }
+        const double relativePos = playerB->getPositionSnapshot().relativeAt(shownAt(userVisualTrimB));
+        overviewTopB->setPlayhead(relativePos);
+        if (deckB && deckB->getWaveform()) {
+            deckB->getWaveform()->setPlayhead(relativePos);
         }
     } else if (overviewTopB && overviewTopB->isScratching()) {
         // Update scratch end time when scratching is detected
         lastScratchEndB = currentTime;
     }
+
+    // Reads both deck views' playheads set just above
+    if (phaseCompare && phaseCompare->isVisible()) phaseCompare->update();
 }
 
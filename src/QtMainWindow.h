@@ -4,11 +4,14 @@
 #include <QHBoxLayout>
 #include <QSlider>
 #include <QDial>
+#include <QPushButton>
 #include <QTimer>
 #include <QKeyEvent>
 #include <QMouseEvent>
 #include <QThreadPool>
 #include <QProgressBar>
+#include <QSet>
+#include <QPointer>
 #include <ctime>
 #include <chrono>
 #include "QtDeckWidget.h"
@@ -17,58 +20,116 @@
 #include <QListWidget>
 #include "LibraryManager.h"
 #include "MasterLevelMonitor.h"
+#include "MasterScope.h"
+#include "DeckMixer.h"
+#include "KeylockGovernor.h"
+#include "MasterRecorder.h"
+#include "MultitrackRecorder.h"
+#include "MasterStreamer.h"
+#include "MixAutomation.h"
+#include "SamplerBank.h"
+#include "PreviewPlayer.h"
+#include "MicChannel.h"
+#include "OfflineMixRenderer.h"
+#include "LatencyCalibrator.h"
+#include "JobSystem.h"
+#include "AnalysisProgress.h"
+#include "ControllerInput.h"
+#include "NetworkTempoSync.h"
+#include "MidiClockOutput.h"
+#include "LightingOutput.h"
+#include "OscRemote.h"
+#include "WebRemote.h"
+#include "TimecodeDecoder.h"
+#include "AudioDeviceConfig.h"
+#include "CueOutputDevice.h"
+#include "SessionSnapshot.h"
+#include "PlayHistory.h"
+#include "BpmCache.h"
+#include "StemTrackReader.h"
+#include "AutoDjPlanner.h"
+#include "MemoryPressureMonitor.h"
+class MasterScopeView;
 // #include "AudioMixer.h" // Removed - using simplified AudioSourcePlayer approach
 class DJAudioPlayer;
 class BpmAnalyzer;
 class PreferencesDialog;
-
-// Custom audio callback for proper stereo mixing of both decks
-class StereoAudioCallback : public juce::AudioIODeviceCallback {
-public:
-    explicit StereoAudioCallback(DJAudioPlayer* playerA, DJAudioPlayer* playerB) 
-        : audioPlayerA(playerA), audioPlayerB(playerB),
-          volumeA(1.0f), volumeB(1.0f), crossfaderPos(0.0f), masterVolume(1.0f) {}
-    
-    void audioDeviceIOCallback(const float* const* inputChannelData, int numInputChannels,
-                              float* const* outputChannelData, int numOutputChannels, 
-                              int numSamples);
-    
-    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
-                                         float* const* outputChannelData, int numOutputChannels, 
-                                         int numSamples, const juce::AudioIODeviceCallbackContext& context) override;
-    
-    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
-    void audioDeviceStopped() override;
-    
-    // Mixer controls
-    void setVolumeA(float vol) { volumeA.store(juce::jlimit(0.0f, 1.0f, vol)); }
-    void setVolumeB(float vol) { volumeB.store(juce::jlimit(0.0f, 1.0f, vol)); }
-    void setCrossfader(float pos) { crossfaderPos.store(juce::jlimit(-1.0f, 1.0f, pos)); }
-    void setMasterVolume(float vol) { masterVolume.store(juce::jlimit(0.0f, 1.0f, vol)); }
-    
-private:
-    DJAudioPlayer* audioPlayerA{nullptr};
-    DJAudioPlayer* audioPlayerB{nullptr};
-    juce::AudioBuffer<float> tempBufferA;
-    juce::AudioBuffer<float> tempBufferB;
-    
-    // Mixer parameters (atomic for thread safety)
-    std::atomic<float> volumeA{1.0f};
-    std::atomic<float> volumeB{1.0f};
-    std::atomic<float> crossfaderPos{0.0f};  // -1.0 = A only, 0.0 = center, +1.0 = B only
-    std::atomic<float> masterVolume{1.0f};
-};
+class LibraryAnalyzer;
+class TrackPrefetcher;
+class GigPrep;
 
 class QtMainWindow : public QWidget {
     Q_OBJECT
     
     // Forward declaration and friend class for threaded BPM analysis
     friend class BpmAnalysisTask;
+    friend class AudioFileLoadTask;
     
 public:
     explicit QtMainWindow(QWidget* parent = nullptr);
     ~QtMainWindow();
 
+    // Master-bus meter, measured inside the deck mixer (read via getSnapshot())
+    const MasterLevelMonitor& getMasterLevelMonitor() const { return masterLevelMonitor; }
+    // Audio callback timing since the previous call (one caller: the menu bar's DSP readout)
+    CallbackProfiler::Report takeCallbackReport();
+
+    // Mix recording: log every control change, then render the set offline to WAV/FLAC
+    void setMixRecording(bool enabled);
+    bool isMixRecording() const { return mixAutomation.isRecording(); }
+    void renderRecordedMix();
+    // Tools > Calibrate Latency: measures the device's output latency over a loopback and
+    // keeps it per device for the playhead timing
+    void calibrateLatency();
+    // Power source, from the menu bar's battery poll. On battery (and with
+    // Performance/LowPowerOnBattery) the UI and background work go to the low-power profile.
+    void setOnBattery(bool onBattery);
+    // Re-reads Performance/LowPowerOnBattery
+    void refreshPowerProfile();
+    // Re-reads the library's display preferences (Library/ShowWaveforms)
+    void refreshLibraryView();
+    // Re-reads Interface/WaveformStyle and Interface/ShowPhaseCompare for the scrolling deck views
+    void refreshDeckViews();
+    // VST3/LV2 insert on deck 0 (A) or 1 (B): asks for the plugin bundle; sandboxed if its name
+    // is on Plugins/Sandboxed
+    void loadDeckPlugin(int deck);
+    void removeDeckPlugin(int deck);
+    // Bypassed plugins back on; a sandboxed one whose process died is loaded again
+    void reenableDeckPlugins();
+    // Plugins/CpuBudgetPercent to the loaded plugins
+    void applyPluginSettings();
+    // Re-reads Audio/Device, BufferSize, SampleRate and ExclusiveMode and reopens the device
+    // when they changed; the decks keep their tracks and positions
+    void applyAudioDeviceSettings();
+    // Live recording of the master output (asks for the file when starting)
+    bool setMasterRecording(bool enabled);
+    bool isMasterRecording() const { return masterRecorder.isRecording(); }
+    const MasterRecorder& getMasterRecorder() const { return masterRecorder; }
+    // Every deck and the mic to files of their own (asks for the folder when starting)
+    bool setMultitrackRecording(bool enabled);
+    bool isMultitrackRecording() const { return multitrackRecorder.isRecording(); }
+    // Live stream of the master output to the Icecast server in the Streaming/* preferences
+    bool setMasterStreaming(bool enabled);
+    // View > Master Scope: oscilloscope, goniometer and correlation of the master bus in a tool
+    // window; the mixer only feeds the scope while it shows
+    void setMasterScopeVisible(bool visible);
+    bool isMasterScopeVisible() const;
+    // Called by the loader once a track sits on a deck (logged for the offline render)
+    void noteTrackLoaded(bool isDeckA, const QString& filePath);
+    // Called by the analysis job: cues and loop the track was left with (BpmCache::Memory)
+    void applyTrackMemory(bool isDeckA, const QString& filePath, const BpmCache::Memory& memory);
+    // Instant double: loads the other deck's track onto this deck at the same tempo and
+    // position, playing if the source plays. Samples and analysis come from the HotTrackCache.
+    void instantDouble(bool toDeckA);
+    // Queues the load, beat analysis and cache write for a track dropped on a deck
+    void startDeckLoad(bool isDeckA, const QString& filePath);
+    // Called by the loader after the source is applied; completes a pending instant double
+    void finishInstantDouble(bool isDeckA, const QString& filePath);
+    // AutoDJ: mixes the playing deck into a compatible library track on the other deck, and on
+    // from there. Moving the crossfader by hand hands the mix back and turns it off.
+    void setAutoDj(bool enabled);
+    bool isAutoDjEnabled() const { return autoDjStage != AutoDjStage::Off; }
+
 protected:
     // Event filter for double-click reset functionality
     bool eventFilter(QObject *obj, QEvent *event) override;
@@ -88,18 +149,31 @@ private slots:
     // Volume slider slots
     void onLeftVolumeChanged(int v);
     void onRightVolumeChanged(int v);
+    // Headphone cue (PFL) slots
+    void onLeftCueToggled(bool enabled);
+    void onRightCueToggled(bool enabled);
+    void onCueMixChanged(int v);
+    // Microphone strip
+    void onMicToggled(bool enabled);
+    void onTalkoverToggled(bool enabled);
+    void onMicGainChanged(int db);
+    void onMicEqChanged();
 
 public:
     // Performance optimization: Handle BPM analysis results (public for thread access)
     void handleBpmAnalysisResult(double bpm, const std::vector<double>& beatsSec, double totalSec, 
-                                const std::string& algorithm, double firstBeatOffset, bool isDeckA);
+                                const std::string& algorithm, double firstBeatOffset, bool isDeckA,
+                                const std::vector<float>& novelty = {}, double noveltyHopSec = 0.0,
+                                const TrackStructure& structure = {});
     // Performance optimization: Make BPM analyzer accessible to threaded tasks
     BpmAnalyzer* bpmAnalyzer{nullptr};
     // THREADING FIX: Make waveform displays accessible to threads
     class WaveformDisplay* overviewTopA;
     class WaveformDisplay* overviewTopB;
-    // THREADING FIX: Make format manager accessible to threads
-    static juce::AudioFormatManager* sharedFormatManager;
+    // Both decks' waveforms and grids on one time axis (WaveformDisplay::setPhaseCompare)
+    class WaveformDisplay* phaseCompare{nullptr};
+    // DecoderRegistry's manager, for the load tasks
+    juce::AudioFormatManager* sharedFormatManager{nullptr};
     
     // THREADING FIX: Make deck widgets accessible to threads
     QtDeckWidget* deckA;
@@ -117,6 +191,9 @@ private:
     double analysisProgressB{0.0};
     bool analysisFailedA{false};
     bool analysisFailedB{false};
+    // Written by the analysis jobs, applied to the fields above once per frame
+    AnalysisProgress analysisReportA;
+    AnalysisProgress analysisReportB;
 
     BeatIndicator* beatIndicator;
     QLabel* deckALabel;
@@ -141,27 +218,195 @@ private:
     // Volume sliders (moved from deck widgets)
     QSlider* leftVolumeSlider;
     QSlider* rightVolumeSlider;
-    LibraryManager* libraryManager;
+    // Headphone cue: PFL per deck and cue/master blend (outputs 3/4)
+    QPushButton* leftCueButton{nullptr};
+    QPushButton* rightCueButton{nullptr};
+    QDial* cueMixKnob{nullptr};
+    // Microphone: on, talkover, level (dB) and EQ
+    QPushButton* micButton{nullptr};
+    QPushButton* talkoverButton{nullptr};
+    QDial* micGainKnob{nullptr};
+    QDial* micHigh{nullptr};
+    QDial* micMid{nullptr};
+    QDial* micLow{nullptr};
+    LibraryManager* libraryManager{nullptr};
+    // Batch BPM / waveform analysis of the library tracks
+    LibraryAnalyzer* libraryAnalyzer{nullptr};
+    // Warms the highlighted library tracks for an instant deck load
+    TrackPrefetcher* trackPrefetcher{nullptr};
+    // Prepares and pins a crate before a set
+    GigPrep* gigPrep{nullptr};
     juce::AudioDeviceManager deviceManager;
+    // What the preferences asked for when the device was last opened
+    AudioDeviceConfig::Request appliedAudioRequest;
+    AudioDeviceConfig::Request readAudioDeviceRequest() const;
+    // Moves the mix to the device `request` opens (nullptr: the running one, re-prepared for its
+    // current format): fade out, detach, open, prepare the players, attach and fade back in
+    AudioDeviceConfig::Result migrateAudioDevice(const AudioDeviceConfig::Request* request);
+    void prepareDecksForDevice(juce::AudioIODevice& device);
+    // Headphone cue on a second device (Audio/CueDevice, "Type: Device"; empty = none), reopened
+    // for every master device so it bridges the master's current rate and block
+    CueOutputDevice cueOutputDevice;
+    QString appliedCueDevice;
+    void openCueDevice(juce::AudioIODevice& master);
+    // Polled: fails over to the default output when the device dies, re-prepares when JUCE
+    // reopened it at another format
+    void checkAudioDevice();
+    QTimer* deviceWatchTimer{nullptr};
+    // Startup after the window is up: deck settings and audio (then interactive), then the
+    // stored library, read off the UI thread
+    bool startupStagesRun{false};
+    // Crash recovery: the session is captured every SnapshotIntervalMs and written off the UI
+    // thread; a snapshot found at startup is restored (decks parked, not playing)
+    static constexpr int SnapshotIntervalMs = 2000;
+    std::unique_ptr<SessionSnapshot> sessionSnapshot;
+    QTimer* snapshotTimer{nullptr};
+    SessionSnapshot::State lastPostedSnapshot;
+    int pendingRestores{0};         // decks still loading their saved track
+    qint64 restoreDeadlineMs{0};    // snapshots resume by then even if a load never finished
+    void startSessionSnapshots();
+    SessionSnapshot::State captureSession() const;
+    void restoreSession(const SessionSnapshot::State& state);
+    void restoreDeck(int index, const SessionSnapshot::Deck& saved);
+    // Set history: a deck's track goes to the PlayHistory journal once it has played with its
+    // fader open for PlayedThresholdSec, or half its length if that is shorter
+    static constexpr double PlayedThresholdSec = 30.0;
+    static constexpr int HistoryTickMs = 1000;
+    struct DeckPlay {
+        QString path;
+        qint64 loadedAtMs{0};
+        qint64 startedAtMs{0};   // 0 until it first played
+        double playedSec{0.0};
+        bool logged{false};
+    };
+    std::array<DeckPlay, 2> deckPlays;
+    std::unique_ptr<PlayHistory> playHistory;
+    QTimer* historyTimer{nullptr};
+    void startPlayHistory();
+    void tickPlayHistory();
+    void runStartupStages();
+    void loadStoredLibrary();
+    double preparedDeviceRate{0.0};
+    int preparedDeviceBlock{0};
+    double lastFailoverMs{0.0};
     
-    // Custom stereo audio callback instead of AudioSourcePlayer
-    std::unique_ptr<StereoAudioCallback> stereoCallback;
+    // N-channel mixer graph (decks, later samplers) used as the main device callback
+    std::unique_ptr<DeckMixer> deckMixer;
+    int mixerChannelA{-1};
+    int mixerChannelB{-1};
+    // KEYLOCK: steps stretcher quality down/up with the callback load (ticked by its own timer)
+    KeylockGovernor keylockGovernor;
+    QTimer* keylockGovernorTimer{nullptr};
+    // MIDI controllers on their own dispatch thread; the widgets follow via drainControllerEvents
+    std::unique_ptr<ControllerInput> controllerInput;
+    void drainControllerEvents();
+    // OSC control through the controller dispatch, telemetry out (Remote/Osc, Remote/OscPort,
+    // Remote/TelemetryHost, Remote/TelemetryPort, Remote/TelemetryHz)
+    std::unique_ptr<OscRemote> oscRemote;
+    std::unique_ptr<WebRemote> webRemote;
+    // Tempo/phase session with other machines on the LAN (Sync/Network: off, follow, lead)
+    std::unique_ptr<NetworkTempoSync> networkSync;
+    // MIDI beat clock from the sync master (Sync/MidiClock: output name, empty = off;
+    // Sync/MidiClockLeadMs: sent that much ahead of the audio)
+    std::unique_ptr<MidiClockOutput> midiClock;
+    // DMX to the lighting rig (Lighting/Protocol: off, artnet, sacn; Lighting/Address,
+    // Lighting/Universe, Lighting/StartChannel, Lighting/LeadMs)
+    std::unique_ptr<LightingOutput> lightingOutput;
+    // Timecode vinyl (DVS/Format, DVS/DeckA, DVS/DeckB): turntables on inputs 1/2 and 3/4 drive
+    // decks A and B; the decks stay in scratch mode for as long as they are under control
+    std::unique_ptr<TimecodeDecoder> timecodeDecoderA;
+    std::unique_ptr<TimecodeDecoder> timecodeDecoderB;
+    void startTimecodeControl(juce::AudioIODevice& device);
+    // Mic/Input, Mic/DirectMonitor and Mic/TalkoverDuckDb onto the mic and the mixer
+    void applyMicSettings();
     
     // Master output level monitoring for the menubar display
     MasterLevelMonitor masterLevelMonitor;
+    // Decimated master frames for the scope window, fed by the mixer after the meter
+    MasterScope masterScope;
+    QPointer<MasterScopeView> masterScopeView;
+    // Master output recorder, fed by the mixer after the meter
+    MasterRecorder masterRecorder;
+    MultitrackRecorder multitrackRecorder;
+    // Live stream of the master output, fed next to the recorder
+    MasterStreamer masterStreamer;
+    // 16 sample slots, pads of deck A play 1-8 and deck B 9-16
+    SamplerBank samplerBank;
+    // Library preview into the headphones, from the track list's mini waveforms; the timer moves
+    // the playhead while it plays
+    PreviewPlayer previewPlayer;
+    QTimer* previewTimer{nullptr};
+    void previewTrack(const QString& filePath, double fraction);
+    // Mic on the device input Mic/Input, mixed by the mixer
+    MicChannel micChannel;
+
+    // Recorded control log and the offline export running from it
+    MixAutomation mixAutomation;
+    std::unique_ptr<OfflineMixRenderer> mixRenderer;
+    QTimer* mixRenderTimer{nullptr};
+    // Device callback while a latency calibration runs (the mixer is detached meanwhile)
+    std::unique_ptr<LatencyCalibrator> latencyCalibrator;
+    QTimer* latencyCalibrationTimer{nullptr};
+    // Battery power profile: frame clock cap and reduced background work, audio untouched
+    static constexpr double LowPowerFrameRate = 30.0;
+    void applyPowerProfile(bool lowPower);
+    bool onBatteryPower{false};
+    bool lowPowerMode{false};
+    QString loadedTrackPathA;
+    QString loadedTrackPathB;
+    // Per-track memory of what is on each deck; changes are written for memoryPath only, so
+    // cues still showing from the previous track never reach the new one's record
+    BpmCache::Memory trackMemoryA, trackMemoryB;
+    QString memoryPathA, memoryPathB;
+    bool applyingTrackMemory{false};
+    void storeTrackMemory(bool isDeckA);
+
+    // Stems (Stems/Enabled): a deck's track is separated by a background job after its load
+    // and the result goes to the StemCache; the deck switches over to them the next time it is
+    // paused (replaceTrackInPlace), or right away if it already is. Job thread / UI thread.
+    void separateStems(bool isDeckA, const QString& filePath, const JobSystem::CancelToken& token);
+    void attachPendingStems(bool isDeckA);
+    struct PendingStems {
+        QString path;
+        StemTrackReader::StemsPtr stems;
+    };
+    PendingStems pendingStemsA, pendingStemsB;
+
+    // AutoDJ: the next track is loaded on the deck that isn't mixing out, a background job plans
+    // the transition from both tracks' analysis, the incoming deck is armed at its cue and the
+    // mixer runs the rest on the audio thread. The frame clock follows the mixer's status.
+    enum class AutoDjStage { Off, Loading, Planning, Scheduled };
+    static constexpr double AutoDjLeadSeconds = 4.0;   // earliest mix start ahead of the playhead
+    AutoDjStage autoDjStage{AutoDjStage::Off};
+    bool autoDjOutIsA{true};
+    QString autoDjNextPath;
+    QSet<QString> autoDjPlayed;
+    juce::uint32 autoDjSerial{0};
+    bool autoDjInStarted{false};
+    float autoDjShownCrossfader{0.0f};
+    // Track the last analysis result was applied for, and its BPM (0 when it failed)
+    QString beatInfoPathA, beatInfoPathB;
+    double beatInfoBpmA{0.0}, beatInfoBpmB{0.0};
+    void noteBeatInfo(bool isDeckA, double bpm);
+    void tickAutoDj();
+    QString pickAutoDjTrack() const;
+    void planAutoDjTransition();
+    void applyAutoDjPlan(juce::uint32 serial, const AutoDjPlanner::Plan& plan);
+    // Crossfader slider (and, with `toMixer`, the mixer) without counting as a hand on it
+    void showAutoDjCrossfader(float position, bool toMixer);
 
-    // PREROLL SUPPORT: Timer for automatic position updates
-    QTimer* positionUpdateTimer;
-    
     // Scratching state management to prevent timer conflicts
     qint64 lastScratchEndA{0};
     qint64 lastScratchEndB{0};
     
-    // Performance optimization: Cached format manager to avoid repeated initialization
-    static int formatManagerRefCount;
-    
-    // Thread pool optimization
-    std::unique_ptr<QThreadPool> bpmThreadPool;
+    // Deck loads and their analysis; each deck cancels its jobs when the next track comes
+    std::unique_ptr<JobSystem> jobSystem;
+    JobSystem::CancelSource deckCancelA;
+    JobSystem::CancelSource deckCancelB;
+    // Shared decode-ahead thread for all decks (outlives the players, see performCleanup)
+    std::unique_ptr<juce::TimeSliceThread> readAheadThread;
+    // Sheds cached tracks and thumbnails when the OS is short on memory
+    std::unique_ptr<MemoryPressureMonitor> memoryPressureMonitor;
     // Scratch resume state per deck
     bool scratchWasPlayingA{false};
     bool scratchWasPlayingB{false};
@@ -182,6 +427,8 @@ private:
     
 protected:
     void closeEvent(QCloseEvent* event) override;
+    // The first show starts the rest of the startup (see runStartupStages)
+    void showEvent(QShowEvent* event) override;
     void keyPressEvent(QKeyEvent* event) override;
     // Window drag functionality
     void mousePressEvent(QMouseEvent* event) override;
@@ -190,11 +437,24 @@ protected:
 
 private:
     void updateOverviewLabel(bool isDeckA);
+    // Frame clock: shows what the deck's analysis reported since the last frame
+    void applyAnalysisProgress(bool isDeckA);
+    // Deck the compatible-tracks panel follows: the sync master, else the only deck playing,
+    // else the deck loaded last
+    QtDeckWidget* getMasterDeck() const;
+    void updateCompatibleTracks();
+    QtDeckWidget* lastLoadedDeck{nullptr};
+    QString instantDoublePathA, instantDoublePathB;   // load in flight that should follow the other deck
     void performCleanup(); // Safe cleanup method
     bool cleanupCompleted{false}; // Prevent double cleanup
     
     // PREROLL SUPPORT: Update playback positions automatically
     void updatePlaybackPositions();
+    // Playback minus display latency, plus the clamped trim: how far the deck's reported
+    // position runs ahead of what is heard when the frame shows
+    double getVisualDelaySeconds(const DJAudioPlayer* player, double trimSec) const;
+    // Hands the mixer the measured output latency stored for the current device (if any)
+    void applyLatencyCalibration();
     
     // BetaPulseX Menu Setup
     // BetaPulseX: Deck Settings Management
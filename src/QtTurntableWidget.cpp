@@ -1,19 +1,28 @@
 #include "QtTurntableWidget.h"
+#include "FrameClock.h"
 #include <QPainter>
+#include <algorithm>
 #include <cmath>
 
 QtTurntableWidget::QtTurntableWidget(QWidget* parent) : QWidget(parent) {
-    connect(&timer, &QTimer::timeout, this, &QtTurntableWidget::tick);
-    timer.setInterval(16); // ~60 FPS for smooth animation
     setMinimumSize(100, 100);
 }
 
 void QtTurntableWidget::start() { 
-    timer.start(); 
+    // Animate on the shared frame clock while the deck plays
+    if (!frameConnection) {
+        frameConnection = connect(&FrameClock::instance(), &FrameClock::frame, this, &QtTurntableWidget::tick);
+        backgroundDirty = true;   // the playing ring is part of the background
+        update();
+    }
 }
 
 void QtTurntableWidget::stop() { 
-    timer.stop(); 
+    if (!frameConnection) return;
+    disconnect(frameConnection);
+    frameConnection = {};
+    backgroundDirty = true;
+    update();
 }
 
 void QtTurntableWidget::setSpeed(double ratio) { 
@@ -29,6 +38,11 @@ void QtTurntableWidget::setBpm(double newBpm) {
 void QtTurntableWidget::setPlayheadPosition(double position) {
     playheadPosition = std::clamp(position, 0.0, 1.0);
     updateRotationFromPosition();
+    // Stopped decks are off the frame clock; a seek still turns the platter once
+    if (!running() && angle != paintedAngle && isVisible()) {
+        paintedAngle = angle;
+        update();
+    }
 }
 
 void QtTurntableWidget::setTrackLength(double lengthInSeconds) {
@@ -70,39 +84,79 @@ void QtTurntableWidget::resizeEvent(QResizeEvent* event) {
 void QtTurntableWidget::tick() {
     if (!syncToBeats) {
         // Free-running mode - rotate based on speed
-        double rotationSpeed = (2.0 * M_PI / 60.0) * speed; // radians per second at 60 FPS
-        angle += rotationSpeed / 60.0;
+        double rotationSpeed = (2.0 * M_PI / 60.0) * speed; // radians per second
+        angle += rotationSpeed * FrameClock::instance().getFramePeriodMs() * 0.001;
         if (angle > 2.0 * M_PI) angle -= 2.0 * M_PI;
     }
     // In sync mode, rotation is handled by updateRotationFromPosition()
+    if (angle == paintedAngle || !isVisible()) return;
+    paintedAngle = angle;
     update();
 }
 
 void QtTurntableWidget::updateBackgroundCache() const {
-    if (!backgroundDirty) return;
+    const qreal dpr = devicePixelRatioF();
+    if (!backgroundDirty && cachedBackground.devicePixelRatio() == dpr) return;
     
     const int size = std::min(width(), height());
     if (size <= 0) return;
     
-    cachedBackground = QPixmap(size, size);
-    cachedBackground.fill(Qt::transparent);
-    
-    QPainter p(&cachedBackground);
-    p.setRenderHint(QPainter::Antialiasing, true);
-    
     const QRectF rect(0, 0, size, size);
     const QPointF center = rect.center();
     const double radius = size * 0.4;
+    auto newLayer = [&]() {
+        QPixmap layer(QSize(size, size) * dpr);
+        layer.setDevicePixelRatio(dpr);
+        layer.fill(Qt::transparent);
+        return layer;
+    };
+    
+    cachedBackground = newLayer();
+    {
+        QPainter p(&cachedBackground);
+        p.setRenderHint(QPainter::Antialiasing, true);
+        
+        // Simple dark background circle
+        QRadialGradient baseGradient(center, radius * 1.2);
+        baseGradient.setColorAt(0.0, QColor(40, 40, 45));
+        baseGradient.setColorAt(0.8, QColor(25, 25, 30));
+        baseGradient.setColorAt(1.0, QColor(15, 15, 20));
+        p.setBrush(baseGradient);
+        p.setPen(QPen(QColor(20, 20, 25), 1));
+        p.drawEllipse(center, radius * 1.2, radius * 1.2);
+        
+        // Center point (non-rotating); the ring never reaches it, so it can sit underneath
+        p.setBrush(QBrush(QColor(200, 200, 200)));
+        p.setPen(QPen(QColor(150, 150, 150), 1));
+        const double centerRadius = 4;
+        p.drawEllipse(center, centerRadius, centerRadius);
+        
+        // Status indicator - green outline while playing
+        if (running()) {
+            p.setBrush(Qt::NoBrush);
+            p.setPen(QPen(QColor(0, 255, 0, 180), 2));
+            const double indicatorRadius = radius * 1.1;
+            p.drawEllipse(center, indicatorRadius, indicatorRadius);
+        }
+    }
     
-    // Simple dark background circle
-    QRadialGradient baseGradient(center, radius * 1.2);
-    baseGradient.setColorAt(0.0, QColor(40, 40, 45));
-    baseGradient.setColorAt(0.8, QColor(25, 25, 30));
-    baseGradient.setColorAt(1.0, QColor(15, 15, 20));
-    
-    p.setBrush(baseGradient);
-    p.setPen(QPen(QColor(20, 20, 25), 1));
-    p.drawEllipse(center, radius * 1.2, radius * 1.2);
+    cachedRing = newLayer();
+    {
+        QPainter p(&cachedRing);
+        p.setRenderHint(QPainter::Antialiasing, true);
+        p.translate(center);
+        
+        // Main circle outline with BEAT-SYNCHRONIZED GAP
+        p.setBrush(Qt::NoBrush);
+        p.setPen(QPen(QColor(255, 255, 255), 3)); // White circle, thick line
+        
+        // Gap should appear at "up" position (12 o'clock) on red beats
+        // Gap spans 20 degrees (10 degrees on each side of the beat position)
+        int gapSize = 20 * 16;  // 20 degrees in Qt's 16ths of a degree
+        int gapStart = (-10) * 16;  // Start 10 degrees before "up" position
+        int circleSpan = (360 - 20) * 16;  // Full circle minus the gap
+        p.drawArc(QRectF(-radius, -radius, radius * 2, radius * 2), gapStart + gapSize, circleSpan);
+    }
     
     backgroundDirty = false;
 }
@@ -110,55 +164,17 @@ void QtTurntableWidget::updateBackgroundCache() const {
 void QtTurntableWidget::paintEvent(QPaintEvent* event) {
     Q_UNUSED(event);
     
-    // Update background cache if needed
     updateBackgroundCache();
+    if (cachedBackground.isNull()) return;
     
     QPainter p(this);
-    p.setRenderHint(QPainter::Antialiasing, true);
-    
     const int size = std::min(width(), height());
     const QRectF rect((width() - size) / 2.0, (height() - size) / 2.0, size, size);
-    const QPointF center = rect.center();
-    const double radius = size * 0.4;
-    
-    // Draw cached background (non-rotating platter)
-    if (!cachedBackground.isNull()) {
-        const QRectF bgRect((width() - size) / 2.0, (height() - size) / 2.0, size, size);
-        p.drawPixmap(bgRect.toRect(), cachedBackground);
-    }
     
-    // Draw rotating circle with cutout synchronized to beats
-    p.save();
-    p.translate(center);
+    // Cached platter, then the beat ring rotated about the centre
+    p.drawPixmap(rect.topLeft(), cachedBackground);
+    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    p.translate(rect.center());
     p.rotate(angle * 180.0 / M_PI);
-    
-    // Main circle outline with BEAT-SYNCHRONIZED GAP
-    p.setBrush(Qt::NoBrush);
-    p.setPen(QPen(QColor(255, 255, 255), 3)); // White circle, thick line
-    
-    // Calculate gap position based on beat sync
-    // Gap should appear at "up" position (12 o'clock) on red beats
-    // Gap spans 20 degrees (10 degrees on each side of the beat position)
-    int gapSize = 20 * 16;  // 20 degrees in Qt's 16ths of a degree
-    int gapStart = (-10) * 16;  // Start 10 degrees before "up" position
-    int circleSpan = (360 - 20) * 16;  // Full circle minus the gap
-    
-    // Draw the circle with the beat-synchronized gap
-    p.drawArc(QRectF(-radius, -radius, radius * 2, radius * 2), gapStart + gapSize, circleSpan);
-    
-    p.restore();
-    
-    // Draw center point (non-rotating)
-    p.setBrush(QBrush(QColor(200, 200, 200)));
-    p.setPen(QPen(QColor(150, 150, 150), 1));
-    const double centerRadius = 4;
-    p.drawEllipse(center, centerRadius, centerRadius);
-    
-    // Status indicator - show when playing
-    if (timer.isActive()) {
-        p.setBrush(Qt::NoBrush);
-        p.setPen(QPen(QColor(0, 255, 0, 180), 2)); // Green outline when playing
-        const double indicatorRadius = radius * 1.1;
-        p.drawEllipse(center, indicatorRadius, indicatorRadius);
-    }
+    p.drawPixmap(QPointF(-size / 2.0, -size / 2.0), cachedRing);
 }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <QWidget>
-#include <QTimer>
+#include <QPixmap>
 
 class QtTurntableWidget : public QWidget {
     Q_OBJECT
@@ -19,17 +19,22 @@ protected:
     void resizeEvent(QResizeEvent* event) override;
 
 private:
-    QTimer timer;
+    QMetaObject::Connection frameConnection; // FrameClock, while started
     double angle{0.0};
+    double paintedAngle{-1.0};
     double speed{1.0};
     double bpm{120.0};
     double playheadPosition{0.0}; // Current position in track (0.0 to 1.0)
     double trackLengthSeconds{0.0};
     bool syncToBeats{true};
     
-    // Performance optimization: Cache rendered elements
+    // Static artwork rendered once at the device pixel ratio: the platter with its centre
+    // point (and the playing ring), and the beat ring with its gap. A frame only draws the
+    // background and the ring pixmap under a rotation.
     mutable QPixmap cachedBackground;
+    mutable QPixmap cachedRing;
     mutable bool backgroundDirty{true};
+    bool running() const { return (bool) frameConnection; }
     
     void updateBackgroundCache() const;
     void updateRotationFromPosition();
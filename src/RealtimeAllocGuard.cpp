@@ -0,0 +1,201 @@
+#include "RealtimeAllocGuard.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if DAVID_RT_CHECKS && defined(__GLIBC__)
+ #include <cerrno>
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #define REALTIME_C_HOOKS 1
+// glibc's own allocator entry points, so the hooks below reach the real allocator without dlsym
+extern "C" {
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+    void* __libc_realloc(void*, std::size_t);
+    void* __libc_memalign(std::size_t, std::size_t);
+    void __libc_free(void*);
+}
+#else
+ #define REALTIME_C_HOOKS 0
+#endif
+
+namespace {
+    thread_local int guardDepth = 0;
+    std::atomic<int> allocations{0};
+    std::atomic<int> frees{0};
+    std::atomic<int> locks{0};
+    std::atomic<bool> backtraceTaken{false};
+    char firstBacktrace[4096] = {};
+
+    enum class Kind { Allocation, Free, Lock };
+
+    // Only called with guardDepth > 0. Drops the guard while reporting so the assertion
+    // machinery and the backtrace may allocate and lock freely.
+    void report(Kind kind) noexcept
+    {
+        const int savedDepth = guardDepth;
+        guardDepth = 0;
+        switch (kind) {
+            case Kind::Allocation:
+                allocations.fetch_add(1, std::memory_order_relaxed);
+                std::fputs("[RT] heap allocation on the audio thread!\n", stderr);
+                break;
+            case Kind::Free:
+                frees.fetch_add(1, std::memory_order_relaxed);
+                std::fputs("[RT] heap free on the audio thread!\n", stderr);
+                break;
+            case Kind::Lock:
+                locks.fetch_add(1, std::memory_order_relaxed);
+                std::fputs("[RT] mutex lock on the audio thread!\n", stderr);
+                break;
+        }
+       #if DAVID_RT_CHECKS
+        if (! backtraceTaken.exchange(true)) {
+            const juce::String stack = juce::SystemStats::getStackBacktrace();
+            stack.copyToUTF8(firstBacktrace, sizeof(firstBacktrace));
+        }
+       #endif
+        jassertfalse;
+        guardDepth = savedDepth;
+    }
+}
+
+namespace RealtimeAllocGuard {
+    bool isActive() noexcept { return guardDepth > 0; }
+    int violationCount() noexcept
+    {
+        return allocations.load(std::memory_order_relaxed) + frees.load(std::memory_order_relaxed)
+             + locks.load(std::memory_order_relaxed);
+    }
+    Counts counts() noexcept
+    {
+        return { allocations.load(std::memory_order_relaxed), frees.load(std::memory_order_relaxed),
+                 locks.load(std::memory_order_relaxed) };
+    }
+    bool allocationHooksInstalled() noexcept
+    {
+       #if JUCE_DEBUG || DAVID_RT_CHECKS
+        return true;
+       #else
+        return false;
+       #endif
+    }
+    bool lockHooksInstalled() noexcept { return REALTIME_C_HOOKS != 0; }
+    const char* firstViolationBacktrace() noexcept { return backtraceTaken.load() ? firstBacktrace : ""; }
+    void enter() noexcept { ++guardDepth; }
+    void leave() noexcept { --guardDepth; }
+}
+
+#if JUCE_DEBUG || DAVID_RT_CHECKS
+// Replacement global allocation functions: only in debug and checked builds so release
+// builds keep the default allocator untouched.
+static void* rawMalloc(std::size_t size) noexcept
+{
+   #if REALTIME_C_HOOKS
+    return __libc_malloc(size);     // the malloc hook would count it a second time
+   #else
+    return std::malloc(size);
+   #endif
+}
+
+static void rawFree(void* p) noexcept
+{
+   #if REALTIME_C_HOOKS
+    __libc_free(p);
+   #else
+    std::free(p);
+   #endif
+}
+
+static void* guardedAlloc(std::size_t size)
+{
+    if (guardDepth > 0) report(Kind::Allocation);
+    if (size == 0) size = 1;
+    if (void* p = rawMalloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+static void guardedFree(void* p) noexcept
+{
+    if (p != nullptr && guardDepth > 0) report(Kind::Free);
+    rawFree(p);
+}
+
+void* operator new(std::size_t size) { return guardedAlloc(size); }
+void* operator new[](std::size_t size) { return guardedAlloc(size); }
+void operator delete(void* p) noexcept { guardedFree(p); }
+void operator delete[](void* p) noexcept { guardedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { guardedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { guardedFree(p); }
+#endif
+
+#if REALTIME_C_HOOKS
+// C allocator and mutex interposed for the whole process: defined in the executable, these win
+// over glibc's for every library too. Outside a Scope they only add a thread-local check.
+extern "C" {
+    void* malloc(std::size_t size)
+    {
+        if (guardDepth > 0) report(Kind::Allocation);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size)
+    {
+        if (guardDepth > 0) report(Kind::Allocation);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, std::size_t size)
+    {
+        if (guardDepth > 0) report(p != nullptr && size == 0 ? Kind::Free : Kind::Allocation);
+        return __libc_realloc(p, size);
+    }
+
+    void free(void* p)
+    {
+        if (p != nullptr && guardDepth > 0) report(Kind::Free);
+        __libc_free(p);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size)
+    {
+        if (guardDepth > 0) report(Kind::Allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* memalign(std::size_t alignment, std::size_t size)
+    {
+        if (guardDepth > 0) report(Kind::Allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** out, std::size_t alignment, std::size_t size)
+    {
+        if (guardDepth > 0) report(Kind::Allocation);
+        if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+        void* p = __libc_memalign(alignment, size);
+        if (p == nullptr) return ENOMEM;
+        *out = p;
+        return 0;
+    }
+
+    // Blocking waits only; trylock never sleeps and spin-then-try patterns stay legal
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        // Looked up on first use without a static guard: the guard itself may take a mutex.
+        // glibc's dlsym locks internally, never through this symbol.
+        using Lock = int (*)(pthread_mutex_t*);
+        static std::atomic<Lock> next{nullptr};
+        Lock lock = next.load(std::memory_order_acquire);
+        if (lock == nullptr) {
+            lock = reinterpret_cast<Lock>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            next.store(lock, std::memory_order_release);
+        }
+        if (guardDepth > 0) report(Kind::Lock);
+        return lock(mutex);
+    }
+}
+#endif
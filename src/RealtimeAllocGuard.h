@@ -0,0 +1,49 @@
+#pragma once
+
+/**
+ * Detector for heap allocations, frees and blocking locks on the audio thread.
+ *
+ * Wrap a real-time section in an RealtimeAllocGuard::Scope. In debug builds the global
+ * operator new/delete are replaced (see RealtimeAllocGuard.cpp) and assert whenever they are
+ * called while a scope is active on the current thread; objects the audio thread lets go of
+ * belong in the RealtimeReclaimer. In release builds everything compiles away to nothing.
+ *
+ * A checked build (-DDAVID_RT_CHECKS=ON) keeps the operator new/delete replacement in any
+ * build type and, on glibc, also interposes malloc/calloc/realloc/free, the aligned
+ * allocators and pthread_mutex_lock, so C allocations inside JUCE or a codec and every
+ * std::mutex / CriticalSection wait are caught too. DavidBench --rt-check drives the engine
+ * through every playback mode under such a build and fails on the first count above zero.
+ */
+namespace RealtimeAllocGuard {
+
+    // True while the calling thread is inside a Scope
+    bool isActive() noexcept;
+
+    // Number of allocations and frees caught inside scopes since startup (debug builds only)
+    int violationCount() noexcept;
+
+    // What was caught, by kind; locks only in a checked build
+    struct Counts {
+        int allocations{0};
+        int frees{0};
+        int locks{0};
+    };
+    Counts counts() noexcept;
+
+    // Whether this build catches anything at all, and whether C allocations and locks too
+    bool allocationHooksInstalled() noexcept;
+    bool lockHooksInstalled() noexcept;
+
+    // Stack of the first violation since startup (empty if none, or not a checked build)
+    const char* firstViolationBacktrace() noexcept;
+
+    void enter() noexcept;
+    void leave() noexcept;
+
+    struct Scope {
+        Scope() noexcept { enter(); }
+        ~Scope() { leave(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+}
@@ -0,0 +1,135 @@
+#include "RealtimeReclaimer.h"
+#include "ThreadingPolicy.h"
+
+namespace {
+    constexpr int CollectIntervalMs = 50;
+    thread_local int readerDepth = 0;
+}
+
+// The calling thread's pin slot, given back when the thread exits
+struct ReaderSlot {
+    int index = -2;     // -2: not claimed yet, -1: none free
+
+    int get() noexcept {
+        if (index == -2) index = RealtimeReclaimer::getInstance().claimReaderSlot();
+        return index;
+    }
+    ~ReaderSlot() {
+        if (index >= 0) RealtimeReclaimer::getInstance().releaseReaderSlot(index);
+    }
+};
+
+namespace {
+    thread_local ReaderSlot readerSlot;
+}
+
+RealtimeReclaimer& RealtimeReclaimer::getInstance()
+{
+    static RealtimeReclaimer instance;
+    return instance;
+}
+
+RealtimeReclaimer::RealtimeReclaimer()
+    : juce::Thread("Realtime Reclaimer")
+{
+    for (auto& p : pinned) p.store(0);
+    for (auto& t : slotTaken) t.store(false);
+    startThread(juce::Thread::Priority::background);
+}
+
+RealtimeReclaimer::~RealtimeReclaimer()
+{
+    stopThread(2000);
+    // Process exit: no callback runs any more
+    std::lock_guard<std::mutex> guard(listLock);
+    retired.clear();
+}
+
+int RealtimeReclaimer::claimReaderSlot() noexcept
+{
+    for (int i = 0; i < MaxReaderThreads; ++i) {
+        bool expected = false;
+        if (slotTaken[(size_t) i].compare_exchange_strong(expected, true)) return i;
+    }
+    return -1;
+}
+
+void RealtimeReclaimer::releaseReaderSlot(int slot) noexcept
+{
+    pinned[(size_t) slot].store(0);
+    slotTaken[(size_t) slot].store(false);
+}
+
+RealtimeReclaimer::ReadScope::ReadScope() noexcept
+{
+    if (readerDepth++ > 0) return;
+    auto& self = getInstance();
+    const int slot = readerSlot.get();
+    // seq_cst: a retire() that has not seen this pin has unpublished its object before the
+    // callback reads the pointer
+    if (slot < 0) self.unslottedReaders.fetch_add(1);
+    else self.pinned[(size_t) slot].store(self.epoch.load());
+}
+
+RealtimeReclaimer::ReadScope::~ReadScope()
+{
+    if (--readerDepth > 0) return;
+    auto& self = getInstance();
+    const int slot = readerSlot.get();
+    if (slot < 0) self.unslottedReaders.fetch_sub(1, std::memory_order_release);
+    else self.pinned[(size_t) slot].store(0, std::memory_order_release);
+}
+
+void RealtimeReclaimer::retireHolder(std::unique_ptr<Garbage> garbage)
+{
+    // The object was unpublished before this; callbacks starting from here on can't see it
+    const juce::uint64 retiredEpoch = epoch.fetch_add(1);
+    std::lock_guard<std::mutex> guard(listLock);
+    retired.push_back({ std::move(garbage), retiredEpoch });
+}
+
+bool RealtimeReclaimer::isReclaimable(juce::uint64 retiredEpoch) const noexcept
+{
+    if (unslottedReaders.load() > 0) return false;
+    for (const auto& p : pinned) {
+        const juce::uint64 v = p.load();
+        if (v != 0 && v <= retiredEpoch) return false;
+    }
+    return true;
+}
+
+bool RealtimeReclaimer::collect()
+{
+    std::lock_guard<std::mutex> destroying(destroyLock);
+    std::vector<std::unique_ptr<Garbage>> due;
+    bool drained = false;
+    {
+        std::lock_guard<std::mutex> guard(listLock);
+        for (auto it = retired.begin(); it != retired.end(); ) {
+            if (isReclaimable(it->epoch)) {
+                due.push_back(std::move(it->garbage));
+                it = retired.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        drained = retired.empty();
+    }
+    due.clear();   // destructors run here, outside the list lock
+    return drained;
+}
+
+void RealtimeReclaimer::flush()
+{
+    // A callback in flight finishes within a block, so this waits a few milliseconds at most
+    while (!collect()) sleep(1);
+}
+
+void RealtimeReclaimer::run()
+{
+    while (!threadShouldExit()) {
+        ThreadingPolicy::getInstance().applyToWorkerThread();
+        collect();
+        wait(CollectIntervalMs);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Deferred destruction for objects the audio thread may still be reading.
+ *
+ * Whoever swaps such an object out (beat grid, stretcher, a deck's playback chain) hands the old
+ * one to retire() instead of destroying it, and never lets the audio thread drop the last
+ * reference. Every audio callback runs inside a ReadScope, which pins the epoch it started in;
+ * each retire() advances the epoch, and a retired object is destroyed once no callback that was
+ * already running at that point is still inside its scope. Destruction happens on the
+ * reclaimer's own low-priority thread, so neither the callback nor the UI pays for closing
+ * files or freeing large buffers.
+ *
+ * The epoch only covers what a callback picks up and lets go of within the same block. An
+ * object the audio thread keeps across blocks (the deck's current track) is retired by its owner
+ * only after the audio thread has reported that it moved on.
+ */
+class RealtimeReclaimer : private juce::Thread {
+public:
+    // Distinct threads that may be inside a ReadScope at the same time (device callback,
+    // offline render, ...)
+    static constexpr int MaxReaderThreads = 16;
+
+    static RealtimeReclaimer& getInstance();
+
+    // Audio side: wrap each callback; nested scopes on one thread pin only once. Never blocks
+    // or allocates.
+    class ReadScope {
+    public:
+        ReadScope() noexcept;
+        ~ReadScope();
+        ReadScope(const ReadScope&) = delete;
+        ReadScope& operator=(const ReadScope&) = delete;
+    };
+
+    // Any thread except inside a ReadScope
+    template <typename T>
+    void retire(std::unique_ptr<T> object) {
+        if (object) retireHolder(std::make_unique<Holder<std::unique_ptr<T>>>(std::move(object)));
+    }
+    template <typename T>
+    void retire(std::shared_ptr<T> object) {
+        if (object) retireHolder(std::make_unique<Holder<std::shared_ptr<T>>>(std::move(object)));
+    }
+
+    // Blocks until everything retired so far is destroyed; for owners about to tear down
+    // something the retired objects still refer to (e.g. the read-ahead thread)
+    void flush();
+
+private:
+    RealtimeReclaimer();
+    ~RealtimeReclaimer() override;
+
+    struct Garbage {
+        virtual ~Garbage() = default;
+    };
+    template <typename Pointer>
+    struct Holder : Garbage {
+        explicit Holder(Pointer p) : object(std::move(p)) {}
+        Pointer object;
+    };
+    struct Retired {
+        std::unique_ptr<Garbage> garbage;
+        juce::uint64 epoch;     // destroyed once no reader is pinned at or before this
+    };
+
+    void retireHolder(std::unique_ptr<Garbage> garbage);
+    // Destroys what is due on the calling thread; true if nothing is left waiting
+    bool collect();
+    bool isReclaimable(juce::uint64 retiredEpoch) const noexcept;
+    void run() override;
+
+    friend struct ReaderSlot;
+    // -1 if every slot is taken
+    int claimReaderSlot() noexcept;
+    void releaseReaderSlot(int slot) noexcept;
+
+    std::atomic<juce::uint64> epoch{1};
+    // Epoch each reader thread's current callback started in; 0 = not in a callback. A slot
+    // belongs to one thread from its first callback until it exits.
+    std::array<std::atomic<juce::uint64>, MaxReaderThreads> pinned{};
+    std::array<std::atomic<bool>, MaxReaderThreads> slotTaken{};
+    // Callbacks of threads that found no free slot; while any runs nothing is reclaimed
+    std::atomic<int> unslottedReaders{0};
+
+    std::mutex listLock;
+    std::vector<Retired> retired;
+    // Held while a batch is destroyed, so flush() can wait for one in progress
+    std::mutex destroyLock;
+};
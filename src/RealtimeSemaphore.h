@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+/**
+ * Minimal counting semaphore for waking audio worker threads.
+ *
+ * post() never blocks: on Linux it is a single atomic increment plus a futex wake when a waiter
+ * is parked, so it is safe to call from the audio callback. wait() spins briefly before
+ * sleeping in the kernel, which keeps the wake-up latency low for sub-millisecond jobs.
+ * Other platforms fall back to a mutex/condition variable.
+ */
+class RealtimeSemaphore {
+public:
+    void post() noexcept {
+#if defined(__linux__)
+        // seq_cst on both sides: the waiter increments `waiters` before re-checking `count`
+        count.fetch_add(1);
+        if (waiters.load() > 0)
+            futex(FUTEX_WAKE_PRIVATE, 1);
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            count.fetch_add(1, std::memory_order_release);
+        }
+        cv.notify_one();
+#endif
+    }
+
+    void wait() noexcept {
+        // Short spin first: the job we are waiting for is usually a fraction of a buffer away
+        for (int spin = 0; spin < 256; ++spin) {
+            if (tryAcquire()) return;
+        }
+#if defined(__linux__)
+        waiters.fetch_add(1);
+        while (!tryAcquire()) {
+            futex(FUTEX_WAIT_PRIVATE, 0);
+        }
+        waiters.fetch_sub(1);
+#else
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return tryAcquire(); });
+#endif
+    }
+
+    bool tryAcquire() noexcept {
+        int c = count.load(std::memory_order_acquire);
+        while (c > 0) {
+            if (count.compare_exchange_weak(c, c - 1, std::memory_order_acq_rel))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    std::atomic<int> count{0};
+
+#if defined(__linux__)
+    std::atomic<int> waiters{0};
+
+    void futex(int op, int value) noexcept {
+        // Sleeps only while count still equals `value` (0), so a concurrent post() cannot be lost
+        syscall(SYS_futex, reinterpret_cast<int*>(&count), op, value, nullptr, nullptr, 0);
+    }
+#else
+    std::mutex mutex;
+    std::condition_variable cv;
+#endif
+};
@@ -0,0 +1,185 @@
+#include "RtTrace.h"
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    constexpr int MaxRings = 16;
+    constexpr juce::uint32 RingCapacity = 512;   // power of two
+
+    struct Record {
+        juce::int64 ticks;
+        const char* format;
+        double args[RtTrace::MaxArgs];
+        juce::uint8 numArgs;
+        juce::uint8 level;
+    };
+
+    enum RingState { Free = 0, Owned, Released };
+
+    struct Ring {
+        std::atomic<int> state{Free};
+        std::atomic<juce::uint32> head{0};      // written by the owning thread
+        std::atomic<juce::uint32> tail{0};      // written by the drain thread
+        std::atomic<juce::uint32> dropped{0};
+        juce::uint32 droppedReported{0};        // drain thread only
+        int threadNumber{0};                    // shown in the output, set when claimed
+        std::array<Record, RingCapacity> records;
+    };
+
+    class Hub : private juce::Thread {
+    public:
+        Hub() : juce::Thread("RtTrace drain"), startTicks(juce::Time::getHighResolutionTicks()) {}
+        ~Hub() override { stopDraining(); }
+
+        Ring* claim() noexcept
+        {
+            for (auto& ring : rings) {
+                int expected = Free;
+                if (ring.state.compare_exchange_strong(expected, Owned, std::memory_order_acquire)) {
+                    ring.threadNumber = nextThreadNumber.fetch_add(1, std::memory_order_relaxed) + 1;
+                    return &ring;
+                }
+            }
+            unclaimed.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        void startDraining() { startThread(juce::Thread::Priority::low); }
+
+        void stopDraining()
+        {
+            stopThread(1000);
+            drainAll();
+        }
+
+    private:
+        void run() override
+        {
+            while (!threadShouldExit()) {
+                wait(20);
+                drainAll();
+            }
+        }
+
+        void drainAll()
+        {
+            const juce::ScopedLock sl(drainLock);
+            for (auto& ring : rings) {
+                const int state = ring.state.load(std::memory_order_acquire);
+                if (state == Free) continue;
+                drain(ring);
+                // The owner is gone and everything it wrote has been printed
+                if (state == Released) {
+                    ring.head.store(0, std::memory_order_relaxed);
+                    ring.tail.store(0, std::memory_order_relaxed);
+                    ring.dropped.store(0, std::memory_order_relaxed);
+                    ring.droppedReported = 0;
+                    ring.state.store(Free, std::memory_order_release);
+                }
+            }
+            if (const int missed = unclaimed.exchange(0, std::memory_order_relaxed))
+                std::cout << "RtTrace: " << missed << " threads found no free ring, their records are lost" << std::endl;
+        }
+
+        void drain(Ring& ring)
+        {
+            const juce::uint32 head = ring.head.load(std::memory_order_acquire);
+            juce::uint32 tail = ring.tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail)
+                print(ring.threadNumber, ring.records[tail & (RingCapacity - 1)]);
+            ring.tail.store(tail, std::memory_order_release);
+
+            const juce::uint32 dropped = ring.dropped.load(std::memory_order_relaxed);
+            if (dropped != ring.droppedReported) {
+                std::cout << "RtTrace: thread " << ring.threadNumber << " dropped "
+                          << (dropped - ring.droppedReported) << " records (ring full)" << std::endl;
+                ring.droppedReported = dropped;
+            }
+        }
+
+        void print(int threadNumber, const Record& record) const
+        {
+            static const char* const levelNames[] = { "", "WARN", "INFO", "DEBUG" };
+            const double ms = juce::Time::highResolutionTicksToSeconds(record.ticks - startTicks) * 1000.0;
+            std::string text;
+            int next = 0;
+            for (const char* p = record.format; *p != '\0'; ++p) {
+                if (p[0] == '{' && p[1] == '}' && next < record.numArgs) {
+                    const double value = record.args[next++];
+                    // Whole numbers (counts, sizes, flags) print without a fraction
+                    if (std::floor(value) == value && std::abs(value) < 1.0e15) text += std::to_string((long long) value);
+                    else text += juce::String(value).toStdString();
+                    ++p;
+                } else {
+                    text += *p;
+                }
+            }
+            std::cout << "[rt " << threadNumber << " " << juce::String(ms, 1) << " ms "
+                      << levelNames[juce::jlimit(0, 3, (int) record.level)] << "] " << text << std::endl;
+        }
+
+        std::array<Ring, MaxRings> rings;
+        std::atomic<int> nextThreadNumber{0};
+        std::atomic<int> unclaimed{0};
+        juce::CriticalSection drainLock;   // the drain thread against stop()
+        const juce::int64 startTicks;
+    };
+
+    Hub& hub()
+    {
+        static Hub instance;
+        return instance;
+    }
+
+    // Gives the ring back when its thread ends; the drain thread prints what is left first
+    struct ThreadRing {
+        Ring* ring{nullptr};
+        bool attached{false};
+        ~ThreadRing()
+        {
+            if (ring != nullptr) ring->state.store(Released, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadRing threadRing;
+
+    Ring* currentRing() noexcept
+    {
+        auto& local = threadRing;
+        if (!local.attached) {
+            local.attached = true;
+            local.ring = hub().claim();
+        }
+        return local.ring;
+    }
+}
+
+namespace RtTrace {
+
+    void start() { hub().startDraining(); }
+
+    void stop() { hub().stopDraining(); }
+
+    void attachCurrentThread() noexcept { currentRing(); }
+
+    void write(Level level, const char* format, const double* args, int numArgs) noexcept
+    {
+        Ring* ring = currentRing();
+        if (ring == nullptr) return;
+
+        const juce::uint32 head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) >= RingCapacity) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record& record = ring->records[head & (RingCapacity - 1)];
+        record.ticks = juce::Time::getHighResolutionTicks();
+        record.format = format;
+        record.level = (juce::uint8) level;
+        record.numArgs = (juce::uint8) juce::jlimit(0, MaxArgs, numArgs);
+        for (int i = 0; i < record.numArgs; ++i) record.args[i] = args[i];
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <type_traits>
+
+/**
+ * Logging for the audio and render threads, which must never block on std::cout.
+ *
+ * A trace statement writes one fixed-size record (timestamp, level, format pointer and up to
+ * four numeric arguments) into a ring owned by the calling thread: single producer, single
+ * consumer, no lock, no allocation, and the record is dropped (and counted) when the ring is
+ * full. A background thread drains every ring about fifty times a second and prints there.
+ *
+ * The format must be a string literal, its "{}" placeholders are filled in by the drain thread.
+ * Levels are compile-time: statements above RT_TRACE_LEVEL expand to nothing, arguments
+ * included. Debug builds keep everything, release builds only warnings, which cost nothing
+ * until one fires. Define RT_TRACE_LEVEL (0-3) to override.
+ *
+ *     RT_TRACE_DEBUG("[KL] setTimeRatio={}", timeRatio);
+ */
+namespace RtTrace {
+
+    enum Level { Off = 0, Warning = 1, Info = 2, Debug = 3 };
+
+    static constexpr int MaxArgs = 4;
+
+    // Message thread, at startup / shutdown: the drain thread (stop() prints what is left)
+    void start();
+    void stop();
+
+    // Claims the calling thread's ring ahead of its first record. Optional, but the C++ runtime
+    // allocates once when a thread's first thread_local with a destructor is touched, so
+    // real-time threads call this at their start, outside any RealtimeAllocGuard scope.
+    void attachCurrentThread() noexcept;
+
+    void write(Level level, const char* format, const double* args, int numArgs) noexcept;
+
+    template <typename... Args>
+    void log(Level level, const char* format, Args... args) noexcept
+    {
+        static_assert(sizeof...(Args) <= MaxArgs, "RtTrace records hold at most four arguments");
+        static_assert((std::is_arithmetic_v<Args> && ...), "RtTrace arguments must be numbers");
+        const double values[MaxArgs + 1] = { static_cast<double>(args)... };
+        write(level, format, values, (int) sizeof...(Args));
+    }
+}
+
+#ifndef RT_TRACE_LEVEL
+ #if JUCE_DEBUG
+  #define RT_TRACE_LEVEL 3
+ #else
+  #define RT_TRACE_LEVEL 1
+ #endif
+#endif
+
+#if RT_TRACE_LEVEL >= 1
+ #define RT_TRACE_WARN(...) ::RtTrace::log(::RtTrace::Warning, __VA_ARGS__)
+#else
+ #define RT_TRACE_WARN(...) ((void) 0)
+#endif
+
+#if RT_TRACE_LEVEL >= 2
+ #define RT_TRACE_INFO(...) ::RtTrace::log(::RtTrace::Info, __VA_ARGS__)
+#else
+ #define RT_TRACE_INFO(...) ((void) 0)
+#endif
+
+#if RT_TRACE_LEVEL >= 3
+ #define RT_TRACE_DEBUG(...) ::RtTrace::log(::RtTrace::Debug, __VA_ARGS__)
+#else
+ #define RT_TRACE_DEBUG(...) ((void) 0)
+#endif
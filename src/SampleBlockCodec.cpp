@@ -0,0 +1,268 @@
+#include "SampleBlockCodec.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    constexpr int MaxOrder = 4;
+    constexpr int WarmupBits = 18;      // zigzagged, a side channel needs 17
+    constexpr int OrderBits = 3;
+    constexpr int RiceBits = 5;
+    constexpr int MaxRice = 24;
+    constexpr uint32_t EscapeQuotient = 31;
+    constexpr int EscapeBits = 24;      // residuals stay below 2^22, zigzagged below 2^23
+    constexpr float SampleScale = 1.0f / 32767.0f;   // the same scale as the Int16 store
+
+    enum StereoMode : uint32_t { LeftRight = 0, LeftSide, RightSide, MidSide };
+
+    uint32_t zigzag(int32_t v) { return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31); }
+    int32_t unzigzag(uint32_t u) { return (int32_t) (u >> 1) ^ -(int32_t) (u & 1u); }
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& target) : out(target) {}
+        void put(uint32_t value, int numBits) {
+            if (numBits <= 0) return;
+            acc = (acc << numBits) | (numBits == 32 ? value : value & ((1u << numBits) - 1u));
+            bits += numBits;
+            while (bits >= 8) {
+                bits -= 8;
+                out.push_back((uint8_t) (acc >> bits));
+            }
+            acc &= (1ull << bits) - 1ull;
+        }
+        void flush() { if (bits > 0) put(0, 8 - bits); }
+
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t acc{0};
+        int bits{0};
+    };
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t* bytes, size_t numBytes) noexcept : data(bytes), size(numBytes) {}
+        uint32_t get(int numBits) noexcept {
+            if (numBits <= 0) return 0;
+            refill();
+            const uint32_t v = (uint32_t) (cache >> (64 - numBits));
+            cache <<= numBits;
+            avail -= numBits;
+            return v;
+        }
+        // Ones before the next zero, which is consumed too; > EscapeQuotient means damage
+        uint32_t unary() noexcept {
+            refill();
+            const uint64_t inverted = ~cache;
+            const int ones = inverted == 0 ? 64 : __builtin_clzll(inverted);
+            if (ones > (int) EscapeQuotient) return EscapeQuotient + 1;
+            cache <<= ones + 1;
+            avail -= ones + 1;
+            return (uint32_t) ones;
+        }
+        bool overran() const noexcept { return pos * 8 - (size_t) avail > size * 8; }
+
+    private:
+        void refill() noexcept {
+            while (avail <= 56) {
+                const uint64_t byte = pos < size ? data[pos] : 0;
+                ++pos;
+                cache |= byte << (56 - avail);
+                avail += 8;
+            }
+        }
+        const uint8_t* data;
+        size_t size;
+        size_t pos{0};
+        uint64_t cache{0};
+        int avail{0};
+    };
+
+    // Residual of the fixed predictor of `order` at i (i >= order)
+    int32_t residual(const int32_t* x, int i, int order) {
+        switch (order) {
+            case 0: return x[i];
+            case 1: return x[i] - x[i - 1];
+            case 2: return x[i] - 2 * x[i - 1] + x[i - 2];
+            case 3: return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+            default: return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+        }
+    }
+
+    // Best fixed order for x and the size of its residuals (sum of magnitudes)
+    int bestOrder(const int32_t* x, int n, uint64_t& cost) {
+        uint64_t totals[MaxOrder + 1] = {};
+        for (int i = MaxOrder; i < n; ++i)
+            for (int o = 0; o <= MaxOrder; ++o)
+                totals[o] += (uint64_t) std::abs(residual(x, i, o));
+        int best = 0;
+        for (int o = 1; o <= std::min(MaxOrder, n - 1); ++o)
+            if (totals[o] < totals[best]) best = o;
+        cost = totals[best];
+        return best;
+    }
+
+    int riceCost(const uint32_t* u, int n, int k) {
+        int total = 0;
+        for (int i = 0; i < n; ++i) {
+            const uint32_t q = u[i] >> k;
+            total += q < EscapeQuotient ? (int) q + 1 + k : (int) EscapeQuotient + 1 + EscapeBits;
+        }
+        return total;
+    }
+
+    void encodeChannel(BitWriter& w, const int32_t* x, int n, int order) {
+        order = std::min(order, n);
+        w.put((uint32_t) order, OrderBits);
+        for (int i = 0; i < order; ++i) w.put(zigzag(x[i]), WarmupBits);
+
+        uint32_t u[SampleBlockCodec::PartitionSize];
+        for (int start = 0; start < n; start += SampleBlockCodec::PartitionSize) {
+            const int first = std::max(start, order);
+            const int end = std::min(n, start + SampleBlockCodec::PartitionSize);
+            if (first >= end) continue;
+            const int count = end - first;
+            uint64_t sum = 0;
+            for (int i = 0; i < count; ++i) {
+                u[i] = zigzag(residual(x, first + i, order));
+                sum += u[i];
+            }
+            // Start from the mean's magnitude and look one step either side
+            int k = 0;
+            while (k < MaxRice && ((uint64_t) count << (k + 1)) <= sum) ++k;
+            int bestK = k, bestBits = riceCost(u, count, k);
+            for (int c : { k - 1, k + 1 }) {
+                if (c < 0 || c > MaxRice) continue;
+                const int bits = riceCost(u, count, c);
+                if (bits < bestBits) { bestBits = bits; bestK = c; }
+            }
+            w.put((uint32_t) bestK, RiceBits);
+            for (int i = 0; i < count; ++i) {
+                const uint32_t q = u[i] >> bestK;
+                if (q < EscapeQuotient) {
+                    w.put(((1u << q) - 1u) << 1, (int) q + 1);
+                    w.put(u[i], bestK);
+                } else {
+                    w.put(0xFFFFFFFEu, (int) EscapeQuotient + 1);
+                    w.put(u[i], EscapeBits);
+                }
+            }
+        }
+    }
+
+    bool decodeChannel(BitReader& r, int32_t* x, int n) noexcept {
+        const int order = (int) r.get(OrderBits);
+        if (order > MaxOrder || order > n) return false;
+        for (int i = 0; i < order; ++i) x[i] = unzigzag(r.get(WarmupBits));
+
+        for (int start = 0; start < n; start += SampleBlockCodec::PartitionSize) {
+            const int first = std::max(start, order);
+            const int end = std::min(n, start + SampleBlockCodec::PartitionSize);
+            if (first >= end) continue;
+            const int k = (int) r.get(RiceBits);
+            if (k > MaxRice) return false;
+            for (int i = first; i < end; ++i) {
+                const uint32_t q = r.unary();
+                uint32_t u;
+                if (q < EscapeQuotient) u = (q << k) | r.get(k);
+                else if (q == EscapeQuotient) u = r.get(EscapeBits);
+                else return false;
+                const int32_t e = unzigzag(u);
+                switch (order) {
+                    case 0: x[i] = e; break;
+                    case 1: x[i] = e + x[i - 1]; break;
+                    case 2: x[i] = e + 2 * x[i - 1] - x[i - 2]; break;
+                    case 3: x[i] = e + 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3]; break;
+                    default: x[i] = e + 4 * x[i - 1] - 6 * x[i - 2] + 4 * x[i - 3] - x[i - 4]; break;
+                }
+            }
+        }
+        return !r.overran();
+    }
+}
+
+void SampleBlockCodec::encode(const int16_t* const* channels, int numChannels, int numFrames, std::vector<uint8_t>& out)
+{
+    numChannels = std::clamp(numChannels, 1, MaxChannels);
+    numFrames = std::clamp(numFrames, 0, BlockFrames);
+    BitWriter w(out);
+
+    static thread_local std::vector<int32_t> work;
+    work.resize((size_t) BlockFrames * 4);
+    int32_t* left = work.data();
+    int32_t* right = left + BlockFrames;
+    int32_t* mid = right + BlockFrames;
+    int32_t* side = mid + BlockFrames;
+
+    for (int i = 0; i < numFrames; ++i) left[i] = channels[0][i];
+    if (numChannels == 1) {
+        uint64_t cost = 0;
+        encodeChannel(w, left, numFrames, bestOrder(left, numFrames, cost));
+        w.flush();
+        return;
+    }
+
+    for (int i = 0; i < numFrames; ++i) {
+        right[i] = channels[1][i];
+        mid[i] = (left[i] + right[i]) >> 1;
+        side[i] = left[i] - right[i];
+    }
+    uint64_t cl = 0, cr = 0, cm = 0, cs = 0;
+    const int ol = bestOrder(left, numFrames, cl);
+    const int orr = bestOrder(right, numFrames, cr);
+    const int om = bestOrder(mid, numFrames, cm);
+    const int os = bestOrder(side, numFrames, cs);
+
+    StereoMode mode = LeftRight;
+    uint64_t best = cl + cr;
+    if (cl + cs < best) { best = cl + cs; mode = LeftSide; }
+    if (cr + cs < best) { best = cr + cs; mode = RightSide; }
+    if (cm + cs < best) { mode = MidSide; }
+
+    w.put(mode, 2);
+    switch (mode) {
+        case LeftRight: encodeChannel(w, left, numFrames, ol); encodeChannel(w, right, numFrames, orr); break;
+        case LeftSide:  encodeChannel(w, left, numFrames, ol); encodeChannel(w, side, numFrames, os); break;
+        case RightSide: encodeChannel(w, right, numFrames, orr); encodeChannel(w, side, numFrames, os); break;
+        case MidSide:   encodeChannel(w, mid, numFrames, om); encodeChannel(w, side, numFrames, os); break;
+    }
+    w.flush();
+}
+
+bool SampleBlockCodec::decode(const uint8_t* data, size_t size, int numChannels, int numFrames,
+                              float* const* channels, int32_t* scratch) noexcept
+{
+    numChannels = std::clamp(numChannels, 1, MaxChannels);
+    if (numFrames < 0 || numFrames > BlockFrames) return false;
+    BitReader r(data, size);
+    int32_t* a = scratch;
+    int32_t* b = scratch + BlockFrames;
+
+    if (numChannels == 1) {
+        if (!decodeChannel(r, a, numFrames)) return false;
+        for (int i = 0; i < numFrames; ++i) channels[0][i] = (float) a[i] * SampleScale;
+        return true;
+    }
+
+    const auto mode = (StereoMode) r.get(2);
+    if (!decodeChannel(r, a, numFrames) || !decodeChannel(r, b, numFrames)) return false;
+    float* left = channels[0];
+    float* right = channels[1];
+    for (int i = 0; i < numFrames; ++i) {
+        int32_t l, rr;
+        switch (mode) {
+            case LeftRight: l = a[i]; rr = b[i]; break;
+            case LeftSide:  l = a[i]; rr = a[i] - b[i]; break;
+            case RightSide: rr = a[i]; l = a[i] + b[i]; break;
+            default: {
+                const int32_t m = (int32_t) ((uint32_t) a[i] << 1) | (b[i] & 1);
+                l = (m + b[i]) >> 1;
+                rr = (m - b[i]) >> 1;
+                break;
+            }
+        }
+        left[i] = (float) l * SampleScale;
+        right[i] = (float) rr * SampleScale;
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Lossless codec for blocks of 16-bit PCM, the storage of InMemoryTrackReader's Compressed format.
+ *
+ * Every block stands alone, so a reader can decode any one of them for a seek. The scheme is
+ * FLAC's "fixed" subset: per block the stereo pair is coded as left/right, left/side,
+ * right/side or mid/side, whichever predicts best. Each channel then gets the fixed polynomial
+ * predictor (order 0..4) with the smallest residual. The residuals are Rice coded in
+ * partitions of PartitionSize with a parameter per partition, and an escape for the odd
+ * outlier. Typical music comes out at 55-75 % of the 16-bit size. Decoding is a table-free bit
+ * reader, a few tens of microseconds per block, and runs on the audio thread.
+ */
+class SampleBlockCodec {
+public:
+    static constexpr int BlockFrames = 4096;
+    static constexpr int MaxChannels = 2;
+    static constexpr int PartitionSize = 256;
+
+    // Appends one block of numFrames (<= BlockFrames) per channel to `out`
+    static void encode(const int16_t* const* channels, int numChannels, int numFrames, std::vector<uint8_t>& out);
+
+    // Decodes a block encode() wrote (same channel and frame counts) into `channels` as floats
+    // in -1..1; `scratch` holds MaxChannels * BlockFrames ints. False if the data is damaged.
+    static bool decode(const uint8_t* data, size_t size, int numChannels, int numFrames,
+                       float* const* channels, int32_t* scratch) noexcept;
+};
@@ -0,0 +1,337 @@
+#include "SamplerBank.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+std::shared_ptr<const SamplerBank::SampleData> SamplerBank::decode(const juce::File& file)
+{
+    const juce::String key = file.getFullPathName();
+    auto cached = decodeCache.find(key);
+    if (cached != decodeCache.end()) {
+        if (auto shared = cached->second.lock())
+            return shared;
+    }
+
+    if (formatManager == nullptr) return nullptr;
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager->createReaderFor(file));
+    if (reader == nullptr) {
+        std::cout << "SamplerBank: cannot read " << key.toStdString() << std::endl;
+        return nullptr;
+    }
+
+    const auto maxLength = (juce::int64) (MaxSampleSeconds * reader->sampleRate);
+    const int length = (int) std::min(reader->lengthInSamples, maxLength);
+    if (length <= 0) return nullptr;
+    if (reader->lengthInSamples > maxLength)
+        std::cout << "SamplerBank: " << file.getFileName().toStdString() << " cut to " << MaxSampleSeconds << " s" << std::endl;
+
+    auto data = std::make_shared<SampleData>();
+    data->audio.setSize(2, length);
+    reader->read(&data->audio, 0, length, 0, true, true);
+    if (reader->numChannels == 1)
+        data->audio.copyFrom(1, 0, data->audio, 0, 0, length);
+    data->sampleRate = reader->sampleRate;
+    data->path = key;
+
+    std::shared_ptr<const SampleData> shared = std::move(data);
+    decodeCache[key] = shared;
+    return shared;
+}
+
+bool SamplerBank::post(const Message& message)
+{
+    if (!messages.push(message)) {
+        std::cout << "SamplerBank: message queue full, dropping message " << (int) message.type << std::endl;
+        return false;
+    }
+    ++postedMessages;
+    return true;
+}
+
+bool SamplerBank::loadSample(int slot, const juce::File& file)
+{
+    if (slot < 0 || slot >= NumSlots) return false;
+    auto data = decode(file);
+    if (data == nullptr) return false;
+
+    Message m;
+    m.type = Message::Type::SetSample;
+    m.slot = slot;
+    m.data = data.get();
+    if (!post(m)) return false;
+
+    if (slotData[(size_t) slot] != nullptr)
+        retired.push_back({ std::move(slotData[(size_t) slot]), postedMessages });
+    slotData[(size_t) slot] = std::move(data);
+    collectGarbage();
+    return true;
+}
+
+void SamplerBank::clearSlot(int slot)
+{
+    if (slot < 0 || slot >= NumSlots || slotData[(size_t) slot] == nullptr) return;
+    Message m;
+    m.type = Message::Type::SetSample;
+    m.slot = slot;
+    if (!post(m)) return;
+    retired.push_back({ std::move(slotData[(size_t) slot]), postedMessages });
+    slotData[(size_t) slot] = nullptr;
+    collectGarbage();
+}
+
+void SamplerBank::collectGarbage()
+{
+    const juce::uint64 applied = appliedMessages.load(std::memory_order_acquire);
+    retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                 [applied](const Retired& r) { return r.serial <= applied; }),
+                  retired.end());
+    for (auto it = decodeCache.begin(); it != decodeCache.end(); ) {
+        if (it->second.expired()) it = decodeCache.erase(it);
+        else ++it;
+    }
+}
+
+void SamplerBank::setPlayMode(int slot, PlayMode mode)
+{
+    if (slot < 0 || slot >= NumSlots) return;
+    slotModes[(size_t) slot] = mode;
+    Message m;
+    m.type = Message::Type::SetMode;
+    m.slot = slot;
+    m.value = mode == PlayMode::Loop ? 1.0f : 0.0f;
+    post(m);
+}
+
+SamplerBank::PlayMode SamplerBank::getPlayMode(int slot) const
+{
+    return slot >= 0 && slot < NumSlots ? slotModes[(size_t) slot] : PlayMode::OneShot;
+}
+
+void SamplerBank::setSlotGain(int slot, float gain)
+{
+    if (slot < 0 || slot >= NumSlots) return;
+    Message m;
+    m.type = Message::Type::SetGain;
+    m.slot = slot;
+    m.value = juce::jlimit(0.0f, 2.0f, gain);
+    post(m);
+}
+
+bool SamplerBank::hasSample(int slot) const
+{
+    return slot >= 0 && slot < NumSlots && slotData[(size_t) slot] != nullptr;
+}
+
+juce::String SamplerBank::getSlotName(int slot) const
+{
+    if (!hasSample(slot)) return {};
+    return juce::File(slotData[(size_t) slot]->path).getFileNameWithoutExtension();
+}
+
+void SamplerBank::trigger(int slot, float velocity)
+{
+    if (!hasSample(slot)) return;
+    Message m;
+    m.type = Message::Type::Trigger;
+    m.slot = slot;
+    m.value = juce::jlimit(0.0f, 1.0f, velocity);
+    post(m);
+}
+
+void SamplerBank::stop(int slot)
+{
+    if (slot < 0 || slot >= NumSlots) return;
+    Message m;
+    m.type = Message::Type::Stop;
+    m.slot = slot;
+    post(m);
+}
+
+void SamplerBank::stopAll()
+{
+    Message m;
+    m.type = Message::Type::StopAll;
+    post(m);
+}
+
+bool SamplerBank::isSlotPlaying(int slot) const
+{
+    return slot >= 0 && slot < NumSlots && slotPlaying[(size_t) slot].load(std::memory_order_relaxed);
+}
+
+void SamplerBank::prepare(double sampleRate, int maximumBlockSize)
+{
+    deviceRate = sampleRate > 0.0 ? sampleRate : 44100.0;
+    maxBlock = std::max(64, maximumBlockSize);
+    fadeSamples = std::max(1, (int) (FadeSeconds * deviceRate));
+    scratch.setSize(2, maxBlock, false, true, false);
+    for (auto& v : voices) v = Voice{};
+    activeVoices = 0;
+    for (auto& playing : slotPlaying) playing.store(false, std::memory_order_relaxed);
+    playingPublished = false;
+    playStateVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SamplerBank::applyMessages() noexcept
+{
+    Message m;
+    juce::uint64 applied = 0;
+    while (messages.pop(m)) {
+        ++applied;
+        if (m.type == Message::Type::StopAll) {
+            for (int s = 0; s < NumSlots; ++s) releaseSlotVoices(s, false);
+            continue;
+        }
+        if (m.slot < 0 || m.slot >= NumSlots) continue;
+        auto& slot = audioSlots[(size_t) m.slot];
+        switch (m.type) {
+            case Message::Type::Trigger: startVoice(m.slot, m.value); break;
+            case Message::Type::Stop: releaseSlotVoices(m.slot, false); break;
+            case Message::Type::SetSample:
+                // The old buffer may be freed as soon as this message counts as applied
+                releaseSlotVoices(m.slot, true);
+                slot.data = m.data;
+                break;
+            case Message::Type::SetMode: slot.loop = m.value != 0.0f; break;
+            case Message::Type::SetGain: slot.gain = m.value; break;
+            case Message::Type::StopAll: break;
+        }
+    }
+    if (applied > 0)
+        appliedMessages.fetch_add(applied, std::memory_order_release);
+}
+
+void SamplerBank::startVoice(int slot, float velocity) noexcept
+{
+    const auto& s = audioSlots[(size_t) slot];
+    if (s.data == nullptr) return;
+
+    // A loop slot toggles: a second trigger releases the running loop
+    if (s.loop) {
+        for (const auto& v : voices) {
+            if (v.data != nullptr && v.slot == slot && v.fadeRemaining < 0) {
+                releaseSlotVoices(slot, false);
+                return;
+            }
+        }
+    }
+
+    // Free voice, or steal the oldest one
+    Voice* target = nullptr;
+    for (auto& v : voices) {
+        if (v.data == nullptr) { target = &v; break; }
+        if (target == nullptr || v.startedAt < target->startedAt) target = &v;
+    }
+    if (target->data == nullptr) ++activeVoices;
+
+    target->data = s.data;
+    target->slot = slot;
+    target->pos = 0.0;
+    target->step = s.data->sampleRate / deviceRate;
+    target->gain = s.gain * velocity;
+    target->loop = s.loop;
+    target->fadeRemaining = -1;
+    target->startedAt = ++voiceCounter;
+}
+
+void SamplerBank::releaseSlotVoices(int slot, bool immediately) noexcept
+{
+    for (auto& v : voices) {
+        if (v.data == nullptr || v.slot != slot) continue;
+        if (immediately) {
+            v.data = nullptr;
+            --activeVoices;
+        } else if (v.fadeRemaining < 0) {
+            v.fadeRemaining = fadeSamples;
+        }
+    }
+}
+
+void SamplerBank::renderVoice(Voice& v, int numSamples) noexcept
+{
+    const auto& audio = v.data->audio;
+    const int length = audio.getNumSamples();
+    const int srcChannels = audio.getNumChannels();
+    const bool direct = v.step == 1.0;
+
+    int done = 0;
+    while (done < numSamples) {
+        if (v.pos >= length) {
+            if (!v.loop || length <= 0) { v.data = nullptr; return; }
+            v.pos -= length;
+        }
+        int todo = std::min(numSamples - done, std::max(1, (int) std::ceil((length - v.pos) / v.step)));
+        float g0 = v.gain, g1 = v.gain;
+        if (v.fadeRemaining >= 0) {
+            todo = std::min(todo, v.fadeRemaining);
+            if (todo <= 0) { v.data = nullptr; return; }
+            g0 = v.gain * (float) v.fadeRemaining / (float) fadeSamples;
+            g1 = v.gain * (float) (v.fadeRemaining - todo) / (float) fadeSamples;
+        }
+
+        for (int ch = 0; ch < 2; ++ch) {
+            const float* src = audio.getReadPointer(std::min(ch, srcChannels - 1));
+            float* dst = scratch.getWritePointer(ch, done);
+            if (direct && g0 == g1) {
+                juce::FloatVectorOperations::addWithMultiply(dst, src + (int) v.pos, g0, todo);
+                continue;
+            }
+            const float gStep = (g1 - g0) / (float) todo;
+            for (int i = 0; i < todo; ++i) {
+                const double p = v.pos + i * v.step;
+                const int i0 = (int) p;
+                const float frac = (float) (p - i0);
+                const float next = i0 + 1 < length ? src[i0 + 1] : (v.loop ? src[0] : 0.0f);
+                dst[i] += (src[i0] + frac * (next - src[i0])) * (g0 + gStep * (float) i);
+            }
+        }
+
+        v.pos += todo * v.step;
+        done += todo;
+        if (v.fadeRemaining >= 0) {
+            v.fadeRemaining -= todo;
+            if (v.fadeRemaining <= 0) { v.data = nullptr; return; }
+        }
+    }
+}
+
+void SamplerBank::renderAdding(float* const* output, int numChannels, int numSamples, float gain) noexcept
+{
+    applyMessages();
+    if (activeVoices == 0 || maxBlock == 0 || numSamples <= 0) {
+        if (playingPublished) {
+            for (auto& playing : slotPlaying) playing.store(false, std::memory_order_relaxed);
+            playingPublished = false;
+            playStateVersion.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    const int outChannels = std::min(numChannels, 2);
+    for (int done = 0; done < numSamples; ) {
+        const int n = std::min(maxBlock, numSamples - done);
+        scratch.clear(0, n);
+        for (auto& v : voices) {
+            if (v.data == nullptr) continue;
+            renderVoice(v, n);
+            if (v.data == nullptr) --activeVoices;
+        }
+        for (int ch = 0; ch < outChannels; ++ch) {
+            if (output[ch] != nullptr)
+                juce::FloatVectorOperations::addWithMultiply(output[ch] + done, scratch.getReadPointer(ch), gain, n);
+        }
+        done += n;
+        if (activeVoices == 0) break;
+    }
+
+    std::array<bool, NumSlots> playing{};
+    for (const auto& v : voices)
+        if (v.data != nullptr) playing[(size_t) v.slot] = true;
+    bool changed = false;
+    for (int s = 0; s < NumSlots; ++s) {
+        changed |= slotPlaying[(size_t) s].load(std::memory_order_relaxed) != playing[(size_t) s];
+        slotPlaying[(size_t) s].store(playing[(size_t) s], std::memory_order_relaxed);
+    }
+    if (changed) playStateVersion.fetch_add(1, std::memory_order_relaxed);
+    playingPublished = true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+#include "LockFreeQueue.h"
+
+/**
+ * Bank of one-shot / loop sample slots played from a fixed voice pool, mixed by DeckMixer as
+ * its own bus.
+ *
+ * Samples are decoded once on the UI thread into immutable, reference-counted buffers; slots
+ * loading the same file share one decode. The audio thread only ever sees raw pointers handed
+ * over through an SPSC queue, and a replaced buffer is freed by collectGarbage() once the audio
+ * thread has acknowledged the swap (it stops the slot's voices when it applies it). Triggers
+ * travel the same queue, so a pad press costs one queue push and sounds from the next block.
+ *
+ * Voices at the device rate are summed with vector multiply-adds; samples at another rate are
+ * interpolated linearly. With no voice playing, rendering returns immediately.
+ */
+class SamplerBank {
+public:
+    static constexpr int NumSlots = 16;
+    static constexpr int MaxVoices = 32;
+    static constexpr double MaxSampleSeconds = 60.0;
+    static constexpr double FadeSeconds = 0.005;
+
+    enum class PlayMode { OneShot, Loop };
+
+    // Decoded audio shared between slots; never modified after loading
+    struct SampleData {
+        juce::AudioBuffer<float> audio;   // stereo (mono files are duplicated)
+        double sampleRate{44100.0};
+        juce::String path;
+    };
+
+    SamplerBank() = default;
+    ~SamplerBank() = default;
+
+    // UI thread
+    void setFormatManager(juce::AudioFormatManager* manager) { formatManager = manager; }
+    bool loadSample(int slot, const juce::File& file);
+    void clearSlot(int slot);
+    void setPlayMode(int slot, PlayMode mode);
+    PlayMode getPlayMode(int slot) const;
+    void setSlotGain(int slot, float gain);
+    bool hasSample(int slot) const;
+    juce::String getSlotName(int slot) const;
+    // One-shots start another voice on every trigger; loops toggle on and off
+    void trigger(int slot, float velocity = 1.0f);
+    void stop(int slot);
+    void stopAll();
+    // As last reported by the audio thread
+    bool isSlotPlaying(int slot) const;
+    // Moves whenever a slot starts or stops playing; the pads restyle when it changed
+    juce::uint32 getPlayStateVersion() const { return playStateVersion.load(std::memory_order_relaxed); }
+    // Free decoded buffers the audio thread no longer references
+    void collectGarbage();
+
+    // Audio thread
+    void prepare(double sampleRate, int maximumBlockSize);
+    // Adds the bank's output times gain to up to two output channels
+    void renderAdding(float* const* output, int numChannels, int numSamples, float gain) noexcept;
+
+private:
+    struct Message {
+        enum class Type { Trigger, Stop, StopAll, SetSample, SetMode, SetGain };
+        Type type{Type::Trigger};
+        int slot{0};
+        float value{0.0f};
+        const SampleData* data{nullptr};
+    };
+
+    struct Voice {
+        const SampleData* data{nullptr};
+        int slot{-1};
+        double pos{0.0};
+        double step{1.0};
+        float gain{1.0f};
+        bool loop{false};
+        int fadeRemaining{-1};   // >= 0 while fading out
+        juce::uint32 startedAt{0};
+    };
+
+    struct AudioSlot {
+        const SampleData* data{nullptr};
+        bool loop{false};
+        float gain{1.0f};
+    };
+
+    bool post(const Message& message);
+    void applyMessages() noexcept;
+    void startVoice(int slot, float velocity) noexcept;
+    void releaseSlotVoices(int slot, bool immediately) noexcept;
+    void renderVoice(Voice& voice, int numSamples) noexcept;
+    std::shared_ptr<const SampleData> decode(const juce::File& file);
+
+    juce::AudioFormatManager* formatManager{nullptr};
+
+    // UI side: ownership of every buffer a slot holds, plus the decode cache
+    std::array<std::shared_ptr<const SampleData>, NumSlots> slotData{};
+    std::array<PlayMode, NumSlots> slotModes{};
+    std::map<juce::String, std::weak_ptr<const SampleData>> decodeCache;
+    struct Retired {
+        std::shared_ptr<const SampleData> data;
+        juce::uint64 serial;
+    };
+    std::vector<Retired> retired;
+    juce::uint64 postedMessages{0};
+
+    SpscQueue<Message, 256> messages;
+    std::atomic<juce::uint64> appliedMessages{0};
+
+    // Audio side
+    std::array<AudioSlot, NumSlots> audioSlots{};
+    std::array<Voice, MaxVoices> voices{};
+    int activeVoices{0};
+    juce::uint32 voiceCounter{0};
+    double deviceRate{44100.0};
+    int maxBlock{0};
+    int fadeSamples{220};
+    juce::AudioBuffer<float> scratch;
+    std::array<std::atomic<bool>, NumSlots> slotPlaying{};
+    std::atomic<juce::uint32> playStateVersion{0};
+    bool playingPublished{false};
+};
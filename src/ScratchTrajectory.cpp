@@ -0,0 +1,127 @@
+#include "ScratchTrajectory.h"
+#include <algorithm>
+#include <cmath>
+
+bool ScratchTrajectory::push(double positionSec, juce::uint64 timeNs) noexcept
+{
+    Event e;
+    e.positionSec = positionSec;
+    e.timeNs = timeNs;
+    return queue.push(e);
+}
+
+void ScratchTrajectory::prepare(double rate) noexcept
+{
+    sampleRate = rate > 0.0 ? rate : 44100.0;
+    nsPerSample = 1.0e9 / sampleRate;
+    smoothing = 1.0 - std::exp(-2.0 * juce::MathConstants<double>::pi * SmoothingHz / sampleRate);
+}
+
+void ScratchTrajectory::start(double positionSec, juce::uint64 nowNs) noexcept
+{
+    // Touches from before the hand went down belong to the previous scratch
+    Event stale;
+    while (queue.pop(stale)) {}
+
+    points[0].positionSec = positionSec;
+    points[0].timeNs = nowNs;
+    numPoints = 1;
+    cursor = 0;
+    clockNs = (double) nowNs;
+    // The event spacing is kept from the last scratch: it is the same device most of the time
+    delayNs = juce::jlimit(MinDelayMs * 1.0e6, MaxDelayMs * 1.0e6, 1.5 * meanIntervalNs);
+    stage1 = position = positionSec;
+    velocity = 0.0;
+}
+
+void ScratchTrajectory::follow(const double* positions, int numSamples) noexcept
+{
+    if (numSamples <= 0) return;
+    Event stale;
+    while (queue.pop(stale)) {}
+    // Keep the state render() continues from in step: the record is where it was last heard
+    const double previous = numSamples > 1 ? positions[numSamples - 2] : position;
+    stage1 = position = positions[numSamples - 1];
+    velocity = (position - previous) * sampleRate;
+    clockNs += numSamples * nsPerSample;
+    points[0].positionSec = position;
+    points[0].timeNs = (juce::uint64) clockNs;
+    numPoints = 1;
+    cursor = 0;
+}
+
+void ScratchTrajectory::drainQueue() noexcept
+{
+    Event e;
+    while (queue.pop(e)) {
+        if (numPoints > 0) {
+            Event& last = points[(size_t) (numPoints - 1)];
+            const double gap = (double) e.timeNs - (double) last.timeNs;
+            // Same sample (or out of order): coalesce, the newest position wins
+            if (gap < nsPerSample) {
+                last.positionSec = e.positionSec;
+                continue;
+            }
+            if (gap < 100.0e6) meanIntervalNs += 0.1 * (gap - meanIntervalNs);
+            // After a pause the record stood still: hold until just before the new touch
+            // instead of crawling there over the whole gap
+            const double holdNs = std::min(meanIntervalNs, MaxDelayMs * 1.0e6);
+            if (gap > 2.0 * MaxDelayMs * 1.0e6 && numPoints < MaxPoints) {
+                Event hold = last;
+                hold.timeNs = e.timeNs - (juce::uint64) holdNs;
+                points[(size_t) numPoints++] = hold;
+            }
+        }
+        if (numPoints == MaxPoints) {
+            std::move(points.begin() + 1, points.end(), points.begin());
+            --numPoints;
+            cursor = std::max(0, cursor - 1);
+        }
+        points[(size_t) numPoints++] = e;
+    }
+}
+
+double ScratchTrajectory::targetAt(double timeNs) noexcept
+{
+    while (cursor + 1 < numPoints && (double) points[(size_t) (cursor + 1)].timeNs <= timeNs) ++cursor;
+    const Event& a = points[(size_t) cursor];
+    if (cursor + 1 >= numPoints || timeNs <= (double) a.timeNs) return a.positionSec;
+    const Event& b = points[(size_t) (cursor + 1)];
+    const double frac = (timeNs - (double) a.timeNs) / ((double) b.timeNs - (double) a.timeNs);
+    return a.positionSec + frac * (b.positionSec - a.positionSec);
+}
+
+void ScratchTrajectory::render(double* positions, int numSamples, juce::uint64 blockStartNs) noexcept
+{
+    if (numSamples <= 0) return;
+    drainQueue();
+    if (numPoints == 0) {
+        std::fill(positions, positions + numSamples, position);
+        velocity = 0.0;
+        return;
+    }
+    // Points behind the segment in use can't be reached any more
+    if (cursor > 0) {
+        std::move(points.begin() + cursor, points.begin() + numPoints, points.begin());
+        numPoints -= cursor;
+        cursor = 0;
+    }
+
+    // The sample count is the clock; callback jitter only nudges it, a stall resyncs it
+    const double blockStart = (double) blockStartNs;
+    if (std::abs(blockStart - clockNs) > MaxDelayMs * 1.0e6) clockNs = blockStart;
+    else clockNs += 0.05 * (blockStart - clockNs);
+    const double wantedDelay = juce::jlimit(MinDelayMs * 1.0e6, MaxDelayMs * 1.0e6, 1.5 * meanIntervalNs);
+    delayNs += 0.1 * (wantedDelay - delayNs);
+
+    double previous = position;
+    for (int i = 0; i < numSamples; ++i) {
+        const double target = targetAt(clockNs + i * nsPerSample - delayNs);
+        stage1 += smoothing * (target - stage1);
+        previous = position;
+        position += smoothing * (stage1 - position);
+        positions[i] = position;
+    }
+    velocity = (position - previous) * sampleRate;
+    clockNs += numSamples * nsPerSample;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "LockFreeQueue.h"
+
+/**
+ * Scratch input of one deck: timestamped record positions in, a per-sample playhead out.
+ *
+ * The UI (mouse drags on the waveform) or a controller thread (jog wheels, up to 1000 Hz)
+ * pushes where the record is and when, on the DeckMixer::nowNs() clock; nothing else about
+ * the audio is touched from there. The audio thread drains the queue at the top of each
+ * block and plays the input curve back a little in the past, so it interpolates between
+ * touches instead of guessing ahead: the delay follows the spacing of the events (about
+ * 1.5 intervals, 1..20 ms), a 1 kHz jog costs ~1.5 ms, a 60 Hz mouse ~25 ms at most. Two
+ * one-pole stages on top keep the velocity continuous, so per-event steps and the event
+ * loop's jitter never reach the sound. When the input stops, the record stops where it was
+ * last put, like a hand holding the platter.
+ *
+ * Events that land on the same sample are coalesced into the newest; the history only keeps
+ * the points the interpolation can still reach. No locks and no allocation on either side.
+ */
+class ScratchTrajectory {
+public:
+    struct Event {
+        double positionSec{0.0};    // track time under the needle; negative = preroll
+        juce::uint64 timeNs{0};     // DeckMixer::nowNs() when the record was there
+    };
+
+    static constexpr double MinDelayMs = 1.0;
+    static constexpr double MaxDelayMs = 20.0;
+    static constexpr double SmoothingHz = 60.0;
+
+    // Producer (one thread at a time): false if the audio thread has fallen 1024 events behind
+    bool push(double positionSec, juce::uint64 timeNs) noexcept;
+
+    // prepareToPlay
+    void prepare(double sampleRate) noexcept;
+    // Audio thread: a scratch starts with the record at positionSec; events queued before are dropped
+    void start(double positionSec, juce::uint64 nowNs) noexcept;
+    // Audio thread: track positions (seconds) for the next numSamples output samples;
+    // blockStartNs is DeckMixer::nowNs() as the block starts rendering
+    void render(double* positions, int numSamples, juce::uint64 blockStartNs) noexcept;
+    // Audio thread, instead of render(): the positions are known per sample already (timecode
+    // vinyl) and are played as they are; queued touches are dropped
+    void follow(const double* positions, int numSamples) noexcept;
+
+    // Audio thread: after the last rendered sample
+    double getPosition() const noexcept { return position; }
+    double getVelocity() const noexcept { return velocity; }   // track seconds per second
+
+private:
+    void drainQueue() noexcept;
+    double targetAt(double timeNs) noexcept;
+
+    SpscQueue<Event, 1024> queue;
+
+    // Audio thread: input curve, oldest first; points[cursor] is the segment start in use
+    static constexpr int MaxPoints = 128;
+    std::array<Event, MaxPoints> points{};
+    int numPoints{0};
+    int cursor{0};
+
+    double sampleRate{44100.0};
+    double nsPerSample{1.0e9 / 44100.0};
+    double clockNs{0.0};            // time of the next sample, advanced by the sample count
+    double delayNs{MaxDelayMs * 1.0e6};
+    double meanIntervalNs{MaxDelayMs * 1.0e6};
+    double smoothing{1.0};          // per-sample coefficient of both stages
+    double stage1{0.0};
+    double position{0.0};
+    double velocity{0.0};
+};
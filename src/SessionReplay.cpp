@@ -0,0 +1,185 @@
+#include "SessionReplay.h"
+#include "DJAudioPlayer.h"
+#include "DecoderRegistry.h"
+#include "OfflineMixRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Frame of the block boundary the event is applied at, in the replay's sample rate
+    juce::int64 eventFrame(const MixAutomation::Event& e, double recordedRate, double sampleRate)
+    {
+        if (e.frame >= 0 && recordedRate > 0.0)
+            return recordedRate == sampleRate ? e.frame : (juce::int64) std::llround((double) e.frame * sampleRate / recordedRate);
+        return (juce::int64) std::llround(e.timeSec * sampleRate);
+    }
+}
+
+SessionReplay::Report SessionReplay::run(const MixAutomation& session, const Settings& settings)
+{
+    Report report;
+    const std::vector<MixAutomation::Event> events = session.getEvents();
+    if (events.empty()) {
+        report.error = "nothing recorded";
+        return report;
+    }
+
+    const double recordedRate = session.getSampleRate();
+    report.sampleRate = settings.sampleRate > 0.0 ? settings.sampleRate : recordedRate > 0.0 ? recordedRate : 44100.0;
+    report.blockSize = juce::jlimit(16, 8192, settings.blockSize > 0 ? settings.blockSize
+                                              : session.getBlockSize() > 0 ? session.getBlockSize() : 512);
+    report.deadlineMs = 1000.0 * report.blockSize / report.sampleRate;
+
+    const juce::int64 totalFrames = eventFrame(events.back(), recordedRate, report.sampleRate);
+    if (totalFrames <= 0) {
+        report.error = "recording is empty";
+        return report;
+    }
+
+    int numDecks = 2;
+    for (const auto& e : events)
+        numDecks = std::max(numDecks, e.deck + 1);
+    report.numDecks = std::min(numDecks, DeckMixer::MaxChannels);
+
+    // Same deck layout as OfflineMixRenderer (deck 0 = A, deck 1 = B)
+    juce::AudioFormatManager& formatManager = DecoderRegistry::getInstance().getFormatManager();
+    std::vector<std::unique_ptr<DJAudioPlayer>> players;
+    auto mixer = std::make_unique<DeckMixer>();
+    for (int i = 0; i < report.numDecks; ++i) {
+        players.push_back(std::make_unique<DJAudioPlayer>(formatManager));
+        players.back()->setTimedCommands(false);   // events land on block starts here
+        players.back()->prepareToPlay(report.blockSize, report.sampleRate);
+        const auto side = i == 0 ? DeckMixer::CrossfaderSide::A
+                        : i == 1 ? DeckMixer::CrossfaderSide::B : DeckMixer::CrossfaderSide::Thru;
+        mixer->addChannel(players.back().get(), side);
+    }
+    mixer->prepareToRender(2, report.blockSize, report.sampleRate);
+    mixer->setParallelRendering(settings.parallelDecks);
+
+    std::cout << "SessionReplay: " << events.size() << " events, " << totalFrames / report.sampleRate << " s, "
+              << report.numDecks << " decks, " << report.blockSize << " samples @ " << report.sampleRate << " Hz"
+              << (recordedRate > 0.0 ? "" : " (no frame stamps, using wall clock times)") << std::endl;
+
+    juce::AudioBuffer<float> block(2, report.blockSize);
+    juce::AudioIODeviceCallbackContext context;
+    const double msPerTick = 1000.0 / (double) juce::Time::getHighResolutionTicksPerSecond();
+    const size_t numWorst = (size_t) std::max(0, settings.numWorstBlocks);
+    auto faster = [](const Block& a, const Block& b) { return a.ms > b.ms; };   // min-heap on ms
+
+    std::vector<float> blockMs;
+    blockMs.reserve((size_t) (totalFrames / report.blockSize + 1));
+    size_t nextEvent = 0;
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+
+    for (juce::int64 done = 0; done < totalFrames; ) {
+        const int n = (int) std::min<juce::int64>(report.blockSize, totalFrames - done);
+
+        // Outside the timed region: live, loads and command posts happen on other threads
+        Block b;
+        b.index = (juce::int64) blockMs.size();
+        b.frame = done;
+        b.firstEvent = (int) nextEvent;
+        while (nextEvent < events.size() && eventFrame(events[nextEvent], recordedRate, report.sampleRate) <= done) {
+            const auto& e = events[nextEvent++];
+            OfflineMixRenderer::applyEvent(e, (e.deck >= 0 && e.deck < report.numDecks) ? players[(size_t) e.deck].get() : nullptr,
+                                           *mixer);
+        }
+        b.endEvent = (int) nextEvent;
+
+        float* out[2] = { block.getWritePointer(0), block.getWritePointer(1) };
+        const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        mixer->audioDeviceIOCallbackWithContext(nullptr, 0, out, 2, n, context);
+        b.ms = (double) (juce::Time::getHighResolutionTicks() - startTicks) * msPerTick;
+        blockMs.push_back((float) b.ms);
+
+        if (b.ms > report.deadlineMs * n / report.blockSize) ++report.overruns;
+        if (numWorst > 0 && (report.worstBlocks.size() < numWorst || b.ms > report.worstBlocks.front().ms)) {
+            for (int i = 0; i < report.numDecks; ++i)
+                b.deckMs[(size_t) i] = mixer->getChannelRenderMs(i);
+            if (report.worstBlocks.size() == numWorst) {
+                std::pop_heap(report.worstBlocks.begin(), report.worstBlocks.end(), faster);
+                report.worstBlocks.pop_back();
+            }
+            report.worstBlocks.push_back(b);
+            std::push_heap(report.worstBlocks.begin(), report.worstBlocks.end(), faster);
+        }
+        done += n;
+    }
+
+    report.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+    mixer.reset();       // stops the render workers before the players go
+    players.clear();
+
+    report.numBlocks = (juce::int64) blockMs.size();
+    double sum = 0.0;
+    for (float ms : blockMs) sum += ms;
+    report.meanMs = sum / (double) blockMs.size();
+    auto percentile = [&blockMs](double p) {
+        auto nth = blockMs.begin() + (std::ptrdiff_t) std::min(blockMs.size() - 1, (size_t) (p * (double) blockMs.size()));
+        std::nth_element(blockMs.begin(), nth, blockMs.end());
+        return (double) *nth;
+    };
+    report.medianMs = percentile(0.5);
+    report.p99Ms = percentile(0.99);
+    report.maxMs = *std::max_element(blockMs.begin(), blockMs.end());
+    std::sort_heap(report.worstBlocks.begin(), report.worstBlocks.end(), faster);
+
+    std::cout << "SessionReplay: " << report.numBlocks << " blocks in " << report.renderSeconds << " s, median "
+              << report.medianMs << " ms, p99 " << report.p99Ms << " ms, max " << report.maxMs << " ms, "
+              << report.overruns << " over the " << report.deadlineMs << " ms deadline" << std::endl;
+    return report;
+}
+
+bool SessionReplay::writeReport(const Report& report, const MixAutomation& session, const juce::File& file)
+{
+    const std::vector<MixAutomation::Event> events = session.getEvents();
+
+    juce::Array<juce::var> worst;
+    for (const auto& b : report.worstBlocks) {
+        auto* block = new juce::DynamicObject();
+        block->setProperty("block", b.index);
+        block->setProperty("frame", b.frame);
+        block->setProperty("timeSec", (double) b.frame / report.sampleRate);
+        block->setProperty("ms", b.ms);
+        block->setProperty("deadlineLoad", b.ms / report.deadlineMs);
+
+        juce::Array<juce::var> decks;
+        for (int i = 0; i < report.numDecks; ++i)
+            decks.add((double) b.deckMs[(size_t) i]);
+        block->setProperty("deckMs", decks);
+
+        juce::Array<juce::var> applied;
+        for (int i = b.firstEvent; i < b.endEvent && i < (int) events.size(); ++i) {
+            const auto& e = events[(size_t) i];
+            auto* event = new juce::DynamicObject();
+            event->setProperty("index", i);
+            event->setProperty("deck", e.deck);
+            event->setProperty("kind", MixAutomation::getKindName(e.kind));
+            if (e.kind == MixAutomation::Kind::DeckCommand)
+                event->setProperty("command", DJAudioPlayer::getCommandName((DJAudioPlayer::Command::Type) e.commandType));
+            event->setProperty("v", e.value);
+            event->setProperty("v2", e.value2);
+            if (e.path.isNotEmpty()) event->setProperty("path", e.path);
+            applied.add(juce::var(event));
+        }
+        block->setProperty("events", applied);
+        worst.add(juce::var(block));
+    }
+
+    auto* root = new juce::DynamicObject();
+    if (report.error.isNotEmpty()) root->setProperty("error", report.error);
+    root->setProperty("sampleRate", report.sampleRate);
+    root->setProperty("blockSize", report.blockSize);
+    root->setProperty("decks", report.numDecks);
+    root->setProperty("deadlineMs", report.deadlineMs);
+    root->setProperty("blocks", report.numBlocks);
+    root->setProperty("overruns", report.overruns);
+    root->setProperty("meanMs", report.meanMs);
+    root->setProperty("medianMs", report.medianMs);
+    root->setProperty("p99Ms", report.p99Ms);
+    root->setProperty("maxMs", report.maxMs);
+    root->setProperty("renderSeconds", report.renderSeconds);
+    root->setProperty("worstBlocks", worst);
+    return file.replaceWithText(juce::JSON::toString(juce::var(root), true) + "\n");
+}
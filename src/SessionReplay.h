@@ -0,0 +1,60 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "DeckMixer.h"
+#include "MixAutomation.h"
+
+/**
+ * Replays a recorded set against the engine at full speed and times every audio block.
+ *
+ * Builds private players and a DeckMixer like OfflineMixRenderer, but writes nothing: each
+ * block is rendered straight through the mixer's device callback and its duration is compared
+ * with the block's real-time deadline. Events carrying an audio frame (recorded with a frame
+ * clock) are applied at exactly the block they hit live, at the recorded sample rate and block
+ * size, so two runs of the same log render the same audio; older logs fall back to their wall
+ * clock times. The report lists the slowest blocks with the events applied right before them
+ * and the per-deck render time, which is usually enough to tell what blew the deadline.
+ *
+ * Blocking; runs on the calling thread (DavidBench --replay).
+ */
+class SessionReplay {
+public:
+    struct Settings {
+        double sampleRate{0.0};     // 0 = as recorded (44.1 kHz for logs without a device format)
+        int blockSize{0};           // 0 = as recorded (512 if unknown)
+        bool parallelDecks{false};
+        int numWorstBlocks{20};
+    };
+
+    struct Block {
+        juce::int64 index{0};
+        juce::int64 frame{0};       // first frame of the block
+        double ms{0.0};
+        int firstEvent{0};          // events [firstEvent, endEvent) were applied right before it
+        int endEvent{0};
+        std::array<float, DeckMixer::MaxChannels> deckMs{};
+    };
+
+    struct Report {
+        juce::String error;         // empty on success
+        double sampleRate{0.0};
+        int blockSize{0};
+        int numDecks{0};
+        double deadlineMs{0.0};     // one block of audio
+        juce::int64 numBlocks{0};
+        juce::int64 overruns{0};    // blocks slower than the deadline
+        double meanMs{0.0};
+        double medianMs{0.0};
+        double p99Ms{0.0};
+        double maxMs{0.0};
+        double renderSeconds{0.0};  // wall clock of the whole replay, loads included
+        std::vector<Block> worstBlocks;   // slowest first
+    };
+
+    static Report run(const MixAutomation& session, const Settings& settings);
+
+    // JSON report with the offending events spelled out; false if the file could not be written
+    static bool writeReport(const Report& report, const MixAutomation& session, const juce::File& file);
+};
@@ -0,0 +1,114 @@
+#include "SessionSnapshot.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'S', 'N', 'A', 'P', '\0' };
+    constexpr int Version = 1;
+    constexpr int EndMark = 0x534e4150;    // last word; a truncated file reads zeros instead
+}
+
+bool SessionSnapshot::Deck::operator==(const Deck& o) const
+{
+    return trackPath == o.trackPath && positionSec == o.positionSec && tempoFactor == o.tempoFactor
+        && playing == o.playing && keylock == o.keylock && loopEnabled == o.loopEnabled
+        && loopStartSec == o.loopStartSec && loopEndSec == o.loopEndSec && cues == o.cues
+        && eqHigh == o.eqHigh && eqMid == o.eqMid && eqLow == o.eqLow && filter == o.filter && volume == o.volume;
+}
+
+SessionSnapshot::SessionSnapshot(const juce::File& file) : juce::Thread("Session Snapshot"), file(file)
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+SessionSnapshot::~SessionSnapshot()
+{
+    signalThreadShouldExit();
+    wake.signal();
+    stopThread(2000);
+}
+
+bool SessionSnapshot::post(const State& state)
+{
+    if (!queue.push(state)) return false;
+    wake.signal();
+    return true;
+}
+
+void SessionSnapshot::discard()
+{
+    signalThreadShouldExit();
+    wake.signal();
+    stopThread(2000);
+    file.deleteFile();
+}
+
+void SessionSnapshot::run()
+{
+    while (!threadShouldExit()) {
+        wake.wait(-1);
+        // Only the newest state is worth the write
+        State state;
+        bool have = false;
+        while (queue.pop(state)) have = true;
+        if (have && !threadShouldExit() && !write(file, state))
+            std::cout << "SessionSnapshot: cannot write " << file.getFullPathName() << std::endl;
+    }
+}
+
+bool SessionSnapshot::write(const juce::File& target, const State& state)
+{
+    juce::MemoryOutputStream out;
+    out.write(Magic, sizeof(Magic));
+    out.writeInt(Version);
+    out.writeInt64(state.savedAtMs);
+    out.writeInt(state.crossfader);
+    out.writeInt(NumDecks);
+    for (const Deck& d : state.decks) {
+        out.writeString(d.trackPath);
+        out.writeDouble(d.positionSec);
+        out.writeDouble(d.tempoFactor);
+        out.writeBool(d.playing);
+        out.writeBool(d.keylock);
+        out.writeBool(d.loopEnabled);
+        out.writeDouble(d.loopStartSec);
+        out.writeDouble(d.loopEndSec);
+        for (double cue : d.cues) out.writeDouble(cue);
+        for (int value : { d.eqHigh, d.eqMid, d.eqLow, d.filter, d.volume }) out.writeInt(value);
+    }
+    out.writeInt(EndMark);
+
+    juce::TemporaryFile temp(target);
+    if (!temp.getFile().replaceWithData(out.getData(), out.getDataSize())) return false;
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool SessionSnapshot::read(const juce::File& source, State& state)
+{
+    juce::MemoryBlock data;
+    if (!source.existsAsFile() || !source.loadFileAsData(data) || data.getSize() < sizeof(Magic) + 4) return false;
+    juce::MemoryInputStream in(data, false);
+    char magic[sizeof(Magic)];
+    if (in.read(magic, sizeof(magic)) != (int) sizeof(magic) || std::memcmp(magic, Magic, sizeof(Magic)) != 0) return false;
+    if (in.readInt() != Version) return false;
+
+    State s;
+    s.savedAtMs = in.readInt64();
+    s.crossfader = in.readInt();
+    if (in.readInt() != NumDecks) return false;
+    for (Deck& d : s.decks) {
+        d.trackPath = in.readString();
+        d.positionSec = in.readDouble();
+        d.tempoFactor = in.readDouble();
+        d.playing = in.readBool();
+        d.keylock = in.readBool();
+        d.loopEnabled = in.readBool();
+        d.loopStartSec = in.readDouble();
+        d.loopEndSec = in.readDouble();
+        for (double& cue : d.cues) cue = in.readDouble();
+        for (int* value : { &d.eqHigh, &d.eqMid, &d.eqLow, &d.filter, &d.volume }) *value = in.readInt();
+    }
+    if (in.readInt() != EndMark) return false;
+    state = s;
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "LockFreeQueue.h"
+
+/**
+ * Crash recovery: the state of the decks and the mixer, kept on disk while the app runs.
+ *
+ * The UI thread captures a State every few seconds (the player's position, loop and tempo from
+ * its lock-free snapshots, the rest from the controls) and post()s it; a background thread
+ * takes the newest one off an SPSC queue and replaces the snapshot file with it, so neither the
+ * UI nor the audio thread waits for the disk. The file is a few hundred bytes of versioned
+ * binary, written to a temporary file and renamed over the old one, so a crash mid-write leaves
+ * the previous snapshot.
+ *
+ * A clean exit removes the file (discard()); one still there at startup means the last session
+ * ended in a crash, and the app reloads its tracks and parks the decks where they were.
+ */
+class SessionSnapshot : private juce::Thread {
+public:
+    static constexpr int NumDecks = 2;
+    static constexpr int NumCues = 8;
+
+    struct Deck {
+        juce::String trackPath;         // empty: nothing loaded
+        double positionSec{0.0};
+        double tempoFactor{1.0};
+        bool playing{false};
+        bool keylock{false};
+        bool loopEnabled{false};
+        double loopStartSec{0.0};
+        double loopEndSec{0.0};
+        std::array<double, NumCues> cues{};    // seconds; negative for empty pads
+        // Control positions in the UI's own units (dial and fader values)
+        int eqHigh{0};
+        int eqMid{0};
+        int eqLow{0};
+        int filter{0};
+        int volume{100};
+        bool operator==(const Deck& o) const;
+        bool operator!=(const Deck& o) const { return !(*this == o); }
+    };
+
+    struct State {
+        juce::int64 savedAtMs{0};       // wall clock; not compared
+        int crossfader{50};
+        std::array<Deck, NumDecks> decks{};
+        bool operator==(const State& o) const { return crossfader == o.crossfader && decks == o.decks; }
+        bool operator!=(const State& o) const { return !(*this == o); }
+    };
+
+    explicit SessionSnapshot(const juce::File& file);
+    ~SessionSnapshot() override;
+
+    // UI thread: queue a state for writing; false if the writer is still behind on earlier ones
+    bool post(const State& state);
+    // Clean exit: stop writing and remove the file, so the next start has nothing to restore
+    void discard();
+
+    // The snapshot a previous session left behind; false if there is none or it can't be read
+    static bool read(const juce::File& file, State& state);
+    static bool write(const juce::File& file, const State& state);
+
+private:
+    void run() override;
+
+    juce::File file;
+    SpscQueue<State, 4> queue;
+    juce::WaitableEvent wake;
+};
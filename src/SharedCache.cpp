@@ -0,0 +1,38 @@
+#include "SharedCache.h"
+#include <mutex>
+
+namespace {
+    std::mutex rootMutex;
+    juce::File sharedRoot;
+}
+
+void SharedCache::setRoot(const juce::File& root)
+{
+    const std::lock_guard<std::mutex> lock(rootMutex);
+    sharedRoot = root;
+}
+
+juce::File SharedCache::getRoot()
+{
+    const std::lock_guard<std::mutex> lock(rootMutex);
+    return sharedRoot;
+}
+
+bool SharedCache::isEnabled()
+{
+    const juce::File root = getRoot();
+    return root != juce::File() && root.isDirectory();
+}
+
+juce::File SharedCache::fileFor(const juce::File& localDirectory, const juce::String& key, const juce::String& extension)
+{
+    if (key.isEmpty() || !isEnabled()) return {};
+    return getRoot().getChildFile(localDirectory.getFileName()).getChildFile(key + extension);
+}
+
+bool SharedCache::publish(const juce::File& target, const void* data, size_t size)
+{
+    if (target == juce::File() || target.getParentDirectory().createDirectory().failed()) return false;
+    juce::TemporaryFile temp(target);
+    return temp.getFile().replaceWithData(data, size) && temp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * A cache directory several machines share (a NAS folder), below the local caches. BpmCache and
+ * WaveformCache look there for a track the local directory misses, keyed by ContentHash instead
+ * of the path, copy what they find into the local directory, and write their own results back.
+ * The local files stay keyed by path, so a lookup that hits locally never reads the audio; the
+ * shared ones hold across machines whose paths differ. Its bpm_cache/ and waveforms/ mirror the
+ * local folders of the same names; pulsedj-analyze can fill it for everybody.
+ *
+ * The root may be read-only: it is read from then, and nothing is written back. Hot cues and
+ * loops (BpmCache::Memory) are the DJ's own and stay local.
+ */
+class SharedCache {
+public:
+    // Empty (the default) turns sharing off; any thread
+    static void setRoot(const juce::File& root);
+    static juce::File getRoot();
+    // A root is set and reachable
+    static bool isEnabled();
+
+    // The file for the track with `key` in the shared counterpart of a local cache directory;
+    // juce::File() when sharing is off, the root is missing or the key is empty
+    static juce::File fileFor(const juce::File& localDirectory, const juce::String& key, const juce::String& extension);
+    // What a shared record carries in place of the local path
+    static juce::String identityFor(const juce::String& key) { return "xxh64:" + key; }
+
+    // Through a temporary file next to target, so readers on other machines never see half of
+    // it; false without a message if the directory can't be written
+    static bool publish(const juce::File& target, const void* data, size_t size);
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * Function multiversioning for the hand-written DSP loops.
+ *
+ * Release builds target the baseline instruction set, so one binary runs on every machine of its
+ * architecture. A function marked SIMD_DISPATCH is compiled twice more, for x86-64-v3 (AVX2 +
+ * FMA) and x86-64-v4 (AVX-512). The dynamic loader picks the best copy for the CPU once, at
+ * load time (an ifunc), and calls go straight to it afterwards.
+ *
+ * Only GCC 11+ on x86-64 Linux gets the clones, elsewhere the macro is empty: NEON is part of
+ * the AArch64 baseline, so the plain copy is already vectorised there. Mark leaf loops that run
+ * for a whole block or chunk; a cloned function is never inlined into its caller.
+ * Define SIMD_DISPATCH_DISABLED to build the baseline copy only.
+ */
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && ! defined(__clang__) && __GNUC__ >= 11 \
+    && ! defined(SIMD_DISPATCH_DISABLED)
+ #define SIMD_DISPATCH __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+ #define SIMD_DISPATCH
+#endif
@@ -0,0 +1,35 @@
+#include "SmartCrate.h"
+#include "KeyDetector.h"
+
+SmartCrate::Predicate SmartCrate::compile(qint64 nowMs) const
+{
+    constexpr qint64 MsPerDay = 24LL * 60 * 60 * 1000;
+
+    Predicate p;
+    p.minBpm = minBpm;
+    p.maxBpm = maxBpm;
+    for (const QString& key : keys) {
+        const int index = KeyDetector::parse(key.toStdString());
+        if (index >= 0) p.keyMask |= 1u << index;
+    }
+    for (const QString& genre : genres) {
+        const QString trimmed = genre.trimmed();
+        if (!trimmed.isEmpty()) p.genres.insert(trimmed.toLower());
+    }
+    if (addedWithinDays > 0) p.addedSinceMs = nowMs - addedWithinDays * MsPerDay;
+    p.paths = QSet<QString>(tracks.begin(), tracks.end());
+    return p;
+}
+
+QString SmartCrate::describe() const
+{
+    QStringList rules;
+    if (minBpm > 0.0 && maxBpm > 0.0) rules << QString("%1-%2 BPM").arg(minBpm).arg(maxBpm);
+    else if (minBpm > 0.0) rules << QString(">= %1 BPM").arg(minBpm);
+    else if (maxBpm > 0.0) rules << QString("<= %1 BPM").arg(maxBpm);
+    if (!keys.isEmpty()) rules << keys.join(' ');
+    if (!genres.isEmpty()) rules << genres.join(", ");
+    if (addedWithinDays > 0) rules << QString("added in the last %1 days").arg(addedWithinDays);
+    if (!tracks.isEmpty()) rules << QString("%1 listed tracks").arg(tracks.size());
+    return rules.isEmpty() ? QString("all tracks") : rules.join(", ");
+}
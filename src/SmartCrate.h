@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+/**
+ * A saved, rule-based selection of library tracks.
+ *
+ * Rules are ANDed and an unset rule matches every track: BPM range (either bound 0 = open),
+ * keys (Camelot or key names, any of), genres (case-insensitive, any of), a date-added
+ * window in days and an explicit track list (a playlist brought in by CollectionImporter). Crates are stored with the library in the LibraryDatabase. The model does
+ * not interpret these fields per track; compile() lowers them once to a Predicate over the
+ * columns it keeps anyway (BPM, key index, interned genre, time added).
+ */
+struct SmartCrate {
+    QString name;
+    double minBpm = 0.0;
+    double maxBpm = 0.0;
+    QStringList keys;
+    QStringList genres;
+    int addedWithinDays = 0;
+    QStringList tracks;   // file paths; empty = any track
+
+    class Predicate {
+    public:
+        // key: KeyDetector index or -1. The genre rule is separate so callers can evaluate it
+        // once per distinct genre rather than per track.
+        bool matchesColumns(double bpm, int key, qint64 addedMs) const {
+            if (minBpm > 0.0 && bpm < minBpm) return false;
+            if (maxBpm > 0.0 && (bpm <= 0.0 || bpm > maxBpm)) return false;
+            if (keyMask != 0 && (key < 0 || !(keyMask & (1u << key)))) return false;
+            return addedSinceMs <= 0 || addedMs >= addedSinceMs;
+        }
+        bool matchesGenre(const QString& genreLower) const {
+            return genres.isEmpty() || genres.contains(genreLower);
+        }
+        // Without a playlist every path matches; lets a caller skip making the path
+        bool hasPaths() const { return !paths.isEmpty(); }
+        bool matchesPath(const QString& filePath) const {
+            return paths.isEmpty() || paths.contains(filePath);
+        }
+
+    private:
+        friend struct SmartCrate;
+        double minBpm = 0.0, maxBpm = 0.0;
+        quint32 keyMask = 0;   // bit per KeyDetector index; 0 = any key
+        QSet<QString> genres;
+        QSet<QString> paths;
+        qint64 addedSinceMs = 0;
+    };
+
+    // The date-added window is fixed at nowMs
+    Predicate compile(qint64 nowMs) const;
+    // "124-128 BPM, 8A 9A, House" style summary for the crate list
+    QString describe() const;
+};
@@ -0,0 +1,121 @@
+#include "Spectrogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Levels stop halving below this many columns
+    constexpr int MinLevelColumns = 256;
+}
+
+void Spectrogram::Data::buildLevels()
+{
+    levels.resize(std::min<size_t>(levels.size(), 1));
+    while (numColumns(levels.size() - 1) > MinLevelColumns) {
+        const auto& finer = levels.back();
+        const int finerColumns = numColumns(levels.size() - 1);
+        std::vector<std::uint8_t> coarser((size_t) ((finerColumns + 1) / 2) * NumBands);
+        for (int c = 0; c < finerColumns; ++c) {
+            std::uint8_t* out = &coarser[(size_t) (c / 2) * NumBands];
+            const std::uint8_t* in = &finer[(size_t) c * NumBands];
+            for (int b = 0; b < NumBands; ++b) out[b] = std::max(out[b], in[b]);
+        }
+        levels.push_back(std::move(coarser));
+    }
+    int64_t bytes = 0;
+    for (const auto& level : levels) bytes += (int64_t) level.size();
+    memory.resize(bytes);
+}
+
+void Spectrogram::prepare(const juce::AudioFormatReader& reader)
+{
+    const double rate = reader.sampleRate > 0.0 ? reader.sampleRate : 44100.0;
+    frameSize = rate > 60000.0 ? FrameSize * 2 : FrameSize;
+    fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2((double) frameSize)));
+    window.resize((size_t) frameSize);
+    for (int i = 0; i < frameSize; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float) i / (float) frameSize);
+    for (int b = 0; b <= NumBands; ++b) {
+        const double hz = MinHz * std::pow(MaxHz / MinHz, (double) b / NumBands);
+        bandEdges[(size_t) b] = std::min(frameSize / 2, (int) std::lround(hz * frameSize / rate));
+    }
+    // Hann's coherent gain is one half
+    fullScale = (float) frameSize * 0.25f;
+    hop = rate / ColumnsPerSecond;
+
+    // Half a frame of silence in front, so column c is centred on (c + 0.5) * hop
+    ring.assign((size_t) frameSize, 0.0f);
+    fftData.assign((size_t) frameSize * 2, 0.0f);
+    pushed = frameSize / 2;
+    nextColumnAt = hop * 0.5 + frameSize;
+    columns.clear();
+    columns.reserve((size_t) (std::ceil((double) reader.lengthInSamples / hop) + 1) * NumBands);
+    complete = false;
+}
+
+void Spectrogram::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64)
+{
+    const int channels = block.getNumChannels();
+    if (channels == 0 || fft == nullptr) return;
+
+    mono.resize((size_t) numSamples);
+    juce::FloatVectorOperations::copy(mono.data(), block.getReadPointer(0), numSamples);
+    for (int ch = 1; ch < channels; ++ch)
+        juce::FloatVectorOperations::add(mono.data(), block.getReadPointer(ch), numSamples);
+    juce::FloatVectorOperations::multiply(mono.data(), 1.0f / (float) channels, numSamples);
+    push(mono.data(), numSamples);
+}
+
+void Spectrogram::push(const float* samples, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i) {
+        ring[(size_t) (pushed % frameSize)] = samples[i];
+        if ((double) ++pushed >= nextColumnAt) {
+            addColumn();
+            nextColumnAt += hop;
+        }
+    }
+}
+
+void Spectrogram::finish(bool completed)
+{
+    if (!completed || fft == nullptr) return;
+    // Silence after the end until the column holding the last sample is out
+    const juce::int64 consumed = pushed - frameSize / 2;
+    const auto wanted = (size_t) std::ceil((double) consumed / hop) * NumBands;
+    const std::vector<float> silence((size_t) frameSize, 0.0f);
+    while (columns.size() < wanted) push(silence.data(), frameSize);
+    columns.resize(wanted);
+    complete = !columns.empty();
+}
+
+void Spectrogram::addColumn()
+{
+    // The ring in time order, windowed
+    const int start = (int) (pushed % frameSize);
+    for (int i = 0; i < frameSize; ++i)
+        fftData[(size_t) i] = ring[(size_t) ((start + i) % frameSize)] * window[(size_t) i];
+    std::fill(fftData.begin() + frameSize, fftData.end(), 0.0f);
+    fft->performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    const float scale = 1.0f / (fullScale * fullScale);
+    for (int b = 0; b < NumBands; ++b) {
+        // Low bands are narrower than a bin; they read the bin they fall in
+        const int from = std::min(bandEdges[(size_t) b], frameSize / 2 - 1);
+        const int to = std::max(from + 1, bandEdges[(size_t) b + 1]);
+        float power = 0.0f;
+        for (int bin = from; bin < to; ++bin) power += fftData[(size_t) bin] * fftData[(size_t) bin];
+        const float db = 10.0f * std::log10(power * scale / (float) (to - from) + 1.0e-12f);
+        const float level = juce::jlimit(0.0f, 1.0f, (db - FloorDb) / -FloorDb);
+        columns.push_back((std::uint8_t) std::lround(level * 255.0f));
+    }
+}
+
+Spectrogram::SharedData Spectrogram::takeData()
+{
+    if (!complete) return nullptr;
+    auto data = std::make_shared<Data>();
+    data->levels.push_back(std::move(columns));
+    data->buildLevels();
+    complete = false;
+    return data;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MemoryBudget.h"
+#include "TrackDecodePipeline.h"
+
+/**
+ * Short-time spectrum of a whole track for the deck's spectrogram display, one more sink of the
+ * analysis pass (TrackAnalysis).
+ *
+ * The mono mix is cut into Hann frames of FrameSize (FrameSize * 2 above 60 kHz, so a frame
+ * lasts about as long at any rate), ColumnsPerSecond of them, each centred on its column. The
+ * magnitudes are pooled into NumBands bands log-spaced between MinHz and MaxHz and kept as one
+ * byte each, FloorDb..0 dBFS onto 0..255: 64 bytes a column, about 750 KB for a six minute
+ * track. SpectrogramCache keeps them, so the FFT runs once per track.
+ */
+class Spectrogram : public TrackDecodePipeline::Sink {
+public:
+    static constexpr int FrameSize = 2048;
+    static constexpr int NumBands = 64;
+    static constexpr double ColumnsPerSecond = 40.0;
+    static constexpr double MinHz = 30.0;
+    static constexpr double MaxHz = 16000.0;
+    static constexpr float FloorDb = -80.0f;
+
+    /**
+     * Columns of NumBands bytes, lowest band first. levels[0] is the analysis; each further
+     * level halves the columns, keeping the louder of each pair per band, down to a few hundred
+     * columns, so a zoomed-out view still reads at most one column per pixel.
+     */
+    struct Data {
+        std::vector<std::vector<std::uint8_t>> levels;
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::Waveforms};
+
+        int numColumns(size_t level = 0) const { return level < levels.size() ? (int) (levels[level].size() / NumBands) : 0; }
+        // From levels[0]
+        void buildLevels();
+    };
+    using SharedData = std::shared_ptr<const Data>;
+
+    void prepare(const juce::AudioFormatReader& reader) override;
+    void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+    void finish(bool completed) override;
+
+    // The whole track was read
+    bool isComplete() const { return complete; }
+    // With its levels; nullptr unless complete
+    SharedData takeData();
+
+private:
+    void push(const float* samples, int numSamples);
+    void addColumn();
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int frameSize{FrameSize};
+    std::vector<float> window;
+    std::array<int, NumBands + 1> bandEdges{};   // FFT bins
+    float fullScale{1.0f};                       // a full-scale sine's peak bin
+    double hop{1102.5};                          // source samples per column
+    juce::int64 expectedColumns{0};
+    juce::int64 pushed{0};                       // samples into the ring, the half-frame of padding included
+    double nextColumnAt{0.0};
+    std::vector<float> ring;                     // the last frameSize samples
+    std::vector<float> mono;
+    std::vector<float> fftData;
+    std::vector<std::uint8_t> columns;
+    bool complete{false};
+};
@@ -0,0 +1,114 @@
+#include "SpectrogramCache.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'S', 'P', 'E', 'C', '\0' };
+    // magic, version, numBands, size, mtime, columnsPerSecond, numColumns, pathBytes
+    constexpr size_t HeaderBytes = 8 + 4 + 4 + 8 + 8 + 8 + 4 + 4;
+
+    double readDouble(const char* p)
+    {
+        const juce::int64 bits = (juce::int64) juce::ByteOrder::littleEndianInt64(p);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    struct Header {
+        size_t numColumns{0};
+        size_t pathBytes{0};
+    };
+
+    // The header at `data` describes a spectrogram of `audioFile` as it is now, in this layout
+    bool readHeader(const char* data, size_t size, const juce::File& audioFile, Header& header)
+    {
+        if (size < HeaderBytes || std::memcmp(data, Magic, sizeof(Magic)) != 0) return false;
+        if (juce::ByteOrder::littleEndianInt(data + 8) != SpectrogramCache::Version) return false;
+        if ((int) juce::ByteOrder::littleEndianInt(data + 12) != Spectrogram::NumBands) return false;
+        const auto sourceSize = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 16);
+        const auto sourceModMs = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 24);
+        if (readDouble(data + 32) != Spectrogram::ColumnsPerSecond) return false;
+        header.numColumns = juce::ByteOrder::littleEndianInt(data + 40);
+        header.pathBytes = juce::ByteOrder::littleEndianInt(data + 44);
+        if (header.numColumns == 0) return false;
+        if (sourceSize != audioFile.getSize() || sourceModMs != audioFile.getLastModificationTime().toMilliseconds())
+            return false;
+        if (HeaderBytes + header.pathBytes > size) return false;
+        return juce::String::fromUTF8(data + HeaderBytes, (int) header.pathBytes) == audioFile.getFullPathName();
+    }
+}
+
+SpectrogramCache::SpectrogramCache(const juce::File& dir) : directory(dir)
+{
+}
+
+juce::File SpectrogramCache::getCacheFileFor(const juce::File& audioFile) const
+{
+    const auto key = juce::String::toHexString(audioFile.getFullPathName().hashCode64());
+    return directory.getChildFile(key + ".pspec");
+}
+
+bool SpectrogramCache::contains(const juce::File& audioFile) const
+{
+    if (!isEnabled()) return false;
+    juce::FileInputStream in(getCacheFileFor(audioFile));
+    if (!in.openedOk()) return false;
+    juce::MemoryBlock head;
+    const size_t want = HeaderBytes + (size_t) audioFile.getFullPathName().getNumBytesAsUTF8();
+    head.setSize(want);
+    if (in.read(head.getData(), (int) want) != (int) want) return false;
+    Header header;
+    return readHeader(static_cast<const char*>(head.getData()), want, audioFile, header);
+}
+
+bool SpectrogramCache::store(const juce::File& audioFile, const Spectrogram::Data& data) const
+{
+    if (!isEnabled() || data.numColumns() == 0) return false;
+
+    const juce::String path = audioFile.getFullPathName();
+    const size_t pathBytes = path.getNumBytesAsUTF8();
+    const auto& columns = data.levels.front();
+
+    juce::MemoryOutputStream out(columns.size() + HeaderBytes + pathBytes);
+    out.write(Magic, sizeof(Magic));
+    out.writeInt((int) Version);
+    out.writeInt(Spectrogram::NumBands);
+    out.writeInt64(audioFile.getSize());
+    out.writeInt64(audioFile.getLastModificationTime().toMilliseconds());
+    out.writeDouble(Spectrogram::ColumnsPerSecond);
+    out.writeInt(data.numColumns());
+    out.writeInt((int) pathBytes);
+    out.write(path.toRawUTF8(), pathBytes);
+    out.write(columns.data(), columns.size());
+
+    const juce::File target = getCacheFileFor(audioFile);
+    juce::TemporaryFile temp(target);
+    if (!temp.getFile().replaceWithData(out.getData(), out.getDataSize()) || !temp.overwriteTargetFileWithTemporary()) {
+        std::cout << "SpectrogramCache: failed to write " << target.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Spectrogram::SharedData SpectrogramCache::load(const juce::File& audioFile) const
+{
+    if (!isEnabled()) return nullptr;
+    const juce::File cacheFile = getCacheFileFor(audioFile);
+    if (!cacheFile.existsAsFile()) return nullptr;
+
+    juce::MemoryMappedFile mapped(cacheFile, juce::MemoryMappedFile::readOnly);
+    const char* bytes = static_cast<const char*>(mapped.getData());
+    const size_t size = mapped.getSize();
+    Header header;
+    if (bytes == nullptr || !readHeader(bytes, size, audioFile, header)) return nullptr;
+
+    const size_t at = HeaderBytes + header.pathBytes;
+    const size_t columnBytes = header.numColumns * Spectrogram::NumBands;
+    if (columnBytes > size - at) return nullptr;
+    auto data = std::make_shared<Spectrogram::Data>();
+    const auto* first = reinterpret_cast<const std::uint8_t*>(bytes + at);
+    data->levels.emplace_back(first, first + columnBytes);
+    data->buildLevels();
+    return data;
+}
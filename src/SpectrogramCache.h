@@ -0,0 +1,32 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Spectrogram.h"
+
+/**
+ * On-disk spectrograms, one file per track next to the waveform summaries.
+ *
+ * A file holds the finest level of Spectrogram::Data as it is in RAM, NumBands bytes a column;
+ * the coarser levels are rebuilt on load, which is cheaper than reading them. Like StemCache,
+ * files are keyed by a hash of the path and carry the path, size and modification time of the
+ * source, so a changed or moved track simply misses; files are written through a temporary so
+ * readers never see half of one.
+ */
+class SpectrogramCache {
+public:
+    static constexpr juce::uint32 Version = 1;
+
+    explicit SpectrogramCache(const juce::File& directory);
+
+    bool isEnabled() const { return directory.isDirectory(); }
+    juce::File getCacheFileFor(const juce::File& audioFile) const;
+    // Cheap: the header only
+    bool contains(const juce::File& audioFile) const;
+
+    bool store(const juce::File& audioFile, const Spectrogram::Data& data) const;
+    // nullptr on any mismatch (missing, stale, other version or layout, damaged)
+    Spectrogram::SharedData load(const juce::File& audioFile) const;
+
+private:
+    juce::File directory;
+};
@@ -0,0 +1,39 @@
+#include "StartupTimeline.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point startTime = Clock::now();
+    double lastMarkMs = 0.0;
+    bool interactiveLogged = false;
+}
+
+void StartupTimeline::begin()
+{
+    startTime = Clock::now();
+    lastMarkMs = 0.0;
+    interactiveLogged = false;
+}
+
+double StartupTimeline::elapsedMs()
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+}
+
+void StartupTimeline::mark(const char* stage)
+{
+    const double now = elapsedMs();
+    std::cout << "Startup: " << stage << " +" << (int) (now - lastMarkMs) << " ms (" << (int) now << " ms)" << std::endl;
+    lastMarkMs = now;
+}
+
+void StartupTimeline::interactive()
+{
+    if (interactiveLogged) return;
+    interactiveLogged = true;
+    const double now = elapsedMs();
+    std::cout << "Startup: interactive after " << (int) now << " ms" << std::endl;
+    if (now > TargetMs)
+        std::cout << "Startup: slower than the " << (int) TargetMs << " ms target" << std::endl;
+}
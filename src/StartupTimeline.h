@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * Startup stages and time-to-interactive, measured from the top of main().
+ *
+ * Each mark() logs "Startup: <stage> +<ms> ms". interactive() is called once the window is
+ * on screen and the audio device runs, so a track can be loaded and played; it logs the total
+ * once and warns above TargetMs. Everything after that (stored library, analysis queue) is
+ * marked too, but doesn't count. UI thread only.
+ */
+class StartupTimeline {
+public:
+    static constexpr double TargetMs = 500.0;
+
+    static void begin();
+    static void mark(const char* stage);
+    static void interactive();
+    static double elapsedMs();
+};
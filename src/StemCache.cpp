@@ -0,0 +1,183 @@
+#include "StemCache.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'S', 'T', 'E', 'M', '\0' };
+    // magic, version, numStems, size, mtime, lengthInSamples, sampleRate, pathBytes, reserved
+    constexpr size_t HeaderBytes = 8 + 4 + 4 + 8 + 8 + 8 + 8 + 4 + 4;
+
+    double readDouble(const char* p)
+    {
+        const juce::int64 bits = (juce::int64) juce::ByteOrder::littleEndianInt64(p);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    struct Header {
+        juce::int64 lengthInSamples{0};
+        double sampleRate{0.0};
+        size_t pathBytes{0};
+    };
+
+    // The header at `data` describes stems of `audioFile` as it is now
+    bool readHeader(const char* data, size_t size, const juce::File& audioFile, Header& header)
+    {
+        if (size < HeaderBytes || std::memcmp(data, Magic, sizeof(Magic)) != 0) return false;
+        if (juce::ByteOrder::littleEndianInt(data + 8) != StemCache::Version) return false;
+        if ((int) juce::ByteOrder::littleEndianInt(data + 12) != StemTrackReader::NumStems) return false;
+        const auto sourceSize = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 16);
+        const auto sourceModMs = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 24);
+        header.lengthInSamples = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 32);
+        header.sampleRate = readDouble(data + 40);
+        header.pathBytes = juce::ByteOrder::littleEndianInt(data + 48);
+        if (header.lengthInSamples <= 0 || header.sampleRate <= 0.0) return false;
+        if (sourceSize != audioFile.getSize() || sourceModMs != audioFile.getLastModificationTime().toMilliseconds())
+            return false;
+        if (HeaderBytes + header.pathBytes > size) return false;
+        return juce::String::fromUTF8(data + HeaderBytes, (int) header.pathBytes) == audioFile.getFullPathName();
+    }
+}
+
+StemCache::StemCache(const juce::File& dir) : directory(dir)
+{
+}
+
+juce::File StemCache::getCacheFileFor(const juce::File& audioFile) const
+{
+    const auto key = juce::String::toHexString(audioFile.getFullPathName().hashCode64());
+    return directory.getChildFile(key + ".pstem");
+}
+
+bool StemCache::contains(const juce::File& audioFile) const
+{
+    if (!isEnabled()) return false;
+    juce::FileInputStream in(getCacheFileFor(audioFile));
+    if (!in.openedOk()) return false;
+    juce::MemoryBlock head;
+    const size_t want = HeaderBytes + (size_t) audioFile.getFullPathName().getNumBytesAsUTF8();
+    head.setSize(want);
+    if (in.read(head.getData(), (int) want) != (int) want) return false;
+    Header header;
+    return readHeader(static_cast<const char*>(head.getData()), want, audioFile, header);
+}
+
+bool StemCache::store(const juce::File& audioFile, const StemTrackReader::Stems& stems) const
+{
+    if (!isEnabled() || !stems.isComplete()) return false;
+
+    const juce::String path = audioFile.getFullPathName();
+    const size_t pathBytes = path.getNumBytesAsUTF8();
+
+    juce::MemoryOutputStream out((size_t) stems.sizeInBytes() + HeaderBytes + pathBytes + 64);
+    out.write(Magic, sizeof(Magic));
+    out.writeInt((int) Version);
+    out.writeInt(StemTrackReader::NumStems);
+    out.writeInt64(audioFile.getSize());
+    out.writeInt64(audioFile.getLastModificationTime().toMilliseconds());
+    out.writeInt64(stems.lengthInSamples);
+    out.writeDouble(stems.sampleRate);
+    out.writeInt((int) pathBytes);
+    out.writeInt(0);
+    out.write(path.toRawUTF8(), pathBytes);
+    // Per stem: data size, block offsets (numBlocks + 1), the blocks
+    for (const auto& stream : stems.streams) {
+        out.writeInt64((juce::int64) stream.data.size());
+        for (const uint32_t offset : stream.blockOffsets) out.writeInt((int) offset);
+        out.write(stream.data.data(), stream.data.size());
+    }
+
+    const juce::File target = getCacheFileFor(audioFile);
+    juce::TemporaryFile temp(target);
+    if (!temp.getFile().replaceWithData(out.getData(), out.getDataSize()) || !temp.overwriteTargetFileWithTemporary()) {
+        std::cout << "StemCache: failed to write " << target.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool StemCache::relink(const juce::File& from, juce::int64 fromSize, juce::int64 fromModifiedMs, const juce::File& to) const
+{
+    if (!isEnabled()) return false;
+    const juce::File source = getCacheFileFor(from);
+    const bool moved = from != to;
+    if (moved && getCacheFileFor(to).existsAsFile()) return false;
+    juce::FileInputStream in(source);
+    if (!in.openedOk()) return false;
+    const juce::String fromPath = from.getFullPathName();
+    const size_t fromBytes = fromPath.getNumBytesAsUTF8();
+    juce::MemoryBlock head(HeaderBytes + fromBytes);
+    if (in.read(head.getData(), (int) head.getSize()) != (int) head.getSize()) return false;
+    const char* data = static_cast<const char*>(head.getData());
+    if (std::memcmp(data, Magic, sizeof(Magic)) != 0 || juce::ByteOrder::littleEndianInt(data + 8) != Version
+        || (juce::int64) juce::ByteOrder::littleEndianInt64(data + 16) != fromSize
+        || (juce::int64) juce::ByteOrder::littleEndianInt64(data + 24) != fromModifiedMs
+        || juce::ByteOrder::littleEndianInt(data + 48) != fromBytes
+        || juce::String::fromUTF8(data + HeaderBytes, (int) fromBytes) != fromPath)
+        return false;
+
+    const juce::String path = to.getFullPathName();
+    const size_t pathBytes = path.getNumBytesAsUTF8();
+    juce::TemporaryFile temp(getCacheFileFor(to));
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk()) return false;
+        out.write(data, 16);                  // magic, version, numStems
+        out.writeInt64(to.getSize());
+        out.writeInt64(to.getLastModificationTime().toMilliseconds());
+        out.write(data + 32, 16);             // lengthInSamples, sampleRate
+        out.writeInt((int) pathBytes);
+        out.writeInt(0);
+        out.write(path.toRawUTF8(), pathBytes);
+        out.writeFromInputStream(in, -1);
+        out.flush();
+        if (!out.getStatus().wasOk()) return false;
+    }
+    if (!temp.overwriteTargetFileWithTemporary()) return false;
+    if (moved) source.deleteFile();
+    return true;
+}
+
+StemTrackReader::StemsPtr StemCache::load(const juce::File& audioFile) const
+{
+    if (!isEnabled()) return nullptr;
+    const juce::File cacheFile = getCacheFileFor(audioFile);
+    if (!cacheFile.existsAsFile()) return nullptr;
+
+    juce::MemoryMappedFile mapped(cacheFile, juce::MemoryMappedFile::readOnly);
+    const char* data = static_cast<const char*>(mapped.getData());
+    const size_t size = mapped.getSize();
+    Header header;
+    if (data == nullptr || !readHeader(data, size, audioFile, header)) return nullptr;
+
+    auto stems = std::make_shared<StemTrackReader::Stems>();
+    stems->sampleRate = header.sampleRate;
+    stems->lengthInSamples = header.lengthInSamples;
+    const size_t numOffsets = (size_t) stems->numBlocks() + 1;
+    size_t at = HeaderBytes + header.pathBytes;
+    try {
+        for (auto& stream : stems->streams) {
+            if (at + 8 + numOffsets * 4 > size) return nullptr;
+            const auto dataBytes = (juce::uint64) juce::ByteOrder::littleEndianInt64(data + at);
+            at += 8;
+            stream.blockOffsets.resize(numOffsets);
+            for (size_t i = 0; i < numOffsets; ++i)
+                stream.blockOffsets[i] = juce::ByteOrder::littleEndianInt(data + at + i * 4);
+            at += numOffsets * 4;
+            if (dataBytes > size - at) return nullptr;
+            stream.data.assign(reinterpret_cast<const uint8_t*>(data + at), reinterpret_cast<const uint8_t*>(data + at + dataBytes));
+            at += (size_t) dataBytes;
+        }
+    } catch (const std::bad_alloc&) {
+        std::cout << "StemCache: no memory for the stems of " << audioFile.getFileName().toStdString() << std::endl;
+        return nullptr;
+    }
+    if (!stems->isComplete()) return nullptr;
+    // Offsets must stay inside the data and go forwards, the reader trusts them
+    for (const auto& stream : stems->streams)
+        for (size_t i = 1; i < stream.blockOffsets.size(); ++i)
+            if (stream.blockOffsets[i] < stream.blockOffsets[i - 1]) return nullptr;
+    stems->memory.resize(stems->sizeInBytes());
+    return stems;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StemTrackReader.h"
+
+/**
+ * On-disk stems, one file per track next to the waveform summaries
+ * (AppConfig::getWaveformCacheDirectory()).
+ *
+ * A file holds the four stems exactly as StemTrackReader keeps them in RAM: per stem the
+ * SampleBlockCodec blocks and their offsets, so loading is a read of the file and no audio is
+ * decoded or separated again. Like WaveformCache, files are keyed by a hash of the path and
+ * carry the path, size and modification time of the source, so a changed or moved track simply
+ * misses; files are written through a temporary so readers never see half of one.
+ */
+class StemCache {
+public:
+    static constexpr juce::uint32 Version = 1;
+
+    explicit StemCache(const juce::File& directory);
+
+    bool isEnabled() const { return directory.isDirectory(); }
+    juce::File getCacheFileFor(const juce::File& audioFile) const;
+    // Cheap: the header only
+    bool contains(const juce::File& audioFile) const;
+
+    bool store(const juce::File& audioFile, const StemTrackReader::Stems& stems) const;
+    // nullptr on any mismatch (missing, stale, other version, damaged)
+    StemTrackReader::StemsPtr load(const juce::File& audioFile) const;
+    // The stems of a track that moved (or was re-tagged) from `from` to `to` keeping its audio, if
+    // they were current for from's size and modification time; streamed over, the old file removed
+    bool relink(const juce::File& from, juce::int64 fromSize, juce::int64 fromModifiedMs, const juce::File& to) const;
+
+private:
+    juce::File directory;
+};
@@ -0,0 +1,253 @@
+#include "StemSeparator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // 0 below `from`, 1 above `to`, a raised cosine in between
+    float rise(double f, double from, double to) {
+        if (f <= from) return 0.0f;
+        if (f >= to) return 1.0f;
+        return (float) (0.5 - 0.5 * std::cos(juce::MathConstants<double>::pi * (f - from) / (to - from)));
+    }
+
+    constexpr float kTiny = 1.0e-12f;
+}
+
+StemSeparator::StemSeparator() = default;
+StemSeparator::~StemSeparator() = default;
+
+void StemSeparator::prepare(const juce::AudioFormatReader& reader) {
+    length = reader.lengthInSamples;
+    const double rate = reader.sampleRate > 0.0 ? reader.sampleRate : 44100.0;
+    result.reset();
+    stems.reset();
+    if (length <= 0) return;
+
+    fft = std::make_unique<juce::dsp::FFT>(FftOrder);
+    window.resize(FftSize);
+    for (int n = 0; n < FftSize; ++n)
+        window[(size_t) n] = (float) std::sqrt(0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * n / FftSize));
+    // Analysis times synthesis window is a periodic Hann, which overlaps to a constant
+    double sum = 0.0;
+    for (int n = 0; n < FftSize; ++n) sum += (double) window[(size_t) n] * window[(size_t) n];
+    overlapGain = (float) ((double) Hop / sum);
+
+    bassWeight.resize(NumBins);
+    vocalWeight.resize(NumBins);
+    for (int k = 0; k < NumBins; ++k) {
+        const double f = (double) k * rate / FftSize;
+        bassWeight[(size_t) k] = 1.0f - rise(f, BassFullHz, BassEndHz);
+        vocalWeight[(size_t) k] = rise(f, VocalStartHz, VocalFullHz) * (1.0f - rise(f, VocalFullEndHz, VocalEndHz));
+    }
+
+    // The first frame starts FftSize - Hop before the track, so every sample is covered by
+    // all the frames it needs to add up
+    for (auto& channel : input) channel.assign(FftSize, 0.0f);
+    inputFill = FftSize - Hop;
+    skip = FftSize - Hop;
+    frames.assign(MedianFrames, Frame{});
+    for (auto& frame : frames) {
+        frame.spectrum.assign(FftSize, Complex());
+        frame.magnitude.assign(NumBins, 0.0f);
+        for (auto& head : frame.head) head.assign(Hop, 0.0f);
+    }
+    framesAnalysed = 0;
+    for (auto& stem : overlap)
+        for (auto& channel : stem) channel.assign(FftSize, 0.0f);
+    work.assign(FftSize, Complex());
+    inverse.assign(FftSize, Complex());
+    for (auto& mask : masks) mask.assign(NumBins, 0.0f);
+    column.resize(std::max(MedianFrames, MedianBins));
+
+    written = 0;
+    stagingFill = 0;
+    stems = std::make_shared<StemTrackReader::Stems>();
+    stems->sampleRate = rate;
+    stems->lengthInSamples = length;
+    for (auto& stream : stems->streams) {
+        stream.blockOffsets.reserve((size_t) stems->numBlocks() + 1);
+        stream.blockOffsets.push_back(0);
+    }
+    for (auto& stem : staging)
+        for (auto& channel : stem) channel.assign(SampleBlockCodec::BlockFrames, 0);
+}
+
+void StemSeparator::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) {
+    juce::ignoreUnused(position);
+    if (stems == nullptr || block.getNumChannels() == 0) return;
+    // Mono: both channels the same, which the centre mask reads as all centre
+    const float* left = block.getReadPointer(0);
+    const float* right = block.getReadPointer(std::min(1, block.getNumChannels() - 1));
+    push(left, right, numSamples);
+}
+
+void StemSeparator::finish(bool completed) {
+    if (stems == nullptr) return;
+    if (!completed) {
+        stems.reset();
+        return;
+    }
+    // Silence after the end carries the held-back frames out
+    const std::vector<float> silence(Hop, 0.0f);
+    for (int guard = 0; written < length && guard < MedianFrames + FftSize / Hop + 2; ++guard)
+        push(silence.data(), silence.data(), Hop);
+    if (stagingFill > 0) encodeStaged();
+
+    for (auto& stream : stems->streams) stream.data.shrink_to_fit();
+    stems->memory.resize(stems->sizeInBytes());
+    if (!stems->isComplete()) {
+        std::cout << "StemSeparator: incomplete stems, dropped" << std::endl;
+        stems.reset();
+        return;
+    }
+    std::cout << "StemSeparator: " << length << " samples into " << StemTrackReader::NumStems << " stems, "
+              << (stems->sizeInBytes() >> 20) << " MB" << std::endl;
+    result = std::move(stems);
+}
+
+void StemSeparator::push(const float* left, const float* right, int numSamples) {
+    for (int done = 0; done < numSamples; ) {
+        const int n = std::min(numSamples - done, FftSize - inputFill);
+        std::memcpy(input[0].data() + inputFill, left + done, (size_t) n * sizeof(float));
+        std::memcpy(input[1].data() + inputFill, right + done, (size_t) n * sizeof(float));
+        inputFill += n;
+        done += n;
+        if (inputFill == FftSize) {
+            analyseFrame();
+            for (auto& channel : input)
+                std::memmove(channel.data(), channel.data() + Hop, (size_t) (FftSize - Hop) * sizeof(float));
+            inputFill = FftSize - Hop;
+        }
+    }
+}
+
+void StemSeparator::analyseFrame() {
+    Frame& frame = frames[(size_t) (framesAnalysed % MedianFrames)];
+    for (int ch = 0; ch < 2; ++ch)
+        std::memcpy(frame.head[ch].data(), input[ch].data(), (size_t) Hop * sizeof(float));
+    for (int n = 0; n < FftSize; ++n)
+        work[(size_t) n] = Complex(input[0][(size_t) n] * window[(size_t) n], input[1][(size_t) n] * window[(size_t) n]);
+    fft->perform(work.data(), frame.spectrum.data(), false);
+
+    // Z = L + iR: L(k) = (Z(k) + conj Z(-k)) / 2, R(k) = (Z(k) - conj Z(-k)) / 2i
+    for (int k = 0; k < NumBins; ++k) {
+        const Complex z = frame.spectrum[(size_t) k];
+        const Complex zm = std::conj(frame.spectrum[(size_t) ((FftSize - k) % FftSize)]);
+        frame.magnitude[(size_t) k] = 0.5f * (std::abs(z + zm) + std::abs(z - zm));
+    }
+    ++framesAnalysed;
+
+    // The middle of the ring has its frames on both sides now
+    const juce::int64 centre = framesAnalysed - 1 - MedianFrames / 2;
+    if (centre >= 0) separate(frames[(size_t) (centre % MedianFrames)]);
+}
+
+void StemSeparator::separate(const Frame& frame) {
+    for (int k = 0; k < NumBins; ++k) {
+        // Steady in time: median across the ring
+        for (int f = 0; f < MedianFrames; ++f) column[(size_t) f] = frames[(size_t) f].magnitude[(size_t) k];
+        std::nth_element(column.begin(), column.begin() + MedianFrames / 2, column.begin() + MedianFrames);
+        const float harmonic = column[MedianFrames / 2];
+        // Broadband: median across the neighbouring bins
+        const int from = std::max(0, k - MedianBins / 2), to = std::min(NumBins, k + MedianBins / 2 + 1);
+        std::copy(frame.magnitude.begin() + from, frame.magnitude.begin() + to, column.begin());
+        const int count = to - from;
+        std::nth_element(column.begin(), column.begin() + count / 2, column.begin() + count);
+        const float percussive = column[(size_t) (count / 2)];
+
+        const float h2 = harmonic * harmonic, p2 = percussive * percussive;
+        const float drums = h2 + p2 > kTiny ? p2 / (h2 + p2) : 0.5f;
+        const float tonal = 1.0f - drums;
+
+        // Centre of the image: 2 Re(L conj R) / (|L|^2 + |R|^2), 1 for identical channels
+        const Complex z = frame.spectrum[(size_t) k];
+        const Complex zm = std::conj(frame.spectrum[(size_t) ((FftSize - k) % FftSize)]);
+        const Complex l = 0.5f * (z + zm);
+        const Complex r = Complex(0.0f, -0.5f) * (z - zm);
+        const float energy = std::norm(l) + std::norm(r);
+        float centre = energy > kTiny ? std::max(0.0f, 2.0f * (l * std::conj(r)).real() / energy) : 0.0f;
+        centre *= centre;
+
+        const float bass = bassWeight[(size_t) k];
+        masks[StemTrackReader::Drums][(size_t) k] = drums;
+        masks[StemTrackReader::Bass][(size_t) k] = tonal * bass;
+        masks[StemTrackReader::Vocals][(size_t) k] = tonal * (1.0f - bass) * vocalWeight[(size_t) k] * centre;
+    }
+
+    // One inverse FFT per stem gives its left (real) and right (imaginary) channel
+    for (int s = 0; s < MaskedStems; ++s) {
+        const auto& mask = masks[(size_t) s];
+        for (int k = 0; k < FftSize; ++k)
+            work[(size_t) k] = frame.spectrum[(size_t) k] * mask[(size_t) (k < NumBins ? k : FftSize - k)];
+        fft->perform(work.data(), inverse.data(), true);
+        float* left = overlap[s][0].data();
+        float* right = overlap[s][1].data();
+        for (int n = 0; n < FftSize; ++n) {
+            left[n] += inverse[(size_t) n].real() * window[(size_t) n];
+            right[n] += inverse[(size_t) n].imag() * window[(size_t) n];
+        }
+    }
+
+    // The first Hop samples are complete now; other is the input minus the three
+    float stemOut[StemTrackReader::NumStems][2][Hop];
+    for (int ch = 0; ch < 2; ++ch) {
+        for (int i = 0; i < Hop; ++i) {
+            float rest = frame.head[ch][(size_t) i];
+            for (int s = 0; s < MaskedStems; ++s) {
+                const float v = overlap[s][ch][(size_t) i] * overlapGain;
+                stemOut[s][ch][i] = v;
+                rest -= v;
+            }
+            stemOut[StemTrackReader::Other][ch][i] = rest;
+        }
+    }
+    for (auto& stem : overlap) {
+        for (auto& channel : stem) {
+            std::memmove(channel.data(), channel.data() + Hop, (size_t) (FftSize - Hop) * sizeof(float));
+            std::fill(channel.begin() + (FftSize - Hop), channel.end(), 0.0f);
+        }
+    }
+
+    const float* channels[StemTrackReader::NumStems * 2];
+    for (int s = 0; s < StemTrackReader::NumStems; ++s)
+        for (int ch = 0; ch < 2; ++ch) channels[s * 2 + ch] = stemOut[s][ch];
+    emit(channels, Hop);
+}
+
+void StemSeparator::emit(const float* const* channels, int numSamples) {
+    int offset = 0;
+    if (skip > 0) {
+        offset = (int) std::min<juce::int64>(skip, numSamples);
+        skip -= offset;
+    }
+    int remaining = (int) std::min<juce::int64>(numSamples - offset, length - written);
+    while (remaining > 0) {
+        const int n = std::min(remaining, SampleBlockCodec::BlockFrames - stagingFill);
+        for (int s = 0; s < StemTrackReader::NumStems; ++s) {
+            for (int ch = 0; ch < 2; ++ch) {
+                const float* src = channels[s * 2 + ch] + offset;
+                int16_t* dst = staging[s][ch].data() + stagingFill;
+                for (int i = 0; i < n; ++i)
+                    dst[i] = (int16_t) juce::roundToInt(juce::jlimit(-1.0f, 1.0f, src[i] * StemTrackReader::StoreGain) * 32767.0f);
+            }
+        }
+        stagingFill += n;
+        offset += n;
+        remaining -= n;
+        written += n;
+        if (stagingFill == SampleBlockCodec::BlockFrames) encodeStaged();
+    }
+}
+
+void StemSeparator::encodeStaged() {
+    for (int s = 0; s < StemTrackReader::NumStems; ++s) {
+        const int16_t* inputs[2] = { staging[s][0].data(), staging[s][1].data() };
+        auto& stream = stems->streams[(size_t) s];
+        SampleBlockCodec::encode(inputs, 2, stagingFill, stream.data);
+        stream.blockOffsets.push_back((uint32_t) stream.data.size());
+    }
+    stagingFill = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <complex>
+#include <memory>
+#include <vector>
+#include "StemTrackReader.h"
+#include "TrackDecodePipeline.h"
+
+/**
+ * Splits a track into vocals, drums, bass and other, as one more sink of a decode pass.
+ *
+ * There is no trained model behind it: the separation is spectral masking on a short-time
+ * Fourier transform (FftSize, sqrt-Hann, 75 % overlap). Harmonic and percussive parts come
+ * from median filtering the magnitudes (Fitzgerald's HPSS): a median across MedianFrames frames
+ * keeps what is steady in time, one across MedianBins bins keeps what is broadband and short,
+ * and their squares give a soft mask. The percussive part is the drums. The harmonic part
+ * below the bass crossover is the bass; above it, what sits in the vocal band and in the
+ * centre of the stereo image (the two channels in phase and of equal level) is the vocals.
+ * Other gets the rest, as the input minus the three, so the four stems add up to the track.
+ *
+ * Both channels go through one complex FFT (left real, right imaginary) per frame and every
+ * mask is real, so each stem costs a single inverse FFT. The median across frames needs the
+ * frames after the one being separated, which the sink holds back until they arrive; the pass
+ * stays front to back. Each stem is encoded into SampleBlockCodec blocks as it comes out, at
+ * the source rate and length, which is what StemCache stores and StemTrackReader plays.
+ * A pass that doesn't complete leaves nothing. CPU-bound: run it as a background job.
+ */
+class StemSeparator : public TrackDecodePipeline::Sink {
+public:
+    static constexpr int FftOrder = 11;
+    static constexpr int FftSize = 1 << FftOrder;
+    static constexpr int Hop = FftSize / 4;
+    static constexpr int MedianFrames = 17;
+    static constexpr int MedianBins = 17;
+    static constexpr double BassFullHz = 120.0;      // harmonic content below is all bass ...
+    static constexpr double BassEndHz = 250.0;       // ... fading out up to here
+    static constexpr double VocalStartHz = 200.0;    // vocal band, raised-cosine edges
+    static constexpr double VocalFullHz = 400.0;
+    static constexpr double VocalFullEndHz = 7000.0;
+    static constexpr double VocalEndHz = 12000.0;
+
+    StemSeparator();
+    ~StemSeparator() override;
+
+    void prepare(const juce::AudioFormatReader& reader) override;
+    void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+    void finish(bool completed) override;
+
+    // After a completed pass, nullptr otherwise
+    StemTrackReader::StemsPtr takeStems() { return std::move(result); }
+
+private:
+    using Complex = std::complex<float>;
+    static constexpr int NumBins = FftSize / 2 + 1;
+    static constexpr int MaskedStems = 3;   // vocals, drums, bass; other is what remains
+
+    struct Frame {
+        std::vector<Complex> spectrum;   // FftSize, left + i right
+        std::vector<float> magnitude;    // NumBins, |left| + |right|
+        std::vector<float> head[2];      // the frame's first Hop input samples per channel
+    };
+
+    void push(const float* left, const float* right, int numSamples);
+    void analyseFrame();
+    void separate(const Frame& frame);
+    void emit(const float* const* stems, int numSamples);
+    void encodeStaged();
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> window;           // sqrt-Hann, analysis and synthesis
+    float overlapGain{1.0f};             // undoes the windows' overlap sum
+    std::vector<float> bassWeight, vocalWeight;   // per bin
+
+    std::vector<float> input[2];         // the next frame's input
+    int inputFill{0};
+    std::vector<Frame> frames;           // ring of MedianFrames
+    juce::int64 framesAnalysed{0};
+    std::vector<float> overlap[MaskedStems][2];   // overlap-add accumulators, FftSize
+    std::vector<Complex> work, inverse;
+    std::array<std::vector<float>, MaskedStems> masks;   // per bin
+    std::vector<float> column;           // median scratch
+
+    juce::int64 length{0};
+    juce::int64 skip{0};                 // output samples before the track starts (padding)
+    juce::int64 written{0};
+    std::shared_ptr<StemTrackReader::Stems> stems;
+    std::vector<int16_t> staging[StemTrackReader::NumStems][2];
+    int stagingFill{0};
+    StemTrackReader::StemsPtr result;
+};
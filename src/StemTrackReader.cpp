@@ -0,0 +1,149 @@
+#include "StemTrackReader.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int kStemChannels = 2;
+}
+
+const char* StemTrackReader::getStemName(int stem) {
+    switch (stem) {
+        case Vocals: return "Vocals";
+        case Drums: return "Drums";
+        case Bass: return "Bass";
+        case Other: return "Other";
+        default: break;
+    }
+    return "?";
+}
+
+int64_t StemTrackReader::Stems::sizeInBytes() const {
+    int64_t bytes = 0;
+    for (const auto& stream : streams)
+        bytes += (int64_t) (stream.data.size() + stream.blockOffsets.size() * sizeof(uint32_t));
+    return bytes;
+}
+
+bool StemTrackReader::Stems::isComplete() const {
+    if (sampleRate <= 0.0 || lengthInSamples <= 0) return false;
+    for (const auto& stream : streams)
+        if ((juce::int64) stream.blockOffsets.size() != numBlocks() + 1 || stream.blockOffsets.front() != 0
+            || stream.blockOffsets.back() != stream.data.size())
+            return false;
+    return true;
+}
+
+StemTrackReader::StemTrackReader(StemsPtr stemsToRead)
+    : juce::AudioFormatReader(nullptr, "Stems"), stems(std::move(stemsToRead)),
+      scratch((size_t) SampleBlockCodec::MaxChannels * SampleBlockCodec::BlockFrames, 0) {
+    sampleRate = stems->sampleRate;
+    lengthInSamples = stems->lengthInSamples;
+    numChannels = kStemChannels;
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+    for (auto& cache : caches) {
+        cache.block.fill(-1);
+        cache.samples.assign((size_t) BlockCacheSlots * kStemChannels * SampleBlockCodec::BlockFrames, 0.0f);
+    }
+    for (auto& gain : targetGains) gain.store(1.0f, std::memory_order_relaxed);
+    rampStep = (float) (1.0 / (GainRampSeconds * std::max(1.0, sampleRate)));
+}
+
+void StemTrackReader::setStemGain(int stem, float gain) noexcept {
+    if (stem < 0 || stem >= NumStems) return;
+    targetGains[(size_t) stem].store(std::max(0.0f, gain), std::memory_order_relaxed);
+}
+
+float StemTrackReader::getStemGain(int stem) const noexcept {
+    if (stem < 0 || stem >= NumStems) return 0.0f;
+    return targetGains[(size_t) stem].load(std::memory_order_relaxed);
+}
+
+int StemTrackReader::cachedBlock(int stem, juce::int64 block) noexcept {
+    BlockCache& c = caches[(size_t) stem];
+    int slot = 0;
+    for (int s = 0; s < BlockCacheSlots; ++s) {
+        if (c.block[(size_t) s] == block) {
+            c.lastUse[(size_t) s] = ++clock;
+            return s;
+        }
+        if (c.lastUse[(size_t) s] < c.lastUse[(size_t) slot]) slot = s;
+    }
+
+    const auto& stream = stems->streams[(size_t) stem];
+    if (block < 0 || block + 1 >= (juce::int64) stream.blockOffsets.size()) return -1;
+    const int frames = (int) std::min<juce::int64>(SampleBlockCodec::BlockFrames, lengthInSamples - block * SampleBlockCodec::BlockFrames);
+    float* dest[kStemChannels];
+    for (int ch = 0; ch < kStemChannels; ++ch)
+        dest[ch] = c.samples.data() + ((size_t) slot * kStemChannels + (size_t) ch) * SampleBlockCodec::BlockFrames;
+    const uint32_t start = stream.blockOffsets[(size_t) block];
+    c.block[(size_t) slot] = -1;
+    if (!SampleBlockCodec::decode(stream.data.data() + start, stream.blockOffsets[(size_t) block + 1] - start,
+                                  kStemChannels, frames, dest, scratch.data()))
+        return -1;
+    c.block[(size_t) slot] = block;
+    c.lastUse[(size_t) slot] = ++clock;
+    return slot;
+}
+
+bool StemTrackReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                  juce::int64 startSampleInFile, int numSamples) {
+    // Same clamping as InMemoryTrackReader: AudioFormatReaderSource may ask around the start
+    const juce::int64 first = std::max<juce::int64>(0, startSampleInFile);
+    const juce::int64 last = std::min<juce::int64>(lengthInSamples, startSampleInFile + numSamples);
+    const int lead = (int) (first - startSampleInFile);
+
+    float* out[kStemChannels] = {};
+    for (int ch = 0; ch < numDestChannels; ++ch) {
+        auto* dest = reinterpret_cast<float*>(destChannels[ch]);
+        if (dest == nullptr) continue;
+        dest += startOffsetInDestBuffer;
+        juce::FloatVectorOperations::clear(dest, numSamples);
+        if (ch < kStemChannels) out[ch] = dest + lead;
+    }
+    if (last <= first) return true;
+
+    std::array<float, NumStems> targets;
+    for (int s = 0; s < NumStems; ++s) targets[(size_t) s] = targetGains[(size_t) s].load(std::memory_order_relaxed);
+    if (!gainsPrimed) {
+        gains = targets;
+        gainsPrimed = true;
+    }
+
+    for (juce::int64 pos = first; pos < last; ) {
+        const juce::int64 block = pos / SampleBlockCodec::BlockFrames;
+        const int offset = (int) (pos - block * SampleBlockCodec::BlockFrames);
+        const int n = (int) std::min<juce::int64>(last - pos, SampleBlockCodec::BlockFrames - offset);
+        const int at = (int) (pos - first);
+
+        for (int s = 0; s < NumStems; ++s) {
+            float& gain = gains[(size_t) s];
+            const float target = targets[(size_t) s];
+            if (gain == 0.0f && target == 0.0f) continue;   // muted: not even decoded
+            const int slot = cachedBlock(s, block);
+            if (slot < 0) continue;
+            const float* src[kStemChannels];
+            for (int ch = 0; ch < kStemChannels; ++ch)
+                src[ch] = caches[(size_t) s].samples.data() + ((size_t) slot * kStemChannels + (size_t) ch) * SampleBlockCodec::BlockFrames + offset;
+
+            if (gain == target) {
+                for (int ch = 0; ch < kStemChannels; ++ch)
+                    if (out[ch] != nullptr)
+                        juce::FloatVectorOperations::addWithMultiply(out[ch] + at, src[ch], gain / StoreGain, n);
+                continue;
+            }
+            // Glide, the same gain on both channels
+            float g = gain;
+            for (int i = 0; i < n; ++i) {
+                g = target > g ? std::min(target, g + rampStep) : std::max(target, g - rampStep);
+                const float scaled = g / StoreGain;
+                for (int ch = 0; ch < kStemChannels; ++ch)
+                    if (out[ch] != nullptr) out[ch][at + i] += src[ch][i] * scaled;
+            }
+            gain = g;
+        }
+        pos += n;
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MemoryBudget.h"
+#include "SampleBlockCodec.h"
+
+/**
+ * AudioFormatReader over the four separated stems of a track (StemSeparator), mixed down to
+ * stereo with a gain per stem as it reads.
+ *
+ * The stems are stereo streams of SampleBlockCodec blocks held in RAM, sample aligned with the
+ * source track and at its rate, so a deck loads this reader in place of the track's own and
+ * positions, cues and grids line up unchanged. Every read decodes the block it is in for all
+ * four stems (each stem keeps BlockCacheSlots decoded blocks, so loops and scratching back and
+ * forth across a boundary don't decode again) and sums them in one pass over the same frames:
+ * the stems can never drift apart. A gain change glides over GainRampSeconds so muting a stem
+ * doesn't click. The stems are stored StoreGain down to leave headroom for the peaks masking
+ * creates; the reader puts it back.
+ *
+ * Stems are immutable once built and shared between readers, like InMemoryTrackReader's
+ * samples; the RAM counts against MemoryBudget::Pool::Stems and goes with the last reader.
+ */
+class StemTrackReader : public juce::AudioFormatReader {
+public:
+    enum Stem { Vocals = 0, Drums, Bass, Other, NumStems };
+    static const char* getStemName(int stem);
+
+    static constexpr float StoreGain = 0.5f;
+    static constexpr double GainRampSeconds = 0.02;
+    static constexpr int BlockCacheSlots = 2;
+
+    struct Stems {
+        struct Stream {
+            std::vector<uint8_t> data;           // the blocks back to back
+            std::vector<uint32_t> blockOffsets;  // start of every block, and the end
+        };
+        double sampleRate{0.0};
+        juce::int64 lengthInSamples{0};
+        std::array<Stream, NumStems> streams;
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::Stems};
+
+        juce::int64 numBlocks() const { return (lengthInSamples + SampleBlockCodec::BlockFrames - 1) / SampleBlockCodec::BlockFrames; }
+        int64_t sizeInBytes() const;
+        // Every stream has one block per BlockFrames of the track
+        bool isComplete() const;
+    };
+    using StemsPtr = std::shared_ptr<const Stems>;
+
+    explicit StemTrackReader(StemsPtr stems);
+    ~StemTrackReader() override = default;
+
+    // Any thread; linear, 0 mutes the stem. The first read starts at these gains, later ones
+    // ramp to them.
+    void setStemGain(int stem, float gain) noexcept;
+    float getStemGain(int stem) const noexcept;
+
+    const StemsPtr& getStems() const { return stems; }
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    // Slot of `stem` holding `block`, decoded now if it isn't cached; -1 if the block is damaged
+    int cachedBlock(int stem, juce::int64 block) noexcept;
+
+    struct BlockCache {
+        std::array<juce::int64, BlockCacheSlots> block;
+        std::array<juce::uint32, BlockCacheSlots> lastUse{};
+        std::vector<float> samples;   // [slot][channel][frame]
+    };
+
+    StemsPtr stems;
+    std::array<BlockCache, NumStems> caches;
+    juce::uint32 clock{0};
+    std::vector<int32_t> scratch;
+
+    std::array<std::atomic<float>, NumStems> targetGains;
+    // Reading thread
+    std::array<float, NumStems> gains{};
+    bool gainsPrimed{false};
+    float rampStep{0.0f};   // largest gain change per frame
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemTrackReader)
+};
@@ -0,0 +1,178 @@
+#include "SystemStatsSampler.h"
+#include "ThreadingPolicy.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+#if defined(__linux__)
+    // utime + stime of a /proc/.../stat line, in clock ticks; -1 if unreadable
+    juce::int64 readTaskTicks(const std::string& path)
+    {
+        std::ifstream in(path);
+        std::string line;
+        if (!std::getline(in, line)) return -1;
+        // The command name may contain spaces and parentheses: fields restart after the last ')'
+        const size_t close = line.rfind(')');
+        if (close == std::string::npos) return -1;
+        std::istringstream fields(line.substr(close + 2));
+        std::string field;
+        juce::int64 utime = 0, stime = 0;
+        // Field 3 (state) is the first after the name; utime and stime are fields 14 and 15
+        for (int index = 3; index <= 15 && fields >> field; ++index) {
+            if (index == 14) utime = std::stoll(field);
+            if (index == 15) stime = std::stoll(field);
+        }
+        return utime + stime;
+    }
+
+    std::string readFirstLine(const std::string& path)
+    {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) line.pop_back();
+        return line;
+    }
+#endif
+}
+
+SystemStatsSampler::SystemStatsSampler() : juce::Thread("System Stats")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+SystemStatsSampler::~SystemStatsSampler()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+}
+
+void SystemStatsSampler::run()
+{
+    while (!threadShouldExit()) {
+        sample();
+        wait(IntervalMs);
+    }
+}
+
+void SystemStatsSampler::sample()
+{
+    Snapshot s;
+#if defined(__linux__)
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    const double elapsedSec = lastSampleMs > 0.0 ? (nowMs - lastSampleMs) * 0.001 : 0.0;
+    lastSampleMs = nowMs;
+    const double ticksPerSec = (double) sysconf(_SC_CLK_TCK);
+
+    // System: busy share of all jiffies since the last round
+    {
+        std::istringstream cpu(readFirstLine("/proc/stat"));
+        std::string label;
+        cpu >> label;
+        juce::int64 value = 0, total = 0, idle = 0;
+        for (int i = 0; cpu >> value; ++i) {
+            total += value;
+            if (i == 3) idle = value;
+        }
+        if (label == "cpu" && lastSystemTotal > 0 && total > lastSystemTotal)
+            s.systemCpuPercent = (float) (100.0 * (double) ((total - lastSystemTotal) - (idle - lastSystemIdle))
+                                          / (double) (total - lastSystemTotal));
+        lastSystemTotal = total;
+        lastSystemIdle = idle;
+    }
+
+    // This process and its audio thread, as a share of one core
+    auto toPercent = [&](juce::int64 ticks, juce::int64 previous) {
+        if (ticks < 0 || previous < 0 || elapsedSec <= 0.0 || ticksPerSec <= 0.0) return -1.0f;
+        return (float) (100.0 * (double) (ticks - previous) / ticksPerSec / elapsedSec);
+    };
+    const juce::int64 processTicks = readTaskTicks("/proc/self/stat");
+    s.processCpuPercent = toPercent(processTicks, lastProcessTicks);
+    lastProcessTicks = processTicks;
+
+    // A new device thread (restart, device change) starts a fresh delta
+    const int audioThreadId = ThreadingPolicy::getInstance().getAudioThreadId();
+    const juce::int64 audioTicks = audioThreadId > 0
+        ? readTaskTicks("/proc/self/task/" + std::to_string(audioThreadId) + "/stat") : -1;
+    s.audioThreadCpuPercent = toPercent(audioTicks, audioThreadId == lastAudioThreadId ? lastAudioTicks : -1);
+    lastAudioTicks = audioTicks;
+    lastAudioThreadId = audioThreadId;
+
+    // Memory: MemAvailable is what the kernel could hand out without swapping
+    {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key, unit;
+        juce::int64 value = 0, totalKb = 0, availableKb = -1;
+        while (meminfo >> key >> value) {
+            std::getline(meminfo, unit);
+            if (key == "MemTotal:") totalKb = value;
+            else if (key == "MemAvailable:") availableKb = value;
+            if (totalKb > 0 && availableKb >= 0) break;
+        }
+        if (totalKb > 0 && availableKb >= 0)
+            s.memoryUsedPercent = (float) (100.0 * (double) (totalKb - availableKb) / (double) totalKb);
+
+        std::ifstream statm("/proc/self/statm");
+        juce::int64 sizePages = 0, residentPages = 0;
+        if (statm >> sizePages >> residentPages)
+            s.processResidentBytes = residentPages * (juce::int64) sysconf(_SC_PAGESIZE);
+    }
+
+    // Battery: BAT0, else BAT1; none on a desktop
+    for (const char* battery : { "BAT0", "BAT1" }) {
+        const std::string base = std::string("/sys/class/power_supply/") + battery + "/";
+        const std::string capacity = readFirstLine(base + "capacity");
+        if (capacity.empty()) continue;
+        s.batteryPercent = juce::jlimit(0, 100, juce::String(capacity).getIntValue());
+        const std::string status = readFirstLine(base + "status");
+        s.charging = status == "Charging";
+        s.onBattery = status == "Discharging";
+        break;
+    }
+#endif
+    s.rounds = ++rounds;
+    publish(s);
+}
+
+void SystemStatsSampler::publish(const Snapshot& s)
+{
+    const juce::uint32 seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    outSystemCpu.store(s.systemCpuPercent, std::memory_order_relaxed);
+    outProcessCpu.store(s.processCpuPercent, std::memory_order_relaxed);
+    outAudioCpu.store(s.audioThreadCpuPercent, std::memory_order_relaxed);
+    outMemory.store(s.memoryUsedPercent, std::memory_order_relaxed);
+    outResident.store(s.processResidentBytes, std::memory_order_relaxed);
+    outBattery.store(s.batteryPercent, std::memory_order_relaxed);
+    outCharging.store(s.charging, std::memory_order_relaxed);
+    outOnBattery.store(s.onBattery, std::memory_order_relaxed);
+    outRounds.store(s.rounds, std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+SystemStatsSampler::Snapshot SystemStatsSampler::getSnapshot() const
+{
+    Snapshot snap;
+    for (;;) {
+        const juce::uint32 before = sequence.load(std::memory_order_acquire);
+        if ((before & 1u) != 0) continue;   // writer is mid-publish (a handful of stores)
+        snap.systemCpuPercent = outSystemCpu.load(std::memory_order_relaxed);
+        snap.processCpuPercent = outProcessCpu.load(std::memory_order_relaxed);
+        snap.audioThreadCpuPercent = outAudioCpu.load(std::memory_order_relaxed);
+        snap.memoryUsedPercent = outMemory.load(std::memory_order_relaxed);
+        snap.processResidentBytes = outResident.load(std::memory_order_relaxed);
+        snap.batteryPercent = outBattery.load(std::memory_order_relaxed);
+        snap.charging = outCharging.load(std::memory_order_relaxed);
+        snap.onBattery = outOnBattery.load(std::memory_order_relaxed);
+        snap.rounds = outRounds.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) return snap;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+ * Machine and process load for the menu bar, read off the UI thread.
+ *
+ * A background thread reads /proc and the battery's sysfs node every IntervalMs and publishes
+ * the result as one snapshot behind a sequence counter, so a reader never blocks on a slow
+ * procfs or battery read and always sees values from the same round. Besides system-wide CPU it
+ * measures this process and the audio device thread (ThreadingPolicy records its thread id),
+ * both as a share of one core like top does.
+ *
+ * Linux only for now; elsewhere the snapshot stays at its "unknown" values.
+ */
+class SystemStatsSampler : private juce::Thread {
+public:
+    static constexpr int IntervalMs = 2000;
+
+    struct Snapshot {
+        float systemCpuPercent{-1.0f};       // all cores together; -1 = unknown
+        float processCpuPercent{-1.0f};      // of one core
+        float audioThreadCpuPercent{-1.0f};  // of one core, -1 until the device thread ran
+        float memoryUsedPercent{-1.0f};      // of physical memory (MemAvailable based)
+        juce::int64 processResidentBytes{0};
+        int batteryPercent{-1};              // -1: no battery
+        bool charging{false};
+        bool onBattery{false};               // discharging; "Full" / "Not charging" are on mains
+        juce::uint32 rounds{0};              // 0: nothing sampled yet
+    };
+
+    SystemStatsSampler();
+    ~SystemStatsSampler() override;
+
+    // Any thread: latest consistent snapshot
+    Snapshot getSnapshot() const;
+
+private:
+    void run() override;
+    void sample();
+    void publish(const Snapshot& s);
+
+    // Previous readings for the CPU deltas (sampler thread)
+    juce::int64 lastSystemTotal{0}, lastSystemIdle{0};
+    juce::int64 lastProcessTicks{-1}, lastAudioTicks{-1};
+    int lastAudioThreadId{-1};
+    double lastSampleMs{0.0};
+    juce::uint32 rounds{0};
+
+    // Seqlock-published snapshot: odd sequence = write in progress
+    std::atomic<juce::uint32> sequence{0};
+    std::atomic<float> outSystemCpu{-1.0f};
+    std::atomic<float> outProcessCpu{-1.0f};
+    std::atomic<float> outAudioCpu{-1.0f};
+    std::atomic<float> outMemory{-1.0f};
+    std::atomic<juce::int64> outResident{0};
+    std::atomic<int> outBattery{-1};
+    std::atomic<bool> outCharging{false};
+    std::atomic<bool> outOnBattery{false};
+    std::atomic<juce::uint32> outRounds{0};
+};
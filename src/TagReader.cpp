@@ -0,0 +1,693 @@
+#include "TagReader.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+    using Bytes = std::vector<juce::uint8>;
+
+    constexpr juce::int64 MaxTagBytes = 16 << 20;      // whole ID3 tag, only when it must be de-unsynchronised
+    constexpr juce::int64 MaxFieldBytes = 64 << 10;    // single text frame / atom / chunk
+    constexpr size_t MaxOggHeaderBytes = 256 << 10;    // comment packet; cover art past this is cut off
+    constexpr juce::int64 MaxCoverArtBytes = 8 << 20;
+    constexpr int MpegSearchBytes = 64 << 10;
+    constexpr int OggTailBytes = 64 << 10;
+
+    // ID3v1 genre list (Winamp extensions omitted)
+    constexpr const char* Id3Genres[] = {
+        "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+        "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+        "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+        "Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+        "AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+        "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+        "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychadelic", "Rave", "Showtunes",
+        "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock"
+    };
+    constexpr int NumId3Genres = (int) (sizeof(Id3Genres) / sizeof(Id3Genres[0]));
+
+    juce::uint32 be16(const juce::uint8* p) { return (juce::uint32) (p[0] << 8 | p[1]); }
+    juce::uint32 be24(const juce::uint8* p) { return (juce::uint32) (p[0] << 16 | p[1] << 8 | p[2]); }
+    juce::uint32 be32(const juce::uint8* p) { return (juce::uint32) p[0] << 24 | (juce::uint32) (p[1] << 16 | p[2] << 8 | p[3]); }
+    juce::uint64 be64(const juce::uint8* p) { return (juce::uint64) be32(p) << 32 | be32(p + 4); }
+    juce::uint32 le16(const juce::uint8* p) { return (juce::uint32) (p[1] << 8 | p[0]); }
+    juce::uint32 le32(const juce::uint8* p) { return (juce::uint32) p[3] << 24 | (juce::uint32) (p[2] << 16 | p[1] << 8 | p[0]); }
+    juce::uint64 le64(const juce::uint8* p) { return (juce::uint64) le32(p + 4) << 32 | le32(p); }
+    juce::uint32 syncsafe(const juce::uint8* p) { return (juce::uint32) ((p[0] & 0x7F) << 21 | (p[1] & 0x7F) << 14 | (p[2] & 0x7F) << 7 | (p[3] & 0x7F)); }
+
+    bool readExact(juce::InputStream& in, void* dest, juce::int64 numBytes)
+    {
+        return numBytes >= 0 && in.read(dest, (int) numBytes) == (int) numBytes;
+    }
+
+    bool readBytes(juce::InputStream& in, juce::int64 numBytes, Bytes& out)
+    {
+        out.resize((size_t) std::max<juce::int64>(0, numBytes));
+        return readExact(in, out.data(), numBytes);
+    }
+
+    juce::String fromCodePoints(std::vector<juce::juce_wchar>& chars)
+    {
+        chars.push_back(0);
+        return juce::String(juce::CharPointer_UTF32(chars.data()));
+    }
+
+    juce::String latin1(const juce::uint8* p, size_t len)
+    {
+        std::vector<juce::juce_wchar> chars;
+        for (size_t i = 0; i < len && p[i] != 0; ++i) chars.push_back((juce::juce_wchar) p[i]);
+        return fromCodePoints(chars);
+    }
+
+    // First value of an ID3 text field; encodings 0 Latin-1, 1 UTF-16 with BOM, 2 UTF-16BE, 3 UTF-8
+    juce::String decodeId3Text(juce::uint8 encoding, const juce::uint8* p, size_t len)
+    {
+        if (encoding == 0) return latin1(p, len);
+        if (encoding == 3) {
+            size_t n = 0;
+            while (n < len && p[n] != 0) ++n;
+            return juce::String::fromUTF8((const char*) p, (int) n);
+        }
+
+        bool bigEndian = encoding == 2;
+        size_t i = 0;
+        if (encoding == 1 && len >= 2) {
+            if (p[0] == 0xFF && p[1] == 0xFE) { bigEndian = false; i = 2; }
+            else if (p[0] == 0xFE && p[1] == 0xFF) { bigEndian = true; i = 2; }
+        }
+        auto unit = [&](size_t at) { return bigEndian ? be16(p + at) : le16(p + at); };
+        std::vector<juce::juce_wchar> chars;
+        for (; i + 1 < len; i += 2) {
+            juce::uint32 c = unit(i);
+            if (c == 0) break;
+            if (c >= 0xD800 && c < 0xDC00 && i + 3 < len) {
+                const juce::uint32 low = unit(i + 2);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                }
+            }
+            chars.push_back((juce::juce_wchar) c);
+        }
+        return fromCodePoints(chars);
+    }
+
+    // "(17)", "17" or "(17)Rock" -> "Rock"
+    juce::String resolveGenre(const juce::String& genre)
+    {
+        juce::String number = genre;
+        if (genre.startsWithChar('(')) {
+            const juce::String rest = genre.fromFirstOccurrenceOf(")", false, false);
+            if (rest.isNotEmpty()) return rest;
+            number = genre.substring(1).upToFirstOccurrenceOf(")", false, false);
+        }
+        if (number.isEmpty() || !number.containsOnly("0123456789")) return genre;
+        const int index = number.getIntValue();
+        return index < NumId3Genres ? juce::String(Id3Genres[index]) : genre;
+    }
+
+    // field: title, artist, album, genre, year, comment, bpm or key. The first value wins.
+    void applyField(TagReader::Tags& tags, const char* field, const juce::String& raw)
+    {
+        const juce::String value = raw.trim();
+        if (value.isEmpty()) return;
+        auto set = [&](juce::String& target, const juce::String& v) { if (target.isEmpty()) target = v; };
+
+        if (std::strcmp(field, "title") == 0) set(tags.title, value);
+        else if (std::strcmp(field, "artist") == 0) set(tags.artist, value);
+        else if (std::strcmp(field, "album") == 0) set(tags.album, value);
+        else if (std::strcmp(field, "genre") == 0) set(tags.genre, resolveGenre(value));
+        else if (std::strcmp(field, "year") == 0) set(tags.year, value.substring(0, 4));
+        else if (std::strcmp(field, "comment") == 0) set(tags.comment, value);
+        else if (std::strcmp(field, "key") == 0) set(tags.key, value);
+        else if (std::strcmp(field, "bpm") == 0 && tags.bpm <= 0.0) {
+            const double bpm = value.getDoubleValue();
+            if (bpm > 0.0) tags.bpm = bpm;
+        }
+    }
+
+    //==============================================================================
+    // ID3
+
+    const char* id3Field(const juce::String& id)
+    {
+        if (id == "TIT2" || id == "TT2") return "title";
+        if (id == "TPE1" || id == "TP1") return "artist";
+        if (id == "TALB" || id == "TAL") return "album";
+        if (id == "TCON" || id == "TCO") return "genre";
+        if (id == "TYER" || id == "TYE" || id == "TDRC") return "year";
+        if (id == "COMM" || id == "COM") return "comment";
+        if (id == "TBPM" || id == "TBP") return "bpm";
+        if (id == "TKEY" || id == "TKE") return "key";
+        return nullptr;
+    }
+
+    void undoUnsync(Bytes& data)
+    {
+        size_t out = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[out++] = data[i];
+            if (data[i] == 0xFF && i + 1 < data.size() && data[i + 1] == 0x00) ++i;
+        }
+        data.resize(out);
+    }
+
+    juce::String id3FrameText(bool isComment, const Bytes& frame)
+    {
+        if (frame.empty()) return {};
+        const juce::uint8 encoding = frame[0];
+        size_t pos = 1;
+        if (isComment) {
+            // Language, then a terminated description; iTunes keeps its own data in described comments
+            pos += 3;
+            const size_t width = (encoding == 1 || encoding == 2) ? 2 : 1;
+            const size_t descStart = pos;
+            while (pos + width <= frame.size() && !(frame[pos] == 0 && (width == 1 || frame[pos + 1] == 0))) pos += width;
+            if (pos > frame.size()) return {};
+            const juce::String description = decodeId3Text(encoding, frame.data() + descStart, pos - descStart);
+            if (description.startsWith("iTun")) return {};
+            pos += width;
+            if (pos > frame.size()) return {};
+        }
+        return decodeId3Text(encoding, frame.data() + pos, frame.size() - pos);
+    }
+
+    // APIC: encoding, MIME type, picture type, description, data. v2.2 PIC has a 3-letter format.
+    void readId3Picture(int version, const Bytes& frame, juce::MemoryBlock& out)
+    {
+        if (frame.size() < 4) return;
+        const juce::uint8 encoding = frame[0];
+        size_t pos = 1;
+        if (version == 2) {
+            pos += 3;
+        } else {
+            while (pos < frame.size() && frame[pos] != 0) ++pos;
+            ++pos;   // MIME terminator
+        }
+        ++pos;       // picture type
+        const size_t width = (encoding == 1 || encoding == 2) ? 2 : 1;
+        while (pos + width <= frame.size() && !(frame[pos] == 0 && (width == 1 || frame[pos + 1] == 0))) pos += width;
+        pos += width;
+        if (pos < frame.size()) out.replaceAll(frame.data() + pos, frame.size() - pos);
+    }
+
+    void readId3Frames(juce::InputStream& in, juce::int64 end, int version, bool unsyncFrames, TagReader::Tags& tags)
+    {
+        const int headerSize = version == 2 ? 6 : 10;
+        juce::uint8 header[10];
+        Bytes frame;
+        while (in.getPosition() + headerSize <= end && readExact(in, header, headerSize)) {
+            if (header[0] == 0) break;   // padding
+
+            juce::String id;
+            juce::int64 size;
+            juce::uint8 flags = 0;
+            if (version == 2) {
+                id = juce::String((const char*) header, 3);
+                size = be24(header + 3);
+            } else {
+                id = juce::String((const char*) header, 4);
+                size = version == 4 ? syncsafe(header + 4) : be32(header + 4);
+                flags = header[9];
+            }
+            const juce::int64 next = in.getPosition() + size;
+            if (size <= 0 || next > end) break;
+
+            // v2.3: 0x80 compressed, 0x40 encrypted, 0x20 group byte; v2.4: 0x08 / 0x04, 0x40 group
+            // byte, 0x02 unsynchronised, 0x01 data length prefix
+            const bool opaque = version == 3 ? (flags & 0xC0) != 0 : version == 4 && (flags & 0x0C) != 0;
+            auto readPayload = [&](juce::int64 limit) {
+                if (opaque || size > limit || !readBytes(in, size, frame)) return false;
+                size_t skip = 0;
+                if (version == 3 && (flags & 0x20)) skip += 1;
+                if (version == 4 && (flags & 0x40)) skip += 1;
+                if (version == 4 && (flags & 0x01)) skip += 4;
+                frame.erase(frame.begin(), frame.begin() + (std::ptrdiff_t) std::min(skip, frame.size()));
+                if (unsyncFrames || (version == 4 && (flags & 0x02))) undoUnsync(frame);
+                return true;
+            };
+            const char* field = id3Field(id);
+            if (field != nullptr && readPayload(MaxFieldBytes)) {
+                applyField(tags, field, id3FrameText(std::strcmp(field, "comment") == 0, frame));
+            } else if ((id == "APIC" || id == "PIC") && tags.wantCoverArt && tags.coverArt.isEmpty()
+                       && readPayload(MaxCoverArtBytes)) {
+                readId3Picture(version, frame, tags.coverArt);
+            }
+            in.setPosition(next);
+        }
+    }
+
+    // ID3v2 tag at the stream position: its end offset, or -1 (position unchanged) if there is none
+    juce::int64 readId3v2(juce::InputStream& in, TagReader::Tags& tags)
+    {
+        const juce::int64 start = in.getPosition();
+        juce::uint8 h[10];
+        if (!readExact(in, h, 10) || std::memcmp(h, "ID3", 3) != 0 || h[3] < 2 || h[3] > 4) {
+            in.setPosition(start);
+            return -1;
+        }
+        const int version = h[3];
+        const juce::uint8 flags = h[5];
+        const juce::int64 framesEnd = start + 10 + syncsafe(h + 6);
+        const juce::int64 end = framesEnd + ((version == 4 && (flags & 0x10)) ? 10 : 0);
+
+        auto skipExtendedHeader = [&](juce::InputStream& s) {
+            juce::uint8 e[4];
+            if (version < 3 || !(flags & 0x40) || !readExact(s, e, 4)) return;
+            s.skipNextBytes(version == 3 ? (juce::int64) be32(e) : (juce::int64) syncsafe(e) - 4);
+        };
+
+        if (version < 4 && (flags & 0x80)) {
+            // Whole-tag unsynchronisation: undone in memory, frame sizes count the decoded bytes
+            Bytes raw;
+            if (framesEnd - start - 10 <= MaxTagBytes && readBytes(in, framesEnd - start - 10, raw)) {
+                undoUnsync(raw);
+                juce::MemoryInputStream mem(raw.data(), raw.size(), false);
+                skipExtendedHeader(mem);
+                readId3Frames(mem, (juce::int64) raw.size(), version, false, tags);
+            }
+        } else {
+            skipExtendedHeader(in);
+            readId3Frames(in, framesEnd, version, version == 4 && (flags & 0x80), tags);
+        }
+        in.setPosition(end);
+        return end;
+    }
+
+    // ID3v1 tags at the end of the file; returns where the audio ends
+    juce::int64 readId3v1(juce::InputStream& in, juce::int64 fileSize, TagReader::Tags& tags)
+    {
+        juce::uint8 t[128];
+        if (fileSize < 128 || !in.setPosition(fileSize - 128) || !readExact(in, t, 128) || std::memcmp(t, "TAG", 3) != 0)
+            return fileSize;
+        applyField(tags, "title", latin1(t + 3, 30));
+        applyField(tags, "artist", latin1(t + 33, 30));
+        applyField(tags, "album", latin1(t + 63, 30));
+        applyField(tags, "year", latin1(t + 93, 4));
+        applyField(tags, "comment", latin1(t + 97, 30));
+        if (t[127] < NumId3Genres) applyField(tags, "genre", Id3Genres[t[127]]);
+        return fileSize - 128;
+    }
+
+    //==============================================================================
+    // MPEG audio
+
+    struct MpegHeader {
+        int version;      // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+        int layer;        // 1-3
+        int bitrateKbps;
+        int sampleRate;
+        int samplesPerFrame;
+        int frameBytes;
+        int sideInfoBytes;
+    };
+
+    bool parseMpegHeader(const juce::uint8* p, MpegHeader& h)
+    {
+        static constexpr short Bitrates[2][3][15] = {
+            { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+              { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+              { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 } },
+            { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } }
+        };
+        static constexpr int Rates[3] = { 44100, 48000, 32000 };
+
+        if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+        const int version = (p[1] >> 3) & 3;
+        const int layerBits = (p[1] >> 1) & 3;
+        const int bitrateIndex = p[2] >> 4;
+        const int rateIndex = (p[2] >> 2) & 3;
+        // layer bits 00 is ADTS (AAC), which this doesn't measure
+        if (version == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) return false;
+
+        const bool mpeg1 = version == 3;
+        const bool mono = (p[3] >> 6) == 3;
+        const int padding = (p[2] >> 1) & 1;
+        h.version = version;
+        h.layer = 4 - layerBits;
+        h.bitrateKbps = Bitrates[mpeg1 ? 0 : 1][h.layer - 1][bitrateIndex];
+        h.sampleRate = Rates[rateIndex] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+        h.samplesPerFrame = h.layer == 1 ? 384 : (h.layer == 2 || mpeg1) ? 1152 : 576;
+        h.frameBytes = h.layer == 1 ? (12 * h.bitrateKbps * 1000 / h.sampleRate + padding) * 4
+                                    : h.samplesPerFrame / 8 * h.bitrateKbps * 1000 / h.sampleRate + padding;
+        h.sideInfoBytes = h.layer != 3 ? 0 : mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+        return h.frameBytes > 4;
+    }
+
+    // First frame with a matching successor; Xing / Info / VBRI frame count, else the CBR bitrate
+    bool readMpegDuration(juce::InputStream& in, juce::int64 audioStart, juce::int64 audioEnd, double& seconds)
+    {
+        Bytes buf((size_t) MpegSearchBytes);
+        if (!in.setPosition(audioStart)) return false;
+        const int n = in.read(buf.data(), MpegSearchBytes);
+        const juce::uint8* p = buf.data();
+
+        for (int i = 0; i + 4 <= n; ++i) {
+            MpegHeader h;
+            if (!parseMpegHeader(p + i, h)) continue;
+            if (i + h.frameBytes + 4 <= n) {
+                MpegHeader next;
+                if (!parseMpegHeader(p + i + h.frameBytes, next) || next.version != h.version
+                    || next.layer != h.layer || next.sampleRate != h.sampleRate)
+                    continue;
+            }
+
+            juce::uint32 frames = 0;
+            const int xing = i + 4 + h.sideInfoBytes;
+            const int vbri = i + 36;
+            if (xing + 12 <= n && (std::memcmp(p + xing, "Xing", 4) == 0 || std::memcmp(p + xing, "Info", 4) == 0)) {
+                if (be32(p + xing + 4) & 1) frames = be32(p + xing + 8);
+            } else if (vbri + 18 <= n && std::memcmp(p + vbri, "VBRI", 4) == 0) {
+                frames = be32(p + vbri + 14);
+            }
+
+            if (frames > 0) seconds = (double) frames * h.samplesPerFrame / h.sampleRate;
+            else seconds = (double) (audioEnd - audioStart - i) * 8.0 / (h.bitrateKbps * 1000.0);
+            return seconds > 0.0;
+        }
+        return false;
+    }
+
+    //==============================================================================
+    // Vorbis comments (FLAC, Ogg Vorbis, Opus)
+
+    void readVorbisComments(const juce::uint8* p, size_t len, TagReader::Tags& tags)
+    {
+        if (len < 4) return;
+        size_t pos = 4 + (size_t) le32(p);   // vendor string
+        if (pos + 4 > len) return;
+        const juce::uint32 count = le32(p + pos);
+        pos += 4;
+        for (juce::uint32 i = 0; i < count && pos + 4 <= len; ++i) {
+            const size_t size = le32(p + pos);
+            pos += 4;
+            if (size > len - pos) break;   // truncated (cover art past the read cap)
+            const juce::String entry = juce::String::fromUTF8((const char*) p + pos, (int) size);
+            pos += size;
+
+            const juce::String name = entry.upToFirstOccurrenceOf("=", false, false).toUpperCase();
+            const juce::String value = entry.fromFirstOccurrenceOf("=", false, false);
+            if (name == "TITLE") applyField(tags, "title", value);
+            else if (name == "ARTIST") applyField(tags, "artist", value);
+            else if (name == "ALBUM") applyField(tags, "album", value);
+            else if (name == "GENRE") applyField(tags, "genre", value);
+            else if (name == "DATE" || name == "YEAR") applyField(tags, "year", value);
+            else if (name == "COMMENT" || name == "DESCRIPTION") applyField(tags, "comment", value);
+            else if (name == "BPM" || name == "TEMPO") applyField(tags, "bpm", value);
+            else if (name == "INITIALKEY" || name == "KEY") applyField(tags, "key", value);
+        }
+    }
+
+    // PICTURE block: type, MIME and description (length-prefixed), 4 x geometry, data length, data
+    void readFlacPicture(const Bytes& block, juce::MemoryBlock& out)
+    {
+        size_t pos = 4;
+        for (int field = 0; field < 2; ++field) {
+            if (pos + 4 > block.size()) return;
+            pos += 4 + (size_t) be32(block.data() + pos);
+        }
+        pos += 16;
+        if (pos + 4 > block.size()) return;
+        const size_t length = be32(block.data() + pos);
+        pos += 4;
+        if (length > 0 && length <= block.size() - pos) out.replaceAll(block.data() + pos, length);
+    }
+
+    bool readFlac(juce::InputStream& in, TagReader::Tags& tags)
+    {
+        juce::uint8 magic[4];
+        if (!readExact(in, magic, 4) || std::memcmp(magic, "fLaC", 4) != 0) return false;
+
+        bool haveStreamInfo = false;
+        Bytes block;
+        for (bool last = false; !last;) {
+            juce::uint8 h[4];
+            if (!readExact(in, h, 4)) break;
+            last = (h[0] & 0x80) != 0;
+            const int type = h[0] & 0x7F;
+            const juce::int64 size = be24(h + 1);
+            const juce::int64 next = in.getPosition() + size;
+
+            if (type == 0 && size >= 18 && readBytes(in, 18, block)) {
+                const juce::uint32 rate = (juce::uint32) block[10] << 12 | (juce::uint32) block[11] << 4 | block[12] >> 4;
+                const juce::uint64 samples = (juce::uint64) (block[13] & 0x0F) << 32 | be32(block.data() + 14);
+                if (rate > 0) tags.durationSeconds = (double) samples / rate;
+                haveStreamInfo = true;
+            } else if (type == 4 && size <= MaxFieldBytes * 16 && readBytes(in, size, block)) {
+                readVorbisComments(block.data(), block.size(), tags);
+            } else if (type == 6 && tags.wantCoverArt && tags.coverArt.isEmpty() && size <= MaxCoverArtBytes
+                       && readBytes(in, size, block)) {
+                readFlacPicture(block, tags.coverArt);
+            }
+            if (!in.setPosition(next)) break;
+        }
+        return haveStreamInfo;
+    }
+
+    bool readOgg(juce::InputStream& in, juce::int64 fileSize, TagReader::Tags& tags)
+    {
+        // Reassemble the first two packets (identification, comments) of the first stream
+        std::vector<Bytes> packets(1);
+        juce::uint32 serial = 0;
+        bool haveSerial = false;
+        size_t total = 0;
+        Bytes body;
+        while (packets.size() <= 2 && total < MaxOggHeaderBytes) {
+            juce::uint8 h[27], lacing[255];
+            if (!readExact(in, h, 27) || std::memcmp(h, "OggS", 4) != 0 || !readExact(in, lacing, h[26])) break;
+            int bodySize = 0;
+            for (int i = 0; i < h[26]; ++i) bodySize += lacing[i];
+
+            const juce::uint32 pageSerial = le32(h + 14);
+            if (!haveSerial) { serial = pageSerial; haveSerial = true; }
+            if (pageSerial != serial) { in.skipNextBytes(bodySize); continue; }
+            if (!readBytes(in, bodySize, body)) break;
+
+            size_t offset = 0;
+            for (int i = 0; i < h[26] && packets.size() <= 2; ++i) {
+                packets.back().insert(packets.back().end(), body.begin() + (std::ptrdiff_t) offset,
+                                      body.begin() + (std::ptrdiff_t) (offset + lacing[i]));
+                offset += lacing[i];
+                total += lacing[i];
+                if (lacing[i] < 255) packets.emplace_back();
+            }
+        }
+        if (packets.size() < 2) return false;
+
+        const Bytes& ident = packets[0];
+        const Bytes& comments = packets[1];
+        double rate = 0.0;
+        juce::int64 preSkip = 0;
+        if (ident.size() >= 16 && std::memcmp(ident.data(), "\x01vorbis", 7) == 0) {
+            rate = le32(ident.data() + 12);
+            if (comments.size() > 7 && std::memcmp(comments.data(), "\x03vorbis", 7) == 0)
+                readVorbisComments(comments.data() + 7, comments.size() - 7, tags);
+        } else if (ident.size() >= 19 && std::memcmp(ident.data(), "OpusHead", 8) == 0) {
+            rate = 48000.0;   // Opus granules always count 48 kHz samples
+            preSkip = le16(ident.data() + 10);
+            if (comments.size() > 8 && std::memcmp(comments.data(), "OpusTags", 8) == 0)
+                readVorbisComments(comments.data() + 8, comments.size() - 8, tags);
+        } else {
+            return false;
+        }
+
+        // Duration: granule position of the stream's last page
+        const int tailSize = (int) std::min<juce::int64>(OggTailBytes, fileSize);
+        Bytes tail;
+        if (rate > 0.0 && in.setPosition(fileSize - tailSize) && readBytes(in, tailSize, tail)) {
+            for (int i = tailSize - 27; i >= 0; --i) {
+                if (std::memcmp(tail.data() + i, "OggS", 4) != 0 || le32(tail.data() + i + 14) != serial) continue;
+                const juce::int64 granule = (juce::int64) le64(tail.data() + i + 6);
+                if (granule > preSkip) tags.durationSeconds = (double) (granule - preSkip) / rate;
+                break;
+            }
+        }
+        return true;
+    }
+
+    //==============================================================================
+    // MP4
+
+    struct Atom {
+        char type[4];
+        juce::int64 body;
+        juce::int64 end;
+        bool is(const char* t) const { return std::memcmp(type, t, 4) == 0; }
+    };
+
+    bool readAtom(juce::InputStream& in, juce::int64 limit, Atom& atom)
+    {
+        const juce::int64 start = in.getPosition();
+        juce::uint8 h[8];
+        if (start + 8 > limit || !readExact(in, h, 8)) return false;
+        std::memcpy(atom.type, h + 4, 4);
+        juce::int64 size = be32(h);
+        juce::int64 header = 8;
+        if (size == 1) {
+            juce::uint8 large[8];
+            if (!readExact(in, large, 8)) return false;
+            size = (juce::int64) be64(large);
+            header = 16;
+        } else if (size == 0) {
+            size = limit - start;
+        }
+        if (size < header || start + size > limit) return false;
+        atom.body = start + header;
+        atom.end = start + size;
+        return true;
+    }
+
+    // One ilst item: its "data" payload, and for "----" items the "name" it carries
+    void readMp4Item(const Atom& item, const Bytes& body, TagReader::Tags& tags)
+    {
+        juce::MemoryInputStream in(body.data(), body.size(), false);
+        juce::String freeformName;
+        Atom child;
+        while (readAtom(in, (juce::int64) body.size(), child)) {
+            const size_t at = (size_t) child.body;
+            const size_t size = (size_t) (child.end - child.body);
+            if (child.is("name") && size > 4) {
+                freeformName = juce::String::fromUTF8((const char*) body.data() + at + 4, (int) size - 4);
+            } else if (child.is("data") && size >= 8) {
+                const juce::uint8* p = body.data() + at + 8;
+                const size_t len = size - 8;
+                if (item.is("covr")) {
+                    if (tags.wantCoverArt && tags.coverArt.isEmpty() && len > 0) tags.coverArt.replaceAll(p, len);
+                    in.setPosition(child.end);
+                    continue;
+                }
+                const juce::String text = juce::String::fromUTF8((const char*) p, (int) len);
+                if (item.is("\xA9nam")) applyField(tags, "title", text);
+                else if (item.is("\xA9" "ART")) applyField(tags, "artist", text);
+                else if (item.is("\xA9" "alb")) applyField(tags, "album", text);
+                else if (item.is("\xA9gen")) applyField(tags, "genre", text);
+                else if (item.is("\xA9" "day")) applyField(tags, "year", text);
+                else if (item.is("\xA9" "cmt")) applyField(tags, "comment", text);
+                else if (item.is("tmpo") && len >= 2) applyField(tags, "bpm", juce::String((int) be16(p)));
+                else if (item.is("gnre") && len >= 2 && be16(p) > 0) applyField(tags, "genre", juce::String((int) be16(p) - 1));
+                else if (item.is("----") && freeformName.equalsIgnoreCase("initialkey")) applyField(tags, "key", text);
+            }
+            in.setPosition(child.end);
+        }
+    }
+
+    void readMp4Container(juce::InputStream& in, juce::int64 end, TagReader::Tags& tags, double& duration, bool insideIlst)
+    {
+        Atom atom;
+        Bytes body;
+        while (readAtom(in, end, atom)) {
+            if (insideIlst) {
+                // Large items (cover art) are skipped unless the picture is wanted
+                const juce::int64 limit = atom.is("covr") && tags.wantCoverArt ? MaxCoverArtBytes : MaxFieldBytes;
+                if (atom.end - atom.body <= limit && readBytes(in, atom.end - atom.body, body))
+                    readMp4Item(atom, body, tags);
+            } else if (atom.is("mvhd")) {
+                juce::uint8 h[32];
+                if (readExact(in, h, 32)) {
+                    const bool v1 = h[0] == 1;
+                    const juce::uint32 timescale = v1 ? be32(h + 20) : be32(h + 12);
+                    const juce::uint64 length = v1 ? be64(h + 24) : be32(h + 16);
+                    if (timescale > 0) duration = (double) length / timescale;
+                }
+            } else if (atom.is("moov") || atom.is("udta") || atom.is("ilst")) {
+                readMp4Container(in, atom.end, tags, duration, atom.is("ilst"));
+            } else if (atom.is("meta")) {
+                // A full box (version / flags first) in MP4, a plain container in QuickTime
+                juce::uint8 peek[8];
+                if (readExact(in, peek, 8)) {
+                    in.setPosition(atom.body + (std::memcmp(peek + 4, "hdlr", 4) == 0 ? 0 : 4));
+                    readMp4Container(in, atom.end, tags, duration, false);
+                }
+            }
+            if (!in.setPosition(atom.end)) break;
+        }
+    }
+
+    bool readMp4(juce::InputStream& in, juce::int64 fileSize, TagReader::Tags& tags)
+    {
+        double duration = 0.0;
+        readMp4Container(in, fileSize, tags, duration, false);
+        tags.durationSeconds = duration;
+        return duration > 0.0;
+    }
+
+    //==============================================================================
+    // RIFF / WAVE
+
+    bool readWav(juce::InputStream& in, juce::int64 fileSize, TagReader::Tags& tags)
+    {
+        in.skipNextBytes(12);   // "RIFF" size "WAVE"
+        juce::uint32 byteRate = 0;
+        juce::int64 dataSize = -1;
+        Bytes body;
+        juce::uint8 h[8];
+        while (in.getPosition() + 8 <= fileSize && readExact(in, h, 8)) {
+            const juce::int64 start = in.getPosition();
+            juce::int64 size = le32(h + 4);
+            if (std::memcmp(h, "data", 4) == 0) {
+                // Streamed writers leave the size unset
+                dataSize = (size == 0 || size == 0xFFFFFFFF || start + size > fileSize) ? fileSize - start : size;
+                size = dataSize;
+            } else if (std::memcmp(h, "fmt ", 4) == 0 && size >= 16 && readBytes(in, 16, body)) {
+                byteRate = le32(body.data() + 8);
+            } else if (std::memcmp(h, "LIST", 4) == 0 && size >= 4 && size <= MaxFieldBytes * 16 && readBytes(in, size, body)
+                       && std::memcmp(body.data(), "INFO", 4) == 0) {
+                for (size_t pos = 4; pos + 8 <= body.size();) {
+                    const size_t len = le32(body.data() + pos + 4);
+                    if (len > body.size() - pos - 8) break;
+                    const juce::String value = latin1(body.data() + pos + 8, len);
+                    const char* id = (const char*) body.data() + pos;
+                    if (std::memcmp(id, "INAM", 4) == 0) applyField(tags, "title", value);
+                    else if (std::memcmp(id, "IART", 4) == 0) applyField(tags, "artist", value);
+                    else if (std::memcmp(id, "IPRD", 4) == 0) applyField(tags, "album", value);
+                    else if (std::memcmp(id, "IGNR", 4) == 0) applyField(tags, "genre", value);
+                    else if (std::memcmp(id, "ICRD", 4) == 0) applyField(tags, "year", value);
+                    else if (std::memcmp(id, "ICMT", 4) == 0) applyField(tags, "comment", value);
+                    pos += 8 + len + (len & 1);
+                }
+            } else if ((std::memcmp(h, "id3 ", 4) == 0 || std::memcmp(h, "ID3 ", 4) == 0) && size <= MaxTagBytes
+                       && readBytes(in, size, body)) {
+                juce::MemoryInputStream mem(body.data(), body.size(), false);
+                readId3v2(mem, tags);
+            }
+            if (!in.setPosition(start + size + (size & 1))) break;
+        }
+        if (byteRate > 0 && dataSize > 0) tags.durationSeconds = (double) dataSize / byteRate;
+        return byteRate > 0 && dataSize >= 0;
+    }
+}
+
+bool TagReader::read(const juce::File& file, Tags& tags)
+{
+    juce::FileInputStream in(file);
+    if (!in.openedOk()) return false;
+    const juce::int64 fileSize = in.getTotalLength();
+
+    Tags result;
+    result.wantCoverArt = tags.wantCoverArt;
+    const juce::int64 id3End = readId3v2(in, result);
+    const juce::int64 start = std::max<juce::int64>(0, id3End);
+    juce::uint8 magic[12] = {};
+    if (!in.setPosition(start)) return false;
+    in.read(magic, sizeof(magic));
+    in.setPosition(start);
+
+    bool ok;
+    if (std::memcmp(magic, "fLaC", 4) == 0) ok = readFlac(in, result);
+    else if (std::memcmp(magic, "OggS", 4) == 0) ok = readOgg(in, fileSize, result);
+    else if (std::memcmp(magic + 4, "ftyp", 4) == 0) ok = readMp4(in, fileSize, result);
+    else if (std::memcmp(magic, "RIFF", 4) == 0 && std::memcmp(magic + 8, "WAVE", 4) == 0) ok = readWav(in, fileSize, result);
+    else {
+        // MPEG audio, or ADTS behind an ID3 tag: tags only, no duration
+        const juce::int64 audioEnd = readId3v1(in, fileSize, result);
+        double seconds = 0.0;
+        if (readMpegDuration(in, start, audioEnd, seconds)) result.durationSeconds = seconds;
+        ok = id3End >= 0 || result.durationSeconds > 0.0;
+    }
+    if (!ok) return false;
+
+    tags = std::move(result);
+    return true;
+}
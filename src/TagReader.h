@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Tags and duration of an audio file, read straight from its container headers instead of
+ * through an AudioFormatReader.
+ *
+ * Understands ID3v2.2-2.4 (plus ID3v1) with the first MPEG frame's Xing / VBRI header or CBR
+ * bitrate for the duration, FLAC metadata blocks, Ogg Vorbis / Opus comment headers with the
+ * last page's granule position, MP4 atoms (mvhd, ilst) and RIFF/WAVE (fmt, data, LIST/INFO,
+ * id3). Only headers are read; large payloads such as cover art or the audio itself are skipped
+ * by seeking, so a file costs a few KB of I/O and no decoder. With wantCoverArt the first
+ * embedded picture (ID3 APIC, FLAC PICTURE, MP4 covr) is read as well. Safe to call from any
+ * thread.
+ */
+class TagReader {
+public:
+    struct Tags {
+        juce::String title, artist, album, genre, year, comment, key;
+        double bpm{0.0};
+        double durationSeconds{0.0};   // 0 if the container doesn't say (e.g. raw ADTS)
+        bool wantCoverArt{false};      // in: also extract the embedded picture
+        juce::MemoryBlock coverArt;    // encoded image (JPEG / PNG) as stored, empty if none
+    };
+
+    // False if the file isn't one of the containers above or its headers don't parse
+    static bool read(const juce::File& file, Tags& tags);
+};
@@ -0,0 +1,218 @@
+#include "TempoEstimator.h"
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+    // Of the onset smoothing ahead of the beat tracker, in periods
+    constexpr double SmoothingPeriods = 1.0 / 32.0;
+    // Beats at either end weaker than this times the RMS of all of them are dropped
+    constexpr double TrimLevel = 0.5;
+    constexpr size_t MinBeats = 8;
+
+    double tempoPrior(double bpm)
+    {
+        const double octaves = std::log2(bpm / TempoEstimator::PriorBpm) / TempoEstimator::PriorOctaves;
+        return std::exp(-0.5 * octaves * octaves);
+    }
+
+    // Offset of the vertex of the parabola through (-1, a), (0, b), (1, c); 0 if it isn't a peak
+    double parabolicPeak(double a, double b, double c)
+    {
+        const double denom = a - 2.0 * b + c;
+        if (denom >= 0.0) return 0.0;
+        return std::clamp(0.5 * (a - c) / denom, -0.5, 0.5);
+    }
+}
+
+AnalysisArena::Vector<float> TempoEstimator::autocorrelate(const float* x, int n, int maxLag)
+{
+    auto acf = AnalysisArena::vector<float>((size_t) std::max(0, maxLag) + 1, 0.0f);
+    if (n <= 0) return acf;
+
+    // Zero-padded to twice the length, so the circular correlation of the FFT is linear
+    int order = 1;
+    while ((1 << order) < 2 * n) ++order;
+    const int size = 1 << order;
+    juce::dsp::FFT fft(order);
+    auto data = AnalysisArena::vector<float>((size_t) size * 2, 0.0f);
+    std::copy(x, x + n, data.begin());
+    fft.performRealOnlyForwardTransform(data.data(), true);
+    for (int bin = 0; bin <= size / 2; ++bin) {
+        const float re = data[(size_t) bin * 2], im = data[(size_t) bin * 2 + 1];
+        data[(size_t) bin * 2] = re * re + im * im;
+        data[(size_t) bin * 2 + 1] = 0.0f;
+    }
+    for (int bin = size / 2 + 1; bin < size; ++bin) {
+        data[(size_t) bin * 2] = data[(size_t) (size - bin) * 2];
+        data[(size_t) bin * 2 + 1] = 0.0f;
+    }
+    fft.performRealOnlyInverseTransform(data.data());
+
+    const int lags = std::min(maxLag, n - 1);
+    std::copy(data.begin(), data.begin() + lags + 1, acf.begin());
+    return acf;
+}
+
+double TempoEstimator::findPeriod(const AnalysisArena::Vector<float>& acf, double hopSeconds, double& confidence)
+{
+    confidence = 0.0;
+    const int minLag = std::max(2, (int) std::floor(60.0 / MaxBpm / hopSeconds));
+    const int maxLag = (int) std::ceil(60.0 / MinBpm / hopSeconds);
+    if (maxLag <= minLag || acf.empty() || acf[0] <= 0.0f) return 0.0;
+    const int lastLag = (int) acf.size() - 1;
+
+    // Comb with a tooth on every multiple of the lag up to the same span for all lags, so a
+    // faster period that really repeats collects more evidence than the slower one it divides.
+    // The k-th tooth may sit k / 2 frames off the exact multiple of a whole-frame lag.
+    const int span = std::min(lastLag - CombHarmonics, CombHarmonics * maxLag);
+    auto scores = AnalysisArena::vector<double>((size_t) (maxLag - minLag + 1), 0.0);
+    for (int lag = minLag; lag <= maxLag; ++lag) {
+        double sum = 0.0;
+        for (int k = 1; k * lag <= span; ++k) {
+            const int centre = k * lag;
+            float peak = acf[(size_t) centre];
+            for (int d = 1; d <= k / 2; ++d)
+                peak = std::max({ peak, acf[(size_t) (centre - d)], acf[(size_t) (centre + d)] });
+            sum += peak;
+        }
+        scores[(size_t) (lag - minLag)] = std::max(0.0, sum / (double) acf[0]) * tempoPrior(60.0 / (lag * hopSeconds));
+    }
+
+    const auto best = std::max_element(scores.begin(), scores.end());
+    if (*best <= 0.0) return 0.0;
+    const double mean = std::accumulate(scores.begin(), scores.end(), 0.0) / (double) scores.size();
+    confidence = mean > 0.0 ? *best / mean : 0.0;
+    const auto index = (size_t) (best - scores.begin());
+    double period = (double) (minLag + (int) index);
+    if (index > 0 && index + 1 < scores.size())
+        period += parabolicPeak(scores[index - 1], scores[index], scores[index + 1]);
+
+    // The farthest tooth in reach pins the period to a fraction of a frame
+    for (int k = CombHarmonics; k > 1; --k) {
+        const int centre = (int) std::lround(k * period);
+        if (centre + k > lastLag) continue;
+        int peak = centre;
+        for (int d = -(k / 2); d <= k / 2; ++d)
+            if (acf[(size_t) (centre + d)] > acf[(size_t) peak]) peak = centre + d;
+        const double refined = (peak + parabolicPeak(acf[(size_t) peak - 1], acf[(size_t) peak], acf[(size_t) peak + 1])) / k;
+        if (std::abs(refined - period) < 1.0) period = refined;
+        break;
+    }
+    return period;
+}
+
+AnalysisArena::Vector<int> TempoEstimator::trackBeats(const AnalysisArena::Vector<float>& onset, double period)
+{
+    const int n = (int) onset.size();
+    auto beats = AnalysisArena::vector<int>();
+    if (n == 0 || period < 2.0) return beats;
+
+    // Onsets smoothed over a 32nd of a period and brought to unit RMS
+    const double sigma = std::max(0.5, period * SmoothingPeriods);
+    const int reach = (int) std::ceil(3.0 * sigma);
+    auto kernel = AnalysisArena::vector<float>((size_t) (2 * reach + 1));
+    for (int i = -reach; i <= reach; ++i)
+        kernel[(size_t) (i + reach)] = (float) std::exp(-0.5 * (i / sigma) * (i / sigma));
+    auto local = AnalysisArena::vector<float>((size_t) n, 0.0f);
+    for (int t = 0; t < n; ++t) {
+        const int from = std::max(0, t - reach), to = std::min(n - 1, t + reach);
+        float sum = 0.0f;
+        for (int s = from; s <= to; ++s) sum += onset[(size_t) s] * kernel[(size_t) (s - t + reach)];
+        local[(size_t) t] = sum;
+    }
+    const double rms = std::sqrt(std::inner_product(local.begin(), local.end(), local.begin(), 0.0) / n);
+    if (rms <= 0.0) return beats;
+    juce::FloatVectorOperations::multiply(local.data(), (float) (1.0 / rms), n);
+
+    // Penalty of each predecessor distance, half a period to two periods
+    const int nearest = std::max(1, (int) std::lround(period / 2.0));
+    const int farthest = std::max(nearest, (int) std::lround(2.0 * period));
+    auto penalty = AnalysisArena::vector<float>((size_t) (farthest - nearest + 1));
+    for (int d = nearest; d <= farthest; ++d) {
+        const double ratio = std::log(d / period);
+        penalty[(size_t) (d - nearest)] = (float) (-Tightness * ratio * ratio);
+    }
+
+    auto cumulative = AnalysisArena::vector<float>((size_t) n);
+    auto previous = AnalysisArena::vector<int>((size_t) n, -1);
+    for (int t = 0; t < n; ++t) {
+        float best = 0.0f;
+        for (int d = nearest; d <= std::min(farthest, t); ++d) {
+            const float score = cumulative[(size_t) (t - d)] + penalty[(size_t) (d - nearest)];
+            if (score > best) {
+                best = score;
+                previous[(size_t) t] = t - d;
+            }
+        }
+        cumulative[(size_t) t] = local[(size_t) t] + best;
+    }
+
+    // The path ends on the best frame of the last period
+    const int tailFrom = std::max(0, n - (int) std::lround(period));
+    int t = (int) (std::max_element(cumulative.begin() + tailFrom, cumulative.end()) - cumulative.begin());
+    for (; t >= 0; t = previous[(size_t) t]) beats.push_back(t);
+    std::reverse(beats.begin(), beats.end());
+
+    double sum = 0.0;
+    for (int beat : beats) sum += (double) local[(size_t) beat] * local[(size_t) beat];
+    const float floor = (float) (TrimLevel * std::sqrt(sum / (double) beats.size()));
+    while (!beats.empty() && local[(size_t) beats.back()] < floor) beats.pop_back();
+    const auto first = std::find_if(beats.begin(), beats.end(), [&](int beat) { return local[(size_t) beat] >= floor; });
+    beats.erase(beats.begin(), first);
+    return beats;
+}
+
+TempoEstimator::Result TempoEstimator::estimate(const std::vector<float>& novelty, double hopSeconds, double latencySeconds)
+{
+    Result result;
+    const int n = (int) novelty.size();
+    if (hopSeconds <= 0.0 || n * hopSeconds < MinSeconds) return result;
+    AnalysisArena::Track arena;
+
+    // The autocorrelation takes the curve around its mean, the beat tracker only its rises
+    const float mean = (float) (std::accumulate(novelty.begin(), novelty.end(), 0.0) / n);
+    AnalysisArena::Vector<float> centred(novelty.begin(), novelty.end(), AnalysisArena::resource());
+    juce::FloatVectorOperations::add(centred.data(), -mean, n);
+    auto onset = AnalysisArena::vector<float>((size_t) n);
+    juce::FloatVectorOperations::clip(onset.data(), centred.data(), 0.0f, std::numeric_limits<float>::max(), n);
+
+    const int maxLag = CombHarmonics * ((int) std::ceil(60.0 / MinBpm / hopSeconds) + 1);
+    auto acf = autocorrelate(centred.data(), n, maxLag);
+    // Unbiased: every lag over the number of products it sums
+    for (size_t lag = 1; lag < acf.size() && (int) lag < n; ++lag) acf[lag] *= (float) n / (float) (n - (int) lag);
+
+    const double period = findPeriod(acf, hopSeconds, result.confidence);
+    if (period <= 0.0) return result;
+    const auto frames = trackBeats(onset, period);
+    if (frames.size() < MinBeats) return result;
+
+    // Line through the beats, numbered by the estimated period so a skipped one keeps its place
+    const double periodSec = period * hopSeconds;
+    const double origin = frames.front() * hopSeconds;
+    double sumN = 0.0, sumT = 0.0, sumNN = 0.0, sumNT = 0.0;
+    for (int frame : frames) {
+        const double t = frame * hopSeconds - latencySeconds;
+        const double k = std::round((frame * hopSeconds - origin) / periodSec);
+        result.beatsSec.push_back(t);
+        sumN += k;
+        sumT += t;
+        sumNN += k * k;
+        sumNT += k * t;
+    }
+    const double count = (double) frames.size();
+    const double denom = count * sumNN - sumN * sumN;
+    if (denom <= 0.0) return result;
+    const double slope = (count * sumNT - sumN * sumT) / denom;
+    const double intercept = (sumT - slope * sumN) / count;
+    if (slope <= 0.0) return result;
+    const double bpm = 60.0 / slope;
+    if (bpm < MinBpm * 0.95 || bpm > MaxBpm * 1.05) return result;
+
+    result.bpm = bpm;
+    result.firstBeatSec = intercept - std::floor(intercept / slope) * slope;
+    return result;
+}
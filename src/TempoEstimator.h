@@ -0,0 +1,53 @@
+#pragma once
+
+#include "AnalysisArena.h"
+#include <vector>
+
+/**
+ * Tempo and beats from an onset novelty curve (the spectral flux the analysis pass takes from
+ * OnsetEngine), with no external library: BpmAnalyzer's detector when aubio isn't built in.
+ *
+ * The curve's autocorrelation comes from one juce::dsp::FFT: power spectrum of the zero-padded
+ * curve around its mean, transformed back. A comb filterbank over it scores each beat period
+ * between MinBpm and MaxBpm by all its multiples up to CombHarmonics slowest periods (so a period
+ * that really repeats beats the slower one it divides), weighted by a log-normal tempo
+ * prior around PriorBpm, PriorOctaves wide, which settles octave ambiguities the way listeners
+ * tend to. The beats are then placed by dynamic programming (Ellis): each frame takes the best
+ * predecessor half a period to two periods back, penalised by Tightness times the squared log
+ * ratio of the interval to the period, and the best path is traced back from the end. The BPM and
+ * first beat are the least-squares line through the tracked beats.
+ *
+ * Pure and single-threaded, so the same curve always gives the same result. The working buffers
+ * come from the calling thread's AnalysisArena.
+ */
+class TempoEstimator {
+public:
+    static constexpr double MinBpm = 60.0;
+    static constexpr double MaxBpm = 180.0;
+    static constexpr double PriorBpm = 120.0;
+    static constexpr double PriorOctaves = 1.0;
+    static constexpr int CombHarmonics = 4;
+    static constexpr double Tightness = 100.0;
+    static constexpr double MinSeconds = 8.0;   // shorter curves give no tempo
+
+    struct Result {
+        double bpm{0.0};
+        double firstBeatSec{0.0};       // in [0, one beat)
+        std::vector<double> beatsSec;   // as tracked
+        double confidence{0.0};         // comb peak over the filterbank's mean
+
+        bool isValid() const { return bpm > 0.0; }
+    };
+
+    // novelty[i] answers the onset at i * hopSeconds - latencySeconds
+    static Result estimate(const std::vector<float>& novelty, double hopSeconds, double latencySeconds = 0.0);
+
+    // Unnormalised linear autocorrelation of x[0..n), lags 0..maxLag
+    static AnalysisArena::Vector<float> autocorrelate(const float* x, int n, int maxLag);
+
+private:
+    // Beat period in frames (fractional), 0 without a peak; confidence as in Result
+    static double findPeriod(const AnalysisArena::Vector<float>& acf, double hopSeconds, double& confidence);
+    // Frames of the beats on the best path through onset
+    static AnalysisArena::Vector<int> trackBeats(const AnalysisArena::Vector<float>& onset, double period);
+};
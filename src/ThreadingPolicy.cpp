@@ -0,0 +1,153 @@
+#include "ThreadingPolicy.h"
+#include <iostream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+    // configure() round the calling thread has applied
+    thread_local juce::uint32 appliedGeneration = 0;
+
+    juce::String coreRange(int first, int last)
+    {
+        return first == last ? juce::String(first) : juce::String(first) + "-" + juce::String(last);
+    }
+
+    const char* describeRealtime(ThreadingPolicy::Realtime r)
+    {
+        switch (r) {
+            case ThreadingPolicy::Realtime::Already: return "already realtime";
+            case ThreadingPolicy::Realtime::Granted: return "granted";
+            case ThreadingPolicy::Realtime::Denied:  return "not permitted";
+            default:                                 return "left to the driver";
+        }
+    }
+}
+
+ThreadingPolicy& ThreadingPolicy::getInstance()
+{
+    static ThreadingPolicy instance;
+    return instance;
+}
+
+void ThreadingPolicy::configure(const Config& config)
+{
+    // Affinity masks are 32 bits wide in JUCE
+    const int cpus = juce::jlimit(1, 32, juce::SystemStats::getNumCpus());
+    const int tp = juce::jlimit(0, 100, config.threadPriority);
+    const int rt = tp <= 50 ? juce::roundToInt(juce::jmap((double) tp, 0.0, 50.0, 1.0, 8.0))
+                            : juce::roundToInt(juce::jmap((double) tp, 50.0, 100.0, 8.0, 10.0));
+
+    numCpus.store(cpus, std::memory_order_relaxed);
+    renderPriority.store(rt, std::memory_order_relaxed);
+    fifoPriority.store(10 + rt * 8, std::memory_order_relaxed);
+    if (config.isolateAudioCores && cpus >= 4) {
+        const int reserved = cpus / 2;
+        audioCore.store(cpus - 1, std::memory_order_relaxed);
+        numRenderCores.store(reserved - 1, std::memory_order_relaxed);
+        workerMask.store((1u << (juce::uint32) (cpus - reserved)) - 1u, std::memory_order_relaxed);
+    } else {
+        audioCore.store(-1, std::memory_order_relaxed);
+        numRenderCores.store(0, std::memory_order_relaxed);
+        workerMask.store(0, std::memory_order_relaxed);
+    }
+
+#if defined(_WIN32)
+    // Looked up here so the callback never loads a library
+    if (mmcssRegister.load() == nullptr) {
+        if (HMODULE avrt = LoadLibraryW(L"avrt.dll"))
+            mmcssRegister.store(reinterpret_cast<void*>(GetProcAddress(avrt, "AvSetMmThreadCharacteristicsW")));
+    }
+#endif
+
+    generation.fetch_add(1, std::memory_order_release);
+    std::cout << "ThreadingPolicy: " << describe() << std::endl;
+}
+
+void ThreadingPolicy::applyToAudioThread() noexcept
+{
+    const juce::uint32 current = generation.load(std::memory_order_acquire);
+    if (appliedGeneration == current) return;
+    appliedGeneration = current;
+
+    const int core = audioCore.load(std::memory_order_relaxed);
+    if (core >= 0) juce::Thread::setCurrentThreadAffinityMask(1u << (juce::uint32) core);
+
+    Realtime result = Realtime::Untouched;
+#if defined(__linux__)
+    audioThreadId.store((int) syscall(SYS_gettid), std::memory_order_relaxed);
+    int policy = 0;
+    sched_param param{};
+    const int wanted = juce::jmin(fifoPriority.load(std::memory_order_relaxed), sched_get_priority_max(SCHED_FIFO));
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0
+        && (policy == SCHED_FIFO || policy == SCHED_RR) && param.sched_priority >= wanted) {
+        result = Realtime::Already;
+    } else {
+        param.sched_priority = wanted;
+        result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 ? Realtime::Granted : Realtime::Denied;
+    }
+#elif defined(_WIN32)
+    using AvSetMmThreadCharacteristicsFn = HANDLE (WINAPI*)(LPCWSTR, LPDWORD);
+    if (auto* registerThread = reinterpret_cast<AvSetMmThreadCharacteristicsFn>(mmcssRegister.load())) {
+        DWORD taskIndex = 0;
+        result = registerThread(L"Pro Audio", &taskIndex) != nullptr ? Realtime::Granted : Realtime::Denied;
+    } else {
+        result = Realtime::Denied;
+    }
+#endif
+    audioRealtime.store((int) result);
+    audioApplied.store(true);
+    audioReportPending.store(true);
+}
+
+juce::uint32 ThreadingPolicy::getRenderAffinity(int index) const noexcept
+{
+    const int cpus = numCpus.load(std::memory_order_relaxed);
+    const int renderCores = numRenderCores.load(std::memory_order_relaxed);
+    if (renderCores > 0) {
+        const int core = audioCore.load(std::memory_order_relaxed) - 1 - (juce::jmax(0, index - 1) % renderCores);
+        return 1u << (juce::uint32) core;
+    }
+    // No isolation: one core per worker, core 0 left to the device callback thread
+    return cpus > 1 ? 1u << (juce::uint32) (index % cpus) : 0u;
+}
+
+void ThreadingPolicy::noteRenderWorker(bool realtime) noexcept
+{
+    (realtime ? realtimeRenderWorkers : normalRenderWorkers).fetch_add(1);
+}
+
+void ThreadingPolicy::applyToWorkerThread() noexcept
+{
+    const juce::uint32 current = generation.load(std::memory_order_acquire);
+    if (appliedGeneration == current) return;
+    appliedGeneration = current;
+    if (const juce::uint32 mask = workerMask.load(std::memory_order_relaxed))
+        juce::Thread::setCurrentThreadAffinityMask(mask);
+}
+
+juce::String ThreadingPolicy::describe() const
+{
+    const int cpus = numCpus.load();
+    const int core = audioCore.load();
+    const int renderCores = numRenderCores.load();
+    juce::String text;
+    if (core >= 0) {
+        text << "audio thread on core " << core
+             << ", render workers on cores " << coreRange(core - renderCores, core - 1)
+             << ", background workers on cores " << coreRange(0, core - renderCores - 1);
+    } else {
+        text << "no core isolation (" << cpus << " cores)";
+    }
+    if (audioApplied.load()) text << "; audio thread realtime " << describeRealtime((Realtime) audioRealtime.load());
+    else text << "; audio thread not running yet";
+    text << ", render priority " << renderPriority.load()
+         << " (" << realtimeRenderWorkers.load() << " realtime, " << normalRenderWorkers.load() << " fallback)";
+    return text;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+ * Which cores and priorities the real-time threads get, and how everything else keeps out of
+ * their way.
+ *
+ * configure() runs once at startup with Performance/ThreadPriority and
+ * Performance/IsolateAudioCores. With isolation on and at least four cores, the upper half of the
+ * machine is reserved: the top core for the device callback thread, the ones below it for the
+ * DeckRender workers. Analysis, library and prefetch workers are kept on the remaining cores, so
+ * a decode never competes with a render thread. ThreadPriority (0-100, default 50) sets the
+ * realtime priority the render workers request and the SCHED_FIFO priority (Linux) or MMCSS "Pro
+ * Audio" registration (Windows) the device thread asks for in its first callback. Where the OS
+ * refuses (no rtprio limit, no MMCSS) a thread runs on as before; describe() reports what was
+ * applied.
+ */
+class ThreadingPolicy {
+public:
+    struct Config {
+        int threadPriority = 50;
+        bool isolateAudioCores = true;
+    };
+
+    enum class Realtime { Untouched, Already, Granted, Denied };
+
+    static ThreadingPolicy& getInstance();
+
+    // UI thread, before the audio device starts
+    void configure(const Config& config);
+
+    // Device callback: pins and promotes the calling thread; a few syscalls in the first
+    // callback after configure(), a thread_local compare after that
+    void applyToAudioThread() noexcept;
+
+    // Render worker `index` (1..), before it starts. Mask 0: leave the affinity alone.
+    juce::uint32 getRenderAffinity(int index) const noexcept;
+    int getRenderPriority() const noexcept { return renderPriority.load(std::memory_order_relaxed); }
+    void noteRenderWorker(bool realtime) noexcept;
+
+    // Background worker threads, at the start of each job; cheap after the first call
+    void applyToWorkerThread() noexcept;
+
+    // Kernel thread id of the device callback thread (Linux), -1 before its first callback
+    int getAudioThreadId() const noexcept { return audioThreadId.load(std::memory_order_relaxed); }
+
+    // True once after the audio thread applied the policy, for the UI to log describe()
+    bool takeAudioThreadReport() noexcept { return audioReportPending.exchange(false); }
+    juce::String describe() const;
+
+private:
+    ThreadingPolicy() = default;
+
+    // Bumped by configure(); each thread applies the policy once per round
+    std::atomic<juce::uint32> generation{0};
+    std::atomic<int> numCpus{1};
+    std::atomic<int> audioCore{-1};            // -1: no isolation
+    std::atomic<int> numRenderCores{0};        // directly below audioCore
+    std::atomic<juce::uint32> workerMask{0};   // 0: unrestricted
+    std::atomic<int> renderPriority{8};        // juce::Thread::RealtimeOptions priority
+    std::atomic<int> fifoPriority{74};
+
+    // What the threads reported back
+    std::atomic<int> audioRealtime{(int) Realtime::Untouched};
+    std::atomic<bool> audioApplied{false};
+    std::atomic<int> audioThreadId{-1};
+    std::atomic<bool> audioReportPending{false};
+    std::atomic<int> realtimeRenderWorkers{0};
+    std::atomic<int> normalRenderWorkers{0};
+
+    std::atomic<void*> mmcssRegister{nullptr};   // AvSetMmThreadCharacteristicsW, resolved in configure()
+};
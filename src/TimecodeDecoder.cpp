@@ -0,0 +1,210 @@
+#include "TimecodeDecoder.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+namespace {
+    // Register layouts as xwax documents them for these records
+    const TimecodeDecoder::Format kFormats[] = {
+        { "serato_2a", "Serato 2nd Ed., side A", 20, 1000, 0x59017, 0x361e4, 712000, false, false, false },
+        { "serato_2b", "Serato 2nd Ed., side B", 20, 1000, 0x8f3c6, 0x4f0d8, 922000, false, false, false },
+        { "traktor_a", "Traktor Scratch, side A", 23, 2000, 0x134503, 0x041040, 1500000, true, true, true },
+        { "traktor_b", "Traktor Scratch, side B", 23, 2000, 0x32066c, 0x041040, 2110000, true, true, true },
+    };
+
+    // Carrier DC and rumble
+    constexpr double HighPassHz = 20.0;
+    // Envelope of the carrier amplitude, for needle up/down
+    constexpr double EnvelopeHz = 50.0;
+    // Alpha-beta tracker: alpha is the share of each phase residual taken into the position,
+    // beta (critically damped for that alpha) into the velocity
+    constexpr double TrackerAlpha = 1.0 / 16.0;
+    constexpr double TrackerBeta = TrackerAlpha * TrackerAlpha / (2.0 - TrackerAlpha);
+    // Needle up: the record slows to a stop over a few ms instead of freezing mid-cycle
+    constexpr double LiftDecayPerSample = 0.995;
+    // Peaks averaged into the bit reference and the phase past a peak it is read at (cycles).
+    // The hysteresis keeps a record standing on a peak from reading it over and over.
+    constexpr float RefPeaks = 48.0f;
+    constexpr double PeakHysteresis = 1.0 / 32.0;
+
+    juce::uint32 parity(juce::uint32 bits) noexcept { return (juce::uint32) (std::bitset<32>(bits).count() & 1u); }
+
+    // atan2 in cycles, [-0.5, 0.5); a few 1e-6 of a cycle off, well below the carrier's own noise
+    double angleOf(double y, double x) noexcept
+    {
+        const double ax = std::abs(x), ay = std::abs(y);
+        const double big = std::max(ax, ay);
+        if (big <= 0.0) return 0.0;
+        const double a = std::min(ax, ay) / big;
+        const double s = a * a;
+        double r = ((-0.0464964749 * s + 0.15931422) * s - 0.327622764) * s * a + a;
+        if (ay > ax) r = 0.5 * juce::MathConstants<double>::pi - r;
+        if (x < 0.0) r = juce::MathConstants<double>::pi - r;
+        if (y < 0.0) r = -r;
+        const double cycles = r / juce::MathConstants<double>::twoPi;
+        return cycles >= 0.5 ? cycles - 1.0 : cycles;
+    }
+
+    double wrapCycles(double d) noexcept
+    {
+        if (d >= 0.5) return d - 1.0;
+        if (d < -0.5) return d + 1.0;
+        return d;
+    }
+}
+
+const TimecodeDecoder::Format* TimecodeDecoder::findFormat(const juce::String& name)
+{
+    for (const Format& format : kFormats)
+        if (name.equalsIgnoreCase(format.name)) return &format;
+    return nullptr;
+}
+
+juce::uint32 TimecodeDecoder::forward(juce::uint32 code, const Format& format) noexcept
+{
+    const juce::uint32 bit = parity(code & (format.taps | 1u));
+    return (code >> 1) | (bit << (format.bits - 1));
+}
+
+juce::uint32 TimecodeDecoder::reverse(juce::uint32 code, const Format& format) noexcept
+{
+    const juce::uint32 mask = (1u << format.bits) - 1u;
+    const juce::uint32 bit = parity(code & ((format.taps >> 1) | (1u << (format.bits - 1))));
+    return ((code << 1) & mask) | bit;
+}
+
+std::shared_ptr<const TimecodeDecoder::CodeTable> TimecodeDecoder::buildTable(const Format& format)
+{
+    auto table = std::make_shared<CodeTable>();
+    table->format = &format;
+    table->codes.reserve((size_t) format.length);
+    juce::uint32 code = format.seed;
+    for (int cycle = 0; cycle < format.length; ++cycle) {
+        table->codes.emplace_back(code, (juce::int32) cycle);
+        code = forward(code, format);
+    }
+    std::sort(table->codes.begin(), table->codes.end());
+    return table;
+}
+
+int TimecodeDecoder::CodeTable::find(juce::uint32 code) const noexcept
+{
+    const auto it = std::lower_bound(codes.begin(), codes.end(), std::make_pair(code, (juce::int32) -1));
+    return it != codes.end() && it->first == code ? (int) it->second : -1;
+}
+
+TimecodeDecoder::TimecodeDecoder(std::shared_ptr<const CodeTable> codeTable)
+    : table(std::move(codeTable)), format(*table->format)
+{
+    prepare(sampleRate, 512);
+}
+
+void TimecodeDecoder::prepare(double rate, int maxBlockSize)
+{
+    sampleRate = rate > 0.0 ? rate : 44100.0;
+    positions.assign((size_t) std::max(1, maxBlockSize), 0.0);
+    numPositions = 0;
+    highPass = 1.0 - juce::MathConstants<double>::twoPi * HighPassHz / sampleRate;
+    envelopeCoeff = (float) (1.0 - std::exp(-juce::MathConstants<double>::twoPi * EnvelopeHz / sampleRate));
+}
+
+void TimecodeDecoder::process(const float* left, const float* right, int numSamples) noexcept
+{
+    const float* primaryIn = format.primaryLeft ? left : right;
+    const float* secondaryIn = format.primaryLeft ? right : left;
+    const double polarity = format.negativePeaks ? -1.0 : 1.0;
+    const double direction = format.reversedPhase ? -1.0 : 1.0;
+    numPositions = std::min(numSamples, (int) positions.size());
+
+    for (int i = 0; i < numSamples; ++i) {
+        // DC blockers; the bits are read on the primary's peaks, so its sign is folded in here
+        primaryDc = primaryIn[i] - lastPrimary + highPass * primaryDc;
+        secondaryDc = secondaryIn[i] - lastSecondary + highPass * secondaryDc;
+        lastPrimary = primaryIn[i];
+        lastSecondary = secondaryIn[i];
+        const double p = polarity * primaryDc;
+        const double s = direction * secondaryDc;
+
+        const float magnitude = (float) std::sqrt(p * p + s * s);
+        envelope += envelopeCoeff * (magnitude - envelope);
+        const double angle = angleOf(s, p);
+
+        if (envelope < MinSignal) {
+            hadSignal = false;
+            estVelocity *= LiftDecayPerSample;
+            estCycles += estVelocity;
+        } else {
+            if (!hadSignal) reacquire(angle);
+            rawCycles += wrapCycles(angle - lastAngle);
+            lastAngle = angle;
+
+            const double predicted = estCycles + estVelocity;
+            const double residual = rawCycles - predicted;
+            estCycles = predicted + TrackerAlpha * residual;
+            estVelocity += TrackerBeta * residual;
+
+            // Angle 0 is the primary's peak
+            if (rawCycles >= (double) (boundary + 1) + PeakHysteresis) {
+                ++boundary;
+                readBit((float) p, true, boundary);
+            } else if (rawCycles < (double) boundary - PeakHysteresis) {
+                readBit((float) p, false, boundary);
+                --boundary;
+            }
+        }
+
+        if (i < numPositions)
+            positions[(size_t) i] = (estCycles + (absolute ? (double) offsetCycles : 0.0)) / format.resolution;
+    }
+
+    signal.store(hadSignal, std::memory_order_relaxed);
+    locked.store(absolute && validBits >= ValidBits, std::memory_order_relaxed);
+    pitch.store(estVelocity * sampleRate / format.resolution, std::memory_order_relaxed);
+}
+
+void TimecodeDecoder::reacquire(double angle) noexcept
+{
+    // The phase picks up where the tracker stood, to the nearest cycle; where the bits were
+    // gets lost with the needle, so they start over
+    const double frac = estCycles - std::floor(estCycles);
+    rawCycles = estCycles + wrapCycles(angle - frac);
+    lastAngle = angle;
+    boundary = (juce::int64) std::floor(rawCycles);
+    bitstream = expected = 0;
+    validBits = 0;
+    hadSignal = true;
+}
+
+void TimecodeDecoder::readBit(float peak, bool forwards, juce::int64 peakCycle) noexcept
+{
+    const float level = std::abs(peak);
+    if (refLevel <= 0.0f) refLevel = level;
+    const juce::uint32 bit = level > refLevel ? 1u : 0u;
+    refLevel += (level - refLevel) / RefPeaks;
+
+    // Forwards the newest bit enters at the top of the register, backwards at the bottom
+    const juce::uint32 mask = (1u << format.bits) - 1u;
+    if (forwards) {
+        bitstream = (bitstream >> 1) | (bit << (format.bits - 1));
+        expected = forward(expected, format);
+    } else {
+        bitstream = ((bitstream << 1) & mask) | bit;
+        expected = reverse(expected, format);
+    }
+
+    if (bitstream != expected) {
+        expected = bitstream;
+        validBits = 0;
+        return;
+    }
+    if (++validBits != ValidBits) return;
+
+    // Trusted now: find where on the record the register is. It holds the peaks of cycles
+    // cycle - bits + 1 .. cycle, the one just read at the top going forwards, at the bottom
+    // going backwards.
+    const int cycle = table->find(bitstream);
+    if (cycle < 0) return;
+    const juce::int64 recordCycle = forwards ? cycle : cycle - format.bits + 1;
+    offsetCycles = recordCycle - peakCycle;
+    absolute = true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Timecode vinyl (DVS) decoder for one turntable: a stereo input pair in, where the needle is
+ * on the record out, for every input sample.
+ *
+ * Control records carry a sine carrier on both channels, 90 degrees apart, and one bit per
+ * cycle in the amplitude of one of them (the primary). The phase of the pair is the playhead:
+ * it is taken per sample (a polynomial atan2, unwrapped into cycles) and run through an
+ * alpha-beta tracker, which gives a smooth position and the pitch without the lag of a
+ * smoothing filter. Each time the phase passes the primary's peak, that peak's height against
+ * a running reference is the next bit; the bits form a maximal-length LFSR sequence, so once
+ * ValidBits of them in a row follow the register the last Format::bits of them are looked up
+ * in a table of the whole record and the position becomes absolute. Until then (and after a
+ * needle drop, until the new place is found) it is relative: it moves like the record, from
+ * wherever the deck was.
+ *
+ * The code table is built once per format, off the audio thread (buildTable), and shared by
+ * the decks. process() runs on the audio thread before the deck renders, so the deck plays
+ * the position the record had in the same input block: the control adds no buffering of its
+ * own on top of the device's.
+ */
+class TimecodeDecoder {
+public:
+    struct Format {
+        const char* name;           // DVS/Format preference value
+        const char* description;
+        int bits;                   // register length
+        int resolution;             // carrier cycles per second at 33 1/3 rpm
+        juce::uint32 seed;          // code of cycle 0
+        juce::uint32 taps;
+        int length;                 // cycles with a code
+        bool primaryLeft;           // the bits ride on the left channel (else the right)
+        bool negativePeaks;         // ... on its negative peaks
+        bool reversedPhase;         // forwards, the secondary leads the primary
+    };
+    static const Format* findFormat(const juce::String& name);
+
+    // Index of every code on the record, sorted by code
+    struct CodeTable {
+        const Format* format{nullptr};
+        std::vector<std::pair<juce::uint32, juce::int32>> codes;
+        int find(juce::uint32 code) const noexcept;   // cycle, or -1
+    };
+    // Any thread but the audio thread: a fraction of a second for the longest records
+    static std::shared_ptr<const CodeTable> buildTable(const Format& format);
+
+    static constexpr int ValidBits = 24;
+    static constexpr float MinSignal = 0.01f;     // carrier amplitude below it: needle up
+
+    explicit TimecodeDecoder(std::shared_ptr<const CodeTable> table);
+
+    // Before the decoder is handed to the audio thread, and on every device start
+    void prepare(double sampleRate, int maxBlockSize);
+
+    // Audio thread: decode one block; record positions (seconds at 33 1/3 rpm) for the first
+    // getNumPositions() samples are in getPositions() afterwards
+    void process(const float* left, const float* right, int numSamples) noexcept;
+    const double* getPositions() const noexcept { return positions.data(); }
+    int getNumPositions() const noexcept { return numPositions; }
+    // Audio thread: the positions are places on the record (else relative to an arbitrary start)
+    bool isAbsolute() const noexcept { return absolute; }
+
+    // Any thread, for the UI
+    bool hasSignal() const { return signal.load(std::memory_order_relaxed); }
+    double getPitch() const { return pitch.load(std::memory_order_relaxed); }   // 1 = 33 1/3 rpm
+    bool isLocked() const { return locked.load(std::memory_order_relaxed); }
+
+    static juce::uint32 forward(juce::uint32 code, const Format& format) noexcept;
+    static juce::uint32 reverse(juce::uint32 code, const Format& format) noexcept;
+
+private:
+    void readBit(float peak, bool forwards, juce::int64 peakCycle) noexcept;
+    void reacquire(double angle) noexcept;
+
+    std::shared_ptr<const CodeTable> table;
+    const Format& format;
+
+    double sampleRate{44100.0};
+    std::vector<double> positions;
+    int numPositions{0};
+
+    // Audio thread
+    double highPass{0.0};           // DC blocker coefficient; inputs and outputs
+    float lastPrimary{0.0f}, lastSecondary{0.0f};
+    double primaryDc{0.0}, secondaryDc{0.0};
+    float envelope{0.0f};
+    float envelopeCoeff{0.0f};
+    bool hadSignal{false};
+    double lastAngle{0.0};          // cycles, [-0.5, 0.5)
+    double rawCycles{0.0};          // unwrapped phase
+    double estCycles{0.0};          // tracked phase and velocity (cycles per sample)
+    double estVelocity{0.0};
+    juce::int64 boundary{0};        // cycle the phase is in: next peak boundary + 1, or boundary going back
+    float refLevel{0.0f};
+    juce::uint32 bitstream{0};
+    juce::uint32 expected{0};
+    int validBits{0};
+    bool absolute{false};
+    juce::int64 offsetCycles{0};    // record cycle minus tracked cycle, once absolute
+
+    std::atomic<bool> signal{false};
+    std::atomic<bool> locked{false};
+    std::atomic<double> pitch{0.0};
+
+    JUCE_DECLARE_NON_COPYABLE(TimecodeDecoder)
+};
@@ -0,0 +1,135 @@
+#include "TrackAnalysis.h"
+#include "AudioFingerprint.h"
+#include "BpmAnalyzer.h"
+#include "DecoderRegistry.h"
+#include "LoudnessMeter.h"
+#include "SpectrogramCache.h"
+#include "TrackDecodePipeline.h"
+#include "WaveformGenerator.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    // Default-threshold summary check only needs a handful of bins
+    constexpr int ProbeBins = 64;
+
+    // Runs Options::pace ahead of every block; wants more as long as the real sinks do
+    class PaceSink : public TrackDecodePipeline::Sink {
+    public:
+        PaceSink(const std::function<void()>& pace, std::vector<TrackDecodePipeline::Sink*> sinks)
+            : pace(pace), sinks(std::move(sinks)) {}
+
+        void consume(const juce::AudioBuffer<float>&, int, juce::int64) override { if (pace) pace(); }
+
+        bool wantsMore() const override {
+            return std::any_of(sinks.begin(), sinks.end(), [](auto* s) { return s->wantsMore(); });
+        }
+
+    private:
+        const std::function<void()>& pace;
+        std::vector<TrackDecodePipeline::Sink*> sinks;
+    };
+}
+
+TrackAnalysis::Result TrackAnalysis::run(const juce::File& file, const BpmCache& bpmCache, const Options& options)
+{
+    Result result;
+    if (!file.existsAsFile()) return result;
+    auto stopped = [&options] { return options.shouldStop && options.shouldStop(); };
+
+    WaveformGenerator gen;
+    WaveformGenerator::Result probe;
+    BpmCache::Entry cached;
+    if (options.beatGrid && !options.force && bpmCache.load(file, cached)) {
+        result.bpm = cached.bpm;
+        result.key = cached.key;
+        result.bpmFromCache = true;
+    }
+    const bool haveWaveform = options.waveform && !options.force && gen.loadCached(file, ProbeBins, probe);
+    const bool haveLoudness = options.loudness && !options.force && bpmCache.loadLoudness(file, result.loudness);
+    const bool haveFingerprint = options.fingerprint && !options.force
+                              && bpmCache.loadFingerprint(file, result.fingerprint);
+    const SpectrogramCache spectrogramCache(WaveformGenerator::getCacheDirectory());
+    const bool haveSpectrogram = options.spectrogram && !options.force && spectrogramCache.contains(file);
+    result.waveform = haveWaveform;
+    result.spectrogram = haveSpectrogram;
+    const bool needBpm = options.beatGrid && !result.bpmFromCache;
+    const bool needWaveform = options.waveform && !haveWaveform;
+    const bool needLoudness = options.loudness && !haveLoudness;
+    const bool needFingerprint = options.fingerprint && !haveFingerprint;
+    const bool needSpectrogram = options.spectrogram && !haveSpectrogram;
+    if (!needBpm && !needWaveform && !needLoudness && !needFingerprint && !needSpectrogram) {
+        result.status = Status::Cached;
+        return result;
+    }
+
+    // A deck's load pass is on this file: it fills both caches itself
+    if (!WaveformGenerator::claimAnalysis(file)) {
+        result.status = Status::Busy;
+        return result;
+    }
+
+    // The indexed MP3 reader: this first pass over a track also leaves its frame index behind
+    auto reader = DecoderRegistry::getInstance().acquireReader(file);
+    if (!reader) {
+        WaveformGenerator::releaseAnalysis(file);
+        return result;
+    }
+
+    WaveformGenerator::SummaryBuilder waveSink;
+    BpmAnalyzer::FeatureExtractor bpmSink(options.bpmWindowSeconds);
+    LoudnessMeter loudnessSink;
+    AudioFingerprint fingerprintSink;
+    Spectrogram spectrogramSink;
+    std::vector<TrackDecodePipeline::Sink*> sinks;
+    if (needWaveform) sinks.push_back(&waveSink);
+    if (needBpm) sinks.push_back(&bpmSink);
+    if (needLoudness) sinks.push_back(&loudnessSink);
+    if (needFingerprint) sinks.push_back(&fingerprintSink);
+    if (needSpectrogram) sinks.push_back(&spectrogramSink);
+    PaceSink paceSink(options.pace, sinks);
+
+    TrackDecodePipeline pipeline(*reader);
+    // Gives way to deck loads on the same disk
+    pipeline.setScheduledIo(file, IoScheduler::Priority::Background);
+    pipeline.addSink(&paceSink);
+    for (auto* sink : sinks) pipeline.addSink(sink);
+    if (options.shouldStop) pipeline.setStopCondition(options.shouldStop);
+    const bool decoded = pipeline.run();
+
+    if (needWaveform && waveSink.isComplete() && !stopped()) {
+        gen.publish(file, waveSink.getSummary(), ProbeBins, probe);
+        result.waveform = true;
+    }
+    // Before the claim goes: a deck waiting on it reads the spectrogram next
+    if (auto spectrogram = needSpectrogram && !stopped() ? spectrogramSink.takeData() : nullptr)
+        result.spectrogram = spectrogramCache.store(file, *spectrogram);
+    WaveformGenerator::releaseAnalysis(file);
+    if (stopped()) return result;
+
+    if (needLoudness && loudnessSink.getResult().valid) {
+        result.loudness = loudnessSink.getResult();
+        bpmCache.storeLoudness(file, result.loudness);
+    }
+    if (needFingerprint) {
+        result.fingerprint = fingerprintSink.takeFingerprint();
+        if (!result.fingerprint.empty()) bpmCache.storeFingerprint(file, result.fingerprint);
+    }
+
+    if (auto features = needBpm ? bpmSink.takeFeatures() : nullptr) {
+        std::vector<double> beats;
+        double totalSec = 0.0, firstBeat = 0.0;
+        std::string algorithm;
+        BpmAnalyzer analyzer;
+        result.bpm = analyzer.analyzeFeatures(*features, &beats, &totalSec, &algorithm, &firstBeat);
+        result.key = BpmAnalyzer::getKey(*features);
+        std::vector<float> novelty;
+        double noveltyHop = 0.0;
+        BpmAnalyzer::getBeatNovelty(*features, novelty, noveltyHop);
+        if (result.bpm > 0.0)
+            bpmCache.store(file, { result.bpm, beats, totalSec, firstBeat, algorithm, result.key, novelty, noveltyHop,
+                                   BpmAnalyzer::getStructure(*features, result.bpm, firstBeat) });
+    }
+    result.status = decoded ? Status::Analysed : Status::Failed;
+    return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "BpmCache.h"
+
+/**
+ * Everything the caches keep about a track, filled in one decode pass: the beat grid with its
+ * key, novelty and structure (BpmAnalyzer, BpmCache), the loudness for auto gain (LoudnessMeter,
+ * BpmCache::Loudness), the acoustic fingerprint for duplicate detection (AudioFingerprint) and
+ * the waveform summary with its pyramid (WaveformGenerator) and the spectrogram (Spectrogram,
+ * SpectrogramCache), both stored in WaveformGenerator::getCacheDirectory(). What is cached already is read back, not recomputed,
+ * unless Options::force is set. Shared by LibraryAnalyzer in the app and the headless
+ * pulsedj-analyze tool, so both leave the same files behind.
+ *
+ * A file whose waveform another pass (a deck load) has claimed is left to it. Runs on the
+ * calling thread; any number of threads may analyse different files at once.
+ */
+class TrackAnalysis {
+public:
+    struct Options {
+        bool beatGrid{true};
+        bool loudness{true};
+        bool waveform{true};
+        bool fingerprint{true};
+        bool spectrogram{true};
+        bool force{false};            // analyse again what is cached
+        double bpmWindowSeconds{120.0};
+        // Called before every decoded block; may block to give way to other work
+        std::function<void()> pace;
+        // Ends the pass early; nothing is stored after it returned true
+        std::function<bool()> shouldStop;
+    };
+
+    enum class Status {
+        Analysed,     // decoded, the results are in the caches
+        Cached,       // everything asked for was there already
+        Busy,         // another pass owns the file
+        Failed,       // missing, unreadable, or stopped
+    };
+
+    struct Result {
+        Status status{Status::Failed};
+        double bpm{0.0};              // 0 if unknown or not asked for
+        int key{-1};                  // KeyDetector index
+        BpmCache::Loudness loudness;
+        std::vector<std::uint32_t> fingerprint;   // empty if not asked for or nothing audible
+        bool waveform{false};         // a summary is cached
+        bool spectrogram{false};      // a spectrogram is cached
+        bool bpmFromCache{false};
+    };
+
+    static Result run(const juce::File& file, const BpmCache& bpmCache, const Options& options);
+};
@@ -0,0 +1,39 @@
+#include "TrackDecodePipeline.h"
+#include <algorithm>
+#include <iostream>
+
+bool TrackDecodePipeline::run()
+{
+    samplesDecoded = 0;
+    if (sinks.empty()) return true;
+
+    const juce::int64 totalSamples = reader.lengthInSamples;
+    bool ok = totalSamples > 0 && reader.numChannels > 0;
+    if (ok) {
+        for (auto* sink : sinks) sink->prepare(reader);
+
+        juce::AudioBuffer<float> block((int) reader.numChannels, BlockSamples);
+        for (juce::int64 pos = 0; pos < totalSamples; pos += BlockSamples) {
+            const bool anyWants = std::any_of(sinks.begin(), sinks.end(), [](Sink* s) { return s->wantsMore(); });
+            if (!anyWants) break;
+            if (shouldStop && shouldStop()) {
+                ok = false;
+                break;
+            }
+
+            const int n = (int) std::min<juce::int64>(BlockSamples, totalSamples - pos);
+            if (readAhead) readAhead->reached(pos + n, totalSamples);
+            if (!reader.read(&block, 0, n, pos, true, true)) {
+                std::cout << "TrackDecodePipeline: decode failed at sample " << pos << std::endl;
+                ok = false;
+                break;
+            }
+            for (auto* sink : sinks)
+                if (sink->wantsMore()) sink->consume(block, n, pos);
+            samplesDecoded = pos + n;
+        }
+    }
+
+    for (auto* sink : sinks) sink->finish(ok || !sink->wantsMore());
+    return ok;
+}
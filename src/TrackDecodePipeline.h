@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "IoScheduler.h"
+
+/**
+ * Decodes a track once and hands every block to all registered sinks in file order.
+ *
+ * Loading a deck needs the same PCM several times over: the waveform summary, the BPM / onset
+ * analysis and, optionally, the in-memory sample store. Each of those is a Sink here, so compressed
+ * files go through the decoder a single time. A sink that only needs the start of the track
+ * (the BPM window) reports wantsMore() == false and the pass ends as soon as no sink wants more.
+ * A stop condition, checked before every block, ends it early for a load that was superseded.
+ * With setScheduledIo() the file is read ahead of the decoder in the IoScheduler's turns.
+ */
+class TrackDecodePipeline {
+public:
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual void prepare(const juce::AudioFormatReader& reader) { juce::ignoreUnused(reader); }
+        // `block` holds all channels of the file; samples [0, numSamples) start at `position`
+        virtual void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) = 0;
+        virtual bool wantsMore() const { return true; }
+        // completed is false if the decoder failed before the sink had everything it wanted
+        virtual void finish(bool completed) { juce::ignoreUnused(completed); }
+    };
+
+    static constexpr int BlockSamples = 16384;
+
+    explicit TrackDecodePipeline(juce::AudioFormatReader& reader) : reader(reader) {}
+
+    void addSink(Sink* sink) { if (sink != nullptr) sinks.push_back(sink); }
+    // The pass fails like a decode error once this returns true
+    void setStopCondition(std::function<bool()> condition) { shouldStop = std::move(condition); }
+    // The reader's file, read ahead at this priority on its device
+    void setScheduledIo(const juce::File& file, IoScheduler::Priority priority)
+    {
+        readAhead = std::make_unique<IoScheduler::ReadAhead>(file, priority);
+    }
+    bool run();
+    juce::int64 getSamplesDecoded() const { return samplesDecoded; }
+
+private:
+    juce::AudioFormatReader& reader;
+    std::vector<Sink*> sinks;
+    std::function<bool()> shouldStop;
+    std::unique_ptr<IoScheduler::ReadAhead> readAhead;
+    juce::int64 samplesDecoded{0};
+};
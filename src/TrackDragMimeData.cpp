@@ -0,0 +1,48 @@
+#include "TrackDragMimeData.h"
+
+TrackDragMimeData::TrackDragMimeData(std::vector<int> ids, Resolver resolver)
+    : ids(std::move(ids)), resolver(std::move(resolver))
+{
+}
+
+QStringList TrackDragMimeData::filePaths() const
+{
+    QStringList paths;
+    paths.reserve((qsizetype) ids.size());
+    for (int id : ids) {
+        const QString path = resolver(id);
+        if (!path.isEmpty()) paths.append(path);
+    }
+    return paths;
+}
+
+QString TrackDragMimeData::firstFilePath(const QMimeData* mime)
+{
+    if (const auto* tracks = qobject_cast<const TrackDragMimeData*>(mime)) {
+        for (int id : tracks->ids) {
+            const QString path = tracks->resolver(id);
+            if (!path.isEmpty()) return path;
+        }
+        return QString();
+    }
+    const QList<QUrl> urls = mime->urls();
+    return urls.isEmpty() ? QString() : urls.first().toLocalFile();
+}
+
+QStringList TrackDragMimeData::formats() const
+{
+    return { QString::fromLatin1(TrackIdsFormat), QStringLiteral("text/uri-list") };
+}
+
+QVariant TrackDragMimeData::retrieveData(const QString& mimeType, QMetaType type) const
+{
+    if (mimeType == QLatin1String(TrackIdsFormat))
+        return QByteArray(reinterpret_cast<const char*>(ids.data()), (qsizetype) (ids.size() * sizeof(int)));
+    if (mimeType != QLatin1String("text/uri-list")) return QMimeData::retrieveData(mimeType, type);
+    // As a list of QUrl; QMimeData turns it into the text form where that is what is wanted
+    if (!urlsBuilt) {
+        for (const QString& path : filePaths()) urlList.append(QUrl::fromLocalFile(path));
+        urlsBuilt = true;
+    }
+    return urlList;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QMimeData>
+#include <QStringList>
+#include <QUrl>
+#include <functional>
+#include <vector>
+
+/**
+ * What a drag out of the library carries: the dragged tracks' ids, not their paths. Starting a
+ * drag of a thousand selected rows costs a vector of ints; a path is only made once a drop
+ * target asks for it.
+ *
+ * In-app targets read the ids' paths through this class (firstFilePath() for a deck, which takes
+ * one track, filePaths() for a target taking all of them). To anything else, a file manager or
+ * another application, the drag offers text/uri-list, which retrieveData() builds the first
+ * time it is asked for and then keeps.
+ */
+class TrackDragMimeData : public QMimeData {
+    Q_OBJECT
+
+public:
+    static constexpr const char* TrackIdsFormat = "application/x-pulsedj-track-ids";
+
+    // A track id's path; empty for none
+    using Resolver = std::function<QString(int)>;
+
+    TrackDragMimeData(std::vector<int> ids, Resolver resolver);
+
+    int count() const { return (int) ids.size(); }
+    QStringList filePaths() const;
+    // The first dragged track still in the library: from the ids of a library drag, from the
+    // URLs of any other
+    static QString firstFilePath(const QMimeData* mime);
+
+    QStringList formats() const override;
+
+protected:
+    QVariant retrieveData(const QString& mimeType, QMetaType type) const override;
+
+private:
+    const std::vector<int> ids;
+    const Resolver resolver;
+    mutable QList<QVariant> urlList;   // built on the first external request
+    mutable bool urlsBuilt = false;
+};
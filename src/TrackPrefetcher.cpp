@@ -0,0 +1,67 @@
+#include "TrackPrefetcher.h"
+#include "AppConfig.h"
+#include "BpmCache.h"
+#include "HotTrackCache.h"
+#include "IoScheduler.h"
+#include "ThreadingPolicy.h"
+#include "WaveformGenerator.h"
+#include <QThread>
+#include <algorithm>
+
+TrackPrefetcher::TrackPrefetcher()
+{
+    pool.setMaxThreadCount(1);
+    pool.setExpiryTimeout(30000);
+}
+
+TrackPrefetcher::~TrackPrefetcher()
+{
+    ++currentGeneration;
+    pool.clear();
+    pool.waitForDone();
+}
+
+void TrackPrefetcher::prefetch(const QStringList& files)
+{
+    const int generation = ++currentGeneration;
+    pool.clear();
+    for (const QString& file : files) {
+        if (file.isEmpty()) continue;
+        pool.start([this, file, generation]() { warm(file, generation); });
+    }
+}
+
+void TrackPrefetcher::warm(const QString& filePath, int generation)
+{
+    if (isStale(generation)) return;
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    ThreadingPolicy::getInstance().applyToWorkerThread();
+
+    const juce::File file(filePath.toStdString());
+    HotTrackCache& hot = HotTrackCache::getInstance();
+    const HotTrackCache::Entry entry = hot.find(file);
+
+    // Decoded samples in RAM already make the file irrelevant; otherwise a sequential read now
+    // means the deck's reader and decode pass are served from the page cache. Read in the disk's
+    // background turns, behind any deck load.
+    if (!entry.samples) {
+        IoScheduler::ReadAhead in(file, IoScheduler::Priority::Background);
+        const juce::int64 end = std::min<juce::int64>(in.getFileBytes(), MaxWarmBytes);
+        for (juce::int64 offset = 0; offset < end; offset += IoScheduler::BlockBytes) {
+            if (isStale(generation)) return;
+            in.readTo(offset + IoScheduler::BlockBytes);
+        }
+    }
+
+    if (!entry.waveform && !isStale(generation)) {
+        WaveformGenerator gen;
+        WaveformGenerator::Result wave;
+        if (gen.loadCached(file, HotTrackCache::OverviewBins, wave))
+            hot.storeWaveform(file, std::make_shared<const WaveformGenerator::Result>(std::move(wave)));
+    }
+    if (!entry.beatGrid && !isStale(generation)) {
+        const BpmCache cache(juce::File(AppConfig::instance().getBpmCacheDirectory().toStdString()));
+        auto grid = std::make_shared<BpmCache::Entry>();
+        if (cache.load(file, *grid)) hot.storeBeatGrid(file, grid);
+    }
+}
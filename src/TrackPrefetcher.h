@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+
+/**
+ * Speculative background work for the tracks highlighted in the library, so that loading one of
+ * them onto a deck finds everything warm.
+ *
+ * Each file is read once to pull it into the OS page cache (up to MaxWarmBytes), and its cached
+ * overview bins and beat grid are put into the HotTrackCache, where the deck's load task picks
+ * them up instead of running its decode pass. Tracks without cached analysis are the
+ * LibraryAnalyzer's job; the caller promotes them there. One worker at the lowest priority; a
+ * new selection drops whatever is still queued or running for the previous one.
+ */
+class TrackPrefetcher {
+public:
+    static constexpr qint64 MaxWarmBytes = 128LL * 1024 * 1024;
+
+    TrackPrefetcher();
+    ~TrackPrefetcher();
+
+    // Most important first; replaces the previous request
+    void prefetch(const QStringList& files);
+
+private:
+    void warm(const QString& filePath, int generation);
+    bool isStale(int generation) const { return generation != currentGeneration.load(std::memory_order_relaxed); }
+
+    QThreadPool pool;
+    std::atomic<int> currentGeneration{0};
+};
@@ -0,0 +1,124 @@
+#include "TrackStore.h"
+#include "LibraryManager.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+    constexpr int TextOffsetBits = 20;
+    static_assert((1 << TextOffsetBits) == TrackColumns::TextChunkBytes, "a text reference holds a chunk offset");
+    static_assert(TrackColumns::FieldCount * TrackColumns::MaxFieldBytes <= TrackColumns::TextChunkBytes,
+                  "a track's text fits one chunk");
+
+    std::string toUtf8(const QString& text)
+    {
+        const QByteArray bytes = text.toUtf8();
+        int length = std::min((int) bytes.size(), TrackColumns::MaxFieldBytes);
+        // Not in the middle of a character
+        while (length < bytes.size() && length > 0 && (((unsigned char) bytes[length]) & 0xc0) == 0x80) --length;
+        return std::string(bytes.constData(), (size_t) length);
+    }
+}
+
+TrackInfo TrackColumns::get(int id) const
+{
+    const Row& r = row(id);
+    TrackInfo track(text(id, FilePath));
+    track.title = text(id, Title);
+    track.artist = text(id, Artist);
+    track.album = text(id, Album);
+    track.genre = text(id, Genre);
+    track.year = text(id, Year);
+    track.key = text(id, Key);
+    track.comment = text(id, Comment);
+    track.duration = r.duration;
+    track.bpm = r.bpm;
+    track.fileSize = r.fileSize;
+    track.modifiedMs = r.modifiedMs;
+    track.addedMs = r.addedMs;
+    track.uid = r.uid;
+    track.identity = r.identity;
+    return track;
+}
+
+QString TrackColumns::text(int id, Field field) const
+{
+    const std::string_view bytes = utf8(id, field);
+    return QString::fromUtf8(bytes.data(), (qsizetype) bytes.size());
+}
+
+std::string_view TrackColumns::utf8(int id, Field field) const
+{
+    const Row& r = row(id);
+    size_t offset = r.text & (TextChunkBytes - 1);
+    for (int f = 0; f < field; ++f) offset += r.lengths[(size_t) f];
+    return std::string_view(textChunks[r.text >> TextOffsetBits]->bytes.get() + offset, r.lengths[field]);
+}
+
+int64_t TrackColumns::bytes(int id) const
+{
+    int64_t text = 0;
+    for (quint16 length : row(id).lengths) text += length;
+    return (int64_t) sizeof(Row) + text;
+}
+
+int TrackStore::add(const TrackInfo& track)
+{
+    const std::array<std::string, FieldCount> fields{
+        toUtf8(track.filePath), toUtf8(track.title), toUtf8(track.artist), toUtf8(track.album),
+        toUtf8(track.genre), toUtf8(track.year), toUtf8(track.key), toUtf8(track.comment)
+    };
+    if (count % RowsPerChunk == 0) rowChunks.push_back(std::make_shared<RowChunk>());
+    // Past every snapshot's size: nobody reads this row yet
+    Row& r = rowChunks.back()->rows[(size_t) count % RowsPerChunk];
+    r = { track.duration, track.bpm, track.fileSize, track.modifiedMs, track.addedMs, track.uid, track.identity, 0, {}, 0 };
+    std::array<std::string_view, FieldCount> views;
+    for (int f = 0; f < FieldCount; ++f) views[(size_t) f] = fields[(size_t) f];
+    appendText(views, r);
+    return count++;
+}
+
+void TrackStore::clear()
+{
+    rowChunks.clear();
+    rowChunks.shrink_to_fit();
+    textChunks.clear();
+    textChunks.shrink_to_fit();
+    count = 0;
+    textUsed = TextChunkBytes;
+}
+
+void TrackStore::setText(int id, Field field, const QString& value)
+{
+    const std::string replaced = toUtf8(value);
+    std::array<std::string_view, FieldCount> fields;
+    for (int f = 0; f < FieldCount; ++f) fields[(size_t) f] = utf8(id, (Field) f);
+    fields[field] = replaced;
+    // The old text stays where a snapshot may be reading it
+    appendText(fields, writableRow(id));
+}
+
+TrackStore::Row& TrackStore::writableRow(int id)
+{
+    auto& chunk = rowChunks[(size_t) id / RowsPerChunk];
+    if (chunk.use_count() > 1) chunk = std::make_shared<RowChunk>(*chunk);
+    return chunk->rows[(size_t) id % RowsPerChunk];
+}
+
+void TrackStore::appendText(const std::array<std::string_view, FieldCount>& fields, Row& row)
+{
+    size_t total = 0;
+    for (const auto& field : fields) total += field.size();
+    if (textUsed + total > (size_t) TextChunkBytes) {
+        textChunks.push_back(std::make_shared<TextChunk>());
+        textUsed = 0;
+    }
+    char* out = textChunks.back()->bytes.get() + textUsed;
+    row.text = ((quint32) (textChunks.size() - 1) << TextOffsetBits) | (quint32) textUsed;
+    for (int f = 0; f < FieldCount; ++f) {
+        row.lengths[(size_t) f] = (quint16) fields[(size_t) f].size();
+        std::memcpy(out, fields[(size_t) f].data(), fields[(size_t) f].size());
+        out += fields[(size_t) f].size();
+    }
+    textUsed += (int) total;
+}
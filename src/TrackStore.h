@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+struct TrackInfo;
+
+/**
+ * The read side of a TrackStore, and what a snapshot of one is.
+ *
+ * The library's tracks in columns. Numbers sit in a fixed-size row per track; the strings of all
+ * tracks are UTF-8 back to back in a pool, a row holding where its own start and how long each
+ * is. A track costs its row and its text, about a quarter of what a TrackInfo holds in QStrings
+ * (UTF-16, a heap block and header each), and nothing is decoded at load.
+ *
+ * QStrings are made on demand: text() for the one field a query reads, get() for a whole track.
+ * utf8() reads a field in place.
+ *
+ * Rows are kept RowsPerChunk to a chunk and the pool in chunks of TextChunkBytes, each chunk
+ * shared by the store and the snapshots holding it, so a snapshot costs a pointer per chunk.
+ */
+class TrackColumns
+{
+public:
+    enum Field { FilePath = 0, Title, Artist, Album, Genre, Year, Key, Comment, FieldCount };
+
+    // Longer strings (a comment, say) are cut at a character boundary
+    static constexpr int MaxFieldBytes = 0xffff;
+    static constexpr int RowsPerChunk = 1024;
+    static constexpr int TextChunkBytes = 1 << 20;   // a track's text always fits one
+
+    // Ids from 0; removed tracks stay behind as tombstones
+    int size() const { return count; }
+    bool isRemoved(int id) const { return row(id).removed != 0; }
+
+    TrackInfo get(int id) const;
+    QString text(int id, Field field) const;
+    std::string_view utf8(int id, Field field) const;
+
+    double duration(int id) const { return row(id).duration; }
+    double bpm(int id) const { return row(id).bpm; }
+    qint64 fileSize(int id) const { return row(id).fileSize; }
+    qint64 modifiedMs(int id) const { return row(id).modifiedMs; }
+    qint64 addedMs(int id) const { return row(id).addedMs; }
+    quint64 uid(int id) const { return row(id).uid; }
+    quint64 identity(int id) const { return row(id).identity; }
+
+    // What one track holds: its row and its text in the pool
+    int64_t bytes(int id) const;
+
+protected:
+    struct Row {
+        double duration;
+        double bpm;
+        qint64 fileSize;
+        qint64 modifiedMs;
+        qint64 addedMs;
+        quint64 uid;
+        quint64 identity;
+        quint32 text;   // text chunk << 20 | offset: the fields back to back, in Field order
+        std::array<quint16, FieldCount> lengths;
+        quint8 removed;
+    };
+    struct RowChunk {
+        std::array<Row, RowsPerChunk> rows;
+    };
+    struct TextChunk {
+        std::unique_ptr<char[]> bytes{ new char[TextChunkBytes] };
+    };
+
+    const Row& row(int id) const { return rowChunks[(size_t) id / RowsPerChunk]->rows[(size_t) id % RowsPerChunk]; }
+
+    std::vector<std::shared_ptr<RowChunk>> rowChunks;
+    std::vector<std::shared_ptr<TextChunk>> textChunks;
+    int count = 0;
+};
+
+/**
+ * The tracks of the library model, which only the GUI thread writes, readable from anywhere as
+ * snapshots. snapshot() copies the chunk pointers and the size; the tracks it holds never
+ * change under it, the store going on as if it wasn't there:
+ *
+ * - an add writes a row and text past the snapshot's size, which it never reads;
+ * - a change to a track (setBpm, setRemoved, ...) first copies the row chunk if a snapshot
+ *   shares it; setText also writes its new text past the snapshot's end of the pool;
+ * - clear() lets go of the chunks, which the snapshots keep alive.
+ *
+ * A reader holds no lock and a snapshot can be kept for as long as a job takes. snapshot() is
+ * called on the writing thread, so only that thread ever adds an owner to a chunk.
+ *
+ * Tracks are only appended or all cleared. setText() appends the track's text again with the
+ * field replaced; the old bytes stay behind until clear(), which analysis filling in a key now
+ * and then doesn't make worth reclaiming.
+ */
+class TrackStore : public TrackColumns
+{
+public:
+    using Snapshot = std::shared_ptr<const TrackColumns>;
+
+    Snapshot snapshot() const { return std::make_shared<const TrackColumns>(static_cast<const TrackColumns&>(*this)); }
+
+    int add(const TrackInfo& track);
+    void clear();
+    void setText(int id, Field field, const QString& value);
+    void setBpm(int id, double bpm) { writableRow(id).bpm = bpm; }
+    void setIdentity(int id, quint64 identity) { writableRow(id).identity = identity; }
+    void setRemoved(int id) { writableRow(id).removed = 1; }
+
+private:
+    // The row, its chunk copied first if a snapshot holds it
+    Row& writableRow(int id);
+    void appendText(const std::array<std::string_view, FieldCount>& fields, Row& row);
+
+    int textUsed = TextChunkBytes;   // bytes of the last text chunk written; full = none yet
+};
@@ -0,0 +1,202 @@
+#include "TrackStructure.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Bars per block the phrase alignment compares
+    constexpr long BlockBars = 4;
+
+    // Mean of the envelope over [fromSec, toSec); 0 outside it
+    double meanOver(const std::vector<float>& v, double hopSeconds, double fromSec, double toSec)
+    {
+        const auto size = (long) v.size();
+        const long first = std::clamp((long) std::floor(fromSec / hopSeconds), 0L, size);
+        const long last = std::clamp((long) std::ceil(toSec / hopSeconds), 0L, size);
+        if (last <= first) return 0.0;
+        double sum = 0.0;
+        for (long i = first; i < last; ++i) sum += v[(size_t) i];
+        return sum / (double) (last - first);
+    }
+
+    // Mean of v[from, to), clamped to v
+    double meanOf(const std::vector<double>& v, long from, long to)
+    {
+        from = std::max(0L, from);
+        to = std::min((long) v.size(), to);
+        if (to <= from) return 0.0;
+        double sum = 0.0;
+        for (long i = from; i < to; ++i) sum += v[(size_t) i];
+        return sum / (double) (to - from);
+    }
+
+    // Loudness change across index b, `span` either side; 0 where a side is cut off
+    double changeAt(const std::vector<double>& v, long b, long span)
+    {
+        if (b < span || b + span > (long) v.size()) return 0.0;
+        return std::abs(meanOf(v, b, b + span) - meanOf(v, b - span, b));
+    }
+}
+
+int TrackStructure::phraseAt(double timeSec) const
+{
+    if (phrases.empty() || timeSec < phrases.front().startSec) return -1;
+    const auto it = std::upper_bound(phrases.begin(), phrases.end(), timeSec,
+                                     [](double t, const Phrase& phrase) { return t < phrase.startSec; });
+    return (int) (it - phrases.begin()) - 1;
+}
+
+int TrackStructure::find(Section section, int from) const
+{
+    for (int i = std::max(0, from); i < (int) phrases.size(); ++i)
+        if (phrases[(size_t) i].section == section) return i;
+    return -1;
+}
+
+int TrackStructure::findLastRun(Section section) const
+{
+    int i = (int) phrases.size() - 1;
+    while (i >= 0 && phrases[(size_t) i].section != section) --i;
+    if (i < 0) return -1;
+    while (i > 0 && phrases[(size_t) i - 1].section == section) --i;
+    return i;
+}
+
+const char* TrackStructure::getSectionName(Section section)
+{
+    switch (section) {
+        case Section::Intro: return "Intro";
+        case Section::Build: return "Build";
+        case Section::Drop: return "Drop";
+        case Section::Breakdown: return "Breakdown";
+        case Section::Outro: return "Outro";
+    }
+    return "?";
+}
+
+uint32_t TrackStructure::getSectionColor(Section section)
+{
+    switch (section) {
+        case Section::Intro: return 0x4a90d9;
+        case Section::Build: return 0xe0b040;
+        case Section::Drop: return 0xe04848;
+        case Section::Breakdown: return 0x50c080;
+        case Section::Outro: return 0x8a6ad0;
+    }
+    return 0x808080;
+}
+
+TrackStructure TrackStructure::detect(const Envelope& envelope, double bpm, double firstBeatSec, double lengthSec)
+{
+    TrackStructure result;
+    const double hop = envelope.hopSeconds;
+    if (bpm <= 0.0 || lengthSec <= 0.0 || hop <= 0.0 || firstBeatSec < 0.0 || envelope.full.empty()
+        || envelope.low.size() != envelope.full.size())
+        return result;
+    const double beatSec = 60.0 / bpm;
+    const double endSec = std::min(lengthSec, (double) envelope.full.size() * hop);
+    const long numBeats = (long) std::floor((endSec - firstBeatSec) / beatSec);
+    if (numBeats < 2 * BeatsPerBar) return result;
+
+    // Per beat: loudness with the low band weighted in (each band over its track mean), and the
+    // full-band onset right on the beat
+    const double fullMean = meanOver(envelope.full, hop, 0.0, endSec);
+    const double lowMean = meanOver(envelope.low, hop, 0.0, endSec);
+    if (fullMean <= 0.0) return result;
+    std::vector<double> level((size_t) numBeats), onset((size_t) numBeats);
+    for (long b = 0; b < numBeats; ++b) {
+        const double t = firstBeatSec + (double) b * beatSec;
+        const double full = meanOver(envelope.full, hop, t, t + beatSec) / fullMean;
+        const double low = lowMean > 0.0 ? meanOver(envelope.low, hop, t, t + beatSec) / lowMean : full;
+        level[(size_t) b] = 0.5 * (full + low);
+        const double quarter = 0.25 * beatSec;
+        onset[(size_t) b] = std::max(0.0, meanOver(envelope.full, hop, t, t + quarter)
+                                              - meanOver(envelope.full, hop, t - quarter, t)) / fullMean;
+    }
+
+    int downbeat = 0;
+    double best = -1.0;
+    for (int phase = 0; phase < BeatsPerBar; ++phase) {
+        double score = 0.0;
+        for (long b = phase; b < numBeats; b += BeatsPerBar) score += onset[(size_t) b] + changeAt(level, b, BeatsPerBar);
+        if (score > best) {
+            best = score;
+            downbeat = phase;
+        }
+    }
+    const long numBars = (numBeats - downbeat) / BeatsPerBar;
+    if (numBars < 1) return result;
+    const double barSec = BeatsPerBar * beatSec;
+    result.downbeatSec = firstBeatSec + downbeat * beatSec;
+    std::vector<double> barLevel((size_t) numBars);
+    for (long k = 0; k < numBars; ++k)
+        barLevel[(size_t) k] = meanOf(level, downbeat + k * BeatsPerBar, downbeat + (k + 1) * BeatsPerBar);
+
+    // Phrase alignment: the 4-bar step the largest changes between 4-bar blocks fall on, the
+    // first downbeat on a tie
+    long offset = 0;
+    best = -1.0;
+    for (long step = 0; step < PhraseBars; step += BlockBars) {
+        double score = 0.0;
+        for (long k = step; k < numBars; k += PhraseBars) score += changeAt(barLevel, k, BlockBars);
+        if (score > best + 1e-9) {
+            best = score;
+            offset = step;
+        }
+    }
+    std::vector<long> starts;
+    if (offset > 0) starts.push_back(0);
+    for (long k = offset; k < numBars; k += PhraseBars) starts.push_back(k);
+    // A tail shorter than a block goes with the phrase before it
+    if (starts.size() > 1 && numBars - starts.back() < BlockBars) starts.pop_back();
+
+    const size_t count = starts.size();
+    std::vector<double> phraseLevel(count);
+    std::vector<bool> rising(count);
+    for (size_t i = 0; i < count; ++i) {
+        const long from = starts[i];
+        const long to = i + 1 < count ? starts[i + 1] : numBars;
+        Phrase phrase;
+        phrase.startSec = result.downbeatSec + (double) from * barSec;
+        phrase.endSec = i + 1 < count ? result.downbeatSec + (double) to * barSec : lengthSec;
+        phrase.bars = (int) (to - from);
+        result.phrases.push_back(phrase);
+        phraseLevel[i] = meanOf(barLevel, from, to);
+        const long quarter = std::max(1L, (to - from) / 4);
+        rising[i] = meanOf(barLevel, to - quarter, to) > RiseRatio * meanOf(barLevel, from, from + quarter);
+    }
+
+    const double loudest = *std::max_element(phraseLevel.begin(), phraseLevel.end());
+    std::vector<bool> drop(count);
+    for (size_t i = 0; i < count; ++i) drop[i] = phraseLevel[i] >= DropLevel * loudest;
+    const size_t firstDrop = (size_t) (std::find(drop.begin(), drop.end(), true) - drop.begin());
+    const size_t lastDrop = count - 1 - (size_t) (std::find(drop.rbegin(), drop.rend(), true) - drop.rbegin());
+    // Back to front, so a build may run over several phrases into its drop
+    for (size_t i = count; i-- > 0;) {
+        Section& section = result.phrases[i].section;
+        if (drop[i]) section = Section::Drop;
+        else if (rising[i] && i + 1 < count && (drop[i + 1] || result.phrases[i + 1].section == Section::Build))
+            section = Section::Build;
+        else if (i < firstDrop) section = Section::Intro;
+        else if (i > lastDrop) section = Section::Outro;
+        else section = Section::Breakdown;
+    }
+
+    std::vector<Phrase> merged;
+    merged.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Phrase& phrase = result.phrases[i];
+        if (i + 1 < count && phrase.bars == PhraseBars && result.phrases[i + 1].bars == PhraseBars
+            && result.phrases[i + 1].section == phrase.section) {
+            Phrase both = phrase;
+            both.endSec = result.phrases[i + 1].endSec;
+            both.bars = 2 * PhraseBars;
+            merged.push_back(both);
+            ++i;
+            continue;
+        }
+        merged.push_back(phrase);
+    }
+    result.phrases = std::move(merged);
+    return result;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Bars and phrases of a track on its beat grid. Found once per analysis from the loudness
+ * envelope the BPM pass collects over the whole track (BpmAnalyzer::getStructure), cached with
+ * the grid (BpmCache::Entry) and published with the deck's BeatGrid, so readers on any thread
+ * look phrases up without locks.
+ *
+ * The downbeat is the one of the first four beats whose bar boundaries carry the largest
+ * loudness changes and the strongest full-band onsets (crashes, drum entries). From it the track
+ * is cut into PhraseBars-bar phrases, aligned the same way over 4-bar steps, so a track that
+ * doesn't open on a phrase gets a shorter first one; two neighbouring phrases of the same kind
+ * merge into one of twice the length. The kind follows a phrase's loudness with the low band
+ * weighted in, relative to the loudest phrase: Drop from DropLevel, Build when it rises by
+ * RiseRatio through its length into a drop, Intro before the first drop, Outro after the last,
+ * Breakdown in between.
+ */
+struct TrackStructure {
+    enum class Section : uint8_t { Intro, Build, Drop, Breakdown, Outro };
+    static constexpr int NumSections = 5;
+    static constexpr int BeatsPerBar = 4;
+    static constexpr int PhraseBars = 16;
+    static constexpr double DropLevel = 0.85;
+    static constexpr double RiseRatio = 1.3;
+
+    struct Phrase {
+        double startSec{0.0};
+        double endSec{0.0};
+        int bars{0};
+        Section section{Section::Intro};
+    };
+
+    // RMS of the whole track every hopSeconds, of the full band and of the band below LowBandHz
+    struct Envelope {
+        static constexpr double LowBandHz = 150.0;
+        std::vector<float> full;
+        std::vector<float> low;
+        double hopSeconds{0.0};
+    };
+
+    double downbeatSec{-1.0};       // first downbeat; negative without a structure
+    std::vector<Phrase> phrases;    // consecutive, the first starting on downbeatSec
+
+    bool isValid() const { return downbeatSec >= 0.0 && !phrases.empty(); }
+    // Phrase containing timeSec; -1 before the first downbeat or without phrases, the last one past the end
+    int phraseAt(double timeSec) const;
+    // First phrase of `section` from index `from` on; -1 if there is none
+    int find(Section section, int from = 0) const;
+    // First phrase of the last run of `section`; -1 if there is none
+    int findLastRun(Section section) const;
+
+    static const char* getSectionName(Section section);
+    // 0xRRGGBB the waveforms tint the section with
+    static uint32_t getSectionColor(Section section);
+    // Empty (invalid) without a usable BPM, length or envelope
+    static TrackStructure detect(const Envelope& envelope, double bpm, double firstBeatSec, double lengthSec);
+};
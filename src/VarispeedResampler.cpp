@@ -0,0 +1,226 @@
+#include "VarispeedResampler.h"
+#include "SimdDispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr double kKaiserBeta = 8.0;
+
+    // Upper ratio of each anti-alias band; band 0 (ratio <= 1) is a full-band, transparent kernel
+    constexpr double kBandRatios[] = { 1.0, 1.5, 2.0, 3.0, 4.0 };
+
+    double besselI0(double x) {
+        double sum = 1.0, term = 1.0;
+        const double halfX = x * 0.5;
+        for (int k = 1; k < 32; ++k) {
+            term *= (halfX / k) * (halfX / k);
+            sum += term;
+            if (term < 1.0e-12 * sum) break;
+        }
+        return sum;
+    }
+}
+
+VarispeedResampler::VarispeedResampler(juce::AudioSource* inputSource, int channels)
+    : input(inputSource), numChannels(juce::jmax(1, channels)) {
+}
+
+void VarispeedResampler::setResamplingRatio(double samplesInPerOutputSample) {
+    targetRatio.store(juce::jlimit(MinRatio, MaxRatio, samplesInPerOutputSample), std::memory_order_relaxed);
+}
+
+void VarispeedResampler::flushBuffers() {
+    inputBuffer.clear();
+    validSamples = TapsBefore;   // zeroed history in front of the first sample
+    readPos = (double) TapsBefore;
+}
+
+void VarispeedResampler::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    if (!tablesBuilt) buildSincTables();
+
+    maxChunk = juce::jmax(64, samplesPerBlockExpected);
+    const int capacity = TapsBefore + 1 + (int) std::ceil(maxChunk * MaxRatio) + TapsAfter + 8;
+    inputBuffer.setSize(numChannels, capacity);
+    flushBuffers();
+    currentRatio = targetRatio.load(std::memory_order_relaxed);
+
+    if (input) input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void VarispeedResampler::releaseResources() {
+    if (input) input->releaseResources();
+    inputBuffer.setSize(numChannels, 0);
+    validSamples = 0;
+}
+
+void VarispeedResampler::buildSincTables() {
+    const size_t rowsPerBand = (size_t) (NumPhases + 1);
+    sincTable.assign((size_t) NumCutoffBands * rowsPerBand * NumTaps, 0.0f);
+    sincDelta.assign(sincTable.size(), 0.0f);
+
+    const double halfWidth = NumTaps / 2.0;
+    const double i0Beta = besselI0(kKaiserBeta);
+
+    for (int band = 0; band < NumCutoffBands; ++band) {
+        const double cutoff = band == 0 ? 1.0 : 0.92 / kBandRatios[band];
+
+        for (int p = 0; p <= NumPhases; ++p) {
+            const double frac = (double) p / NumPhases;
+            float* row = &sincTable[((size_t) band * rowsPerBand + (size_t) p) * NumTaps];
+
+            double sum = 0.0;
+            double values[NumTaps];
+            for (int k = 0; k < NumTaps; ++k) {
+                const double t = (double) (k - TapsBefore) - frac;
+                const double x = cutoff * t;
+                const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+                const double w = t / halfWidth;
+                const double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(kKaiserBeta * std::sqrt(1.0 - w * w)) / i0Beta;
+                values[k] = cutoff * sinc * window;
+                sum += values[k];
+            }
+            // Unity DC gain for every phase, otherwise fractional positions would ripple in level
+            for (int k = 0; k < NumTaps; ++k)
+                row[k] = (float) (values[k] / sum);
+        }
+
+        for (int p = 0; p < NumPhases; ++p) {
+            const float* row = &sincTable[((size_t) band * rowsPerBand + (size_t) p) * NumTaps];
+            float* delta = &sincDelta[((size_t) band * rowsPerBand + (size_t) p) * NumTaps];
+            for (int k = 0; k < NumTaps; ++k)
+                delta[k] = row[k + NumTaps] - row[k];
+        }
+    }
+    tablesBuilt = true;
+}
+
+int VarispeedResampler::cutoffBandFor(double ratio) const noexcept {
+    for (int band = 0; band < NumCutoffBands - 1; ++band)
+        if (ratio <= kBandRatios[band]) return band;
+    return NumCutoffBands - 1;
+}
+
+SIMD_DISPATCH
+double VarispeedResampler::renderSinc(const float* const* src, float* const* dst, int outChannels, int numSamples,
+                                      double pos, double startRatio, double step, const float* table,
+                                      const float* delta) noexcept {
+    static_assert(NumTaps % 8 == 0, "the tap loop runs eight lanes at a time");
+    alignas(64) float coeff[NumTaps];
+    for (int i = 0; i < numSamples; ++i) {
+        const int ip = (int) pos;
+        const float phase = (float) (pos - ip) * NumPhases;
+        const int p = std::min((int) phase, NumPhases - 1);
+        const float pf = phase - (float) p;
+
+        // Interpolate between neighbouring phases once, then share the row across channels
+        const float* h = table + (size_t) p * NumTaps;
+        const float* d = delta + (size_t) p * NumTaps;
+        for (int k = 0; k < NumTaps; ++k)
+            coeff[k] = h[k] + pf * d[k];
+
+        for (int ch = 0; ch < outChannels; ++ch) {
+            const float* x = src[ch] + ip - TapsBefore;
+            // Eight independent lanes: one AVX register, or two SSE / NEON ones, without -ffast-math
+            float lanes[8] = {};
+            for (int k = 0; k < NumTaps; k += 8)
+                for (int l = 0; l < 8; ++l)
+                    lanes[l] += x[k + l] * coeff[k + l];
+            dst[ch][i] = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+        pos += startRatio + step * (i + 1);
+    }
+    return pos;
+}
+
+void VarispeedResampler::fillInput(int needed) {
+    needed = std::min(needed, inputBuffer.getNumSamples());
+    if (needed <= validSamples) return;
+
+    juce::AudioSourceChannelInfo fill(&inputBuffer, validSamples, needed - validSamples);
+    if (input) {
+        const juce::int64 start = juce::Time::getHighResolutionTicks();
+        input->getNextAudioBlock(fill);
+        inputTicks += juce::Time::getHighResolutionTicks() - start;
+    } else {
+        fill.clearActiveBufferRegion();
+    }
+    validSamples = needed;
+}
+
+void VarispeedResampler::getNextAudioBlock(const juce::AudioSourceChannelInfo& info) {
+    if (inputBuffer.getNumSamples() == 0 || !tablesBuilt) {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    const double startRatio = currentRatio;
+    const double endRatio = targetRatio.load(std::memory_order_relaxed);
+    const int total = info.numSamples;
+
+    // Oversized device blocks are split so every chunk fits the preallocated history
+    for (int done = 0; done < total; ) {
+        const int n = std::min(maxChunk, total - done);
+        const double r0 = startRatio + (endRatio - startRatio) * done / total;
+        const double r1 = startRatio + (endRatio - startRatio) * (done + n) / total;
+        renderChunk(info, done, n, r0, r1);
+        done += n;
+    }
+    currentRatio = endRatio;
+}
+
+void VarispeedResampler::renderChunk(const juce::AudioSourceChannelInfo& info, int offset, int n,
+                                     double r0, double r1) {
+    // Slide the history down so the read position sits just after TapsBefore samples
+    const int discard = (int) readPos - TapsBefore;
+    if (discard > 0) {
+        const int keep = validSamples - discard;
+        for (int ch = 0; ch < numChannels; ++ch) {
+            float* data = inputBuffer.getWritePointer(ch);
+            std::memmove(data, data + discard, (size_t) std::max(0, keep) * sizeof(float));
+        }
+        validSamples = std::max(0, keep);
+        readPos -= discard;
+    }
+
+    fillInput((int) (readPos + n * std::max(r0, r1)) + TapsAfter + 2);
+
+    auto& out = *info.buffer;
+    const int outChannels = std::min(out.getNumChannels(), numChannels);
+    if (outChannels == 0) return;
+    const int start = info.startSample + offset;
+    const double step = (r1 - r0) / n;
+
+    // Unity ratio on an integer position is an exact copy (keylock path, decks at 0% pitch)
+    if (r0 == 1.0 && r1 == 1.0 && readPos == std::floor(readPos)) {
+        const int ip = (int) readPos;
+        for (int ch = 0; ch < outChannels; ++ch)
+            out.copyFrom(ch, start, inputBuffer, ch, ip, n);
+        readPos += n;
+    } else if ((Engine) engine.load(std::memory_order_relaxed) == Engine::Linear) {
+        const float* src[2] = { inputBuffer.getReadPointer(0), inputBuffer.getReadPointer(std::min(1, numChannels - 1)) };
+        float* dst[2] = { out.getWritePointer(0, start), outChannels > 1 ? out.getWritePointer(1, start) : nullptr };
+        double pos = readPos;
+        for (int i = 0; i < n; ++i) {
+            const int ip = (int) pos;
+            const float frac = (float) (pos - ip);
+            for (int ch = 0; ch < outChannels; ++ch)
+                dst[ch][i] = src[ch][ip] + frac * (src[ch][ip + 1] - src[ch][ip]);
+            pos += r0 + step * (i + 1);
+        }
+        readPos = pos;
+    } else {
+        const size_t rowsPerBand = (size_t) (NumPhases + 1);
+        const size_t bandOffset = (size_t) cutoffBandFor(std::max(r0, r1)) * rowsPerBand * NumTaps;
+        const float* table = sincTable.data() + bandOffset;
+        const float* delta = sincDelta.data() + bandOffset;
+        const float* src[2] = { inputBuffer.getReadPointer(0), inputBuffer.getReadPointer(std::min(1, numChannels - 1)) };
+        float* dst[2] = { out.getWritePointer(0, start), outChannels > 1 ? out.getWritePointer(1, start) : nullptr };
+        readPos = renderSinc(src, dst, outChannels, n, readPos, r0, step, table, delta);
+    }
+
+    for (int ch = outChannels; ch < out.getNumChannels(); ++ch)
+        out.clear(ch, start, n);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * Varispeed resampler for tempo changes and scratching (replaces juce::ResamplingAudioSource).
+ *
+ * The ratio set with setResamplingRatio() is a target: each block ramps linearly from the
+ * previous ratio to it, so per-block scratch velocity updates bend smoothly instead of stepping.
+ * Two engines share the same input history:
+ *   - Linear: 2-point interpolation, cheapest, for weak machines
+ *   - Sinc:   16-tap Kaiser-windowed sinc from a polyphase table built in prepareToPlay(),
+ *             with a few precomputed anti-alias cutoffs selected by ratio (no filter redesign
+ *             when the ratio moves). The tap loop is fixed-length over contiguous rows so the
+ *             compiler vectorises it, once per instruction set (SimdDispatch.h).
+ * Everything is preallocated in prepareToPlay(); getNextAudioBlock() never allocates.
+ */
+class VarispeedResampler : public juce::AudioSource {
+public:
+    enum class Engine { Linear = 0, Sinc };
+
+    static constexpr double MaxRatio = 8.0;
+    static constexpr double MinRatio = 0.01;
+
+    VarispeedResampler(juce::AudioSource* input, int numChannels = 2);
+
+    // Input samples consumed per output sample (target; reached by the end of the next block)
+    void setResamplingRatio(double samplesInPerOutputSample);
+    double getResamplingRatio() const noexcept { return targetRatio.load(std::memory_order_relaxed); }
+
+    void setEngine(Engine e) noexcept { engine.store((int) e, std::memory_order_relaxed); }
+    Engine getEngine() const noexcept { return (Engine) engine.load(std::memory_order_relaxed); }
+
+    // Audio thread: input already pulled from the source but not played yet (look-ahead), in samples
+    double getBufferedInputSamples() const noexcept { return validSamples - readPos; }
+
+    // Drop the input history (e.g. after a hard seek)
+    void flushBuffers();
+    // Audio thread: pull from another source from the next block on; it is not prepared here,
+    // the caller hands over one that already is
+    void setInput(juce::AudioSource* newInput) noexcept { input = newInput; }
+    // Audio thread: high-resolution ticks spent pulling from the input since the last call
+    juce::int64 takeInputTicks() noexcept { const juce::int64 t = inputTicks; inputTicks = 0; return t; }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override;
+
+private:
+    static constexpr int NumTaps = 16;
+    static constexpr int TapsBefore = NumTaps / 2 - 1;   // history samples left of the read position
+    static constexpr int TapsAfter = NumTaps / 2;        // look-ahead samples right of it
+    static constexpr int NumPhases = 256;
+    static constexpr int NumCutoffBands = 5;
+
+    void buildSincTables();
+    int cutoffBandFor(double ratio) const noexcept;
+    // Render one chunk that fits into the preallocated input buffer
+    void renderChunk(const juce::AudioSourceChannelInfo& info, int offset, int numSamples,
+                     double startRatio, double endRatio);
+    // Make sure at least `needed` samples are valid in inputBuffer, pulling from the input source
+    void fillInput(int needed);
+    // The sinc engine's per-sample loop; returns the read position after the last sample
+    static double renderSinc(const float* const* src, float* const* dst, int outChannels, int numSamples,
+                             double pos, double startRatio, double step, const float* table, const float* delta) noexcept;
+
+    juce::AudioSource* input;
+    const int numChannels;
+
+    std::atomic<double> targetRatio{1.0};
+    double currentRatio{1.0};
+    std::atomic<int> engine{(int) Engine::Sinc};
+
+    juce::AudioBuffer<float> inputBuffer;
+    int validSamples{0};      // samples of inputBuffer holding real input
+    juce::int64 inputTicks{0};
+    double readPos{0.0};      // fractional read position inside inputBuffer
+    int maxChunk{512};        // output samples per renderChunk()
+
+    // [band][phase (NumPhases + 1 rows)][tap], plus the per-phase deltas for inter-phase interpolation
+    std::vector<float> sincTable;
+    std::vector<float> sincDelta;
+    bool tablesBuilt{false};
+};
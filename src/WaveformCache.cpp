@@ -0,0 +1,349 @@
+#include "WaveformCache.h"
+#include "ContentHash.h"
+#include "SharedCache.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr char Magic[8] = { 'P', 'D', 'X', 'W', 'A', 'V', 'E', '\0' };
+    // magic, version, numLevels, size, mtime, totalSamples, sampleRate, audioStart, audioEnd, pathBytes, reserved
+    constexpr size_t HeaderBytes = 8 + 4 + 4 + 8 + 8 + 8 + 8 + 8 + 8 + 4 + 4;
+    constexpr size_t LevelEntryBytes = 4 + 4 + 8;
+    constexpr const char* Extension = ".pwf";
+
+    double readDouble(const char* p)
+    {
+        const juce::int64 bits = (juce::int64) juce::ByteOrder::littleEndianInt64(p);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    struct MappedSummary {
+        int numLevels{0};
+        juce::int64 totalSamples{0};
+        double sampleRate{0.0};
+        double audioStart{0.0};
+        double audioEnd{0.0};
+        std::array<WaveformCache::LevelView, WaveformCache::MaxLevels> levels{};
+    };
+
+    // The header and level views of a mapped cache file; false unless it is a current summary of audioFile
+    bool mapSummary(const juce::MemoryMappedFile& mapped, const juce::File& audioFile, MappedSummary& summary)
+    {
+        const char* data = static_cast<const char*>(mapped.getData());
+        const size_t size = mapped.getSize();
+        if (data == nullptr || size < HeaderBytes || std::memcmp(data, Magic, sizeof(Magic)) != 0) return false;
+
+        if (juce::ByteOrder::littleEndianInt(data + 8) != WaveformCache::Version) return false;
+        const int numLevels = (int) juce::ByteOrder::littleEndianInt(data + 12);
+        const auto sourceSize = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 16);
+        const auto sourceModMs = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 24);
+        summary.totalSamples = (juce::int64) juce::ByteOrder::littleEndianInt64(data + 32);
+        summary.sampleRate = readDouble(data + 40);
+        summary.audioStart = readDouble(data + 48);
+        summary.audioEnd = readDouble(data + 56);
+        const size_t pathBytes = juce::ByteOrder::littleEndianInt(data + 64);
+
+        if (numLevels <= 0 || numLevels > WaveformCache::MaxLevels || summary.totalSamples <= 0 || summary.sampleRate <= 0.0)
+            return false;
+        if (sourceSize != audioFile.getSize() || sourceModMs != audioFile.getLastModificationTime().toMilliseconds())
+            return false;
+
+        const size_t pathOffset = HeaderBytes + LevelEntryBytes * (size_t) numLevels;
+        if (pathOffset + pathBytes > size) return false;
+        if (juce::String::fromUTF8(data + pathOffset, (int) pathBytes) != audioFile.getFullPathName()) return false;
+
+        for (int l = 0; l < numLevels; ++l) {
+            const char* entry = data + HeaderBytes + LevelEntryBytes * (size_t) l;
+            auto& view = summary.levels[(size_t) l];
+            view.samplesPerBin = (int) juce::ByteOrder::littleEndianInt(entry);
+            view.numBins = (int) juce::ByteOrder::littleEndianInt(entry + 4);
+            const auto levelOffset = (juce::uint64) juce::ByteOrder::littleEndianInt64(entry + 8);
+            if (view.samplesPerBin <= 0 || view.numBins <= 0
+                || levelOffset + (2 + WaveformCache::NumBands) * (juce::uint64) view.numBins > size)
+                return false;
+            view.minMax = reinterpret_cast<const std::int8_t*>(data + levelOffset);
+            view.bands = reinterpret_cast<const std::uint8_t*>(data + levelOffset + 2 * (juce::uint64) view.numBins);
+        }
+        summary.numLevels = numLevels;
+        return true;
+    }
+}
+
+WaveformCache::WaveformCache(const juce::File& dir) : directory(dir)
+{
+}
+
+juce::File WaveformCache::getCacheFileFor(const juce::File& audioFile) const
+{
+    const auto key = juce::String::toHexString(audioFile.getFullPathName().hashCode64());
+    return directory.getChildFile(key + Extension);
+}
+
+bool WaveformCache::store(const juce::File& audioFile, const Summary& summary) const
+{
+    if (!isEnabled() || summary.levels.empty()) return false;
+
+    const juce::String path = audioFile.getFullPathName();
+    const size_t pathBytes = path.getNumBytesAsUTF8();
+    const int numLevels = std::min((int) summary.levels.size(), MaxLevels);
+
+    juce::MemoryOutputStream out;
+    out.write(Magic, sizeof(Magic));
+    out.writeInt((int) Version);
+    out.writeInt(numLevels);
+    out.writeInt64(audioFile.getSize());
+    out.writeInt64(audioFile.getLastModificationTime().toMilliseconds());
+    out.writeInt64(summary.totalSamples);
+    out.writeDouble(summary.sampleRate);
+    out.writeDouble(summary.audioStartOffsetSec);
+    out.writeDouble(summary.audioEndOffsetSec);
+    out.writeInt((int) pathBytes);
+    out.writeInt(0);
+
+    juce::uint64 offset = HeaderBytes + LevelEntryBytes * (size_t) numLevels + pathBytes;
+    for (int l = 0; l < numLevels; ++l) {
+        const auto& level = summary.levels[(size_t) l];
+        out.writeInt(level.samplesPerBin);
+        out.writeInt(level.numBins());
+        out.writeInt64((juce::int64) offset);
+        offset += level.minMax.size() + (size_t) level.numBins() * NumBands;
+    }
+    out.write(path.toRawUTF8(), pathBytes);
+    // Per level: min/max pairs, then band energies (zero if the analysis had none)
+    for (int l = 0; l < numLevels; ++l) {
+        const auto& level = summary.levels[(size_t) l];
+        out.write(level.minMax.data(), level.minMax.size());
+        const size_t bandBytes = (size_t) level.numBins() * NumBands;
+        if (level.bands.size() == bandBytes) out.write(level.bands.data(), bandBytes);
+        else out.writeRepeatedByte(0, bandBytes);
+    }
+
+    const juce::File target = getCacheFileFor(audioFile);
+    juce::TemporaryFile temp(target);
+    if (!temp.getFile().replaceWithData(out.getData(), out.getDataSize()) || !temp.overwriteTargetFileWithTemporary()) {
+        std::cout << "WaveformCache: failed to write " << target.getFullPathName().toStdString() << std::endl;
+        return false;
+    }
+
+    if (SharedCache::isEnabled()) {
+        const juce::String key = ContentHash::keyFor(audioFile);
+        const auto shared = relabel(out.getMemoryBlock(), path, SharedCache::identityFor(key), 0, 0);
+        if (shared.getSize() > 0)
+            SharedCache::publish(SharedCache::fileFor(directory, key, Extension), shared.getData(), shared.getSize());
+    }
+    return true;
+}
+
+bool WaveformCache::load(const juce::File& audioFile, int binCount, std::vector<std::int8_t>& minBins,
+                         std::vector<std::int8_t>& maxBins, double& audioStartOffsetSec, juce::int64& totalSamples,
+                         double& sampleRate, std::vector<std::uint8_t>* bands, double* audioEndOffsetSec) const
+{
+    if (!isEnabled() || binCount <= 0) return false;
+    if (loadLocal(audioFile, binCount, minBins, maxBins, audioStartOffsetSec, totalSamples, sampleRate, bands, audioEndOffsetSec))
+        return true;
+    return fetchShared(audioFile)
+        && loadLocal(audioFile, binCount, minBins, maxBins, audioStartOffsetSec, totalSamples, sampleRate, bands, audioEndOffsetSec);
+}
+
+bool WaveformCache::fetchShared(const juce::File& audioFile) const
+{
+    if (!SharedCache::isEnabled()) return false;
+    const juce::String key = ContentHash::keyFor(audioFile);
+    const juce::File source = SharedCache::fileFor(directory, key, Extension);
+    juce::MemoryBlock shared;
+    if (!source.existsAsFile() || !source.loadFileAsData(shared)) return false;
+    const auto local = relabel(shared, SharedCache::identityFor(key), audioFile.getFullPathName(), audioFile.getSize(),
+                               audioFile.getLastModificationTime().toMilliseconds());
+    if (local.getSize() == 0) return false;
+    juce::TemporaryFile temp(getCacheFileFor(audioFile));
+    return temp.getFile().replaceWithData(local.getData(), local.getSize()) && temp.overwriteTargetFileWithTemporary();
+}
+
+bool WaveformCache::relink(const juce::File& from, juce::int64 fromSize, juce::int64 fromModifiedMs, const juce::File& to) const
+{
+    if (!isEnabled()) return false;
+    const juce::File source = getCacheFileFor(from);
+    const bool moved = from != to;
+    juce::MemoryBlock data;
+    if ((moved && getCacheFileFor(to).existsAsFile()) || !source.existsAsFile() || !source.loadFileAsData(data)
+        || data.getSize() < HeaderBytes)
+        return false;
+    const char* header = static_cast<const char*>(data.getData());
+    if ((juce::int64) juce::ByteOrder::littleEndianInt64(header + 16) != fromSize
+        || (juce::int64) juce::ByteOrder::littleEndianInt64(header + 24) != fromModifiedMs)
+        return false;
+    const auto relinked = relabel(data, from.getFullPathName(), to.getFullPathName(), to.getSize(),
+                                  to.getLastModificationTime().toMilliseconds());
+    if (relinked.getSize() == 0) return false;
+    juce::TemporaryFile temp(getCacheFileFor(to));
+    if (!temp.getFile().replaceWithData(relinked.getData(), relinked.getSize()) || !temp.overwriteTargetFileWithTemporary())
+        return false;
+    if (moved) source.deleteFile();
+    return true;
+}
+
+juce::MemoryBlock WaveformCache::relabel(const juce::MemoryBlock& file, const juce::String& from, const juce::String& to,
+                                         juce::int64 sourceSize, juce::int64 sourceModifiedMs)
+{
+    const char* data = static_cast<const char*>(file.getData());
+    const size_t size = file.getSize();
+    if (size < HeaderBytes || std::memcmp(data, Magic, sizeof(Magic)) != 0
+        || juce::ByteOrder::littleEndianInt(data + 8) != Version)
+        return {};
+    const int numLevels = (int) juce::ByteOrder::littleEndianInt(data + 12);
+    const size_t pathBytes = juce::ByteOrder::littleEndianInt(data + 64);
+    const size_t pathOffset = HeaderBytes + LevelEntryBytes * (size_t) std::max(0, numLevels);
+    if (numLevels <= 0 || numLevels > MaxLevels || pathOffset + pathBytes > size
+        || juce::String::fromUTF8(data + pathOffset, (int) pathBytes) != from)
+        return {};
+
+    // Same layout; the levels move by the difference in path length
+    const size_t toBytes = to.getNumBytesAsUTF8();
+    const auto shift = (juce::int64) toBytes - (juce::int64) pathBytes;
+    juce::MemoryOutputStream out(size + toBytes);
+    out.write(data, 16);                  // magic, version, numLevels
+    out.writeInt64(sourceSize);
+    out.writeInt64(sourceModifiedMs);
+    out.write(data + 32, 32);             // totalSamples, sampleRate, audioStart, audioEnd
+    out.writeInt((int) toBytes);
+    out.writeInt(0);
+    for (int l = 0; l < numLevels; ++l) {
+        const char* entry = data + HeaderBytes + LevelEntryBytes * (size_t) l;
+        out.write(entry, 8);
+        out.writeInt64((juce::int64) juce::ByteOrder::littleEndianInt64(entry + 8) + shift);
+    }
+    out.write(to.toRawUTF8(), toBytes);
+    out.write(data + pathOffset + pathBytes, size - pathOffset - pathBytes);
+    return out.getMemoryBlock();
+}
+
+bool WaveformCache::loadLocal(const juce::File& audioFile, int binCount, std::vector<std::int8_t>& minBins,
+                              std::vector<std::int8_t>& maxBins, double& audioStartOffsetSec, juce::int64& totalSamples,
+                              double& sampleRate, std::vector<std::uint8_t>* bands, double* audioEndOffsetSec) const
+{
+    const juce::File cacheFile = getCacheFileFor(audioFile);
+    if (!cacheFile.existsAsFile()) return false;
+
+    juce::MemoryMappedFile mapped(cacheFile, juce::MemoryMappedFile::readOnly);
+    MappedSummary summary;
+    if (!mapSummary(mapped, audioFile, summary)) return false;
+
+    const auto startSample = (juce::int64) std::llround(summary.audioStart * summary.sampleRate);
+    resample(summary.levels.data(), summary.numLevels, startSample, summary.totalSamples, binCount, minBins, maxBins, bands);
+    audioStartOffsetSec = summary.audioStart;
+    if (audioEndOffsetSec != nullptr) *audioEndOffsetSec = summary.audioEnd;
+    totalSamples = summary.totalSamples;
+    sampleRate = summary.sampleRate;
+    return true;
+}
+
+bool WaveformCache::loadTile(const juce::File& audioFile, int level, int firstBin, int numBins, Tile& tile) const
+{
+    if (!isEnabled() || level < 0 || firstBin < 0 || numBins < 0) return false;
+    if (loadTileLocal(audioFile, level, firstBin, numBins, tile)) return true;
+    return fetchShared(audioFile) && loadTileLocal(audioFile, level, firstBin, numBins, tile);
+}
+
+bool WaveformCache::loadTileLocal(const juce::File& audioFile, int level, int firstBin, int numBins, Tile& tile) const
+{
+    const juce::File cacheFile = getCacheFileFor(audioFile);
+    if (!cacheFile.existsAsFile()) return false;
+
+    juce::MemoryMappedFile mapped(cacheFile, juce::MemoryMappedFile::readOnly);
+    MappedSummary summary;
+    if (!mapSummary(mapped, audioFile, summary) || level >= summary.numLevels) return false;
+
+    tile.totalSamples = summary.totalSamples;
+    tile.sampleRate = summary.sampleRate;
+    tile.audioStartOffsetSec = summary.audioStart;
+    tile.audioEndOffsetSec = summary.audioEnd;
+    tile.numLevels = summary.numLevels;
+    for (int l = 0; l < MaxLevels; ++l) {
+        const auto& view = summary.levels[(size_t) l];
+        tile.levelBins[(size_t) l] = l < summary.numLevels ? view.numBins : 0;
+        tile.levelSamplesPerBin[(size_t) l] = l < summary.numLevels ? view.samplesPerBin : 0;
+    }
+
+    const auto& view = summary.levels[(size_t) level];
+    tile.level = level;
+    tile.firstBin = std::min(firstBin, view.numBins);
+    const int count = std::min(numBins, view.numBins - tile.firstBin);
+    tile.minMax.assign(view.minMax + 2 * tile.firstBin, view.minMax + 2 * (tile.firstBin + count));
+    tile.bands.assign(view.bands + NumBands * tile.firstBin, view.bands + NumBands * (tile.firstBin + count));
+    return true;
+}
+
+void WaveformCache::buildLevels(Summary& summary)
+{
+    if (summary.levels.empty()) return;
+    while ((int) summary.levels.size() < MaxLevels && summary.levels.back().numBins() > 1024) {
+        const Level& finer = summary.levels.back();
+        Level coarser;
+        coarser.samplesPerBin = finer.samplesPerBin * LevelFactor;
+        const int bins = (finer.numBins() + LevelFactor - 1) / LevelFactor;
+        coarser.minMax.resize((size_t) bins * 2);
+        const bool hasBands = finer.bands.size() == (size_t) finer.numBins() * NumBands;
+        if (hasBands) coarser.bands.resize((size_t) bins * NumBands);
+        for (int b = 0; b < bins; ++b) {
+            std::int8_t lo = 0, hi = 0;
+            std::array<int, NumBands> energy{};
+            const int end = std::min(finer.numBins(), (b + 1) * LevelFactor);
+            for (int i = b * LevelFactor; i < end; ++i) {
+                lo = std::min(lo, finer.minMax[(size_t) i * 2]);
+                hi = std::max(hi, finer.minMax[(size_t) i * 2 + 1]);
+                if (hasBands)
+                    for (int k = 0; k < NumBands; ++k) energy[(size_t) k] += finer.bands[(size_t) i * NumBands + (size_t) k];
+            }
+            coarser.minMax[(size_t) b * 2] = lo;
+            coarser.minMax[(size_t) b * 2 + 1] = hi;
+            // Energies average, peaks don't
+            if (hasBands)
+                for (int k = 0; k < NumBands; ++k)
+                    coarser.bands[(size_t) b * NumBands + (size_t) k] = (std::uint8_t) (energy[(size_t) k] / (end - b * LevelFactor));
+        }
+        summary.levels.push_back(std::move(coarser));
+    }
+}
+
+void WaveformCache::resample(const LevelView* levels, int numLevels, juce::int64 startSample,
+                             juce::int64 totalSamples, int binCount, std::vector<std::int8_t>& minBins,
+                             std::vector<std::int8_t>& maxBins, std::vector<std::uint8_t>* bands)
+{
+    minBins.assign((size_t) std::max(0, binCount), 0);
+    maxBins.assign((size_t) std::max(0, binCount), 0);
+    if (bands != nullptr) bands->assign((size_t) std::max(0, binCount) * NumBands, 0);
+    if (numLevels <= 0 || binCount <= 0 || totalSamples <= startSample) return;
+
+    // Coarsest level that still has at least one bin per output bin
+    const double samplesPerOutBin = (double) (totalSamples - startSample) / (double) binCount;
+    const LevelView* level = &levels[0];
+    for (int l = 1; l < numLevels; ++l)
+        if (levels[l].samplesPerBin <= samplesPerOutBin) level = &levels[l];
+
+    const double spb = level->samplesPerBin;
+    for (int b = 0; b < binCount; ++b) {
+        const double s0 = (double) startSample + b * samplesPerOutBin;
+        const double s1 = s0 + samplesPerOutBin;
+        const int i0 = std::min(level->numBins - 1, (int) std::floor(s0 / spb));
+        const int i1 = std::min(level->numBins, std::max(i0 + 1, (int) std::ceil(s1 / spb)));
+        std::int8_t lo = 0, hi = 0;
+        for (int i = i0; i < i1; ++i) {
+            lo = std::min(lo, level->minMax[(size_t) i * 2]);
+            hi = std::max(hi, level->minMax[(size_t) i * 2 + 1]);
+        }
+        minBins[(size_t) b] = lo;
+        maxBins[(size_t) b] = hi;
+        if (bands != nullptr && level->bands != nullptr && i1 > i0) {
+            for (int k = 0; k < NumBands; ++k) {
+                int sum = 0;
+                for (int i = i0; i < i1; ++i) sum += level->bands[(size_t) i * NumBands + (size_t) k];
+                (*bands)[(size_t) b * NumBands + (size_t) k] = (std::uint8_t) ((sum + (i1 - i0) / 2) / (i1 - i0));
+            }
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * On-disk waveform summaries, one file per track in AppConfig::getWaveformCacheDirectory().
+ *
+ * A summary holds min/max pairs (8-bit, mono mix) and low/mid/high band energies at
+ * BaseSamplesPerBin plus coarser levels, each 4x the previous, together with the detected
+ * audible start and end. Files are keyed by a hash of
+ * the path and carry the path, size and modification time of the source, so a changed or moved
+ * track simply misses. Loading memory-maps the file and resamples the best-fitting level to the
+ * requested bin count without decoding any audio.
+ *
+ * With a SharedCache root set, a miss is looked up there by the track's ContentHash and the
+ * summary found is copied here; store() writes every summary back. A shared file carries the
+ * key in place of the path, and no size or time.
+ */
+class WaveformCache {
+public:
+    static constexpr juce::uint32 Version = 3;
+    static constexpr int BaseSamplesPerBin = 128;
+    static constexpr int LevelFactor = 4;
+    static constexpr int MaxLevels = 8;
+    static constexpr int NumBands = 3;   // low, mid, high
+
+    struct Level {
+        int samplesPerBin{BaseSamplesPerBin};
+        std::vector<std::int8_t> minMax;   // interleaved min, max per bin (x127)
+        std::vector<std::uint8_t> bands;   // interleaved low, mid, high energy per bin (x255)
+        int numBins() const { return (int) (minMax.size() / 2); }
+    };
+
+    // What the analysis pass produces and the cache stores
+    struct Summary {
+        juce::int64 totalSamples{0};
+        double sampleRate{0.0};
+        double audioStartOffsetSec{0.0};
+        double audioEndOffsetSec{0.0};     // past the last audible chunk; totalSamples if it never went quiet
+        std::vector<Level> levels;   // levels[0] is the finest
+    };
+
+    explicit WaveformCache(const juce::File& directory);
+
+    bool isEnabled() const { return directory.isDirectory(); }
+    juce::File getCacheFileFor(const juce::File& audioFile) const;
+
+    // Writes through a temporary file, so readers never see half a summary
+    bool store(const juce::File& audioFile, const Summary& summary) const;
+
+    // Bins over the audible part of the track (audio start .. end), like a fresh analysis.
+    // False on any mismatch (missing, stale, other version); the caller analyses then.
+    bool load(const juce::File& audioFile, int binCount, std::vector<std::int8_t>& minBins,
+              std::vector<std::int8_t>& maxBins, double& audioStartOffsetSec, juce::int64& totalSamples,
+              double& sampleRate, std::vector<std::uint8_t>* bands = nullptr,
+              double* audioEndOffsetSec = nullptr) const;
+    // The summary of a track that moved (or was re-tagged) from `from` to `to` keeping its audio,
+    // if it was current for from's size and modification time; the old file is removed
+    bool relink(const juce::File& from, juce::int64 fromSize, juce::int64 fromModifiedMs, const juce::File& to) const;
+
+    // A run of one level's bins as stored, bins counted from sample 0, for a client that draws its
+    // own waveform and fetches it piece by piece (WebRemote). The header fields describe the whole
+    // summary, so a request for zero bins just reads them.
+    struct Tile {
+        juce::int64 totalSamples{0};
+        double sampleRate{0.0};
+        double audioStartOffsetSec{0.0};
+        double audioEndOffsetSec{0.0};
+        int numLevels{0};
+        std::array<int, MaxLevels> levelBins{};
+        std::array<int, MaxLevels> levelSamplesPerBin{};
+        int level{0};
+        int firstBin{0};                   // fewer bins than asked for at the end of the level
+        std::vector<std::int8_t> minMax;   // as in Level
+        std::vector<std::uint8_t> bands;
+        int numBins() const { return (int) (minMax.size() / 2); }
+    };
+    // False like load() on any mismatch, or if the summary has no such level
+    bool loadTile(const juce::File& audioFile, int level, int firstBin, int numBins, Tile& tile) const;
+
+    // Read-only view of one level, in memory or mapped from disk
+    struct LevelView {
+        const std::int8_t* minMax{nullptr};
+        const std::uint8_t* bands{nullptr};
+        int numBins{0};
+        int samplesPerBin{BaseSamplesPerBin};
+    };
+
+    // Fill coarser levels from levels[0]
+    static void buildLevels(Summary& summary);
+    // Bins over [startSample, totalSamples); shared by load() and a fresh analysis. Output stays
+    // quantised like a Level: amplitudes x127, and in bands (optional) NumBands energies x255 per bin.
+    static void resample(const LevelView* levels, int numLevels, juce::int64 startSample, juce::int64 totalSamples,
+                         int binCount, std::vector<std::int8_t>& minBins, std::vector<std::int8_t>& maxBins,
+                         std::vector<std::uint8_t>* bands = nullptr);
+
+    // The values a quantised amplitude or band energy stands for
+    static float amplitude(std::int8_t q) { return (float) q * (1.0f / 127.0f); }
+    static float energy(std::uint8_t q) { return (float) q * (1.0f / 255.0f); }
+
+private:
+    bool loadLocal(const juce::File& audioFile, int binCount, std::vector<std::int8_t>& minBins,
+                   std::vector<std::int8_t>& maxBins, double& audioStartOffsetSec, juce::int64& totalSamples,
+                   double& sampleRate, std::vector<std::uint8_t>* bands, double* audioEndOffsetSec) const;
+    bool loadTileLocal(const juce::File& audioFile, int level, int firstBin, int numBins, Tile& tile) const;
+    // The shared summary of audioFile's content, copied here; false if there is none
+    bool fetchShared(const juce::File& audioFile) const;
+    // A cache file of the source `from` as one of `to`; empty unless it is a current summary of `from`
+    static juce::MemoryBlock relabel(const juce::MemoryBlock& file, const juce::String& from, const juce::String& to,
+                                     juce::int64 sourceSize, juce::int64 sourceModifiedMs);
+
+    juce::File directory;
+};
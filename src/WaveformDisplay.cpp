@@ -1,15 +1,36 @@
 #include "WaveformDisplay.h"
 #include "WaveformGenerator.h"
+#include "FrameClock.h"
+#include "EventTrace.h"
+#include "FrameTimeHud.h"
+#include "GlResources.h"
+#include "WaveformRaster.h"
+#include "WaveformRenderer.h"
+#include "WaveformShaders.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QTimer>
 #include <QKeyEvent>
 #include <QMouseEvent>
 #include <QSurfaceFormat>
+#include <QVector2D>
 #include <iostream>
 #include <cmath>
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
+
+namespace {
+    // Spectrogram colour map, quiet to loud
+    struct ColourStop { float at; int r, g, b; };
+    constexpr ColourStop SpectrogramStops[] = {
+        { 0.00f,   0,   0,   0 },
+        { 0.25f,  40,  10,  90 },
+        { 0.50f, 180,  30,  90 },
+        { 0.75f, 250, 140,  30 },
+        { 1.00f, 255, 250, 200 },
+    };
+}
 
 // REMOVED: Static global zoom level to prevent deck interference
 // Each deck now has its own beatGridZoomLevel instance variable
@@ -23,10 +44,6 @@ WaveformDisplay::WaveformDisplay(QWidget* parent)
     fmt.setSwapInterval(1); // vsync on supported platforms
     setFormat(fmt);
 
-    formatManager.registerBasicFormats(); // JUCE's basic formats include MP3 with JUCE_USE_MP3AUDIOFORMAT=1
-    waveformImage = QImage(800, 200, QImage::Format_ARGB32_Premultiplied);
-    waveformImage.fill(Qt::black);
-    
     // Initialize cue points as invalid
     cuePoints.fill(-1.0);
     cuePointsValid = false;
@@ -34,33 +51,636 @@ WaveformDisplay::WaveformDisplay(QWidget* parent)
     // Enable keyboard focus
     setFocusPolicy(Qt::StrongFocus);
     
-    // Setup smooth update throttling for fluid motion
-    updateThrottleTimer = new QTimer(this);
-    updateThrottleTimer->setSingleShot(true);
-    updateThrottleTimer->setInterval(16); // 60 FPS for ultra smooth motion
-    connect(updateThrottleTimer, &QTimer::timeout, this, [this]() {
-        if (pendingUpdate) {
+    // Repaint on the shared frame clock, and only when something changed
+    connect(&FrameClock::instance(), &FrameClock::frame, this, [this]() {
+        if (!isVisible()) return;
+        // The render thread draws every refresh by itself and only takes what was set here
+        if (renderer) {
             pendingUpdate = false;
-            update();
+            publishScene();
+            return;
         }
+        if (!pendingUpdate) return;
+        pendingUpdate = false;
+        update();
     });
+}
 
-    // Dedicated render timer to keep frame pacing steady at ~60 FPS
-    renderTimer = new QTimer(this);
-    renderTimer->setTimerType(Qt::PreciseTimer);
-    renderTimer->setInterval(16);
-    connect(renderTimer, &QTimer::timeout, this, [this]() {
-        // Only repaint when visible to save CPU/GPU
-        if (isVisible()) update();
-    });
-    renderTimer->start();
+WaveformDisplay::~WaveformDisplay()
+{
+    setThreadedRendering(nullptr);
+    makeCurrent();
+    waveProgram.reset();
+    beatProgram.reset();
+    if (quadVbo.isCreated()) quadVbo.destroy();
+    if (waveVao.isCreated()) waveVao.destroy();
+    if (beatInstanceVbo.isCreated()) beatInstanceVbo.destroy();
+    if (beatVao.isCreated()) beatVao.destroy();
+    for (auto& deck : compareDecks) {
+        if (deck.beatInstances.isCreated()) deck.beatInstances.destroy();
+        if (deck.beatVao.isCreated()) deck.beatVao.destroy();
+    }
+    waveTextures.reset();
+    spectrogramProgram.reset();
+    if (spectrogramRing) glDeleteTextures(1, &spectrogramRing);
+    if (spectrogramColourMap) glDeleteTextures(1, &spectrogramColourMap);
+    frameHud.releaseGL();
+    doneCurrent();
+}
+
+void WaveformDisplay::initializeGL()
+{
+    initializeOpenGLFunctions();
+    frameHud.initializeGL();
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Compiled by the first view only; every deck draws with the same programs
+    waveProgram = GlResources::instance().program("WaveformDisplay.wave", WaveformShaders::WaveVertex, WaveformShaders::WaveFragment);
+    beatProgram = GlResources::instance().program("WaveformDisplay.beat", WaveformShaders::BeatVertex, WaveformShaders::BeatFragment);
+    if (!waveProgram || !beatProgram) {
+        std::cout << "WaveformDisplay: GL 3.3 shaders unavailable, painting with QPainter" << std::endl;
+        return;
+    }
+
+    const float corners[8] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+    waveVao.create();
+    waveVao.bind();
+    quadVbo.create();
+    quadVbo.bind();
+    quadVbo.allocate(corners, sizeof(corners));
+    waveProgram->bind();
+    waveProgram->enableAttributeArray(0);
+    waveProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2, sizeof(float) * 2);
+    waveProgram->release();
+    waveVao.release();
+
+    quadVbo.release();
+    createBeatVao(beatVao, beatInstanceVbo);
+
+    // Without it the spectrogram style draws the waveform
+    spectrogramProgram = GlResources::instance().program("WaveformDisplay.spectrogram", WaveformShaders::WaveVertex, WaveformShaders::SpectrogramFragment);
+    if (spectrogramProgram) {
+        glGenTextures(1, &spectrogramRing);
+        glBindTexture(GL_TEXTURE_2D, spectrogramRing);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, Spectrogram::NumBands, SpectrogramRingColumns, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        std::vector<std::uint8_t> colours(256 * 4);
+        for (int i = 0; i < 256; ++i) {
+            const float t = i / 255.0f;
+            size_t s = 1;
+            while (s + 1 < std::size(SpectrogramStops) && SpectrogramStops[s].at < t) ++s;
+            const ColourStop& a = SpectrogramStops[s - 1];
+            const ColourStop& b = SpectrogramStops[s];
+            const float f = std::clamp((t - a.at) / (b.at - a.at), 0.0f, 1.0f);
+            colours[(size_t) i * 4] = (std::uint8_t) std::lround(a.r + (b.r - a.r) * f);
+            colours[(size_t) i * 4 + 1] = (std::uint8_t) std::lround(a.g + (b.g - a.g) * f);
+            colours[(size_t) i * 4 + 2] = (std::uint8_t) std::lround(a.b + (b.b - a.b) * f);
+            colours[(size_t) i * 4 + 3] = 255;
+        }
+        glGenTextures(1, &spectrogramColourMap);
+        glBindTexture(GL_TEXTURE_2D, spectrogramColourMap);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colours.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        spectrogramMemory.resize((int64_t) Spectrogram::NumBands * SpectrogramRingColumns + (int64_t) colours.size());
+        ringFirst = ringEnd = 0;
+    }
+
+    glReady = true;
+    texturesDirty = true;
+    gridInstancesDirty = true;
+}
+
+int WaveformDisplay::packWaveTextures(const WaveformGenerator::Result& wave, std::vector<int>& levelTexelOffsets,
+                                      std::vector<std::int8_t>& minMax, std::vector<std::uint8_t>& bands)
+{
+    levelTexelOffsets.clear();
+    minMax.clear();
+    bands.clear();
+    size_t total = wave.maxBins.size();
+    levelTexelOffsets.push_back(0);
+    for (const auto& level : wave.pyramid) {
+        levelTexelOffsets.push_back((int)total);
+        total += level.maxBins.size();
+    }
+    if (total == 0) return 0;
+
+    // The bins go up as quantised: two signed bytes of min/max and three bytes of band energy
+    // per bin, which the texture unit and the shader turn back into levels and colours
+    const int rows = (int)((total + WaveTextureWidth - 1) / WaveTextureWidth);
+    constexpr size_t nb = (size_t) WaveformCache::NumBands;
+    minMax.assign((size_t)rows * WaveTextureWidth * 2, 0);
+    bool textureHasBands = hasBands(wave, 0);
+    for (size_t l = 1; l <= wave.pyramid.size(); ++l) textureHasBands = textureHasBands && hasBands(wave, l);
+    if (textureHasBands) bands.assign((size_t)rows * WaveTextureWidth * nb, 0);
+
+    auto fill = [&](size_t offset, const std::vector<std::int8_t>& mins, const std::vector<std::int8_t>& maxs,
+                    const std::vector<std::uint8_t>& levelBands) {
+        const size_t n = std::min(mins.size(), maxs.size());
+        for (size_t i = 0; i < n; ++i) {
+            minMax[(offset + i) * 2] = mins[i];
+            minMax[(offset + i) * 2 + 1] = maxs[i];
+        }
+        if (textureHasBands) std::copy_n(levelBands.begin(), n * nb, bands.begin() + (std::ptrdiff_t)(offset * nb));
+    };
+    fill(0, wave.minBins, wave.maxBins, wave.bands);
+    for (size_t l = 0; l < wave.pyramid.size(); ++l)
+        fill((size_t)levelTexelOffsets[l + 1], wave.pyramid[l].minBins, wave.pyramid[l].maxBins, wave.pyramid[l].bands);
+    return rows;
+}
+
+void WaveformDisplay::uploadWaveformTextures()
+{
+    waveTextures->uploaded = false;
+    std::vector<std::int8_t> minMax;
+    std::vector<std::uint8_t> bands;
+    const int rows = packWaveTextures(*source, waveTextures->levelTexelOffsets, minMax, bands);
+    if (rows == 0) return;
+    const bool textureHasBands = !bands.empty();
+    waveTextures->hasBands = textureHasBands;
+
+    glBindTexture(GL_TEXTURE_2D, waveTextures->minMax);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8_SNORM, WaveTextureWidth, rows, 0, GL_RG, GL_BYTE, minMax.data());
+    if (textureHasBands) {
+        glBindTexture(GL_TEXTURE_2D, waveTextures->bands);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, WaveTextureWidth, rows, 0, GL_RGB, GL_UNSIGNED_BYTE, bands.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    waveTextures->memory.resize((int64_t) (minMax.size() + bands.size()));
+    waveTextures->uploaded = true;
+}
+
+void WaveformDisplay::createBeatVao(QOpenGLVertexArrayObject& vao, QOpenGLBuffer& instances)
+{
+    vao.create();
+    vao.bind();
+    quadVbo.bind();
+    beatProgram->bind();
+    beatProgram->enableAttributeArray(0);
+    beatProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2, sizeof(float) * 2);
+    instances.create();
+    instances.bind();
+    instances.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    beatProgram->enableAttributeArray(1);
+    beatProgram->setAttributeBuffer(1, GL_FLOAT, 0, 2, sizeof(float) * 2);
+    glVertexAttribDivisor(1, 1);
+    beatProgram->release();
+    vao.release();
+    instances.release();
+    quadVbo.release();
+}
+
+void WaveformDisplay::updateWaveTextures()
+{
+    if (!texturesDirty) return;
+    texturesDirty = false;
+    // A finished summary is uploaded by whichever view shows it first; one still
+    // streaming in belongs to this view alone and is uploaded again as bins arrive
+    waveTextures = GlResources::instance().waveTextures(source);
+    if (waveTextures && (!waveTextures->uploaded || source == loadingSource)) uploadWaveformTextures();
+}
+
+bool WaveformDisplay::drawWaveformGL(double binOrigin, double binsPerPixel, size_t levelIndex, float outlineWidth)
+{
+    if (!glReady) return false;
+    updateWaveTextures();
+    if (!waveTextures) return false;
+    return drawWaveTextures(*source, *waveTextures, rect(), binOrigin, binsPerPixel, levelIndex, outlineWidth);
+}
+
+bool WaveformDisplay::drawWaveTextures(const WaveformGenerator::Result& wave, const GlResources::WaveTextures& textures,
+                                       const QRect& area, double binOrigin, double binsPerPixel, size_t levelIndex,
+                                       float outlineWidth)
+{
+    const std::vector<int>& levelTexelOffsets = textures.levelTexelOffsets;
+    if (!textures.uploaded || levelTexelOffsets.empty() || levelIndex >= levelTexelOffsets.size()) return false;
+
+    const int levelBins = levelIndex == 0 ? (int)wave.maxBins.size() : (int)wave.pyramid[levelIndex - 1].maxBins.size();
+    const double pixelRatio = devicePixelRatioF();
+    setGlViewport(area);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    waveProgram->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures.minMax);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textures.bands);
+    waveProgram->setUniformValue("uMinMax", 0);
+    waveProgram->setUniformValue("uBands", 1);
+    waveProgram->setUniformValue("uHasBands", textures.hasBands);
+    waveProgram->setUniformValue("uTexWidth", WaveTextureWidth);
+    waveProgram->setUniformValue("uResolution", QVector2D((float)area.width(), (float)area.height()));
+    waveProgram->setUniformValue("uViewOrigin", QVector2D((float)area.x(), (float)(height() - area.y() - area.height())));
+    waveProgram->setUniformValue("uPixelRatio", (float)pixelRatio);
+    waveProgram->setUniformValue("uBinOrigin", (float)binOrigin);
+    waveProgram->setUniformValue("uBinsPerPixel", (float)binsPerPixel);
+    waveProgram->setUniformValue("uDetailRatio", (float)detailPixelRatio());
+    waveProgram->setUniformValue("uBaseBins", (int)wave.maxBins.size());
+    waveProgram->setUniformValue("uLevelOffset", levelTexelOffsets[levelIndex]);
+    waveProgram->setUniformValue("uLevelBins", levelBins);
+    waveProgram->setUniformValue("uLevelScale", (float)std::ldexp(1.0, (int)levelIndex));
+    waveProgram->setUniformValue("uOutlineWidth", outlineWidth);
+
+    waveVao.bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    waveVao.release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    waveProgram->release();
+    return true;
+}
+
+bool WaveformDisplay::drawSpectrogramGL(double leftTrackSec, double trackSecPerPixel)
+{
+    if (!glReady || !spectrogramProgram || !spectrogram || spectrogram->numColumns() == 0) return false;
+
+    // The finest level with at most a column per detail pixel whose view fills at most half the ring
+    const double finestPerPixel = trackSecPerPixel * Spectrogram::ColumnsPerSecond;
+    const double finestPerDetail = finestPerPixel / detailPixelRatio();
+    size_t level = 0;
+    while (level + 1 < spectrogram->levels.size()) {
+        const double levelScale = std::ldexp(1.0, (int) level);
+        if (finestPerDetail <= levelScale && width() * finestPerPixel / levelScale <= SpectrogramRingColumns / 2) break;
+        ++level;
+    }
+    const double levelScale = std::ldexp(1.0, (int) level);
+    const double columnsPerPixel = finestPerPixel / levelScale;
+    const double columnOrigin = leftTrackSec * Spectrogram::ColumnsPerSecond / levelScale;
+    const qint64 numColumns = spectrogram->numColumns(level);
+    const qint64 first = std::clamp<qint64>((qint64) std::floor(columnOrigin) - 1, 0, numColumns);
+    const qint64 end = std::clamp<qint64>((qint64) std::ceil(columnOrigin + width() * columnsPerPixel) + 1, first, numColumns);
+
+    // The rest of the ring holds the columns on either side, so scrolling either way and back
+    // uploads only the columns new to it: one or two a frame at playing speed
+    const qint64 wantFirst = std::max<qint64>(0, first - (SpectrogramRingColumns - (end - first)) / 2);
+    const qint64 wantEnd = std::min<qint64>(numColumns, wantFirst + SpectrogramRingColumns);
+    glBindTexture(GL_TEXTURE_2D, spectrogramRing);
+    if (level != ringLevel || wantFirst >= ringEnd || wantEnd <= ringFirst) {
+        uploadSpectrogramColumns(level, wantFirst, wantEnd);
+    } else {
+        if (wantFirst < ringFirst) uploadSpectrogramColumns(level, wantFirst, ringFirst);
+        if (wantEnd > ringEnd) uploadSpectrogramColumns(level, ringEnd, wantEnd);
+    }
+    ringLevel = level;
+    ringFirst = wantFirst;
+    ringEnd = wantEnd;
+
+    const double pixelRatio = devicePixelRatioF();
+    glViewport(0, 0, (GLsizei)(width() * pixelRatio), (GLsizei)(height() * pixelRatio));
+    glDisable(GL_BLEND);
+    spectrogramProgram->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, spectrogramRing);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, spectrogramColourMap);
+    spectrogramProgram->setUniformValue("uRing", 0);
+    spectrogramProgram->setUniformValue("uColourMap", 1);
+    spectrogramProgram->setUniformValue("uRingColumns", SpectrogramRingColumns);
+    spectrogramProgram->setUniformValue("uNumBands", Spectrogram::NumBands);
+    spectrogramProgram->setUniformValue("uResolution", QVector2D((float)width(), (float)height()));
+    spectrogramProgram->setUniformValue("uPixelRatio", (float)pixelRatio);
+    spectrogramProgram->setUniformValue("uColumnOrigin", (float)columnOrigin);
+    spectrogramProgram->setUniformValue("uColumnsPerPixel", (float)columnsPerPixel);
+    spectrogramProgram->setUniformValue("uFirstColumn", (float)wantFirst);
+    spectrogramProgram->setUniformValue("uEndColumn", (float)wantEnd);
+
+    waveVao.bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    waveVao.release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    spectrogramProgram->release();
+    glEnable(GL_BLEND);
+    return true;
+}
+
+void WaveformDisplay::uploadSpectrogramColumns(size_t level, qint64 first, qint64 end)
+{
+    // Column c lives in row c % SpectrogramRingColumns; a range crossing the end is two uploads
+    const auto& columns = spectrogram->levels[level];
+    while (first < end) {
+        const int row = (int) (first % SpectrogramRingColumns);
+        const int count = (int) std::min<qint64>(end - first, SpectrogramRingColumns - row);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, Spectrogram::NumBands, count, GL_RED, GL_UNSIGNED_BYTE,
+                        columns.data() + (size_t) first * Spectrogram::NumBands);
+        first += count;
+    }
+}
+
+void WaveformDisplay::setSpectrogram(Spectrogram::SharedData data)
+{
+    spectrogram = std::move(data);
+    // Everything is uploaded again on the next frame
+    ringFirst = ringEnd = 0;
+    update();
+}
+
+void WaveformDisplay::updateGridBeats()
+{
+    // Same rules as the painter path: analysed beats, else a grid from this deck's BPM
+    const std::array<double, 6> key = {
+        (double)beatPositions.size(),
+        beatPositions.isEmpty() ? 0.0 : beatPositions.first(),
+        beatPositions.isEmpty() ? 0.0 : beatPositions.last(),
+        trackLengthSec, originalBpm, beatPhaseShiftSec };
+    if (key == gridKey && !gridLines->times.empty()) return;
+    gridKey = key;
+    gridInstancesDirty = true;
+
+    // A new grid rather than an edit: scenes already handed out keep drawing the old one
+    auto lines = std::make_shared<GridLines>();
+    baseGridBeatTimes(lines->times);
+    for (double& t : lines->times) t += beatPhaseShiftSec;
+    lines->isBar.assign(lines->times.size(), false);
+    for (size_t i = 0; i < lines->times.size(); ++i) lines->isBar[i] = i % 4 == 0;
+    gridLines = std::move(lines);
+}
+
+void WaveformDisplay::baseGridBeatTimes(std::vector<double>& out) const
+{
+    out.clear();
+    if (!beatPositions.isEmpty()) {
+        out.reserve((size_t)beatPositions.size());
+        for (double rel : beatPositions) out.push_back(rel * trackLengthSec);
+    } else if (originalBpm > 0.0) {
+        const double beatInterval = 60.0 / originalBpm;
+        for (double t = 0.0; t < trackLengthSec + beatInterval; t += beatInterval)
+            out.push_back(t);
+    }
+}
+
+void WaveformDisplay::uploadBeatInstances(QOpenGLBuffer& instances, const std::vector<double>& beatTimes,
+                                          const std::vector<bool>& isBar)
+{
+    // Beats at the very start are left to the preroll "0" line
+    std::vector<float> values;
+    values.reserve(beatTimes.size() * 2);
+    for (size_t i = 0; i < beatTimes.size(); ++i) {
+        if (beatTimes[i] <= 0.1) continue;
+        values.push_back((float)beatTimes[i]);
+        values.push_back(isBar[i] ? 1.0f : 0.0f);
+    }
+    instances.bind();
+    instances.allocate(values.data(), (int)(values.size() * sizeof(float)));
+    instances.release();
+}
+
+void WaveformDisplay::drawBeatLinesGL(double visualOffset, double visualScale, double leftSecond, double timeRange)
+{
+    if (gridInstancesDirty) {
+        uploadBeatInstances(beatInstanceVbo, gridLines->times, gridLines->isBar);
+        gridInstancesDirty = false;
+    }
+    drawBeatInstances(beatVao, beatInstanceVbo, rect(), visualOffset, visualScale, leftSecond, timeRange);
+}
+
+void WaveformDisplay::drawBeatInstances(QOpenGLVertexArrayObject& vao, QOpenGLBuffer& instances, const QRect& area,
+                                        double visualOffset, double visualScale, double leftSecond, double timeRange)
+{
+    const int count = instances.isCreated() ? instances.size() / (int)(sizeof(float) * 2) : 0;
+    if (count <= 0) return;
+
+    setGlViewport(area);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    beatProgram->bind();
+    beatProgram->setUniformValue("uResolution", QVector2D((float)area.width(), (float)area.height()));
+    beatProgram->setUniformValue("uVisualOffset", (float)visualOffset);
+    beatProgram->setUniformValue("uVisualScale", (float)visualScale);
+    beatProgram->setUniformValue("uLeftSecond", (float)leftSecond);
+    beatProgram->setUniformValue("uTimeRange", (float)timeRange);
+    vao.bind();
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    vao.release();
+    beatProgram->release();
+}
+
+void WaveformDisplay::setGlViewport(const QRect& area)
+{
+    // GL counts rows from the bottom, in physical pixels
+    const double pixelRatio = devicePixelRatioF();
+    glViewport((GLint)std::lround(area.x() * pixelRatio), (GLint)std::lround((height() - area.y() - area.height()) * pixelRatio),
+               (GLsizei)std::lround(area.width() * pixelRatio), (GLsizei)std::lround(area.height() * pixelRatio));
+}
+
+QRgb WaveformDisplay::bandColour(const std::uint8_t* energies)
+{
+    const float low = WaveformCache::energy(energies[0]);
+    const float mid = WaveformCache::energy(energies[1]);
+    const float high = WaveformCache::energy(energies[2]);
+    // Hue from the band balance, brightness from the strongest band
+    const float peak = std::max({ low, mid, high, 1e-4f });
+    const float brightness = 0.45f + 0.55f * std::min(1.0f, peak * 1.6f);
+    return qRgba((int)(255.0f * brightness * (0.25f + 0.75f * low / peak)),
+                 (int)(255.0f * brightness * (0.25f + 0.75f * mid / peak)),
+                 (int)(255.0f * brightness * (0.25f + 0.75f * high / peak)),
+                 170);
+}
+
+bool WaveformDisplay::hasBands(const WaveformGenerator::Result& wave, size_t levelIndex)
+{
+    if (levelIndex > wave.pyramid.size()) return false;
+    const auto& maxBins = levelIndex == 0 ? wave.maxBins : wave.pyramid[levelIndex - 1].maxBins;
+    const auto& bands = levelIndex == 0 ? wave.bands : wave.pyramid[levelIndex - 1].bands;
+    return !maxBins.empty() && bands.size() == maxBins.size() * (size_t) WaveformCache::NumBands;
+}
+
+void WaveformDisplay::setWaveformQuality(int percent)
+{
+    waveformQuality = std::clamp(percent, 25, 100);
+    update();
+}
+
+qreal WaveformDisplay::detailPixelRatio() const
+{
+    return detailPixelRatio(devicePixelRatioF(), waveformQuality);
+}
+
+qreal WaveformDisplay::detailPixelRatio(qreal devicePixelRatio, int quality)
+{
+    // 25 % resolves logical pixels, 75 % and up every physical one; 1x screens always get 1
+    const qreal dpr = std::max<qreal>(1.0, devicePixelRatio);
+    const qreal share = std::clamp((quality - 25) / 50.0, 0.0, 1.0);
+    return 1.0 + (dpr - 1.0) * share;
+}
+
+void WaveformDisplay::invalidateScrollTiles()
+{
+    scrollTiles.clear();
+    tileMemory.resize(0);
+}
+
+void WaveformDisplay::drawScrollTiles(QPainter& p, double binOrigin, double binsPerPixel, double zoomBinsPerPixel,
+                                      size_t levelIndex, float outlineWidth)
+{
+    if (binsPerPixel <= 0.0) return;
+    // Tiles are only valid for one zoom; a tempo change stretches them until it is too far off
+    const qreal pixelRatio = detailPixelRatio();
+    const double stretchOff = tileBinsPerPixel > 0.0 ? std::abs(std::log(binsPerPixel / tileBinsPerPixel)) : 0.0;
+    // The zoom key compared loosely: dividing the tempo back out leaves rounding behind
+    const bool sameZoom = std::abs(zoomBinsPerPixel - tileZoomBinsPerPixel) <= 1e-9 * tileZoomBinsPerPixel;
+    if (!sameZoom || tileBinsPerPixel <= 0.0 || stretchOff > std::log(MaxTileStretch)
+        || outlineWidth != tileOutlineWidth || height() != tileHeight || pixelRatio != tilePixelRatio) {
+        invalidateScrollTiles();
+        tileBinsPerPixel = binsPerPixel;
+        tileZoomBinsPerPixel = zoomBinsPerPixel;
+        tileLevelIndex = levelIndex;
+        tileOutlineWidth = outlineWidth;
+        tileHeight = height();
+        tilePixelRatio = pixelRatio;
+    }
+
+    // Tile column c lies at screen x = (c - originColumn) / stretch; tile t holds columns [t*W, (t+1)*W)
+    const double stretch = binsPerPixel / tileBinsPerPixel;
+    const double originColumn = binOrigin / tileBinsPerPixel;
+    const qint64 firstTile = (qint64)std::floor(originColumn / ScrollTileWidth);
+    const qint64 lastTile = (qint64)std::floor((originColumn + width() * stretch) / ScrollTileWidth);
+    const size_t capacity = std::max<size_t>(MaxScrollTiles, (size_t)(lastTile - firstTile + 2));
+    const quint64 frame = ++scrollTileClock;
+
+    for (qint64 index = firstTile; index <= lastTile; ++index) {
+        auto tile = std::find_if(scrollTiles.begin(), scrollTiles.end(), [index](const ScrollTile& t) { return t.index == index; });
+        if (tile == scrollTiles.end()) {
+            if (scrollTiles.size() >= capacity) {
+                // Least recently composited first; tiles of this frame are never the oldest
+                auto oldest = std::min_element(scrollTiles.begin(), scrollTiles.end(),
+                    [](const ScrollTile& a, const ScrollTile& b) { return a.lastUsed < b.lastUsed; });
+                scrollTiles.erase(oldest);
+            }
+            scrollTiles.push_back({ index, frame, renderScrollTile(index, tileBinsPerPixel, tileLevelIndex, outlineWidth) });
+            tile = scrollTiles.end() - 1;
+        }
+        tile->lastUsed = frame;
+        const double x = ((double)(index * ScrollTileWidth) - originColumn) / stretch;
+        if (stretch == 1.0)
+            p.drawPixmap(QPointF(x, 0.0), tile->pixmap);
+        else
+            p.drawPixmap(QRectF(x, 0.0, ScrollTileWidth / stretch, height()), tile->pixmap, QRectF(tile->pixmap.rect()));
+    }
+
+    int64_t bytes = 0;
+    for (const auto& t : scrollTiles)
+        bytes += (int64_t)t.pixmap.width() * t.pixmap.height() * 4;
+    tileMemory.resize(bytes);
+}
+
+QPixmap WaveformDisplay::renderScrollTile(qint64 index, double binsPerPixel, size_t levelIndex, float outlineWidth) const
+{
+    // Rendered at detail resolution: one raster column every 1 / pixelRatio logical pixels
+    const qreal pixelRatio = detailPixelRatio();
+    const int detailWidth = (int)std::lround(ScrollTileWidth * pixelRatio);
+    const int detailHeight = (int)std::lround(height() * pixelRatio);
+    const double binsPerDetail = binsPerPixel / pixelRatio;
+    QImage tile(detailWidth, detailHeight, QImage::Format_ARGB32_Premultiplied);
+    tile.fill(Qt::transparent);
+
+    const std::vector<std::int8_t>* levelMin = &source->minBins;
+    const std::vector<std::int8_t>* levelMax = &source->maxBins;
+    const std::vector<std::uint8_t>* levelBands = &source->bands;
+    if (levelIndex > 0 && levelIndex <= source->pyramid.size()) {
+        levelMin = &source->pyramid[levelIndex - 1].minBins;
+        levelMax = &source->pyramid[levelIndex - 1].maxBins;
+        levelBands = &source->pyramid[levelIndex - 1].bands;
+    }
+    const double levelScale = std::ldexp(1.0, (int)levelIndex);
+    const int levelBins = (int)std::min(levelMin->size(), levelMax->size());
+    const double levelBinsPerPixel = binsPerDetail / levelScale;
+    const float centerY = detailHeight / 2;
+    const float halfHeight = detailHeight * 0.45f;
+
+    // Frequency colouring: every column its own band colour
+    const bool levelColours = hasBands(*source, levelIndex);
+    WaveformRaster::Columns columns;
+    columns.resize(detailWidth);
+    if (levelColours) columns.colour.resize((size_t)detailWidth);
+
+    for (int d = 0; d < detailWidth; ++d) {
+        const double x = d / pixelRatio;
+        const double audioBinFloat = ((double)(index * ScrollTileWidth) + x) * binsPerPixel;
+        // Before the track start (preroll) and after its end: flat centre line
+        if (audioBinFloat < 0 || audioBinFloat >= sourceWidth) {
+            columns.top[d] = (std::int32_t)centerY;
+            columns.bottom[d] = (std::int32_t)centerY + 1;
+            if (levelColours) columns.colour[d] = qPremultiply(qRgba(120, 200, 255, 255));
+            continue;
+        }
+        if (levelColours) {
+            const int colourBin = std::min(levelBins - 1, (int)(audioBinFloat / levelScale));
+            columns.colour[d] = qPremultiply(bandColour(&(*levelBands)[(size_t)colourBin * WaveformCache::NumBands]));
+        }
+
+        float minVal = 0.0f, maxVal = 0.0f;
+        if (binsPerDetail > 1.0) {
+            // Zoomed out: peaks of the level bins this pixel covers (a pixel either side at most)
+            const double levelBin = audioBinFloat / levelScale;
+            const int startBin = std::max(0, (int)std::floor(levelBin - levelBinsPerPixel));
+            const int endBin = std::min(levelBins, (int)std::ceil(levelBin + levelBinsPerPixel) + 1);
+            std::int8_t lo = 0, hi = 0;
+            for (int b = startBin; b < endBin; ++b) {
+                lo = std::min(lo, (*levelMin)[b]);
+                hi = std::max(hi, (*levelMax)[b]);
+            }
+            minVal = WaveformCache::amplitude(lo);
+            maxVal = WaveformCache::amplitude(hi);
+        } else {
+            // Zoomed in: linear interpolation between source bins
+            const int bin = (int)audioBinFloat;
+            const float frac = (float)(audioBinFloat - bin);
+            if (bin + 1 < sourceWidth && bin + 1 < (int)source->minBins.size() && bin + 1 < (int)source->maxBins.size()) {
+                minVal = WaveformCache::amplitude(source->minBins[bin]) * (1.0f - frac)
+                       + WaveformCache::amplitude(source->minBins[bin + 1]) * frac;
+                maxVal = WaveformCache::amplitude(source->maxBins[bin]) * (1.0f - frac)
+                       + WaveformCache::amplitude(source->maxBins[bin + 1]) * frac;
+            } else if (bin < (int)source->minBins.size() && bin < (int)source->maxBins.size()) {
+                minVal = WaveformCache::amplitude(source->minBins[bin]);
+                maxVal = WaveformCache::amplitude(source->maxBins[bin]);
+            }
+        }
+        // At least the centre row, so silence still draws a line
+        columns.top[d] = (std::int32_t)std::floor(centerY - maxVal * halfHeight);
+        columns.bottom[d] = std::max(columns.top[d] + 1, (std::int32_t)std::ceil(centerY - minVal * halfHeight));
+    }
+
+    // Without bands a vertical gradient, strong at the peaks and faint at the centre
+    std::vector<quint32> rowColours;
+    if (!levelColours)
+        rowColours = WaveformRaster::verticalGradient(detailHeight, { { 0.0f, qRgba(100, 180, 255, 140) },
+                                                                      { 0.5f, qRgba(60, 140, 220, 80) },
+                                                                      { 1.0f, qRgba(100, 180, 255, 140) } });
+    // Crisp outline rows closing each column
+    const int outlineRows = std::max(1, (int)std::lround(outlineWidth * pixelRatio * 0.5));
+    WaveformRaster::fill(tile, columns, rowColours, qPremultiply(qRgba(120, 200, 255, 255)), outlineRows);
+
+    QPixmap pixmap = QPixmap::fromImage(std::move(tile));
+    pixmap.setDevicePixelRatio(pixelRatio);
+    return pixmap;
 }
 
 void WaveformDisplay::paintGL()
 {
+    EVENT_TRACE_SCOPE("WaveformDisplay::paintGL", "ui");
+    FrameTimeHud::Frame hudFrame(frameHud);
     glViewport(0, 0, width(), height());
     glClearColor(8/255.0f, 8/255.0f, 10/255.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
+    // Covered by the window the render thread draws (setThreadedRendering); the phase view
+    // still draws from this view's upload
+    if (renderer) {
+        if (glReady) updateWaveTextures();
+        return;
+    }
     QPainter p(this);
     
     // Professional antialiasing for smooth lines
@@ -70,262 +690,330 @@ void WaveformDisplay::paintGL()
     
     // Background already cleared by GL
 
-    if (sourceMaxBins.empty() || audioLength <= 0.0) {
+    if (isPhaseCompare()) {
+        paintPhaseCompare(p);
+        return;
+    }
+
+    const Scene scene = makeScene();
+    if (scene.source->maxBins.empty() || scene.audioLength <= 0.0) {
         p.setPen(QPen(QColor(120, 120, 120), 1));
         p.setFont(QFont("Arial", 12));
         p.drawText(rect(), Qt::AlignCenter, "NO TRACK LOADED");
         return;
     }
     
-    // Center line position (always fixed in the middle)
-    int centerX = width() / 2;
-    int centerY = height() / 2;
-    
-    // Get current zoom factor
-    double zoomFactor = getBeatGridZoomFactor();
+    // PREROLL SUPPORT: Allow negative playhead positions but handle them correctly
+    const View view = layoutView(scene, size(), playheadSeconds());
+    if (!view.visible) return; // Only return early if we're not in preroll
     
-    // Current tempo factor (used for labels only; mapping uses pure track time)
-    double deckTempoFactor = tempoFactor;
+    // Pick the pyramid level with one to two bins per detail pixel, so a frame costs O(width) at
+    // any zoom: physical pixels on hi-DPI screens unless the quality setting asks for less
+    const size_t levelIndex = levelForBinsPerDetail(view.binsPerPixel / detailPixelRatio());
+
+    // Shader path: the summary lives in textures, a frame only sets a few uniforms. Not where
+    // acceleration is off or GL itself runs on the CPU (GlResources::gpuWaveforms)
+    const bool gpu = glReady && GlResources::instance().gpuWaveforms();
+    bool waveformOnGpu = false;
+    if (gpu) {
+        p.beginNativePainting();
+        if (displayStyle == DisplayStyle::Spectrogram) waveformOnGpu = drawSpectrogramGL(view.leftTrackSec, view.trackSecPerPixel);
+        if (!waveformOnGpu) waveformOnGpu = drawWaveformGL(view.binOrigin, view.binsPerPixel, levelIndex, view.outlineWidth);
+        p.endNativePainting();
+    }
+
+    // Software path: the waveform at this zoom is rasterized once into tiles that scroll with
+    // the track (WaveformRaster), so a frame only composites the few tiles in view
+    if (!waveformOnGpu)
+        drawScrollTiles(p, view.binOrigin, view.binsPerPixel, view.binsPerPixel * view.visualScale, levelIndex, view.outlineWidth);
+    
+    // Beat grid only after analysis is available: lines instanced on the GPU, labels with the overlays
+    const bool linesOnGpu = useAnalyzedBeats && gpu;
+    if (linesOnGpu) {
+        p.beginNativePainting();
+        drawBeatLinesGL(view.visualOffset, view.visualScale, view.leftSecond, view.timeRange);
+        p.endNativePainting();
+    }
+    paintOverlays(p, scene, view, size(), linesOnGpu);
+}
+
+WaveformDisplay::Scene WaveformDisplay::makeScene()
+{
+    updateGridBeats();
+    Scene scene;
+    scene.source = source;
+    // The summary still streaming in changes under this thread: a copy per revision instead
+    if (loadingSource && source == loadingSource && renderer) {
+        if (!loadingSnapshot || loadingSnapshotRevision != loadingRevision) {
+            loadingSnapshot = std::make_shared<WaveformGenerator::Result>(*loadingSource);
+            loadingSnapshotRevision = loadingRevision;
+        }
+        scene.source = loadingSnapshot;
+    }
+    scene.sourceWidth = sourceWidth;
+    scene.audioLength = audioLength;
+    scene.audioStartOffset = audioStartOffset;
+    scene.tempoFactor = tempoFactor;
+    scene.originalBpm = originalBpm;
+    scene.zoomFactor = getBeatGridZoomFactor();
+    scene.viewMode = viewMode;
+    scene.fixedPixelsPerSecond = useFixedPixelsPerSecond;
+    scene.waveformQuality = waveformQuality;
+    scene.prerollEnabled = prerollEnabled;
+    scene.prerollTimeSec = prerollTimeSec;
+    scene.useAnalyzedBeats = useAnalyzedBeats;
+    scene.grid = gridLines;
+    scene.cuePoints = cuePoints;
+    scene.cuePointsValid = cuePointsValid;
+    scene.loopEnabled = loopEnabled;
+    scene.loopStartSec = loopStartSec;
+    scene.loopEndSec = loopEndSec;
+    scene.ghostLoopEnabled = ghostLoopEnabled;
+    scene.ghostLoopStartSec = ghostLoopStartSec;
+    scene.ghostLoopEndSec = ghostLoopEndSec;
+    scene.structure = structure;
+    scene.analysisActive = analysisActive;
+    scene.analysisProgress = analysisProgress;
+    scene.analysisFailed = analysisFailed;
+    scene.scratching = scratching;
+    scene.playheadRelative = playheadPos;
+    return scene;
+}
+
+WaveformDisplay::View WaveformDisplay::layoutView(const Scene& s, const QSize& size, double playheadSec)
+{
+    View v;
+    v.playheadSec = playheadSec;
+    if (s.audioLength <= 0.0 || size.width() <= 0) {
+        v.visible = false;
+        return v;
+    }
+    const int pixelWidth = size.width();
+    const double zoomFactor = s.zoomFactor;
+    const bool beatLocked = s.viewMode == ViewMode::BeatLocked;
     
     // Calculate viewport timing: BeatLocked keeps scroll speed static (pps independent of tempo)
     // Use LOCAL calculation instead of GlobalBeatGrid to prevent deck interference
-    double basePps = useFixedPixelsPerSecond
+    const double basePps = s.fixedPixelsPerSecond
         ? 100.0  // Fixed local value instead of GlobalBeatGrid
-        : ((double)width() / std::max(1.0, audioLength));
-    double safeTempo = (tempoFactor > 1e-6 ? tempoFactor : 1.0);
-    double pixelsPerSecond = basePps * zoomFactor; // do not scale by tempo for static scroll speed
-    
-    // Calculate current playhead position in seconds
-    // PREROLL SUPPORT: Allow negative playhead positions but handle them correctly
-    double effectivePlayhead = playheadPos;
-    
-    // CRITICAL FIX: Handle negative positions properly for preroll
-    double playheadSec;
-    if (effectivePlayhead < 0.0 && prerollEnabled) {
-        // In preroll area: negative position maps to negative time
-        // IMPORTANT: Don't multiply by audioLength for negative values - use direct mapping
-        playheadSec = effectivePlayhead * prerollTimeSec; // This gives us seconds before track start
-    } else {
-        // Normal area: clamp to valid range and map normally
-        effectivePlayhead = std::clamp(effectivePlayhead, 0.0, 1.0);
-        playheadSec = effectivePlayhead * audioLength;
-    }
+        : ((double)pixelWidth / std::max(1.0, s.audioLength));
+    const double safeTempo = (s.tempoFactor > 1e-6 ? s.tempoFactor : 1.0);
+    const double pixelsPerSecond = basePps * zoomFactor; // do not scale by tempo for static scroll speed
     
     // Display center time: in BeatLocked, anchor by real-time proxy (playheadSec / tempo) for constant scroll speed
-    double displayCenterSec = (viewMode == ViewMode::BeatLocked) ? (playheadSec / safeTempo) : playheadSec;
+    v.displayCenterSec = beatLocked ? (playheadSec / safeTempo) : playheadSec;
     
     // Calculate visible time range centered on playhead
     // PREROLL SUPPORT: Proper viewport calculation for negative times
-    double bufferSec = std::max(0.05, 0.5 / std::max(1.0, zoomFactor));
-    double halfViewportTime = (double)width() / (2.0 * pixelsPerSecond);
-    double leftSecond = displayCenterSec - halfViewportTime - bufferSec;
-    double rightSecond = displayCenterSec + halfViewportTime + bufferSec;
+    v.bufferSec = std::max(0.05, 0.5 / std::max(1.0, zoomFactor));
+    v.halfViewportTime = (double)pixelWidth / (2.0 * pixelsPerSecond);
+    v.leftSecond = v.displayCenterSec - v.halfViewportTime - v.bufferSec;
+    v.rightSecond = v.displayCenterSec + v.halfViewportTime + v.bufferSec;
+    v.timeRange = v.rightSecond - v.leftSecond;
     
     // IMPORTANT: Don't artificially limit leftSecond - let it go negative for preroll
-    // The rendering code will handle negative times appropriately
-    
-    // Convert to source bin indices for waveform data
-    // PREROLL SUPPORT: Only use bins for positive time range
-    double binPerSecond = (double)sourceWidth / audioLength;
-    
-    // Calculate bins only for the positive portion of the viewport
-    double posLeftSecond = std::max(0.0, leftSecond);
-    double posRightSecond = std::max(0.0, rightSecond);
-    
-    int leftBin = std::max(0, (int)((posLeftSecond - audioStartOffset) * binPerSecond));
-    int rightBin = std::min(sourceWidth, (int)((posRightSecond - audioStartOffset) * binPerSecond));
-    
-    // Ensure valid range
-    if (leftBin < 0) leftBin = 0;
-    if (rightBin > sourceWidth) rightBin = sourceWidth;
-    if (leftBin >= rightBin && rightSecond > 0.0) return; // Only return early if we're not in preroll
-    
-    // Smooth viewport calculations
-    int pixelWidth = width();
-    double timeRange = rightSecond - leftSecond;
-    
-    // Create REAL WAVEFORM like Serato/Rekordbox - separate upper and lower parts
-    std::vector<QPointF> upperPoints, lowerPoints;
-    upperPoints.reserve(pixelWidth);
-    lowerPoints.reserve(pixelWidth);
-    
-    // Render pixel by pixel with consistent sampling strategy
-    for (int screenX = 0; screenX < pixelWidth; ++screenX) {
-        // Map screen pixel to time
-        double screenRatio = (double)screenX / (double)pixelWidth;
-        double timeSec = leftSecond + screenRatio * timeRange;
-        
-        // Calculate audio bin position
-            double scaledTime;
-            if (viewMode == ViewMode::BeatLocked) {
-                // Map visual time (timeSec around displayCenterSec) to track time around playheadSec
-                // Faster tempo -> multiply to compress waveform features
-                double deltaVis = timeSec - displayCenterSec;
-                scaledTime = playheadSec + (deltaVis * safeTempo);
-            } else {
-                // Pure track time
-                scaledTime = timeSec;
-            }
-            double audioBinFloat = (scaledTime - audioStartOffset) * binPerSecond;
-            
-            // PREROLL SUPPORT: Handle negative times (before track start)
-            if (scaledTime < 0.0 && prerollEnabled) {
-                // In preroll area - render NO waveform (flat center line)
-                upperPoints.emplace_back(screenX, centerY);
-                lowerPoints.emplace_back(screenX, centerY);
-                continue;
-            }
-            
-            if (audioBinFloat < 0 || audioBinFloat >= sourceWidth) {
-            upperPoints.emplace_back(screenX, centerY);
-            lowerPoints.emplace_back(screenX, centerY);
-            continue;
-        }
-        
-        // Get REAL waveform min/max values with zoom-consistent sampling
-        float minVal = 0.0f, maxVal = 0.0f;
-        
-        // Consistent sampling strategy based on zoom to prevent "wackling"
-        if (zoomFactor < 1.0) {
-            // Zoomed out: sample multiple bins to get stable peaks
-            int sampleRadius = (int)(1.5 / zoomFactor);
-            int startBin = std::max(0, (int)audioBinFloat - sampleRadius);
-            int endBin = std::min(sourceWidth, (int)audioBinFloat + sampleRadius + 1);
-            
-            // Find peak values in range for stable display
-            for (int b = startBin; b < endBin; ++b) {
-                if (b >= 0 && b < sourceWidth && b < sourceMinBins.size() && b < sourceMaxBins.size()) {
-                    minVal = std::min(minVal, sourceMinBins[b]);
-                    maxVal = std::max(maxVal, sourceMaxBins[b]);
-                }
-            }
-        } else {
-            // Zoomed in: use smooth interpolation
-            int bin = (int)audioBinFloat;
-            float frac = audioBinFloat - bin;
-            
-            if (bin >= 0 && bin < sourceWidth - 1 && bin + 1 < sourceMinBins.size() && bin + 1 < sourceMaxBins.size()) {
-                // Simple linear interpolation for consistency
-                minVal = sourceMinBins[bin] * (1.0f - frac) + sourceMinBins[bin + 1] * frac;
-                maxVal = sourceMaxBins[bin] * (1.0f - frac) + sourceMaxBins[bin + 1] * frac;
-            } else if (bin >= 0 && bin < sourceWidth && bin < sourceMinBins.size() && bin < sourceMaxBins.size()) {
-                minVal = sourceMinBins[bin];
-                maxVal = sourceMaxBins[bin];
-            }
-        }
-        
-        // Convert to screen coordinates - REAL waveform with positive and negative parts
-        float upperY = centerY - maxVal * height() * 0.45f;
-        float lowerY = centerY - minVal * height() * 0.45f;
-        
-        upperPoints.emplace_back(screenX, upperY);
-        lowerPoints.emplace_back(screenX, lowerY);
-    }
-    
-    // Draw the REAL waveform like Serato/Rekordbox
-    if (upperPoints.size() > 1 && lowerPoints.size() > 1) {
-        // Create filled waveform area
-        QPainterPath waveformPath;
-        
-        // Start with upper curve
-        waveformPath.moveTo(upperPoints[0]);
-        for (size_t i = 1; i < upperPoints.size(); ++i) {
-            waveformPath.lineTo(upperPoints[i]);
-        }
-        
-        // Connect to lower curve and go back
-        waveformPath.lineTo(lowerPoints.back());
-        for (int i = (int)lowerPoints.size() - 2; i >= 0; --i) {
-            waveformPath.lineTo(lowerPoints[i]);
-        }
-        waveformPath.closeSubpath();
-        
-        // Fill with gradient like professional DJ software
-        QLinearGradient waveGradient(0, 0, 0, height());
-        waveGradient.setColorAt(0.0, QColor(100, 180, 255, 140));  // Top
-        waveGradient.setColorAt(0.5, QColor(60, 140, 220, 80));    // Center
-        waveGradient.setColorAt(1.0, QColor(100, 180, 255, 140));  // Bottom
-        
-        p.fillPath(waveformPath, QBrush(waveGradient));
-        
-        // Draw crisp outline lines
-        QPen outlinePen(QColor(120, 200, 255), zoomFactor > 6.0 ? 1.8f : 1.2f);
-        outlinePen.setCapStyle(Qt::RoundCap);
-        outlinePen.setJoinStyle(Qt::RoundJoin);
-        p.setPen(outlinePen);
-        
-        // Draw upper waveform line
-        QPainterPath upperLine;
-        upperLine.moveTo(upperPoints[0]);
-        for (size_t i = 1; i < upperPoints.size(); ++i) {
-            upperLine.lineTo(upperPoints[i]);
-        }
-        p.drawPath(upperLine);
-        
-        // Draw lower waveform line
-        QPainterPath lowerLine;
-        lowerLine.moveTo(lowerPoints[0]);
-        for (size_t i = 1; i < lowerPoints.size(); ++i) {
-            lowerLine.lineTo(lowerPoints[i]);
-        }
-        p.drawPath(lowerLine);
-    }
-    
-    // Removed center horizontal line to eliminate remaining grey lines
-    
-    // Draw beat grid only after analysis is available
-    if (useAnalyzedBeats) {
-        drawBeatGrid(p, playheadSec, leftSecond, rightSecond, timeRange);
+    // Convert to source bin indices for waveform data; only the positive time range has bins
+    const double binPerSecond = (double)s.sourceWidth / s.audioLength;
+    const int leftBin = std::max(0, (int)((std::max(0.0, v.leftSecond) - s.audioStartOffset) * binPerSecond));
+    const int rightBin = std::min(s.sourceWidth, (int)((std::max(0.0, v.rightSecond) - s.audioStartOffset) * binPerSecond));
+    v.visible = leftBin < rightBin || v.rightSecond <= 0.0;
+    
+    v.trackSecPerPixel = v.timeRange / (double)pixelWidth * (beatLocked ? safeTempo : 1.0);
+    v.binsPerPixel = v.trackSecPerPixel * binPerSecond;
+    v.leftTrackSec = beatLocked ? playheadSec + (v.leftSecond - v.displayCenterSec) * safeTempo : v.leftSecond;
+    v.binOrigin = (v.leftTrackSec - s.audioStartOffset) * binPerSecond;
+    v.outlineWidth = zoomFactor > 6.0 ? 1.8f : 1.2f;
+    v.visualScale = beatLocked ? 1.0 / safeTempo : 1.0;
+    v.visualOffset = beatLocked ? v.displayCenterSec - playheadSec * v.visualScale : 0.0;
+    return v;
+}
+
+void WaveformDisplay::paintOverlays(QPainter& p, const Scene& s, const View& v, const QSize& size, bool linesOnGpu)
+{
+    const double playheadSec = v.playheadSec;
+    if (s.useAnalyzedBeats) {
+        drawBeatGrid(p, s, size, playheadSec, v.leftSecond, v.rightSecond, v.timeRange, linesOnGpu);
     }
     
     // Calculate audio-time viewport for cue points (unaffected by tempo)
-    double audioTimeLeftSec = playheadSec - halfViewportTime - bufferSec;
-    double audioTimeRightSec = playheadSec + halfViewportTime + bufferSec;
+    double audioTimeLeftSec = playheadSec - v.halfViewportTime - v.bufferSec;
+    double audioTimeRightSec = playheadSec + v.halfViewportTime + v.bufferSec;
     double audioTimeRange = audioTimeRightSec - audioTimeLeftSec;
     
     // Draw cue points using audio time (not tempo-scaled time)
-    if (cuePointsValid && audioLength > 0.0) {
-        drawCuePoints(p, audioTimeLeftSec, audioTimeRightSec, audioTimeRange);
+    if (s.cuePointsValid && s.audioLength > 0.0) {
+        drawCuePoints(p, s, size, playheadSec, audioTimeLeftSec, audioTimeRightSec, audioTimeRange);
     }
     
+    if (s.structure.isValid() && s.audioLength > 0.0) {
+        drawPhrases(p, s, size, playheadSec, v.leftSecond, v.rightSecond, v.timeRange);
+    }
+
     // Draw loops using display time (tempo-scaled) for correct visual sizing
     // Draw ghost loop region first (behind active loop) using display time
-    if (ghostLoopEnabled && audioLength > 0.0 && ghostLoopEndSec > ghostLoopStartSec) {
-        drawGhostLoopRegion(p, leftSecond, rightSecond, timeRange);
+    if (s.ghostLoopEnabled && s.audioLength > 0.0 && s.ghostLoopEndSec > s.ghostLoopStartSec) {
+        drawGhostLoopRegion(p, s, size, playheadSec, v.leftSecond, v.rightSecond, v.timeRange);
     }
 
     // PREROLL VISUALIZATION: Draw preroll area if enabled and visible
-    if (prerollEnabled && leftSecond < 0.0) {
-        drawPrerollRegion(p, leftSecond, rightSecond, timeRange);
+    if (s.prerollEnabled && v.leftSecond < 0.0) {
+        drawPrerollRegion(p, size, v.leftSecond, v.rightSecond, v.timeRange);
     }
 
     // Draw active loop only when enabled
-    std::cout << "WaveformDisplay::paintGL loop check: loopEnabled=" << loopEnabled 
-              << ", loopStartSec=" << loopStartSec << ", loopEndSec=" << loopEndSec 
-              << ", audioLength=" << audioLength << std::endl;
-    if (loopEnabled && loopEndSec > loopStartSec && audioLength > 0.0) {
-        std::cout << "WaveformDisplay::paintGL calling drawLoopRegion" << std::endl;
-        drawLoopRegion(p, leftSecond, rightSecond, timeRange);
+    if (s.loopEnabled && s.loopEndSec > s.loopStartSec && s.audioLength > 0.0) {
+        drawLoopRegion(p, s, size, playheadSec, v.leftSecond, v.rightSecond, v.timeRange);
     }
     
     // DEBUG: Always draw a red indicator if loop is enabled (for debugging)
-    if (loopEnabled) {
+    if (s.loopEnabled) {
         p.setPen(QPen(QColor(255, 0, 0), 3));
         p.drawRect(10, 10, 100, 20);
-        p.drawText(15, 25, QString("LOOP ENABLED: %1-%2").arg(loopStartSec, 0, 'f', 1).arg(loopEndSec, 0, 'f', 1));
+        p.drawText(15, 25, QString("LOOP ENABLED: %1-%2").arg(s.loopStartSec, 0, 'f', 1).arg(s.loopEndSec, 0, 'f', 1));
     }
     
-    // Draw playhead
+    // Draw playhead (always fixed in the middle)
     p.setPen(QPen(QColor(255, 100, 100), 2));
-    p.drawLine(centerX, 0, centerX, height());
+    p.drawLine(size.width() / 2, 0, size.width() / 2, size.height());
     
     // Zoom indicator
-    if (zoomFactor != 1.0) {
+    if (s.zoomFactor != 1.0) {
         p.setPen(QPen(QColor(150, 180, 220), 1));
         p.setFont(QFont("Arial", 8));
-        QString zoomText = QString("%1x").arg(zoomFactor, 0, 'f', 1);
-        p.drawText(8, height() - 15, zoomText);
+        QString zoomText = QString("%1x").arg(s.zoomFactor, 0, 'f', 1);
+        p.drawText(8, size.height() - 15, zoomText);
+    }
+}
+
+void WaveformDisplay::resizeEvent(QResizeEvent* event)
+{
+    QOpenGLWidget::resizeEvent(event);
+    scaledDirty = true; // ensure static-mode scaled cache updates on next paint
+    if (rendererHost) rendererHost->setGeometry(rect());
+}
+
+bool WaveformDisplay::setThreadedRendering(const DJAudioPlayer* player)
+{
+    if (rendererHost) {
+        // The thread is joined before the container deletes the window it draws into
+        renderer->stop();
+        delete rendererHost;
+        rendererHost = nullptr;
+        renderer = nullptr;
+        update();
+    }
+    if (!player || isPhaseCompare() || displayStyle != DisplayStyle::Waveform || !WaveformRenderer::isSupported())
+        return false;
+
+    renderer = new WaveformRenderer(this, player);
+    renderer->setVisualTrim(threadedVisualTrim);
+    rendererHost = QWidget::createWindowContainer(renderer, this);
+    // Input reaches the window and is handed on to this view, keys included
+    rendererHost->setFocusPolicy(Qt::NoFocus);
+    rendererHost->setGeometry(rect());
+    rendererHost->show();
+    publishScene();
+    return true;
+}
+
+void WaveformDisplay::setThreadedVisualTrim(double seconds)
+{
+    threadedVisualTrim = seconds;
+    if (renderer) renderer->setVisualTrim(seconds);
+}
+
+void WaveformDisplay::publishScene()
+{
+    if (renderer) renderer->setScene(std::make_shared<const Scene>(makeScene()));
+}
+
+void WaveformDisplay::setPhaseCompare(const WaveformDisplay* top, const WaveformDisplay* bottom)
+{
+    compareDecks[0].view = top;
+    compareDecks[1].view = bottom;
+    for (auto& deck : compareDecks) deck.gridKey = {};
+    update();
+}
+
+void WaveformDisplay::paintPhaseCompare(QPainter& p)
+{
+    if (!glReady) {
+        p.setPen(QPen(QColor(120, 120, 120), 1));
+        p.setFont(QFont("Arial", 9));
+        p.drawText(rect(), Qt::AlignCenter, "PHASE VIEW NEEDS OPENGL 3.3");
+        return;
+    }
+
+    // Output seconds across the view at this view's zoom, the decks' base scale
+    const double secondsPerPixel = 1.0 / (100.0 * getBeatGridZoomFactor());
+    const int halfHeight = height() / 2;
+    p.beginNativePainting();
+    for (size_t i = 0; i < compareDecks.size(); ++i) {
+        CompareDeck& deck = compareDecks[i];
+        const WaveformDisplay* view = deck.view;
+        if (!view || view->source->maxBins.empty() || view->audioLength <= 0.0) continue;
+        const QRect area = i == 0 ? QRect(0, 0, width(), halfHeight) : QRect(0, halfHeight, width(), height() - halfHeight);
+        const double tempo = view->tempoFactor > 1e-6 ? view->tempoFactor : 1.0;
+        const double trackSecPerPixel = secondsPerPixel * tempo;
+        const double leftTrackSec = view->playheadSeconds() - width() * 0.5 * trackSecPerPixel;
+
+        // The deck view's upload; until it has painted a new summary there is nothing to draw
+        if (!view->texturesDirty && view->waveTextures) {
+            const double binPerSecond = view->sourceWidth / view->audioLength;
+            const double binsPerPixel = trackSecPerPixel * binPerSecond;
+            drawWaveTextures(*view->source, *view->waveTextures, area, (leftTrackSec - view->audioStartOffset) * binPerSecond,
+                             binsPerPixel, view->levelForBinsPerDetail(binsPerPixel / detailPixelRatio()), 1.2f);
+        }
+        if (view->useAnalyzedBeats && !view->gridLines->times.empty()) {
+            if (!deck.beatVao.isCreated()) createBeatVao(deck.beatVao, deck.beatInstances);
+            if (deck.gridKey != view->gridKey) {
+                uploadBeatInstances(deck.beatInstances, view->gridLines->times, view->gridLines->isBar);
+                deck.gridKey = view->gridKey;
+            }
+            drawBeatInstances(deck.beatVao, deck.beatInstances, area, 0.0, 1.0 / tempo, leftTrackSec / tempo,
+                              width() * secondsPerPixel);
+        }
+    }
+    p.endNativePainting();
+
+    p.setPen(QPen(QColor(60, 60, 70), 1));
+    p.drawLine(0, halfHeight, width(), halfHeight);
+    p.setFont(QFont("Arial", 8, QFont::Bold));
+    p.setPen(QColor(0, 136, 255));
+    p.drawText(6, 12, "A");
+    p.setPen(QColor(255, 136, 0));
+    p.drawText(6, halfHeight + 12, "B");
+    p.setPen(QPen(QColor(255, 100, 100), 2));
+    p.drawLine(width() / 2, 0, width() / 2, height());
+}
+
+double WaveformDisplay::playheadSeconds() const
+{
+    return playheadSeconds(playheadPos, prerollEnabled, prerollTimeSec, audioLength);
+}
+
+double WaveformDisplay::playheadSeconds(double relative, bool prerollEnabled, double prerollTimeSec, double audioLength)
+{
+    // CRITICAL FIX: Handle negative positions properly for preroll
+    if (relative < 0.0 && prerollEnabled) {
+        // In preroll area: negative position maps to negative time
+        // IMPORTANT: Don't multiply by audioLength for negative values - use direct mapping
+        return relative * prerollTimeSec; // This gives us seconds before track start
     }
+    // Normal area: clamp to valid range and map normally
+    return std::clamp(relative, 0.0, 1.0) * audioLength;
+}
+
+size_t WaveformDisplay::levelForBinsPerDetail(const WaveformGenerator::Result& wave, double binsPerDetail)
+{
+    double levelScale = 1.0;
+    size_t levelIndex = 0;
+    for (size_t level = 0; level < wave.pyramid.size(); ++level) {
+        if (binsPerDetail < levelScale * 2.0) break;
+        levelScale *= 2.0;
+        ++levelIndex;
+    }
+    return levelIndex;
 }
 
 void WaveformDisplay::loadAndRenderWaveform()
@@ -346,12 +1034,86 @@ void WaveformDisplay::loadFile(const QString& path)
     QTimer::singleShot(10, this, &WaveformDisplay::loadAndRenderWaveform);
 }
 
+void WaveformDisplay::setSourceBins(WaveformGenerator::SharedResult wave)
+{
+    if (!wave) return;
+    source = std::move(wave);
+    loadingSource.reset();
+    loadingSnapshot.reset();
+    texturesDirty = true;
+    invalidateScrollTiles();
+    sourceWidth = (int) source->maxBins.size();
+    audioStartOffset = source->audioStartOffsetSec;
+    audioLength = source->lengthSeconds;
+    // Ensure track metadata and initial viewport are valid before playback
+    trackLengthSec = source->lengthSeconds;
+    if (playheadPos < 0.0) {
+        // Default to start so the waveform is visible immediately
+        playheadPos = 0.0;
+    }
+    // New bins imply a new track; wait for analysis before drawing beat grid
+    useAnalyzedBeats = false;
+    beatPositions.clear();
+    noveltyFlux.clear();
+    noveltyReady = false;
+    beatPhaseShiftSec = 0.0;
+    update();
+}
+
+void WaveformDisplay::beginSourceBins(int binCount, double audioStartOffsetSec, double lengthSeconds)
+{
+    // No pyramid or colours until the summary is complete; level 0 is enough meanwhile
+    loadingSource = std::make_shared<WaveformGenerator::Result>();
+    loadingSource->maxBins.assign((size_t)std::max(0, binCount), 0);
+    loadingSource->minBins.assign((size_t)std::max(0, binCount), 0);
+    loadingSource->audioStartOffsetSec = audioStartOffsetSec;
+    loadingSource->lengthSeconds = lengthSeconds;
+    source = loadingSource;
+    ++loadingRevision;
+    texturesDirty = true;
+    invalidateScrollTiles();
+    sourceWidth = binCount;
+    audioStartOffset = audioStartOffsetSec;
+    audioLength = lengthSeconds;
+    trackLengthSec = lengthSeconds;
+    if (playheadPos < 0.0) playheadPos = 0.0;
+    useAnalyzedBeats = false;
+    beatPositions.clear();
+    noveltyFlux.clear();
+    noveltyReady = false;
+    beatPhaseShiftSec = 0.0;
+    update();
+}
+
+void WaveformDisplay::updateSourceBins(int firstBin, const std::vector<std::int8_t>& maxBins,
+                                       const std::vector<std::int8_t>& minBins)
+{
+    if (!loadingSource || source != loadingSource || firstBin < 0 || firstBin >= sourceWidth) return;
+    const size_t count = std::min({ maxBins.size(), minBins.size(), (size_t)(sourceWidth - firstBin) });
+    std::copy_n(maxBins.begin(), count, loadingSource->maxBins.begin() + firstBin);
+    std::copy_n(minBins.begin(), count, loadingSource->minBins.begin() + firstBin);
+    ++loadingRevision;
+    texturesDirty = true;
+    invalidateScrollTiles();
+    update();
+}
+
 void WaveformDisplay::setOriginalBpm(double bpm, double trackLengthSeconds)
 {
     originalBpm = bpm;
     trackLengthSec = trackLengthSeconds;
     // REMOVED: GlobalBeatGrid update to prevent deck interference
     // Each deck now uses its own originalBpm for beat grid rendering
+    recomputeBeatPhaseShift();
+    update();
+}
+
+void WaveformDisplay::setBeatNovelty(const std::vector<float>& envelope, double hopSec)
+{
+    noveltyFlux = envelope;
+    noveltyFluxHopSec = hopSec;
+    noveltyReady = !noveltyFlux.empty() && hopSec > 0.0;
+    recomputeBeatPhaseShift();
     update();
 }
 
@@ -382,12 +1144,8 @@ void WaveformDisplay::setPlayhead(double relative)
 }
 
 void WaveformDisplay::throttledUpdate() {
-    if (!updateThrottleTimer->isActive()) {
-        updateThrottleTimer->start();
-        update();
-    } else {
-        pendingUpdate = true;
-    }
+    // Picked up by the next frame clock tick
+    pendingUpdate = true;
 }
 
 void WaveformDisplay::updateTempo(double newBpm) {
@@ -404,7 +1162,7 @@ void WaveformDisplay::updateTempo(double newBpm) {
     
     // REMOVED: GlobalBeatGrid update to prevent deck interference
     // Each deck now uses its own originalBpm and tempoFactor
-    update();
+    throttledUpdate();
 }
 
 void WaveformDisplay::refreshBeatGrid() {
@@ -451,8 +1209,8 @@ void WaveformDisplay::mouseMoveEvent(QMouseEvent* event)
         // DIRECTION FIX: Invert deltaX so left mouse = backward waveform movement
         deltaX = -deltaX;
         
-        // STABILITY: Skip tiny movements and prevent jitter
-        if (std::abs(deltaX) < 3) { // Increased threshold from 2 to 3 for more stability
+        // Every pixel counts: the audio thread smooths the path, a dead zone would only make it stair-step
+        if (deltaX == 0) {
             return;
         }
         
@@ -507,8 +1265,7 @@ void WaveformDisplay::mouseMoveEvent(QMouseEvent* event)
         // Clamp to valid range
         newPos = std::clamp(newPos, minPos, maxPos);
 
-        // ANTI-JITTER: Only update if change is significant enough
-        if (std::abs(newPos - playheadPos) > 0.0001) {
+        if (newPos != playheadPos) {
 
             // Debug (reduced frequency to avoid spam)
             static int debugCounter = 0;
@@ -554,7 +1311,7 @@ void WaveformDisplay::mouseReleaseEvent(QMouseEvent* event)
     }
 }
 
-// Zoom controls with + and - keys
+// Zoom controls with + and - keys; S switches between the waveform and the spectrogram
 void WaveformDisplay::keyPressEvent(QKeyEvent* event)
 {
     switch (event->key()) {
@@ -568,6 +1325,9 @@ void WaveformDisplay::keyPressEvent(QKeyEvent* event)
         case Qt::Key_0:
             resetBeatGridZoom();
             break;
+        case Qt::Key_S:
+            setDisplayStyle(displayStyle == DisplayStyle::Spectrogram ? DisplayStyle::Waveform : DisplayStyle::Spectrogram);
+            break;
         default:
             QWidget::keyPressEvent(event);
             break;
@@ -610,8 +1370,53 @@ double WaveformDisplay::mapXToAbsRel(double x) const
     return std::clamp(x / std::max(1, width()), 0.0, 1.0);
 }
 
-void WaveformDisplay::recomputeBeatPhaseShift() {}
-void WaveformDisplay::generateDefaultGrid() {}
+void WaveformDisplay::recomputeBeatPhaseShift()
+{
+    beatPhaseShiftSec = 0.0;
+    if (!noveltyReady || originalBpm <= 0.0 || trackLengthSec <= 0.0) return;
+
+    std::vector<double> beats;
+    baseGridBeatTimes(beats);
+    if (beats.empty()) return;
+
+    // Analysed beats only get a fine-tune; the default grid from 0:00 has no phase of its own
+    const double period = 60.0 / originalBpm;
+    const double range = beatPositions.isEmpty() ? period * 0.5 : std::min(0.03, period * 0.25);
+    const double hop = noveltyFluxHopSec;
+    const double lastFrame = (double)(noveltyFlux.size() - 1);
+    auto score = [&](double shift) {
+        double sum = 0.0;
+        for (double t : beats) {
+            const double frame = (t + shift) / hop;
+            if (frame < 0.0) continue;
+            if (frame >= lastFrame) break;
+            const size_t i = (size_t)frame;
+            const double frac = frame - (double)i;
+            sum += noveltyFlux[i] * (1.0 - frac) + noveltyFlux[i + 1] * frac;
+        }
+        return sum;
+    };
+
+    // Quarter-frame steps over the range, then a parabola through the best step's neighbours
+    const double step = hop * 0.25;
+    double bestShift = 0.0, bestScore = score(0.0);
+    for (double shift = -range; shift <= range; shift += step) {
+        const double s = score(shift);
+        if (s > bestScore) { bestScore = s; bestShift = shift; }
+    }
+    const double before = score(bestShift - step), after = score(bestShift + step);
+    const double curvature = before - 2.0 * bestScore + after;
+    if (curvature < 0.0)
+        bestShift += std::clamp(0.5 * (before - after) / curvature, -0.5, 0.5) * step;
+    beatPhaseShiftSec = bestShift;
+}
+
+void WaveformDisplay::generateDefaultGrid()
+{
+    // updateGridBeats() builds the grid on demand; only its phase depends on the new length
+    recomputeBeatPhaseShift();
+    update();
+}
 
 // NEW: Cue points support
 void WaveformDisplay::setCuePoints(const std::array<double, 8>& newCuePoints) {
@@ -654,30 +1459,20 @@ void WaveformDisplay::setGhostLoopRegion(bool enabled, double startSec, double e
 }
 
 // NEW: Beat grid rendering using global beat grid system
-void WaveformDisplay::drawBeatGrid(QPainter& p, double playheadSec, double leftSecond, 
-                                   double rightSecond, double timeRange) {
+void WaveformDisplay::drawBeatGrid(QPainter& p, const Scene& s, const QSize& size, double playheadSec, double leftSecond,
+                                   double rightSecond, double timeRange, bool linesOnGpu) {
     
     if (timeRange <= 0.0) return;
     
-    // Use LOCAL beat data and BPM - completely independent from GlobalBeatGrid
-    std::vector<double> localBeats;
-    double localBpm = originalBpm; // Use this deck's original BPM
-    
-    if (!beatPositions.isEmpty()) {
-        localBeats.reserve(beatPositions.size());
-        for (double rel : beatPositions) localBeats.push_back(rel * trackLengthSec);
-    } else if (localBpm > 0.0) {
-        // Generate local beat grid based on this deck's BPM - NO GlobalBeatGrid dependency
-        double beatInterval = 60.0 / localBpm;
-        for (double t = 0.0; t < trackLengthSec + beatInterval; t += beatInterval) {
-            localBeats.push_back(t);
-        }
-    }
+    // Use LOCAL beat data and BPM - completely independent from GlobalBeatGrid (makeScene updated the grid)
+    static const std::vector<double> noBeats;
+    const std::vector<double>& localBeats = s.grid ? s.grid->times : noBeats;
+    double localBpm = s.originalBpm; // Use this deck's original BPM
     
     if (localBeats.empty() && localBpm <= 0.0) return;
     
     // Tempo used for transform in BeatLocked mode
-    double deckTempoFactor = tempoFactor;
+    double deckTempoFactor = s.tempoFactor;
     double safeTempoLocal = (deckTempoFactor > 1e-6 ? deckTempoFactor : 1.0);
     
     // Calculate current effective BPM for visual styling - use local BPM
@@ -691,132 +1486,98 @@ void WaveformDisplay::drawBeatGrid(QPainter& p, double playheadSec, double leftS
     QPen whiteBeatPen(QColor(200, 220, 255, 160), 1.5);
     whiteBeatPen.setStyle(Qt::SolidLine);
     
-    int beatIndex = 0;
+    // Visible lines are collected first and drawn in one call per style, labels after them
+    QVector<QLineF> barLines, beatLines;
+    struct BarLabel { int x; QString text; };
+    std::vector<BarLabel> barLabels;
+    const int viewWidth = size.width();
+    const int viewHeight = size.height();
+    auto addLine = [&](int screenX, bool bar, bool onGpu) {
+        if (onGpu) return;
+        if (bar) barLines.append(QLineF(screenX, 0, screenX, viewHeight)); // Full height line
+        else beatLines.append(QLineF(screenX, viewHeight / 3, screenX, 2 * viewHeight / 3));
+    };
+    
+    // Visual time is linear in beat time, so only the visible slice of the grid is walked
     const double displayCenterSecLocal = (leftSecond + rightSecond) * 0.5;
+    const double visualScale = (s.viewMode == ViewMode::BeatLocked) ? 1.0 / std::max(1e-6, safeTempoLocal) : 1.0;
+    const double visualOffset = (s.viewMode == ViewMode::BeatLocked) ? displayCenterSecLocal - playheadSec * visualScale : 0.0;
+    const double firstVisible = (leftSecond - visualOffset) / visualScale - 1e-3;
+    const double lastVisible = (leftSecond + timeRange - visualOffset) / visualScale + 1e-3;
+    auto toScreenX = [&](double beatTime) {
+        const double visualTime = visualOffset + beatTime * visualScale;
+        return (int)((visualTime - leftSecond) / timeRange * viewWidth);
+    };
     
-    // PREROLL BEAT GRID: Handle negative time region ONLY - completely independent
-    if (leftSecond < 0.0 && prerollEnabled && localBpm > 0.0) {
-        double beatInterval = 60.0 / (localBpm * deckTempoFactor); // Use local BPM with tempo
+    // PREROLL BEAT GRID: negative time region only, beats generated from this deck's BPM
+    if (leftSecond < 0.0 && s.prerollEnabled && localBpm > 0.0) {
+        const double beatInterval = 60.0 / (localBpm * deckTempoFactor); // Use local BPM with tempo
         
-        // Only draw in negative time region - start from -beatInterval and go backwards
-        for (double beatTime = -beatInterval; beatTime >= leftSecond; beatTime -= beatInterval) {
-            if (beatTime >= 0.0) continue; // Only negative times for preroll
+        // Beat -1, -2, ... that fall inside the window
+        const long long firstBeat = (long long)std::ceil(firstVisible / beatInterval);
+        const long long lastBeat = std::min(-1LL, (long long)std::floor(lastVisible / beatInterval));
+        for (long long beatNumber = firstBeat; beatNumber <= lastBeat; ++beatNumber) {
+            const int screenX = toScreenX(beatNumber * beatInterval);
+            if (screenX < 0 || screenX >= viewWidth) continue;
             
-            double visualTime;
-            if (viewMode == ViewMode::BeatLocked) {
-                visualTime = displayCenterSecLocal + (beatTime - playheadSec) / std::max(1e-6, safeTempoLocal);
-            } else {
-                visualTime = beatTime;
-            }
-            
-            double relativePos = (visualTime - leftSecond) / timeRange;
-            int screenX = (int)(relativePos * width());
-            
-            if (screenX >= 0 && screenX < width()) {
-                // Calculate which beat this is (-1, -2, -3, ...)
-                int beatNumber = (int)std::round(beatTime / beatInterval);
-                
-                // Every 4th beat gets orange line
-                if (beatNumber % 4 == 0) {
-                    p.setPen(orangeBeatPen);
-                    p.drawLine(screenX, 0, screenX, height());
-                    
-                    // Orange line number: -1, -2, -3, etc.
-                    int orangeLineNumber = beatNumber / 4;
-                    
-                    // Draw number labels
-                    p.setPen(QPen(QColor(255, 180, 100, 200), 1));
-                    p.setFont(QFont("Arial", 9, QFont::Bold));
-                    p.drawText(screenX + 3, 15, QString::number(orangeLineNumber));
-                } else {
-                    // Regular beats - white lines
-                    p.setPen(whiteBeatPen);
-                    p.drawLine(screenX, height()/3, screenX, 2*height()/3);
-                }
-            }
+            // Every 4th beat gets an orange line numbered -1, -2, -3, ...
+            const bool bar = beatNumber % 4 == 0;
+            addLine(screenX, bar, false);
+            if (bar) barLabels.push_back({ screenX, QString::number(beatNumber / 4) });
         }
         
-        // Special case: Draw the "0" line at song start (beatTime = 0.0) if visible
+        // Special case: the "0" line at song start if visible
         if (rightSecond > 0.0 && leftSecond < 0.1) {
-            double visualTime;
-            if (viewMode == ViewMode::BeatLocked) {
-                visualTime = displayCenterSecLocal + (0.0 - playheadSec) / std::max(1e-6, safeTempoLocal);
-            } else {
-                visualTime = 0.0;
-            }
-            
-            double relativePos = (visualTime - leftSecond) / timeRange;
-            int screenX = (int)(relativePos * width());
-            
-            if (screenX >= 0 && screenX < width()) {
-                p.setPen(orangeBeatPen);
-                p.drawLine(screenX, 0, screenX, height());
-                
-                // Draw "0" label at song start
-                p.setPen(QPen(QColor(255, 180, 100, 200), 1));
-                p.setFont(QFont("Arial", 9, QFont::Bold));
-                p.drawText(screenX + 3, 15, "0");
+            const int screenX = toScreenX(0.0);
+            if (screenX >= 0 && screenX < viewWidth) {
+                addLine(screenX, true, false);
+                barLabels.push_back({ screenX, QStringLiteral("0") });
             }
         }
     }
     
-    // REGULAR BEAT GRID: Handle positive time region (existing track) - start from first beat AFTER 0
-    for (double beatTime : localBeats) {
-        // Only process beats well after track start (> 0.1) to avoid any overlap
-        if (beatTime <= 0.1) {
-            beatIndex++;
-            continue;
-        }
-        double visualTime;
-        if (viewMode == ViewMode::BeatLocked) {
-            // Transform track beat time to visual time so that center corresponds to playhead
-            // Faster tempo -> divide to bring beat lines closer together
-            visualTime = displayCenterSecLocal + (beatTime - playheadSec) / std::max(1e-6, safeTempoLocal);
-        } else {
-            visualTime = beatTime;
-        }
-        double relativePos = (visualTime - leftSecond) / timeRange;
-        int screenX = (int)(relativePos * width());
-        
-        if (screenX < 0 || screenX >= width()) {
-            beatIndex++;
-            continue;
-        }
+    // REGULAR BEAT GRID: positive time region (existing track) - from the first beat AFTER 0,
+    // found by binary search; only beats well after track start (> 0.1) to avoid any overlap
+    auto it = std::lower_bound(localBeats.begin(), localBeats.end(), std::max(firstVisible, 0.1));
+    for (; it != localBeats.end() && *it <= lastVisible; ++it) {
+        if (*it <= 0.1) continue;
+        const int beatIndex = (int)(it - localBeats.begin());
+        const int screenX = toScreenX(*it);
+        if (screenX < 0 || screenX >= viewWidth) continue;
         
         // Every 4th beat gets an orange line with sequential numbering
-        if (beatIndex % 4 == 0) {
-            // Use the common orange style for ALL beats that are multiples of 4
-            p.setPen(orangeBeatPen);
-            p.drawLine(screenX, 0, screenX, height()); // Full height line
-            
-            // Calculate sequential number for ALL orange lines
-            int orangeLineNumber = (beatIndex / 4) + 1; // Continuous numbering
-            
-            p.setPen(QPen(QColor(255, 180, 100, 200), 1));
-            p.setFont(QFont("Arial", 9, QFont::Bold));
-            p.drawText(screenX + 3, 15, QString::number(orangeLineNumber));
-        } else {
-            // Regular beats - WHITE lines (no numbering)
-            p.setPen(whiteBeatPen);
-            p.drawLine(screenX, height()/3, screenX, 2*height()/3);
-        }
-        
-        beatIndex++;
+        const bool bar = beatIndex % 4 == 0;
+        addLine(screenX, bar, linesOnGpu);
+        if (bar) barLabels.push_back({ screenX, QString::number((beatIndex / 4) + 1) }); // Continuous numbering
+    }
+    
+    if (!beatLines.isEmpty()) {
+        p.setPen(whiteBeatPen);
+        p.drawLines(beatLines);
+    }
+    if (!barLines.isEmpty()) {
+        p.setPen(orangeBeatPen);
+        p.drawLines(barLines);
+    }
+    if (!barLabels.empty()) {
+        p.setPen(QPen(QColor(255, 180, 100, 200), 1));
+        p.setFont(QFont("Arial", 9, QFont::Bold));
+        for (const auto& label : barLabels) p.drawText(label.x + 3, 15, label.text);
     }
     
     // BPM indicator with analysis status
     {
         p.setFont(QFont("Arial", 8));
-        int rightX = width() - 8;
+        int rightX = size.width() - 8;
         int y = 15;
-        if (analysisActive) {
+        if (s.analysisActive) {
             // Show progress percent
-            int percent = (int)std::round(analysisProgress * 100.0);
+            int percent = (int)std::round(s.analysisProgress * 100.0);
             p.setPen(QPen(QColor(180, 200, 255), 1));
             QString txt = QString("Analyzing %1%") .arg(percent);
             int w = p.fontMetrics().horizontalAdvance(txt);
             p.drawText(rightX - w, y, txt);
-        } else if (analysisFailed) {
+        } else if (s.analysisFailed) {
             p.setPen(QPen(QColor(255, 120, 120), 1));
             QString txt("Analysis failed");
             int w = p.fontMetrics().horizontalAdvance(txt);
@@ -828,7 +1589,7 @@ void WaveformDisplay::drawBeatGrid(QPainter& p, double playheadSec, double leftS
             p.drawText(rightX - w, y, bpmText);
         }
         // Optional: pixels-per-second info on next line
-        if (useFixedPixelsPerSecond) {
+        if (s.fixedPixelsPerSecond) {
             double pixelsPerSec = 100.0; // Local fixed value instead of GlobalBeatGrid
             QString ratioText = QString("%1px/s").arg(pixelsPerSec, 0, 'f', 0);
             int w = p.fontMetrics().horizontalAdvance(ratioText);
@@ -839,8 +1600,11 @@ void WaveformDisplay::drawBeatGrid(QPainter& p, double playheadSec, double leftS
 }
 
 // NEW: Draw cue points as vertical lines
-void WaveformDisplay::drawCuePoints(QPainter& p, double leftSecond, double rightSecond, double timeRange) {
-    if (timeRange <= 0.0 || audioLength <= 0.0) return;
+void WaveformDisplay::drawCuePoints(QPainter& p, const Scene& s, const QSize& size, double playheadPositionSec,
+                                    double leftSecond, double rightSecond, double timeRange) {
+    if (timeRange <= 0.0 || s.audioLength <= 0.0) return;
+    const int width = size.width();
+    const int height = size.height();
     
     // Define cue point colors (rainbow-like sequence for easy identification)
     static const QColor cueColors[8] = {
@@ -855,18 +1619,18 @@ void WaveformDisplay::drawCuePoints(QPainter& p, double leftSecond, double right
     };
     
     // Get tempo and viewport info for proper scaling
-    double safeTempo = (tempoFactor > 1e-6 ? tempoFactor : 1.0);
+    double safeTempo = (s.tempoFactor > 1e-6 ? s.tempoFactor : 1.0);
     double displayCenterSec = (leftSecond + rightSecond) * 0.5;
-    double playheadSec = std::clamp(playheadPos, 0.0, 1.0) * audioLength;
+    double playheadSec = std::clamp(playheadPositionSec, 0.0, s.audioLength);
     
     for (int i = 0; i < 8; ++i) {
-        if (cuePoints[i] < 0.0) continue; // Skip unset cue points
+        if (s.cuePoints[i] < 0.0) continue; // Skip unset cue points
         
-        double cueAudioTime = cuePoints[i]; // Original cue time in audio seconds
+        double cueAudioTime = s.cuePoints[i]; // Original cue time in audio seconds
         
         // Convert cue time from audio time to display time based on view mode
         double cueDisplayTime;
-        if (viewMode == ViewMode::BeatLocked) {
+        if (s.viewMode == ViewMode::BeatLocked) {
             // BeatLocked: Convert audio time to visual time using same logic as beat grid
             // visual = displayCenter + (audio - playhead) / tempo
             cueDisplayTime = displayCenterSec + (cueAudioTime - playheadSec) / safeTempo;
@@ -880,16 +1644,16 @@ void WaveformDisplay::drawCuePoints(QPainter& p, double leftSecond, double right
         
         // Calculate screen position using display time
         double relativePos = (cueDisplayTime - leftSecond) / timeRange;
-        int screenX = (int)(relativePos * width());
+        int screenX = (int)(relativePos * width);
         
         // Ensure screen position is valid
-        if (screenX < 0 || screenX >= width()) continue;
+        if (screenX < 0 || screenX >= width) continue;
         
         // Draw cue line with distinctive style
         QPen cuePen(cueColors[i], 2.5);
         cuePen.setStyle(Qt::SolidLine);
         p.setPen(cuePen);
-        p.drawLine(screenX, 0, screenX, height());
+        p.drawLine(screenX, 0, screenX, height);
         
         // Draw small cue number label at bottom
         p.setFont(QFont("Arial", 7, QFont::Bold));
@@ -898,7 +1662,7 @@ void WaveformDisplay::drawCuePoints(QPainter& p, double leftSecond, double right
         
         // Position label at bottom to avoid overlap with beat grid
         int labelX = screenX + 3;
-        int labelY = height() - 2; // Bottom of waveform
+        int labelY = height - 2; // Bottom of waveform
         
         // Draw label background for better readability
         QRect bgRect(labelX - 1, labelY - labelRect.height() + 1, labelRect.width() + 2, labelRect.height());
@@ -911,19 +1675,62 @@ void WaveformDisplay::drawCuePoints(QPainter& p, double leftSecond, double right
 }
 
 // NEW: Draw loop region as semi-transparent box
-void WaveformDisplay::drawLoopRegion(QPainter& p, double leftSecond, double rightSecond, double timeRange) {
-    if (timeRange <= 0.0 || audioLength <= 0.0) return;
+void WaveformDisplay::drawPhrases(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                                  double leftSecond, double rightSecond, double timeRange) {
+    if (timeRange <= 0.0) return;
+    const int width = size.width();
+    const int height = size.height();
+    const double safeTempo = (s.tempoFactor > 1e-6 ? s.tempoFactor : 1.0);
+    const double displayCenterSecLocal = (leftSecond + rightSecond) * 0.5;
+    const double phSec = std::clamp(playheadSec, 0.0, s.audioLength);
+    // Same audio-to-display mapping as drawLoopRegion
+    auto toDisplay = [&](double sec) {
+        return s.viewMode == ViewMode::BeatLocked ? displayCenterSecLocal + (sec - phSec) / safeTempo : sec;
+    };
+
+    p.save();
+    p.setFont(QFont("Arial", 7, QFont::Bold));
+    const int stripHeight = 3;
+    for (const auto& phrase : s.structure.phrases) {
+        const double start = toDisplay(phrase.startSec);
+        const double end = toDisplay(phrase.endSec);
+        if (end < leftSecond || start > rightSecond) continue;
+        const int x0 = (int)(std::clamp((start - leftSecond) / timeRange, 0.0, 1.0) * width);
+        const int x1 = (int)(std::clamp((end - leftSecond) / timeRange, 0.0, 1.0) * width);
+        if (x1 <= x0) continue;
+        QColor color = QColor::fromRgb((QRgb) TrackStructure::getSectionColor(phrase.section));
+        color.setAlpha(22);
+        p.fillRect(x0, 0, x1 - x0, height, color);
+        color.setAlpha(200);
+        p.fillRect(x0, height - stripHeight, x1 - x0, stripHeight, color);
+        if (start >= leftSecond) {
+            p.setPen(QPen(color, 1));
+            p.drawLine(x0, 0, x0, height);
+            p.drawText(x0 + 3, height - stripHeight - 3,
+                       QString("%1 %2").arg(TrackStructure::getSectionName(phrase.section)).arg(phrase.bars));
+        }
+    }
+    p.restore();
+}
+
+void WaveformDisplay::drawLoopRegion(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                                     double leftSecond, double rightSecond, double timeRange) {
+    if (timeRange <= 0.0 || s.audioLength <= 0.0) return;
+    const int width = size.width();
+    const int height = size.height();
+    const double loopStartSec = s.loopStartSec;
+    const double loopEndSec = s.loopEndSec;
     
     // Convert loop times from audio time to display time for correct visual sizing
-    double safeTempo = (tempoFactor > 1e-6 ? tempoFactor : 1.0);
+    double safeTempo = (s.tempoFactor > 1e-6 ? s.tempoFactor : 1.0);
     double displayLoopStartSec, displayLoopEndSec;
     
-    if (viewMode == ViewMode::BeatLocked) {
+    if (s.viewMode == ViewMode::BeatLocked) {
         // BeatLocked display maps visual time around playhead: 
         // visual = displayCenter + (audio - playhead) / tempo
         // USE SAME LOGIC AS GHOST LOOP SINCE THAT WORKS
         const double displayCenterSecLocal = (leftSecond + rightSecond) * 0.5;
-        const double phSec = std::clamp(playheadPos, 0.0, 1.0) * audioLength;
+        const double phSec = std::clamp(playheadSec, 0.0, s.audioLength);
         displayLoopStartSec = displayCenterSecLocal + (loopStartSec - phSec) / safeTempo;
         displayLoopEndSec   = displayCenterSecLocal + (loopEndSec   - phSec) / safeTempo;
     } else {
@@ -943,14 +1750,14 @@ void WaveformDisplay::drawLoopRegion(QPainter& p, double leftSecond, double righ
     relativeStart = std::max(0.0, std::min(1.0, relativeStart));
     relativeEnd = std::max(0.0, std::min(1.0, relativeEnd));
     
-    int screenStartX = (int)(relativeStart * width());
-    int screenEndX = (int)(relativeEnd * width());
+    int screenStartX = (int)(relativeStart * width);
+    int screenEndX = (int)(relativeEnd * width);
     
     if (screenEndX <= screenStartX) return;
     
     // Draw semi-transparent loop region (more opaque than ghost)
     QColor loopColor(100, 255, 100, 160); // Green with 160/255 transparency
-    p.fillRect(screenStartX, 0, screenEndX - screenStartX, height(), loopColor);
+    p.fillRect(screenStartX, 0, screenEndX - screenStartX, height, loopColor);
     
     // Draw loop boundaries with more opaque lines
     QPen loopBoundaryPen(QColor(0, 200, 0, 200), 2.5);
@@ -958,8 +1765,8 @@ void WaveformDisplay::drawLoopRegion(QPainter& p, double leftSecond, double righ
     p.setPen(loopBoundaryPen);
     
     // Draw start and end lines
-    p.drawLine(screenStartX, 0, screenStartX, height());
-    p.drawLine(screenEndX, 0, screenEndX, height());
+    p.drawLine(screenStartX, 0, screenStartX, height);
+    p.drawLine(screenEndX, 0, screenEndX, height);
     
     // Draw small "LOOP" label at top of loop region
     p.setFont(QFont("Arial", 8, QFont::Bold));
@@ -980,18 +1787,23 @@ void WaveformDisplay::drawLoopRegion(QPainter& p, double leftSecond, double righ
 }
 
 // NEW: Draw ghost loop region as very transparent box for last used loop
-void WaveformDisplay::drawGhostLoopRegion(QPainter& p, double leftSecond, double rightSecond, double timeRange) {
-    if (!ghostLoopEnabled || timeRange <= 0.0 || audioLength <= 0.0) return;
+void WaveformDisplay::drawGhostLoopRegion(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                                          double leftSecond, double rightSecond, double timeRange) {
+    if (!s.ghostLoopEnabled || timeRange <= 0.0 || s.audioLength <= 0.0) return;
+    const int width = size.width();
+    const int height = size.height();
+    const double ghostLoopStartSec = s.ghostLoopStartSec;
+    const double ghostLoopEndSec = s.ghostLoopEndSec;
     
     // Convert ghost loop times from audio time to display time for correct visual sizing
-    double safeTempo = (tempoFactor > 1e-6 ? tempoFactor : 1.0);
+    double safeTempo = (s.tempoFactor > 1e-6 ? s.tempoFactor : 1.0);
     double displayGhostLoopStartSec, displayGhostLoopEndSec;
     
-    if (viewMode == ViewMode::BeatLocked) {
+    if (s.viewMode == ViewMode::BeatLocked) {
         // BeatLocked display maps visual time around playhead: 
         // visual = displayCenter + (audio - playhead) / tempo
         const double displayCenterSecLocal = (leftSecond + rightSecond) * 0.5;
-        const double phSec = std::clamp(playheadPos, 0.0, 1.0) * audioLength;
+        const double phSec = std::clamp(playheadSec, 0.0, s.audioLength);
         displayGhostLoopStartSec = displayCenterSecLocal + (ghostLoopStartSec - phSec) / safeTempo;
         displayGhostLoopEndSec   = displayCenterSecLocal + (ghostLoopEndSec   - phSec) / safeTempo;
     } else {
@@ -1011,14 +1823,14 @@ void WaveformDisplay::drawGhostLoopRegion(QPainter& p, double leftSecond, double
     relativeStart = std::max(0.0, std::min(1.0, relativeStart));
     relativeEnd = std::max(0.0, std::min(1.0, relativeEnd));
     
-    int screenStartX = (int)(relativeStart * width());
-    int screenEndX = (int)(relativeEnd * width());
+    int screenStartX = (int)(relativeStart * width);
+    int screenEndX = (int)(relativeEnd * width);
     
     if (screenEndX <= screenStartX) return;
     
     // Draw very transparent ghost loop region (much lighter than active loop)
     QColor ghostLoopColor(100, 255, 100, 20); // Green with 20/255 transparency (lighter than active)
-    p.fillRect(screenStartX, 0, screenEndX - screenStartX, height(), ghostLoopColor);
+    p.fillRect(screenStartX, 0, screenEndX - screenStartX, height, ghostLoopColor);
     
     // Draw ghost loop boundaries with lighter opacity
     QPen ghostBoundaryPen(QColor(0, 200, 0, 80), 1.5);
@@ -1026,8 +1838,8 @@ void WaveformDisplay::drawGhostLoopRegion(QPainter& p, double leftSecond, double
     p.setPen(ghostBoundaryPen);
     
     // Draw start and end lines
-    p.drawLine(screenStartX, 0, screenStartX, height());
-    p.drawLine(screenEndX, 0, screenEndX, height());
+    p.drawLine(screenStartX, 0, screenStartX, height);
+    p.drawLine(screenEndX, 0, screenEndX, height);
     
     // Draw small "GHOST" label at top of ghost loop region
     p.setFont(QFont("Arial", 7, QFont::Normal)); // Smaller and lighter than active loop
@@ -1048,48 +1860,50 @@ void WaveformDisplay::drawGhostLoopRegion(QPainter& p, double leftSecond, double
 }
 
 // NEW: Draw preroll region for DJ-style cueing
-void WaveformDisplay::drawPrerollRegion(QPainter& p, double leftSecond, double rightSecond, double timeRange) {
+void WaveformDisplay::drawPrerollRegion(QPainter& p, const QSize& size, double leftSecond, double rightSecond, double timeRange) {
+    const int width = size.width();
+    const int height = size.height();
     // Only draw if preroll area is visible
     if (rightSecond <= 0.0) {
         // Entire viewport is in preroll
         double screenStartX = 0;
-        double screenEndX = width();
+        double screenEndX = width;
         
         // Dark blue-gray background for preroll area
         QColor prerollColor(30, 50, 80, 120);
-        p.fillRect(QRect(screenStartX, 0, screenEndX - screenStartX, height()), prerollColor);
+        p.fillRect(QRect(screenStartX, 0, screenEndX - screenStartX, height), prerollColor);
         
         // Diagonal stripes pattern to indicate preroll
         p.setPen(QPen(QColor(60, 100, 160), 1));
         for (int x = screenStartX; x < screenEndX; x += 20) {
-            p.drawLine(x, 0, x + 10, height());
+            p.drawLine(x, 0, x + 10, height);
         }
         
         // Preroll label
         p.setFont(QFont("Arial", 10, QFont::Bold));
         p.setPen(QPen(QColor(120, 180, 255), 1));
-        p.drawText(width()/2 - 30, height()/2, "PREROLL");
+        p.drawText(width/2 - 30, height/2, "PREROLL");
         
     } else if (leftSecond < 0.0) {
         // Partial preroll visible
         double prerollRatio = -leftSecond / timeRange;
-        int screenEndX = (int)(prerollRatio * width());
+        int screenEndX = (int)(prerollRatio * width);
         
         // Dark blue-gray background for preroll area
         QColor prerollColor(30, 50, 80, 120);
-        p.fillRect(QRect(0, 0, screenEndX, height()), prerollColor);
+        p.fillRect(QRect(0, 0, screenEndX, height), prerollColor);
         
         // Diagonal stripes pattern
         p.setPen(QPen(QColor(60, 100, 160), 1));
         for (int x = 0; x < screenEndX; x += 15) {
-            p.drawLine(x, 0, x + 8, height());
+            p.drawLine(x, 0, x + 8, height);
         }
         
         // Track start line (at position 0.0)
         double trackStartRatio = -leftSecond / timeRange;
-        int trackStartX = (int)(trackStartRatio * width());
+        int trackStartX = (int)(trackStartRatio * width);
         p.setPen(QPen(QColor(255, 255, 255), 2));
-        p.drawLine(trackStartX, 0, trackStartX, height());
+        p.drawLine(trackStartX, 0, trackStartX, height);
         
         // Label
         p.setFont(QFont("Arial", 8, QFont::Bold));
@@ -2,7 +2,10 @@
 
 #include <QWidget>
 #include <QOpenGLWidget>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLShaderProgram>
 #include <QImage>
 #include <QPixmap>
 #include <QString>
@@ -10,15 +13,29 @@
 #include <QResizeEvent>
 #include <QTimer>
 #include <JuceHeader.h>
+#include <array>
+#include <memory>
 #include <vector>
 #include "GlobalBeatGrid.h"
+#include "TrackStructure.h"
+#include "FrameTimeHud.h"
+#include "GlResources.h"
+#include "MemoryBudget.h"
+#include "Spectrogram.h"
+#include "WaveformGenerator.h"
 
-class WaveformDisplay : public QOpenGLWidget, protected QOpenGLFunctions
+class DJAudioPlayer;
+class WaveformRenderer;
+
+class WaveformDisplay : public QOpenGLWidget, protected QOpenGLExtraFunctions
 {
     Q_OBJECT
 public:
     enum class ViewMode { TimeLocked, BeatLocked };
+    // What the view shows of the stretch of track in view; ViewMode decides which stretch that is
+    enum class DisplayStyle { Waveform, Spectrogram };
     explicit WaveformDisplay(QWidget* parent = nullptr);
+    ~WaveformDisplay() override;
     void loadFile(const QString& path);
     // update playhead position (0.0-1.0)
     void setPlayhead(double relative);
@@ -29,46 +46,38 @@ public:
         // Capture first beat offset for use in default grid
         if (!beats.isEmpty()) {
             firstBeatOffset = beats.first() * trackLengthSec;
-            // Keep global grid aligned with analysis: bpm + firstBeatOffset + track length
-            GlobalBeatGrid::getInstance().setBeatGridParams(originalBpm, firstBeatOffset, trackLengthSec);
         }
         // Re-align the grid after new beats are provided
         recomputeBeatPhaseShift();
         update(); 
     }
+    // Onset novelty from the analysis pass (BpmAnalyzer::getBeatNovelty, cached with the grid);
+    // the drawn grid is phase-tuned against it
+    void setBeatNovelty(const std::vector<float>& envelope, double hopSec);
+    // Phrases from the same analysis, tinted under the waveform by section
+    void setStructure(const TrackStructure& trackStructure) { structure = trackStructure; update(); }
     // Set original BPM from analysis to generate adaptive beat grid
     void setOriginalBpm(double bpm, double trackLengthSeconds);
-    // New: accept precomputed high-res bins from a background task
-    void setSourceBins(const std::vector<float>& maxBins,
-                       const std::vector<float>& minBins,
-                       double audioStartOffsetSec,
-                       double lengthSeconds) {
-        sourceMaxBins = maxBins;
-        sourceMinBins = minBins;
-        sourceWidth = (int) maxBins.size();
-        audioStartOffset = audioStartOffsetSec;
-        audioLength = lengthSeconds;
-        // Ensure track metadata and initial viewport are valid before playback
-        trackLengthSec = lengthSeconds;
-        if (playheadPos < 0.0) {
-            // Default to start so the waveform is visible immediately
-            playheadPos = 0.0;
-        }
-    // New bins imply a new track; wait for analysis before drawing beat grid
-    useAnalyzedBeats = false;
-    beatPositions.clear();
-        waveformImage = QImage(); // ensure we render from source bins
-        update();
-    }
+    // New: accept precomputed high-res bins from a background task. The result (bins, pyramid,
+    // bands) is shared with the producer and only read here.
+    void setSourceBins(WaveformGenerator::SharedResult wave);
+    // Progressive loading: size the bins for a track still being decoded, then fill them in
+    // as the decode pass gets there. setSourceBins() with the finished summary replaces them.
+    void beginSourceBins(int binCount, double audioStartOffsetSec, double lengthSeconds);
+    void updateSourceBins(int firstBin, const std::vector<std::int8_t>& maxBins, const std::vector<std::int8_t>& minBins);
+    // Columns from the analysis pass (Spectrogram, SpectrogramCache); nullptr while the track has none
+    void setSpectrogram(Spectrogram::SharedData data);
+    // Phase comparison: this view shows no track of its own but the two deck views, one per
+    // half, on one real-time axis around their playheads, so beats of matched tempos line up
+    // and drift shows at a glance. Drawn from their GPU textures and beat grids as they last
+    // painted them; needs GL. nullptrs end it.
+    void setPhaseCompare(const WaveformDisplay* top, const WaveformDisplay* bottom);
     
-    // NEW: Set beat info with global beat grid integration
+    // NEW: Set beat info from the analysis (the deck's BeatGrid is published by its player)
     void setBeatInfo(double bpm, double firstBeatOffset, double totalLength) {
+        Q_UNUSED(firstBeatOffset);
         originalBpm = bpm;
         trackLengthSec = totalLength;
-        
-        // Update global beat grid
-        GlobalBeatGrid::getInstance().setBeatGridParams(bpm, firstBeatOffset, totalLength);
-        
         update();
     }
     
@@ -79,11 +88,12 @@ public:
     void setPrerollEnabled(bool enabled) { prerollEnabled = enabled; update(); }
     void setPrerollTime(double seconds) { prerollTimeSec = seconds; update(); }
 
-    // Set tempo factor to adjust beat grid timing (deck-specific)
-    void setTempoFactor(double factor) { 
-    // Update tempo factor immediately for visual sync (no threshold to reflect tiny slider steps)
-    tempoFactor = factor; 
-    update(); // Direct update without throttling for sync responsiveness
+    // Set tempo factor to adjust beat grid timing (deck-specific). Tempo only warps the view:
+    // the shaders take it as uniforms over the uploaded summary and beat instances, and the
+    // software tiles are stretched, so a fader move costs the next frame and nothing else.
+    void setTempoFactor(double factor) {
+        tempoFactor = factor;
+        throttledUpdate();
     }
 
     // Scrolling overview mode: keep playhead centered and scroll waveform
@@ -131,7 +141,12 @@ public:
     double getPixelsPerSecond() const { return GlobalBeatGrid::getInstance().getPixelsPerSecond(); }
     // View mode control
     void setViewMode(ViewMode m) { viewMode = m; update(); }
+    // Interface/WaveformQuality, 25-100: how much of a hi-DPI screen's resolution the waveform uses
+    void setWaveformQuality(int percent);
     ViewMode getViewMode() const { return viewMode; }
+    // Interface/WaveformStyle; the spectrogram needs GL and the track's columns, else the waveform is drawn
+    void setDisplayStyle(DisplayStyle style) { displayStyle = style; update(); }
+    DisplayStyle getDisplayStyle() const { return displayStyle; }
     // Visual latency compensation in seconds (UI leads audio by this amount)
     void setVisualLatencyComp(double seconds) { visualLatencyComp = std::clamp(seconds, -0.25, 0.25); }
 
@@ -140,22 +155,96 @@ public:
     void setAnalysisProgress(double p) { analysisProgress = std::clamp(p, 0.0, 1.0); update(); }
     void setAnalysisFailed(bool failed) { analysisFailed = failed; update(); }
 
+    // Interface/ThreadedWaveforms: the view drawn by a WaveformRenderer on its own thread, its
+    // playhead read from `player`'s position snapshot there, so it scrolls on through a busy GUI
+    // thread. The widget keeps the input and the state and hands a Scene over every frame.
+    // Only the waveform style of a deck view (not the phase view) and only where the platform
+    // draws GL off the GUI thread; false if not started. nullptr stops it, before `player` goes.
+    bool setThreadedRendering(const DJAudioPlayer* player);
+    bool isThreadedRendering() const { return renderer != nullptr; }
+    // The user trim the threaded view samples the snapshot with (positive delays the picture)
+    void setThreadedVisualTrim(double seconds);
+
+    // Phase-shifted beat times (seconds) and bar flags of the drawn grid
+    struct GridLines {
+        std::vector<double> times;
+        std::vector<bool> isBar;
+    };
+    // Everything a frame of the scrolling view draws but the playhead, laid out on the GUI thread
+    // from the setters above; immutable once made, so the render thread can draw from it
+    struct Scene {
+        WaveformGenerator::SharedResult source;
+        int sourceWidth{0};
+        double audioLength{0.0};
+        double audioStartOffset{0.0};
+        double tempoFactor{1.0};
+        double originalBpm{0.0};
+        double zoomFactor{1.0};
+        ViewMode viewMode{ViewMode::BeatLocked};
+        bool fixedPixelsPerSecond{true};
+        int waveformQuality{75};
+        bool prerollEnabled{true};
+        double prerollTimeSec{8.0};
+        bool useAnalyzedBeats{false};
+        std::shared_ptr<const GridLines> grid;
+        std::array<double, 8> cuePoints{};
+        bool cuePointsValid{false};
+        bool loopEnabled{false};
+        double loopStartSec{0.0};
+        double loopEndSec{0.0};
+        bool ghostLoopEnabled{false};
+        double ghostLoopStartSec{0.0};
+        double ghostLoopEndSec{0.0};
+        TrackStructure structure;
+        bool analysisActive{false};
+        double analysisProgress{0.0};
+        bool analysisFailed{false};
+        // While the view is scratched its playhead follows the pointer, not the deck
+        bool scratching{false};
+        double playheadRelative{0.0};
+    };
+    // Where a frame of a scene looks at the track, for a view size and playhead
+    struct View {
+        double playheadSec{0.0};       // track time under the playhead, negative in the preroll
+        double displayCenterSec{0.0};
+        double halfViewportTime{0.0};
+        double bufferSec{0.0};
+        double leftSecond{0.0};        // display time across the view
+        double rightSecond{0.0};
+        double timeRange{0.0};
+        double leftTrackSec{0.0};      // track time at the left edge
+        double trackSecPerPixel{0.0};
+        double binOrigin{0.0};         // source bin at the left edge
+        double binsPerPixel{0.0};
+        double visualOffset{0.0};      // beat lines: visual time = offset + beat * scale
+        double visualScale{1.0};
+        float outlineWidth{1.2f};
+        bool visible{true};            // false: nothing of the track in view, draw nothing
+    };
+    static View layoutView(const Scene& scene, const QSize& size, double playheadSec);
+    // Beat grid labels (and lines unless linesOnGpu), cues, phrases, loops, preroll, playhead
+    static void paintOverlays(QPainter& p, const Scene& scene, const View& view, const QSize& size, bool linesOnGpu);
+    // Track time under the playhead for a deck's relative position (negative: preroll)
+    static double playheadSeconds(double relative, bool prerollEnabled, double prerollTimeSec, double audioLength);
+    // The summary's texture layout (uploadWaveformTextures): rows of WaveTextureWidth texels,
+    // `bands` left empty unless every level has band energies; 0 rows for an empty summary
+    static int packWaveTextures(const WaveformGenerator::Result& wave, std::vector<int>& levelTexelOffsets,
+                                std::vector<std::int8_t>& minMax, std::vector<std::uint8_t>& bands);
+    static size_t levelForBinsPerDetail(const WaveformGenerator::Result& wave, double binsPerDetail);
+    static qreal detailPixelRatio(qreal devicePixelRatio, int waveformQuality);
+    static constexpr int WaveTextureWidth = 4096;
+
 signals:
     void positionClicked(double relative);
     void scratchStart();
+    // Per pointer event; the audio thread derives the scratch speed from these positions
     void scratchMove(double relative);
     void scratchEnd();
-    void scratchVelocityChanged(double velocity); // Signal for scratch speed
     void zoomLevelChanged(int newLevel); // Signal when zoom level changes
 
 protected:
     // OpenGL-backed rendering for ultra-smooth visuals
-    void initializeGL() override {
-        initializeOpenGLFunctions();
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    }
+    void initializeGL() override;
     void resizeGL(int w, int h) override { Q_UNUSED(w); Q_UNUSED(h); }
     void paintGL() override;
     void mousePressEvent(QMouseEvent* event) override;
@@ -164,10 +253,7 @@ protected:
     void keyPressEvent(QKeyEvent* event) override;
     QSize sizeHint() const override { return QSize(1100, 240); }
     QSize minimumSizeHint() const override { return QSize(700, 160); }
-    void resizeEvent(QResizeEvent* event) override {
-    QOpenGLWidget::resizeEvent(event);
-        scaledDirty = true; // ensure static-mode scaled cache updates on next paint
-    }
+    void resizeEvent(QResizeEvent* event) override;
 
 private:
     // Simplified rendering methods
@@ -177,10 +263,8 @@ private:
 
 private:
     // Waveform rendering - optimized for performance
-    QImage waveformImage;
     QPixmap cachedScaled; // cached scaled image for static mode
     bool scaledDirty{true};
-    juce::AudioFormatManager formatManager;
     QString currentFilePath;
     double playheadPos{-1.0};
     bool scrollMode{false};
@@ -188,8 +272,14 @@ private:
     int imageHeight{0};
     
     // High-resolution source data for viewport rendering
-    std::vector<float> sourceMaxBins;
-    std::vector<float> sourceMinBins;
+    // (maxBins, minBins, pyramid of halving levels for zoomed-out views, bands); never null
+    WaveformGenerator::SharedResult source{ std::make_shared<WaveformGenerator::Result>() };
+    // The result being filled by beginSourceBins / updateSourceBins; owned by this display alone
+    std::shared_ptr<WaveformGenerator::Result> loadingSource;
+    // Colour of a bin from its NumBands quantised energies; the shader does the same per pixel
+    static QRgb bandColour(const std::uint8_t* energies);
+    // Band energies for every bin of a level (0 = source bins, i = pyramid[i - 1])
+    static bool hasBands(const WaveformGenerator::Result& wave, size_t levelIndex);
     int sourceWidth{0};
     double audioLength{0.0};
     
@@ -207,11 +297,8 @@ private:
     double ghostLoopStartSec{0.0};
     double ghostLoopEndSec{0.0};
     
-    // Performance optimization: Image cache and update throttling
-    QTimer* updateThrottleTimer{nullptr};
-    QTimer* renderTimer{nullptr};
+    // Performance optimization: Image cache and update throttling (repaint on the next FrameClock tick)
     bool pendingUpdate{false};
-    static constexpr int UPDATE_THROTTLE_MS = 16; // ~60 FPS for ultra-smooth performance
     
     // ENHANCED: Smart caching system for better performance with multiple loaded songs
     struct RenderCache {
@@ -255,12 +342,8 @@ private:
     double beatPhaseShiftSec{0.0}; // uniform phase shift we apply when drawing beats
     int manualBeatLineOffsetBeats{-1}; // manual whole-beat shift (negative = left)
     
-    // Envelope-driven alignment data
-    std::vector<float> ampEnvelope; // per-pixel max amplitude, size == imageWidth
-    bool envelopeReady{false};
-    
     // Analysis caches
-    std::vector<float> noveltyFlux; // frame-wise positive energy differences
+    std::vector<float> noveltyFlux; // frame-wise onset novelty (0..1) from the analysis pass
     double noveltyFluxHopSec{0.0};
     bool noveltyReady{false};
 
@@ -268,8 +351,6 @@ private:
     bool scratching{false};
     double scratchStartX{0.0};          // Initial mouse X when scratch began
     double scratchStartPos{0.0};        // Initial track position (0..1) when scratch began
-    double scratchVelocity{0.0};        // Current scratch velocity for audio feedback
-    QTimer* scratchTimer{nullptr};      // Timer for velocity updates
     
     // Additional scratch variables for the working implementation
     double scratchViewOffset{0.0};      // Current view offset during scratching
@@ -293,24 +374,142 @@ private:
     void loadAndRenderWaveform();
     void generateDefaultGrid(); // Generate default beat grid based on current BPM
     void recomputeBeatPhaseShift(); // Optimize phase so lines hit peaks in main section
-    void computeEnergyFluxNovelty(const juce::AudioBuffer<float>& buffer, double sampleRateFromReader);
     double mapXToAbsRel(double x) const; // Helper to map x-position to absolute relative position (0..1 along full track)
+    // The scene of the next frame; shares the summary and grid with the last one while they last
+    Scene makeScene();
     
-    // NEW: Beat grid rendering with global beat grid
-    void drawBeatGrid(QPainter& p, double playheadSec, double leftSecond, 
-                      double rightSecond, double timeRange);
+    // NEW: Beat grid rendering with global beat grid (linesOnGpu: only labels and preroll here)
+    static void drawBeatGrid(QPainter& p, const Scene& s, const QSize& size, double playheadSec, double leftSecond,
+                             double rightSecond, double timeRange, bool linesOnGpu = false);
+
+    // GPU waveform: quantised min/max and band energies of every pyramid level live in two
+    // textures and a fragment shader shades each pixel; beat lines are instanced quads. Per frame only
+    // uniforms change. Falls back to the software tiles when the shaders don't build or
+    // GlResources::gpuWaveforms() says no.
+    void uploadWaveformTextures();
+    // The summary's shared textures, uploaded if this view is the first to show it
+    void updateWaveTextures();
+    // Waveform detail pixels per logical pixel, from devicePixelRatio and waveformQuality
+    qreal detailPixelRatio() const;
+    int waveformQuality{75};
+    void updateGridBeats();
+    // Grid before the phase shift: analysed beats, else one from this deck's BPM at 0:00
+    void baseGridBeatTimes(std::vector<double>& out) const;
+    bool drawWaveformGL(double binOrigin, double binsPerPixel, size_t levelIndex, float outlineWidth);
+    // One summary's textures into `area` (logical pixels) of this widget
+    bool drawWaveTextures(const WaveformGenerator::Result& wave, const GlResources::WaveTextures& textures,
+                          const QRect& area, double binOrigin, double binsPerPixel, size_t levelIndex, float outlineWidth);
+    void drawBeatLinesGL(double visualOffset, double visualScale, double leftSecond, double timeRange);
+    void createBeatVao(QOpenGLVertexArrayObject& vao, QOpenGLBuffer& instances);
+    static void uploadBeatInstances(QOpenGLBuffer& instances, const std::vector<double>& beatTimes, const std::vector<bool>& isBar);
+    void drawBeatInstances(QOpenGLVertexArrayObject& vao, QOpenGLBuffer& instances, const QRect& area,
+                           double visualOffset, double visualScale, double leftSecond, double timeRange);
+    void setGlViewport(const QRect& area);
+    // Track time under the playhead; negative in the preroll
+    double playheadSeconds() const;
+    // Pyramid level (0 = source bins) with one to two bins per detail pixel
+    size_t levelForBinsPerDetail(double binsPerDetail) const { return levelForBinsPerDetail(*source, binsPerDetail); }
+    bool glReady{false};
+    bool texturesDirty{true};
+    std::shared_ptr<QOpenGLShaderProgram> waveProgram;
+    std::shared_ptr<QOpenGLShaderProgram> beatProgram;
+    QOpenGLBuffer quadVbo{ QOpenGLBuffer::VertexBuffer };
+    QOpenGLVertexArrayObject waveVao;
+    QOpenGLBuffer beatInstanceVbo{ QOpenGLBuffer::VertexBuffer };
+    QOpenGLVertexArrayObject beatVao;
+    // Shared with every other view of the same summary (GlResources)
+    std::shared_ptr<GlResources::WaveTextures> waveTextures;
+    FrameTimeHud frameHud{this, "WaveformDisplay"};
+
+    // GPU spectrogram: the columns in view, at the finest level with at most one per detail
+    // pixel, and as many on either side sit in a ring texture of SpectrogramRingColumns rows.
+    // Scrolling uploads only the columns that came into view; the shader reads each pixel's
+    // column and band from the ring and colours it through a 256-texel colour map.
+    static constexpr int SpectrogramRingColumns = 4096;
+    bool drawSpectrogramGL(double leftTrackSec, double trackSecPerPixel);
+    void uploadSpectrogramColumns(size_t level, qint64 first, qint64 end);
+    DisplayStyle displayStyle{DisplayStyle::Waveform};
+    Spectrogram::SharedData spectrogram;
+    std::shared_ptr<QOpenGLShaderProgram> spectrogramProgram;
+    GLuint spectrogramRing{0};
+    GLuint spectrogramColourMap{0};
+    size_t ringLevel{0};
+    qint64 ringFirst{0};        // the ring holds columns [ringFirst, ringEnd) of ringLevel
+    qint64 ringEnd{0};
+    MemoryBudget::Allocation spectrogramMemory{MemoryBudget::Pool::GpuTextures};
+
+    // setPhaseCompare(): per half, the deck view and this view's copy of its beat instances
+    struct CompareDeck {
+        const WaveformDisplay* view{nullptr};
+        QOpenGLVertexArrayObject beatVao;
+        QOpenGLBuffer beatInstances{ QOpenGLBuffer::VertexBuffer };
+        std::array<double, 6> gridKey{};
+    };
+    std::array<CompareDeck, 2> compareDecks;
+    bool isPhaseCompare() const { return compareDecks[0].view || compareDecks[1].view; }
+    void paintPhaseCompare(QPainter& p);
+
+    // Software path: the waveform at the current zoom, rasterized (WaveformRaster) into fixed-width
+    // tiles along the track. Scrolling only composites the tiles in view; a tile is drawn once per
+    // zoom, size and summary, and the least recently shown ones are dropped first. In BeatLocked
+    // the tempo stretches the tiles as they are composited; they are only drawn again once the
+    // stretch passes MaxTileStretch either way.
+    static constexpr int ScrollTileWidth = 512;
+    static constexpr size_t MaxScrollTiles = 8;
+    static constexpr double MaxTileStretch = 1.1;
+    struct ScrollTile {
+        qint64 index;          // covers track columns [index * ScrollTileWidth, (index + 1) * ScrollTileWidth)
+        quint64 lastUsed;
+        QPixmap pixmap;
+    };
+    // zoomBinsPerPixel: binsPerPixel without the tempo, the tiles' key
+    void drawScrollTiles(QPainter& p, double binOrigin, double binsPerPixel, double zoomBinsPerPixel, size_t levelIndex,
+                         float outlineWidth);
+    QPixmap renderScrollTile(qint64 index, double binsPerPixel, size_t levelIndex, float outlineWidth) const;
+    void invalidateScrollTiles();
+    std::vector<ScrollTile> scrollTiles;
+    quint64 scrollTileClock{0};
+    double tileBinsPerPixel{0.0};       // what the tiles were rasterized at
+    double tileZoomBinsPerPixel{0.0};
+    size_t tileLevelIndex{0};
+    float tileOutlineWidth{0.0f};
+    int tileHeight{0};
+    qreal tilePixelRatio{0.0};
+    MemoryBudget::Allocation tileMemory{MemoryBudget::Pool::GpuTextures};
+    // The grid behind the instance buffer, rebuilt when the grid changes; never null
+    std::shared_ptr<const GridLines> gridLines{ std::make_shared<GridLines>() };
+    std::array<double, 6> gridKey{};
+    bool gridInstancesDirty{true};
     
+    // Overlays of a scene, `playheadSec` placing it; drawn by paintOverlays()
     // NEW: Cue points rendering
-    void drawCuePoints(QPainter& p, double leftSecond, double rightSecond, double timeRange);
+    static void drawCuePoints(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                              double leftSecond, double rightSecond, double timeRange);
     
     // NEW: Loop region rendering
-    void drawLoopRegion(QPainter& p, double leftSecond, double rightSecond, double timeRange);
+    static void drawLoopRegion(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                               double leftSecond, double rightSecond, double timeRange);
+    // Section tint and name per phrase, in display time like the loop
+    static void drawPhrases(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                            double leftSecond, double rightSecond, double timeRange);
+    TrackStructure structure;
     
     // NEW: Preroll region rendering for DJ-style cueing
-    void drawPrerollRegion(QPainter& p, double leftSecond, double rightSecond, double timeRange);
+    static void drawPrerollRegion(QPainter& p, const QSize& size, double leftSecond, double rightSecond, double timeRange);
     
     // NEW: Ghost loop region rendering
-    void drawGhostLoopRegion(QPainter& p, double leftSecond, double rightSecond, double timeRange);
+    static void drawGhostLoopRegion(QPainter& p, const Scene& s, const QSize& size, double playheadSec,
+                                    double leftSecond, double rightSecond, double timeRange);
+
+    // setThreadedRendering(): the window drawing this view and its container, a child filling it
+    WaveformRenderer* renderer{nullptr};
+    QWidget* rendererHost{nullptr};
+    double threadedVisualTrim{0.0};
+    void publishScene();
+    // beginSourceBins / updateSourceBins count up; a scene gets a copy of the summary per count
+    quint64 loadingRevision{0};
+    quint64 loadingSnapshotRevision{0};
+    WaveformGenerator::SharedResult loadingSnapshot;
     
     // Performance optimization: Throttled update method
     void throttledUpdate();
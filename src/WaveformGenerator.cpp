@@ -1,95 +1,385 @@
 #include "WaveformGenerator.h"
+#include "DecoderRegistry.h"
+#include "EventTrace.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <set>
 
-WaveformGenerator::WaveformGenerator()
+namespace {
+    // Files currently being analysed (the two deck views and the load pass want the same track)
+    std::mutex inFlightMutex;
+    std::condition_variable inFlightDone;
+    std::set<juce::String> inFlight;
+
+    std::mutex cacheDirectoryMutex;
+
+    juce::File& cacheDirectory()
+    {
+        static juce::File directory{ juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("DavidWaveforms") };
+        return directory;
+    }
+
+    std::int8_t quantise(float v, bool roundUp)
+    {
+        const float scaled = roundUp ? std::ceil(v * 127.0f) : std::floor(v * 127.0f);
+        return (std::int8_t) juce::jlimit(-127.0f, 127.0f, scaled);
+    }
+
+    // Mean magnitude -> 8 bit; the square root keeps quiet highs from rounding to zero
+    std::uint8_t quantiseEnergy(float meanAbs)
+    {
+        return (std::uint8_t) juce::roundToInt(255.0f * std::sqrt(juce::jlimit(0.0f, 1.0f, meanAbs * 2.0f)));
+    }
+
+    float onePoleCoeff(double cutoffHz, double sampleRate)
+    {
+        return (float) (1.0 - std::exp(-juce::MathConstants<double>::twoPi * cutoffHz / sampleRate));
+    }
+
+    constexpr int RmsChunk = 1024; // ~23ms @44.1k
+}
+
+WaveformGenerator::SummaryBuilder::SummaryBuilder(float threshold, int chunksNeeded)
+    : silenceThreshold(threshold), consecutiveChunksNeeded(chunksNeeded)
 {
-    formatManager.registerBasicFormats(); // JUCE's basic formats include MP3 with JUCE_USE_MP3AUDIOFORMAT=1
 }
 
-bool WaveformGenerator::generate(const juce::File& file,
-                                 int binCount,
-                                 Result& out,
-                                 float silenceThreshold,
-                                 int consecutiveChunksNeeded)
+void WaveformGenerator::SummaryBuilder::prepare(const juce::AudioFormatReader& reader)
 {
-    if (binCount <= 0) return false;
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
-    if (!reader) return false;
+    summary = {};
+    summary.totalSamples = reader.lengthInSamples;
+    summary.sampleRate = reader.sampleRate;
+    // Finest level covers the whole file; the audible start only decides which bins get shown
+    base = {};
+    base.samplesPerBin = WaveformCache::BaseSamplesPerBin;
+    const int64 numBins = (reader.lengthInSamples + base.samplesPerBin - 1) / base.samplesPerBin;
+    base.minMax.assign((size_t) std::max<int64>(1, numBins) * 2, 0);
+    base.bands.assign((size_t) std::max<int64>(1, numBins) * WaveformCache::NumBands, 0);
+    memory.resize((int64_t) (base.minMax.size() * sizeof(std::int8_t) + base.bands.size() * sizeof(std::uint8_t)));
+    lowCoeff = onePoleCoeff(LowCrossoverHz, reader.sampleRate);
+    highCoeff = onePoleCoeff(HighCrossoverHz, reader.sampleRate);
+    lowState = highState = 0.0f;
+    bandSum = {};
+    binSamples = 0;
+    complete = false;
+    consecutive = 0;
+    startFound = false;
+    audioStartSample = 0;
+    audioEndSample = 0;
+    rmsSum = 0.0;
+    rmsCount = 0;
+    rmsChunkStart = 0;
+    currentBin = 0;
+    binMin = binMax = 0.0f;
+    partialBinsSent = 0;
+}
 
-    const int64 totalSamples = reader->lengthInSamples;
-    if (totalSamples <= 0) return false;
-    out.totalSamples = totalSamples;
-    out.sampleRate = (int)reader->sampleRate;
-    out.lengthSeconds = (double)totalSamples / reader->sampleRate;
-
-    // Find audible start by scanning RMS with finer granularity and a small pre-roll
-    int64 audioStartSample = 0;
-    const int chunkSize = 1024; // finer resolution (~23ms @44.1k)
-    int consecutive = 0;
-    juce::AudioBuffer<float> searchBuf((int)reader->numChannels, chunkSize);
-    for (int64 pos = 0; pos < totalSamples; pos += chunkSize) {
-        const int toRead = (int)std::min<int64>(chunkSize, totalSamples - pos);
-        reader->read(&searchBuf, 0, toRead, pos, true, true);
-        double sum = 0.0;
-        int n = 0;
-        for (int ch = 0; ch < searchBuf.getNumChannels(); ++ch) {
-            const float* d = searchBuf.getReadPointer(ch);
-            for (int i = 0; i < toRead; ++i) { sum += (double)d[i] * d[i]; ++n; }
+void WaveformGenerator::SummaryBuilder::setPartialListener(int binCount, std::function<void(Partial&&)> listener)
+{
+    partialBinCount = binCount;
+    partialListener = std::move(listener);
+}
+
+void WaveformGenerator::SummaryBuilder::consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position)
+{
+    const int numCh = block.getNumChannels();
+    if (numCh <= 0 || numSamples <= 0) return;
+    detectSilence(block, numSamples, position);
+
+    // Mix channels for mono signal - real min/max, not an envelope
+    if ((int) mono.size() < numSamples) mono.resize((size_t) numSamples);
+    float* m = mono.data();
+    juce::FloatVectorOperations::copy(m, block.getReadPointer(0), numSamples);
+    for (int ch = 1; ch < numCh; ++ch)
+        juce::FloatVectorOperations::add(m, block.getReadPointer(ch), numSamples);
+    if (numCh > 1)
+        juce::FloatVectorOperations::multiply(m, 1.0f / (float) numCh, numSamples);
+
+    // Walk bin boundaries: one vector min/max per stretch of samples inside a bin
+    const int spb = base.samplesPerBin;
+    for (int i = 0; i < numSamples; ) {
+        const int64 idx = position + i;
+        const int64 bin = idx / spb;
+        if (bin != currentBin) {
+            flushBin();
+            currentBin = bin;
+        }
+        const int span = (int) std::min<int64>(numSamples - i, (bin + 1) * spb - idx);
+        const auto range = juce::FloatVectorOperations::findMinAndMax(m + i, span);
+        binMin = std::min(binMin, range.getStart());
+        binMax = std::max(binMax, range.getEnd());
+
+        // Band split: low = LP(low crossover), high = x - LP(high crossover), mid in between
+        float lowAcc = 0.0f, midAcc = 0.0f, highAcc = 0.0f;
+        for (int k = 0; k < span; ++k) {
+            const float x = m[i + k];
+            lowState += lowCoeff * (x - lowState);
+            highState += highCoeff * (x - highState);
+            lowAcc += std::abs(lowState);
+            midAcc += std::abs(highState - lowState);
+            highAcc += std::abs(x - highState);
+        }
+        bandSum[0] += lowAcc;
+        bandSum[1] += midAcc;
+        bandSum[2] += highAcc;
+        binSamples += span;
+        i += span;
+    }
+    if (partialListener) publishPartial(false);
+}
+
+void WaveformGenerator::SummaryBuilder::publishPartial(bool final)
+{
+    if (!startFound || partialBinCount <= 0 || summary.sampleRate <= 0.0) return;
+    const int64 total = summary.totalSamples;
+    if (total <= audioStartSample) return;
+
+    // Base bins before currentBin are flushed and final
+    const double samplesPerOutBin = (double) (total - audioStartSample) / (double) partialBinCount;
+    const int64 decodedEnd = final ? total : currentBin * (int64) base.samplesPerBin;
+    const int ready = final ? partialBinCount
+                            : (int) std::min<int64>(partialBinCount, (int64) ((double) (decodedEnd - audioStartSample) / samplesPerOutBin));
+    const int step = std::max(1, partialBinCount / PartialSteps);
+    if (ready <= partialBinsSent || (!final && partialBinsSent > 0 && ready - partialBinsSent < step)) return;
+
+    Partial partial;
+    partial.binCount = partialBinCount;
+    partial.firstBin = partialBinsSent;
+    partial.audioStartOffsetSec = (double) audioStartSample / summary.sampleRate;
+    partial.lengthSeconds = (double) total / summary.sampleRate;
+    const WaveformCache::LevelView view{ base.minMax.data(), nullptr, base.numBins(), base.samplesPerBin };
+    const double from = (double) audioStartSample + partialBinsSent * samplesPerOutBin;
+    const double to = (double) audioStartSample + ready * samplesPerOutBin;
+    WaveformCache::resample(&view, 1, (int64) std::llround(from), (int64) std::llround(to),
+                            ready - partialBinsSent, partial.minBins, partial.maxBins);
+    partialBinsSent = ready;
+    partialListener(std::move(partial));
+}
+
+void WaveformGenerator::SummaryBuilder::detectSilence(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position)
+{
+    const int numCh = block.getNumChannels();
+    for (int i = 0; i < numSamples; ) {
+        const int64 idx = position + i;
+        const int span = (int) std::min<int64>(numSamples - i, rmsChunkStart + RmsChunk - idx);
+        for (int ch = 0; ch < numCh; ++ch) {
+            const float* d = block.getReadPointer(ch, i);
+            float acc = 0.0f;
+            for (int k = 0; k < span; ++k) acc += d[k] * d[k];
+            rmsSum += acc;
         }
-        const float rms = n > 0 ? std::sqrt(sum / (double)n) : 0.0f;
-    if (rms > silenceThreshold) {
-            if (++consecutive >= consecutiveChunksNeeded) {
-        // Back up to the first above-threshold chunk start
-        int64 candidate = std::max<int64>(0, pos - (consecutiveChunksNeeded - 1) * chunkSize);
-        // Apply a small pre-roll so we never cut off a transient
-        const int preRoll = (int)std::round(0.02 * reader->sampleRate); // 20 ms
-        audioStartSample = std::max<int64>(0, candidate - preRoll);
-                break;
+        rmsCount += span * numCh;
+        i += span;
+
+        const int64 end = position + i;
+        if (end - rmsChunkStart < RmsChunk && end < summary.totalSamples) continue;
+        const float rms = rmsCount > 0 ? (float) std::sqrt(rmsSum / (double) rmsCount) : 0.0f;
+        if (rms > silenceThreshold) {
+            // Any loud chunk moves the end; the tail is only known once the pass is through
+            audioEndSample = end;
+            if (!startFound && ++consecutive >= consecutiveChunksNeeded) {
+                // Back up to the first above-threshold chunk start
+                const int64 candidate = std::max<int64>(0, rmsChunkStart - (int64) (consecutiveChunksNeeded - 1) * RmsChunk);
+                // Apply a small pre-roll so we never cut off a transient
+                const int preRoll = (int) std::round(0.02 * summary.sampleRate); // 20 ms
+                audioStartSample = std::max<int64>(0, candidate - preRoll);
+                startFound = true;
             }
         } else {
             consecutive = 0;
         }
+        rmsSum = 0.0;
+        rmsCount = 0;
+        rmsChunkStart = end;
     }
-    out.audioStartOffsetSec = (double)audioStartSample / reader->sampleRate;
-
-    // Stream into bins - REAL WAVEFORM like Serato/Rekordbox (not RMS/Peak!)
-    out.minBins.assign(binCount, 0.0f);
-    out.maxBins.assign(binCount, 0.0f);
-    
-    // Use smaller chunks for better waveform precision
-    const int streamChunk = 4096;
-    juce::AudioBuffer<float> buf((int)reader->numChannels, streamChunk);
-    const int64 samplesFromStart = totalSamples - audioStartSample;
-    int64 processed = 0;
-    
-    // Pre-calculate for performance
-    const double binToSampleRatio = (double)samplesFromStart / (double)binCount;
-    
-    while (processed < samplesFromStart) {
-        const int toRead = (int)std::min<int64>(streamChunk, samplesFromStart - processed);
-        reader->read(&buf, 0, toRead, audioStartSample + processed, true, true);
-        
-        for (int i = 0; i < toRead; ++i) {
-            // Mix channels for mono signal
-            float sample = 0.0f;
-            const int numCh = buf.getNumChannels();
-            for (int ch = 0; ch < numCh; ++ch) {
-                sample += buf.getReadPointer(ch)[i];
-            }
-            sample /= (float)numCh; // Average channels
-            
-            const int64 globalIdx = processed + i;
-            const int bin = (int)(globalIdx / binToSampleRatio);
-            
-            if ((unsigned)bin < (unsigned)binCount) {
-                // REAL WAVEFORM: Store actual min/max values (not envelope!)
-                if (sample < out.minBins[bin]) out.minBins[bin] = sample;
-                if (sample > out.maxBins[bin]) out.maxBins[bin] = sample;
-            }
+}
+
+void WaveformGenerator::SummaryBuilder::flushBin()
+{
+    base.minMax[(size_t) currentBin * 2] = quantise(binMin, false);
+    base.minMax[(size_t) currentBin * 2 + 1] = quantise(binMax, true);
+    if (binSamples > 0)
+        for (int k = 0; k < WaveformCache::NumBands; ++k)
+            base.bands[(size_t) currentBin * WaveformCache::NumBands + (size_t) k] = quantiseEnergy(bandSum[(size_t) k] / (float) binSamples);
+    binMin = binMax = 0.0f;
+    bandSum = {};
+    binSamples = 0;
+}
+
+void WaveformGenerator::SummaryBuilder::finish(bool completed)
+{
+    complete = completed && summary.totalSamples > 0 && summary.sampleRate > 0.0;
+    if (!complete) return;
+    flushBin();
+
+    // Whatever the listener hasn't seen yet (the tail, or everything for a track with no audible start)
+    if (partialListener) {
+        startFound = true;
+        publishPartial(true);
+    }
+
+    summary.audioStartOffsetSec = (double) audioStartSample / summary.sampleRate;
+    // A post-roll like the start's pre-roll keeps a decaying tail; a silent track ends where it does
+    const int postRoll = (int) std::round(0.02 * summary.sampleRate); // 20 ms
+    const int64 endSample = audioEndSample > audioStartSample ? std::min(summary.totalSamples, audioEndSample + postRoll)
+                                                              : summary.totalSamples;
+    summary.audioEndOffsetSec = (double) endSample / summary.sampleRate;
+    summary.levels.clear();
+    summary.levels.push_back(std::move(base));
+    WaveformCache::buildLevels(summary);
+}
+
+WaveformGenerator::WaveformGenerator()
+    : cache(getCacheDirectory())
+{
+}
+
+void WaveformGenerator::setCacheDirectory(const juce::File& directory)
+{
+    std::lock_guard<std::mutex> lock(cacheDirectoryMutex);
+    cacheDirectory() = directory;
+}
+
+juce::File WaveformGenerator::getCacheDirectory()
+{
+    std::lock_guard<std::mutex> lock(cacheDirectoryMutex);
+    return cacheDirectory();
+}
+
+bool WaveformGenerator::claimAnalysis(const juce::File& file)
+{
+    std::lock_guard<std::mutex> lock(inFlightMutex);
+    return inFlight.insert(file.getFullPathName()).second;
+}
+
+void WaveformGenerator::releaseAnalysis(const juce::File& file)
+{
+    {
+        std::lock_guard<std::mutex> lock(inFlightMutex);
+        inFlight.erase(file.getFullPathName());
+    }
+    inFlightDone.notify_all();
+}
+
+bool WaveformGenerator::loadCached(const juce::File& file, int binCount, Result& out) const
+{
+    double audioStart = 0.0, audioEnd = 0.0, sampleRate = 0.0;
+    int64 totalSamples = 0;
+    if (!cache.load(file, binCount, out.minBins, out.maxBins, audioStart, totalSamples, sampleRate, &out.bands, &audioEnd))
+        return false;
+    out.audioStartOffsetSec = audioStart;
+    out.audioEndOffsetSec = audioEnd;
+    out.totalSamples = totalSamples;
+    out.sampleRate = (int) sampleRate;
+    out.lengthSeconds = (double) totalSamples / sampleRate;
+    out.pyramid = buildPyramid(out.minBins, out.maxBins, out.bands);
+    out.updateMemoryUsage();
+    return true;
+}
+
+void WaveformGenerator::publish(const juce::File& file, const WaveformCache::Summary& summary, int binCount, Result& out) const
+{
+    cache.store(file, summary);
+    fillResult(summary, binCount, out);
+}
+
+void WaveformGenerator::fillResult(const WaveformCache::Summary& summary, int binCount, Result& out)
+{
+    std::vector<WaveformCache::LevelView> views;
+    for (const auto& level : summary.levels)
+        views.push_back({ level.minMax.data(),
+                          level.bands.size() == (size_t) level.numBins() * WaveformCache::NumBands ? level.bands.data() : nullptr,
+                          level.numBins(), level.samplesPerBin });
+    const auto startSample = (int64) std::llround(summary.audioStartOffsetSec * summary.sampleRate);
+    WaveformCache::resample(views.data(), (int) views.size(), startSample, summary.totalSamples,
+                            binCount, out.minBins, out.maxBins, &out.bands);
+
+    out.audioStartOffsetSec = summary.audioStartOffsetSec;
+    out.audioEndOffsetSec = summary.audioEndOffsetSec;
+    out.totalSamples = summary.totalSamples;
+    out.sampleRate = (int) summary.sampleRate;
+    out.lengthSeconds = (double) summary.totalSamples / summary.sampleRate;
+    out.pyramid = buildPyramid(out.minBins, out.maxBins, out.bands);
+    out.updateMemoryUsage();
+}
+
+void WaveformGenerator::Result::updateMemoryUsage()
+{
+    size_t bytes = minBins.capacity() + maxBins.capacity() + bands.capacity();
+    for (const auto& level : pyramid)
+        bytes += level.minBins.capacity() + level.maxBins.capacity() + level.bands.capacity();
+    memory.resize((int64_t) (bytes + pyramid.capacity() * sizeof(Level)));
+}
+
+std::vector<WaveformGenerator::Result::Level> WaveformGenerator::buildPyramid(const std::vector<std::int8_t>& minBins,
+                                                                              const std::vector<std::int8_t>& maxBins,
+                                                                              const std::vector<std::uint8_t>& bands)
+{
+    constexpr size_t nb = (size_t) WaveformCache::NumBands;
+    std::vector<Result::Level> pyramid;
+    const std::vector<std::int8_t>* finerMin = &minBins;
+    const std::vector<std::int8_t>* finerMax = &maxBins;
+    const std::vector<std::uint8_t>* finerBands = &bands;
+    while (finerMin->size() == finerMax->size() && finerMin->size() / 2 >= (size_t) MinPyramidBins) {
+        const size_t bins = (finerMin->size() + 1) / 2;
+        const bool hasBands = finerBands->size() == finerMin->size() * nb;
+        Result::Level level;
+        level.minBins.resize(bins);
+        level.maxBins.resize(bins);
+        if (hasBands) level.bands.resize(bins * nb);
+        for (size_t i = 0; i < bins; ++i) {
+            const size_t a = i * 2, b = std::min(a + 1, finerMin->size() - 1);
+            level.minBins[i] = std::min((*finerMin)[a], (*finerMin)[b]);
+            level.maxBins[i] = std::max((*finerMax)[a], (*finerMax)[b]);
+            if (hasBands)
+                for (size_t k = 0; k < nb; ++k)
+                    level.bands[i * nb + k] = (std::uint8_t) (((*finerBands)[a * nb + k] + (*finerBands)[b * nb + k] + 1) / 2);
         }
-        processed += toRead;
+        pyramid.push_back(std::move(level));
+        finerMin = &pyramid.back().minBins;
+        finerMax = &pyramid.back().maxBins;
+        finerBands = &pyramid.back().bands;
     }
-    
-    // NO post-processing! Keep the real waveform min/max values
-    // This is how Serato/Rekordbox actually work - they show the real audio waveform
+    return pyramid;
+}
+
+bool WaveformGenerator::generate(const juce::File& file,
+                                 int binCount,
+                                 Result& out,
+                                 float silenceThreshold,
+                                 int consecutiveChunksNeeded)
+{
+    if (binCount <= 0) return false;
+    EVENT_TRACE_SCOPE("WaveformGenerator::generate", "waveform");
+
+    const bool cacheable = silenceThreshold == DefaultSilenceThreshold
+                        && consecutiveChunksNeeded == DefaultConsecutiveChunks;
+    struct ReleaseGuard {
+        const juce::File* file{nullptr};
+        ~ReleaseGuard() { if (file != nullptr) WaveformGenerator::releaseAnalysis(*file); }
+    } guard;
+
+    if (cacheable) {
+        const juce::String key = file.getFullPathName();
+        std::unique_lock<std::mutex> lock(inFlightMutex);
+        inFlightDone.wait(lock, [&key] { return inFlight.count(key) == 0; });
+        if (loadCached(file, binCount, out)) return true;
+        inFlight.insert(key);
+        guard.file = &file;
+    }
+
+    auto reader = DecoderRegistry::getInstance().acquireReader(file);
+    if (!reader) return false;
+
+    SummaryBuilder builder(silenceThreshold, consecutiveChunksNeeded);
+    TrackDecodePipeline pipeline(*reader);
+    pipeline.addSink(&builder);
+    pipeline.run();
+    if (!builder.isComplete()) return false;
+
+    if (cacheable) publish(file, builder.getSummary(), binCount, out);
+    else fillResult(builder.getSummary(), binCount, out);
     return true;
 }
@@ -1,29 +1,146 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <JuceHeader.h>
+#include "MemoryBudget.h"
+#include "TrackDecodePipeline.h"
+#include "WaveformCache.h"
 
 class WaveformGenerator {
 public:
+    // Bins stay quantised as in the cache, one byte per value (WaveformCache::amplitude() and
+    // energy() give the levels); the displays upload them to the GPU as they are
     struct Result {
-        std::vector<float> minBins;   // signed min per bin [-1..0]
-        std::vector<float> maxBins;   // signed max per bin [0..1]
+        std::vector<std::int8_t> minBins;   // signed min per bin [-127..0]
+        std::vector<std::int8_t> maxBins;   // signed max per bin [0..127]
         double audioStartOffsetSec{0.0};
+        double audioEndOffsetSec{0.0};      // end of the last audible chunk; the deck's auto-cue uses the start
         double lengthSeconds{0.0};
         int sampleRate{0};
         int64 totalSamples{0};
+        // Low, mid, high energy per bin (x255), WaveformCache::NumBands values per bin
+        std::vector<std::uint8_t> bands;
+        // Zoom pyramid: coarser copies of minBins/maxBins, each with half the bins of the one before
+        struct Level {
+            std::vector<std::int8_t> minBins;
+            std::vector<std::int8_t> maxBins;
+            std::vector<std::uint8_t> bands;
+        };
+        std::vector<Level> pyramid;
+        // Bins and pyramid counted against the Waveforms pool; refreshed once they are filled
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::Waveforms};
+        void updateMemoryUsage();
+    };
+    // Finished results are handed to the displays as one shared, immutable object
+    using SharedResult = std::shared_ptr<const Result>;
+
+    static constexpr float DefaultSilenceThreshold = 0.02f;
+    static constexpr int DefaultConsecutiveChunks = 3;
+    static constexpr int MinPyramidBins = 64;
+
+    // Crossovers splitting the mono mix into the low / mid / high bands
+    static constexpr double LowCrossoverHz = 250.0;
+    static constexpr double HighCrossoverHz = 2500.0;
+
+    static std::vector<Result::Level> buildPyramid(const std::vector<std::int8_t>& minBins,
+                                                   const std::vector<std::int8_t>& maxBins,
+                                                   const std::vector<std::uint8_t>& bands = {});
+
+    // Audible start and end and the finest summary level, built from one decode pass
+    class SummaryBuilder : public TrackDecodePipeline::Sink {
+    public:
+        SummaryBuilder(float silenceThreshold = DefaultSilenceThreshold,
+                       int consecutiveChunksNeeded = DefaultConsecutiveChunks);
+        void prepare(const juce::AudioFormatReader& reader) override;
+        void consume(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position) override;
+        void finish(bool completed) override;
+        // Valid after a completed pass; coarser levels included
+        bool isComplete() const { return complete; }
+        WaveformCache::Summary& getSummary() { return summary; }
+
+        // Bins of the final binCount-bin layout as soon as the pass has decoded them, so a
+        // display can show the intro while the rest of the track is still being read. Called
+        // on the decoding thread, first once the audible start is known, then every
+        // binCount / PartialSteps bins. Bins are final; the listener only sees each one once.
+        struct Partial {
+            int binCount{0};
+            int firstBin{0};
+            std::vector<std::int8_t> minBins;
+            std::vector<std::int8_t> maxBins;
+            double audioStartOffsetSec{0.0};
+            double lengthSeconds{0.0};
+        };
+        static constexpr int PartialSteps = 64;
+        void setPartialListener(int binCount, std::function<void(Partial&&)> listener);
+
+    private:
+        void detectSilence(const juce::AudioBuffer<float>& block, int numSamples, juce::int64 position);
+        void flushBin();
+        void publishPartial(bool final);
+
+        float silenceThreshold;
+        int consecutiveChunksNeeded;
+        WaveformCache::Summary summary;
+        WaveformCache::Level base;
+        MemoryBudget::Allocation memory{MemoryBudget::Pool::Analysis};
+        bool complete{false};
+        // RMS silence detection over fine chunks, across the whole pass
+        int consecutive{0};
+        bool startFound{false};
+        juce::int64 audioStartSample{0};
+        juce::int64 audioEndSample{0};      // end of the last chunk above the threshold
+        double rmsSum{0.0};
+        int rmsCount{0};
+        juce::int64 rmsChunkStart{0};
+        // Bin being filled
+        juce::int64 currentBin{0};
+        float binMin{0.0f}, binMax{0.0f};
+        std::vector<float> mono;
+        // One-pole crossovers and the band energy of the bin being filled
+        float lowCoeff{0.0f}, highCoeff{0.0f};
+        float lowState{0.0f}, highState{0.0f};
+        std::array<float, WaveformCache::NumBands> bandSum{};
+        int binSamples{0};
+        // Progressive output
+        std::function<void(Partial&&)> partialListener;
+        int partialBinCount{0};
+        int partialBinsSent{0};
     };
 
     WaveformGenerator();
+
+    // Where every generator keeps its waveform summaries. The app points it at
+    // AppConfig::getWaveformCacheDirectory() at startup; until then it is a folder in the temp
+    // directory, so headless tools need no configuration.
+    static void setCacheDirectory(const juce::File& directory);
+    static juce::File getCacheDirectory();
+
     // binCount: number of horizontal bins desired
     // silenceThreshold: RMS threshold to detect start of audible content (0..1)
     // consecutiveChunksNeeded: number of consecutive chunks above threshold
+    // With the default thresholds the summary is shared through the waveform cache, so a known
+    // track is answered without decoding and concurrent requests for one file analyse it once.
     bool generate(const juce::File& file,
                   int binCount,
                   Result& out,
-                  float silenceThreshold = 0.02f,
-                  int consecutiveChunksNeeded = 3);
+                  float silenceThreshold = DefaultSilenceThreshold,
+                  int consecutiveChunksNeeded = DefaultConsecutiveChunks);
+
+    // For a shared decode pass: claim the file so generate() elsewhere waits for its summary
+    // instead of decoding too, then publish and release. claimAnalysis() is false if another
+    // pass already owns the file.
+    static bool claimAnalysis(const juce::File& file);
+    static void releaseAnalysis(const juce::File& file);
+    bool loadCached(const juce::File& file, int binCount, Result& out) const;
+    // Stores a default-threshold summary in the cache and fills `out` from it
+    void publish(const juce::File& file, const WaveformCache::Summary& summary, int binCount, Result& out) const;
 
 private:
-    juce::AudioFormatManager formatManager;
+    static void fillResult(const WaveformCache::Summary& summary, int binCount, Result& out);
+
+    WaveformCache cache;
 };
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QImage>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Software waveform rasterizer: min/max columns written straight into a QImage.
+ *
+ * A waveform column is one vertical span per x, so instead of tessellating a filled path the
+ * image is walked one scanline at a time. Each row is a branch-free select over all columns
+ * (inside the span: fill colour, on its first or last rows: outline colour, else left as it
+ * was), which the compiler turns into compare-and-blend vector code; the loop is built for
+ * AVX2 and AVX-512 too (SimdDispatch.h). Only the rows some span reaches are visited.
+ *
+ * Used where the GL path is unavailable or slow: the QPainter fallback tiles of
+ * WaveformDisplay and the overview strip of DeckWaveformOverview (GlResources::gpuWaveforms).
+ * Pure CPU, any thread.
+ */
+namespace WaveformRaster {
+    // One span per column: rows [top, bottom), top == bottom for an empty column. Colours are
+    // premultiplied ARGB32 (qPremultiply), per column (bands) or per row (a vertical gradient).
+    struct Columns {
+        std::vector<std::int32_t> top;
+        std::vector<std::int32_t> bottom;
+        std::vector<quint32> colour;     // per column; empty: rowColours decides
+        void resize(int width);
+        int width() const { return (int) top.size(); }
+    };
+
+    // Into `image` (Format_ARGB32_Premultiplied, at least columns.width() wide), rows outside
+    // the image clipped. rowColours has image.height() entries and is used when the columns
+    // carry no colour; outlineRows of `outline` close each span at both ends (0: none).
+    void fill(QImage& image, const Columns& columns, const std::vector<quint32>& rowColours,
+              quint32 outline, int outlineRows);
+
+    // A vertical gradient through `stops` (at 0..1 down the image), premultiplied, one per row
+    std::vector<quint32> verticalGradient(int height, const std::vector<std::pair<float, QRgb>>& stops);
+}
@@ -0,0 +1,431 @@
+#include "WaveformRenderer.h"
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "GlResources.h"
+#include "WaveformShaders.h"
+#include <QCoreApplication>
+#include <QExposeEvent>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLPaintDevice>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QPainter>
+#include <QPlatformSurfaceEvent>
+#include <QResizeEvent>
+#include <QScreen>
+#include <QVector2D>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+class WaveformRenderer::RenderThread : public QThread {
+public:
+    explicit RenderThread(WaveformRenderer& owner) : owner(owner) {}
+
+private:
+    void run() override { owner.renderLoop(); }
+    WaveformRenderer& owner;
+};
+
+// This context's objects; a frame draws from these and the latest scene
+struct WaveformRenderer::Gl {
+    QOpenGLExtraFunctions* f{nullptr};
+    std::unique_ptr<QOpenGLShaderProgram> waveProgram;
+    std::unique_ptr<QOpenGLShaderProgram> beatProgram;
+    QOpenGLBuffer quadVbo{ QOpenGLBuffer::VertexBuffer };
+    QOpenGLVertexArrayObject waveVao;
+    QOpenGLBuffer beatInstances{ QOpenGLBuffer::VertexBuffer };
+    QOpenGLVertexArrayObject beatVao;
+    int beatCount{0};
+    std::shared_ptr<const WaveformDisplay::GridLines> uploadedGrid;
+
+    GLuint minMax{0};
+    GLuint bands{0};
+    std::vector<int> levelTexelOffsets;
+    bool hasBands{false};
+    bool uploaded{false};
+    WaveformGenerator::SharedResult uploadedSource;
+    MemoryBudget::Allocation memory{MemoryBudget::Pool::GpuTextures};
+};
+
+WaveformRenderer::WaveformRenderer(WaveformDisplay* view, const DJAudioPlayer* player)
+    : view(view), player(player)
+{
+    setSurfaceType(QWindow::OpenGLSurface);
+    // The view's own format: the same GL version, multisampling and vsync
+    QSurfaceFormat fmt = view->format();
+    fmt.setSwapInterval(1);
+    setFormat(fmt);
+    updateGeometry();
+    QObject::connect(this, &QWindow::screenChanged, this, [this](QScreen*) { updateGeometry(); });
+    thread = std::make_unique<RenderThread>(*this);
+    thread->start(QThread::HighPriority);
+}
+
+WaveformRenderer::~WaveformRenderer()
+{
+    stop();
+}
+
+bool WaveformRenderer::isSupported()
+{
+    return QOpenGLContext::supportsThreadedOpenGL();
+}
+
+void WaveformRenderer::setScene(std::shared_ptr<const WaveformDisplay::Scene> latest)
+{
+    std::lock_guard<std::mutex> guard(sceneLock);
+    scene = std::move(latest);
+}
+
+void WaveformRenderer::stop()
+{
+    if (!thread) return;
+    stopping.store(true);
+    {
+        // Taken so the thread is either in a frame or waiting, not between the two
+        std::lock_guard<std::mutex> guard(surfaceLock);
+    }
+    wake.notify_all();
+    thread->wait();
+    thread.reset();
+}
+
+bool WaveformRenderer::event(QEvent* event)
+{
+    switch (event->type()) {
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseButtonRelease:
+        case QEvent::MouseButtonDblClick:
+        case QEvent::MouseMove:
+        case QEvent::Wheel:
+        case QEvent::KeyPress:
+        case QEvent::KeyRelease:
+            // The window covers the view exactly, so positions need no mapping
+            QCoreApplication::sendEvent(view, event);
+            return true;
+        case QEvent::PlatformSurface: {
+            const auto type = static_cast<QPlatformSurfaceEvent*>(event)->surfaceEventType();
+            {
+                // Waits for a frame in progress: the thread never draws into a surface being destroyed
+                std::lock_guard<std::mutex> guard(surfaceLock);
+                hasSurface = type == QPlatformSurfaceEvent::SurfaceCreated;
+            }
+            wake.notify_all();
+            break;
+        }
+        default:
+            break;
+    }
+    return QWindow::event(event);
+}
+
+void WaveformRenderer::exposeEvent(QExposeEvent* event)
+{
+    Q_UNUSED(event);
+    updateGeometry();
+    {
+        std::lock_guard<std::mutex> guard(surfaceLock);
+        exposed = isExposed();
+    }
+    wake.notify_all();
+}
+
+void WaveformRenderer::resizeEvent(QResizeEvent* event)
+{
+    QWindow::resizeEvent(event);
+    updateGeometry();
+}
+
+void WaveformRenderer::updateGeometry()
+{
+    logicalWidth.store(width());
+    logicalHeight.store(height());
+    pixelRatio.store(devicePixelRatio());
+    if (QScreen* s = screen()) refreshHz.store(s->refreshRate() > 1.0 ? s->refreshRate() : FallbackRefreshHz);
+}
+
+void WaveformRenderer::renderLoop()
+{
+    // Objects before the context: should the surface be gone at the end, the context dies first
+    // and takes its objects with it
+    Gl gl;
+    QOpenGLContext context;
+    context.setFormat(requestedFormat());
+    if (!context.create()) {
+        std::cout << "WaveformRenderer: no GL context for the render thread" << std::endl;
+        failed.store(true);
+    }
+
+    bool ready = false;
+    double swapDelayNs = 0.0;
+    while (!failed.load() && !stopping.load()) {
+        std::unique_lock<std::mutex> lock(surfaceLock);
+        wake.wait(lock, [this] { return stopping.load() || (hasSurface && exposed); });
+        if (stopping.load()) break;
+        if (!context.makeCurrent(this)) {
+            lock.unlock();
+            QThread::msleep(50);
+            continue;
+        }
+        if (!ready) {
+            if (!initialiseGl(gl)) {
+                failed.store(true);
+                break;
+            }
+            ready = true;
+        }
+
+        // On screen one refresh after the swap this frame ends with, as FrameClock reckons it
+        const double periodNs = 1.0e9 / refreshHz.load(std::memory_order_relaxed);
+        const quint64 startNs = DeckMixer::nowNs();
+        renderFrame(gl, startNs + (quint64) (swapDelayNs + periodNs));
+        context.swapBuffers(this);
+        context.doneCurrent();
+        lock.unlock();
+
+        const double frameNs = (double) (DeckMixer::nowNs() - startNs);
+        if (frameNs < 2.0 * periodNs) swapDelayNs += 0.1 * (frameNs - swapDelayNs);
+        // A swap that doesn't wait for vsync (some drivers, hidden windows) would spin
+        if (frameNs < 0.5 * periodNs) QThread::usleep((unsigned long) ((periodNs - frameNs) / 1000.0));
+    }
+
+    if (ready) {
+        std::lock_guard<std::mutex> guard(surfaceLock);
+        if (hasSurface && context.makeCurrent(this)) {
+            releaseGl(gl);
+            context.doneCurrent();
+        }
+    }
+    if (failed.load()) {
+        // Back to the view drawing itself
+        QMetaObject::invokeMethod(view, [target = view]() { target->setThreadedRendering(nullptr); }, Qt::QueuedConnection);
+    }
+}
+
+bool WaveformRenderer::initialiseGl(Gl& gl)
+{
+    gl.f = QOpenGLContext::currentContext()->extraFunctions();
+    gl.f->initializeOpenGLFunctions();
+    // A CPU-emulated GL gains nothing from a thread of shaders; the view rasterizes instead
+    const auto* rendererName = reinterpret_cast<const char*>(gl.f->glGetString(GL_RENDERER));
+    if (rendererName && GlResources::isSoftwareRenderer(QString::fromLatin1(rendererName))) {
+        std::cout << "WaveformRenderer: " << rendererName << " renders in software, not threading the view" << std::endl;
+        return false;
+    }
+    // The view's programs built again for this context, from the same shader cache entries
+    gl.waveProgram = GlResources::buildProgram("WaveformDisplay.wave", WaveformShaders::WaveVertex, WaveformShaders::WaveFragment);
+    gl.beatProgram = GlResources::buildProgram("WaveformDisplay.beat", WaveformShaders::BeatVertex, WaveformShaders::BeatFragment);
+    if (!gl.waveProgram || !gl.beatProgram) return false;
+
+    const float corners[8] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+    gl.waveVao.create();
+    gl.waveVao.bind();
+    gl.quadVbo.create();
+    gl.quadVbo.bind();
+    gl.quadVbo.allocate(corners, sizeof(corners));
+    gl.waveProgram->bind();
+    gl.waveProgram->enableAttributeArray(0);
+    gl.waveProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2, sizeof(float) * 2);
+    gl.waveProgram->release();
+    gl.waveVao.release();
+
+    // Beat lines: the quad per instance, one (time, bar) pair each (WaveformDisplay::createBeatVao)
+    gl.beatVao.create();
+    gl.beatVao.bind();
+    gl.beatProgram->bind();
+    gl.beatProgram->enableAttributeArray(0);
+    gl.beatProgram->setAttributeBuffer(0, GL_FLOAT, 0, 2, sizeof(float) * 2);
+    gl.beatInstances.create();
+    gl.beatInstances.bind();
+    gl.beatInstances.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    gl.beatProgram->enableAttributeArray(1);
+    gl.beatProgram->setAttributeBuffer(1, GL_FLOAT, 0, 2, sizeof(float) * 2);
+    gl.f->glVertexAttribDivisor(1, 1);
+    gl.beatProgram->release();
+    gl.beatVao.release();
+    gl.beatInstances.release();
+    gl.quadVbo.release();
+
+    gl.f->glGenTextures(1, &gl.minMax);
+    gl.f->glGenTextures(1, &gl.bands);
+    for (GLuint tex : { gl.minMax, gl.bands }) {
+        gl.f->glBindTexture(GL_TEXTURE_2D, tex);
+        gl.f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        gl.f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl.f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl.f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    gl.f->glBindTexture(GL_TEXTURE_2D, 0);
+    std::cout << "WaveformRenderer: drawing " << view->objectName().toStdString() << " on its own thread" << std::endl;
+    return true;
+}
+
+void WaveformRenderer::releaseGl(Gl& gl)
+{
+    gl.waveProgram.reset();
+    gl.beatProgram.reset();
+    if (gl.quadVbo.isCreated()) gl.quadVbo.destroy();
+    if (gl.waveVao.isCreated()) gl.waveVao.destroy();
+    if (gl.beatInstances.isCreated()) gl.beatInstances.destroy();
+    if (gl.beatVao.isCreated()) gl.beatVao.destroy();
+    if (gl.minMax) gl.f->glDeleteTextures(1, &gl.minMax);
+    if (gl.bands) gl.f->glDeleteTextures(1, &gl.bands);
+    gl.minMax = gl.bands = 0;
+    gl.memory.resize(0);
+}
+
+void WaveformRenderer::renderFrame(Gl& gl, quint64 shownAtNs)
+{
+    const QSize size(logicalWidth.load(std::memory_order_relaxed), logicalHeight.load(std::memory_order_relaxed));
+    const qreal ratio = pixelRatio.load(std::memory_order_relaxed);
+    const QSize pixels((int) std::lround(size.width() * ratio), (int) std::lround(size.height() * ratio));
+    if (size.isEmpty()) return;
+    gl.f->glViewport(0, 0, pixels.width(), pixels.height());
+    gl.f->glClearColor(8/255.0f, 8/255.0f, 10/255.0f, 1.0f);
+    gl.f->glClear(GL_COLOR_BUFFER_BIT);
+
+    std::shared_ptr<const WaveformDisplay::Scene> current;
+    {
+        std::lock_guard<std::mutex> guard(sceneLock);
+        current = scene;
+    }
+
+    QOpenGLPaintDevice device(pixels);
+    device.setDevicePixelRatio(ratio);
+    QPainter p(&device);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    p.setRenderHint(QPainter::TextAntialiasing, true);
+
+    if (!current || !current->source || current->source->maxBins.empty() || current->audioLength <= 0.0) {
+        p.setPen(QPen(QColor(120, 120, 120), 1));
+        p.setFont(QFont("Arial", 12));
+        p.drawText(QRect(QPoint(0, 0), size), Qt::AlignCenter, "NO TRACK LOADED");
+        return;
+    }
+
+    // Where the deck is heard when this frame is shown, the user trim on top; the pointer's
+    // place while the view is scratched
+    double relative = current->playheadRelative;
+    if (!current->scratching) {
+        const auto trimNs = (qint64) (std::clamp(visualTrim.load(std::memory_order_relaxed), -0.05, 0.05) * 1.0e9);
+        relative = player->getPositionSnapshot().relativeAt((quint64) std::max<qint64>(0, (qint64) shownAtNs - trimNs));
+    }
+    const double playheadSec = WaveformDisplay::playheadSeconds(relative, current->prerollEnabled, current->prerollTimeSec,
+                                                                current->audioLength);
+    const WaveformDisplay::View layout = WaveformDisplay::layoutView(*current, size, playheadSec);
+    if (!layout.visible) return;
+
+    p.beginNativePainting();
+    drawWaveform(gl, *current, layout, size, ratio);
+    if (current->useAnalyzedBeats) drawBeatLines(gl, *current, layout, size, ratio);
+    p.endNativePainting();
+    WaveformDisplay::paintOverlays(p, *current, layout, size, current->useAnalyzedBeats);
+}
+
+void WaveformRenderer::uploadSummary(Gl& gl, const WaveformGenerator::SharedResult& source)
+{
+    gl.uploadedSource = source;
+    gl.uploaded = false;
+    std::vector<std::int8_t> minMax;
+    std::vector<std::uint8_t> bands;
+    const int rows = WaveformDisplay::packWaveTextures(*source, gl.levelTexelOffsets, minMax, bands);
+    if (rows == 0) return;
+    gl.hasBands = !bands.empty();
+    gl.f->glBindTexture(GL_TEXTURE_2D, gl.minMax);
+    gl.f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8_SNORM, WaveformDisplay::WaveTextureWidth, rows, 0, GL_RG, GL_BYTE, minMax.data());
+    if (gl.hasBands) {
+        gl.f->glBindTexture(GL_TEXTURE_2D, gl.bands);
+        gl.f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, WaveformDisplay::WaveTextureWidth, rows, 0, GL_RGB, GL_UNSIGNED_BYTE, bands.data());
+    }
+    gl.f->glBindTexture(GL_TEXTURE_2D, 0);
+    gl.memory.resize((int64_t) (minMax.size() + bands.size()));
+    gl.uploaded = true;
+}
+
+void WaveformRenderer::drawWaveform(Gl& gl, const WaveformDisplay::Scene& s, const WaveformDisplay::View& v,
+                                    const QSize& size, qreal ratio)
+{
+    if (gl.uploadedSource != s.source) uploadSummary(gl, s.source);
+    if (!gl.uploaded) return;
+
+    // Same uniforms as WaveformDisplay::drawWaveTextures over the whole window
+    const WaveformGenerator::Result& wave = *s.source;
+    const qreal detail = WaveformDisplay::detailPixelRatio(ratio, s.waveformQuality);
+    const size_t levelIndex = std::min(WaveformDisplay::levelForBinsPerDetail(wave, v.binsPerPixel / detail),
+                                       gl.levelTexelOffsets.size() - 1);
+    const int levelBins = levelIndex == 0 ? (int) wave.maxBins.size() : (int) wave.pyramid[levelIndex - 1].maxBins.size();
+    gl.f->glViewport(0, 0, (GLsizei) std::lround(size.width() * ratio), (GLsizei) std::lround(size.height() * ratio));
+    gl.f->glEnable(GL_BLEND);
+    gl.f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    QOpenGLShaderProgram& program = *gl.waveProgram;
+    program.bind();
+    gl.f->glActiveTexture(GL_TEXTURE0);
+    gl.f->glBindTexture(GL_TEXTURE_2D, gl.minMax);
+    gl.f->glActiveTexture(GL_TEXTURE1);
+    gl.f->glBindTexture(GL_TEXTURE_2D, gl.bands);
+    program.setUniformValue("uMinMax", 0);
+    program.setUniformValue("uBands", 1);
+    program.setUniformValue("uHasBands", gl.hasBands);
+    program.setUniformValue("uTexWidth", WaveformDisplay::WaveTextureWidth);
+    program.setUniformValue("uResolution", QVector2D((float) size.width(), (float) size.height()));
+    program.setUniformValue("uViewOrigin", QVector2D(0.0f, 0.0f));
+    program.setUniformValue("uPixelRatio", (float) ratio);
+    program.setUniformValue("uBinOrigin", (float) v.binOrigin);
+    program.setUniformValue("uBinsPerPixel", (float) v.binsPerPixel);
+    program.setUniformValue("uDetailRatio", (float) detail);
+    program.setUniformValue("uBaseBins", (int) wave.maxBins.size());
+    program.setUniformValue("uLevelOffset", gl.levelTexelOffsets[levelIndex]);
+    program.setUniformValue("uLevelBins", levelBins);
+    program.setUniformValue("uLevelScale", (float) std::ldexp(1.0, (int) levelIndex));
+    program.setUniformValue("uOutlineWidth", v.outlineWidth);
+
+    gl.waveVao.bind();
+    gl.f->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    gl.waveVao.release();
+    gl.f->glBindTexture(GL_TEXTURE_2D, 0);
+    gl.f->glActiveTexture(GL_TEXTURE0);
+    gl.f->glBindTexture(GL_TEXTURE_2D, 0);
+    program.release();
+}
+
+void WaveformRenderer::drawBeatLines(Gl& gl, const WaveformDisplay::Scene& s, const WaveformDisplay::View& v,
+                                     const QSize& size, qreal ratio)
+{
+    if (!s.grid) return;
+    if (gl.uploadedGrid != s.grid) {
+        // Beats at the very start are left to the preroll "0" line (WaveformDisplay::uploadBeatInstances)
+        std::vector<float> values;
+        values.reserve(s.grid->times.size() * 2);
+        for (size_t i = 0; i < s.grid->times.size(); ++i) {
+            if (s.grid->times[i] <= 0.1) continue;
+            values.push_back((float) s.grid->times[i]);
+            values.push_back(s.grid->isBar[i] ? 1.0f : 0.0f);
+        }
+        gl.beatInstances.bind();
+        gl.beatInstances.allocate(values.data(), (int) (values.size() * sizeof(float)));
+        gl.beatInstances.release();
+        gl.beatCount = (int) (values.size() / 2);
+        gl.uploadedGrid = s.grid;
+    }
+    if (gl.beatCount <= 0) return;
+
+    gl.f->glViewport(0, 0, (GLsizei) std::lround(size.width() * ratio), (GLsizei) std::lround(size.height() * ratio));
+    gl.f->glEnable(GL_BLEND);
+    gl.f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    QOpenGLShaderProgram& program = *gl.beatProgram;
+    program.bind();
+    program.setUniformValue("uResolution", QVector2D((float) size.width(), (float) size.height()));
+    program.setUniformValue("uVisualOffset", (float) v.visualOffset);
+    program.setUniformValue("uVisualScale", (float) v.visualScale);
+    program.setUniformValue("uLeftSecond", (float) v.leftSecond);
+    program.setUniformValue("uTimeRange", (float) v.timeRange);
+    gl.beatVao.bind();
+    gl.f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, gl.beatCount);
+    gl.beatVao.release();
+    program.release();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QWindow>
+#include <QThread>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "WaveformDisplay.h"
+
+class DJAudioPlayer;
+
+/**
+ * A scrolling deck waveform drawn on a thread of its own (WaveformDisplay::setThreadedRendering).
+ *
+ * The window sits over its WaveformDisplay, which keeps the state and the input (handed on from
+ * here): once per FrameClock tick the view hands over an immutable Scene. The thread owns a GL
+ * context on the window and loops on its swaps, paced by vsync. Each frame reads the deck's
+ * position snapshot for the moment the frame reaches the screen, lays the latest scene out
+ * around that playhead and draws it with the view's shaders and overlays. Nothing in the loop
+ * waits for the GUI thread, so a stalled one (a library re-sort, a dialog opening) only holds
+ * back what changes in the scene (a new cue, a zoom step) and never the scrolling.
+ *
+ * The summary is uploaded into this context's own textures, once per summary (the GlResources
+ * copies belong to the GUI thread's share group). The GUI thread waits for a frame in progress
+ * only when the window's surface goes away and in stop().
+ */
+class WaveformRenderer : public QWindow {
+public:
+    // Frames when vsync doesn't block the swap are at least this far apart
+    static constexpr double FallbackRefreshHz = 60.0;
+
+    // `view` gets the input; `player` is read on the thread until stop() (neither owned)
+    WaveformRenderer(WaveformDisplay* view, const DJAudioPlayer* player);
+    ~WaveformRenderer() override;
+
+    // Whether the platform draws GL off the GUI thread at all
+    static bool isSupported();
+
+    // GUI thread
+    void setScene(std::shared_ptr<const WaveformDisplay::Scene> scene);
+    // Seconds the picture is delayed by (the user visual trim), -0.05..0.05
+    void setVisualTrim(double seconds) { visualTrim.store(seconds, std::memory_order_relaxed); }
+    // Joins the thread; the window stays blank from then on
+    void stop();
+
+protected:
+    bool event(QEvent* event) override;
+    void exposeEvent(QExposeEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    class RenderThread;
+    struct Gl;
+
+    // Render thread
+    void renderLoop();
+    bool initialiseGl(Gl& gl);
+    void releaseGl(Gl& gl);
+    void renderFrame(Gl& gl, quint64 shownAtNs);
+    void drawWaveform(Gl& gl, const WaveformDisplay::Scene& scene, const WaveformDisplay::View& view,
+                      const QSize& size, qreal pixelRatio);
+    void drawBeatLines(Gl& gl, const WaveformDisplay::Scene& scene, const WaveformDisplay::View& view,
+                       const QSize& size, qreal pixelRatio);
+    void uploadSummary(Gl& gl, const WaveformGenerator::SharedResult& source);
+
+    void updateGeometry();
+
+    WaveformDisplay* view;
+    const DJAudioPlayer* player;
+    std::unique_ptr<RenderThread> thread;
+    std::atomic<bool> failed{false};
+
+    std::mutex sceneLock;
+    std::shared_ptr<const WaveformDisplay::Scene> scene;
+
+    // Held by the thread for a frame; the surface only changes under it
+    std::mutex surfaceLock;
+    std::condition_variable wake;
+    bool hasSurface{false};
+    bool exposed{false};
+    std::atomic<bool> stopping{false};
+
+    std::atomic<int> logicalWidth{0};
+    std::atomic<int> logicalHeight{0};
+    std::atomic<double> pixelRatio{1.0};
+    std::atomic<double> refreshHz{FallbackRefreshHz};
+    std::atomic<double> visualTrim{0.0};
+};
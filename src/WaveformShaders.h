@@ -0,0 +1,145 @@
+#pragma once
+
+/**
+ * GLSL 3.3 sources of the waveform views: the scrolling WaveformDisplay and the thread that
+ * draws it (WaveformRenderer) compile the same programs, each in its own context.
+ */
+namespace WaveformShaders {
+    // Full-screen quad; the fragment shader maps each pixel to its bins
+    inline constexpr const char* WaveVertex = R"GLSL(
+        #version 330 core
+        layout(location=0) in vec2 aCorner; // [0,1]^2
+        void main(){
+            gl_Position = vec4(aCorner * 2.0 - 1.0, 0.0, 1.0);
+        }
+    )GLSL";
+    inline constexpr const char* WaveFragment = R"GLSL(
+        #version 330 core
+        uniform sampler2D uMinMax;   // r = min, g = max; signed normalized, so fetched as -1..1
+        uniform sampler2D uBands;    // rgb = low, mid, high energy per bin
+        uniform bool uHasBands;
+        uniform int uTexWidth;
+        uniform vec2 uResolution;    // logical pixels
+        uniform vec2 uViewOrigin;    // bottom left of the drawn area in the widget, logical pixels
+        uniform float uPixelRatio;
+        uniform float uBinOrigin;    // level 0 bin at x = 0
+        uniform float uBinsPerPixel; // level 0 bins per pixel
+        uniform float uDetailRatio;  // detail pixels per logical pixel (detailPixelRatio())
+        uniform int uBaseBins;
+        uniform int uLevelOffset;
+        uniform int uLevelBins;
+        uniform float uLevelScale;   // level 0 bins per level bin
+        uniform float uOutlineWidth;
+        out vec4 FragColor;
+
+        vec2 fetchMinMax(int i){
+            return texelFetch(uMinMax, ivec2(i % uTexWidth, i / uTexWidth), 0).rg;
+        }
+        // Hue from the band balance, brightness from the strongest band (WaveformDisplay::bandColour)
+        vec4 fetchColour(int i){
+            vec3 e = texelFetch(uBands, ivec2(i % uTexWidth, i / uTexWidth), 0).rgb;
+            float peak = max(max(e.r, e.g), max(e.b, 1e-4));
+            float brightness = 0.45 + 0.55 * min(1.0, peak * 1.6);
+            return vec4(brightness * (0.25 + 0.75 * e / peak), 170.0 / 255.0);
+        }
+
+        void main(){
+            vec2 pos = gl_FragCoord.xy / uPixelRatio - uViewOrigin;
+            float bin = uBinOrigin + pos.x * uBinsPerPixel;
+            if (bin < 0.0 || bin >= float(uBaseBins)) discard;
+
+            vec2 mm = vec2(0.0);
+            int colourIndex;
+            float binsPerDetail = uBinsPerPixel / uDetailRatio;
+            if (binsPerDetail > 1.0) {
+                // Zoomed out: peaks of the level bins this pixel covers
+                float levelBin = bin / uLevelScale;
+                float span = binsPerDetail / uLevelScale;
+                int b0 = max(0, int(floor(levelBin - span)));
+                int b1 = min(uLevelBins, int(ceil(levelBin + span)) + 1);
+                for (int b = b0; b < b1 && b < b0 + 8; ++b) {
+                    vec2 v = fetchMinMax(uLevelOffset + b);
+                    mm = vec2(min(mm.x, v.x), max(mm.y, v.y));
+                }
+                colourIndex = uLevelOffset + min(uLevelBins - 1, int(levelBin));
+            } else {
+                // Zoomed in: interpolate between neighbouring source bins
+                int b = int(bin);
+                mm = mix(fetchMinMax(b), fetchMinMax(min(b + 1, uBaseBins - 1)), fract(bin));
+                colourIndex = b;
+            }
+
+            // Amplitude of this pixel, +1 at 45% of the height above the centre line
+            float scale = uResolution.y * 0.45;
+            float v = (pos.y - uResolution.y * 0.5) / scale;
+            float edge = min(abs(v - mm.y), abs(v - mm.x)) * scale;
+            bool inside = v >= mm.x && v <= mm.y;
+            if (!inside && edge > uOutlineWidth * 0.5) discard;
+
+            if (edge <= uOutlineWidth * 0.5) {
+                FragColor = vec4(120.0, 200.0, 255.0, 255.0) / 255.0;
+            } else if (uHasBands) {
+                FragColor = fetchColour(colourIndex);
+            } else {
+                float t = abs(v) * scale / (uResolution.y * 0.5);
+                FragColor = mix(vec4(60.0, 140.0, 220.0, 80.0), vec4(100.0, 180.0, 255.0, 140.0), t) / 255.0;
+            }
+        }
+    )GLSL";
+
+    // Spectrogram: the same quad; each pixel looks its column up in the ring, its band by height
+    inline constexpr const char* SpectrogramFragment = R"GLSL(
+        #version 330 core
+        uniform sampler2D uRing;         // r = band level; a row per column, wrapping every uRingColumns
+        uniform sampler2D uColourMap;
+        uniform int uRingColumns;
+        uniform int uNumBands;
+        uniform vec2 uResolution;        // logical pixels
+        uniform float uPixelRatio;
+        uniform float uColumnOrigin;     // column at x = 0
+        uniform float uColumnsPerPixel;
+        uniform float uFirstColumn;      // the columns in the ring
+        uniform float uEndColumn;
+        out vec4 FragColor;
+
+        void main(){
+            vec2 pos = gl_FragCoord.xy / uPixelRatio;
+            float column = uColumnOrigin + pos.x * uColumnsPerPixel;
+            if (column < uFirstColumn || column >= uEndColumn) discard;
+            // Lowest band at the bottom; column c is centred on c + 0.5, like its texel
+            float band = clamp(pos.y / uResolution.y, 0.0, 1.0) * float(uNumBands - 1) + 0.5;
+            float level = texture(uRing, vec2(band / float(uNumBands), column / float(uRingColumns))).r;
+            FragColor = texture(uColourMap, vec2(level * (255.0 / 256.0) + 0.5 / 256.0, 0.5));
+        }
+    )GLSL";
+
+    // Beat lines: one quad per beat, placed from the beat time by the vertex shader
+    inline constexpr const char* BeatVertex = R"GLSL(
+        #version 330 core
+        layout(location=0) in vec2 aCorner;
+        layout(location=1) in vec2 aBeat;    // track seconds, 1 = bar line
+        uniform vec2 uResolution;
+        uniform float uVisualOffset;         // visual time = offset + beat * scale
+        uniform float uVisualScale;
+        uniform float uLeftSecond;
+        uniform float uTimeRange;
+        out vec4 vColour;
+        void main(){
+            bool bar = aBeat.y > 0.5;
+            float visual = uVisualOffset + aBeat.x * uVisualScale;
+            float x = floor((visual - uLeftSecond) / uTimeRange * uResolution.x);
+            x += (aCorner.x - 0.5) * (bar ? 3.0 : 1.5);
+            float halfHeight = bar ? 1.0 : 1.0 / 3.0;
+            gl_Position = vec4(x / uResolution.x * 2.0 - 1.0, (aCorner.y * 2.0 - 1.0) * halfHeight, 0.0, 1.0);
+            vColour = bar ? vec4(255.0, 150.0, 50.0, 200.0) / 255.0 : vec4(200.0, 220.0, 255.0, 160.0) / 255.0;
+        }
+    )GLSL";
+    inline constexpr const char* BeatFragment = R"GLSL(
+        #version 330 core
+        in vec4 vColour;
+        out vec4 FragColor;
+        void main(){
+            FragColor = vColour;
+        }
+    )GLSL";
+}
@@ -0,0 +1,158 @@
+#include "WaveformThumbnails.h"
+#include "WaveformCache.h"
+#include "WaveformGenerator.h"
+#include <QGuiApplication>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int CellsPerPage = WaveformThumbnails::AtlasColumns * WaveformThumbnails::AtlasRows;
+    const QColor PeakColour(100, 180, 255);
+}
+
+WaveformThumbnails& WaveformThumbnails::instance()
+{
+    static WaveformThumbnails thumbnails;
+    return thumbnails;
+}
+
+WaveformThumbnails::WaveformThumbnails()
+{
+    // Rendered for the main screen; the atlas is blitted, never scaled, on screens like it
+    pixelRatio = std::max<qreal>(1.0, qApp ? qApp->devicePixelRatio() : 1.0);
+    pool.setMaxThreadCount(1);
+    pool.setExpiryTimeout(30000);
+}
+
+WaveformThumbnails::~WaveformThumbnails()
+{
+    {
+        QMutexLocker locker(&queueLock);
+        queue.clear();
+    }
+    pool.clear();
+    pool.waitForDone();
+}
+
+QRect WaveformThumbnails::cellRect(int cell) const
+{
+    const int w = (int) std::lround(Width * pixelRatio);
+    const int h = (int) std::lround(Height * pixelRatio);
+    const int inPage = cell % CellsPerPage;
+    return QRect((inPage % AtlasColumns) * w, (inPage / AtlasColumns) * h, w, h);
+}
+
+bool WaveformThumbnails::find(const QString& filePath, const QPixmap*& page, QRect& cell)
+{
+    const auto it = cellByPath.constFind(filePath);
+    if (it != cellByPath.constEnd()) {
+        cells[(size_t) it.value()].lastUsed = ++clock;
+        page = &pages[(size_t) (it.value() / CellsPerPage)];
+        cell = cellRect(it.value());
+        return true;
+    }
+    if (!filePath.isEmpty() && !failed.contains(filePath)) request(filePath);
+    return false;
+}
+
+void WaveformThumbnails::request(const QString& filePath)
+{
+    QMutexLocker locker(&queueLock);
+    if (requested.contains(filePath)) return;
+    requested.insert(filePath);
+    queue.push_back(filePath);
+    // Rows scrolled past long ago are asked for again if they come back into view
+    while ((int) queue.size() > MaxQueued) {
+        requested.remove(queue.front());
+        queue.pop_front();
+    }
+    if (!workerRunning) {
+        workerRunning = true;
+        pool.start([this]() { runQueue(); });
+    }
+}
+
+void WaveformThumbnails::runQueue()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    for (;;) {
+        QString filePath;
+        {
+            QMutexLocker locker(&queueLock);
+            if (queue.empty()) {
+                workerRunning = false;
+                return;
+            }
+            filePath = queue.back();
+            queue.pop_back();
+        }
+        const QImage image = render(filePath);
+        QMetaObject::invokeMethod(this, [this, filePath, image]() { place(filePath, image); }, Qt::QueuedConnection);
+    }
+}
+
+QImage WaveformThumbnails::render(const QString& filePath) const
+{
+    // A cached summary is resampled without decoding; otherwise this analyses the track once
+    const int columns = (int) std::lround(Width * pixelRatio);
+    WaveformGenerator generator;
+    WaveformGenerator::Result wave;
+    if (!generator.generate(juce::File(filePath.toStdString()), columns, wave) || wave.maxBins.empty()) return QImage();
+
+    const int rows = (int) std::lround(Height * pixelRatio);
+    QImage image(columns, rows, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter p(&image);
+    const float centre = rows * 0.5f;
+    for (int x = 0; x < columns && x < (int) wave.maxBins.size(); ++x) {
+        const float top = centre - WaveformCache::amplitude(wave.maxBins[(size_t) x]) * centre;
+        const float bottom = centre - WaveformCache::amplitude(wave.minBins[(size_t) x]) * centre;
+        const int y0 = (int) std::floor(top);
+        p.fillRect(x, y0, 1, std::max(1, (int) std::ceil(bottom) - y0), PeakColour);
+    }
+    return image;
+}
+
+void WaveformThumbnails::place(const QString& filePath, const QImage& image)
+{
+    {
+        QMutexLocker locker(&queueLock);
+        requested.remove(filePath);
+    }
+    if (image.isNull()) {
+        failed.insert(filePath);
+        return;
+    }
+    if (cellByPath.contains(filePath)) return;
+
+    int cell;
+    if ((int) cells.size() < MaxPages * CellsPerPage) {
+        cell = (int) cells.size();
+        cells.push_back({});
+        if (cell % CellsPerPage == 0) {
+            const QRect last = cellRect(CellsPerPage - 1);
+            pages.emplace_back(last.right() + 1, last.bottom() + 1);
+            pages.back().fill(Qt::transparent);
+            memory.resize(memory.getBytes() + (int64_t) pages.back().width() * pages.back().height() * 4);
+        }
+    } else {
+        // The least recently painted cell is off screen
+        const auto oldest = std::min_element(cells.begin(), cells.end(),
+            [](const Cell& a, const Cell& b) { return a.lastUsed < b.lastUsed; });
+        cell = (int) (oldest - cells.begin());
+        cellByPath.remove(oldest->filePath);
+    }
+    cells[(size_t) cell] = { filePath, ++clock };
+    cellByPath.insert(filePath, cell);
+
+    QPainter p(&pages[(size_t) (cell / CellsPerPage)]);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    const QRect rect = cellRect(cell);
+    p.fillRect(rect, Qt::transparent);
+    p.drawImage(rect.topLeft(), image);
+    p.end();
+    emit thumbnailReady(filePath);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QPixmap>
+#include <QRect>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <deque>
+#include <vector>
+#include "MemoryBudget.h"
+
+/**
+ * Mini overview waveforms for the library table's Waveform column.
+ *
+ * A thumbnail comes from the track's summary in the waveform cache: WaveformCache::load() at
+ * Width bins resamples the coarsest level that still has a bin per column, so only a few KB of
+ * the mapped file are read. It is drawn once into a cell of an atlas page, a QPixmap of
+ * AtlasColumns x AtlasRows cells, and the row delegate blits its cell; painting a row draws no
+ * waveform. Cells are reused least recently painted first, over at most MaxPages pages.
+ *
+ * Lookups run on a single pool thread at the lowest priority, newest request first (the rows
+ * in view), and only the last MaxQueued requests are kept, so a fast scroll doesn't leave a
+ * backlog. A track without a cached summary is analysed there (WaveformGenerator::generate,
+ * which also stores the summary a deck load reads later) or waits for the deck or
+ * LibraryAnalyzer pass already on it. Nothing is decoded on the GUI thread; the row shows a
+ * placeholder until thumbnailReady().
+ *
+ * GUI thread only, apart from the worker.
+ */
+class WaveformThumbnails : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int Width = 120;       // logical pixels
+    static constexpr int Height = 16;
+    static constexpr int AtlasColumns = 4;
+    static constexpr int AtlasRows = 64;
+    static constexpr int MaxPages = 2;
+    static constexpr int MaxQueued = 64;
+
+    static WaveformThumbnails& instance();
+
+    // The atlas page holding filePath's thumbnail and its cell there, in the page's device
+    // pixels; false if there is none yet, and a lookup is queued unless one failed before
+    bool find(const QString& filePath, const QPixmap*& page, QRect& cell);
+
+signals:
+    // A thumbnail asked for through find() is in the atlas now
+    void thumbnailReady(const QString& filePath);
+
+private:
+    WaveformThumbnails();
+    ~WaveformThumbnails() override;
+
+    struct Cell {
+        QString filePath;   // empty while unused
+        quint64 lastUsed{0};
+    };
+
+    void request(const QString& filePath);
+    void runQueue();
+    QImage render(const QString& filePath) const;
+    void place(const QString& filePath, const QImage& image);
+    QRect cellRect(int cell) const;
+
+    qreal pixelRatio{1.0};
+    std::vector<QPixmap> pages;
+    std::vector<Cell> cells;                // page * cellsPerPage + cell
+    QHash<QString, int> cellByPath;
+    QSet<QString> failed;                   // no summary and no way to make one, this session
+    quint64 clock{0};
+    MemoryBudget::Allocation memory{MemoryBudget::Pool::Waveforms};   // the atlas pages
+
+    QThreadPool pool;
+    QMutex queueLock;
+    std::deque<QString> queue;              // newest at the back
+    QSet<QString> requested;                // queued or being looked up
+    bool workerRunning{false};
+};
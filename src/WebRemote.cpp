@@ -0,0 +1,660 @@
+#include "WebRemote.h"
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "WaveformCache.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+ #include <sys/socket.h>
+#endif
+
+namespace {
+    constexpr size_t MaxRequestBytes = 8192;
+    constexpr juce::uint32 RequestTimeoutMs = 5000;
+    // The page only sends short commands
+    constexpr juce::uint64 MaxMessageBytes = 4096;
+    // How often a deck whose track has no summary yet looks for one
+    constexpr juce::uint32 SummaryProbeMs = 1000;
+    // Less of a ratio change than this (the sync trim at work) is left to the position check
+    constexpr double RatioTolerance = 1.0e-4;
+    constexpr const char* HandshakeGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    enum Opcode : juce::uint8 { Text = 0x1, Binary = 0x2, Close = 0x8, Ping = 0x9, Pong = 0xA };
+    enum MessageKind : juce::uint8 { StateMessage = 1, TileMessage = 2 };
+
+    // A peer gone mid-write must fail the write, not raise SIGPIPE in the whole process
+    bool writeAll(juce::StreamingSocket& socket, const void* data, size_t size)
+    {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+           #if JUCE_LINUX || JUCE_BSD
+            const auto sent = ::send(socket.getRawSocketHandle(), p, size, MSG_NOSIGNAL);
+           #else
+            const int sent = socket.write(p, (int) size);
+           #endif
+            if (sent <= 0) return false;
+            p += sent;
+            size -= (size_t) sent;
+        }
+        return true;
+    }
+
+    bool respond(juce::StreamingSocket& socket, const char* status, const char* type, const void* body, size_t size)
+    {
+        const juce::String head = juce::String("HTTP/1.1 ") + status + "\r\nContent-Type: " + type
+                                  + "\r\nContent-Length: " + juce::String((juce::int64) size)
+                                  + "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+        return writeAll(socket, head.toRawUTF8(), head.getNumBytesAsUTF8()) && writeAll(socket, body, size);
+    }
+
+    bool respond(juce::StreamingSocket& socket, const char* status)
+    {
+        return respond(socket, status, "text/plain", status, std::strlen(status));
+    }
+
+    juce::uint32 rotateLeft(juce::uint32 x, int bits) { return (x << bits) | (x >> (32 - bits)); }
+
+    // SHA-1 for the WebSocket handshake only (RFC 6455 4.2.2); JUCE has no SHA-1
+    std::array<juce::uint8, 20> sha1(const juce::String& text)
+    {
+        juce::MemoryOutputStream message;
+        message.write(text.toRawUTF8(), text.getNumBytesAsUTF8());
+        const juce::uint64 bits = (juce::uint64) message.getDataSize() * 8;
+        message.writeByte((char) 0x80);
+        while (message.getDataSize() % 64 != 56) message.writeByte(0);
+        message.writeInt64BigEndian((juce::int64) bits);
+
+        juce::uint32 h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        const auto* data = static_cast<const juce::uint8*>(message.getData());
+        for (size_t chunk = 0; chunk < message.getDataSize(); chunk += 64) {
+            juce::uint32 w[80];
+            for (int i = 0; i < 16; ++i) w[i] = juce::ByteOrder::bigEndianInt(data + chunk + 4 * (size_t) i);
+            for (int i = 16; i < 80; ++i) w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            juce::uint32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                juce::uint32 f, k;
+                if (i < 20)      { f = (b & c) | (~b & d);           k = 0x5A827999; }
+                else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ED9EBA1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8F1BBCDC; }
+                else             { f = b ^ c ^ d;                    k = 0xCA62C1D6; }
+                const juce::uint32 t = rotateLeft(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rotateLeft(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+        }
+
+        std::array<juce::uint8, 20> digest{};
+        for (size_t i = 0; i < 20; ++i) digest[i] = (juce::uint8) (h[i / 4] >> (24 - 8 * (i % 4)));
+        return digest;
+    }
+
+    // The whole remote: it draws from the tiles and state the server streams
+    constexpr const char* Page = R"html(<!DOCTYPE html>
+<html><head><meta charset="utf-8">
+<meta name="viewport" content="width=device-width,initial-scale=1,user-scalable=no">
+<title>PulseDJ Remote</title>
+<style>
+body{margin:0;background:#111;color:#ddd;font:14px sans-serif;user-select:none;-webkit-user-select:none;touch-action:manipulation}
+.deck{padding:8px;border-bottom:1px solid #333}
+.info{display:flex;justify-content:space-between;margin-bottom:4px;white-space:nowrap;overflow:hidden}
+canvas{width:100%;display:block;background:#000}
+.wave{height:120px}.over{height:28px;margin-top:4px}
+.row{display:flex;gap:6px;margin-top:6px;align-items:center}
+button{flex:1;padding:14px 0;background:#2a2a2a;color:#eee;border:1px solid #444;border-radius:6px;font-size:15px}
+button.on{background:#2a6a3a;border-color:#4c8}
+input[type=range]{flex:1}
+#status{padding:4px 8px;color:#888}
+</style></head><body>
+<div id="status">connecting</div>
+<div id="decks"></div>
+<div class="deck"><div class="row">A<input id="xf" type="range" min="-1" max="1" step="0.01" value="0">B</div></div>
+<script>
+const TILE=1024, VIEW_SEC=8, decks=[], status=document.getElementById('status');
+let ws=null;
+function send(text){if(ws&&ws.readyState===1)ws.send(text);}
+function el(tag,cls,parent){const e=document.createElement(tag);if(cls)e.className=cls;parent.appendChild(e);return e;}
+function hold(button,control,d){
+  button.onpointerdown=()=>send(control+' '+d+' 1');
+  button.onpointerup=button.onpointercancel=()=>send(control+' '+d+' 0');
+}
+function slider(parent,label,min,max,step,value,onchange){
+  el('span','',parent).textContent=label;
+  const s=el('input','',parent);Object.assign(s,{type:'range',min:min,max:max,step:step,value:value});
+  s.oninput=()=>onchange(s.value);
+  s.ondblclick=()=>{s.value=value;onchange(value);};
+  return s;
+}
+for(let d=0;d<2;d++){
+  const root=el('div','deck',document.getElementById('decks')), info=el('div','info',root);
+  const deck={index:d,id:0,track:null,tiles:new Map(),pos:0,ratio:0,at:performance.now(),bpm:0,playing:false,length:0,
+              name:el('span','',info),time:el('span','',info)};
+  deck.wave=el('canvas','wave',root);deck.over=el('canvas','over',root);
+  deck.name.textContent='Deck '+'AB'[d];
+  const transport=el('div','row',root);
+  for(const [label,control] of [['CUE','cue'],['PLAY','play'],['SYNC','sync']]){
+    const b=el('button','',transport);b.textContent=label;hold(b,control,d);
+    if(control==='play')deck.playButton=b;
+  }
+  const pads=el('div','row',root);
+  for(let p=1;p<=4;p++){const b=el('button','',pads);b.textContent=p;b.onpointerdown=()=>send('hotcue '+d+' '+p);}
+  for(const beats of [-4,4]){
+    const b=el('button','',pads);b.textContent=(beats<0?'-':'+')+Math.abs(beats);
+    b.onpointerdown=()=>send('beatjump '+d+' '+beats);
+  }
+  const faders=el('div','row',root);
+  slider(faders,'VOL',0,1,0.01,1,v=>send('volume '+d+' '+v));
+  slider(faders,'TEMPO',0.92,1.08,0.001,1,v=>send('tempo '+d+' '+v));
+  decks.push(deck);
+}
+const xf=document.getElementById('xf');
+xf.oninput=()=>send('crossfader 0 '+xf.value);
+
+function position(deck){return deck.pos+deck.ratio*(performance.now()-deck.at)/1000;}
+function onTrack(m){
+  const deck=decks[m.deck];if(!deck||m.type!=='track')return;
+  deck.id=m.id;deck.track=m;deck.tiles=new Map();
+  deck.name.textContent=m.name||('Deck '+'AB'[m.deck]);
+}
+function onBinary(v){
+  const deck=decks[v.getUint8(1)];if(!deck)return;
+  if(v.getUint8(0)===1){
+    const fields=v.getUint8(2);let o=3;
+    const next=()=>{const x=v.getFloat32(o,true);o+=4;return x;};
+    if(fields&1){deck.pos=next();deck.at=performance.now();}
+    if(fields&2)deck.ratio=next();
+    if(fields&4)deck.bpm=next();
+    if(fields&8)deck.playing=next()>0;
+    if(fields&16)deck.length=next();
+    deck.playButton.className=deck.playing?'on':'';
+  }else if(v.getUint8(0)===2){
+    const level=v.getUint8(2), id=v.getUint32(4,true), first=v.getUint32(8,true), n=v.getUint32(12,true);
+    if(id!==deck.id)return;
+    deck.tiles.set(level+':'+Math.floor(first/TILE),
+                   {first:first,n:n,mm:new Int8Array(v.buffer,16,2*n),bands:new Uint8Array(v.buffer,16+2*n,3*n)});
+  }
+}
+// The tile holding bin i, asked for once; null until it is here
+function tileFor(deck,level,i){
+  const key=level+':'+Math.floor(i/TILE), t=deck.tiles.get(key);
+  if(t!==undefined)return t;
+  deck.tiles.set(key,null);
+  send('tile '+deck.index+' '+deck.id+' '+level+' '+Math.floor(i/TILE));
+  return null;
+}
+function sized(canvas){
+  const w=Math.round(canvas.clientWidth*devicePixelRatio), h=Math.round(canvas.clientHeight*devicePixelRatio);
+  if(canvas.width!==w||canvas.height!==h){canvas.width=w;canvas.height=h;}
+  const ctx=canvas.getContext('2d');ctx.clearRect(0,0,w,h);return ctx;
+}
+function drawWave(deck,canvas,startSec,spanSec,cursorSec){
+  const ctx=sized(canvas), w=canvas.width, h=canvas.height, mid=h/2, track=deck.track;
+  if(track&&track.levels.length&&spanSec>0){
+    const rate=track.sampleRate, perPx=spanSec*rate/w;
+    let l=0;
+    while(l+1<track.levels.length&&track.levels[l+1].samplesPerBin<=perPx)l++;
+    const level=track.levels[l], spb=level.samplesPerBin;
+    for(let x=0;x<w;x++){
+      const s=(startSec+x*spanSec/w)*rate, b0=Math.floor(s/spb), b1=Math.max(b0+1,Math.floor((s+perPx)/spb));
+      let lo=0,hi=0,low=0,mids=0,high=0,n=0;
+      for(let b=Math.max(0,b0);b<Math.min(b1,level.bins);b++){
+        const t=tileFor(deck,l,b);if(!t)continue;
+        const j=b-t.first;if(j<0||j>=t.n)continue;
+        lo=Math.min(lo,t.mm[2*j]);hi=Math.max(hi,t.mm[2*j+1]);
+        low+=t.bands[3*j];mids+=t.bands[3*j+1];high+=t.bands[3*j+2];n++;
+      }
+      if(!n)continue;
+      const scale=255/Math.max(1,low,mids,high);
+      ctx.fillStyle='rgb('+(low*scale|0)+','+(mids*scale|0)+','+(high*scale|0)+')';
+      ctx.fillRect(x,mid-hi/127*mid,1,Math.max(1,(hi-lo)/127*mid));
+    }
+  }
+  ctx.fillStyle='#fff';
+  ctx.fillRect(Math.round((cursorSec-startSec)/spanSec*w),0,Math.max(1,devicePixelRatio),h);
+}
+function clock(sec){
+  const s=Math.max(0,sec);
+  return Math.floor(s/60)+':'+('0'+Math.floor(s%60)).slice(-2)+'.'+Math.floor(s*10%10);
+}
+function frame(){
+  for(const deck of decks){
+    const pos=position(deck);
+    drawWave(deck,deck.wave,pos-VIEW_SEC/2,VIEW_SEC,pos);
+    drawWave(deck,deck.over,0,deck.length,pos);
+    deck.time.textContent=clock(pos)+'  -'+clock(deck.length-pos)+'  '+(deck.bpm>0?deck.bpm.toFixed(1):'--')+' BPM';
+  }
+  requestAnimationFrame(frame);
+}
+function connect(){
+  ws=new WebSocket((location.protocol==='https:'?'wss://':'ws://')+location.host+'/ws');
+  ws.binaryType='arraybuffer';
+  ws.onopen=()=>{status.textContent='connected';};
+  ws.onclose=()=>{status.textContent='disconnected, retrying';for(const deck of decks)deck.tiles=new Map();setTimeout(connect,1000);};
+  ws.onmessage=e=>{if(typeof e.data==='string')onTrack(JSON.parse(e.data));else onBinary(new DataView(e.data));};
+}
+connect();
+requestAnimationFrame(frame);
+</script></body></html>
+)html";
+}
+
+//==============================================================================
+class WebRemote::Client : private juce::Thread {
+public:
+    Client(WebRemote& owner, std::unique_ptr<juce::StreamingSocket> connection)
+        : juce::Thread("Web Remote Client"), owner(owner), socket(std::move(connection)), cache(owner.cacheDirectory)
+    {
+       #if JUCE_MAC
+        int on = 1;
+        setsockopt(socket->getRawSocketHandle(), SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+       #endif
+        startThread(juce::Thread::Priority::low);
+    }
+
+    ~Client() override
+    {
+        // Between frames the thread sees this within a frame period and says goodbye to the page;
+        // closing the socket unblocks it if it is stuck in a read
+        signalThreadShouldExit();
+        waitForThreadToExit(500);
+        socket->close();
+        stopThread(2000);
+    }
+
+    bool isFinished() const { return !isThreadRunning(); }
+
+private:
+    // What the page was last sent of a deck, which it extrapolates from
+    struct Sent {
+        bool valid{false};
+        double positionSec{0.0};
+        double ratio{0.0};
+        juce::uint64 timeNs{0};
+        float bpm{0.0f};
+        bool playing{false};
+        float lengthSec{0.0f};
+    };
+
+    struct DeckView {
+        juce::uint32 trackId{0};
+        bool hasSummary{false};
+        juce::uint32 nextProbeMs{0};
+        Sent sent;
+    };
+
+    void run() override
+    {
+        std::string request;
+        if (!readRequest(request)) return;
+        const juce::StringArray lines = juce::StringArray::fromLines(juce::String::fromUTF8(request.data(), (int) request.size()));
+        const juce::StringArray requestLine = juce::StringArray::fromTokens(lines[0], " ", "");
+        if (requestLine.size() < 3 || requestLine[0] != "GET") {
+            respond(*socket, "405 Method Not Allowed");
+            return;
+        }
+        const juce::String path = requestLine[1].upToFirstOccurrenceOf("?", false, false);
+        if (path == "/" || path == "/index.html") {
+            respond(*socket, "200 OK", "text/html; charset=utf-8", Page, std::strlen(Page));
+            return;
+        }
+        if (path != "/ws") {
+            respond(*socket, "404 Not Found");
+            return;
+        }
+
+        juce::String key;
+        for (int i = 1; i < lines.size(); ++i) {
+            if (lines[i].upToFirstOccurrenceOf(":", false, false).trim().equalsIgnoreCase("Sec-WebSocket-Key"))
+                key = lines[i].fromFirstOccurrenceOf(":", false, false).trim();
+        }
+        if (key.isEmpty()) {
+            respond(*socket, "400 Bad Request");
+            return;
+        }
+        const auto digest = sha1(key + HandshakeGuid);
+        const juce::String accept = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                                    "Sec-WebSocket-Accept: " + juce::Base64::toBase64(digest.data(), digest.size()) + "\r\n\r\n";
+        if (!writeAll(*socket, accept.toRawUTF8(), accept.getNumBytesAsUTF8())) return;
+        serve();
+    }
+
+    // Up to the blank line after the headers
+    bool readRequest(std::string& request)
+    {
+        const juce::uint32 deadline = juce::Time::getMillisecondCounter() + RequestTimeoutMs;
+        char chunk[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            const auto left = (juce::int32) (deadline - juce::Time::getMillisecondCounter());
+            if (threadShouldExit() || left <= 0 || request.size() > MaxRequestBytes) return false;
+            const int ready = socket->waitUntilReady(true, std::min(100, (int) left));
+            if (ready < 0) return false;
+            if (ready == 0) continue;
+            const int got = socket->read(chunk, (int) sizeof(chunk), false);
+            if (got <= 0) return false;
+            request.append(chunk, (size_t) got);
+        }
+        return true;
+    }
+
+    void serve()
+    {
+        const double periodMs = 1000.0 / owner.settings.fps;
+        double next = juce::Time::getMillisecondCounterHiRes();
+        juce::MemoryBlock payload;
+        while (!threadShouldExit()) {
+            const double now = juce::Time::getMillisecondCounterHiRes();
+            if (now >= next) {
+                if (!update()) return;
+                next += periodMs;
+                if (next < now) next = now;   // fell behind: no burst to catch up
+                continue;
+            }
+            const int ready = socket->waitUntilReady(true, std::max(1, (int) (next - now)));
+            if (ready < 0) return;
+            if (ready == 0) continue;
+
+            juce::uint8 opcode = 0;
+            if (!readFrame(opcode, payload)) return;
+            switch (opcode) {
+                case Text:
+                    if (!handleCommand(juce::String::fromUTF8(static_cast<const char*>(payload.getData()), (int) payload.getSize())))
+                        return;
+                    break;
+                case Ping:
+                    if (!sendFrame(Pong, payload.getData(), payload.getSize())) return;
+                    break;
+                case Close:
+                    sendFrame(Close, payload.getData(), std::min<size_t>(2, payload.getSize()));
+                    return;
+                default:
+                    break;   // the page sends no binary or fragmented messages
+            }
+        }
+        const juce::uint8 goingAway[2] = { 0x03, 0xE9 };   // 1001
+        sendFrame(Close, goingAway, sizeof(goingAway));
+    }
+
+    bool readAll(void* data, size_t size)
+    {
+        return size == 0 || socket->read(data, (int) size, true) == (int) size;
+    }
+
+    bool readFrame(juce::uint8& opcode, juce::MemoryBlock& payload)
+    {
+        juce::uint8 head[2];
+        if (!readAll(head, sizeof(head))) return false;
+        juce::uint64 length = head[1] & 0x7f;
+        if (length == 126) {
+            juce::uint8 extended[2];
+            if (!readAll(extended, sizeof(extended))) return false;
+            length = juce::ByteOrder::bigEndianShort(extended);
+        }
+        else if (length == 127) {
+            juce::uint8 extended[8];
+            if (!readAll(extended, sizeof(extended))) return false;
+            length = juce::ByteOrder::bigEndianInt64(extended);
+        }
+        // Every frame from a browser is masked (RFC 6455 5.3)
+        if ((head[1] & 0x80) == 0 || length > MaxMessageBytes) return false;
+        juce::uint8 mask[4];
+        if (!readAll(mask, sizeof(mask))) return false;
+        payload.setSize((size_t) length);
+        if (!readAll(payload.getData(), (size_t) length)) return false;
+        auto* bytes = static_cast<juce::uint8*>(payload.getData());
+        for (size_t i = 0; i < (size_t) length; ++i) bytes[i] ^= mask[i % 4];
+        opcode = head[0] & 0x0f;
+        return true;
+    }
+
+    // One write a frame, so the header never waits on Nagle for its payload
+    bool sendFrame(juce::uint8 opcode, const void* data, size_t size)
+    {
+        frame.reset();
+        frame.writeByte((char) (0x80 | opcode));
+        if (size < 126) {
+            frame.writeByte((char) size);
+        }
+        else if (size <= 0xffff) {
+            frame.writeByte((char) 126);
+            frame.writeShortBigEndian((short) size);
+        }
+        else {
+            frame.writeByte((char) 127);
+            frame.writeInt64BigEndian((juce::int64) size);
+        }
+        frame.write(data, size);
+        return writeAll(*socket, frame.getData(), frame.getDataSize());
+    }
+
+    bool handleCommand(const juce::String& text)
+    {
+        const juce::StringArray tokens = juce::StringArray::fromTokens(text, " ", "");
+        if (tokens.size() < 2) return true;
+        const int deck = tokens[1].getIntValue();
+        if (deck < 0 || deck >= MaxDecks) return true;
+        if (tokens[0] == "tile") {
+            if (tokens.size() < 5) return true;
+            return sendTile(deck, (juce::uint32) tokens[2].getLargeIntValue(), tokens[3].getIntValue(), tokens[4].getIntValue());
+        }
+        if (owner.controller != nullptr)
+            owner.controller->postNamed(tokens[0], deck, tokens[2].getFloatValue(), tokens.size() > 2, MaxTempoRange);
+        return true;
+    }
+
+    bool sendTile(int deck, juce::uint32 trackId, int level, int index)
+    {
+        const Track track = owner.getTrack(deck);
+        // A request from before the deck loaded something else
+        if (track.id != trackId || track.file == juce::File() || index < 0 || index > INT_MAX / TileBins) return true;
+        WaveformCache::Tile tile;
+        if (!cache.loadTile(track.file, level, index * TileBins, TileBins, tile)) return true;
+
+        message.reset();
+        message.writeByte((char) TileMessage);
+        message.writeByte((char) deck);
+        message.writeByte((char) level);
+        message.writeByte(0);
+        message.writeInt((int) trackId);
+        message.writeInt(tile.firstBin);
+        message.writeInt(tile.numBins());
+        message.write(tile.minMax.data(), tile.minMax.size());
+        message.write(tile.bands.data(), tile.bands.size());
+        return sendFrame(Binary, message.getData(), message.getDataSize());
+    }
+
+    bool sendTrack(int deck, const Track& track, const WaveformCache::Tile* summary)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("type", "track");
+        object->setProperty("deck", deck);
+        object->setProperty("id", (juce::int64) track.id);
+        object->setProperty("name", track.file.getFileNameWithoutExtension());
+        juce::Array<juce::var> levels;
+        if (summary != nullptr) {
+            object->setProperty("sampleRate", summary->sampleRate);
+            object->setProperty("totalSamples", summary->totalSamples);
+            object->setProperty("audioStart", summary->audioStartOffsetSec);
+            for (int l = 0; l < summary->numLevels; ++l) {
+                auto* level = new juce::DynamicObject();
+                level->setProperty("samplesPerBin", summary->levelSamplesPerBin[(size_t) l]);
+                level->setProperty("bins", summary->levelBins[(size_t) l]);
+                levels.add(juce::var(level));
+            }
+        }
+        object->setProperty("levels", levels);
+        const juce::String text = juce::JSON::toString(juce::var(object), true);
+        return sendFrame(Text, text.toRawUTF8(), text.getNumBytesAsUTF8());
+    }
+
+    // A frame's worth of track changes and state deltas
+    bool update()
+    {
+        const juce::uint64 now = DeckMixer::nowNs();
+        const juce::uint32 nowMs = juce::Time::getMillisecondCounter();
+        for (int d = 0; d < MaxDecks; ++d) {
+            const DJAudioPlayer* player = owner.decks[(size_t) d];
+            if (player == nullptr) continue;
+            DeckView& view = views[(size_t) d];
+
+            const Track track = owner.getTrack(d);
+            const bool changed = track.id != view.trackId;
+            if (changed || (!view.hasSummary && track.file != juce::File() && (juce::int32) (nowMs - view.nextProbeMs) >= 0)) {
+                WaveformCache::Tile summary;
+                const bool found = track.file != juce::File() && cache.loadTile(track.file, 0, 0, 0, summary);
+                view.nextProbeMs = nowMs + SummaryProbeMs;
+                if (changed || found) {
+                    if (!sendTrack(d, track, found ? &summary : nullptr)) return false;
+                    view.trackId = track.id;
+                    view.hasSummary = found;
+                }
+            }
+            if (!sendState(d, *player, now, view.sent)) return false;
+        }
+        return true;
+    }
+
+    bool sendState(int deck, const DJAudioPlayer& player, juce::uint64 now, Sent& sent)
+    {
+        const auto snapshot = player.getPositionSnapshot();
+        const double position = snapshot.positionAt(now);
+        const bool playing = snapshot.ratio > 0.0;
+        const BeatGrid::Ptr grid = player.getBeatGrid();
+        const float bpm = grid && grid->isValid()
+                              ? (float) (grid->getBpmAtTime(std::max(0.0, position)) * (playing ? snapshot.ratio : 1.0))
+                              : 0.0f;
+        const float length = (float) snapshot.lengthSec;
+
+        juce::uint8 fields = Position | Ratio | Bpm | Playing | Length;
+        if (sent.valid) {
+            fields = 0;
+            const double predicted = sent.positionSec + sent.ratio * (double) (now - sent.timeNs) * 1.0e-9;
+            if (std::abs(position - predicted) > PositionToleranceSec) fields |= Position;
+            if (std::abs(snapshot.ratio - sent.ratio) > RatioTolerance || playing != sent.playing) fields |= Position | Ratio;
+            if (std::abs(bpm - sent.bpm) >= 0.01f) fields |= Bpm;
+            if (playing != sent.playing) fields |= Playing;
+            if (length != sent.lengthSec) fields |= Length;
+            if (fields == 0) return true;
+        }
+
+        message.reset();
+        message.writeByte((char) StateMessage);
+        message.writeByte((char) deck);
+        message.writeByte((char) fields);
+        if (fields & Position) {
+            message.writeFloat((float) position);
+            sent.positionSec = position;
+            sent.timeNs = now;
+        }
+        if (fields & Ratio) {
+            message.writeFloat((float) snapshot.ratio);
+            sent.ratio = snapshot.ratio;
+        }
+        if (fields & Bpm) {
+            message.writeFloat(bpm);
+            sent.bpm = bpm;
+        }
+        if (fields & Playing) {
+            message.writeFloat(playing ? 1.0f : 0.0f);
+            sent.playing = playing;
+        }
+        if (fields & Length) {
+            message.writeFloat(length);
+            sent.lengthSec = length;
+        }
+        sent.valid = true;
+        return sendFrame(Binary, message.getData(), message.getDataSize());
+    }
+
+    WebRemote& owner;
+    std::unique_ptr<juce::StreamingSocket> socket;
+    WaveformCache cache;
+    std::array<DeckView, MaxDecks> views{};
+    juce::MemoryOutputStream message;
+    juce::MemoryOutputStream frame;
+};
+
+//==============================================================================
+WebRemote::WebRemote()
+    : juce::Thread("Web Remote")
+{
+}
+
+WebRemote::~WebRemote()
+{
+    stop();
+}
+
+void WebRemote::setDeck(int index, DJAudioPlayer* player)
+{
+    if (index >= 0 && index < MaxDecks) decks[(size_t) index] = player;
+}
+
+bool WebRemote::start(const Settings& newSettings)
+{
+    stop();
+    settings = newSettings;
+    settings.fps = juce::jlimit(1.0, 120.0, settings.fps);
+    if (!listener.createListener(settings.port)) {
+        std::cout << "WebRemote: could not listen on port " << settings.port << std::endl;
+        return false;
+    }
+    startThread(juce::Thread::Priority::low);
+    std::cout << "WebRemote: http://" << juce::IPAddress::getLocalAddress().toString() << ":" << settings.port
+              << "/ at " << settings.fps << " fps" << std::endl;
+    return true;
+}
+
+void WebRemote::stop()
+{
+    stopThread(1000);
+    {
+        std::lock_guard<std::mutex> guard(clientLock);
+        clients.clear();
+    }
+    listener.close();
+}
+
+int WebRemote::getNumClients() const
+{
+    std::lock_guard<std::mutex> guard(clientLock);
+    return (int) std::count_if(clients.begin(), clients.end(), [](const auto& client) { return !client->isFinished(); });
+}
+
+void WebRemote::setTrack(int deck, const juce::File& file)
+{
+    if (deck < 0 || deck >= MaxDecks) return;
+    std::lock_guard<std::mutex> guard(trackLock);
+    tracks[(size_t) deck].file = file;
+    tracks[(size_t) deck].id = nextTrackId++;
+}
+
+WebRemote::Track WebRemote::getTrack(int deck) const
+{
+    std::lock_guard<std::mutex> guard(trackLock);
+    return tracks[(size_t) deck];
+}
+
+void WebRemote::run()
+{
+    while (!threadShouldExit()) {
+        if (listener.waitUntilReady(true, 200) <= 0) continue;
+        std::unique_ptr<juce::StreamingSocket> socket(listener.waitForNextConnection());
+        if (socket == nullptr) continue;
+
+        std::lock_guard<std::mutex> guard(clientLock);
+        clients.erase(std::remove_if(clients.begin(), clients.end(), [](const auto& client) { return client->isFinished(); }),
+                      clients.end());
+        if ((int) clients.size() >= MaxClients) {
+            respond(*socket, "503 Service Unavailable");
+            continue;
+        }
+        clients.push_back(std::make_unique<Client>(*this, std::move(socket)));
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ControllerInput.h"
+
+class DJAudioPlayer;
+
+/**
+ * A remote for a tablet or a second screen: a small HTTP server that serves one page, which opens
+ * a WebSocket back to it. The page draws the decks itself, so driving it costs a few hundred
+ * bytes a frame here, whatever its size.
+ *
+ * Waveforms travel as tiles of TileBins bins read straight out of the WaveformCache summary the
+ * analysis already wrote (no audio is decoded and nothing is drawn for the page); the page asks
+ * for the tiles its view needs at the level it draws. Deck state goes out at Settings::fps as
+ * deltas: only the fields that changed, and the playhead only when the page's extrapolation of
+ * the last one (position plus ratio times the time since) has drifted by PositionToleranceSec,
+ * so a deck playing steadily sends nothing at all. Control comes back as ControllerInput named
+ * controls (postNamed), the same path as OSC and MIDI.
+ *
+ * Each page gets its own thread (at most MaxClients); they read the decks' lock-free snapshots
+ * and never touch the widgets. Wire format, WebSocket frames, numbers little-endian:
+ *   server -> page, text: {"type":"track","deck":0,"id":7,"name":"...","sampleRate":44100,
+ *       "totalSamples":N,"audioStart":s,"levels":[{"samplesPerBin":128,"bins":N},...]}
+ *       when a deck loads a track, again once its summary exists (levels empty before)
+ *   server -> page, binary state: u8 1, u8 deck, u8 fields (StateField bits), then a float32 per
+ *       bit set in bit order; position in seconds, ratio in track seconds per second
+ *   server -> page, binary tile: u8 2, u8 deck, u8 level, u8 0, u32 track id, u32 first bin,
+ *       u32 bins, then the bins' min/max pairs (int8) and low/mid/high energies (uint8)
+ *   page -> server, text: "tile <deck> <track id> <level> <index>" for bins from index * TileBins,
+ *       or "<control> <deck> [value]" with a ControllerInput::postNamed control name
+ */
+class WebRemote : private juce::Thread {
+public:
+    static constexpr int MaxDecks = ControllerInput::MaxDecks;
+    static constexpr int DefaultPort = 8080;
+    static constexpr double DefaultFps = 30.0;
+    static constexpr int MaxClients = 4;
+    static constexpr int TileBins = 1024;
+    static constexpr double PositionToleranceSec = 0.005;
+    static constexpr float MaxTempoRange = 0.5f;
+
+    enum StateField : juce::uint8 {
+        Position = 1 << 0,
+        Ratio = 1 << 1,
+        Bpm = 1 << 2,
+        Playing = 1 << 3,
+        Length = 1 << 4
+    };
+
+    struct Settings {
+        int port{DefaultPort};
+        double fps{DefaultFps};
+    };
+
+    WebRemote();
+    ~WebRemote() override;
+
+    // While stopped (not owned)
+    void setDeck(int index, DJAudioPlayer* player);
+    void setControllerInput(ControllerInput* input) { controller = input; }
+    void setWaveformCacheDirectory(const juce::File& directory) { cacheDirectory = directory; }
+
+    // UI thread: false if the port can't be opened
+    bool start(const Settings& settings);
+    void stop();
+    int getNumClients() const;
+
+    // UI thread: the file a deck just loaded (empty: none)
+    void setTrack(int deck, const juce::File& file);
+
+private:
+    class Client;
+
+    struct Track {
+        juce::File file;
+        juce::uint32 id{0};
+    };
+
+    void run() override;
+    Track getTrack(int deck) const;
+
+    Settings settings;
+    juce::StreamingSocket listener;
+    std::array<DJAudioPlayer*, MaxDecks> decks{};
+    ControllerInput* controller{nullptr};
+    juce::File cacheDirectory;
+
+    mutable std::mutex trackLock;
+    std::array<Track, MaxDecks> tracks{};
+    juce::uint32 nextTrackId{1};
+
+    mutable std::mutex clientLock;
+    std::vector<std::unique_ptr<Client>> clients;
+};
@@ -0,0 +1,249 @@
+#include <JuceHeader.h>
+#include "../src/BpmCache.h"
+#include "../src/DecoderRegistry.h"
+#include "../src/FingerprintIndex.h"
+#include "../src/KeyDetector.h"
+#include "../src/SharedCache.h"
+#include "../src/TrackAnalysis.h"
+#include "../src/WaveformGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Headless batch analysis, for preparing libraries and USB sticks ahead of a gig: every audio
+ * file under the given folders goes through the same TrackAnalysis pass as the app's library
+ * analyzer (beat grid, key, structure, loudness, waveform summary and pyramid, spectrogram), on all cores,
+ * into the caches the app reads. A laptop pointed at the same data directory then loads every
+ * track as a cache hit.
+ *
+ *     pulsedj-analyze [--data <dir>] [--shared <dir>] [--jobs N] [--force] [--no-waveform]
+ *                     [--no-bpm] [--no-loudness] [--no-fingerprint] [--no-spectrogram] [--duplicates]
+ *                     [--mp3-decoder juce|mpg123] [--quiet] <folder|file>...
+ *
+ * --data is the app's data directory (AppConfig::getAppDataDirectory(); "BetaPulseX" in the
+ * project folder for debug builds), the release location by default. The caches go to its
+ * bpm_cache/, waveforms/ and cache/mp3_index/ folders, created if missing. --shared is a
+ * SharedCache root (Library/SharedCachePath in the app): what is found there is not analysed
+ * again, and the results go there too, for every machine using it. --duplicates lists the
+ * tracks that hold the same recording (FingerprintIndex), best quality first by bitrate. Exit
+ * code 1 if any track failed, 2 on a usage error.
+ */
+
+namespace {
+    struct Options {
+        juce::File dataDirectory;
+        juce::File sharedDirectory;
+        int jobs{0};
+        TrackAnalysis::Options analysis;
+        IndexedMp3Format::Backend mp3Backend{IndexedMp3Format::Backend::Mpg123};
+        bool quiet{false};
+        bool duplicates{false};
+        std::vector<juce::File> inputs;
+    };
+
+    // Where AppConfig puts a release build's data (QStandardPaths::AppDataLocation for "David")
+    juce::File defaultDataDirectory()
+    {
+#if JUCE_MAC
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("Application Support/David");
+#elif JUCE_LINUX || JUCE_BSD
+        const juce::String xdg = juce::SystemStats::getEnvironmentVariable("XDG_DATA_HOME", {});
+        const juce::File base = xdg.isNotEmpty() ? juce::File(xdg)
+                                                 : juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile(".local/share");
+        return base.getChildFile("David");
+#else
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile("David");
+#endif
+    }
+
+    void printUsage()
+    {
+        std::cout << "usage: pulsedj-analyze [--data <dir>] [--shared <dir>] [--jobs N] [--force] [--no-waveform]\n"
+                     "                       [--no-bpm] [--no-loudness] [--no-fingerprint] [--no-spectrogram] [--duplicates]\n"
+                     "                       [--mp3-decoder juce|mpg123] [--quiet] <folder|file>..."
+                  << std::endl;
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        options.dataDirectory = defaultDataDirectory();
+        const juce::File cwd = juce::File::getCurrentWorkingDirectory();
+        for (int i = 1; i < argc; ++i) {
+            const juce::String arg(argv[i]);
+            if (arg == "--data" && i + 1 < argc) options.dataDirectory = cwd.getChildFile(argv[++i]);
+            else if (arg == "--shared" && i + 1 < argc) options.sharedDirectory = cwd.getChildFile(argv[++i]);
+            else if (arg == "--jobs" && i + 1 < argc) options.jobs = juce::String(argv[++i]).getIntValue();
+            else if (arg == "--force") options.analysis.force = true;
+            else if (arg == "--no-waveform") options.analysis.waveform = false;
+            else if (arg == "--no-bpm") options.analysis.beatGrid = false;
+            else if (arg == "--no-loudness") options.analysis.loudness = false;
+            else if (arg == "--no-fingerprint") options.analysis.fingerprint = false;
+            else if (arg == "--no-spectrogram") options.analysis.spectrogram = false;
+            else if (arg == "--duplicates") options.duplicates = true;
+            else if (arg == "--mp3-decoder" && i + 1 < argc)
+                options.mp3Backend = juce::String(argv[++i]) == "juce" ? IndexedMp3Format::Backend::Juce
+                                                                      : IndexedMp3Format::Backend::Mpg123;
+            else if (arg == "--quiet") options.quiet = true;
+            else if (arg == "--help" || arg == "-h") return false;
+            else if (arg.startsWith("--")) {
+                std::cout << "pulsedj-analyze: unknown option " << arg << std::endl;
+                return false;
+            }
+            else options.inputs.push_back(cwd.getChildFile(arg));
+        }
+        if (options.jobs <= 0) options.jobs = juce::SystemStats::getNumCpus();
+        return !options.inputs.empty()
+            && (options.analysis.beatGrid || options.analysis.waveform || options.analysis.loudness
+                || options.analysis.fingerprint || options.analysis.spectrogram)
+            && (options.analysis.fingerprint || !options.duplicates);
+    }
+
+    // Audio files under the inputs, in path order so runs are comparable
+    std::vector<juce::File> collectTracks(const std::vector<juce::File>& inputs)
+    {
+        const juce::String wildcard = DecoderRegistry::getInstance().getFormatManager().getWildcardForAllFormats();
+        std::vector<juce::File> tracks;
+        for (const auto& input : inputs) {
+            if (input.isDirectory()) {
+                for (const auto& entry : juce::RangedDirectoryIterator(input, true, wildcard, juce::File::findFiles))
+                    tracks.push_back(entry.getFile());
+            } else if (input.existsAsFile()) {
+                tracks.push_back(input);
+            } else {
+                std::cout << "pulsedj-analyze: no such file or folder " << input.getFullPathName() << std::endl;
+            }
+        }
+        std::sort(tracks.begin(), tracks.end());
+        tracks.erase(std::unique(tracks.begin(), tracks.end()), tracks.end());
+        return tracks;
+    }
+
+    // Groups of tracks the index matches, each listed once, the highest bitrate first
+    void printDuplicates(const std::vector<juce::File>& tracks, const BpmCache& bpmCache, const FingerprintIndex& index)
+    {
+        std::vector<bool> listed(tracks.size(), false);
+        std::map<juce::String, size_t> byPath;
+        for (size_t i = 0; i < tracks.size(); ++i) byPath[tracks[i].getFullPathName()] = i;
+        const auto bitrate = [&](const juce::File& file) {
+            BpmCache::Entry entry;
+            return bpmCache.load(file, entry) && entry.totalSeconds > 0.0
+                ? (int) (file.getSize() * 8 / entry.totalSeconds / 1000.0) : 0;
+        };
+
+        int groups = 0;
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            std::vector<std::uint32_t> fingerprint;
+            if (listed[i] || !bpmCache.loadFingerprint(tracks[i], fingerprint)) continue;
+            std::vector<std::pair<int, juce::File>> group{ { bitrate(tracks[i]), tracks[i] } };
+            for (const auto& match : index.find(fingerprint, tracks[i].getFullPathName())) {
+                const auto found = byPath.find(match.path);
+                if (found == byPath.end() || listed[found->second]) continue;
+                listed[found->second] = true;
+                group.emplace_back(bitrate(tracks[found->second]), tracks[found->second]);
+            }
+            if (group.size() < 2) continue;
+            listed[i] = true;
+            std::sort(group.begin(), group.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+            std::cout << "duplicates:" << std::endl;
+            for (const auto& [kbps, file] : group)
+                std::cout << "  " << kbps << " kbps  " << file.getFullPathName() << std::endl;
+            ++groups;
+        }
+        std::cout << "pulsedj-analyze: " << groups << " group(s) of duplicates" << std::endl;
+    }
+
+    const char* statusName(TrackAnalysis::Status status)
+    {
+        switch (status) {
+            case TrackAnalysis::Status::Analysed: return "analysed";
+            case TrackAnalysis::Status::Cached: return "cached";
+            case TrackAnalysis::Status::Busy: return "busy";
+            case TrackAnalysis::Status::Failed: return "FAILED";
+        }
+        return "?";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const juce::ScopedJuceInitialiser_GUI juceInit;
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    const juce::File bpmDirectory = options.dataDirectory.getChildFile("bpm_cache");
+    const juce::File waveformDirectory = options.dataDirectory.getChildFile("waveforms");
+    const juce::File mp3IndexDirectory = options.dataDirectory.getChildFile("cache/mp3_index");
+    for (const auto& directory : { bpmDirectory, waveformDirectory, mp3IndexDirectory }) {
+        if (directory.createDirectory().failed()) {
+            std::cout << "pulsedj-analyze: cannot create " << directory.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    if (options.sharedDirectory != juce::File() && !options.sharedDirectory.isDirectory()) {
+        std::cout << "pulsedj-analyze: no such folder " << options.sharedDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+    // The same setup as the app's main()
+    SharedCache::setRoot(options.sharedDirectory);
+    WaveformGenerator::setCacheDirectory(waveformDirectory);
+    DecoderRegistry::getInstance().useIndexedMp3(mp3IndexDirectory, options.mp3Backend);
+    const BpmCache bpmCache(bpmDirectory);
+
+    const auto tracks = collectTracks(options.inputs);
+    std::cout << "pulsedj-analyze: " << tracks.size() << " track(s), " << options.jobs << " job(s), data in "
+              << options.dataDirectory.getFullPathName() << std::endl;
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> analysed{0}, cached{0}, failed{0};
+    std::mutex printLock;
+    size_t done = 0;
+    FingerprintIndex fingerprints;
+    const auto started = std::chrono::steady_clock::now();
+
+    auto work = [&] {
+        for (size_t i = next++; i < tracks.size(); i = next++) {
+            auto result = TrackAnalysis::run(tracks[i], bpmCache, options.analysis);
+            if (options.duplicates) fingerprints.add(tracks[i].getFullPathName(), std::move(result.fingerprint));
+            switch (result.status) {
+                case TrackAnalysis::Status::Analysed: ++analysed; break;
+                case TrackAnalysis::Status::Cached: ++cached; break;
+                case TrackAnalysis::Status::Busy:
+                case TrackAnalysis::Status::Failed: ++failed; break;
+            }
+            const std::lock_guard<std::mutex> lock(printLock);
+            ++done;
+            if (options.quiet && result.status != TrackAnalysis::Status::Failed) continue;
+            juce::String line;
+            line << "[" << (int) done << "/" << (int) tracks.size() << "] " << statusName(result.status);
+            if (result.bpm > 0.0) line << "  " << juce::String(result.bpm, 2) << " BPM";
+            if (result.key >= 0) line << "  " << juce::String(KeyDetector::getCamelot(result.key));
+            if (result.loudness.valid) line << "  " << juce::String(result.loudness.integratedLufs, 1) << " LUFS";
+            std::cout << line << "  " << tracks[i].getFullPathName() << std::endl;
+        }
+    };
+    std::vector<std::thread> workers;
+    const int numWorkers = std::min<int>(options.jobs, (int) std::max<size_t>(1, tracks.size()));
+    for (int w = 0; w < numWorkers; ++w) workers.emplace_back(work);
+    for (auto& worker : workers) worker.join();
+
+    const double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() / 60.0;
+    std::cout << "pulsedj-analyze: " << analysed.load() << " analysed, " << cached.load() << " cached, "
+              << failed.load() << " failed in " << juce::String(minutes * 60.0, 1) << " s";
+    if (analysed > 0 && minutes > 0.0)
+        std::cout << ", " << juce::String(analysed.load() / minutes, 1) << " tracks/minute";
+    std::cout << std::endl;
+    if (options.duplicates) printDuplicates(tracks, bpmCache, fingerprints);
+
+    DecoderRegistry::getInstance().shutdown();
+    return failed > 0 ? 1 : 0;
+}